@@ -10,11 +10,15 @@
 
 CXX_GUARD_START
 
-#include <mgba-util/circle-buffer.h>
-
+// Safe for one thread writing and another reading at the same time without locking.
+// Positions run up to twice the capacity so that full and empty can be told apart,
+// and each one is only ever advanced by its own side.
 struct mAudioBuffer {
-	struct mCircleBuffer data;
+	int16_t* data;
+	size_t capacity;
 	unsigned channels;
+	uint32_t readPosition;
+	uint32_t writePosition;
 };
 
 void mAudioBufferInit(struct mAudioBuffer* buffer, size_t capacity, unsigned channels);
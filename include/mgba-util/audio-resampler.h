@@ -26,6 +26,7 @@ struct mAudioResampler {
 		struct mInterpolator interp;
 		struct mInterpolatorSinc sinc;
 		struct mInterpolatorCosine cosine;
+		struct mInterpolatorPolyphase polyphase;
 	};
 	bool consume;
 };
@@ -69,6 +69,11 @@ struct GUIMenuItem {
 
 DECLARE_VECTOR(GUIMenuItemList, struct GUIMenuItem);
 
+// Called before every frame a menu is shown, so its items can change while it's open
+struct GUIMenuUpdater {
+	void (*update)(struct GUIMenuUpdater*, struct GUIMenu*);
+};
+
 struct GUIBackground;
 struct GUIMenu {
 	const char* title;
@@ -76,6 +81,7 @@ struct GUIMenu {
 	struct GUIMenuItemList items;
 	size_t index;
 	struct GUIBackground* background;
+	struct GUIMenuUpdater* updater;
 };
 
 struct GUIMenuSavedState {
@@ -153,6 +153,9 @@ void mImageDestroy(struct mImage*);
 bool mImageSave(const struct mImage*, const char* path, const char* format);
 #endif
 bool mImageSaveVF(const struct mImage*, struct VFile* vf, const char* format);
+// Formats are "png", "qoi" and "ppm". The compression level only applies to PNG,
+// where it's a zlib level from 0 to 9, or -1 for the default
+bool mImageSaveVFCompressed(const struct mImage*, struct VFile* vf, const char* format, int compression);
 
 uint32_t mImageGetPixel(const struct mImage* image, unsigned x, unsigned y);
 uint32_t mImageGetPixelRaw(const struct mImage* image, unsigned x, unsigned y);
@@ -13,6 +13,7 @@ CXX_GUARD_START
 enum mInterpolatorType {
 	mINTERPOLATOR_SINC,
 	mINTERPOLATOR_COSINE,
+	mINTERPOLATOR_POLYPHASE,
 };
 
 struct mInterpolationData {
@@ -40,12 +41,30 @@ struct mInterpolatorCosine {
 	double* lut;
 };
 
+// Windowed sinc precomputed into a bank of filters, one per subsample phase,
+// for converting whole blocks at once instead of one sample at a time
+struct mInterpolatorPolyphase {
+	struct mInterpolator d;
+
+	unsigned phases;
+	unsigned width;
+	unsigned taps;
+	double cutoff;
+	float* bank;
+	float* slope;
+};
+
 void mInterpolatorSincInit(struct mInterpolatorSinc* interp, unsigned resolution, unsigned width);
 void mInterpolatorSincDeinit(struct mInterpolatorSinc* interp);
 
 void mInterpolatorCosineInit(struct mInterpolatorCosine* interp, unsigned resolution);
 void mInterpolatorCosineDeinit(struct mInterpolatorCosine* interp);
 
+void mInterpolatorPolyphaseInit(struct mInterpolatorPolyphase* interp, unsigned phases, unsigned width);
+void mInterpolatorPolyphaseDeinit(struct mInterpolatorPolyphase* interp);
+bool mInterpolatorPolyphaseSetStep(struct mInterpolatorPolyphase* interp, double sampleStep);
+double mInterpolatorPolyphaseResample(const struct mInterpolatorPolyphase* interp, const float* const* input, unsigned channels, int16_t* output, size_t count, double time, double sampleStep);
+
 CXX_GUARD_END
 
 #endif
@@ -13,6 +13,39 @@ CXX_GUARD_START
 void* anonymousMemoryMap(size_t size);
 void mappedMemoryFree(void* memory, size_t size);
 
+// Like anonymousMemoryMap, but backed by huge pages where the platform supports it.
+// The allocation is padded out to a whole number of huge pages.
+void* hugeMemoryMap(size_t size);
+void hugeMemoryFree(void* memory, size_t size);
+
+enum mMemoryAdvice {
+	// Back the memory with huge pages, if the platform can do so after the fact
+	mMEMORY_ADVICE_HUGE_PAGES = 1,
+	// Start reading a file mapping into memory in the background
+	mMEMORY_ADVICE_READ_AHEAD = 2,
+	// Fault in anonymous memory now, instead of on first access
+	mMEMORY_ADVICE_PREFAULT = 4,
+};
+
+// Only a hint; platforms that can't act on some advice ignore it
+void mappedMemoryAdvise(void* memory, size_t size, int advice);
+
+// How many bytes of the range are backed by physical memory right now. Platforms that
+// can't tell report the whole range as resident
+size_t mappedMemoryResident(const void* memory, size_t size);
+
+// A block of memory that can be mapped several times in one process. Private
+// mappings are copy-on-write, so only the pages that get written are copied
+struct SharedMemory {
+	intptr_t handle;
+	size_t size;
+};
+
+bool sharedMemoryCreate(struct SharedMemory*, size_t size);
+void sharedMemoryDestroy(struct SharedMemory*);
+void* sharedMemoryMap(const struct SharedMemory*, bool copyOnWrite);
+void sharedMemoryUnmap(const struct SharedMemory*, void* memory);
+
 CXX_GUARD_END
 
 #endif
@@ -0,0 +1,19 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef PATCH_BPS_H
+#define PATCH_BPS_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+struct Patch;
+
+bool loadPatchBPS(struct Patch* patch);
+
+CXX_GUARD_END
+
+#endif
@@ -32,6 +32,12 @@ struct PatchFast {
 void initPatchFast(struct PatchFast*);
 void deinitPatchFast(struct PatchFast*);
 bool diffPatchFast(struct PatchFast* patch, const void* restrict in, const void* restrict out, size_t size);
+// Appends the extents for one range of the buffers, leaving the bytes outside of it
+// to be copied unchanged. Ranges must be added in increasing order of offset.
+bool diffPatchFastRange(struct PatchFast* patch, const void* restrict in, const void* restrict out, size_t offset, size_t size);
+// Appends the extents of another patch, which must all come after the ones already present.
+// This allows separate ranges to be diffed in parallel and joined afterwards.
+void appendPatchFast(struct PatchFast* patch, const struct PatchFast* other);
 
 CXX_GUARD_END
 
@@ -11,7 +11,15 @@
 CXX_GUARD_START
 
 #include <pthread.h>
+#include <sched.h>
 #include <sys/time.h>
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(__APPLE__)
+#include <pthread/qos.h>
+#endif
 #ifdef HAVE_PTHREAD_NP_H
 #include <pthread_np.h>
 #elif defined(__HAIKU__)
@@ -104,6 +112,89 @@ static inline int ThreadSetName(const char* name) {
 #endif
 }
 
+static inline int ThreadSetPriority(enum ThreadPriority priority) {
+#ifdef __APPLE__
+	// Darwin schedules by quality of service rather than by priority, which also decides
+	// whether a thread goes onto the performance or the efficiency cores
+	qos_class_t qos = QOS_CLASS_DEFAULT;
+	switch (priority) {
+	case THREAD_PRIO_LOW:
+		qos = QOS_CLASS_UTILITY;
+		break;
+	case THREAD_PRIO_HIGH:
+	case THREAD_PRIO_REALTIME:
+		qos = QOS_CLASS_USER_INTERACTIVE;
+		break;
+	case THREAD_PRIO_NORMAL:
+		break;
+	}
+	return pthread_set_qos_class_self_np(qos, 0);
+#else
+	struct sched_param param = {0};
+	if (priority == THREAD_PRIO_REALTIME) {
+		param.sched_priority = sched_get_priority_min(SCHED_RR) + 1;
+		if (!pthread_setschedparam(pthread_self(), SCHED_RR, &param)) {
+			return 0;
+		}
+		priority = THREAD_PRIO_HIGH;
+	}
+	int min = sched_get_priority_min(SCHED_OTHER);
+	int max = sched_get_priority_max(SCHED_OTHER);
+	switch (priority) {
+	case THREAD_PRIO_LOW:
+		param.sched_priority = min;
+		break;
+	case THREAD_PRIO_HIGH:
+		param.sched_priority = max;
+		break;
+	default:
+		param.sched_priority = (min + max) / 2;
+		break;
+	}
+	int res = pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+#ifdef __linux__
+	// SCHED_OTHER has no priority range on Linux, but the nice value is kept per thread
+	int nice = 0;
+	if (priority == THREAD_PRIO_LOW) {
+		nice = 10;
+	} else if (priority == THREAD_PRIO_HIGH) {
+		nice = -10;
+	}
+	res = setpriority(PRIO_PROCESS, syscall(SYS_gettid), nice);
+#endif
+	return res;
+#endif
+}
+
+static inline int ThreadSetAffinity(uint64_t mask) {
+#if defined(__linux__) && defined(CPU_SETSIZE)
+	// Android has no pthread_setaffinity_np, but it does have this
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	int cpu;
+	for (cpu = 0; cpu < 64 && cpu < CPU_SETSIZE; ++cpu) {
+		if (mask & (UINT64_C(1) << cpu)) {
+			CPU_SET(cpu, &set);
+		}
+	}
+	return sched_setaffinity(syscall(SYS_gettid), sizeof(set), &set);
+#elif defined(__FreeBSD__) && defined(HAVE_PTHREAD_NP_H)
+	cpuset_t set;
+	CPU_ZERO(&set);
+	int cpu;
+	for (cpu = 0; cpu < 64 && cpu < CPU_SETSIZE; ++cpu) {
+		if (mask & (UINT64_C(1) << cpu)) {
+			CPU_SET(cpu, &set);
+		}
+	}
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+	// Darwin only takes affinity hints between threads, not CPU masks
+	UNUSED(mask);
+	return -1;
+#endif
+}
+
 #if (__STDC_VERSION__ < 201112L) || (__STDC_NO_THREADS__ == 1)
 typedef pthread_key_t ThreadLocal;
 
@@ -140,6 +140,21 @@ static inline int ThreadSetName(const char* name) {
 	return -1;
 }
 
+static inline int ThreadSetPriority(enum ThreadPriority priority) {
+	UNUSED(priority);
+	return -1;
+}
+
+static inline int ThreadSetAffinity(uint64_t mask) {
+	// Applications only get the first three cores, whose kernel mask bits start at 16
+	int sceMask = (mask & 0x7) * SCE_KERNEL_CPU_MASK_USER_0;
+	if (!sceMask) {
+		return -1;
+	}
+	int res = sceKernelChangeThreadCpuAffinityMask(sceKernelGetThreadId(), sceMask);
+	return res < 0 ? res : 0;
+}
+
 #if (__STDC_VERSION__ < 201112L) || (__STDC_NO_THREADS__ == 1)
 typedef int ThreadLocal;
 
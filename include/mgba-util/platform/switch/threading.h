@@ -85,4 +85,16 @@ static inline void ThreadSetName(const char* name) {
 	// Unimplemented
 }
 
+static inline int ThreadSetPriority(enum ThreadPriority priority) {
+	UNUSED(priority);
+	// Unimplemented
+	return -1;
+}
+
+static inline int ThreadSetAffinity(uint64_t mask) {
+	UNUSED(mask);
+	// Unimplemented
+	return -1;
+}
+
 #endif
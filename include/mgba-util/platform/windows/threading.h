@@ -87,6 +87,34 @@ static inline int ThreadSetName(const char* name) {
 	return -1;
 }
 
+static inline int ThreadSetPriority(enum ThreadPriority priority) {
+	int value = THREAD_PRIORITY_NORMAL;
+	switch (priority) {
+	case THREAD_PRIO_LOW:
+		value = THREAD_PRIORITY_BELOW_NORMAL;
+		break;
+	case THREAD_PRIO_HIGH:
+		value = THREAD_PRIORITY_HIGHEST;
+		break;
+	case THREAD_PRIO_REALTIME:
+		value = THREAD_PRIORITY_TIME_CRITICAL;
+		break;
+	case THREAD_PRIO_NORMAL:
+		break;
+	}
+	if (!SetThreadPriority(GetCurrentThread(), value)) {
+		return GetLastError();
+	}
+	return 0;
+}
+
+static inline int ThreadSetAffinity(uint64_t mask) {
+	if (!SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR) mask)) {
+		return GetLastError();
+	}
+	return 0;
+}
+
 #if (__STDC_VERSION__ < 201112L) || (__STDC_NO_THREADS__ == 1)
 typedef DWORD ThreadLocal;
 
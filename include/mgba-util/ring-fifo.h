@@ -10,11 +10,20 @@
 
 CXX_GUARD_START
 
+#include <mgba-util/threading.h>
+
+// A queue for one producer thread and one consumer thread. Reads and writes don't lock;
+// the mutex is only taken by the Wait variants once the FIFO is empty or full, and by
+// the other side to wake them up if they're sleeping.
 struct RingFIFO {
 	void* data;
 	size_t capacity;
 	void* readPtr;
 	void* writePtr;
+
+	Mutex mutex;
+	Condition cond;
+	int waiting;
 };
 
 void RingFIFOInit(struct RingFIFO* buffer, size_t capacity);
@@ -24,6 +33,8 @@ size_t RingFIFOSize(const struct RingFIFO* buffer);
 void RingFIFOClear(struct RingFIFO* buffer);
 size_t RingFIFOWrite(struct RingFIFO* buffer, const void* value, size_t length);
 size_t RingFIFORead(struct RingFIFO* buffer, void* output, size_t length);
+size_t RingFIFOWriteWait(struct RingFIFO* buffer, const void* value, size_t length);
+size_t RingFIFOReadWait(struct RingFIFO* buffer, void* output, size_t length);
 
 CXX_GUARD_END
 
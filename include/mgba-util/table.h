@@ -10,7 +10,7 @@
 
 CXX_GUARD_START
 
-struct TableList;
+struct TableTuple;
 typedef uint32_t (*HashFunction)(const void* key, size_t len, uint32_t seed);
 
 struct TableFunctions {
@@ -22,7 +22,8 @@ struct TableFunctions {
 };
 
 struct Table {
-	struct TableList* table;
+	struct TableTuple* table;
+	uint8_t* control;
 	size_t tableSize;
 	size_t size;
 	uint32_t seed;
@@ -10,6 +10,21 @@
 
 CXX_GUARD_START
 
+enum ThreadPriority {
+	THREAD_PRIO_NORMAL = 0,
+	THREAD_PRIO_LOW,
+	THREAD_PRIO_HIGH,
+	// Only meant for threads that block most of the time, such as audio callbacks.
+	// Where the process isn't allowed realtime scheduling, this is the same as THREAD_PRIO_HIGH.
+	THREAD_PRIO_REALTIME,
+};
+
+struct ThreadPolicy {
+	enum ThreadPriority priority;
+	// Bit n allows running on logical CPU n; 0 leaves placement up to the scheduler
+	uint64_t affinity;
+};
+
 #ifndef DISABLE_THREADING
 #ifdef USE_PTHREADS
 #include <mgba-util/platform/posix/threading.h>
@@ -33,6 +48,20 @@ CXX_GUARD_START
 #define ThreadLocalSetKey(K, V) K = V
 #define ThreadLocalGetValue(K) K
 #endif
+
+// Like ThreadSetName, this applies to the calling thread. Threads start out with a normal
+// priority and no affinity. A nonzero return means at least part of the policy couldn't be
+// applied, which is common when asking for more priority than the user is allowed.
+static inline int ThreadSetPolicy(const struct ThreadPolicy* policy) {
+	int res = ThreadSetPriority(policy->priority);
+	if (policy->affinity) {
+		int affinityRes = ThreadSetAffinity(policy->affinity);
+		if (affinityRes) {
+			res = affinityRes;
+		}
+	}
+	return res;
+}
 #else
 #ifdef __3DS__
 // ctrulib already has a type called Thread
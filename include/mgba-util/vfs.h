@@ -87,12 +87,23 @@ struct VFile* VFileMemChunk(const void* mem, size_t size);
 struct mCircleBuffer;
 struct VFile* VFileFIFO(struct mCircleBuffer* backing);
 
+// Takes ownership of backing and prefetches sequential reads and flushes writes
+// on a background thread, for use on slow storage. Without threading support,
+// backing is returned as-is.
+struct VFile* VFileAsync(struct VFile* backing);
+
 #if defined(ENABLE_VFS) && defined(ENABLE_DIRECTORIES)
 struct VDir* VDirOpen(const char* path);
 struct VDir* VDirOpenArchive(const char* path);
 
 #if defined(USE_LIBZIP) || defined(USE_MINIZIP)
 struct VDir* VDirOpenZip(const char* path, int flags);
+
+// Keeps fully mapped archive members decompressed in memory after they're
+// closed, up to budget bytes, so that opening them again is instant. Off until
+// initialized; Deinit only once every file opened from an archive is closed.
+void VFileZipCacheInit(size_t budget);
+void VFileZipCacheDeinit(void);
 #endif
 
 #ifdef USE_LZMA
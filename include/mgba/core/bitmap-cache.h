@@ -55,7 +55,8 @@ void mBitmapCacheConfigureSystem(struct mBitmapCache* cache, mBitmapCacheSystemI
 void mBitmapCacheWriteVRAM(struct mBitmapCache* cache, uint32_t address);
 void mBitmapCacheWritePalette(struct mBitmapCache* cache, uint32_t entry, mColor color);
 
-void mBitmapCacheCleanRow(struct mBitmapCache* cache, struct mBitmapCacheEntry* entry, unsigned y);
+// Returns true if the row had to be redrawn
+bool mBitmapCacheCleanRow(struct mBitmapCache* cache, struct mBitmapCacheEntry* entry, unsigned y);
 bool mBitmapCacheCheckRow(struct mBitmapCache* cache, const struct mBitmapCacheEntry* entry, unsigned y);
 const mColor* mBitmapCacheGetRow(struct mBitmapCache* cache, unsigned y);
 
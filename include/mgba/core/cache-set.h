@@ -33,6 +33,8 @@ void mCacheSetAssignVRAM(struct mCacheSet*, void* vram);
 void mCacheSetWriteVRAM(struct mCacheSet*, uint32_t address);
 void mCacheSetWritePalette(struct mCacheSet*, uint32_t entry, mColor color);
 
+size_t mCacheSetMemoryUsage(const struct mCacheSet*);
+
 CXX_GUARD_END
 
 #endif
@@ -56,12 +56,24 @@ struct mCheatPatch {
 	bool check;
 };
 
+// A stretch of plain memory that compiled cheats can access directly instead of going
+// through the bus. base covers size bytes, of which address is at offset. Writes stamp
+// dirtyPages, indexed by offset >> mSTATE_PAGE_SHIFT, with *dirtyGeneration if given.
+struct mCheatMemoryMap {
+	uint8_t* base;
+	uint32_t size;
+	uint32_t offset;
+	uint32_t* dirtyPages;
+	const uint32_t* dirtyGeneration;
+};
+
 mLOG_DECLARE_CATEGORY(CHEATS);
 
 DECLARE_VECTOR(mCheatList, struct mCheat);
 DECLARE_VECTOR(mCheatPatchList, struct mCheatPatch);
 
 struct mCheatDevice;
+struct mCheatPlanOp;
 struct mCheatSet {
 	struct mCheatList list;
 
@@ -81,6 +93,11 @@ struct mCheatSet {
 	bool enabled;
 	struct mCheatPatchList romPatches;
 	struct StringList lines;
+
+	// The list compiled for mCheatRefresh, rebuilt whenever it no longer matches planSource
+	struct mCheatPlanOp* plan;
+	struct mCheatList planSource;
+	bool planValid;
 };
 
 DECLARE_VECTOR(mCheatSets, struct mCheatSet*);
@@ -90,6 +107,8 @@ struct mCheatDevice {
 	struct mCore* p;
 
 	struct mCheatSet* (*createSet)(struct mCheatDevice*, const char* name);
+	// Optional, for addresses whose host memory stays put for the lifetime of the core
+	bool (*mapMemory)(struct mCheatDevice*, uint32_t address, struct mCheatMemoryMap* map);
 
 	struct mCheatSets cheats;
 	struct Table unpatchedMemory;
@@ -125,6 +144,9 @@ void mCheatAutosave(struct mCheatDevice*);
 void mCheatRefresh(struct mCheatDevice*, struct mCheatSet*);
 void mCheatPressButton(struct mCheatDevice*, bool down);
 
+// An estimate of the heap memory held by the device and its cheat sets
+size_t mCheatDeviceMemoryUsage(const struct mCheatDevice*);
+
 CXX_GUARD_END
 
 #endif
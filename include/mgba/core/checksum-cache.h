@@ -0,0 +1,46 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_CORE_CHECKSUM_CACHE_H
+#define M_CORE_CHECKSUM_CACHE_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/core/interface.h>
+
+// Process-wide index of the checksums of ROM files, so that a file that hasn't changed
+// since it was last hashed doesn't need to be read in full again. Files are identified
+// by their path, size and modification time. The index is kept in the config directory
+// and is shared by the cores and the library. Caching is off until mChecksumCacheInit
+// is called, and Deinit writes out anything that hasn't been written yet.
+void mChecksumCacheInit(void);
+void mChecksumCacheDeinit(void);
+bool mChecksumCacheIsEnabled(void);
+
+#define mCHECKSUM_CACHE_ALL ((1 << mCHECKSUM_CRC32) | (1 << mCHECKSUM_MD5) | (1 << mCHECKSUM_SHA1))
+
+struct mChecksumCacheEntry {
+	// Which checksums below are filled in, as 1 << mCoreChecksumType
+	unsigned known;
+	uint32_t crc32;
+	uint8_t md5[16];
+	uint8_t sha1[20];
+};
+
+// Returns false if nothing is known about the file as it is now
+bool mChecksumCacheLookup(const char* path, struct mChecksumCacheEntry* entry);
+// Adds to what's known about the file, replacing anything from before it last changed
+void mChecksumCacheStore(const char* path, const struct mChecksumCacheEntry* entry);
+bool mChecksumCacheSync(void);
+
+// Hashes whatever isn't known about the file yet on a background thread. Without
+// threading support, nothing is hashed until it's asked for.
+void mChecksumCacheHashInBackground(const char* path);
+
+CXX_GUARD_END
+
+#endif
@@ -34,6 +34,7 @@ struct mCoreOptions {
 	bool rewindEnable;
 	int rewindBufferCapacity;
 	int rewindBufferInterval;
+	int runAhead;
 	float fpsTarget;
 	size_t audioBuffers;
 	unsigned sampleRate;
@@ -104,6 +105,10 @@ void mCoreConfigSetOverrideFloatValue(struct mCoreConfig*, const char* key, floa
 void mCoreConfigCopyValue(struct mCoreConfig* config, const struct mCoreConfig* src, const char* key);
 
 void mCoreConfigMap(const struct mCoreConfig* config, struct mCoreOptions* opts);
+struct ThreadPolicy;
+// The scheduling policy for the emulation, rendering and rewind threads, from threadPriority
+// ("low", "normal" or "high") and threadAffinity (a CPU mask, which can be written in hex)
+void mCoreConfigGetThreadPolicy(const struct mCoreConfig* config, struct ThreadPolicy* policy);
 void mCoreConfigLoadDefaults(struct mCoreConfig* config, const struct mCoreOptions* opts);
 
 void mCoreConfigEnumerate(const struct mCoreConfig* config, const char* prefix, void (*handler)(const char* key, const char* value, enum mCoreConfigLevel type, void* user), void* user);
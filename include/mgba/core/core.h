@@ -21,6 +21,7 @@ CXX_GUARD_START
 #ifdef ENABLE_DEBUGGERS
 #include <mgba/debugger/debugger.h>
 #endif
+#include <mgba-util/vector.h>
 
 enum mPlatform {
 	mPLATFORM_NONE = -1,
@@ -28,11 +29,39 @@ enum mPlatform {
 	mPLATFORM_GB = 1,
 };
 
+enum mCoreMemoryBacking {
+	mCORE_MEMORY_ANONYMOUS,
+	// Mapped from a file, so the pages can be dropped and read back in under pressure
+	mCORE_MEMORY_FILE,
+	// Shared with other cores in the same process
+	mCORE_MEMORY_SHARED,
+};
+
+struct mCoreMemoryUsage {
+	const char* name;
+	size_t size;
+	size_t resident;
+	enum mCoreMemoryBacking backing;
+};
+
+DECLARE_VECTOR(mCoreMemoryUsageList, struct mCoreMemoryUsage);
+
+enum mCoreDirtyState {
+	mCORE_DIRTY_IO = 1,
+	mCORE_DIRTY_PALETTE = 2,
+	mCORE_DIRTY_OAM = 4,
+	mCORE_DIRTY_VRAM = 8,
+	mCORE_DIRTY_ALL = 0xF,
+};
+
 struct mAudioBuffer;
 struct mCoreConfig;
 struct mCoreSync;
 struct mDebuggerSymbols;
 struct mStateExtdata;
+struct mStateRangeList;
+struct mStateSection;
+struct mStateWriter;
 struct mVideoLogContext;
 struct mCore {
 	void* cpu;
@@ -71,14 +100,17 @@ struct mCore {
 
 	void (*setVideoBuffer)(struct mCore*, mColor* buffer, size_t stride);
 	void (*setVideoGLTex)(struct mCore*, unsigned texid);
+	void (*setRenderSkip)(struct mCore*, bool skip);
 
 	void (*getPixels)(struct mCore*, const void** buffer, size_t* stride);
+	unsigned (*getPixelsLatency)(struct mCore*);
 	void (*putPixels)(struct mCore*, const void* buffer, size_t stride);
 
 	unsigned (*audioSampleRate)(const struct mCore*);
 	struct mAudioBuffer* (*getAudioBuffer)(struct mCore*);
 	void (*setAudioBufferSize)(struct mCore*, size_t samples);
 	size_t (*getAudioBufferSize)(struct mCore*);
+	void (*setAudioSkip)(struct mCore*, bool skip);
 
 	void (*addCoreCallbacks)(struct mCore*, struct mCoreCallbacks*);
 	void (*clearCoreCallbacks)(struct mCore*);
@@ -91,6 +123,9 @@ struct mCore {
 	void (*unloadROM)(struct mCore*);
 	size_t (*romSize)(const struct mCore*);
 	void (*checksum)(const struct mCore*, void* data, enum mCoreChecksumType type);
+	// Optional; names the file the next ROM will be loaded from, so that its checksums
+	// can be taken from and saved to the checksum cache
+	void (*setROMPath)(struct mCore*, const char* path);
 
 	bool (*loadBIOS)(struct mCore*, struct VFile* vf, int biosID);
 	bool (*selectBIOS)(struct mCore*, int biosID);
@@ -105,8 +140,22 @@ struct mCore {
 	size_t (*stateSize)(struct mCore*);
 	bool (*loadState)(struct mCore*, const void* state);
 	bool (*saveState)(struct mCore*, void* state);
+	// Incremental saves and loads only copy the pages of large memory blocks that
+	// changed since the core and state were last in sync, at checkpoint since, and
+	// return the checkpoint they're in sync at now, or 0 on failure; see
+	// mSTATE_PAGE_SHIFT. written, if given, collects the byte ranges of state that
+	// were rewritten. Writes through pointers from getMemoryBlock aren't tracked.
+	uint32_t (*loadStateIncremental)(struct mCore*, const void* state, uint32_t since);
+	uint32_t (*saveStateIncremental)(struct mCore*, void* state, uint32_t since, struct mStateRangeList* written);
+	// Which parts of the video and IO state the game wrote to since checkpoint since, as
+	// a mask of mCoreDirtyState, using the same checkpoints as incremental states. The
+	// checkpoint to pass next time is stored in checkpoint; 0 is older than any of them.
+	uint32_t (*dirtyState)(struct mCore*, uint32_t since, uint32_t* checkpoint);
+	// In order of offset; parts of the state that aren't listed are kept together
+	size_t (*listStateSections)(const struct mCore*, const struct mStateSection**);
 	bool (*loadExtraState)(struct mCore*, const struct mStateExtdata*);
 	bool (*saveExtraState)(struct mCore*, struct mStateExtdata*);
+	bool (*fork)(struct mCore*, struct mCore* target);
 
 	void (*setKeys)(struct mCore*, uint32_t keys);
 	void (*addKeys)(struct mCore*, uint32_t keys);
@@ -141,6 +190,9 @@ struct mCore {
 	size_t (*listMemoryBlocks)(const struct mCore*, const struct mCoreMemoryBlock**);
 	void* (*getMemoryBlock)(struct mCore*, size_t id, size_t* sizeOut);
 
+	// Appends the host memory the core itself owns; see mCoreListMemoryUsage
+	void (*listMemoryUsage)(const struct mCore*, struct mCoreMemoryUsageList*);
+
 	size_t (*listRegisters)(const struct mCore*, const struct mCoreRegisterInfo**);
 	bool (*readRegister)(const struct mCore*, const char* name, void* out);
 	bool (*writeRegister)(struct mCore*, const char* name, const void* in);
@@ -191,19 +243,32 @@ bool mCoreAutoloadPatch(struct mCore* core);
 bool mCoreAutoloadCheats(struct mCore* core);
 
 bool mCoreSaveState(struct mCore* core, int slot, int flags);
+bool mCoreSaveStateAsync(struct mCore* core, struct mStateWriter* writer, int slot, int flags);
 bool mCoreLoadState(struct mCore* core, int slot, int flags);
 struct VFile* mCoreGetState(struct mCore* core, int slot, bool write);
 void mCoreDeleteState(struct mCore* core, int slot);
 
 void mCoreTakeScreenshot(struct mCore* core);
+bool mCoreTakeScreenshotAsync(struct mCore* core, struct mStateWriter* writer);
 #endif
 bool mCoreTakeScreenshotVF(struct mCore* core, struct VFile* vf);
+// A NULL format uses the configured screenshotFormat
+bool mCoreTakeScreenshotVFAsync(struct mCore* core, struct mStateWriter* writer, struct VFile* vf, const char* format);
 #endif
 
 struct mCore* mCoreFindVF(struct VFile* vf);
 enum mPlatform mCoreIsCompatible(struct VFile* vf);
 struct mCore* mCoreCreate(enum mPlatform);
 
+// Duplicates a running core into target, or a newly created core for mCoreClone.
+// The clone gets its own in-memory copy of the savedata and never writes back to
+// the original save file. Callbacks, peripherals and cheats are not carried over,
+// and a core made by mCoreClone has no video buffer; fork into a target that has
+// one to see its output. With shared ROMs enabled the ROM is shared copy-on-write,
+// otherwise it is copied.
+bool mCoreFork(struct mCore* core, struct mCore* target);
+struct mCore* mCoreClone(struct mCore* core);
+
 bool mCoreSaveStateNamed(struct mCore* core, struct VFile* vf, int flags);
 bool mCoreLoadStateNamed(struct mCore* core, struct VFile* vf, int flags);
 
@@ -217,6 +282,14 @@ void* mCoreGetMemoryBlock(struct mCore* core, uint32_t start, size_t* size);
 void* mCoreGetMemoryBlockMasked(struct mCore* core, uint32_t start, size_t* size, uint32_t mask);
 const struct mCoreMemoryBlock* mCoreGetMemoryBlockInfo(struct mCore* core, uint32_t address);
 
+// Lists the host memory held by the core and what it has attached, replacing the contents of
+// the list, and returns the total resident bytes. Memory the frontend owns, like the video
+// buffer, isn't included
+size_t mCoreListMemoryUsage(struct mCore* core, struct mCoreMemoryUsageList* list);
+// Residency is only checked if memory is given; otherwise all of it counts as resident
+void mCoreMemoryUsageAdd(struct mCoreMemoryUsageList* list, const char* name, const void* memory, size_t size, enum mCoreMemoryBacking backing);
+const char* mCoreMemoryBackingName(enum mCoreMemoryBacking backing);
+
 double mCoreCalculateFramerateRatio(const struct mCore* core, double desiredFrameRate);
 
 #ifdef USE_ELF
@@ -0,0 +1,53 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_CORE_HOST_TRACE_H
+#define M_CORE_HOST_TRACE_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+// Timeline tracing of what the emulator's host threads are doing, written out in the
+// Chrome trace event format, which chrome://tracing and ui.perfetto.dev both load.
+// Unlike sampling profilers, this shows where threads block on one another.
+//
+// The functions are built whenever the ENABLE_HOST_TRACE option is on, but the mTRACE
+// instrumentation is only compiled into targets that get the ENABLE_HOST_TRACE define,
+// which the libretro core doesn't. Event names must be string literals, as only the
+// pointers are recorded. Begin and end markers have to be balanced on the same thread.
+
+struct VFile;
+
+// On success, takes ownership of the file, which is closed when tracing stops
+bool mHostTraceStart(struct VFile* vf);
+void mHostTraceStop(void);
+bool mHostTraceIsActive(void);
+
+// Only threads named after tracing was first started show up by name in the trace
+void mHostTraceSetThreadName(const char* name);
+
+void mHostTraceBegin(const char* name);
+void mHostTraceEnd(void);
+void mHostTraceInstant(const char* name);
+void mHostTraceCounter(const char* name, int64_t value);
+
+#ifdef ENABLE_HOST_TRACE
+#define mTRACE_BEGIN(NAME) mHostTraceBegin(NAME)
+#define mTRACE_END() mHostTraceEnd()
+#define mTRACE_INSTANT(NAME) mHostTraceInstant(NAME)
+#define mTRACE_COUNTER(NAME, VALUE) mHostTraceCounter(NAME, VALUE)
+#define mTRACE_THREAD_NAME(NAME) mHostTraceSetThreadName(NAME)
+#else
+#define mTRACE_BEGIN(NAME)
+#define mTRACE_END()
+#define mTRACE_INSTANT(NAME)
+#define mTRACE_COUNTER(NAME, VALUE)
+#define mTRACE_THREAD_NAME(NAME)
+#endif
+
+CXX_GUARD_END
+
+#endif
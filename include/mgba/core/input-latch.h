@@ -0,0 +1,58 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_CORE_INPUT_LATCH_H
+#define M_CORE_INPUT_LATCH_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba-util/threading.h>
+
+// How long key changes waited between being captured and being handed to the core,
+// in microseconds. Each frame that gets new keys counts once, from when the earliest
+// of the changes it picked up was captured.
+struct mInputLatchStats {
+	uint64_t changes;
+	uint32_t latency;
+	uint32_t averageLatency;
+	uint32_t maxLatency;
+};
+
+// Holds the keys a frontend sees pressed, captured from whichever thread it handles
+// input on, until the core applies them just before it runs the next frame. Capturing
+// doesn't have to stop the core, and each change is stamped with when it happened, so
+// that the time until the game can first see it is known.
+struct mInputLatch {
+	Mutex mutex;
+	uint32_t keys;
+	uint32_t applied;
+	uint64_t pendingSince;
+	struct mInputLatchStats stats;
+};
+
+struct mCore;
+
+void mInputLatchInit(struct mInputLatch* latch);
+void mInputLatchDeinit(struct mInputLatch* latch);
+
+// Timestamps are in nanoseconds on the same monotonic clock as this
+uint64_t mInputLatchNow(void);
+
+void mInputLatchSetKeys(struct mInputLatch* latch, uint32_t keys, uint64_t timestamp);
+void mInputLatchAddKeys(struct mInputLatch* latch, uint32_t keys, uint64_t timestamp);
+void mInputLatchClearKeys(struct mInputLatch* latch, uint32_t keys, uint64_t timestamp);
+
+// Only the keys that changed in the latch since it was last applied are changed on the
+// core, so keys set on the core in other ways aren't overridden
+void mInputLatchApply(struct mInputLatch* latch, struct mCore* core);
+
+void mInputLatchGetStats(struct mInputLatch* latch, struct mInputLatchStats* stats);
+void mInputLatchResetStats(struct mInputLatch* latch);
+
+CXX_GUARD_END
+
+#endif
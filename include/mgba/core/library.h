@@ -16,6 +16,8 @@ CXX_GUARD_START
 #include <mgba-util/vector.h>
 
 #define M_LIBRARY_MODEL_UNKNOWN -1
+#define M_LIBRARY_DEFAULT_THREADS 4
+#define M_LIBRARY_MAX_THREADS 32
 
 struct mLibraryEntry {
 	const char* base;
@@ -45,6 +47,9 @@ struct VFile;
 void mLibraryLoadDirectory(struct mLibrary* library, const char* base, bool recursive);
 void mLibraryClear(struct mLibrary* library);
 
+void mLibrarySetThreads(struct mLibrary* library, unsigned threads);
+void mLibrarySetProgressCallback(struct mLibrary* library, void (*callback)(void* context, size_t processed, size_t total), void* context);
+
 size_t mLibraryCount(struct mLibrary* library, const struct mLibraryEntry* constraints);
 size_t mLibraryGetEntries(struct mLibrary* library, struct mLibraryListing* out, size_t numEntries, size_t offset, const struct mLibraryEntry* constraints);
 void mLibraryEntryFree(struct mLibraryEntry* entry);
@@ -24,11 +24,19 @@ enum mLogLevel {
 	mLOG_ALL = 0x7F
 };
 
+#define mLOG_MAX_CATEGORY 64
+
+// Levels listed here are compiled out of mLOG call sites entirely, arguments included
+#ifndef mLOG_DISABLED_LEVELS
+#define mLOG_DISABLED_LEVELS 0
+#endif
+
 struct Table;
 struct mLogFilter {
 	int defaultLevels;
 	struct Table categories;
-	struct Table levels;
+	// Levels by category ID, resolved from the categories table on first use
+	uint16_t levels[mLOG_MAX_CATEGORY];
 };
 
 struct mLogger {
@@ -42,6 +50,15 @@ struct mStandardLogger {
 	struct VFile* logFile;
 };
 
+// Formats messages on the calling thread into a per-thread queue and hands them to the
+// backend from a dedicated thread. Ordering is only preserved within each thread.
+struct mAsyncLogContext;
+struct mAsyncLogger {
+	struct mLogger d;
+	struct mLogger* backend;
+	struct mAsyncLogContext* context;
+};
+
 struct mLogger* mLogGetContext(void);
 void mLogSetDefaultLogger(struct mLogger*);
 void mLogSetThreadLogger(struct mLogger*);
@@ -57,6 +74,10 @@ void mStandardLoggerInit(struct mStandardLogger*);
 void mStandardLoggerDeinit(struct mStandardLogger*);
 void mStandardLoggerConfig(struct mStandardLogger*, struct mCoreConfig* config);
 
+void mAsyncLoggerInit(struct mAsyncLogger*, struct mLogger* backend);
+void mAsyncLoggerDeinit(struct mAsyncLogger*);
+void mAsyncLoggerFlush(struct mAsyncLogger*);
+
 void mLogFilterInit(struct mLogFilter*);
 void mLogFilterDeinit(struct mLogFilter*);
 void mLogFilterLoad(struct mLogFilter*, const struct mCoreConfig*);
@@ -72,7 +93,7 @@ void mLog(int category, enum mLogLevel level, const char* format, ...);
 ATTRIBUTE_FORMAT(printf, 4, 5)
 void mLogExplicit(struct mLogger*, int category, enum mLogLevel level, const char* format, ...);
 
-#define mLOG(CATEGORY, LEVEL, ...) mLog(_mLOG_CAT_ ## CATEGORY, mLOG_ ## LEVEL, __VA_ARGS__)
+#define mLOG(CATEGORY, LEVEL, ...) ((mLOG_ ## LEVEL & mLOG_DISABLED_LEVELS) ? (void) 0 : mLog(_mLOG_CAT_ ## CATEGORY, mLOG_ ## LEVEL, __VA_ARGS__))
 
 #define mLOG_DECLARE_CATEGORY(CATEGORY) extern int _mLOG_CAT_ ## CATEGORY;
 #define mLOG_DEFINE_CATEGORY(CATEGORY, NAME, ID) \
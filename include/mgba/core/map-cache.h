@@ -72,7 +72,8 @@ void mMapCacheWriteVRAM(struct mMapCache* cache, uint32_t address);
 uint32_t mMapCacheTileId(struct mMapCache* cache, unsigned x, unsigned y);
 
 bool mMapCacheCheckTile(struct mMapCache* cache, const struct mMapCacheEntry* entry, unsigned x, unsigned y);
-void mMapCacheCleanTile(struct mMapCache* cache, struct mMapCacheEntry* entry, unsigned x, unsigned y);
+// Returns true if the tile was redrawn since the caller's entry was last updated
+bool mMapCacheCleanTile(struct mMapCache* cache, struct mMapCacheEntry* entry, unsigned x, unsigned y);
 
 void mMapCacheCleanRow(struct mMapCache* cache, unsigned y);
 const mColor* mMapCacheGetRow(struct mMapCache* cache, unsigned y);
@@ -53,10 +53,39 @@ struct mCoreMemorySearchResult {
 
 DECLARE_VECTOR(mCoreMemorySearchResults, struct mCoreMemorySearchResult);
 
+// Integer searches can instead keep one bit per aligned address in each memory block,
+// along with a snapshot of the values as of the last pass. Narrowing happens in place,
+// and results are only materialized when asked for.
+struct mCoreMemorySearchCandidateBlock {
+	int id;
+	int segment;
+	uint32_t start;
+	size_t size;
+	size_t count;
+	uint8_t* snapshot;
+	uint32_t* bitmap;
+};
+
+DECLARE_VECTOR(mCoreMemorySearchCandidateBlocks, struct mCoreMemorySearchCandidateBlock);
+
+struct mCoreMemorySearchCandidates {
+	struct mCoreMemorySearchCandidateBlocks blocks;
+	int width;
+	size_t count;
+};
+
 struct mCore;
 void mCoreMemorySearch(struct mCore* core, const struct mCoreMemorySearchParams* params, struct mCoreMemorySearchResults* out, size_t limit);
 void mCoreMemorySearchRepeat(struct mCore* core, const struct mCoreMemorySearchParams* params, struct mCoreMemorySearchResults* inout);
 
+void mCoreMemorySearchCandidatesInit(struct mCoreMemorySearchCandidates*);
+void mCoreMemorySearchCandidatesDeinit(struct mCoreMemorySearchCandidates*);
+void mCoreMemorySearchCandidatesClear(struct mCoreMemorySearchCandidates*);
+
+bool mCoreMemorySearchCandidatesSearch(struct mCore* core, const struct mCoreMemorySearchParams* params, struct mCoreMemorySearchCandidates* out);
+size_t mCoreMemorySearchCandidatesNarrow(struct mCore* core, const struct mCoreMemorySearchParams* params, struct mCoreMemorySearchCandidates* inout);
+size_t mCoreMemorySearchCandidatesResults(const struct mCoreMemorySearchCandidates*, struct mCoreMemorySearchResults* out, size_t offset, size_t limit);
+
 CXX_GUARD_END
 
 #endif
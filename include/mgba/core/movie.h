@@ -0,0 +1,94 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_CORE_MOVIE_H
+#define M_CORE_MOVIE_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba-util/vector.h>
+
+#define mCORE_MOVIE_DEFAULT_KEYFRAME_INTERVAL 600
+
+struct mCore;
+struct VFile;
+
+enum mCoreMovieMode {
+	mMOVIE_STOPPED = 0,
+	mMOVIE_RECORDING,
+	mMOVIE_PLAYING,
+};
+
+// The same keys held for a number of frames in a row
+struct mCoreMovieRun {
+	uint32_t keys;
+	uint32_t frames;
+};
+
+// The state at the start of a frame, before its keys are pressed, followed by the savedata
+struct mCoreMovieKeyframe {
+	uint32_t frame;
+	void* data;
+	uint32_t size;
+	uint32_t stateSize;
+	uint32_t savedataSize;
+	bool compressed;
+};
+
+DECLARE_VECTOR(mCoreMovieRunList, struct mCoreMovieRun);
+DECLARE_VECTOR(mCoreMovieKeyframeList, struct mCoreMovieKeyframe);
+
+// A movie is the keys pressed on every frame, stored as runs, starting from a keyframe of
+// the state when recording began. Another keyframe is taken every keyframeInterval frames,
+// whether recording or playing, so seeking never has to emulate more than that many frames.
+// Keyframes use the raw state and carry the savedata, since games write to it as they go.
+struct mCoreMovie {
+	enum mCoreMovieMode mode;
+	int platform;
+	uint32_t romCrc32;
+	unsigned keyframeInterval;
+	// How many times recording has gone back and dropped frames it had already recorded
+	unsigned rerecords;
+
+	struct mCoreMovieRunList runs;
+	struct mCoreMovieKeyframeList keyframes;
+	uint32_t length;
+
+	// The next frame to be run, and where its keys are among the runs
+	uint32_t frame;
+	size_t run;
+	uint32_t runOffset;
+
+	void* scratch;
+	size_t scratchSize;
+};
+
+void mCoreMovieInit(struct mCoreMovie*, unsigned keyframeInterval);
+void mCoreMovieDeinit(struct mCoreMovie*);
+
+// Throws away anything already in the movie and starts recording from the current state
+bool mCoreMovieStartRecording(struct mCoreMovie*, struct mCore*);
+// Loads the first keyframe, which has to match the game the core is running
+bool mCoreMovieStartPlayback(struct mCoreMovie*, struct mCore*);
+void mCoreMovieStop(struct mCoreMovie*);
+
+// Records the keys, or presses the recorded ones instead, then runs a frame. Once playback
+// gets to the end, the movie stops and nothing is run.
+bool mCoreMovieRunFrame(struct mCoreMovie*, struct mCore*, uint32_t keys);
+// Puts the core at the start of a frame, emulating forward from the last keyframe before
+// it with rendering and audio skipped. When recording, every frame from there on is dropped,
+// and recording picks up from that frame.
+bool mCoreMovieSeek(struct mCoreMovie*, struct mCore*, uint32_t frame);
+bool mCoreMovieGetKeys(const struct mCoreMovie*, uint32_t frame, uint32_t* keys);
+
+bool mCoreMovieIsCompatible(const struct mCoreMovie*, struct mCore*);
+bool mCoreMovieSave(const struct mCoreMovie*, struct VFile*);
+bool mCoreMovieLoad(struct mCoreMovie*, struct VFile*);
+
+CXX_GUARD_END
+
+#endif
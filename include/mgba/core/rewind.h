@@ -10,38 +10,147 @@
 
 CXX_GUARD_START
 
+#include <mgba/core/serialize.h>
+#include <mgba-util/patch/fast.h>
 #include <mgba-util/vector.h>
 #ifndef DISABLE_THREADING
 #include <mgba-util/threading.h>
 #endif
 
-DECLARE_VECTOR(mCoreRewindPatches, struct PatchFast);
+#define mCORE_REWIND_MAX_WORKERS 8
 
+struct ThreadPolicy;
+struct VDir;
 struct VFile;
+
+// Every stored state has the difference from the one before it, so any state can be
+// reached by walking from the current one in either direction. Every so often a whole
+// state is kept as well, so that seeking a long way doesn't have to walk every step.
+// Both are compressed when zlib is available.
+//
+// Entries that have been spilled keep their delta and keyframe in a spill file instead,
+// one after the other at spillOffset, and only read them back when they're needed.
+struct mCoreRewindEntry {
+	void* delta;
+	void* keyframe;
+	uint32_t deltaSize;
+	uint32_t deltaRawSize;
+	uint32_t keyframeSize;
+	uint32_t stateSize;
+	// 0 while the entry is still in memory
+	uint32_t spillSegment;
+	uint32_t spillOffset;
+};
+
+struct mCoreRewindSpillSegment {
+	struct VFile* vf;
+	uint32_t id;
+	uint32_t size;
+};
+
+DECLARE_VECTOR(mCoreRewindEntries, struct mCoreRewindEntry);
+DECLARE_VECTOR(mCoreRewindSpillSegments, struct mCoreRewindSpillSegment);
+
+struct mCoreRewindContext;
+
+#ifndef DISABLE_THREADING
+struct mCoreRewindWorker {
+	struct mCoreRewindContext* p;
+	struct PatchFast patch;
+	size_t start;
+	size_t end;
+	Thread thread;
+};
+#endif
+
 struct mCoreRewindContext {
-	struct mCoreRewindPatches patchMemory;
-	size_t current;
-	size_t size;
+	struct mCoreRewindEntries entries;
+	size_t first;
+	size_t position;
+	size_t maxEntries;
+	size_t memoryLimit;
+	size_t memoryUsed;
+	unsigned sinceKeyframe;
+	struct PatchFast patch;
+	void* diffBuffer;
+	size_t diffBufferSize;
+	void* compressBuffer;
+	size_t compressBufferSize;
 	struct VFile* previousState;
 	struct VFile* currentState;
+	uint32_t previousCheckpoint;
+	uint32_t currentCheckpoint;
+	struct mStateRangeList written;
 	int rewindFrameCounter;
 
+	// Instead of being dropped for the memory limit, the oldest entries can be moved out to
+	// a series of append-only files, and everything from first up to spilled lives there.
+	// Files are deleted once every entry in them has been dropped.
+	struct VDir* spillDir;
+	char* spillName;
+	size_t spillLimit;
+	size_t spillUsed;
+	size_t spilled;
+	struct mCoreRewindSpillSegments spillSegments;
+	uint32_t nextSpillSegment;
+	void* spillBuffer;
+	size_t spillBufferSize;
+
 #ifndef DISABLE_THREADING
 	bool onThread;
 	Thread thread;
 	Condition cond;
 	Mutex mutex;
 	bool ready;
+
+	unsigned nWorkers;
+	struct mCoreRewindWorker* workers;
+	Mutex workerMutex;
+	Condition workerCond;
+	Condition workerDoneCond;
+	unsigned workerJob;
+	unsigned workersPending;
+	bool workersStopping;
+	const void* diffIn;
+	const void* diffOut;
+
+	// Each diffing thread applies this to itself when it next wakes up and sees a new generation
+	struct ThreadPolicy threadPolicy;
+	unsigned threadPolicyGeneration;
 #endif
 };
 
 void mCoreRewindContextInit(struct mCoreRewindContext*, size_t entries, bool onThread);
 void mCoreRewindContextDeinit(struct mCoreRewindContext*);
+// Splits diffing of large states between this many threads, counting the one that would
+// diff on its own. 0 or 1 keeps everything on one thread.
+void mCoreRewindContextSetWorkers(struct mCoreRewindContext*, unsigned workers);
+// Drops the oldest states once the stored history takes up more than this many bytes,
+// on top of the entry limit. 0 means no limit.
+void mCoreRewindContextSetMemoryLimit(struct mCoreRewindContext*, size_t bytes);
+// Sets the priority and affinity of the diffing threads, which the emulation thread ends up
+// waiting on if they fall behind
+void mCoreRewindContextSetThreadPolicy(struct mCoreRewindContext*, const struct ThreadPolicy*);
+#if defined(ENABLE_VFS) && defined(ENABLE_DIRECTORIES)
+// Moves the oldest states out to files in a directory once the memory limit is reached,
+// rather than dropping them, until the files hold this many bytes. The files are named after
+// name and written in the background. A NULL directory or a limit of 0 turns this off.
+void mCoreRewindContextSetSpill(struct mCoreRewindContext*, struct VDir* dir, const char* name, size_t limit);
+#endif
 
 struct mCore;
 void mCoreRewindAppend(struct mCoreRewindContext*, struct mCore*);
 bool mCoreRewindRestore(struct mCoreRewindContext*, struct mCore*, unsigned count);
 
+// States are indexed from 0 for the oldest one still kept. Seeking doesn't discard
+// anything, so it's possible to go forward again until the next state is appended.
+size_t mCoreRewindCount(struct mCoreRewindContext*);
+size_t mCoreRewindPosition(struct mCoreRewindContext*);
+
+// The history plus the scratch states and buffers used to build it
+size_t mCoreRewindMemoryUsage(struct mCoreRewindContext*);
+bool mCoreRewindSeek(struct mCoreRewindContext*, struct mCore*, size_t index);
+
 CXX_GUARD_END
 
 #endif
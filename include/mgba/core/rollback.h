@@ -0,0 +1,106 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_CORE_ROLLBACK_H
+#define M_CORE_ROLLBACK_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#define mCORE_ROLLBACK_MAX_PLAYERS 4
+// How far emulation may run ahead of the last frame with every input known
+#define mCORE_ROLLBACK_MAX_FRAMES 12
+#define mCORE_ROLLBACK_MAX_DELAY 8
+#define mCORE_ROLLBACK_INPUT_FRAMES 64
+#define mCORE_ROLLBACK_CHECKSUMS 8
+#define mCORE_ROLLBACK_DEFAULT_CHECKSUM_INTERVAL 60
+
+struct mCore;
+
+enum mCoreRollbackMessageType {
+	mROLLBACK_MESSAGE_INPUT = 0,
+	// A hash of the state at the start of a frame, once every input before it is known
+	mROLLBACK_MESSAGE_CHECKSUM = 1,
+};
+
+struct mCoreRollbackMessage {
+	enum mCoreRollbackMessageType type;
+	int player;
+	uint32_t frame;
+	union {
+		uint32_t keys;
+		uint64_t checksum;
+	};
+};
+
+// Carries messages to the other peers. Messages from one player must arrive in the
+// order they were sent.
+struct mCoreRollbackTransport {
+	void (*send)(struct mCoreRollbackTransport*, const struct mCoreRollbackMessage*);
+	bool (*receive)(struct mCoreRollbackTransport*, struct mCoreRollbackMessage*);
+};
+
+struct mCoreRollbackInput {
+	uint32_t frame;
+	uint32_t keys[mCORE_ROLLBACK_MAX_PLAYERS];
+	unsigned confirmed;
+};
+
+struct mCoreRollbackChecksum {
+	uint32_t frame;
+	uint64_t local;
+	uint64_t remote[mCORE_ROLLBACK_MAX_PLAYERS];
+	unsigned known;
+};
+
+// Every peer emulates every player's core from the same inputs, so nothing but input
+// ever has to cross the network. Local input is delayed by a few frames to hide most
+// of the latency; whatever is still missing is predicted, and when a prediction turns
+// out wrong the cores are rolled back to the last state before it and run forward again.
+// Peers also trade hashes of the states they settle on, so that a desync is noticed.
+// With one core, every player's keys are pressed on it together.
+struct mCoreRollback {
+	struct mCore* cores[mCORE_ROLLBACK_MAX_PLAYERS];
+	int nCores;
+	int nPlayers;
+	int localPlayer;
+	unsigned inputDelay;
+
+	struct mCoreRollbackTransport* transport;
+
+	// Applies one frame of input for every player and runs a frame. By default each
+	// player's keys go to the core with the same index and each core runs one frame.
+	// Frames that are being run again have resimulating set, and needn't be shown.
+	void (*runFrame)(struct mCoreRollback*, const uint32_t* keys);
+	void (*desynced)(struct mCoreRollback*, int player, uint32_t frame);
+	void* context;
+
+	unsigned checksumInterval;
+	uint32_t nextChecksum;
+	uint32_t desyncFrame;
+	bool desync;
+
+	uint32_t frame;
+	uint32_t confirmedFrame;
+	uint32_t rollbackFrame;
+	bool resimulating;
+	unsigned rollbacks;
+
+	size_t stateSize;
+	void* states[mCORE_ROLLBACK_MAX_FRAMES];
+	struct mCoreRollbackInput inputs[mCORE_ROLLBACK_INPUT_FRAMES];
+	uint32_t lastKeys[mCORE_ROLLBACK_MAX_PLAYERS];
+	struct mCoreRollbackChecksum checksums[mCORE_ROLLBACK_CHECKSUMS];
+};
+
+bool mCoreRollbackInit(struct mCoreRollback*, struct mCore** cores, int nCores, int nPlayers, int localPlayer, unsigned inputDelay);
+void mCoreRollbackDeinit(struct mCoreRollback*);
+
+bool mCoreRollbackRunFrame(struct mCoreRollback*, uint32_t localKeys);
+
+CXX_GUARD_END
+
+#endif
@@ -10,6 +10,11 @@
 
 CXX_GUARD_START
 
+#include <mgba-util/vector.h>
+#ifndef DISABLE_THREADING
+#include <mgba-util/threading.h>
+#endif
+
 enum mStateExtdataTag {
 	EXTDATA_NONE = 0,
 	EXTDATA_SCREENSHOT = 1,
@@ -30,6 +35,8 @@ enum mStateExtdataTag {
 #define SAVESTATE_RTC        8
 #define SAVESTATE_METADATA   16
 #define SAVESTATE_ALL        31
+// Not an extdata flag: writes a sectioned container instead, see state-container.h
+#define SAVESTATE_SECTIONED  32
 
 struct mStateExtdataItem {
 	int32_t size;
@@ -41,6 +48,103 @@ struct mStateExtdata {
 	struct mStateExtdataItem data[EXTDATA_MAX];
 };
 
+// Cores track writes to their large memory blocks in pages of this size. Each page
+// is stamped with the generation it was last written in, and each checkpoint hands
+// out the current generation as a token before starting a new one, so a page has
+// changed since a checkpoint if its stamp is newer than the token. A token of 0
+// means "no checkpoint": everything counts as changed.
+#define mSTATE_PAGE_SHIFT 8
+#define mSTATE_PAGE_SIZE (1 << mSTATE_PAGE_SHIFT)
+
+struct mStateRange {
+	uint32_t offset;
+	uint32_t size;
+};
+
+DECLARE_VECTOR(mStateRangeList, struct mStateRange);
+
+enum mStateSectionId {
+	// Whatever parts of the raw state a core doesn't list separately
+	mSTATE_SECTION_STATE = 0,
+	mSTATE_SECTION_CPU = 1,
+	mSTATE_SECTION_IO = 2,
+	mSTATE_SECTION_PALETTE = 3,
+	mSTATE_SECTION_OAM = 4,
+	mSTATE_SECTION_VRAM = 5,
+	mSTATE_SECTION_IWRAM = 6,
+	mSTATE_SECTION_WRAM = 7,
+	mSTATE_SECTION_HRAM = 8,
+	// Followed by the mStateExtdataTag
+	mSTATE_SECTION_EXTDATA = 0x10000,
+};
+
+// Where a part of the raw state lives, so it can be kept apart from the rest
+struct mStateSection {
+	enum mStateSectionId id;
+	uint32_t offset;
+	uint32_t size;
+};
+
+// State hashes are kept per chunk of the raw state, so that only chunks touched by
+// an incremental save need rehashing. A context follows one core: it is only valid
+// for the core it was last updated with.
+#define mSTATE_HASH_CHUNK_SHIFT 12
+#define mSTATE_HASH_CHUNK_SIZE (1 << mSTATE_HASH_CHUNK_SHIFT)
+
+struct mStateHash {
+	void* state;
+	size_t stateSize;
+	uint32_t checkpoint;
+	uint64_t* chunks;
+	size_t nChunks;
+	struct mStateRangeList written;
+};
+
+// Everything a savestate file is made from, copied out of the core so that it can be
+// packaged and written somewhere else. Buffers are kept between uses.
+struct mStateSnapshot {
+	void* state;
+	size_t stateSize;
+	size_t stateCapacity;
+	void* pixels;
+	size_t pixelsCapacity;
+	unsigned width;
+	unsigned height;
+	struct mStateExtdata extdata;
+	const struct mStateSection* sections;
+	size_t nSections;
+	int flags;
+};
+
+typedef void (*mStateWriterCallback)(bool success, void* context);
+
+struct mStateWriterJob {
+	struct mStateSnapshot snapshot;
+	struct VFile* vf;
+	// Set for screenshots, which only use the snapshot's pixels
+	char imageFormat[8];
+	int compression;
+	mStateWriterCallback callback;
+	void* context;
+};
+
+DECLARE_VECTOR(mStateWriterJobList, struct mStateWriterJob*);
+
+// Writes savestates out on a background thread, which is started on first use
+struct mStateWriter {
+	struct mStateWriterJobList pending;
+	struct mStateWriterJobList spare;
+#ifndef DISABLE_THREADING
+	bool running;
+	bool stopping;
+	bool busy;
+	Thread thread;
+	Mutex mutex;
+	Condition cond;
+	Condition doneCond;
+#endif
+};
+
 void mStateExtdataInit(struct mStateExtdata*);
 void mStateExtdataDeinit(struct mStateExtdata*);
 void mStateExtdataPut(struct mStateExtdata*, enum mStateExtdataTag, struct mStateExtdataItem*);
@@ -50,12 +154,41 @@ struct VFile;
 bool mStateExtdataSerialize(struct mStateExtdata* extdata, struct VFile* vf);
 bool mStateExtdataDeserialize(struct mStateExtdata* extdata, struct VFile* vf);
 
+void mStateCopyDirtyPages(void* dest, const void* src, const uint32_t* stamps, size_t pages, uint32_t since);
+void mStateRangeListAdd(struct mStateRangeList*, uint32_t offset, uint32_t size);
+void mStateRangeListAddDirtyPages(struct mStateRangeList*, uint32_t offset, const uint32_t* stamps, size_t pages, uint32_t since);
+
 struct mCore;
 bool mCoreSaveStateNamed(struct mCore* core, struct VFile* vf, int flags);
 bool mCoreLoadStateNamed(struct mCore* core, struct VFile* vf, int flags);
+bool mCoreSaveStateIncremental(struct mCore* core, struct VFile* vf, int flags, uint32_t* checkpoint, struct mStateRangeList* written);
+bool mCoreSnapshotState(struct mCore* core, struct mStateSnapshot* snapshot, int flags);
+// Non-cryptographic 64-bit hash of the raw machine state, as saved by saveState. The
+// result is the same with or without a context, but with one, repeated calls only
+// rehash the parts of the state that changed.
+uint64_t mCoreHashState(struct mCore* core, struct mStateHash* context);
+// The same hash, of a state that was already saved
+uint64_t mStateHashBuffer(const void* state, size_t stateSize);
 void* mCoreExtractState(struct mCore* core, struct VFile* vf, struct mStateExtdata* extdata);
 bool mCoreExtractExtdata(struct mCore* core, struct VFile* vf, struct mStateExtdata* extdata);
 
+void mStateHashInit(struct mStateHash*);
+void mStateHashDeinit(struct mStateHash*);
+
+void mStateSnapshotInit(struct mStateSnapshot*);
+void mStateSnapshotDeinit(struct mStateSnapshot*);
+bool mStateSnapshotWrite(struct mStateSnapshot*, struct VFile* vf);
+
+void mStateWriterInit(struct mStateWriter*);
+void mStateWriterDeinit(struct mStateWriter*);
+// Snapshots the core right away, then writes the state to the file and closes it in
+// the background. The callback runs on the writer's thread once that's done.
+bool mStateWriterSave(struct mStateWriter*, struct mCore* core, struct VFile* vf, int flags, mStateWriterCallback callback, void* context);
+// Same, but only copies the current frame and writes it out as an image, see mImageSaveVFCompressed
+bool mStateWriterScreenshot(struct mStateWriter*, struct mCore* core, struct VFile* vf, const char* format, int compression, mStateWriterCallback callback, void* context);
+// Waits until everything queued so far has been written
+void mStateWriterFlush(struct mStateWriter*);
+
 CXX_GUARD_END
 
 #endif
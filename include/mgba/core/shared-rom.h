@@ -0,0 +1,32 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_CORE_SHARED_ROM_H
+#define M_CORE_SHARED_ROM_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+// Process-wide registry that lets cores running the same ROM share one copy
+// of it. Sharing is off until mSharedROMInit is called, since a single core
+// is better served by mapping the file directly. Deinit only once every core
+// using it has been unloaded.
+void mSharedROMInit(void);
+void mSharedROMDeinit(void);
+bool mSharedROMIsEnabled(void);
+
+// Returns a copy-on-write view of mapSize bytes whose start matches rom and
+// whose remainder is filled with 0xFF, or NULL if sharing isn't available.
+// Writing to the view only copies the pages that are written to.
+void* mSharedROMAcquire(const void* rom, size_t romSize, size_t mapSize, uint32_t crc32);
+// Returns a fresh view of the same ROM as an existing view, skipping the
+// lookup. Pages already written through the existing view are not carried over.
+void* mSharedROMDuplicate(const void* view);
+void mSharedROMRelease(void* view);
+
+CXX_GUARD_END
+
+#endif
@@ -0,0 +1,64 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_CORE_STATE_CONTAINER_H
+#define M_CORE_STATE_CONTAINER_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/core/serialize.h>
+
+// Sectioned savestates keep each part of a state in a section of its own: the CPU, the
+// IO registers, each block of RAM and each piece of extdata. A table of contents at the
+// start of the file says where each one is, so one section can be read without decoding
+// the rest, or several can be decoded at once. Sections are each either compressed or
+// stored as they are, and stored sections of at least mSTATE_CONTAINER_ALIGN bytes
+// start on a boundary of that size so that they can be mapped straight out of the file.
+//
+// Everything is little-endian. The file starts with mSTATE_CONTAINER_MAGIC, followed by
+// the size of the raw state as a uint32_t, the number of sections as a uint32_t, and
+// then an mStateContainerEntry for each section.
+
+#define mSTATE_CONTAINER_MAGIC "mSTATE\x1A\x01"
+#define mSTATE_CONTAINER_MAGIC_SIZE 8
+#define mSTATE_CONTAINER_ALIGN 0x1000
+
+enum mStateCodec {
+	mSTATE_CODEC_RAW = 0,
+	mSTATE_CODEC_DEFLATE = 1,
+};
+
+struct mStateContainerEntry {
+	uint32_t id;
+	uint32_t codec;
+	// Where the section goes in the raw state; 0 for extdata
+	uint32_t offset;
+	uint32_t size;
+	uint64_t fileOffset;
+	uint64_t storedSize;
+};
+
+DECLARE_VECTOR(mStateContainerEntryList, struct mStateContainerEntry);
+
+struct VFile;
+
+bool mStateContainerIsValid(struct VFile* vf);
+
+// Sections are only kept compressed when that makes them smaller
+bool mStateContainerWrite(struct VFile* vf, const struct mStateSnapshot* snapshot, bool compress);
+
+bool mStateContainerReadTOC(struct VFile* vf, struct mStateContainerEntryList* toc, uint32_t* stateSize);
+// out needs to hold the section's full size
+bool mStateContainerReadSection(struct VFile* vf, const struct mStateContainerEntry* entry, void* out);
+
+// Returns a state from anonymousMemoryMap, or NULL if the file isn't for states of this size
+void* mStateContainerLoadState(struct VFile* vf, size_t stateSize, struct mStateExtdata* extdata);
+bool mStateContainerLoadExtdata(struct VFile* vf, struct mStateExtdata* extdata);
+
+CXX_GUARD_END
+
+#endif
@@ -0,0 +1,52 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_CORE_STATE_THUMBNAIL_H
+#define M_CORE_STATE_THUMBNAIL_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba-util/image.h>
+
+// Slot menus only need a preview and a timestamp for each state, but getting those out of
+// the states themselves means decoding every one of them in full, which takes seconds on
+// SD cards. Instead, a small cache file next to the states keeps a downscaled preview for
+// each of the first few slots, written whenever one of them is saved.
+//
+// Each cached preview remembers how big its state was, so states that are replaced behind
+// the cache's back are noticed and decoded again, after which they're cached too.
+
+#define mSTATE_THUMBNAIL_SLOTS 10
+#define mSTATE_THUMBNAIL_MAX_WIDTH 128
+#define mSTATE_THUMBNAIL_MAX_HEIGHT 112
+
+struct mStateThumbnail {
+	// Both are 0 for states saved without a screenshot
+	unsigned width;
+	unsigned height;
+	// 0 for states saved without metadata
+	uint64_t creationUsec;
+	mColor* pixels;
+};
+
+void mStateThumbnailInit(struct mStateThumbnail*);
+void mStateThumbnailDeinit(struct mStateThumbnail*);
+
+#if defined(ENABLE_VFS) && defined(ENABLE_DIRECTORIES)
+struct mCore;
+
+// Fails if the slot is empty or its state can't be read
+bool mCoreLoadStateThumbnail(struct mCore* core, int slot, struct mStateThumbnail* thumbnail);
+// Called when a slot is saved, with the flags the state was saved with, while the frame in
+// it is still the current one. A stateSize of 0 means it's still being written.
+void mCoreStoreStateThumbnail(struct mCore* core, int slot, int flags, uint32_t stateSize);
+void mCoreInvalidateStateThumbnail(struct mCore* core, int slot);
+#endif
+
+CXX_GUARD_END
+
+#endif
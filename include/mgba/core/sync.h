@@ -12,19 +12,71 @@ CXX_GUARD_START
 
 #include <mgba-util/threading.h>
 
+// Presentation timing as measured by the frontend. Latencies are in microseconds,
+// from the core finishing a frame to that frame being handed to the display.
+struct mCorePresentStats {
+	uint64_t frames;
+	uint32_t latency;
+	uint32_t averageLatency;
+	uint32_t maxLatency;
+	uint32_t missedVblanks;
+	uint32_t queueDepth;
+};
+
+// How closely the frame limiter has kept to its cadence, in nanoseconds from each
+// frame's deadline to when it was let through. Frames that finish after their deadline
+// are let through right away and counted as late.
+struct mCoreFrameLimiterStats {
+	uint64_t frames;
+	uint32_t jitter;
+	uint32_t averageJitter;
+	uint32_t maxJitter;
+	uint32_t lateFrames;
+};
+
+// Paces frames on its own, for when there's no audio or vsync to do it. Most of each wait
+// is slept on a high-resolution timer, and the last stretch is spun, where how long to
+// spin follows how late the timer has been waking up.
+struct mCoreFrameLimiter {
+	uint64_t deadline;
+	uint64_t interval;
+	uint64_t spin;
+	void* timer;
+	struct mCoreFrameLimiterStats stats;
+};
+
 struct mCoreSync {
 	int videoFramePending;
 	bool videoFrameWait;
+	bool videoFrameConsumed;
 	Mutex videoFrameMutex;
 	Condition videoFrameAvailableCond;
 	Condition videoFrameRequiredCond;
 
+	// In triple buffer mode, the producer owns videoFrameBack, the display owns
+	// videoFrameFront, and the two trade the slot in videoFrameShared with the
+	// newest frame, so neither has to wait on the other unless syncing to video
+	bool videoTripleBuffer;
+	bool videoFrameLocked;
+	unsigned videoFrameBack;
+	unsigned videoFrameFront;
+	uint32_t videoFrameShared;
+
 	bool audioWait;
 	Condition audioRequiredCond;
 	Mutex audioBufferMutex;
 	size_t audioHighWater;
 
 	float fpsTarget;
+
+	// Paces posted frames to fpsTarget. Like the waits above, frontends turn this off
+	// along with them for fast-forward. After a gap of more than a frame, like after
+	// being turned back on, the cadence starts over instead of rushing to catch up.
+	bool frameLimit;
+	struct mCoreFrameLimiter frameLimiter;
+	struct mCoreFrameLimiterStats frameLimiterStats;
+
+	struct mCorePresentStats presentStats;
 };
 
 void mCoreSyncPostFrame(struct mCoreSync* sync);
@@ -32,6 +84,23 @@ void mCoreSyncForceFrame(struct mCoreSync* sync);
 bool mCoreSyncWaitFrameStart(struct mCoreSync* sync);
 void mCoreSyncWaitFrameEnd(struct mCoreSync* sync);
 void mCoreSyncSetVideoSync(struct mCoreSync* sync, bool wait);
+bool mCoreSyncWantsFrame(struct mCoreSync* sync);
+
+void mCoreSyncSetTripleBuffer(struct mCoreSync* sync, bool enable);
+unsigned mCoreSyncPublishFrame(struct mCoreSync* sync);
+bool mCoreSyncTakeFrame(struct mCoreSync* sync, unsigned* slot);
+
+void mCoreSyncGetFrameLimiterStats(struct mCoreSync* sync, struct mCoreFrameLimiterStats* stats);
+
+void mCoreSyncReportPresent(struct mCoreSync* sync, uint32_t latency, unsigned missedVblanks, unsigned queueDepth);
+void mCoreSyncGetPresentStats(struct mCoreSync* sync, struct mCorePresentStats* stats);
+void mCoreSyncResetPresentStats(struct mCoreSync* sync);
+
+void mCoreFrameLimiterInit(struct mCoreFrameLimiter* limiter);
+void mCoreFrameLimiterDeinit(struct mCoreFrameLimiter* limiter);
+void mCoreFrameLimiterReset(struct mCoreFrameLimiter* limiter);
+// Waits until the next frame is due at the given rate
+void mCoreFrameLimiterWait(struct mCoreFrameLimiter* limiter, float fps);
 
 struct mAudioBuffer;
 bool mCoreSyncProduceAudio(struct mCoreSync* sync, const struct mAudioBuffer*);
@@ -28,6 +28,9 @@ struct mThreadLogger {
 struct mScriptContext;
 #endif
 struct mCoreThreadInternal;
+struct mCoreRollback;
+struct mCoreMovie;
+struct mInputLatch;
 struct mCoreThread {
 	// Input
 	struct mCore* core;
@@ -42,6 +45,15 @@ struct mCoreThread {
 	ThreadCallback unpauseCallback;
 	void* userData;
 	void (*run)(struct mCoreThread*);
+	// When set, frames are run through this single-core rollback session instead of
+	// run-ahead or rewind, and the keys set on the core are what the local player presses
+	struct mCoreRollback* rollback;
+	// When set and not stopped, frames are recorded into or played back from this movie,
+	// and rewind is left off, since the movie's keyframes already cover seeking back
+	struct mCoreMovie* movie;
+	// When set, keys captured here are handed to the core right before each frame runs,
+	// so the frontend doesn't have to interrupt the thread to change them
+	struct mInputLatch* inputLatch;
 
 #ifdef ENABLE_SCRIPTING
 	struct mScriptContext* scriptContext;
@@ -52,6 +64,7 @@ struct mCoreThread {
 
 #ifndef OPAQUE_THREADING
 #include <mgba/core/rewind.h>
+#include <mgba/core/serialize.h>
 #include <mgba/core/sync.h>
 #include <mgba-util/threading.h>
 
@@ -91,9 +104,22 @@ struct mCoreThreadInternal {
 	Condition stateOffThreadCond;
 	int interruptDepth;
 	bool frameWasOn;
+	bool frameTraced;
+	bool renderSkipped;
+	bool runningAhead;
+	bool speculating;
+	void* runAheadState;
+	size_t runAheadStateSize;
+	uint32_t runAheadCheckpoint;
+	uint32_t rollbackKeys;
+	// Requested from any thread under stateMutex, then picked up by the core thread
+	// between batches, which keeps the rest to itself
+	unsigned unboundedInterval;
+	bool unbounded;
 
 	struct mCoreSync sync;
 	struct mCoreRewindContext rewind;
+	struct mStateWriter stateWriter;
 	struct mCore* core;
 };
 
@@ -128,6 +154,27 @@ void mCoreThreadClearCrashed(struct mCoreThread* threadContext);
 void mCoreThreadSetRewinding(struct mCoreThread* threadContext, bool);
 void mCoreThreadRewindParamsChanged(struct mCoreThread* threadContext);
 
+bool mCoreThreadSeekMovie(struct mCoreThread* threadContext, uint32_t frame);
+
+#define mCORE_THREAD_UNBOUNDED_INTERVAL 10
+
+// Fast-forwards by running frames in batches of the given size, with only the last frame
+// of each batch rendered and synced to audio or video. Audio isn't mixed at all. With
+// syncing turned off, this runs as fast as the core can go. Pass 0 to go back to normal.
+// Safe to call from any thread, including the core thread's own callbacks.
+void mCoreThreadSetUnboundedFastForward(struct mCoreThread* threadContext, unsigned interval);
+unsigned mCoreThreadGetUnboundedFastForward(struct mCoreThread* threadContext);
+
+#if defined(ENABLE_VFS) && defined(ENABLE_DIRECTORIES)
+// Call from the core thread or while it's interrupted; the file itself is written in the background
+bool mCoreThreadSaveState(struct mCoreThread* threadContext, int slot, int flags);
+bool mCoreThreadTakeScreenshot(struct mCoreThread* threadContext);
+#endif
+#ifdef ENABLE_VFS
+bool mCoreThreadTakeScreenshotVF(struct mCoreThread* threadContext, struct VFile* vf, const char* format);
+#endif
+void mCoreThreadFlushStates(struct mCoreThread* threadContext);
+
 struct mCoreThread* mCoreThreadGet(void);
 
 CXX_GUARD_END
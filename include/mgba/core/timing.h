@@ -18,17 +18,50 @@ struct mTimingEvent {
 	uint32_t when;
 	unsigned priority;
 
-	struct mTimingEvent* next;
+	// Bookkeeping for struct mTiming; not meaningful while unscheduled
+	size_t index;
+	uint32_t order;
+};
+
+#define mTIMING_PROFILE_MAX_EVENTS 24
+
+// Optional instrumentation, accumulating the time spent in each kind of event and how it
+// gets scheduled. Events are told apart by name; any beyond the table size are lumped
+// together in an entry named NULL.
+struct mTimingProfile {
+	// Timestamps in arbitrary units, supplied by the caller. If NULL, no time is measured.
+	uint64_t (*clock)(void);
+	// Total time spent in mTimingTick, including the event callbacks
+	uint64_t tickTime;
+	size_t nEntries;
+	struct mTimingProfileEntry {
+		const char* name;
+		uint64_t time;
+		// Times the event fired
+		uint64_t count;
+		// Sum of the cycles late the event fired, to be divided by count
+		uint64_t lateness;
+		// Times the event was moved or removed before it got to fire
+		uint64_t reschedules;
+		uint64_t deschedules;
+	} entries[mTIMING_PROFILE_MAX_EVENTS];
+	bool active;
 };
 
 struct mTiming {
-	struct mTimingEvent* root;
-	struct mTimingEvent* reroot;
+	// Binary min-heap ordered by when, then priority, then scheduling order
+	struct mTimingEvent** events;
+	size_t nEvents;
+	size_t capacity;
+	uint32_t order;
+	bool interrupted;
 
 	uint64_t globalCycles;
 	uint32_t masterCycles;
 	int32_t* relativeCycles;
 	int32_t* nextEvent;
+
+	struct mTimingProfile* profile;
 };
 
 void mTimingInit(struct mTiming* timing, int32_t* relativeCycles, int32_t* nextEvent);
@@ -40,10 +73,13 @@ void mTimingInterrupt(struct mTiming* timing);
 void mTimingSchedule(struct mTiming* timing, struct mTimingEvent*, int32_t when);
 void mTimingScheduleAbsolute(struct mTiming* timing, struct mTimingEvent*, int32_t when);
 void mTimingDeschedule(struct mTiming* timing, struct mTimingEvent*);
+void mTimingDescheduleAll(struct mTiming* timing);
 bool mTimingIsScheduled(const struct mTiming* timing, const struct mTimingEvent*);
 
 int32_t mTimingTick(struct mTiming* timing, int32_t cycles);
 
+void mTimingProfileReset(struct mTimingProfile* profile);
+
 int32_t mTimingCurrentTime(const struct mTiming* timing);
 uint64_t mTimingGlobalTime(const struct mTiming* timing);
 
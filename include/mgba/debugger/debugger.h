@@ -59,6 +59,8 @@ enum mDebuggerType {
 	DEBUGGER_CLI,
 	DEBUGGER_GDB,
 	DEBUGGER_ACCESS_LOGGER,
+	DEBUGGER_TRACE_RECORDER,
+	DEBUGGER_PROFILER,
 	DEBUGGER_MAX
 };
 
@@ -133,6 +135,7 @@ struct mBreakpoint {
 	int segment;
 	enum mBreakpointType type;
 	struct ParseTree* condition;
+	struct ParseProgram* compiledCondition;
 	bool isTemporary;
 };
 
@@ -143,6 +146,7 @@ struct mWatchpoint {
 	uint32_t maxAddress;
 	enum mWatchpointType type;
 	struct ParseTree* condition;
+	struct ParseProgram* compiledCondition;
 };
 
 struct mDebuggerInstructionInfo {
@@ -153,6 +157,17 @@ struct mDebuggerInstructionInfo {
 	mDebuggerAccessLogFlagsEx flagsEx[INSN_LENGTH_MAX];
 };
 
+#define mDEBUGGER_TRACE_MAX_REGISTERS 16
+
+struct mDebuggerTraceEntry {
+	uint32_t pc;
+	uint32_t opcode;
+	uint32_t flags;
+	uint16_t changedRegisters;
+	uint8_t width;
+	uint8_t reserved;
+};
+
 DECLARE_VECTOR(mBreakpointList, struct mBreakpoint);
 DECLARE_VECTOR(mWatchpointList, struct mWatchpoint);
 DECLARE_VECTOR(mDebuggerModuleList, struct mDebuggerModule*);
@@ -165,6 +180,8 @@ struct mStackFrame {
 	int frameBaseSegment;
 	uint32_t frameBaseAddress;
 	void* regs;
+	// Platform-specific state that is kept even when registers aren't saved
+	uint32_t state;
 	bool finished;
 	bool breakWhenFinished;
 	bool interrupt;
@@ -175,12 +192,17 @@ DECLARE_VECTOR(mStackFrames, struct mStackFrame);
 struct mStackTrace {
 	struct mStackFrames stack;
 	size_t registersSize;
+	bool saveRegisters;
+	// Register snapshots for each depth, reused as frames are pushed and popped
+	uint8_t* registers;
+	size_t registersCapacity;
 
 	void (*formatRegisters)(struct mStackFrame* frame, char* out, size_t* length);
 };
 
 struct mDebugger;
 struct ParseTree;
+struct ParseProgram;
 struct mDebuggerPlatform {
 	struct mDebugger* p;
 
@@ -207,6 +229,9 @@ struct mDebuggerPlatform {
 	bool (*updateStackTrace)(struct mDebuggerPlatform* d);
 
 	void (*nextInstructionInfo)(struct mDebuggerPlatform* d, struct mDebuggerInstructionInfo* info);
+
+	size_t (*nextTraceEntry)(struct mDebuggerPlatform* d, struct mDebuggerTraceEntry* entry, uint32_t* registers);
+	void (*formatTraceEntry)(struct mDebuggerPlatform* d, const struct mDebuggerTraceEntry* entry, char* out, size_t* length);
 };
 
 struct mDebugger {
@@ -261,6 +286,7 @@ void mDebuggerModuleSetNeedsCallback(struct mDebuggerModule*);
 void mDebuggerModuleClearNeedsCallback(struct mDebuggerModule*);
 
 bool mDebuggerLookupIdentifier(struct mDebugger* debugger, const char* name, int32_t* value, int* segment);
+bool mDebuggerTestCondition(struct mDebugger* debugger, struct ParseTree* condition, const struct ParseProgram* compiled);
 
 CXX_GUARD_END
 
@@ -0,0 +1,34 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_NETPLAY_H
+#define M_NETPLAY_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/core/rollback.h>
+#include <mgba-util/socket.h>
+
+#define mNETPLAY_MESSAGE_SIZE 14
+
+// Sends rollback messages to a single peer over TCP. Input costs 10 bytes a frame.
+struct mNetplayTransport {
+	struct mCoreRollbackTransport d;
+	Socket socket;
+	bool connected;
+
+	uint8_t buffer[mNETPLAY_MESSAGE_SIZE];
+	size_t buffered;
+};
+
+bool mNetplayTransportListen(struct mNetplayTransport*, int port, const struct Address* bindAddress, int timeoutMs);
+bool mNetplayTransportConnect(struct mNetplayTransport*, int port, const struct Address* address);
+void mNetplayTransportDeinit(struct mNetplayTransport*);
+
+CXX_GUARD_END
+
+#endif
@@ -11,7 +11,6 @@
 CXX_GUARD_START
 
 #include <mgba-util/ring-fifo.h>
-#include <mgba-util/threading.h>
 #include <mgba/feature/video-backend.h>
 
 enum mVideoBackendCommandType {
@@ -27,6 +26,7 @@ enum mVideoBackendCommandType {
 	mVB_CMD_IMAGE_SIZE,
 	mVB_CMD_SET_IMAGE,
 	mVB_CMD_DRAW_FRAME,
+	mVB_CMD_SET_IMAGE_RECT,
 };
 
 union mVideoBackendCommandData {
@@ -42,6 +42,10 @@ union mVideoBackendCommandData {
 		unsigned maxH;
 	} u;
 	const void* image;
+	struct {
+		struct mRectangle rect;
+		const void* image;
+	} r;
 };
 
 struct mVideoBackendCommand {
@@ -61,11 +65,6 @@ struct mVideoProxyBackend {
 	struct RingFIFO in;
 	struct RingFIFO out;
 
-	Mutex inLock;
-	Mutex outLock;
-	Condition inWait;
-	Condition outWait;
-
 	void (*wakeupCb)(struct mVideoProxyBackend*, void* context);
 	void* context;
 };
@@ -30,6 +30,8 @@ struct mVideoThreadProxy {
 	Mutex mutex;
 	enum mVideoThreadProxyState threadState;
 	enum mVideoLoggerEvent event;
+	// Applied by the rendering thread when it starts
+	struct ThreadPolicy threadPolicy;
 
 	struct RingFIFO dirtyQueue;
 };
@@ -27,6 +27,11 @@ struct mUpdate {
 	const char* version;
 	const char* commit;
 	const char* sha256;
+
+	// A patch against the previous release's archive, identified by that archive's hash
+	const char* deltaPath;
+	size_t deltaSize;
+	const char* deltaBase;
 };
 
 bool mUpdaterInit(struct mUpdaterContext*, const char* manifest);
@@ -45,6 +50,7 @@ const char* mUpdateGetRoot(const struct mCoreConfig*);
 const char* mUpdateGetCommand(const struct mCoreConfig*);
 const char* mUpdateGetArchiveExtension(const struct mCoreConfig*);
 bool mUpdateGetArchivePath(const struct mCoreConfig*, char* out, size_t outLength);
+bool mUpdateGetBaseArchivePath(const char* extension, char* out, size_t outLength);
 
 CXX_GUARD_END
 
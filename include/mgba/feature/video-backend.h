@@ -52,6 +52,8 @@ struct VideoBackend {
 	void (*setImageSize)(struct VideoBackend*, enum VideoLayer, int w, int h);
 	void (*imageSize)(struct VideoBackend*, enum VideoLayer, int* w, int* h);
 	void (*setImage)(struct VideoBackend*, enum VideoLayer, const void* frame);
+	// Optional: only uploads the given part of the image, with frame pointing at the whole image as for setImage
+	void (*setImageRect)(struct VideoBackend*, enum VideoLayer, const struct mRectangle*, const void* frame);
 	void (*drawFrame)(struct VideoBackend*);
 
 	void* user;
@@ -27,6 +27,7 @@ enum mVideoLoggerDirtyType {
 	DIRTY_FRAME,
 	DIRTY_RANGE,
 	DIRTY_BUFFER,
+	DIRTY_VRAM_SWAP,
 };
 
 enum mVideoLoggerEvent {
@@ -85,6 +86,16 @@ struct mVideoLogger {
 	uint16_t* oam;
 	uint16_t* palette;
 
+	// With shared VRAM, dirty blocks are copied straight into whichever of two snapshots
+	// the reading side isn't using, and a DIRTY_VRAM_SWAP packet then hands it over.
+	// Blocks only go through the queue while a previous swap is still outstanding.
+	bool sharedVRAM;
+	uint16_t* vramBuffers[2];
+	uint32_t* vramStaleBitmap[2];
+	int vramBack;
+	unsigned vramSwapsQueued;
+	unsigned vramSwapsDone;
+
 	const void* pixelBuffer;
 	size_t pixelStride;
 
@@ -120,6 +131,7 @@ struct mCore;
 struct mVideoLogContext* mVideoLogContextCreate(struct mCore* core);
 
 void mVideoLogContextSetCompression(struct mVideoLogContext*, bool enable);
+void mVideoLogContextSetCompressionThreads(struct mVideoLogContext*, unsigned threads);
 void mVideoLogContextSetOutput(struct mVideoLogContext*, struct VFile*);
 void mVideoLogContextWriteHeader(struct mVideoLogContext*, struct mCore* core);
 
@@ -127,6 +139,13 @@ bool mVideoLogContextLoad(struct mVideoLogContext*, struct VFile*);
 void mVideoLogContextDestroy(struct mCore* core, struct mVideoLogContext*, bool closeVF);
 
 void mVideoLogContextRewind(struct mVideoLogContext*, struct mCore*);
+// Writing an index stores a keyframe every few frames, so playback can start near any frame
+void mVideoLogContextSetIndexInterval(struct mVideoLogContext*, unsigned frames);
+uint32_t mVideoLogContextFrameCount(const struct mVideoLogContext*);
+// Makes the next rewind start from the last keyframe at or before frame, and returns its frame number
+uint32_t mVideoLogContextSeek(struct mVideoLogContext*, uint32_t frame);
+// Positions a video log player core so that its next frame is the given one
+bool mVideoLogPlayerSeek(struct mCore* core, uint32_t frame);
 void* mVideoLogContextInitialState(struct mVideoLogContext*, size_t* size);
 
 int mVideoLoggerAddChannel(struct mVideoLogContext*);
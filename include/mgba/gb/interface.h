@@ -12,6 +12,9 @@ CXX_GUARD_START
 
 #include <mgba/core/interface.h>
 
+// Idle loops in switchable ROM banks are keyed by bank as well, in the top 16 bits
+#define GB_IDLE_LOOP_NONE 0xFFFFFFFF
+
 enum GBModel {
 	GB_MODEL_AUTODETECT = 0xFF,
 	GB_MODEL_DMG  = 0x00,
@@ -82,6 +85,7 @@ struct GBCartridgeOverride {
 	enum GBMemoryBankControllerType mbc;
 
 	uint32_t gbColors[12];
+	uint32_t idleLoop;
 };
 
 struct GBColorPreset {
@@ -107,6 +107,11 @@ bool GBAIsBIOS(struct VFile* vf);
 bool GBAOverrideFind(const struct Configuration*, struct GBACartridgeOverride* override);
 void GBAOverrideSave(struct Configuration*, const struct GBACartridgeOverride* override);
 
+#define GBA_IDLE_LOOP_CACHE_FILE "idleloops.ini"
+
+bool GBAIdleLoopCacheFind(const struct Configuration*, uint32_t crc32, uint32_t* idleLoop);
+void GBAIdleLoopCacheSave(struct Configuration*, uint32_t crc32, uint32_t idleLoop);
+
 struct GBASIODriver {
 	struct GBASIO* p;
 
@@ -66,7 +66,16 @@ enum LSMDirection {
 	LSM_DB = 3
 };
 
+// What the NZCV flags in cpsr are still waiting on. Anything past ARM_LAZY_NZ also owns C and V.
+enum ARMLazyFlags {
+	ARM_LAZY_NONE = 0,
+	ARM_LAZY_NZ,
+	ARM_LAZY_ADD,
+	ARM_LAZY_SUB
+};
+
 struct ARMCore;
+struct ARMBlockCache;
 
 union PSR {
 	struct {
@@ -181,6 +190,13 @@ struct ARMCore {
 	int32_t shifterOperand;
 	int32_t shifterCarryOut;
 
+	// Flag-setting ALU operations only record their operands and result; the flags are
+	// worked out from them when something reads cpsr. See ARMMaterializeFlags.
+	enum ARMLazyFlags lazyFlags;
+	int32_t lazyM;
+	int32_t lazyN;
+	int32_t lazyD;
+
 	uint32_t prefetch[2];
 	enum ExecutionMode executionMode;
 	enum PrivilegeMode privilegeMode;
@@ -190,6 +206,7 @@ struct ARMCore {
 	struct ARMCoprocessor cp[16];
 
 	struct mCPUComponent* master;
+	struct ARMBlockCache* blockCache;
 
 	size_t numComponents;
 	struct mCPUComponent** components;
@@ -204,6 +221,7 @@ void ARMHotplugDetach(struct ARMCore* cpu, size_t slot);
 
 void ARMReset(struct ARMCore* cpu);
 void ARMSetPrivilegeMode(struct ARMCore*, enum PrivilegeMode);
+void ARMMaterializeFlags(struct ARMCore*);
 void ARMRaiseIRQ(struct ARMCore*);
 void ARMRaiseSWI(struct ARMCore*);
 void ARMRaiseUndefined(struct ARMCore*);
@@ -0,0 +1,55 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef ARM_BLOCK_CACHE_H
+#define ARM_BLOCK_CACHE_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/internal/arm/isa-arm.h>
+#include <mgba/internal/arm/isa-thumb.h>
+
+#define ARM_BLOCK_CACHE_BITS 11
+#define ARM_BLOCK_CACHE_SIZE (1 << ARM_BLOCK_CACHE_BITS)
+#define ARM_BLOCK_MAX_LENGTH 16
+
+// Fold the upper address bits in so that e.g. BIOS and ROM code at the same offset don't evict each other
+#define ARM_BLOCK_CACHE_INDEX(ADDRESS) ((((ADDRESS) >> 1) ^ ((ADDRESS) >> 17)) & (ARM_BLOCK_CACHE_SIZE - 1))
+
+struct ARMCore;
+struct ARMJIT;
+
+struct ARMBlockInstruction {
+	union {
+		ARMInstruction arm;
+		ThumbInstruction thumb;
+	};
+	uint32_t opcode;
+};
+
+struct ARMBlock {
+	// Address of the first instruction, with the execution mode in bit 0
+	uint32_t tag;
+	unsigned length;
+	unsigned hits;
+	// Recompiled code, if any; returns nonzero if it found a stale opcode and bailed out
+	int (*native)(struct ARMCore* cpu);
+	struct ARMBlockInstruction instructions[ARM_BLOCK_MAX_LENGTH];
+};
+
+struct ARMBlockCache {
+	struct ARMBlock blocks[ARM_BLOCK_CACHE_SIZE];
+	struct ARMJIT* jit;
+};
+
+void ARMBlockCacheEnable(struct ARMCore* cpu, bool enable);
+
+void ARMBlockCacheBuild(struct ARMCore* cpu, struct ARMBlock* block, uint32_t tag);
+
+CXX_GUARD_END
+
+#endif
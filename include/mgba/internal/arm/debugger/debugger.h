@@ -13,6 +13,7 @@ CXX_GUARD_START
 #include <mgba/debugger/debugger.h>
 
 #include <mgba/internal/arm/arm.h>
+#include <mgba/internal/debugger/disassembly-cache.h>
 #include <mgba-util/vector.h>
 
 struct ParseTree;
@@ -26,18 +27,29 @@ struct ARMDebugBreakpoint {
 
 DECLARE_VECTOR(ARMDebugBreakpointList, struct ARMDebugBreakpoint);
 
+#define ARM_DEBUGGER_BREAKPOINT_FILTER_SIZE 0x2000
+#define ARM_DEBUGGER_WATCHPOINT_FILTER_SIZE 0x1000
+#define ARM_DEBUGGER_WATCHPOINT_PAGE_SHIFT 10
+
 struct ARMDebugger {
 	struct mDebuggerPlatform d;
 	struct ARMCore* cpu;
 
 	struct ARMDebugBreakpointList breakpoints;
+	// One bit per hashed halfword address; a clear bit means no hardware breakpoint can be at that PC
+	uint32_t breakpointFilter[ARM_DEBUGGER_BREAKPOINT_FILTER_SIZE / 32];
 	struct ARMDebugBreakpointList swBreakpoints;
 	struct mWatchpointList watchpoints;
+	// One bit per hashed 1 KiB page for each access type; accesses to clear pages skip the watchpoint list
+	uint32_t readWatchpointFilter[ARM_DEBUGGER_WATCHPOINT_FILTER_SIZE / 32];
+	uint32_t writeWatchpointFilter[ARM_DEBUGGER_WATCHPOINT_FILTER_SIZE / 32];
 	struct ARMMemory originalMemory;
 
 	ssize_t nextId;
 	enum mStackTraceMode stackTraceMode;
 
+	struct mDisassemblyCache disassembly;
+
 	void (*entered)(struct mDebugger*, enum mDebuggerEntryReason, struct mDebuggerEntryInfo*);
 
 	bool (*setSoftwareBreakpoint)(struct ARMDebugger*, uint32_t address, enum ExecutionMode mode, uint32_t* opcode);
@@ -47,6 +59,12 @@ struct ARMDebugger {
 struct mDebuggerPlatform* ARMDebuggerPlatformCreate(void);
 ssize_t ARMDebuggerSetSoftwareBreakpoint(struct mDebuggerPlatform* debugger, struct mDebuggerModule* owner, uint32_t address, enum ExecutionMode mode);
 
+struct ARMInstructionInfo;
+// Like ARMDisassemble, but reuses the text from the last time the same instruction was
+// disassembled at the same PC. For a wide Thumb instruction, the second halfword is in the
+// upper half of the opcode.
+void ARMDebuggerDisassemble(struct ARMDebugger* debugger, const struct ARMInstructionInfo* info, uint32_t opcode, bool wide, struct ARMCore* cpu, uint32_t pc, char* buffer, int blen);
+
 CXX_GUARD_END
 
 #endif
@@ -22,6 +22,9 @@
 	DIRECTIVE, \
 	DIRECTIVE
 
+#define DO_64(DIRECTIVE) \
+	DO_8(DO_8(DIRECTIVE))
+
 #define DO_256(DIRECTIVE) \
 	DO_4(DO_8(DO_8(DIRECTIVE)))
 
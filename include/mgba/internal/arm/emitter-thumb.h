@@ -110,4 +110,135 @@
 	DO_8(DO_4(DECLARE_INSTRUCTION_THUMB(EMITTER, BL1))), \
 	DO_8(DO_4(DECLARE_INSTRUCTION_THUMB(EMITTER, BL2))) \
 
+// The whole-opcode table used with ENABLE_THUMB_SPECIALIZATION: the register fields of the
+// instructions in the low bits index handlers specialized for them
+#define DECLARE_SPECIALIZED_REGISTERS_LOW_THUMB(EMITTER, NAME) \
+	DECLARE_INSTRUCTION_THUMB(EMITTER, NAME ## _0), \
+	DECLARE_INSTRUCTION_THUMB(EMITTER, NAME ## _1), \
+	DECLARE_INSTRUCTION_THUMB(EMITTER, NAME ## _2), \
+	DECLARE_INSTRUCTION_THUMB(EMITTER, NAME ## _3), \
+	DECLARE_INSTRUCTION_THUMB(EMITTER, NAME ## _4), \
+	DECLARE_INSTRUCTION_THUMB(EMITTER, NAME ## _5), \
+	DECLARE_INSTRUCTION_THUMB(EMITTER, NAME ## _6), \
+	DECLARE_INSTRUCTION_THUMB(EMITTER, NAME ## _7)
+
+#define DECLARE_SPECIALIZED_INSTRUCTION_THUMB(EMITTER, NAME) \
+	DECLARE_SPECIALIZED_REGISTERS_LOW_THUMB(EMITTER, NAME ## _0), \
+	DECLARE_SPECIALIZED_REGISTERS_LOW_THUMB(EMITTER, NAME ## _1), \
+	DECLARE_SPECIALIZED_REGISTERS_LOW_THUMB(EMITTER, NAME ## _2), \
+	DECLARE_SPECIALIZED_REGISTERS_LOW_THUMB(EMITTER, NAME ## _3), \
+	DECLARE_SPECIALIZED_REGISTERS_LOW_THUMB(EMITTER, NAME ## _4), \
+	DECLARE_SPECIALIZED_REGISTERS_LOW_THUMB(EMITTER, NAME ## _5), \
+	DECLARE_SPECIALIZED_REGISTERS_LOW_THUMB(EMITTER, NAME ## _6), \
+	DECLARE_SPECIALIZED_REGISTERS_LOW_THUMB(EMITTER, NAME ## _7)
+
+#define DECLARE_SPECIALIZED_REGISTER_THUMB(EMITTER, NAME) \
+	DO_256(DECLARE_INSTRUCTION_THUMB(EMITTER, NAME ## _0)), \
+	DO_256(DECLARE_INSTRUCTION_THUMB(EMITTER, NAME ## _1)), \
+	DO_256(DECLARE_INSTRUCTION_THUMB(EMITTER, NAME ## _2)), \
+	DO_256(DECLARE_INSTRUCTION_THUMB(EMITTER, NAME ## _3)), \
+	DO_256(DECLARE_INSTRUCTION_THUMB(EMITTER, NAME ## _4)), \
+	DO_256(DECLARE_INSTRUCTION_THUMB(EMITTER, NAME ## _5)), \
+	DO_256(DECLARE_INSTRUCTION_THUMB(EMITTER, NAME ## _6)), \
+	DO_256(DECLARE_INSTRUCTION_THUMB(EMITTER, NAME ## _7))
+
+#define DECLARE_INSTRUCTION_WITH_HIGH_64_THUMB(EMITTER, NAME) \
+	DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, NAME ## 00)), \
+	DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, NAME ## 01)), \
+	DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, NAME ## 10)), \
+	DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, NAME ## 11))
+
+#define DECLARE_THUMB_SPECIALIZED_EMITTER_BLOCK(EMITTER) \
+	DO_8(DO_4(DECLARE_SPECIALIZED_INSTRUCTION_THUMB(EMITTER, LSL1))), \
+	DO_8(DO_4(DECLARE_SPECIALIZED_INSTRUCTION_THUMB(EMITTER, LSR1))), \
+	DO_8(DO_4(DECLARE_SPECIALIZED_INSTRUCTION_THUMB(EMITTER, ASR1))), \
+	DO_8(DECLARE_SPECIALIZED_INSTRUCTION_THUMB(EMITTER, ADD3)), \
+	DO_8(DECLARE_SPECIALIZED_INSTRUCTION_THUMB(EMITTER, SUB3)), \
+	DO_8(DECLARE_SPECIALIZED_INSTRUCTION_THUMB(EMITTER, ADD1)), \
+	DO_8(DECLARE_SPECIALIZED_INSTRUCTION_THUMB(EMITTER, SUB1)), \
+	DECLARE_SPECIALIZED_REGISTER_THUMB(EMITTER, MOV1), \
+	DECLARE_SPECIALIZED_REGISTER_THUMB(EMITTER, CMP1), \
+	DECLARE_SPECIALIZED_REGISTER_THUMB(EMITTER, ADD2), \
+	DECLARE_SPECIALIZED_REGISTER_THUMB(EMITTER, SUB2), \
+	DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, AND)), \
+	DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, EOR)), \
+	DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, LSL2)), \
+	DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, LSR2)), \
+	DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, ASR2)), \
+	DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, ADC)), \
+	DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, SBC)), \
+	DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, ROR)), \
+	DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, TST)), \
+	DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, NEG)), \
+	DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, CMP2)), \
+	DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, CMN)), \
+	DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, ORR)), \
+	DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, MUL)), \
+	DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, BIC)), \
+	DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, MVN)), \
+	DECLARE_INSTRUCTION_WITH_HIGH_64_THUMB(EMITTER, ADD4), \
+	DECLARE_INSTRUCTION_WITH_HIGH_64_THUMB(EMITTER, CMP3), \
+	DECLARE_INSTRUCTION_WITH_HIGH_64_THUMB(EMITTER, MOV3), \
+	DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, BX)), \
+	DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, BX)), \
+	DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, ILL)), \
+	DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, ILL)), \
+	DO_8(DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, LDR3)))), \
+	DO_8(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, STR2))), \
+	DO_8(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, STRH2))), \
+	DO_8(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, STRB2))), \
+	DO_8(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, LDRSB))), \
+	DO_8(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, LDR2))), \
+	DO_8(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, LDRH2))), \
+	DO_8(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, LDRB2))), \
+	DO_8(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, LDRSH))), \
+	DO_8(DO_4(DECLARE_SPECIALIZED_INSTRUCTION_THUMB(EMITTER, STR1))), \
+	DO_8(DO_4(DECLARE_SPECIALIZED_INSTRUCTION_THUMB(EMITTER, LDR1))), \
+	DO_8(DO_4(DECLARE_SPECIALIZED_INSTRUCTION_THUMB(EMITTER, STRB1))), \
+	DO_8(DO_4(DECLARE_SPECIALIZED_INSTRUCTION_THUMB(EMITTER, LDRB1))), \
+	DO_8(DO_4(DECLARE_SPECIALIZED_INSTRUCTION_THUMB(EMITTER, STRH1))), \
+	DO_8(DO_4(DECLARE_SPECIALIZED_INSTRUCTION_THUMB(EMITTER, LDRH1))), \
+	DO_8(DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, STR3)))), \
+	DO_8(DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, LDR4)))), \
+	DO_8(DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, ADD5)))), \
+	DO_8(DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, ADD6)))), \
+	DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, ADD7)), \
+	DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, ADD7)), \
+	DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, SUB4)), \
+	DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, SUB4)), \
+	DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, ILL))), \
+	DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, ILL))), \
+	DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, ILL))), \
+	DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, PUSH))), \
+	DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, PUSHR))), \
+	DO_8(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, ILL))), \
+	DO_8(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, ILL))), \
+	DO_8(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, ILL))), \
+	DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, POP))), \
+	DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, POPR))), \
+	DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, BKPT))), \
+	DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, ILL))), \
+	DO_8(DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, STMIA)))), \
+	DO_8(DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, LDMIA)))), \
+	DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, BEQ))), \
+	DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, BNE))), \
+	DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, BCS))), \
+	DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, BCC))), \
+	DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, BMI))), \
+	DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, BPL))), \
+	DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, BVS))), \
+	DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, BVC))), \
+	DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, BHI))), \
+	DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, BLS))), \
+	DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, BGE))), \
+	DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, BLT))), \
+	DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, BGT))), \
+	DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, BLE))), \
+	DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, ILL))), \
+	DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, SWI))), \
+	DO_8(DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, B)))), \
+	DO_8(DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, ILL)))), \
+	DO_8(DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, BL1)))), \
+	DO_8(DO_4(DO_64(DECLARE_INSTRUCTION_THUMB(EMITTER, BL2)))) \
+
 #endif
@@ -67,8 +67,62 @@
 		currentCycles += cpu->memory.stall(cpu, wait);                    \
 	}
 
-#define ARM_STUB cpu->irqh.hitStub(cpu, opcode)
-#define ARM_ILL cpu->irqh.hitIllegal(cpu, opcode)
+#define ARM_STUB _ARMMaterializeFlags(cpu); cpu->irqh.hitStub(cpu, opcode)
+#define ARM_ILL _ARMMaterializeFlags(cpu); cpu->irqh.hitIllegal(cpu, opcode)
+
+static inline void _ARMMaterializeFlags(struct ARMCore* cpu) {
+	int32_t m = cpu->lazyM;
+	int32_t n = cpu->lazyN;
+	int32_t d = cpu->lazyD;
+	unsigned nz = (((uint32_t) d >> 31) << 3) | (!d << 2);
+	switch (cpu->lazyFlags) {
+	case ARM_LAZY_NONE:
+		return;
+	case ARM_LAZY_NZ:
+		cpu->cpsr.flags = (cpu->cpsr.flags & 0x3F) | (nz << 4);
+		break;
+	case ARM_LAZY_ADD:
+		cpu->cpsr.flags = (nz | (ARM_CARRY_FROM(m, n, d) << 1) | ARM_V_ADDITION(m, n, d)) << 4;
+		break;
+	case ARM_LAZY_SUB:
+		cpu->cpsr.flags = (nz | (ARM_BORROW_FROM(m, n, d) << 1) | ARM_V_SUBTRACTION(m, n, d)) << 4;
+		break;
+	}
+	cpu->lazyFlags = ARM_LAZY_NONE;
+}
+
+// C and V are only pending after an addition or a subtraction
+static inline void _ARMMaterializeCarry(struct ARMCore* cpu) {
+	if (cpu->lazyFlags > ARM_LAZY_NZ) {
+		_ARMMaterializeFlags(cpu);
+	}
+}
+
+// Reads C without writing back the rest of the flags
+static inline int _ARMReadCarry(struct ARMCore* cpu) {
+	switch (cpu->lazyFlags) {
+	case ARM_LAZY_ADD:
+		return ARM_CARRY_FROM(cpu->lazyM, cpu->lazyN, cpu->lazyD);
+	case ARM_LAZY_SUB:
+		return ARM_BORROW_FROM(cpu->lazyM, cpu->lazyN, cpu->lazyD);
+	default:
+		return cpu->cpsr.c;
+	}
+}
+
+static inline void _ARMSetFlagsLazy(struct ARMCore* cpu, enum ARMLazyFlags op, int32_t m, int32_t n, int32_t d) {
+	cpu->lazyFlags = op;
+	cpu->lazyM = m;
+	cpu->lazyN = n;
+	cpu->lazyD = d;
+}
+
+// Leaves C and V alone
+static inline void _ARMSetNZLazy(struct ARMCore* cpu, int32_t d) {
+	_ARMMaterializeCarry(cpu);
+	cpu->lazyFlags = ARM_LAZY_NZ;
+	cpu->lazyD = d;
+}
 
 static inline int32_t ARMWritePC(struct ARMCore* cpu) {
 	uint32_t pc = cpu->gprs[ARM_PC] & -WORD_SIZE_THUMB;
@@ -127,6 +181,7 @@ static inline uint32_t _ARMPCAddress(struct ARMCore* cpu) {
 }
 
 static inline bool ARMTestCondition(struct ARMCore* cpu, unsigned condition) {
+	_ARMMaterializeFlags(cpu);
 	switch (condition) {
 		case 0x0:
 			return ARM_COND_EQ;
@@ -15,6 +15,14 @@ struct ARMCore;
 typedef void (*ThumbInstruction)(struct ARMCore*, unsigned opcode);
 extern const ThumbInstruction _thumbTable[0x400];
 
+#ifdef ENABLE_THUMB_SPECIALIZATION
+// Indexed by the whole opcode, so that common instructions can use handlers specialized for their registers
+extern const ThumbInstruction _thumbSpecializedTable[0x10000];
+#define THUMB_DECODE(OPCODE) _thumbSpecializedTable[OPCODE]
+#else
+#define THUMB_DECODE(OPCODE) _thumbTable[(OPCODE) >> 6]
+#endif
+
 CXX_GUARD_END
 
 #endif
@@ -0,0 +1,35 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef ARM_JIT_H
+#define ARM_JIT_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#ifdef ENABLE_JIT
+// Only an x86-64 backend exists so far. Other hosts, AArch64 included, keep using the
+// block cache and the interpreter, and CMake turns ENABLE_JIT off for them.
+
+// Number of interpreted runs before a block is handed to the recompiler
+#define ARM_JIT_THRESHOLD 32
+#define ARM_JIT_ARENA_SIZE 0x400000
+
+struct ARMCore;
+struct ARMBlock;
+
+struct ARMJIT {
+	uint8_t* arena;
+	size_t used;
+};
+
+void ARMJITEnable(struct ARMCore* cpu, bool enable);
+void ARMJITCompile(struct ARMCore* cpu, struct ARMBlock* block);
+#endif
+
+CXX_GUARD_END
+
+#endif
@@ -11,11 +11,18 @@
 CXX_GUARD_START
 
 #include <mgba/debugger/debugger.h>
+#include <mgba-util/threading.h>
 #include <mgba-util/vector.h>
 
 DECL_BITFIELD(mDebuggerAccessLogRegionFlags, uint64_t);
 DECL_BIT(mDebuggerAccessLogRegionFlags, HasExBlock, 0);
 
+struct mDebuggerAccessLogBatch {
+	mDebuggerAccessLogFlags* block;
+	mDebuggerAccessLogFlagsEx* blockEx;
+	uint32_t* dirty;
+};
+
 struct mDebuggerAccessLogRegion {
 	uint32_t start;
 	uint32_t end;
@@ -24,6 +31,7 @@ struct mDebuggerAccessLogRegion {
 	mDebuggerAccessLogFlags* block;
 	mDebuggerAccessLogFlagsEx* blockEx;
 	ssize_t watchpoint;
+	struct mDebuggerAccessLogBatch batch[2];
 };
 
 DECLARE_VECTOR(mDebuggerAccessLogRegionList, struct mDebuggerAccessLogRegion);
@@ -34,6 +42,19 @@ struct mDebuggerAccessLogger {
 	struct VFile* backing;
 	struct mDebuggerAccessLog* mapped;
 	struct mDebuggerAccessLogRegionList regions;
+
+	bool batched;
+	int batchFront;
+	uint32_t batchFrame;
+	unsigned batchFlushes;
+#ifndef DISABLE_THREADING
+	Thread batchThread;
+	Mutex batchMutex;
+	Condition batchStartCond;
+	Condition batchDoneCond;
+	bool batchPending;
+	bool batchExiting;
+#endif
 };
 
 void mDebuggerAccessLoggerInit(struct mDebuggerAccessLogger*);
@@ -45,6 +66,9 @@ bool mDebuggerAccessLoggerClose(struct mDebuggerAccessLogger*);
 void mDebuggerAccessLoggerStart(struct mDebuggerAccessLogger*);
 void mDebuggerAccessLoggerStop(struct mDebuggerAccessLogger*);
 
+void mDebuggerAccessLoggerSetBatched(struct mDebuggerAccessLogger*, bool batched);
+void mDebuggerAccessLoggerFlush(struct mDebuggerAccessLogger*);
+
 int mDebuggerAccessLoggerWatchMemoryBlockId(struct mDebuggerAccessLogger*, size_t id, mDebuggerAccessLogRegionFlags);
 int mDebuggerAccessLoggerWatchMemoryBlockName(struct mDebuggerAccessLogger*, const char* internalName, mDebuggerAccessLogRegionFlags);
 
@@ -20,6 +20,9 @@ extern const char* INFO_WATCHPOINT_ADDED;
 
 struct CLIDebugger;
 struct VFile;
+struct mDebuggerTraceRecorder;
+struct mDebuggerProfiler;
+struct mTimingProfile;
 
 struct CLIDebugVector {
 	struct CLIDebugVector* next;
@@ -89,6 +92,10 @@ struct CLIDebugger {
 
 	int traceRemaining;
 	struct VFile* traceVf;
+	struct mDebuggerTraceRecorder* traceRecorder;
+	struct mDebuggerProfiler* profiler;
+	struct mTimingProfile* eventStats;
+	uint32_t eventStatsFrame;
 	bool skipStatus;
 };
 
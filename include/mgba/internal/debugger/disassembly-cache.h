@@ -0,0 +1,49 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef DISASSEMBLY_CACHE_H
+#define DISASSEMBLY_CACHE_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#define mDISASSEMBLY_CACHE_BITS 10
+#define mDISASSEMBLY_CACHE_SIZE (1 << mDISASSEMBLY_CACHE_BITS)
+#define mDISASSEMBLY_CACHE_TEXT_MAX 64
+
+struct mDisassemblyCacheEntry {
+	uint32_t address;
+	uint32_t opcode;
+	uint32_t flags;
+	uint32_t generation;
+	char text[mDISASSEMBLY_CACHE_TEXT_MAX];
+};
+
+// Remembers disassembled instructions by address, the bytes of the instruction
+// and any platform-specific flags, such as the instruction set. Since the bytes are
+// part of the key, code that gets overwritten is disassembled again; text that
+// depends on anything else, like symbols, is dropped when that changes.
+struct mDebuggerSymbols;
+struct mDisassemblyCache {
+	struct mDisassemblyCacheEntry* entries;
+	uint32_t generation;
+	const struct mDebuggerSymbols* symbols;
+	uint32_t symbolsGeneration;
+};
+
+void mDisassemblyCacheInit(struct mDisassemblyCache*);
+void mDisassemblyCacheDeinit(struct mDisassemblyCache*);
+
+void mDisassemblyCacheInvalidate(struct mDisassemblyCache*);
+// Invalidates the cache if the symbols used for disassembling have changed
+void mDisassemblyCacheCheckSymbols(struct mDisassemblyCache*, const struct mDebuggerSymbols*);
+
+const char* mDisassemblyCacheLookup(struct mDisassemblyCache*, uint32_t address, uint32_t opcode, uint32_t flags);
+void mDisassemblyCacheStore(struct mDisassemblyCache*, uint32_t address, uint32_t opcode, uint32_t flags, const char* text);
+
+CXX_GUARD_END
+
+#endif
@@ -16,6 +16,12 @@ CXX_GUARD_START
 
 #define GDB_STUB_MAX_LINE 1400
 #define GDB_STUB_INTERVAL 32
+#define GDB_STUB_MAX_INTERVAL 0x1000
+#define GDB_STUB_MAX_TRANSFER ((GDB_STUB_MAX_LINE - 32) / 2)
+#define GDB_STUB_SEND_BUFFER (GDB_STUB_MAX_LINE * 4)
+#define GDB_STUB_CACHE_LINES 16
+#define GDB_STUB_CACHE_LINE_SIZE 64
+#define GDB_STUB_CACHED_REGISTERS 17
 
 enum GDBStubAckState {
 	GDB_ACK_PENDING = 0,
@@ -30,27 +36,47 @@ enum GDBWatchpointsBehvaior {
 	GDB_WATCHPOINT_OVERRIDE_LOGIC_ANY_WRITE,
 };
 
+struct GDBStubCacheLine {
+	uint32_t address;
+	bool valid;
+	uint8_t data[GDB_STUB_CACHE_LINE_SIZE];
+};
+
+struct mDebuggerTraceRecorder;
 struct GDBStub {
 	struct mDebuggerModule d;
 
 	char line[GDB_STUB_MAX_LINE];
+	size_t lineLength;
 	char outgoing[GDB_STUB_MAX_LINE];
 	char memoryMapXml[GDB_STUB_MAX_LINE];
 	enum GDBStubAckState lineAck;
 
+	char sendBuffer[GDB_STUB_SEND_BUFFER];
+	size_t sendLength;
+	bool deferSend;
+
 	Socket socket;
 	Socket connection;
 
 	int untilPoll;
+	int pollInterval;
+	int maxPollInterval;
+
+	bool registersCached;
+	uint32_t registerCache[GDB_STUB_CACHED_REGISTERS];
+	struct GDBStubCacheLine memoryCache[GDB_STUB_CACHE_LINES];
 
 	bool supportsSwbreak;
 	bool supportsHwbreak;
 
 	enum GDBWatchpointsBehvaior watchpointsBehavior;
+	struct mDebuggerTraceRecorder* traceRecorder;
 };
 
 void GDBStubCreate(struct GDBStub*);
 bool GDBStubListen(struct GDBStub*, int port, const struct Address* bindAddress, enum GDBWatchpointsBehvaior watchpointsBehavior);
+void GDBStubSetPollInterval(struct GDBStub*, int maxInterval);
 
 void GDBStubHangup(struct GDBStub*);
 void GDBStubShutdown(struct GDBStub*);
@@ -66,6 +66,35 @@ struct ParseTree {
 	int precedence;
 };
 
+#define PARSE_PROGRAM_MAX_DEPTH 32
+
+enum ParseInstructionType {
+	PARSE_INSN_CONSTANT,
+	PARSE_INSN_IDENTIFIER,
+	PARSE_INSN_REGISTER,
+	PARSE_INSN_PUSH,
+	PARSE_INSN_OPERATION,
+	PARSE_INSN_SEGMENT,
+};
+
+struct ParseInstruction {
+	enum ParseInstructionType type;
+	union {
+		struct {
+			int32_t value;
+			int segment;
+		} constant;
+		char* identifier;
+		enum Operation operation;
+	};
+};
+
+DECLARE_VECTOR(ParseInstructionList, struct ParseInstruction);
+
+struct ParseProgram {
+	struct ParseInstructionList instructions;
+};
+
 size_t lexExpression(struct LexVector* lv, const char* string, size_t length, const char* eol);
 void lexFree(struct LexVector* lv);
 
@@ -76,6 +105,10 @@ bool parseLexedExpression(struct ParseTree* tree, struct LexVector* lv);
 struct mDebugger;
 bool mDebuggerEvaluateParseTree(struct mDebugger* debugger, struct ParseTree* tree, int32_t* value, int* segment);
 
+struct ParseProgram* parseCompileTree(struct mDebugger* debugger, const struct ParseTree* tree);
+void parseProgramFree(struct ParseProgram* program);
+bool mDebuggerEvaluateParseProgram(struct mDebugger* debugger, const struct ParseProgram* program, int32_t* value, int* segment);
+
 CXX_GUARD_END
 
 #endif
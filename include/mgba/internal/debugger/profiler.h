@@ -0,0 +1,58 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef DEBUGGER_PROFILER_H
+#define DEBUGGER_PROFILER_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/core/timing.h>
+#include <mgba/debugger/debugger.h>
+#include <mgba-util/table.h>
+#include <mgba-util/vector.h>
+
+#define mDEBUGGER_PROFILER_DEFAULT_PERIOD 0x1000
+#define mDEBUGGER_PROFILER_MAX_DEPTH 64
+
+struct mDebuggerProfilerEntry {
+	// The start of the function, or the sampled address itself if no symbol precedes it
+	uint32_t address;
+	// Owned by the symbol table, so only valid until the symbols change. NULL without a symbol.
+	const char* name;
+	uint64_t self;
+	uint64_t total;
+};
+
+DECLARE_VECTOR(mDebuggerProfilerEntryList, struct mDebuggerProfilerEntry);
+
+struct VFile;
+struct mDebuggerProfiler {
+	struct mDebuggerModule d;
+	struct mTimingEvent event;
+	int32_t period;
+	bool running;
+
+	uint64_t nSamples;
+	// Sampled call chains, innermost address first, mapped to how often they were seen
+	struct Table stacks;
+};
+
+void mDebuggerProfilerInit(struct mDebuggerProfiler*);
+void mDebuggerProfilerDeinit(struct mDebuggerProfiler*);
+
+bool mDebuggerProfilerStart(struct mDebuggerProfiler*, int32_t period);
+void mDebuggerProfilerStop(struct mDebuggerProfiler*);
+void mDebuggerProfilerClear(struct mDebuggerProfiler*);
+
+// Fills the list with one entry per function, most self samples first
+void mDebuggerProfilerHistogram(struct mDebuggerProfiler*, struct mDebuggerProfilerEntryList*);
+bool mDebuggerProfilerWriteFolded(struct mDebuggerProfiler*, struct VFile* out);
+bool mDebuggerProfilerWritePprof(struct mDebuggerProfiler*, struct VFile* out);
+
+CXX_GUARD_END
+
+#endif
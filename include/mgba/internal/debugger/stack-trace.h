@@ -18,6 +18,10 @@ CXX_GUARD_START
 void mStackTraceInit(struct mStackTrace* stack, size_t registersSize);
 void mStackTraceDeinit(struct mStackTrace* stack);
 
+// Without saved registers, frames only keep their addresses, which is cheaper for
+// leaving tracing on all the time. Frames pushed this way have NULL regs.
+void mStackTraceSetSaveRegisters(struct mStackTrace* stack, bool save);
+
 struct mDebuggerSymbols;
 void mStackTraceClear(struct mStackTrace* stack);
 size_t mStackTraceGetDepth(struct mStackTrace* stack);
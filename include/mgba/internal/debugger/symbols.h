@@ -14,13 +14,25 @@ struct mDebuggerSymbols;
 
 struct mDebuggerSymbols* mDebuggerSymbolTableCreate(void);
 void mDebuggerSymbolTableDestroy(struct mDebuggerSymbols*);
+// Changes whenever symbols are added or removed
+uint32_t mDebuggerSymbolTableGeneration(const struct mDebuggerSymbols*);
 
 bool mDebuggerSymbolLookup(const struct mDebuggerSymbols*, const char* name, int32_t* value, int* segment);
 const char* mDebuggerSymbolReverseLookup(const struct mDebuggerSymbols*, int32_t value, int segment);
+const char* mDebuggerSymbolNearest(const struct mDebuggerSymbols*, uint32_t value, int segment, uint32_t* offset);
 
 void mDebuggerSymbolAdd(struct mDebuggerSymbols*, const char* name, int32_t value, int segment);
 void mDebuggerSymbolRemove(struct mDebuggerSymbols*, const char* name);
 
+// A batch holds symbols whose names are offsets into one string table, such as an ELF
+// .strtab, which it keeps a copy of. Adding to a batch doesn't allocate per symbol, and
+// nothing is indexed until the first lookup that needs it. Symbols added with
+// mDebuggerSymbolAdd take precedence over ones in batches, and later batches take
+// precedence over earlier ones. Batches are owned by the table.
+struct mDebuggerSymbolBatch;
+struct mDebuggerSymbolBatch* mDebuggerSymbolBatchCreate(struct mDebuggerSymbols*, const char* strings, size_t size);
+bool mDebuggerSymbolBatchAdd(struct mDebuggerSymbolBatch*, uint32_t name, int32_t value, int segment);
+
 struct VFile;
 void mDebuggerLoadARMIPSSymbols(struct mDebuggerSymbols*, struct VFile* vf);
 
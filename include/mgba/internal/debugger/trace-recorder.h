@@ -0,0 +1,47 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/debugger/debugger.h>
+
+#define mDEBUGGER_TRACE_DEFAULT_CAPACITY 0x100000
+
+struct mDebuggerTraceLog;
+struct mDebuggerTraceRecorder {
+	struct mDebuggerModule d;
+	struct VFile* backing;
+	struct mDebuggerTraceLog* mapped;
+	uint32_t capacity;
+	uint32_t next;
+	uint64_t count;
+
+	bool primed;
+	uint64_t lastTime;
+	size_t nRegisters;
+	uint32_t registers[mDEBUGGER_TRACE_MAX_REGISTERS];
+};
+
+void mDebuggerTraceRecorderInit(struct mDebuggerTraceRecorder*);
+void mDebuggerTraceRecorderDeinit(struct mDebuggerTraceRecorder*);
+
+bool mDebuggerTraceRecorderOpen(struct mDebuggerTraceRecorder*, struct VFile*, int mode, uint32_t capacity);
+bool mDebuggerTraceRecorderClose(struct mDebuggerTraceRecorder*);
+
+bool mDebuggerTraceRecorderStart(struct mDebuggerTraceRecorder*);
+void mDebuggerTraceRecorderStop(struct mDebuggerTraceRecorder*);
+
+size_t mDebuggerTraceRecorderSize(const struct mDebuggerTraceRecorder*);
+bool mDebuggerTraceRecorderGetEntry(const struct mDebuggerTraceRecorder*, size_t index, struct mDebuggerTraceEntry*);
+bool mDebuggerTraceRecorderDisassemble(struct mDebuggerTraceRecorder*, struct VFile* out);
+
+CXX_GUARD_END
+
+#endif
@@ -205,6 +205,7 @@ struct GBAudio {
 	size_t samples;
 	bool forceDisableCh[4];
 	int masterVolume;
+	bool skipMixing;
 };
 
 void GBAudioInit(struct GBAudio* audio, size_t samples, uint8_t* nr52, enum GBAudioStyle style);
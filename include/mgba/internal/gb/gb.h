@@ -43,6 +43,12 @@ enum GBIRQVector {
 	GB_VECTOR_KEYPAD = 0x60,
 };
 
+enum GBIdleLoopOptimization {
+	GB_IDLE_LOOP_IGNORE = -1,
+	GB_IDLE_LOOP_REMOVE = 0,
+	GB_IDLE_LOOP_DETECT
+};
+
 enum GBSGBCommand {
 	SGB_PAL01 = 0,
 	SGB_PAL23,
@@ -105,6 +111,7 @@ struct GB {
 	uint8_t* keySource;
 
 	bool isPristine;
+	bool romShared;
 	size_t pristineRomSize;
 	size_t yankedRomSize;
 	enum GBMemoryBankControllerType yankedMbc;
@@ -133,6 +140,16 @@ struct GB {
 	struct mTimingEvent eiPending;
 	unsigned doubleSpeed;
 
+	// A loop that only reads things that can't change until the next event is skipped ahead
+	// by whole iterations, so it comes out the same as if it had run all the way there
+	enum GBIdleLoopOptimization idleOptimization;
+	uint32_t idleLoop;
+	uint32_t lastJump;
+	int32_t idleLoopTime;
+	int idleDetectionStep;
+	int idleDetectionFailures;
+	uint16_t cachedRegisters[5];
+
 	bool allowOpposingDirections;
 };
 
@@ -182,6 +199,9 @@ bool GBLoadGBX(struct GBXMetadata* metadata, struct VFile* vf);
 
 void GBLoadBIOS(struct GB* gb, struct VFile* vf);
 
+bool GBCloneROM(struct GB* gb, const struct GB* source);
+void GBCloneBIOS(struct GB* gb, const struct GB* source);
+
 void GBSramClean(struct GB* gb, uint32_t frameCount);
 void GBResizeSram(struct GB* gb, size_t size);
 void GBSavedataMask(struct GB* gb, struct VFile* vf, bool writeback);
@@ -117,6 +117,7 @@ void GBIOReset(struct GB* gb);
 
 void GBIOWrite(struct GB* gb, unsigned address, uint8_t value);
 uint8_t GBIORead(struct GB* gb, unsigned address);
+bool GBIOIsReadConstant(unsigned address);
 
 struct GBSerializedState;
 void GBIOSerialize(const struct GB* gb, struct GBSerializedState* state);
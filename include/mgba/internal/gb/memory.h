@@ -11,6 +11,7 @@
 CXX_GUARD_START
 
 #include <mgba/core/log.h>
+#include <mgba/core/serialize.h>
 #include <mgba/core/timing.h>
 #include <mgba/gb/interface.h>
 
@@ -65,6 +66,28 @@ enum {
 	GB_SIZE_MBC6_FLASH = 0x100000,
 };
 
+// The fast paths of GBLoad8 and GBStore8 look addresses up in 4 KiB pages
+enum {
+	GB_ACCESS_PAGE_SHIFT = 12,
+	GB_SIZE_ACCESS_PAGE = 1 << GB_ACCESS_PAGE_SHIFT,
+	GB_ACCESS_PAGES = 0x10000 >> GB_ACCESS_PAGE_SHIFT
+};
+
+// VRAM and WRAM share one page-aligned allocation, laid out in the same order as
+// in savestates, so a dirty page's index is also its offset in the arena
+enum {
+	GB_ARENA_VRAM = 0,
+	GB_ARENA_WRAM = GB_ARENA_VRAM + GB_SIZE_VRAM,
+	GB_SIZE_ARENA = GB_ARENA_WRAM + GB_SIZE_WORKING_RAM
+};
+
+// Dirty page stamps are kept in the same order the blocks appear in savestates
+enum {
+	GB_DIRTY_PAGES_VRAM = 0,
+	GB_DIRTY_PAGES_WRAM = GB_DIRTY_PAGES_VRAM + (GB_SIZE_VRAM >> mSTATE_PAGE_SHIFT),
+	GB_DIRTY_PAGES_MAX = GB_DIRTY_PAGES_WRAM + (GB_SIZE_WORKING_RAM >> mSTATE_PAGE_SHIFT)
+};
+
 struct GBMemory;
 typedef void (*GBMemoryBankControllerWrite)(struct GB*, uint16_t address, uint8_t value);
 typedef uint8_t (*GBMemoryBankControllerRead)(struct GBMemory*, uint16_t address);
@@ -310,10 +333,23 @@ struct GBMemory {
 	uint16_t cartBusPc;
 	uint8_t cartBus;
 
+	uint8_t* arena;
 	uint8_t* wram;
 	uint8_t* wramBank;
 	int wramCurrentBank;
 
+	uint32_t dirtyGeneration;
+	uint32_t dirtyPages[GB_DIRTY_PAGES_MAX];
+	// Stamped like dirtyPages whenever the game writes to these, for mCore.dirtyState
+	uint32_t ioDirty;
+	uint32_t paletteDirty;
+	uint32_t oamDirty;
+
+	// Pages that can be accessed directly point at their memory; the rest are NULL.
+	// Only working RAM is ever writable this way.
+	const uint8_t* readPages[GB_ACCESS_PAGES];
+	uint8_t* writePages[GB_ACCESS_PAGES];
+
 	bool mbcReadBank0;
 	bool mbcReadBank1;
 	bool mbcReadHigh;
@@ -363,6 +399,9 @@ void GBMemoryDeinit(struct GB* gb);
 
 void GBMemoryReset(struct GB* gb);
 void GBMemorySwitchWramBank(struct GBMemory* memory, int bank);
+void GBMemoryUpdatePages(struct GBMemory* memory);
+void GBMemoryMarkDirty(struct GBMemory* memory);
+uint32_t GBMemoryCheckpoint(struct GBMemory* memory);
 
 uint8_t GBLoad8(struct SM83Core* cpu, uint16_t address);
 void GBStore8(struct SM83Core* cpu, uint16_t address, int8_t value);
@@ -377,8 +416,8 @@ uint8_t GBMemoryWriteHDMA5(struct GB* gb, uint8_t value);
 void GBPatch8(struct SM83Core* cpu, uint16_t address, int8_t value, int8_t* old, int segment);
 
 struct GBSerializedState;
-void GBMemorySerialize(const struct GB* gb, struct GBSerializedState* state);
-void GBMemoryDeserialize(struct GB* gb, const struct GBSerializedState* state);
+void GBMemorySerialize(const struct GB* gb, struct GBSerializedState* state, uint32_t since);
+void GBMemoryDeserialize(struct GB* gb, const struct GBSerializedState* state, uint32_t since);
 
 CXX_GUARD_END
 
@@ -0,0 +1,137 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef GB_RENDERER_GL_H
+#define GB_RENDERER_GL_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/core/core.h>
+#include <mgba/internal/gb/gb.h>
+#include <mgba/internal/gb/renderers/software.h>
+#include <mgba/internal/gb/video.h>
+
+#ifdef BUILD_GLES3
+
+#ifdef USE_EPOXY
+#include <epoxy/gl.h>
+#elif defined(__APPLE__)
+#include <OpenGL/gl3.h>
+#elif defined(BUILD_GL)
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#else
+#include <GLES3/gl3.h>
+#endif
+
+enum {
+	GB_GL_FBO_OUTPUT = 0,
+	GB_GL_FBO_SGB,
+	GB_GL_FBO_MAX
+};
+
+enum {
+	GB_GL_UNIFORM_VRAM = 0,
+	GB_GL_UNIFORM_PALETTE,
+	GB_GL_UNIFORM_OBJS,
+	GB_GL_UNIFORM_SCALE,
+	GB_GL_UNIFORM_MAX
+};
+
+enum {
+	GB_GL_SPAN_ATTR_RECT = 1,
+	GB_GL_SPAN_ATTR_BG,
+	GB_GL_SPAN_ATTR_WINDOW,
+};
+
+#define GB_GL_MAX_SPANS 1024
+#define GB_GL_PALETTE_ROWS 256
+
+// One span is a run of pixels on a line drawn with the same registers and palette. rect is
+// the span's start and end x, its line and its palette row, bg is the background's offset,
+// where the window starts (past the end of the line if it isn't shown) and the flags, and
+// window is the window's offset, the number of objects on the line and where to find them.
+struct GBVideoGLSpan {
+	GLint rect[4];
+	GLint bg[4];
+	GLint window[4];
+};
+
+struct GBVideoGLRenderer {
+	struct GBVideoRenderer d;
+
+	uint32_t* temporaryBuffer;
+
+	GLuint fbo[GB_GL_FBO_MAX];
+	GLuint vbo;
+	GLuint spanVbo;
+	GLuint program;
+	GLuint vao;
+	GLint uniforms[GB_GL_UNIFORM_MAX];
+
+	GLuint outputTex;
+	bool outputTexDirty;
+
+	GLuint vramTex;
+	uint32_t vramDirty;
+
+	GLuint paletteTex;
+	uint8_t palette[64][4];
+	uint8_t shadowPalette[GB_GL_PALETTE_ROWS][64][4];
+	int paletteRow;
+	int nextPalette;
+	int firstPalette;
+	bool paletteDirty;
+
+	GLuint objTex;
+	GLshort objs[GB_VIDEO_VERTICAL_PIXELS][GB_VIDEO_MAX_LINE_OBJ][4];
+	int objMax;
+	int objRow;
+	int firstObjRow;
+	int lastObjRow;
+
+	struct GBVideoGLSpan spans[GB_GL_MAX_SPANS];
+	int nSpans;
+
+	uint8_t scy;
+	uint8_t scx;
+	uint8_t wy;
+	uint8_t wx;
+	uint8_t currentWy;
+	uint8_t currentWx;
+	int lastY;
+	int lastX;
+	bool hasWindow;
+
+	GBRegisterLCDC lcdc;
+	enum GBModel model;
+
+	int16_t objOffsetX;
+	int16_t objOffsetY;
+	int16_t offsetScx;
+	int16_t offsetScy;
+	int16_t offsetWx;
+	int16_t offsetWy;
+
+	// The Super Game Boy needs what's been drawn back on the CPU for its transfers, so those
+	// models are drawn in software and only scaled up here
+	struct GBVideoSoftwareRenderer* sgb;
+	GLuint sgbTex;
+	bool sgbBorders;
+
+	int scale;
+};
+
+void GBVideoGLRendererCreate(struct GBVideoGLRenderer* renderer);
+void GBVideoGLRendererSetScale(struct GBVideoGLRenderer* renderer, int scale);
+
+#endif
+
+CXX_GUARD_END
+
+#endif
@@ -18,6 +18,7 @@ struct GBVideoProxyRenderer {
 	struct GBVideoRenderer* backend;
 	struct mVideoLogger* logger;
 	enum GBModel model;
+	bool borders;
 };
 
 void GBVideoProxyRendererCreate(struct GBVideoProxyRenderer* renderer, struct GBVideoRenderer* backend, struct mVideoLogger* logger);
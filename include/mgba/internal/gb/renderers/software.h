@@ -31,6 +31,10 @@ struct GBVideoSoftwareRenderer {
 	mColor palette[192];
 	uint8_t lookup[192];
 
+	// One byte per pixel, decoded lazily from VRAM the first time a tile is drawn after a write
+	uint8_t tileCache[GB_SIZE_VRAM * 4];
+	uint32_t tileDirty[GB_SIZE_VRAM / 16 / 32];
+
 	uint32_t* temporaryBuffer;
 
 	uint8_t scy;
@@ -62,6 +66,10 @@ struct GBVideoSoftwareRenderer {
 	bool sgbBorders;
 	uint32_t sgbBorderMask[18];
 
+	// Palette index of each border pixel, decoded again only after the border's tiles change
+	uint8_t sgbBorderCache[256 * 224];
+	bool sgbBorderDirty;
+
 	uint8_t lastHighlightAmount;
 };
 
@@ -528,6 +528,12 @@ static_assert(sizeof(struct GBSerializedState) == 0x11800, "GB savestate struct
 bool GBDeserialize(struct GB* gb, const struct GBSerializedState* state);
 void GBSerialize(struct GB* gb, struct GBSerializedState* state);
 
+// The incremental variants only copy the pages of VRAM and WRAM that have been
+// written since the checkpoint the state was last synchronized at; see
+// GBMemoryCheckpoint. A checkpoint of 0 copies everything.
+bool GBDeserializeIncremental(struct GB* gb, const struct GBSerializedState* state, uint32_t since);
+void GBSerializeIncremental(struct GB* gb, struct GBSerializedState* state, uint32_t since);
+
 void GBSGBSerialize(struct GB* gb, struct GBSerializedState* state);
 void GBSGBDeserialize(struct GB* gb, const struct GBSerializedState* state);
 
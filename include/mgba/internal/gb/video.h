@@ -169,6 +169,8 @@ struct GBVideo {
 	uint32_t frameCounter;
 	int frameskip;
 	int frameskipCounter;
+	bool renderSkip;
+	bool skipFrame;
 };
 
 void GBVideoInit(struct GBVideo* video);
@@ -193,8 +195,8 @@ void GBVideoSetPalette(struct GBVideo* video, unsigned index, uint32_t color);
 void GBVideoWriteSGBPacket(struct GBVideo* video, uint8_t* data);
 
 struct GBSerializedState;
-void GBVideoSerialize(const struct GBVideo* video, struct GBSerializedState* state);
-void GBVideoDeserialize(struct GBVideo* video, const struct GBSerializedState* state);
+void GBVideoSerialize(const struct GBVideo* video, struct GBSerializedState* state, uint32_t since);
+void GBVideoDeserialize(struct GBVideo* video, const struct GBSerializedState* state, uint32_t since);
 
 CXX_GUARD_END
 
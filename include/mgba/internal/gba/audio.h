@@ -18,13 +18,16 @@ CXX_GUARD_START
 
 #define GBA_AUDIO_FIFO_SIZE 8
 #define GBA_MAX_SAMPLES 16
+#define GBA_AUDIO_FLUSH_BLOCKS 16
 
 #define MP2K_MAGIC 0x68736D53
+#define MP2K_LOCK_MAX 8
 #define MP2K_MAX_SOUND_CHANNELS 12
 
 mLOG_DECLARE_CATEGORY(GBA_AUDIO);
 
 struct GBADMA;
+struct GBAAudioMixer;
 
 extern const unsigned GBA_AUDIO_SAMPLES;
 extern const int GBA_AUDIO_VOLUME_MAX;
@@ -83,9 +86,18 @@ struct GBAAudio {
 	unsigned sampleIndex;
 	struct mStereoSample currentSamples[GBA_MAX_SAMPLES];
 
+	// Finished blocks are handed off to the buffer and stream in batches
+	unsigned pendingBlocks;
+	unsigned pendingSamples;
+	struct mStereoSample pending[GBA_MAX_SAMPLES * GBA_AUDIO_FLUSH_BLOCKS];
+
 	bool forceDisableChA;
 	bool forceDisableChB;
 	int masterVolume;
+	bool skipMixing;
+
+	struct GBAAudioMixer* mixer;
+	bool externalMixing;
 
 	struct mTimingEvent sampleEvent;
 };
@@ -17,6 +17,11 @@ struct GBACartridgeHardware;
 #define EREADER_DOTCODE_STRIDE 1420
 #define EREADER_DOTCODE_SIZE (EREADER_DOTCODE_STRIDE * 40)
 #define EREADER_CARDS_MAX 16
+#define EREADER_SCAN_CACHE_SIZE 16
+
+// Each dot is three pixels wide, packed one bit per pixel. The extra row
+// covers the scanner reading past the end of the last one.
+#define EREADER_DOTCODE_PIXELS_SIZE ((EREADER_DOTCODE_SIZE + EREADER_DOTCODE_STRIDE) * 3 / 8)
 
 DECL_BITFIELD(EReaderControl0, uint8_t);
 DECL_BIT(EReaderControl0, Data, 0);
@@ -57,6 +62,12 @@ struct EReaderCard {
 	size_t size;
 };
 
+struct EReaderScanImage {
+	uint32_t hash;
+	struct EReaderCard card;
+	uint8_t* pixels;
+};
+
 struct GBA;
 struct GBACartEReader {
 	struct GBA* p;
@@ -76,7 +87,10 @@ struct GBACartEReader {
 	int scanX;
 	int scanY;
 	uint8_t* dots;
+	uint8_t* pixels;
 	struct EReaderCard cards[EREADER_CARDS_MAX];
+	struct EReaderScanImage scanCache[EREADER_SCAN_CACHE_SIZE];
+	unsigned nextScanCache;
 };
 
 struct EReaderAnchor;
@@ -0,0 +1,52 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef GBA_AUDIO_MIXER_H
+#define GBA_AUDIO_MIXER_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/core/cpu.h>
+#include <mgba/internal/gba/audio.h>
+
+struct GBAMP2kVoice {
+	bool active;
+	bool loop;
+	uint32_t current;
+	uint32_t remaining;
+	uint32_t loopStart;
+	uint32_t loopLength;
+	uint32_t position;
+	uint32_t step;
+	int volumeRight;
+	int volumeLeft;
+};
+
+// High-level replacement for the output of the MP2K (Sappy) sound engine's mixer. This is
+// only a partial substitution: the engine's SoundMain still runs on the emulated CPU, as it
+// also sequences notes and updates envelopes, which the mixer reads back from the engine's
+// work area every frame. Output quality and rate improve, but no emulated CPU time is
+// saved. Voices aren't kept in savestates either, as they're rebuilt from the work area.
+struct GBAAudioMixer {
+	struct mCPUComponent d;
+	struct GBAAudio* p;
+
+	uint32_t contextAddress;
+
+	bool (*engage)(struct GBAAudioMixer* mixer, uint32_t address);
+	void (*vblank)(struct GBAAudioMixer* mixer);
+	void (*step)(struct GBAAudioMixer* mixer, int16_t* chA, int16_t* chB);
+
+	struct GBAMP2kContext context;
+	struct GBAMP2kVoice voices[MP2K_MAX_SOUND_CHANNELS];
+};
+
+void GBAAudioMixerCreate(struct GBAAudioMixer* mixer);
+
+CXX_GUARD_END
+
+#endif
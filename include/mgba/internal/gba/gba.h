@@ -50,6 +50,10 @@ enum {
 	GBA_SP_BASE_SUPERVISOR = 0x03007FE0
 };
 
+enum {
+	GBA_COMPONENT_AUDIO_MIXER = CPU_COMPONENT_MISC_1
+};
+
 struct ARMCore;
 struct GBA;
 struct Patch;
@@ -93,6 +97,7 @@ struct GBA {
 	int32_t lastRumble;
 
 	bool isPristine;
+	bool romShared;
 	size_t pristineRomSize;
 	size_t yankedRomSize;
 	uint32_t romCrc32;
@@ -171,12 +176,17 @@ void GBASetBreakpoint(struct GBA* gba, struct mCPUComponent* component, uint32_t
 void GBAClearBreakpoint(struct GBA* gba, uint32_t address, enum ExecutionMode mode, uint32_t opcode);
 
 bool GBALoadROM(struct GBA* gba, struct VFile* vf);
+// Skips checksumming a ROM file whose CRC32 is already known
+bool GBALoadROMKnownCrc32(struct GBA* gba, struct VFile* vf, uint32_t crc32);
 bool GBALoadSave(struct GBA* gba, struct VFile* sav);
 void GBAYankROM(struct GBA* gba);
 void GBAUnloadROM(struct GBA* gba);
 void GBALoadBIOS(struct GBA* gba, struct VFile* vf);
 void GBAApplyPatch(struct GBA* gba, struct Patch* patch);
 
+bool GBACloneROM(struct GBA* gba, const struct GBA* source);
+void GBACloneBIOS(struct GBA* gba, const struct GBA* source);
+
 bool GBALoadMB(struct GBA* gba, struct VFile* vf);
 void GBAUnloadMB(struct GBA* gba);
 
@@ -10,6 +10,7 @@
 
 CXX_GUARD_START
 
+#include <mgba/core/serialize.h>
 #include <mgba/core/timing.h>
 
 #include <mgba/internal/arm/arm.h>
@@ -82,6 +83,23 @@ enum {
 	BASE_OFFSET = 24
 };
 
+// VRAM, IWRAM and EWRAM share one page-aligned allocation, laid out in the same
+// order as in savestates, so a dirty page's index is also its offset in the arena
+enum {
+	GBA_ARENA_VRAM = 0,
+	GBA_ARENA_IWRAM = GBA_ARENA_VRAM + GBA_SIZE_VRAM,
+	GBA_ARENA_EWRAM = GBA_ARENA_IWRAM + GBA_SIZE_IWRAM,
+	GBA_SIZE_ARENA = GBA_ARENA_EWRAM + GBA_SIZE_EWRAM
+};
+
+// Dirty page stamps are kept in the same order the blocks appear in savestates
+enum {
+	GBA_DIRTY_PAGES_VRAM = 0,
+	GBA_DIRTY_PAGES_IWRAM = GBA_DIRTY_PAGES_VRAM + (GBA_SIZE_VRAM >> mSTATE_PAGE_SHIFT),
+	GBA_DIRTY_PAGES_EWRAM = GBA_DIRTY_PAGES_IWRAM + (GBA_SIZE_IWRAM >> mSTATE_PAGE_SHIFT),
+	GBA_DIRTY_PAGES_MAX = GBA_DIRTY_PAGES_EWRAM + (GBA_SIZE_EWRAM >> mSTATE_PAGE_SHIFT)
+};
+
 enum {
 	AGB_PRINT_BASE = 0x00FD0000,
 	AGB_PRINT_TOP = 0x00FE0000,
@@ -99,8 +117,19 @@ struct GBAPrintContext {
 	uint16_t put;
 };
 
+// Plain memory that can be accessed without going through the region handlers.
+// An access is fast if (address & mask), aligned down, is below limit. Regions
+// that are fast for stores point dirty at their page stamps.
+struct GBAFastRegion {
+	void* base;
+	uint32_t mask;
+	uint32_t limit;
+	uint32_t* dirty;
+};
+
 struct GBAMemory {
 	uint32_t* bios;
+	uint8_t* arena;
 	uint32_t* wram;
 	uint32_t* iwram;
 	uint32_t* rom;
@@ -120,6 +149,13 @@ struct GBAMemory {
 	char waitstatesSeq16[256];
 	char waitstatesNonseq32[256];
 	char waitstatesNonseq16[256];
+	struct GBAFastRegion fastRegions[256];
+	uint32_t dirtyGeneration;
+	uint32_t dirtyPages[GBA_DIRTY_PAGES_MAX];
+	// Stamped like dirtyPages whenever the game writes to these, for mCore.dirtyState
+	uint32_t ioDirty;
+	uint32_t paletteDirty;
+	uint32_t oamDirty;
 	int activeRegion;
 	bool prefetch;
 	uint32_t lastPrefetchedPc;
@@ -146,6 +182,9 @@ void GBAMemoryDeinit(struct GBA* gba);
 
 void GBAMemoryReset(struct GBA* gba);
 void GBAMemoryClearAGBPrint(struct GBA* gba);
+void GBAMemoryUpdateFastRegions(struct GBA* gba);
+void GBAMemoryMarkDirty(struct GBAMemory* memory);
+uint32_t GBAMemoryCheckpoint(struct GBAMemory* memory);
 
 uint32_t GBALoad32(struct ARMCore* cpu, uint32_t address, int* cycleCounter);
 uint32_t GBALoad16(struct ARMCore* cpu, uint32_t address, int* cycleCounter);
@@ -173,9 +212,12 @@ uint32_t GBAStoreMultiple(struct ARMCore*, uint32_t baseAddress, int mask, enum
 void GBAAdjustWaitstates(struct GBA* gba, uint16_t parameters);
 void GBAAdjustEWRAMWaitstates(struct GBA* gba, uint16_t parameters);
 
+int32_t GBAMemoryStall(struct ARMCore* cpu, int32_t wait);
+int32_t GBAMemoryStallVRAM(struct GBA* gba, int32_t wait, int extra);
+
 struct GBASerializedState;
-void GBAMemorySerialize(const struct GBAMemory* memory, struct GBASerializedState* state);
-void GBAMemoryDeserialize(struct GBAMemory* memory, const struct GBASerializedState* state);
+void GBAMemorySerialize(const struct GBAMemory* memory, struct GBASerializedState* state, uint32_t since);
+void GBAMemoryDeserialize(struct GBAMemory* memory, const struct GBASerializedState* state, uint32_t since);
 
 void GBAPrintFlush(struct GBA* gba);
 
@@ -20,6 +20,7 @@ struct GBAVideoRendererSprite {
 	int8_t index;
 };
 
+bool GBAVideoRendererCleanSprite(struct GBAObj* oam, int index, struct GBAVideoRendererSprite* sprite, int offsetY);
 int GBAVideoRendererCleanOAM(struct GBAObj* oam, struct GBAVideoRendererSprite* sprites, int offsetY);
 
 CXX_GUARD_END
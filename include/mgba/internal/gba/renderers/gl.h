@@ -102,15 +102,7 @@ enum {
 
 	GBA_GL_OBJ_VRAM = 2,
 	GBA_GL_OBJ_PALETTE,
-	GBA_GL_OBJ_CHARBASE,
-	GBA_GL_OBJ_TILE,
-	GBA_GL_OBJ_STRIDE,
-	GBA_GL_OBJ_LOCALPALETTE,
-	GBA_GL_OBJ_INFLAGS,
-	GBA_GL_OBJ_TRANSFORM,
-	GBA_GL_OBJ_DIMS,
 	GBA_GL_OBJ_OBJWIN,
-	GBA_GL_OBJ_MOSAIC,
 	GBA_GL_OBJ_CYCLES,
 
 	GBA_GL_WIN_DISPCNT = 2,
@@ -132,6 +124,27 @@ enum {
 	GBA_GL_UNIFORM_MAX = 14
 };
 
+enum {
+	GBA_GL_OBJ_ATTR_RECT = 1,
+	GBA_GL_OBJ_ATTR_TILE,
+	GBA_GL_OBJ_ATTR_FLAGS,
+	GBA_GL_OBJ_ATTR_TRANSFORM,
+	GBA_GL_OBJ_ATTR_DIMS,
+	GBA_GL_OBJ_ATTR_INDEX,
+};
+
+#define GBA_GL_UPLOAD_BUFFERS 3
+#define GBA_GL_UPLOAD_SIZE 0x200000
+
+struct GBAVideoGLSpriteInstance {
+	GLint rect[4];
+	GLint tile[4];
+	GLint flags[4];
+	GLfloat transform[4];
+	GLint dims[4];
+	GLint index;
+};
+
 struct GBAVideoGLShader {
 	GLuint program;
 	GLuint vao;
@@ -154,6 +167,7 @@ struct GBAVideoGLRenderer {
 	GLuint fbo[GBA_GL_FBO_MAX];
 	GLuint layers[GBA_GL_TEX_MAX];
 	GLuint vbo;
+	GLuint spriteVbo;
 
 	GLuint outputTex;
 	bool outputTexDirty;
@@ -167,11 +181,18 @@ struct GBAVideoGLRenderer {
 	GLuint vramTex;
 	unsigned vramDirty;
 
+	bool persistentUpload;
+	GLuint uploadBuffer[GBA_GL_UPLOAD_BUFFERS];
+	GLsync uploadFence[GBA_GL_UPLOAD_BUFFERS];
+	uint8_t* uploadMap[GBA_GL_UPLOAD_BUFFERS];
+	int activeUpload;
+	size_t uploadOffset;
+
 	uint16_t shadowRegs[0x30];
 	uint64_t regsDirty;
 
 	struct GBAVideoGLShader bgShader[6];
-	struct GBAVideoGLShader objShader[3];
+	struct GBAVideoGLShader objShader[2];
 	struct GBAVideoGLShader windowShader;
 	struct GBAVideoGLShader finalizeShader;
 
@@ -198,6 +219,7 @@ struct GBAVideoGLRenderer {
 
 	GLint winNHistory[2][GBA_VIDEO_VERTICAL_PIXELS * 4];
 	GLint spriteCycles[GBA_VIDEO_VERTICAL_PIXELS];
+	struct GBAVideoGLSpriteInstance spriteInstances[128];
 
 	GBAWindowControl winout;
 	GBAWindowControl objwin;
@@ -206,10 +228,19 @@ struct GBAVideoGLRenderer {
 	int firstY;
 
 	int scale;
+
+	bool asyncReadback;
+	GLuint readbackBuffer[2];
+	GLsync readbackFence[2];
+	unsigned readbackFrame[2];
+	unsigned readbackCounter;
+	unsigned readbackPixelsFrame;
+	bool readbackPixelsValid;
 };
 
 void GBAVideoGLRendererCreate(struct GBAVideoGLRenderer* renderer);
 void GBAVideoGLRendererSetScale(struct GBAVideoGLRenderer* renderer, int scale);
+unsigned GBAVideoGLRendererReadbackLatency(const struct GBAVideoGLRenderer* renderer);
 
 #endif
 
@@ -0,0 +1,65 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef GBA_VIDEO_PARALLEL_H
+#define GBA_VIDEO_PARALLEL_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/internal/gba/renderers/video-software.h>
+#include <mgba/internal/gba/video.h>
+
+#include <mgba-util/threading.h>
+
+#ifndef DISABLE_THREADING
+
+#define GBA_VIDEO_PARALLEL_MAX_WORKERS 8
+
+struct GBAVideoParallelRenderer;
+struct GBAVideoParallelWorker {
+	struct GBAVideoParallelRenderer* p;
+	struct GBAVideoSoftwareRenderer renderer;
+	uint16_t* vram;
+	uint16_t* palette;
+	union GBAOAM* oam;
+
+	Thread thread;
+	size_t read;
+};
+
+// Records everything the renderer is told during a frame and has a pool of software
+// renderers replay it. Every worker replays all of it to keep its state in sync, but
+// each one only draws its own share of the scanlines into the shared output buffer.
+struct GBAVideoParallelRenderer {
+	struct GBAVideoRenderer d;
+	struct GBAVideoSoftwareRenderer* backend;
+
+	int nWorkers;
+	struct GBAVideoParallelWorker* workers;
+
+	Mutex mutex;
+	Condition toWorkerCond;
+	Condition fromWorkerCond;
+	bool stopping;
+	// Applied by the workers when they start
+	struct ThreadPolicy threadPolicy;
+
+	uint8_t* queue;
+	size_t queueSize;
+	size_t written;
+	size_t published;
+	uint32_t vramDirty;
+};
+
+void GBAVideoParallelRendererCreate(struct GBAVideoParallelRenderer* renderer, struct GBAVideoSoftwareRenderer* backend, int nWorkers);
+size_t GBAVideoParallelRendererMemoryUsage(const struct GBAVideoParallelRenderer* renderer);
+
+#endif
+
+CXX_GUARD_END
+
+#endif
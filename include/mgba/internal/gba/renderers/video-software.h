@@ -133,12 +133,18 @@ struct GBAVideoSoftwareRenderer {
 
 	bool forceTarget1;
 	bool oamDirty;
-	int oamMax;
+	uint32_t spriteDirty[4];
+	// Bit n of spriteRows[y] is set when OBJ n is on scanline y
+	uint32_t spriteRows[GBA_VIDEO_VERTICAL_PIXELS][4];
 	struct GBAVideoRendererSprite sprites[128];
 	int16_t objOffsetX;
 	int16_t objOffsetY;
 
 	uint32_t scanlineDirty[5];
+	// When a whole frame went by without redrawing a line or changing a register, the
+	// next one can skip comparing each scanline against the register cache
+	bool frameClean;
+	bool ioClean;
 	uint16_t nextIo[GBA_REG(SOUND1CNT_LO)];
 	struct ScanlineCache {
 		uint16_t io[GBA_REG(SOUND1CNT_LO)];
@@ -147,6 +153,10 @@ struct GBAVideoSoftwareRenderer {
 	} cache[GBA_VIDEO_VERTICAL_PIXELS];
 	int nextY;
 
+	// Only scanlines in [drawStartY, drawEndY) are drawn; the rest just advance state
+	int drawStartY;
+	int drawEndY;
+
 	int start;
 	int end;
 
@@ -84,6 +84,8 @@ struct GBASavedata {
 
 	int dirty;
 	uint32_t dirtAge;
+	uint32_t dirtyStart;
+	uint32_t dirtyEnd;
 
 	enum FlashStateMachine flashState;
 };
@@ -104,6 +106,7 @@ size_t GBASavedataSize(const struct GBASavedata* savedata);
 bool GBASavedataClone(struct GBASavedata* savedata, struct VFile* out);
 bool GBASavedataLoad(struct GBASavedata* savedata, struct VFile* in);
 void GBASavedataForceType(struct GBASavedata* savedata, enum GBASavedataType type);
+void GBASavedataMarkDirty(struct GBASavedata* savedata, uint32_t offset, uint32_t size);
 
 void GBASavedataInitFlash(struct GBASavedata* savedata);
 void GBASavedataInitEEPROM(struct GBASavedata* savedata);
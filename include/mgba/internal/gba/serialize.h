@@ -491,6 +491,12 @@ struct VDir;
 void GBASerialize(struct GBA* gba, struct GBASerializedState* state);
 bool GBADeserialize(struct GBA* gba, const struct GBASerializedState* state);
 
+// The incremental variants only copy the pages of VRAM, IWRAM and EWRAM that have
+// been written since the checkpoint the state was last synchronized at; see
+// GBAMemoryCheckpoint. A checkpoint of 0 copies everything.
+void GBASerializeIncremental(struct GBA* gba, struct GBASerializedState* state, uint32_t since);
+bool GBADeserializeIncremental(struct GBA* gba, const struct GBASerializedState* state, uint32_t since);
+
 CXX_GUARD_END
 
 #endif
@@ -15,6 +15,8 @@ CXX_GUARD_START
 
 #include <mgba-util/socket.h>
 
+#define DOLPHIN_BUFFER_SIZE 64
+
 extern const uint16_t DOLPHIN_CLOCK_PORT;
 extern const uint16_t DOLPHIN_DATA_PORT;
 
@@ -28,6 +30,11 @@ struct GBASIODolphin {
 	int32_t clockSlice;
 	int state;
 	bool active;
+
+	uint8_t dataBuffer[DOLPHIN_BUFFER_SIZE];
+	size_t dataLength;
+	uint8_t clockBuffer[4];
+	size_t clockLength;
 };
 
 void GBASIODolphinCreate(struct GBASIODolphin*);
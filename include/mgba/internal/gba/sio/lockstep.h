@@ -42,6 +42,8 @@ struct GBASIOLockstepCoordinator {
 
 	int32_t cycle;
 	int32_t nextHardSync;
+	// How many cycles the primary may run ahead of the secondaries between transfers
+	int32_t maxSkew;
 
 	uint16_t multiData[4];
 	uint32_t normalData[4];
@@ -66,6 +68,7 @@ struct GBASIOLockstepPlayer {
 	bool asleep;
 	int32_t cycleOffset;
 	struct GBASIOLockstepEvent* queue;
+	int pendingEvents;
 	bool dataReceived;
 
 	struct GBASIOLockstepEvent buffer[MAX_LOCKSTEP_EVENTS];
@@ -75,6 +78,7 @@ struct GBASIOLockstepPlayer {
 struct GBASIOLockstepDriver {
 	struct GBASIODriver d;
 	struct GBASIOLockstepCoordinator* coordinator;
+	struct GBASIOLockstepPlayer* player;
 	struct mTimingEvent event;
 	unsigned lockstepId;
 
@@ -87,6 +91,7 @@ void GBASIOLockstepCoordinatorDeinit(struct GBASIOLockstepCoordinator*);
 void GBASIOLockstepCoordinatorAttach(struct GBASIOLockstepCoordinator*, struct GBASIOLockstepDriver*);
 void GBASIOLockstepCoordinatorDetach(struct GBASIOLockstepCoordinator*, struct GBASIOLockstepDriver*);
 size_t GBASIOLockstepCoordinatorAttached(struct GBASIOLockstepCoordinator*);
+void GBASIOLockstepCoordinatorSetMaxSkew(struct GBASIOLockstepCoordinator*, int32_t cycles);
 
 void GBASIOLockstepDriverCreate(struct GBASIOLockstepDriver*, struct mLockstepUser*);
 
@@ -17,6 +17,8 @@ DECL_BITS(GBATimerFlags, PrescaleBits, 0, 4);
 DECL_BIT(GBATimerFlags, CountUp, 4);
 DECL_BIT(GBATimerFlags, DoIrq, 5);
 DECL_BIT(GBATimerFlags, Enable, 6);
+// The pending event only refreshes the counter, as nothing depends on its overflows
+DECL_BIT(GBATimerFlags, Lazy, 7);
 
 struct GBA;
 struct GBATimer {
@@ -30,6 +32,8 @@ void GBATimerInit(struct GBA* gba);
 void GBATimerUpdateRegister(struct GBA* gba, int timer, int32_t cyclesLate);
 void GBATimerWriteTMCNT_LO(struct GBA* gba, int timer, uint16_t value);
 void GBATimerWriteTMCNT_HI(struct GBA* gba, int timer, uint16_t value);
+// Call when anything that depends on a timer's overflows changes
+void GBATimerReschedule(struct GBA* gba, int timer);
 
 CXX_GUARD_END
 
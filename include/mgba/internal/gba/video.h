@@ -229,6 +229,8 @@ struct GBAVideo {
 	uint32_t frameCounter;
 	int frameskip;
 	int frameskipCounter;
+	bool renderSkip;
+	bool skipFrame;
 };
 
 void GBAVideoInit(struct GBAVideo* video);
@@ -241,8 +243,8 @@ void GBAVideoAssociateRenderer(struct GBAVideo* video, struct GBAVideoRenderer*
 void GBAVideoWriteDISPSTAT(struct GBAVideo* video, uint16_t value);
 
 struct GBASerializedState;
-void GBAVideoSerialize(const struct GBAVideo* video, struct GBASerializedState* state);
-void GBAVideoDeserialize(struct GBAVideo* video, const struct GBASerializedState* state);
+void GBAVideoSerialize(const struct GBAVideo* video, struct GBASerializedState* state, uint32_t since);
+void GBAVideoDeserialize(struct GBAVideo* video, const struct GBASerializedState* state, uint32_t since);
 
 extern MGBA_EXPORT const int GBAVideoObjSizes[16][2];
 
@@ -15,6 +15,10 @@ void mScriptContextGetInputTypes(struct Table*);
 
 void mScriptTypeAdd(struct Table*, const struct mScriptType* type);
 
+struct mScriptValue;
+struct mScriptValue* mScriptContextTakeValue(void);
+bool mScriptContextReturnValue(struct mScriptValue*);
+
 CXX_GUARD_END
 
 #endif
@@ -12,6 +12,7 @@ CXX_GUARD_START
 
 #include <mgba/debugger/debugger.h>
 
+#include <mgba/internal/debugger/disassembly-cache.h>
 #include <mgba/internal/sm83/sm83.h>
 
 struct SM83Segment {
@@ -26,6 +27,8 @@ struct SM83Debugger {
 	struct SM83Core* cpu;
 
 	struct mBreakpointList breakpoints;
+	// One bit per address in the 16-bit address space, set if any breakpoint is there
+	uint32_t breakpointFilter[0x10000 / 32];
 	struct mWatchpointList watchpoints;
 	struct SM83Memory originalMemory;
 
@@ -33,11 +36,18 @@ struct SM83Debugger {
 
 	const struct SM83Segment* segments;
 
+	struct mDisassemblyCache disassembly;
+
 	void (*printStatus)(struct CLIDebuggerSystem*);
 };
 
 struct mDebuggerPlatform* SM83DebuggerPlatformCreate(void);
 
+struct SM83InstructionInfo;
+// Like SM83Disassemble, but reuses the text from the last time the same bytes were
+// disassembled at the same PC. The bytes are packed into the opcode, first byte lowest.
+void SM83DebuggerDisassemble(struct SM83Debugger* debugger, struct SM83InstructionInfo* info, uint32_t opcode, unsigned width, uint16_t pc, char* buffer, int blen);
+
 CXX_GUARD_END
 
 #endif
@@ -168,6 +168,7 @@ void SM83RaiseIRQ(struct SM83Core* cpu);
 
 void SM83Tick(struct SM83Core* cpu);
 void SM83Run(struct SM83Core* cpu);
+void SM83RunLoop(struct SM83Core* cpu);
 
 CXX_GUARD_END
 
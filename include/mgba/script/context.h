@@ -13,17 +13,30 @@ CXX_GUARD_START
 #include <mgba/core/log.h>
 #include <mgba/script/types.h>
 #include <mgba-util/table.h>
+#include <mgba-util/vector.h>
 #include <mgba-util/vfs.h>
 
 #define mSCRIPT_KV_PAIR(KEY, VALUE) { #KEY, (struct mScriptValue*) VALUE }
 #define mSCRIPT_CONSTANT_PAIR(NS, CONST) { #CONST, mScriptValueCreateFromSInt(NS ## _ ## CONST) }
 #define mSCRIPT_KV_SENTINEL { NULL, NULL }
 
+#define mSCRIPT_VALUE_POOL_MAX 256
+
 mLOG_DECLARE_CATEGORY(SCRIPT);
 
 struct mScriptFrame;
 struct mScriptFunction;
 struct mScriptEngineContext;
+struct mScriptCallbackSet;
+
+struct mScriptProfileEntry {
+	const char* name;
+	uint64_t calls;
+	uint64_t totalNsec;
+	uint64_t maxNsec;
+};
+
+DECLARE_VECTOR(mScriptProfileList, struct mScriptProfileEntry);
 
 struct mScriptContext {
 	struct Table rootScope;
@@ -37,6 +50,11 @@ struct mScriptContext {
 	struct mScriptValue* constants;
 	struct Table docstrings;
 	int threadDepth;
+	struct mScriptValue* valuePool;
+	size_t valuePoolSize;
+	bool profiling;
+	struct Table profile;
+	bool compileCache;
 };
 
 struct mScriptEngine2 {
@@ -96,10 +114,20 @@ void mScriptContextExportConstants(struct mScriptContext* context, const char* n
 void mScriptContextExportNamespace(struct mScriptContext* context, const char* nspace, struct mScriptKVPair* value);
 
 void mScriptContextTriggerCallback(struct mScriptContext*, const char* callback, struct mScriptList* args);
+struct mScriptCallbackSet* mScriptContextResolveCallback(struct mScriptContext*, const char* callback);
+void mScriptContextTriggerCallbackSet(struct mScriptCallbackSet*, struct mScriptList* args);
 uint32_t mScriptContextAddCallback(struct mScriptContext*, const char* callback, struct mScriptValue* value);
 uint32_t mScriptContextAddOneshot(struct mScriptContext*, const char* callback, struct mScriptValue* value);
 void mScriptContextRemoveCallback(struct mScriptContext*, uint32_t cbid);
 
+void mScriptContextSetProfiling(struct mScriptContext*, bool enable);
+void mScriptContextResetProfile(struct mScriptContext*);
+void mScriptContextGetProfile(struct mScriptContext*, struct mScriptProfileList*);
+
+// Lets engines that support it keep compiled scripts in the config directory, keyed by
+// their source, so that unchanged scripts don't need compiling again. Off by default.
+void mScriptContextSetCompileCache(struct mScriptContext*, bool enable);
+
 void mScriptContextSetDocstring(struct mScriptContext*, const char* key, const char* docstring);
 const char* mScriptContextGetDocstring(struct mScriptContext*, const char* key);
 
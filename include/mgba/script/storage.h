@@ -16,6 +16,9 @@ CXX_GUARD_START
 struct VFile;
 void mScriptContextAttachStorage(struct mScriptContext* context);
 void mScriptStorageFlushAll(struct mScriptContext* context);
+// Writes out buckets with automatic flushing enabled that have had changes waiting for
+// long enough, on a background thread where available. Meant to be called frequently.
+void mScriptStorageFlushPending(struct mScriptContext* context);
 
 bool mScriptStorageSaveBucket(struct mScriptContext* context, const char* bucket);
 bool mScriptStorageSaveBucketVF(struct mScriptContext* context, const char* bucket, struct VFile* vf);
@@ -5,9 +5,11 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/internal/arm/arm.h>
 
+#include <mgba/internal/arm/block-cache.h>
 #include <mgba/internal/arm/isa-arm.h>
 #include <mgba/internal/arm/isa-inlines.h>
 #include <mgba/internal/arm/isa-thumb.h>
+#include <mgba/internal/arm/jit.h>
 
 void ARMSetPrivilegeMode(struct ARMCore* cpu, enum PrivilegeMode mode) {
 	if (mode == cpu->privilegeMode) {
@@ -46,6 +48,7 @@ void ARMSetPrivilegeMode(struct ARMCore* cpu, enum PrivilegeMode mode) {
 
 void ARMInit(struct ARMCore* cpu) {
 	memset(cpu->cp, 0, sizeof(cpu->cp));
+	cpu->blockCache = NULL;
 	cpu->master->init(cpu, cpu->master);
 	size_t i;
 	for (i = 0; i < cpu->numComponents; ++i) {
@@ -65,6 +68,7 @@ void ARMDeinit(struct ARMCore* cpu) {
 			cpu->components[i]->deinit(cpu->components[i]);
 		}
 	}
+	ARMBlockCacheEnable(cpu, false);
 }
 
 void ARMSetComponents(struct ARMCore* cpu, struct mCPUComponent* master, int extra, struct mCPUComponent** extras) {
@@ -109,6 +113,7 @@ void ARMReset(struct ARMCore* cpu) {
 
 	cpu->shifterOperand = 0;
 	cpu->shifterCarryOut = 0;
+	cpu->lazyFlags = ARM_LAZY_NONE;
 
 	cpu->executionMode = MODE_THUMB;
 	_ARMSetMode(cpu, MODE_ARM);
@@ -121,10 +126,15 @@ void ARMReset(struct ARMCore* cpu) {
 	cpu->irqh.reset(cpu);
 }
 
+void ARMMaterializeFlags(struct ARMCore* cpu) {
+	_ARMMaterializeFlags(cpu);
+}
+
 void ARMRaiseIRQ(struct ARMCore* cpu) {
 	if (cpu->cpsr.i) {
 		return;
 	}
+	_ARMMaterializeFlags(cpu);
 	union PSR cpsr = cpu->cpsr;
 	int instructionWidth;
 	if (cpu->executionMode == MODE_THUMB) {
@@ -144,6 +154,7 @@ void ARMRaiseIRQ(struct ARMCore* cpu) {
 }
 
 void ARMRaiseSWI(struct ARMCore* cpu) {
+	_ARMMaterializeFlags(cpu);
 	union PSR cpsr = cpu->cpsr;
 	int instructionWidth;
 	if (cpu->executionMode == MODE_THUMB) {
@@ -162,6 +173,7 @@ void ARMRaiseSWI(struct ARMCore* cpu) {
 }
 
 void ARMRaiseUndefined(struct ARMCore* cpu) {
+	_ARMMaterializeFlags(cpu);
 	union PSR cpsr = cpu->cpsr;
 	int instructionWidth;
 	if (cpu->executionMode == MODE_THUMB) {
@@ -206,6 +218,7 @@ static inline void ARMStep(struct ARMCore* cpu) {
 
 	unsigned condition = opcode >> 28;
 	if (condition != 0xE) {
+		_ARMMaterializeFlags(cpu);
 		unsigned flags = cpu->cpsr.flags >> 4;
 		bool conditionMet = conditionLut[condition] & (1 << flags);
 		if (!conditionMet) {
@@ -222,10 +235,117 @@ static inline void ThumbStep(struct ARMCore* cpu) {
 	cpu->prefetch[0] = cpu->prefetch[1];
 	cpu->gprs[ARM_PC] += WORD_SIZE_THUMB;
 	LOAD_16(cpu->prefetch[1], cpu->gprs[ARM_PC] & cpu->memory.activeMask, cpu->memory.activeRegion);
-	ThumbInstruction instruction = _thumbTable[opcode >> 6];
+	ThumbInstruction instruction = THUMB_DECODE(opcode);
 	instruction(cpu, opcode);
 }
 
+static void ARMRunBlock(struct ARMCore* cpu, struct ARMBlock* block) {
+	const struct ARMBlockInstruction* instruction = block->instructions;
+	const struct ARMBlockInstruction* end = &block->instructions[block->length];
+	while (true) {
+		uint32_t opcode = cpu->prefetch[0];
+		if (UNLIKELY(opcode != instruction->opcode)) {
+			// Memory changed underneath the block; drop it and let it be rebuilt
+			block->length = 0;
+			ARMStep(cpu);
+			return;
+		}
+		cpu->prefetch[0] = cpu->prefetch[1];
+		cpu->gprs[ARM_PC] += WORD_SIZE_ARM;
+		int32_t pc = cpu->gprs[ARM_PC];
+		LOAD_32(cpu->prefetch[1], pc & cpu->memory.activeMask, cpu->memory.activeRegion);
+
+		unsigned condition = opcode >> 28;
+		if (condition != 0xE) {
+			_ARMMaterializeFlags(cpu);
+			unsigned flags = cpu->cpsr.flags >> 4;
+			bool conditionMet = conditionLut[condition] & (1 << flags);
+			if (!conditionMet) {
+				cpu->cycles += ARM_PREFETCH_CYCLES;
+				goto next;
+			}
+		}
+		instruction->arm(cpu, opcode);
+		if (cpu->gprs[ARM_PC] != pc) {
+			return;
+		}
+	next:
+		++instruction;
+		if (instruction == end || cpu->cycles >= cpu->nextEvent) {
+			return;
+		}
+	}
+}
+
+static void ThumbRunBlock(struct ARMCore* cpu, struct ARMBlock* block) {
+	// Every instruction that can write PC ends a Thumb block, so only the ARM variant has to check for it
+	const struct ARMBlockInstruction* instruction = block->instructions;
+	const struct ARMBlockInstruction* end = &block->instructions[block->length];
+	do {
+		uint32_t opcode = cpu->prefetch[0];
+		if (UNLIKELY(opcode != instruction->opcode)) {
+			// Memory changed underneath the block; drop it and let it be rebuilt
+			block->length = 0;
+			ThumbStep(cpu);
+			return;
+		}
+		cpu->prefetch[0] = cpu->prefetch[1];
+		cpu->gprs[ARM_PC] += WORD_SIZE_THUMB;
+		LOAD_16(cpu->prefetch[1], cpu->gprs[ARM_PC] & cpu->memory.activeMask, cpu->memory.activeRegion);
+		instruction->thumb(cpu, opcode);
+		++instruction;
+	} while (instruction != end && cpu->cycles < cpu->nextEvent);
+}
+
+static void ARMRunLoopCached(struct ARMCore* cpu) {
+	struct ARMBlock* blocks = cpu->blockCache->blocks;
+	if (cpu->executionMode == MODE_THUMB) {
+		while (cpu->cycles < cpu->nextEvent) {
+			uint32_t address = cpu->gprs[ARM_PC] - WORD_SIZE_THUMB;
+			struct ARMBlock* block = &blocks[ARM_BLOCK_CACHE_INDEX(address)];
+			if (UNLIKELY(block->tag != (address | MODE_THUMB) || !block->length)) {
+				ARMBlockCacheBuild(cpu, block, address | MODE_THUMB);
+			}
+#ifdef ENABLE_JIT
+			if (block->native) {
+				if (UNLIKELY(block->native(cpu))) {
+					block->length = 0;
+					ThumbStep(cpu);
+				}
+				continue;
+			}
+			if (cpu->blockCache->jit && ++block->hits == ARM_JIT_THRESHOLD) {
+				ARMJITCompile(cpu, block);
+			}
+#endif
+			ThumbRunBlock(cpu, block);
+		}
+	} else {
+		while (cpu->cycles < cpu->nextEvent) {
+			uint32_t address = cpu->gprs[ARM_PC] - WORD_SIZE_ARM;
+			struct ARMBlock* block = &blocks[ARM_BLOCK_CACHE_INDEX(address)];
+			if (UNLIKELY(block->tag != address || !block->length)) {
+				ARMBlockCacheBuild(cpu, block, address);
+			}
+#ifdef ENABLE_JIT
+			if (block->native) {
+				if (UNLIKELY(block->native(cpu))) {
+					block->length = 0;
+					ARMStep(cpu);
+				}
+				continue;
+			}
+			if (cpu->blockCache->jit && ++block->hits == ARM_JIT_THRESHOLD) {
+				ARMJITCompile(cpu, block);
+			}
+#endif
+			ARMRunBlock(cpu, block);
+		}
+	}
+	_ARMMaterializeFlags(cpu);
+	cpu->irqh.processEvents(cpu);
+}
+
 void ARMRun(struct ARMCore* cpu) {
 	while (cpu->cycles >= cpu->nextEvent) {
 		cpu->irqh.processEvents(cpu);
@@ -235,12 +355,17 @@ void ARMRun(struct ARMCore* cpu) {
 	} else {
 		ARMStep(cpu);
 	}
+	_ARMMaterializeFlags(cpu);
 	while (cpu->cycles >= cpu->nextEvent) {
 		cpu->irqh.processEvents(cpu);
 	}
 }
 
 void ARMRunLoop(struct ARMCore* cpu) {
+	if (cpu->blockCache) {
+		ARMRunLoopCached(cpu);
+		return;
+	}
 	if (cpu->executionMode == MODE_THUMB) {
 		while (cpu->cycles < cpu->nextEvent) {
 			ThumbStep(cpu);
@@ -250,6 +375,7 @@ void ARMRunLoop(struct ARMCore* cpu) {
 			ARMStep(cpu);
 		}
 	}
+	_ARMMaterializeFlags(cpu);
 	cpu->irqh.processEvents(cpu);
 }
 
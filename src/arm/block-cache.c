@@ -0,0 +1,74 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/internal/arm/block-cache.h>
+
+#include <mgba/internal/arm/arm.h>
+#include <mgba/internal/arm/decoder.h>
+#include <mgba/internal/arm/jit.h>
+#include <mgba/internal/arm/macros.h>
+#include <mgba-util/memory.h>
+
+void ARMBlockCacheEnable(struct ARMCore* cpu, bool enable) {
+	if (enable == !!cpu->blockCache) {
+		return;
+	}
+	if (enable) {
+		cpu->blockCache = anonymousMemoryMap(sizeof(struct ARMBlockCache));
+	} else {
+#ifdef ENABLE_JIT
+		ARMJITEnable(cpu, false);
+#endif
+		mappedMemoryFree(cpu->blockCache, sizeof(struct ARMBlockCache));
+		cpu->blockCache = NULL;
+	}
+	// Kick the CPU out of whichever run loop it's in
+	cpu->nextEvent = cpu->cycles;
+}
+
+static void _buildBlockARM(struct ARMCore* cpu, struct ARMBlock* block, uint32_t address) {
+	struct ARMInstructionInfo info;
+	unsigned i;
+	for (i = 0; i < ARM_BLOCK_MAX_LENGTH; ++i, address += WORD_SIZE_ARM) {
+		uint32_t opcode;
+		LOAD_32(opcode, address & cpu->memory.activeMask, cpu->memory.activeRegion);
+		block->instructions[i].opcode = opcode;
+		block->instructions[i].arm = _armTable[((opcode >> 16) & 0xFF0) | ((opcode >> 4) & 0x00F)];
+		ARMDecodeARM(opcode, &info);
+		if (info.branchType != ARM_BRANCH_NONE || info.traps) {
+			++i;
+			break;
+		}
+	}
+	block->length = i;
+}
+
+static void _buildBlockThumb(struct ARMCore* cpu, struct ARMBlock* block, uint32_t address) {
+	struct ARMInstructionInfo info;
+	unsigned i;
+	for (i = 0; i < ARM_BLOCK_MAX_LENGTH; ++i, address += WORD_SIZE_THUMB) {
+		uint16_t opcode;
+		LOAD_16(opcode, address & cpu->memory.activeMask, cpu->memory.activeRegion);
+		block->instructions[i].opcode = opcode;
+		block->instructions[i].thumb = THUMB_DECODE(opcode);
+		ARMDecodeThumb(opcode, &info);
+		if (info.branchType != ARM_BRANCH_NONE || info.traps) {
+			++i;
+			break;
+		}
+	}
+	block->length = i;
+}
+
+void ARMBlockCacheBuild(struct ARMCore* cpu, struct ARMBlock* block, uint32_t tag) {
+	block->tag = tag;
+	block->hits = 0;
+	block->native = NULL;
+	if (tag & MODE_THUMB) {
+		_buildBlockThumb(cpu, block, tag & ~MODE_THUMB);
+	} else {
+		_buildBlockARM(cpu, block, tag);
+	}
+}
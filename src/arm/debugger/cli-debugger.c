@@ -99,6 +99,7 @@ static void _disassembleMode(struct CLIDebugger* debugger, struct CLIDebugVector
 static inline uint32_t _printLine(struct CLIDebugger* debugger, uint32_t address, enum ExecutionMode mode) {
 	struct CLIDebuggerBackend* be = debugger->backend;
 	struct mCore* core = debugger->d.p->core;
+	struct ARMDebugger* platform = (struct ARMDebugger*) debugger->d.p->platform;
 	char disassembly[64];
 	struct ARMInstructionInfo info;
 	address &= ~(WORD_SIZE_THUMB - 1);
@@ -106,7 +107,7 @@ static inline uint32_t _printLine(struct CLIDebugger* debugger, uint32_t address
 	if (mode == MODE_ARM) {
 		uint32_t instruction = core->busRead32(core, address & ~(WORD_SIZE_ARM - 1));
 		ARMDecodeARM(instruction, &info);
-		ARMDisassemble(&info, core->cpu, core->symbolTable, address + WORD_SIZE_ARM * 2, disassembly, sizeof(disassembly));
+		ARMDebuggerDisassemble(platform, &info, instruction, false, core->cpu, address + WORD_SIZE_ARM * 2, disassembly, sizeof(disassembly));
 		be->printf(be, "%08X\t%s\n", instruction, disassembly);
 		return WORD_SIZE_ARM;
 	} else {
@@ -117,11 +118,11 @@ static inline uint32_t _printLine(struct CLIDebugger* debugger, uint32_t address
 		ARMDecodeThumb(instruction, &info);
 		ARMDecodeThumb(instruction2, &info2);
 		if (ARMDecodeThumbCombine(&info, &info2, &combined)) {
-			ARMDisassemble(&combined, core->cpu, core->symbolTable, address + WORD_SIZE_THUMB * 2, disassembly, sizeof(disassembly));
+			ARMDebuggerDisassemble(platform, &combined, instruction | (instruction2 << 16), true, core->cpu, address + WORD_SIZE_THUMB * 2, disassembly, sizeof(disassembly));
 			be->printf(be, "%04X %04X\t%s\n", instruction, instruction2, disassembly);
 			return WORD_SIZE_THUMB * 2;
 		} else {
-			ARMDisassemble(&info, core->cpu, core->symbolTable, address + WORD_SIZE_THUMB * 2, disassembly, sizeof(disassembly));
+			ARMDebuggerDisassemble(platform, &info, instruction, false, core->cpu, address + WORD_SIZE_THUMB * 2, disassembly, sizeof(disassembly));
 			be->printf(be, "%04X     \t%s\n", instruction, disassembly);
 			return WORD_SIZE_THUMB;
 		}
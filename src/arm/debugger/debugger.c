@@ -14,8 +14,9 @@
 #include <mgba/internal/debugger/parser.h>
 #include <mgba/internal/debugger/stack-trace.h>
 #include <mgba-util/math.h>
+#include <mgba-util/string.h>
 
-#define FRAME_PRIV(FRAME) ((struct ARMRegisterFile*) FRAME->regs)->cpsr.priv
+#define FRAME_PRIV(FRAME) (FRAME)->state
 
 DEFINE_VECTOR(ARMDebugBreakpointList, struct ARMDebugBreakpoint);
 
@@ -75,9 +76,10 @@ static bool ARMDebuggerUpdateStackTraceInternal(struct mDebuggerPlatform* d, uin
 		struct mStackFrame* irqFrame = mStackTraceGetFrame(stack, 0);
 		// TODO: uint32_t ivtBase = ARMControlRegIsVE(cpu->cp15.r1.c0) ? 0xFFFF0000 : 0x00000000;
 		uint32_t ivtBase = 0x00000000;
-		if (ivtBase <= pc && pc < ivtBase + 0x20 && !(irqFrame && _ARMModeHasSPSR(((struct ARMRegisterFile*) irqFrame->regs)->cpsr.priv))) {
+		if (ivtBase <= pc && pc < ivtBase + 0x20 && !(irqFrame && _ARMModeHasSPSR(FRAME_PRIV(irqFrame)))) {
 			// TODO: Potential enhancement opportunity: add break-on-exception mode
 			irqFrame = mStackTracePush(stack, pc, pc, cpu->gprs[ARM_SP], &cpu->regs);
+			irqFrame->state = cpu->cpsr.priv;
 			irqFrame->interrupt = true;
 			interrupt = true;
 		}
@@ -156,6 +158,7 @@ static bool ARMDebuggerUpdateStackTraceInternal(struct mDebuggerPlatform* d, uin
 		if (isCall) {
 			int instructionLength = isWideInstruction ? WORD_SIZE_ARM : WORD_SIZE_THUMB;
 			frame = mStackTracePush(stack, pc, destAddress + instructionLength, cpu->gprs[ARM_SP], &cpu->regs);
+			frame->state = cpu->cpsr.priv;
 		}
 		if (!(debugger->stackTraceMode & STACK_TRACE_BREAK_ON_CALL)) {
 			return false;
@@ -181,6 +184,9 @@ static void _destroyBreakpoint(struct mDebugger* debugger, struct ARMDebugBreakp
 	if (breakpoint->d.condition) {
 		parseFree(breakpoint->d.condition);
 	}
+	if (breakpoint->d.compiledCondition) {
+		parseProgramFree(breakpoint->d.compiledCondition);
+	}
 	TableRemove(&debugger->pointOwner, breakpoint->d.id);
 }
 
@@ -188,9 +194,29 @@ static void _destroyWatchpoint(struct mDebugger* debugger, struct mWatchpoint* w
 	if (watchpoint->condition) {
 		parseFree(watchpoint->condition);
 	}
+	if (watchpoint->compiledCondition) {
+		parseProgramFree(watchpoint->compiledCondition);
+	}
 	TableRemove(&debugger->pointOwner, watchpoint->id);
 }
 
+static inline uint32_t _breakpointFilterIndex(uint32_t address) {
+	return ((address >> 1) ^ (address >> 24)) & (ARM_DEBUGGER_BREAKPOINT_FILTER_SIZE - 1);
+}
+
+static inline void _addBreakpointFilter(struct ARMDebugger* debugger, uint32_t address) {
+	uint32_t index = _breakpointFilterIndex(address);
+	debugger->breakpointFilter[index >> 5] |= 1U << (index & 31);
+}
+
+static void _rebuildBreakpointFilter(struct ARMDebugger* debugger) {
+	memset(debugger->breakpointFilter, 0, sizeof(debugger->breakpointFilter));
+	size_t i;
+	for (i = 0; i < ARMDebugBreakpointListSize(&debugger->breakpoints); ++i) {
+		_addBreakpointFilter(debugger, ARMDebugBreakpointListGetPointer(&debugger->breakpoints, i)->d.address);
+	}
+}
+
 static void ARMDebuggerCheckBreakpoints(struct mDebuggerPlatform* d) {
 	struct ARMDebugger* debugger = (struct ARMDebugger*) d;
 	int instructionLength = _ARMInstructionLength(debugger->cpu);
@@ -198,18 +224,19 @@ static void ARMDebuggerCheckBreakpoints(struct mDebuggerPlatform* d) {
 	if (debugger->stackTraceMode != STACK_TRACE_DISABLED && ARMDebuggerUpdateStackTraceInternal(d, pc)) {
 		return;
 	}
+	uint32_t index = _breakpointFilterIndex(pc);
+	if (!(debugger->breakpointFilter[index >> 5] & (1U << (index & 31)))) {
+		return;
+	}
+	bool removed = false;
 	size_t i;
 	for (i = 0; i < ARMDebugBreakpointListSize(&debugger->breakpoints); ++i) {
 		struct ARMDebugBreakpoint* breakpoint = ARMDebugBreakpointListGetPointer(&debugger->breakpoints, i);
 		if (breakpoint->d.address != pc) {
 			continue;
 		}
-		if (breakpoint->d.condition) {
-			int32_t value;
-			int segment;
-			if (!mDebuggerEvaluateParseTree(d->p, breakpoint->d.condition, &value, &segment) || !(value || segment >= 0)) {
-				continue;
-			}
+		if (breakpoint->d.condition && !mDebuggerTestCondition(d->p, breakpoint->d.condition, breakpoint->d.compiledCondition)) {
+			continue;
 		}
 		struct mDebuggerEntryInfo info = {
 			.address = breakpoint->d.address,
@@ -221,9 +248,13 @@ static void ARMDebuggerCheckBreakpoints(struct mDebuggerPlatform* d) {
 		if (breakpoint->d.isTemporary) {
 			_destroyBreakpoint(debugger->d.p, breakpoint);
 			ARMDebugBreakpointListShift(&debugger->breakpoints, i, 1);
+			removed = true;
 			--i;
 		}
 	}
+	if (removed) {
+		_rebuildBreakpointFilter(debugger);
+	}
 }
 
 static void ARMDebuggerInit(void* cpu, struct mDebuggerPlatform* platform);
@@ -245,6 +276,8 @@ static enum mStackTraceMode ARMDebuggerGetStackTraceMode(struct mDebuggerPlatfor
 static void ARMDebuggerSetStackTraceMode(struct mDebuggerPlatform*, enum mStackTraceMode);
 static bool ARMDebuggerUpdateStackTrace(struct mDebuggerPlatform* d);
 static void ARMDebuggerNextInstructionInfo(struct mDebuggerPlatform* d, struct mDebuggerInstructionInfo*);
+static size_t ARMDebuggerNextTraceEntry(struct mDebuggerPlatform* d, struct mDebuggerTraceEntry* entry, uint32_t* registers);
+static void ARMDebuggerFormatTraceEntry(struct mDebuggerPlatform* d, const struct mDebuggerTraceEntry* entry, char* out, size_t* length);
 
 struct mDebuggerPlatform* ARMDebuggerPlatformCreate(void) {
 	struct mDebuggerPlatform* platform = (struct mDebuggerPlatform*) malloc(sizeof(struct ARMDebugger));
@@ -263,6 +296,8 @@ struct mDebuggerPlatform* ARMDebuggerPlatformCreate(void) {
 	platform->setStackTraceMode = ARMDebuggerSetStackTraceMode;
 	platform->updateStackTrace = ARMDebuggerUpdateStackTrace;
 	platform->nextInstructionInfo = ARMDebuggerNextInstructionInfo;
+	platform->nextTraceEntry = ARMDebuggerNextTraceEntry;
+	platform->formatTraceEntry = ARMDebuggerFormatTraceEntry;
 	return platform;
 }
 
@@ -274,7 +309,10 @@ void ARMDebuggerInit(void* cpu, struct mDebuggerPlatform* platform) {
 	debugger->stackTraceMode = STACK_TRACE_DISABLED;
 	ARMDebugBreakpointListInit(&debugger->breakpoints, 0);
 	ARMDebugBreakpointListInit(&debugger->swBreakpoints, 0);
+	memset(debugger->breakpointFilter, 0, sizeof(debugger->breakpointFilter));
 	mWatchpointListInit(&debugger->watchpoints, 0);
+	ARMDebuggerUpdateWatchpointFilter(debugger);
+	mDisassemblyCacheInit(&debugger->disassembly);
 	struct mStackTrace* stack = &platform->p->stackTrace;
 	mStackTraceInit(stack, sizeof(struct ARMRegisterFile));
 	stack->formatRegisters = ARMDebuggerFrameFormatRegisters;
@@ -304,12 +342,14 @@ void ARMDebuggerDeinit(struct mDebuggerPlatform* platform) {
 	ARMDebugBreakpointListDeinit(&debugger->swBreakpoints);
 	mWatchpointListDeinit(&debugger->watchpoints);
 	mStackTraceDeinit(&platform->p->stackTrace);
+	mDisassemblyCacheDeinit(&debugger->disassembly);
 }
 
 static void ARMDebuggerEnter(struct mDebuggerPlatform* platform, enum mDebuggerEntryReason reason, struct mDebuggerEntryInfo* info) {
 	struct ARMDebugger* debugger = (struct ARMDebugger*) platform;
 	struct ARMCore* cpu = debugger->cpu;
 	cpu->nextEvent = cpu->cycles;
+	_ARMMaterializeFlags(cpu);
 	if (reason != DEBUGGER_ENTER_BREAKPOINT) {
 		return;
 	}
@@ -353,6 +393,7 @@ ssize_t ARMDebuggerSetSoftwareBreakpoint(struct mDebuggerPlatform* d, struct mDe
 	breakpoint->d.address = address & ~1; // Clear Thumb bit since it's not part of a valid address
 	breakpoint->d.segment = -1;
 	breakpoint->d.condition = NULL;
+	breakpoint->d.compiledCondition = NULL;
 	breakpoint->d.type = BREAKPOINT_SOFTWARE;
 	breakpoint->sw.opcode = opcode;
 	breakpoint->sw.mode = mode;
@@ -369,7 +410,9 @@ static ssize_t ARMDebuggerSetBreakpoint(struct mDebuggerPlatform* d, struct mDeb
 	breakpoint->d = *info;
 	breakpoint->d.address &= ~1; // Clear Thumb bit since it's not part of a valid address
 	breakpoint->d.id = id;
+	breakpoint->d.compiledCondition = parseCompileTree(debugger->d.p, info->condition);
 	TableInsert(&debugger->d.p->pointOwner, id, owner);
+	_addBreakpointFilter(debugger, breakpoint->d.address);
 	if (info->type == BREAKPOINT_SOFTWARE) {
 		// TODO
 		abort();
@@ -386,6 +429,7 @@ static bool ARMDebuggerClearBreakpoint(struct mDebuggerPlatform* d, ssize_t id)
 		if (ARMDebugBreakpointListGetPointer(breakpoints, i)->d.id == id) {
 			_destroyBreakpoint(debugger->d.p, ARMDebugBreakpointListGetPointer(breakpoints, i));
 			ARMDebugBreakpointListShift(breakpoints, i, 1);
+			_rebuildBreakpointFilter(debugger);
 			return true;
 		}
 	}
@@ -406,6 +450,7 @@ static bool ARMDebuggerClearBreakpoint(struct mDebuggerPlatform* d, ssize_t id)
 		if (mWatchpointListGetPointer(watchpoints, i)->id == id) {
 			_destroyWatchpoint(debugger->d.p, mWatchpointListGetPointer(watchpoints, i));
 			mWatchpointListShift(watchpoints, i, 1);
+			ARMDebuggerUpdateWatchpointFilter(debugger);
 			if (!mWatchpointListSize(&debugger->watchpoints)) {
 				ARMDebuggerRemoveMemoryShim(debugger);
 			}
@@ -459,7 +504,9 @@ static void ARMDebuggerListBreakpoints(struct mDebuggerPlatform* d, struct mDebu
 
 static bool ARMDebuggerHasBreakpoints(struct mDebuggerPlatform* d) {
 	struct ARMDebugger* debugger = (struct ARMDebugger*) d;
-	return ARMDebugBreakpointListSize(&debugger->breakpoints) || mWatchpointListSize(&debugger->watchpoints) || debugger->stackTraceMode != STACK_TRACE_DISABLED;
+	// Watchpoints are caught by the memory shim, which only traps accesses to watched pages and
+	// stops the run loop itself, so they don't need the core to be single-stepped
+	return ARMDebugBreakpointListSize(&debugger->breakpoints) || debugger->stackTraceMode != STACK_TRACE_DISABLED;
 }
 
 static ssize_t ARMDebuggerSetWatchpoint(struct mDebuggerPlatform* d, struct mDebuggerModule* owner, const struct mWatchpoint* info) {
@@ -472,7 +519,9 @@ static ssize_t ARMDebuggerSetWatchpoint(struct mDebuggerPlatform* d, struct mDeb
 	++debugger->nextId;
 	*watchpoint = *info;
 	watchpoint->id = id;
+	watchpoint->compiledCondition = parseCompileTree(debugger->d.p, info->condition);
 	TableInsert(&debugger->d.p->pointOwner, id, owner);
+	ARMDebuggerUpdateWatchpointFilter(debugger);
 	return id;
 }
 
@@ -496,7 +545,6 @@ static void ARMDebuggerListWatchpoints(struct mDebuggerPlatform* d, struct mDebu
 static void ARMDebuggerTrace(struct mDebuggerPlatform* d, char* out, size_t* length) {
 	struct ARMDebugger* debugger = (struct ARMDebugger*) d;
 	struct ARMCore* cpu = debugger->cpu;
-	struct mCore* core = d->p->core;
 
 	char disassembly[64];
 
@@ -505,17 +553,17 @@ static void ARMDebuggerTrace(struct mDebuggerPlatform* d, char* out, size_t* len
 	if (cpu->executionMode == MODE_ARM) {
 		uint32_t instruction = cpu->prefetch[0];
 		sprintf(disassembly, "%08X: ", instruction);
-		ARMDisassemble(&info, cpu, core->symbolTable, cpu->gprs[ARM_PC], disassembly + strlen("00000000: "), sizeof(disassembly) - strlen("00000000: "));
+		ARMDebuggerDisassemble(debugger, &info, instruction, false, cpu, cpu->gprs[ARM_PC], disassembly + strlen("00000000: "), sizeof(disassembly) - strlen("00000000: "));
 	} else {
 		uint16_t instruction = cpu->prefetch[0];
-		ARMDecodeThumb(instruction, &info);
 		if (isWideInstruction) {
 			uint16_t instruction2 = cpu->prefetch[1];
 			sprintf(disassembly, "%04X%04X: ", instruction, instruction2);
-			ARMDisassemble(&info, cpu, core->symbolTable, cpu->gprs[ARM_PC], disassembly + strlen("00000000: "), sizeof(disassembly) - strlen("00000000: "));
+			ARMDebuggerDisassemble(debugger, &info, instruction | (instruction2 << 16), true, cpu, cpu->gprs[ARM_PC], disassembly + strlen("00000000: "), sizeof(disassembly) - strlen("00000000: "));
 		} else {
+			ARMDecodeThumb(instruction, &info);
 			sprintf(disassembly, "    %04X: ", instruction);
-			ARMDisassemble(&info, cpu, core->symbolTable, cpu->gprs[ARM_PC], disassembly + strlen("00000000: "), sizeof(disassembly) - strlen("00000000: "));
+			ARMDebuggerDisassemble(debugger, &info, instruction, false, cpu, cpu->gprs[ARM_PC], disassembly + strlen("00000000: "), sizeof(disassembly) - strlen("00000000: "));
 		}
 	}
 
@@ -525,6 +573,33 @@ static void ARMDebuggerTrace(struct mDebuggerPlatform* d, char* out, size_t* len
 	*length = regStringLen;
 }
 
+static bool _disassemblyReadsMemory(const struct ARMInstructionInfo* info) {
+	// PC-relative loads are shown with the value they load, which can change without the
+	// instruction itself changing
+	if (!(info->operandFormat & ARM_OPERAND_MEMORY) || info->memory.format & ARM_MEMORY_STORE) {
+		return false;
+	}
+	return info->memory.format & ARM_MEMORY_REGISTER_BASE && info->memory.format & ARM_MEMORY_IMMEDIATE_OFFSET && info->memory.baseReg == ARM_PC;
+}
+
+void ARMDebuggerDisassemble(struct ARMDebugger* debugger, const struct ARMInstructionInfo* info, uint32_t opcode, bool wide, struct ARMCore* cpu, uint32_t pc, char* buffer, int blen) {
+	const struct mDebuggerSymbols* symbols = debugger->d.p->core->symbolTable;
+	if (cpu && _disassemblyReadsMemory(info)) {
+		ARMDisassemble(info, cpu, symbols, pc, buffer, blen);
+		return;
+	}
+
+	mDisassemblyCacheCheckSymbols(&debugger->disassembly, symbols);
+	uint32_t flags = info->execMode | (wide << 1);
+	const char* text = mDisassemblyCacheLookup(&debugger->disassembly, pc, opcode, flags);
+	if (text) {
+		strlcpy(buffer, text, blen);
+		return;
+	}
+	ARMDisassemble(info, cpu, symbols, pc, buffer, blen);
+	mDisassemblyCacheStore(&debugger->disassembly, pc, opcode, flags, buffer);
+}
+
 static void ARMDebuggerFormatRegisters(struct ARMRegisterFile* regs, char* out, size_t* length) {
 	*length = snprintf(out, *length, "%08X %08X %08X %08X %08X %08X %08X %08X %08X %08X %08X %08X %08X %08X %08X %08X cpsr: %08X",
 		               regs->gprs[0],  regs->gprs[1],  regs->gprs[2],  regs->gprs[3],
@@ -586,3 +661,50 @@ static void ARMDebuggerNextInstructionInfo(struct mDebuggerPlatform* d, struct m
 
 	// TODO Access types
 }
+
+static size_t ARMDebuggerNextTraceEntry(struct mDebuggerPlatform* d, struct mDebuggerTraceEntry* entry, uint32_t* registers) {
+	struct ARMDebugger* debugger = (struct ARMDebugger*) d;
+	struct ARMCore* cpu = debugger->cpu;
+	int instructionLength = _ARMInstructionLength(cpu);
+	entry->pc = cpu->gprs[ARM_PC] - instructionLength;
+	entry->flags = cpu->cpsr.packed;
+	entry->width = instructionLength;
+	if (cpu->executionMode == MODE_ARM) {
+		entry->opcode = cpu->prefetch[0];
+	} else {
+		// Keep both halves so a wide Thumb instruction can be decoded later
+		entry->opcode = (cpu->prefetch[0] & 0xFFFF) | (cpu->prefetch[1] << 16);
+	}
+	memcpy(registers, cpu->gprs, ARM_PC * sizeof(*registers));
+	return ARM_PC;
+}
+
+static void ARMDebuggerFormatTraceEntry(struct mDebuggerPlatform* d, const struct mDebuggerTraceEntry* entry, char* out, size_t* length) {
+	struct ARMDebugger* debugger = (struct ARMDebugger*) d;
+	char disassembly[64];
+	bool wide = false;
+	struct ARMInstructionInfo info;
+	union PSR cpsr;
+	cpsr.packed = entry->flags;
+
+	if (!cpsr.t) {
+		ARMDecodeARM(entry->opcode, &info);
+		sprintf(disassembly, "%08X: ", entry->opcode);
+	} else {
+		struct ARMInstructionInfo info2;
+		uint16_t instruction = entry->opcode;
+		uint16_t instruction2 = entry->opcode >> 16;
+		ARMDecodeThumb(instruction, &info);
+		ARMDecodeThumb(instruction2, &info2);
+		if (ARMDecodeThumbCombine(&info, &info2, &info)) {
+			sprintf(disassembly, "%04X%04X: ", instruction, instruction2);
+			wide = true;
+		} else {
+			ARMDecodeThumb(instruction, &info);
+			sprintf(disassembly, "    %04X: ", instruction);
+		}
+	}
+	ARMDebuggerDisassemble(debugger, &info, wide || !cpsr.t ? entry->opcode : entry->opcode & 0xFFFF, wide, NULL, entry->pc + entry->width, disassembly + strlen("00000000: "), sizeof(disassembly) - strlen("00000000: "));
+
+	*length = snprintf(out, *length, "%08X cpsr: %08X delta: %04X | %s", entry->pc, entry->flags, entry->changedRegisters, disassembly);
+}
@@ -14,6 +14,15 @@
 
 static void _checkWatchpoints(struct ARMDebugger* debugger, uint32_t address, enum mWatchpointType type, uint32_t newValue, int width);
 
+static inline uint32_t _watchpointFilterIndex(uint32_t page) {
+	return (page ^ (page >> 10)) & (ARM_DEBUGGER_WATCHPOINT_FILTER_SIZE - 1);
+}
+
+static inline bool _isPageWatched(const uint32_t* filter, uint32_t address) {
+	uint32_t index = _watchpointFilterIndex(address >> ARM_DEBUGGER_WATCHPOINT_PAGE_SHIFT);
+	return filter[index >> 5] & (1U << (index & 31));
+}
+
 #define FIND_DEBUGGER(DEBUGGER, CPU) \
 	do { \
 		DEBUGGER = 0; \
@@ -39,7 +48,9 @@ static void _checkWatchpoints(struct ARMDebugger* debugger, uint32_t address, en
 	static RETURN DebuggerShim_ ## NAME TYPES { \
 		struct ARMDebugger* debugger; \
 		FIND_DEBUGGER(debugger, cpu); \
-		_checkWatchpoints(debugger, address, WATCHPOINT_READ, 0, WIDTH); \
+		if (_isPageWatched(debugger->readWatchpointFilter, address)) { \
+			_checkWatchpoints(debugger, address, WATCHPOINT_READ, 0, WIDTH); \
+		} \
 		return debugger->originalMemory.NAME(cpu, __VA_ARGS__); \
 	}
 
@@ -47,11 +58,13 @@ static void _checkWatchpoints(struct ARMDebugger* debugger, uint32_t address, en
 	static RETURN DebuggerShim_ ## NAME TYPES { \
 		struct ARMDebugger* debugger; \
 		FIND_DEBUGGER(debugger, cpu); \
-		_checkWatchpoints(debugger, address, WATCHPOINT_WRITE, value, WIDTH); \
+		if (_isPageWatched(debugger->writeWatchpointFilter, address)) { \
+			_checkWatchpoints(debugger, address, WATCHPOINT_WRITE, value, WIDTH); \
+		} \
 		return debugger->originalMemory.NAME(cpu, __VA_ARGS__); \
 	}
 
-#define CREATE_MULTIPLE_WATCHPOINT_SHIM(NAME, ACCESS_TYPE) \
+#define CREATE_MULTIPLE_WATCHPOINT_SHIM(NAME, ACCESS_TYPE, FILTER) \
 	static uint32_t DebuggerShim_ ## NAME (struct ARMCore* cpu, uint32_t address, int mask, enum LSMDirection direction, int* cycleCounter) { \
 		struct ARMDebugger* debugger; \
 		FIND_DEBUGGER(debugger, cpu); \
@@ -67,7 +80,9 @@ static void _checkWatchpoints(struct ARMDebugger* debugger, uint32_t address, en
 		} \
 		unsigned i; \
 		for (i = 0; i < popcount; ++i) { \
-			_checkWatchpoints(debugger, base + 4 * i, ACCESS_TYPE, 0, 4); \
+			if (_isPageWatched(debugger->FILTER, base + 4 * i)) { \
+				_checkWatchpoints(debugger, base + 4 * i, ACCESS_TYPE, 0, 4); \
+			} \
 		} \
 		return debugger->originalMemory.NAME(cpu, address, mask, direction, cycleCounter); \
 	}
@@ -78,8 +93,8 @@ CREATE_WATCHPOINT_READ_SHIM(load8, 1, uint32_t, (struct ARMCore* cpu, uint32_t a
 CREATE_WATCHPOINT_WRITE_SHIM(store32, 4, void, (struct ARMCore* cpu, uint32_t address, int32_t value, int* cycleCounter), address, value, cycleCounter)
 CREATE_WATCHPOINT_WRITE_SHIM(store16, 2, void, (struct ARMCore* cpu, uint32_t address, int16_t value, int* cycleCounter), address, value, cycleCounter)
 CREATE_WATCHPOINT_WRITE_SHIM(store8, 1, void, (struct ARMCore* cpu, uint32_t address, int8_t value, int* cycleCounter), address, value, cycleCounter)
-CREATE_MULTIPLE_WATCHPOINT_SHIM(loadMultiple, WATCHPOINT_READ)
-CREATE_MULTIPLE_WATCHPOINT_SHIM(storeMultiple, WATCHPOINT_WRITE)
+CREATE_MULTIPLE_WATCHPOINT_SHIM(loadMultiple, WATCHPOINT_READ, readWatchpointFilter)
+CREATE_MULTIPLE_WATCHPOINT_SHIM(storeMultiple, WATCHPOINT_WRITE, writeWatchpointFilter)
 CREATE_SHIM(setActiveRegion, void, (struct ARMCore* cpu, uint32_t address), address)
 
 static void _checkWatchpoints(struct ARMDebugger* debugger, uint32_t address, enum mWatchpointType type, uint32_t newValue, int width) {
@@ -90,12 +105,8 @@ static void _checkWatchpoints(struct ARMDebugger* debugger, uint32_t address, en
 	for (i = 0; i < mWatchpointListSize(&debugger->watchpoints); ++i) {
 		watchpoint = mWatchpointListGetPointer(&debugger->watchpoints, i);
 		if (watchpoint->type & type && watchpoint->minAddress < maxAddress && minAddress < watchpoint->maxAddress) {
-			if (watchpoint->condition) {
-				int32_t value;
-				int segment;
-				if (!mDebuggerEvaluateParseTree(debugger->d.p, watchpoint->condition, &value, &segment) || !(value || segment >= 0)) {
-					continue;
-				}
+			if (watchpoint->condition && !mDebuggerTestCondition(debugger->d.p, watchpoint->condition, watchpoint->compiledCondition)) {
+				continue;
 			}
 
 			uint32_t oldValue;
@@ -132,6 +143,37 @@ static void _checkWatchpoints(struct ARMDebugger* debugger, uint32_t address, en
 	}
 }
 
+static void _markWatchpointPages(uint32_t* filter, const struct mWatchpoint* watchpoint) {
+	if (watchpoint->maxAddress <= watchpoint->minAddress) {
+		return;
+	}
+	uint32_t page = watchpoint->minAddress >> ARM_DEBUGGER_WATCHPOINT_PAGE_SHIFT;
+	uint32_t lastPage = (watchpoint->maxAddress - 1) >> ARM_DEBUGGER_WATCHPOINT_PAGE_SHIFT;
+	if (lastPage - page >= ARM_DEBUGGER_WATCHPOINT_FILTER_SIZE) {
+		memset(filter, 0xFF, ARM_DEBUGGER_WATCHPOINT_FILTER_SIZE / 8);
+		return;
+	}
+	for (; page <= lastPage; ++page) {
+		uint32_t index = _watchpointFilterIndex(page);
+		filter[index >> 5] |= 1U << (index & 31);
+	}
+}
+
+void ARMDebuggerUpdateWatchpointFilter(struct ARMDebugger* debugger) {
+	memset(debugger->readWatchpointFilter, 0, sizeof(debugger->readWatchpointFilter));
+	memset(debugger->writeWatchpointFilter, 0, sizeof(debugger->writeWatchpointFilter));
+	size_t i;
+	for (i = 0; i < mWatchpointListSize(&debugger->watchpoints); ++i) {
+		const struct mWatchpoint* watchpoint = mWatchpointListGetConstPointer(&debugger->watchpoints, i);
+		if (watchpoint->type & WATCHPOINT_READ) {
+			_markWatchpointPages(debugger->readWatchpointFilter, watchpoint);
+		}
+		if (watchpoint->type & WATCHPOINT_WRITE) {
+			_markWatchpointPages(debugger->writeWatchpointFilter, watchpoint);
+		}
+	}
+}
+
 void ARMDebuggerInstallMemoryShim(struct ARMDebugger* debugger) {
 	debugger->originalMemory = debugger->cpu->memory;
 	debugger->cpu->memory.store32 = DebuggerShim_store32;
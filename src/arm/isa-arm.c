@@ -26,7 +26,7 @@ static inline void _shiftLSL(struct ARMCore* cpu, uint32_t opcode) {
 		int shift = cpu->gprs[rs] & 0xFF;
 		if (!shift) {
 			cpu->shifterOperand = shiftVal;
-			cpu->shifterCarryOut = cpu->cpsr.c;
+			cpu->shifterCarryOut = _ARMReadCarry(cpu);
 		} else if (shift < 32) {
 			cpu->shifterOperand = shiftVal << shift;
 			cpu->shifterCarryOut = (shiftVal >> (32 - shift)) & 1;
@@ -41,7 +41,7 @@ static inline void _shiftLSL(struct ARMCore* cpu, uint32_t opcode) {
 		int immediate = (opcode & 0x00000F80) >> 7;
 		if (!immediate) {
 			cpu->shifterOperand = cpu->gprs[rm];
-			cpu->shifterCarryOut = cpu->cpsr.c;
+			cpu->shifterCarryOut = _ARMReadCarry(cpu);
 		} else {
 			cpu->shifterOperand = cpu->gprs[rm] << immediate;
 			cpu->shifterCarryOut = (cpu->gprs[rm] >> (32 - immediate)) & 1;
@@ -61,7 +61,7 @@ static inline void _shiftLSR(struct ARMCore* cpu, uint32_t opcode) {
 		int shift = cpu->gprs[rs] & 0xFF;
 		if (!shift) {
 			cpu->shifterOperand = shiftVal;
-			cpu->shifterCarryOut = cpu->cpsr.c;
+			cpu->shifterCarryOut = _ARMReadCarry(cpu);
 		} else if (shift < 32) {
 			cpu->shifterOperand = shiftVal >> shift;
 			cpu->shifterCarryOut = (shiftVal >> (shift - 1)) & 1;
@@ -96,7 +96,7 @@ static inline void _shiftASR(struct ARMCore* cpu, uint32_t opcode) {
 		int shift = cpu->gprs[rs] & 0xFF;
 		if (!shift) {
 			cpu->shifterOperand = shiftVal;
-			cpu->shifterCarryOut = cpu->cpsr.c;
+			cpu->shifterCarryOut = _ARMReadCarry(cpu);
 		} else if (shift < 32) {
 			cpu->shifterOperand = shiftVal >> shift;
 			cpu->shifterCarryOut = (shiftVal >> (shift - 1)) & 1;
@@ -132,7 +132,7 @@ static inline void _shiftROR(struct ARMCore* cpu, uint32_t opcode) {
 		int rotate = shift & 0x1F;
 		if (!shift) {
 			cpu->shifterOperand = shiftVal;
-			cpu->shifterCarryOut = cpu->cpsr.c;
+			cpu->shifterCarryOut = _ARMReadCarry(cpu);
 		} else if (rotate) {
 			cpu->shifterOperand = ROR(shiftVal, rotate);
 			cpu->shifterCarryOut = (shiftVal >> (rotate - 1)) & 1;
@@ -147,7 +147,7 @@ static inline void _shiftROR(struct ARMCore* cpu, uint32_t opcode) {
 			cpu->shifterCarryOut = (cpu->gprs[rm] >> (immediate - 1)) & 1;
 		} else {
 			// RRX
-			cpu->shifterOperand = (cpu->cpsr.c << 31) | (((uint32_t) cpu->gprs[rm]) >> 1);
+			cpu->shifterOperand = (_ARMReadCarry(cpu) << 31) | (((uint32_t) cpu->gprs[rm]) >> 1);
 			cpu->shifterCarryOut = cpu->gprs[rm] & 0x00000001;
 		}
 	}
@@ -158,7 +158,7 @@ static inline void _immediate(struct ARMCore* cpu, uint32_t opcode) {
 	int immediate = opcode & 0x000000FF;
 	if (!rotate) {
 		cpu->shifterOperand = immediate;
-		cpu->shifterCarryOut = cpu->cpsr.c;
+		cpu->shifterCarryOut = _ARMReadCarry(cpu);
 	} else {
 		cpu->shifterOperand = ROR(immediate, rotate);
 		cpu->shifterCarryOut = ARM_SIGN(cpu->shifterOperand);
@@ -168,49 +168,31 @@ static inline void _immediate(struct ARMCore* cpu, uint32_t opcode) {
 // Instruction definitions
 // Beware pre-processor antics
 
-ATTRIBUTE_NOINLINE static void _additionS(struct ARMCore* cpu, int32_t m, int32_t n, int32_t d) {
-	cpu->cpsr.flags = 0;
-	cpu->cpsr.n = ARM_SIGN(d);
-	cpu->cpsr.z = !d;
-	cpu->cpsr.c = ARM_CARRY_FROM(m, n, d);
-	cpu->cpsr.v = ARM_V_ADDITION(m, n, d);
-}
-
-ATTRIBUTE_NOINLINE static void _subtractionS(struct ARMCore* cpu, int32_t m, int32_t n, int32_t d) {
-	cpu->cpsr.flags = 0;
-	cpu->cpsr.n = ARM_SIGN(d);
-	cpu->cpsr.z = !d;
-	cpu->cpsr.c = ARM_BORROW_FROM(m, n, d);
-	cpu->cpsr.v = ARM_V_SUBTRACTION(m, n, d);
-}
-
-ATTRIBUTE_NOINLINE static void _neutralS(struct ARMCore* cpu, int32_t d) {
-	cpu->cpsr.n = ARM_SIGN(d);
-	cpu->cpsr.z = !d; \
-	cpu->cpsr.c = cpu->shifterCarryOut; \
-}
-
 #define ARM_ADDITION_S(M, N, D) \
 	if (rd == ARM_PC && _ARMModeHasSPSR(cpu->cpsr.priv)) { \
+		cpu->lazyFlags = ARM_LAZY_NONE; \
 		cpu->cpsr = cpu->spsr; \
 		_ARMReadCPSR(cpu); \
 	} else { \
-		_additionS(cpu, M, N, D); \
+		_ARMSetFlagsLazy(cpu, ARM_LAZY_ADD, M, N, D); \
 	}
 
 #define ARM_SUBTRACTION_S(M, N, D) \
 	if (rd == ARM_PC && _ARMModeHasSPSR(cpu->cpsr.priv)) { \
+		cpu->lazyFlags = ARM_LAZY_NONE; \
 		cpu->cpsr = cpu->spsr; \
 		_ARMReadCPSR(cpu); \
 	} else { \
-		_subtractionS(cpu, M, N, D); \
+		_ARMSetFlagsLazy(cpu, ARM_LAZY_SUB, M, N, D); \
 	}
 
 #define ARM_SUBTRACTION_CARRY_S(M, N, D, C) \
 	if (rd == ARM_PC && _ARMModeHasSPSR(cpu->cpsr.priv)) { \
+		cpu->lazyFlags = ARM_LAZY_NONE; \
 		cpu->cpsr = cpu->spsr; \
 		_ARMReadCPSR(cpu); \
 	} else { \
+		cpu->lazyFlags = ARM_LAZY_NONE; \
 		cpu->cpsr.n = ARM_SIGN(D); \
 		cpu->cpsr.z = !(D); \
 		cpu->cpsr.c = ARM_BORROW_FROM_CARRY(M, N, D, C); \
@@ -219,13 +201,17 @@ ATTRIBUTE_NOINLINE static void _neutralS(struct ARMCore* cpu, int32_t d) {
 
 #define ARM_NEUTRAL_S(M, N, D) \
 	if (rd == ARM_PC && _ARMModeHasSPSR(cpu->cpsr.priv)) { \
+		cpu->lazyFlags = ARM_LAZY_NONE; \
 		cpu->cpsr = cpu->spsr; \
 		_ARMReadCPSR(cpu); \
 	} else { \
-		_neutralS(cpu, D); \
+		_ARMSetNZLazy(cpu, D); \
+		cpu->cpsr.c = cpu->shifterCarryOut; \
 	}
 
 #define ARM_NEUTRAL_HI_S(DLO, DHI) \
+	_ARMMaterializeCarry(cpu); \
+	cpu->lazyFlags = ARM_LAZY_NONE; \
 	cpu->cpsr.n = ARM_SIGN(DHI); \
 	cpu->cpsr.z = !((DHI) | (DLO));
 
@@ -250,7 +236,7 @@ ATTRIBUTE_NOINLINE static void _neutralS(struct ARMCore* cpu, int32_t d) {
 #define ADDR_MODE_2_LSL (cpu->gprs[rm] << ADDR_MODE_2_I)
 #define ADDR_MODE_2_LSR (ADDR_MODE_2_I_TEST ? ((uint32_t) cpu->gprs[rm]) >> ADDR_MODE_2_I : 0)
 #define ADDR_MODE_2_ASR (ADDR_MODE_2_I_TEST ? ((int32_t) cpu->gprs[rm]) >> ADDR_MODE_2_I : ((int32_t) cpu->gprs[rm]) >> 31)
-#define ADDR_MODE_2_ROR (ADDR_MODE_2_I_TEST ? ROR(cpu->gprs[rm], ADDR_MODE_2_I) : (cpu->cpsr.c << 31) | (((uint32_t) cpu->gprs[rm]) >> 1))
+#define ADDR_MODE_2_ROR (ADDR_MODE_2_I_TEST ? ROR(cpu->gprs[rm], ADDR_MODE_2_I) : (_ARMReadCarry(cpu) << 31) | (((uint32_t) cpu->gprs[rm]) >> 1))
 
 #define ADDR_MODE_3_ADDRESS ADDR_MODE_2_ADDRESS
 #define ADDR_MODE_3_RN ADDR_MODE_2_RN
@@ -432,6 +418,7 @@ ATTRIBUTE_NOINLINE static void _neutralS(struct ARMCore* cpu, int32_t d) {
 	if (!(rs & 0x8000) && rs) { \
 		ARMSetPrivilegeMode(cpu, privilegeMode); \
 	} else if (_ARMModeHasSPSR(cpu->cpsr.priv)) { \
+		cpu->lazyFlags = ARM_LAZY_NONE; \
 		cpu->cpsr = cpu->spsr; \
 		_ARMReadCPSR(cpu); \
 	}
@@ -472,7 +459,7 @@ DEFINE_ALU_INSTRUCTION_ARM(ADD, ARM_ADDITION_S(n, cpu->shifterOperand, cpu->gprs
 	cpu->gprs[rd] = n + cpu->shifterOperand;)
 
 DEFINE_ALU_INSTRUCTION_ARM(ADC, ARM_ADDITION_S(n, cpu->shifterOperand, cpu->gprs[rd]),
-	cpu->gprs[rd] = n + cpu->shifterOperand + cpu->cpsr.c;)
+	cpu->gprs[rd] = n + cpu->shifterOperand + _ARMReadCarry(cpu);)
 
 DEFINE_ALU_INSTRUCTION_ARM(AND, ARM_NEUTRAL_S(n, cpu->shifterOperand, cpu->gprs[rd]),
 	cpu->gprs[rd] = n & cpu->shifterOperand;)
@@ -501,11 +488,13 @@ DEFINE_ALU_INSTRUCTION_ARM(ORR, ARM_NEUTRAL_S(n, cpu->shifterOperand, cpu->gprs[
 DEFINE_ALU_INSTRUCTION_ARM(RSB, ARM_SUBTRACTION_S(cpu->shifterOperand, n, cpu->gprs[rd]),
 	cpu->gprs[rd] = cpu->shifterOperand - n;)
 
-DEFINE_ALU_INSTRUCTION_ARM(RSC, ARM_SUBTRACTION_CARRY_S(cpu->shifterOperand, n, cpu->gprs[rd], !cpu->cpsr.c),
-	cpu->gprs[rd] = cpu->shifterOperand - n - !cpu->cpsr.c;)
+DEFINE_ALU_INSTRUCTION_ARM(RSC, ARM_SUBTRACTION_CARRY_S(cpu->shifterOperand, n, cpu->gprs[rd], !carry),
+	int carry = _ARMReadCarry(cpu);
+	cpu->gprs[rd] = cpu->shifterOperand - n - !carry;)
 
-DEFINE_ALU_INSTRUCTION_ARM(SBC, ARM_SUBTRACTION_CARRY_S(n, cpu->shifterOperand, cpu->gprs[rd], !cpu->cpsr.c),
-	cpu->gprs[rd] = n - cpu->shifterOperand - !cpu->cpsr.c;)
+DEFINE_ALU_INSTRUCTION_ARM(SBC, ARM_SUBTRACTION_CARRY_S(n, cpu->shifterOperand, cpu->gprs[rd], !carry),
+	int carry = _ARMReadCarry(cpu);
+	cpu->gprs[rd] = n - cpu->shifterOperand - !carry;)
 
 DEFINE_ALU_INSTRUCTION_ARM(SUB, ARM_SUBTRACTION_S(n, cpu->shifterOperand, cpu->gprs[rd]),
 	cpu->gprs[rd] = n - cpu->shifterOperand;)
@@ -697,11 +686,13 @@ DEFINE_INSTRUCTION_ARM(STC, ARM_STUB)
 // Begin miscellaneous definitions
 
 DEFINE_INSTRUCTION_ARM(BKPT,
+	_ARMMaterializeFlags(cpu);
 	cpu->irqh.bkpt32(cpu, ((opcode >> 4) & 0xFFF0) | (opcode & 0xF));
 	currentCycles = 0;); // Not strictly in ARMv4T, but here for convenience
 DEFINE_INSTRUCTION_ARM(ILL, ARM_ILL) // Illegal opcode
 
 DEFINE_INSTRUCTION_ARM(MSR,
+	_ARMMaterializeFlags(cpu);
 	int c = opcode & 0x00010000;
 	int f = opcode & 0x00080000;
 	int32_t operand = cpu->gprs[opcode & 0x0000000F];
@@ -736,6 +727,7 @@ DEFINE_INSTRUCTION_ARM(MSRR,
 
 DEFINE_INSTRUCTION_ARM(MRS, \
 	int rd = (opcode >> 12) & 0xF; \
+	_ARMMaterializeFlags(cpu); \
 	cpu->gprs[rd] = cpu->cpsr.packed;)
 
 DEFINE_INSTRUCTION_ARM(MRSR, \
@@ -743,6 +735,7 @@ DEFINE_INSTRUCTION_ARM(MRSR, \
 	cpu->gprs[rd] = cpu->spsr.packed;)
 
 DEFINE_INSTRUCTION_ARM(MSRI,
+	_ARMMaterializeFlags(cpu);
 	uint32_t c = opcode & 0x00010000;
 	uint32_t f = opcode & 0x00080000;
 	uint32_t rotate = (opcode & 0x00000F00) >> 7;
@@ -777,7 +770,7 @@ DEFINE_INSTRUCTION_ARM(MSRRI,
 	mask &= PSR_USER_MASK | PSR_PRIV_MASK | PSR_STATE_MASK;
 	cpu->spsr.packed = (cpu->spsr.packed & ~mask) | (operand & mask) | 0x00000010;)
 
-DEFINE_INSTRUCTION_ARM(SWI, cpu->irqh.swi32(cpu, opcode & 0xFFFFFF))
+DEFINE_INSTRUCTION_ARM(SWI, _ARMMaterializeFlags(cpu); cpu->irqh.swi32(cpu, opcode & 0xFFFFFF))
 
 const ARMInstruction _armTable[0x1000] = {
 	DECLARE_ARM_EMITTER_BLOCK(_ARMInstruction)
@@ -12,28 +12,20 @@
 // Beware pre-processor insanity
 
 #define THUMB_ADDITION_S(M, N, D) \
-	cpu->cpsr.flags = 0; \
-	cpu->cpsr.n = ARM_SIGN(D); \
-	cpu->cpsr.z = !(D); \
-	cpu->cpsr.c = ARM_CARRY_FROM(M, N, D); \
-	cpu->cpsr.v = ARM_V_ADDITION(M, N, D);
+	_ARMSetFlagsLazy(cpu, ARM_LAZY_ADD, M, N, D);
 
 #define THUMB_SUBTRACTION_S(M, N, D) \
-	cpu->cpsr.flags = 0; \
-	cpu->cpsr.n = ARM_SIGN(D); \
-	cpu->cpsr.z = !(D); \
-	cpu->cpsr.c = ARM_BORROW_FROM(M, N, D); \
-	cpu->cpsr.v = ARM_V_SUBTRACTION(M, N, D);
+	_ARMSetFlagsLazy(cpu, ARM_LAZY_SUB, M, N, D);
 
 #define THUMB_SUBTRACTION_CARRY_S(M, N, D, C) \
+	cpu->lazyFlags = ARM_LAZY_NONE; \
 	cpu->cpsr.n = ARM_SIGN(D); \
 	cpu->cpsr.z = !(D); \
 	cpu->cpsr.c = ARM_BORROW_FROM_CARRY(M, N, D, C); \
 	cpu->cpsr.v = ARM_V_SUBTRACTION(M, N, D);
 
 #define THUMB_NEUTRAL_S(M, N, D) \
-	cpu->cpsr.n = ARM_SIGN(D); \
-	cpu->cpsr.z = !(D);
+	_ARMSetNZLazy(cpu, D);
 
 #define THUMB_ADDITION(D, M, N) \
 	int n = N; \
@@ -62,14 +54,56 @@
 		cpu->cycles += currentCycles; \
 	}
 
-#define DEFINE_IMMEDIATE_5_INSTRUCTION_THUMB(NAME, BODY) \
+#ifdef ENABLE_THUMB_SPECIALIZATION
+// Variants of the most common instructions with their register fields as constants,
+// for the whole-opcode table to pick between
+#define DEFINE_SPECIALIZED_REGISTERS_LOW_THUMB(DEFINE, NAME, HIGH, BODY) \
+	DEFINE(NAME ## _0, HIGH, 0, BODY) \
+	DEFINE(NAME ## _1, HIGH, 1, BODY) \
+	DEFINE(NAME ## _2, HIGH, 2, BODY) \
+	DEFINE(NAME ## _3, HIGH, 3, BODY) \
+	DEFINE(NAME ## _4, HIGH, 4, BODY) \
+	DEFINE(NAME ## _5, HIGH, 5, BODY) \
+	DEFINE(NAME ## _6, HIGH, 6, BODY) \
+	DEFINE(NAME ## _7, HIGH, 7, BODY)
+
+#define DEFINE_SPECIALIZED_REGISTERS_THUMB(DEFINE, NAME, BODY) \
+	DEFINE_SPECIALIZED_REGISTERS_LOW_THUMB(DEFINE, NAME ## _0, 0, BODY) \
+	DEFINE_SPECIALIZED_REGISTERS_LOW_THUMB(DEFINE, NAME ## _1, 1, BODY) \
+	DEFINE_SPECIALIZED_REGISTERS_LOW_THUMB(DEFINE, NAME ## _2, 2, BODY) \
+	DEFINE_SPECIALIZED_REGISTERS_LOW_THUMB(DEFINE, NAME ## _3, 3, BODY) \
+	DEFINE_SPECIALIZED_REGISTERS_LOW_THUMB(DEFINE, NAME ## _4, 4, BODY) \
+	DEFINE_SPECIALIZED_REGISTERS_LOW_THUMB(DEFINE, NAME ## _5, 5, BODY) \
+	DEFINE_SPECIALIZED_REGISTERS_LOW_THUMB(DEFINE, NAME ## _6, 6, BODY) \
+	DEFINE_SPECIALIZED_REGISTERS_LOW_THUMB(DEFINE, NAME ## _7, 7, BODY)
+
+#define DEFINE_SPECIALIZED_REGISTER_THUMB(DEFINE, NAME, BODY) \
+	DEFINE(NAME ## _0, 0, BODY) \
+	DEFINE(NAME ## _1, 1, BODY) \
+	DEFINE(NAME ## _2, 2, BODY) \
+	DEFINE(NAME ## _3, 3, BODY) \
+	DEFINE(NAME ## _4, 4, BODY) \
+	DEFINE(NAME ## _5, 5, BODY) \
+	DEFINE(NAME ## _6, 6, BODY) \
+	DEFINE(NAME ## _7, 7, BODY)
+#else
+#define DEFINE_SPECIALIZED_REGISTERS_THUMB(DEFINE, NAME, BODY)
+#define DEFINE_SPECIALIZED_REGISTER_THUMB(DEFINE, NAME, BODY)
+#endif
+
+#define DEFINE_IMMEDIATE_5_EX_INSTRUCTION_THUMB(NAME, RM, RD, BODY) \
 	DEFINE_INSTRUCTION_THUMB(NAME, \
 		int immediate = (opcode >> 6) & 0x001F; \
-		int rd = opcode & 0x0007; \
-		int rm = (opcode >> 3) & 0x0007; \
+		int rd = RD; \
+		int rm = RM; \
 		BODY;)
 
+#define DEFINE_IMMEDIATE_5_INSTRUCTION_THUMB(NAME, BODY) \
+	DEFINE_IMMEDIATE_5_EX_INSTRUCTION_THUMB(NAME, (opcode >> 3) & 0x0007, opcode & 0x0007, BODY) \
+	DEFINE_SPECIALIZED_REGISTERS_THUMB(DEFINE_IMMEDIATE_5_EX_INSTRUCTION_THUMB, NAME, BODY)
+
 DEFINE_IMMEDIATE_5_INSTRUCTION_THUMB(LSL1,
+	_ARMMaterializeCarry(cpu);
 	if (!immediate) {
 		cpu->gprs[rd] = cpu->gprs[rm];
 	} else {
@@ -79,6 +113,7 @@ DEFINE_IMMEDIATE_5_INSTRUCTION_THUMB(LSL1,
 	THUMB_NEUTRAL_S( , , cpu->gprs[rd]);)
 
 DEFINE_IMMEDIATE_5_INSTRUCTION_THUMB(LSR1,
+	_ARMMaterializeCarry(cpu);
 	if (!immediate) {
 		cpu->cpsr.c = ARM_SIGN(cpu->gprs[rm]);
 		cpu->gprs[rd] = 0;
@@ -89,6 +124,7 @@ DEFINE_IMMEDIATE_5_INSTRUCTION_THUMB(LSR1,
 	THUMB_NEUTRAL_S( , , cpu->gprs[rd]);)
 
 DEFINE_IMMEDIATE_5_INSTRUCTION_THUMB(ASR1,
+	_ARMMaterializeCarry(cpu);
 	if (!immediate) {
 		cpu->cpsr.c = ARM_SIGN(cpu->gprs[rm]);
 		if (cpu->cpsr.c) {
@@ -109,32 +145,44 @@ DEFINE_IMMEDIATE_5_INSTRUCTION_THUMB(STR1, cpu->memory.store32(cpu, cpu->gprs[rm
 DEFINE_IMMEDIATE_5_INSTRUCTION_THUMB(STRB1, cpu->memory.store8(cpu, cpu->gprs[rm] + immediate, cpu->gprs[rd], &currentCycles); THUMB_STORE_POST_BODY;)
 DEFINE_IMMEDIATE_5_INSTRUCTION_THUMB(STRH1, cpu->memory.store16(cpu, cpu->gprs[rm] + immediate * 2, cpu->gprs[rd], &currentCycles); THUMB_STORE_POST_BODY;)
 
-#define DEFINE_DATA_FORM_1_INSTRUCTION_THUMB(NAME, BODY) \
+#define DEFINE_DATA_FORM_1_EX_INSTRUCTION_THUMB(NAME, RN, RD, BODY) \
 	DEFINE_INSTRUCTION_THUMB(NAME, \
 		int rm = (opcode >> 6) & 0x0007; \
-		int rd = opcode & 0x0007; \
-		int rn = (opcode >> 3) & 0x0007; \
+		int rd = RD; \
+		int rn = RN; \
 		BODY;)
 
+#define DEFINE_DATA_FORM_1_INSTRUCTION_THUMB(NAME, BODY) \
+	DEFINE_DATA_FORM_1_EX_INSTRUCTION_THUMB(NAME, (opcode >> 3) & 0x0007, opcode & 0x0007, BODY) \
+	DEFINE_SPECIALIZED_REGISTERS_THUMB(DEFINE_DATA_FORM_1_EX_INSTRUCTION_THUMB, NAME, BODY)
+
 DEFINE_DATA_FORM_1_INSTRUCTION_THUMB(ADD3, THUMB_ADDITION(cpu->gprs[rd], cpu->gprs[rn], cpu->gprs[rm]))
 DEFINE_DATA_FORM_1_INSTRUCTION_THUMB(SUB3, THUMB_SUBTRACTION(cpu->gprs[rd], cpu->gprs[rn], cpu->gprs[rm]))
 
-#define DEFINE_DATA_FORM_2_INSTRUCTION_THUMB(NAME, BODY) \
+#define DEFINE_DATA_FORM_2_EX_INSTRUCTION_THUMB(NAME, RN, RD, BODY) \
 	DEFINE_INSTRUCTION_THUMB(NAME, \
 		int immediate = (opcode >> 6) & 0x0007; \
-		int rd = opcode & 0x0007; \
-		int rn = (opcode >> 3) & 0x0007; \
+		int rd = RD; \
+		int rn = RN; \
 		BODY;)
 
+#define DEFINE_DATA_FORM_2_INSTRUCTION_THUMB(NAME, BODY) \
+	DEFINE_DATA_FORM_2_EX_INSTRUCTION_THUMB(NAME, (opcode >> 3) & 0x0007, opcode & 0x0007, BODY) \
+	DEFINE_SPECIALIZED_REGISTERS_THUMB(DEFINE_DATA_FORM_2_EX_INSTRUCTION_THUMB, NAME, BODY)
+
 DEFINE_DATA_FORM_2_INSTRUCTION_THUMB(ADD1, THUMB_ADDITION(cpu->gprs[rd], cpu->gprs[rn], immediate))
 DEFINE_DATA_FORM_2_INSTRUCTION_THUMB(SUB1, THUMB_SUBTRACTION(cpu->gprs[rd], cpu->gprs[rn], immediate))
 
-#define DEFINE_DATA_FORM_3_INSTRUCTION_THUMB(NAME, BODY) \
+#define DEFINE_DATA_FORM_3_EX_INSTRUCTION_THUMB(NAME, RD, BODY) \
 	DEFINE_INSTRUCTION_THUMB(NAME, \
-		int rd = (opcode >> 8) & 0x0007; \
+		int rd = RD; \
 		int immediate = opcode & 0x00FF; \
 		BODY;)
 
+#define DEFINE_DATA_FORM_3_INSTRUCTION_THUMB(NAME, BODY) \
+	DEFINE_DATA_FORM_3_EX_INSTRUCTION_THUMB(NAME, (opcode >> 8) & 0x0007, BODY) \
+	DEFINE_SPECIALIZED_REGISTER_THUMB(DEFINE_DATA_FORM_3_EX_INSTRUCTION_THUMB, NAME, BODY)
+
 DEFINE_DATA_FORM_3_INSTRUCTION_THUMB(ADD2, THUMB_ADDITION(cpu->gprs[rd], cpu->gprs[rd], immediate))
 DEFINE_DATA_FORM_3_INSTRUCTION_THUMB(CMP1, int aluOut = cpu->gprs[rd] - immediate; THUMB_SUBTRACTION_S(cpu->gprs[rd], immediate, aluOut))
 DEFINE_DATA_FORM_3_INSTRUCTION_THUMB(MOV1, cpu->gprs[rd] = immediate; THUMB_NEUTRAL_S(, , cpu->gprs[rd]))
@@ -150,6 +198,7 @@ DEFINE_DATA_FORM_5_INSTRUCTION_THUMB(AND, cpu->gprs[rd] = cpu->gprs[rd] & cpu->g
 DEFINE_DATA_FORM_5_INSTRUCTION_THUMB(EOR, cpu->gprs[rd] = cpu->gprs[rd] ^ cpu->gprs[rn]; THUMB_NEUTRAL_S( , , cpu->gprs[rd]))
 DEFINE_DATA_FORM_5_INSTRUCTION_THUMB(LSL2,
 	int rs = cpu->gprs[rn] & 0xFF;
+	_ARMMaterializeCarry(cpu);
 	if (rs) {
 		if (rs < 32) {
 			cpu->cpsr.c = (cpu->gprs[rd] >> (32 - rs)) & 1;
@@ -168,6 +217,7 @@ DEFINE_DATA_FORM_5_INSTRUCTION_THUMB(LSL2,
 
 DEFINE_DATA_FORM_5_INSTRUCTION_THUMB(LSR2,
 	int rs = cpu->gprs[rn] & 0xFF;
+	_ARMMaterializeCarry(cpu);
 	if (rs) {
 		if (rs < 32) {
 			cpu->cpsr.c = (cpu->gprs[rd] >> (rs - 1)) & 1;
@@ -186,6 +236,7 @@ DEFINE_DATA_FORM_5_INSTRUCTION_THUMB(LSR2,
 
 DEFINE_DATA_FORM_5_INSTRUCTION_THUMB(ASR2,
 	int rs = cpu->gprs[rn] & 0xFF;
+	_ARMMaterializeCarry(cpu);
 	if (rs) {
 		if (rs < 32) {
 			cpu->cpsr.c = (cpu->gprs[rd] >> (rs - 1)) & 1;
@@ -205,17 +256,19 @@ DEFINE_DATA_FORM_5_INSTRUCTION_THUMB(ASR2,
 DEFINE_DATA_FORM_5_INSTRUCTION_THUMB(ADC,
 	int n = cpu->gprs[rn];
 	int d = cpu->gprs[rd];
-	cpu->gprs[rd] = d + n + cpu->cpsr.c;
+	cpu->gprs[rd] = d + n + _ARMReadCarry(cpu);
 	THUMB_ADDITION_S(d, n, cpu->gprs[rd]);)
 
 DEFINE_DATA_FORM_5_INSTRUCTION_THUMB(SBC,
 	int n = cpu->gprs[rn];
 	int d = cpu->gprs[rd];
-	cpu->gprs[rd] = d - n - !cpu->cpsr.c;
-	THUMB_SUBTRACTION_CARRY_S(d, n, cpu->gprs[rd], !cpu->cpsr.c);)
+	int carry = _ARMReadCarry(cpu);
+	cpu->gprs[rd] = d - n - !carry;
+	THUMB_SUBTRACTION_CARRY_S(d, n, cpu->gprs[rd], !carry);)
 
 DEFINE_DATA_FORM_5_INSTRUCTION_THUMB(ROR,
 	int rs = cpu->gprs[rn] & 0xFF;
+	_ARMMaterializeCarry(cpu);
 	if (rs) {
 		int r4 = rs & 0x1F;
 		if (r4 > 0) {
@@ -323,6 +376,7 @@ DEFINE_LOAD_STORE_MULTIPLE_THUMB(STMIA,
 
 #define DEFINE_CONDITIONAL_BRANCH_THUMB(COND) \
 	DEFINE_INSTRUCTION_THUMB(B ## COND, \
+		_ARMMaterializeFlags(cpu); \
 		if (ARM_COND_ ## COND) { \
 			int8_t immediate = opcode; \
 			cpu->gprs[ARM_PC] += (int32_t) immediate << 1; \
@@ -382,6 +436,7 @@ DEFINE_LOAD_STORE_MULTIPLE_THUMB(PUSHR,
 
 DEFINE_INSTRUCTION_THUMB(ILL, ARM_ILL)
 DEFINE_INSTRUCTION_THUMB(BKPT,
+	_ARMMaterializeFlags(cpu);
 	cpu->irqh.bkpt16(cpu, opcode & 0xFF);
 	currentCycles = 0;) // Not strictly in ARMv4T, but here for convenience
 DEFINE_INSTRUCTION_THUMB(B,
@@ -410,8 +465,14 @@ DEFINE_INSTRUCTION_THUMB(BX,
 		currentCycles += ARMWritePC(cpu);
 	})
 
-DEFINE_INSTRUCTION_THUMB(SWI, cpu->irqh.swi16(cpu, opcode & 0xFF))
+DEFINE_INSTRUCTION_THUMB(SWI, _ARMMaterializeFlags(cpu); cpu->irqh.swi16(cpu, opcode & 0xFF))
 
 const ThumbInstruction _thumbTable[0x400] = {
 	DECLARE_THUMB_EMITTER_BLOCK(_ThumbInstruction)
 };
+
+#ifdef ENABLE_THUMB_SPECIALIZATION
+const ThumbInstruction _thumbSpecializedTable[0x10000] = {
+	DECLARE_THUMB_SPECIALIZED_EMITTER_BLOCK(_ThumbInstruction)
+};
+#endif
@@ -0,0 +1,381 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/internal/arm/jit.h>
+
+#include <mgba/internal/arm/arm.h>
+#include <mgba/internal/arm/block-cache.h>
+
+#include <stddef.h>
+#include <sys/mman.h>
+
+// Blocks are translated into a straight line of native code that keeps the
+// interpreter's prefetch bookkeeping inline and calls straight into the
+// interpreter's handlers. A handful of simple Thumb ALU formats are emitted
+// natively. rbx holds the struct ARMCore* for the lifetime of a block.
+
+#define JIT_MAX_BLOCK_SIZE 0x1000
+#define JIT_MAX_PATCHES (ARM_BLOCK_MAX_LENGTH * 3)
+
+#define CPU_OFFSET(FIELD) ((int32_t) offsetof(struct ARMCore, FIELD))
+#define GPR_OFFSET(R) (CPU_OFFSET(gprs) + (int32_t) sizeof(int32_t) * (R))
+#define FLAGS_OFFSET (CPU_OFFSET(cpsr) + 3)
+
+enum {
+	EAX = 0,
+	ECX = 1,
+	EDX = 2,
+	EBX = 3,
+};
+
+enum {
+	CC_C = 0x2,
+	CC_NC = 0x3,
+	CC_Z = 0x4,
+	CC_NZ = 0x5,
+	CC_GE = 0xD,
+};
+
+struct ARMJITEmitter {
+	uint8_t* code;
+	size_t offset;
+	size_t exits[JIT_MAX_PATCHES];
+	size_t nExits;
+	size_t bailouts[ARM_BLOCK_MAX_LENGTH];
+	size_t nBailouts;
+};
+
+static void _emit8(struct ARMJITEmitter* e, uint8_t value) {
+	e->code[e->offset] = value;
+	++e->offset;
+}
+
+static void _emit32(struct ARMJITEmitter* e, uint32_t value) {
+	memcpy(&e->code[e->offset], &value, sizeof(value));
+	e->offset += sizeof(value);
+}
+
+static void _emit64(struct ARMJITEmitter* e, uint64_t value) {
+	memcpy(&e->code[e->offset], &value, sizeof(value));
+	e->offset += sizeof(value);
+}
+
+// <op> r32, [rbx + disp32] and friends
+static void _emitCPU(struct ARMJITEmitter* e, uint8_t op, unsigned reg, int32_t disp) {
+	_emit8(e, op);
+	_emit8(e, 0x80 | (reg << 3) | EBX);
+	_emit32(e, disp);
+}
+
+static size_t _emitJcc(struct ARMJITEmitter* e, unsigned cc) {
+	_emit8(e, 0x0F);
+	_emit8(e, 0x80 | cc);
+	_emit32(e, 0);
+	return e->offset - 4;
+}
+
+static size_t _emitJmp(struct ARMJITEmitter* e) {
+	_emit8(e, 0xE9);
+	_emit32(e, 0);
+	return e->offset - 4;
+}
+
+static void _bind(struct ARMJITEmitter* e, size_t patch) {
+	uint32_t rel = e->offset - (patch + 4);
+	memcpy(&e->code[patch], &rel, sizeof(rel));
+}
+
+static void _emitAddPrefetchCycles(struct ARMJITEmitter* e, int32_t seqCycles) {
+	_emitCPU(e, 0x8B, EAX, seqCycles); // mov eax, [seqCycles]
+	_emit8(e, 0xFF); // inc eax
+	_emit8(e, 0xC0);
+	_emitCPU(e, 0x01, EAX, CPU_OFFSET(cycles)); // add [cycles], eax
+}
+
+static void _emitPrefetch(struct ARMJITEmitter* e, uint32_t opcode, uint32_t pc, bool thumb) {
+	// Bail out if the code changed since the block was built
+	_emitCPU(e, 0x81, 7, CPU_OFFSET(prefetch[0])); // cmp dword [prefetch[0]], opcode
+	_emit32(e, opcode);
+	e->bailouts[e->nBailouts] = _emitJcc(e, CC_NZ);
+	++e->nBailouts;
+
+	_emitCPU(e, 0x8B, EAX, CPU_OFFSET(prefetch[1])); // mov eax, [prefetch[1]]
+	_emitCPU(e, 0x89, EAX, CPU_OFFSET(prefetch[0])); // mov [prefetch[0]], eax
+	_emitCPU(e, 0xC7, 0, GPR_OFFSET(ARM_PC)); // mov dword [pc], pc
+	_emit32(e, pc);
+	_emit8(e, 0xB8); // mov eax, pc
+	_emit32(e, pc);
+	_emitCPU(e, 0x23, EAX, CPU_OFFSET(memory.activeMask)); // and eax, [activeMask]
+	_emit8(e, 0x48); // mov rcx, [activeRegion]
+	_emitCPU(e, 0x8B, ECX, CPU_OFFSET(memory.activeRegion));
+	if (thumb) {
+		_emit8(e, 0x0F); // movzx eax, word [rcx + rax]
+		_emit8(e, 0xB7);
+	} else {
+		_emit8(e, 0x8B); // mov eax, [rcx + rax]
+	}
+	_emit8(e, 0x04);
+	_emit8(e, 0x01);
+	_emitCPU(e, 0x89, EAX, CPU_OFFSET(prefetch[1])); // mov [prefetch[1]], eax
+}
+
+static void _emitCall(struct ARMJITEmitter* e, void (*handler)(struct ARMCore*, unsigned), uint32_t opcode) {
+	_emit8(e, 0x48); // mov rdi, rbx
+	_emit8(e, 0x89);
+	_emit8(e, 0xDF);
+	_emit8(e, 0xBE); // mov esi, opcode
+	_emit32(e, opcode);
+	_emit8(e, 0x48); // mov rax, handler
+	_emit8(e, 0xB8);
+	_emit64(e, (uintptr_t) handler);
+	_emit8(e, 0xFF); // call rax
+	_emit8(e, 0xD0);
+}
+
+// Writes back any flags the interpreter's handlers have left pending
+static void _emitMaterializeFlags(struct ARMJITEmitter* e) {
+	_emitCPU(e, 0x83, 7, CPU_OFFSET(lazyFlags)); // cmp dword [lazyFlags], ARM_LAZY_NONE
+	_emit8(e, ARM_LAZY_NONE);
+	size_t skip = _emitJcc(e, CC_Z);
+	_emit8(e, 0x48); // mov rdi, rbx
+	_emit8(e, 0x89);
+	_emit8(e, 0xDF);
+	_emit8(e, 0x48); // mov rax, ARMMaterializeFlags
+	_emit8(e, 0xB8);
+	_emit64(e, (uintptr_t) ARMMaterializeFlags);
+	_emit8(e, 0xFF); // call rax
+	_emit8(e, 0xD0);
+	_bind(e, skip);
+}
+
+static void _emitExit(struct ARMJITEmitter* e, unsigned cc) {
+	e->exits[e->nExits] = _emitJcc(e, cc);
+	++e->nExits;
+}
+
+static void _emitEventCheck(struct ARMJITEmitter* e) {
+	_emitCPU(e, 0x8B, EAX, CPU_OFFSET(cycles)); // mov eax, [cycles]
+	_emitCPU(e, 0x3B, EAX, CPU_OFFSET(nextEvent)); // cmp eax, [nextEvent]
+	_emitExit(e, CC_GE);
+}
+
+// Packs the host flags from the last add/sub into cpsr.flags, the same way THUMB_ADDITION_S/THUMB_SUBTRACTION_S do
+static void _emitArithmeticFlags(struct ARMJITEmitter* e, bool subtraction) {
+	static const uint8_t sequence[] = {
+		0x0F, 0x98, 0xC0, // sets al
+		0x0F, 0x94, 0xC1, // setz cl
+		0x41, 0x0F, 0x90, 0xC0, // seto r8b
+		0xC0, 0xE0, 0x03, // shl al, 3
+		0xC0, 0xE1, 0x02, // shl cl, 2
+		0x00, 0xD2, // add dl, dl
+		0x08, 0xC8, // or al, cl
+		0x08, 0xD0, // or al, dl
+		0x44, 0x08, 0xC0, // or al, r8b
+		0xC0, 0xE0, 0x04, // shl al, 4
+	};
+	// ARM carry is the inverse of the x86 borrow for subtraction
+	_emit8(e, 0x0F); // setc/setnc dl
+	_emit8(e, 0x90 | (subtraction ? CC_NC : CC_C));
+	_emit8(e, 0xC2);
+	memcpy(&e->code[e->offset], sequence, sizeof(sequence));
+	e->offset += sizeof(sequence);
+	_emitCPU(e, 0x88, EAX, FLAGS_OFFSET); // mov [cpsr.flags], al
+	_emitCPU(e, 0xC7, 0, CPU_OFFSET(lazyFlags)); // mov dword [lazyFlags], ARM_LAZY_NONE
+	_emit32(e, ARM_LAZY_NONE);
+}
+
+static bool _emitThumbNative(struct ARMJITEmitter* e, uint16_t opcode) {
+	int rd;
+	bool subtraction;
+	bool store = true;
+	switch (opcode >> 11) {
+	case 0x04: // MOV1
+		rd = (opcode >> 8) & 7;
+		_emitAddPrefetchCycles(e, CPU_OFFSET(memory.activeSeqCycles16));
+		_emitCPU(e, 0xC7, 0, GPR_OFFSET(rd)); // mov dword [rd], immediate
+		_emit32(e, opcode & 0xFF);
+		// N is always clear, C and V are left alone
+		_emitMaterializeFlags(e);
+		_emitCPU(e, 0x80, 4, FLAGS_OFFSET); // and byte [cpsr.flags], 0x3F
+		_emit8(e, 0x3F);
+		if (!(opcode & 0xFF)) {
+			_emitCPU(e, 0x80, 1, FLAGS_OFFSET); // or byte [cpsr.flags], 0x40
+			_emit8(e, 0x40);
+		}
+		return true;
+	case 0x05: // CMP1
+	case 0x06: // ADD2
+	case 0x07: // SUB2
+		rd = (opcode >> 8) & 7;
+		subtraction = (opcode >> 11) != 0x06;
+		store = (opcode >> 11) != 0x05;
+		_emitAddPrefetchCycles(e, CPU_OFFSET(memory.activeSeqCycles16));
+		_emitCPU(e, 0x8B, EAX, GPR_OFFSET(rd)); // mov eax, [rd]
+		_emit8(e, subtraction ? 0x2D : 0x05); // sub/add eax, immediate
+		_emit32(e, opcode & 0xFF);
+		break;
+	default:
+		switch (opcode >> 9) {
+		case 0x0C: // ADD3
+		case 0x0D: // SUB3
+		case 0x0E: // ADD1
+		case 0x0F: // SUB1
+			rd = opcode & 7;
+			subtraction = opcode & 0x0200;
+			_emitAddPrefetchCycles(e, CPU_OFFSET(memory.activeSeqCycles16));
+			_emitCPU(e, 0x8B, EAX, GPR_OFFSET((opcode >> 3) & 7)); // mov eax, [rn]
+			if (opcode & 0x0400) {
+				_emit8(e, subtraction ? 0x2D : 0x05); // sub/add eax, immediate
+				_emit32(e, (opcode >> 6) & 7);
+			} else {
+				_emitCPU(e, subtraction ? 0x2B : 0x03, EAX, GPR_OFFSET((opcode >> 6) & 7)); // sub/add eax, [rm]
+			}
+			break;
+		default:
+			return false;
+		}
+		break;
+	}
+	if (store) {
+		_emitCPU(e, 0x89, EAX, GPR_OFFSET(rd)); // mov [rd], eax
+	}
+	_emitArithmeticFlags(e, subtraction);
+	return true;
+}
+
+static void _compileThumb(struct ARMJITEmitter* e, const struct ARMBlock* block, uint32_t address) {
+	unsigned i;
+	for (i = 0; i < block->length; ++i, address += WORD_SIZE_THUMB) {
+		uint32_t opcode = block->instructions[i].opcode;
+		_emitPrefetch(e, opcode, address + WORD_SIZE_THUMB * 2, true);
+		if (!_emitThumbNative(e, opcode)) {
+			_emitCall(e, block->instructions[i].thumb, opcode);
+		}
+		if (i + 1 < block->length) {
+			_emitEventCheck(e);
+		}
+	}
+}
+
+static void _compileARM(struct ARMJITEmitter* e, const struct ARMBlock* block, uint32_t address) {
+	static const uint16_t conditionLut[16] = {
+		0xF0F0, 0x0F0F, 0xCCCC, 0x3333, 0xFF00, 0x00FF, 0xAAAA, 0x5555,
+		0x0C0C, 0xF3F3, 0xAA55, 0x55AA, 0x0A05, 0xF5FA, 0xFFFF, 0x0000
+	};
+	unsigned i;
+	for (i = 0; i < block->length; ++i, address += WORD_SIZE_ARM) {
+		uint32_t opcode = block->instructions[i].opcode;
+		uint32_t pc = address + WORD_SIZE_ARM * 2;
+		unsigned condition = opcode >> 28;
+		size_t skip = 0;
+		_emitPrefetch(e, opcode, pc, false);
+		if (condition == 0xF) {
+			_emitAddPrefetchCycles(e, CPU_OFFSET(memory.activeSeqCycles32));
+		} else {
+			if (condition != 0xE) {
+				_emitMaterializeFlags(e);
+				_emit8(e, 0x0F); // movzx eax, byte [cpsr.flags]
+				_emitCPU(e, 0xB6, EAX, FLAGS_OFFSET);
+				_emit8(e, 0xC1); // shr eax, 4
+				_emit8(e, 0xE8);
+				_emit8(e, 0x04);
+				_emit8(e, 0xB9); // mov ecx, lut
+				_emit32(e, conditionLut[condition]);
+				_emit8(e, 0x0F); // bt ecx, eax
+				_emit8(e, 0xA3);
+				_emit8(e, 0xC1);
+				size_t met = _emitJcc(e, CC_C);
+				_emitAddPrefetchCycles(e, CPU_OFFSET(memory.activeSeqCycles32));
+				skip = _emitJmp(e);
+				_bind(e, met);
+			}
+			_emitCall(e, block->instructions[i].arm, opcode);
+			_emitCPU(e, 0x81, 7, GPR_OFFSET(ARM_PC)); // cmp dword [pc], pc
+			_emit32(e, pc);
+			_emitExit(e, CC_NZ);
+			if (skip) {
+				_bind(e, skip);
+			}
+		}
+		if (i + 1 < block->length) {
+			_emitEventCheck(e);
+		}
+	}
+}
+
+static void _flush(struct ARMBlockCache* cache) {
+	size_t i;
+	for (i = 0; i < ARM_BLOCK_CACHE_SIZE; ++i) {
+		cache->blocks[i].native = NULL;
+		cache->blocks[i].hits = 0;
+	}
+	cache->jit->used = 0;
+}
+
+void ARMJITEnable(struct ARMCore* cpu, bool enable) {
+	if (enable) {
+		ARMBlockCacheEnable(cpu, true);
+		if (!cpu->blockCache || cpu->blockCache->jit) {
+			return;
+		}
+		uint8_t* arena = mmap(0, ARM_JIT_ARENA_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANON, -1, 0);
+		if (arena == MAP_FAILED) {
+			// Writable and executable memory isn't available; stick with the interpreter
+			return;
+		}
+		cpu->blockCache->jit = malloc(sizeof(*cpu->blockCache->jit));
+		cpu->blockCache->jit->arena = arena;
+		cpu->blockCache->jit->used = 0;
+	} else {
+		if (!cpu->blockCache || !cpu->blockCache->jit) {
+			return;
+		}
+		_flush(cpu->blockCache);
+		munmap(cpu->blockCache->jit->arena, ARM_JIT_ARENA_SIZE);
+		free(cpu->blockCache->jit);
+		cpu->blockCache->jit = NULL;
+	}
+	cpu->nextEvent = cpu->cycles;
+}
+
+void ARMJITCompile(struct ARMCore* cpu, struct ARMBlock* block) {
+	struct ARMJIT* jit = cpu->blockCache->jit;
+	if (jit->used + JIT_MAX_BLOCK_SIZE > ARM_JIT_ARENA_SIZE) {
+		_flush(cpu->blockCache);
+	}
+
+	struct ARMJITEmitter e = {
+		.code = &jit->arena[jit->used]
+	};
+	_emit8(&e, 0x53); // push rbx
+	_emit8(&e, 0x48); // mov rbx, rdi
+	_emit8(&e, 0x89);
+	_emit8(&e, 0xFB);
+	if (block->tag & MODE_THUMB) {
+		_compileThumb(&e, block, block->tag & ~MODE_THUMB);
+	} else {
+		_compileARM(&e, block, block->tag);
+	}
+
+	size_t i;
+	for (i = 0; i < e.nExits; ++i) {
+		_bind(&e, e.exits[i]);
+	}
+	_emit8(&e, 0x31); // xor eax, eax
+	_emit8(&e, 0xC0);
+	_emit8(&e, 0x5B); // pop rbx
+	_emit8(&e, 0xC3); // ret
+
+	for (i = 0; i < e.nBailouts; ++i) {
+		_bind(&e, e.bailouts[i]);
+	}
+	_emit8(&e, 0xB8); // mov eax, 1
+	_emit32(&e, 1);
+	_emit8(&e, 0x5B); // pop rbx
+	_emit8(&e, 0xC3); // ret
+
+	block->native = (int (*)(struct ARMCore*)) (void*) e.code;
+	jit->used += (e.offset + 15) & ~15;
+}
@@ -121,7 +121,7 @@ uint32_t _lookupEntry15(void* vram, uint32_t offset) {
 	return mColorFrom555(((uint16_t*) vram)[offset]);
 }
 
-void mBitmapCacheCleanRow(struct mBitmapCache* cache, struct mBitmapCacheEntry* entry, unsigned y) {
+bool mBitmapCacheCleanRow(struct mBitmapCache* cache, struct mBitmapCacheEntry* entry, unsigned y) {
 	mColor* row = &cache->cache[(cache->buffer * mBitmapCacheSystemInfoGetHeight(cache->sysConfig) + y) * mBitmapCacheSystemInfoGetWidth(cache->sysConfig)];
 	size_t location = cache->buffer + mBitmapCacheSystemInfoGetBuffers(cache->sysConfig) * y;
 	struct mBitmapCacheEntry* status = &cache->status[location];
@@ -136,7 +136,7 @@ void mBitmapCacheCleanRow(struct mBitmapCache* cache, struct mBitmapCacheEntry*
 	}
 
 	if (!mBitmapCacheConfigurationIsShouldStore(cache->config) || !memcmp(status, &desiredStatus, sizeof(*entry))) {
-		return;
+		return false;
 	}
 
 	size_t offset = y * mBitmapCacheSystemInfoGetWidth(cache->sysConfig);
@@ -168,6 +168,7 @@ void mBitmapCacheCleanRow(struct mBitmapCache* cache, struct mBitmapCacheEntry*
 		}
 	}
 	*status = desiredStatus;
+	return true;
 }
 
 bool mBitmapCacheCheckRow(struct mBitmapCache* cache, const struct mBitmapCacheEntry* entry, unsigned y) {
@@ -45,6 +45,34 @@ void mCacheSetDeinit(struct mCacheSet* cache) {
 	mTileCacheSetDeinit(&cache->tiles);
 }
 
+size_t mCacheSetMemoryUsage(const struct mCacheSet* cache) {
+	size_t usage = 0;
+	size_t i;
+	for (i = 0; i < mMapCacheSetSize(&cache->maps); ++i) {
+		const struct mMapCache* mapCache = mMapCacheSetGetConstPointer(&cache->maps, i);
+		if (mapCache->cache) {
+			size_t tiles = mMapCacheTileCount(mapCache);
+			usage += 8 * 8 * sizeof(mColor) * tiles + tiles * sizeof(*mapCache->status);
+		}
+	}
+	for (i = 0; i < mBitmapCacheSetSize(&cache->bitmaps); ++i) {
+		const struct mBitmapCache* bitmapCache = mBitmapCacheSetGetConstPointer(&cache->bitmaps, i);
+		if (bitmapCache->cache) {
+			size_t size = mBitmapCacheSystemInfoGetHeight(bitmapCache->sysConfig) * mBitmapCacheSystemInfoGetBuffers(bitmapCache->sysConfig);
+			usage += mBitmapCacheSystemInfoGetWidth(bitmapCache->sysConfig) * size * sizeof(mColor) + size * sizeof(*bitmapCache->status);
+		}
+	}
+	for (i = 0; i < mTileCacheSetSize(&cache->tiles); ++i) {
+		const struct mTileCache* tileCache = mTileCacheSetGetConstPointer(&cache->tiles, i);
+		if (tileCache->cache) {
+			size_t size = 1 << mTileCacheSystemInfoGetPaletteCount(tileCache->sysConfig);
+			size_t tiles = mTileCacheSystemInfoGetMaxTiles(tileCache->sysConfig);
+			usage += (8 * 8 * sizeof(mColor) + sizeof(*tileCache->status)) * tiles * size;
+		}
+	}
+	return usage;
+}
+
 void mCacheSetAssignVRAM(struct mCacheSet* cache, void* vram) {
 	size_t i;
 	for (i = 0; i < mMapCacheSetSize(&cache->maps); ++i) {
@@ -6,6 +6,7 @@
 #include <mgba/core/cheats.h>
 
 #include <mgba/core/core.h>
+#include <mgba/core/serialize.h>
 #include <mgba-util/string.h>
 #include <mgba-util/vfs.h>
 
@@ -26,6 +27,26 @@ struct mCheatPatchedMem {
 	bool dirty;
 };
 
+// One compiled cheat. Everything that doesn't depend on memory contents is worked out
+// up front; host is set when every address the cheat touches is in directly mapped memory.
+struct mCheatPlanOp {
+	enum mCheatType type;
+	int width;
+	uint32_t address;
+	int32_t operand;
+	uint32_t repeat;
+	int32_t addressOffset;
+	int32_t operandOffset;
+	int conditionRemaining;
+	int negativeConditionRemaining;
+	bool conditional;
+
+	uint8_t* host;
+	uint32_t hostOffset;
+	uint32_t* dirtyPages;
+	const uint32_t* dirtyGeneration;
+};
+
 static uint32_t _patchMakeKey(struct mCheatPatch* patch) {
 	// NB: This assumes patches have only one valid size per platform
 	uint32_t patchKey = patch->address;
@@ -171,6 +192,7 @@ void mCheatDeviceCreate(struct mCheatDevice* device) {
 	device->d.id = M_CHEAT_DEVICE_ID;
 	device->d.init = mCheatDeviceInit;
 	device->d.deinit = mCheatDeviceDeinit;
+	device->mapMemory = NULL;
 	device->autosave = false;
 	device->buttonDown = false;
 	mCheatSetsInit(&device->cheats, 4);
@@ -197,6 +219,9 @@ void mCheatSetInit(struct mCheatSet* set, const char* name) {
 	mCheatListInit(&set->list, 4);
 	StringListInit(&set->lines, 4);
 	mCheatPatchListInit(&set->romPatches, 4);
+	mCheatListInit(&set->planSource, 0);
+	set->plan = NULL;
+	set->planValid = false;
 	if (name) {
 		set->name = strdup(name);
 	} else {
@@ -216,6 +241,8 @@ void mCheatSetDeinit(struct mCheatSet* set) {
 	}
 	StringListDeinit(&set->lines);
 	mCheatPatchListDeinit(&set->romPatches);
+	mCheatListDeinit(&set->planSource);
+	free(set->plan);
 	if (set->deinit) {
 		set->deinit(set);
 	}
@@ -242,6 +269,7 @@ bool mCheatAddLine(struct mCheatSet* set, const char* line, int type) {
 
 void mCheatAddSet(struct mCheatDevice* device, struct mCheatSet* cheats) {
 	*mCheatSetsAppend(&device->cheats) = cheats;
+	cheats->planValid = false;
 	if (cheats->add) {
 		cheats->add(cheats, device);
 	}
@@ -639,142 +667,253 @@ void mCheatAutosave(struct mCheatDevice* device) {
 }
 #endif
 
-void mCheatRefresh(struct mCheatDevice* device, struct mCheatSet* cheats) {
-	if (cheats->enabled) {
-		_patchROM(device, cheats);
+static bool _isConditional(enum mCheatType type) {
+	switch (type) {
+	case CHEAT_ASSIGN:
+	case CHEAT_ASSIGN_INDIRECT:
+	case CHEAT_AND:
+	case CHEAT_ADD:
+	case CHEAT_OR:
+		return false;
+	default:
+		return true;
 	}
-	if (cheats->refresh) {
-		cheats->refresh(cheats, device);
+}
+
+static void _mapPlanOp(struct mCheatDevice* device, struct mCheatPlanOp* op) {
+	op->host = NULL;
+	if (!device->mapMemory || !op->repeat || op->type == CHEAT_ASSIGN_INDIRECT) {
+		return;
 	}
-	if (!cheats->enabled) {
-		_unpatchROM(device, cheats);
+	if (op->width != 1 && op->width != 2 && op->width != 4) {
 		return;
 	}
+	// Misaligned bus accesses get rotated or aligned down, so leave those to the bus
+	uint32_t repeat = op->conditional ? 1 : op->repeat;
+	if ((op->address | (uint32_t) op->addressOffset) & (op->width - 1)) {
+		return;
+	}
+	struct mCheatMemoryMap first;
+	struct mCheatMemoryMap last;
+	int64_t span = (int64_t) (repeat - 1) * op->addressOffset;
+	if (!device->mapMemory(device, op->address, &first) || !device->mapMemory(device, op->address + (uint32_t) span, &last)) {
+		return;
+	}
+	// Every address in between has to land in the same stretch, without wrapping around a mirror
+	if (first.base != last.base || (int64_t) last.offset - first.offset != span) {
+		return;
+	}
+	if (first.offset + op->width > first.size || last.offset + op->width > last.size) {
+		return;
+	}
+	op->host = first.base;
+	op->hostOffset = first.offset;
+	op->dirtyPages = first.dirtyPages;
+	op->dirtyGeneration = first.dirtyGeneration;
+}
 
-	size_t elseLoc = 0;
-	size_t endLoc = 0;
+static void _compilePlan(struct mCheatDevice* device, struct mCheatSet* cheats) {
 	size_t nCodes = mCheatListSize(&cheats->list);
+	free(cheats->plan);
+	cheats->plan = nCodes ? malloc(nCodes * sizeof(*cheats->plan)) : NULL;
+	mCheatListClear(&cheats->planSource);
+	if (nCodes) {
+		mCheatListResize(&cheats->planSource, nCodes);
+		memcpy(mCheatListGetPointer(&cheats->planSource, 0), mCheatListGetConstPointer(&cheats->list, 0), nCodes * sizeof(struct mCheat));
+	}
+
 	size_t i;
 	for (i = 0; i < nCodes; ++i) {
-		struct mCheat* cheat = mCheatListGetPointer(&cheats->list, i);
-		int32_t value = 0;
-		int32_t operand = cheat->operand;
-		uint32_t operationsRemaining = cheat->repeat;
-		uint32_t address = cheat->address;
-		bool performAssignment = false;
-		bool condition = true;
-		int conditionRemaining = 0;
-		int negativeConditionRemaining = 0;
+		const struct mCheat* cheat = mCheatListGetConstPointer(&cheats->list, i);
+		struct mCheatPlanOp* op = &cheats->plan[i];
+		op->type = cheat->type;
+		op->width = cheat->width;
+		op->address = cheat->address;
+		op->operand = cheat->operand;
+		op->repeat = cheat->repeat;
+		op->addressOffset = cheat->addressOffset;
+		op->operandOffset = cheat->operandOffset;
+		op->conditional = _isConditional(cheat->type);
+		// A cheat that never runs leaves the skip counts at zero
+		if (op->conditional && op->repeat) {
+			op->conditionRemaining = cheat->repeat;
+			op->negativeConditionRemaining = cheat->negativeRepeat;
+		} else {
+			op->conditionRemaining = 0;
+			op->negativeConditionRemaining = 0;
+		}
+		_mapPlanOp(device, op);
+	}
+	cheats->planValid = true;
+}
 
-		for (; operationsRemaining; --operationsRemaining) {
-			switch (cheat->type) {
-			case CHEAT_ASSIGN:
-				value = operand;
-				performAssignment = true;
-				break;
-			case CHEAT_ASSIGN_INDIRECT:
-				value = operand;
-				address = _readMem(device->p, address, 4) + cheat->addressOffset;
-				performAssignment = true;
-				break;
+static bool _planIsCurrent(const struct mCheatSet* cheats) {
+	if (!cheats->planValid) {
+		return false;
+	}
+	size_t nCodes = mCheatListSize(&cheats->list);
+	if (nCodes != mCheatListSize(&cheats->planSource)) {
+		return false;
+	}
+	if (!nCodes) {
+		return true;
+	}
+	return !memcmp(mCheatListGetConstPointer(&cheats->list, 0), mCheatListGetConstPointer(&cheats->planSource, 0), nCodes * sizeof(struct mCheat));
+}
+
+static inline int32_t _readHost(const struct mCheatPlanOp* op, uint32_t offset) {
+	uint16_t value16;
+	uint32_t value32;
+	switch (op->width) {
+	case 1:
+		return op->host[offset];
+	case 2:
+		LOAD_16LE(value16, offset, op->host);
+		return value16;
+	default:
+		LOAD_32LE(value32, offset, op->host);
+		return value32;
+	}
+}
+
+static inline void _writeHost(const struct mCheatPlanOp* op, uint32_t offset, int32_t value) {
+	switch (op->width) {
+	case 1:
+		op->host[offset] = value;
+		break;
+	case 2:
+		STORE_16LE((uint16_t) value, offset, op->host);
+		break;
+	default:
+		STORE_32LE((uint32_t) value, offset, op->host);
+		break;
+	}
+	if (op->dirtyPages) {
+		op->dirtyPages[offset >> mSTATE_PAGE_SHIFT] = *op->dirtyGeneration;
+	}
+}
+
+static bool _testCondition(struct mCheatDevice* device, const struct mCheatPlanOp* op) {
+	int32_t value = 0;
+	if (op->type != CHEAT_IF_BUTTON && op->type != CHEAT_NEVER) {
+		value = op->host ? _readHost(op, op->hostOffset) : _readMem(device->p, op->address, op->width);
+	}
+	switch (op->type) {
+	case CHEAT_IF_EQ:
+		return value == op->operand;
+	case CHEAT_IF_NE:
+		return value != op->operand;
+	case CHEAT_IF_LT:
+		return value < op->operand;
+	case CHEAT_IF_GT:
+		return value > op->operand;
+	case CHEAT_IF_ULT:
+		return (uint32_t) value < (uint32_t) op->operand;
+	case CHEAT_IF_UGT:
+		return (uint32_t) value > (uint32_t) op->operand;
+	case CHEAT_IF_AND:
+		return value & op->operand;
+	case CHEAT_IF_LAND:
+		return value && op->operand;
+	case CHEAT_IF_NAND:
+		return !(value & op->operand);
+	case CHEAT_IF_BUTTON:
+		return device->buttonDown;
+	default:
+		return false;
+	}
+}
+
+static void _runAssignment(struct mCheatDevice* device, const struct mCheatPlanOp* op) {
+	int32_t operand = op->operand;
+	uint32_t address = op->address;
+	uint32_t offset = op->hostOffset;
+	uint32_t operationsRemaining;
+	for (operationsRemaining = op->repeat; operationsRemaining; --operationsRemaining) {
+		int32_t value;
+		if (op->host) {
+			switch (op->type) {
 			case CHEAT_AND:
-				value = _readMem(device->p, address, cheat->width) & operand;
-				performAssignment = true;
+				value = _readHost(op, offset) & operand;
 				break;
 			case CHEAT_ADD:
-				value = _readMem(device->p, address, cheat->width) + operand;
-				performAssignment = true;
+				value = _readHost(op, offset) + operand;
 				break;
 			case CHEAT_OR:
-				value = _readMem(device->p, address, cheat->width) | operand;
-				performAssignment = true;
-				break;
-			case CHEAT_IF_EQ:
-				condition = _readMem(device->p, address, cheat->width) == operand;
-				conditionRemaining = cheat->repeat;
-				negativeConditionRemaining = cheat->negativeRepeat;
-				operationsRemaining = 1;
-				break;
-			case CHEAT_IF_NE:
-				condition = _readMem(device->p, address, cheat->width) != operand;
-				conditionRemaining = cheat->repeat;
-				negativeConditionRemaining = cheat->negativeRepeat;
-				operationsRemaining = 1;
-				break;
-			case CHEAT_IF_LT:
-				condition = _readMem(device->p, address, cheat->width) < operand;
-				conditionRemaining = cheat->repeat;
-				negativeConditionRemaining = cheat->negativeRepeat;
-				operationsRemaining = 1;
+				value = _readHost(op, offset) | operand;
 				break;
-			case CHEAT_IF_GT:
-				condition = _readMem(device->p, address, cheat->width) > operand;
-				conditionRemaining = cheat->repeat;
-				negativeConditionRemaining = cheat->negativeRepeat;
-				operationsRemaining = 1;
-				break;
-			case CHEAT_IF_ULT:
-				condition = (uint32_t) _readMem(device->p, address, cheat->width) < (uint32_t) operand;
-				conditionRemaining = cheat->repeat;
-				negativeConditionRemaining = cheat->negativeRepeat;
-				operationsRemaining = 1;
-				break;
-			case CHEAT_IF_UGT:
-				condition = (uint32_t) _readMem(device->p, address, cheat->width) > (uint32_t) operand;
-				conditionRemaining = cheat->repeat;
-				negativeConditionRemaining = cheat->negativeRepeat;
-				operationsRemaining = 1;
+			default:
+				value = operand;
 				break;
-			case CHEAT_IF_AND:
-				condition = _readMem(device->p, address, cheat->width) & operand;
-				conditionRemaining = cheat->repeat;
-				negativeConditionRemaining = cheat->negativeRepeat;
-				operationsRemaining = 1;
+			}
+			_writeHost(op, offset, value);
+			offset += op->addressOffset;
+		} else {
+			switch (op->type) {
+			case CHEAT_ASSIGN_INDIRECT:
+				value = operand;
+				address = _readMem(device->p, address, 4) + op->addressOffset;
 				break;
-			case CHEAT_IF_LAND:
-				condition = _readMem(device->p, address, cheat->width) && operand;
-				conditionRemaining = cheat->repeat;
-				negativeConditionRemaining = cheat->negativeRepeat;
-				operationsRemaining = 1;
+			case CHEAT_AND:
+				value = _readMem(device->p, address, op->width) & operand;
 				break;
-			case CHEAT_IF_NAND:
-				condition = !(_readMem(device->p, address, cheat->width) & operand);
-				conditionRemaining = cheat->repeat;
-				negativeConditionRemaining = cheat->negativeRepeat;
-				operationsRemaining = 1;
+			case CHEAT_ADD:
+				value = _readMem(device->p, address, op->width) + operand;
 				break;
-			case CHEAT_IF_BUTTON:
-				condition = device->buttonDown;
-				conditionRemaining = cheat->repeat;
-				negativeConditionRemaining = cheat->negativeRepeat;
-				operationsRemaining = 1;
+			case CHEAT_OR:
+				value = _readMem(device->p, address, op->width) | operand;
 				break;
-			case CHEAT_NEVER:
-				condition = false;
-				conditionRemaining = cheat->repeat;
-				negativeConditionRemaining = cheat->negativeRepeat;
-				operationsRemaining = 1;
+			default:
+				value = operand;
 				break;
 			}
+			_writeMem(device->p, address, op->width, value);
+			address += op->addressOffset;
+		}
+		operand += op->operandOffset;
+	}
+}
 
-			if (performAssignment) {
-				_writeMem(device->p, address, cheat->width, value);
-			}
+void mCheatRefresh(struct mCheatDevice* device, struct mCheatSet* cheats) {
+	if (cheats->enabled) {
+		_patchROM(device, cheats);
+	}
+	if (cheats->refresh) {
+		cheats->refresh(cheats, device);
+	}
+	if (!cheats->enabled) {
+		_unpatchROM(device, cheats);
+		return;
+	}
 
-			address += cheat->addressOffset;
-			operand += cheat->operandOffset;
-		}
+	if (!_planIsCurrent(cheats)) {
+		_compilePlan(device, cheats);
+	}
 
+	size_t elseLoc = 0;
+	size_t endLoc = 0;
+	size_t nCodes = mCheatListSize(&cheats->planSource);
+	size_t i;
+	for (i = 0; i < nCodes; ++i) {
+		const struct mCheatPlanOp* op = &cheats->plan[i];
+		bool condition = true;
+		if (op->conditional) {
+			if (op->repeat) {
+				condition = _testCondition(device, op);
+			}
+		} else {
+			_runAssignment(device, op);
+		}
 
 		if (elseLoc && i == elseLoc) {
 			i = endLoc;
 			endLoc = 0;
 		}
-		if (conditionRemaining > 0 && !condition) {
-			i += conditionRemaining;
-		} else if (negativeConditionRemaining > 0) {
-			elseLoc = i + conditionRemaining;
-			endLoc = elseLoc + negativeConditionRemaining;
+		if (op->conditionRemaining > 0 && !condition) {
+			i += op->conditionRemaining;
+		} else if (op->negativeConditionRemaining > 0) {
+			elseLoc = i + op->conditionRemaining;
+			endLoc = elseLoc + op->negativeConditionRemaining;
 		}
 	}
 }
@@ -783,12 +922,33 @@ void mCheatPressButton(struct mCheatDevice* device, bool down) {
 	device->buttonDown = down;
 }
 
+size_t mCheatDeviceMemoryUsage(const struct mCheatDevice* device) {
+	size_t usage = sizeof(*device) + device->cheats.capacity * sizeof(struct mCheatSet*);
+	size_t i;
+	for (i = 0; i < mCheatSetsSize(&device->cheats); ++i) {
+		const struct mCheatSet* cheats = *mCheatSetsGetConstPointer(&device->cheats, i);
+		usage += sizeof(*cheats);
+		usage += (cheats->list.capacity + cheats->planSource.capacity) * sizeof(struct mCheat);
+		usage += cheats->romPatches.capacity * sizeof(struct mCheatPatch);
+		usage += cheats->lines.capacity * sizeof(char*);
+		if (cheats->plan) {
+			usage += mCheatListSize(&cheats->planSource) * sizeof(*cheats->plan);
+		}
+		size_t j;
+		for (j = 0; j < StringListSize(&cheats->lines); ++j) {
+			usage += strlen(*StringListGetConstPointer(&cheats->lines, j)) + 1;
+		}
+	}
+	return usage;
+}
+
 void mCheatDeviceInit(void* cpu, struct mCPUComponent* component) {
 	UNUSED(cpu);
 	struct mCheatDevice* device = (struct mCheatDevice*) component;
 	size_t i;
 	for (i = 0; i < mCheatSetsSize(&device->cheats); ++i) {
 		struct mCheatSet* cheats = *mCheatSetsGetPointer(&device->cheats, i);
+		cheats->planValid = false;
 		if (cheats->add) {
 			cheats->add(cheats, device);
 		}
@@ -0,0 +1,341 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/checksum-cache.h>
+
+#include <mgba/core/config.h>
+#include <mgba/core/log.h>
+#include <mgba-util/configuration.h>
+#include <mgba-util/crc32.h>
+#include <mgba-util/md5.h>
+#include <mgba-util/sha1.h>
+#include <mgba-util/string.h>
+#include <mgba-util/threading.h>
+#include <mgba-util/vector.h>
+#include <mgba-util/vfs.h>
+
+#include <sys/stat.h>
+
+#define CHECKSUM_CACHE_FILE "checksums.ini"
+
+mLOG_DEFINE_CATEGORY(CHECKSUM_CACHE, "Checksum cache", "core.checksum-cache");
+
+struct mChecksumCacheFile {
+	int64_t size;
+	int64_t mtime;
+};
+
+static bool _enabled = false;
+static Mutex _mutex;
+static struct Configuration _index;
+static char _indexPath[PATH_MAX + 1];
+static bool _dirty;
+
+#ifndef DISABLE_THREADING
+static Thread _thread;
+static Condition _jobAvailable;
+static struct StringList _jobs;
+static bool _threadRunning;
+static bool _stopping;
+
+static THREAD_ENTRY _hashThread(void* context);
+#endif
+
+static bool _statFile(const char* path, struct mChecksumCacheFile* file) {
+#ifdef _WIN32
+	wchar_t wpath[PATH_MAX];
+	MultiByteToWideChar(CP_UTF8, 0, path, -1, wpath, sizeof(wpath) / sizeof(*wpath));
+	struct _stat64 st;
+	if (_wstat64(wpath, &st) < 0) {
+		return false;
+	}
+#else
+	struct stat st;
+	if (stat(path, &st) < 0) {
+		return false;
+	}
+#endif
+	file->size = st.st_size;
+	file->mtime = st.st_mtime;
+	return true;
+}
+
+static void _sectionName(const char* path, char* section, size_t size) {
+	// Paths can contain characters that can't go in a section name, so they're keyed by a
+	// hash of the path instead and the path itself is stored alongside to check against
+	snprintf(section, size, "%08X", doCrc32(path, strlen(path)));
+}
+
+static bool _parseHex(const char* value, uint8_t* out, size_t size) {
+	if (!value || strlen(value) != size * 2) {
+		return false;
+	}
+	size_t i;
+	for (i = 0; i < size; ++i) {
+		value = hex8(value, &out[i]);
+		if (!value) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void _formatHex(char* out, const uint8_t* data, size_t size) {
+	size_t i;
+	for (i = 0; i < size; ++i) {
+		snprintf(&out[i * 2], 3, "%02x", data[i]);
+	}
+}
+
+static bool _readEntry(const char* section, const char* path, const struct mChecksumCacheFile* file, struct mChecksumCacheEntry* entry) {
+	memset(entry, 0, sizeof(*entry));
+	const char* value = ConfigurationGetValue(&_index, section, "path");
+	if (!value || strcmp(value, path) != 0) {
+		return false;
+	}
+	value = ConfigurationGetValue(&_index, section, "size");
+	if (!value || strtoll(value, NULL, 10) != file->size) {
+		return false;
+	}
+	value = ConfigurationGetValue(&_index, section, "mtime");
+	if (!value || strtoll(value, NULL, 10) != file->mtime) {
+		return false;
+	}
+
+	uint32_t crc32;
+	value = ConfigurationGetValue(&_index, section, "crc32");
+	if (value && strlen(value) == 8 && hex32(value, &crc32)) {
+		entry->crc32 = crc32;
+		entry->known |= 1 << mCHECKSUM_CRC32;
+	}
+	if (_parseHex(ConfigurationGetValue(&_index, section, "md5"), entry->md5, sizeof(entry->md5))) {
+		entry->known |= 1 << mCHECKSUM_MD5;
+	}
+	if (_parseHex(ConfigurationGetValue(&_index, section, "sha1"), entry->sha1, sizeof(entry->sha1))) {
+		entry->known |= 1 << mCHECKSUM_SHA1;
+	}
+	return entry->known != 0;
+}
+
+static void _storeEntry(const char* path, const struct mChecksumCacheFile* file, const struct mChecksumCacheEntry* entry) {
+	char section[16];
+	_sectionName(path, section, sizeof(section));
+
+	MutexLock(&_mutex);
+	struct mChecksumCacheEntry merged;
+	_readEntry(section, path, file, &merged);
+	if ((merged.known | entry->known) == merged.known) {
+		MutexUnlock(&_mutex);
+		return;
+	}
+	if (entry->known & (1 << mCHECKSUM_CRC32)) {
+		merged.crc32 = entry->crc32;
+	}
+	if (entry->known & (1 << mCHECKSUM_MD5)) {
+		memcpy(merged.md5, entry->md5, sizeof(merged.md5));
+	}
+	if (entry->known & (1 << mCHECKSUM_SHA1)) {
+		memcpy(merged.sha1, entry->sha1, sizeof(merged.sha1));
+	}
+	merged.known |= entry->known;
+
+	char value[sizeof(merged.sha1) * 2 + 1];
+	ConfigurationSetValue(&_index, section, "path", path);
+	snprintf(value, sizeof(value), "%" PRId64, file->size);
+	ConfigurationSetValue(&_index, section, "size", value);
+	snprintf(value, sizeof(value), "%" PRId64, file->mtime);
+	ConfigurationSetValue(&_index, section, "mtime", value);
+	if (merged.known & (1 << mCHECKSUM_CRC32)) {
+		snprintf(value, sizeof(value), "%08X", merged.crc32);
+		ConfigurationSetValue(&_index, section, "crc32", value);
+	} else {
+		ConfigurationClearValue(&_index, section, "crc32");
+	}
+	if (merged.known & (1 << mCHECKSUM_MD5)) {
+		_formatHex(value, merged.md5, sizeof(merged.md5));
+		ConfigurationSetValue(&_index, section, "md5", value);
+	} else {
+		ConfigurationClearValue(&_index, section, "md5");
+	}
+	if (merged.known & (1 << mCHECKSUM_SHA1)) {
+		_formatHex(value, merged.sha1, sizeof(merged.sha1));
+		ConfigurationSetValue(&_index, section, "sha1", value);
+	} else {
+		ConfigurationClearValue(&_index, section, "sha1");
+	}
+	_dirty = true;
+	MutexUnlock(&_mutex);
+}
+
+void mChecksumCacheInit(void) {
+	if (_enabled) {
+		return;
+	}
+	MutexInit(&_mutex);
+	ConfigurationInit(&_index);
+	mCoreConfigDirectory(_indexPath, PATH_MAX);
+	strncat(_indexPath, PATH_SEP CHECKSUM_CACHE_FILE, PATH_MAX - strlen(_indexPath));
+	ConfigurationRead(&_index, _indexPath);
+	_dirty = false;
+#ifndef DISABLE_THREADING
+	ConditionInit(&_jobAvailable);
+	StringListInit(&_jobs, 0);
+	_threadRunning = false;
+	_stopping = false;
+#endif
+	_enabled = true;
+}
+
+void mChecksumCacheDeinit(void) {
+	if (!_enabled) {
+		return;
+	}
+#ifndef DISABLE_THREADING
+	MutexLock(&_mutex);
+	_stopping = true;
+	ConditionWake(&_jobAvailable);
+	MutexUnlock(&_mutex);
+	if (_threadRunning) {
+		ThreadJoin(&_thread);
+		_threadRunning = false;
+	}
+	size_t i;
+	for (i = 0; i < StringListSize(&_jobs); ++i) {
+		free(*StringListGetPointer(&_jobs, i));
+	}
+	StringListDeinit(&_jobs);
+	ConditionDeinit(&_jobAvailable);
+#endif
+	mChecksumCacheSync();
+	_enabled = false;
+	ConfigurationDeinit(&_index);
+	MutexDeinit(&_mutex);
+}
+
+bool mChecksumCacheIsEnabled(void) {
+	return _enabled;
+}
+
+bool mChecksumCacheLookup(const char* path, struct mChecksumCacheEntry* entry) {
+	memset(entry, 0, sizeof(*entry));
+	if (!_enabled) {
+		return false;
+	}
+	struct mChecksumCacheFile file;
+	if (!_statFile(path, &file)) {
+		return false;
+	}
+	char section[16];
+	_sectionName(path, section, sizeof(section));
+	MutexLock(&_mutex);
+	bool found = _readEntry(section, path, &file, entry);
+	MutexUnlock(&_mutex);
+	return found;
+}
+
+void mChecksumCacheStore(const char* path, const struct mChecksumCacheEntry* entry) {
+	if (!_enabled || !entry->known) {
+		return;
+	}
+	struct mChecksumCacheFile file;
+	if (_statFile(path, &file)) {
+		_storeEntry(path, &file, entry);
+	}
+}
+
+bool mChecksumCacheSync(void) {
+	if (!_enabled) {
+		return false;
+	}
+	bool success = true;
+	MutexLock(&_mutex);
+	if (_dirty) {
+		success = ConfigurationWrite(&_index, _indexPath);
+		if (success) {
+			_dirty = false;
+		} else {
+			mLOG(CHECKSUM_CACHE, WARN, "Could not write checksum cache to %s", _indexPath);
+		}
+	}
+	MutexUnlock(&_mutex);
+	return success;
+}
+
+#ifndef DISABLE_THREADING
+static void _hashFile(const char* path) {
+	struct mChecksumCacheFile file;
+	if (!_statFile(path, &file)) {
+		return;
+	}
+	struct mChecksumCacheEntry entry;
+	mChecksumCacheLookup(path, &entry);
+	if (entry.known == mCHECKSUM_CACHE_ALL) {
+		return;
+	}
+	struct VFile* vf = VFileOpen(path, O_RDONLY);
+	if (!vf) {
+		return;
+	}
+	unsigned missing = mCHECKSUM_CACHE_ALL & ~entry.known;
+	if (missing & (1 << mCHECKSUM_CRC32)) {
+		entry.crc32 = fileCrc32(vf, vf->size(vf));
+	}
+	if ((missing & (1 << mCHECKSUM_MD5)) && !md5File(vf, entry.md5)) {
+		missing &= ~(1 << mCHECKSUM_MD5);
+	}
+	if ((missing & (1 << mCHECKSUM_SHA1)) && !sha1File(vf, entry.sha1)) {
+		missing &= ~(1 << mCHECKSUM_SHA1);
+	}
+	vf->close(vf);
+
+	// If the file changed while it was being read, what was read can't be trusted
+	struct mChecksumCacheFile after;
+	if (!_statFile(path, &after) || after.size != file.size || after.mtime != file.mtime) {
+		return;
+	}
+	entry.known = missing;
+	_storeEntry(path, &file, &entry);
+}
+
+static THREAD_ENTRY _hashThread(void* context) {
+	UNUSED(context);
+	ThreadSetName("Checksum Cache");
+	MutexLock(&_mutex);
+	while (!_stopping) {
+		if (!StringListSize(&_jobs)) {
+			ConditionWait(&_jobAvailable, &_mutex);
+			continue;
+		}
+		char* path = *StringListGetPointer(&_jobs, 0);
+		StringListShift(&_jobs, 0, 1);
+		MutexUnlock(&_mutex);
+
+		_hashFile(path);
+		free(path);
+		mChecksumCacheSync();
+
+		MutexLock(&_mutex);
+	}
+	MutexUnlock(&_mutex);
+	THREAD_EXIT(0);
+}
+#endif
+
+void mChecksumCacheHashInBackground(const char* path) {
+#ifndef DISABLE_THREADING
+	if (!_enabled) {
+		return;
+	}
+	MutexLock(&_mutex);
+	*StringListAppend(&_jobs) = strdup(path);
+	if (!_threadRunning) {
+		_threadRunning = ThreadCreate(&_thread, _hashThread, NULL) == 0;
+	}
+	ConditionWake(&_jobAvailable);
+	MutexUnlock(&_mutex);
+#else
+	UNUSED(path);
+#endif
+}
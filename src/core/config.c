@@ -8,6 +8,7 @@
 #include <mgba/core/version.h>
 #include <mgba-util/formatting.h>
 #include <mgba-util/string.h>
+#include <mgba-util/threading.h>
 #include <mgba-util/vfs.h>
 
 #include <sys/stat.h>
@@ -442,6 +443,7 @@ void mCoreConfigMap(const struct mCoreConfig* config, struct mCoreOptions* opts)
 	_lookupIntValue(config, "volume", &opts->volume);
 	_lookupIntValue(config, "rewindBufferCapacity", &opts->rewindBufferCapacity);
 	_lookupIntValue(config, "rewindBufferInterval", &opts->rewindBufferInterval);
+	_lookupIntValue(config, "runAhead", &opts->runAhead);
 	_lookupFloatValue(config, "fpsTarget", &opts->fpsTarget);
 	unsigned audioBuffers;
 	if (_lookupUIntValue(config, "audioBuffers", &audioBuffers)) {
@@ -475,6 +477,30 @@ void mCoreConfigMap(const struct mCoreConfig* config, struct mCoreOptions* opts)
 	_lookupCharValue(config, "cheatsPath", &opts->cheatsPath);
 }
 
+void mCoreConfigGetThreadPolicy(const struct mCoreConfig* config, struct ThreadPolicy* policy) {
+	policy->priority = THREAD_PRIO_NORMAL;
+	policy->affinity = 0;
+
+	const char* priority = _lookupValue(config, "threadPriority");
+	if (priority) {
+		if (strcasecmp(priority, "low") == 0) {
+			policy->priority = THREAD_PRIO_LOW;
+		} else if (strcasecmp(priority, "high") == 0) {
+			policy->priority = THREAD_PRIO_HIGH;
+		}
+		// Realtime isn't accepted here, since the emulation thread can spin in the frame limiter
+	}
+
+	const char* affinity = _lookupValue(config, "threadAffinity");
+	if (affinity) {
+		char* end;
+		unsigned long long value = strtoull(affinity, &end, 0);
+		if (!*end) {
+			policy->affinity = value;
+		}
+	}
+}
+
 void mCoreConfigLoadDefaults(struct mCoreConfig* config, const struct mCoreOptions* opts) {
 	ConfigurationSetValue(&config->defaultsTable, 0, "bios", opts->bios);
 	ConfigurationSetValue(&config->defaultsTable, 0, "shader", opts->shader);
@@ -485,6 +511,7 @@ void mCoreConfigLoadDefaults(struct mCoreConfig* config, const struct mCoreOptio
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "rewindEnable", opts->rewindEnable);
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "rewindBufferCapacity", opts->rewindBufferCapacity);
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "rewindBufferInterval", opts->rewindBufferInterval);
+	ConfigurationSetIntValue(&config->defaultsTable, 0, "runAhead", opts->runAhead);
 	ConfigurationSetFloatValue(&config->defaultsTable, 0, "fpsTarget", opts->fpsTarget);
 	ConfigurationSetUIntValue(&config->defaultsTable, 0, "audioBuffers", opts->audioBuffers);
 	ConfigurationSetUIntValue(&config->defaultsTable, 0, "sampleRate", opts->sampleRate);
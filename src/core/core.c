@@ -6,8 +6,13 @@
 #include <mgba/core/core.h>
 
 #include <mgba/core/cheats.h>
+#include <mgba/core/checksum-cache.h>
 #include <mgba/core/log.h>
 #include <mgba/core/serialize.h>
+#include <mgba/core/state-thumbnail.h>
+#include <mgba-util/audio-buffer.h>
+#include <mgba-util/image.h>
+#include <mgba-util/memory.h>
 #include <mgba-util/vfs.h>
 #include <mgba/internal/debugger/symbols.h>
 
@@ -31,6 +36,8 @@
 #include <mgba/feature/video-logger.h>
 #endif
 
+DEFINE_VECTOR(mCoreMemoryUsageList, struct mCoreMemoryUsage);
+
 static const struct mCoreFilter {
 	bool (*filter)(struct VFile*);
 	struct mCore* (*open)(void);
@@ -90,11 +97,130 @@ struct mCore* mCoreCreate(enum mPlatform platform) {
 	return NULL;
 }
 
+struct mCoreConfigCopy {
+	struct Configuration* table;
+	const char* section;
+};
+
+static void _copyConfigValue(const char* key, const char* value, void* user) {
+	struct mCoreConfigCopy* copy = user;
+	ConfigurationSetValue(copy->table, copy->section, key, value);
+}
+
+static void _copyConfigTable(struct Configuration* dest, const struct Configuration* src, const char* port) {
+	struct mCoreConfigCopy copy = { dest, NULL };
+	ConfigurationEnumerate(src, NULL, _copyConfigValue, &copy);
+	if (port) {
+		copy.section = port;
+		ConfigurationEnumerate(src, port, _copyConfigValue, &copy);
+	}
+}
+
+bool mCoreFork(struct mCore* core, struct mCore* target) {
+	if (!core->fork || target->platform(target) != core->platform(core)) {
+		return false;
+	}
+	if (!core->fork(core, target)) {
+		return false;
+	}
+
+	// A raw state is a flat copy of the hardware, without the extdata and
+	// compression that mCoreSaveStateNamed adds
+	size_t stateSize = core->stateSize(core);
+	void* state = anonymousMemoryMap(stateSize);
+	if (!state) {
+		return false;
+	}
+	bool success = core->saveState(core, state) && target->loadState(target, state);
+	mappedMemoryFree(state, stateSize);
+	if (success) {
+		target->setKeys(target, core->getKeys(core));
+	}
+	return success;
+}
+
+struct mCore* mCoreClone(struct mCore* core) {
+	struct mCore* clone = mCoreCreate(core->platform(core));
+	if (!clone) {
+		return NULL;
+	}
+	if (!clone->init(clone)) {
+		free(clone);
+		return NULL;
+	}
+	mCoreInitConfig(clone, core->config.port);
+	_copyConfigTable(&clone->config.defaultsTable, &core->config.defaultsTable, core->config.port);
+	_copyConfigTable(&clone->config.configTable, &core->config.configTable, core->config.port);
+	_copyConfigTable(&clone->config.overridesTable, &core->config.overridesTable, core->config.port);
+	mCoreLoadForeignConfig(clone, &clone->config);
+	if (!mCoreFork(core, clone)) {
+		mCoreConfigDeinit(&clone->config);
+		clone->deinit(clone);
+		return NULL;
+	}
+	return clone;
+}
+
+#if defined(ENABLE_VFS) || defined(USE_PNG)
+static const char* _screenshotFormat(struct mCore* core, int* compression) {
+	if (!mCoreConfigGetIntValue(&core->config, "screenshotCompression", compression) || *compression < -1 || *compression > 9) {
+		*compression = -1;
+	}
+#ifndef PSP2
+	const char* format = mCoreConfigGetValue(&core->config, "screenshotFormat");
+	if (format && strcasecmp(format, "qoi") == 0) {
+		return "qoi";
+	}
+	if (format && strcasecmp(format, "ppm") == 0) {
+		return "ppm";
+	}
+#endif
+#ifdef USE_PNG
+	return "png";
+#elif !defined(PSP2)
+	return "qoi";
+#else
+	return NULL;
+#endif
+}
+#endif
+
+#if (defined(ENABLE_VFS) && defined(ENABLE_DIRECTORIES)) || defined(USE_PNG)
+static bool _takeScreenshotVF(struct mCore* core, struct VFile* vf, const char* format, int compression) {
+	size_t stride;
+	const void* pixels = NULL;
+	unsigned width, height;
+	core->currentVideoSize(core, &width, &height);
+	core->getPixels(core, &pixels, &stride);
+	if (!pixels) {
+		return false;
+	}
+	struct mImage image = {
+		.data = (void*) pixels,
+		.width = width,
+		.height = height,
+		.stride = stride,
+		.depth = BYTES_PER_PIXEL,
+		.format = mCOLOR_NATIVE,
+	};
+	return mImageSaveVFCompressed(&image, vf, format, compression);
+}
+#endif
+
 #ifdef ENABLE_VFS
 #ifdef PSP2
 #include <psp2/photoexport.h>
 #endif
 
+static void _screenshotSavedAsync(bool success, void* context) {
+	UNUSED(context);
+	if (success) {
+		mLOG(STATUS, INFO, "Screenshot saved");
+	} else {
+		mLOG(STATUS, WARN, "Failed to take screenshot");
+	}
+}
+
 struct mCore* mCoreFind(const char* path) {
 	struct mCore* core = NULL;
 #if defined(ENABLE_VFS) && defined(ENABLE_DIRECTORIES)
@@ -137,23 +263,34 @@ bool mCoreLoadFile(struct mCore* core, const char* path) {
 	return mCorePreloadFile(core, path);
 #else
 #if defined(ENABLE_VFS) && defined(ENABLE_DIRECTORIES)
+	struct VDir* archive = core->dirs.archive;
 	struct VFile* rom = mDirectorySetOpenPath(&core->dirs, path, core->isROM);
+	// A ROM from inside an archive can't be identified by the archive's path
+	bool cacheChecksums = core->dirs.archive == archive;
 #else
 	struct VFile* rom = VFileOpen(path, O_RDONLY);
 	if (rom && !core->isROM(rom)) {
 		rom->close(rom);
 		rom = NULL;
 	}
+	bool cacheChecksums = true;
 #endif
 	if (!rom) {
 		return false;
 	}
 
-	bool ret = core->loadROM(core, rom);
-	if (!ret) {
+	cacheChecksums = cacheChecksums && core->setROMPath && mChecksumCacheIsEnabled();
+	if (cacheChecksums) {
+		core->setROMPath(core, path);
+	}
+	if (!core->loadROM(core, rom)) {
 		rom->close(rom);
+		return false;
 	}
-	return ret;
+	if (cacheChecksums) {
+		mChecksumCacheHashInBackground(path);
+	}
+	return true;
 #endif
 }
 
@@ -315,6 +452,9 @@ bool mCoreSaveState(struct mCore* core, int slot, int flags) {
 		return false;
 	}
 	bool success = mCoreSaveStateNamed(core, vf, flags);
+	if (success) {
+		mCoreStoreStateThumbnail(core, slot, flags, vf->size(vf));
+	}
 	vf->close(vf);
 	if (success) {
 		mLOG(STATUS, INFO, "State %i saved", slot);
@@ -325,6 +465,29 @@ bool mCoreSaveState(struct mCore* core, int slot, int flags) {
 	return success;
 }
 
+static void _stateSavedAsync(bool success, void* context) {
+	int slot = (intptr_t) context;
+	if (success) {
+		mLOG(STATUS, INFO, "State %i saved", slot);
+	} else {
+		mLOG(STATUS, INFO, "State %i failed to save", slot);
+	}
+}
+
+bool mCoreSaveStateAsync(struct mCore* core, struct mStateWriter* writer, int slot, int flags) {
+	struct VFile* vf = mCoreGetState(core, slot, true);
+	if (!vf) {
+		return false;
+	}
+	if (!mStateWriterSave(writer, core, vf, flags, _stateSavedAsync, (void*) (intptr_t) slot)) {
+		mLOG(STATUS, INFO, "State %i failed to save", slot);
+		return false;
+	}
+	// The frame has to be captured now, before the core moves on
+	mCoreStoreStateThumbnail(core, slot, flags, 0);
+	return true;
+}
+
 bool mCoreLoadState(struct mCore* core, int slot, int flags) {
 	struct VFile* vf = mCoreGetState(core, slot, false);
 	if (!vf) {
@@ -350,26 +513,36 @@ struct VFile* mCoreGetState(struct mCore* core, int slot, bool write) {
 	}
 	char name[PATH_MAX + 14]; // Quash warning
 	snprintf(name, sizeof(name), "%s.ss%i", core->dirs.baseName, slot);
-	return core->dirs.state->openFile(core->dirs.state, name, write ? (O_CREAT | O_TRUNC | O_RDWR) : O_RDONLY);
+	struct VFile* vf = core->dirs.state->openFile(core->dirs.state, name, write ? (O_CREAT | O_TRUNC | O_RDWR) : O_RDONLY);
+#if defined(__3DS__) || defined(PSP2) || defined(__SWITCH__)
+	// Savestates are read and written in many small pieces, which SD cards handle poorly
+	vf = VFileAsync(vf);
+#endif
+	return vf;
 }
 
 void mCoreDeleteState(struct mCore* core, int slot) {
 	char name[PATH_MAX + 14]; // Quash warning
 	snprintf(name, sizeof(name), "%s.ss%i", core->dirs.baseName, slot);
 	core->dirs.state->deleteFile(core->dirs.state, name);
+	mCoreInvalidateStateThumbnail(core, slot);
 }
 
 void mCoreTakeScreenshot(struct mCore* core) {
-#ifdef USE_PNG
-	struct VFile* vf;
+	int compression;
+	const char* format = _screenshotFormat(core, &compression);
+	if (format) {
+		struct VFile* vf;
 #ifndef PSP2
-	vf = VDirFindNextAvailable(core->dirs.screenshot, core->dirs.baseName, "-", ".png", O_CREAT | O_TRUNC | O_WRONLY);
+		char suffix[8];
+		snprintf(suffix, sizeof(suffix), ".%s", format);
+		vf = VDirFindNextAvailable(core->dirs.screenshot, core->dirs.baseName, "-", suffix, O_CREAT | O_TRUNC | O_WRONLY);
 #else
-	vf = VFileMemChunk(0, 0);
+		vf = VFileMemChunk(0, 0);
 #endif
-	bool success = false;
-	if (vf) {
-		success = mCoreTakeScreenshotVF(core, vf);
+		bool success = false;
+		if (vf) {
+			success = _takeScreenshotVF(core, vf, format, compression);
 #ifdef PSP2
 		void* data = vf->map(vf, 0, 0);
 		PhotoExportParam param = {
@@ -379,34 +552,65 @@ void mCoreTakeScreenshot(struct mCore* core) {
 			NULL,
 			{ 0 }
 		};
-		scePhotoExportFromData(data, vf->size(vf), &param, NULL, NULL, NULL, NULL, 0);
+			scePhotoExportFromData(data, vf->size(vf), &param, NULL, NULL, NULL, NULL, 0);
 #endif
-		vf->close(vf);
-	}
-	if (success) {
-		mLOG(STATUS, INFO, "Screenshot saved");
-		return;
+			vf->close(vf);
+		}
+		if (success) {
+			mLOG(STATUS, INFO, "Screenshot saved");
+			return;
+		}
 	}
+	mLOG(STATUS, WARN, "Failed to take screenshot");
+}
+
+bool mCoreTakeScreenshotAsync(struct mCore* core, struct mStateWriter* writer) {
+#ifdef PSP2
+	// Screenshots have to be exported to the photo library once they're written
+	mCoreTakeScreenshot(core);
+	return true;
 #else
-	UNUSED(core);
+	int compression;
+	const char* format = _screenshotFormat(core, &compression);
+	if (!format) {
+		mLOG(STATUS, WARN, "Failed to take screenshot");
+		return false;
+	}
+	char suffix[8];
+	snprintf(suffix, sizeof(suffix), ".%s", format);
+	struct VFile* vf = VDirFindNextAvailable(core->dirs.screenshot, core->dirs.baseName, "-", suffix, O_CREAT | O_TRUNC | O_WRONLY);
+	if (!vf) {
+		mLOG(STATUS, WARN, "Failed to take screenshot");
+		return false;
+	}
+	if (!mStateWriterScreenshot(writer, core, vf, format, compression, _screenshotSavedAsync, NULL)) {
+		mLOG(STATUS, WARN, "Failed to take screenshot");
+		return false;
+	}
+	return true;
 #endif
-	mLOG(STATUS, WARN, "Failed to take screenshot");
 }
 #endif
+
+bool mCoreTakeScreenshotVFAsync(struct mCore* core, struct mStateWriter* writer, struct VFile* vf, const char* format) {
+	int compression;
+	const char* configured = _screenshotFormat(core, &compression);
+	if (!format) {
+		format = configured;
+	}
+	if (!format) {
+		vf->close(vf);
+		return false;
+	}
+	return mStateWriterScreenshot(writer, core, vf, format, compression, _screenshotSavedAsync, NULL);
+}
 #endif
 
 bool mCoreTakeScreenshotVF(struct mCore* core, struct VFile* vf) {
 #ifdef USE_PNG
-	size_t stride;
-	const void* pixels = 0;
-	unsigned width, height;
-	core->currentVideoSize(core, &width, &height);
-	core->getPixels(core, &pixels, &stride);
-	png_structp png = PNGWriteOpen(vf);
-	png_infop info = PNGWriteHeader(png, width, height, mCOLOR_NATIVE);
-	bool success = PNGWritePixels(png, width, height, stride, pixels, mCOLOR_NATIVE);
-	PNGWriteClose(png, info);
-	return success;
+	int compression;
+	_screenshotFormat(core, &compression);
+	return _takeScreenshotVF(core, vf, "png", compression);
 #else
 	UNUSED(core);
 	UNUSED(vf);
@@ -437,6 +641,11 @@ void mCoreLoadForeignConfig(struct mCore* core, const struct mCoreConfig* config
 	mCoreConfigCopyValue(&core->config, config, "cheatAutosave");
 	mCoreConfigCopyValue(&core->config, config, "cheatAutoload");
 	mCoreConfigCopyValue(&core->config, config, "savePlayerId");
+	mCoreConfigCopyValue(&core->config, config, "threadPriority");
+	mCoreConfigCopyValue(&core->config, config, "threadAffinity");
+	mCoreConfigCopyValue(&core->config, config, "audioRealtime");
+	mCoreConfigCopyValue(&core->config, config, "rewindBufferMemory");
+	mCoreConfigCopyValue(&core->config, config, "rewindSpill");
 
 	core->loadConfig(core, config);
 }
@@ -480,6 +689,47 @@ const struct mCoreMemoryBlock* mCoreGetMemoryBlockInfo(struct mCore* core, uint3
 	return NULL;
 }
 
+size_t mCoreListMemoryUsage(struct mCore* core, struct mCoreMemoryUsageList* list) {
+	mCoreMemoryUsageListClear(list);
+	if (core->listMemoryUsage) {
+		core->listMemoryUsage(core, list);
+	}
+	struct mAudioBuffer* buffer = core->getAudioBuffer(core);
+	if (buffer && buffer->data) {
+		mCoreMemoryUsageAdd(list, "audio", NULL, buffer->capacity * buffer->channels * sizeof(*buffer->data), mCORE_MEMORY_ANONYMOUS);
+	}
+
+	size_t total = 0;
+	size_t i;
+	for (i = 0; i < mCoreMemoryUsageListSize(list); ++i) {
+		total += mCoreMemoryUsageListGetPointer(list, i)->resident;
+	}
+	return total;
+}
+
+void mCoreMemoryUsageAdd(struct mCoreMemoryUsageList* list, const char* name, const void* memory, size_t size, enum mCoreMemoryBacking backing) {
+	if (!size) {
+		return;
+	}
+	struct mCoreMemoryUsage* usage = mCoreMemoryUsageListAppend(list);
+	usage->name = name;
+	usage->size = size;
+	usage->resident = memory ? mappedMemoryResident(memory, size) : size;
+	usage->backing = backing;
+}
+
+const char* mCoreMemoryBackingName(enum mCoreMemoryBacking backing) {
+	switch (backing) {
+	case mCORE_MEMORY_ANONYMOUS:
+		return "anonymous";
+	case mCORE_MEMORY_FILE:
+		return "file";
+	case mCORE_MEMORY_SHARED:
+		return "shared";
+	}
+	return "unknown";
+}
+
 double mCoreCalculateFramerateRatio(const struct mCore* core, double desiredFrameRate) {
 	uint32_t clockRate = core->frequency(core);
 	uint32_t frameCycles = core->frameCycles(core);
@@ -516,19 +766,31 @@ void mCoreLoadELFSymbols(struct mDebuggerSymbols* symbols, struct ELF* elf) {
 	size_t symIndex = ELFFindSection(elf, ".symtab");
 	size_t names = ELFFindSection(elf, ".strtab");
 	Elf32_Shdr* symHeader = ELFGetSectionHeader(elf, symIndex);
-	char* bytes = ELFBytes(elf, NULL);
+	Elf32_Shdr* namesHeader = ELFGetSectionHeader(elf, names);
+	if (!symHeader || !namesHeader || !symHeader->sh_size || !namesHeader->sh_size) {
+		return;
+	}
+	size_t size;
+	char* bytes = ELFBytes(elf, &size);
+	if (symHeader->sh_offset > size || symHeader->sh_size > size - symHeader->sh_offset ||
+	    namesHeader->sh_offset > size || namesHeader->sh_size > size - namesHeader->sh_offset) {
+		return;
+	}
 
+	// Large ELFs can have hundreds of thousands of symbols, so they're handed over in bulk
+	// and only indexed once the debugger actually looks something up
+	const char* strings = &bytes[namesHeader->sh_offset];
+	struct mDebuggerSymbolBatch* batch = mDebuggerSymbolBatchCreate(symbols, strings, namesHeader->sh_size);
 	Elf32_Sym* syms = (Elf32_Sym*) &bytes[symHeader->sh_offset];
 	size_t i;
-	for (i = 0; i * sizeof(*syms) < symHeader->sh_size; ++i) {
+	for (i = 0; (i + 1) * sizeof(*syms) <= symHeader->sh_size; ++i) {
 		if (!syms[i].st_name || ELF32_ST_TYPE(syms[i].st_info) == STT_FILE) {
 			continue;
 		}
-		const char* name = ELFGetString(elf, names, syms[i].st_name);
-		if (name[0] == '$') {
+		if (syms[i].st_name >= namesHeader->sh_size || strings[syms[i].st_name] == '$') {
 			continue;
 		}
-		mDebuggerSymbolAdd(symbols, name, syms[i].st_value, -1);
+		mDebuggerSymbolBatchAdd(batch, syms[i].st_name, syms[i].st_value, -1);
 	}
 }
 #endif
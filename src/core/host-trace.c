@@ -0,0 +1,264 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/host-trace.h>
+
+#include <mgba-util/threading.h>
+#include <mgba-util/vfs.h>
+
+// Each thread buffers this many events before writing them out, which is a couple of
+// seconds' worth of scanlines
+#define EVENTS_PER_CHUNK 0x10000
+
+enum mHostTracePhase {
+	TRACE_BEGIN = 'B',
+	TRACE_END = 'E',
+	TRACE_INSTANT = 'i',
+	TRACE_COUNTER = 'C',
+};
+
+struct mHostTraceEvent {
+	const char* name;
+	uint64_t timestamp;
+	int64_t value;
+	char phase;
+};
+
+// There's no portable way to find out when a thread exits, so these stay around for the
+// lifetime of the process. They only hold onto events while tracing is active.
+struct mHostTraceThread {
+	struct mHostTraceThread* next;
+	Mutex lock;
+	int id;
+	const char* name;
+	struct mHostTraceEvent* events;
+	size_t nEvents;
+};
+
+static bool _initialized = false;
+static int _active = 0;
+static ThreadLocal _threadKey;
+
+// Guards everything below, as well as the list of threads
+static Mutex _outputMutex;
+static struct VFile* _output = NULL;
+static uint64_t _epoch;
+static struct mHostTraceThread* _threads = NULL;
+static int _nextThreadId = 1;
+
+static uint64_t _now(void) {
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec * UINT64_C(1000000000) + tv.tv_usec * UINT64_C(1000);
+#endif
+}
+
+static struct mHostTraceThread* _currentThread(void) {
+	struct mHostTraceThread* thread = ThreadLocalGetValue(_threadKey);
+	if (thread) {
+		return thread;
+	}
+	thread = calloc(1, sizeof(*thread));
+	MutexInit(&thread->lock);
+	MutexLock(&_outputMutex);
+	thread->id = _nextThreadId;
+	++_nextThreadId;
+	thread->next = _threads;
+	_threads = thread;
+	MutexUnlock(&_outputMutex);
+	ThreadLocalSetKey(_threadKey, thread);
+	return thread;
+}
+
+static void _writeEvents(const struct mHostTraceThread* thread, const struct mHostTraceEvent* events, size_t nEvents) {
+	char line[256];
+	size_t i;
+	for (i = 0; i < nEvents; ++i) {
+		const struct mHostTraceEvent* event = &events[i];
+		// Timestamps are in microseconds, but fractions are allowed
+		uint64_t timestamp = event->timestamp > _epoch ? event->timestamp - _epoch : 0;
+		uint64_t us = timestamp / 1000;
+		unsigned ns = timestamp % 1000;
+		int length;
+		switch (event->phase) {
+		case TRACE_BEGIN:
+			length = snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"ph\":\"B\",\"ts\":%" PRIu64 ".%03u,\"pid\":1,\"tid\":%i}",
+			                  event->name, us, ns, thread->id);
+			break;
+		case TRACE_END:
+			length = snprintf(line, sizeof(line), ",\n{\"ph\":\"E\",\"ts\":%" PRIu64 ".%03u,\"pid\":1,\"tid\":%i}",
+			                  us, ns, thread->id);
+			break;
+		case TRACE_INSTANT:
+			length = snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%" PRIu64 ".%03u,\"pid\":1,\"tid\":%i}",
+			                  event->name, us, ns, thread->id);
+			break;
+		case TRACE_COUNTER:
+			length = snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%" PRIu64 ".%03u,\"pid\":1,\"tid\":%i,\"args\":{\"value\":%" PRId64 "}}",
+			                  event->name, us, ns, thread->id, event->value);
+			break;
+		default:
+			continue;
+		}
+		if (length <= 0) {
+			continue;
+		}
+		if ((size_t) length >= sizeof(line)) {
+			// Only a ridiculously long name could get here, and cutting it off would break the JSON
+			continue;
+		}
+		_output->write(_output, line, length);
+	}
+}
+
+static void _record(enum mHostTracePhase phase, const char* name, int64_t value) {
+	int active;
+	ATOMIC_LOAD(active, _active);
+	if (!active) {
+		return;
+	}
+	uint64_t timestamp = _now();
+	struct mHostTraceThread* thread = _currentThread();
+	struct mHostTraceEvent* full = NULL;
+
+	MutexLock(&thread->lock);
+	// Tracing may have stopped while waiting on the lock, in which case the buffer is already gone
+	ATOMIC_LOAD(active, _active);
+	if (!active) {
+		MutexUnlock(&thread->lock);
+		return;
+	}
+	if (!thread->events) {
+		thread->events = malloc(EVENTS_PER_CHUNK * sizeof(*thread->events));
+		thread->nEvents = 0;
+	}
+	struct mHostTraceEvent* event = &thread->events[thread->nEvents];
+	event->name = name;
+	event->timestamp = timestamp;
+	event->value = value;
+	event->phase = phase;
+	++thread->nEvents;
+	if (thread->nEvents == EVENTS_PER_CHUNK) {
+		full = thread->events;
+		thread->events = NULL;
+		thread->nEvents = 0;
+	}
+	MutexUnlock(&thread->lock);
+
+	if (full) {
+		// The writing happens on the traced thread, so make the stall it causes visible
+		mHostTraceBegin("Host trace: write");
+		MutexLock(&_outputMutex);
+		if (_output) {
+			_writeEvents(thread, full, EVENTS_PER_CHUNK);
+		}
+		MutexUnlock(&_outputMutex);
+		free(full);
+		mHostTraceEnd();
+	}
+}
+
+bool mHostTraceStart(struct VFile* vf) {
+	if (!vf) {
+		return false;
+	}
+	if (!_initialized) {
+		ThreadLocalInitKey(&_threadKey);
+		MutexInit(&_outputMutex);
+		_initialized = true;
+	}
+
+	MutexLock(&_outputMutex);
+	if (_output) {
+		MutexUnlock(&_outputMutex);
+		return false;
+	}
+	static const char header[] = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+		"{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"mGBA\"}}";
+	if (vf->write(vf, header, sizeof(header) - 1) != sizeof(header) - 1) {
+		MutexUnlock(&_outputMutex);
+		return false;
+	}
+	_output = vf;
+	_epoch = _now();
+	MutexUnlock(&_outputMutex);
+
+	ATOMIC_STORE(_active, 1);
+	return true;
+}
+
+void mHostTraceStop(void) {
+	if (!_initialized) {
+		return;
+	}
+	ATOMIC_STORE(_active, 0);
+
+	MutexLock(&_outputMutex);
+	if (!_output) {
+		MutexUnlock(&_outputMutex);
+		return;
+	}
+	char line[256];
+	struct mHostTraceThread* thread;
+	for (thread = _threads; thread; thread = thread->next) {
+		MutexLock(&thread->lock);
+		if (thread->events) {
+			_writeEvents(thread, thread->events, thread->nEvents);
+			free(thread->events);
+			thread->events = NULL;
+			thread->nEvents = 0;
+		}
+		if (thread->name) {
+			int length = snprintf(line, sizeof(line), ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%i,\"args\":{\"name\":\"%s\"}}",
+			                      thread->id, thread->name);
+			if (length > 0 && (size_t) length < sizeof(line)) {
+				_output->write(_output, line, length);
+			}
+		}
+		MutexUnlock(&thread->lock);
+	}
+	static const char footer[] = "\n]}\n";
+	_output->write(_output, footer, sizeof(footer) - 1);
+	_output->close(_output);
+	_output = NULL;
+	MutexUnlock(&_outputMutex);
+}
+
+bool mHostTraceIsActive(void) {
+	int active;
+	ATOMIC_LOAD(active, _active);
+	return active;
+}
+
+void mHostTraceSetThreadName(const char* name) {
+	if (!_initialized) {
+		return;
+	}
+	struct mHostTraceThread* thread = _currentThread();
+	MutexLock(&thread->lock);
+	thread->name = name;
+	MutexUnlock(&thread->lock);
+}
+
+void mHostTraceBegin(const char* name) {
+	_record(TRACE_BEGIN, name, 0);
+}
+
+void mHostTraceEnd(void) {
+	_record(TRACE_END, NULL, 0);
+}
+
+void mHostTraceInstant(const char* name) {
+	_record(TRACE_INSTANT, name, 0);
+}
+
+void mHostTraceCounter(const char* name, int64_t value) {
+	_record(TRACE_COUNTER, name, value);
+}
@@ -0,0 +1,117 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/input-latch.h>
+
+#include <mgba/core/core.h>
+
+void mInputLatchInit(struct mInputLatch* latch) {
+	memset(latch, 0, sizeof(*latch));
+	MutexInit(&latch->mutex);
+}
+
+void mInputLatchDeinit(struct mInputLatch* latch) {
+	MutexDeinit(&latch->mutex);
+}
+
+uint64_t mInputLatchNow(void) {
+#ifdef _WIN32
+	LARGE_INTEGER counter;
+	LARGE_INTEGER frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return (counter.QuadPart / frequency.QuadPart) * UINT64_C(1000000000) + (counter.QuadPart % frequency.QuadPart) * UINT64_C(1000000000) / frequency.QuadPart;
+#elif defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec * UINT64_C(1000000000) + tv.tv_usec * UINT64_C(1000);
+#endif
+}
+
+static void _update(struct mInputLatch* latch, uint32_t keys, uint64_t timestamp) {
+	if (keys == latch->keys) {
+		return;
+	}
+	latch->keys = keys;
+	// Events can be stamped by their source, so they don't always arrive in order
+	if (!latch->pendingSince || timestamp < latch->pendingSince) {
+		latch->pendingSince = timestamp;
+	}
+}
+
+void mInputLatchSetKeys(struct mInputLatch* latch, uint32_t keys, uint64_t timestamp) {
+	MutexLock(&latch->mutex);
+	_update(latch, keys, timestamp);
+	MutexUnlock(&latch->mutex);
+}
+
+void mInputLatchAddKeys(struct mInputLatch* latch, uint32_t keys, uint64_t timestamp) {
+	MutexLock(&latch->mutex);
+	_update(latch, latch->keys | keys, timestamp);
+	MutexUnlock(&latch->mutex);
+}
+
+void mInputLatchClearKeys(struct mInputLatch* latch, uint32_t keys, uint64_t timestamp) {
+	MutexLock(&latch->mutex);
+	_update(latch, latch->keys & ~keys, timestamp);
+	MutexUnlock(&latch->mutex);
+}
+
+void mInputLatchApply(struct mInputLatch* latch, struct mCore* core) {
+	MutexLock(&latch->mutex);
+	if (!latch->pendingSince) {
+		MutexUnlock(&latch->mutex);
+		return;
+	}
+	uint32_t pressed = latch->keys & ~latch->applied;
+	uint32_t released = latch->applied & ~latch->keys;
+	uint64_t since = latch->pendingSince;
+	latch->applied = latch->keys;
+	latch->pendingSince = 0;
+	if (!pressed && !released) {
+		// Whatever changed got changed back before the core could see it
+		MutexUnlock(&latch->mutex);
+		return;
+	}
+
+	uint64_t now = mInputLatchNow();
+	uint32_t latency = now > since ? (now - since) / 1000 : 0;
+	struct mInputLatchStats* stats = &latch->stats;
+	if (!stats->changes) {
+		stats->averageLatency = latency;
+	} else {
+		// Exponential moving average over roughly the last 16 changes
+		stats->averageLatency += ((int64_t) latency - (int64_t) stats->averageLatency) / 16;
+	}
+	if (latency > stats->maxLatency) {
+		stats->maxLatency = latency;
+	}
+	++stats->changes;
+	stats->latency = latency;
+	MutexUnlock(&latch->mutex);
+
+	if (released) {
+		core->clearKeys(core, released);
+	}
+	if (pressed) {
+		core->addKeys(core, pressed);
+	}
+}
+
+void mInputLatchGetStats(struct mInputLatch* latch, struct mInputLatchStats* stats) {
+	MutexLock(&latch->mutex);
+	*stats = latch->stats;
+	MutexUnlock(&latch->mutex);
+}
+
+void mInputLatchResetStats(struct mInputLatch* latch) {
+	MutexLock(&latch->mutex);
+	memset(&latch->stats, 0, sizeof(latch->stats));
+	MutexUnlock(&latch->mutex);
+}
@@ -5,10 +5,15 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/core/library.h>
 
+#include <mgba/core/checksum-cache.h>
 #include <mgba/core/core.h>
 #include <mgba-util/string.h>
+#include <mgba-util/table.h>
+#include <mgba-util/threading.h>
 #include <mgba-util/vfs.h>
 
+#include <sys/stat.h>
+
 #ifdef M_CORE_GB
 #include <mgba/gb/interface.h>
 #include <mgba/internal/gb/gb.h>
@@ -28,13 +33,78 @@ struct mLibrary {
 	sqlite3_stmt* insertRoot;
 	sqlite3_stmt* selectRom;
 	sqlite3_stmt* selectRoot;
+	sqlite3_stmt* selectRootPaths;
+	sqlite3_stmt* selectArchive;
 	sqlite3_stmt* deletePath;
+	sqlite3_stmt* clearRoot;
 	sqlite3_stmt* deleteRoot;
 	sqlite3_stmt* count;
 	sqlite3_stmt* select;
 	const struct NoIntroDB* gameDB;
+
+	unsigned threads;
+	void (*progress)(void* context, size_t processed, size_t total);
+	void* progressContext;
+};
+
+enum mLibraryScanRecordType {
+	SCAN_RECORD_ENTRY,
+	SCAN_RECORD_DELETE_PATH,
+	SCAN_RECORD_CLEAR_ROOT,
+	SCAN_RECORD_DELETE_ROOT,
+};
+
+struct mLibraryFileInfo {
+	int64_t mtime;
+	int64_t size;
+	int64_t fileId;
+};
+
+struct mLibraryScanJob {
+	char* base;
+	char* filename;
+	struct VDir* archive;
+	struct mLibraryFileInfo info;
+};
+
+struct mLibraryScanRecord {
+	enum mLibraryScanRecordType type;
+	struct mLibraryEntry entry;
+	struct mLibraryFileInfo info;
 };
 
+struct mLibraryKnownPath {
+	struct mLibraryFileInfo info;
+	bool seen;
+};
+
+DECLARE_VECTOR(mLibraryScanJobList, struct mLibraryScanJob);
+DEFINE_VECTOR(mLibraryScanJobList, struct mLibraryScanJob);
+DECLARE_VECTOR(mLibraryScanRecordList, struct mLibraryScanRecord);
+DEFINE_VECTOR(mLibraryScanRecordList, struct mLibraryScanRecord);
+
+struct mLibraryScan {
+	struct mLibrary* library;
+	size_t queued;
+	size_t processed;
+	size_t uncommitted;
+#ifndef DISABLE_THREADING
+	bool threaded;
+	bool walking;
+	bool hashing;
+	struct mLibraryScanJobList jobs;
+	size_t nextJob;
+	struct mLibraryScanRecordList records;
+	Mutex mutex;
+	Condition jobAvailable;
+	Condition recordAvailable;
+#endif
+};
+
+// Scans are committed in batches so a large import neither syncs every row nor holds
+// one huge transaction open until it finishes
+#define LIBRARY_BATCH_SIZE 500
+
 #define CONSTRAINTS_ROMONLY \
 	"CASE WHEN :useSize THEN roms.size = :size ELSE 1 END AND " \
 	"CASE WHEN :usePlatform THEN roms.platform = :platform ELSE 1 END AND " \
@@ -49,9 +119,8 @@ struct mLibrary {
 	"CASE WHEN :useFilename THEN paths.path = :path ELSE 1 END AND " \
 	"CASE WHEN :useRoot THEN roots.path = :root ELSE 1 END"
 
-static void _mLibraryDeleteEntry(struct mLibrary* library, struct mLibraryEntry* entry);
-static void _mLibraryInsertEntry(struct mLibrary* library, struct mLibraryEntry* entry);
-static bool _mLibraryAddEntry(struct mLibrary* library, const char* filename, const char* base, struct VFile* vf);
+static void _mLibraryInsertEntry(struct mLibrary* library, struct mLibraryEntry* entry, const struct mLibraryFileInfo* info);
+static bool _mLibraryScanEntry(struct mLibraryScan* scan, const char* filename, const char* base, const char* path, struct VFile* vf, const struct mLibraryFileInfo* fileInfo);
 
 static void _bindConstraints(sqlite3_stmt* statement, const struct mLibraryEntry* constraints) {
 	if (!constraints) {
@@ -151,6 +220,7 @@ error:
 struct mLibrary* mLibraryLoad(const char* path) {
 	struct mLibrary* library = malloc(sizeof(*library));
 	memset(library, 0, sizeof(*library));
+	library->threads = M_LIBRARY_DEFAULT_THREADS;
 
 	if (sqlite3_open_v2(path, &library->db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_FULLMUTEX, NULL)) {
 		goto error;
@@ -158,7 +228,7 @@ struct mLibrary* mLibraryLoad(const char* path) {
 
 	static const char createTables[] =
 		"   PRAGMA foreign_keys = ON;"
-		"\n PRAGMA journal_mode = MEMORY;"
+		"\n PRAGMA journal_mode = WAL;"
 		"\n PRAGMA synchronous = NORMAL;"
 		"\n CREATE TABLE IF NOT EXISTS version ("
 		"\n 	tname TEXT NOT NULL PRIMARY KEY,"
@@ -187,6 +257,8 @@ struct mLibrary* mLibraryLoad(const char* path) {
 		"\n 	mtime INTEGER NOT NULL DEFAULT 0,"
 		"\n 	rootid INTEGER REFERENCES roots(rootid) ON DELETE CASCADE,"
 		"\n 	customTitle TEXT,"
+		"\n 	size INTEGER NOT NULL DEFAULT 0,"
+		"\n 	fileid INTEGER NOT NULL DEFAULT 0,"
 		"\n 	CONSTRAINT location UNIQUE (path, rootid)"
 		"\n );"
 		"\n CREATE INDEX IF NOT EXISTS crc32 ON roms (crc32);"
@@ -195,7 +267,7 @@ struct mLibrary* mLibraryLoad(const char* path) {
 		"\n INSERT OR IGNORE INTO version (tname, version) VALUES ('version', 1);"
 		"\n INSERT OR IGNORE INTO version (tname, version) VALUES ('roots', 1);"
 		"\n INSERT OR IGNORE INTO version (tname, version) VALUES ('roms', 2);"
-		"\n INSERT OR IGNORE INTO version (tname, version) VALUES ('paths', 1);";
+		"\n INSERT OR IGNORE INTO version (tname, version) VALUES ('paths', 2);";
 	if (sqlite3_exec(library->db, createTables, NULL, NULL, NULL)) {
 		goto error;
 	}
@@ -217,7 +289,23 @@ struct mLibrary* mLibraryLoad(const char* path) {
 		}
 	}
 
-	static const char insertPath[] = "INSERT INTO paths (romid, path, customTitle, rootid) VALUES (?, ?, ?, ?);";
+	int pathsTableVersion = _mLibraryTableVersion(library, "paths");
+	if (pathsTableVersion < 0) {
+		goto error;
+	} else if (pathsTableVersion < 2) {
+		// Existing paths are left with a size of 0, so they get hashed once more on the next scan
+		static const char upgradePathsTable[] =
+			"   ALTER TABLE paths"
+			"\n ADD COLUMN size INTEGER NOT NULL DEFAULT 0;"
+			"\n ALTER TABLE paths"
+			"\n ADD COLUMN fileid INTEGER NOT NULL DEFAULT 0;"
+			"\n UPDATE version SET version=2 WHERE tname='paths'";
+		if (sqlite3_exec(library->db, upgradePathsTable, NULL, NULL, NULL)) {
+			goto error;
+		}
+	}
+
+	static const char insertPath[] = "INSERT INTO paths (romid, path, customTitle, rootid, mtime, size, fileid) VALUES (?, ?, ?, ?, ?, ?, ?);";
 	if (sqlite3_prepare_v2(library->db, insertPath, -1, &library->insertPath, NULL)) {
 		goto error;
 	}
@@ -237,11 +325,16 @@ struct mLibrary* mLibraryLoad(const char* path) {
 		goto error;
 	}
 
-	static const char deletePath[] = "DELETE FROM paths WHERE path = ?;";
+	static const char deletePath[] = "DELETE FROM paths WHERE path = ? AND rootid IN (SELECT rootid FROM roots WHERE path = ?);";
 	if (sqlite3_prepare_v2(library->db, deletePath, -1, &library->deletePath, NULL)) {
 		goto error;
 	}
 
+	static const char clearRoot[] = "DELETE FROM paths WHERE rootid IN (SELECT rootid FROM roots WHERE path = ?);";
+	if (sqlite3_prepare_v2(library->db, clearRoot, -1, &library->clearRoot, NULL)) {
+		goto error;
+	}
+
 	static const char selectRom[] = "SELECT romid FROM roms WHERE " CONSTRAINTS_ROMONLY ";";
 	if (sqlite3_prepare_v2(library->db, selectRom, -1, &library->selectRom, NULL)) {
 		goto error;
@@ -252,6 +345,16 @@ struct mLibrary* mLibraryLoad(const char* path) {
 		goto error;
 	}
 
+	static const char selectRootPaths[] = "SELECT paths.path, paths.mtime, paths.size, paths.fileid FROM paths JOIN roots USING (rootid) WHERE roots.path = ?;";
+	if (sqlite3_prepare_v2(library->db, selectRootPaths, -1, &library->selectRootPaths, NULL)) {
+		goto error;
+	}
+
+	static const char selectArchive[] = "SELECT paths.mtime, paths.size, paths.fileid FROM paths JOIN roots USING (rootid) WHERE roots.path = ? LIMIT 1;";
+	if (sqlite3_prepare_v2(library->db, selectArchive, -1, &library->selectArchive, NULL)) {
+		goto error;
+	}
+
 	static const char count[] = "SELECT count(pathid) FROM paths JOIN roots USING (rootid) JOIN roms USING (romid) WHERE " CONSTRAINTS ";";
 	if (sqlite3_prepare_v2(library->db, count, -1, &library->count, NULL)) {
 		goto error;
@@ -278,77 +381,422 @@ void mLibraryDestroy(struct mLibrary* library) {
 	sqlite3_finalize(library->insertRom);
 	sqlite3_finalize(library->insertRoot);
 	sqlite3_finalize(library->deletePath);
+	sqlite3_finalize(library->clearRoot);
 	sqlite3_finalize(library->deleteRoot);
 	sqlite3_finalize(library->selectRom);
 	sqlite3_finalize(library->selectRoot);
+	sqlite3_finalize(library->selectRootPaths);
+	sqlite3_finalize(library->selectArchive);
 	sqlite3_finalize(library->select);
 	sqlite3_finalize(library->count);
 	sqlite3_close(library->db);
 	free(library);
 }
 
-void mLibraryLoadDirectory(struct mLibrary* library, const char* base, bool recursive) {
-	struct VDir* dir = VDirOpenArchive(base);
-	if (!dir) {
-		dir = VDirOpen(base);
+static void _bindRoot(sqlite3_stmt* statement, const char* base) {
+	sqlite3_clear_bindings(statement);
+	sqlite3_reset(statement);
+	sqlite3_bind_text(statement, 1, base, -1, SQLITE_TRANSIENT);
+	sqlite3_step(statement);
+}
+
+static void _writeRecord(struct mLibraryScan* scan, struct mLibraryScanRecord* record) {
+	struct mLibrary* library = scan->library;
+	switch (record->type) {
+	case SCAN_RECORD_ENTRY:
+		_mLibraryInsertEntry(library, &record->entry, &record->info);
+		break;
+	case SCAN_RECORD_DELETE_PATH:
+		sqlite3_clear_bindings(library->deletePath);
+		sqlite3_reset(library->deletePath);
+		sqlite3_bind_text(library->deletePath, 1, record->entry.filename, -1, SQLITE_TRANSIENT);
+		sqlite3_bind_text(library->deletePath, 2, record->entry.base, -1, SQLITE_TRANSIENT);
+		sqlite3_step(library->deletePath);
+		break;
+	case SCAN_RECORD_CLEAR_ROOT:
+		_bindRoot(library->clearRoot, record->entry.base);
+		break;
+	case SCAN_RECORD_DELETE_ROOT:
+		_bindRoot(library->deleteRoot, record->entry.base);
+		break;
 	}
-	sqlite3_exec(library->db, "BEGIN TRANSACTION;", NULL, NULL, NULL);
-	if (!dir) {
-		sqlite3_clear_bindings(library->deleteRoot);
-		sqlite3_reset(library->deleteRoot);
-		sqlite3_bind_text(library->deleteRoot, 1, base, -1, SQLITE_TRANSIENT);
-		sqlite3_step(library->deleteRoot);
-		sqlite3_exec(library->db, "COMMIT;", NULL, NULL, NULL);
+	mLibraryEntryFree(&record->entry);
+
+	++scan->uncommitted;
+	if (scan->uncommitted == LIBRARY_BATCH_SIZE) {
+		scan->uncommitted = 0;
+		sqlite3_exec(library->db, "COMMIT; BEGIN TRANSACTION;", NULL, NULL, NULL);
+	}
+}
+
+static void _reportProgress(struct mLibraryScan* scan, size_t processed, size_t total) {
+	if (scan->library->progress) {
+		scan->library->progress(scan->library->progressContext, processed, total);
+	}
+}
+
+static void _postRecord(struct mLibraryScan* scan, enum mLibraryScanRecordType type, const struct mLibraryEntry* entry, const struct mLibraryFileInfo* info) {
+	struct mLibraryScanRecord record = {
+		.type = type,
+		.entry = *entry
+	};
+	if (info) {
+		record.info = *info;
+	}
+	record.entry.base = strdup(entry->base);
+	record.entry.filename = entry->filename ? strdup(entry->filename) : NULL;
+	record.entry.title = NULL;
+#ifndef DISABLE_THREADING
+	if (scan->threaded) {
+		MutexLock(&scan->mutex);
+		*mLibraryScanRecordListAppend(&scan->records) = record;
+		ConditionWake(&scan->recordAvailable);
+		MutexUnlock(&scan->mutex);
 		return;
 	}
+#endif
+	_writeRecord(scan, &record);
+}
 
+static void _postPath(struct mLibraryScan* scan, enum mLibraryScanRecordType type, const char* base, const char* filename) {
 	struct mLibraryEntry entry;
 	memset(&entry, 0, sizeof(entry));
 	entry.base = base;
-	struct mLibraryListing entries;
-	mLibraryListingInit(&entries, 0);
-	mLibraryGetEntries(library, &entries, 0, 0, &entry);
-	size_t i;
-	for (i = 0; i < mLibraryListingSize(&entries); ++i) {
-		struct mLibraryEntry* current = mLibraryListingGetPointer(&entries, i);
-		struct VFile* vf = dir->openFile(dir, current->filename, O_RDONLY);
-		_mLibraryDeleteEntry(library, current);
-		if (!vf) {
-			mLibraryEntryFree(current);
-			continue;
-		}
-		_mLibraryAddEntry(library, current->filename, base, vf);
-		mLibraryEntryFree(current);
+	entry.filename = filename;
+	_postRecord(scan, type, &entry, NULL);
+}
+
+static void _postRoot(struct mLibraryScan* scan, enum mLibraryScanRecordType type, const char* base) {
+	_postPath(scan, type, base, NULL);
+}
+
+static bool _statFile(const char* path, struct mLibraryFileInfo* info) {
+#ifdef _WIN32
+	wchar_t wpath[PATH_MAX];
+	MultiByteToWideChar(CP_UTF8, 0, path, -1, wpath, sizeof(wpath) / sizeof(*wpath));
+	struct _stat64 st;
+	if (_wstat64(wpath, &st) < 0) {
+		return false;
 	}
-	mLibraryListingDeinit(&entries);
+#else
+	struct stat st;
+	if (stat(path, &st) < 0) {
+		return false;
+	}
+#endif
+	info->mtime = st.st_mtime;
+	info->size = st.st_size;
+	// Windows doesn't report a file ID here, so it only goes by time and size
+	info->fileId = st.st_ino;
+	return true;
+}
+
+static bool _fileInfoEqual(const struct mLibraryFileInfo* a, const struct mLibraryFileInfo* b) {
+	return a->mtime == b->mtime && a->size == b->size && a->fileId == b->fileId;
+}
+
+static bool _archiveUnchanged(struct mLibrary* library, const char* path, const struct mLibraryFileInfo* info) {
+	// Every path in an archive is stamped with the archive's own metadata
+	sqlite3_clear_bindings(library->selectArchive);
+	sqlite3_reset(library->selectArchive);
+	sqlite3_bind_text(library->selectArchive, 1, path, -1, SQLITE_TRANSIENT);
+	if (sqlite3_step(library->selectArchive) != SQLITE_ROW) {
+		return false;
+	}
+	struct mLibraryFileInfo known = {
+		.mtime = sqlite3_column_int64(library->selectArchive, 0),
+		.size = sqlite3_column_int64(library->selectArchive, 1),
+		.fileId = sqlite3_column_int64(library->selectArchive, 2),
+	};
+	sqlite3_reset(library->selectArchive);
+	return _fileInfoEqual(&known, info);
+}
+
+static void _loadKnownPaths(struct mLibrary* library, const char* base, struct Table* known) {
+	sqlite3_clear_bindings(library->selectRootPaths);
+	sqlite3_reset(library->selectRootPaths);
+	sqlite3_bind_text(library->selectRootPaths, 1, base, -1, SQLITE_TRANSIENT);
+	while (sqlite3_step(library->selectRootPaths) == SQLITE_ROW) {
+		struct mLibraryKnownPath* path = calloc(1, sizeof(*path));
+		path->info.mtime = sqlite3_column_int64(library->selectRootPaths, 1);
+		path->info.size = sqlite3_column_int64(library->selectRootPaths, 2);
+		path->info.fileId = sqlite3_column_int64(library->selectRootPaths, 3);
+		HashTableInsert(known, (const char*) sqlite3_column_text(library->selectRootPaths, 0), path);
+	}
+	sqlite3_reset(library->selectRootPaths);
+}
 
+static void _scanArchive(struct mLibraryScan* scan, const char* base, struct VDir* dir, const struct mLibraryFileInfo* info) {
+	// Whatever was in the archive before is replaced by what's in it now
+	_postRoot(scan, SCAN_RECORD_CLEAR_ROOT, base);
 	dir->rewind(dir);
-	struct VDirEntry* dirent = dir->listNext(dir);
-	while (dirent) {
+	struct VDirEntry* dirent;
+	while ((dirent = dir->listNext(dir))) {
 		const char* name = dirent->name(dirent);
-		struct VFile* vf = dir->openFile(dir, name, O_RDONLY);
-		bool wasAdded = false;
+		_mLibraryScanEntry(scan, name, base, NULL, dir->openFile(dir, name, O_RDONLY), info);
+	}
+	dir->close(dir);
+}
 
-		if (vf) {
-			wasAdded = _mLibraryAddEntry(library, name, base, vf);
+static void _scanJob(struct mLibraryScan* scan, struct mLibraryScanJob* job) {
+	if (job->archive) {
+		_scanArchive(scan, job->base, job->archive, &job->info);
+		return;
+	}
+
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s" PATH_SEP "%s", job->base, job->filename);
+	if (_mLibraryScanEntry(scan, job->filename, job->base, path, VFileOpen(path, O_RDONLY), &job->info)) {
+		return;
+	}
+	if (job->filename[0] == '.') {
+		return;
+	}
+	struct VDir* archive = VDirOpenArchive(path);
+	if (archive) {
+		_scanArchive(scan, path, archive, &job->info);
+	} else {
+		// Drop anything left over from when this used to be an archive
+		_postRoot(scan, SCAN_RECORD_DELETE_ROOT, path);
+	}
+}
+
+static void _queueJob(struct mLibraryScan* scan, const char* base, const char* filename, struct VDir* archive, const struct mLibraryFileInfo* info) {
+	struct mLibraryScanJob job = {
+		.base = strdup(base),
+		.filename = filename ? strdup(filename) : NULL,
+		.archive = archive,
+		.info = *info
+	};
+#ifndef DISABLE_THREADING
+	if (scan->threaded) {
+		MutexLock(&scan->mutex);
+		*mLibraryScanJobListAppend(&scan->jobs) = job;
+		++scan->queued;
+		ConditionWake(&scan->jobAvailable);
+		MutexUnlock(&scan->mutex);
+		return;
+	}
+#endif
+	++scan->queued;
+	_scanJob(scan, &job);
+	free(job.base);
+	free(job.filename);
+	++scan->processed;
+	_reportProgress(scan, scan->processed, scan->queued);
+}
+
+static void _walkDirectory(struct mLibraryScan* scan, const char* base, bool recursive) {
+	struct mLibraryFileInfo info;
+	memset(&info, 0, sizeof(info));
+
+	// Archives are opened here but scanned as a single job, since their members can't be read in parallel
+	struct VDir* dir = VDirOpenArchive(base);
+	if (dir) {
+		if (_statFile(base, &info) && _archiveUnchanged(scan->library, base, &info)) {
+			dir->close(dir);
+		} else {
+			_queueJob(scan, base, NULL, dir, &info);
+		}
+		return;
+	}
+	dir = VDirOpen(base);
+	if (!dir) {
+		_postRoot(scan, SCAN_RECORD_DELETE_ROOT, base);
+		return;
+	}
+
+	// Files whose metadata matches what was stored last time are left alone, and anything
+	// that's gone or has changed is dropped before the new contents are hashed
+	struct Table known;
+	HashTableInit(&known, 0, free);
+	_loadKnownPaths(scan->library, base, &known);
+
+	dir->rewind(dir);
+	struct VDirEntry* dirent;
+	while ((dirent = dir->listNext(dir))) {
+		const char* name = dirent->name(dirent);
+		char path[PATH_MAX];
+		snprintf(path, sizeof(path), "%s" PATH_SEP "%s", base, name);
+		if (dirent->type(dirent) == VFS_DIRECTORY) {
+			if (recursive && name[0] != '.') {
+				_walkDirectory(scan, path, recursive);
+			}
+			continue;
 		}
-		if (!wasAdded && name[0] != '.') {
-			char newBase[PATH_MAX];
-			snprintf(newBase, sizeof(newBase), "%s" PATH_SEP "%s", base, name);
-
-			if (recursive) {
-				mLibraryLoadDirectory(library, newBase, recursive);
-			} else if (dirent->type(dirent) == VFS_FILE) {
-				mLibraryLoadDirectory(library, newBase, true); // This will add as an archive
+		if (!_statFile(path, &info)) {
+			memset(&info, 0, sizeof(info));
+		}
+		struct mLibraryKnownPath* knownPath = HashTableLookup(&known, name);
+		if (knownPath) {
+			knownPath->seen = true;
+			if (_fileInfoEqual(&knownPath->info, &info)) {
+				continue;
 			}
+			// This has to reach the writer before the new entry does
+			_postPath(scan, SCAN_RECORD_DELETE_PATH, base, name);
+		} else if (_archiveUnchanged(scan->library, path, &info)) {
+			continue;
 		}
-		dirent = dir->listNext(dir);
+		_queueJob(scan, base, name, NULL, &info);
 	}
 	dir->close(dir);
+
+	struct TableIterator iter;
+	if (HashTableIteratorStart(&known, &iter)) {
+		do {
+			struct mLibraryKnownPath* knownPath = HashTableIteratorGetValue(&known, &iter);
+			if (!knownPath->seen) {
+				_postPath(scan, SCAN_RECORD_DELETE_PATH, base, HashTableIteratorGetKey(&known, &iter));
+			}
+		} while (HashTableIteratorNext(&known, &iter));
+	}
+	HashTableDeinit(&known);
+}
+
+#ifndef DISABLE_THREADING
+static THREAD_ENTRY _hashThread(void* context) {
+	struct mLibraryScan* scan = context;
+	ThreadSetName("Library Hash");
+	MutexLock(&scan->mutex);
+	while (true) {
+		if (scan->nextJob == mLibraryScanJobListSize(&scan->jobs)) {
+			if (!scan->walking) {
+				break;
+			}
+			ConditionWait(&scan->jobAvailable, &scan->mutex);
+			continue;
+		}
+		struct mLibraryScanJob job = *mLibraryScanJobListGetPointer(&scan->jobs, scan->nextJob);
+		++scan->nextJob;
+		MutexUnlock(&scan->mutex);
+
+		_scanJob(scan, &job);
+		free(job.base);
+		free(job.filename);
+
+		MutexLock(&scan->mutex);
+		++scan->processed;
+		ConditionWake(&scan->recordAvailable);
+	}
+	MutexUnlock(&scan->mutex);
+	THREAD_EXIT(0);
+}
+
+static THREAD_ENTRY _writeThread(void* context) {
+	struct mLibraryScan* scan = context;
+	ThreadSetName("Library Writer");
+	struct mLibraryScanRecordList batch;
+	mLibraryScanRecordListInit(&batch, 0);
+	size_t reported = 0;
+	MutexLock(&scan->mutex);
+	while (true) {
+		if (!mLibraryScanRecordListSize(&scan->records) && scan->processed == reported) {
+			if (!scan->hashing) {
+				break;
+			}
+			ConditionWait(&scan->recordAvailable, &scan->mutex);
+			continue;
+		}
+		// Take everything that's ready in one go so the hashing threads only wait on a swap
+		struct mLibraryScanRecordList swap = scan->records;
+		scan->records = batch;
+		batch = swap;
+		size_t processed = scan->processed;
+		size_t total = scan->queued;
+		MutexUnlock(&scan->mutex);
+
+		size_t i;
+		for (i = 0; i < mLibraryScanRecordListSize(&batch); ++i) {
+			_writeRecord(scan, mLibraryScanRecordListGetPointer(&batch, i));
+		}
+		mLibraryScanRecordListClear(&batch);
+		if (processed != reported) {
+			reported = processed;
+			_reportProgress(scan, processed, total);
+		}
+
+		MutexLock(&scan->mutex);
+	}
+	MutexUnlock(&scan->mutex);
+	mLibraryScanRecordListDeinit(&batch);
+	THREAD_EXIT(0);
+}
+#endif
+
+void mLibraryLoadDirectory(struct mLibrary* library, const char* base, bool recursive) {
+	struct mLibraryScan scan = {
+		.library = library
+	};
+	sqlite3_exec(library->db, "BEGIN TRANSACTION;", NULL, NULL, NULL);
+#ifndef DISABLE_THREADING
+	// This thread walks the directories, handing files off to the hashing threads, whose
+	// results are funneled through a single thread that owns all writes to the database
+	Thread* threads = NULL;
+	Thread writer;
+	unsigned nThreads = library->threads;
+	if (nThreads) {
+		scan.threaded = true;
+		scan.walking = true;
+		scan.hashing = true;
+		mLibraryScanJobListInit(&scan.jobs, 0);
+		mLibraryScanRecordListInit(&scan.records, 0);
+		MutexInit(&scan.mutex);
+		ConditionInit(&scan.jobAvailable);
+		ConditionInit(&scan.recordAvailable);
+		threads = calloc(nThreads, sizeof(*threads));
+		unsigned i;
+		for (i = 0; i < nThreads; ++i) {
+			ThreadCreate(&threads[i], _hashThread, &scan);
+		}
+		ThreadCreate(&writer, _writeThread, &scan);
+	}
+#endif
+
+	_walkDirectory(&scan, base, recursive);
+
+#ifndef DISABLE_THREADING
+	if (nThreads) {
+		MutexLock(&scan.mutex);
+		scan.walking = false;
+		ConditionWake(&scan.jobAvailable);
+		MutexUnlock(&scan.mutex);
+		unsigned i;
+		for (i = 0; i < nThreads; ++i) {
+			ThreadJoin(&threads[i]);
+		}
+		free(threads);
+
+		MutexLock(&scan.mutex);
+		scan.hashing = false;
+		ConditionWake(&scan.recordAvailable);
+		MutexUnlock(&scan.mutex);
+		ThreadJoin(&writer);
+
+		ConditionDeinit(&scan.recordAvailable);
+		ConditionDeinit(&scan.jobAvailable);
+		MutexDeinit(&scan.mutex);
+		mLibraryScanRecordListDeinit(&scan.records);
+		mLibraryScanJobListDeinit(&scan.jobs);
+	}
+#endif
 	sqlite3_exec(library->db, "COMMIT;", NULL, NULL, NULL);
+	mChecksumCacheSync();
+}
+
+void mLibrarySetThreads(struct mLibrary* library, unsigned threads) {
+	if (threads > M_LIBRARY_MAX_THREADS) {
+		threads = M_LIBRARY_MAX_THREADS;
+	}
+	library->threads = threads;
+}
+
+void mLibrarySetProgressCallback(struct mLibrary* library, void (*callback)(void* context, size_t processed, size_t total), void* context) {
+	library->progress = callback;
+	library->progressContext = context;
 }
 
-bool _mLibraryAddEntry(struct mLibrary* library, const char* filename, const char* base, struct VFile* vf) {
+static bool _mLibraryScanEntry(struct mLibraryScan* scan, const char* filename, const char* base, const char* path, struct VFile* vf, const struct mLibraryFileInfo* fileInfo) {
 	if (!vf) {
 		return false;
 	}
@@ -360,6 +808,11 @@ bool _mLibraryAddEntry(struct mLibrary* library, const char* filename, const cha
 	struct mLibraryEntry entry;
 	memset(&entry, 0, sizeof(entry));
 	core->init(core);
+	if (path && core->setROMPath) {
+		// Files that have been hashed before, whether by the library or by loading them,
+		// don't need to be read in full again
+		core->setROMPath(core, path);
+	}
 	core->loadROM(core, vf);
 
 	struct mGameInfo info;
@@ -383,13 +836,13 @@ bool _mLibraryAddEntry(struct mLibrary* library, const char* filename, const cha
 	entry.base = base;
 	entry.filename = filename;
 	entry.filesize = vf->size(vf);
-	_mLibraryInsertEntry(library, &entry);
+	_postRecord(scan, SCAN_RECORD_ENTRY, &entry, fileInfo);
 	// Note: this destroys the VFile
 	core->deinit(core);
 	return true;
 }
 
-static void _mLibraryInsertEntry(struct mLibrary* library, struct mLibraryEntry* entry) {
+static void _mLibraryInsertEntry(struct mLibrary* library, struct mLibraryEntry* entry, const struct mLibraryFileInfo* info) {
 	sqlite3_clear_bindings(library->selectRom);
 	sqlite3_reset(library->selectRom);
 	struct mLibraryEntry constraints = *entry;
@@ -406,6 +859,7 @@ static void _mLibraryInsertEntry(struct mLibrary* library, struct mLibraryEntry*
 	} else {
 		romId = sqlite3_column_int64(library->selectRom, 0);
 	}
+	sqlite3_reset(library->selectRom);
 
 	sqlite3_int64 rootId = 0;
 	if (entry->base) {
@@ -421,6 +875,7 @@ static void _mLibraryInsertEntry(struct mLibrary* library, struct mLibraryEntry*
 		} else {
 			rootId = sqlite3_column_int64(library->selectRoot, 0);
 		}
+		sqlite3_reset(library->selectRoot);
 	}
 
 	sqlite3_clear_bindings(library->insertPath);
@@ -431,13 +886,9 @@ static void _mLibraryInsertEntry(struct mLibrary* library, struct mLibraryEntry*
 	if (rootId > 0) {
 		sqlite3_bind_int64(library->insertPath, 4, rootId);
 	}
-	sqlite3_step(library->insertPath);
-}
-
-static void _mLibraryDeleteEntry(struct mLibrary* library, struct mLibraryEntry* entry) {
-	sqlite3_clear_bindings(library->deletePath);
-	sqlite3_reset(library->deletePath);
-	sqlite3_bind_text(library->deletePath, 1, entry->filename, -1, SQLITE_TRANSIENT);
+	sqlite3_bind_int64(library->insertPath, 5, info->mtime);
+	sqlite3_bind_int64(library->insertPath, 6, info->size);
+	sqlite3_bind_int64(library->insertPath, 7, info->fileId);
 	sqlite3_step(library->insertPath);
 }
 
@@ -458,7 +909,9 @@ size_t mLibraryCount(struct mLibrary* library, const struct mLibraryEntry* const
 	if (sqlite3_step(library->count) != SQLITE_ROW) {
 		return 0;
 	}
-	return sqlite3_column_int64(library->count, 0);
+	size_t count = sqlite3_column_int64(library->count, 0);
+	sqlite3_reset(library->count);
+	return count;
 }
 
 size_t mLibraryGetEntries(struct mLibrary* library, struct mLibraryListing* out, size_t numEntries, size_t offset, const struct mLibraryEntry* constraints) {
@@ -6,22 +6,33 @@
 #include <mgba/core/log.h>
 
 #include <mgba/core/config.h>
+#include <mgba-util/ring-fifo.h>
 #include <mgba-util/threading.h>
 #include <mgba-util/vfs.h>
 
-#define MAX_CATEGORY 64
+#define MAX_CATEGORY mLOG_MAX_CATEGORY
 #define MAX_LOG_BUF 1024
 
+#define FILTER_RESOLVED 0x100
+
+#define ASYNC_LOG_RECORDS 1024
+#define ASYNC_LOG_TEXT 240
+#define ASYNC_LOG_TIMEOUT 100
+
+mLOG_DECLARE_CATEGORY(LOG);
+
 static struct mLogger* _defaultLogger = NULL;
 
 #ifndef DISABLE_THREADING
 static ThreadLocal _contextKey;
+static ThreadLocal _asyncThreadKey;
 
 #ifdef USE_PTHREADS
 static pthread_once_t _contextOnce = PTHREAD_ONCE_INIT;
 
 static void _createTLS(void) {
 	ThreadLocalInitKey(&_contextKey);
+	ThreadLocalInitKey(&_asyncThreadKey);
 }
 #elif _WIN32
 static INIT_ONCE _contextOnce = INIT_ONCE_STATIC_INIT;
@@ -31,6 +42,7 @@ static BOOL CALLBACK _createTLS(PINIT_ONCE once, PVOID param, PVOID* context) {
 	UNUSED(param);
 	UNUSED(context);
 	ThreadLocalInitKey(&_contextKey);
+	ThreadLocalInitKey(&_asyncThreadKey);
 	return TRUE;
 }
 #endif
@@ -138,12 +150,11 @@ void mLogExplicit(struct mLogger* context, int category, enum mLogLevel level, c
 
 void mLogFilterInit(struct mLogFilter* filter) {
 	HashTableInit(&filter->categories, 8, NULL);
-	TableInit(&filter->levels, 8, NULL);
+	memset(filter->levels, 0, sizeof(filter->levels));
 }
 
 void mLogFilterDeinit(struct mLogFilter* filter) {
 	HashTableDeinit(&filter->categories);
-	TableDeinit(&filter->levels);
 }
 
 static void _setFilterLevel(const char* key, const char* value, enum mCoreConfigLevel level, void* user) {
@@ -170,7 +181,7 @@ static void _setFilterLevel(const char* key, const char* value, enum mCoreConfig
 
 void mLogFilterLoad(struct mLogFilter* filter, const struct mCoreConfig* config) {
 	HashTableClear(&filter->categories);
-	TableClear(&filter->levels);
+	memset(filter->levels, 0, sizeof(filter->levels));
 
 	mCoreConfigEnumerate(config, "logLevel.", _setFilterLevel, filter);
 	filter->defaultLevels = mLOG_ALL;
@@ -197,8 +208,8 @@ void mLogFilterSet(struct mLogFilter* filter, const char* category, int levels)
 	HashTableInsert(&filter->categories, category, (void*)(intptr_t) levels);
 	// Can't do this eagerly because not all categories are initialized immediately
 	int cat = mLogCategoryById(category);
-	if (cat >= 0) {
-		TableInsert(&filter->levels, cat, (void*)(intptr_t) levels);
+	if (cat >= 0 && cat < MAX_CATEGORY) {
+		filter->levels[cat] = levels | FILTER_RESOLVED;
 	}
 }
 
@@ -206,8 +217,8 @@ void mLogFilterReset(struct mLogFilter* filter, const char* category) {
 	HashTableRemove(&filter->categories, category);
 	// Can't do this eagerly because not all categories are initialized immediately
 	int cat = mLogCategoryById(category);
-	if (cat >= 0) {
-		TableRemove(&filter->levels, cat);
+	if (cat >= 0 && cat < MAX_CATEGORY) {
+		filter->levels[cat] = FILTER_RESOLVED;
 	}
 }
 
@@ -219,16 +230,21 @@ bool mLogFilterTest(const struct mLogFilter* filter, int category, enum mLogLeve
 	return level & filter->defaultLevels;
 }
 
-int mLogFilterLevels(const struct mLogFilter* filter , int category) {
-	int value = (intptr_t) TableLookup(&filter->levels, category);
-	if (value) {
-		return value;
+int mLogFilterLevels(const struct mLogFilter* filter, int category) {
+	if (category < 0 || category >= MAX_CATEGORY) {
+		return 0;
 	}
-	const char* cat = mLogCategoryId(category);
-	if (cat) {
+	int value = filter->levels[category];
+	if (!(value & FILTER_RESOLVED)) {
+		const char* cat = mLogCategoryId(category);
+		if (!cat) {
+			return 0;
+		}
 		value = (intptr_t) HashTableLookup(&filter->categories, cat);
+		// Caching the lookup doesn't change what the filter reports, so it's fine on a const filter
+		((struct mLogFilter*) filter)->levels[category] = value | FILTER_RESOLVED;
 	}
-	return value;
+	return value & ~FILTER_RESOLVED;
 }
 
 void _mCoreStandardLog(struct mLogger* logger, int category, enum mLogLevel level, const char* format, va_list args) {
@@ -291,4 +307,230 @@ void mStandardLoggerConfig(struct mStandardLogger* logger, struct mCoreConfig* c
 	mLogFilterLoad(logger->d.filter, config);
 }
 
+struct mAsyncLogRecord {
+	int category;
+	int level;
+	char* spill;
+	char text[ASYNC_LOG_TEXT];
+};
+
+// Identifies a producer thread to the async loggers it feeds. It's never freed, since
+// queues still refer to it after the thread exits
+struct mAsyncLogThread {
+	struct mAsyncLogQueue* queue;
+	unsigned serial;
+};
+
+struct mAsyncLogQueue {
+	struct mAsyncLogQueue* next;
+	const struct mAsyncLogThread* thread;
+	struct RingFIFO fifo;
+};
+
+struct mAsyncLogContext {
+#ifndef DISABLE_THREADING
+	Thread thread;
+	Mutex mutex;
+	Condition workerCond;
+	Condition clientCond;
+#endif
+	struct mAsyncLogQueue* queues;
+	unsigned serial;
+	int pending;
+	int dropped;
+	bool shutdown;
+	bool draining;
+	unsigned generation;
+};
+
+static void _asyncDeliver(struct mLogger* backend, int category, enum mLogLevel level, const char* format, ...) {
+	va_list args;
+	va_start(args, format);
+	backend->log(backend, category, level, format, args);
+	va_end(args);
+}
+
+static void _asyncDrain(struct mAsyncLogger* logger) {
+	struct mAsyncLogContext* context = logger->context;
+	struct mAsyncLogQueue* queue;
+	struct mAsyncLogRecord record;
+	ATOMIC_LOAD_PTR(queue, context->queues);
+	for (; queue; queue = queue->next) {
+		while (RingFIFORead(&queue->fifo, &record, sizeof(record))) {
+			_asyncDeliver(logger->backend, record.category, record.level, "%s", record.spill ? record.spill : record.text);
+			free(record.spill);
+		}
+	}
+	int dropped = 0;
+	ATOMIC_LOAD(dropped, context->dropped);
+	if (dropped) {
+		ATOMIC_SUB(context->dropped, dropped);
+		_asyncDeliver(logger->backend, _mLOG_CAT_LOG, mLOG_WARN, "%i log messages dropped", dropped);
+	}
+}
+
+#ifndef DISABLE_THREADING
+static THREAD_ENTRY _asyncRun(void* user) {
+	struct mAsyncLogger* logger = user;
+	struct mAsyncLogContext* context = logger->context;
+	ThreadSetName("Logging");
+	MutexLock(&context->mutex);
+	while (true) {
+		if (!context->pending && !context->shutdown) {
+			// Producers only take the lock when the worker looks idle, so a wakeup can be
+			// missed; draining on a timeout bounds how late those records can arrive
+			ConditionWaitTimed(&context->workerCond, &context->mutex, ASYNC_LOG_TIMEOUT);
+		}
+		bool shutdown = context->shutdown;
+		ATOMIC_STORE(context->pending, 0);
+		context->draining = true;
+		MutexUnlock(&context->mutex);
+
+		_asyncDrain(logger);
+
+		MutexLock(&context->mutex);
+		context->draining = false;
+		++context->generation;
+		ConditionWake(&context->clientCond);
+		if (shutdown) {
+			break;
+		}
+	}
+	MutexUnlock(&context->mutex);
+	THREAD_EXIT(0);
+}
+
+static struct mAsyncLogQueue* _asyncGetQueue(struct mAsyncLogContext* context) {
+	_setupTLS();
+	struct mAsyncLogThread* thread = ThreadLocalGetValue(_asyncThreadKey);
+	if (!thread) {
+		thread = calloc(1, sizeof(*thread));
+		ThreadLocalSetKey(_asyncThreadKey, thread);
+	}
+	if (thread->serial == context->serial) {
+		return thread->queue;
+	}
+
+	MutexLock(&context->mutex);
+	struct mAsyncLogQueue* queue;
+	for (queue = context->queues; queue; queue = queue->next) {
+		if (queue->thread == thread) {
+			break;
+		}
+	}
+	if (!queue) {
+		queue = malloc(sizeof(*queue));
+		queue->thread = thread;
+		RingFIFOInit(&queue->fifo, sizeof(struct mAsyncLogRecord) * ASYNC_LOG_RECORDS);
+		queue->next = context->queues;
+		ATOMIC_STORE_PTR(context->queues, queue);
+	}
+	MutexUnlock(&context->mutex);
+	thread->serial = context->serial;
+	thread->queue = queue;
+	return queue;
+}
+#endif
+
+static void _asyncLog(struct mLogger* logger, int category, enum mLogLevel level, const char* format, va_list args) {
+	struct mAsyncLogger* async = (struct mAsyncLogger*) logger;
+#ifdef DISABLE_THREADING
+	async->backend->log(async->backend, category, level, format, args);
+#else
+	struct mAsyncLogContext* context = async->context;
+	struct mAsyncLogQueue* queue = _asyncGetQueue(context);
+
+	struct mAsyncLogRecord record;
+	record.category = category;
+	record.level = level;
+	record.spill = NULL;
+	va_list argc;
+	va_copy(argc, args);
+	int length = vsnprintf(record.text, sizeof(record.text), format, argc);
+	va_end(argc);
+	if (length < 0) {
+		return;
+	}
+	if ((size_t) length >= sizeof(record.text)) {
+		// Keep long messages intact and in order rather than truncating them
+		record.spill = malloc(length + 1);
+		vsnprintf(record.spill, length + 1, format, args);
+	}
+	if (!RingFIFOWrite(&queue->fifo, &record, sizeof(record))) {
+		free(record.spill);
+		ATOMIC_ADD(context->dropped, 1);
+		return;
+	}
+
+	int pending;
+	ATOMIC_LOAD(pending, context->pending);
+	if (!pending) {
+		MutexLock(&context->mutex);
+		ATOMIC_STORE(context->pending, 1);
+		ConditionWake(&context->workerCond);
+		MutexUnlock(&context->mutex);
+	}
+#endif
+}
+
+void mAsyncLoggerInit(struct mAsyncLogger* logger, struct mLogger* backend) {
+	logger->d.log = _asyncLog;
+	logger->d.filter = backend->filter;
+	logger->backend = backend;
+	logger->context = calloc(1, sizeof(*logger->context));
+#ifndef DISABLE_THREADING
+	static unsigned serial = 0;
+	struct mAsyncLogContext* context = logger->context;
+	// Contexts can be reallocated at the same address, so threads match them by serial
+	context->serial = ATOMIC_ADD(serial, 1);
+	MutexInit(&context->mutex);
+	ConditionInit(&context->workerCond);
+	ConditionInit(&context->clientCond);
+	ThreadCreate(&context->thread, _asyncRun, logger);
+#endif
+}
+
+void mAsyncLoggerDeinit(struct mAsyncLogger* logger) {
+	struct mAsyncLogContext* context = logger->context;
+#ifndef DISABLE_THREADING
+	MutexLock(&context->mutex);
+	context->shutdown = true;
+	ConditionWake(&context->workerCond);
+	MutexUnlock(&context->mutex);
+	ThreadJoin(&context->thread);
+
+	ConditionDeinit(&context->clientCond);
+	ConditionDeinit(&context->workerCond);
+	MutexDeinit(&context->mutex);
+#endif
+
+	_asyncDrain(logger);
+	while (context->queues) {
+		struct mAsyncLogQueue* queue = context->queues;
+		context->queues = queue->next;
+		RingFIFODeinit(&queue->fifo);
+		free(queue);
+	}
+	free(context);
+	logger->context = NULL;
+}
+
+void mAsyncLoggerFlush(struct mAsyncLogger* logger) {
+#ifndef DISABLE_THREADING
+	struct mAsyncLogContext* context = logger->context;
+	MutexLock(&context->mutex);
+	// A drain that's already running may have passed this thread's queue, so wait for the next one
+	unsigned target = context->generation + (context->draining ? 2 : 1);
+	ATOMIC_STORE(context->pending, 1);
+	ConditionWake(&context->workerCond);
+	while ((int) (context->generation - target) < 0) {
+		ConditionWait(&context->clientCond, &context->mutex);
+	}
+	MutexUnlock(&context->mutex);
+#else
+	UNUSED(logger);
+#endif
+}
+
 mLOG_DEFINE_CATEGORY(STATUS, "Status", "core.status")
+mLOG_DEFINE_CATEGORY(LOG, "Logging", "core.log")
@@ -143,7 +143,7 @@ uint32_t mMapCacheTileId(struct mMapCache* cache, unsigned x, unsigned y) {
 	return stride * y + x;
 }
 
-void mMapCacheCleanTile(struct mMapCache* cache, struct mMapCacheEntry* entry, unsigned x, unsigned y) {
+bool mMapCacheCleanTile(struct mMapCache* cache, struct mMapCacheEntry* entry, unsigned x, unsigned y) {
 	size_t location = mMapCacheTileId(cache, x, y);
 	struct mMapCacheEntry* status = &cache->status[location];
 	const mColor* tile = NULL;
@@ -158,7 +158,7 @@ void mMapCacheCleanTile(struct mMapCache* cache, struct mMapCacheEntry* entry, u
 	tile = mTileCacheGetTileIfDirty(cache->tileCache, status->tileStatus, tileId, mMapCacheEntryFlagsGetPaletteId(status->flags));
 	if (!tile) {
 		if (mMapCacheEntryFlagsIsVramClean(status->flags) && memcmp(status, &entry[location], sizeof(*entry)) == 0) {
-			return;
+			return false;
 		}
 		tile = mTileCacheGetTile(cache->tileCache, tileId, mMapCacheEntryFlagsGetPaletteId(status->flags));
 	}
@@ -167,6 +167,7 @@ void mMapCacheCleanTile(struct mMapCache* cache, struct mMapCacheEntry* entry, u
 	mColor* mapOut = &cache->cache[(y * stride + x) * 8];
 	_cleanTile(cache, tile, mapOut, status);
 	entry[location] = *status;
+	return true;
 }
 
 bool mMapCacheCheckTile(struct mMapCache* cache, const struct mMapCacheEntry* entry, unsigned x, unsigned y) {
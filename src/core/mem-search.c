@@ -7,8 +7,15 @@
 
 #include <mgba/core/core.h>
 #include <mgba/core/interface.h>
+#include <mgba-util/math.h>
+#include <mgba-util/threading.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 DEFINE_VECTOR(mCoreMemorySearchResults, struct mCoreMemorySearchResult);
+DEFINE_VECTOR(mCoreMemorySearchCandidateBlocks, struct mCoreMemorySearchCandidateBlock);
 
 static bool _op(int32_t value, int32_t match, enum mCoreMemorySearchOp op) {
 	switch (op) {
@@ -225,27 +232,141 @@ static size_t _search(const void* mem, size_t size, const struct mCoreMemoryBloc
 	return 0;
 }
 
+// Large blocks are split up so that threads can share them; this is a multiple of every search width
+#define SEARCH_CHUNK_SIZE 0x10000
+#define SEARCH_PARALLEL_THRESHOLD (SEARCH_CHUNK_SIZE * 2)
+#define SEARCH_MAX_THREADS 4
+
+struct mCoreMemorySearchTask {
+	const uint8_t* mem;
+	size_t size;
+	struct mCoreMemoryBlock block;
+	struct mCoreMemorySearchResults results;
+};
+
+struct mCoreMemorySearchJob {
+	const struct mCoreMemorySearchParams* params;
+	struct mCoreMemorySearchTask* tasks;
+	size_t nTasks;
+	size_t limit;
+#ifndef DISABLE_THREADING
+	size_t nextTask;
+	Mutex mutex;
+#endif
+};
+
+static void _runSearchTask(struct mCoreMemorySearchJob* job, struct mCoreMemorySearchTask* task) {
+	_search(task->mem, task->size, &task->block, job->params, &task->results, job->limit);
+}
+
+#ifndef DISABLE_THREADING
+static THREAD_ENTRY _searchThread(void* context) {
+	struct mCoreMemorySearchJob* job = context;
+	ThreadSetName("Memory Search");
+	while (true) {
+		MutexLock(&job->mutex);
+		size_t task = job->nextTask;
+		++job->nextTask;
+		MutexUnlock(&job->mutex);
+		if (task >= job->nTasks) {
+			break;
+		}
+		_runSearchTask(job, &job->tasks[task]);
+	}
+	THREAD_EXIT(0);
+}
+#endif
+
 void mCoreMemorySearch(struct mCore* core, const struct mCoreMemorySearchParams* params, struct mCoreMemorySearchResults* out, size_t limit) {
 	const struct mCoreMemoryBlock* blocks;
 	size_t nBlocks = core->listMemoryBlocks(core, &blocks);
-	size_t found = 0;
+	struct mCoreMemorySearchJob job = {
+		.params = params,
+		.limit = limit,
+	};
+	size_t tasksCapacity = 0;
+	size_t total = 0;
 
 	size_t b;
-	for (b = 0; (!limit || found < limit) && b < nBlocks; ++b) {
+	for (b = 0; b < nBlocks; ++b) {
 		size_t size;
 		const struct mCoreMemoryBlock* block = &blocks[b];
 		if (!(block->flags & params->memoryFlags)) {
 			continue;
 		}
-		void* mem = core->getMemoryBlock(core, block->id, &size);
+		const uint8_t* mem = core->getMemoryBlock(core, block->id, &size);
 		if (!mem) {
 			continue;
 		}
 		if (size > block->end - block->start) {
 			size = block->end - block->start; // TOOD: Segments
 		}
-		found += _search(mem, size, block, params, out, limit ? limit - found : 0);
+		total += size;
+		// Strings can straddle chunk boundaries, so they're always searched a block at a time
+		size_t offset;
+		for (offset = 0; offset < size || !offset; offset += SEARCH_CHUNK_SIZE) {
+			if (job.nTasks == tasksCapacity) {
+				tasksCapacity = tasksCapacity ? tasksCapacity * 2 : 16;
+				job.tasks = realloc(job.tasks, tasksCapacity * sizeof(*job.tasks));
+			}
+			struct mCoreMemorySearchTask* task = &job.tasks[job.nTasks];
+			++job.nTasks;
+			task->mem = &mem[offset];
+			task->size = size - offset;
+			task->block = *block;
+			task->block.start += offset;
+			if (params->type == mCORE_MEMORY_SEARCH_STRING) {
+				break;
+			}
+			if (task->size > SEARCH_CHUNK_SIZE) {
+				task->size = SEARCH_CHUNK_SIZE;
+			}
+		}
+	}
+
+	size_t i;
+	for (i = 0; i < job.nTasks; ++i) {
+		mCoreMemorySearchResultsInit(&job.tasks[i].results, 0);
+	}
+
+#ifndef DISABLE_THREADING
+	if (total >= SEARCH_PARALLEL_THRESHOLD && job.nTasks > 1) {
+		Thread threads[SEARCH_MAX_THREADS];
+		size_t nThreads = job.nTasks < SEARCH_MAX_THREADS ? job.nTasks : SEARCH_MAX_THREADS;
+		job.nextTask = 0;
+		MutexInit(&job.mutex);
+		for (i = 0; i < nThreads; ++i) {
+			ThreadCreate(&threads[i], _searchThread, &job);
+		}
+		for (i = 0; i < nThreads; ++i) {
+			ThreadJoin(&threads[i]);
+		}
+		MutexDeinit(&job.mutex);
+	} else
+#endif
+	{
+		for (i = 0; i < job.nTasks; ++i) {
+			_runSearchTask(&job, &job.tasks[i]);
+		}
+	}
+
+	// Merge in block and address order, so the results don't depend on which thread ran what
+	size_t found = 0;
+	for (i = 0; i < job.nTasks; ++i) {
+		struct mCoreMemorySearchResults* results = &job.tasks[i].results;
+		size_t size = mCoreMemorySearchResultsSize(results);
+		if (limit && size > limit - found) {
+			size = limit - found;
+		}
+		if (size) {
+			size_t base = mCoreMemorySearchResultsSize(out);
+			mCoreMemorySearchResultsResize(out, size);
+			memcpy(mCoreMemorySearchResultsGetPointer(out, base), mCoreMemorySearchResultsGetPointer(results, 0), size * sizeof(struct mCoreMemorySearchResult));
+			found += size;
+		}
+		mCoreMemorySearchResultsDeinit(results);
 	}
+	free(job.tasks);
 }
 
 bool _testSpecificGuess(struct mCore* core, struct mCoreMemorySearchResult* res, int64_t opValue, enum mCoreMemorySearchOp op) {
@@ -340,3 +461,385 @@ void mCoreMemorySearchRepeat(struct mCore* core, const struct mCoreMemorySearchP
 		}
 	}
 }
+
+// Every search op boils down to one of these, applied to either the value or its delta
+enum _mCandidateCompare {
+	CANDIDATE_EQUAL,
+	CANDIDATE_NOT_EQUAL,
+	CANDIDATE_GREATER,
+	CANDIDATE_LESS,
+	CANDIDATE_ALWAYS,
+};
+
+struct _mCandidateTest {
+	enum _mCandidateCompare compare;
+	int32_t match;
+	bool delta;
+	int width;
+};
+
+// Each bitmap word covers 32 slots, so that many bytes times the width are compared at once
+#define CANDIDATE_WORD_BYTES(WIDTH) (32 * (WIDTH))
+
+static void _candidateTest(struct _mCandidateTest* test, const struct mCoreMemorySearchParams* params, int width, bool repeat) {
+	test->width = width;
+	test->match = params->valueInt;
+	test->delta = repeat && params->op >= mCORE_MEMORY_SEARCH_DELTA;
+	switch (params->op) {
+	case mCORE_MEMORY_SEARCH_EQUAL:
+	case mCORE_MEMORY_SEARCH_DELTA:
+		test->compare = CANDIDATE_EQUAL;
+		break;
+	case mCORE_MEMORY_SEARCH_GREATER:
+		test->compare = CANDIDATE_GREATER;
+		break;
+	case mCORE_MEMORY_SEARCH_LESS:
+		test->compare = CANDIDATE_LESS;
+		break;
+	case mCORE_MEMORY_SEARCH_DELTA_POSITIVE:
+		test->compare = CANDIDATE_GREATER;
+		test->match = 0;
+		break;
+	case mCORE_MEMORY_SEARCH_DELTA_NEGATIVE:
+		test->compare = CANDIDATE_LESS;
+		test->match = 0;
+		break;
+	case mCORE_MEMORY_SEARCH_DELTA_ANY:
+		test->compare = CANDIDATE_NOT_EQUAL;
+		test->match = 0;
+		break;
+	case mCORE_MEMORY_SEARCH_ANY:
+		test->compare = CANDIDATE_ALWAYS;
+		break;
+	}
+	if (!repeat) {
+		// The first pass matches against the value truncated to the search width, like mCoreMemorySearch
+		switch (width) {
+		case 1:
+			test->match = (uint8_t) test->match;
+			break;
+		case 2:
+			test->match = (uint16_t) test->match;
+			break;
+		}
+	}
+}
+
+#if defined(__SSE2__)
+static inline unsigned _compare4(__m128i value, __m128i match, enum _mCandidateCompare compare) {
+	switch (compare) {
+	case CANDIDATE_EQUAL:
+		return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(value, match)));
+	case CANDIDATE_NOT_EQUAL:
+		return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(value, match))) ^ 0xF;
+	case CANDIDATE_GREATER:
+		return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(value, match)));
+	case CANDIDATE_LESS:
+		return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(value, match)));
+	case CANDIDATE_ALWAYS:
+		break;
+	}
+	return 0xF;
+}
+
+// Values are widened to 32-bit lanes so that deltas and comparisons behave exactly like the scalar code
+static uint32_t _compareWord(const uint8_t* mem, const uint8_t* old, const struct _mCandidateTest* test) {
+	__m128i match = _mm_set1_epi32(test->match);
+	__m128i zero = _mm_setzero_si128();
+	uint32_t bits = 0;
+	unsigned shift = 0;
+	size_t off;
+	for (off = 0; off < (size_t) CANDIDATE_WORD_BYTES(test->width); off += 16) {
+		__m128i lanes[4];
+		__m128i oldLanes[4];
+		__m128i value = _mm_loadu_si128((const __m128i*) &mem[off]);
+		__m128i oldValue = _mm_loadu_si128((const __m128i*) &old[off]);
+		int nLanes;
+		switch (test->width) {
+		case 1: {
+			__m128i lo = _mm_unpacklo_epi8(value, zero);
+			__m128i hi = _mm_unpackhi_epi8(value, zero);
+			lanes[0] = _mm_unpacklo_epi16(lo, zero);
+			lanes[1] = _mm_unpackhi_epi16(lo, zero);
+			lanes[2] = _mm_unpacklo_epi16(hi, zero);
+			lanes[3] = _mm_unpackhi_epi16(hi, zero);
+			lo = _mm_unpacklo_epi8(oldValue, zero);
+			hi = _mm_unpackhi_epi8(oldValue, zero);
+			oldLanes[0] = _mm_unpacklo_epi16(lo, zero);
+			oldLanes[1] = _mm_unpackhi_epi16(lo, zero);
+			oldLanes[2] = _mm_unpacklo_epi16(hi, zero);
+			oldLanes[3] = _mm_unpackhi_epi16(hi, zero);
+			nLanes = 4;
+			break;
+		}
+		case 2:
+			lanes[0] = _mm_unpacklo_epi16(value, zero);
+			lanes[1] = _mm_unpackhi_epi16(value, zero);
+			oldLanes[0] = _mm_unpacklo_epi16(oldValue, zero);
+			oldLanes[1] = _mm_unpackhi_epi16(oldValue, zero);
+			nLanes = 2;
+			break;
+		case 4:
+		default:
+			lanes[0] = value;
+			oldLanes[0] = oldValue;
+			nLanes = 1;
+			break;
+		}
+		int i;
+		for (i = 0; i < nLanes; ++i) {
+			__m128i lane = lanes[i];
+			if (test->delta) {
+				lane = _mm_sub_epi32(lane, oldLanes[i]);
+			}
+			bits |= _compare4(lane, match, test->compare) << shift;
+			shift += 4;
+		}
+	}
+	return bits;
+}
+#else
+static inline int32_t _candidateValue(const uint8_t* mem, size_t off, int width) {
+	uint32_t value;
+	uint16_t value16;
+	switch (width) {
+	case 1:
+		return mem[off];
+	case 2:
+		LOAD_16LE(value16, off, mem);
+		return value16;
+	case 4:
+	default:
+		LOAD_32LE(value, off, mem);
+		return (int32_t) value;
+	}
+}
+
+static uint32_t _compareWord(const uint8_t* mem, const uint8_t* old, const struct _mCandidateTest* test) {
+	uint32_t bits = 0;
+	unsigned i;
+	for (i = 0; i < 32; ++i) {
+		int32_t value = _candidateValue(mem, i * test->width, test->width);
+		if (test->delta) {
+			value = (int32_t) ((uint32_t) value - (uint32_t) _candidateValue(old, i * test->width, test->width));
+		}
+		bool match;
+		switch (test->compare) {
+		case CANDIDATE_EQUAL:
+			match = value == test->match;
+			break;
+		case CANDIDATE_NOT_EQUAL:
+			match = value != test->match;
+			break;
+		case CANDIDATE_GREATER:
+			match = value > test->match;
+			break;
+		case CANDIDATE_LESS:
+			match = value < test->match;
+			break;
+		case CANDIDATE_ALWAYS:
+		default:
+			match = true;
+			break;
+		}
+		bits |= (uint32_t) match << i;
+	}
+	return bits;
+}
+#endif
+
+static size_t _narrowBlock(struct mCoreMemorySearchCandidateBlock* block, const uint8_t* mem, const struct _mCandidateTest* test) {
+	size_t wordBytes = CANDIDATE_WORD_BYTES(test->width);
+	size_t slots = block->size / test->width;
+	size_t nWords = (slots + 31) / 32;
+	size_t fullWords = slots / 32;
+	size_t count = 0;
+	size_t w;
+	for (w = 0; w < nWords; ++w) {
+		uint32_t bits = block->bitmap[w];
+		if (!bits) {
+			continue;
+		}
+		if (test->compare != CANDIDATE_ALWAYS) {
+			if (w < fullWords) {
+				bits &= _compareWord(&mem[w * wordBytes], &block->snapshot[w * wordBytes], test);
+			} else {
+				// Pad out the last partial word; its bits past the end are never set
+				uint8_t memTail[CANDIDATE_WORD_BYTES(4)] = {0};
+				uint8_t oldTail[CANDIDATE_WORD_BYTES(4)] = {0};
+				memcpy(memTail, &mem[w * wordBytes], block->size - w * wordBytes);
+				memcpy(oldTail, &block->snapshot[w * wordBytes], block->size - w * wordBytes);
+				bits &= _compareWord(memTail, oldTail, test);
+			}
+			block->bitmap[w] = bits;
+		}
+		count += popcount32(bits);
+	}
+	memcpy(block->snapshot, mem, block->size);
+	block->count = count;
+	return count;
+}
+
+static void _deinitCandidateBlock(struct mCoreMemorySearchCandidateBlock* block) {
+	free(block->snapshot);
+	free(block->bitmap);
+}
+
+void mCoreMemorySearchCandidatesInit(struct mCoreMemorySearchCandidates* candidates) {
+	mCoreMemorySearchCandidateBlocksInit(&candidates->blocks, 0);
+	candidates->width = 0;
+	candidates->count = 0;
+}
+
+void mCoreMemorySearchCandidatesDeinit(struct mCoreMemorySearchCandidates* candidates) {
+	mCoreMemorySearchCandidatesClear(candidates);
+	mCoreMemorySearchCandidateBlocksDeinit(&candidates->blocks);
+}
+
+void mCoreMemorySearchCandidatesClear(struct mCoreMemorySearchCandidates* candidates) {
+	size_t i;
+	for (i = 0; i < mCoreMemorySearchCandidateBlocksSize(&candidates->blocks); ++i) {
+		_deinitCandidateBlock(mCoreMemorySearchCandidateBlocksGetPointer(&candidates->blocks, i));
+	}
+	mCoreMemorySearchCandidateBlocksClear(&candidates->blocks);
+	candidates->width = 0;
+	candidates->count = 0;
+}
+
+bool mCoreMemorySearchCandidatesSearch(struct mCore* core, const struct mCoreMemorySearchParams* params, struct mCoreMemorySearchCandidates* out) {
+	mCoreMemorySearchCandidatesClear(out);
+	if (params->type != mCORE_MEMORY_SEARCH_INT) {
+		return false;
+	}
+	if (params->width != 1 && params->width != 2 && params->width != 4) {
+		return false;
+	}
+	if (params->align != params->width && params->align != -1) {
+		return false;
+	}
+	out->width = params->width;
+
+	struct _mCandidateTest test;
+	_candidateTest(&test, params, params->width, false);
+
+	const struct mCoreMemoryBlock* blocks;
+	size_t nBlocks = core->listMemoryBlocks(core, &blocks);
+	size_t b;
+	for (b = 0; b < nBlocks; ++b) {
+		size_t size;
+		const struct mCoreMemoryBlock* block = &blocks[b];
+		if (!(block->flags & params->memoryFlags)) {
+			continue;
+		}
+		const uint8_t* mem = core->getMemoryBlock(core, block->id, &size);
+		if (!mem) {
+			continue;
+		}
+		if (size > block->end - block->start) {
+			size = block->end - block->start; // TOOD: Segments
+		}
+		size -= size % params->width;
+		if (!size) {
+			continue;
+		}
+		size_t nWords = (size / params->width + 31) / 32;
+		struct mCoreMemorySearchCandidateBlock* candidates = mCoreMemorySearchCandidateBlocksAppend(&out->blocks);
+		candidates->id = block->id;
+		candidates->segment = -1; // TODO
+		candidates->start = block->start;
+		candidates->size = size;
+		candidates->snapshot = malloc(size);
+		candidates->bitmap = malloc(nWords * sizeof(uint32_t));
+		memset(candidates->bitmap, 0xFF, nWords * sizeof(uint32_t));
+		if ((size / params->width) & 31) {
+			candidates->bitmap[nWords - 1] = (1U << ((size / params->width) & 31)) - 1;
+		}
+		memcpy(candidates->snapshot, mem, size);
+		out->count += _narrowBlock(candidates, mem, &test);
+	}
+	return true;
+}
+
+size_t mCoreMemorySearchCandidatesNarrow(struct mCore* core, const struct mCoreMemorySearchParams* params, struct mCoreMemorySearchCandidates* inout) {
+	if (!inout->width) {
+		return 0;
+	}
+	struct _mCandidateTest test;
+	_candidateTest(&test, params, inout->width, true);
+
+	inout->count = 0;
+	size_t i;
+	for (i = 0; i < mCoreMemorySearchCandidateBlocksSize(&inout->blocks); ++i) {
+		struct mCoreMemorySearchCandidateBlock* block = mCoreMemorySearchCandidateBlocksGetPointer(&inout->blocks, i);
+		if (!block->count) {
+			continue;
+		}
+		size_t size;
+		const uint8_t* mem = core->getMemoryBlock(core, block->id, &size);
+		if (!mem || size < block->size) {
+			// The block went away or shrank, e.g. the save type changed
+			memset(block->bitmap, 0, (block->size / inout->width + 31) / 32 * sizeof(uint32_t));
+			block->count = 0;
+			continue;
+		}
+		inout->count += _narrowBlock(block, mem, &test);
+	}
+	return inout->count;
+}
+
+size_t mCoreMemorySearchCandidatesResults(const struct mCoreMemorySearchCandidates* candidates, struct mCoreMemorySearchResults* out, size_t offset, size_t limit) {
+	size_t found = 0;
+	size_t i;
+	for (i = 0; (!limit || found < limit) && i < mCoreMemorySearchCandidateBlocksSize(&candidates->blocks); ++i) {
+		const struct mCoreMemorySearchCandidateBlock* block = mCoreMemorySearchCandidateBlocksGetConstPointer(&candidates->blocks, i);
+		if (offset >= block->count) {
+			offset -= block->count;
+			continue;
+		}
+		size_t nWords = (block->size / candidates->width + 31) / 32;
+		size_t w;
+		for (w = 0; (!limit || found < limit) && w < nWords; ++w) {
+			uint32_t bits = block->bitmap[w];
+			if (offset) {
+				unsigned count = popcount32(bits);
+				if (offset >= count) {
+					offset -= count;
+					continue;
+				}
+				for (; offset; --offset) {
+					bits &= bits - 1;
+				}
+			}
+			while (bits && (!limit || found < limit)) {
+				size_t off = (w * 32 + ctz32(bits)) * candidates->width;
+				bits &= bits - 1;
+				struct mCoreMemorySearchResult* res = mCoreMemorySearchResultsAppend(out);
+				res->address = block->start + off;
+				res->type = mCORE_MEMORY_SEARCH_INT;
+				res->width = candidates->width;
+				res->segment = block->segment;
+				res->guessDivisor = 1;
+				res->guessMultiplier = 1;
+				switch (candidates->width) {
+				case 1:
+					res->oldValue = block->snapshot[off];
+					break;
+				case 2: {
+					uint16_t value;
+					LOAD_16LE(value, off, block->snapshot);
+					res->oldValue = value;
+					break;
+				}
+				case 4: {
+					uint32_t value;
+					LOAD_32LE(value, off, block->snapshot);
+					res->oldValue = value;
+					break;
+				}
+				}
+				++found;
+			}
+		}
+	}
+	return found;
+}
@@ -0,0 +1,491 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/movie.h>
+
+#include <mgba/core/core.h>
+#include <mgba/core/log.h>
+#include <mgba-util/vfs.h>
+
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+
+#define MOVIE_MAGIC 0x564D474D // "MGMV"
+#define MOVIE_VERSION 1
+#define MOVIE_HEADER_SIZE 40
+#define MOVIE_KEYFRAME_HEADER_SIZE 20
+#define MOVIE_KEYFRAME_COMPRESSED 1
+
+mLOG_DEFINE_CATEGORY(MOVIE, "Movie", "core.movie");
+
+DEFINE_VECTOR(mCoreMovieRunList, struct mCoreMovieRun);
+DEFINE_VECTOR(mCoreMovieKeyframeList, struct mCoreMovieKeyframe);
+
+void mCoreMovieInit(struct mCoreMovie* movie, unsigned keyframeInterval) {
+	memset(movie, 0, sizeof(*movie));
+	movie->keyframeInterval = keyframeInterval ? keyframeInterval : mCORE_MOVIE_DEFAULT_KEYFRAME_INTERVAL;
+	movie->platform = mPLATFORM_NONE;
+	mCoreMovieRunListInit(&movie->runs, 0);
+	mCoreMovieKeyframeListInit(&movie->keyframes, 0);
+}
+
+static void _clearKeyframes(struct mCoreMovie* movie, size_t first) {
+	size_t i;
+	for (i = first; i < mCoreMovieKeyframeListSize(&movie->keyframes); ++i) {
+		free(mCoreMovieKeyframeListGetPointer(&movie->keyframes, i)->data);
+	}
+	mCoreMovieKeyframeListResize(&movie->keyframes, (ssize_t) first - (ssize_t) mCoreMovieKeyframeListSize(&movie->keyframes));
+}
+
+static void _clear(struct mCoreMovie* movie) {
+	_clearKeyframes(movie, 0);
+	mCoreMovieRunListClear(&movie->runs);
+	movie->length = 0;
+	movie->rerecords = 0;
+	movie->frame = 0;
+	movie->run = 0;
+	movie->runOffset = 0;
+	movie->mode = mMOVIE_STOPPED;
+}
+
+void mCoreMovieDeinit(struct mCoreMovie* movie) {
+	_clearKeyframes(movie, 0);
+	mCoreMovieKeyframeListDeinit(&movie->keyframes);
+	mCoreMovieRunListDeinit(&movie->runs);
+	free(movie->scratch);
+	movie->scratch = NULL;
+	movie->scratchSize = 0;
+}
+
+static void* _scratch(struct mCoreMovie* movie, size_t size) {
+	if (size > movie->scratchSize) {
+		free(movie->scratch);
+		movie->scratch = malloc(size);
+		movie->scratchSize = size;
+	}
+	return movie->scratch;
+}
+
+static void _takeKeyframe(struct mCoreMovie* movie, struct mCore* core) {
+	size_t stateSize = core->stateSize(core);
+	void* savedata = NULL;
+	size_t savedataSize = 0;
+	if (core->savedataClone) {
+		savedataSize = core->savedataClone(core, &savedata);
+	}
+	size_t size = stateSize + savedataSize;
+	uint8_t* raw = _scratch(movie, size);
+	if (!core->saveState(core, raw)) {
+		free(savedata);
+		mLOG(MOVIE, WARN, "Failed to take keyframe at frame %u", movie->frame);
+		return;
+	}
+	if (savedataSize) {
+		memcpy(&raw[stateSize], savedata, savedataSize);
+	}
+	free(savedata);
+
+	struct mCoreMovieKeyframe* keyframe = mCoreMovieKeyframeListAppend(&movie->keyframes);
+	keyframe->frame = movie->frame;
+	keyframe->stateSize = stateSize;
+	keyframe->savedataSize = savedataSize;
+	keyframe->compressed = false;
+#ifdef USE_ZLIB
+	// Most of a state is zeroes or repeats, so this usually shrinks it several times over
+	uLongf packed = compressBound(size);
+	keyframe->data = malloc(packed);
+	if (compress2(keyframe->data, &packed, raw, size, Z_BEST_SPEED) == Z_OK && packed < size) {
+		keyframe->data = realloc(keyframe->data, packed);
+		keyframe->size = packed;
+		keyframe->compressed = true;
+		return;
+	}
+	free(keyframe->data);
+#endif
+	keyframe->data = malloc(size);
+	memcpy(keyframe->data, raw, size);
+	keyframe->size = size;
+}
+
+static bool _loadKeyframe(struct mCoreMovie* movie, struct mCore* core, const struct mCoreMovieKeyframe* keyframe) {
+	if (keyframe->stateSize != core->stateSize(core)) {
+		mLOG(MOVIE, ERROR, "Keyframe at frame %u is for a different core", keyframe->frame);
+		return false;
+	}
+	size_t size = keyframe->stateSize + keyframe->savedataSize;
+	const uint8_t* raw = keyframe->data;
+	if (keyframe->compressed) {
+#ifdef USE_ZLIB
+		uint8_t* unpacked = _scratch(movie, size);
+		uLongf unpackedSize = size;
+		if (uncompress(unpacked, &unpackedSize, keyframe->data, keyframe->size) != Z_OK || unpackedSize != size) {
+			mLOG(MOVIE, ERROR, "Keyframe at frame %u is corrupted", keyframe->frame);
+			return false;
+		}
+		raw = unpacked;
+#else
+		UNUSED(movie);
+		UNUSED(size);
+		mLOG(MOVIE, ERROR, "Keyframe at frame %u is compressed, but zlib is unavailable", keyframe->frame);
+		return false;
+#endif
+	}
+	if (!core->loadState(core, raw)) {
+		return false;
+	}
+	if (keyframe->savedataSize && core->savedataRestore) {
+		// Playing back shouldn't clobber the save file, so the savedata is only masked
+		core->savedataRestore(core, &raw[keyframe->stateSize], keyframe->savedataSize, false);
+	}
+	return true;
+}
+
+static void _findRun(struct mCoreMovie* movie) {
+	uint32_t frame = 0;
+	size_t i;
+	for (i = 0; i < mCoreMovieRunListSize(&movie->runs); ++i) {
+		const struct mCoreMovieRun* run = mCoreMovieRunListGetConstPointer(&movie->runs, i);
+		if (movie->frame < frame + run->frames) {
+			break;
+		}
+		frame += run->frames;
+	}
+	movie->run = i;
+	movie->runOffset = movie->frame - frame;
+}
+
+static uint32_t _nextKeys(struct mCoreMovie* movie) {
+	const struct mCoreMovieRun* run = mCoreMovieRunListGetConstPointer(&movie->runs, movie->run);
+	uint32_t keys = run->keys;
+	++movie->runOffset;
+	if (movie->runOffset == run->frames) {
+		++movie->run;
+		movie->runOffset = 0;
+	}
+	return keys;
+}
+
+static void _recordKeys(struct mCoreMovie* movie, uint32_t keys) {
+	size_t nRuns = mCoreMovieRunListSize(&movie->runs);
+	struct mCoreMovieRun* run = NULL;
+	if (nRuns) {
+		run = mCoreMovieRunListGetPointer(&movie->runs, nRuns - 1);
+	}
+	if (!run || run->keys != keys || run->frames == UINT32_MAX) {
+		run = mCoreMovieRunListAppend(&movie->runs);
+		run->keys = keys;
+		run->frames = 0;
+	}
+	++run->frames;
+	++movie->length;
+	movie->run = mCoreMovieRunListSize(&movie->runs);
+	movie->runOffset = 0;
+}
+
+static void _maybeTakeKeyframe(struct mCoreMovie* movie, struct mCore* core) {
+	if (movie->frame % movie->keyframeInterval) {
+		return;
+	}
+	size_t nKeyframes = mCoreMovieKeyframeListSize(&movie->keyframes);
+	// Keyframes are kept in order, and after seeking back the later ones are already there
+	if (nKeyframes && mCoreMovieKeyframeListGetConstPointer(&movie->keyframes, nKeyframes - 1)->frame >= movie->frame) {
+		return;
+	}
+	_takeKeyframe(movie, core);
+}
+
+bool mCoreMovieStartRecording(struct mCoreMovie* movie, struct mCore* core) {
+	_clear(movie);
+	movie->platform = core->platform(core);
+	core->checksum(core, &movie->romCrc32, mCHECKSUM_CRC32);
+	_takeKeyframe(movie, core);
+	if (!mCoreMovieKeyframeListSize(&movie->keyframes)) {
+		return false;
+	}
+	movie->mode = mMOVIE_RECORDING;
+	return true;
+}
+
+bool mCoreMovieStartPlayback(struct mCoreMovie* movie, struct mCore* core) {
+	if (!mCoreMovieIsCompatible(movie, core) || !mCoreMovieKeyframeListSize(&movie->keyframes)) {
+		return false;
+	}
+	movie->mode = mMOVIE_PLAYING;
+	if (!mCoreMovieSeek(movie, core, 0)) {
+		movie->mode = mMOVIE_STOPPED;
+		return false;
+	}
+	return true;
+}
+
+void mCoreMovieStop(struct mCoreMovie* movie) {
+	movie->mode = mMOVIE_STOPPED;
+}
+
+bool mCoreMovieRunFrame(struct mCoreMovie* movie, struct mCore* core, uint32_t keys) {
+	switch (movie->mode) {
+	case mMOVIE_STOPPED:
+		return false;
+	case mMOVIE_RECORDING:
+		_maybeTakeKeyframe(movie, core);
+		_recordKeys(movie, keys);
+		break;
+	case mMOVIE_PLAYING:
+		if (movie->frame >= movie->length) {
+			movie->mode = mMOVIE_STOPPED;
+			return false;
+		}
+		_maybeTakeKeyframe(movie, core);
+		keys = _nextKeys(movie);
+		break;
+	}
+	++movie->frame;
+	core->setKeys(core, keys);
+	core->runFrame(core);
+	return true;
+}
+
+bool mCoreMovieSeek(struct mCoreMovie* movie, struct mCore* core, uint32_t frame) {
+	if (frame > movie->length) {
+		return false;
+	}
+	const struct mCoreMovieKeyframe* keyframe = NULL;
+	size_t i;
+	for (i = mCoreMovieKeyframeListSize(&movie->keyframes); i > 0; --i) {
+		keyframe = mCoreMovieKeyframeListGetConstPointer(&movie->keyframes, i - 1);
+		if (keyframe->frame <= frame) {
+			break;
+		}
+	}
+	if (!i || !_loadKeyframe(movie, core, keyframe)) {
+		return false;
+	}
+	movie->frame = keyframe->frame;
+	_findRun(movie);
+
+	core->setRenderSkip(core, true);
+	core->setAudioSkip(core, true);
+	while (movie->frame < frame) {
+		// The last frame is shown, so that there's a picture of where the movie is. Mixing
+		// is also turned back on, since skipping it leaves stale samples in the state.
+		if (movie->frame + 1 == frame) {
+			core->setRenderSkip(core, false);
+			core->setAudioSkip(core, false);
+		}
+		_maybeTakeKeyframe(movie, core);
+		core->setKeys(core, _nextKeys(movie));
+		++movie->frame;
+		core->runFrame(core);
+	}
+	core->setRenderSkip(core, false);
+	core->setAudioSkip(core, false);
+
+	if (movie->mode == mMOVIE_RECORDING && frame < movie->length) {
+		// Cut the runs off at the frame, and drop any keyframes past it
+		if (movie->runOffset) {
+			mCoreMovieRunListGetPointer(&movie->runs, movie->run)->frames = movie->runOffset;
+			++movie->run;
+			movie->runOffset = 0;
+		}
+		mCoreMovieRunListResize(&movie->runs, (ssize_t) movie->run - (ssize_t) mCoreMovieRunListSize(&movie->runs));
+		for (i = 0; i < mCoreMovieKeyframeListSize(&movie->keyframes); ++i) {
+			if (mCoreMovieKeyframeListGetConstPointer(&movie->keyframes, i)->frame > frame) {
+				break;
+			}
+		}
+		_clearKeyframes(movie, i);
+		movie->length = frame;
+		++movie->rerecords;
+	}
+	return true;
+}
+
+bool mCoreMovieGetKeys(const struct mCoreMovie* movie, uint32_t frame, uint32_t* keys) {
+	if (frame >= movie->length) {
+		return false;
+	}
+	size_t i;
+	for (i = 0; i < mCoreMovieRunListSize(&movie->runs); ++i) {
+		const struct mCoreMovieRun* run = mCoreMovieRunListGetConstPointer(&movie->runs, i);
+		if (frame < run->frames) {
+			*keys = run->keys;
+			return true;
+		}
+		frame -= run->frames;
+	}
+	return false;
+}
+
+bool mCoreMovieIsCompatible(const struct mCoreMovie* movie, struct mCore* core) {
+	if (movie->platform != (int) core->platform(core)) {
+		return false;
+	}
+	uint32_t crc32 = 0;
+	core->checksum(core, &crc32, mCHECKSUM_CRC32);
+	return crc32 == movie->romCrc32;
+}
+
+// Runs are written as pairs of variable-length integers, seven bits to a byte, which
+// takes two or three bytes for most of them
+static size_t _writeVarint(uint8_t* buffer, uint32_t value) {
+	size_t size = 0;
+	while (value >= 0x80) {
+		buffer[size] = (value & 0x7F) | 0x80;
+		value >>= 7;
+		++size;
+	}
+	buffer[size] = value;
+	return size + 1;
+}
+
+static bool _readVarint(struct VFile* vf, uint32_t* value) {
+	*value = 0;
+	unsigned shift;
+	for (shift = 0; shift < 35; shift += 7) {
+		uint8_t byte;
+		if (vf->read(vf, &byte, 1) != 1) {
+			return false;
+		}
+		*value |= (uint32_t) (byte & 0x7F) << shift;
+		if (!(byte & 0x80)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool mCoreMovieSave(const struct mCoreMovie* movie, struct VFile* vf) {
+	uint8_t header[MOVIE_HEADER_SIZE];
+	size_t nRuns = mCoreMovieRunListSize(&movie->runs);
+	size_t nKeyframes = mCoreMovieKeyframeListSize(&movie->keyframes);
+	STORE_32LE(MOVIE_MAGIC, 0, header);
+	STORE_32LE(MOVIE_VERSION, 4, header);
+	STORE_32LE(movie->platform, 8, header);
+	STORE_32LE(movie->romCrc32, 12, header);
+	STORE_32LE(movie->keyframeInterval, 16, header);
+	STORE_32LE(movie->length, 20, header);
+	STORE_32LE(movie->rerecords, 24, header);
+	STORE_32LE(nRuns, 28, header);
+	STORE_32LE(nKeyframes, 32, header);
+	STORE_32LE(0, 36, header);
+	if (vf->write(vf, header, sizeof(header)) != sizeof(header)) {
+		return false;
+	}
+
+	uint8_t buffer[0x400];
+	size_t buffered = 0;
+	size_t i;
+	for (i = 0; i < nRuns; ++i) {
+		const struct mCoreMovieRun* run = mCoreMovieRunListGetConstPointer(&movie->runs, i);
+		buffered += _writeVarint(&buffer[buffered], run->frames);
+		buffered += _writeVarint(&buffer[buffered], run->keys);
+		if (buffered > sizeof(buffer) - 10 || i + 1 == nRuns) {
+			if (vf->write(vf, buffer, buffered) != (ssize_t) buffered) {
+				return false;
+			}
+			buffered = 0;
+		}
+	}
+
+	for (i = 0; i < nKeyframes; ++i) {
+		const struct mCoreMovieKeyframe* keyframe = mCoreMovieKeyframeListGetConstPointer(&movie->keyframes, i);
+		uint8_t keyframeHeader[MOVIE_KEYFRAME_HEADER_SIZE];
+		STORE_32LE(keyframe->frame, 0, keyframeHeader);
+		STORE_32LE(keyframe->stateSize, 4, keyframeHeader);
+		STORE_32LE(keyframe->savedataSize, 8, keyframeHeader);
+		STORE_32LE(keyframe->size, 12, keyframeHeader);
+		STORE_32LE(keyframe->compressed ? MOVIE_KEYFRAME_COMPRESSED : 0, 16, keyframeHeader);
+		if (vf->write(vf, keyframeHeader, sizeof(keyframeHeader)) != sizeof(keyframeHeader)) {
+			return false;
+		}
+		if (vf->write(vf, keyframe->data, keyframe->size) != (ssize_t) keyframe->size) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool mCoreMovieLoad(struct mCoreMovie* movie, struct VFile* vf) {
+	_clear(movie);
+	uint8_t header[MOVIE_HEADER_SIZE];
+	if (vf->read(vf, header, sizeof(header)) != sizeof(header)) {
+		return false;
+	}
+	uint32_t magic;
+	uint32_t version;
+	uint32_t value;
+	uint32_t nRuns;
+	uint32_t nKeyframes;
+	LOAD_32LE(magic, 0, header);
+	LOAD_32LE(version, 4, header);
+	if (magic != MOVIE_MAGIC || version != MOVIE_VERSION) {
+		mLOG(MOVIE, ERROR, "Not a movie, or from a newer version");
+		return false;
+	}
+	LOAD_32LE(value, 8, header);
+	movie->platform = (int32_t) value;
+	LOAD_32LE(movie->romCrc32, 12, header);
+	LOAD_32LE(value, 16, header);
+	movie->keyframeInterval = value ? value : mCORE_MOVIE_DEFAULT_KEYFRAME_INTERVAL;
+	LOAD_32LE(movie->length, 20, header);
+	LOAD_32LE(value, 24, header);
+	movie->rerecords = value;
+	LOAD_32LE(nRuns, 28, header);
+	LOAD_32LE(nKeyframes, 32, header);
+
+	uint32_t length = 0;
+	uint32_t i;
+	for (i = 0; i < nRuns; ++i) {
+		struct mCoreMovieRun run;
+		if (!_readVarint(vf, &run.frames) || !_readVarint(vf, &run.keys) || !run.frames || run.frames > movie->length - length) {
+			goto error;
+		}
+		*mCoreMovieRunListAppend(&movie->runs) = run;
+		length += run.frames;
+	}
+	if (length != movie->length) {
+		goto error;
+	}
+
+	uint32_t lastFrame = 0;
+	for (i = 0; i < nKeyframes; ++i) {
+		uint8_t keyframeHeader[MOVIE_KEYFRAME_HEADER_SIZE];
+		if (vf->read(vf, keyframeHeader, sizeof(keyframeHeader)) != sizeof(keyframeHeader)) {
+			goto error;
+		}
+		struct mCoreMovieKeyframe keyframe;
+		uint32_t flags;
+		LOAD_32LE(keyframe.frame, 0, keyframeHeader);
+		LOAD_32LE(keyframe.stateSize, 4, keyframeHeader);
+		LOAD_32LE(keyframe.savedataSize, 8, keyframeHeader);
+		LOAD_32LE(keyframe.size, 12, keyframeHeader);
+		LOAD_32LE(flags, 16, keyframeHeader);
+		keyframe.compressed = flags & MOVIE_KEYFRAME_COMPRESSED;
+		// The first keyframe has to be where the movie starts, and the rest in order after it
+		if ((i == 0) != (keyframe.frame == 0) || (i && keyframe.frame <= lastFrame) || keyframe.frame > movie->length) {
+			goto error;
+		}
+		if (keyframe.stateSize > 0x1000000 || keyframe.savedataSize > 0x1000000 || keyframe.size > keyframe.stateSize + keyframe.savedataSize + 0x10000) {
+			goto error;
+		}
+		keyframe.data = malloc(keyframe.size);
+		if (vf->read(vf, keyframe.data, keyframe.size) != (ssize_t) keyframe.size) {
+			free(keyframe.data);
+			goto error;
+		}
+		*mCoreMovieKeyframeListAppend(&movie->keyframes) = keyframe;
+		lastFrame = keyframe.frame;
+	}
+	if (!nKeyframes) {
+		goto error;
+	}
+	return true;
+
+error:
+	mLOG(MOVIE, ERROR, "Movie is truncated or corrupted");
+	_clear(movie);
+	return false;
+}
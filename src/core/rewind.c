@@ -6,34 +6,117 @@
 #include <mgba/core/rewind.h>
 
 #include <mgba/core/core.h>
+#include <mgba/core/host-trace.h>
+#include <mgba/core/log.h>
 #include <mgba/core/serialize.h>
+#include <mgba-util/math.h>
 #include <mgba-util/patch/fast.h>
 #include <mgba-util/vfs.h>
 
-DEFINE_VECTOR(mCoreRewindPatches, struct PatchFast);
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+
+// Below this much data to diff, waking the workers costs more than it saves
+#define PARALLEL_DIFF_THRESHOLD 0x10000
+#define KEYFRAME_INTERVAL 64
+// Roughly how many deltas can be applied in the time it takes to unpack a keyframe
+#define KEYFRAME_COST 16
+// Dropped entries are only moved out of the list once this many have piled up
+#define COMPACT_THRESHOLD 256
+// Spill files are started over once they reach this size, so old ones can be deleted whole
+#define SPILL_SEGMENT_SIZE 0x4000000
+
+mLOG_DEFINE_CATEGORY(REWIND, "Rewind", "core.rewind");
+
+DEFINE_VECTOR(mCoreRewindEntries, struct mCoreRewindEntry);
+DEFINE_VECTOR(mCoreRewindSpillSegments, struct mCoreRewindSpillSegment);
+
+struct mCoreRewindDeltaRecord {
+	uint32_t offset;
+	uint32_t length;
+};
 
 static void _rewindDiff(struct mCoreRewindContext* context);
+static void _diffRanges(struct PatchFast* patch, const void* in, const void* out, const struct mStateRangeList* ranges, size_t start, size_t end);
+static bool _reconstruct(struct mCoreRewindContext* context, size_t slot);
+static void _truncateHistory(struct mCoreRewindContext* context, size_t end);
+static void _dropOldest(struct mCoreRewindContext* context);
+static bool _spillOldest(struct mCoreRewindContext* context);
+static const void* _entryBlock(struct mCoreRewindContext* context, const struct mCoreRewindEntry* entry, bool keyframe);
 
 #ifndef DISABLE_THREADING
 THREAD_ENTRY _rewindThread(void* context);
+static THREAD_ENTRY _workerThread(void* context);
+static bool _rewindDiffParallel(struct mCoreRewindContext* context, struct PatchFast* patch, const void* in, const void* out);
+static void _stopWorkers(struct mCoreRewindContext* context);
 #endif
 
+static inline void _lock(struct mCoreRewindContext* context) {
+#ifndef DISABLE_THREADING
+	if (context->onThread) {
+		mTRACE_BEGIN("Rewind: lock");
+		MutexLock(&context->mutex);
+		mTRACE_END();
+	}
+	// A state that hasn't been diffed yet has to be stored before anything else happens
+	if (context->ready) {
+		_rewindDiff(context);
+		context->ready = false;
+	}
+#else
+	UNUSED(context);
+#endif
+}
+
+static inline void _unlock(struct mCoreRewindContext* context) {
+#ifndef DISABLE_THREADING
+	if (context->onThread) {
+		MutexUnlock(&context->mutex);
+	}
+#else
+	UNUSED(context);
+#endif
+}
+
 void mCoreRewindContextInit(struct mCoreRewindContext* context, size_t entries, bool onThread) {
 	if (context->currentState) {
 		return;
 	}
-	mCoreRewindPatchesInit(&context->patchMemory, entries);
-	size_t e;
-	for (e = 0; e < entries; ++e) {
-		initPatchFast(mCoreRewindPatchesAppend(&context->patchMemory));
-	}
+	mCoreRewindEntriesInit(&context->entries, 0);
+	context->first = 0;
+	context->position = 0;
+	context->maxEntries = entries;
+	context->memoryLimit = 0;
+	context->memoryUsed = 0;
+	context->sinceKeyframe = 0;
+	initPatchFast(&context->patch);
+	context->diffBuffer = NULL;
+	context->diffBufferSize = 0;
+	context->compressBuffer = NULL;
+	context->compressBufferSize = 0;
 	context->previousState = VFileMemChunk(0, 0);
 	context->currentState = VFileMemChunk(0, 0);
-	context->size = 0;
+	context->previousCheckpoint = 0;
+	context->currentCheckpoint = 0;
+	mStateRangeListInit(&context->written, 8);
 	context->rewindFrameCounter = 0;
+	context->spillDir = NULL;
+	context->spillName = NULL;
+	context->spillLimit = 0;
+	context->spillUsed = 0;
+	context->spilled = 0;
+	mCoreRewindSpillSegmentsInit(&context->spillSegments, 0);
+	context->nextSpillSegment = 1;
+	context->spillBuffer = NULL;
+	context->spillBufferSize = 0;
 #ifndef DISABLE_THREADING
 	context->onThread = onThread;
 	context->ready = false;
+	context->nWorkers = 0;
+	context->workers = NULL;
+	memset(&context->threadPolicy, 0, sizeof(context->threadPolicy));
+	context->threadPolicyGeneration = 0;
 	if (onThread) {
 		MutexInit(&context->mutex);
 		ConditionInit(&context->cond);
@@ -58,28 +141,135 @@ void mCoreRewindContextDeinit(struct mCoreRewindContext* context) {
 		MutexDeinit(&context->mutex);
 		ConditionDeinit(&context->cond);
 	}
+	_stopWorkers(context);
 #endif
 	context->previousState->close(context->previousState);
 	context->currentState->close(context->currentState);
 	context->previousState = NULL;
 	context->currentState = NULL;
-	size_t s;
-	for (s = 0; s < mCoreRewindPatchesSize(&context->patchMemory); ++s) {
-		deinitPatchFast(mCoreRewindPatchesGetPointer(&context->patchMemory, s));
+	mStateRangeListDeinit(&context->written);
+	_truncateHistory(context, 0);
+	mCoreRewindEntriesDeinit(&context->entries);
+	mCoreRewindSpillSegmentsDeinit(&context->spillSegments);
+	deinitPatchFast(&context->patch);
+	free(context->diffBuffer);
+	free(context->compressBuffer);
+	free(context->spillBuffer);
+	free(context->spillName);
+	context->diffBuffer = NULL;
+	context->compressBuffer = NULL;
+	context->spillBuffer = NULL;
+	context->spillName = NULL;
+}
+
+void mCoreRewindContextSetWorkers(struct mCoreRewindContext* context, unsigned workers) {
+#ifndef DISABLE_THREADING
+	if (!context->currentState) {
+		return;
 	}
-	mCoreRewindPatchesDeinit(&context->patchMemory);
+	if (workers > mCORE_REWIND_MAX_WORKERS) {
+		workers = mCORE_REWIND_MAX_WORKERS;
+	}
+	if (workers < 2) {
+		workers = 0;
+	}
+	if (workers == context->nWorkers) {
+		return;
+	}
+	_lock(context);
+	_stopWorkers(context);
+	if (workers) {
+		MutexInit(&context->workerMutex);
+		ConditionInit(&context->workerCond);
+		ConditionInit(&context->workerDoneCond);
+		context->workerJob = 0;
+		context->workersPending = 0;
+		context->workersStopping = false;
+		// The thread asking for the diff takes the first share itself
+		context->nWorkers = workers;
+		context->workers = calloc(workers - 1, sizeof(*context->workers));
+		unsigned i;
+		for (i = 0; i < workers - 1; ++i) {
+			struct mCoreRewindWorker* worker = &context->workers[i];
+			worker->p = context;
+			initPatchFast(&worker->patch);
+			ThreadCreate(&worker->thread, _workerThread, worker);
+		}
+	}
+	_unlock(context);
+#else
+	UNUSED(context);
+	UNUSED(workers);
+#endif
 }
 
-void mCoreRewindAppend(struct mCoreRewindContext* context, struct mCore* core) {
+void mCoreRewindContextSetMemoryLimit(struct mCoreRewindContext* context, size_t bytes) {
+	if (!context->currentState) {
+		return;
+	}
+	_lock(context);
+	context->memoryLimit = bytes;
+	_unlock(context);
+}
+
+void mCoreRewindContextSetThreadPolicy(struct mCoreRewindContext* context, const struct ThreadPolicy* policy) {
 #ifndef DISABLE_THREADING
-	if (context->onThread) {
-		MutexLock(&context->mutex);
+	if (!context->currentState) {
+		return;
 	}
+	_lock(context);
+	if (context->nWorkers) {
+		MutexLock(&context->workerMutex);
+	}
+	context->threadPolicy = *policy;
+	++context->threadPolicyGeneration;
+	if (context->nWorkers) {
+		MutexUnlock(&context->workerMutex);
+	}
+	_unlock(context);
+#else
+	UNUSED(context);
+	UNUSED(policy);
 #endif
+}
+
+#if defined(ENABLE_VFS) && defined(ENABLE_DIRECTORIES)
+void mCoreRewindContextSetSpill(struct mCoreRewindContext* context, struct VDir* dir, const char* name, size_t limit) {
+	if (!context->currentState) {
+		return;
+	}
+	if (!dir || !name || !limit) {
+		dir = NULL;
+		name = NULL;
+		limit = 0;
+	}
+	_lock(context);
+	if (dir != context->spillDir || (name && context->spillName && strcmp(name, context->spillName) != 0)) {
+		// Whatever was already spilled is somewhere else now, so the history can't be kept
+		if (context->spilled > context->first) {
+			_truncateHistory(context, 0);
+		}
+		free(context->spillName);
+		context->spillName = name ? strdup(name) : NULL;
+		context->spillDir = dir;
+	}
+	context->spillLimit = limit;
+	_unlock(context);
+}
+#endif
+
+void mCoreRewindAppend(struct mCoreRewindContext* context, struct mCore* core) {
+	_lock(context);
+	// The state being replaced is two appends old, so only what changed since then needs rewriting
 	struct VFile* nextState = context->previousState;
-	mCoreSaveStateNamed(core, nextState, SAVESTATE_SAVEDATA | SAVESTATE_RTC);
+	uint32_t checkpoint = context->previousCheckpoint;
+	mTRACE_BEGIN("Rewind: save state");
+	mCoreSaveStateIncremental(core, nextState, SAVESTATE_SAVEDATA | SAVESTATE_RTC, &checkpoint, &context->written);
+	mTRACE_END();
 	context->previousState = context->currentState;
 	context->currentState = nextState;
+	context->previousCheckpoint = context->currentCheckpoint;
+	context->currentCheckpoint = checkpoint;
 #ifndef DISABLE_THREADING
 	if (context->onThread) {
 		context->ready = true;
@@ -91,89 +281,571 @@ void mCoreRewindAppend(struct mCoreRewindContext* context, struct mCore* core) {
 	_rewindDiff(context);
 }
 
-void _rewindDiff(struct mCoreRewindContext* context) {
-	++context->current;
-	if (context->size < mCoreRewindPatchesSize(&context->patchMemory)) {
-		++context->size;
+static void _ensureBuffer(void** buffer, size_t* bufferSize, size_t size) {
+	if (size <= *bufferSize) {
+		return;
 	}
-	if (context->current >= mCoreRewindPatchesSize(&context->patchMemory)) {
-		context->current = 0;
+	*bufferSize = toPow2(size);
+	free(*buffer);
+	*buffer = malloc(*bufferSize);
+}
+
+// Resizes a state, making sure anything it grows into is zeroed, since diffs
+// between states of different sizes treat the shorter one as zero padded
+static void _resizeState(struct VFile* vf, size_t size) {
+	size_t oldSize = vf->size(vf);
+	vf->truncate(vf, size);
+	if (size > oldSize) {
+		uint8_t* state = vf->map(vf, size, MAP_WRITE);
+		memset(&state[oldSize], 0, size - oldSize);
+		vf->unmap(vf, state, size);
 	}
-	struct PatchFast* patch = mCoreRewindPatchesGetPointer(&context->patchMemory, context->current);
-	size_t size2 = context->currentState->size(context->currentState);
-	size_t size = context->previousState->size(context->previousState);
-	if (size2 > size) {
-		context->previousState->truncate(context->previousState, size2);
-		size = size2;
-	} else if (size > size2) {
-		context->currentState->truncate(context->currentState, size);
+}
+
+// Blocks are only kept compressed if that actually made them smaller, and are
+// stored as is otherwise, so equal sizes mean there's nothing to unpack
+static void* _pack(struct mCoreRewindContext* context, const void* data, size_t size, uint32_t* packedSize) {
+	void* block;
+#ifdef USE_ZLIB
+	uLongf packed = compressBound(size);
+	_ensureBuffer(&context->compressBuffer, &context->compressBufferSize, packed);
+	if (compress2(context->compressBuffer, &packed, data, size, Z_BEST_SPEED) == Z_OK && packed < size) {
+		block = malloc(packed);
+		memcpy(block, context->compressBuffer, packed);
+		*packedSize = packed;
+		return block;
 	}
-	void* current = context->previousState->map(context->previousState, size, MAP_READ);
-	void* next = context->currentState->map(context->currentState, size, MAP_READ);
-	diffPatchFast(patch, current, next, size);
-	context->previousState->unmap(context->previousState, current, size);
-	context->currentState->unmap(context->currentState, next, size);
+#else
+	UNUSED(context);
+#endif
+	block = malloc(size);
+	memcpy(block, data, size);
+	*packedSize = size;
+	return block;
 }
 
-bool mCoreRewindRestore(struct mCoreRewindContext* context, struct mCore* core, unsigned count) {
-#ifndef DISABLE_THREADING
-	if (context->onThread) {
-		MutexLock(&context->mutex);
+static bool _unpack(const void* block, uint32_t packedSize, void* data, size_t size) {
+	if (packedSize == size) {
+		memcpy(data, block, size);
+		return true;
 	}
+#ifdef USE_ZLIB
+	uLongf unpacked = size;
+	return uncompress(data, &unpacked, block, packedSize) == Z_OK && unpacked == size;
+#else
+	return false;
 #endif
-	if (!context->size) {
+}
+
+static void _packDelta(struct mCoreRewindContext* context, struct mCoreRewindEntry* entry) {
+	const struct PatchFastExtents* extents = &context->patch.extents;
+	size_t count = PatchFastExtentsSize(extents);
+	size_t size = 0;
+	size_t e;
+	for (e = 0; e < count; ++e) {
+		size += sizeof(struct mCoreRewindDeltaRecord) + PatchFastExtentsGetConstPointer(extents, e)->length;
+	}
+	if (!size) {
+		return;
+	}
+	_ensureBuffer(&context->diffBuffer, &context->diffBufferSize, size);
+	uint8_t* buffer = context->diffBuffer;
+	struct mCoreRewindDeltaRecord record = { 0, 0 };
+	size_t recordOffset = 0;
+	size_t used = 0;
+	for (e = 0; e < count; ++e) {
+		const struct PatchFastExtent* extent = PatchFastExtentsGetConstPointer(extents, e);
+		// Extents have a fixed maximum length, so long runs of changes are split up
+		if (!record.length || record.offset + record.length != extent->offset) {
+			if (record.length) {
+				memcpy(&buffer[recordOffset], &record, sizeof(record));
+			}
+			record.offset = extent->offset;
+			record.length = 0;
+			recordOffset = used;
+			used += sizeof(record);
+		}
+		memcpy(&buffer[used], extent->extent, extent->length);
+		used += extent->length;
+		record.length += extent->length;
+	}
+	memcpy(&buffer[recordOffset], &record, sizeof(record));
+	entry->deltaRawSize = used;
+	entry->delta = _pack(context, buffer, used, &entry->deltaSize);
+}
+
+static bool _applyDelta(struct mCoreRewindContext* context, const struct mCoreRewindEntry* entry, uint8_t* state, size_t size) {
+	if (!entry->deltaRawSize) {
+		return true;
+	}
+	const void* delta = _entryBlock(context, entry, false);
+	if (!delta) {
+		return false;
+	}
+	_ensureBuffer(&context->diffBuffer, &context->diffBufferSize, entry->deltaRawSize);
+	if (!_unpack(delta, entry->deltaSize, context->diffBuffer, entry->deltaRawSize)) {
+		return false;
+	}
+	const uint8_t* buffer = context->diffBuffer;
+	size_t used = 0;
+	while (used + sizeof(struct mCoreRewindDeltaRecord) <= entry->deltaRawSize) {
+		struct mCoreRewindDeltaRecord record;
+		memcpy(&record, &buffer[used], sizeof(record));
+		used += sizeof(record);
+		if (record.length > entry->deltaRawSize - used || record.offset > size || record.length > size - record.offset) {
+			return false;
+		}
+		uint32_t i;
+		for (i = 0; i < record.length; ++i) {
+			state[record.offset + i] ^= buffer[used + i];
+		}
+		used += record.length;
+	}
+	return true;
+}
+
+void _rewindDiff(struct mCoreRewindContext* context) {
+	mTRACE_BEGIN("Rewind: diff");
+	// Anything stored past the current position is replaced by the new state
+	_truncateHistory(context, context->position + 1);
+	struct mCoreRewindEntry entry = {0};
+	size_t previousSize = context->previousState->size(context->previousState);
+	size_t currentSize = context->currentState->size(context->currentState);
+	entry.stateSize = currentSize;
+	bool empty = mCoreRewindEntriesSize(&context->entries) == context->first;
+	if (!empty) {
+		size_t size = previousSize > currentSize ? previousSize : currentSize;
+		_resizeState(context->previousState, size);
+		_resizeState(context->currentState, size);
+		void* current = context->previousState->map(context->previousState, size, MAP_READ);
+		void* next = context->currentState->map(context->currentState, size, MAP_READ);
+		// Anything that wasn't rewritten is the same in both states
+		size_t end = 0;
+		size_t r;
+		for (r = 0; r < mStateRangeListSize(&context->written); ++r) {
+			struct mStateRange* range = mStateRangeListGetPointer(&context->written, r);
+			if (range->offset >= size) {
+				mStateRangeListResize(&context->written, (ssize_t) r - (ssize_t) mStateRangeListSize(&context->written));
+				break;
+			}
+			end = range->offset + range->size;
+			if (end > size) {
+				range->size = size - range->offset;
+				end = size;
+			}
+		}
+		mStateRangeListAdd(&context->written, end, size - end);
+		PatchFastExtentsClear(&context->patch.extents);
 #ifndef DISABLE_THREADING
-		if (context->onThread) {
-			MutexUnlock(&context->mutex);
+		if (!_rewindDiffParallel(context, &context->patch, current, next))
+#endif
+		{
+			_diffRanges(&context->patch, current, next, &context->written, 0, size);
+		}
+		context->previousState->unmap(context->previousState, current, size);
+		context->currentState->unmap(context->currentState, next, size);
+		context->previousState->truncate(context->previousState, previousSize);
+		context->currentState->truncate(context->currentState, currentSize);
+		_packDelta(context, &entry);
+		++context->sinceKeyframe;
+	}
+	if (empty || context->sinceKeyframe >= KEYFRAME_INTERVAL) {
+		void* state = context->currentState->map(context->currentState, currentSize, MAP_READ);
+		entry.keyframe = _pack(context, state, currentSize, &entry.keyframeSize);
+		context->currentState->unmap(context->currentState, state, currentSize);
+		context->sinceKeyframe = 0;
+	}
+	context->memoryUsed += entry.deltaSize + entry.keyframeSize;
+	*mCoreRewindEntriesAppend(&context->entries) = entry;
+	context->position = mCoreRewindEntriesSize(&context->entries) - 1;
+
+	while (context->position > context->first) {
+		size_t count = context->position - context->first + 1;
+		if (context->maxEntries && count > context->maxEntries) {
+			_dropOldest(context);
+		} else if (context->memoryLimit && context->memoryUsed > context->memoryLimit) {
+			if (!_spillOldest(context)) {
+				_dropOldest(context);
+			}
+		} else if (context->spillUsed > context->spillLimit) {
+			_dropOldest(context);
+		} else {
+			break;
 		}
+	}
+	if (context->first >= COMPACT_THRESHOLD && context->first * 2 >= mCoreRewindEntriesSize(&context->entries)) {
+		mCoreRewindEntriesShift(&context->entries, 0, context->first);
+		context->position -= context->first;
+		context->spilled -= context->first;
+		context->first = 0;
+	}
+	mTRACE_END();
+}
+
+// Diffs the part of the ranges that falls between start and end, counting only the bytes
+// inside of the ranges, so that the work can be split evenly
+static void _diffRanges(struct PatchFast* patch, const void* in, const void* out, const struct mStateRangeList* ranges, size_t start, size_t end) {
+	size_t position = 0;
+	size_t r;
+	for (r = 0; r < mStateRangeListSize(ranges) && position < end; ++r) {
+		const struct mStateRange* range = mStateRangeListGetConstPointer(ranges, r);
+		size_t first = start > position ? start - position : 0;
+		size_t last = end - position < range->size ? end - position : range->size;
+		if (first < last) {
+			diffPatchFastRange(patch, in, out, range->offset + first, last - first);
+		}
+		position += range->size;
+	}
+}
+
+static void _freeEntry(struct mCoreRewindContext* context, struct mCoreRewindEntry* entry) {
+	if (entry->spillSegment) {
+		context->spillUsed -= entry->deltaSize + entry->keyframeSize;
+	} else {
+		context->memoryUsed -= entry->deltaSize + entry->keyframeSize;
+	}
+	free(entry->delta);
+	free(entry->keyframe);
+	memset(entry, 0, sizeof(*entry));
+}
+
+static void _deleteSegment(struct mCoreRewindContext* context, struct mCoreRewindSpillSegment* segment) {
+	segment->vf->close(segment->vf);
+	segment->vf = NULL;
+#if defined(ENABLE_VFS) && defined(ENABLE_DIRECTORIES)
+	char name[PATH_MAX + 16];
+	snprintf(name, sizeof(name), "%s.rw%u", context->spillName, segment->id);
+	context->spillDir->deleteFile(context->spillDir, name);
+#else
+	UNUSED(context);
+#endif
+}
+
+static struct mCoreRewindSpillSegment* _openSegment(struct mCoreRewindContext* context) {
+#if defined(ENABLE_VFS) && defined(ENABLE_DIRECTORIES)
+	char name[PATH_MAX + 16];
+	snprintf(name, sizeof(name), "%s.rw%u", context->spillName, context->nextSpillSegment);
+	struct VFile* vf = context->spillDir->openFile(context->spillDir, name, O_CREAT | O_TRUNC | O_RDWR);
+	if (!vf) {
+		return NULL;
+	}
+	struct mCoreRewindSpillSegment* segment = mCoreRewindSpillSegmentsAppend(&context->spillSegments);
+	// Spilling happens a little at a time, so the writes are gathered up and flushed in the background
+	segment->vf = VFileAsync(vf);
+	segment->id = context->nextSpillSegment;
+	segment->size = 0;
+	++context->nextSpillSegment;
+	return segment;
+#else
+	UNUSED(context);
+	return NULL;
 #endif
+}
+
+static struct mCoreRewindSpillSegment* _findSegment(struct mCoreRewindContext* context, uint32_t id) {
+	size_t count = mCoreRewindSpillSegmentsSize(&context->spillSegments);
+	if (!count) {
+		return NULL;
+	}
+	uint32_t first = mCoreRewindSpillSegmentsGetPointer(&context->spillSegments, 0)->id;
+	if (id < first || id - first >= count) {
+		return NULL;
+	}
+	return mCoreRewindSpillSegmentsGetPointer(&context->spillSegments, id - first);
+}
+
+// Moves the oldest entry that's still in memory out to the end of the newest spill file
+static bool _spillOldest(struct mCoreRewindContext* context) {
+	if (!context->spillDir || !context->spillLimit || context->spilled >= context->position) {
+		return false;
+	}
+	struct mCoreRewindEntry* entry = mCoreRewindEntriesGetPointer(&context->entries, context->spilled);
+	uint32_t size = entry->deltaSize + entry->keyframeSize;
+	struct mCoreRewindSpillSegment* segment = NULL;
+	size_t count = mCoreRewindSpillSegmentsSize(&context->spillSegments);
+	if (count) {
+		segment = mCoreRewindSpillSegmentsGetPointer(&context->spillSegments, count - 1);
+		if (segment->size && segment->size + size > SPILL_SEGMENT_SIZE) {
+			segment = NULL;
+		}
+	}
+	if (!segment) {
+		segment = _openSegment(context);
+	}
+	if (!segment || segment->vf->seek(segment->vf, segment->size, SEEK_SET) < 0 ||
+	    (entry->deltaSize && segment->vf->write(segment->vf, entry->delta, entry->deltaSize) != (ssize_t) entry->deltaSize) ||
+	    (entry->keyframeSize && segment->vf->write(segment->vf, entry->keyframe, entry->keyframeSize) != (ssize_t) entry->keyframeSize)) {
+		mLOG(REWIND, ERROR, "Failed to spill rewind history, keeping it in memory only");
+		context->spillLimit = 0;
 		return false;
 	}
+	entry->spillSegment = segment->id;
+	entry->spillOffset = segment->size;
+	segment->size += size;
+	context->memoryUsed -= size;
+	context->spillUsed += size;
+	free(entry->delta);
+	free(entry->keyframe);
+	entry->delta = NULL;
+	entry->keyframe = NULL;
+	++context->spilled;
+	return true;
+}
 
-	for (; count && context->size; --count, --context->size) {
-		if (context->current == 0) {
-			context->current = mCoreRewindPatchesSize(&context->patchMemory);
+// Deletes the spill files older than the one the oldest entry is in, or all of them if
+// nothing is spilled anymore
+static void _releaseSegments(struct mCoreRewindContext* context) {
+	uint32_t live = 0;
+	if (context->spilled > context->first) {
+		live = mCoreRewindEntriesGetPointer(&context->entries, context->first)->spillSegment;
+	}
+	size_t count = mCoreRewindSpillSegmentsSize(&context->spillSegments);
+	size_t released;
+	for (released = 0; released < count; ++released) {
+		struct mCoreRewindSpillSegment* segment = mCoreRewindSpillSegmentsGetPointer(&context->spillSegments, released);
+		if (live && segment->id >= live) {
+			break;
 		}
-		--context->current;
+		_deleteSegment(context, segment);
+	}
+	mCoreRewindSpillSegmentsShift(&context->spillSegments, 0, released);
+}
+
+// Gets a block of an entry, reading it back in if it's been spilled
+static const void* _entryBlock(struct mCoreRewindContext* context, const struct mCoreRewindEntry* entry, bool keyframe) {
+	if (!entry->spillSegment) {
+		return keyframe ? entry->keyframe : entry->delta;
+	}
+	struct mCoreRewindSpillSegment* segment = _findSegment(context, entry->spillSegment);
+	if (!segment) {
+		return NULL;
+	}
+	uint32_t offset = entry->spillOffset;
+	uint32_t size = entry->deltaSize;
+	if (keyframe) {
+		offset += entry->deltaSize;
+		size = entry->keyframeSize;
+	}
+	_ensureBuffer(&context->spillBuffer, &context->spillBufferSize, size);
+	if (segment->vf->seek(segment->vf, offset, SEEK_SET) < 0 || segment->vf->read(segment->vf, context->spillBuffer, size) != (ssize_t) size) {
+		return NULL;
+	}
+	return context->spillBuffer;
+}
 
-		if (context->size > 1) {
-			struct PatchFast* patch = mCoreRewindPatchesGetPointer(&context->patchMemory, context->current);
-			size_t size2 = context->previousState->size(context->previousState);
-			size_t size = context->currentState->size(context->currentState);
-			if (size2 < size) {
-				size = size2;
+static void _truncateHistory(struct mCoreRewindContext* context, size_t end) {
+	size_t size = mCoreRewindEntriesSize(&context->entries);
+	if (end >= size) {
+		return;
+	}
+	if (end < context->spilled) {
+		// Cut the spill files back to just before the first entry being dropped
+		uint32_t keep = 0;
+		uint32_t offset = 0;
+		if (end > context->first) {
+			const struct mCoreRewindEntry* entry = mCoreRewindEntriesGetConstPointer(&context->entries, end);
+			keep = entry->spillSegment;
+			offset = entry->spillOffset;
+		}
+		while (mCoreRewindSpillSegmentsSize(&context->spillSegments)) {
+			struct mCoreRewindSpillSegment* segment = mCoreRewindSpillSegmentsGetPointer(&context->spillSegments, mCoreRewindSpillSegmentsSize(&context->spillSegments) - 1);
+			if (segment->id < keep) {
+				break;
+			}
+			if (segment->id == keep) {
+				segment->vf->truncate(segment->vf, offset);
+				segment->size = offset;
+				break;
 			}
-			void* current = context->currentState->map(context->currentState, size, MAP_READ);
-			void* previous = context->previousState->map(context->previousState, size, MAP_WRITE);
-			patch->d.applyPatch(&patch->d, previous, size, current, size);
-			context->currentState->unmap(context->currentState, current, size);
-			context->previousState->unmap(context->previousState, previous, size);
+			_deleteSegment(context, segment);
+			mCoreRewindSpillSegmentsResize(&context->spillSegments, -1);
+		}
+		context->spilled = end;
+	}
+	size_t slot;
+	for (slot = end; slot < size; ++slot) {
+		_freeEntry(context, mCoreRewindEntriesGetPointer(&context->entries, slot));
+	}
+	mCoreRewindEntriesResize(&context->entries, (ssize_t) end - (ssize_t) size);
+	if (end <= context->first) {
+		mCoreRewindEntriesClear(&context->entries);
+		context->first = 0;
+		context->position = 0;
+		context->spilled = 0;
+		return;
+	}
+	context->sinceKeyframe = KEYFRAME_INTERVAL;
+	for (slot = end; slot > context->first; --slot) {
+		if (mCoreRewindEntriesGetPointer(&context->entries, slot - 1)->keyframeSize) {
+			context->sinceKeyframe = end - slot;
+			break;
 		}
-		struct VFile* nextState = context->previousState;
-		context->previousState = context->currentState;
-		context->currentState = nextState;
 	}
+}
 
-	mCoreLoadStateNamed(core, context->currentState, SAVESTATE_SAVEDATA | SAVESTATE_RTC);
+static void _dropOldest(struct mCoreRewindContext* context) {
+	_freeEntry(context, mCoreRewindEntriesGetPointer(&context->entries, context->first));
+	++context->first;
+	if (context->spilled < context->first) {
+		context->spilled = context->first;
+	}
+	// The delta into the oldest state leads nowhere anymore
+	struct mCoreRewindEntry* oldest = mCoreRewindEntriesGetPointer(&context->entries, context->first);
+	if (oldest->spillSegment) {
+		// It stays in the file, which will be deleted whole later
+		context->spillUsed -= oldest->deltaSize;
+		oldest->spillOffset += oldest->deltaSize;
+	} else {
+		context->memoryUsed -= oldest->deltaSize;
+	}
+	free(oldest->delta);
+	oldest->delta = NULL;
+	oldest->deltaSize = 0;
+	oldest->deltaRawSize = 0;
+	_releaseSegments(context);
+}
 
+// Rebuilds the state in a given slot in the current state buffer, either by walking the
+// deltas from the current position, or from the nearest keyframe if that's quicker
+static bool _reconstruct(struct mCoreRewindContext* context, size_t slot) {
+	struct VFile* vf = context->currentState;
+	size_t position = context->position;
+	size_t distance = slot > position ? slot - position : position - slot;
+	size_t keyframe = slot;
+	bool useKeyframe = false;
+	size_t i;
+	for (i = context->first; i < mCoreRewindEntriesSize(&context->entries); ++i) {
+		if (!mCoreRewindEntriesGetPointer(&context->entries, i)->keyframeSize) {
+			continue;
+		}
+		size_t cost = (i > slot ? i - slot : slot - i) + KEYFRAME_COST;
+		if (cost < distance) {
+			distance = cost;
+			keyframe = i;
+			useKeyframe = true;
+		}
+	}
+	if (useKeyframe) {
+		const struct mCoreRewindEntry* entry = mCoreRewindEntriesGetPointer(&context->entries, keyframe);
+		const void* block = _entryBlock(context, entry, true);
+		if (!block) {
+			return false;
+		}
+		_resizeState(vf, entry->stateSize);
+		void* state = vf->map(vf, entry->stateSize, MAP_WRITE);
+		bool ok = _unpack(block, entry->keyframeSize, state, entry->stateSize);
+		vf->unmap(vf, state, entry->stateSize);
+		if (!ok) {
+			return false;
+		}
+		position = keyframe;
+	}
+	while (position != slot) {
+		size_t next = position < slot ? position + 1 : position - 1;
+		// Each delta is stored with the later of the two states it connects
+		const struct mCoreRewindEntry* delta = mCoreRewindEntriesGetPointer(&context->entries, position < next ? next : position);
+		size_t fromSize = mCoreRewindEntriesGetPointer(&context->entries, position)->stateSize;
+		size_t toSize = mCoreRewindEntriesGetPointer(&context->entries, next)->stateSize;
+		size_t size = fromSize > toSize ? fromSize : toSize;
+		_resizeState(vf, size);
+		void* state = vf->map(vf, size, MAP_WRITE);
+		bool ok = _applyDelta(context, delta, state, size);
+		vf->unmap(vf, state, size);
+		if (!ok) {
+			return false;
+		}
+		vf->truncate(vf, toSize);
+		position = next;
+	}
+	context->position = slot;
+	return true;
+}
 
-#ifndef DISABLE_THREADING
-	if (context->onThread) {
-		MutexUnlock(&context->mutex);
+static bool _seek(struct mCoreRewindContext* context, struct mCore* core, size_t slot) {
+	if (!_reconstruct(context, slot)) {
+		mLOG(REWIND, ERROR, "Rewind history is corrupted, discarding it");
+		_truncateHistory(context, 0);
+		context->previousCheckpoint = 0;
+		context->currentCheckpoint = 0;
+		return false;
 	}
-#endif
+	mCoreLoadStateNamed(core, context->currentState, SAVESTATE_SAVEDATA | SAVESTATE_RTC);
+	// The buffers no longer match the core's idea of what it last saved into them
+	context->previousCheckpoint = 0;
+	context->currentCheckpoint = 0;
 	return true;
 }
 
+bool mCoreRewindRestore(struct mCoreRewindContext* context, struct mCore* core, unsigned count) {
+	_lock(context);
+	if (!count || context->position <= context->first || mCoreRewindEntriesSize(&context->entries) == context->first) {
+		_unlock(context);
+		return false;
+	}
+	size_t slot = context->first;
+	if (count < context->position - context->first) {
+		slot = context->position - count;
+	}
+	bool success = _seek(context, core, slot);
+	_unlock(context);
+	return success;
+}
+
+size_t mCoreRewindCount(struct mCoreRewindContext* context) {
+	_lock(context);
+	size_t count = mCoreRewindEntriesSize(&context->entries) - context->first;
+	_unlock(context);
+	return count;
+}
+
+size_t mCoreRewindPosition(struct mCoreRewindContext* context) {
+	_lock(context);
+	size_t position = context->position - context->first;
+	_unlock(context);
+	return position;
+}
+
+size_t mCoreRewindMemoryUsage(struct mCoreRewindContext* context) {
+	if (!context->currentState) {
+		return 0;
+	}
+	_lock(context);
+	size_t usage = context->memoryUsed;
+	usage += context->entries.capacity * sizeof(struct mCoreRewindEntry);
+	usage += context->diffBufferSize + context->compressBufferSize + context->spillBufferSize;
+	usage += context->previousState->size(context->previousState);
+	usage += context->currentState->size(context->currentState);
+	_unlock(context);
+	return usage;
+}
+
+bool mCoreRewindSeek(struct mCoreRewindContext* context, struct mCore* core, size_t index) {
+	_lock(context);
+	size_t slot = context->first + index;
+	if (slot >= mCoreRewindEntriesSize(&context->entries)) {
+		_unlock(context);
+		return false;
+	}
+	bool success = _seek(context, core, slot);
+	_unlock(context);
+	return success;
+}
+
 #ifndef DISABLE_THREADING
 THREAD_ENTRY _rewindThread(void* context) {
 	struct mCoreRewindContext* rewindContext = context;
 	ThreadSetName("Rewind Diffing");
+	mTRACE_THREAD_NAME("Rewind Diffing");
+	unsigned policyGeneration = 0;
 	MutexLock(&rewindContext->mutex);
 	while (rewindContext->onThread) {
 		while (!rewindContext->ready && rewindContext->onThread) {
 			ConditionWait(&rewindContext->cond, &rewindContext->mutex);
 		}
+		if (policyGeneration != rewindContext->threadPolicyGeneration) {
+			policyGeneration = rewindContext->threadPolicyGeneration;
+			ThreadSetPolicy(&rewindContext->threadPolicy);
+		}
 		if (rewindContext->ready) {
 			_rewindDiff(rewindContext);
 		}
@@ -182,5 +854,105 @@ THREAD_ENTRY _rewindThread(void* context) {
 	MutexUnlock(&rewindContext->mutex);
 	THREAD_EXIT(0);
 }
-#endif
 
+static bool _rewindDiffParallel(struct mCoreRewindContext* context, struct PatchFast* patch, const void* in, const void* out) {
+	if (context->nWorkers < 2) {
+		return false;
+	}
+	size_t total = 0;
+	size_t r;
+	for (r = 0; r < mStateRangeListSize(&context->written); ++r) {
+		total += mStateRangeListGetConstPointer(&context->written, r)->size;
+	}
+	if (total < PARALLEL_DIFF_THRESHOLD) {
+		return false;
+	}
+	size_t share = ((total / context->nWorkers) + mSTATE_PAGE_SIZE - 1) & ~(size_t) (mSTATE_PAGE_SIZE - 1);
+	MutexLock(&context->workerMutex);
+	context->diffIn = in;
+	context->diffOut = out;
+	unsigned i;
+	for (i = 0; i < context->nWorkers - 1; ++i) {
+		struct mCoreRewindWorker* worker = &context->workers[i];
+		worker->start = share * (i + 1);
+		worker->end = i == context->nWorkers - 2 ? total : share * (i + 2);
+	}
+	context->workersPending = context->nWorkers - 1;
+	++context->workerJob;
+	ConditionWake(&context->workerCond);
+	MutexUnlock(&context->workerMutex);
+
+	_diffRanges(patch, in, out, &context->written, 0, share);
+
+	MutexLock(&context->workerMutex);
+	while (context->workersPending) {
+		ConditionWait(&context->workerDoneCond, &context->workerMutex);
+	}
+	MutexUnlock(&context->workerMutex);
+	for (i = 0; i < context->nWorkers - 1; ++i) {
+		appendPatchFast(patch, &context->workers[i].patch);
+	}
+	return true;
+}
+
+static THREAD_ENTRY _workerThread(void* context) {
+	struct mCoreRewindWorker* worker = context;
+	struct mCoreRewindContext* rewindContext = worker->p;
+	ThreadSetName("Rewind Diffing Worker");
+	mTRACE_THREAD_NAME("Rewind Diffing Worker");
+	// Jobs are counted from when the workers were started, so none can be missed before this runs
+	unsigned job = 0;
+	unsigned policyGeneration = 0;
+	MutexLock(&rewindContext->workerMutex);
+	while (true) {
+		while (job == rewindContext->workerJob && !rewindContext->workersStopping) {
+			ConditionWait(&rewindContext->workerCond, &rewindContext->workerMutex);
+		}
+		if (rewindContext->workersStopping) {
+			break;
+		}
+		job = rewindContext->workerJob;
+		if (policyGeneration != rewindContext->threadPolicyGeneration) {
+			policyGeneration = rewindContext->threadPolicyGeneration;
+			ThreadSetPolicy(&rewindContext->threadPolicy);
+		}
+		MutexUnlock(&rewindContext->workerMutex);
+
+		mTRACE_BEGIN("Rewind: diff range");
+		PatchFastExtentsClear(&worker->patch.extents);
+		if (worker->start < worker->end) {
+			_diffRanges(&worker->patch, rewindContext->diffIn, rewindContext->diffOut, &rewindContext->written, worker->start, worker->end);
+		}
+		mTRACE_END();
+
+		MutexLock(&rewindContext->workerMutex);
+		--rewindContext->workersPending;
+		if (!rewindContext->workersPending) {
+			ConditionWake(&rewindContext->workerDoneCond);
+		}
+	}
+	MutexUnlock(&rewindContext->workerMutex);
+	THREAD_EXIT(0);
+}
+
+static void _stopWorkers(struct mCoreRewindContext* context) {
+	if (!context->nWorkers) {
+		return;
+	}
+	MutexLock(&context->workerMutex);
+	context->workersStopping = true;
+	ConditionWake(&context->workerCond);
+	MutexUnlock(&context->workerMutex);
+	unsigned i;
+	for (i = 0; i < context->nWorkers - 1; ++i) {
+		ThreadJoin(&context->workers[i].thread);
+		deinitPatchFast(&context->workers[i].patch);
+	}
+	free(context->workers);
+	context->workers = NULL;
+	context->nWorkers = 0;
+	MutexDeinit(&context->workerMutex);
+	ConditionDeinit(&context->workerCond);
+	ConditionDeinit(&context->workerDoneCond);
+}
+#endif
@@ -0,0 +1,280 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/rollback.h>
+
+#include <mgba/core/core.h>
+#include <mgba/core/log.h>
+#include <mgba/core/serialize.h>
+
+mLOG_DEFINE_CATEGORY(ROLLBACK, "Rollback", "core.rollback");
+
+static void _defaultRunFrame(struct mCoreRollback* rollback, const uint32_t* keys) {
+	int i;
+	if (rollback->nCores == 1) {
+		struct mCore* core = rollback->cores[0];
+		uint32_t merged = 0;
+		for (i = 0; i < rollback->nPlayers; ++i) {
+			merged |= keys[i];
+		}
+		core->setKeys(core, merged);
+		core->runFrame(core);
+		return;
+	}
+	for (i = 0; i < rollback->nCores; ++i) {
+		struct mCore* core = rollback->cores[i];
+		core->setKeys(core, keys[i]);
+		core->runFrame(core);
+	}
+}
+
+static inline unsigned _allPlayers(const struct mCoreRollback* rollback) {
+	return (1U << rollback->nPlayers) - 1;
+}
+
+static struct mCoreRollbackInput* _input(struct mCoreRollback* rollback, uint32_t frame) {
+	struct mCoreRollbackInput* input = &rollback->inputs[frame % mCORE_ROLLBACK_INPUT_FRAMES];
+	if (input->frame != frame) {
+		input->frame = frame;
+		memset(input->keys, 0, sizeof(input->keys));
+		// Nobody can have pressed anything for the frames that the delay covers
+		input->confirmed = frame < rollback->inputDelay ? _allPlayers(rollback) : 0;
+	}
+	return input;
+}
+
+static void _saveState(struct mCoreRollback* rollback, uint32_t frame) {
+	uint8_t* state = rollback->states[frame % mCORE_ROLLBACK_MAX_FRAMES];
+	int i;
+	for (i = 0; i < rollback->nCores; ++i) {
+		struct mCore* core = rollback->cores[i];
+		core->saveState(core, state);
+		state += core->stateSize(core);
+	}
+}
+
+static void _loadState(struct mCoreRollback* rollback, uint32_t frame) {
+	const uint8_t* state = rollback->states[frame % mCORE_ROLLBACK_MAX_FRAMES];
+	int i;
+	for (i = 0; i < rollback->nCores; ++i) {
+		struct mCore* core = rollback->cores[i];
+		core->loadState(core, state);
+		state += core->stateSize(core);
+	}
+}
+
+static void _runFrame(struct mCoreRollback* rollback, uint32_t frame) {
+	struct mCoreRollbackInput* input = _input(rollback, frame);
+	int i;
+	for (i = 0; i < rollback->nPlayers; ++i) {
+		if (!(input->confirmed & (1 << i))) {
+			// Players usually hold the same buttons from one frame to the next
+			input->keys[i] = rollback->lastKeys[i];
+		}
+	}
+	rollback->runFrame(rollback, input->keys);
+}
+
+static struct mCoreRollbackChecksum* _checksum(struct mCoreRollback* rollback, uint32_t frame) {
+	struct mCoreRollbackChecksum* checksum = &rollback->checksums[(frame / rollback->checksumInterval) % mCORE_ROLLBACK_CHECKSUMS];
+	if (checksum->frame != frame) {
+		checksum->frame = frame;
+		checksum->known = 0;
+	}
+	return checksum;
+}
+
+static void _compareChecksum(struct mCoreRollback* rollback, struct mCoreRollbackChecksum* checksum) {
+	if (!(checksum->known & (1 << rollback->localPlayer)) || rollback->desync) {
+		return;
+	}
+	int i;
+	for (i = 0; i < rollback->nPlayers; ++i) {
+		if (i == rollback->localPlayer || !(checksum->known & (1 << i)) || checksum->remote[i] == checksum->local) {
+			continue;
+		}
+		mLOG(ROLLBACK, ERROR, "Desynced from player %i at frame %u", i + 1, checksum->frame);
+		rollback->desync = true;
+		rollback->desyncFrame = checksum->frame;
+		if (rollback->desynced) {
+			rollback->desynced(rollback, i, checksum->frame);
+		}
+		return;
+	}
+}
+
+static void _receiveInput(struct mCoreRollback* rollback, const struct mCoreRollbackMessage* message) {
+	uint32_t frame = message->frame;
+	if (frame < rollback->confirmedFrame || frame - rollback->confirmedFrame >= mCORE_ROLLBACK_INPUT_FRAMES) {
+		mLOG(ROLLBACK, WARN, "Received input for frame %u outside of window", frame);
+		return;
+	}
+	struct mCoreRollbackInput* input = _input(rollback, frame);
+	if (input->confirmed & (1 << message->player)) {
+		return;
+	}
+	if (frame < rollback->frame && input->keys[message->player] != message->keys && frame < rollback->rollbackFrame) {
+		rollback->rollbackFrame = frame;
+	}
+	input->keys[message->player] = message->keys;
+	input->confirmed |= 1 << message->player;
+	rollback->lastKeys[message->player] = message->keys;
+}
+
+static void _receive(struct mCoreRollback* rollback) {
+	struct mCoreRollbackMessage message;
+	while (rollback->transport->receive(rollback->transport, &message)) {
+		if (message.player < 0 || message.player >= rollback->nPlayers || message.player == rollback->localPlayer) {
+			mLOG(ROLLBACK, WARN, "Received message for invalid player %i", message.player);
+			continue;
+		}
+		switch (message.type) {
+		case mROLLBACK_MESSAGE_INPUT:
+			_receiveInput(rollback, &message);
+			break;
+		case mROLLBACK_MESSAGE_CHECKSUM:
+			if (rollback->checksumInterval && !(message.frame % rollback->checksumInterval)) {
+				struct mCoreRollbackChecksum* checksum = _checksum(rollback, message.frame);
+				checksum->remote[message.player] = message.checksum;
+				checksum->known |= 1 << message.player;
+				_compareChecksum(rollback, checksum);
+			}
+			break;
+		default:
+			mLOG(ROLLBACK, WARN, "Received unknown message type %i", message.type);
+			break;
+		}
+	}
+}
+
+static void _sendChecksums(struct mCoreRollback* rollback) {
+	// A frame's state is final once every input before it is known. It stays in the
+	// ring until then, since emulation stalls before it can be overwritten.
+	while (rollback->nextChecksum <= rollback->confirmedFrame && rollback->nextChecksum < rollback->frame) {
+		uint32_t frame = rollback->nextChecksum;
+		struct mCoreRollbackChecksum* checksum = _checksum(rollback, frame);
+		checksum->local = mStateHashBuffer(rollback->states[frame % mCORE_ROLLBACK_MAX_FRAMES], rollback->stateSize);
+		checksum->known |= 1 << rollback->localPlayer;
+		if (rollback->transport) {
+			struct mCoreRollbackMessage message = {
+				.type = mROLLBACK_MESSAGE_CHECKSUM,
+				.player = rollback->localPlayer,
+				.frame = frame,
+				.checksum = checksum->local
+			};
+			rollback->transport->send(rollback->transport, &message);
+		}
+		_compareChecksum(rollback, checksum);
+		rollback->nextChecksum += rollback->checksumInterval;
+	}
+}
+
+static void _updateConfirmed(struct mCoreRollback* rollback) {
+	unsigned all = _allPlayers(rollback);
+	while (rollback->confirmedFrame < rollback->frame) {
+		const struct mCoreRollbackInput* input = &rollback->inputs[rollback->confirmedFrame % mCORE_ROLLBACK_INPUT_FRAMES];
+		if (input->frame != rollback->confirmedFrame || input->confirmed != all) {
+			break;
+		}
+		++rollback->confirmedFrame;
+	}
+	if (rollback->checksumInterval) {
+		_sendChecksums(rollback);
+	}
+}
+
+bool mCoreRollbackInit(struct mCoreRollback* rollback, struct mCore** cores, int nCores, int nPlayers, int localPlayer, unsigned inputDelay) {
+	if (nPlayers < 1 || nPlayers > mCORE_ROLLBACK_MAX_PLAYERS || nCores < 1 || nCores > nPlayers) {
+		return false;
+	}
+	if (localPlayer < 0 || localPlayer >= nPlayers || inputDelay > mCORE_ROLLBACK_MAX_DELAY) {
+		return false;
+	}
+	memset(rollback, 0, sizeof(*rollback));
+	rollback->nCores = nCores;
+	rollback->nPlayers = nPlayers;
+	rollback->localPlayer = localPlayer;
+	rollback->inputDelay = inputDelay;
+	rollback->runFrame = _defaultRunFrame;
+	rollback->checksumInterval = mCORE_ROLLBACK_DEFAULT_CHECKSUM_INTERVAL;
+
+	int i;
+	for (i = 0; i < nCores; ++i) {
+		rollback->cores[i] = cores[i];
+		rollback->stateSize += cores[i]->stateSize(cores[i]);
+	}
+	for (i = 0; i < mCORE_ROLLBACK_MAX_FRAMES; ++i) {
+		rollback->states[i] = malloc(rollback->stateSize);
+		if (!rollback->states[i]) {
+			mCoreRollbackDeinit(rollback);
+			return false;
+		}
+	}
+	for (i = 0; i < mCORE_ROLLBACK_INPUT_FRAMES; ++i) {
+		rollback->inputs[i].frame = UINT32_MAX;
+	}
+	for (i = 0; i < mCORE_ROLLBACK_CHECKSUMS; ++i) {
+		rollback->checksums[i].frame = UINT32_MAX;
+	}
+	return true;
+}
+
+void mCoreRollbackDeinit(struct mCoreRollback* rollback) {
+	int i;
+	for (i = 0; i < mCORE_ROLLBACK_MAX_FRAMES; ++i) {
+		free(rollback->states[i]);
+		rollback->states[i] = NULL;
+	}
+}
+
+bool mCoreRollbackRunFrame(struct mCoreRollback* rollback, uint32_t localKeys) {
+	if (rollback->transport) {
+		_receive(rollback);
+	}
+
+	if (rollback->rollbackFrame < rollback->frame) {
+		uint32_t frame;
+		mLOG(ROLLBACK, DEBUG, "Rolling back %u frames", rollback->frame - rollback->rollbackFrame);
+		_loadState(rollback, rollback->rollbackFrame);
+		rollback->resimulating = true;
+		for (frame = rollback->rollbackFrame; frame < rollback->frame; ++frame) {
+			if (frame != rollback->rollbackFrame) {
+				_saveState(rollback, frame);
+			}
+			_runFrame(rollback, frame);
+		}
+		rollback->resimulating = false;
+		++rollback->rollbacks;
+	}
+	rollback->rollbackFrame = rollback->frame;
+	_updateConfirmed(rollback);
+
+	// Only the states since the last fully known frame are kept, so running any
+	// further ahead would lose the state a late input needs to roll back to
+	if (rollback->frame - rollback->confirmedFrame >= mCORE_ROLLBACK_MAX_FRAMES) {
+		return false;
+	}
+
+	uint32_t target = rollback->frame + rollback->inputDelay;
+	struct mCoreRollbackInput* input = _input(rollback, target);
+	input->keys[rollback->localPlayer] = localKeys;
+	input->confirmed |= 1 << rollback->localPlayer;
+	if (rollback->transport) {
+		struct mCoreRollbackMessage message = {
+			.type = mROLLBACK_MESSAGE_INPUT,
+			.player = rollback->localPlayer,
+			.frame = target,
+			.keys = localKeys
+		};
+		rollback->transport->send(rollback->transport, &message);
+	}
+
+	_saveState(rollback, rollback->frame);
+	_runFrame(rollback, rollback->frame);
+	++rollback->frame;
+	rollback->rollbackFrame = rollback->frame;
+	_updateConfirmed(rollback);
+	return true;
+}
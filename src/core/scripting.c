@@ -6,7 +6,14 @@
 #include <mgba/core/scripting.h>
 
 #include <mgba/core/core.h>
+#include <mgba/core/input-latch.h>
 #include <mgba/core/serialize.h>
+#include <mgba/core/thread.h>
+#ifdef ENABLE_DEBUGGERS
+#include <mgba/internal/debugger/profiler.h>
+#include <mgba/internal/debugger/symbols.h>
+#include <mgba/internal/debugger/trace-recorder.h>
+#endif
 #ifdef M_CORE_GBA
 #include <mgba/gba/interface.h>
 #endif
@@ -159,6 +166,15 @@ bool mScriptBridgeLookupSymbol(struct mScriptBridge* sb, const char* name, int32
 struct mScriptMemoryDomain {
 	struct mCore* core;
 	struct mCoreMemoryBlock block;
+	uint8_t* data;
+	size_t dataSize;
+	unsigned refs;
+};
+
+struct mScriptMemoryView {
+	struct mScriptMemoryDomain* domain;
+	uint8_t* data;
+	uint32_t size;
 };
 
 #ifdef ENABLE_DEBUGGERS
@@ -192,8 +208,12 @@ struct mScriptCoreAdapter {
 	struct mCore* core;
 	struct mScriptContext* context;
 	struct mScriptValue memory;
+	struct mScriptCallbackSet* resetCallbacks;
+	struct mScriptCallbackSet* rumbleCallbacks;
 #ifdef ENABLE_DEBUGGERS
 	struct mScriptDebugger debugger;
+	struct mDebuggerTraceRecorder traceRecorder;
+	struct mDebuggerProfiler profiler;
 #endif
 	struct mRumble rumble;
 	struct mRumbleIntegrator rumbleIntegrator;
@@ -253,6 +273,187 @@ static struct mScriptValue* mScriptMemoryDomainReadRange(struct mScriptMemoryDom
 	return value;
 }
 
+static const uint8_t* _mScriptMemoryDomainData(struct mScriptMemoryDomain* adapter) {
+	if (!adapter->core) {
+		return NULL;
+	}
+	if (!adapter->data) {
+		// The pointer is fetched once and kept until the memory map is torn down,
+		// since fetching it may mark the whole block dirty
+		adapter->data = adapter->core->getMemoryBlock(adapter->core, adapter->block.id, &adapter->dataSize);
+		if (!adapter->data) {
+			adapter->dataSize = 0;
+		}
+	}
+	return adapter->data;
+}
+
+static void _mScriptMemoryDomainRelease(struct mScriptMemoryDomain* adapter) {
+	--adapter->refs;
+	if (!adapter->refs) {
+		free(adapter);
+	}
+}
+
+static void mScriptMemoryViewDeinit(struct mScriptMemoryView* view) {
+	if (view->domain) {
+		_mScriptMemoryDomainRelease(view->domain);
+	} else {
+		free(view->data);
+	}
+	free(view);
+}
+
+static const uint8_t* _mScriptMemoryViewAt(const struct mScriptMemoryView* view, uint32_t index, uint32_t width) {
+	if (view->domain && !view->domain->core) {
+		return NULL;
+	}
+	if (index >= view->size / width) {
+		return NULL;
+	}
+	return &view->data[index * width];
+}
+
+static uint32_t mScriptMemoryViewU8(const struct mScriptMemoryView* view, uint32_t index) {
+	const uint8_t* data = _mScriptMemoryViewAt(view, index, 1);
+	return data ? *data : 0;
+}
+
+static int32_t mScriptMemoryViewS8(const struct mScriptMemoryView* view, uint32_t index) {
+	const uint8_t* data = _mScriptMemoryViewAt(view, index, 1);
+	return data ? (int8_t) *data : 0;
+}
+
+static uint32_t mScriptMemoryViewU16(const struct mScriptMemoryView* view, uint32_t index) {
+	const uint8_t* data = _mScriptMemoryViewAt(view, index, 2);
+	uint16_t value = 0;
+	if (data) {
+		LOAD_16LE(value, 0, data);
+	}
+	return value;
+}
+
+static int32_t mScriptMemoryViewS16(const struct mScriptMemoryView* view, uint32_t index) {
+	return (int16_t) mScriptMemoryViewU16(view, index);
+}
+
+static uint32_t mScriptMemoryViewU32(const struct mScriptMemoryView* view, uint32_t index) {
+	const uint8_t* data = _mScriptMemoryViewAt(view, index, 4);
+	uint32_t value = 0;
+	if (data) {
+		LOAD_32LE(value, 0, data);
+	}
+	return value;
+}
+
+static int32_t mScriptMemoryViewS32(const struct mScriptMemoryView* view, uint32_t index) {
+	return (int32_t) mScriptMemoryViewU32(view, index);
+}
+
+static uint32_t mScriptMemoryViewSize(const struct mScriptMemoryView* view) {
+	if (view->domain && !view->domain->core) {
+		return 0;
+	}
+	return view->size;
+}
+
+static bool mScriptMemoryViewIsLive(const struct mScriptMemoryView* view) {
+	return view->domain && view->domain->core;
+}
+
+mSCRIPT_DECLARE_STRUCT(mScriptMemoryView);
+mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptMemoryView, _deinit, mScriptMemoryViewDeinit, 0);
+mSCRIPT_DECLARE_STRUCT_C_METHOD(mScriptMemoryView, U32, u8, mScriptMemoryViewU8, 1, U32, index);
+mSCRIPT_DECLARE_STRUCT_C_METHOD(mScriptMemoryView, S32, s8, mScriptMemoryViewS8, 1, U32, index);
+mSCRIPT_DECLARE_STRUCT_C_METHOD(mScriptMemoryView, U32, u16, mScriptMemoryViewU16, 1, U32, index);
+mSCRIPT_DECLARE_STRUCT_C_METHOD(mScriptMemoryView, S32, s16, mScriptMemoryViewS16, 1, U32, index);
+mSCRIPT_DECLARE_STRUCT_C_METHOD(mScriptMemoryView, U32, u32, mScriptMemoryViewU32, 1, U32, index);
+mSCRIPT_DECLARE_STRUCT_C_METHOD(mScriptMemoryView, S32, s32, mScriptMemoryViewS32, 1, U32, index);
+mSCRIPT_DECLARE_STRUCT_C_METHOD(mScriptMemoryView, U32, size, mScriptMemoryViewSize, 0);
+mSCRIPT_DECLARE_STRUCT_C_METHOD(mScriptMemoryView, BOOL, isLive, mScriptMemoryViewIsLive, 0);
+
+mSCRIPT_DEFINE_STRUCT(mScriptMemoryView)
+	mSCRIPT_DEFINE_CLASS_DOCSTRING(
+		"A typed view of a range of memory. Views made with struct::mScriptMemoryDomain.view read "
+		"straight from emulated memory without copying, while buffers made with struct::mScriptCoreAdapter.newBuffer "
+		"own their memory and are filled with struct::mScriptMemoryDomain.readInto or struct::mScriptCoreAdapter.readInto. "
+		"Indices count elements of the accessor's width, starting at 0, and indices out of bounds read as 0. "
+		"Values are little-endian."
+	)
+	mSCRIPT_DEFINE_STRUCT_DEINIT(mScriptMemoryView)
+	mSCRIPT_DEFINE_DOCSTRING("Read an unsigned 8-bit value at the given index")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryView, u8)
+	mSCRIPT_DEFINE_DOCSTRING("Read a signed 8-bit value at the given index")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryView, s8)
+	mSCRIPT_DEFINE_DOCSTRING("Read an unsigned 16-bit value at the given index")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryView, u16)
+	mSCRIPT_DEFINE_DOCSTRING("Read a signed 16-bit value at the given index")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryView, s16)
+	mSCRIPT_DEFINE_DOCSTRING("Read an unsigned 32-bit value at the given index")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryView, u32)
+	mSCRIPT_DEFINE_DOCSTRING("Read a signed 32-bit value at the given index")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryView, s32)
+	mSCRIPT_DEFINE_DOCSTRING("Get the size of the view in bytes. Views of a memory domain that has gone away have a size of 0")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryView, size)
+	mSCRIPT_DEFINE_DOCSTRING("Check if this view reads straight from emulated memory instead of owning a buffer")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryView, isLive)
+mSCRIPT_DEFINE_END;
+
+static struct mScriptValue* _mScriptMemoryViewCreateBuffer(uint32_t size) {
+	// Like images, cap the size of buffers scripts can make
+	if (!size || size > 0x1000000) {
+		return NULL;
+	}
+	struct mScriptMemoryView* view = calloc(1, sizeof(*view));
+	view->data = calloc(size, 1);
+	view->size = size;
+	struct mScriptValue* value = mScriptValueAlloc(mSCRIPT_TYPE_MS_S(mScriptMemoryView));
+	value->value.opaque = view;
+	value->flags = mSCRIPT_VALUE_FLAG_DEINIT;
+	return value;
+}
+
+static struct mScriptValue* mScriptMemoryDomainView(struct mScriptMemoryDomain* adapter, uint32_t offset, uint32_t length) {
+	const uint8_t* data = _mScriptMemoryDomainData(adapter);
+	if (!data || offset >= adapter->dataSize) {
+		return NULL;
+	}
+	if (!length || length > adapter->dataSize - offset) {
+		length = adapter->dataSize - offset;
+	}
+	struct mScriptMemoryView* view = calloc(1, sizeof(*view));
+	view->domain = adapter;
+	view->data = (uint8_t*) &data[offset];
+	view->size = length;
+	++adapter->refs;
+	struct mScriptValue* value = mScriptValueAlloc(mSCRIPT_TYPE_MS_S(mScriptMemoryView));
+	value->value.opaque = view;
+	value->flags = mSCRIPT_VALUE_FLAG_DEINIT;
+	return value;
+}
+
+static uint32_t mScriptMemoryDomainReadInto(struct mScriptMemoryDomain* adapter, struct mScriptMemoryView* buffer, uint32_t address) {
+	if (buffer->domain || !adapter->core) {
+		return 0;
+	}
+	const uint8_t* data = _mScriptMemoryDomainData(adapter);
+	if (data && address < adapter->dataSize && buffer->size <= adapter->dataSize - address) {
+		memcpy(buffer->data, &data[address], buffer->size);
+		return buffer->size;
+	}
+	CALCULATE_SEGMENT_INFO;
+	uint32_t i;
+	for (i = 0; i < buffer->size; ++i, ++address) {
+		CALCULATE_SEGMENT_ADDRESS;
+		buffer->data[i] = adapter->core->rawRead8(adapter->core, segmentAddress, segment);
+	}
+	return buffer->size;
+}
+
+static void mScriptMemoryDomainDeinit(struct mScriptMemoryDomain* adapter) {
+	_mScriptMemoryDomainRelease(adapter);
+}
+
 static void mScriptMemoryDomainWrite8(struct mScriptMemoryDomain* adapter, uint32_t address, uint8_t value) {
 	CALCULATE_SEGMENT_INFO;
 	CALCULATE_SEGMENT_ADDRESS;
@@ -288,6 +489,7 @@ static struct mScriptValue* mScriptMemoryDomainName(struct mScriptMemoryDomain*
 }
 
 mSCRIPT_DECLARE_STRUCT(mScriptMemoryDomain);
+mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptMemoryDomain, _deinit, mScriptMemoryDomainDeinit, 0);
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptMemoryDomain, U32, read8, mScriptMemoryDomainRead8, 1, U32, address);
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptMemoryDomain, U32, read16, mScriptMemoryDomainRead16, 1, U32, address);
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptMemoryDomain, U32, read32, mScriptMemoryDomainRead32, 1, U32, address);
@@ -300,12 +502,25 @@ mSCRIPT_DECLARE_STRUCT_METHOD(mScriptMemoryDomain, U32, base, mScriptMemoryDomai
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptMemoryDomain, U32, bound, mScriptMemoryDomainEnd, 0);
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptMemoryDomain, U32, size, mScriptMemoryDomainSize, 0);
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptMemoryDomain, WSTR, name, mScriptMemoryDomainName, 0);
+mSCRIPT_DECLARE_STRUCT_METHOD_WITH_DEFAULTS(mScriptMemoryDomain, W(mScriptMemoryView), view, mScriptMemoryDomainView, 2, U32, offset, U32, length);
+mSCRIPT_DECLARE_STRUCT_METHOD_WITH_DEFAULTS(mScriptMemoryDomain, U32, readInto, mScriptMemoryDomainReadInto, 2, S(mScriptMemoryView), buffer, U32, offset);
+
+mSCRIPT_DEFINE_STRUCT_BINDING_DEFAULTS(mScriptMemoryDomain, view)
+	mSCRIPT_U32(0),
+	mSCRIPT_U32(0)
+mSCRIPT_DEFINE_DEFAULTS_END;
+
+mSCRIPT_DEFINE_STRUCT_BINDING_DEFAULTS(mScriptMemoryDomain, readInto)
+	mSCRIPT_NO_DEFAULT,
+	mSCRIPT_U32(0)
+mSCRIPT_DEFINE_DEFAULTS_END;
 
 mSCRIPT_DEFINE_STRUCT(mScriptMemoryDomain)
 	mSCRIPT_DEFINE_CLASS_DOCSTRING(
 		"An object used for access directly to a memory domain, e.g. the cartridge, "
 		"instead of through a whole address space, as with the functions directly on struct::mCore."
 	)
+	mSCRIPT_DEFINE_STRUCT_DEINIT(mScriptMemoryDomain)
 	mSCRIPT_DEFINE_DOCSTRING("Read an 8-bit value from the given offset")
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryDomain, read8)
 	mSCRIPT_DEFINE_DOCSTRING("Read a 16-bit value from the given offset")
@@ -329,6 +544,16 @@ mSCRIPT_DEFINE_STRUCT(mScriptMemoryDomain)
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryDomain, size)
 	mSCRIPT_DEFINE_DOCSTRING("Get a short, human-readable name for this memory domain")
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryDomain, name)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Get a struct::mScriptMemoryView reading straight from this memory domain, starting at the given offset. "
+		"If no length is given, the view extends to the end of the domain. Returns nil if the domain can't be viewed directly"
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryDomain, view)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Copy bytes starting at the given offset into a buffer from struct::mScriptCoreAdapter.newBuffer, filling it. "
+		"Returns the number of bytes copied"
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryDomain, readInto)
 mSCRIPT_DEFINE_END;
 
 static struct mScriptValue* _mScriptCoreGetGameTitle(const struct mCore* core) {
@@ -450,6 +675,13 @@ static void _mScriptCoreTakeScreenshot(struct mCore* core, const char* filename)
 		mCoreTakeScreenshotVF(core, vf);
 		vf->close(vf);
 	} else {
+#ifndef DISABLE_THREADING
+		struct mCoreThread* thread = mCoreThreadGet();
+		if (thread && thread->core == core) {
+			mCoreThreadTakeScreenshot(thread);
+			return;
+		}
+#endif
 		mCoreTakeScreenshot(core);
 	}
 }
@@ -462,6 +694,120 @@ static int32_t _mScriptCoreLoadState(struct mCore* core, struct mScriptString* b
 	return ret;
 }
 
+static void _insertTableField(struct mScriptValue* table, const char* name, struct mScriptValue* value) {
+	struct mScriptValue* key = mScriptStringCreateFromUTF8(name);
+	mScriptTableInsert(table, key, value);
+	mScriptValueDeref(key);
+	mScriptValueDeref(value);
+}
+
+static void _insertTableU32(struct mScriptValue* table, const char* name, uint32_t u32) {
+	struct mScriptValue* value = mScriptValueAlloc(mSCRIPT_TYPE_MS_U32);
+	value->value.u32 = u32;
+	_insertTableField(table, name, value);
+}
+
+static struct mScriptValue* _mScriptCorePresentStats(struct mCore* core) {
+#ifndef DISABLE_THREADING
+	struct mCoreThread* thread = mCoreThreadGet();
+	if (thread && thread->core == core) {
+		struct mCorePresentStats stats;
+		mCoreSyncGetPresentStats(&thread->impl->sync, &stats);
+		if (!stats.frames) {
+			return &mScriptValueNull;
+		}
+		struct mScriptValue* table = mScriptValueAlloc(mSCRIPT_TYPE_MS_TABLE);
+		struct mScriptValue* frames = mScriptValueAlloc(mSCRIPT_TYPE_MS_U64);
+		frames->value.u64 = stats.frames;
+		_insertTableField(table, "frames", frames);
+		_insertTableU32(table, "latency", stats.latency);
+		_insertTableU32(table, "averageLatency", stats.averageLatency);
+		_insertTableU32(table, "maxLatency", stats.maxLatency);
+		_insertTableU32(table, "missedVblanks", stats.missedVblanks);
+		_insertTableU32(table, "queueDepth", stats.queueDepth);
+		return table;
+	}
+#else
+	UNUSED(core);
+#endif
+	return &mScriptValueNull;
+}
+
+static struct mScriptValue* _mScriptCoreFrameLimiterStats(struct mCore* core) {
+#ifndef DISABLE_THREADING
+	struct mCoreThread* thread = mCoreThreadGet();
+	if (thread && thread->core == core) {
+		struct mCoreFrameLimiterStats stats;
+		mCoreSyncGetFrameLimiterStats(&thread->impl->sync, &stats);
+		if (!stats.frames) {
+			return &mScriptValueNull;
+		}
+		struct mScriptValue* table = mScriptValueAlloc(mSCRIPT_TYPE_MS_TABLE);
+		struct mScriptValue* frames = mScriptValueAlloc(mSCRIPT_TYPE_MS_U64);
+		frames->value.u64 = stats.frames;
+		_insertTableField(table, "frames", frames);
+		_insertTableU32(table, "jitter", stats.jitter);
+		_insertTableU32(table, "averageJitter", stats.averageJitter);
+		_insertTableU32(table, "maxJitter", stats.maxJitter);
+		_insertTableU32(table, "lateFrames", stats.lateFrames);
+		return table;
+	}
+#else
+	UNUSED(core);
+#endif
+	return &mScriptValueNull;
+}
+
+static struct mScriptValue* _mScriptCoreInputLatencyStats(struct mCore* core) {
+#ifndef DISABLE_THREADING
+	struct mCoreThread* thread = mCoreThreadGet();
+	if (thread && thread->core == core && thread->inputLatch) {
+		struct mInputLatchStats stats;
+		mInputLatchGetStats(thread->inputLatch, &stats);
+		if (!stats.changes) {
+			return &mScriptValueNull;
+		}
+		struct mScriptValue* table = mScriptValueAlloc(mSCRIPT_TYPE_MS_TABLE);
+		struct mScriptValue* changes = mScriptValueAlloc(mSCRIPT_TYPE_MS_U64);
+		changes->value.u64 = stats.changes;
+		_insertTableField(table, "changes", changes);
+		_insertTableU32(table, "latency", stats.latency);
+		_insertTableU32(table, "averageLatency", stats.averageLatency);
+		_insertTableU32(table, "maxLatency", stats.maxLatency);
+		return table;
+	}
+#else
+	UNUSED(core);
+#endif
+	return &mScriptValueNull;
+}
+
+static bool _mScriptCoreSetUnboundedFastForward(struct mCore* core, uint32_t interval) {
+#ifndef DISABLE_THREADING
+	struct mCoreThread* thread = mCoreThreadGet();
+	if (thread && thread->core == core) {
+		mCoreThreadSetUnboundedFastForward(thread, interval);
+		return true;
+	}
+#else
+	UNUSED(core);
+	UNUSED(interval);
+#endif
+	return false;
+}
+
+static uint32_t _mScriptCoreUnboundedFastForward(struct mCore* core) {
+#ifndef DISABLE_THREADING
+	struct mCoreThread* thread = mCoreThreadGet();
+	if (thread && thread->core == core) {
+		return mCoreThreadGetUnboundedFastForward(thread);
+	}
+#else
+	UNUSED(core);
+#endif
+	return 0;
+}
+
 static struct mScriptValue* _mScriptCoreTakeScreenshotToImage(struct mCore* core) {
 	size_t stride;
 	const void* pixels = 0;
@@ -542,6 +888,11 @@ mSCRIPT_DECLARE_STRUCT_METHOD_WITH_DEFAULTS(mCore, BOOL, loadStateFile, _mScript
 mSCRIPT_DECLARE_STRUCT_VOID_METHOD_WITH_DEFAULTS(mCore, screenshot, _mScriptCoreTakeScreenshot, 1, CHARP, filename);
 #endif
 mSCRIPT_DECLARE_STRUCT_METHOD(mCore, W(mImage), screenshotToImage, _mScriptCoreTakeScreenshotToImage, 0);
+mSCRIPT_DECLARE_STRUCT_METHOD(mCore, WRAPPER, presentStats, _mScriptCorePresentStats, 0);
+mSCRIPT_DECLARE_STRUCT_METHOD(mCore, WRAPPER, frameLimiterStats, _mScriptCoreFrameLimiterStats, 0);
+mSCRIPT_DECLARE_STRUCT_METHOD(mCore, WRAPPER, inputLatencyStats, _mScriptCoreInputLatencyStats, 0);
+mSCRIPT_DECLARE_STRUCT_METHOD(mCore, BOOL, setUnboundedFastForward, _mScriptCoreSetUnboundedFastForward, 1, U32, interval);
+mSCRIPT_DECLARE_STRUCT_METHOD(mCore, U32, unboundedFastForward, _mScriptCoreUnboundedFastForward, 0);
 
 mSCRIPT_DEFINE_STRUCT(mCore)
 	mSCRIPT_DEFINE_CLASS_DOCSTRING(
@@ -635,6 +986,35 @@ mSCRIPT_DEFINE_STRUCT(mCore)
 #endif
 	mSCRIPT_DEFINE_DOCSTRING("Get a screenshot in an struct::mImage")
 	mSCRIPT_DEFINE_STRUCT_METHOD(mCore, screenshotToImage)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Get display timing reported by the frontend, or nil if none has been reported. "
+		"The table contains `frames` presented, `latency`, `averageLatency` and `maxLatency` "
+		"in microseconds from the emulated frame finishing to it being presented, the total "
+		"number of `missedVblanks`, and the `queueDepth` of frames produced since the last present"
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mCore, presentStats)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Get how closely the frame limiter is keeping to its cadence, or nil if it isn't on. "
+		"The table contains the number of `frames` limited, the `jitter`, `averageJitter` and "
+		"`maxJitter` in nanoseconds from each frame's deadline to when it was let through, and "
+		"the number of `lateFrames` that finished after their deadline"
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mCore, frameLimiterStats)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Get how long key changes take to reach the game, or nil if the frontend doesn't latch its "
+		"input. The table contains the number of `changes` applied, and the `latency`, "
+		"`averageLatency` and `maxLatency` in microseconds from a change being captured to the "
+		"start of the first frame that sees it"
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mCore, inputLatencyStats)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Fast-forward as fast as possible, rendering only every `interval` frames and skipping audio. "
+		"Cheats and frame callbacks still run on every frame. Pass 0 to stop. Returns false if the "
+		"core isn't running on an emulation thread"
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mCore, setUnboundedFastForward)
+	mSCRIPT_DEFINE_DOCSTRING("Get the render interval of unbounded fast-forward, or 0 if it's off")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mCore, unboundedFastForward)
 mSCRIPT_DEFINE_END;
 
 mSCRIPT_DEFINE_STRUCT_BINDING_DEFAULTS(mCore, checksum)
@@ -680,6 +1060,14 @@ static void _clearMemoryMap(struct mScriptContext* context, struct mScriptCoreAd
 		while (true) {
 			struct mScriptValue* weakref = mScriptTableIteratorGetValue(&adapter->memory, &iter);
 			if (weakref) {
+				// Views into the domain may outlive it, so make sure they stop reading from the core
+				struct mScriptValue* domain = mScriptContextAccessWeakref(context, weakref);
+				if (domain) {
+					struct mScriptMemoryDomain* memadapter = domain->value.opaque;
+					memadapter->core = NULL;
+					memadapter->data = NULL;
+					memadapter->dataSize = 0;
+				}
 				if (clear) {
 					mScriptContextClearWeakref(context, weakref->value.s32);
 				}
@@ -705,9 +1093,10 @@ static void _rebuildMemoryMap(struct mScriptContext* context, struct mScriptCore
 		}
 		struct mScriptMemoryDomain* memadapter = calloc(1, sizeof(*memadapter));
 		memadapter->core = adapter->core;
+		memadapter->refs = 1;
 		memcpy(&memadapter->block, &blocks[i], sizeof(memadapter->block));
 		struct mScriptValue* value = mScriptValueAlloc(mSCRIPT_TYPE_MS_S(mScriptMemoryDomain));
-		value->flags = mSCRIPT_VALUE_FLAG_FREE_BUFFER;
+		value->flags = mSCRIPT_VALUE_FLAG_DEINIT;
 		value->value.opaque = memadapter;
 		struct mScriptValue* key = mScriptStringCreateFromUTF8(blocks[i].internalName);
 		mScriptTableInsert(&adapter->memory, key, mScriptContextMakeWeakref(context, value));
@@ -992,6 +1381,144 @@ static bool _mScriptCoreAdapterClearBreakpoint(struct mScriptCoreAdapter* adapte
 static uint64_t _mScriptCoreAdapterCurrentCycle(struct mScriptCoreAdapter* adapter) {
 	return mTimingGlobalTime(adapter->core->timing);
 }
+
+static struct mScriptValue* _mScriptCoreAdapterSymbolAt(struct mScriptCoreAdapter* adapter, uint32_t address, int32_t segment) {
+	if (!adapter->core->symbolTable) {
+		return &mScriptValueNull;
+	}
+	uint32_t offset;
+	const char* name = mDebuggerSymbolNearest(adapter->core->symbolTable, address, segment, &offset);
+	if (!name) {
+		return &mScriptValueNull;
+	}
+	struct mScriptValue* table = mScriptValueAlloc(mSCRIPT_TYPE_MS_TABLE);
+	struct mScriptValue* value = mScriptValueAlloc(mSCRIPT_TYPE_MS_U32);
+	value->value.u32 = address - offset;
+	_insertTableField(table, "address", value);
+	value = mScriptValueAlloc(mSCRIPT_TYPE_MS_U32);
+	value->value.u32 = offset;
+	_insertTableField(table, "offset", value);
+	_insertTableField(table, "name", mScriptStringCreateFromUTF8(name));
+	return table;
+}
+
+static bool _mScriptCoreAdapterStartTrace(struct mScriptCoreAdapter* adapter, const char* path, uint32_t capacity) {
+#ifdef ENABLE_VFS
+	struct mDebugger* debugger = adapter->core->debugger;
+	if (!debugger || !debugger->platform->nextTraceEntry) {
+		return false;
+	}
+	struct VFile* vf = VFileOpen(path, O_CREAT | O_TRUNC | O_RDWR);
+	if (!vf) {
+		return false;
+	}
+	if (!adapter->traceRecorder.d.p) {
+		mDebuggerAttachModule(debugger, &adapter->traceRecorder.d);
+	}
+	if (!mDebuggerTraceRecorderOpen(&adapter->traceRecorder, vf, O_CREAT | O_TRUNC, capacity)) {
+		vf->close(vf);
+		return false;
+	}
+	return mDebuggerTraceRecorderStart(&adapter->traceRecorder);
+#else
+	UNUSED(adapter);
+	UNUSED(path);
+	UNUSED(capacity);
+	return false;
+#endif
+}
+
+static void _mScriptCoreAdapterStopTrace(struct mScriptCoreAdapter* adapter) {
+	mDebuggerTraceRecorderClose(&adapter->traceRecorder);
+}
+
+static bool _mScriptCoreAdapterDumpTrace(struct mScriptCoreAdapter* adapter, const char* path) {
+#ifdef ENABLE_VFS
+	if (!adapter->traceRecorder.backing) {
+		return false;
+	}
+	struct VFile* vf = VFileOpen(path, O_CREAT | O_TRUNC | O_WRONLY);
+	if (!vf) {
+		return false;
+	}
+	bool success = mDebuggerTraceRecorderDisassemble(&adapter->traceRecorder, vf);
+	vf->close(vf);
+	return success;
+#else
+	UNUSED(adapter);
+	UNUSED(path);
+	return false;
+#endif
+}
+
+static bool _mScriptCoreAdapterStartProfile(struct mScriptCoreAdapter* adapter, int32_t period) {
+	struct mDebugger* debugger = adapter->core->debugger;
+	if (!debugger || !debugger->platform->nextTraceEntry) {
+		return false;
+	}
+	if (!adapter->profiler.d.p) {
+		mDebuggerAttachModule(debugger, &adapter->profiler.d);
+	}
+	mDebuggerProfilerClear(&adapter->profiler);
+	return mDebuggerProfilerStart(&adapter->profiler, period);
+}
+
+static void _mScriptCoreAdapterStopProfile(struct mScriptCoreAdapter* adapter) {
+	mDebuggerProfilerStop(&adapter->profiler);
+}
+
+static struct mScriptValue* _mScriptCoreAdapterProfile(struct mScriptCoreAdapter* adapter) {
+	struct mDebuggerProfilerEntryList entries;
+	mDebuggerProfilerEntryListInit(&entries, 0);
+	mDebuggerProfilerHistogram(&adapter->profiler, &entries);
+
+	struct mScriptValue* list = mScriptValueAlloc(mSCRIPT_TYPE_MS_LIST);
+	size_t i;
+	for (i = 0; i < mDebuggerProfilerEntryListSize(&entries); ++i) {
+		const struct mDebuggerProfilerEntry* entry = mDebuggerProfilerEntryListGetConstPointer(&entries, i);
+		struct mScriptValue* table = mScriptValueAlloc(mSCRIPT_TYPE_MS_TABLE);
+		_insertTableU32(table, "address", entry->address);
+		if (entry->name) {
+			_insertTableField(table, "name", mScriptStringCreateFromUTF8(entry->name));
+		}
+		struct mScriptValue* value = mScriptValueAlloc(mSCRIPT_TYPE_MS_U64);
+		value->value.u64 = entry->self;
+		_insertTableField(table, "self", value);
+		value = mScriptValueAlloc(mSCRIPT_TYPE_MS_U64);
+		value->value.u64 = entry->total;
+		_insertTableField(table, "total", value);
+		// The list takes over the reference to the table
+		mScriptValueWrap(table, mScriptListAppend(list->value.list));
+	}
+	mDebuggerProfilerEntryListDeinit(&entries);
+	return list;
+}
+
+static bool _mScriptCoreAdapterDumpProfile(struct mScriptCoreAdapter* adapter, const char* path, const char* format) {
+#ifdef ENABLE_VFS
+	bool pprof = strcmp(format, "pprof") == 0;
+	if (!pprof && strcmp(format, "folded") != 0) {
+		return false;
+	}
+	struct VFile* vf = VFileOpen(path, O_CREAT | O_TRUNC | O_WRONLY);
+	if (!vf) {
+		return false;
+	}
+	bool success;
+	if (pprof) {
+		success = mDebuggerProfilerWritePprof(&adapter->profiler, vf);
+	} else {
+		success = mDebuggerProfilerWriteFolded(&adapter->profiler, vf);
+	}
+	vf->close(vf);
+	return success;
+#else
+	UNUSED(adapter);
+	UNUSED(path);
+	UNUSED(format);
+	return false;
+#endif
+}
 #endif
 
 static void _mScriptCoreAdapterDeinit(struct mScriptCoreAdapter* adapter) {
@@ -1014,6 +1541,14 @@ static void _mScriptCoreAdapterDeinit(struct mScriptCoreAdapter* adapter) {
 	if (adapter->core->debugger) {
 		mDebuggerDetachModule(adapter->core->debugger, &adapter->debugger.d);
 	}
+	if (adapter->traceRecorder.d.p) {
+		mDebuggerDetachModule(adapter->traceRecorder.d.p, &adapter->traceRecorder.d);
+	}
+	mDebuggerTraceRecorderDeinit(&adapter->traceRecorder);
+	if (adapter->profiler.d.p) {
+		mDebuggerDetachModule(adapter->profiler.d.p, &adapter->profiler.d);
+	}
+	mDebuggerProfilerDeinit(&adapter->profiler);
 #endif
 }
 
@@ -1032,7 +1567,7 @@ static struct mScriptValue* _mScriptCoreAdapterGet(struct mScriptCoreAdapter* ad
 
 static void _mScriptCoreAdapterReset(struct mScriptCoreAdapter* adapter) {
 	adapter->core->reset(adapter->core);
-	mScriptContextTriggerCallback(adapter->context, "reset", NULL);
+	mScriptContextTriggerCallbackSet(adapter->resetCallbacks, NULL);
 }
 
 static struct mScriptValue* _mScriptCoreAdapterSetRotationCbTable(struct mScriptCoreAdapter* adapter, struct mScriptValue* cbTable) {
@@ -1106,6 +1641,28 @@ static struct mScriptValue* _mScriptCoreAdapterReadRange(struct mScriptCoreAdapt
 	return value;
 }
 
+static struct mScriptValue* _mScriptCoreAdapterNewBuffer(struct mScriptCoreAdapter* adapter, uint32_t size) {
+	UNUSED(adapter);
+	return _mScriptMemoryViewCreateBuffer(size);
+}
+
+static uint32_t _mScriptCoreAdapterReadInto(struct mScriptCoreAdapter* adapter, struct mScriptMemoryView* buffer, uint32_t address) {
+	if (buffer->domain) {
+		return 0;
+	}
+#ifdef ENABLE_DEBUGGERS
+	adapter->debugger.reentered = true;
+#endif
+	uint32_t i;
+	for (i = 0; i < buffer->size; ++i, ++address) {
+		buffer->data[i] = adapter->core->busRead8(adapter->core, address);
+	}
+#ifdef ENABLE_DEBUGGERS
+	adapter->debugger.reentered = false;
+#endif
+	return buffer->size;
+}
+
 static void _mScriptCoreAdapterWrite8(struct mScriptCoreAdapter* adapter, uint32_t address, uint8_t value) {
 #ifdef ENABLE_DEBUGGERS
 	adapter->debugger.reentered = true;
@@ -1150,6 +1707,8 @@ mSCRIPT_DECLARE_STRUCT_METHOD(mScriptCoreAdapter, WSTR, readRange, _mScriptCoreA
 mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptCoreAdapter, write8, _mScriptCoreAdapterWrite8, 2, U32, address, U8, value);
 mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptCoreAdapter, write16, _mScriptCoreAdapterWrite16, 2, U32, address, U16, value);
 mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptCoreAdapter, write32, _mScriptCoreAdapterWrite32, 2, U32, address, U32, value);
+mSCRIPT_DECLARE_STRUCT_METHOD(mScriptCoreAdapter, W(mScriptMemoryView), newBuffer, _mScriptCoreAdapterNewBuffer, 1, U32, size);
+mSCRIPT_DECLARE_STRUCT_METHOD(mScriptCoreAdapter, U32, readInto, _mScriptCoreAdapterReadInto, 2, S(mScriptMemoryView), buffer, U32, address);
 
 #ifdef ENABLE_DEBUGGERS
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptCoreAdapter, U64, currentCycle, _mScriptCoreAdapterCurrentCycle, 0);
@@ -1157,6 +1716,14 @@ mSCRIPT_DECLARE_STRUCT_METHOD_WITH_DEFAULTS(mScriptCoreAdapter, S64, setBreakpoi
 mSCRIPT_DECLARE_STRUCT_METHOD_WITH_DEFAULTS(mScriptCoreAdapter, S64, setWatchpoint, _mScriptCoreAdapterSetWatchpoint, 4, WRAPPER, callback, U32, address, S32, type, S32, segment);
 mSCRIPT_DECLARE_STRUCT_METHOD_WITH_DEFAULTS(mScriptCoreAdapter, S64, setRangeWatchpoint, _mScriptCoreAdapterSetRangeWatchpoint, 5, WRAPPER, callback, U32, minAddress, U32, maxAddress, S32, type, S32, segment);
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptCoreAdapter, BOOL, clearBreakpoint, _mScriptCoreAdapterClearBreakpoint, 1, S64, cbid);
+mSCRIPT_DECLARE_STRUCT_METHOD_WITH_DEFAULTS(mScriptCoreAdapter, WRAPPER, symbolAt, _mScriptCoreAdapterSymbolAt, 2, U32, address, S32, segment);
+mSCRIPT_DECLARE_STRUCT_METHOD_WITH_DEFAULTS(mScriptCoreAdapter, BOOL, startTrace, _mScriptCoreAdapterStartTrace, 2, CHARP, path, U32, capacity);
+mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptCoreAdapter, stopTrace, _mScriptCoreAdapterStopTrace, 0);
+mSCRIPT_DECLARE_STRUCT_METHOD(mScriptCoreAdapter, BOOL, dumpTrace, _mScriptCoreAdapterDumpTrace, 1, CHARP, path);
+mSCRIPT_DECLARE_STRUCT_METHOD_WITH_DEFAULTS(mScriptCoreAdapter, BOOL, startProfile, _mScriptCoreAdapterStartProfile, 1, S32, period);
+mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptCoreAdapter, stopProfile, _mScriptCoreAdapterStopProfile, 0);
+mSCRIPT_DECLARE_STRUCT_METHOD(mScriptCoreAdapter, WRAPPER, profile, _mScriptCoreAdapterProfile, 0);
+mSCRIPT_DECLARE_STRUCT_METHOD_WITH_DEFAULTS(mScriptCoreAdapter, BOOL, dumpProfile, _mScriptCoreAdapterDumpProfile, 2, CHARP, path, CHARP, format);
 
 mSCRIPT_DEFINE_STRUCT_BINDING_DEFAULTS(mScriptCoreAdapter, setBreakpoint)
 	mSCRIPT_NO_DEFAULT,
@@ -1178,6 +1745,25 @@ mSCRIPT_DEFINE_STRUCT_BINDING_DEFAULTS(mScriptCoreAdapter, setRangeWatchpoint)
 	mSCRIPT_NO_DEFAULT,
 	mSCRIPT_S32(-1)
 mSCRIPT_DEFINE_DEFAULTS_END;
+
+mSCRIPT_DEFINE_STRUCT_BINDING_DEFAULTS(mScriptCoreAdapter, symbolAt)
+	mSCRIPT_NO_DEFAULT,
+	mSCRIPT_S32(-1)
+mSCRIPT_DEFINE_DEFAULTS_END;
+
+mSCRIPT_DEFINE_STRUCT_BINDING_DEFAULTS(mScriptCoreAdapter, startTrace)
+	mSCRIPT_NO_DEFAULT,
+	mSCRIPT_U32(0)
+mSCRIPT_DEFINE_DEFAULTS_END;
+
+mSCRIPT_DEFINE_STRUCT_BINDING_DEFAULTS(mScriptCoreAdapter, startProfile)
+	mSCRIPT_S32(0)
+mSCRIPT_DEFINE_DEFAULTS_END;
+
+mSCRIPT_DEFINE_STRUCT_BINDING_DEFAULTS(mScriptCoreAdapter, dumpProfile)
+	mSCRIPT_NO_DEFAULT,
+	mSCRIPT_CHARP("folded")
+mSCRIPT_DEFINE_DEFAULTS_END;
 #endif
 
 mSCRIPT_DEFINE_STRUCT(mScriptCoreAdapter)
@@ -1217,6 +1803,14 @@ mSCRIPT_DEFINE_STRUCT(mScriptCoreAdapter)
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, write8)
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, write16)
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, write32)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Create a zero-filled struct::mScriptMemoryView buffer of the given size in bytes. Unlike the string returned by "
+		"struct::mCore.readRange, a buffer can be refilled every frame with struct::mScriptCoreAdapter.readInto or "
+		"struct::mScriptMemoryDomain.readInto without allocating"
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, newBuffer)
+	mSCRIPT_DEFINE_DOCSTRING("Copy bytes from the address space starting at the given address into a buffer, filling it. Returns the number of bytes copied")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, readInto)
 #ifdef ENABLE_DEBUGGERS
 	mSCRIPT_DEFINE_DOCSTRING("Get the current execution cycle")
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, currentCycle)
@@ -1231,6 +1825,38 @@ mSCRIPT_DEFINE_STRUCT(mScriptCoreAdapter)
 		"as though you've added the size, i.e. a 4-byte watch would specify the maximum as the minimum address + 4"
 	)
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, setRangeWatchpoint)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Find the closest symbol at or before a given address. Returns a table with the symbol's `name` and `address`, "
+		"and the `offset` of the given address from it, or nil if no symbol precedes the address"
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, symbolAt)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Start recording every executed instruction to a binary trace file at the given path. "
+		"The file is a ring buffer holding the last `capacity` instructions, or a default size if omitted"
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, startTrace)
+	mSCRIPT_DEFINE_DOCSTRING("Stop recording the trace started by struct::mScriptCoreAdapter.startTrace and close the file")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, stopTrace)
+	mSCRIPT_DEFINE_DOCSTRING("Write a disassembly of the trace being recorded to a text file at the given path")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, dumpTrace)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Start sampling where the game is running every `period` cycles, or a default period if omitted, "
+		"discarding any earlier samples. Callers are only recorded while stack tracing is enabled in the debugger"
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, startProfile)
+	mSCRIPT_DEFINE_DOCSTRING("Stop sampling, keeping the samples taken so far")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, stopProfile)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Get a list of the sampled functions, most samples first. Each entry has the function's `address`, "
+		"its `name` if there is a symbol for it, the number of samples taken in the function itself (`self`) "
+		"and the number taken in it or anything it called (`total`)"
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, profile)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Write the samples to a file at the given path, either as folded stacks for flame graphs (`\"folded\"`, the default) "
+		"or as a pprof profile (`\"pprof\"`)"
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, dumpProfile)
 #endif
 	mSCRIPT_DEFINE_STRUCT_CAST_TO_MEMBER(mScriptCoreAdapter, S(mCore), _core)
 	mSCRIPT_DEFINE_STRUCT_CAST_TO_MEMBER(mScriptCoreAdapter, CS(mCore), _core)
@@ -1272,7 +1898,7 @@ static void _setRumbleFloat(struct mRumbleIntegrator* integrator, float level) {
 	struct mScriptList args;
 	mScriptListInit(&args, 1);
 	*mScriptListAppend(&args) = mSCRIPT_MAKE_F32(level);
-	mScriptContextTriggerCallback(adapter->context, "rumble", &args);
+	mScriptContextTriggerCallbackSet(adapter->rumbleCallbacks, &args);
 	mScriptListDeinit(&args);
 }
 
@@ -1382,13 +2008,24 @@ static uint8_t _readLuminance(struct GBALuminanceSource* luminance) {
 #define mCoreCallback(NAME) _mScriptCoreCallback ## NAME
 #define DEFINE_CALLBACK(NAME) \
 	void mCoreCallback(NAME) (void* context) { \
-		struct mScriptContext* scriptContext = context; \
-		if (!scriptContext) { \
+		struct mScriptCallbackSet* set = context; \
+		if (!set) { \
 			return; \
 		} \
-		mScriptContextTriggerCallback(scriptContext, #NAME, NULL); \
+		mScriptContextTriggerCallbackSet(set, NULL); \
 	}
 
+// Each callback is registered on its own with its set resolved up front, so firing
+// one doesn't need to look it up by name
+#define ADD_CALLBACK(CORE, CONTEXT, FIELD, NAME) \
+	do { \
+		struct mCoreCallbacks callbacks = { \
+			.FIELD = mCoreCallback(NAME), \
+			.context = mScriptContextResolveCallback(CONTEXT, #NAME) \
+		}; \
+		CORE->addCoreCallbacks(CORE, &callbacks); \
+	} while (0)
+
 DEFINE_CALLBACK(frame)
 DEFINE_CALLBACK(crashed)
 DEFINE_CALLBACK(sleep)
@@ -1408,6 +2045,11 @@ void mScriptContextAttachCore(struct mScriptContext* context, struct mCore* core
 	adapter->memory.type = mSCRIPT_TYPE_MS_TABLE;
 	adapter->memory.type->alloc(&adapter->memory);
 
+#ifdef ENABLE_DEBUGGERS
+	mDebuggerTraceRecorderInit(&adapter->traceRecorder);
+	mDebuggerProfilerInit(&adapter->profiler);
+#endif
+
 	mRumbleIntegratorInit(&adapter->rumbleIntegrator);
 	adapter->rumbleIntegrator.setRumble = _setRumbleFloat;
 	adapter->rumble.setRumble = _setRumble;
@@ -1431,17 +2073,15 @@ void mScriptContextAttachCore(struct mScriptContext* context, struct mCore* core
 	}
 #endif
 
-	struct mCoreCallbacks callbacks = {
-		.videoFrameEnded = mCoreCallback(frame),
-		.coreCrashed = mCoreCallback(crashed),
-		.sleep = mCoreCallback(sleep),
-		.shutdown = mCoreCallback(stop),
-		.keysRead = mCoreCallback(keysRead),
-		.savedataUpdated = mCoreCallback(savedataUpdated),
-		.alarm = mCoreCallback(alarm),
-		.context = context
-	};
-	core->addCoreCallbacks(core, &callbacks);
+	ADD_CALLBACK(core, context, videoFrameEnded, frame);
+	ADD_CALLBACK(core, context, coreCrashed, crashed);
+	ADD_CALLBACK(core, context, sleep, sleep);
+	ADD_CALLBACK(core, context, shutdown, stop);
+	ADD_CALLBACK(core, context, keysRead, keysRead);
+	ADD_CALLBACK(core, context, savedataUpdated, savedataUpdated);
+	ADD_CALLBACK(core, context, alarm, alarm);
+	adapter->resetCallbacks = mScriptContextResolveCallback(context, "reset");
+	adapter->rumbleCallbacks = mScriptContextResolveCallback(context, "rumble");
 
 	_rebuildMemoryMap(context, adapter);
 
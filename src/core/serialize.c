@@ -8,8 +8,12 @@
 #include <mgba/core/core.h>
 #include <mgba/core/cheats.h>
 #include <mgba/core/interface.h>
+#include <mgba/core/state-container.h>
 #include <mgba/core/version.h>
+#include <mgba-util/hash.h>
+#include <mgba-util/image.h>
 #include <mgba-util/memory.h>
+#include <mgba-util/string.h>
 #include <mgba-util/vfs.h>
 
 #ifdef USE_PNG
@@ -20,6 +24,9 @@
 
 mLOG_DEFINE_CATEGORY(SAVESTATE, "Savestate", "core.serialize");
 
+DEFINE_VECTOR(mStateRangeList, struct mStateRange);
+DEFINE_VECTOR(mStateWriterJobList, struct mStateWriterJob*);
+
 struct mBundledState {
 	size_t stateSize;
 	void* state;
@@ -153,33 +160,14 @@ bool mStateExtdataDeserialize(struct mStateExtdata* extdata, struct VFile* vf) {
 }
 
 #ifdef USE_PNG
-static bool _savePNGState(struct mCore* core, struct VFile* vf, struct mStateExtdata* extdata) {
-	size_t stride;
-	const void* pixels = 0;
-
-	core->getPixels(core, &pixels, &stride);
-	if (!pixels) {
-		return false;
-	}
-
-	size_t stateSize = core->stateSize(core);
-	void* state = anonymousMemoryMap(stateSize);
-	if (!state) {
-		return false;
-	}
-	core->saveState(core, state);
-
+static bool _writePNGState(struct VFile* vf, const void* state, size_t stateSize, const void* pixels, size_t stride, unsigned width, unsigned height, struct mStateExtdata* extdata) {
 	uLongf len = compressBound(stateSize);
 	void* buffer = malloc(len);
 	if (!buffer) {
-		mappedMemoryFree(state, stateSize);
 		return false;
 	}
 	compress(buffer, &len, (const Bytef*) state, stateSize);
-	mappedMemoryFree(state, stateSize);
 
-	unsigned width, height;
-	core->currentVideoSize(core, &width, &height);
 	png_structp png = PNGWriteOpen(vf);
 	png_infop info = PNGWriteHeader(png, width, height, mCOLOR_NATIVE);
 	if (!png || !info) {
@@ -212,6 +200,29 @@ static bool _savePNGState(struct mCore* core, struct VFile* vf, struct mStateExt
 	return true;
 }
 
+static bool _savePNGState(struct mCore* core, struct VFile* vf, struct mStateExtdata* extdata) {
+	size_t stride;
+	const void* pixels = 0;
+
+	core->getPixels(core, &pixels, &stride);
+	if (!pixels) {
+		return false;
+	}
+
+	size_t stateSize = core->stateSize(core);
+	void* state = anonymousMemoryMap(stateSize);
+	if (!state) {
+		return false;
+	}
+	core->saveState(core, state);
+
+	unsigned width, height;
+	core->currentVideoSize(core, &width, &height);
+	bool success = _writePNGState(vf, state, stateSize, pixels, stride, width, height, extdata);
+	mappedMemoryFree(state, stateSize);
+	return success;
+}
+
 static int _loadPNGChunkHandler(png_structp png, png_unknown_chunkp chunk) {
 	struct mBundledState* bundle = png_get_user_chunk_ptr(png);
 	if (!bundle) {
@@ -376,12 +387,53 @@ static bool _loadPNGExtdata(struct VFile* vf, struct mStateExtdata* extdata) {
 }
 #endif
 
-bool mCoreSaveStateNamed(struct mCore* core, struct VFile* vf, int flags) {
-	struct mStateExtdata extdata;
-	mStateExtdataInit(&extdata);
-	size_t stateSize = core->stateSize(core);
+void mStateCopyDirtyPages(void* dest, const void* src, const uint32_t* stamps, size_t pages, uint32_t since) {
+	if (!since) {
+		memcpy(dest, src, pages << mSTATE_PAGE_SHIFT);
+		return;
+	}
+	size_t page = 0;
+	while (page < pages) {
+		if (stamps[page] <= since) {
+			++page;
+			continue;
+		}
+		size_t first = page;
+		for (++page; page < pages && stamps[page] > since; ++page);
+		memcpy((uint8_t*) dest + (first << mSTATE_PAGE_SHIFT), (const uint8_t*) src + (first << mSTATE_PAGE_SHIFT), (page - first) << mSTATE_PAGE_SHIFT);
+	}
+}
 
-	core->saveExtraState(core, &extdata);
+void mStateRangeListAdd(struct mStateRangeList* list, uint32_t offset, uint32_t size) {
+	if (!size) {
+		return;
+	}
+	size_t count = mStateRangeListSize(list);
+	if (count) {
+		struct mStateRange* last = mStateRangeListGetPointer(list, count - 1);
+		if (last->offset + last->size == offset) {
+			last->size += size;
+			return;
+		}
+	}
+	*mStateRangeListAppend(list) = (struct mStateRange) { offset, size };
+}
+
+void mStateRangeListAddDirtyPages(struct mStateRangeList* list, uint32_t offset, const uint32_t* stamps, size_t pages, uint32_t since) {
+	if (!since) {
+		mStateRangeListAdd(list, offset, pages << mSTATE_PAGE_SHIFT);
+		return;
+	}
+	size_t page;
+	for (page = 0; page < pages; ++page) {
+		if (stamps[page] > since) {
+			mStateRangeListAdd(list, offset + (page << mSTATE_PAGE_SHIFT), mSTATE_PAGE_SIZE);
+		}
+	}
+}
+
+static void _collectExtdata(struct mCore* core, struct mStateExtdata* extdata, int flags) {
+	core->saveExtraState(core, extdata);
 	if (flags & SAVESTATE_METADATA) {
 		uint64_t* creationUsec = malloc(sizeof(*creationUsec));
 		if (creationUsec) {
@@ -412,7 +464,7 @@ bool mCoreSaveStateNamed(struct mCore* core, struct VFile* vf, int flags) {
 				.data = creationUsec,
 				.clean = free
 			};
-			mStateExtdataPut(&extdata, EXTDATA_META_TIME, &item);
+			mStateExtdataPut(extdata, EXTDATA_META_TIME, &item);
 		}
 
 		char creator[256];
@@ -422,7 +474,7 @@ bool mCoreSaveStateNamed(struct mCore* core, struct VFile* vf, int flags) {
 			.data = strdup(creator),
 			.clean = free
 		};
-		mStateExtdataPut(&extdata, EXTDATA_META_CREATOR, &item);
+		mStateExtdataPut(extdata, EXTDATA_META_CREATOR, &item);
 	}
 
 	if (flags & SAVESTATE_SAVEDATA) {
@@ -434,30 +486,53 @@ bool mCoreSaveStateNamed(struct mCore* core, struct VFile* vf, int flags) {
 				.data = sram,
 				.clean = free
 			};
-			mStateExtdataPut(&extdata, EXTDATA_SAVEDATA, &item);
+			mStateExtdataPut(extdata, EXTDATA_SAVEDATA, &item);
 		}
 	}
-	struct VFile* cheatVf = 0;
 	struct mCheatDevice* device;
 	if (flags & SAVESTATE_CHEATS && (device = core->cheatDevice(core))) {
-		cheatVf = VFileMemChunk(0, 0);
+		struct VFile* cheatVf = VFileMemChunk(0, 0);
 		if (cheatVf) {
 			mCheatSaveFile(device, cheatVf);
-			struct mStateExtdataItem item = {
-				.size = cheatVf->size(cheatVf),
-				.data = cheatVf->map(cheatVf, cheatVf->size(cheatVf), MAP_READ),
-				.clean = 0
-			};
-			mStateExtdataPut(&extdata, EXTDATA_CHEATS, &item);
+			size_t size = cheatVf->size(cheatVf);
+			void* cheats = malloc(size);
+			if (cheats) {
+				cheatVf->seek(cheatVf, 0, SEEK_SET);
+				cheatVf->read(cheatVf, cheats, size);
+				struct mStateExtdataItem item = {
+					.size = size,
+					.data = cheats,
+					.clean = free
+				};
+				mStateExtdataPut(extdata, EXTDATA_CHEATS, &item);
+			}
+			cheatVf->close(cheatVf);
 		}
 	}
 	if (flags & SAVESTATE_RTC) {
 		struct mStateExtdataItem item;
 		if (core->rtc.d.serialize) {
 			core->rtc.d.serialize(&core->rtc.d, &item);
-			mStateExtdataPut(&extdata, EXTDATA_RTC, &item);
+			mStateExtdataPut(extdata, EXTDATA_RTC, &item);
 		}
 	}
+}
+
+static bool _saveStateNamed(struct mCore* core, struct VFile* vf, int flags, uint32_t* checkpoint, struct mStateRangeList* written) {
+	struct mStateExtdata extdata;
+	mStateExtdataInit(&extdata);
+	size_t stateSize = core->stateSize(core);
+
+	if (flags & SAVESTATE_SECTIONED && !checkpoint) {
+		mStateExtdataDeinit(&extdata);
+		struct mStateSnapshot snapshot;
+		mStateSnapshotInit(&snapshot);
+		bool success = mCoreSnapshotState(core, &snapshot, flags) && mStateSnapshotWrite(&snapshot, vf);
+		mStateSnapshotDeinit(&snapshot);
+		return success;
+	}
+
+	_collectExtdata(core, &extdata, flags);
 #ifdef USE_PNG
 	if (!(flags & SAVESTATE_SCREENSHOT)) {
 #else
@@ -467,18 +542,25 @@ bool mCoreSaveStateNamed(struct mCore* core, struct VFile* vf, int flags) {
 		void* state = vf->map(vf, stateSize, MAP_WRITE);
 		if (!state) {
 			mStateExtdataDeinit(&extdata);
-			if (cheatVf) {
-				cheatVf->close(cheatVf);
-			}
 			return false;
 		}
-		core->saveState(core, state);
+		if (!checkpoint) {
+			core->saveState(core, state);
+		} else if (core->saveStateIncremental) {
+			*checkpoint = core->saveStateIncremental(core, state, *checkpoint, written);
+		} else {
+			core->saveState(core, state);
+			*checkpoint = 0;
+			if (written) {
+				mStateRangeListAdd(written, 0, stateSize);
+			}
+		}
 		vf->unmap(vf, state, stateSize);
 		vf->seek(vf, stateSize, SEEK_SET);
 		mStateExtdataSerialize(&extdata, vf);
 		mStateExtdataDeinit(&extdata);
-		if (cheatVf) {
-			cheatVf->close(cheatVf);
+		if (written) {
+			mStateRangeListAdd(written, stateSize, vf->size(vf) - stateSize);
 		}
 		return true;
 #ifdef USE_PNG
@@ -486,9 +568,6 @@ bool mCoreSaveStateNamed(struct mCore* core, struct VFile* vf, int flags) {
 	else {
 		bool success = _savePNGState(core, vf, &extdata);
 		mStateExtdataDeinit(&extdata);
-		if (cheatVf) {
-			cheatVf->close(cheatVf);
-		}
 		return success;
 	}
 #endif
@@ -496,7 +575,412 @@ bool mCoreSaveStateNamed(struct mCore* core, struct VFile* vf, int flags) {
 	return false;
 }
 
+bool mCoreSaveStateNamed(struct mCore* core, struct VFile* vf, int flags) {
+	return _saveStateNamed(core, vf, flags, NULL, NULL);
+}
+
+bool mCoreSaveStateIncremental(struct mCore* core, struct VFile* vf, int flags, uint32_t* checkpoint, struct mStateRangeList* written) {
+	if (written) {
+		mStateRangeListClear(written);
+	}
+	// The raw state has to stay at the start of the file for pages to be skipped in place
+	if (!_saveStateNamed(core, vf, flags & ~(SAVESTATE_SCREENSHOT | SAVESTATE_SECTIONED), checkpoint, written)) {
+		*checkpoint = 0;
+		return false;
+	}
+	return true;
+}
+
+static bool _snapshotPixels(struct mCore* core, struct mStateSnapshot* snapshot) {
+	size_t stride;
+	const void* pixels = NULL;
+	core->getPixels(core, &pixels, &stride);
+	if (!pixels) {
+		return false;
+	}
+	unsigned width, height;
+	core->currentVideoSize(core, &width, &height);
+	size_t size = width * height * BYTES_PER_PIXEL;
+	if (size > snapshot->pixelsCapacity) {
+		free(snapshot->pixels);
+		snapshot->pixelsCapacity = size;
+		snapshot->pixels = malloc(size);
+		if (!snapshot->pixels) {
+			snapshot->pixelsCapacity = 0;
+			return false;
+		}
+	}
+	// The screenshot is copied tightly packed, since the core's stride is only valid right now
+	unsigned y;
+	for (y = 0; y < height; ++y) {
+		memcpy((uint8_t*) snapshot->pixels + y * width * BYTES_PER_PIXEL, (const uint8_t*) pixels + y * stride * BYTES_PER_PIXEL, width * BYTES_PER_PIXEL);
+	}
+	snapshot->width = width;
+	snapshot->height = height;
+	return true;
+}
+
+bool mCoreSnapshotState(struct mCore* core, struct mStateSnapshot* snapshot, int flags) {
+	mStateExtdataDeinit(&snapshot->extdata);
+	mStateExtdataInit(&snapshot->extdata);
+	snapshot->flags = flags;
+	snapshot->stateSize = core->stateSize(core);
+	if (snapshot->stateSize > snapshot->stateCapacity) {
+		if (snapshot->state) {
+			mappedMemoryFree(snapshot->state, snapshot->stateCapacity);
+		}
+		snapshot->stateCapacity = snapshot->stateSize;
+		snapshot->state = anonymousMemoryMap(snapshot->stateCapacity);
+		if (!snapshot->state) {
+			snapshot->stateCapacity = 0;
+			return false;
+		}
+	}
+	core->saveState(core, snapshot->state);
+	_collectExtdata(core, &snapshot->extdata, flags);
+
+	snapshot->sections = NULL;
+	snapshot->nSections = 0;
+	if (core->listStateSections) {
+		snapshot->nSections = core->listStateSections(core, &snapshot->sections);
+	}
+
+	snapshot->width = 0;
+	snapshot->height = 0;
+#ifndef USE_PNG
+	// Sectioned states are the only ones that can hold a screenshot without PNG support
+	if (!(flags & SAVESTATE_SECTIONED)) {
+		return true;
+	}
+#endif
+	if (flags & SAVESTATE_SCREENSHOT) {
+		return _snapshotPixels(core, snapshot);
+	}
+	return true;
+}
+
+void mStateHashInit(struct mStateHash* context) {
+	context->state = NULL;
+	context->stateSize = 0;
+	context->checkpoint = 0;
+	context->chunks = NULL;
+	context->nChunks = 0;
+	mStateRangeListInit(&context->written, 0);
+}
+
+void mStateHashDeinit(struct mStateHash* context) {
+	if (context->state) {
+		mappedMemoryFree(context->state, context->stateSize);
+	}
+	free(context->chunks);
+	mStateRangeListDeinit(&context->written);
+	context->state = NULL;
+	context->stateSize = 0;
+	context->chunks = NULL;
+	context->nChunks = 0;
+}
+
+static uint64_t _hashChunk(const struct mStateHash* context, size_t chunk) {
+	size_t offset = chunk << mSTATE_HASH_CHUNK_SHIFT;
+	size_t size = context->stateSize - offset;
+	if (size > mSTATE_HASH_CHUNK_SIZE) {
+		size = mSTATE_HASH_CHUNK_SIZE;
+	}
+	return hash64((const uint8_t*) context->state + offset, size, chunk);
+}
+
+uint64_t mCoreHashState(struct mCore* core, struct mStateHash* context) {
+	if (!context) {
+		struct mStateHash temporary;
+		mStateHashInit(&temporary);
+		uint64_t hash = mCoreHashState(core, &temporary);
+		mStateHashDeinit(&temporary);
+		return hash;
+	}
+
+	size_t stateSize = core->stateSize(core);
+	if (stateSize != context->stateSize) {
+		mStateHashDeinit(context);
+		mStateRangeListInit(&context->written, 0);
+		context->state = anonymousMemoryMap(stateSize);
+		context->nChunks = (stateSize + mSTATE_HASH_CHUNK_SIZE - 1) >> mSTATE_HASH_CHUNK_SHIFT;
+		context->chunks = calloc(context->nChunks, sizeof(*context->chunks));
+		if (!context->state || !context->chunks) {
+			mStateHashDeinit(context);
+			return 0;
+		}
+		context->stateSize = stateSize;
+		context->checkpoint = 0;
+	}
+
+	mStateRangeListClear(&context->written);
+	if (core->saveStateIncremental) {
+		context->checkpoint = core->saveStateIncremental(core, context->state, context->checkpoint, &context->written);
+	} else {
+		core->saveState(core, context->state);
+		mStateRangeListAdd(&context->written, 0, stateSize);
+	}
+
+	// A chunk shared by neighboring ranges only needs hashing once
+	size_t lastChunk = SIZE_MAX;
+	size_t i;
+	for (i = 0; i < mStateRangeListSize(&context->written); ++i) {
+		const struct mStateRange* range = mStateRangeListGetConstPointer(&context->written, i);
+		size_t chunk = range->offset >> mSTATE_HASH_CHUNK_SHIFT;
+		size_t end = ((size_t) range->offset + range->size + mSTATE_HASH_CHUNK_SIZE - 1) >> mSTATE_HASH_CHUNK_SHIFT;
+		if (chunk == lastChunk) {
+			++chunk;
+		}
+		for (; chunk < end && chunk < context->nChunks; ++chunk) {
+			uint64_t hash = _hashChunk(context, chunk);
+			STORE_64LE(hash, chunk * sizeof(uint64_t), context->chunks);
+			lastChunk = chunk;
+		}
+	}
+	return hash64(context->chunks, context->nChunks * sizeof(uint64_t), stateSize);
+}
+
+uint64_t mStateHashBuffer(const void* state, size_t stateSize) {
+	struct mStateHash context = {
+		.state = (void*) state,
+		.stateSize = stateSize,
+		.nChunks = (stateSize + mSTATE_HASH_CHUNK_SIZE - 1) >> mSTATE_HASH_CHUNK_SHIFT
+	};
+	context.chunks = malloc(context.nChunks * sizeof(uint64_t));
+	if (!context.chunks) {
+		return 0;
+	}
+	size_t chunk;
+	for (chunk = 0; chunk < context.nChunks; ++chunk) {
+		uint64_t hash = _hashChunk(&context, chunk);
+		STORE_64LE(hash, chunk * sizeof(uint64_t), context.chunks);
+	}
+	uint64_t hash = hash64(context.chunks, context.nChunks * sizeof(uint64_t), stateSize);
+	free(context.chunks);
+	return hash;
+}
+
+void mStateSnapshotInit(struct mStateSnapshot* snapshot) {
+	memset(snapshot, 0, sizeof(*snapshot));
+	mStateExtdataInit(&snapshot->extdata);
+}
+
+void mStateSnapshotDeinit(struct mStateSnapshot* snapshot) {
+	mStateExtdataDeinit(&snapshot->extdata);
+	if (snapshot->state) {
+		mappedMemoryFree(snapshot->state, snapshot->stateCapacity);
+	}
+	free(snapshot->pixels);
+	memset(snapshot, 0, sizeof(*snapshot));
+}
+
+bool mStateSnapshotWrite(struct mStateSnapshot* snapshot, struct VFile* vf) {
+	if (snapshot->flags & SAVESTATE_SECTIONED) {
+		return mStateContainerWrite(vf, snapshot, true);
+	}
+#ifdef USE_PNG
+	if (snapshot->flags & SAVESTATE_SCREENSHOT) {
+		return _writePNGState(vf, snapshot->state, snapshot->stateSize, snapshot->pixels, snapshot->width, snapshot->width, snapshot->height, &snapshot->extdata);
+	}
+#endif
+	vf->truncate(vf, 0);
+	vf->seek(vf, 0, SEEK_SET);
+	if (vf->write(vf, snapshot->state, snapshot->stateSize) != (ssize_t) snapshot->stateSize) {
+		return false;
+	}
+	return mStateExtdataSerialize(&snapshot->extdata, vf);
+}
+
+static bool _writeJob(struct mStateWriterJob* job) {
+	bool success;
+	if (job->imageFormat[0]) {
+		struct mImage image = {
+			.data = job->snapshot.pixels,
+			.width = job->snapshot.width,
+			.height = job->snapshot.height,
+			.stride = job->snapshot.width,
+			.depth = BYTES_PER_PIXEL,
+			.format = mCOLOR_NATIVE,
+		};
+		success = mImageSaveVFCompressed(&image, job->vf, job->imageFormat, job->compression);
+	} else {
+		success = mStateSnapshotWrite(&job->snapshot, job->vf);
+	}
+	job->vf->close(job->vf);
+	job->vf = NULL;
+	// Savedata and the like aren't needed until the next snapshot refills them
+	mStateExtdataDeinit(&job->snapshot.extdata);
+	mStateExtdataInit(&job->snapshot.extdata);
+	if (job->callback) {
+		job->callback(success, job->context);
+	}
+	return success;
+}
+
+#ifndef DISABLE_THREADING
+static THREAD_ENTRY _stateWriterThread(void* context) {
+	struct mStateWriter* writer = context;
+	ThreadSetName("Savestate Writer");
+	MutexLock(&writer->mutex);
+	while (true) {
+		while (!mStateWriterJobListSize(&writer->pending) && !writer->stopping) {
+			ConditionWait(&writer->cond, &writer->mutex);
+		}
+		if (!mStateWriterJobListSize(&writer->pending)) {
+			break;
+		}
+		struct mStateWriterJob* job = *mStateWriterJobListGetPointer(&writer->pending, 0);
+		mStateWriterJobListShift(&writer->pending, 0, 1);
+		writer->busy = true;
+		MutexUnlock(&writer->mutex);
+
+		_writeJob(job);
+
+		MutexLock(&writer->mutex);
+		*mStateWriterJobListAppend(&writer->spare) = job;
+		writer->busy = false;
+		ConditionWake(&writer->doneCond);
+	}
+	MutexUnlock(&writer->mutex);
+	THREAD_EXIT(0);
+}
+#endif
+
+void mStateWriterInit(struct mStateWriter* writer) {
+	mStateWriterJobListInit(&writer->pending, 0);
+	mStateWriterJobListInit(&writer->spare, 0);
+#ifndef DISABLE_THREADING
+	writer->running = false;
+	writer->stopping = false;
+	writer->busy = false;
+	MutexInit(&writer->mutex);
+	ConditionInit(&writer->cond);
+	ConditionInit(&writer->doneCond);
+#endif
+}
+
+void mStateWriterDeinit(struct mStateWriter* writer) {
+#ifndef DISABLE_THREADING
+	if (writer->running) {
+		// Anything still queued gets written before the thread exits
+		MutexLock(&writer->mutex);
+		writer->stopping = true;
+		ConditionWake(&writer->cond);
+		MutexUnlock(&writer->mutex);
+		ThreadJoin(&writer->thread);
+		writer->running = false;
+	}
+	MutexDeinit(&writer->mutex);
+	ConditionDeinit(&writer->cond);
+	ConditionDeinit(&writer->doneCond);
+#endif
+	size_t i;
+	for (i = 0; i < mStateWriterJobListSize(&writer->spare); ++i) {
+		struct mStateWriterJob* job = *mStateWriterJobListGetPointer(&writer->spare, i);
+		mStateSnapshotDeinit(&job->snapshot);
+		free(job);
+	}
+	mStateWriterJobListDeinit(&writer->pending);
+	mStateWriterJobListDeinit(&writer->spare);
+}
+
+static struct mStateWriterJob* _acquireJob(struct mStateWriter* writer) {
+	struct mStateWriterJob* job = NULL;
+#ifndef DISABLE_THREADING
+	MutexLock(&writer->mutex);
+#endif
+	if (mStateWriterJobListSize(&writer->spare)) {
+		job = *mStateWriterJobListGetPointer(&writer->spare, mStateWriterJobListSize(&writer->spare) - 1);
+		mStateWriterJobListResize(&writer->spare, -1);
+	}
+#ifndef DISABLE_THREADING
+	MutexUnlock(&writer->mutex);
+#endif
+	if (!job) {
+		job = malloc(sizeof(*job));
+		if (!job) {
+			return NULL;
+		}
+		mStateSnapshotInit(&job->snapshot);
+	}
+	return job;
+}
+
+static void _queueJob(struct mStateWriter* writer, struct mStateWriterJob* job) {
+#ifndef DISABLE_THREADING
+	MutexLock(&writer->mutex);
+	if (!writer->running) {
+		writer->running = true;
+		writer->stopping = false;
+		ThreadCreate(&writer->thread, _stateWriterThread, writer);
+	}
+	*mStateWriterJobListAppend(&writer->pending) = job;
+	ConditionWake(&writer->cond);
+	MutexUnlock(&writer->mutex);
+#else
+	_writeJob(job);
+	*mStateWriterJobListAppend(&writer->spare) = job;
+#endif
+}
+
+bool mStateWriterSave(struct mStateWriter* writer, struct mCore* core, struct VFile* vf, int flags, mStateWriterCallback callback, void* context) {
+	struct mStateWriterJob* job = _acquireJob(writer);
+	if (!job) {
+		vf->close(vf);
+		return false;
+	}
+	if (!mCoreSnapshotState(core, &job->snapshot, flags)) {
+		vf->close(vf);
+		mStateSnapshotDeinit(&job->snapshot);
+		free(job);
+		return false;
+	}
+	job->vf = vf;
+	job->imageFormat[0] = '\0';
+	job->compression = -1;
+	job->callback = callback;
+	job->context = context;
+	_queueJob(writer, job);
+	return true;
+}
+
+bool mStateWriterScreenshot(struct mStateWriter* writer, struct mCore* core, struct VFile* vf, const char* format, int compression, mStateWriterCallback callback, void* context) {
+	struct mStateWriterJob* job = _acquireJob(writer);
+	if (!job) {
+		vf->close(vf);
+		return false;
+	}
+	if (!_snapshotPixels(core, &job->snapshot)) {
+		vf->close(vf);
+		mStateSnapshotDeinit(&job->snapshot);
+		free(job);
+		return false;
+	}
+	job->vf = vf;
+	strlcpy(job->imageFormat, format, sizeof(job->imageFormat));
+	job->compression = compression;
+	job->callback = callback;
+	job->context = context;
+	_queueJob(writer, job);
+	return true;
+}
+
+void mStateWriterFlush(struct mStateWriter* writer) {
+#ifndef DISABLE_THREADING
+	MutexLock(&writer->mutex);
+	while (mStateWriterJobListSize(&writer->pending) || writer->busy) {
+		ConditionWait(&writer->doneCond, &writer->mutex);
+	}
+	MutexUnlock(&writer->mutex);
+#else
+	UNUSED(writer);
+#endif
+}
+
 void* mCoreExtractState(struct mCore* core, struct VFile* vf, struct mStateExtdata* extdata) {
+	if (mStateContainerIsValid(vf)) {
+		return mStateContainerLoadState(vf, core->stateSize(core), extdata);
+	}
 #ifdef USE_PNG
 	if (isPNG(vf)) {
 		return _loadPNGState(core, vf, extdata);
@@ -516,6 +1000,9 @@ void* mCoreExtractState(struct mCore* core, struct VFile* vf, struct mStateExtda
 }
 
 bool mCoreExtractExtdata(struct mCore* core, struct VFile* vf, struct mStateExtdata* extdata) {
+	if (mStateContainerIsValid(vf)) {
+		return mStateContainerLoadExtdata(vf, extdata);
+	}
 #ifdef USE_PNG
 	if (isPNG(vf)) {
 		return _loadPNGExtdata(vf, extdata);
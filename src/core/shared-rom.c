@@ -0,0 +1,197 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/shared-rom.h>
+
+#include <mgba-util/memory.h>
+#include <mgba-util/threading.h>
+#include <mgba-util/vector.h>
+
+struct mSharedROMEntry {
+	struct SharedMemory memory;
+	void* contents;
+	size_t romSize;
+	uint32_t crc32;
+	size_t refs;
+};
+
+struct mSharedROMView {
+	void* view;
+	struct mSharedROMEntry* entry;
+};
+
+DECLARE_VECTOR(mSharedROMEntryList, struct mSharedROMEntry*);
+DEFINE_VECTOR(mSharedROMEntryList, struct mSharedROMEntry*);
+DECLARE_VECTOR(mSharedROMViewList, struct mSharedROMView);
+DEFINE_VECTOR(mSharedROMViewList, struct mSharedROMView);
+
+static bool _enabled = false;
+static Mutex _mutex;
+static struct mSharedROMEntryList _entries;
+static struct mSharedROMViewList _views;
+
+static struct mSharedROMEntry* _createEntry(const void* rom, size_t romSize, size_t mapSize, uint32_t crc32);
+static void _removeEntry(struct mSharedROMEntry* entry);
+static void _destroyEntry(struct mSharedROMEntry* entry);
+
+void mSharedROMInit(void) {
+	if (_enabled) {
+		return;
+	}
+	MutexInit(&_mutex);
+	mSharedROMEntryListInit(&_entries, 0);
+	mSharedROMViewListInit(&_views, 0);
+	_enabled = true;
+}
+
+void mSharedROMDeinit(void) {
+	if (!_enabled) {
+		return;
+	}
+	_enabled = false;
+	size_t i;
+	for (i = 0; i < mSharedROMViewListSize(&_views); ++i) {
+		struct mSharedROMView* view = mSharedROMViewListGetPointer(&_views, i);
+		sharedMemoryUnmap(&view->entry->memory, view->view);
+	}
+	for (i = 0; i < mSharedROMEntryListSize(&_entries); ++i) {
+		_destroyEntry(*mSharedROMEntryListGetPointer(&_entries, i));
+	}
+	mSharedROMViewListDeinit(&_views);
+	mSharedROMEntryListDeinit(&_entries);
+	MutexDeinit(&_mutex);
+}
+
+bool mSharedROMIsEnabled(void) {
+	return _enabled;
+}
+
+void* mSharedROMAcquire(const void* rom, size_t romSize, size_t mapSize, uint32_t crc32) {
+	if (!_enabled || romSize > mapSize) {
+		return NULL;
+	}
+	MutexLock(&_mutex);
+	struct mSharedROMEntry* entry = NULL;
+	size_t i;
+	for (i = 0; i < mSharedROMEntryListSize(&_entries); ++i) {
+		struct mSharedROMEntry* candidate = *mSharedROMEntryListGetPointer(&_entries, i);
+		if (candidate->crc32 != crc32 || candidate->romSize != romSize || candidate->memory.size != mapSize) {
+			continue;
+		}
+		// The CRC only narrows it down; make sure it's really the same ROM
+		if (memcmp(candidate->contents, rom, romSize) == 0) {
+			entry = candidate;
+			break;
+		}
+	}
+	if (!entry) {
+		entry = _createEntry(rom, romSize, mapSize, crc32);
+		if (!entry) {
+			MutexUnlock(&_mutex);
+			return NULL;
+		}
+		*mSharedROMEntryListAppend(&_entries) = entry;
+	}
+
+	void* view = sharedMemoryMap(&entry->memory, true);
+	if (view) {
+		++entry->refs;
+		*mSharedROMViewListAppend(&_views) = (struct mSharedROMView) {
+			.view = view,
+			.entry = entry,
+		};
+	} else if (!entry->refs) {
+		_removeEntry(entry);
+	}
+	MutexUnlock(&_mutex);
+	return view;
+}
+
+void* mSharedROMDuplicate(const void* view) {
+	if (!_enabled || !view) {
+		return NULL;
+	}
+	MutexLock(&_mutex);
+	void* duplicate = NULL;
+	size_t i;
+	for (i = 0; i < mSharedROMViewListSize(&_views); ++i) {
+		struct mSharedROMView* record = mSharedROMViewListGetPointer(&_views, i);
+		if (record->view != view) {
+			continue;
+		}
+		struct mSharedROMEntry* entry = record->entry;
+		duplicate = sharedMemoryMap(&entry->memory, true);
+		if (duplicate) {
+			++entry->refs;
+			*mSharedROMViewListAppend(&_views) = (struct mSharedROMView) {
+				.view = duplicate,
+				.entry = entry,
+			};
+		}
+		break;
+	}
+	MutexUnlock(&_mutex);
+	return duplicate;
+}
+
+void mSharedROMRelease(void* view) {
+	if (!_enabled || !view) {
+		return;
+	}
+	MutexLock(&_mutex);
+	size_t i;
+	for (i = 0; i < mSharedROMViewListSize(&_views); ++i) {
+		struct mSharedROMView* record = mSharedROMViewListGetPointer(&_views, i);
+		if (record->view != view) {
+			continue;
+		}
+		struct mSharedROMEntry* entry = record->entry;
+		sharedMemoryUnmap(&entry->memory, view);
+		mSharedROMViewListShift(&_views, i, 1);
+		--entry->refs;
+		if (!entry->refs) {
+			_removeEntry(entry);
+		}
+		break;
+	}
+	MutexUnlock(&_mutex);
+}
+
+static struct mSharedROMEntry* _createEntry(const void* rom, size_t romSize, size_t mapSize, uint32_t crc32) {
+	struct mSharedROMEntry* entry = calloc(1, sizeof(*entry));
+	if (!sharedMemoryCreate(&entry->memory, mapSize)) {
+		free(entry);
+		return NULL;
+	}
+	// Keep a writable view of the canonical copy around for comparing against
+	entry->contents = sharedMemoryMap(&entry->memory, false);
+	if (!entry->contents) {
+		sharedMemoryDestroy(&entry->memory);
+		free(entry);
+		return NULL;
+	}
+	memcpy(entry->contents, rom, romSize);
+	memset((uint8_t*) entry->contents + romSize, 0xFF, mapSize - romSize);
+	entry->romSize = romSize;
+	entry->crc32 = crc32;
+	return entry;
+}
+
+static void _removeEntry(struct mSharedROMEntry* entry) {
+	size_t i;
+	for (i = 0; i < mSharedROMEntryListSize(&_entries); ++i) {
+		if (*mSharedROMEntryListGetPointer(&_entries, i) == entry) {
+			mSharedROMEntryListShift(&_entries, i, 1);
+			break;
+		}
+	}
+	_destroyEntry(entry);
+}
+
+static void _destroyEntry(struct mSharedROMEntry* entry) {
+	sharedMemoryUnmap(&entry->memory, entry->contents);
+	sharedMemoryDestroy(&entry->memory);
+	free(entry);
+}
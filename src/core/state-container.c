@@ -0,0 +1,305 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/state-container.h>
+
+#include <mgba-util/image.h>
+#include <mgba-util/memory.h>
+#include <mgba-util/vfs.h>
+
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+
+#define HEADER_SIZE (mSTATE_CONTAINER_MAGIC_SIZE + 8)
+#define ENTRY_SIZE 32
+#define MAX_SECTIONS 0x1000
+// Sections smaller than this aren't worth compressing
+#define MIN_COMPRESS_SIZE 64
+
+DEFINE_VECTOR(mStateContainerEntryList, struct mStateContainerEntry);
+
+struct mStateContainerPart {
+	struct mStateContainerEntry entry;
+	const void* data;
+};
+
+static size_t _addPart(struct mStateContainerPart* parts, size_t nParts, uint32_t id, uint32_t offset, uint32_t size, const void* data) {
+	if (!size) {
+		return nParts;
+	}
+	memset(&parts[nParts], 0, sizeof(parts[nParts]));
+	parts[nParts].entry.id = id;
+	parts[nParts].entry.offset = offset;
+	parts[nParts].entry.size = size;
+	parts[nParts].data = data;
+	return nParts + 1;
+}
+
+static bool _writePadding(struct VFile* vf, size_t size) {
+	static const uint8_t zeroes[256] = {0};
+	while (size) {
+		size_t chunk = size < sizeof(zeroes) ? size : sizeof(zeroes);
+		if (vf->write(vf, zeroes, chunk) != (ssize_t) chunk) {
+			return false;
+		}
+		size -= chunk;
+	}
+	return true;
+}
+
+static bool _writePart(struct VFile* vf, struct mStateContainerPart* part, uint64_t* position, bool compressSections) {
+	struct mStateContainerEntry* entry = &part->entry;
+	const void* data = part->data;
+	void* buffer = NULL;
+	entry->codec = mSTATE_CODEC_RAW;
+	entry->storedSize = entry->size;
+#ifdef USE_ZLIB
+	if (compressSections && entry->size >= MIN_COMPRESS_SIZE) {
+		uLongf len = compressBound(entry->size);
+		buffer = malloc(len);
+		if (buffer && compress2(buffer, &len, data, entry->size, Z_BEST_SPEED) == Z_OK && len < entry->size) {
+			data = buffer;
+			entry->codec = mSTATE_CODEC_DEFLATE;
+			entry->storedSize = len;
+		}
+	}
+#else
+	UNUSED(compressSections);
+#endif
+
+	// Only stored sections big enough to be worth mapping get a page to themselves
+	uint64_t align = 16;
+	if (entry->codec == mSTATE_CODEC_RAW && entry->size >= mSTATE_CONTAINER_ALIGN) {
+		align = mSTATE_CONTAINER_ALIGN;
+	}
+	entry->fileOffset = (*position + align - 1) & ~(align - 1);
+	bool success = _writePadding(vf, entry->fileOffset - *position);
+	success = success && vf->write(vf, data, entry->storedSize) == (ssize_t) entry->storedSize;
+	*position = entry->fileOffset + entry->storedSize;
+	free(buffer);
+	return success;
+}
+
+bool mStateContainerWrite(struct VFile* vf, const struct mStateSnapshot* snapshot, bool compressSections) {
+	size_t maxParts = snapshot->nSections * 2 + 1 + EXTDATA_MAX + 2;
+	struct mStateContainerPart* parts = malloc(maxParts * sizeof(*parts));
+	if (!parts) {
+		return false;
+	}
+
+	// The raw state is split wherever the core has a section, and the parts in between
+	// are kept as they are
+	const uint8_t* state = snapshot->state;
+	uint32_t stateSize = snapshot->stateSize;
+	uint32_t cursor = 0;
+	size_t nParts = 0;
+	size_t i;
+	for (i = 0; i < snapshot->nSections; ++i) {
+		const struct mStateSection* section = &snapshot->sections[i];
+		if (section->offset < cursor || section->offset > stateSize || section->size > stateSize - section->offset) {
+			continue;
+		}
+		nParts = _addPart(parts, nParts, mSTATE_SECTION_STATE, cursor, section->offset - cursor, &state[cursor]);
+		nParts = _addPart(parts, nParts, section->id, section->offset, section->size, &state[section->offset]);
+		cursor = section->offset + section->size;
+	}
+	nParts = _addPart(parts, nParts, mSTATE_SECTION_STATE, cursor, stateSize - cursor, &state[cursor]);
+
+	uint16_t dims[2] = { snapshot->width, snapshot->height };
+	if (snapshot->width && snapshot->height && snapshot->pixels) {
+		nParts = _addPart(parts, nParts, mSTATE_SECTION_EXTDATA + EXTDATA_SCREENSHOT, 0, snapshot->width * snapshot->height * BYTES_PER_PIXEL, snapshot->pixels);
+		nParts = _addPart(parts, nParts, mSTATE_SECTION_EXTDATA + EXTDATA_SCREENSHOT_DIMENSIONS, 0, sizeof(dims), dims);
+	}
+	for (i = 1; i < EXTDATA_MAX; ++i) {
+		const struct mStateExtdataItem* item = &snapshot->extdata.data[i];
+		if (!item->data || item->size <= 0) {
+			continue;
+		}
+		if ((i == EXTDATA_SCREENSHOT || i == EXTDATA_SCREENSHOT_DIMENSIONS) && snapshot->pixels && snapshot->width) {
+			continue;
+		}
+		nParts = _addPart(parts, nParts, mSTATE_SECTION_EXTDATA + i, 0, item->size, item->data);
+	}
+
+	// The table of contents is written last, once it's known where everything went
+	size_t tocSize = HEADER_SIZE + nParts * ENTRY_SIZE;
+	uint8_t* toc = calloc(1, tocSize);
+	if (!toc) {
+		free(parts);
+		return false;
+	}
+	vf->truncate(vf, 0);
+	vf->seek(vf, 0, SEEK_SET);
+	bool success = vf->write(vf, toc, tocSize) == (ssize_t) tocSize;
+	uint64_t position = tocSize;
+	for (i = 0; i < nParts && success; ++i) {
+		success = _writePart(vf, &parts[i], &position, compressSections);
+	}
+
+	if (success) {
+		memcpy(toc, mSTATE_CONTAINER_MAGIC, mSTATE_CONTAINER_MAGIC_SIZE);
+		STORE_32LE(stateSize, mSTATE_CONTAINER_MAGIC_SIZE, toc);
+		STORE_32LE(nParts, mSTATE_CONTAINER_MAGIC_SIZE + 4, toc);
+		for (i = 0; i < nParts; ++i) {
+			uint8_t* raw = &toc[HEADER_SIZE + i * ENTRY_SIZE];
+			const struct mStateContainerEntry* entry = &parts[i].entry;
+			STORE_32LE(entry->id, offsetof(struct mStateContainerEntry, id), raw);
+			STORE_32LE(entry->codec, offsetof(struct mStateContainerEntry, codec), raw);
+			STORE_32LE(entry->offset, offsetof(struct mStateContainerEntry, offset), raw);
+			STORE_32LE(entry->size, offsetof(struct mStateContainerEntry, size), raw);
+			STORE_64LE(entry->fileOffset, offsetof(struct mStateContainerEntry, fileOffset), raw);
+			STORE_64LE(entry->storedSize, offsetof(struct mStateContainerEntry, storedSize), raw);
+		}
+		success = vf->seek(vf, 0, SEEK_SET) == 0 && vf->write(vf, toc, tocSize) == (ssize_t) tocSize;
+		vf->seek(vf, position, SEEK_SET);
+	}
+	free(toc);
+	free(parts);
+	return success;
+}
+
+bool mStateContainerIsValid(struct VFile* vf) {
+	char magic[mSTATE_CONTAINER_MAGIC_SIZE];
+	if (vf->seek(vf, 0, SEEK_SET) < 0) {
+		return false;
+	}
+	bool valid = vf->read(vf, magic, sizeof(magic)) == sizeof(magic) && memcmp(magic, mSTATE_CONTAINER_MAGIC, sizeof(magic)) == 0;
+	vf->seek(vf, 0, SEEK_SET);
+	return valid;
+}
+
+bool mStateContainerReadTOC(struct VFile* vf, struct mStateContainerEntryList* toc, uint32_t* stateSize) {
+	uint8_t header[HEADER_SIZE];
+	if (vf->seek(vf, 0, SEEK_SET) < 0 || vf->read(vf, header, sizeof(header)) != sizeof(header)) {
+		return false;
+	}
+	if (memcmp(header, mSTATE_CONTAINER_MAGIC, mSTATE_CONTAINER_MAGIC_SIZE) != 0) {
+		return false;
+	}
+	uint32_t nSections;
+	LOAD_32LE(*stateSize, mSTATE_CONTAINER_MAGIC_SIZE, header);
+	LOAD_32LE(nSections, mSTATE_CONTAINER_MAGIC_SIZE + 4, header);
+	if (nSections > MAX_SECTIONS) {
+		return false;
+	}
+
+	mStateContainerEntryListClear(toc);
+	uint32_t i;
+	for (i = 0; i < nSections; ++i) {
+		uint8_t raw[ENTRY_SIZE];
+		if (vf->read(vf, raw, sizeof(raw)) != sizeof(raw)) {
+			return false;
+		}
+		struct mStateContainerEntry* entry = mStateContainerEntryListAppend(toc);
+		LOAD_32LE(entry->id, offsetof(struct mStateContainerEntry, id), raw);
+		LOAD_32LE(entry->codec, offsetof(struct mStateContainerEntry, codec), raw);
+		LOAD_32LE(entry->offset, offsetof(struct mStateContainerEntry, offset), raw);
+		LOAD_32LE(entry->size, offsetof(struct mStateContainerEntry, size), raw);
+		LOAD_64LE(entry->fileOffset, offsetof(struct mStateContainerEntry, fileOffset), raw);
+		LOAD_64LE(entry->storedSize, offsetof(struct mStateContainerEntry, storedSize), raw);
+	}
+	return true;
+}
+
+bool mStateContainerReadSection(struct VFile* vf, const struct mStateContainerEntry* entry, void* out) {
+	if (vf->seek(vf, entry->fileOffset, SEEK_SET) < 0) {
+		return false;
+	}
+	switch (entry->codec) {
+	case mSTATE_CODEC_RAW:
+		if (entry->storedSize != entry->size) {
+			return false;
+		}
+		return vf->read(vf, out, entry->size) == (ssize_t) entry->size;
+#ifdef USE_ZLIB
+	case mSTATE_CODEC_DEFLATE: {
+		if (entry->storedSize > compressBound(entry->size)) {
+			return false;
+		}
+		void* buffer = malloc(entry->storedSize);
+		if (!buffer) {
+			return false;
+		}
+		bool success = vf->read(vf, buffer, entry->storedSize) == (ssize_t) entry->storedSize;
+		uLongf len = entry->size;
+		success = success && uncompress(out, &len, buffer, entry->storedSize) == Z_OK && len == entry->size;
+		free(buffer);
+		return success;
+	}
+#endif
+	default:
+		return false;
+	}
+}
+
+static void _loadExtdata(struct VFile* vf, const struct mStateContainerEntry* entry, struct mStateExtdata* extdata) {
+	uint32_t tag = entry->id - mSTATE_SECTION_EXTDATA;
+	if (tag == EXTDATA_NONE || tag >= EXTDATA_MAX || !entry->size || entry->size > INT32_MAX) {
+		return;
+	}
+	struct mStateExtdataItem item = {
+		.data = malloc(entry->size),
+		.size = entry->size,
+		.clean = free
+	};
+	if (!item.data) {
+		return;
+	}
+	if (!mStateContainerReadSection(vf, entry, item.data)) {
+		free(item.data);
+		return;
+	}
+	mStateExtdataPut(extdata, tag, &item);
+}
+
+void* mStateContainerLoadState(struct VFile* vf, size_t stateSize, struct mStateExtdata* extdata) {
+	struct mStateContainerEntryList toc;
+	mStateContainerEntryListInit(&toc, 16);
+	uint32_t containerStateSize;
+	if (!mStateContainerReadTOC(vf, &toc, &containerStateSize) || containerStateSize != stateSize) {
+		mStateContainerEntryListDeinit(&toc);
+		return NULL;
+	}
+
+	uint8_t* state = anonymousMemoryMap(stateSize);
+	if (!state) {
+		mStateContainerEntryListDeinit(&toc);
+		return NULL;
+	}
+	size_t i;
+	for (i = 0; i < mStateContainerEntryListSize(&toc); ++i) {
+		const struct mStateContainerEntry* entry = mStateContainerEntryListGetConstPointer(&toc, i);
+		if (entry->id >= mSTATE_SECTION_EXTDATA) {
+			if (extdata) {
+				_loadExtdata(vf, entry, extdata);
+			}
+			continue;
+		}
+		if (entry->offset > stateSize || entry->size > stateSize - entry->offset || !mStateContainerReadSection(vf, entry, &state[entry->offset])) {
+			mappedMemoryFree(state, stateSize);
+			state = NULL;
+			break;
+		}
+	}
+	mStateContainerEntryListDeinit(&toc);
+	return state;
+}
+
+bool mStateContainerLoadExtdata(struct VFile* vf, struct mStateExtdata* extdata) {
+	struct mStateContainerEntryList toc;
+	mStateContainerEntryListInit(&toc, 16);
+	uint32_t stateSize;
+	bool success = mStateContainerReadTOC(vf, &toc, &stateSize);
+	size_t i;
+	for (i = 0; success && i < mStateContainerEntryListSize(&toc); ++i) {
+		const struct mStateContainerEntry* entry = mStateContainerEntryListGetConstPointer(&toc, i);
+		if (entry->id >= mSTATE_SECTION_EXTDATA) {
+			_loadExtdata(vf, entry, extdata);
+		}
+	}
+	mStateContainerEntryListDeinit(&toc);
+	return success;
+}
@@ -0,0 +1,333 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/state-thumbnail.h>
+
+#include <mgba/core/core.h>
+#include <mgba/core/serialize.h>
+#include <mgba-util/crc32.h>
+#include <mgba-util/memory.h>
+#include <mgba-util/vfs.h>
+
+#include <sys/time.h>
+
+#define CACHE_MAGIC 0x4354534D // MSTC
+#define CACHE_VERSION 1
+#define CACHE_HEADER_SIZE 16
+
+// Every slot gets room for the largest preview, so updating one never moves the others.
+// Previews are stored as RGB565, which is plenty for something this small.
+#define RECORD_HEADER_SIZE 24
+#define RECORD_SIZE (RECORD_HEADER_SIZE + mSTATE_THUMBNAIL_MAX_WIDTH * mSTATE_THUMBNAIL_MAX_HEIGHT * 2)
+#define RECORD_VALID 1
+
+struct mStateThumbnailRecord {
+	uint32_t flags;
+	uint32_t stateSize;
+	uint64_t creationUsec;
+	uint16_t width;
+	uint16_t height;
+	// Covers everything but itself, so a record torn by a crash is just a cache miss
+	uint32_t crc32;
+	uint8_t pixels[mSTATE_THUMBNAIL_MAX_WIDTH * mSTATE_THUMBNAIL_MAX_HEIGHT * 2];
+};
+
+void mStateThumbnailInit(struct mStateThumbnail* thumbnail) {
+	memset(thumbnail, 0, sizeof(*thumbnail));
+}
+
+void mStateThumbnailDeinit(struct mStateThumbnail* thumbnail) {
+	free(thumbnail->pixels);
+	thumbnail->pixels = NULL;
+	thumbnail->width = 0;
+	thumbnail->height = 0;
+}
+
+#if defined(ENABLE_VFS) && defined(ENABLE_DIRECTORIES)
+static uint64_t _now(void) {
+#ifndef _MSC_VER
+	struct timeval tv;
+	if (!gettimeofday(&tv, 0)) {
+		return tv.tv_usec + tv.tv_sec * 1000000LL;
+	}
+#else
+	struct timespec ts;
+	if (timespec_get(&ts, TIME_UTC)) {
+		return ts.tv_nsec / 1000 + ts.tv_sec * 1000000LL;
+	}
+#endif
+	return 0;
+}
+
+// Box filters the frame down by whatever whole factor makes it fit
+static void _downscale(struct mStateThumbnailRecord* record, const mColor* pixels, size_t stride, unsigned width, unsigned height) {
+	unsigned factor = 1;
+	while (width / factor > mSTATE_THUMBNAIL_MAX_WIDTH || height / factor > mSTATE_THUMBNAIL_MAX_HEIGHT) {
+		++factor;
+	}
+	record->width = width / factor;
+	record->height = height / factor;
+	unsigned area = factor * factor;
+	unsigned x, y;
+	for (y = 0; y < record->height; ++y) {
+		for (x = 0; x < record->width; ++x) {
+			unsigned r = 0;
+			unsigned g = 0;
+			unsigned b = 0;
+			unsigned sx, sy;
+			for (sy = 0; sy < factor; ++sy) {
+				const mColor* row = &pixels[(y * factor + sy) * stride + x * factor];
+				for (sx = 0; sx < factor; ++sx) {
+					uint32_t color = mColorConvert(row[sx], mCOLOR_NATIVE, mCOLOR_XBGR8);
+					r += color & 0xFF;
+					g += (color >> 8) & 0xFF;
+					b += (color >> 16) & 0xFF;
+				}
+			}
+			uint32_t color = (r / area) | ((g / area) << 8) | ((b / area) << 16);
+			color = mColorConvert(color, mCOLOR_XBGR8, mCOLOR_RGB565);
+			STORE_16LE(color, (y * record->width + x) * 2, record->pixels);
+		}
+	}
+}
+
+static uint32_t _recordCrc32(const uint8_t* header, const struct mStateThumbnailRecord* record) {
+	uint32_t crc = crc32(0, header, RECORD_HEADER_SIZE - 4);
+	return crc32(crc, record->pixels, record->width * record->height * 2);
+}
+
+static struct VFile* _openCache(struct mCore* core, bool write) {
+	if (!core->dirs.state) {
+		return NULL;
+	}
+	char name[PATH_MAX + 14]; // Quash warning
+	snprintf(name, sizeof(name), "%s.ssc", core->dirs.baseName);
+	struct VFile* vf = core->dirs.state->openFile(core->dirs.state, name, write ? (O_CREAT | O_RDWR) : O_RDONLY);
+	if (!vf) {
+		return NULL;
+	}
+
+	uint8_t header[CACHE_HEADER_SIZE];
+	uint32_t magic = 0;
+	uint32_t version = 0;
+	uint32_t slots = 0;
+	if (vf->read(vf, header, sizeof(header)) == sizeof(header)) {
+		LOAD_32LE(magic, 0, header);
+		LOAD_32LE(version, 4, header);
+		LOAD_32LE(slots, 8, header);
+	}
+	if (magic == CACHE_MAGIC && version == CACHE_VERSION && slots == mSTATE_THUMBNAIL_SLOTS) {
+		return vf;
+	}
+	if (!write) {
+		vf->close(vf);
+		return NULL;
+	}
+
+	// Start over, dropping whatever was there
+	memset(header, 0, sizeof(header));
+	STORE_32LE(CACHE_MAGIC, 0, header);
+	STORE_32LE(CACHE_VERSION, 4, header);
+	STORE_32LE(mSTATE_THUMBNAIL_SLOTS, 8, header);
+	vf->truncate(vf, 0);
+	vf->seek(vf, 0, SEEK_SET);
+	if (vf->write(vf, header, sizeof(header)) != sizeof(header)) {
+		vf->close(vf);
+		return NULL;
+	}
+	return vf;
+}
+
+static bool _readRecord(struct VFile* vf, int slot, struct mStateThumbnailRecord* record) {
+	uint8_t header[RECORD_HEADER_SIZE];
+	vf->seek(vf, CACHE_HEADER_SIZE + slot * RECORD_SIZE, SEEK_SET);
+	if (vf->read(vf, header, sizeof(header)) != sizeof(header)) {
+		return false;
+	}
+	LOAD_32LE(record->flags, 0, header);
+	LOAD_32LE(record->stateSize, 4, header);
+	LOAD_64LE(record->creationUsec, 8, header);
+	LOAD_16LE(record->width, 16, header);
+	LOAD_16LE(record->height, 18, header);
+	LOAD_32LE(record->crc32, 20, header);
+	if (!(record->flags & RECORD_VALID)) {
+		return false;
+	}
+	if (record->width > mSTATE_THUMBNAIL_MAX_WIDTH || record->height > mSTATE_THUMBNAIL_MAX_HEIGHT) {
+		return false;
+	}
+	ssize_t size = record->width * record->height * 2;
+	if (vf->read(vf, record->pixels, size) != size) {
+		return false;
+	}
+	return _recordCrc32(header, record) == record->crc32;
+}
+
+static void _writeRecord(struct mCore* core, int slot, struct mStateThumbnailRecord* record) {
+	struct VFile* vf = _openCache(core, true);
+	if (!vf) {
+		return;
+	}
+	uint8_t header[RECORD_HEADER_SIZE];
+	STORE_32LE(record->flags, 0, header);
+	STORE_32LE(record->stateSize, 4, header);
+	STORE_64LE(record->creationUsec, 8, header);
+	STORE_16LE(record->width, 16, header);
+	STORE_16LE(record->height, 18, header);
+	record->crc32 = _recordCrc32(header, record);
+	STORE_32LE(record->crc32, 20, header);
+
+	vf->seek(vf, CACHE_HEADER_SIZE + slot * RECORD_SIZE, SEEK_SET);
+	if (vf->write(vf, header, sizeof(header)) == sizeof(header)) {
+		vf->write(vf, record->pixels, record->width * record->height * 2);
+	}
+	vf->close(vf);
+}
+
+static void _exportRecord(const struct mStateThumbnailRecord* record, struct mStateThumbnail* thumbnail) {
+	mStateThumbnailDeinit(thumbnail);
+	thumbnail->creationUsec = record->creationUsec;
+	if (!record->width || !record->height) {
+		return;
+	}
+	thumbnail->pixels = malloc(record->width * record->height * sizeof(mColor));
+	if (!thumbnail->pixels) {
+		return;
+	}
+	thumbnail->width = record->width;
+	thumbnail->height = record->height;
+	size_t i;
+	for (i = 0; i < thumbnail->width * thumbnail->height; ++i) {
+		uint16_t color;
+		LOAD_16LE(color, i * 2, record->pixels);
+		thumbnail->pixels[i] = mColorConvert(color, mCOLOR_RGB565, mCOLOR_NATIVE);
+	}
+}
+
+// Decodes the whole state, like the slot menus had to before there was a cache
+static bool _decodeRecord(struct mCore* core, struct VFile* vf, struct mStateThumbnailRecord* record) {
+	struct mStateExtdata extdata;
+	mStateExtdataInit(&extdata);
+	void* state = mCoreExtractState(core, vf, &extdata);
+	if (!state) {
+		mStateExtdataDeinit(&extdata);
+		return false;
+	}
+	mappedMemoryFree(state, core->stateSize(core));
+
+	record->flags = RECORD_VALID;
+	record->creationUsec = 0;
+	record->width = 0;
+	record->height = 0;
+
+	struct mStateExtdataItem item;
+	if (mStateExtdataGet(&extdata, EXTDATA_META_TIME, &item) && item.size == sizeof(uint64_t)) {
+		LOAD_64LE(record->creationUsec, 0, item.data);
+	}
+	if (mStateExtdataGet(&extdata, EXTDATA_SCREENSHOT, &item)) {
+		unsigned width, height;
+		core->currentVideoSize(core, &width, &height);
+		struct mStateExtdataItem dims;
+		if (mStateExtdataGet(&extdata, EXTDATA_SCREENSHOT_DIMENSIONS, &dims) && dims.size == sizeof(uint16_t[2])) {
+			width = ((uint16_t*) dims.data)[0];
+			height = ((uint16_t*) dims.data)[1];
+		}
+		if (item.size >= (int32_t) (width * height * BYTES_PER_PIXEL)) {
+			_downscale(record, item.data, width, width, height);
+		}
+	}
+	mStateExtdataDeinit(&extdata);
+	return true;
+}
+
+bool mCoreLoadStateThumbnail(struct mCore* core, int slot, struct mStateThumbnail* thumbnail) {
+	struct VFile* state = mCoreGetState(core, slot, false);
+	if (!state) {
+		return false;
+	}
+	uint32_t stateSize = state->size(state);
+
+	struct mStateThumbnailRecord* record = malloc(sizeof(*record));
+	if (!record) {
+		state->close(state);
+		return false;
+	}
+	bool success = false;
+	if (slot < mSTATE_THUMBNAIL_SLOTS) {
+		struct VFile* cache = _openCache(core, false);
+		if (cache) {
+			success = _readRecord(cache, slot, record);
+			cache->close(cache);
+		}
+		if (success && record->stateSize != stateSize) {
+			if (record->stateSize) {
+				success = false;
+			} else {
+				// The state was still being written when this was cached
+				record->stateSize = stateSize;
+				_writeRecord(core, slot, record);
+			}
+		}
+	}
+	if (!success) {
+		success = _decodeRecord(core, state, record);
+		if (success && slot < mSTATE_THUMBNAIL_SLOTS) {
+			record->stateSize = stateSize;
+			_writeRecord(core, slot, record);
+		}
+	}
+	state->close(state);
+
+	if (success) {
+		_exportRecord(record, thumbnail);
+	}
+	free(record);
+	return success;
+}
+
+void mCoreStoreStateThumbnail(struct mCore* core, int slot, int flags, uint32_t stateSize) {
+	if (slot < 0 || slot >= mSTATE_THUMBNAIL_SLOTS) {
+		return;
+	}
+	struct mStateThumbnailRecord* record = malloc(sizeof(*record));
+	if (!record) {
+		return;
+	}
+	record->flags = RECORD_VALID;
+	record->stateSize = stateSize;
+	record->creationUsec = 0;
+	record->width = 0;
+	record->height = 0;
+	if (flags & SAVESTATE_METADATA) {
+		record->creationUsec = _now();
+	}
+	if (flags & SAVESTATE_SCREENSHOT) {
+		unsigned width, height;
+		size_t stride;
+		const void* pixels;
+		core->currentVideoSize(core, &width, &height);
+		core->getPixels(core, &pixels, &stride);
+		if (pixels) {
+			_downscale(record, pixels, stride, width, height);
+		}
+	}
+	_writeRecord(core, slot, record);
+	free(record);
+}
+
+void mCoreInvalidateStateThumbnail(struct mCore* core, int slot) {
+	if (slot < 0 || slot >= mSTATE_THUMBNAIL_SLOTS) {
+		return;
+	}
+	struct VFile* vf = _openCache(core, true);
+	if (!vf) {
+		return;
+	}
+	uint8_t header[RECORD_HEADER_SIZE] = {0};
+	vf->seek(vf, CACHE_HEADER_SIZE + slot * RECORD_SIZE, SEEK_SET);
+	vf->write(vf, header, sizeof(header));
+	vf->close(vf);
+}
+#endif
@@ -5,8 +5,31 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/core/sync.h>
 
+#include <mgba/core/host-trace.h>
 #include <mgba-util/audio-buffer.h>
 
+#include <errno.h>
+
+#ifdef _WIN32
+#include <mmsystem.h>
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#endif
+
+#define FRAME_SLOT_MASK 3
+#define FRAME_SLOT_FRESH 4
+
+// Timers can wake up this much after they were due, even on a good day. Windows timers
+// without the high-resolution flag are a lot coarser, so the spin starts out longer there.
+#define LIMITER_MIN_SPIN 100000
+#define LIMITER_MAX_SPIN 4000000
+#ifdef _WIN32
+#define LIMITER_INITIAL_SPIN 1500000
+#else
+#define LIMITER_INITIAL_SPIN 500000
+#endif
+
 static void _changeVideoSync(struct mCoreSync* sync, bool wait) {
 	// Make sure the video thread can process events while the GBA thread is paused
 	MutexLock(&sync->videoFrameMutex);
@@ -17,13 +40,48 @@ static void _changeVideoSync(struct mCoreSync* sync, bool wait) {
 	MutexUnlock(&sync->videoFrameMutex);
 }
 
+static bool _isLockFree(const struct mCoreSync* sync) {
+	return sync->videoTripleBuffer && !sync->videoFrameWait;
+}
+
+static uint32_t _exchangeFrameSlot(struct mCoreSync* sync, uint32_t slot) {
+	uint32_t old;
+	do {
+		ATOMIC_LOAD(old, sync->videoFrameShared);
+	} while (!ATOMIC_CMPXCHG(sync->videoFrameShared, old, slot));
+	return old;
+}
+
+static void _limitFrame(struct mCoreSync* sync) {
+	if (sync->fpsTarget <= 0) {
+		return;
+	}
+	mTRACE_BEGIN("Sync: limit frame");
+	mCoreFrameLimiterWait(&sync->frameLimiter, sync->fpsTarget);
+	MutexLock(&sync->videoFrameMutex);
+	sync->frameLimiterStats = sync->frameLimiter.stats;
+	MutexUnlock(&sync->videoFrameMutex);
+	mTRACE_END();
+}
+
 void mCoreSyncPostFrame(struct mCoreSync* sync) {
 	if (!sync) {
 		return;
 	}
 
+	if (sync->frameLimit) {
+		_limitFrame(sync);
+	}
+
+	if (_isLockFree(sync)) {
+		// The display only ever picks up the newest frame, so there's nothing to wait on
+		ATOMIC_ADD(sync->videoFramePending, 1);
+		return;
+	}
+
+	mTRACE_BEGIN("Sync: post frame");
 	MutexLock(&sync->videoFrameMutex);
-	++sync->videoFramePending;
+	ATOMIC_ADD(sync->videoFramePending, 1);
 	do {
 		ConditionWake(&sync->videoFrameAvailableCond);
 		if (sync->videoFrameWait) {
@@ -31,6 +89,7 @@ void mCoreSyncPostFrame(struct mCoreSync* sync) {
 		}
 	} while (sync->videoFrameWait && sync->videoFramePending);
 	MutexUnlock(&sync->videoFrameMutex);
+	mTRACE_END();
 }
 
 void mCoreSyncForceFrame(struct mCoreSync* sync) {
@@ -48,24 +107,45 @@ bool mCoreSyncWaitFrameStart(struct mCoreSync* sync) {
 		return true;
 	}
 
+	if (_isLockFree(sync)) {
+		sync->videoFrameLocked = false;
+		int pending;
+		do {
+			ATOMIC_LOAD(pending, sync->videoFramePending);
+		} while (pending && !ATOMIC_CMPXCHG(sync->videoFramePending, pending, 0));
+		if (!pending) {
+			return false;
+		}
+		sync->videoFrameConsumed = true;
+		return true;
+	}
+
+	mTRACE_BEGIN("Sync: wait for frame");
 	MutexLock(&sync->videoFrameMutex);
+	sync->videoFrameLocked = true;
 	if (!sync->videoFrameWait && !sync->videoFramePending) {
+		mTRACE_END();
 		return false;
 	}
 	if (sync->videoFrameWait) {
 		ConditionWake(&sync->videoFrameRequiredCond);
 		if (ConditionWaitTimed(&sync->videoFrameAvailableCond, &sync->videoFrameMutex, 50)) {
+			mTRACE_END();
+			mTRACE_INSTANT("Sync: frame wait timed out");
 			return false;
 		}
 	}
-	sync->videoFramePending = 0;
+	mTRACE_END();
+	ATOMIC_STORE(sync->videoFramePending, 0);
+	sync->videoFrameConsumed = true;
 	return true;
 }
 
 void mCoreSyncWaitFrameEnd(struct mCoreSync* sync) {
-	if (!sync) {
+	if (!sync || !sync->videoFrameLocked) {
 		return;
 	}
+	sync->videoFrameLocked = false;
 
 	ConditionWake(&sync->videoFrameRequiredCond);
 	MutexUnlock(&sync->videoFrameMutex);
@@ -79,19 +159,120 @@ void mCoreSyncSetVideoSync(struct mCoreSync* sync, bool wait) {
 	_changeVideoSync(sync, wait);
 }
 
+bool mCoreSyncWantsFrame(struct mCoreSync* sync) {
+	if (!sync) {
+		return true;
+	}
+
+	bool lockFree = _isLockFree(sync);
+	if (!lockFree) {
+		MutexLock(&sync->videoFrameMutex);
+	}
+	int pending;
+	ATOMIC_LOAD(pending, sync->videoFramePending);
+	// If the display has already missed a frame while running unsynced, it will only
+	// ever show the newest one, so there's no point in drawing the ones in between
+	bool wanted = sync->videoFrameWait || !sync->videoFrameConsumed || pending < 2;
+	if (!lockFree) {
+		MutexUnlock(&sync->videoFrameMutex);
+	}
+	return wanted;
+}
+
+void mCoreSyncSetTripleBuffer(struct mCoreSync* sync, bool enable) {
+	if (!sync) {
+		return;
+	}
+
+	MutexLock(&sync->videoFrameMutex);
+	sync->videoTripleBuffer = enable;
+	sync->videoFrameBack = 0;
+	sync->videoFrameFront = 1;
+	ATOMIC_STORE(sync->videoFrameShared, 2);
+	MutexUnlock(&sync->videoFrameMutex);
+}
+
+unsigned mCoreSyncPublishFrame(struct mCoreSync* sync) {
+	uint32_t old = _exchangeFrameSlot(sync, sync->videoFrameBack | FRAME_SLOT_FRESH);
+	sync->videoFrameBack = old & FRAME_SLOT_MASK;
+	return sync->videoFrameBack;
+}
+
+bool mCoreSyncTakeFrame(struct mCoreSync* sync, unsigned* slot) {
+	uint32_t shared;
+	ATOMIC_LOAD(shared, sync->videoFrameShared);
+	bool fresh = shared & FRAME_SLOT_FRESH;
+	if (fresh) {
+		uint32_t old = _exchangeFrameSlot(sync, sync->videoFrameFront);
+		sync->videoFrameFront = old & FRAME_SLOT_MASK;
+	}
+	*slot = sync->videoFrameFront;
+	return fresh;
+}
+
+void mCoreSyncGetFrameLimiterStats(struct mCoreSync* sync, struct mCoreFrameLimiterStats* stats) {
+	MutexLock(&sync->videoFrameMutex);
+	*stats = sync->frameLimiterStats;
+	MutexUnlock(&sync->videoFrameMutex);
+}
+
+void mCoreSyncReportPresent(struct mCoreSync* sync, uint32_t latency, unsigned missedVblanks, unsigned queueDepth) {
+	if (!sync) {
+		return;
+	}
+
+	MutexLock(&sync->videoFrameMutex);
+	struct mCorePresentStats* stats = &sync->presentStats;
+	if (!stats->frames) {
+		stats->averageLatency = latency;
+	} else {
+		// Exponential moving average over roughly the last 16 frames
+		stats->averageLatency += ((int64_t) latency - (int64_t) stats->averageLatency) / 16;
+	}
+	if (latency > stats->maxLatency) {
+		stats->maxLatency = latency;
+	}
+	++stats->frames;
+	stats->latency = latency;
+	stats->missedVblanks += missedVblanks;
+	stats->queueDepth = queueDepth;
+	MutexUnlock(&sync->videoFrameMutex);
+}
+
+void mCoreSyncGetPresentStats(struct mCoreSync* sync, struct mCorePresentStats* stats) {
+	MutexLock(&sync->videoFrameMutex);
+	*stats = sync->presentStats;
+	MutexUnlock(&sync->videoFrameMutex);
+}
+
+void mCoreSyncResetPresentStats(struct mCoreSync* sync) {
+	MutexLock(&sync->videoFrameMutex);
+	memset(&sync->presentStats, 0, sizeof(sync->presentStats));
+	MutexUnlock(&sync->videoFrameMutex);
+}
+
 bool mCoreSyncProduceAudio(struct mCoreSync* sync, const struct mAudioBuffer* buf) {
 	if (!sync) {
 		return true;
 	}
 
+	// The buffer can be written without holding the lock, so it's only needed
+	// here if the consumer is behind and there's actually something to wait on
 	size_t produced = mAudioBufferAvailable(buf);
 	size_t producedNew = produced;
+	if (!sync->audioWait || !sync->audioHighWater || producedNew < sync->audioHighWater) {
+		return false;
+	}
+	mTRACE_COUNTER("Audio: buffered samples", producedNew);
+	mTRACE_BEGIN("Sync: wait for audio consumer");
+	MutexLock(&sync->audioBufferMutex);
 	while (sync->audioWait && sync->audioHighWater && producedNew >= sync->audioHighWater) {
 		ConditionWait(&sync->audioRequiredCond, &sync->audioBufferMutex);
 		produced = producedNew;
 		producedNew = mAudioBufferAvailable(buf);
 	}
 	MutexUnlock(&sync->audioBufferMutex);
+	mTRACE_END();
 	return producedNew != produced;
 }
 
@@ -100,7 +281,9 @@ void mCoreSyncLockAudio(struct mCoreSync* sync) {
 		return;
 	}
 
+	mTRACE_BEGIN("Sync: lock audio");
 	MutexLock(&sync->audioBufferMutex);
+	mTRACE_END();
 }
 
 void mCoreSyncUnlockAudio(struct mCoreSync* sync) {
@@ -119,3 +302,142 @@ void mCoreSyncConsumeAudio(struct mCoreSync* sync) {
 	ConditionWake(&sync->audioRequiredCond);
 	MutexUnlock(&sync->audioBufferMutex);
 }
+
+static uint64_t _limiterNow(void) {
+#ifdef _WIN32
+	LARGE_INTEGER counter;
+	LARGE_INTEGER frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return (counter.QuadPart / frequency.QuadPart) * UINT64_C(1000000000) + (counter.QuadPart % frequency.QuadPart) * UINT64_C(1000000000) / frequency.QuadPart;
+#elif defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec * UINT64_C(1000000000) + tv.tv_usec * UINT64_C(1000);
+#endif
+}
+
+static void _limiterSleep(struct mCoreFrameLimiter* limiter, uint64_t until) {
+#ifdef _WIN32
+	if (limiter->timer) {
+		uint64_t now = _limiterNow();
+		if (until <= now) {
+			return;
+		}
+		// Relative times are negative, in units of 100ns
+		LARGE_INTEGER due;
+		due.QuadPart = -(LONGLONG) ((until - now) / 100);
+		if (SetWaitableTimer(limiter->timer, &due, 0, NULL, NULL, FALSE)) {
+			WaitForSingleObject(limiter->timer, INFINITE);
+			return;
+		}
+	}
+	uint64_t now = _limiterNow();
+	if (until > now + 1000000) {
+		Sleep((DWORD) ((until - now) / 1000000));
+	}
+#elif defined(TIMER_ABSTIME) && defined(CLOCK_MONOTONIC) && !defined(__APPLE__)
+	UNUSED(limiter);
+	struct timespec ts = {
+		.tv_sec = until / UINT64_C(1000000000),
+		.tv_nsec = until % UINT64_C(1000000000),
+	};
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+#else
+	UNUSED(limiter);
+	uint64_t now = _limiterNow();
+	if (until <= now) {
+		return;
+	}
+	struct timespec ts = {
+		.tv_sec = (until - now) / UINT64_C(1000000000),
+		.tv_nsec = (until - now) % UINT64_C(1000000000),
+	};
+	nanosleep(&ts, NULL);
+#endif
+}
+
+void mCoreFrameLimiterInit(struct mCoreFrameLimiter* limiter) {
+	memset(limiter, 0, sizeof(*limiter));
+	limiter->spin = LIMITER_INITIAL_SPIN;
+#ifdef _WIN32
+	timeBeginPeriod(1);
+	limiter->timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+	if (!limiter->timer) {
+		// Older versions of Windows don't have high-resolution timers
+		limiter->timer = CreateWaitableTimerExW(NULL, NULL, 0, TIMER_ALL_ACCESS);
+	}
+#endif
+}
+
+void mCoreFrameLimiterDeinit(struct mCoreFrameLimiter* limiter) {
+#ifdef _WIN32
+	if (limiter->timer) {
+		CloseHandle(limiter->timer);
+	}
+	timeEndPeriod(1);
+#endif
+	limiter->timer = NULL;
+}
+
+void mCoreFrameLimiterReset(struct mCoreFrameLimiter* limiter) {
+	limiter->deadline = 0;
+	memset(&limiter->stats, 0, sizeof(limiter->stats));
+}
+
+void mCoreFrameLimiterWait(struct mCoreFrameLimiter* limiter, float fps) {
+	uint64_t interval = 1000000000.0 / fps;
+	uint64_t now = _limiterNow();
+	if (!limiter->deadline || interval != limiter->interval || now >= limiter->deadline + interval) {
+		// Either this is the first frame, or the rate changed, or it fell more than a
+		// whole frame behind, like after a pause, so start the cadence over from here
+		limiter->interval = interval;
+		limiter->deadline = now + interval;
+		return;
+	}
+
+	uint64_t jitter;
+	if (now >= limiter->deadline) {
+		jitter = now - limiter->deadline;
+		++limiter->stats.lateFrames;
+	} else {
+		if (limiter->deadline - now > limiter->spin) {
+			uint64_t wake = limiter->deadline - limiter->spin;
+			_limiterSleep(limiter, wake);
+			// Keep enough of a margin to cover about twice how late the timer wakes up
+			uint64_t woke = _limiterNow();
+			int64_t overshoot = woke > wake ? woke - wake : 0;
+			int64_t spin = limiter->spin + (overshoot * 2 + LIMITER_MIN_SPIN - (int64_t) limiter->spin) / 8;
+			if (spin < LIMITER_MIN_SPIN) {
+				spin = LIMITER_MIN_SPIN;
+			} else if (spin > LIMITER_MAX_SPIN) {
+				spin = LIMITER_MAX_SPIN;
+			}
+			limiter->spin = spin;
+		}
+		do {
+			now = _limiterNow();
+		} while (now < limiter->deadline);
+		jitter = now - limiter->deadline;
+	}
+	limiter->deadline += interval;
+
+	if (jitter > UINT32_MAX) {
+		jitter = UINT32_MAX;
+	}
+	struct mCoreFrameLimiterStats* stats = &limiter->stats;
+	if (!stats->frames) {
+		stats->averageJitter = jitter;
+	} else {
+		stats->averageJitter += ((int64_t) jitter - (int64_t) stats->averageJitter) / 16;
+	}
+	if (jitter > stats->maxJitter) {
+		stats->maxJitter = jitter;
+	}
+	stats->jitter = jitter;
+	++stats->frames;
+}
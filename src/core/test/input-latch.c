@@ -0,0 +1,142 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/core/input-latch.h>
+
+struct mTestKeyCore {
+	struct mCore d;
+	uint32_t keys;
+	int calls;
+};
+
+static void _addKeys(struct mCore* core, uint32_t keys) {
+	struct mTestKeyCore* test = (struct mTestKeyCore*) core;
+	test->keys |= keys;
+	++test->calls;
+}
+
+static void _clearKeys(struct mCore* core, uint32_t keys) {
+	struct mTestKeyCore* test = (struct mTestKeyCore*) core;
+	test->keys &= ~keys;
+	++test->calls;
+}
+
+static int latchSetup(void** state) {
+	struct mInputLatch* latch = malloc(sizeof(*latch));
+	mInputLatchInit(latch);
+	*state = latch;
+	return 0;
+}
+
+static int latchTeardown(void** state) {
+	struct mInputLatch* latch = *state;
+	mInputLatchDeinit(latch);
+	free(latch);
+	return 0;
+}
+
+static void _initCore(struct mTestKeyCore* core) {
+	memset(core, 0, sizeof(*core));
+	core->d.addKeys = _addKeys;
+	core->d.clearKeys = _clearKeys;
+}
+
+M_TEST_DEFINE(applyChanges) {
+	struct mInputLatch* latch = *state;
+	struct mTestKeyCore core;
+	_initCore(&core);
+
+	mInputLatchAddKeys(latch, 0x5, mInputLatchNow());
+	assert_int_equal(core.keys, 0);
+	mInputLatchApply(latch, &core.d);
+	assert_int_equal(core.keys, 0x5);
+
+	mInputLatchClearKeys(latch, 0x1, mInputLatchNow());
+	mInputLatchAddKeys(latch, 0x8, mInputLatchNow());
+	mInputLatchApply(latch, &core.d);
+	assert_int_equal(core.keys, 0xC);
+
+	mInputLatchSetKeys(latch, 0x2, mInputLatchNow());
+	mInputLatchApply(latch, &core.d);
+	assert_int_equal(core.keys, 0x2);
+}
+
+M_TEST_DEFINE(keepOtherKeys) {
+	struct mInputLatch* latch = *state;
+	struct mTestKeyCore core;
+	_initCore(&core);
+
+	mInputLatchAddKeys(latch, 0x1, mInputLatchNow());
+	mInputLatchApply(latch, &core.d);
+	core.keys |= 0x10;
+
+	// Nothing changed in the latch, so the core's keys are left alone
+	int calls = core.calls;
+	mInputLatchApply(latch, &core.d);
+	assert_int_equal(core.calls, calls);
+	assert_int_equal(core.keys, 0x11);
+
+	mInputLatchClearKeys(latch, 0x1, mInputLatchNow());
+	mInputLatchApply(latch, &core.d);
+	assert_int_equal(core.keys, 0x10);
+}
+
+M_TEST_DEFINE(undoneChange) {
+	struct mInputLatch* latch = *state;
+	struct mTestKeyCore core;
+	_initCore(&core);
+
+	mInputLatchAddKeys(latch, 0x1, mInputLatchNow());
+	mInputLatchClearKeys(latch, 0x1, mInputLatchNow());
+	mInputLatchApply(latch, &core.d);
+	assert_int_equal(core.calls, 0);
+
+	struct mInputLatchStats stats;
+	mInputLatchGetStats(latch, &stats);
+	assert_int_equal(stats.changes, 0);
+}
+
+M_TEST_DEFINE(measureLatency) {
+	struct mInputLatch* latch = *state;
+	struct mTestKeyCore core;
+	_initCore(&core);
+
+	struct mInputLatchStats stats;
+	mInputLatchGetStats(latch, &stats);
+	assert_int_equal(stats.changes, 0);
+
+	// Stamped 5 ms in the past, with a later change that shouldn't count separately
+	uint64_t now = mInputLatchNow();
+	mInputLatchAddKeys(latch, 0x1, now - 5000000);
+	mInputLatchAddKeys(latch, 0x2, now);
+	mInputLatchApply(latch, &core.d);
+
+	mInputLatchGetStats(latch, &stats);
+	assert_int_equal(stats.changes, 1);
+	assert_true(stats.latency >= 5000);
+	assert_int_equal(stats.averageLatency, stats.latency);
+	assert_int_equal(stats.maxLatency, stats.latency);
+
+	mInputLatchClearKeys(latch, 0x3, mInputLatchNow());
+	mInputLatchApply(latch, &core.d);
+	mInputLatchGetStats(latch, &stats);
+	assert_int_equal(stats.changes, 2);
+	assert_true(stats.latency < stats.maxLatency);
+	assert_true(stats.maxLatency >= 5000);
+
+	mInputLatchResetStats(latch);
+	mInputLatchGetStats(latch, &stats);
+	assert_int_equal(stats.changes, 0);
+	assert_int_equal(stats.maxLatency, 0);
+}
+
+M_TEST_SUITE_DEFINE(mInputLatch,
+	cmocka_unit_test_setup_teardown(applyChanges, latchSetup, latchTeardown),
+	cmocka_unit_test_setup_teardown(keepOtherKeys, latchSetup, latchTeardown),
+	cmocka_unit_test_setup_teardown(undoneChange, latchSetup, latchTeardown),
+	cmocka_unit_test_setup_teardown(measureLatency, latchSetup, latchTeardown))
@@ -0,0 +1,185 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/log.h>
+#include <mgba-util/threading.h>
+
+#define LOG_THREADS 4
+#define LOG_LINES 200
+
+mLOG_DECLARE_CATEGORY(TEST);
+mLOG_DEFINE_CATEGORY(TEST, "Test", "test.log");
+
+struct TestLogger {
+	struct mLogger d;
+	char lines[LOG_THREADS * LOG_LINES + 1][512];
+	int levels[LOG_THREADS * LOG_LINES + 1];
+	int count;
+};
+
+static void _testLog(struct mLogger* logger, int category, enum mLogLevel level, const char* format, va_list args) {
+	UNUSED(category);
+	struct TestLogger* test = (struct TestLogger*) logger;
+	if (test->count >= (int) (sizeof(test->lines) / sizeof(*test->lines))) {
+		return;
+	}
+	vsnprintf(test->lines[test->count], sizeof(*test->lines), format, args);
+	test->levels[test->count] = level;
+	++test->count;
+}
+
+M_TEST_DEFINE(filterDefault) {
+	struct mLogFilter filter;
+	mLogFilterInit(&filter);
+	filter.defaultLevels = mLOG_ERROR | mLOG_WARN;
+	assert_true(mLogFilterTest(&filter, _mLOG_CAT_TEST, mLOG_ERROR));
+	assert_true(mLogFilterTest(&filter, _mLOG_CAT_TEST, mLOG_WARN));
+	assert_false(mLogFilterTest(&filter, _mLOG_CAT_TEST, mLOG_DEBUG));
+	assert_int_equal(mLogFilterLevels(&filter, _mLOG_CAT_TEST), 0);
+
+	filter.defaultLevels = mLOG_DEBUG;
+	assert_false(mLogFilterTest(&filter, _mLOG_CAT_TEST, mLOG_ERROR));
+	assert_true(mLogFilterTest(&filter, _mLOG_CAT_TEST, mLOG_DEBUG));
+	mLogFilterDeinit(&filter);
+}
+
+M_TEST_DEFINE(filterCategory) {
+	struct mLogFilter filter;
+	mLogFilterInit(&filter);
+	filter.defaultLevels = mLOG_ALL;
+	assert_true(mLogFilterTest(&filter, _mLOG_CAT_TEST, mLOG_DEBUG));
+
+	mLogFilterSet(&filter, "test.log", mLOG_FATAL);
+	assert_false(mLogFilterTest(&filter, _mLOG_CAT_TEST, mLOG_DEBUG));
+	assert_true(mLogFilterTest(&filter, _mLOG_CAT_TEST, mLOG_FATAL));
+	assert_true(mLogFilterTest(&filter, _mLOG_CAT_STATUS, mLOG_DEBUG));
+
+	mLogFilterReset(&filter, "test.log");
+	assert_true(mLogFilterTest(&filter, _mLOG_CAT_TEST, mLOG_DEBUG));
+	assert_int_equal(mLogFilterLevels(&filter, _mLOG_CAT_TEST), 0);
+	mLogFilterDeinit(&filter);
+}
+
+M_TEST_DEFINE(filterUnknownCategory) {
+	struct mLogFilter filter;
+	mLogFilterInit(&filter);
+	filter.defaultLevels = mLOG_ALL;
+
+	// Levels set for a category that isn't registered yet still apply once it is
+	mLogFilterSet(&filter, "test.unregistered", mLOG_ERROR);
+	int category = mLogGenerateCategory("Unregistered", "test.unregistered");
+	assert_false(mLogFilterTest(&filter, category, mLOG_DEBUG));
+	assert_true(mLogFilterTest(&filter, category, mLOG_ERROR));
+
+	assert_true(mLogFilterTest(&filter, mLOG_MAX_CATEGORY, mLOG_DEBUG));
+	assert_true(mLogFilterTest(&filter, -1, mLOG_DEBUG));
+	mLogFilterDeinit(&filter);
+}
+
+M_TEST_DEFINE(asyncOrdered) {
+	struct TestLogger* test = calloc(1, sizeof(*test));
+	test->d.log = _testLog;
+	struct mAsyncLogger async;
+	mAsyncLoggerInit(&async, &test->d);
+
+	int i;
+	for (i = 0; i < LOG_LINES; ++i) {
+		mLogExplicit(&async.d, _mLOG_CAT_TEST, mLOG_INFO, "Line %i", i);
+	}
+	mAsyncLoggerFlush(&async);
+	assert_int_equal(test->count, LOG_LINES);
+	for (i = 0; i < LOG_LINES; ++i) {
+		char expected[16];
+		snprintf(expected, sizeof(expected), "Line %i", i);
+		assert_string_equal(test->lines[i], expected);
+		assert_int_equal(test->levels[i], mLOG_INFO);
+	}
+
+	mAsyncLoggerDeinit(&async);
+	free(test);
+}
+
+M_TEST_DEFINE(asyncLongMessage) {
+	struct TestLogger* test = calloc(1, sizeof(*test));
+	test->d.log = _testLog;
+	struct mAsyncLogger async;
+	mAsyncLoggerInit(&async, &test->d);
+
+	char message[400];
+	memset(message, 'x', sizeof(message) - 1);
+	message[sizeof(message) - 1] = '\0';
+	mLogExplicit(&async.d, _mLOG_CAT_TEST, mLOG_WARN, "%s", message);
+	mLogExplicit(&async.d, _mLOG_CAT_TEST, mLOG_ERROR, "After");
+	mAsyncLoggerDeinit(&async);
+
+	assert_int_equal(test->count, 2);
+	assert_string_equal(test->lines[0], message);
+	assert_int_equal(test->levels[0], mLOG_WARN);
+	assert_string_equal(test->lines[1], "After");
+	free(test);
+}
+
+#ifndef DISABLE_THREADING
+struct LogThreadContext {
+	struct mAsyncLogger* logger;
+	int id;
+};
+
+static THREAD_ENTRY _logThread(void* user) {
+	struct LogThreadContext* context = user;
+	int i;
+	for (i = 0; i < LOG_LINES; ++i) {
+		mLogExplicit(&context->logger->d, _mLOG_CAT_TEST, mLOG_INFO, "%i %i", context->id, i);
+	}
+	THREAD_EXIT(0);
+}
+
+M_TEST_DEFINE(asyncThreads) {
+	struct TestLogger* test = calloc(1, sizeof(*test));
+	test->d.log = _testLog;
+	struct mAsyncLogger async;
+	mAsyncLoggerInit(&async, &test->d);
+
+	Thread threads[LOG_THREADS];
+	struct LogThreadContext contexts[LOG_THREADS];
+	int i;
+	for (i = 0; i < LOG_THREADS; ++i) {
+		contexts[i].logger = &async;
+		contexts[i].id = i;
+		ThreadCreate(&threads[i], _logThread, &contexts[i]);
+	}
+	for (i = 0; i < LOG_THREADS; ++i) {
+		ThreadJoin(&threads[i]);
+	}
+	mAsyncLoggerFlush(&async);
+	assert_int_equal(test->count, LOG_THREADS * LOG_LINES);
+
+	// Lines from each thread arrive in the order that thread logged them
+	int next[LOG_THREADS] = {0};
+	for (i = 0; i < test->count; ++i) {
+		int id;
+		int line;
+		assert_int_equal(sscanf(test->lines[i], "%i %i", &id, &line), 2);
+		assert_in_range(id, 0, LOG_THREADS - 1);
+		assert_int_equal(line, next[id]);
+		++next[id];
+	}
+
+	mAsyncLoggerDeinit(&async);
+	free(test);
+}
+#endif
+
+M_TEST_SUITE_DEFINE(mLog,
+	cmocka_unit_test(filterDefault),
+	cmocka_unit_test(filterCategory),
+	cmocka_unit_test(filterUnknownCategory),
+	cmocka_unit_test(asyncOrdered),
+#ifndef DISABLE_THREADING
+	cmocka_unit_test(asyncThreads),
+#endif
+	cmocka_unit_test(asyncLongMessage))
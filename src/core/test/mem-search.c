@@ -0,0 +1,266 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/core/interface.h>
+#include <mgba/core/mem-search.h>
+
+#define MEMORY_BASE 0x02000000
+#define MEMORY_SIZE 0x1234
+#define LARGE_BASE 0x03000000
+#define LARGE_SIZE 0x43210
+
+// The large block is big enough to be split up and searched on several threads
+struct MemSearchCore {
+	struct mCore d;
+	uint8_t memory[MEMORY_SIZE];
+	uint8_t large[LARGE_SIZE];
+	uint32_t seed;
+};
+
+static const struct mCoreMemoryBlock _blocks[] = {
+	{ 0, "wram", "WRAM", "Work RAM", MEMORY_BASE, MEMORY_BASE + MEMORY_SIZE, MEMORY_SIZE, mCORE_MEMORY_RW, 0, 0 },
+	{ 1, "large", "Large", "Large RAM", LARGE_BASE, LARGE_BASE + LARGE_SIZE, LARGE_SIZE, mCORE_MEMORY_RW, 0, 0 },
+};
+
+static size_t _listMemoryBlocks(const struct mCore* core, const struct mCoreMemoryBlock** blocks) {
+	UNUSED(core);
+	*blocks = _blocks;
+	return sizeof(_blocks) / sizeof(*_blocks);
+}
+
+static void* _getMemoryBlock(struct mCore* core, size_t id, size_t* sizeOut) {
+	struct MemSearchCore* search = (struct MemSearchCore*) core;
+	if (id == 1) {
+		*sizeOut = LARGE_SIZE;
+		return search->large;
+	}
+	*sizeOut = MEMORY_SIZE;
+	return search->memory;
+}
+
+static const uint8_t* _memoryAt(struct mCore* core, uint32_t address) {
+	struct MemSearchCore* search = (struct MemSearchCore*) core;
+	if (address >= LARGE_BASE) {
+		return &search->large[address - LARGE_BASE];
+	}
+	return &search->memory[address - MEMORY_BASE];
+}
+
+static uint32_t _rawRead8(struct mCore* core, uint32_t address, int segment) {
+	UNUSED(segment);
+	return *_memoryAt(core, address);
+}
+
+static uint32_t _rawRead16(struct mCore* core, uint32_t address, int segment) {
+	UNUSED(segment);
+	uint16_t value;
+	LOAD_16LE(value, 0, _memoryAt(core, address));
+	return value;
+}
+
+static uint32_t _rawRead32(struct mCore* core, uint32_t address, int segment) {
+	UNUSED(segment);
+	uint32_t value;
+	LOAD_32LE(value, 0, _memoryAt(core, address));
+	return value;
+}
+
+// Values are kept small so that equality searches actually find something
+static void _scramble(struct MemSearchCore* core, int fraction) {
+	size_t i;
+	for (i = 0; i < MEMORY_SIZE + LARGE_SIZE; ++i) {
+		core->seed = core->seed * 1664525 + 1013904223;
+		if ((core->seed >> 24) % fraction == 0) {
+			uint8_t* byte = i < MEMORY_SIZE ? &core->memory[i] : &core->large[i - MEMORY_SIZE];
+			*byte = (core->seed >> 8) & 3;
+		}
+	}
+}
+
+static void _initCore(struct MemSearchCore* core) {
+	memset(core, 0, sizeof(*core));
+	core->d.listMemoryBlocks = _listMemoryBlocks;
+	core->d.getMemoryBlock = _getMemoryBlock;
+	core->d.rawRead8 = _rawRead8;
+	core->d.rawRead16 = _rawRead16;
+	core->d.rawRead32 = _rawRead32;
+	core->seed = 1;
+	_scramble(core, 1);
+}
+
+static int _compareResults(const void* a, const void* b) {
+	const struct mCoreMemorySearchResult* resultA = a;
+	const struct mCoreMemorySearchResult* resultB = b;
+	return (resultA->address > resultB->address) - (resultA->address < resultB->address);
+}
+
+static void _assertSame(struct mCoreMemorySearchResults* expected, const struct mCoreMemorySearchCandidates* candidates) {
+	struct mCoreMemorySearchResults actual;
+	mCoreMemorySearchResultsInit(&actual, 0);
+	assert_int_equal(candidates->count, mCoreMemorySearchResultsSize(expected));
+	assert_int_equal(mCoreMemorySearchCandidatesResults(candidates, &actual, 0, 0), candidates->count);
+
+	if (!candidates->count) {
+		mCoreMemorySearchResultsDeinit(&actual);
+		return;
+	}
+	qsort(mCoreMemorySearchResultsGetPointer(expected, 0), mCoreMemorySearchResultsSize(expected), sizeof(struct mCoreMemorySearchResult), _compareResults);
+	size_t i;
+	for (i = 0; i < mCoreMemorySearchResultsSize(expected); ++i) {
+		struct mCoreMemorySearchResult* a = mCoreMemorySearchResultsGetPointer(expected, i);
+		struct mCoreMemorySearchResult* b = mCoreMemorySearchResultsGetPointer(&actual, i);
+		assert_int_equal(a->address, b->address);
+		assert_int_equal(a->width, b->width);
+		assert_int_equal(a->oldValue, b->oldValue);
+	}
+	mCoreMemorySearchResultsDeinit(&actual);
+}
+
+M_TEST_DEFINE(matchesListSearch) {
+	static const enum mCoreMemorySearchOp firstOps[] = {
+		mCORE_MEMORY_SEARCH_ANY,
+		mCORE_MEMORY_SEARCH_EQUAL,
+		mCORE_MEMORY_SEARCH_GREATER,
+		mCORE_MEMORY_SEARCH_LESS,
+	};
+	static const enum mCoreMemorySearchOp repeatOps[] = {
+		mCORE_MEMORY_SEARCH_DELTA_ANY,
+		mCORE_MEMORY_SEARCH_DELTA_POSITIVE,
+		mCORE_MEMORY_SEARCH_DELTA_NEGATIVE,
+		mCORE_MEMORY_SEARCH_DELTA,
+		mCORE_MEMORY_SEARCH_LESS,
+		mCORE_MEMORY_SEARCH_ANY,
+	};
+	static const int widths[] = { 1, 2, 4 };
+	static struct MemSearchCore core;
+	struct mCoreMemorySearchResults results;
+	struct mCoreMemorySearchCandidates candidates;
+	mCoreMemorySearchResultsInit(&results, 0);
+	mCoreMemorySearchCandidatesInit(&candidates);
+
+	size_t w;
+	size_t first;
+	for (w = 0; w < sizeof(widths) / sizeof(*widths); ++w) {
+		for (first = 0; first < sizeof(firstOps) / sizeof(*firstOps); ++first) {
+			_initCore(&core);
+			struct mCoreMemorySearchParams params = {
+				.memoryFlags = mCORE_MEMORY_WRITE,
+				.type = mCORE_MEMORY_SEARCH_INT,
+				.op = firstOps[first],
+				.align = -1,
+				.width = widths[w],
+				.valueInt = 0x101,
+			};
+			mCoreMemorySearchResultsClear(&results);
+			mCoreMemorySearch(&core.d, &params, &results, 0);
+			assert_true(mCoreMemorySearchCandidatesSearch(&core.d, &params, &candidates));
+			_assertSame(&results, &candidates);
+
+			size_t repeat;
+			for (repeat = 0; repeat < sizeof(repeatOps) / sizeof(*repeatOps); ++repeat) {
+				_scramble(&core, 8);
+				params.op = repeatOps[repeat];
+				params.valueInt = repeat & 1 ? 1 : 0x100;
+				mCoreMemorySearchRepeat(&core.d, &params, &results);
+				mCoreMemorySearchCandidatesNarrow(&core.d, &params, &candidates);
+				_assertSame(&results, &candidates);
+			}
+		}
+	}
+
+	mCoreMemorySearchCandidatesDeinit(&candidates);
+	mCoreMemorySearchResultsDeinit(&results);
+}
+
+M_TEST_DEFINE(resultsWindow) {
+	static struct MemSearchCore core;
+	struct mCoreMemorySearchResults all;
+	struct mCoreMemorySearchResults window;
+	struct mCoreMemorySearchCandidates candidates;
+	mCoreMemorySearchResultsInit(&all, 0);
+	mCoreMemorySearchResultsInit(&window, 0);
+	mCoreMemorySearchCandidatesInit(&candidates);
+
+	_initCore(&core);
+	struct mCoreMemorySearchParams params = {
+		.memoryFlags = mCORE_MEMORY_WRITE,
+		.type = mCORE_MEMORY_SEARCH_INT,
+		.op = mCORE_MEMORY_SEARCH_EQUAL,
+		.align = -1,
+		.width = 1,
+		.valueInt = 2,
+	};
+	assert_true(mCoreMemorySearchCandidatesSearch(&core.d, &params, &candidates));
+	assert_int_equal(mCoreMemorySearchCandidatesResults(&candidates, &all, 0, 0), candidates.count);
+	assert_true(candidates.count > 100);
+
+	size_t offset;
+	for (offset = 0; offset < candidates.count; offset += 37) {
+		mCoreMemorySearchResultsClear(&window);
+		size_t found = mCoreMemorySearchCandidatesResults(&candidates, &window, offset, 50);
+		assert_int_equal(found, candidates.count - offset < 50 ? candidates.count - offset : 50);
+		size_t i;
+		for (i = 0; i < found; ++i) {
+			assert_int_equal(mCoreMemorySearchResultsGetPointer(&window, i)->address, mCoreMemorySearchResultsGetPointer(&all, offset + i)->address);
+		}
+	}
+
+	params.type = mCORE_MEMORY_SEARCH_STRING;
+	assert_false(mCoreMemorySearchCandidatesSearch(&core.d, &params, &candidates));
+	assert_int_equal(candidates.count, 0);
+
+	mCoreMemorySearchCandidatesDeinit(&candidates);
+	mCoreMemorySearchResultsDeinit(&all);
+	mCoreMemorySearchResultsDeinit(&window);
+}
+
+M_TEST_DEFINE(orderedResults) {
+	static struct MemSearchCore core;
+	struct mCoreMemorySearchResults results;
+	struct mCoreMemorySearchResults limited;
+	mCoreMemorySearchResultsInit(&results, 0);
+	mCoreMemorySearchResultsInit(&limited, 0);
+
+	_initCore(&core);
+	struct mCoreMemorySearchParams params = {
+		.memoryFlags = mCORE_MEMORY_WRITE,
+		.type = mCORE_MEMORY_SEARCH_INT,
+		.op = mCORE_MEMORY_SEARCH_EQUAL,
+		.align = -1,
+		.width = 2,
+		.valueInt = 0x0203,
+	};
+	mCoreMemorySearch(&core.d, &params, &results, 0);
+
+	size_t expected = 0;
+	size_t i;
+	for (i = 0; i < MEMORY_SIZE; i += 2) {
+		expected += _rawRead16(&core.d, MEMORY_BASE + i, -1) == 0x0203;
+	}
+	for (i = 0; i < LARGE_SIZE; i += 2) {
+		expected += _rawRead16(&core.d, LARGE_BASE + i, -1) == 0x0203;
+	}
+	assert_int_equal(mCoreMemorySearchResultsSize(&results), expected);
+	for (i = 1; i < mCoreMemorySearchResultsSize(&results); ++i) {
+		assert_true(mCoreMemorySearchResultsGetPointer(&results, i - 1)->address < mCoreMemorySearchResultsGetPointer(&results, i)->address);
+	}
+
+	// A limit keeps the lowest addresses, like a sequential search would
+	size_t limit = mCoreMemorySearchResultsSize(&results) / 2 + 3;
+	mCoreMemorySearch(&core.d, &params, &limited, limit);
+	assert_int_equal(mCoreMemorySearchResultsSize(&limited), limit);
+	assert_memory_equal(mCoreMemorySearchResultsGetPointer(&limited, 0), mCoreMemorySearchResultsGetPointer(&results, 0), limit * sizeof(struct mCoreMemorySearchResult));
+
+	mCoreMemorySearchResultsDeinit(&results);
+	mCoreMemorySearchResultsDeinit(&limited);
+}
+
+M_TEST_SUITE_DEFINE(mCoreMemorySearch,
+	cmocka_unit_test(matchesListSearch),
+	cmocka_unit_test(orderedResults),
+	cmocka_unit_test(resultsWindow))
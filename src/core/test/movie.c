@@ -0,0 +1,230 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/core/movie.h>
+#include <mgba-util/vfs.h>
+
+#define TEST_INTERVAL 16
+
+struct TestCore {
+	struct mCore d;
+	uint32_t keys;
+	uint32_t state[2];
+	uint32_t crc32;
+	unsigned framesRun;
+};
+
+static enum mPlatform _platform(const struct mCore* core) {
+	UNUSED(core);
+	return mPLATFORM_GBA;
+}
+
+static void _checksum(const struct mCore* core, void* data, enum mCoreChecksumType type) {
+	UNUSED(type);
+	memcpy(data, &((const struct TestCore*) core)->crc32, sizeof(uint32_t));
+}
+
+static size_t _stateSize(struct mCore* core) {
+	UNUSED(core);
+	return sizeof(((struct TestCore*) NULL)->state);
+}
+
+static bool _saveState(struct mCore* core, void* state) {
+	struct TestCore* test = (struct TestCore*) core;
+	memcpy(state, test->state, sizeof(test->state));
+	return true;
+}
+
+static bool _loadState(struct mCore* core, const void* state) {
+	struct TestCore* test = (struct TestCore*) core;
+	memcpy(test->state, state, sizeof(test->state));
+	return true;
+}
+
+static void _setKeys(struct mCore* core, uint32_t keys) {
+	((struct TestCore*) core)->keys = keys;
+}
+
+static void _setSkip(struct mCore* core, bool skip) {
+	UNUSED(core);
+	UNUSED(skip);
+}
+
+static void _runFrame(struct mCore* core) {
+	struct TestCore* test = (struct TestCore*) core;
+	test->state[0] = test->state[0] * 31 + test->keys + 1;
+	++test->state[1];
+	++test->framesRun;
+}
+
+static void _testCoreInit(struct TestCore* core) {
+	memset(core, 0, sizeof(*core));
+	core->crc32 = 0x12345678;
+	core->d.platform = _platform;
+	core->d.checksum = _checksum;
+	core->d.stateSize = _stateSize;
+	core->d.saveState = _saveState;
+	core->d.loadState = _loadState;
+	core->d.setKeys = _setKeys;
+	core->d.setRenderSkip = _setSkip;
+	core->d.setAudioSkip = _setSkip;
+	core->d.runFrame = _runFrame;
+}
+
+static uint32_t _script(uint32_t frame) {
+	return (frame / 5) & 3;
+}
+
+static void _record(struct mCoreMovie* movie, struct TestCore* core, uint32_t frames, uint32_t* states) {
+	uint32_t frame;
+	for (frame = 0; frame < frames; ++frame) {
+		if (states) {
+			states[frame] = core->state[0];
+		}
+		assert_true(mCoreMovieRunFrame(movie, &core->d, _script(frame)));
+	}
+}
+
+M_TEST_DEFINE(recordAndPlay) {
+	struct TestCore core;
+	_testCoreInit(&core);
+	struct mCoreMovie movie;
+	mCoreMovieInit(&movie, TEST_INTERVAL);
+
+	uint32_t states[100];
+	assert_true(mCoreMovieStartRecording(&movie, &core.d));
+	_record(&movie, &core, 100, states);
+	uint32_t final = core.state[0];
+	mCoreMovieStop(&movie);
+	assert_int_equal(movie.length, 100);
+	// Keys change every five frames
+	assert_int_equal(mCoreMovieRunListSize(&movie.runs), 20);
+
+	core.state[0] = 0xDEADBEEF;
+	assert_true(mCoreMovieStartPlayback(&movie, &core.d));
+	uint32_t frame;
+	for (frame = 0; frame < 100; ++frame) {
+		assert_int_equal(core.state[0], states[frame]);
+		assert_true(mCoreMovieRunFrame(&movie, &core.d, 0xFF));
+		assert_int_equal(core.keys, _script(frame));
+	}
+	assert_int_equal(core.state[0], final);
+	assert_false(mCoreMovieRunFrame(&movie, &core.d, 0));
+	assert_int_equal(movie.mode, mMOVIE_STOPPED);
+
+	mCoreMovieDeinit(&movie);
+}
+
+M_TEST_DEFINE(seekWithinInterval) {
+	struct TestCore core;
+	_testCoreInit(&core);
+	struct mCoreMovie movie;
+	mCoreMovieInit(&movie, TEST_INTERVAL);
+
+	uint32_t states[100];
+	assert_true(mCoreMovieStartRecording(&movie, &core.d));
+	_record(&movie, &core, 100, states);
+	assert_true(mCoreMovieStartPlayback(&movie, &core.d));
+	assert_int_equal(mCoreMovieKeyframeListSize(&movie.keyframes), 7);
+
+	static const uint32_t targets[] = { 73, 5, 99, 0, 48, 100 };
+	size_t i;
+	for (i = 0; i < sizeof(targets) / sizeof(*targets); ++i) {
+		core.framesRun = 0;
+		assert_true(mCoreMovieSeek(&movie, &core.d, targets[i]));
+		assert_true(core.framesRun < TEST_INTERVAL);
+		assert_int_equal(movie.frame, targets[i]);
+		if (targets[i] < 100) {
+			assert_int_equal(core.state[0], states[targets[i]]);
+			assert_true(mCoreMovieRunFrame(&movie, &core.d, 0));
+			assert_int_equal(core.keys, _script(targets[i]));
+		}
+	}
+	assert_false(mCoreMovieSeek(&movie, &core.d, 101));
+
+	mCoreMovieDeinit(&movie);
+}
+
+M_TEST_DEFINE(rerecord) {
+	struct TestCore core;
+	_testCoreInit(&core);
+	struct mCoreMovie movie;
+	mCoreMovieInit(&movie, TEST_INTERVAL);
+
+	assert_true(mCoreMovieStartRecording(&movie, &core.d));
+	_record(&movie, &core, 100, NULL);
+	assert_true(mCoreMovieSeek(&movie, &core.d, 37));
+	assert_int_equal(movie.mode, mMOVIE_RECORDING);
+	assert_int_equal(movie.length, 37);
+	assert_int_equal(movie.rerecords, 1);
+	assert_int_equal(mCoreMovieKeyframeListSize(&movie.keyframes), 3);
+
+	uint32_t keys;
+	assert_true(mCoreMovieGetKeys(&movie, 36, &keys));
+	assert_int_equal(keys, _script(36));
+	assert_false(mCoreMovieGetKeys(&movie, 37, &keys));
+
+	uint32_t frame;
+	for (frame = 37; frame < 60; ++frame) {
+		assert_true(mCoreMovieRunFrame(&movie, &core.d, 0x10));
+	}
+	uint32_t final = core.state[0];
+	assert_int_equal(movie.length, 60);
+	assert_true(mCoreMovieGetKeys(&movie, 37, &keys));
+	assert_int_equal(keys, 0x10);
+
+	assert_true(mCoreMovieStartPlayback(&movie, &core.d));
+	while (mCoreMovieRunFrame(&movie, &core.d, 0));
+	assert_int_equal(core.state[0], final);
+
+	mCoreMovieDeinit(&movie);
+}
+
+M_TEST_DEFINE(saveAndLoad) {
+	struct TestCore core;
+	_testCoreInit(&core);
+	struct mCoreMovie movie;
+	mCoreMovieInit(&movie, TEST_INTERVAL);
+
+	assert_true(mCoreMovieStartRecording(&movie, &core.d));
+	_record(&movie, &core, 100, NULL);
+	uint32_t final = core.state[0];
+
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	assert_true(mCoreMovieSave(&movie, vf));
+	mCoreMovieDeinit(&movie);
+
+	vf->seek(vf, 0, SEEK_SET);
+	mCoreMovieInit(&movie, 0);
+	assert_true(mCoreMovieLoad(&movie, vf));
+	assert_int_equal(movie.length, 100);
+	assert_int_equal(movie.keyframeInterval, TEST_INTERVAL);
+	assert_true(mCoreMovieIsCompatible(&movie, &core.d));
+
+	core.state[0] = 0;
+	assert_true(mCoreMovieStartPlayback(&movie, &core.d));
+	while (mCoreMovieRunFrame(&movie, &core.d, 0));
+	assert_int_equal(core.state[0], final);
+
+	// A truncated file shouldn't load
+	vf->truncate(vf, vf->size(vf) - 1);
+	vf->seek(vf, 0, SEEK_SET);
+	assert_false(mCoreMovieLoad(&movie, vf));
+	vf->close(vf);
+
+	core.crc32 = 0;
+	assert_false(mCoreMovieStartPlayback(&movie, &core.d));
+
+	mCoreMovieDeinit(&movie);
+}
+
+M_TEST_SUITE_DEFINE(mCoreMovie,
+	cmocka_unit_test(recordAndPlay),
+	cmocka_unit_test(seekWithinInterval),
+	cmocka_unit_test(rerecord),
+	cmocka_unit_test(saveAndLoad))
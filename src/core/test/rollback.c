@@ -0,0 +1,280 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/core/rollback.h>
+
+#define TEST_QUEUE_SIZE 256
+
+struct TestCore {
+	struct mCore d;
+	uint32_t keys;
+	uint32_t state[2];
+};
+
+struct TestMessage {
+	struct mCoreRollbackMessage d;
+	unsigned deliverAt;
+};
+
+struct TestTransport {
+	struct mCoreRollbackTransport d;
+	struct TestTransport* peer;
+	struct TestMessage queue[TEST_QUEUE_SIZE];
+	size_t head;
+	size_t tail;
+	unsigned latency;
+	unsigned now;
+	bool corrupt;
+};
+
+static size_t _stateSize(struct mCore* core) {
+	UNUSED(core);
+	return sizeof(((struct TestCore*) NULL)->state);
+}
+
+static bool _saveState(struct mCore* core, void* state) {
+	struct TestCore* test = (struct TestCore*) core;
+	memcpy(state, test->state, sizeof(test->state));
+	return true;
+}
+
+static bool _loadState(struct mCore* core, const void* state) {
+	struct TestCore* test = (struct TestCore*) core;
+	memcpy(test->state, state, sizeof(test->state));
+	return true;
+}
+
+static void _setKeys(struct mCore* core, uint32_t keys) {
+	((struct TestCore*) core)->keys = keys;
+}
+
+static void _runFrame(struct mCore* core) {
+	struct TestCore* test = (struct TestCore*) core;
+	test->state[0] = test->state[0] * 31 + test->keys + 1;
+	++test->state[1];
+}
+
+static void _testCoreInit(struct TestCore* core) {
+	memset(core, 0, sizeof(*core));
+	core->d.stateSize = _stateSize;
+	core->d.saveState = _saveState;
+	core->d.loadState = _loadState;
+	core->d.setKeys = _setKeys;
+	core->d.runFrame = _runFrame;
+}
+
+static void _send(struct mCoreRollbackTransport* transport, const struct mCoreRollbackMessage* message) {
+	struct TestTransport* test = (struct TestTransport*) transport;
+	struct TestTransport* peer = test->peer;
+	struct TestMessage* queued = &peer->queue[peer->tail % TEST_QUEUE_SIZE];
+	queued->d = *message;
+	if (test->corrupt && message->type == mROLLBACK_MESSAGE_CHECKSUM) {
+		queued->d.checksum ^= 1;
+	}
+	queued->deliverAt = test->now + test->latency;
+	++peer->tail;
+}
+
+static bool _receive(struct mCoreRollbackTransport* transport, struct mCoreRollbackMessage* message) {
+	struct TestTransport* test = (struct TestTransport*) transport;
+	if (test->head == test->tail) {
+		return false;
+	}
+	struct TestMessage* queued = &test->queue[test->head % TEST_QUEUE_SIZE];
+	if (queued->deliverAt > test->now) {
+		return false;
+	}
+	*message = queued->d;
+	++test->head;
+	return true;
+}
+
+static void _testTransportInit(struct TestTransport* transport, struct TestTransport* peer, unsigned latency) {
+	memset(transport, 0, sizeof(*transport));
+	transport->d.send = _send;
+	transport->d.receive = _receive;
+	transport->peer = peer;
+	transport->latency = latency;
+}
+
+static uint32_t _script(int player, uint32_t frame) {
+	if (frame >= 100) {
+		return player + 1;
+	}
+	return ((frame / (3 + player)) * 0x9E3779B1U) >> (24 + player);
+}
+
+M_TEST_DEFINE(localOnly) {
+	struct TestCore core;
+	_testCoreInit(&core);
+	struct mCore* cores[] = { &core.d };
+	struct mCoreRollback rollback;
+	assert_true(mCoreRollbackInit(&rollback, cores, 1, 1, 0, 2));
+
+	uint32_t expected = 0;
+	uint32_t i;
+	for (i = 0; i < 32; ++i) {
+		assert_true(mCoreRollbackRunFrame(&rollback, _script(0, i)));
+		expected = expected * 31 + (i < 2 ? 0 : _script(0, i - 2)) + 1;
+	}
+	assert_int_equal(core.state[0], expected);
+	assert_int_equal(core.state[1], 32);
+	assert_int_equal(rollback.confirmedFrame, 32);
+	assert_int_equal(rollback.rollbacks, 0);
+	mCoreRollbackDeinit(&rollback);
+}
+
+M_TEST_DEFINE(invalidParameters) {
+	struct TestCore core;
+	_testCoreInit(&core);
+	struct mCore* cores[] = { &core.d };
+	struct mCoreRollback rollback;
+	assert_false(mCoreRollbackInit(&rollback, cores, 1, 0, 0, 0));
+	assert_false(mCoreRollbackInit(&rollback, cores, 1, 2, 2, 0));
+	assert_false(mCoreRollbackInit(&rollback, cores, 1, 2, 0, mCORE_ROLLBACK_MAX_DELAY + 1));
+	assert_false(mCoreRollbackInit(&rollback, cores, 2, 1, 0, 0));
+}
+
+M_TEST_DEFINE(stallWithoutPeer) {
+	struct TestCore core[2];
+	struct TestTransport transport[2];
+	_testCoreInit(&core[0]);
+	_testCoreInit(&core[1]);
+	_testTransportInit(&transport[0], &transport[1], 0);
+	_testTransportInit(&transport[1], &transport[0], 0);
+	struct mCore* cores[] = { &core[0].d, &core[1].d };
+	struct mCoreRollback rollback;
+	assert_true(mCoreRollbackInit(&rollback, cores, 2, 2, 0, 2));
+	rollback.transport = &transport[0].d;
+
+	int i;
+	for (i = 0; i < mCORE_ROLLBACK_MAX_FRAMES + 2; ++i) {
+		assert_true(mCoreRollbackRunFrame(&rollback, 0));
+	}
+	assert_int_equal(rollback.confirmedFrame, 2);
+	assert_false(mCoreRollbackRunFrame(&rollback, 0));
+	assert_int_equal(rollback.frame, mCORE_ROLLBACK_MAX_FRAMES + 2);
+	mCoreRollbackDeinit(&rollback);
+}
+
+static void _runPeers(unsigned latency, unsigned delay, bool corrupt) {
+	struct TestCore core[2][2];
+	struct TestTransport transport[2];
+	struct mCoreRollback rollback[2];
+	int i;
+	for (i = 0; i < 2; ++i) {
+		_testCoreInit(&core[i][0]);
+		_testCoreInit(&core[i][1]);
+		_testTransportInit(&transport[i], &transport[!i], latency);
+		transport[i].corrupt = corrupt && i == 1;
+		struct mCore* cores[] = { &core[i][0].d, &core[i][1].d };
+		assert_true(mCoreRollbackInit(&rollback[i], cores, 2, 2, i, delay));
+		rollback[i].transport = &transport[i].d;
+	}
+
+	unsigned tick;
+	for (tick = 0; tick < 400; ++tick) {
+		for (i = 0; i < 2; ++i) {
+			transport[i].now = tick;
+			mCoreRollbackRunFrame(&rollback[i], _script(i, rollback[i].frame));
+		}
+	}
+
+	uint32_t expected[2] = { 0, 0 };
+	for (i = 0; i < 2; ++i) {
+		uint32_t frame;
+		for (frame = 0; frame < rollback[0].frame; ++frame) {
+			expected[i] = expected[i] * 31 + (frame < delay ? 0 : _script(i, frame - delay)) + 1;
+		}
+	}
+	assert_int_equal(rollback[0].frame, rollback[1].frame);
+	for (i = 0; i < 2; ++i) {
+		assert_int_equal(core[i][0].state[0], expected[0]);
+		assert_int_equal(core[i][1].state[0], expected[1]);
+		assert_int_equal(core[i][0].state[1], rollback[i].frame);
+		assert_true(rollback[i].frame - rollback[i].confirmedFrame <= latency + 1);
+		if (latency > delay) {
+			assert_int_not_equal(rollback[i].rollbacks, 0);
+		}
+		assert_true(rollback[i].nextChecksum > mCORE_ROLLBACK_DEFAULT_CHECKSUM_INTERVAL * 4);
+		if (corrupt && i == 0) {
+			// Only the checksums player 2 sends are damaged
+			assert_true(rollback[i].desync);
+			assert_int_equal(rollback[i].desyncFrame, 0);
+		} else {
+			assert_false(rollback[i].desync);
+		}
+		mCoreRollbackDeinit(&rollback[i]);
+	}
+}
+
+M_TEST_DEFINE(peersNoLatency) {
+	_runPeers(0, 0, false);
+}
+
+M_TEST_DEFINE(peersHiddenByDelay) {
+	_runPeers(2, 3, false);
+}
+
+M_TEST_DEFINE(peersRollback) {
+	_runPeers(6, 2, false);
+}
+
+M_TEST_DEFINE(peersStall) {
+	_runPeers(mCORE_ROLLBACK_MAX_FRAMES + 4, 1, false);
+}
+
+M_TEST_DEFINE(peersDesync) {
+	_runPeers(6, 2, true);
+}
+
+M_TEST_DEFINE(singleCoreMerged) {
+	struct TestCore core[2];
+	struct TestTransport transport[2];
+	struct mCoreRollback rollback[2];
+	int i;
+	for (i = 0; i < 2; ++i) {
+		_testCoreInit(&core[i]);
+		_testTransportInit(&transport[i], &transport[!i], 3);
+		struct mCore* cores[] = { &core[i].d };
+		assert_true(mCoreRollbackInit(&rollback[i], cores, 1, 2, i, 1));
+		rollback[i].transport = &transport[i].d;
+	}
+
+	unsigned tick;
+	for (tick = 0; tick < 200; ++tick) {
+		for (i = 0; i < 2; ++i) {
+			transport[i].now = tick;
+			mCoreRollbackRunFrame(&rollback[i], _script(i, rollback[i].frame));
+		}
+	}
+
+	uint32_t expected = 0;
+	uint32_t frame;
+	for (frame = 0; frame < rollback[0].frame; ++frame) {
+		uint32_t keys = frame < 1 ? 0 : _script(0, frame - 1) | _script(1, frame - 1);
+		expected = expected * 31 + keys + 1;
+	}
+	assert_int_equal(rollback[0].frame, rollback[1].frame);
+	for (i = 0; i < 2; ++i) {
+		assert_int_equal(core[i].state[0], expected);
+		assert_false(rollback[i].desync);
+		mCoreRollbackDeinit(&rollback[i]);
+	}
+}
+
+M_TEST_SUITE_DEFINE(mCoreRollback,
+	cmocka_unit_test(localOnly),
+	cmocka_unit_test(invalidParameters),
+	cmocka_unit_test(stallWithoutPeer),
+	cmocka_unit_test(peersNoLatency),
+	cmocka_unit_test(peersHiddenByDelay),
+	cmocka_unit_test(peersRollback),
+	cmocka_unit_test(peersStall),
+	cmocka_unit_test(peersDesync),
+	cmocka_unit_test(singleCoreMerged))
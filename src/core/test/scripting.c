@@ -17,10 +17,12 @@
 #include <mgba/internal/gba/memory.h>
 #define TEST_PLATFORM mPLATFORM_GBA
 #define RAM_BASE GBA_BASE_IWRAM
+#define RAM_DOMAIN "iwram"
 #elif defined(M_CORE_GB)
 #include <mgba/internal/gb/memory.h>
 #define TEST_PLATFORM mPLATFORM_GB
 #define RAM_BASE GB_BASE_WORKING_RAM_BANK0
+#define RAM_DOMAIN "wram"
 #else
 #error "Need a valid platform for testing"
 #endif
@@ -282,6 +284,57 @@ M_TEST_DEFINE(memoryWrite) {
 	TEARDOWN_CORE;
 }
 
+M_TEST_DEFINE(memoryView) {
+	SETUP_LUA;
+	CREATE_CORE;
+	core->reset(core);
+
+	LOAD_PROGRAM(
+		"view = emu.memory[domain]:view(0, 12)\n"
+		"buffer = emu:newBuffer(12)\n"
+		"copied = emu:readInto(buffer, base)\n"
+		"size = view:size()\n"
+		"a8 = view:u8(1)\n"
+		"a16 = view:u16(2)\n"
+		"a32 = view:u32(1)\n"
+		"s16 = view:s16(5)\n"
+		"oob = view:u32(3)\n"
+		"b32 = buffer:u32(0)\n"
+		"emu:write8(base, 0x80)\n"
+		"s8 = view:s8(0)\n"
+		"c8 = buffer:u8(0)\n"
+		"emu.memory[domain]:readInto(buffer)\n"
+		"d8 = buffer:u8(0)\n"
+	);
+
+	int i;
+	for (i = 0; i < 12; ++i) {
+		core->busWrite8(core, RAM_BASE + i, i + 1);
+	}
+	core->busWrite16(core, RAM_BASE + 10, 0xFEDC);
+	struct mScriptValue base = mSCRIPT_MAKE_S32(RAM_BASE);
+	lua->setGlobal(lua, "base", &base);
+	struct mScriptValue* domain = mScriptStringCreateFromASCII(RAM_DOMAIN);
+	lua->setGlobal(lua, "domain", domain);
+	mScriptValueDeref(domain);
+	assert_true(lua->run(lua));
+
+	TEST_VALUE(S32, "copied", 12);
+	TEST_VALUE(S32, "size", 12);
+	TEST_VALUE(S32, "a8", 2);
+	TEST_VALUE(S32, "a16", 0x0605);
+	TEST_VALUE(S32, "a32", 0x08070605);
+	TEST_VALUE(S32, "s16", -0x124);
+	TEST_VALUE(S32, "oob", 0);
+	TEST_VALUE(S32, "b32", 0x04030201);
+	TEST_VALUE(S32, "s8", -0x80);
+	TEST_VALUE(S32, "c8", 1);
+	TEST_VALUE(S32, "d8", 0x80);
+
+	mScriptContextDeinit(&context);
+	TEARDOWN_CORE;
+}
+
 M_TEST_DEFINE(logging) {
 	SETUP_LUA;
 	struct mScriptTestLogger logger;
@@ -328,6 +381,18 @@ M_TEST_DEFINE(screenshot) {
 	TEARDOWN_CORE;
 }
 
+M_TEST_DEFINE(presentStats) {
+	SETUP_LUA;
+	CREATE_CORE;
+	core->reset(core);
+
+	// Without a frontend presenting frames there is nothing to report
+	TEST_PROGRAM("assert(emu:presentStats() == nil)");
+
+	mScriptContextDeinit(&context);
+	TEARDOWN_CORE;
+}
+
 #ifdef ENABLE_DEBUGGERS
 void _setupBp(struct mCore* core) {
 	switch (core->platform(core)) {
@@ -858,8 +923,10 @@ M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(mScriptCore,
 	cmocka_unit_test(runFrame),
 	cmocka_unit_test(memoryRead),
 	cmocka_unit_test(memoryWrite),
+	cmocka_unit_test(memoryView),
 	cmocka_unit_test(logging),
 	cmocka_unit_test(screenshot),
+	cmocka_unit_test(presentStats),
 #ifdef ENABLE_DEBUGGERS
 #ifdef M_CORE_GBA
 	cmocka_unit_test(basicBreakpointGBA),
@@ -0,0 +1,104 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/shared-rom.h>
+#include <mgba-util/crc32.h>
+
+#define ROM_SIZE 0x3000
+#define MAP_SIZE 0x10000
+
+static int sharedSetup(void** state) {
+	uint8_t* rom = malloc(ROM_SIZE);
+	size_t i;
+	for (i = 0; i < ROM_SIZE; ++i) {
+		rom[i] = i * 7;
+	}
+	mSharedROMInit();
+	*state = rom;
+	return 0;
+}
+
+static int sharedTeardown(void** state) {
+	mSharedROMDeinit();
+	free(*state);
+	return 0;
+}
+
+M_TEST_DEFINE(disabled) {
+	uint8_t rom[16] = { 0 };
+	assert_false(mSharedROMIsEnabled());
+	assert_null(mSharedROMAcquire(rom, sizeof(rom), sizeof(rom), doCrc32(rom, sizeof(rom))));
+}
+
+M_TEST_DEFINE(contents) {
+	uint8_t* rom = *state;
+	uint8_t* view = mSharedROMAcquire(rom, ROM_SIZE, MAP_SIZE, doCrc32(rom, ROM_SIZE));
+	if (!view) {
+		skip();
+	}
+	assert_memory_equal(view, rom, ROM_SIZE);
+	size_t i;
+	for (i = ROM_SIZE; i < MAP_SIZE; ++i) {
+		assert_int_equal(view[i], 0xFF);
+	}
+	mSharedROMRelease(view);
+}
+
+M_TEST_DEFINE(copyOnWrite) {
+	uint8_t* rom = *state;
+	uint32_t crc = doCrc32(rom, ROM_SIZE);
+	uint8_t* a = mSharedROMAcquire(rom, ROM_SIZE, MAP_SIZE, crc);
+	if (!a) {
+		skip();
+	}
+	uint8_t* b = mSharedROMAcquire(rom, ROM_SIZE, MAP_SIZE, crc);
+	assert_non_null(b);
+	assert_ptr_not_equal(a, b);
+
+	a[0x10] = 0x55;
+	b[ROM_SIZE] = 0xAA;
+	assert_int_equal(a[0x10], 0x55);
+	assert_int_equal(b[0x10], rom[0x10]);
+	assert_int_equal(a[ROM_SIZE], 0xFF);
+	assert_int_equal(b[ROM_SIZE], 0xAA);
+
+	uint8_t* c = mSharedROMAcquire(rom, ROM_SIZE, MAP_SIZE, crc);
+	assert_non_null(c);
+	assert_memory_equal(c, rom, ROM_SIZE);
+	assert_int_equal(c[ROM_SIZE], 0xFF);
+
+	mSharedROMRelease(a);
+	mSharedROMRelease(b);
+	mSharedROMRelease(c);
+}
+
+M_TEST_DEFINE(distinctContents) {
+	uint8_t* rom = *state;
+	uint32_t crc = doCrc32(rom, ROM_SIZE);
+	uint8_t* a = mSharedROMAcquire(rom, ROM_SIZE, MAP_SIZE, crc);
+	if (!a) {
+		skip();
+	}
+	// Same CRC and size but different contents must not alias
+	uint8_t* other = malloc(ROM_SIZE);
+	memcpy(other, rom, ROM_SIZE);
+	other[0] ^= 1;
+	uint8_t* b = mSharedROMAcquire(other, ROM_SIZE, MAP_SIZE, crc);
+	assert_non_null(b);
+	assert_memory_equal(b, other, ROM_SIZE);
+	assert_memory_equal(a, rom, ROM_SIZE);
+
+	mSharedROMRelease(a);
+	mSharedROMRelease(b);
+	free(other);
+}
+
+M_TEST_SUITE_DEFINE(mSharedROM,
+	cmocka_unit_test(disabled),
+	cmocka_unit_test_setup_teardown(contents, sharedSetup, sharedTeardown),
+	cmocka_unit_test_setup_teardown(copyOnWrite, sharedSetup, sharedTeardown),
+	cmocka_unit_test_setup_teardown(distinctContents, sharedSetup, sharedTeardown))
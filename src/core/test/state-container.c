@@ -0,0 +1,181 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/state-container.h>
+#include <mgba-util/image.h>
+#include <mgba-util/memory.h>
+#include <mgba-util/vfs.h>
+
+#define STATE_SIZE 0x3000
+
+static const struct mStateSection _sections[] = {
+	{ mSTATE_SECTION_CPU, 0x10, 0x40 },
+	{ mSTATE_SECTION_IO, 0x80, 0x100 },
+	{ mSTATE_SECTION_WRAM, 0x1000, 0x1800 },
+};
+
+struct mStateContainerTest {
+	struct mStateSnapshot snapshot;
+	uint8_t state[STATE_SIZE];
+	mColor pixels[4 * 2];
+};
+
+static int containerSetup(void** state) {
+	struct mStateContainerTest* test = calloc(1, sizeof(*test));
+	size_t i;
+	for (i = 0; i < STATE_SIZE; ++i) {
+		// Half of it compresses well, half of it doesn't
+		test->state[i] = i < STATE_SIZE / 2 ? i / 64 : (i * 2654435761U) >> 13;
+	}
+	for (i = 0; i < 8; ++i) {
+		test->pixels[i] = i * 0x10101;
+	}
+	mStateExtdataInit(&test->snapshot.extdata);
+	test->snapshot.state = test->state;
+	test->snapshot.stateSize = STATE_SIZE;
+	test->snapshot.sections = _sections;
+	test->snapshot.nSections = sizeof(_sections) / sizeof(*_sections);
+	test->snapshot.pixels = test->pixels;
+	test->snapshot.width = 4;
+	test->snapshot.height = 2;
+
+	struct mStateExtdataItem item = {
+		.size = 5,
+		.data = strdup("save"),
+		.clean = free
+	};
+	mStateExtdataPut(&test->snapshot.extdata, EXTDATA_SAVEDATA, &item);
+	*state = test;
+	return 0;
+}
+
+static int containerTeardown(void** state) {
+	struct mStateContainerTest* test = *state;
+	mStateExtdataDeinit(&test->snapshot.extdata);
+	free(test);
+	return 0;
+}
+
+static const struct mStateContainerEntry* _findEntry(const struct mStateContainerEntryList* toc, uint32_t id) {
+	size_t i;
+	for (i = 0; i < mStateContainerEntryListSize(toc); ++i) {
+		const struct mStateContainerEntry* entry = mStateContainerEntryListGetConstPointer(toc, i);
+		if (entry->id == id) {
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+M_TEST_DEFINE(roundTrip) {
+	struct mStateContainerTest* test = *state;
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	assert_true(mStateContainerWrite(vf, &test->snapshot, true));
+	assert_true(mStateContainerIsValid(vf));
+
+	struct mStateExtdata extdata;
+	mStateExtdataInit(&extdata);
+	uint8_t* loaded = mStateContainerLoadState(vf, STATE_SIZE, &extdata);
+	assert_non_null(loaded);
+	assert_memory_equal(loaded, test->state, STATE_SIZE);
+	mappedMemoryFree(loaded, STATE_SIZE);
+
+	struct mStateExtdataItem item;
+	assert_true(mStateExtdataGet(&extdata, EXTDATA_SAVEDATA, &item));
+	assert_int_equal(item.size, 5);
+	assert_string_equal(item.data, "save");
+	assert_true(mStateExtdataGet(&extdata, EXTDATA_SCREENSHOT, &item));
+	assert_int_equal(item.size, sizeof(test->pixels));
+	assert_memory_equal(item.data, test->pixels, sizeof(test->pixels));
+	mStateExtdataDeinit(&extdata);
+
+	// Extdata can be read on its own too
+	mStateExtdataInit(&extdata);
+	assert_true(mStateContainerLoadExtdata(vf, &extdata));
+	assert_true(mStateExtdataGet(&extdata, EXTDATA_SAVEDATA, &item));
+	assert_int_equal(item.size, 5);
+	mStateExtdataDeinit(&extdata);
+
+	vf->close(vf);
+}
+
+M_TEST_DEFINE(readSection) {
+	struct mStateContainerTest* test = *state;
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	assert_true(mStateContainerWrite(vf, &test->snapshot, true));
+
+	struct mStateContainerEntryList toc;
+	mStateContainerEntryListInit(&toc, 0);
+	uint32_t stateSize;
+	assert_true(mStateContainerReadTOC(vf, &toc, &stateSize));
+	assert_int_equal(stateSize, STATE_SIZE);
+
+	const struct mStateContainerEntry* entry = _findEntry(&toc, mSTATE_SECTION_WRAM);
+	assert_non_null(entry);
+	assert_int_equal(entry->offset, 0x1000);
+	assert_int_equal(entry->size, 0x1800);
+	uint8_t wram[0x1800];
+	assert_true(mStateContainerReadSection(vf, entry, wram));
+	assert_memory_equal(wram, &test->state[0x1000], sizeof(wram));
+
+	// The parts between sections are kept as well
+	entry = _findEntry(&toc, mSTATE_SECTION_STATE);
+	assert_non_null(entry);
+	assert_int_equal(entry->offset, 0);
+	assert_int_equal(entry->size, 0x10);
+
+#ifdef USE_ZLIB
+	entry = _findEntry(&toc, mSTATE_SECTION_IO);
+	assert_non_null(entry);
+	assert_int_equal(entry->codec, mSTATE_CODEC_DEFLATE);
+	assert_true(entry->storedSize < entry->size);
+#endif
+
+	mStateContainerEntryListDeinit(&toc);
+	vf->close(vf);
+}
+
+M_TEST_DEFINE(mappableSections) {
+	struct mStateContainerTest* test = *state;
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	assert_true(mStateContainerWrite(vf, &test->snapshot, false));
+
+	struct mStateContainerEntryList toc;
+	mStateContainerEntryListInit(&toc, 0);
+	uint32_t stateSize;
+	assert_true(mStateContainerReadTOC(vf, &toc, &stateSize));
+	const struct mStateContainerEntry* entry = _findEntry(&toc, mSTATE_SECTION_WRAM);
+	assert_non_null(entry);
+	assert_int_equal(entry->codec, mSTATE_CODEC_RAW);
+	assert_int_equal(entry->fileOffset & (mSTATE_CONTAINER_ALIGN - 1), 0);
+
+	uint8_t* mapped = vf->map(vf, vf->size(vf), MAP_READ);
+	assert_non_null(mapped);
+	assert_memory_equal(&mapped[entry->fileOffset], &test->state[0x1000], 0x1800);
+	vf->unmap(vf, mapped, vf->size(vf));
+
+	mStateContainerEntryListDeinit(&toc);
+	vf->close(vf);
+}
+
+M_TEST_DEFINE(rejectMismatch) {
+	struct mStateContainerTest* test = *state;
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	assert_true(mStateContainerWrite(vf, &test->snapshot, true));
+	assert_null(mStateContainerLoadState(vf, STATE_SIZE + 4, NULL));
+	vf->close(vf);
+
+	vf = VFileFromConstMemory(test->state, STATE_SIZE);
+	assert_false(mStateContainerIsValid(vf));
+	vf->close(vf);
+}
+
+M_TEST_SUITE_DEFINE(mStateContainer,
+	cmocka_unit_test_setup_teardown(roundTrip, containerSetup, containerTeardown),
+	cmocka_unit_test_setup_teardown(readSection, containerSetup, containerTeardown),
+	cmocka_unit_test_setup_teardown(mappableSections, containerSetup, containerTeardown),
+	cmocka_unit_test_setup_teardown(rejectMismatch, containerSetup, containerTeardown))
@@ -0,0 +1,161 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/sync.h>
+
+static int syncSetup(void** state) {
+	struct mCoreSync* sync = calloc(1, sizeof(*sync));
+	MutexInit(&sync->videoFrameMutex);
+	ConditionInit(&sync->videoFrameAvailableCond);
+	ConditionInit(&sync->videoFrameRequiredCond);
+	mCoreSyncSetTripleBuffer(sync, true);
+	*state = sync;
+	return 0;
+}
+
+static int syncTeardown(void** state) {
+	struct mCoreSync* sync = *state;
+	MutexDeinit(&sync->videoFrameMutex);
+	ConditionDeinit(&sync->videoFrameAvailableCond);
+	ConditionDeinit(&sync->videoFrameRequiredCond);
+	free(sync);
+	return 0;
+}
+
+M_TEST_DEFINE(tripleBufferEmpty) {
+	struct mCoreSync* sync = *state;
+	unsigned slot;
+	assert_false(mCoreSyncTakeFrame(sync, &slot));
+	assert_int_equal(slot, sync->videoFrameFront);
+	assert_int_not_equal(slot, sync->videoFrameBack);
+}
+
+M_TEST_DEFINE(tripleBufferNewest) {
+	struct mCoreSync* sync = *state;
+	unsigned first = sync->videoFrameBack;
+	unsigned second = mCoreSyncPublishFrame(sync);
+	assert_int_not_equal(first, second);
+	unsigned third = mCoreSyncPublishFrame(sync);
+	assert_int_not_equal(second, third);
+
+	unsigned slot;
+	assert_true(mCoreSyncTakeFrame(sync, &slot));
+	assert_int_equal(slot, second);
+	assert_false(mCoreSyncTakeFrame(sync, &slot));
+	assert_int_equal(slot, second);
+}
+
+M_TEST_DEFINE(tripleBufferDisjoint) {
+	struct mCoreSync* sync = *state;
+	int i;
+	for (i = 0; i < 64; ++i) {
+		unsigned slot;
+		if (i & 1) {
+			mCoreSyncPublishFrame(sync);
+		}
+		if (i % 3) {
+			mCoreSyncTakeFrame(sync, &slot);
+		}
+		assert_int_not_equal(sync->videoFrameBack, sync->videoFrameFront);
+		assert_in_range(sync->videoFrameBack, 0, 2);
+		assert_in_range(sync->videoFrameFront, 0, 2);
+	}
+}
+
+M_TEST_DEFINE(lockFreeHandshake) {
+	struct mCoreSync* sync = *state;
+	mCoreSyncPostFrame(sync);
+	assert_true(mCoreSyncWaitFrameStart(sync));
+	mCoreSyncWaitFrameEnd(sync);
+
+	mCoreSyncPostFrame(sync);
+	mCoreSyncPostFrame(sync);
+	assert_false(mCoreSyncWantsFrame(sync));
+
+	// Holding the lock would deadlock here if the posting side ever took it
+	MutexLock(&sync->videoFrameMutex);
+	mCoreSyncPostFrame(sync);
+	MutexUnlock(&sync->videoFrameMutex);
+
+	assert_true(mCoreSyncWaitFrameStart(sync));
+	mCoreSyncWaitFrameEnd(sync);
+	assert_false(mCoreSyncWaitFrameStart(sync));
+	mCoreSyncWaitFrameEnd(sync);
+	assert_true(mCoreSyncWantsFrame(sync));
+}
+
+M_TEST_DEFINE(presentStats) {
+	struct mCoreSync* sync = *state;
+	struct mCorePresentStats stats;
+	mCoreSyncGetPresentStats(sync, &stats);
+	assert_int_equal(stats.frames, 0);
+
+	mCoreSyncReportPresent(sync, 8000, 0, 1);
+	mCoreSyncGetPresentStats(sync, &stats);
+	assert_int_equal(stats.frames, 1);
+	assert_int_equal(stats.latency, 8000);
+	assert_int_equal(stats.averageLatency, 8000);
+	assert_int_equal(stats.maxLatency, 8000);
+
+	mCoreSyncReportPresent(sync, 24000, 1, 2);
+	mCoreSyncReportPresent(sync, 8000, 2, 1);
+	mCoreSyncGetPresentStats(sync, &stats);
+	assert_int_equal(stats.frames, 3);
+	assert_int_equal(stats.latency, 8000);
+	assert_true(stats.averageLatency > 8000 && stats.averageLatency < 24000);
+	assert_int_equal(stats.maxLatency, 24000);
+	assert_int_equal(stats.missedVblanks, 3);
+	assert_int_equal(stats.queueDepth, 1);
+
+	mCoreSyncResetPresentStats(sync);
+	mCoreSyncGetPresentStats(sync, &stats);
+	assert_int_equal(stats.frames, 0);
+	assert_int_equal(stats.missedVblanks, 0);
+}
+
+M_TEST_DEFINE(frameLimiterCadence) {
+	struct mCoreSync* sync = *state;
+	struct mCoreFrameLimiterStats stats;
+	mCoreFrameLimiterInit(&sync->frameLimiter);
+	sync->frameLimit = true;
+	sync->fpsTarget = 240;
+
+	// The first frame only starts the cadence
+	mCoreSyncPostFrame(sync);
+	mCoreSyncGetFrameLimiterStats(sync, &stats);
+	assert_int_equal(stats.frames, 0);
+
+	uint64_t start = sync->frameLimiter.deadline;
+	int i;
+	for (i = 0; i < 24; ++i) {
+		mCoreSyncPostFrame(sync);
+	}
+	mCoreSyncGetFrameLimiterStats(sync, &stats);
+	assert_int_equal(stats.frames, 24);
+	assert_int_equal(sync->frameLimiter.deadline - start, sync->frameLimiter.interval * 24);
+	// Each frame is let through no earlier than its deadline, and nowhere near a frame late
+	assert_true(stats.maxJitter >= stats.jitter);
+	assert_true(stats.averageJitter < sync->frameLimiter.interval / 2);
+
+	// A different rate starts over
+	sync->fpsTarget = 120;
+	mCoreSyncPostFrame(sync);
+	mCoreSyncGetFrameLimiterStats(sync, &stats);
+	assert_int_equal(stats.frames, 24);
+	assert_int_equal(sync->frameLimiter.interval, 1000000000 / 120);
+
+	sync->frameLimit = false;
+	mCoreFrameLimiterDeinit(&sync->frameLimiter);
+}
+
+M_TEST_SUITE_DEFINE(mCoreSync,
+	cmocka_unit_test_setup_teardown(tripleBufferEmpty, syncSetup, syncTeardown),
+	cmocka_unit_test_setup_teardown(tripleBufferNewest, syncSetup, syncTeardown),
+	cmocka_unit_test_setup_teardown(tripleBufferDisjoint, syncSetup, syncTeardown),
+	cmocka_unit_test_setup_teardown(lockFreeHandshake, syncSetup, syncTeardown),
+	cmocka_unit_test_setup_teardown(presentStats, syncSetup, syncTeardown),
+	cmocka_unit_test_setup_teardown(frameLimiterCadence, syncSetup, syncTeardown))
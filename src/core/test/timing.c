@@ -0,0 +1,233 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/timing.h>
+
+struct TimingTest {
+	struct mTiming timing;
+	int32_t cycles;
+	int32_t nextEvent;
+	struct mTimingEvent events[8];
+	int fired[16];
+	int nFired;
+	bool interrupt;
+};
+
+static void _record(struct mTiming* timing, void* context, uint32_t cyclesLate) {
+	UNUSED(cyclesLate);
+	struct TimingTest* test = (struct TimingTest*) ((uintptr_t) timing - offsetof(struct TimingTest, timing));
+	test->fired[test->nFired] = (int) (intptr_t) context;
+	++test->nFired;
+	if (test->interrupt) {
+		mTimingInterrupt(timing);
+	}
+}
+
+static int timingSetup(void** state) {
+	struct TimingTest* test = calloc(1, sizeof(*test));
+	mTimingInit(&test->timing, &test->cycles, &test->nextEvent);
+	test->nextEvent = INT_MAX;
+	size_t i;
+	for (i = 0; i < 8; ++i) {
+		test->events[i].context = (void*) (intptr_t) i;
+		test->events[i].callback = _record;
+		test->events[i].name = "Test";
+		test->events[i].priority = 0;
+	}
+	*state = test;
+	return 0;
+}
+
+static int timingTeardown(void** state) {
+	struct TimingTest* test = *state;
+	mTimingDeinit(&test->timing);
+	free(test);
+	return 0;
+}
+
+M_TEST_DEFINE(orderByTime) {
+	struct TimingTest* test = *state;
+	mTimingSchedule(&test->timing, &test->events[0], 30);
+	mTimingSchedule(&test->timing, &test->events[1], 10);
+	mTimingSchedule(&test->timing, &test->events[2], 20);
+	assert_int_equal(mTimingNextEvent(&test->timing), 10);
+	mTimingTick(&test->timing, 30);
+	assert_int_equal(test->nFired, 3);
+	assert_int_equal(test->fired[0], 1);
+	assert_int_equal(test->fired[1], 2);
+	assert_int_equal(test->fired[2], 0);
+}
+
+M_TEST_DEFINE(orderByPriority) {
+	struct TimingTest* test = *state;
+	test->events[0].priority = 2;
+	test->events[1].priority = 0;
+	test->events[2].priority = 1;
+	mTimingSchedule(&test->timing, &test->events[0], 10);
+	mTimingSchedule(&test->timing, &test->events[1], 10);
+	mTimingSchedule(&test->timing, &test->events[2], 10);
+	mTimingTick(&test->timing, 10);
+	assert_int_equal(test->nFired, 3);
+	assert_int_equal(test->fired[0], 1);
+	assert_int_equal(test->fired[1], 2);
+	assert_int_equal(test->fired[2], 0);
+}
+
+M_TEST_DEFINE(orderBySchedule) {
+	struct TimingTest* test = *state;
+	size_t i;
+	for (i = 0; i < 8; ++i) {
+		mTimingSchedule(&test->timing, &test->events[i], 5);
+	}
+	mTimingTick(&test->timing, 5);
+	assert_int_equal(test->nFired, 8);
+	for (i = 0; i < 8; ++i) {
+		assert_int_equal(test->fired[i], i);
+	}
+}
+
+M_TEST_DEFINE(partialTick) {
+	struct TimingTest* test = *state;
+	mTimingSchedule(&test->timing, &test->events[0], 10);
+	mTimingSchedule(&test->timing, &test->events[1], 20);
+	assert_int_equal(mTimingTick(&test->timing, 15), 5);
+	assert_int_equal(test->nFired, 1);
+	assert_true(mTimingIsScheduled(&test->timing, &test->events[1]));
+	assert_false(mTimingIsScheduled(&test->timing, &test->events[0]));
+	assert_int_equal(mTimingUntil(&test->timing, &test->events[1]), 5);
+}
+
+M_TEST_DEFINE(deschedule) {
+	struct TimingTest* test = *state;
+	size_t i;
+	for (i = 0; i < 8; ++i) {
+		mTimingSchedule(&test->timing, &test->events[i], 80 - i * 10);
+	}
+	mTimingDeschedule(&test->timing, &test->events[3]);
+	mTimingDeschedule(&test->timing, &test->events[7]);
+	mTimingDeschedule(&test->timing, &test->events[7]);
+	assert_false(mTimingIsScheduled(&test->timing, &test->events[3]));
+	assert_false(mTimingIsScheduled(&test->timing, &test->events[7]));
+	assert_true(mTimingIsScheduled(&test->timing, &test->events[0]));
+	mTimingTick(&test->timing, 100);
+	assert_int_equal(test->nFired, 6);
+	assert_int_equal(test->fired[0], 6);
+	assert_int_equal(test->fired[1], 5);
+	assert_int_equal(test->fired[2], 4);
+	assert_int_equal(test->fired[3], 2);
+	assert_int_equal(test->fired[4], 1);
+	assert_int_equal(test->fired[5], 0);
+}
+
+M_TEST_DEFINE(reschedule) {
+	struct TimingTest* test = *state;
+	mTimingSchedule(&test->timing, &test->events[0], 10);
+	mTimingSchedule(&test->timing, &test->events[1], 20);
+	mTimingSchedule(&test->timing, &test->events[0], 30);
+	mTimingTick(&test->timing, 30);
+	assert_int_equal(test->nFired, 2);
+	assert_int_equal(test->fired[0], 1);
+	assert_int_equal(test->fired[1], 0);
+}
+
+M_TEST_DEFINE(interrupt) {
+	struct TimingTest* test = *state;
+	test->interrupt = true;
+	mTimingSchedule(&test->timing, &test->events[0], 10);
+	mTimingSchedule(&test->timing, &test->events[1], 10);
+	mTimingTick(&test->timing, 10);
+	assert_int_equal(test->nFired, 2);
+	assert_int_equal(test->fired[0], 0);
+	assert_int_equal(test->fired[1], 1);
+}
+
+M_TEST_DEFINE(many) {
+	struct TimingTest* test = *state;
+	struct mTimingEvent events[64];
+	size_t i;
+	for (i = 0; i < 64; ++i) {
+		events[i] = test->events[0];
+		events[i].context = (void*) (intptr_t) (i & 0xF);
+		mTimingSchedule(&test->timing, &events[i], (int32_t) ((i * 37) & 63) + 1);
+	}
+	for (i = 0; i < 64; ++i) {
+		int32_t next = mTimingNextEvent(&test->timing);
+		assert_int_equal(next, 1);
+		test->nFired = 0;
+		mTimingTick(&test->timing, next);
+		assert_int_equal(test->nFired, 1);
+	}
+	assert_int_equal(mTimingNextEvent(&test->timing), INT_MAX);
+}
+
+static uint64_t _fakeClock(void) {
+	static uint64_t now = 0;
+	return ++now;
+}
+
+M_TEST_DEFINE(profile) {
+	struct TimingTest* test = *state;
+	struct mTimingProfile profile = { .clock = _fakeClock };
+	mTimingProfileReset(&profile);
+	test->timing.profile = &profile;
+	test->events[1].name = "Other";
+	test->interrupt = true;
+	mTimingSchedule(&test->timing, &test->events[0], 10);
+	mTimingSchedule(&test->timing, &test->events[1], 10);
+	mTimingSchedule(&test->timing, &test->events[2], 20);
+	assert_int_equal(mTimingTick(&test->timing, 10), 10);
+	assert_int_equal(test->nFired, 2);
+	mTimingTick(&test->timing, 10);
+	assert_int_equal(test->nFired, 3);
+	assert_int_equal(profile.nEntries, 2);
+	assert_true(profile.entries[0].name == test->events[0].name);
+	assert_int_equal(profile.entries[0].count, 2);
+	assert_int_equal(profile.entries[1].count, 1);
+	// The fake clock advances by one on every read
+	assert_int_equal(profile.entries[0].time, 2);
+	assert_int_equal(profile.entries[1].time, 1);
+	assert_int_equal(profile.tickTime, 8);
+	assert_false(profile.active);
+}
+
+M_TEST_DEFINE(profileScheduling) {
+	struct TimingTest* test = *state;
+	struct mTimingProfile profile = {0};
+	mTimingProfileReset(&profile);
+	test->timing.profile = &profile;
+	mTimingSchedule(&test->timing, &test->events[0], 10);
+	mTimingSchedule(&test->timing, &test->events[0], 20);
+	mTimingSchedule(&test->timing, &test->events[1], 10);
+	mTimingDeschedule(&test->timing, &test->events[1]);
+	// Descheduling an event that isn't scheduled doesn't count
+	mTimingDeschedule(&test->timing, &test->events[1]);
+	mTimingSchedule(&test->timing, &test->events[2], 30);
+	mTimingTick(&test->timing, 25);
+	assert_int_equal(test->nFired, 1);
+	mTimingTick(&test->timing, 10);
+	assert_int_equal(test->nFired, 2);
+	assert_int_equal(profile.nEntries, 1);
+	assert_int_equal(profile.entries[0].count, 2);
+	assert_int_equal(profile.entries[0].lateness, 10);
+	assert_int_equal(profile.entries[0].reschedules, 1);
+	assert_int_equal(profile.entries[0].deschedules, 1);
+	// Without a clock, nothing is timed
+	assert_int_equal(profile.entries[0].time, 0);
+	assert_int_equal(profile.tickTime, 0);
+}
+
+M_TEST_SUITE_DEFINE(mTiming,
+	cmocka_unit_test_setup_teardown(orderByTime, timingSetup, timingTeardown),
+	cmocka_unit_test_setup_teardown(orderByPriority, timingSetup, timingTeardown),
+	cmocka_unit_test_setup_teardown(orderBySchedule, timingSetup, timingTeardown),
+	cmocka_unit_test_setup_teardown(partialTick, timingSetup, timingTeardown),
+	cmocka_unit_test_setup_teardown(deschedule, timingSetup, timingTeardown),
+	cmocka_unit_test_setup_teardown(reschedule, timingSetup, timingTeardown),
+	cmocka_unit_test_setup_teardown(interrupt, timingSetup, timingTeardown),
+	cmocka_unit_test_setup_teardown(many, timingSetup, timingTeardown),
+	cmocka_unit_test_setup_teardown(profile, timingSetup, timingTeardown),
+	cmocka_unit_test_setup_teardown(profileScheduling, timingSetup, timingTeardown))
@@ -6,6 +6,10 @@
 #include <mgba/core/thread.h>
 
 #include <mgba/core/core.h>
+#include <mgba/core/host-trace.h>
+#include <mgba/core/input-latch.h>
+#include <mgba/core/movie.h>
+#include <mgba/core/rollback.h>
 #ifdef ENABLE_SCRIPTING
 #include <mgba/script/context.h>
 #include <mgba/core/scripting.h>
@@ -142,12 +146,42 @@ static void _cancelRequest(struct mCoreThreadInternal* threadContext, enum mCore
 	ConditionWake(&threadContext->stateOnThreadCond);
 }
 
+static bool _movieIsActive(const struct mCoreThread* thread) {
+	return thread->movie && thread->movie->mode != mMOVIE_STOPPED;
+}
+
 void _frameStarted(void* context) {
 	struct mCoreThread* thread = context;
 	if (!thread) {
 		return;
 	}
-	if (thread->core->opts.rewindEnable && thread->core->opts.rewindBufferCapacity > 0) {
+	// Loading a state can start a frame over, so don't nest it inside the old one
+	if (!thread->impl->frameTraced) {
+		thread->impl->frameTraced = true;
+		mTRACE_BEGIN("Core thread: frame");
+	}
+	if (thread->impl->speculating) {
+		return;
+	}
+	// Rollback sessions and movies pick what keys each frame gets, so they take the
+	// latched keys before they start one instead
+	if (thread->inputLatch && !thread->rollback && !_movieIsActive(thread)) {
+		mInputLatchApply(thread->inputLatch, thread->core);
+	}
+	// Run-ahead and unbounded fast-forward pick which frames get rendered on their own
+	if (!thread->impl->runningAhead && !thread->impl->unbounded) {
+		// Only undo skipping we asked for, so that callers can still use setRenderSkip themselves
+		if (!mCoreSyncWantsFrame(&thread->impl->sync)) {
+			thread->core->setRenderSkip(thread->core, true);
+			thread->impl->renderSkipped = true;
+		} else if (thread->impl->renderSkipped) {
+			thread->core->setRenderSkip(thread->core, false);
+			thread->impl->renderSkipped = false;
+		}
+	}
+	// Rewinding one peer alone would desync it from the others, and rewinding a movie
+	// would desync it from its recorded keys
+	if (thread->core->opts.rewindEnable && thread->core->opts.rewindBufferCapacity > 0 && !thread->rollback && !_movieIsActive(thread)) {
 		if (!thread->impl->rewinding || !mCoreRewindRestore(&thread->impl->rewind, thread->core, 1)) {
 			if (thread->impl->rewind.rewindFrameCounter == 0) {
 				mCoreRewindAppend(&thread->impl->rewind, thread->core);
@@ -163,8 +197,17 @@ void _frameEnded(void* context) {
 	if (!thread) {
 		return;
 	}
+	if (thread->impl->frameTraced) {
+		thread->impl->frameTraced = false;
+		mTRACE_END();
+	}
+	if (thread->impl->runningAhead) {
+		return;
+	}
 	if (thread->frameCallback) {
+		mTRACE_BEGIN("Core thread: frame callback");
 		thread->frameCallback(thread);
+		mTRACE_END();
 	}
 }
 
@@ -198,6 +241,148 @@ void _coreShutdown(void* context) {
 	MutexUnlock(&thread->impl->stateMutex);
 }
 
+static void _runAhead(struct mCoreThread* threadContext) {
+	struct mCoreThreadInternal* impl = threadContext->impl;
+	struct mCore* core = threadContext->core;
+	int frames = core->opts.runAhead;
+
+	size_t stateSize = core->stateSize(core);
+	if (stateSize != impl->runAheadStateSize) {
+		free(impl->runAheadState);
+		impl->runAheadState = malloc(stateSize);
+		impl->runAheadStateSize = stateSize;
+		impl->runAheadCheckpoint = 0;
+	}
+
+	// The real frame is emulated without output; only the last speculative
+	// frame is shown, and everything after the real frame is thrown away
+	impl->runningAhead = true;
+	core->setSync(core, NULL);
+	core->setRenderSkip(core, true);
+	core->runFrame(core);
+	if (core->saveStateIncremental) {
+		impl->runAheadCheckpoint = core->saveStateIncremental(core, impl->runAheadState, impl->runAheadCheckpoint, NULL);
+	} else {
+		core->saveState(core, impl->runAheadState);
+	}
+
+	impl->speculating = true;
+	core->setAudioSkip(core, true);
+	int i;
+	for (i = 0; i < frames; ++i) {
+		if (i == frames - 1) {
+			core->setRenderSkip(core, false);
+			core->setSync(core, &impl->sync);
+		}
+		core->runFrame(core);
+	}
+	// Rolling back only has to undo the pages the speculative frames touched
+	if (core->loadStateIncremental) {
+		impl->runAheadCheckpoint = core->loadStateIncremental(core, impl->runAheadState, impl->runAheadCheckpoint);
+	} else {
+		core->loadState(core, impl->runAheadState);
+	}
+	core->setAudioSkip(core, false);
+	impl->speculating = false;
+	impl->runningAhead = false;
+	impl->renderSkipped = false;
+
+	if (threadContext->frameCallback) {
+		threadContext->frameCallback(threadContext);
+	}
+	mCoreSyncProduceAudio(&impl->sync, core->getAudioBuffer(core));
+}
+
+static void _rollbackRunFrame(struct mCoreRollback* rollback, const uint32_t* keys) {
+	struct mCoreThread* threadContext = rollback->context;
+	struct mCoreThreadInternal* impl = threadContext->impl;
+	struct mCore* core = threadContext->core;
+	if (rollback->resimulating != impl->speculating) {
+		// Frames being run again were already shown once, so they're run like
+		// run-ahead runs its speculative frames: without output or callbacks
+		impl->speculating = rollback->resimulating;
+		impl->runningAhead = rollback->resimulating;
+		impl->renderSkipped = false;
+		core->setSync(core, rollback->resimulating ? NULL : &impl->sync);
+		core->setRenderSkip(core, rollback->resimulating);
+		core->setAudioSkip(core, rollback->resimulating);
+	}
+	uint32_t merged = 0;
+	int i;
+	for (i = 0; i < rollback->nPlayers; ++i) {
+		merged |= keys[i];
+	}
+	core->setKeys(core, merged);
+	impl->rollbackKeys = merged;
+	core->runFrame(core);
+}
+
+static void _runRollback(struct mCoreThread* threadContext) {
+	struct mCoreThreadInternal* impl = threadContext->impl;
+	struct mCore* core = threadContext->core;
+	uint32_t keys = core->getKeys(core);
+	bool ran = mCoreRollbackRunFrame(threadContext->rollback, keys);
+	// The session presses keys on its own schedule, so put back the ones the frontend
+	// set, unless it has set new ones since
+	if (core->getKeys(core) == impl->rollbackKeys) {
+		core->setKeys(core, keys);
+	}
+	if (!ran) {
+		// Still waiting on the other players, but wake up for anything else
+		MutexLock(&impl->stateMutex);
+		if (impl->state == mTHREAD_RUNNING) {
+			ConditionWaitTimed(&impl->stateOnThreadCond, &impl->stateMutex, 1);
+		}
+		MutexUnlock(&impl->stateMutex);
+	}
+}
+
+static void _runMovie(struct mCoreThread* threadContext) {
+	struct mCore* core = threadContext->core;
+	struct mCoreMovie* movie = threadContext->movie;
+	uint32_t keys = core->getKeys(core);
+	bool playing = movie->mode == mMOVIE_PLAYING;
+	if (!mCoreMovieRunFrame(movie, core, keys)) {
+		// Playback just ended, so carry on from where it left off
+		core->runFrame(core);
+		return;
+	}
+	uint32_t pressed;
+	// Same as with rollback, keep the frontend's keys unless it has set new ones since
+	if (playing && mCoreMovieGetKeys(movie, movie->frame - 1, &pressed) && core->getKeys(core) == pressed) {
+		core->setKeys(core, keys);
+	}
+}
+
+static void _runUnbounded(struct mCoreThread* threadContext, unsigned interval) {
+	struct mCoreThreadInternal* impl = threadContext->impl;
+	struct mCore* core = threadContext->core;
+	if (!impl->unbounded) {
+		core->setAudioSkip(core, true);
+		impl->unbounded = true;
+		impl->renderSkipped = false;
+	}
+	// Everything that runs per frame in the core, like cheats and callbacks, still does,
+	// but only the last frame is rendered and goes through the sync. The frontend decides
+	// whether to wait on it, which caps the speed at that many times normal speed.
+	core->setSync(core, NULL);
+	core->setRenderSkip(core, true);
+	unsigned i;
+	for (i = 1; i < interval; ++i) {
+		core->runFrame(core);
+	}
+	core->setRenderSkip(core, false);
+	core->setSync(core, &impl->sync);
+	core->runFrame(core);
+}
+
+static void _endUnbounded(struct mCoreThread* threadContext) {
+	struct mCoreThreadInternal* impl = threadContext->impl;
+	struct mCore* core = threadContext->core;
+	core->setAudioSkip(core, false);
+	impl->unbounded = false;
+}
+
 static THREAD_ENTRY _mCoreThreadRun(void* context) {
 	struct mCoreThread* threadContext = context;
 #ifdef USE_PTHREADS
@@ -208,6 +393,7 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 
 	ThreadLocalSetKey(_contextKey, threadContext);
 	ThreadSetName("CPU Thread");
+	mTRACE_THREAD_NAME("CPU Thread");
 
 	mLogSetThreadLogger(&threadContext->logger.d);
 
@@ -218,6 +404,10 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 #endif
 
 	struct mCore* core = threadContext->core;
+	struct ThreadPolicy policy;
+	mCoreConfigGetThreadPolicy(&core->config, &policy);
+	ThreadSetPolicy(&policy);
+
 	struct mCoreCallbacks callbacks = {
 		.videoFrameStarted = _frameStarted,
 		.videoFrameEnded = _frameEnded,
@@ -246,7 +436,12 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 	}
 #endif
 
+	mStateWriterInit(&threadContext->impl->stateWriter);
 	mCoreThreadRewindParamsChanged(threadContext);
+	if (threadContext->rollback) {
+		threadContext->rollback->runFrame = _rollbackRunFrame;
+		threadContext->rollback->context = threadContext;
+	}
 	if (threadContext->startCallback) {
 		threadContext->startCallback(threadContext);
 	}
@@ -295,8 +490,25 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 #endif
 		{
 			while (impl->state == mTHREAD_RUNNING) {
+				unsigned unbounded = impl->rewinding ? 0 : impl->unboundedInterval;
 				MutexUnlock(&impl->stateMutex);
-				core->runLoop(core);
+				if (impl->unbounded && (!unbounded || threadContext->rollback || _movieIsActive(threadContext))) {
+					_endUnbounded(threadContext);
+				}
+				if (threadContext->inputLatch && (threadContext->rollback || _movieIsActive(threadContext))) {
+					mInputLatchApply(threadContext->inputLatch, core);
+				}
+				if (threadContext->rollback) {
+					_runRollback(threadContext);
+				} else if (_movieIsActive(threadContext)) {
+					_runMovie(threadContext);
+				} else if (unbounded) {
+					_runUnbounded(threadContext, unbounded);
+				} else if (core->opts.runAhead > 0 && !impl->rewinding) {
+					_runAhead(threadContext);
+				} else {
+					core->runLoop(core);
+				}
 				MutexLock(&impl->stateMutex);
 			}
 		}
@@ -306,6 +518,7 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 				_changeState(impl, mTHREAD_INTERRUPTED);
 			}
 
+			mTRACE_BEGIN("Core thread: waiting");
 			while (impl->state >= mTHREAD_MIN_WAITING && impl->state <= mTHREAD_MAX_WAITING) {
 #ifdef ENABLE_DEBUGGERS
 				if (debugger && debugger->state != DEBUGGER_SHUTDOWN) {
@@ -319,11 +532,11 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 
 				if (impl->sync.audioWait) {
 					MutexUnlock(&impl->stateMutex);
-					mCoreSyncLockAudio(&impl->sync);
 					mCoreSyncProduceAudio(&impl->sync, core->getAudioBuffer(core));
 					MutexLock(&impl->stateMutex);
 				}
 			}
+			mTRACE_END();
 #ifdef ENABLE_SCRIPTING
 			scriptContext = threadContext->scriptContext;
 #endif
@@ -390,6 +603,14 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 	if (core->opts.rewindEnable) {
 		 mCoreRewindContextDeinit(&impl->rewind);
 	}
+	if (impl->unbounded) {
+		_endUnbounded(threadContext);
+	}
+	free(impl->runAheadState);
+	impl->runAheadState = NULL;
+	impl->runAheadStateSize = 0;
+	impl->runAheadCheckpoint = 0;
+	mStateWriterDeinit(&impl->stateWriter);
 
 	if (threadContext->cleanCallback) {
 		threadContext->cleanCallback(threadContext);
@@ -446,6 +667,8 @@ bool mCoreThreadStart(struct mCoreThread* threadContext) {
 	threadContext->impl->sync.videoFrameWait = threadContext->core->opts.videoSync;
 	threadContext->impl->sync.fpsTarget = threadContext->core->opts.fpsTarget;
 	threadContext->impl->sync.audioHighWater = 512;
+	mCoreFrameLimiterInit(&threadContext->impl->sync.frameLimiter);
+	mCoreConfigGetBoolValue(&threadContext->core->config, "frameLimiter", &threadContext->impl->sync.frameLimit);
 
 	MutexLock(&threadContext->impl->stateMutex);
 	ThreadCreate(&threadContext->impl->thread, _mCoreThreadRun, threadContext);
@@ -554,6 +777,7 @@ void mCoreThreadJoin(struct mCoreThread* threadContext) {
 	ConditionWake(&threadContext->impl->sync.audioRequiredCond);
 	ConditionDeinit(&threadContext->impl->sync.audioRequiredCond);
 	MutexDeinit(&threadContext->impl->sync.audioBufferMutex);
+	mCoreFrameLimiterDeinit(&threadContext->impl->sync.frameLimiter);
 
 	free(threadContext->impl);
 	threadContext->impl = NULL;
@@ -678,12 +902,86 @@ void mCoreThreadSetRewinding(struct mCoreThread* threadContext, bool rewinding)
 void mCoreThreadRewindParamsChanged(struct mCoreThread* threadContext) {
 	struct mCore* core = threadContext->core;
 	if (core->opts.rewindEnable && core->opts.rewindBufferCapacity > 0) {
-		 mCoreRewindContextInit(&threadContext->impl->rewind, core->opts.rewindBufferCapacity, true);
+		// With a memory budget, the budget decides how far back rewinding goes instead of the entry count
+		unsigned memory = 0;
+		mCoreConfigGetUIntValue(&core->config, "rewindBufferMemory", &memory);
+		mCoreRewindContextInit(&threadContext->impl->rewind, memory ? 0 : core->opts.rewindBufferCapacity, true);
+		mCoreRewindContextSetMemoryLimit(&threadContext->impl->rewind, (size_t) memory << 20);
+#if defined(ENABLE_VFS) && defined(ENABLE_DIRECTORIES)
+		// Past the memory budget, older states can go to disk next to the savestates
+		unsigned spill = 0;
+		mCoreConfigGetUIntValue(&core->config, "rewindSpill", &spill);
+		if (memory && spill && core->dirs.state) {
+			mCoreRewindContextSetSpill(&threadContext->impl->rewind, core->dirs.state, core->dirs.baseName, (size_t) spill << 20);
+		} else {
+			mCoreRewindContextSetSpill(&threadContext->impl->rewind, NULL, NULL, 0);
+		}
+#endif
+		struct ThreadPolicy policy;
+		mCoreConfigGetThreadPolicy(&core->config, &policy);
+		mCoreRewindContextSetThreadPolicy(&threadContext->impl->rewind, &policy);
+		unsigned workers = 0;
+		mCoreConfigGetUIntValue(&core->config, "rewindWorkers", &workers);
+		mCoreRewindContextSetWorkers(&threadContext->impl->rewind, workers);
 	} else {
 		 mCoreRewindContextDeinit(&threadContext->impl->rewind);
 	}
 }
 
+bool mCoreThreadSeekMovie(struct mCoreThread* threadContext, uint32_t frame) {
+	if (!threadContext->movie) {
+		return false;
+	}
+	struct mCoreThreadInternal* impl = threadContext->impl;
+	struct mCore* core = threadContext->core;
+	mCoreThreadInterrupt(threadContext);
+	// Frames emulated on the way to the target were already shown when they were first
+	// run, so treat them like run-ahead frames: no syncing, callbacks or rewind entries
+	impl->speculating = true;
+	impl->runningAhead = true;
+	core->setSync(core, NULL);
+	bool success = mCoreMovieSeek(threadContext->movie, core, frame);
+	core->setSync(core, &impl->sync);
+	impl->speculating = false;
+	impl->runningAhead = false;
+	impl->renderSkipped = false;
+	mCoreThreadContinue(threadContext);
+	return success;
+}
+
+void mCoreThreadSetUnboundedFastForward(struct mCoreThread* threadContext, unsigned interval) {
+	MutexLock(&threadContext->impl->stateMutex);
+	threadContext->impl->unboundedInterval = interval;
+	MutexUnlock(&threadContext->impl->stateMutex);
+}
+
+unsigned mCoreThreadGetUnboundedFastForward(struct mCoreThread* threadContext) {
+	MutexLock(&threadContext->impl->stateMutex);
+	unsigned interval = threadContext->impl->unboundedInterval;
+	MutexUnlock(&threadContext->impl->stateMutex);
+	return interval;
+}
+
+#if defined(ENABLE_VFS) && defined(ENABLE_DIRECTORIES)
+bool mCoreThreadSaveState(struct mCoreThread* threadContext, int slot, int flags) {
+	return mCoreSaveStateAsync(threadContext->core, &threadContext->impl->stateWriter, slot, flags);
+}
+
+bool mCoreThreadTakeScreenshot(struct mCoreThread* threadContext) {
+	return mCoreTakeScreenshotAsync(threadContext->core, &threadContext->impl->stateWriter);
+}
+#endif
+
+#ifdef ENABLE_VFS
+bool mCoreThreadTakeScreenshotVF(struct mCoreThread* threadContext, struct VFile* vf, const char* format) {
+	return mCoreTakeScreenshotVFAsync(threadContext->core, &threadContext->impl->stateWriter, vf, format);
+}
+#endif
+
+void mCoreThreadFlushStates(struct mCoreThread* threadContext) {
+	mStateWriterFlush(&threadContext->impl->stateWriter);
+}
+
 void mCoreThreadWaitFromThread(struct mCoreThread* threadContext) {
 	MutexLock(&threadContext->impl->stateMutex);
 	_sendRequest(threadContext->impl, mTHREAD_REQ_WAIT);
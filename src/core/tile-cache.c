@@ -7,6 +7,14 @@
 
 #include <mgba-util/memory.h>
 
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 void mTileCacheInit(struct mTileCache* cache) {
 	// TODO: Reconfigurable cache for space savings
 	cache->cache = NULL;
@@ -98,100 +106,147 @@ void mTileCacheWritePalette(struct mTileCache* cache, uint32_t entry, mColor col
 	if (entry >= maxEntry) {
 		return;
 	}
+	// Games often rewrite their whole palette every frame; only invalidate tiles if it actually changed
+	if (cache->palette[entry] == color) {
+		return;
+	}
 	cache->palette[entry] = color;
 	entry >>= (1 << mTileCacheSystemInfoGetPaletteBPP(cache->sysConfig));
 	++cache->globalPaletteVersion[entry];
 }
 
+// Tiles are regenerated in two steps: the tile data is unpacked into one palette index
+// per byte, then the indices are looked up in the palette. Index 0 keeps its alpha.
+#if !defined(COLOR_16_BIT) && !defined(__BIG_ENDIAN__) && (defined(__SSSE3__) || (defined(__ARM_NEON) && defined(__aarch64__)))
+#define TILE_CACHE_TABLE_LOOKUP
+#endif
+
+static void _lookupTile(mColor* restrict tile, const uint8_t* restrict indices, const mColor* restrict palette, unsigned entries) {
+	size_t i;
+#ifdef TILE_CACHE_TABLE_LOOKUP
+	if (entries <= 16) {
+		// Transpose the palette into byte planes so that each plane is a 16-entry byte shuffle
+#if defined(__SSSE3__)
+		__m128i alpha = _mm_set1_epi32(0xFF000000);
+		__m128i colors[4];
+		colors[0] = _mm_or_si128(_mm_loadu_si128((const __m128i*) palette), _mm_slli_si128(alpha, 4));
+		for (i = 1; i < 4; ++i) {
+			colors[i] = i < entries / 4 ? _mm_or_si128(_mm_loadu_si128((const __m128i*) &palette[i * 4]), alpha) : _mm_setzero_si128();
+		}
+		__m128i gather = _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+		for (i = 0; i < 4; ++i) {
+			colors[i] = _mm_shuffle_epi8(colors[i], gather);
+		}
+		__m128i lo01 = _mm_unpacklo_epi32(colors[0], colors[1]);
+		__m128i hi01 = _mm_unpackhi_epi32(colors[0], colors[1]);
+		__m128i lo23 = _mm_unpacklo_epi32(colors[2], colors[3]);
+		__m128i hi23 = _mm_unpackhi_epi32(colors[2], colors[3]);
+		__m128i p0 = _mm_unpacklo_epi64(lo01, lo23);
+		__m128i p1 = _mm_unpackhi_epi64(lo01, lo23);
+		__m128i p2 = _mm_unpacklo_epi64(hi01, hi23);
+		__m128i p3 = _mm_unpackhi_epi64(hi01, hi23);
+		for (i = 0; i < 64; i += 16) {
+			__m128i index = _mm_loadu_si128((const __m128i*) &indices[i]);
+			__m128i b0 = _mm_shuffle_epi8(p0, index);
+			__m128i b1 = _mm_shuffle_epi8(p1, index);
+			__m128i b2 = _mm_shuffle_epi8(p2, index);
+			__m128i b3 = _mm_shuffle_epi8(p3, index);
+			lo01 = _mm_unpacklo_epi8(b0, b1);
+			hi01 = _mm_unpackhi_epi8(b0, b1);
+			lo23 = _mm_unpacklo_epi8(b2, b3);
+			hi23 = _mm_unpackhi_epi8(b2, b3);
+			_mm_storeu_si128((__m128i*) &tile[i], _mm_unpacklo_epi16(lo01, lo23));
+			_mm_storeu_si128((__m128i*) &tile[i + 4], _mm_unpackhi_epi16(lo01, lo23));
+			_mm_storeu_si128((__m128i*) &tile[i + 8], _mm_unpacklo_epi16(hi01, hi23));
+			_mm_storeu_si128((__m128i*) &tile[i + 12], _mm_unpackhi_epi16(hi01, hi23));
+		}
+#else
+		uint8x16x4_t planes;
+		if (entries == 16) {
+			planes = vld4q_u8((const uint8_t*) palette);
+			planes.val[3] = vorrq_u8(planes.val[3], vreinterpretq_u8_u64(vcombine_u64(vcreate_u64(0xFFFFFFFFFFFFFF00ULL), vcreate_u64(~0ULL))));
+		} else {
+			uint32_t padded[16] = {0};
+			vst1q_u32(padded, vorrq_u32(vld1q_u32(palette), vsetq_lane_u32(0, vdupq_n_u32(0xFF000000), 0)));
+			planes = vld4q_u8((const uint8_t*) padded);
+		}
+		for (i = 0; i < 64; i += 16) {
+			uint8x16_t index = vld1q_u8(&indices[i]);
+			uint8x16x4_t pixels = {{
+				vqtbl1q_u8(planes.val[0], index),
+				vqtbl1q_u8(planes.val[1], index),
+				vqtbl1q_u8(planes.val[2], index),
+				vqtbl1q_u8(planes.val[3], index),
+			}};
+			vst4q_u8((uint8_t*) &tile[i], pixels);
+		}
+#endif
+		return;
+	}
+#else
+	UNUSED(entries);
+#endif
+	for (i = 0; i < 64; ++i) {
+		unsigned pixel = indices[i];
+		tile[i] = palette[pixel] | (-(pixel != 0) & 0xFF000000);
+	}
+}
+
+// Spreads the bits of a byte into the bytes of a word, most significant bit first
+static inline uint64_t _spreadBits(uint8_t bits) {
+	return ((((bits * 0x0101010101010101ULL) & 0x0102040810204080ULL) + 0x7F7F7F7F7F7F7F7FULL) >> 7) & 0x0101010101010101ULL;
+}
+
 static void _regenerateTile4(struct mTileCache* cache, mColor* tile, unsigned tileId, unsigned paletteId) {
 	uint8_t* start = (uint8_t*) &cache->vram[tileId << 3];
-	paletteId <<= 2;
-	mColor* palette = &cache->palette[paletteId];
+	uint8_t indices[64];
 	int i;
 	for (i = 0; i < 8; ++i) {
-		uint8_t tileDataLower = start[0];
-		uint8_t tileDataUpper = start[1];
+		uint64_t row = _spreadBits(start[0]) | (_spreadBits(start[1]) << 1);
 		start += 2;
-		int pixel;
-		pixel = ((tileDataUpper & 128) >> 6) | ((tileDataLower & 128) >> 7);
-		tile[0] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = ((tileDataUpper & 64) >> 5) | ((tileDataLower & 64) >> 6);
-		tile[1] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = ((tileDataUpper & 32) >> 4) | ((tileDataLower & 32) >> 5);
-		tile[2] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = ((tileDataUpper & 16) >> 3) | ((tileDataLower & 16) >> 4);
-		tile[3] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = ((tileDataUpper & 8) >> 2) | ((tileDataLower & 8) >> 3);
-		tile[4] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = ((tileDataUpper & 4) >> 1) | ((tileDataLower & 4) >> 2);
-		tile[5] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (tileDataUpper & 2) | ((tileDataLower & 2) >> 1);
-		tile[6] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = ((tileDataUpper & 1) << 1) | (tileDataLower & 1);
-		tile[7] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		tile += 8;
+#ifdef __BIG_ENDIAN__
+		int x;
+		for (x = 0; x < 8; ++x) {
+			indices[i * 8 + x] = row >> (x * 8);
+		}
+#else
+		memcpy(&indices[i * 8], &row, sizeof(row));
+#endif
 	}
+	_lookupTile(tile, indices, &cache->palette[paletteId << 2], 4);
 }
 
 static void _regenerateTile16(struct mTileCache* cache, mColor* tile, unsigned tileId, unsigned paletteId) {
-	uint32_t* start = (uint32_t*) &cache->vram[tileId << 4];
-	paletteId <<= 4;
-	mColor* palette = &cache->palette[paletteId];
-	int i;
-	for (i = 0; i < 8; ++i) {
-		uint32_t line = *start;
-		++start;
-		int pixel;
-		pixel = line & 0xF;
-		tile[0] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 4) & 0xF;
-		tile[1] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 8) & 0xF;
-		tile[2] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 12) & 0xF;
-		tile[3] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 16) & 0xF;
-		tile[4] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 20) & 0xF;
-		tile[5] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 24) & 0xF;
-		tile[6] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 28) & 0xF;
-		tile[7] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		tile += 8;
+	uint8_t* start = (uint8_t*) &cache->vram[tileId << 4];
+	uint8_t indices[64];
+	int i = 0;
+#if defined(__SSE2__)
+	__m128i mask = _mm_set1_epi8(0xF);
+	for (; i < 32; i += 16) {
+		__m128i data = _mm_loadu_si128((const __m128i*) &start[i]);
+		__m128i lo = _mm_and_si128(data, mask);
+		__m128i hi = _mm_and_si128(_mm_srli_epi16(data, 4), mask);
+		_mm_storeu_si128((__m128i*) &indices[i * 2], _mm_unpacklo_epi8(lo, hi));
+		_mm_storeu_si128((__m128i*) &indices[i * 2 + 16], _mm_unpackhi_epi8(lo, hi));
 	}
+#elif defined(__ARM_NEON)
+	for (; i < 32; i += 16) {
+		uint8x16_t data = vld1q_u8(&start[i]);
+		uint8x16x2_t pixels = vzipq_u8(vandq_u8(data, vdupq_n_u8(0xF)), vshrq_n_u8(data, 4));
+		vst1q_u8(&indices[i * 2], pixels.val[0]);
+		vst1q_u8(&indices[i * 2 + 16], pixels.val[1]);
+	}
+#endif
+	for (; i < 32; ++i) {
+		indices[i * 2] = start[i] & 0xF;
+		indices[i * 2 + 1] = start[i] >> 4;
+	}
+	_lookupTile(tile, indices, &cache->palette[paletteId << 4], 16);
 }
 
 static void _regenerateTile256(struct mTileCache* cache, mColor* tile, unsigned tileId, unsigned paletteId) {
-	uint32_t* start = (uint32_t*) &cache->vram[tileId << 5];
-	paletteId <<= 8;
-	mColor* palette = &cache->palette[paletteId];
-	int i;
-	for (i = 0; i < 8; ++i) {
-		uint32_t line = *start;
-		++start;
-		int pixel;
-		pixel = line & 0xFF;
-		tile[0] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 8) & 0xFF;
-		tile[1] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 16) & 0xFF;
-		tile[2] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 24) & 0xFF;
-		tile[3] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-
-		line = *start;
-		++start;
-		pixel = line & 0xFF;
-		tile[4] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 8) & 0xFF;
-		tile[5] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 16) & 0xFF;
-		tile[6] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 24) & 0xFF;
-		tile[7] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		tile += 8;
-	}
+	const uint8_t* start = (const uint8_t*) &cache->vram[tileId << 5];
+	_lookupTile(tile, start, &cache->palette[paletteId << 8], 256);
 }
 
 static inline mColor* _tileLookup(struct mTileCache* cache, unsigned tileId, unsigned paletteId) {
@@ -5,57 +5,152 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/core/timing.h>
 
+#define EVENTS_INITIAL_SIZE 16
+
+static inline bool _isBefore(const struct mTimingEvent* a, const struct mTimingEvent* b) {
+	int32_t diff = a->when - b->when;
+	if (diff) {
+		return diff < 0;
+	}
+	if (a->priority != b->priority) {
+		return a->priority < b->priority;
+	}
+	// Events with the same time and priority run in the order they were scheduled
+	return (int32_t) (a->order - b->order) < 0;
+}
+
+static void _siftUp(struct mTiming* timing, size_t index) {
+	struct mTimingEvent** events = timing->events;
+	struct mTimingEvent* event = events[index];
+	while (index) {
+		size_t parent = (index - 1) >> 1;
+		if (!_isBefore(event, events[parent])) {
+			break;
+		}
+		events[index] = events[parent];
+		events[index]->index = index;
+		index = parent;
+	}
+	events[index] = event;
+	event->index = index;
+}
+
+static void _siftDown(struct mTiming* timing, size_t index) {
+	struct mTimingEvent** events = timing->events;
+	struct mTimingEvent* event = events[index];
+	size_t nEvents = timing->nEvents;
+	while (true) {
+		size_t child = index * 2 + 1;
+		if (child >= nEvents) {
+			break;
+		}
+		if (child + 1 < nEvents && _isBefore(events[child + 1], events[child])) {
+			++child;
+		}
+		if (!_isBefore(events[child], event)) {
+			break;
+		}
+		events[index] = events[child];
+		events[index]->index = index;
+		index = child;
+	}
+	events[index] = event;
+	event->index = index;
+}
+
+static void _remove(struct mTiming* timing, size_t index) {
+	--timing->nEvents;
+	if (index == timing->nEvents) {
+		return;
+	}
+	struct mTimingEvent* last = timing->events[timing->nEvents];
+	timing->events[index] = last;
+	last->index = index;
+	if (index && _isBefore(last, timing->events[(index - 1) >> 1])) {
+		_siftUp(timing, index);
+	} else {
+		_siftDown(timing, index);
+	}
+}
+
 void mTimingInit(struct mTiming* timing, int32_t* relativeCycles, int32_t* nextEvent) {
-	timing->root = NULL;
-	timing->reroot = NULL;
+	timing->capacity = EVENTS_INITIAL_SIZE;
+	timing->events = malloc(sizeof(*timing->events) * timing->capacity);
+	timing->nEvents = 0;
+	timing->order = 0;
+	timing->interrupted = false;
 	timing->globalCycles = 0;
 	timing->masterCycles = 0;
 	timing->relativeCycles = relativeCycles;
 	timing->nextEvent = nextEvent;
+	timing->profile = NULL;
 }
 
 void mTimingDeinit(struct mTiming* timing) {
-	UNUSED(timing);
+	free(timing->events);
+	timing->events = NULL;
+	timing->nEvents = 0;
+	timing->capacity = 0;
 }
 
 void mTimingClear(struct mTiming* timing) {
-	timing->root = NULL;
-	timing->reroot = NULL;
+	mTimingDescheduleAll(timing);
 	timing->globalCycles = 0;
 	timing->masterCycles = 0;
 }
 
 void mTimingInterrupt(struct mTiming* timing) {
-	if (!timing->root) {
+	if (!timing->nEvents) {
 		return;
 	}
-	timing->reroot = timing->root;
-	timing->root = NULL;
+	timing->interrupted = true;
+}
+
+static struct mTimingProfileEntry* _profileEntry(struct mTimingProfile* profile, const char* name) {
+	size_t i;
+	for (i = 0; i < profile->nEntries; ++i) {
+		const char* entryName = profile->entries[i].name;
+		// The same name may come from string literals in different files
+		if (entryName == name || (entryName && name && strcmp(entryName, name) == 0)) {
+			return &profile->entries[i];
+		}
+	}
+	if (profile->nEntries < mTIMING_PROFILE_MAX_EVENTS) {
+		++profile->nEntries;
+	} else {
+		i = mTIMING_PROFILE_MAX_EVENTS - 1;
+		name = NULL;
+	}
+	profile->entries[i].name = name;
+	return &profile->entries[i];
+}
+
+static inline uint64_t _profileClock(const struct mTimingProfile* profile) {
+	return profile->clock ? profile->clock() : 0;
 }
 
 void mTimingSchedule(struct mTiming* timing, struct mTimingEvent* event, int32_t when) {
 	int32_t nextEvent = when + *timing->relativeCycles;
+	if (mTimingIsScheduled(timing, event)) {
+		if (UNLIKELY(timing->profile)) {
+			++_profileEntry(timing->profile, event->name)->reschedules;
+		}
+		_remove(timing, event->index);
+	}
 	event->when = nextEvent + timing->masterCycles;
+	event->order = timing->order;
+	++timing->order;
 	if (nextEvent < *timing->nextEvent) {
 		*timing->nextEvent = nextEvent;
 	}
-	if (timing->reroot) {
-		timing->root = timing->reroot;
-		timing->reroot = NULL;
-	}
-	struct mTimingEvent** previous = &timing->root;
-	struct mTimingEvent* next = timing->root;
-	unsigned priority = event->priority;
-	while (next) {
-		int32_t nextWhen = next->when - timing->masterCycles;
-		if (nextWhen > nextEvent || (nextWhen == nextEvent && next->priority > priority)) {
-			break;
-		}
-		previous = &next->next;
-		next = next->next;
+	timing->interrupted = false;
+	if (timing->nEvents == timing->capacity) {
+		timing->capacity *= 2;
+		timing->events = realloc(timing->events, sizeof(*timing->events) * timing->capacity);
 	}
-	event->next = next;
-	*previous = event;
+	timing->events[timing->nEvents] = event;
+	++timing->nEvents;
+	_siftUp(timing, timing->nEvents - 1);
 }
 
 void mTimingScheduleAbsolute(struct mTiming* timing, struct mTimingEvent* event, int32_t when) {
@@ -63,51 +158,84 @@ void mTimingScheduleAbsolute(struct mTiming* timing, struct mTimingEvent* event,
 }
 
 void mTimingDeschedule(struct mTiming* timing, struct mTimingEvent* event) {
-	if (timing->reroot) {
-		timing->root = timing->reroot;
-		timing->reroot = NULL;
-	}
-	struct mTimingEvent** previous = &timing->root;
-	struct mTimingEvent* next = timing->root;
-	while (next) {
-		if (next == event) {
-			*previous = next->next;
-			return;
+	timing->interrupted = false;
+	if (mTimingIsScheduled(timing, event)) {
+		if (UNLIKELY(timing->profile)) {
+			++_profileEntry(timing->profile, event->name)->deschedules;
 		}
-		previous = &next->next;
-		next = next->next;
+		_remove(timing, event->index);
 	}
 }
 
+void mTimingDescheduleAll(struct mTiming* timing) {
+	timing->nEvents = 0;
+	timing->interrupted = false;
+}
+
 bool mTimingIsScheduled(const struct mTiming* timing, const struct mTimingEvent* event) {
-	const struct mTimingEvent* next = timing->root;
-	if (!next) {
-		next = timing->reroot;
+	return event->index < timing->nEvents && timing->events[event->index] == event;
+}
+
+static int32_t _mTimingTickProfiled(struct mTiming* timing, struct mTimingProfile* profile, int32_t cycles) {
+	if (profile->active) {
+		// Ticking from inside an event callback, which is already being timed
+		timing->profile = NULL;
+		int32_t nextEvent = mTimingTick(timing, cycles);
+		timing->profile = profile;
+		return nextEvent;
 	}
-	while (next) {
-		if (next == event) {
-			return true;
+	profile->active = true;
+	uint64_t start = _profileClock(profile);
+	timing->masterCycles += cycles;
+	while (true) {
+		uint32_t masterCycles = timing->masterCycles;
+		while (timing->nEvents && !timing->interrupted) {
+			struct mTimingEvent* next = timing->events[0];
+			int32_t nextWhen = next->when - masterCycles;
+			if (nextWhen > 0) {
+				profile->active = false;
+				profile->tickTime += _profileClock(profile) - start;
+				return nextWhen;
+			}
+			_remove(timing, 0);
+			struct mTimingProfileEntry* entry = _profileEntry(profile, next->name);
+			uint64_t eventStart = _profileClock(profile);
+			next->callback(timing, next->context, -nextWhen);
+			entry->time += _profileClock(profile) - eventStart;
+			++entry->count;
+			entry->lateness += -nextWhen;
+		}
+		if (!timing->interrupted) {
+			break;
+		}
+		timing->interrupted = false;
+		*timing->nextEvent = mTimingNextEvent(timing);
+		if (*timing->nextEvent > 0) {
+			break;
 		}
-		next = next->next;
 	}
-	return false;
+	profile->active = false;
+	profile->tickTime += _profileClock(profile) - start;
+	return *timing->nextEvent;
 }
 
 int32_t mTimingTick(struct mTiming* timing, int32_t cycles) {
+	if (UNLIKELY(timing->profile)) {
+		return _mTimingTickProfiled(timing, timing->profile, cycles);
+	}
 	timing->masterCycles += cycles;
 	uint32_t masterCycles = timing->masterCycles;
-	while (timing->root) {
-		struct mTimingEvent* next = timing->root;
+	while (timing->nEvents && !timing->interrupted) {
+		struct mTimingEvent* next = timing->events[0];
 		int32_t nextWhen = next->when - masterCycles;
 		if (nextWhen > 0) {
 			return nextWhen;
 		}
-		timing->root = next->next;
+		_remove(timing, 0);
 		next->callback(timing, next->context, -nextWhen);
 	}
-	if (timing->reroot) {
-		timing->root = timing->reroot;
-		timing->reroot = NULL;
+	if (timing->interrupted) {
+		timing->interrupted = false;
 		*timing->nextEvent = mTimingNextEvent(timing);
 		if (*timing->nextEvent <= 0) {
 			return mTimingTick(timing, 0);
@@ -116,6 +244,13 @@ int32_t mTimingTick(struct mTiming* timing, int32_t cycles) {
 	return *timing->nextEvent;
 }
 
+void mTimingProfileReset(struct mTimingProfile* profile) {
+	profile->tickTime = 0;
+	profile->nEntries = 0;
+	memset(profile->entries, 0, sizeof(profile->entries));
+	profile->active = false;
+}
+
 int32_t mTimingCurrentTime(const struct mTiming* timing) {
 	return timing->masterCycles + *timing->relativeCycles;
 }
@@ -125,10 +260,10 @@ uint64_t mTimingGlobalTime(const struct mTiming* timing) {
 }
 
 int32_t mTimingNextEvent(struct mTiming* timing) {
-	struct mTimingEvent* next = timing->root;
-	if (!next) {
+	if (!timing->nEvents || timing->interrupted) {
 		return INT_MAX;
 	}
+	struct mTimingEvent* next = timing->events[0];
 	return next->when - timing->masterCycles - *timing->relativeCycles;
 }
 
@@ -6,10 +6,16 @@
 #include <mgba/internal/debugger/access-logger.h>
 
 #include <mgba/core/core.h>
+#include <mgba-util/math.h>
+#include <mgba-util/memory.h>
 #include <mgba-util/vfs.h>
 
 #define DEFAULT_MAX_REGIONS 20
 
+#define BATCH_PAGE_SHIFT 12
+#define BATCH_PAGE_SIZE (1 << BATCH_PAGE_SHIFT)
+#define BATCH_SYNC_INTERVAL 60
+
 const char mAL_MAGIC[] = "mAL\1";
 
 DEFINE_VECTOR(mDebuggerAccessLogRegionList, struct mDebuggerAccessLogRegion);
@@ -45,6 +51,144 @@ struct mDebuggerAccessLog {
 	struct mDebuggerAccessLogRegionInfo regionInfo[];
 };
 
+static size_t _batchDirtyWords(const struct mDebuggerAccessLogRegion* region) {
+	size_t pages = (region->size + BATCH_PAGE_SIZE - 1) >> BATCH_PAGE_SHIFT;
+	return (pages + 31) / 32;
+}
+
+static void _allocBatch(struct mDebuggerAccessLogRegion* region) {
+	size_t i;
+	for (i = 0; i < 2; ++i) {
+		struct mDebuggerAccessLogBatch* batch = &region->batch[i];
+		if (!batch->block) {
+			batch->block = anonymousMemoryMap(region->size * sizeof(mDebuggerAccessLogFlags));
+			batch->dirty = calloc(_batchDirtyWords(region), sizeof(*batch->dirty));
+		}
+		if (region->blockEx && !batch->blockEx) {
+			batch->blockEx = anonymousMemoryMap(region->size * sizeof(mDebuggerAccessLogFlagsEx));
+		}
+	}
+}
+
+static void _freeBatch(struct mDebuggerAccessLogRegion* region) {
+	size_t i;
+	for (i = 0; i < 2; ++i) {
+		struct mDebuggerAccessLogBatch* batch = &region->batch[i];
+		if (batch->block) {
+			mappedMemoryFree(batch->block, region->size * sizeof(mDebuggerAccessLogFlags));
+			free(batch->dirty);
+		}
+		if (batch->blockEx) {
+			mappedMemoryFree(batch->blockEx, region->size * sizeof(mDebuggerAccessLogFlagsEx));
+		}
+		memset(batch, 0, sizeof(*batch));
+	}
+}
+
+static void _mergeBatch(struct mDebuggerAccessLogRegion* region, struct mDebuggerAccessLogBatch* batch) {
+	size_t words = _batchDirtyWords(region);
+	size_t w;
+	for (w = 0; w < words; ++w) {
+		uint32_t bits = batch->dirty[w];
+		batch->dirty[w] = 0;
+		while (bits) {
+			size_t start = (w * 32 + ctz32(bits)) << BATCH_PAGE_SHIFT;
+			size_t end = start + BATCH_PAGE_SIZE;
+			if (end > region->size) {
+				end = region->size;
+			}
+			bits &= bits - 1;
+
+			// Only store into the shadow file when something is new, so untouched pages stay clean
+			size_t i;
+			for (i = start; i < end; ++i) {
+				if (batch->block[i] & ~region->block[i]) {
+					region->block[i] |= batch->block[i];
+				}
+				batch->block[i] = 0;
+			}
+			if (batch->blockEx && region->blockEx) {
+				for (i = start; i < end; ++i) {
+					if (batch->blockEx[i] & ~region->blockEx[i]) {
+						region->blockEx[i] |= batch->blockEx[i];
+					}
+					batch->blockEx[i] = 0;
+				}
+			}
+		}
+	}
+}
+
+static void _flushBatch(struct mDebuggerAccessLogger* logger, int index) {
+	size_t i;
+	for (i = 0; i < mDebuggerAccessLogRegionListSize(&logger->regions); ++i) {
+		struct mDebuggerAccessLogRegion* region = mDebuggerAccessLogRegionListGetPointer(&logger->regions, i);
+		if (region->batch[index].block) {
+			_mergeBatch(region, &region->batch[index]);
+		}
+	}
+	++logger->batchFlushes;
+	if (logger->batchFlushes % BATCH_SYNC_INTERVAL == 0) {
+		logger->backing->sync(logger->backing, logger->mapped, logger->backing->size(logger->backing));
+	}
+}
+
+#ifndef DISABLE_THREADING
+static THREAD_ENTRY _batchThread(void* context) {
+	struct mDebuggerAccessLogger* logger = context;
+	ThreadSetName("Access Log");
+	MutexLock(&logger->batchMutex);
+	while (true) {
+		while (!logger->batchPending && !logger->batchExiting) {
+			ConditionWait(&logger->batchStartCond, &logger->batchMutex);
+		}
+		if (!logger->batchPending) {
+			break;
+		}
+		int index = !logger->batchFront;
+		MutexUnlock(&logger->batchMutex);
+		_flushBatch(logger, index);
+		MutexLock(&logger->batchMutex);
+		logger->batchPending = false;
+		ConditionWake(&logger->batchDoneCond);
+	}
+	MutexUnlock(&logger->batchMutex);
+	THREAD_EXIT(0);
+}
+#endif
+
+static void _kickBatch(struct mDebuggerAccessLogger* logger) {
+#ifndef DISABLE_THREADING
+	MutexLock(&logger->batchMutex);
+	// If the worker hasn't caught up yet, keep accumulating into the same buffers
+	if (!logger->batchPending) {
+		logger->batchFront = !logger->batchFront;
+		logger->batchPending = true;
+		ConditionWake(&logger->batchStartCond);
+	}
+	MutexUnlock(&logger->batchMutex);
+#else
+	_flushBatch(logger, logger->batchFront);
+#endif
+}
+
+static mDebuggerAccessLogFlags* _accessBlock(struct mDebuggerAccessLogger* logger, struct mDebuggerAccessLogRegion* region, size_t offset, size_t width, mDebuggerAccessLogFlagsEx** blockEx) {
+	struct mDebuggerAccessLogBatch* batch = &region->batch[logger->batchFront];
+	if (!logger->batched || !batch->block) {
+		*blockEx = region->blockEx;
+		return region->block;
+	}
+	if (offset + width > region->size) {
+		width = region->size - offset;
+	}
+	size_t page = offset >> BATCH_PAGE_SHIFT;
+	batch->dirty[page / 32] |= 1U << (page & 31);
+	page = (offset + width - 1) >> BATCH_PAGE_SHIFT;
+	batch->dirty[page / 32] |= 1U << (page & 31);
+	*blockEx = batch->blockEx;
+	return batch->block;
+}
+
 static void _mDebuggerAccessLoggerEntered(struct mDebuggerModule* debugger, enum mDebuggerEntryReason reason, struct mDebuggerEntryInfo* info) {
 	struct mDebuggerAccessLogger* logger = (struct mDebuggerAccessLogger*) debugger;
 	logger->d.isPaused = false;
@@ -69,6 +213,9 @@ static void _mDebuggerAccessLoggerEntered(struct mDebuggerModule* debugger, enum
 	}
 	offset &= -info->width;
 
+	mDebuggerAccessLogFlagsEx* blockEx;
+	mDebuggerAccessLogFlags* block = _accessBlock(logger, region, offset, info->width, &blockEx);
+
 	mDebuggerAccessLogFlags flags = 0;
 	mDebuggerAccessLogFlagsEx flagsEx = 0;
 	switch (reason) {
@@ -100,60 +247,60 @@ static void _mDebuggerAccessLoggerEntered(struct mDebuggerModule* debugger, enum
 		}
 		switch (info->width) {
 		case 1:
-			region->block[offset] = flags | mDebuggerAccessLogFlagsFillAccess8(region->block[offset]);
-			if (region->blockEx) {
-				region->blockEx[offset] |= flagsEx;
+			block[offset] = flags | mDebuggerAccessLogFlagsFillAccess8(block[offset]);
+			if (blockEx) {
+				blockEx[offset] |= flagsEx;
 			}
 			break;
 		case 2:
-			region->block[offset] = flags | mDebuggerAccessLogFlagsFillAccess16(region->block[offset]);
-			region->block[offset + 1] = flags | mDebuggerAccessLogFlagsFillAccess16(region->block[offset + 1]);
-			if (region->blockEx) {
-				region->blockEx[offset] |= flagsEx;
-				region->blockEx[offset + 1] |= flagsEx;
+			block[offset] = flags | mDebuggerAccessLogFlagsFillAccess16(block[offset]);
+			block[offset + 1] = flags | mDebuggerAccessLogFlagsFillAccess16(block[offset + 1]);
+			if (blockEx) {
+				blockEx[offset] |= flagsEx;
+				blockEx[offset + 1] |= flagsEx;
 			}
 			break;
 		case 4:
-			region->block[offset] = flags | mDebuggerAccessLogFlagsFillAccess32(region->block[offset]);
-			region->block[offset + 1] = flags | mDebuggerAccessLogFlagsFillAccess32(region->block[offset + 1]);
-			region->block[offset + 2] = flags | mDebuggerAccessLogFlagsFillAccess32(region->block[offset + 2]);
-			region->block[offset + 3] = flags | mDebuggerAccessLogFlagsFillAccess32(region->block[offset + 3]);
-			if (region->blockEx) {
-				region->blockEx[offset] |= flagsEx;
-				region->blockEx[offset + 1] |= flagsEx;
-				region->blockEx[offset + 2] |= flagsEx;
-				region->blockEx[offset + 3] |= flagsEx;
+			block[offset] = flags | mDebuggerAccessLogFlagsFillAccess32(block[offset]);
+			block[offset + 1] = flags | mDebuggerAccessLogFlagsFillAccess32(block[offset + 1]);
+			block[offset + 2] = flags | mDebuggerAccessLogFlagsFillAccess32(block[offset + 2]);
+			block[offset + 3] = flags | mDebuggerAccessLogFlagsFillAccess32(block[offset + 3]);
+			if (blockEx) {
+				blockEx[offset] |= flagsEx;
+				blockEx[offset + 1] |= flagsEx;
+				blockEx[offset + 2] |= flagsEx;
+				blockEx[offset + 3] |= flagsEx;
 			}
 			break;
 		case 8:
-			region->block[offset] = flags | mDebuggerAccessLogFlagsFillAccess64(region->block[offset]);
-			region->block[offset + 1] = flags | mDebuggerAccessLogFlagsFillAccess64(region->block[offset + 1]);
-			region->block[offset + 2] = flags | mDebuggerAccessLogFlagsFillAccess64(region->block[offset + 2]);
-			region->block[offset + 3] = flags | mDebuggerAccessLogFlagsFillAccess64(region->block[offset + 3]);
-			region->block[offset + 4] = flags | mDebuggerAccessLogFlagsFillAccess64(region->block[offset + 4]);
-			region->block[offset + 5] = flags | mDebuggerAccessLogFlagsFillAccess64(region->block[offset + 5]);
-			region->block[offset + 6] = flags | mDebuggerAccessLogFlagsFillAccess64(region->block[offset + 6]);
-			region->block[offset + 7] = flags | mDebuggerAccessLogFlagsFillAccess64(region->block[offset + 7]);
-			if (region->blockEx) {
-				region->blockEx[offset] |= flagsEx;
-				region->blockEx[offset + 1] |= flagsEx;
-				region->blockEx[offset + 2] |= flagsEx;
-				region->blockEx[offset + 3] |= flagsEx;
-				region->blockEx[offset + 4] |= flagsEx;
-				region->blockEx[offset + 5] |= flagsEx;
-				region->blockEx[offset + 6] |= flagsEx;
-				region->blockEx[offset + 7] |= flagsEx;
+			block[offset] = flags | mDebuggerAccessLogFlagsFillAccess64(block[offset]);
+			block[offset + 1] = flags | mDebuggerAccessLogFlagsFillAccess64(block[offset + 1]);
+			block[offset + 2] = flags | mDebuggerAccessLogFlagsFillAccess64(block[offset + 2]);
+			block[offset + 3] = flags | mDebuggerAccessLogFlagsFillAccess64(block[offset + 3]);
+			block[offset + 4] = flags | mDebuggerAccessLogFlagsFillAccess64(block[offset + 4]);
+			block[offset + 5] = flags | mDebuggerAccessLogFlagsFillAccess64(block[offset + 5]);
+			block[offset + 6] = flags | mDebuggerAccessLogFlagsFillAccess64(block[offset + 6]);
+			block[offset + 7] = flags | mDebuggerAccessLogFlagsFillAccess64(block[offset + 7]);
+			if (blockEx) {
+				blockEx[offset] |= flagsEx;
+				blockEx[offset + 1] |= flagsEx;
+				blockEx[offset + 2] |= flagsEx;
+				blockEx[offset + 3] |= flagsEx;
+				blockEx[offset + 4] |= flagsEx;
+				blockEx[offset + 5] |= flagsEx;
+				blockEx[offset + 6] |= flagsEx;
+				blockEx[offset + 7] |= flagsEx;
 			}
 			break;
 		}
 		break;
 	case DEBUGGER_ENTER_ILLEGAL_OP:
-		region->block[offset] = mDebuggerAccessLogFlagsFillExecute(region->block[offset]);
-		if (region->blockEx) {
+		block[offset] = mDebuggerAccessLogFlagsFillExecute(block[offset]);
+		if (blockEx) {
 			uint16_t ex;
-			LOAD_16LE(ex, 0, &region->blockEx[offset]);
+			LOAD_16LE(ex, 0, &blockEx[offset]);
 			ex = mDebuggerAccessLogFlagsExFillErrorIllegalOpcode(ex);
-			STORE_16LE(ex, 0, &region->blockEx[offset]);
+			STORE_16LE(ex, 0, &blockEx[offset]);
 		}
 		break;
 	default:
@@ -164,6 +311,15 @@ static void _mDebuggerAccessLoggerEntered(struct mDebuggerModule* debugger, enum
 static void _mDebuggerAccessLoggerCallback(struct mDebuggerModule* debugger) {
 	struct mDebuggerAccessLogger* logger = (struct mDebuggerAccessLogger*) debugger;
 
+	if (logger->batched) {
+		struct mCore* core = logger->d.p->core;
+		uint32_t frame = core->frameCounter(core);
+		if (frame != logger->batchFrame) {
+			logger->batchFrame = frame;
+			_kickBatch(logger);
+		}
+	}
+
 	struct mDebuggerInstructionInfo info;
 	logger->d.p->platform->nextInstructionInfo(logger->d.p->platform, &info);
 
@@ -173,16 +329,19 @@ static void _mDebuggerAccessLoggerCallback(struct mDebuggerModule* debugger) {
 		return;
 	}
 
+	mDebuggerAccessLogFlagsEx* blockEx;
+	mDebuggerAccessLogFlags* block = _accessBlock(logger, region, offset, info.width, &blockEx);
+
 	size_t i;
 	for (i = 0; i < info.width; ++i) {
 		uint16_t ex = 0;
-		region->block[offset + i] = mDebuggerAccessLogFlagsFillExecute(region->block[offset + i]);
-		region->block[offset + i] |= info.flags[i];
+		block[offset + i] = mDebuggerAccessLogFlagsFillExecute(block[offset + i]);
+		block[offset + i] |= info.flags[i];
 
-		if (region->blockEx) {
-			LOAD_16LE(ex, 0, &region->blockEx[offset + i]);
+		if (blockEx) {
+			LOAD_16LE(ex, 0, &blockEx[offset + i]);
 			ex |= info.flagsEx[i];
-			STORE_16LE(ex, 0, &region->blockEx[offset + i]);
+			STORE_16LE(ex, 0, &blockEx[offset + i]);
 		}
 	}
 }
@@ -197,6 +356,7 @@ void mDebuggerAccessLoggerInit(struct mDebuggerAccessLogger* logger) {
 }
 
 void mDebuggerAccessLoggerDeinit(struct mDebuggerAccessLogger* logger) {
+	mDebuggerAccessLoggerSetBatched(logger, false);
 	mDebuggerAccessLoggerClose(logger);
 	mDebuggerAccessLogRegionListDeinit(&logger->regions);
 }
@@ -268,6 +428,9 @@ static bool _setupRegion(struct mDebuggerAccessLogger* logger, struct mDebuggerA
 	if (region->watchpoint < 0) {
 		return false;
 	}
+	if (logger->batched) {
+		_allocBatch(region);
+	}
 	mDebuggerModuleSetNeedsCallback(&logger->d);
 	return true;
 }
@@ -368,6 +531,7 @@ void mDebuggerAccessLoggerStart(struct mDebuggerAccessLogger* logger) {
 }
 
 void mDebuggerAccessLoggerStop(struct mDebuggerAccessLogger* logger) {
+	mDebuggerAccessLoggerFlush(logger);
 	size_t i;
 	for (i = 0; i < logger->mapped->header.nRegions; ++i) {
 		struct mDebuggerAccessLogRegion* region = mDebuggerAccessLogRegionListGetPointer(&logger->regions, i);
@@ -380,7 +544,70 @@ void mDebuggerAccessLoggerStop(struct mDebuggerAccessLogger* logger) {
 	mDebuggerModuleClearNeedsCallback(&logger->d);
 }
 
+void mDebuggerAccessLoggerSetBatched(struct mDebuggerAccessLogger* logger, bool batched) {
+	if (batched == logger->batched) {
+		return;
+	}
+	size_t i;
+	if (batched) {
+		logger->batchFront = 0;
+		logger->batchFlushes = 0;
+		for (i = 0; i < mDebuggerAccessLogRegionListSize(&logger->regions); ++i) {
+			struct mDebuggerAccessLogRegion* region = mDebuggerAccessLogRegionListGetPointer(&logger->regions, i);
+			if (region->block && region->watchpoint >= 0) {
+				_allocBatch(region);
+			}
+		}
+#ifndef DISABLE_THREADING
+		MutexInit(&logger->batchMutex);
+		ConditionInit(&logger->batchStartCond);
+		ConditionInit(&logger->batchDoneCond);
+		logger->batchPending = false;
+		logger->batchExiting = false;
+		ThreadCreate(&logger->batchThread, _batchThread, logger);
+#endif
+		logger->batched = true;
+		return;
+	}
+
+	mDebuggerAccessLoggerFlush(logger);
+#ifndef DISABLE_THREADING
+	MutexLock(&logger->batchMutex);
+	logger->batchExiting = true;
+	ConditionWake(&logger->batchStartCond);
+	MutexUnlock(&logger->batchMutex);
+	ThreadJoin(&logger->batchThread);
+	ConditionDeinit(&logger->batchDoneCond);
+	ConditionDeinit(&logger->batchStartCond);
+	MutexDeinit(&logger->batchMutex);
+#endif
+	logger->batched = false;
+	for (i = 0; i < mDebuggerAccessLogRegionListSize(&logger->regions); ++i) {
+		_freeBatch(mDebuggerAccessLogRegionListGetPointer(&logger->regions, i));
+	}
+}
+
+void mDebuggerAccessLoggerFlush(struct mDebuggerAccessLogger* logger) {
+	if (!logger->batched || !logger->backing) {
+		return;
+	}
+#ifndef DISABLE_THREADING
+	MutexLock(&logger->batchMutex);
+	while (logger->batchPending) {
+		ConditionWait(&logger->batchDoneCond, &logger->batchMutex);
+	}
+	MutexUnlock(&logger->batchMutex);
+#endif
+	// The worker is idle now, so both halves can be merged here
+	_flushBatch(logger, !logger->batchFront);
+	_flushBatch(logger, logger->batchFront);
+	logger->backing->sync(logger->backing, logger->mapped, logger->backing->size(logger->backing));
+}
+
 static int _mDebuggerAccessLoggerWatchMemoryBlock(struct mDebuggerAccessLogger* logger, const struct mCoreMemoryBlock* block, mDebuggerAccessLogRegionFlags flags) {
+	// Remapping the file moves every block, so nothing can be left in flight
+	mDebuggerAccessLoggerFlush(logger);
+
 	if (mDebuggerAccessLogRegionListSize(&logger->regions) >= logger->mapped->header.regionCapacity) {
 		return -1;
 	}
@@ -424,6 +651,9 @@ static int _mDebuggerAccessLoggerWatchMemoryBlock(struct mDebuggerAccessLogger*
 			logger->backing->sync(logger->backing, logger->mapped, sizeof(struct mDebuggerAccessLogHeader) + logger->mapped->header.regionCapacity * sizeof(struct mDebuggerAccessLogRegionInfo));
 
 			_remapAll(logger);
+			if (logger->batched && region->batch[0].block) {
+				_allocBatch(region);
+			}
 		}
 		return i;
 	}
@@ -481,6 +711,10 @@ bool mDebuggerAccessLoggerClose(struct mDebuggerAccessLogger* logger) {
 		return true;
 	}
 	mDebuggerAccessLoggerStop(logger);
+	size_t i;
+	for (i = 0; i < mDebuggerAccessLogRegionListSize(&logger->regions); ++i) {
+		_freeBatch(mDebuggerAccessLogRegionListGetPointer(&logger->regions, i));
+	}
 	mDebuggerAccessLogRegionListClear(&logger->regions);
 	logger->backing->unmap(logger->backing, logger->mapped, logger->backing->size(logger->backing));
 	logger->mapped = NULL;
@@ -528,6 +762,7 @@ bool mDebuggerAccessLoggerCreateShadowFile(struct mDebuggerAccessLogger* logger,
 	if (vf->seek(vf, 0, SEEK_SET) < 0) {
 		return false;
 	}
+	mDebuggerAccessLoggerFlush(logger);
 	struct mCore* core = logger->d.p->core;
 	struct mDebuggerAccessLogRegion* region = mDebuggerAccessLogRegionListGetPointer(&logger->regions, regionId);
 	vf->truncate(vf, region->size);
@@ -14,7 +14,9 @@
 #include <mgba/core/timing.h>
 #include <mgba/core/version.h>
 #include <mgba/internal/debugger/parser.h>
+#include <mgba/internal/debugger/profiler.h>
 #include <mgba/internal/debugger/stack-trace.h>
+#include <mgba/internal/debugger/trace-recorder.h>
 #ifdef USE_ELF
 #include <mgba-util/elf-read.h>
 #endif
@@ -75,17 +77,27 @@ static void _dumpByte(struct CLIDebugger*, struct CLIDebugVector*);
 static void _dumpHalfword(struct CLIDebugger*, struct CLIDebugVector*);
 static void _dumpWord(struct CLIDebugger*, struct CLIDebugVector*);
 static void _events(struct CLIDebugger*, struct CLIDebugVector*);
+static void _eventStats(struct CLIDebugger*, struct CLIDebugVector*);
+static void _eventStatsReport(struct CLIDebugger*, struct CLIDebugVector*);
+static void _eventStatsStop(struct CLIDebugger*, struct CLIDebugVector*);
 static void _backtrace(struct CLIDebugger*, struct CLIDebugVector*);
 static void _finish(struct CLIDebugger*, struct CLIDebugVector*);
 static void _setStackTraceMode(struct CLIDebugger*, struct CLIDebugVector*);
 #ifdef ENABLE_VFS
 static void _loadSymbols(struct CLIDebugger*, struct CLIDebugVector*);
+static void _traceRecord(struct CLIDebugger*, struct CLIDebugVector*);
+static void _traceDump(struct CLIDebugger*, struct CLIDebugVector*);
+static void _profileDump(struct CLIDebugger*, struct CLIDebugVector*);
 #ifdef ENABLE_SCRIPTING
 static void _source(struct CLIDebugger*, struct CLIDebugVector*);
 #endif
 #endif
 static void _setSymbol(struct CLIDebugger*, struct CLIDebugVector*);
 static void _findSymbol(struct CLIDebugger*, struct CLIDebugVector*);
+static void _traceStop(struct CLIDebugger*, struct CLIDebugVector*);
+static void _profile(struct CLIDebugger*, struct CLIDebugVector*);
+static void _profileStop(struct CLIDebugger*, struct CLIDebugVector*);
+static void _profileReport(struct CLIDebugger*, struct CLIDebugVector*);
 
 static struct CLIDebuggerCommandSummary _debuggerCommands[] = {
 	{ "backtrace", _backtrace, "i", "Print backtrace of all or specified frames" },
@@ -93,6 +105,9 @@ static struct CLIDebuggerCommandSummary _debuggerCommands[] = {
 	{ "continue", _continue, "", "Continue execution" },
 	{ "delete", _clearBreakpoint, "I", "Delete a breakpoint or watchpoint" },
 	{ "disassemble", _disassemble, "Ii", "Disassemble instructions" },
+	{ "event-stats", _eventStats, "", "Start counting how each kind of event uses the scheduler" },
+	{ "event-stats-report", _eventStatsReport, "", "Print per-frame scheduler statistics for each kind of event" },
+	{ "event-stats-stop", _eventStatsStop, "", "Stop counting scheduler statistics" },
 	{ "events", _events, "", "Print list of scheduled events" },
 	{ "finish", _finish, "", "Execute until current stack frame returns" },
 	{ "help", _printHelp, "S", "Print help" },
@@ -105,6 +120,12 @@ static struct CLIDebuggerCommandSummary _debuggerCommands[] = {
 	{ "print", _print, "S+", "Print a value" },
 	{ "print/t", _printBin, "S+", "Print a value as binary" },
 	{ "print/x", _printHex, "S+", "Print a value as hexadecimal" },
+	{ "profile", _profile, "i", "Sample the program counter every so many cycles" },
+#ifdef ENABLE_VFS
+	{ "profile-dump", _profileDump, "Ss", "Write the samples to a file as folded stacks or pprof" },
+#endif
+	{ "profile-report", _profileReport, "i", "Print the functions with the most samples" },
+	{ "profile-stop", _profileStop, "", "Stop sampling the program counter" },
 	{ "quit", _quit, "", "Quit the emulator" },
 	{ "reset", _reset, "", "Reset the emulation" },
 	{ "r/1", _readByte, "I", "Read a byte from a specified offset" },
@@ -116,8 +137,13 @@ static struct CLIDebuggerCommandSummary _debuggerCommands[] = {
 #endif
 	{ "stack", _setStackTraceMode, "S", "Change the stack tracing mode" },
 	{ "status", _printStatus, "", "Print the current status" },
-	{ "symbol", _findSymbol, "I", "Find the symbol name for an address" },
+	{ "symbol", _findSymbol, "I", "Find the symbol name for an address, or the nearest one before it" },
 	{ "trace", _trace, "Is", "Trace a number of instructions" },
+#ifdef ENABLE_VFS
+	{ "trace-dump", _traceDump, "Ss", "Disassemble a binary trace into a text file" },
+	{ "trace-record", _traceRecord, "Si", "Record a binary trace of executed instructions" },
+#endif
+	{ "trace-stop", _traceStop, "", "Stop recording a binary trace" },
 	{ "w/1", _writeByte, "II", "Write a byte at a specified offset" },
 	{ "w/2", _writeHalfword, "II", "Write a halfword at a specified offset" },
 	{ "w/r", _writeRegister, "SI", "Write a register" },
@@ -879,13 +905,82 @@ static void _printStatus(struct CLIDebugger* debugger, struct CLIDebugVector* dv
 	debugger->system->printStatus(debugger->system);
 }
 
+static int _compareEvents(const void* a, const void* b) {
+	const struct mTimingEvent* eventA = *(const struct mTimingEvent* const*) a;
+	const struct mTimingEvent* eventB = *(const struct mTimingEvent* const*) b;
+	int32_t diff = eventA->when - eventB->when;
+	if (diff) {
+		return diff < 0 ? -1 : 1;
+	}
+	if (eventA->priority != eventB->priority) {
+		return eventA->priority < eventB->priority ? -1 : 1;
+	}
+	return (int32_t) (eventA->order - eventB->order) < 0 ? -1 : 1;
+}
+
 static void _events(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
 	UNUSED(dv);
 	struct mTiming* timing = debugger->d.p->core->timing;
-	struct mTimingEvent* next = timing->root;
-	for (; next; next = next->next) {
-		debugger->backend->printf(debugger->backend, "%s in %i cycles\n", next->name, mTimingUntil(timing, next));
+	if (!timing->nEvents) {
+		return;
+	}
+	struct mTimingEvent** events = malloc(sizeof(*events) * timing->nEvents);
+	memcpy(events, timing->events, sizeof(*events) * timing->nEvents);
+	qsort(events, timing->nEvents, sizeof(*events), _compareEvents);
+	size_t i;
+	for (i = 0; i < timing->nEvents; ++i) {
+		debugger->backend->printf(debugger->backend, "%s in %i cycles\n", events[i]->name, mTimingUntil(timing, events[i]));
+	}
+	free(events);
+}
+
+static void _eventStats(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
+	UNUSED(dv);
+	struct mCore* core = debugger->d.p->core;
+	if (core->timing->profile && core->timing->profile != debugger->eventStats) {
+		debugger->backend->printf(debugger->backend, "The scheduler is already being profiled.\n");
+		return;
+	}
+	if (!debugger->eventStats) {
+		// Only counting, so there's no need to read the host clock
+		debugger->eventStats = calloc(1, sizeof(*debugger->eventStats));
 	}
+	mTimingProfileReset(debugger->eventStats);
+	debugger->eventStatsFrame = core->frameCounter(core);
+	core->timing->profile = debugger->eventStats;
+	debugger->backend->printf(debugger->backend, "Counting scheduler events\n");
+}
+
+static void _eventStatsReport(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
+	UNUSED(dv);
+	struct mCore* core = debugger->d.p->core;
+	struct mTimingProfile* profile = debugger->eventStats;
+	if (!profile || !profile->nEntries) {
+		debugger->backend->printf(debugger->backend, "No scheduler events have been counted.\n");
+		return;
+	}
+	uint32_t frames = core->frameCounter(core) - debugger->eventStatsFrame;
+	// Before the first frame ends, the totals are as good a figure as any
+	double divisor = frames ? frames : 1;
+	debugger->backend->printf(debugger->backend, "%u frames\n", frames);
+	debugger->backend->printf(debugger->backend, "%-24s %12s %10s %12s %12s\n", "event", "fires/frame", "avg late", "resched/frm", "desched/frm");
+	size_t i;
+	for (i = 0; i < profile->nEntries; ++i) {
+		const struct mTimingProfileEntry* entry = &profile->entries[i];
+		debugger->backend->printf(debugger->backend, "%-24s %12.2f %10.2f %12.2f %12.2f\n", entry->name ? entry->name : "Other",
+		                          entry->count / divisor, entry->count ? (double) entry->lateness / entry->count : 0.,
+		                          entry->reschedules / divisor, entry->deschedules / divisor);
+	}
+}
+
+static void _eventStatsStop(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
+	UNUSED(dv);
+	struct mTiming* timing = debugger->d.p->core->timing;
+	if (!debugger->eventStats || timing->profile != debugger->eventStats) {
+		debugger->backend->printf(debugger->backend, "Scheduler events are not being counted.\n");
+		return;
+	}
+	timing->profile = NULL;
 }
 
 struct CLIDebugVector* CLIDVParse(struct CLIDebugger* debugger, const char* string, size_t length) {
@@ -1217,6 +1312,26 @@ static void _cliDebuggerDeinit(struct mDebuggerModule* debugger) {
 		cliDebugger->traceVf->close(cliDebugger->traceVf);
 		cliDebugger->traceVf = NULL;
 	}
+	if (cliDebugger->traceRecorder) {
+		mDebuggerDetachModule(debugger->p, &cliDebugger->traceRecorder->d);
+		mDebuggerTraceRecorderDeinit(cliDebugger->traceRecorder);
+		free(cliDebugger->traceRecorder);
+		cliDebugger->traceRecorder = NULL;
+	}
+	if (cliDebugger->profiler) {
+		mDebuggerDetachModule(debugger->p, &cliDebugger->profiler->d);
+		mDebuggerProfilerDeinit(cliDebugger->profiler);
+		free(cliDebugger->profiler);
+		cliDebugger->profiler = NULL;
+	}
+	if (cliDebugger->eventStats) {
+		struct mTiming* timing = debugger->p->core->timing;
+		if (timing->profile == cliDebugger->eventStats) {
+			timing->profile = NULL;
+		}
+		free(cliDebugger->eventStats);
+		cliDebugger->eventStats = NULL;
+	}
 
 	if (cliDebugger->system) {
 		if (cliDebugger->system->deinit) {
@@ -1265,6 +1380,9 @@ void CLIDebuggerCreate(struct CLIDebugger* debugger) {
 
 	debugger->system = NULL;
 	debugger->backend = NULL;
+	debugger->traceRecorder = NULL;
+	debugger->profiler = NULL;
+	debugger->eventStats = NULL;
 }
 
 void CLIDebuggerAttachSystem(struct CLIDebugger* debugger, struct CLIDebuggerSystem* system) {
@@ -1379,6 +1497,7 @@ static void _setStackTraceMode(struct CLIDebugger* debugger, struct CLIDebugVect
 	if (!dv) {
 		debugger->backend->printf(debugger->backend, "off           disable stack tracing (default)\n");
 		debugger->backend->printf(debugger->backend, "trace-only    enable stack tracing\n");
+		debugger->backend->printf(debugger->backend, "trace-light   enable stack tracing without saving registers\n");
 		debugger->backend->printf(debugger->backend, "break-call    break on function calls\n");
 		debugger->backend->printf(debugger->backend, "break-return  break on function returns\n");
 		debugger->backend->printf(debugger->backend, "break-all     break on function calls and returns\n");
@@ -1389,10 +1508,15 @@ static void _setStackTraceMode(struct CLIDebugger* debugger, struct CLIDebugVect
 		return;
 	}
 	struct mDebuggerPlatform* platform = debugger->d.p->platform;
+	struct mStackTrace* stack = &debugger->d.p->stackTrace;
+	mStackTraceSetSaveRegisters(stack, true);
 	if (strcmp(dv->charValue, "off") == 0) {
 		platform->setStackTraceMode(platform, STACK_TRACE_DISABLED);
 	} else if (strcmp(dv->charValue, "trace-only") == 0) {
 		platform->setStackTraceMode(platform, STACK_TRACE_ENABLED);
+	} else if (strcmp(dv->charValue, "trace-light") == 0) {
+		mStackTraceSetSaveRegisters(stack, false);
+		platform->setStackTraceMode(platform, STACK_TRACE_ENABLED);
 	} else if (strcmp(dv->charValue, "break-call") == 0) {
 		platform->setStackTraceMode(platform, STACK_TRACE_BREAK_ON_CALL);
 	} else if (strcmp(dv->charValue, "break-return") == 0) {
@@ -1436,8 +1560,206 @@ static void _loadSymbols(struct CLIDebugger* debugger, struct CLIDebugVector* dv
 	}
 	vf->close(vf);
 }
+
+static void _traceRecord(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
+	if (!dv) {
+		debugger->backend->printf(debugger->backend, "%s\n", ERROR_MISSING_ARGS);
+		return;
+	}
+	if (dv->type != CLIDV_CHAR_TYPE || (dv->next && (dv->next->type != CLIDV_INT_TYPE || dv->next->intValue <= 0))) {
+		debugger->backend->printf(debugger->backend, "%s\n", ERROR_INVALID_ARGS);
+		return;
+	}
+	if (!debugger->d.p->platform->nextTraceEntry) {
+		debugger->backend->printf(debugger->backend, "Trace recording is not supported by this platform.\n");
+		return;
+	}
+	struct VFile* vf = VFileOpen(dv->charValue, O_CREAT | O_TRUNC | O_RDWR);
+	if (!vf) {
+		debugger->backend->printf(debugger->backend, "%s\n", "Could not open trace file");
+		return;
+	}
+	if (!debugger->traceRecorder) {
+		debugger->traceRecorder = malloc(sizeof(*debugger->traceRecorder));
+		mDebuggerTraceRecorderInit(debugger->traceRecorder);
+		mDebuggerAttachModule(debugger->d.p, &debugger->traceRecorder->d);
+	}
+	uint32_t capacity = dv->next ? dv->next->intValue : 0;
+	if (!mDebuggerTraceRecorderOpen(debugger->traceRecorder, vf, O_CREAT | O_TRUNC, capacity)) {
+		vf->close(vf);
+		debugger->backend->printf(debugger->backend, "%s\n", "Could not create trace file");
+		return;
+	}
+	mDebuggerTraceRecorderStart(debugger->traceRecorder);
+	debugger->backend->printf(debugger->backend, "Recording up to %u instructions\n", debugger->traceRecorder->capacity);
+}
+
+static void _traceDump(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
+	if (!dv) {
+		debugger->backend->printf(debugger->backend, "%s\n", ERROR_MISSING_ARGS);
+		return;
+	}
+	if (dv->type != CLIDV_CHAR_TYPE || (dv->next && dv->next->type != CLIDV_CHAR_TYPE)) {
+		debugger->backend->printf(debugger->backend, "%s\n", ERROR_INVALID_ARGS);
+		return;
+	}
+
+	// Traces can be loaded from a file or read back from the one currently being recorded
+	struct mDebuggerTraceRecorder offline;
+	struct mDebuggerTraceRecorder* recorder = debugger->traceRecorder;
+	if (dv->next) {
+		struct VFile* in = VFileOpen(dv->next->charValue, O_RDWR);
+		if (!in) {
+			debugger->backend->printf(debugger->backend, "%s\n", "Could not open trace file");
+			return;
+		}
+		mDebuggerTraceRecorderInit(&offline);
+		offline.d.p = debugger->d.p;
+		if (!mDebuggerTraceRecorderOpen(&offline, in, 0, 0)) {
+			in->close(in);
+			debugger->backend->printf(debugger->backend, "%s\n", "Not a trace file for this platform");
+			return;
+		}
+		recorder = &offline;
+	} else if (!recorder || !recorder->backing) {
+		debugger->backend->printf(debugger->backend, "No trace is being recorded.\n");
+		return;
+	}
+
+	struct VFile* out = VFileOpen(dv->charValue, O_CREAT | O_TRUNC | O_WRONLY);
+	if (out) {
+		if (!mDebuggerTraceRecorderDisassemble(recorder, out)) {
+			debugger->backend->printf(debugger->backend, "%s\n", "Could not write trace");
+		}
+		out->close(out);
+	} else {
+		debugger->backend->printf(debugger->backend, "%s\n", "Could not open output file");
+	}
+	if (recorder == &offline) {
+		mDebuggerTraceRecorderDeinit(&offline);
+	}
+}
+
+static void _profileDump(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
+	if (!dv) {
+		debugger->backend->printf(debugger->backend, "%s\n", ERROR_MISSING_ARGS);
+		return;
+	}
+	if (dv->type != CLIDV_CHAR_TYPE || (dv->next && dv->next->type != CLIDV_CHAR_TYPE)) {
+		debugger->backend->printf(debugger->backend, "%s\n", ERROR_INVALID_ARGS);
+		return;
+	}
+	bool pprof = false;
+	if (dv->next) {
+		if (strcmp(dv->next->charValue, "pprof") == 0) {
+			pprof = true;
+		} else if (strcmp(dv->next->charValue, "folded") != 0) {
+			debugger->backend->printf(debugger->backend, "Unknown format. Use folded or pprof.\n");
+			return;
+		}
+	}
+	if (!debugger->profiler || !debugger->profiler->nSamples) {
+		debugger->backend->printf(debugger->backend, "No samples have been taken.\n");
+		return;
+	}
+
+	struct VFile* out = VFileOpen(dv->charValue, O_CREAT | O_TRUNC | O_WRONLY);
+	if (!out) {
+		debugger->backend->printf(debugger->backend, "%s\n", "Could not open output file");
+		return;
+	}
+	bool success;
+	if (pprof) {
+		success = mDebuggerProfilerWritePprof(debugger->profiler, out);
+	} else {
+		success = mDebuggerProfilerWriteFolded(debugger->profiler, out);
+	}
+	if (!success) {
+		debugger->backend->printf(debugger->backend, "%s\n", "Could not write profile");
+	}
+	out->close(out);
+}
 #endif
 
+static void _traceStop(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
+	UNUSED(dv);
+	if (!debugger->traceRecorder || !debugger->traceRecorder->backing) {
+		debugger->backend->printf(debugger->backend, "No trace is being recorded.\n");
+		return;
+	}
+	uint64_t count = debugger->traceRecorder->count;
+	size_t size = mDebuggerTraceRecorderSize(debugger->traceRecorder);
+	mDebuggerTraceRecorderClose(debugger->traceRecorder);
+	debugger->backend->printf(debugger->backend, "Recorded %" PRIu64 " instructions, kept the last %" PRIz "u\n", count, size);
+}
+
+static void _profile(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
+	if (dv && (dv->type != CLIDV_INT_TYPE || dv->intValue <= 0)) {
+		debugger->backend->printf(debugger->backend, "%s\n", ERROR_INVALID_ARGS);
+		return;
+	}
+	if (!debugger->d.p->platform->nextTraceEntry) {
+		debugger->backend->printf(debugger->backend, "Profiling is not supported by this platform.\n");
+		return;
+	}
+	if (!debugger->profiler) {
+		debugger->profiler = malloc(sizeof(*debugger->profiler));
+		mDebuggerProfilerInit(debugger->profiler);
+		mDebuggerAttachModule(debugger->d.p, &debugger->profiler->d);
+	}
+	mDebuggerProfilerClear(debugger->profiler);
+	mDebuggerProfilerStart(debugger->profiler, dv ? dv->intValue : 0);
+	debugger->backend->printf(debugger->backend, "Sampling every %i cycles\n", debugger->profiler->period);
+	struct mDebuggerPlatform* platform = debugger->d.p->platform;
+	if (platform->getStackTraceMode && platform->getStackTraceMode(platform) == STACK_TRACE_DISABLED) {
+		debugger->backend->printf(debugger->backend, "Stack tracing is disabled, so callers will not be recorded.\n");
+	}
+}
+
+static void _profileStop(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
+	UNUSED(dv);
+	if (!debugger->profiler || !debugger->profiler->running) {
+		debugger->backend->printf(debugger->backend, "The profiler is not running.\n");
+		return;
+	}
+	mDebuggerProfilerStop(debugger->profiler);
+	debugger->backend->printf(debugger->backend, "Took %" PRIu64 " samples\n", debugger->profiler->nSamples);
+}
+
+static void _profileReport(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
+	if (dv && (dv->type != CLIDV_INT_TYPE || dv->intValue <= 0)) {
+		debugger->backend->printf(debugger->backend, "%s\n", ERROR_INVALID_ARGS);
+		return;
+	}
+	if (!debugger->profiler || !debugger->profiler->nSamples) {
+		debugger->backend->printf(debugger->backend, "No samples have been taken.\n");
+		return;
+	}
+	struct mDebuggerProfilerEntryList entries;
+	mDebuggerProfilerEntryListInit(&entries, 0);
+	mDebuggerProfilerHistogram(debugger->profiler, &entries);
+
+	uint64_t nSamples = debugger->profiler->nSamples;
+	size_t count = mDebuggerProfilerEntryListSize(&entries);
+	if (dv && (size_t) dv->intValue < count) {
+		count = dv->intValue;
+	}
+	debugger->backend->printf(debugger->backend, "%" PRIu64 " samples\n", nSamples);
+	debugger->backend->printf(debugger->backend, "  self%%    samples  total%%  function\n");
+	size_t i;
+	for (i = 0; i < count; ++i) {
+		const struct mDebuggerProfilerEntry* entry = mDebuggerProfilerEntryListGetPointer(&entries, i);
+		debugger->backend->printf(debugger->backend, "%6.2f%% %10" PRIu64 " %6.2f%%  ",
+		                          entry->self * 100.0 / nSamples, entry->self, entry->total * 100.0 / nSamples);
+		if (entry->name) {
+			debugger->backend->printf(debugger->backend, "%s (%08X)\n", entry->name, entry->address);
+		} else {
+			debugger->backend->printf(debugger->backend, "%08X\n", entry->address);
+		}
+	}
+	mDebuggerProfilerEntryListDeinit(&entries);
+}
+
 static void _setSymbol(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
 	struct mDebuggerSymbols* symbolTable = debugger->d.p->core->symbolTable;
 	if (!symbolTable) {
@@ -1469,13 +1791,21 @@ static void _findSymbol(struct CLIDebugger* debugger, struct CLIDebugVector* dv)
 		debugger->backend->printf(debugger->backend, "%s\n", ERROR_INVALID_ARGS);
 		return;
 	}
+	uint32_t offset = 0;
 	const char* name = mDebuggerSymbolReverseLookup(symbolTable, dv->intValue, dv->segmentValue);
+	if (!name) {
+		name = mDebuggerSymbolNearest(symbolTable, dv->intValue, dv->segmentValue, &offset);
+	}
 	if (name) {
 		if (dv->segmentValue >= 0) {
-			debugger->backend->printf(debugger->backend, " 0x%02X:%08X = %s\n", dv->segmentValue, dv->intValue, name);
+			debugger->backend->printf(debugger->backend, " 0x%02X:%08X = %s", dv->segmentValue, dv->intValue, name);
 		} else {
-			debugger->backend->printf(debugger->backend, " 0x%08X = %s\n", dv->intValue, name);
+			debugger->backend->printf(debugger->backend, " 0x%08X = %s", dv->intValue, name);
 		}
+		if (offset) {
+			debugger->backend->printf(debugger->backend, "+0x%X", offset);
+		}
+		debugger->backend->printf(debugger->backend, "\n");
 	} else {
 		debugger->backend->printf(debugger->backend, "Not found.\n");
 	}
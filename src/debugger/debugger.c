@@ -8,6 +8,7 @@
 #include <mgba/core/core.h>
 
 #include <mgba/internal/debugger/cli-debugger.h>
+#include <mgba/internal/debugger/parser.h>
 #include <mgba/internal/debugger/symbols.h>
 
 #ifdef ENABLE_GDB_STUB
@@ -63,6 +64,8 @@ struct mDebuggerModule* mDebuggerCreateModule(enum mDebuggerType type, struct mC
 #endif
 	case DEBUGGER_NONE:
 	case DEBUGGER_ACCESS_LOGGER:
+	case DEBUGGER_TRACE_RECORDER:
+	case DEBUGGER_PROFILER:
 	case DEBUGGER_CUSTOM:
 	case DEBUGGER_MAX:
 		free(debugger);
@@ -287,8 +290,9 @@ static void _mDebuggerInit(void* cpu, struct mCPUComponent* component) {
 static void _mDebuggerDeinit(struct mCPUComponent* component) {
 	struct mDebugger* debugger = (struct mDebugger*) component;
 	debugger->state = DEBUGGER_SHUTDOWN;
+	// Walk backwards so modules can detach modules they attached themselves
 	size_t i;
-	for (i = 0; i < mDebuggerModuleListSize(&debugger->modules); ++i) {
+	for (i = mDebuggerModuleListSize(&debugger->modules); i--;) {
 		struct mDebuggerModule* module = *mDebuggerModuleListGetPointer(&debugger->modules, i);
 		if (module->deinit) {
 			module->deinit(module);
@@ -316,6 +320,23 @@ bool mDebuggerLookupIdentifier(struct mDebugger* debugger, const char* name, int
 	return false;
 }
 
+bool mDebuggerTestCondition(struct mDebugger* debugger, struct ParseTree* condition, const struct ParseProgram* compiled) {
+	int32_t value;
+	int segment;
+	if (compiled) {
+		if (!mDebuggerEvaluateParseProgram(debugger, compiled, &value, &segment)) {
+			return false;
+		}
+	} else if (condition) {
+		if (!mDebuggerEvaluateParseTree(debugger, condition, &value, &segment)) {
+			return false;
+		}
+	} else {
+		return true;
+	}
+	return value || segment >= 0;
+}
+
 void mDebuggerModuleSetNeedsCallback(struct mDebuggerModule* debugger) {
 	debugger->needsCallback = true;
 	mDebuggerUpdatePaused(debugger->p);
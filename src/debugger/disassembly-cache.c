@@ -0,0 +1,70 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/internal/debugger/disassembly-cache.h>
+
+#include <mgba/internal/debugger/symbols.h>
+#include <mgba-util/string.h>
+
+static struct mDisassemblyCacheEntry* _entry(struct mDisassemblyCache* cache, uint32_t address, uint32_t opcode) {
+	uint32_t hash = (address ^ (opcode * 0x85EBCA6B)) * 0x9E3779B1;
+	return &cache->entries[hash >> (32 - mDISASSEMBLY_CACHE_BITS)];
+}
+
+void mDisassemblyCacheInit(struct mDisassemblyCache* cache) {
+	cache->entries = NULL;
+	cache->generation = 1;
+	cache->symbols = NULL;
+	cache->symbolsGeneration = 0;
+}
+
+void mDisassemblyCacheDeinit(struct mDisassemblyCache* cache) {
+	free(cache->entries);
+	cache->entries = NULL;
+}
+
+void mDisassemblyCacheInvalidate(struct mDisassemblyCache* cache) {
+	++cache->generation;
+	if (!cache->generation) {
+		// Entries are only valid with a nonzero generation, so start over on wraparound
+		if (cache->entries) {
+			memset(cache->entries, 0, sizeof(*cache->entries) * mDISASSEMBLY_CACHE_SIZE);
+		}
+		cache->generation = 1;
+	}
+}
+
+void mDisassemblyCacheCheckSymbols(struct mDisassemblyCache* cache, const struct mDebuggerSymbols* symbols) {
+	uint32_t generation = symbols ? mDebuggerSymbolTableGeneration(symbols) : 0;
+	if (symbols == cache->symbols && generation == cache->symbolsGeneration) {
+		return;
+	}
+	cache->symbols = symbols;
+	cache->symbolsGeneration = generation;
+	mDisassemblyCacheInvalidate(cache);
+}
+
+const char* mDisassemblyCacheLookup(struct mDisassemblyCache* cache, uint32_t address, uint32_t opcode, uint32_t flags) {
+	if (!cache->entries) {
+		return NULL;
+	}
+	struct mDisassemblyCacheEntry* entry = _entry(cache, address, opcode);
+	if (entry->generation != cache->generation || entry->address != address || entry->opcode != opcode || entry->flags != flags) {
+		return NULL;
+	}
+	return entry->text;
+}
+
+void mDisassemblyCacheStore(struct mDisassemblyCache* cache, uint32_t address, uint32_t opcode, uint32_t flags, const char* text) {
+	if (!cache->entries) {
+		cache->entries = calloc(mDISASSEMBLY_CACHE_SIZE, sizeof(*cache->entries));
+	}
+	struct mDisassemblyCacheEntry* entry = _entry(cache, address, opcode);
+	entry->address = address;
+	entry->opcode = opcode;
+	entry->flags = flags;
+	entry->generation = cache->generation;
+	strlcpy(entry->text, text, sizeof(entry->text));
+}
@@ -7,9 +7,11 @@
 
 #include <mgba/core/core.h>
 #include <mgba/internal/arm/debugger/debugger.h>
+#include <mgba/internal/debugger/trace-recorder.h>
 #include <mgba/internal/arm/isa-inlines.h>
 #include <mgba/internal/gba/memory.h>
 #include <mgba-util/string.h>
+#include <mgba-util/vfs.h>
 
 #include <signal.h>
 
@@ -63,16 +65,24 @@ static const char* TARGET_XML = "<target version=\"1.0\">"
                                 "</target>";
 
 static void _sendMessage(struct GDBStub* stub);
+static void _invalidateCache(struct GDBStub* stub);
 
 static void _gdbStubDeinit(struct mDebuggerModule* debugger) {
 	struct GDBStub* stub = (struct GDBStub*) debugger;
 	if (!SOCKET_FAILED(stub->socket)) {
 		GDBStubShutdown(stub);
 	}
+	if (stub->traceRecorder) {
+		mDebuggerDetachModule(debugger->p, &stub->traceRecorder->d);
+		mDebuggerTraceRecorderDeinit(stub->traceRecorder);
+		free(stub->traceRecorder);
+		stub->traceRecorder = NULL;
+	}
 }
 
 static void _gdbStubEntered(struct mDebuggerModule* debugger, enum mDebuggerEntryReason reason, struct mDebuggerEntryInfo* info) {
 	struct GDBStub* stub = (struct GDBStub*) debugger;
+	_invalidateCache(stub);
 	switch (reason) {
 	case DEBUGGER_ENTER_MANUAL:
 		snprintf(stub->outgoing, GDB_STUB_MAX_LINE - 4, "S%02x", SIGINT);
@@ -132,8 +142,17 @@ static void _gdbStubPoll(struct mDebuggerModule* debugger) {
 	if (stub->untilPoll > 0) {
 		return;
 	}
-	stub->untilPoll = GDB_STUB_INTERVAL;
-	GDBStubUpdate(stub, 0);
+	// Back off while the client is quiet so a running game isn't taxed by a syscall every few
+	// instructions, but drop back to the short interval as soon as traffic shows up again
+	if (GDBStubUpdate(stub, 0)) {
+		stub->pollInterval = GDB_STUB_INTERVAL;
+	} else {
+		stub->pollInterval *= 2;
+	}
+	if (stub->pollInterval > stub->maxPollInterval) {
+		stub->pollInterval = stub->maxPollInterval;
+	}
+	stub->untilPoll = stub->pollInterval;
 }
 
 static void _gdbStubWait(struct mDebuggerModule* debugger, int32_t timeoutMs) {
@@ -146,15 +165,44 @@ static void _gdbStubUpdate(struct mDebuggerModule* debugger) {
 	GDBStubUpdate(stub, 0);
 }
 
+static void _flush(struct GDBStub* stub) {
+	if (!stub->sendLength) {
+		return;
+	}
+	if (!SOCKET_FAILED(stub->connection)) {
+		SocketSend(stub->connection, stub->sendBuffer, stub->sendLength);
+	}
+	stub->sendLength = 0;
+}
+
+static void _queueSend(struct GDBStub* stub, const char* data, size_t size) {
+	if (stub->sendLength + size > sizeof(stub->sendBuffer)) {
+		_flush(stub);
+	}
+	memcpy(&stub->sendBuffer[stub->sendLength], data, size);
+	stub->sendLength += size;
+	if (!stub->deferSend) {
+		_flush(stub);
+	}
+}
+
 static void _ack(struct GDBStub* stub) {
 	char ack = '+';
-	SocketSend(stub->connection, &ack, 1);
+	_queueSend(stub, &ack, 1);
 }
 
 static void _nak(struct GDBStub* stub) {
 	char nak = '-';
 	mLOG(DEBUGGER, WARN, "Packet error");
-	SocketSend(stub->connection, &nak, 1);
+	_queueSend(stub, &nak, 1);
+}
+
+static void _invalidateCache(struct GDBStub* stub) {
+	stub->registersCached = false;
+	size_t i;
+	for (i = 0; i < GDB_STUB_CACHE_LINES; ++i) {
+		stub->memoryCache[i].valid = false;
+	}
 }
 
 static uint32_t _hex2int(const char* hex, int maxDigits) {
@@ -233,7 +281,7 @@ static void _sendMessage(struct GDBStub* stub) {
 	_int2hex8(checksum, &stub->outgoing[i + 1]);
 	stub->outgoing[i + 3] = 0;
 	mLOG(DEBUGGER, DEBUG, "> %s", stub->outgoing);
-	SocketSend(stub->connection, stub->outgoing, i + 3);
+	_queueSend(stub, stub->outgoing, i + 3);
 }
 
 static void _error(struct GDBStub* stub, enum GDBError error) {
@@ -247,7 +295,9 @@ static void _writeHostInfo(struct GDBStub* stub) {
 }
 
 static void _continue(struct GDBStub* stub, const char* message) {
+	_invalidateCache(stub);
 	stub->untilPoll = GDB_STUB_INTERVAL;
+	stub->pollInterval = GDB_STUB_INTERVAL;
 	stub->d.isPaused = false;
 	mDebuggerModuleSetNeedsCallback(&stub->d);
 	// TODO: parse message
@@ -258,6 +308,7 @@ static void _step(struct GDBStub* stub, const char* message) {
 	const struct ARMCore* cpu = stub->d.p->core->cpu;
 	const int32_t pc = cpu->gprs[ARM_PC];
 
+	_invalidateCache(stub);
 	stub->d.p->core->step(stub->d.p->core);
 
 	if (pc >= GBA_SIZE_BIOS && cpu->gprs[ARM_PC] < GBA_SIZE_BIOS) {
@@ -290,11 +341,12 @@ static void _writeMemoryBinary(struct GDBStub* stub, const char* message) {
 	uint32_t size = _readHex(readAddress, &i);
 	readAddress += i + 1;
 
-	if (size > 512) {
+	if (size > GDB_STUB_MAX_TRANSFER) {
 		_error(stub, GDB_BAD_ARGUMENTS);
 		return;
 	}
 
+	_invalidateCache(stub);
 	struct ARMCore* cpu = stub->d.p->core->cpu;
 	for (i = 0; i < size; i++) {
 		uint8_t byte = *readAddress;
@@ -324,11 +376,12 @@ static void _writeMemory(struct GDBStub* stub, const char* message) {
 	uint32_t size = _readHex(readAddress, &i);
 	readAddress += i + 1;
 
-	if (size > 512) {
+	if (size > GDB_STUB_MAX_TRANSFER) {
 		_error(stub, GDB_BAD_ARGUMENTS);
 		return;
 	}
 
+	_invalidateCache(stub);
 	struct ARMCore* cpu = stub->d.p->core->cpu;
 	for (i = 0; i < size; ++i, readAddress += 2) {
 		uint8_t byte = _hex2int(readAddress, 2);
@@ -339,20 +392,38 @@ static void _writeMemory(struct GDBStub* stub, const char* message) {
 	_sendMessage(stub);
 }
 
+static uint8_t _readCachedByte(struct GDBStub* stub, uint32_t address) {
+	struct ARMCore* cpu = stub->d.p->core->cpu;
+	if ((address >> BASE_OFFSET) == GBA_REGION_IO) {
+		// Don't read ahead into registers that might have side effects
+		return cpu->memory.load8(cpu, address, 0);
+	}
+	uint32_t base = address & ~(GDB_STUB_CACHE_LINE_SIZE - 1);
+	struct GDBStubCacheLine* line = &stub->memoryCache[(base / GDB_STUB_CACHE_LINE_SIZE) % GDB_STUB_CACHE_LINES];
+	if (!line->valid || line->address != base) {
+		size_t i;
+		for (i = 0; i < GDB_STUB_CACHE_LINE_SIZE; ++i) {
+			line->data[i] = cpu->memory.load8(cpu, base + i, 0);
+		}
+		line->address = base;
+		line->valid = true;
+	}
+	return line->data[address - base];
+}
+
 static void _readMemory(struct GDBStub* stub, const char* message) {
 	const char* readAddress = message;
 	unsigned i = 0;
 	uint32_t address = _readHex(readAddress, &i);
 	readAddress += i + 1;
 	uint32_t size = _readHex(readAddress, &i);
-	if (size > 512) {
+	if (size > GDB_STUB_MAX_TRANSFER) {
 		_error(stub, GDB_BAD_ARGUMENTS);
 		return;
 	}
-	struct ARMCore* cpu = stub->d.p->core->cpu;
 	int writeAddress = 0;
 	for (i = 0; i < size; ++i, writeAddress += 2) {
-		uint8_t byte = cpu->memory.load8(cpu, address + i, 0);
+		uint8_t byte = _readCachedByte(stub, address + i);
 		_int2hex8(byte, &stub->outgoing[writeAddress]);
 	}
 	stub->outgoing[writeAddress] = 0;
@@ -363,6 +434,7 @@ static void _writeGPRs(struct GDBStub* stub, const char* message) {
 	struct ARMCore* cpu = stub->d.p->core->cpu;
 	const char* readAddress = message;
 
+	_invalidateCache(stub);
 	int r;
 	for (r = 0; r <= ARM_PC; ++r) {
 		cpu->gprs[r] = _hex2int(readAddress, 8);
@@ -382,26 +454,29 @@ static int32_t _readPC(struct ARMCore* cpu) {
 	return cpu->gprs[ARM_PC] - (cpu->cpsr.t ? WORD_SIZE_THUMB : WORD_SIZE_ARM);
 }
 
+static const uint32_t* _cachedRegisters(struct GDBStub* stub) {
+	if (!stub->registersCached) {
+		struct ARMCore* cpu = stub->d.p->core->cpu;
+		memcpy(stub->registerCache, cpu->gprs, ARM_PC * sizeof(cpu->gprs[0]));
+		stub->registerCache[ARM_PC] = _readPC(cpu);
+		stub->registerCache[ARM_PC + 1] = cpu->cpsr.packed;
+		stub->registersCached = true;
+	}
+	return stub->registerCache;
+}
+
 static void _readGPRs(struct GDBStub* stub, const char* message) {
-	struct ARMCore* cpu = stub->d.p->core->cpu;
 	UNUSED(message);
+	const uint32_t* registers = _cachedRegisters(stub);
 	int r;
 	int i = 0;
 
-	// General purpose registers
-	for (r = 0; r < ARM_PC; ++r) {
-		_int2hex32(cpu->gprs[r], &stub->outgoing[i]);
+	// General purpose registers, program counter and CPU status
+	for (r = 0; r < GDB_STUB_CACHED_REGISTERS; ++r) {
+		_int2hex32(registers[r], &stub->outgoing[i]);
 		i += 8;
 	}
 
-	// Program counter
-	_int2hex32(_readPC(cpu), &stub->outgoing[i]);
-	i += 8;
-
-	// CPU status
-	_int2hex32(cpu->cpsr.packed, &stub->outgoing[i]);
-	i += 8;
-
 	stub->outgoing[i] = 0;
 	_sendMessage(stub);
 }
@@ -418,6 +493,7 @@ static void _writeRegister(struct GDBStub* stub, const char* message) {
 
 	LOAD_32BE(value, 0, &value);
 
+	_invalidateCache(stub);
 	if (reg <= ARM_PC) {
 		cpu->gprs[reg] = value;
 		if (reg == ARM_PC) {
@@ -440,17 +516,15 @@ static void _writeRegister(struct GDBStub* stub, const char* message) {
 }
 
 static void _readRegister(struct GDBStub* stub, const char* message) {
-	struct ARMCore* cpu = stub->d.p->core->cpu;
 	const char* readAddress = message;
 	unsigned i = 0;
 	uint32_t reg = _readHex(readAddress, &i);
+	const uint32_t* registers = _cachedRegisters(stub);
 	uint32_t value;
-	if (reg < ARM_PC) {
-		value = cpu->gprs[reg];
-	} else if (reg == ARM_PC) {
-		value = _readPC(cpu);
+	if (reg <= ARM_PC) {
+		value = registers[reg];
 	} else if (reg == 0x19) {
-		value = cpu->cpsr.packed;
+		value = registers[ARM_PC + 1];
 	} else {
 		stub->outgoing[0] = '\0';
 		_sendMessage(stub);
@@ -487,7 +561,9 @@ static void _processQSupportedCommand(struct GDBStub* stub, const char* message)
 		}
 		message = end + 1;
 	}
-	strncpy(stub->outgoing, "swbreak+;hwbreak+;qXfer:features:read+;qXfer:memory-map:read+;QStartNoAckMode+", GDB_STUB_MAX_LINE - 4);
+	// Advertising the packet size lets the client fetch memory and qXfer documents in as few
+	// round trips as the line buffer allows
+	snprintf(stub->outgoing, GDB_STUB_MAX_LINE - 4, "PacketSize=%x;swbreak+;hwbreak+;qXfer:features:read+;qXfer:memory-map:read+;QStartNoAckMode+", GDB_STUB_MAX_TRANSFER);
 }
 
 static void _processQXferCommand(struct GDBStub* stub, const char* params, const char* data) {
@@ -541,12 +617,91 @@ static void _generateMemoryMapXml(struct GDBStub* stub, char* memoryMap) {
 	strncpy(&memoryMap[index], "</memory-map>", amountLeft);
 }
 
+static bool _traceCommand(struct GDBStub* stub, char* command) {
+	char* args = strchr(command, ' ');
+	if (args) {
+		*args = '\0';
+		++args;
+	}
+	char* extra = args ? strchr(args, ' ') : NULL;
+	if (extra) {
+		*extra = '\0';
+		++extra;
+	}
+
+	if (!strcmp(command, "trace-stop")) {
+		if (!stub->traceRecorder || !stub->traceRecorder->backing) {
+			return false;
+		}
+		return mDebuggerTraceRecorderClose(stub->traceRecorder);
+	}
+	if (!args || !args[0]) {
+		return false;
+	}
+#ifdef ENABLE_VFS
+	if (!strcmp(command, "trace-record")) {
+		if (!stub->d.p->platform->nextTraceEntry) {
+			return false;
+		}
+		uint32_t capacity = extra ? strtoul(extra, NULL, 0) : 0;
+		struct VFile* vf = VFileOpen(args, O_CREAT | O_TRUNC | O_RDWR);
+		if (!vf) {
+			return false;
+		}
+		if (!stub->traceRecorder) {
+			stub->traceRecorder = malloc(sizeof(*stub->traceRecorder));
+			mDebuggerTraceRecorderInit(stub->traceRecorder);
+			mDebuggerAttachModule(stub->d.p, &stub->traceRecorder->d);
+		}
+		if (!mDebuggerTraceRecorderOpen(stub->traceRecorder, vf, O_CREAT | O_TRUNC, capacity)) {
+			vf->close(vf);
+			return false;
+		}
+		return mDebuggerTraceRecorderStart(stub->traceRecorder);
+	}
+	if (!strcmp(command, "trace-dump")) {
+		if (!stub->traceRecorder || !stub->traceRecorder->backing) {
+			return false;
+		}
+		struct VFile* out = VFileOpen(args, O_CREAT | O_TRUNC | O_WRONLY);
+		if (!out) {
+			return false;
+		}
+		bool success = mDebuggerTraceRecorderDisassemble(stub->traceRecorder, out);
+		out->close(out);
+		return success;
+	}
+#endif
+	return false;
+}
+
+static void _processQRcmdCommand(struct GDBStub* stub, const char* message) {
+	// The monitor command is sent hex-encoded
+	char command[GDB_STUB_MAX_LINE / 2];
+	size_t i;
+	for (i = 0; i < sizeof(command) - 1 && message[i * 2] && message[i * 2] != '#'; ++i) {
+		command[i] = _hex2int(&message[i * 2], 2);
+	}
+	command[i] = '\0';
+
+	if (_traceCommand(stub, command)) {
+		strncpy(stub->outgoing, "OK", GDB_STUB_MAX_LINE - 4);
+		_sendMessage(stub);
+	} else {
+		_error(stub, GDB_BAD_ARGUMENTS);
+	}
+}
+
 static void _processQReadCommand(struct GDBStub* stub, const char* message) {
 	stub->outgoing[0] = '\0';
 	if (!strncmp("HostInfo#", message, 9)) {
 		_writeHostInfo(stub);
 		return;
 	}
+	if (!strncmp("Rcmd,", message, 5)) {
+		_processQRcmdCommand(stub, message + 5);
+		return;
+	}
 	if (!strncmp("Attached#", message, 9)) {
 		strncpy(stub->outgoing, "1", GDB_STUB_MAX_LINE - 4);
 	} else if (!strncmp("VAttachOrWaitSupported#", message, 23)) {
@@ -587,7 +742,24 @@ static void _processVWriteCommand(struct GDBStub* stub, const char* message) {
 
 static void _processVReadCommand(struct GDBStub* stub, const char* message) {
 	stub->outgoing[0] = '\0';
-	if (!strncmp("Attach", message, 6)) {
+	if (!strncmp("Cont?", message, 5)) {
+		strncpy(stub->outgoing, "vCont;c;C;s;S", GDB_STUB_MAX_LINE - 4);
+	} else if (!strncmp("Cont;", message, 5)) {
+		// There is only one thread, so the first action applies to it
+		switch (message[5]) {
+		case 'c':
+		case 'C':
+			_continue(stub, &message[6]);
+			return;
+		case 's':
+		case 'S':
+			_step(stub, &message[6]);
+			return;
+		default:
+			_error(stub, GDB_UNSUPPORTED_COMMAND);
+			return;
+		}
+	} else if (!strncmp("Attach", message, 6)) {
 		strncpy(stub->outgoing, "1", GDB_STUB_MAX_LINE - 4);
 		stub->d.isPaused = true;
 		struct mDebuggerEntryInfo info = {
@@ -681,6 +853,19 @@ static void _clearBreakpoint(struct GDBStub* stub, const char* message) {
 	_sendMessage(stub);
 }
 
+static void _disconnect(struct GDBStub* stub) {
+	_flush(stub);
+	if (!SOCKET_FAILED(stub->connection)) {
+		SocketClose(stub->connection);
+		stub->connection = INVALID_SOCKET;
+	}
+	stub->lineLength = 0;
+	_invalidateCache(stub);
+	stub->d.needsCallback = false;
+	stub->d.isPaused = false;
+	mDebuggerUpdatePaused(stub->d.p);
+}
+
 size_t _parseGDBMessage(struct GDBStub* stub, const char* message) {
 	uint8_t checksum = 0;
 	int parsed = 1;
@@ -743,6 +928,11 @@ size_t _parseGDBMessage(struct GDBStub* stub, const char* message) {
 	case 'c':
 		_continue(stub, message);
 		break;
+	case 'D':
+		strncpy(stub->outgoing, "OK", GDB_STUB_MAX_LINE - 4);
+		_sendMessage(stub);
+		_disconnect(stub);
+		break;
 	case 'G':
 		_writeGPRs(stub, message);
 		break;
@@ -798,6 +988,43 @@ size_t _parseGDBMessage(struct GDBStub* stub, const char* message) {
 	return parsed;
 }
 
+static size_t _packetLength(const char* message, size_t available) {
+	if (message[0] != '$') {
+		return 1;
+	}
+	const char* terminator = memchr(message, '#', available);
+	if (!terminator || (size_t) (terminator - message) + 3 > available) {
+		return 0;
+	}
+	return terminator - message + 3;
+}
+
+static void _parseGDBMessages(struct GDBStub* stub) {
+	size_t position = 0;
+	while (position < stub->lineLength) {
+		size_t length = _packetLength(&stub->line[position], stub->lineLength - position);
+		if (!length) {
+			break;
+		}
+		// Terminate each packet so handlers never read into the one queued after it
+		char next = stub->line[position + length];
+		stub->line[position + length] = '\0';
+		_parseGDBMessage(stub, &stub->line[position]);
+		if (SOCKET_FAILED(stub->connection)) {
+			return;
+		}
+		stub->line[position + length] = next;
+		position += length;
+	}
+	stub->lineLength -= position;
+	memmove(stub->line, &stub->line[position], stub->lineLength);
+	if (stub->lineLength == GDB_STUB_MAX_LINE - 1) {
+		// No complete packet fits in the buffer, so drop it and ask for a resend
+		stub->lineLength = 0;
+		_nak(stub);
+	}
+}
+
 void GDBStubCreate(struct GDBStub* stub) {
 	stub->socket = INVALID_SOCKET;
 	stub->connection = INVALID_SOCKET;
@@ -810,7 +1037,14 @@ void GDBStubCreate(struct GDBStub* stub) {
 	stub->d.interrupt = NULL;
 	stub->d.type = DEBUGGER_GDB;
 	stub->untilPoll = GDB_STUB_INTERVAL;
+	stub->pollInterval = GDB_STUB_INTERVAL;
+	stub->maxPollInterval = GDB_STUB_MAX_INTERVAL;
 	stub->lineAck = GDB_ACK_PENDING;
+	stub->lineLength = 0;
+	stub->sendLength = 0;
+	stub->deferSend = false;
+	stub->traceRecorder = NULL;
+	_invalidateCache(stub);
 }
 
 bool GDBStubListen(struct GDBStub* stub, int port, const struct Address* bindAddress, enum GDBWatchpointsBehvaior watchpointsBehavior) {
@@ -842,16 +1076,23 @@ cleanup:
 	return false;
 }
 
+void GDBStubSetPollInterval(struct GDBStub* stub, int maxInterval) {
+	if (maxInterval <= 0) {
+		maxInterval = GDB_STUB_MAX_INTERVAL;
+	}
+	stub->maxPollInterval = maxInterval;
+	if (stub->pollInterval > maxInterval) {
+		stub->pollInterval = maxInterval;
+	}
+	if (stub->untilPoll > maxInterval) {
+		stub->untilPoll = maxInterval;
+	}
+}
+
 void GDBStubHangup(struct GDBStub* stub) {
 	strncpy(stub->outgoing, "W00", GDB_STUB_MAX_LINE - 4);
 	_sendMessage(stub);
-	if (!SOCKET_FAILED(stub->connection)) {
-		SocketClose(stub->connection);
-		stub->connection = INVALID_SOCKET;
-	}
-	stub->d.needsCallback = false;
-	stub->d.isPaused = false;
-	mDebuggerUpdatePaused(stub->d.p);
+	_disconnect(stub);
 }
 
 void GDBStubShutdown(struct GDBStub* stub) {
@@ -892,26 +1133,35 @@ bool GDBStubUpdate(struct GDBStub* stub, int32_t timeoutMs) {
 		Socket reads = stub->connection;
 		SocketPoll(1, &reads, 0, 0, timeoutMs);
 	}
-	ssize_t messageLen = SocketRecv(stub->connection, stub->line, GDB_STUB_MAX_LINE - 1);
-	if (messageLen == 0) {
-		goto connectionLost;
-	}
-	if (messageLen == -1) {
-		if (SocketWouldBlock()) {
-			return false;
+
+	// Drain everything the client has queued up and answer it in one send, so pipelined
+	// requests don't each cost a full poll interval
+	bool received = false;
+	stub->deferSend = true;
+	while (!SOCKET_FAILED(stub->connection)) {
+		ssize_t messageLen = SocketRecv(stub->connection, &stub->line[stub->lineLength], GDB_STUB_MAX_LINE - 1 - stub->lineLength);
+		if (messageLen == 0) {
+			goto connectionLost;
+		}
+		if (messageLen == -1) {
+			if (SocketWouldBlock()) {
+				break;
+			}
+			goto connectionLost;
 		}
-		goto connectionLost;
-	}
 
-	stub->line[messageLen] = '\0';
-	mLOG(DEBUGGER, DEBUG, "< %s", stub->line);
-	ssize_t position = 0;
-	while (position < messageLen) {
-		position += _parseGDBMessage(stub, &stub->line[position]);
+		stub->line[stub->lineLength + messageLen] = '\0';
+		mLOG(DEBUGGER, DEBUG, "< %s", &stub->line[stub->lineLength]);
+		stub->lineLength += messageLen;
+		received = true;
+		_parseGDBMessages(stub);
 	}
-	return true;
+	stub->deferSend = false;
+	_flush(stub);
+	return received;
 
 connectionLost:
+	stub->deferSend = false;
 	mLOG(DEBUGGER, WARN, "Connection lost");
 	GDBStubHangup(stub);
 	return false;
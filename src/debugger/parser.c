@@ -7,9 +7,15 @@
 
 #include <mgba/core/core.h>
 #include <mgba/debugger/debugger.h>
+#include <mgba/internal/debugger/symbols.h>
 #include <mgba-util/string.h>
 
+#ifdef ENABLE_SCRIPTING
+#include <mgba/core/scripting.h>
+#endif
+
 DEFINE_VECTOR(LexVector, struct Token);
+DEFINE_VECTOR(ParseInstructionList, struct ParseInstruction);
 
 enum LexState {
 	LEX_ERROR = -1,
@@ -900,3 +906,155 @@ bool mDebuggerEvaluateParseTree(struct mDebugger* debugger, struct ParseTree* tr
 	}
 	return ok;
 }
+
+static void _compileIdentifier(struct mDebugger* debugger, const char* name, struct ParseInstruction* insn) {
+	int32_t value;
+	int segment = -1;
+	// Script and symbol table names can change after compiling, so they stay dynamic
+	insn->type = PARSE_INSN_IDENTIFIER;
+#ifdef ENABLE_SCRIPTING
+	if (debugger->bridge && mScriptBridgeLookupSymbol(debugger->bridge, name, &value)) {
+		insn->identifier = strdup(name);
+		return;
+	}
+#endif
+	if (debugger->core->symbolTable && mDebuggerSymbolLookup(debugger->core->symbolTable, name, &value, &segment)) {
+		insn->identifier = strdup(name);
+		return;
+	}
+	if (debugger->core->lookupIdentifier(debugger->core, name, &value, &segment)) {
+		insn->type = PARSE_INSN_CONSTANT;
+		insn->constant.value = value;
+		insn->constant.segment = segment;
+		return;
+	}
+	if (debugger->platform && debugger->core->readRegister(debugger->core, name, &value)) {
+		insn->type = PARSE_INSN_REGISTER;
+	}
+	insn->identifier = strdup(name);
+}
+
+static bool _compileTree(struct mDebugger* debugger, const struct ParseTree* tree, struct ParseInstructionList* list, int depth, int* maxDepth) {
+	struct ParseInstruction* insn;
+	if (depth > *maxDepth) {
+		*maxDepth = depth;
+	}
+	switch (tree->token.type) {
+	case TOKEN_UINT_TYPE:
+		insn = ParseInstructionListAppend(list);
+		insn->type = PARSE_INSN_CONSTANT;
+		insn->constant.value = tree->token.uintValue;
+		insn->constant.segment = -1;
+		return true;
+	case TOKEN_IDENTIFIER_TYPE:
+		_compileIdentifier(debugger, tree->token.identifierValue, ParseInstructionListAppend(list));
+		return true;
+	case TOKEN_SEGMENT_TYPE:
+	case TOKEN_OPERATOR_TYPE:
+		break;
+	default:
+		return false;
+	}
+
+	// Unary operators take the value that was current before their operand as their left-hand side,
+	// matching the tree walker in mDebuggerEvaluateParseTree
+	bool unary = tree->token.type == TOKEN_OPERATOR_TYPE && _operatorPrecedence[tree->token.operatorValue] == 2;
+	if (!unary) {
+		if (!tree->lhs || !_compileTree(debugger, tree->lhs, list, depth, maxDepth)) {
+			return false;
+		}
+	}
+	ParseInstructionListAppend(list)->type = PARSE_INSN_PUSH;
+	if (!tree->rhs || !_compileTree(debugger, tree->rhs, list, depth + 1, maxDepth)) {
+		return false;
+	}
+	insn = ParseInstructionListAppend(list);
+	if (tree->token.type == TOKEN_SEGMENT_TYPE) {
+		insn->type = PARSE_INSN_SEGMENT;
+	} else {
+		insn->type = PARSE_INSN_OPERATION;
+		insn->operation = tree->token.operatorValue;
+	}
+	return true;
+}
+
+struct ParseProgram* parseCompileTree(struct mDebugger* debugger, const struct ParseTree* tree) {
+	if (!tree) {
+		return NULL;
+	}
+	struct ParseProgram* program = malloc(sizeof(*program));
+	ParseInstructionListInit(&program->instructions, 8);
+	int maxDepth = 0;
+	if (!_compileTree(debugger, tree, &program->instructions, 0, &maxDepth) || maxDepth >= PARSE_PROGRAM_MAX_DEPTH) {
+		parseProgramFree(program);
+		return NULL;
+	}
+	return program;
+}
+
+void parseProgramFree(struct ParseProgram* program) {
+	size_t i;
+	for (i = 0; i < ParseInstructionListSize(&program->instructions); ++i) {
+		struct ParseInstruction* insn = ParseInstructionListGetPointer(&program->instructions, i);
+		if (insn->type == PARSE_INSN_IDENTIFIER || insn->type == PARSE_INSN_REGISTER) {
+			free(insn->identifier);
+		}
+	}
+	ParseInstructionListDeinit(&program->instructions);
+	free(program);
+}
+
+bool mDebuggerEvaluateParseProgram(struct mDebugger* debugger, const struct ParseProgram* program, int32_t* value, int* segment) {
+	if (!value) {
+		return false;
+	}
+	int32_t stackValues[PARSE_PROGRAM_MAX_DEPTH];
+	int stackSegments[PARSE_PROGRAM_MAX_DEPTH];
+	int sp = 0;
+	int32_t tmpVal = 0;
+	int tmpSegment = -1;
+
+	size_t i;
+	size_t size = ParseInstructionListSize(&program->instructions);
+	for (i = 0; i < size; ++i) {
+		const struct ParseInstruction* insn = ParseInstructionListGetConstPointer(&program->instructions, i);
+		switch (insn->type) {
+		case PARSE_INSN_CONSTANT:
+			tmpVal = insn->constant.value;
+			tmpSegment = insn->constant.segment;
+			break;
+		case PARSE_INSN_IDENTIFIER:
+			if (!mDebuggerLookupIdentifier(debugger, insn->identifier, &tmpVal, &tmpSegment)) {
+				return false;
+			}
+			break;
+		case PARSE_INSN_REGISTER:
+			if (!debugger->core->readRegister(debugger->core, insn->identifier, &tmpVal)) {
+				return false;
+			}
+			tmpSegment = -1;
+			break;
+		case PARSE_INSN_PUSH:
+			stackValues[sp] = tmpVal;
+			stackSegments[sp] = tmpSegment;
+			++sp;
+			break;
+		case PARSE_INSN_OPERATION:
+			--sp;
+			tmpSegment = stackSegments[sp];
+			if (!_performOperation(debugger, insn->operation, stackValues[sp], tmpVal, &tmpVal, &tmpSegment)) {
+				return false;
+			}
+			break;
+		case PARSE_INSN_SEGMENT:
+			--sp;
+			tmpSegment = stackValues[sp];
+			break;
+		}
+	}
+	*value = tmpVal;
+	if (segment) {
+		*segment = tmpSegment;
+	}
+	return true;
+}
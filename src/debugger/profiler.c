@@ -0,0 +1,447 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/internal/debugger/profiler.h>
+
+#include <mgba/core/core.h>
+#include <mgba/internal/debugger/stack-trace.h>
+#include <mgba/internal/debugger/symbols.h>
+#include <mgba-util/vfs.h>
+
+DEFINE_VECTOR(mDebuggerProfilerEntryList, struct mDebuggerProfilerEntry);
+
+static void _mDebuggerProfilerSample(struct mTiming* timing, void* context, uint32_t cyclesLate) {
+	struct mDebuggerProfiler* profiler = context;
+	struct mDebuggerPlatform* platform = profiler->d.p->platform;
+
+	uint32_t frames[mDEBUGGER_PROFILER_MAX_DEPTH];
+	struct mDebuggerTraceEntry entry;
+	uint32_t registers[mDEBUGGER_TRACE_MAX_REGISTERS];
+	platform->nextTraceEntry(platform, &entry, registers);
+	frames[0] = entry.pc;
+	size_t depth = 1;
+
+	// Call chains are only known while the stack is being traced; otherwise this is a flat profile
+	if (platform->getStackTraceMode && platform->getStackTraceMode(platform) != STACK_TRACE_DISABLED) {
+		struct mStackTrace* stack = &profiler->d.p->stackTrace;
+		size_t stackDepth = mStackTraceGetDepth(stack);
+		size_t i;
+		for (i = 0; i < stackDepth && depth < mDEBUGGER_PROFILER_MAX_DEPTH; ++i, ++depth) {
+			frames[depth] = mStackTraceGetFrame(stack, i)->callAddress;
+		}
+	}
+
+	uint64_t* count = HashTableLookupBinary(&profiler->stacks, frames, depth * sizeof(*frames));
+	if (!count) {
+		count = calloc(1, sizeof(*count));
+		HashTableInsertBinary(&profiler->stacks, frames, depth * sizeof(*frames), count);
+	}
+	++*count;
+	++profiler->nSamples;
+
+	int32_t next = profiler->period - (int32_t) cyclesLate;
+	if (next < 1) {
+		next = 1;
+	}
+	mTimingSchedule(timing, &profiler->event, next);
+}
+
+static void _mDebuggerProfilerSchedule(struct mDebuggerProfiler* profiler) {
+	struct mTiming* timing = profiler->d.p->core->timing;
+	if (profiler->running && !mTimingIsScheduled(timing, &profiler->event)) {
+		mTimingSchedule(timing, &profiler->event, profiler->period);
+	}
+}
+
+static void _mDebuggerProfilerInit(struct mDebuggerModule* debugger) {
+	_mDebuggerProfilerSchedule((struct mDebuggerProfiler*) debugger);
+}
+
+static void _mDebuggerProfilerDeinit(struct mDebuggerModule* debugger) {
+	mDebuggerProfilerStop((struct mDebuggerProfiler*) debugger);
+}
+
+static void _mDebuggerProfilerUpdate(struct mDebuggerModule* debugger) {
+	// Resets and loading savestates clear every scheduled event, so put the sampler back
+	_mDebuggerProfilerSchedule((struct mDebuggerProfiler*) debugger);
+}
+
+static void _mDebuggerProfilerEntered(struct mDebuggerModule* debugger, enum mDebuggerEntryReason reason, struct mDebuggerEntryInfo* info) {
+	UNUSED(reason);
+	UNUSED(info);
+	debugger->isPaused = false;
+}
+
+void mDebuggerProfilerInit(struct mDebuggerProfiler* profiler) {
+	memset(profiler, 0, sizeof(*profiler));
+
+	profiler->d.type = DEBUGGER_PROFILER;
+	profiler->d.init = _mDebuggerProfilerInit;
+	profiler->d.deinit = _mDebuggerProfilerDeinit;
+	profiler->d.update = _mDebuggerProfilerUpdate;
+	profiler->d.entered = _mDebuggerProfilerEntered;
+
+	profiler->event.context = profiler;
+	profiler->event.callback = _mDebuggerProfilerSample;
+	profiler->event.name = "Debugger Profiler";
+	profiler->event.priority = 0x100;
+	profiler->period = mDEBUGGER_PROFILER_DEFAULT_PERIOD;
+	HashTableInit(&profiler->stacks, 0, free);
+}
+
+void mDebuggerProfilerDeinit(struct mDebuggerProfiler* profiler) {
+	mDebuggerProfilerStop(profiler);
+	HashTableDeinit(&profiler->stacks);
+}
+
+bool mDebuggerProfilerStart(struct mDebuggerProfiler* profiler, int32_t period) {
+	if (!profiler->d.p || !profiler->d.p->platform->nextTraceEntry) {
+		return false;
+	}
+	if (period <= 0) {
+		period = mDEBUGGER_PROFILER_DEFAULT_PERIOD;
+	}
+	mDebuggerProfilerStop(profiler);
+	profiler->period = period;
+	profiler->running = true;
+	_mDebuggerProfilerSchedule(profiler);
+	return true;
+}
+
+void mDebuggerProfilerStop(struct mDebuggerProfiler* profiler) {
+	if (!profiler->running) {
+		return;
+	}
+	profiler->running = false;
+	mTimingDeschedule(profiler->d.p->core->timing, &profiler->event);
+}
+
+void mDebuggerProfilerClear(struct mDebuggerProfiler* profiler) {
+	HashTableClear(&profiler->stacks);
+	profiler->nSamples = 0;
+}
+
+static uint32_t _resolveFunction(struct mDebuggerProfiler* profiler, uint32_t address, const char** name) {
+	const struct mDebuggerSymbols* symbols = profiler->d.p ? profiler->d.p->core->symbolTable : NULL;
+	uint32_t offset = 0;
+	*name = symbols ? mDebuggerSymbolNearest(symbols, address, -1, &offset) : NULL;
+	return address - offset;
+}
+
+static size_t _formatFunction(uint32_t address, const char* name, char* out, size_t size) {
+	if (name) {
+		return snprintf(out, size, "%s", name);
+	}
+	return snprintf(out, size, "0x%08X", address);
+}
+
+static int _compareEntries(const void* a, const void* b) {
+	const struct mDebuggerProfilerEntry* entryA = a;
+	const struct mDebuggerProfilerEntry* entryB = b;
+	if (entryA->self != entryB->self) {
+		return entryA->self < entryB->self ? 1 : -1;
+	}
+	if (entryA->total != entryB->total) {
+		return entryA->total < entryB->total ? 1 : -1;
+	}
+	if (entryA->address != entryB->address) {
+		return entryA->address < entryB->address ? -1 : 1;
+	}
+	return 0;
+}
+
+void mDebuggerProfilerHistogram(struct mDebuggerProfiler* profiler, struct mDebuggerProfilerEntryList* list) {
+	mDebuggerProfilerEntryListClear(list);
+
+	// Maps function addresses to their index in the list, plus one so that 0 means absent
+	struct Table functions;
+	TableInit(&functions, 0, NULL);
+
+	struct TableIterator iter;
+	if (HashTableIteratorStart(&profiler->stacks, &iter)) {
+		do {
+			const uint32_t* frames = HashTableIteratorGetBinaryKey(&profiler->stacks, &iter);
+			size_t depth = HashTableIteratorGetBinaryKeyLen(&profiler->stacks, &iter) / sizeof(*frames);
+			uint64_t count = *(uint64_t*) HashTableIteratorGetValue(&profiler->stacks, &iter);
+
+			// Recursive functions are only counted once per sample towards the total
+			size_t seen[mDEBUGGER_PROFILER_MAX_DEPTH];
+			size_t i;
+			for (i = 0; i < depth; ++i) {
+				const char* name;
+				uint32_t address = _resolveFunction(profiler, frames[i], &name);
+				size_t index = (uintptr_t) TableLookup(&functions, address);
+				if (!index) {
+					struct mDebuggerProfilerEntry* entry = mDebuggerProfilerEntryListAppend(list);
+					entry->address = address;
+					entry->name = name;
+					entry->self = 0;
+					entry->total = 0;
+					index = mDebuggerProfilerEntryListSize(list);
+					TableInsert(&functions, address, (void*) (uintptr_t) index);
+				}
+				seen[i] = index;
+				size_t j;
+				for (j = 0; j < i; ++j) {
+					if (seen[j] == index) {
+						break;
+					}
+				}
+				struct mDebuggerProfilerEntry* entry = mDebuggerProfilerEntryListGetPointer(list, index - 1);
+				if (!i) {
+					entry->self += count;
+				}
+				if (j == i) {
+					entry->total += count;
+				}
+			}
+		} while (HashTableIteratorNext(&profiler->stacks, &iter));
+	}
+	TableDeinit(&functions);
+
+	qsort(mDebuggerProfilerEntryListGetPointer(list, 0), mDebuggerProfilerEntryListSize(list), sizeof(struct mDebuggerProfilerEntry), _compareEntries);
+}
+
+bool mDebuggerProfilerWriteFolded(struct mDebuggerProfiler* profiler, struct VFile* out) {
+	// Different call sites in the same functions fold into the same line, so merge them first
+	struct Table folded;
+	HashTableInit(&folded, 0, free);
+
+	// Names are cut short so that a full stack always fits
+	char line[mDEBUGGER_PROFILER_MAX_DEPTH * 64 + 32];
+	struct TableIterator iter;
+	if (HashTableIteratorStart(&profiler->stacks, &iter)) {
+		do {
+			const uint32_t* frames = HashTableIteratorGetBinaryKey(&profiler->stacks, &iter);
+			size_t depth = HashTableIteratorGetBinaryKeyLen(&profiler->stacks, &iter) / sizeof(*frames);
+			uint64_t count = *(uint64_t*) HashTableIteratorGetValue(&profiler->stacks, &iter);
+
+			// Folded stacks start at the outermost caller
+			size_t written = 0;
+			size_t i;
+			for (i = depth; i--;) {
+				const char* name;
+				uint32_t address = _resolveFunction(profiler, frames[i], &name);
+				if (i != depth - 1) {
+					line[written] = ';';
+					++written;
+				}
+				size_t length = _formatFunction(address, name, &line[written], 64);
+				written += length < 64 ? length : 63;
+			}
+			line[written] = '\0';
+
+			uint64_t* total = HashTableLookup(&folded, line);
+			if (!total) {
+				total = calloc(1, sizeof(*total));
+				HashTableInsert(&folded, line, total);
+			}
+			*total += count;
+		} while (HashTableIteratorNext(&profiler->stacks, &iter));
+	}
+
+	bool success = true;
+	if (HashTableIteratorStart(&folded, &iter)) {
+		do {
+			const char* stack = HashTableIteratorGetKey(&folded, &iter);
+			uint64_t count = *(uint64_t*) HashTableIteratorGetValue(&folded, &iter);
+			size_t written = snprintf(line, sizeof(line), "%s %" PRIu64 "\n", stack, count);
+			if (out->write(out, line, written) < 0) {
+				success = false;
+				break;
+			}
+		} while (HashTableIteratorNext(&folded, &iter));
+	}
+	HashTableDeinit(&folded);
+	return success;
+}
+
+// The pprof format is a protobuf message, which is simple enough to write by hand
+enum {
+	PPROF_PROFILE_SAMPLE_TYPE = 1,
+	PPROF_PROFILE_SAMPLE = 2,
+	PPROF_PROFILE_LOCATION = 4,
+	PPROF_PROFILE_FUNCTION = 5,
+	PPROF_PROFILE_STRING_TABLE = 6,
+	PPROF_PROFILE_PERIOD_TYPE = 11,
+	PPROF_PROFILE_PERIOD = 12,
+
+	PPROF_VALUE_TYPE_TYPE = 1,
+	PPROF_VALUE_TYPE_UNIT = 2,
+
+	PPROF_SAMPLE_LOCATION_ID = 1,
+	PPROF_SAMPLE_VALUE = 2,
+
+	PPROF_LOCATION_ID = 1,
+	PPROF_LOCATION_ADDRESS = 3,
+	PPROF_LOCATION_LINE = 4,
+
+	PPROF_LINE_FUNCTION_ID = 1,
+
+	PPROF_FUNCTION_ID = 1,
+	PPROF_FUNCTION_NAME = 2,
+	PPROF_FUNCTION_SYSTEM_NAME = 3,
+};
+
+enum {
+	PPROF_STRING_EMPTY,
+	PPROF_STRING_SAMPLES,
+	PPROF_STRING_COUNT,
+	PPROF_STRING_CPU,
+	PPROF_STRING_CYCLES,
+	PPROF_STRING_MAX
+};
+
+static const char* const _pprofStrings[PPROF_STRING_MAX] = {
+	"", "samples", "count", "cpu", "cycles"
+};
+
+static size_t _pbVarint(uint8_t* out, uint64_t value) {
+	size_t size = 0;
+	while (value >= 0x80) {
+		out[size] = value | 0x80;
+		value >>= 7;
+		++size;
+	}
+	out[size] = value;
+	return size + 1;
+}
+
+static size_t _pbInt(uint8_t* out, unsigned field, uint64_t value) {
+	size_t size = _pbVarint(out, field << 3);
+	return size + _pbVarint(&out[size], value);
+}
+
+static size_t _pbHeader(uint8_t* out, unsigned field, size_t length) {
+	size_t size = _pbVarint(out, (field << 3) | 2);
+	return size + _pbVarint(&out[size], length);
+}
+
+static bool _pbWriteMessage(struct VFile* out, unsigned field, const uint8_t* message, size_t length) {
+	uint8_t header[16];
+	size_t size = _pbHeader(header, field, length);
+	return out->write(out, header, size) >= 0 && out->write(out, message, length) >= 0;
+}
+
+static bool _pbWriteValueType(struct VFile* out, unsigned field, int type, int unit) {
+	uint8_t message[32];
+	size_t size = _pbInt(message, PPROF_VALUE_TYPE_TYPE, type);
+	size += _pbInt(&message[size], PPROF_VALUE_TYPE_UNIT, unit);
+	return _pbWriteMessage(out, field, message, size);
+}
+
+bool mDebuggerProfilerWritePprof(struct mDebuggerProfiler* profiler, struct VFile* out) {
+	if (!_pbWriteValueType(out, PPROF_PROFILE_SAMPLE_TYPE, PPROF_STRING_SAMPLES, PPROF_STRING_COUNT) ||
+	    !_pbWriteValueType(out, PPROF_PROFILE_SAMPLE_TYPE, PPROF_STRING_CPU, PPROF_STRING_CYCLES)) {
+		return false;
+	}
+
+	// Every distinct sampled address becomes a location, numbered from 1
+	struct Table locationIds;
+	struct UInt32List locations;
+	TableInit(&locationIds, 0, NULL);
+	UInt32ListInit(&locations, 0);
+	bool success = true;
+
+	uint8_t message[mDEBUGGER_PROFILER_MAX_DEPTH * 10 + 64];
+	uint8_t packed[mDEBUGGER_PROFILER_MAX_DEPTH * 10];
+	struct TableIterator iter;
+	if (HashTableIteratorStart(&profiler->stacks, &iter)) {
+		do {
+			const uint32_t* frames = HashTableIteratorGetBinaryKey(&profiler->stacks, &iter);
+			size_t depth = HashTableIteratorGetBinaryKeyLen(&profiler->stacks, &iter) / sizeof(*frames);
+			uint64_t count = *(uint64_t*) HashTableIteratorGetValue(&profiler->stacks, &iter);
+
+			size_t packedSize = 0;
+			size_t i;
+			for (i = 0; i < depth; ++i) {
+				size_t id = (uintptr_t) TableLookup(&locationIds, frames[i]);
+				if (!id) {
+					*UInt32ListAppend(&locations) = frames[i];
+					id = UInt32ListSize(&locations);
+					TableInsert(&locationIds, frames[i], (void*) (uintptr_t) id);
+				}
+				packedSize += _pbVarint(&packed[packedSize], id);
+			}
+			size_t size = _pbHeader(message, PPROF_SAMPLE_LOCATION_ID, packedSize);
+			memcpy(&message[size], packed, packedSize);
+			size += packedSize;
+
+			packedSize = _pbVarint(packed, count);
+			packedSize += _pbVarint(&packed[packedSize], count * profiler->period);
+			size += _pbHeader(&message[size], PPROF_SAMPLE_VALUE, packedSize);
+			memcpy(&message[size], packed, packedSize);
+			size += packedSize;
+
+			if (!_pbWriteMessage(out, PPROF_PROFILE_SAMPLE, message, size)) {
+				success = false;
+				break;
+			}
+		} while (HashTableIteratorNext(&profiler->stacks, &iter));
+	}
+
+	// Locations point at functions, which are also numbered from 1 and get their names
+	// from the string table, right after the fixed strings
+	struct Table functionIds;
+	struct mDebuggerProfilerEntryList functions;
+	TableInit(&functionIds, 0, NULL);
+	mDebuggerProfilerEntryListInit(&functions, 0);
+	size_t i;
+	for (i = 0; success && i < UInt32ListSize(&locations); ++i) {
+		uint32_t address = *UInt32ListGetPointer(&locations, i);
+		const char* name;
+		uint32_t function = _resolveFunction(profiler, address, &name);
+		size_t id = (uintptr_t) TableLookup(&functionIds, function);
+		if (!id) {
+			struct mDebuggerProfilerEntry* entry = mDebuggerProfilerEntryListAppend(&functions);
+			memset(entry, 0, sizeof(*entry));
+			entry->address = function;
+			entry->name = name;
+			id = mDebuggerProfilerEntryListSize(&functions);
+			TableInsert(&functionIds, function, (void*) (uintptr_t) id);
+		}
+		uint8_t line[16];
+		size_t lineSize = _pbInt(line, PPROF_LINE_FUNCTION_ID, id);
+		size_t size = _pbInt(message, PPROF_LOCATION_ID, i + 1);
+		size += _pbInt(&message[size], PPROF_LOCATION_ADDRESS, address);
+		size += _pbHeader(&message[size], PPROF_LOCATION_LINE, lineSize);
+		memcpy(&message[size], line, lineSize);
+		size += lineSize;
+		success = _pbWriteMessage(out, PPROF_PROFILE_LOCATION, message, size);
+	}
+	for (i = 0; success && i < mDebuggerProfilerEntryListSize(&functions); ++i) {
+		size_t size = _pbInt(message, PPROF_FUNCTION_ID, i + 1);
+		size += _pbInt(&message[size], PPROF_FUNCTION_NAME, PPROF_STRING_MAX + i);
+		size += _pbInt(&message[size], PPROF_FUNCTION_SYSTEM_NAME, PPROF_STRING_MAX + i);
+		success = _pbWriteMessage(out, PPROF_PROFILE_FUNCTION, message, size);
+	}
+
+	for (i = 0; success && i < PPROF_STRING_MAX; ++i) {
+		success = _pbWriteMessage(out, PPROF_PROFILE_STRING_TABLE, (const uint8_t*) _pprofStrings[i], strlen(_pprofStrings[i]));
+	}
+	for (i = 0; success && i < mDebuggerProfilerEntryListSize(&functions); ++i) {
+		const struct mDebuggerProfilerEntry* entry = mDebuggerProfilerEntryListGetPointer(&functions, i);
+		char name[256];
+		size_t length = _formatFunction(entry->address, entry->name, name, sizeof(name));
+		if (length >= sizeof(name)) {
+			length = sizeof(name) - 1;
+		}
+		success = _pbWriteMessage(out, PPROF_PROFILE_STRING_TABLE, (const uint8_t*) name, length);
+	}
+
+	if (success) {
+		success = _pbWriteValueType(out, PPROF_PROFILE_PERIOD_TYPE, PPROF_STRING_CPU, PPROF_STRING_CYCLES);
+	}
+	if (success) {
+		size_t size = _pbInt(message, PPROF_PROFILE_PERIOD, profiler->period);
+		success = out->write(out, message, size) >= 0;
+	}
+
+	mDebuggerProfilerEntryListDeinit(&functions);
+	TableDeinit(&functionIds);
+	UInt32ListDeinit(&locations);
+	TableDeinit(&locationIds);
+	return success;
+}
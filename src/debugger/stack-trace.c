@@ -14,32 +14,60 @@
 		return; \
 	}
 
+#define STACK_TRACE_INITIAL_DEPTH 64
+
 DEFINE_VECTOR(mStackFrames, struct mStackFrame);
 
 void mStackTraceInit(struct mStackTrace* stack, size_t registersSize) {
-	mStackFramesInit(&stack->stack, 0);
+	mStackFramesInit(&stack->stack, STACK_TRACE_INITIAL_DEPTH);
 	stack->registersSize = registersSize;
+	stack->saveRegisters = true;
+	stack->registersCapacity = STACK_TRACE_INITIAL_DEPTH;
+	stack->registers = malloc(registersSize * stack->registersCapacity);
 }
 
 void mStackTraceDeinit(struct mStackTrace* stack) {
 	mStackTraceClear(stack);
 	mStackFramesDeinit(&stack->stack);
+	free(stack->registers);
+	stack->registers = NULL;
+	stack->registersCapacity = 0;
+}
+
+void mStackTraceSetSaveRegisters(struct mStackTrace* stack, bool save) {
+	stack->saveRegisters = save;
 }
 
 void mStackTraceClear(struct mStackTrace* stack) {
-	ssize_t i = mStackTraceGetDepth(stack) - 1;
-	while (i >= 0) {
-		free(mStackTraceGetFrame(stack, i)->regs);
-		--i;
-	}
 	mStackFramesClear(&stack->stack);
 }
 
+static void* _mStackTraceRegisters(struct mStackTrace* stack, size_t depth) {
+	if (depth >= stack->registersCapacity) {
+		uint8_t* oldRegisters = stack->registers;
+		while (depth >= stack->registersCapacity) {
+			stack->registersCapacity *= 2;
+		}
+		stack->registers = realloc(stack->registers, stack->registersSize * stack->registersCapacity);
+		if (stack->registers != oldRegisters) {
+			size_t i;
+			for (i = 0; i < depth; ++i) {
+				struct mStackFrame* frame = mStackFramesGetPointer(&stack->stack, i);
+				if (frame->regs) {
+					frame->regs = &stack->registers[stack->registersSize * i];
+				}
+			}
+		}
+	}
+	return &stack->registers[stack->registersSize * depth];
+}
+
 size_t mStackTraceGetDepth(struct mStackTrace* stack) {
 	return mStackFramesSize(&stack->stack);
 }
 
 struct mStackFrame* mStackTracePush(struct mStackTrace* stack, uint32_t pc, uint32_t destAddress, uint32_t sp, void* regs) {
+	size_t depth = mStackTraceGetDepth(stack);
 	struct mStackFrame* frame = mStackFramesAppend(&stack->stack);
 	frame->callSegment = -1;
 	frame->callAddress = pc;
@@ -47,11 +75,15 @@ struct mStackFrame* mStackTracePush(struct mStackTrace* stack, uint32_t pc, uint
 	frame->entryAddress = destAddress;
 	frame->frameBaseSegment = -1;
 	frame->frameBaseAddress = sp;
-	frame->regs = malloc(stack->registersSize);
+	frame->regs = NULL;
+	frame->state = 0;
 	frame->finished = false;
 	frame->breakWhenFinished = false;
 	frame->interrupt = false;
-	memcpy(frame->regs, regs, stack->registersSize);
+	if (stack->saveRegisters) {
+		frame->regs = _mStackTraceRegisters(stack, depth);
+		memcpy(frame->regs, regs, stack->registersSize);
+	}
 	return frame;
 }
 
@@ -82,7 +114,13 @@ void mStackTraceFormatFrame(struct mStackTrace* stack, struct mDebuggerSymbols*
 		return;
 	}
 	const char* functionName = mDebuggerSymbolReverseLookup(st, stackFrame->entryAddress, stackFrame->entrySegment);
-	if (functionName) {
+	uint32_t symbolOffset = 0;
+	if (!functionName) {
+		functionName = mDebuggerSymbolNearest(st, stackFrame->entryAddress, stackFrame->entrySegment, &symbolOffset);
+	}
+	if (functionName && symbolOffset) {
+		written += snprintf(out + written, *length - written, "%s+0x%X ", functionName, symbolOffset);
+	} else if (functionName) {
 		written += snprintf(out + written, *length - written, "%s ", functionName);
 	} else if (stackFrame->entrySegment >= 0) {
 		written += snprintf(out + written, *length - written, "0x%02X:%08X ", stackFrame->entrySegment, stackFrame->entryAddress);
@@ -90,7 +128,7 @@ void mStackTraceFormatFrame(struct mStackTrace* stack, struct mDebuggerSymbols*
 		written += snprintf(out + written, *length - written, "0x%08X ", stackFrame->entryAddress);
 	}
 	CHECK_LENGTH();
-	if (stack->formatRegisters) {
+	if (stack->formatRegisters && stackFrame->regs) {
 		written += snprintf(out + written, *length - written, "(");
 		CHECK_LENGTH();
 		char buffer[1024];
@@ -126,8 +164,6 @@ void mStackTraceFormatFrame(struct mStackTrace* stack, struct mDebuggerSymbols*
 void mStackTracePop(struct mStackTrace* stack) {
 	size_t depth = mStackTraceGetDepth(stack);
 	if (depth > 0) {
-		struct mStackFrame* frame = mStackFramesGetPointer(&stack->stack, depth - 1);
-		free(frame->regs);
 		mStackFramesResize(&stack->stack, -1);
 	}
 }
@@ -7,6 +7,7 @@
 
 #include <mgba-util/string.h>
 #include <mgba-util/table.h>
+#include <mgba-util/vector.h>
 #include <mgba-util/hash.h>
 #include <mgba-util/vfs.h>
 
@@ -15,37 +16,316 @@ struct mDebuggerSymbol {
 	int segment;
 };
 
+struct mDebuggerSymbolIndexEntry {
+	uint32_t value;
+	int segment;
+	const char* name;
+};
+
+struct mDebuggerSymbolIndex {
+	struct mDebuggerSymbolIndexEntry* entries;
+	size_t size;
+	bool dirty;
+};
+
+struct mDebuggerSymbolBatchEntry {
+	int32_t value;
+	int segment;
+	uint32_t name;
+	bool removed;
+};
+
+struct mDebuggerSymbolBatchValue {
+	int32_t value;
+	int segment;
+	uint32_t entry;
+};
+
+struct mDebuggerSymbolBatchName {
+	const char* name;
+	uint32_t entry;
+};
+
+DECLARE_VECTOR(mDebuggerSymbolBatchEntryList, struct mDebuggerSymbolBatchEntry);
+DEFINE_VECTOR(mDebuggerSymbolBatchEntryList, struct mDebuggerSymbolBatchEntry);
+
+struct mDebuggerSymbolBatch {
+	struct mDebuggerSymbols* st;
+	char* strings;
+	size_t stringsSize;
+	struct mDebuggerSymbolBatchEntryList entries;
+
+	// Sorted on the first lookup that needs them, and thrown away whenever the batch changes
+	struct mDebuggerSymbolBatchValue* byValue;
+	struct mDebuggerSymbolBatchName* byName;
+};
+
+DECLARE_VECTOR(mDebuggerSymbolBatchList, struct mDebuggerSymbolBatch*);
+DEFINE_VECTOR(mDebuggerSymbolBatchList, struct mDebuggerSymbolBatch*);
+
 struct mDebuggerSymbols {
 	struct Table names;
 	struct Table reverse;
+	struct mDebuggerSymbolBatchList batches;
+	struct mDebuggerSymbolIndex* index;
+	uint32_t generation;
 };
 
+// Shared between tables, so a new table never looks unchanged from an old one at the same address
+static uint32_t _nextGeneration = 0;
+
 struct mDebuggerSymbols* mDebuggerSymbolTableCreate(void) {
 	struct mDebuggerSymbols* st = malloc(sizeof(*st));
 	HashTableInit(&st->names, 0, free);
 	HashTableInit(&st->reverse, 0, free);
+	mDebuggerSymbolBatchListInit(&st->batches, 0);
+	st->index = calloc(1, sizeof(*st->index));
+	st->generation = ++_nextGeneration;
 	return st;
 }
 
 void mDebuggerSymbolTableDestroy(struct mDebuggerSymbols* st) {
 	HashTableDeinit(&st->names);
 	HashTableDeinit(&st->reverse);
+	size_t i;
+	for (i = 0; i < mDebuggerSymbolBatchListSize(&st->batches); ++i) {
+		struct mDebuggerSymbolBatch* batch = *mDebuggerSymbolBatchListGetPointer(&st->batches, i);
+		mDebuggerSymbolBatchEntryListDeinit(&batch->entries);
+		free(batch->byValue);
+		free(batch->byName);
+		free(batch->strings);
+		free(batch);
+	}
+	mDebuggerSymbolBatchListDeinit(&st->batches);
+	free(st->index->entries);
+	free(st->index);
 	free(st);
 }
 
+static int _compareIndexEntries(const void* a, const void* b) {
+	const struct mDebuggerSymbolIndexEntry* entryA = a;
+	const struct mDebuggerSymbolIndexEntry* entryB = b;
+	if (entryA->segment != entryB->segment) {
+		return entryA->segment < entryB->segment ? -1 : 1;
+	}
+	if (entryA->value != entryB->value) {
+		return entryA->value < entryB->value ? -1 : 1;
+	}
+	return 0;
+}
+
+static void _buildIndex(const struct mDebuggerSymbols* st) {
+	struct mDebuggerSymbolIndex* index = st->index;
+	size_t size = HashTableSize(&st->reverse);
+	size_t i;
+	for (i = 0; i < mDebuggerSymbolBatchListSize(&st->batches); ++i) {
+		size += mDebuggerSymbolBatchEntryListSize(&(*mDebuggerSymbolBatchListGetConstPointer(&st->batches, i))->entries);
+	}
+	free(index->entries);
+	index->entries = malloc((size ? size : 1) * sizeof(*index->entries));
+	index->size = 0;
+
+	struct TableIterator iter;
+	if (HashTableIteratorStart(&st->reverse, &iter)) {
+		do {
+			const struct mDebuggerSymbol* sym = HashTableIteratorGetBinaryKey(&st->reverse, &iter);
+			struct mDebuggerSymbolIndexEntry* entry = &index->entries[index->size];
+			entry->value = sym->value;
+			entry->segment = sym->segment;
+			entry->name = HashTableIteratorGetValue(&st->reverse, &iter);
+			++index->size;
+		} while (HashTableIteratorNext(&st->reverse, &iter));
+	}
+	for (i = 0; i < mDebuggerSymbolBatchListSize(&st->batches); ++i) {
+		const struct mDebuggerSymbolBatch* batch = *mDebuggerSymbolBatchListGetConstPointer(&st->batches, i);
+		size_t j;
+		for (j = 0; j < mDebuggerSymbolBatchEntryListSize(&batch->entries); ++j) {
+			const struct mDebuggerSymbolBatchEntry* sym = mDebuggerSymbolBatchEntryListGetConstPointer(&batch->entries, j);
+			if (sym->removed) {
+				continue;
+			}
+			struct mDebuggerSymbolIndexEntry* entry = &index->entries[index->size];
+			entry->value = sym->value;
+			entry->segment = sym->segment;
+			entry->name = &batch->strings[sym->name];
+			++index->size;
+		}
+	}
+	qsort(index->entries, index->size, sizeof(*index->entries), _compareIndexEntries);
+	index->dirty = false;
+}
+
+static int _compareBatchValues(const void* a, const void* b) {
+	const struct mDebuggerSymbolBatchValue* valueA = a;
+	const struct mDebuggerSymbolBatchValue* valueB = b;
+	if (valueA->segment != valueB->segment) {
+		return valueA->segment < valueB->segment ? -1 : 1;
+	}
+	if (valueA->value != valueB->value) {
+		return valueA->value < valueB->value ? -1 : 1;
+	}
+	// Keep the order symbols were added in, so the last one added wins like with mDebuggerSymbolAdd
+	if (valueA->entry != valueB->entry) {
+		return valueA->entry < valueB->entry ? -1 : 1;
+	}
+	return 0;
+}
+
+static int _compareBatchNames(const void* a, const void* b) {
+	const struct mDebuggerSymbolBatchName* nameA = a;
+	const struct mDebuggerSymbolBatchName* nameB = b;
+	int cmp = strcmp(nameA->name, nameB->name);
+	if (cmp) {
+		return cmp;
+	}
+	if (nameA->entry != nameB->entry) {
+		return nameA->entry < nameB->entry ? -1 : 1;
+	}
+	return 0;
+}
+
+static void _sortBatchValues(struct mDebuggerSymbolBatch* batch) {
+	size_t size = mDebuggerSymbolBatchEntryListSize(&batch->entries);
+	batch->byValue = malloc((size ? size : 1) * sizeof(*batch->byValue));
+	size_t i;
+	for (i = 0; i < size; ++i) {
+		const struct mDebuggerSymbolBatchEntry* entry = mDebuggerSymbolBatchEntryListGetConstPointer(&batch->entries, i);
+		batch->byValue[i].value = entry->value;
+		batch->byValue[i].segment = entry->segment;
+		batch->byValue[i].entry = i;
+	}
+	qsort(batch->byValue, size, sizeof(*batch->byValue), _compareBatchValues);
+}
+
+static void _sortBatchNames(struct mDebuggerSymbolBatch* batch) {
+	size_t size = mDebuggerSymbolBatchEntryListSize(&batch->entries);
+	batch->byName = malloc((size ? size : 1) * sizeof(*batch->byName));
+	size_t i;
+	for (i = 0; i < size; ++i) {
+		const struct mDebuggerSymbolBatchEntry* entry = mDebuggerSymbolBatchEntryListGetConstPointer(&batch->entries, i);
+		batch->byName[i].name = &batch->strings[entry->name];
+		batch->byName[i].entry = i;
+	}
+	qsort(batch->byName, size, sizeof(*batch->byName), _compareBatchNames);
+}
+
+static struct mDebuggerSymbolBatchEntry* _batchLookup(struct mDebuggerSymbolBatch* batch, const char* name) {
+	if (!batch->byName) {
+		_sortBatchNames(batch);
+	}
+	// Find the last entry with this name that's still there
+	size_t low = 0;
+	size_t high = mDebuggerSymbolBatchEntryListSize(&batch->entries);
+	while (low < high) {
+		size_t mid = low + (high - low) / 2;
+		if (strcmp(batch->byName[mid].name, name) <= 0) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	while (low && strcmp(batch->byName[low - 1].name, name) == 0) {
+		struct mDebuggerSymbolBatchEntry* entry = mDebuggerSymbolBatchEntryListGetPointer(&batch->entries, batch->byName[low - 1].entry);
+		if (!entry->removed) {
+			return entry;
+		}
+		--low;
+	}
+	return NULL;
+}
+
+static const char* _batchReverseLookup(struct mDebuggerSymbolBatch* batch, int32_t value, int segment) {
+	if (!batch->byValue) {
+		_sortBatchValues(batch);
+	}
+	size_t low = 0;
+	size_t high = mDebuggerSymbolBatchEntryListSize(&batch->entries);
+	while (low < high) {
+		size_t mid = low + (high - low) / 2;
+		const struct mDebuggerSymbolBatchValue* entry = &batch->byValue[mid];
+		if (entry->segment < segment || (entry->segment == segment && entry->value <= value)) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	while (low && batch->byValue[low - 1].segment == segment && batch->byValue[low - 1].value == value) {
+		const struct mDebuggerSymbolBatchEntry* entry = mDebuggerSymbolBatchEntryListGetConstPointer(&batch->entries, batch->byValue[low - 1].entry);
+		if (!entry->removed) {
+			return &batch->strings[entry->name];
+		}
+		--low;
+	}
+	return NULL;
+}
+
+static const struct mDebuggerSymbolIndexEntry* _findNearest(const struct mDebuggerSymbolIndex* index, uint32_t value, int segment) {
+	// Find the last entry that sorts at or before the address, then make sure it's in the same segment
+	size_t low = 0;
+	size_t high = index->size;
+	while (low < high) {
+		size_t mid = low + (high - low) / 2;
+		const struct mDebuggerSymbolIndexEntry* entry = &index->entries[mid];
+		if (entry->segment < segment || (entry->segment == segment && entry->value <= value)) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	if (!low || index->entries[low - 1].segment != segment) {
+		return NULL;
+	}
+	return &index->entries[low - 1];
+}
+
+uint32_t mDebuggerSymbolTableGeneration(const struct mDebuggerSymbols* st) {
+	return st->generation;
+}
+
 bool mDebuggerSymbolLookup(const struct mDebuggerSymbols* st, const char* name, int32_t* value, int* segment) {
 	struct mDebuggerSymbol* sym = HashTableLookup(&st->names, name);
-	if (!sym) {
-		return false;
+	if (sym) {
+		*value = sym->value;
+		*segment = sym->segment;
+		return true;
 	}
-	*value = sym->value;
-	*segment = sym->segment;
-	return true;
+	size_t i;
+	for (i = mDebuggerSymbolBatchListSize(&st->batches); i; --i) {
+		struct mDebuggerSymbolBatchEntry* entry = _batchLookup(*mDebuggerSymbolBatchListGetConstPointer(&st->batches, i - 1), name);
+		if (entry) {
+			*value = entry->value;
+			*segment = entry->segment;
+			return true;
+		}
+	}
+	return false;
 }
 
 const char* mDebuggerSymbolReverseLookup(const struct mDebuggerSymbols* st, int32_t value, int segment) {
 	struct mDebuggerSymbol sym = { value, segment };
-	return HashTableLookupBinary(&st->reverse, &sym, sizeof(sym));
+	const char* name = HashTableLookupBinary(&st->reverse, &sym, sizeof(sym));
+	size_t i;
+	for (i = mDebuggerSymbolBatchListSize(&st->batches); i && !name; --i) {
+		name = _batchReverseLookup(*mDebuggerSymbolBatchListGetConstPointer(&st->batches, i - 1), value, segment);
+	}
+	return name;
+}
+
+const char* mDebuggerSymbolNearest(const struct mDebuggerSymbols* st, uint32_t value, int segment, uint32_t* offset) {
+	if (st->index->dirty) {
+		_buildIndex(st);
+	}
+	const struct mDebuggerSymbolIndexEntry* entry = _findNearest(st->index, value, segment);
+	if (!entry && segment >= 0) {
+		entry = _findNearest(st->index, value, -1);
+	}
+	if (!entry) {
+		return NULL;
+	}
+	if (offset) {
+		*offset = value - entry->value;
+	}
+	return entry->name;
 }
 
 void mDebuggerSymbolAdd(struct mDebuggerSymbols* st, const char* name, int32_t value, int segment) {
@@ -54,14 +334,62 @@ void mDebuggerSymbolAdd(struct mDebuggerSymbols* st, const char* name, int32_t v
 	sym->segment = segment;
 	HashTableInsert(&st->names, name, sym);
 	HashTableInsertBinary(&st->reverse, sym, sizeof(*sym), strdup(name));
+	st->index->dirty = true;
+	st->generation = ++_nextGeneration;
 }
 
 void mDebuggerSymbolRemove(struct mDebuggerSymbols* st, const char* name) {
+	bool removed = false;
 	struct mDebuggerSymbol* sym = HashTableLookup(&st->names, name);
 	if (sym) {
 		HashTableRemoveBinary(&st->reverse, sym, sizeof(*sym));
 		HashTableRemove(&st->names, name);
+		removed = true;
 	}
+	size_t i;
+	for (i = 0; i < mDebuggerSymbolBatchListSize(&st->batches); ++i) {
+		struct mDebuggerSymbolBatchEntry* entry;
+		while ((entry = _batchLookup(*mDebuggerSymbolBatchListGetPointer(&st->batches, i), name))) {
+			entry->removed = true;
+			removed = true;
+		}
+	}
+	if (removed) {
+		st->index->dirty = true;
+		st->generation = ++_nextGeneration;
+	}
+}
+
+struct mDebuggerSymbolBatch* mDebuggerSymbolBatchCreate(struct mDebuggerSymbols* st, const char* strings, size_t size) {
+	struct mDebuggerSymbolBatch* batch = calloc(1, sizeof(*batch));
+	batch->st = st;
+	// Terminate the copy, so names at the end of a truncated table can't run off of it
+	batch->strings = malloc(size + 1);
+	memcpy(batch->strings, strings, size);
+	batch->strings[size] = '\0';
+	batch->stringsSize = size;
+	mDebuggerSymbolBatchEntryListInit(&batch->entries, 0);
+	*mDebuggerSymbolBatchListAppend(&st->batches) = batch;
+	return batch;
+}
+
+bool mDebuggerSymbolBatchAdd(struct mDebuggerSymbolBatch* batch, uint32_t name, int32_t value, int segment) {
+	if (name >= batch->stringsSize) {
+		return false;
+	}
+	struct mDebuggerSymbolBatchEntry* entry = mDebuggerSymbolBatchEntryListAppend(&batch->entries);
+	entry->value = value;
+	entry->segment = segment;
+	entry->name = name;
+	entry->removed = false;
+
+	free(batch->byValue);
+	batch->byValue = NULL;
+	free(batch->byName);
+	batch->byName = NULL;
+	batch->st->index->dirty = true;
+	batch->st->generation = ++_nextGeneration;
+	return true;
 }
 
 void mDebuggerLoadARMIPSSymbols(struct mDebuggerSymbols* st, struct VFile* vf) {
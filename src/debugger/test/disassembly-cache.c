@@ -0,0 +1,75 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/internal/debugger/disassembly-cache.h>
+#include <mgba/internal/debugger/symbols.h>
+
+static int cacheSetup(void** state) {
+	struct mDisassemblyCache* cache = malloc(sizeof(*cache));
+	mDisassemblyCacheInit(cache);
+	*state = cache;
+	return 0;
+}
+
+static int cacheTeardown(void** state) {
+	struct mDisassemblyCache* cache = *state;
+	mDisassemblyCacheDeinit(cache);
+	free(cache);
+	return 0;
+}
+
+M_TEST_DEFINE(lookupStored) {
+	struct mDisassemblyCache* cache = *state;
+	assert_null(mDisassemblyCacheLookup(cache, 0x08000000, 0xE3A00001, 0));
+
+	mDisassemblyCacheStore(cache, 0x08000000, 0xE3A00001, 0, "mov r0, #0x1");
+	const char* text = mDisassemblyCacheLookup(cache, 0x08000000, 0xE3A00001, 0);
+	assert_non_null(text);
+	assert_string_equal(text, "mov r0, #0x1");
+
+	// Any part of the key being different is a miss
+	assert_null(mDisassemblyCacheLookup(cache, 0x08000004, 0xE3A00001, 0));
+	assert_null(mDisassemblyCacheLookup(cache, 0x08000000, 0xE3A00002, 0));
+	assert_null(mDisassemblyCacheLookup(cache, 0x08000000, 0xE3A00001, 1));
+}
+
+M_TEST_DEFINE(invalidate) {
+	struct mDisassemblyCache* cache = *state;
+	mDisassemblyCacheStore(cache, 0x100, 0x00, 1, "nop");
+	assert_non_null(mDisassemblyCacheLookup(cache, 0x100, 0x00, 1));
+
+	mDisassemblyCacheInvalidate(cache);
+	assert_null(mDisassemblyCacheLookup(cache, 0x100, 0x00, 1));
+
+	mDisassemblyCacheStore(cache, 0x100, 0x00, 1, "nop");
+	assert_non_null(mDisassemblyCacheLookup(cache, 0x100, 0x00, 1));
+}
+
+M_TEST_DEFINE(symbolsChanged) {
+	struct mDisassemblyCache* cache = *state;
+	struct mDebuggerSymbols* st = mDebuggerSymbolTableCreate();
+
+	mDisassemblyCacheCheckSymbols(cache, st);
+	mDisassemblyCacheStore(cache, 0x100, 0xEAFFFFFE, 0, "b 0x00000100");
+	mDisassemblyCacheCheckSymbols(cache, st);
+	assert_non_null(mDisassemblyCacheLookup(cache, 0x100, 0xEAFFFFFE, 0));
+
+	mDebuggerSymbolAdd(st, "loop", 0x100, -1);
+	mDisassemblyCacheCheckSymbols(cache, st);
+	assert_null(mDisassemblyCacheLookup(cache, 0x100, 0xEAFFFFFE, 0));
+
+	mDisassemblyCacheStore(cache, 0x100, 0xEAFFFFFE, 0, "b loop");
+	mDisassemblyCacheCheckSymbols(cache, NULL);
+	assert_null(mDisassemblyCacheLookup(cache, 0x100, 0xEAFFFFFE, 0));
+
+	mDebuggerSymbolTableDestroy(st);
+}
+
+M_TEST_SUITE_DEFINE(mDisassemblyCache,
+	cmocka_unit_test_setup_teardown(lookupStored, cacheSetup, cacheTeardown),
+	cmocka_unit_test_setup_teardown(invalidate, cacheSetup, cacheTeardown),
+	cmocka_unit_test_setup_teardown(symbolsChanged, cacheSetup, cacheTeardown))
@@ -136,6 +136,44 @@ M_TEST_DEFINE(parseUnaryChainedOperator) {
 	assert_int_equal(tree->rhs->rhs->token.uintValue, 2);
 }
 
+#define ASSERT_COMPILED_MATCHES(STR) \
+	do { \
+		PARSE(STR); \
+		int32_t treeValue; \
+		int treeSegment; \
+		int32_t programValue; \
+		int programSegment; \
+		struct ParseProgram* program = parseCompileTree(NULL, tree); \
+		assert_non_null(program); \
+		assert_true(mDebuggerEvaluateParseTree(NULL, tree, &treeValue, &treeSegment)); \
+		assert_true(mDebuggerEvaluateParseProgram(NULL, program, &programValue, &programSegment)); \
+		assert_int_equal(programValue, treeValue); \
+		assert_int_equal(programSegment, treeSegment); \
+		parseProgramFree(program); \
+	} while (0)
+
+M_TEST_DEFINE(compileArithmetic) {
+	ASSERT_COMPILED_MATCHES("(1+2)*3-10/5%3");
+}
+
+M_TEST_DEFINE(compileUnary) {
+	ASSERT_COMPILED_MATCHES("-1+~2&!0");
+}
+
+M_TEST_DEFINE(compileComparison) {
+	ASSERT_COMPILED_MATCHES("1<<4>=16&&3!=2||0");
+}
+
+M_TEST_DEFINE(compileSegment) {
+	ASSERT_COMPILED_MATCHES("$2:4000+1");
+}
+
+M_TEST_DEFINE(compileError) {
+	PARSE("1+");
+
+	assert_null(parseCompileTree(NULL, tree));
+}
+
 M_TEST_SUITE_DEFINE(Parser,
 	cmocka_unit_test_setup_teardown(parseEmpty, parseSetup, parseTeardown),
 	cmocka_unit_test_setup_teardown(parseInt, parseSetup, parseTeardown),
@@ -146,4 +184,9 @@ M_TEST_SUITE_DEFINE(Parser,
 	cmocka_unit_test_setup_teardown(parseParentheticalExpression, parseSetup, parseTeardown),
 	cmocka_unit_test_setup_teardown(parseParentheticalAddMultplyExpression, parseSetup, parseTeardown),
 	cmocka_unit_test_setup_teardown(parseIsolatedOperator, parseSetup, parseTeardown),
-	cmocka_unit_test_setup_teardown(parseUnaryChainedOperator, parseSetup, parseTeardown))
+	cmocka_unit_test_setup_teardown(parseUnaryChainedOperator, parseSetup, parseTeardown),
+	cmocka_unit_test_setup_teardown(compileArithmetic, parseSetup, parseTeardown),
+	cmocka_unit_test_setup_teardown(compileUnary, parseSetup, parseTeardown),
+	cmocka_unit_test_setup_teardown(compileComparison, parseSetup, parseTeardown),
+	cmocka_unit_test_setup_teardown(compileSegment, parseSetup, parseTeardown),
+	cmocka_unit_test_setup_teardown(compileError, parseSetup, parseTeardown))
@@ -0,0 +1,128 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/internal/debugger/stack-trace.h>
+#include <mgba/internal/debugger/symbols.h>
+
+struct mTestRegisters {
+	uint32_t gprs[4];
+};
+
+static void _formatRegisters(struct mStackFrame* frame, char* out, size_t* length) {
+	struct mTestRegisters* regs = frame->regs;
+	*length = snprintf(out, *length, "r3=%u", regs->gprs[3]);
+}
+
+static int stackSetup(void** state) {
+	struct mStackTrace* stack = malloc(sizeof(*stack));
+	mStackTraceInit(stack, sizeof(struct mTestRegisters));
+	*state = stack;
+	return 0;
+}
+
+static int stackTeardown(void** state) {
+	struct mStackTrace* stack = *state;
+	mStackTraceDeinit(stack);
+	free(stack);
+	return 0;
+}
+
+M_TEST_DEFINE(pushPop) {
+	struct mStackTrace* stack = *state;
+	struct mTestRegisters regs = { { 1, 2, 3, 4 } };
+
+	mStackTracePush(stack, 0x100, 0x200, 0x3000, &regs);
+	regs.gprs[0] = 5;
+	mStackTracePush(stack, 0x204, 0x400, 0x2FF0, &regs);
+	assert_int_equal(mStackTraceGetDepth(stack), 2);
+
+	struct mStackFrame* frame = mStackTraceGetFrame(stack, 0);
+	assert_int_equal(frame->callAddress, 0x204);
+	assert_int_equal(frame->entryAddress, 0x400);
+	assert_int_equal(frame->frameBaseAddress, 0x2FF0);
+	assert_int_equal(((struct mTestRegisters*) frame->regs)->gprs[0], 5);
+
+	mStackTracePop(stack);
+	assert_int_equal(mStackTraceGetDepth(stack), 1);
+	frame = mStackTraceGetFrame(stack, 0);
+	assert_int_equal(frame->callAddress, 0x100);
+	assert_int_equal(((struct mTestRegisters*) frame->regs)->gprs[0], 1);
+	assert_null(mStackTraceGetFrame(stack, 1));
+
+	mStackTracePop(stack);
+	mStackTracePop(stack);
+	assert_int_equal(mStackTraceGetDepth(stack), 0);
+}
+
+M_TEST_DEFINE(deepStack) {
+	struct mStackTrace* stack = *state;
+	struct mTestRegisters regs = {0};
+
+	// Deep enough that the saved registers have to move while frames point at them
+	uint32_t i;
+	for (i = 0; i < 1000; ++i) {
+		regs.gprs[1] = i;
+		mStackTracePush(stack, i, i + 1, 0x4000 - i * 4, &regs);
+	}
+	assert_int_equal(mStackTraceGetDepth(stack), 1000);
+	for (i = 0; i < 1000; ++i) {
+		struct mStackFrame* frame = mStackTraceGetFrame(stack, 999 - i);
+		assert_int_equal(frame->callAddress, i);
+		assert_int_equal(((struct mTestRegisters*) frame->regs)->gprs[1], i);
+	}
+
+	for (i = 0; i < 500; ++i) {
+		mStackTracePop(stack);
+	}
+	regs.gprs[1] = 0xFFFF;
+	mStackTracePush(stack, 0, 0, 0, &regs);
+	assert_int_equal(((struct mTestRegisters*) mStackTraceGetFrame(stack, 0)->regs)->gprs[1], 0xFFFF);
+	assert_int_equal(((struct mTestRegisters*) mStackTraceGetFrame(stack, 1)->regs)->gprs[1], 499);
+
+	mStackTraceClear(stack);
+	assert_int_equal(mStackTraceGetDepth(stack), 0);
+}
+
+M_TEST_DEFINE(withoutRegisters) {
+	struct mStackTrace* stack = *state;
+	struct mTestRegisters regs = { { 1, 2, 3, 4 } };
+
+	mStackTracePush(stack, 0x100, 0x200, 0x3000, &regs);
+	mStackTraceSetSaveRegisters(stack, false);
+	uint32_t i;
+	for (i = 0; i < 100; ++i) {
+		mStackTracePush(stack, 0x204 + i, 0x400, 0x2FF0 - i * 4, &regs);
+		assert_null(mStackTraceGetFrame(stack, 0)->regs);
+	}
+	mStackTraceSetSaveRegisters(stack, true);
+	mStackTracePush(stack, 0x600, 0x800, 0x2000, &regs);
+
+	assert_int_equal(mStackTraceGetDepth(stack), 102);
+	assert_non_null(mStackTraceGetFrame(stack, 0)->regs);
+	assert_null(mStackTraceGetFrame(stack, 1)->regs);
+	struct mStackFrame* frame = mStackTraceGetFrame(stack, 101);
+	assert_int_equal(frame->callAddress, 0x100);
+	assert_int_equal(((struct mTestRegisters*) frame->regs)->gprs[3], 4);
+
+	// Frames without registers are formatted with just their addresses
+	struct mDebuggerSymbols* st = mDebuggerSymbolTableCreate();
+	stack->formatRegisters = _formatRegisters;
+	char out[256];
+	size_t length = sizeof(out);
+	mStackTraceFormatFrame(stack, st, 0, out, &length);
+	assert_non_null(strstr(out, "(r3=4)"));
+	length = sizeof(out);
+	mStackTraceFormatFrame(stack, st, 1, out, &length);
+	assert_null(strchr(out, '('));
+	assert_non_null(strstr(out, "at 0x00000267"));
+	mDebuggerSymbolTableDestroy(st);
+}
+
+M_TEST_SUITE_DEFINE(mStackTrace,
+	cmocka_unit_test_setup_teardown(pushPop, stackSetup, stackTeardown),
+	cmocka_unit_test_setup_teardown(deepStack, stackSetup, stackTeardown),
+	cmocka_unit_test_setup_teardown(withoutRegisters, stackSetup, stackTeardown))
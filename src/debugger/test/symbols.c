@@ -0,0 +1,166 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/internal/debugger/symbols.h>
+
+static int symbolsSetup(void** state) {
+	struct mDebuggerSymbols* st = mDebuggerSymbolTableCreate();
+	mDebuggerSymbolAdd(st, "start", 0x08000000, -1);
+	mDebuggerSymbolAdd(st, "main", 0x08000100, -1);
+	mDebuggerSymbolAdd(st, "irq", 0x08000400, -1);
+	mDebuggerSymbolAdd(st, "bank1", 0x4000, 1);
+	mDebuggerSymbolAdd(st, "bank2", 0x4000, 2);
+	*state = st;
+	return 0;
+}
+
+static int symbolsTeardown(void** state) {
+	mDebuggerSymbolTableDestroy(*state);
+	return 0;
+}
+
+M_TEST_DEFINE(nearestExact) {
+	struct mDebuggerSymbols* st = *state;
+	uint32_t offset = 1;
+	const char* name = mDebuggerSymbolNearest(st, 0x08000100, -1, &offset);
+	assert_non_null(name);
+	assert_string_equal(name, "main");
+	assert_int_equal(offset, 0);
+}
+
+M_TEST_DEFINE(nearestBetween) {
+	struct mDebuggerSymbols* st = *state;
+	uint32_t offset;
+	const char* name = mDebuggerSymbolNearest(st, 0x080003FE, -1, &offset);
+	assert_non_null(name);
+	assert_string_equal(name, "main");
+	assert_int_equal(offset, 0x2FE);
+
+	name = mDebuggerSymbolNearest(st, 0x09000000, -1, &offset);
+	assert_non_null(name);
+	assert_string_equal(name, "irq");
+	assert_int_equal(offset, 0xFFFC00);
+}
+
+M_TEST_DEFINE(nearestBefore) {
+	struct mDebuggerSymbols* st = *state;
+	assert_null(mDebuggerSymbolNearest(st, 0x07FFFFFF, -1, NULL));
+}
+
+M_TEST_DEFINE(nearestSegment) {
+	struct mDebuggerSymbols* st = *state;
+	uint32_t offset;
+	const char* name = mDebuggerSymbolNearest(st, 0x4010, 2, &offset);
+	assert_non_null(name);
+	assert_string_equal(name, "bank2");
+	assert_int_equal(offset, 0x10);
+
+	name = mDebuggerSymbolNearest(st, 0x08000004, 3, &offset);
+	assert_non_null(name);
+	assert_string_equal(name, "start");
+	assert_int_equal(offset, 4);
+}
+
+M_TEST_DEFINE(nearestAfterUpdate) {
+	struct mDebuggerSymbols* st = *state;
+	uint32_t offset;
+	const char* name = mDebuggerSymbolNearest(st, 0x08000204, -1, &offset);
+	assert_non_null(name);
+	assert_string_equal(name, "main");
+
+	mDebuggerSymbolAdd(st, "helper", 0x08000200, -1);
+	name = mDebuggerSymbolNearest(st, 0x08000204, -1, &offset);
+	assert_non_null(name);
+	assert_string_equal(name, "helper");
+	assert_int_equal(offset, 4);
+
+	mDebuggerSymbolRemove(st, "helper");
+	mDebuggerSymbolRemove(st, "main");
+	name = mDebuggerSymbolNearest(st, 0x08000204, -1, &offset);
+	assert_non_null(name);
+	assert_string_equal(name, "start");
+	assert_int_equal(offset, 0x204);
+}
+
+// Laid out like an ELF string table, with names that share suffixes
+static const char _batchStrings[] = "\0dup\0loop\0func_loop\0$t\0";
+
+M_TEST_DEFINE(batchLookup) {
+	struct mDebuggerSymbols* st = *state;
+	struct mDebuggerSymbolBatch* batch = mDebuggerSymbolBatchCreate(st, _batchStrings, sizeof(_batchStrings));
+	uint32_t generation = mDebuggerSymbolTableGeneration(st);
+	assert_true(mDebuggerSymbolBatchAdd(batch, 10, 0x08000300, -1));
+	assert_true(mDebuggerSymbolBatchAdd(batch, 15, 0x08000310, -1));
+	assert_true(mDebuggerSymbolBatchAdd(batch, 1, 0x08000320, -1));
+	assert_true(mDebuggerSymbolBatchAdd(batch, 1, 0x08000330, -1));
+	assert_false(mDebuggerSymbolBatchAdd(batch, sizeof(_batchStrings), 0x08000340, -1));
+	assert_int_not_equal(mDebuggerSymbolTableGeneration(st), generation);
+
+	int32_t value;
+	int segment;
+	assert_true(mDebuggerSymbolLookup(st, "func_loop", &value, &segment));
+	assert_int_equal(value, 0x08000300);
+	assert_int_equal(segment, -1);
+	assert_true(mDebuggerSymbolLookup(st, "loop", &value, &segment));
+	assert_int_equal(value, 0x08000310);
+	assert_true(mDebuggerSymbolLookup(st, "dup", &value, &segment));
+	assert_int_equal(value, 0x08000330);
+	assert_true(mDebuggerSymbolLookup(st, "main", &value, &segment));
+	assert_int_equal(value, 0x08000100);
+	assert_false(mDebuggerSymbolLookup(st, "lo", &value, &segment));
+
+	assert_string_equal(mDebuggerSymbolReverseLookup(st, 0x08000310, -1), "loop");
+	assert_string_equal(mDebuggerSymbolReverseLookup(st, 0x08000100, -1), "main");
+	assert_null(mDebuggerSymbolReverseLookup(st, 0x08000310, 1));
+
+	uint32_t offset;
+	const char* name = mDebuggerSymbolNearest(st, 0x08000318, -1, &offset);
+	assert_non_null(name);
+	assert_string_equal(name, "loop");
+	assert_int_equal(offset, 8);
+
+	// Explicitly added symbols win over batched ones
+	mDebuggerSymbolAdd(st, "loop", 0x08000500, -1);
+	assert_true(mDebuggerSymbolLookup(st, "loop", &value, &segment));
+	assert_int_equal(value, 0x08000500);
+}
+
+M_TEST_DEFINE(batchRemove) {
+	struct mDebuggerSymbols* st = *state;
+	struct mDebuggerSymbolBatch* batch = mDebuggerSymbolBatchCreate(st, _batchStrings, sizeof(_batchStrings));
+	mDebuggerSymbolBatchAdd(batch, 1, 0x08000320, -1);
+	mDebuggerSymbolBatchAdd(batch, 1, 0x08000330, -1);
+	mDebuggerSymbolBatchAdd(batch, 5, 0x08000330, -1);
+
+	int32_t value;
+	int segment;
+	assert_string_equal(mDebuggerSymbolReverseLookup(st, 0x08000330, -1), "loop");
+	uint32_t generation = mDebuggerSymbolTableGeneration(st);
+	mDebuggerSymbolRemove(st, "loop");
+	assert_int_not_equal(mDebuggerSymbolTableGeneration(st), generation);
+	assert_false(mDebuggerSymbolLookup(st, "loop", &value, &segment));
+	assert_string_equal(mDebuggerSymbolReverseLookup(st, 0x08000330, -1), "dup");
+
+	mDebuggerSymbolRemove(st, "dup");
+	assert_false(mDebuggerSymbolLookup(st, "dup", &value, &segment));
+	assert_null(mDebuggerSymbolReverseLookup(st, 0x08000320, -1));
+
+	uint32_t offset;
+	const char* name = mDebuggerSymbolNearest(st, 0x08000334, -1, &offset);
+	assert_non_null(name);
+	assert_string_equal(name, "main");
+	assert_int_equal(offset, 0x234);
+}
+
+M_TEST_SUITE_DEFINE(Symbols,
+	cmocka_unit_test_setup_teardown(nearestExact, symbolsSetup, symbolsTeardown),
+	cmocka_unit_test_setup_teardown(nearestBetween, symbolsSetup, symbolsTeardown),
+	cmocka_unit_test_setup_teardown(nearestBefore, symbolsSetup, symbolsTeardown),
+	cmocka_unit_test_setup_teardown(nearestSegment, symbolsSetup, symbolsTeardown),
+	cmocka_unit_test_setup_teardown(nearestAfterUpdate, symbolsSetup, symbolsTeardown),
+	cmocka_unit_test_setup_teardown(batchLookup, symbolsSetup, symbolsTeardown),
+	cmocka_unit_test_setup_teardown(batchRemove, symbolsSetup, symbolsTeardown))
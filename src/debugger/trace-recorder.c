@@ -0,0 +1,274 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/internal/debugger/trace-recorder.h>
+
+#include <mgba/core/core.h>
+#include <mgba/core/timing.h>
+#include <mgba-util/vfs.h>
+
+const char mTR_MAGIC[] = "mTR\1";
+
+struct mDebuggerTraceHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t platform;
+	uint32_t capacity;
+	uint64_t count;
+	uint8_t reserved[0x28];
+};
+static_assert(sizeof(struct mDebuggerTraceHeader) == 0x40, "mDebuggerTraceHeader struct sized wrong");
+static_assert(sizeof(struct mDebuggerTraceEntry) == 0x10, "mDebuggerTraceEntry struct sized wrong");
+
+struct mDebuggerTraceLog {
+	struct mDebuggerTraceHeader header;
+	struct mDebuggerTraceEntry entries[];
+};
+
+static size_t _logSize(uint32_t capacity) {
+	return sizeof(struct mDebuggerTraceHeader) + (size_t) capacity * sizeof(struct mDebuggerTraceEntry);
+}
+
+static void _mDebuggerTraceRecorderEntered(struct mDebuggerModule* debugger, enum mDebuggerEntryReason reason, struct mDebuggerEntryInfo* info) {
+	UNUSED(reason);
+	UNUSED(info);
+	debugger->isPaused = false;
+}
+
+static void _mDebuggerTraceRecorderCallback(struct mDebuggerModule* debugger) {
+	struct mDebuggerTraceRecorder* recorder = (struct mDebuggerTraceRecorder*) debugger;
+	struct mDebugger* parent = recorder->d.p;
+
+	// Modules are also called back while another module holds the debugger paused,
+	// so only record once per step
+	uint64_t time = mTimingGlobalTime(parent->core->timing);
+	if (recorder->primed && time == recorder->lastTime) {
+		return;
+	}
+	recorder->primed = true;
+	recorder->lastTime = time;
+
+	struct mDebuggerTraceEntry entry;
+	uint32_t registers[mDEBUGGER_TRACE_MAX_REGISTERS];
+	size_t nRegisters = parent->platform->nextTraceEntry(parent->platform, &entry, registers);
+
+	uint16_t changed = 0;
+	size_t i;
+	for (i = 0; i < nRegisters; ++i) {
+		if (i >= recorder->nRegisters || registers[i] != recorder->registers[i]) {
+			changed |= 1 << i;
+			recorder->registers[i] = registers[i];
+		}
+	}
+
+	// Registers are sampled before each instruction runs, so what changed since the last
+	// sample was written by the previous instruction
+	if (recorder->nRegisters && recorder->count) {
+		uint32_t previous = recorder->next ? recorder->next - 1 : recorder->capacity - 1;
+		STORE_16LE(changed, 0, &recorder->mapped->entries[previous].changedRegisters);
+	}
+	recorder->nRegisters = nRegisters;
+
+	// The count is only stored once the entry is filled in, so a file left behind by a crash
+	// never claims an entry that was only partially written
+	struct mDebuggerTraceEntry* out = &recorder->mapped->entries[recorder->next];
+	STORE_32LE(entry.pc, 0, &out->pc);
+	STORE_32LE(entry.opcode, 0, &out->opcode);
+	STORE_32LE(entry.flags, 0, &out->flags);
+	STORE_16LE(0, 0, &out->changedRegisters);
+	out->width = entry.width;
+	out->reserved = 0;
+
+	++recorder->next;
+	if (recorder->next == recorder->capacity) {
+		recorder->next = 0;
+	}
+	++recorder->count;
+	STORE_64LE(recorder->count, 0, &recorder->mapped->header.count);
+}
+
+void mDebuggerTraceRecorderInit(struct mDebuggerTraceRecorder* recorder) {
+	memset(recorder, 0, sizeof(*recorder));
+
+	recorder->d.type = DEBUGGER_TRACE_RECORDER;
+	recorder->d.entered = _mDebuggerTraceRecorderEntered;
+	recorder->d.custom = _mDebuggerTraceRecorderCallback;
+}
+
+void mDebuggerTraceRecorderDeinit(struct mDebuggerTraceRecorder* recorder) {
+	mDebuggerTraceRecorderClose(recorder);
+}
+
+static bool mDebuggerTraceRecorderLoad(struct mDebuggerTraceRecorder* recorder, size_t size) {
+	struct mDebuggerTraceHeader* header = &recorder->mapped->header;
+	if (memcmp(header->magic, mTR_MAGIC, sizeof(header->magic)) != 0) {
+		return false;
+	}
+	uint32_t version;
+	LOAD_32LE(version, 0, &header->version);
+	if (version != 1) {
+		return false;
+	}
+
+	enum mPlatform platform;
+	LOAD_32LE(platform, 0, &header->platform);
+	if (platform != recorder->d.p->core->platform(recorder->d.p->core)) {
+		return false;
+	}
+
+	uint32_t capacity;
+	LOAD_32LE(capacity, 0, &header->capacity);
+	if (!capacity || size < _logSize(capacity)) {
+		return false;
+	}
+	recorder->capacity = capacity;
+	LOAD_64LE(recorder->count, 0, &header->count);
+	recorder->next = recorder->count % capacity;
+	return true;
+}
+
+bool mDebuggerTraceRecorderOpen(struct mDebuggerTraceRecorder* recorder, struct VFile* vf, int mode, uint32_t capacity) {
+	if (recorder->backing && !mDebuggerTraceRecorderClose(recorder)) {
+		return false;
+	}
+	if (!capacity) {
+		capacity = mDEBUGGER_TRACE_DEFAULT_CAPACITY;
+	}
+#if __SIZEOF_SIZE_T__ <= 4
+	if (capacity >= 0x8000000) {
+		return false;
+	}
+#endif
+
+	ssize_t size = vf->size(vf);
+	if (size < 0) {
+		return false;
+	}
+	bool create = (mode & O_CREAT) && ((mode & O_TRUNC) || (size_t) size < sizeof(struct mDebuggerTraceHeader));
+	if (create) {
+		vf->truncate(vf, _logSize(capacity));
+		size = _logSize(capacity);
+	} else if ((size_t) size < sizeof(struct mDebuggerTraceHeader)) {
+		return false;
+	}
+
+	recorder->mapped = vf->map(vf, size, MAP_WRITE);
+	if (!recorder->mapped) {
+		return false;
+	}
+	recorder->backing = vf;
+	if (create) {
+		struct mDebuggerTraceHeader* header = &recorder->mapped->header;
+		memset(header, 0, sizeof(*header));
+		memcpy(header->magic, mTR_MAGIC, sizeof(header->magic));
+		STORE_32LE(1, 0, &header->version);
+		STORE_32LE(recorder->d.p->core->platform(recorder->d.p->core), 0, &header->platform);
+		STORE_32LE(capacity, 0, &header->capacity);
+		STORE_64LE(0, 0, &header->count);
+		vf->sync(vf, header, sizeof(*header));
+		recorder->capacity = capacity;
+		recorder->count = 0;
+		recorder->next = 0;
+	} else if (!mDebuggerTraceRecorderLoad(recorder, size)) {
+		vf->unmap(vf, recorder->mapped, size);
+		recorder->mapped = NULL;
+		recorder->backing = NULL;
+		return false;
+	}
+	recorder->nRegisters = 0;
+	recorder->primed = false;
+	return true;
+}
+
+bool mDebuggerTraceRecorderClose(struct mDebuggerTraceRecorder* recorder) {
+	if (!recorder->backing) {
+		return true;
+	}
+	mDebuggerTraceRecorderStop(recorder);
+	size_t size = _logSize(recorder->capacity);
+	recorder->backing->sync(recorder->backing, recorder->mapped, size);
+	recorder->backing->unmap(recorder->backing, recorder->mapped, size);
+	recorder->mapped = NULL;
+	recorder->backing->close(recorder->backing);
+	recorder->backing = NULL;
+	return true;
+}
+
+bool mDebuggerTraceRecorderStart(struct mDebuggerTraceRecorder* recorder) {
+	if (!recorder->backing || !recorder->d.p) {
+		return false;
+	}
+	if (!recorder->d.p->platform->nextTraceEntry) {
+		return false;
+	}
+	recorder->nRegisters = 0;
+	recorder->primed = false;
+	if (recorder->d.p->state > DEBUGGER_CREATED && recorder->d.p->state < DEBUGGER_SHUTDOWN) {
+		// The first callback only comes after the next step, so record the pending instruction now
+		_mDebuggerTraceRecorderCallback(&recorder->d);
+	}
+	mDebuggerModuleSetNeedsCallback(&recorder->d);
+	return true;
+}
+
+void mDebuggerTraceRecorderStop(struct mDebuggerTraceRecorder* recorder) {
+	if (!recorder->d.needsCallback) {
+		return;
+	}
+	mDebuggerModuleClearNeedsCallback(&recorder->d);
+}
+
+size_t mDebuggerTraceRecorderSize(const struct mDebuggerTraceRecorder* recorder) {
+	if (recorder->count > recorder->capacity) {
+		return recorder->capacity;
+	}
+	return recorder->count;
+}
+
+bool mDebuggerTraceRecorderGetEntry(const struct mDebuggerTraceRecorder* recorder, size_t index, struct mDebuggerTraceEntry* entry) {
+	size_t size = mDebuggerTraceRecorderSize(recorder);
+	if (index >= size) {
+		return false;
+	}
+	// Index 0 is the oldest entry still in the ring
+	if (size == recorder->capacity) {
+		index += recorder->next;
+		if (index >= recorder->capacity) {
+			index -= recorder->capacity;
+		}
+	}
+	const struct mDebuggerTraceEntry* in = &recorder->mapped->entries[index];
+	LOAD_32LE(entry->pc, 0, &in->pc);
+	LOAD_32LE(entry->opcode, 0, &in->opcode);
+	LOAD_32LE(entry->flags, 0, &in->flags);
+	LOAD_16LE(entry->changedRegisters, 0, &in->changedRegisters);
+	entry->width = in->width;
+	entry->reserved = in->reserved;
+	return true;
+}
+
+bool mDebuggerTraceRecorderDisassemble(struct mDebuggerTraceRecorder* recorder, struct VFile* out) {
+	if (!recorder->backing || !recorder->d.p->platform->formatTraceEntry) {
+		return false;
+	}
+	struct mDebuggerPlatform* platform = recorder->d.p->platform;
+	char line[256];
+	size_t size = mDebuggerTraceRecorderSize(recorder);
+	size_t i;
+	for (i = 0; i < size; ++i) {
+		struct mDebuggerTraceEntry entry;
+		mDebuggerTraceRecorderGetEntry(recorder, i, &entry);
+		size_t length = sizeof(line) - 1;
+		platform->formatTraceEntry(platform, &entry, line, &length);
+		if (length > sizeof(line) - 2) {
+			length = sizeof(line) - 2;
+		}
+		line[length] = '\n';
+		if (out->write(out, line, length + 1) < 0) {
+			return false;
+		}
+	}
+	return true;
+}
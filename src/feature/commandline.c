@@ -47,6 +47,9 @@ static const struct option _options[] = {
 	{ "log-level", required_argument, 0, 'l' },
 	{ "savestate", required_argument, 0, 't' },
 	{ "patch",     required_argument, 0, 'p' },
+#ifdef ENABLE_HOST_TRACE
+	{ "trace",     required_argument, 0, '\0' },
+#endif
 	{ "version",   no_argument, 0, '\0' },
 	{ 0, 0, 0, 0 }
 };
@@ -125,6 +128,11 @@ bool mArgumentsParse(struct mArguments* args, int argc, char* const* argv, struc
 		case '\0':
 			if (strcmp(opt->name, "version") == 0) {
 				args->showVersion = true;
+#ifdef ENABLE_HOST_TRACE
+			} else if (strcmp(opt->name, "trace") == 0) {
+				free(args->traceFile);
+				args->traceFile = strdup(optarg);
+#endif
 			} else {
 				for (i = 0; i < nSubparsers; ++i) {
 					if (subparsers[i].parseLong) {
@@ -306,6 +314,9 @@ void mArgumentsDeinit(struct mArguments* args) {
 	free(args->bios);
 	args->bios = 0;
 
+	free(args->traceFile);
+	args->traceFile = 0;
+
 	HashTableDeinit(&args->configOverrides);
 }
 
@@ -385,6 +396,9 @@ void usage(const char* arg0, const char* prologue, const char* epilogue, const s
 	     "  -t, --savestate FILE       Load savestate when starting\n"
 	     "  -p, --patch FILE           Apply a specified patch file when running\n"
 	     "  -s, --frameskip N          Skip every N frames\n"
+#ifdef ENABLE_HOST_TRACE
+	     "  --trace FILE               Write a timeline of the emulator's threads to a file\n"
+#endif
 	     "  --version                  Print version and exit"
 	);
 	int i;
@@ -42,6 +42,10 @@ CXX_GUARD_START
 #define FFMPEG_USE_GET_SUPPORTED_CONFIG
 #endif
 
+#if !defined(USE_LIBAV) && LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(58, 27, 100)
+#define FFMPEG_USE_HWACCEL
+#endif
+
 static inline enum AVPixelFormat mColorFormatToFFmpegPixFmt(enum mColorFormat format) {
 	switch (format) {
 #ifndef USE_LIBAV
@@ -4,8 +4,10 @@
  * License, v. 2.0. If a copy of the MPL was not distributed with this
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include "ffmpeg-encoder.h"
+#include "ffmpeg-scale.h"
 
 #include <mgba/core/core.h>
+#include <mgba/core/host-trace.h>
 #include <mgba/gba/interface.h>
 #include <mgba/internal/gba/gba.h>
 #include <mgba-util/math.h>
@@ -23,6 +25,9 @@
 #if LIBAVUTIL_VERSION_MAJOR >= 53
 #include <libavutil/buffer.h>
 #endif
+#ifdef FFMPEG_USE_HWACCEL
+#include <libavutil/hwcontext.h>
+#endif
 #include <libavutil/imgutils.h>
 #include <libavutil/mathematics.h>
 #include <libavutil/opt.h>
@@ -39,10 +44,25 @@ static void _ffmpegPostAudioFrame(struct mAVStream*, int16_t left, int16_t right
 static void _ffmpegSetVideoDimensions(struct mAVStream*, unsigned width, unsigned height);
 static void _ffmpegSetAudioRate(struct mAVStream*, unsigned rate);
 
+static void _ffmpegEncodeAudioSample(struct FFmpegEncoder* encoder, int16_t left, int16_t right);
+static void _ffmpegEncodeVideoFrame(struct FFmpegEncoder* encoder, const mColor* pixels, size_t stride, int64_t frame);
 static bool _ffmpegWriteAudioFrame(struct FFmpegEncoder* encoder, struct AVFrame* audioFrame);
 static bool _ffmpegWriteVideoFrame(struct FFmpegEncoder* encoder, struct AVFrame* videoFrame);
 
+#ifndef DISABLE_THREADING
+static bool _ffmpegStartThread(struct FFmpegEncoder* encoder);
+static void _ffmpegStopThread(struct FFmpegEncoder* encoder);
+static void _ffmpegDrainQueue(struct FFmpegEncoder* encoder);
+static void _ffmpegQueueVideoFrame(struct FFmpegEncoder* encoder, const mColor* pixels, size_t stride, int64_t frame);
+static void _ffmpegQueueAudioSample(struct FFmpegEncoder* encoder, int16_t left, int16_t right);
+static void _ffmpegFlushStagedAudio(struct FFmpegEncoder* encoder);
+#endif
+
 static void _ffmpegOpenResampleContext(struct FFmpegEncoder* encoder);
+static void _ffmpegPalettizeFrame(struct FFmpegEncoder* encoder, const mColor* pixels, size_t stride);
+#ifdef FFMPEG_USE_HWACCEL
+static bool _ffmpegOpenHardwareVideo(struct FFmpegEncoder* encoder, const AVCodec* swCodec);
+#endif
 
 enum {
 	PREFERRED_SAMPLE_RATE = 0x10000
@@ -101,6 +121,17 @@ void FFmpegEncoderInit(struct FFmpegEncoder* encoder) {
 	encoder->source = NULL;
 	encoder->sink = NULL;
 	encoder->sinkFrame = NULL;
+	encoder->hardwareAccel = false;
+	encoder->paletteReuse = false;
+	encoder->lastPixels = NULL;
+	encoder->integerScale = 0;
+	encoder->hwFrame = NULL;
+	encoder->threaded = false;
+	encoder->queuePolicy = FFMPEG_QUEUE_BLOCK;
+#ifndef DISABLE_THREADING
+	encoder->threadRunning = false;
+	memset(&encoder->queueStats, 0, sizeof(encoder->queueStats));
+#endif
 	FFmpegEncoderSetInputFrameRate(encoder, VIDEO_TOTAL_LENGTH, GBA_ARM7TDMI_FREQUENCY);
 
 	int i;
@@ -298,6 +329,39 @@ void FFmpegEncoderSetLooping(struct FFmpegEncoder* encoder, bool loop) {
 	encoder->loop = loop;
 }
 
+void FFmpegEncoderSetHardwareAcceleration(struct FFmpegEncoder* encoder, bool enable) {
+	// Only used if a hardware encoder for the same format as the software one can be opened
+	encoder->hardwareAccel = enable;
+}
+
+void FFmpegEncoderSetPaletteReuse(struct FFmpegEncoder* encoder, bool enable) {
+	// Only affects codecs that take PAL8 input
+	encoder->paletteReuse = enable;
+}
+
+void FFmpegEncoderSetThreaded(struct FFmpegEncoder* encoder, bool threaded, enum FFmpegEncoderQueuePolicy policy) {
+	// Takes effect on the next call to FFmpegEncoderOpen
+	encoder->threaded = threaded;
+	encoder->queuePolicy = policy;
+}
+
+void FFmpegEncoderGetQueueStats(struct FFmpegEncoder* encoder, struct FFmpegEncoderQueueStats* stats) {
+#ifndef DISABLE_THREADING
+	if (encoder->threadRunning) {
+		MutexLock(&encoder->queueMutex);
+		*stats = encoder->queueStats;
+		stats->depth = encoder->queueDepth;
+		MutexUnlock(&encoder->queueMutex);
+		return;
+	}
+	*stats = encoder->queueStats;
+	stats->depth = 0;
+#else
+	UNUSED(encoder);
+	memset(stats, 0, sizeof(*stats));
+#endif
+}
+
 bool FFmpegEncoderVerifyContainer(struct FFmpegEncoder* encoder) {
 	const AVOutputFormat* oformat = av_guess_format(encoder->containerFormat, 0, 0);
 	const AVCodec* acodec = avcodec_find_encoder_by_name(encoder->audioCodec);
@@ -405,7 +469,13 @@ bool FFmpegEncoderOpen(struct FFmpegEncoder* encoder, const char* outfile) {
 #endif
 	}
 
-	if (vcodec) {
+	bool hardwareVideo = false;
+#ifdef FFMPEG_USE_HWACCEL
+	if (vcodec && encoder->hardwareAccel) {
+		hardwareVideo = _ffmpegOpenHardwareVideo(encoder, vcodec);
+	}
+#endif
+	if (vcodec && !hardwareVideo) {
 #ifdef FFMPEG_USE_CODECPAR
 		encoder->videoStream = avformat_new_stream(encoder->context, NULL);
 		encoder->video = avcodec_alloc_context3(vcodec);
@@ -499,7 +569,7 @@ bool FFmpegEncoderOpen(struct FFmpegEncoder* encoder, const char* outfile) {
 			encoder->video->pix_fmt = AV_PIX_FMT_RGB32;
 		}
 
-		if (encoder->pixFormat == AV_PIX_FMT_PAL8) {
+		if (encoder->pixFormat == AV_PIX_FMT_PAL8 && !encoder->paletteReuse) {
 			encoder->graph = avfilter_graph_alloc();
 
 			const struct AVFilter* source = avfilter_get_by_name("buffer");
@@ -551,7 +621,7 @@ bool FFmpegEncoderOpen(struct FFmpegEncoder* encoder, const char* outfile) {
 			return false;
 		}
 		encoder->videoFrame = av_frame_alloc();
-		encoder->videoFrame->format = encoder->video->pix_fmt != AV_PIX_FMT_PAL8 ? encoder->video->pix_fmt : encoder->ipixFormat;
+		encoder->videoFrame->format = encoder->graph ? encoder->ipixFormat : encoder->video->pix_fmt;
 		encoder->videoFrame->width = encoder->video->width;
 		encoder->videoFrame->height = encoder->video->height;
 		encoder->videoFrame->pts = 0;
@@ -578,10 +648,22 @@ bool FFmpegEncoderOpen(struct FFmpegEncoder* encoder, const char* outfile) {
 		FFmpegEncoderClose(encoder);
 		return false;
 	}
+#ifndef DISABLE_THREADING
+	memset(&encoder->queueStats, 0, sizeof(encoder->queueStats));
+	if (encoder->threaded && !_ffmpegStartThread(encoder)) {
+		FFmpegEncoderClose(encoder);
+		return false;
+	}
+#endif
 	return true;
 }
 
 void FFmpegEncoderClose(struct FFmpegEncoder* encoder) {
+#ifndef DISABLE_THREADING
+	if (encoder->threadRunning) {
+		_ffmpegStopThread(encoder);
+	}
+#endif
 	if (encoder->audio) {
 		while (true) {
 			if (!_ffmpegWriteAudioFrame(encoder, NULL)) {
@@ -653,6 +735,15 @@ void FFmpegEncoderClose(struct FFmpegEncoder* encoder) {
 		av_frame_free(&encoder->videoFrame);
 	}
 
+	if (encoder->hwFrame) {
+		av_frame_free(&encoder->hwFrame);
+	}
+
+	if (encoder->lastPixels) {
+		free(encoder->lastPixels);
+		encoder->lastPixels = NULL;
+	}
+
 	if (encoder->sinkFrame) {
 		av_frame_free(&encoder->sinkFrame);
 		encoder->sinkFrame = NULL;
@@ -699,7 +790,16 @@ void _ffmpegPostAudioFrame(struct mAVStream* stream, int16_t left, int16_t right
 	if (!encoder->context || !encoder->audioCodec) {
 		return;
 	}
+#ifndef DISABLE_THREADING
+	if (encoder->threadRunning) {
+		_ffmpegQueueAudioSample(encoder, left, right);
+		return;
+	}
+#endif
+	_ffmpegEncodeAudioSample(encoder, left, right);
+}
 
+void _ffmpegEncodeAudioSample(struct FFmpegEncoder* encoder, int16_t left, int16_t right) {
 	if (encoder->absf && !left) {
 		// XXX: AVBSF doesn't like silence. Figure out why.
 		left = 1;
@@ -824,18 +924,50 @@ void _ffmpegPostVideoFrame(struct mAVStream* stream, const mColor* pixels, size_
 	if (encoder->skipResidue) {
 		return;
 	}
-	stride *= BYTES_PER_PIXEL;
+	int64_t frame = encoder->currentVideoFrame;
+	++encoder->currentVideoFrame;
+#ifndef DISABLE_THREADING
+	if (encoder->threadRunning) {
+		_ffmpegQueueVideoFrame(encoder, pixels, stride, frame);
+		return;
+	}
+#endif
+	mTRACE_BEGIN("FFmpeg: encode video");
+	_ffmpegEncodeVideoFrame(encoder, pixels, stride * BYTES_PER_PIXEL, frame);
+	mTRACE_END();
+}
 
+void _ffmpegEncodeVideoFrame(struct FFmpegEncoder* encoder, const mColor* pixels, size_t stride, int64_t frame) {
 	av_frame_make_writable(encoder->videoFrame);
 	if (encoder->video->codec->id == AV_CODEC_ID_WEBP) {
 		// TODO: Figure out why WebP is rescaling internally (should video frames not be rescaled externally?)
-		encoder->videoFrame->pts = encoder->currentVideoFrame;
+		encoder->videoFrame->pts = frame;
 	} else {
-		encoder->videoFrame->pts = av_rescale_q(encoder->currentVideoFrame, encoder->video->time_base, encoder->videoStream->time_base);
+		encoder->videoFrame->pts = av_rescale_q(frame, encoder->video->time_base, encoder->videoStream->time_base);
+	}
+
+	if (encoder->videoFrame->format == AV_PIX_FMT_PAL8) {
+		_ffmpegPalettizeFrame(encoder, pixels, stride / BYTES_PER_PIXEL);
+	} else if (encoder->integerScale) {
+		FFmpegScaleIntegerToYUV420(pixels, encoder->iwidth, encoder->iheight, stride / BYTES_PER_PIXEL,
+		                           encoder->integerScale, encoder->videoFrame->data, encoder->videoFrame->linesize);
+	} else {
+		sws_scale(encoder->scaleContext, (const uint8_t* const*) &pixels, (const int*) &stride, 0, encoder->iheight, encoder->videoFrame->data, encoder->videoFrame->linesize);
 	}
-	++encoder->currentVideoFrame;
 
-	sws_scale(encoder->scaleContext, (const uint8_t* const*) &pixels, (const int*) &stride, 0, encoder->iheight, encoder->videoFrame->data, encoder->videoFrame->linesize);
+#ifdef FFMPEG_USE_HWACCEL
+	if (encoder->hwFrame) {
+		if (av_hwframe_get_buffer(encoder->video->hw_frames_ctx, encoder->hwFrame, 0) < 0) {
+			return;
+		}
+		if (av_hwframe_transfer_data(encoder->hwFrame, encoder->videoFrame, 0) >= 0) {
+			encoder->hwFrame->pts = encoder->videoFrame->pts;
+			_ffmpegWriteVideoFrame(encoder, encoder->hwFrame);
+		}
+		av_frame_unref(encoder->hwFrame);
+		return;
+	}
+#endif
 
 	if (encoder->graph) {
 		if (av_buffersrc_write_frame(encoder->source, encoder->videoFrame) < 0) {
@@ -898,14 +1030,36 @@ static void _ffmpegSetVideoDimensions(struct mAVStream* stream, unsigned width,
 	if (!encoder->context || !encoder->videoCodec) {
 		return;
 	}
+#ifndef DISABLE_THREADING
+	// The worker scales with these, so let it finish what's already queued first
+	_ffmpegDrainQueue(encoder);
+#endif
 	encoder->iwidth = width;
 	encoder->iheight = height;
 	if (encoder->scaleContext) {
 		sws_freeContext(encoder->scaleContext);
 	}
-	encoder->scaleContext = sws_getContext(encoder->iwidth, encoder->iheight, encoder->ipixFormat,
-	    encoder->videoFrame->width, encoder->videoFrame->height, encoder->videoFrame->format,
-	    SWS_POINT, 0, 0, 0);
+	if (encoder->videoFrame->format == AV_PIX_FMT_PAL8) {
+		// Palettized output is mapped by hand, see _ffmpegPalettizeFrame
+		encoder->scaleContext = NULL;
+		free(encoder->lastPixels);
+		encoder->lastPixels = malloc(encoder->iwidth * encoder->iheight * BYTES_PER_PIXEL);
+		encoder->hasLastFrame = false;
+		encoder->paletteSize = 0;
+	} else {
+		encoder->scaleContext = sws_getContext(encoder->iwidth, encoder->iheight, encoder->ipixFormat,
+		    encoder->videoFrame->width, encoder->videoFrame->height, encoder->videoFrame->format,
+		    SWS_POINT, 0, 0, 0);
+	}
+
+	// Whole-number upscales to YUV420 are common enough to skip swscale for
+	encoder->integerScale = 0;
+	if (encoder->videoFrame->format == AV_PIX_FMT_YUV420P && encoder->iwidth > 0 && encoder->iheight > 0) {
+		unsigned scale = encoder->videoFrame->width / encoder->iwidth;
+		if (scale && encoder->videoFrame->width == (int) scale * encoder->iwidth && encoder->videoFrame->height == (int) scale * encoder->iheight) {
+			encoder->integerScale = scale;
+		}
+	}
 }
 
 static void _ffmpegSetAudioRate(struct mAVStream* stream, unsigned rate) {
@@ -923,6 +1077,9 @@ void FFmpegEncoderSetInputFrameRate(struct FFmpegEncoder* encoder, int numerator
 }
 
 void FFmpegEncoderSetInputSampleRate(struct FFmpegEncoder* encoder, int sampleRate) {
+#ifndef DISABLE_THREADING
+	_ffmpegDrainQueue(encoder);
+#endif
 	encoder->isampleRate = sampleRate;
 	if (encoder->resampleContext) {
 		av_freep(&encoder->audioBuffer);
@@ -958,3 +1115,532 @@ void _ffmpegOpenResampleContext(struct FFmpegEncoder* encoder) {
 	swr_init(encoder->resampleContext);
 #endif
 }
+
+#ifndef DISABLE_THREADING
+static void _ffmpegRunQueueEntry(struct FFmpegEncoder* encoder, const struct FFmpegEncoderQueueEntry* entry) {
+	if (entry->isVideo) {
+		mTRACE_BEGIN("FFmpeg: encode video");
+		_ffmpegEncodeVideoFrame(encoder, entry->pixels, encoder->iwidth * BYTES_PER_PIXEL, entry->frame);
+		mTRACE_END();
+		return;
+	}
+	mTRACE_BEGIN("FFmpeg: encode audio");
+	size_t i;
+	for (i = 0; i < entry->nSamples; ++i) {
+		_ffmpegEncodeAudioSample(encoder, entry->samples[i * 2], entry->samples[i * 2 + 1]);
+	}
+	mTRACE_END();
+}
+
+static THREAD_ENTRY _ffmpegRun(void* context) {
+	struct FFmpegEncoder* encoder = context;
+	ThreadSetName("FFmpeg Encoder");
+	mTRACE_THREAD_NAME("FFmpeg Encoder");
+	MutexLock(&encoder->queueMutex);
+	while (true) {
+		if (encoder->queueDepth) {
+			// The slot stays owned by the worker until the head moves past it
+			struct FFmpegEncoderQueueEntry* entry = &encoder->queue[encoder->queueHead];
+			MutexUnlock(&encoder->queueMutex);
+			_ffmpegRunQueueEntry(encoder, entry);
+			MutexLock(&encoder->queueMutex);
+			encoder->queueHead = (encoder->queueHead + 1) % FFMPEG_QUEUE_SIZE;
+			--encoder->queueDepth;
+			ConditionWake(&encoder->producerCond);
+			continue;
+		}
+		if (encoder->threadShutdown) {
+			break;
+		}
+		ConditionWait(&encoder->workerCond, &encoder->queueMutex);
+	}
+	MutexUnlock(&encoder->queueMutex);
+	THREAD_EXIT(0);
+}
+
+bool _ffmpegStartThread(struct FFmpegEncoder* encoder) {
+	size_t pixels = encoder->iwidth * encoder->iheight;
+	size_t i;
+	for (i = 0; i < FFMPEG_QUEUE_SIZE; ++i) {
+		struct FFmpegEncoderQueueEntry* entry = &encoder->queue[i];
+		entry->pixels = NULL;
+		entry->pixelsCapacity = 0;
+		entry->samples = NULL;
+		if (encoder->videoCodec) {
+			entry->pixels = malloc(pixels * BYTES_PER_PIXEL);
+			entry->pixelsCapacity = pixels;
+		}
+		if (encoder->audioCodec) {
+			entry->samples = malloc(FFMPEG_QUEUE_AUDIO_SAMPLES * 2 * sizeof(int16_t));
+		}
+	}
+	encoder->stagedAudio = malloc(FFMPEG_QUEUE_AUDIO_SAMPLES * 2 * sizeof(int16_t));
+	encoder->stagedSamples = 0;
+	encoder->queueHead = 0;
+	encoder->queueDepth = 0;
+	encoder->threadShutdown = false;
+
+	MutexInit(&encoder->queueMutex);
+	ConditionInit(&encoder->workerCond);
+	ConditionInit(&encoder->producerCond);
+	encoder->threadRunning = true;
+	if (ThreadCreate(&encoder->thread, _ffmpegRun, encoder)) {
+		encoder->threadRunning = false;
+		_ffmpegStopThread(encoder);
+		return false;
+	}
+	return true;
+}
+
+void _ffmpegStopThread(struct FFmpegEncoder* encoder) {
+	if (encoder->threadRunning) {
+		// Hand off the tail end of the audio so the worker can encode it before exiting
+		_ffmpegFlushStagedAudio(encoder);
+		MutexLock(&encoder->queueMutex);
+		encoder->threadShutdown = true;
+		ConditionWake(&encoder->workerCond);
+		MutexUnlock(&encoder->queueMutex);
+		ThreadJoin(&encoder->thread);
+		encoder->threadRunning = false;
+	}
+
+	ConditionDeinit(&encoder->producerCond);
+	ConditionDeinit(&encoder->workerCond);
+	MutexDeinit(&encoder->queueMutex);
+
+	size_t i;
+	for (i = 0; i < FFMPEG_QUEUE_SIZE; ++i) {
+		free(encoder->queue[i].pixels);
+		free(encoder->queue[i].samples);
+		encoder->queue[i].pixels = NULL;
+		encoder->queue[i].samples = NULL;
+	}
+	free(encoder->stagedAudio);
+	encoder->stagedAudio = NULL;
+}
+
+void _ffmpegDrainQueue(struct FFmpegEncoder* encoder) {
+	if (!encoder->threadRunning) {
+		return;
+	}
+	_ffmpegFlushStagedAudio(encoder);
+	mTRACE_BEGIN("FFmpeg: drain queue");
+	MutexLock(&encoder->queueMutex);
+	while (encoder->queueDepth) {
+		ConditionWait(&encoder->producerCond, &encoder->queueMutex);
+	}
+	MutexUnlock(&encoder->queueMutex);
+	mTRACE_END();
+}
+
+static struct FFmpegEncoderQueueEntry* _ffmpegQueueAcquire(struct FFmpegEncoder* encoder, bool droppable) {
+	MutexLock(&encoder->queueMutex);
+	if (encoder->queueDepth == FFMPEG_QUEUE_SIZE) {
+		if (droppable && encoder->queuePolicy == FFMPEG_QUEUE_DROP_VIDEO) {
+			++encoder->queueStats.dropped;
+			MutexUnlock(&encoder->queueMutex);
+			mTRACE_INSTANT("FFmpeg: dropped frame");
+			return NULL;
+		}
+		++encoder->queueStats.stalls;
+		mTRACE_BEGIN("FFmpeg: queue full");
+		do {
+			ConditionWait(&encoder->producerCond, &encoder->queueMutex);
+		} while (encoder->queueDepth == FFMPEG_QUEUE_SIZE);
+		mTRACE_END();
+	}
+	// The worker never looks past the last queued slot, so this one can be filled unlocked
+	struct FFmpegEncoderQueueEntry* entry = &encoder->queue[(encoder->queueHead + encoder->queueDepth) % FFMPEG_QUEUE_SIZE];
+	MutexUnlock(&encoder->queueMutex);
+	return entry;
+}
+
+static void _ffmpegQueueCommit(struct FFmpegEncoder* encoder) {
+	MutexLock(&encoder->queueMutex);
+	++encoder->queueDepth;
+	++encoder->queueStats.queued;
+	if (encoder->queueDepth > encoder->queueStats.maxDepth) {
+		encoder->queueStats.maxDepth = encoder->queueDepth;
+	}
+	mTRACE_COUNTER("FFmpeg: queue depth", encoder->queueDepth);
+	ConditionWake(&encoder->workerCond);
+	MutexUnlock(&encoder->queueMutex);
+}
+
+static void _ffmpegFlushStagedAudio(struct FFmpegEncoder* encoder) {
+	if (!encoder->stagedSamples) {
+		return;
+	}
+	// Dropping audio would desync the streams, so it always waits for a slot
+	struct FFmpegEncoderQueueEntry* entry = _ffmpegQueueAcquire(encoder, false);
+	memcpy(entry->samples, encoder->stagedAudio, encoder->stagedSamples * 2 * sizeof(int16_t));
+	entry->nSamples = encoder->stagedSamples;
+	entry->isVideo = false;
+	encoder->stagedSamples = 0;
+	_ffmpegQueueCommit(encoder);
+}
+
+void _ffmpegQueueVideoFrame(struct FFmpegEncoder* encoder, const mColor* pixels, size_t stride, int64_t frame) {
+	struct FFmpegEncoderQueueEntry* entry = _ffmpegQueueAcquire(encoder, true);
+	if (!entry) {
+		return;
+	}
+	size_t size = encoder->iwidth * encoder->iheight;
+	if (entry->pixelsCapacity < size) {
+		free(entry->pixels);
+		entry->pixels = malloc(size * BYTES_PER_PIXEL);
+		entry->pixelsCapacity = size;
+	}
+	int y;
+	for (y = 0; y < encoder->iheight; ++y) {
+		memcpy(&entry->pixels[y * encoder->iwidth], &pixels[y * stride], encoder->iwidth * BYTES_PER_PIXEL);
+	}
+	entry->isVideo = true;
+	entry->frame = frame;
+	_ffmpegQueueCommit(encoder);
+}
+
+void _ffmpegQueueAudioSample(struct FFmpegEncoder* encoder, int16_t left, int16_t right) {
+	encoder->stagedAudio[encoder->stagedSamples * 2] = left;
+	encoder->stagedAudio[encoder->stagedSamples * 2 + 1] = right;
+	++encoder->stagedSamples;
+	if (encoder->stagedSamples == FFMPEG_QUEUE_AUDIO_SAMPLES) {
+		_ffmpegFlushStagedAudio(encoder);
+	}
+}
+#endif
+
+#ifdef FFMPEG_USE_HWACCEL
+static bool _ffmpegCodecSupportsPixFmt(const AVCodec* codec, enum AVPixelFormat format) {
+	const enum AVPixelFormat* formats;
+#ifdef FFMPEG_USE_GET_SUPPORTED_CONFIG
+	if (avcodec_get_supported_config(NULL, codec, AV_CODEC_CONFIG_PIX_FORMAT, 0, (const void**) &formats, NULL) < 0) {
+		return false;
+	}
+#else
+	formats = codec->pix_fmts;
+#endif
+	if (!formats) {
+		return false;
+	}
+	size_t i;
+	for (i = 0; formats[i] != AV_PIX_FMT_NONE; ++i) {
+		if (formats[i] == format) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static struct AVCodecContext* _ffmpegTryHardwareVideo(struct FFmpegEncoder* encoder, const AVCodec* codec, enum AVHWDeviceType type, bool* uploadFrames) {
+	const AVCodecHWConfig* config = NULL;
+	int i;
+	for (i = 0; (config = avcodec_get_hw_config(codec, i)); ++i) {
+		if (config->device_type == type) {
+			break;
+		}
+	}
+	if (!config) {
+		return NULL;
+	}
+
+	AVBufferRef* device = NULL;
+	if (av_hwdevice_ctx_create(&device, type, NULL, NULL, 0) < 0) {
+		return NULL;
+	}
+
+	struct AVCodecContext* context = avcodec_alloc_context3(codec);
+	*uploadFrames = false;
+	if (config->methods & AV_CODEC_HW_CONFIG_METHOD_HW_FRAMES_CTX) {
+		// Frames get converted to NV12 in system memory as usual, then uploaded
+		AVBufferRef* frames = av_hwframe_ctx_alloc(device);
+		if (!frames) {
+			avcodec_free_context(&context);
+			av_buffer_unref(&device);
+			return NULL;
+		}
+		AVHWFramesContext* framesContext = (AVHWFramesContext*) frames->data;
+		framesContext->format = config->pix_fmt;
+		framesContext->sw_format = AV_PIX_FMT_NV12;
+		framesContext->width = encoder->width;
+		framesContext->height = encoder->height;
+		framesContext->initial_pool_size = 16;
+		if (av_hwframe_ctx_init(frames) < 0) {
+			av_buffer_unref(&frames);
+			avcodec_free_context(&context);
+			av_buffer_unref(&device);
+			return NULL;
+		}
+		context->hw_frames_ctx = frames;
+		context->pix_fmt = config->pix_fmt;
+		*uploadFrames = true;
+	} else if (config->methods & AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX) {
+		// The encoder uploads system memory frames itself
+		if (_ffmpegCodecSupportsPixFmt(codec, AV_PIX_FMT_NV12)) {
+			context->pix_fmt = AV_PIX_FMT_NV12;
+		} else if (_ffmpegCodecSupportsPixFmt(codec, AV_PIX_FMT_YUV420P)) {
+			context->pix_fmt = AV_PIX_FMT_YUV420P;
+		} else {
+			avcodec_free_context(&context);
+			av_buffer_unref(&device);
+			return NULL;
+		}
+		context->hw_device_ctx = av_buffer_ref(device);
+	} else {
+		avcodec_free_context(&context);
+		av_buffer_unref(&device);
+		return NULL;
+	}
+	av_buffer_unref(&device);
+
+	context->width = encoder->width;
+	context->height = encoder->height;
+	context->time_base = (AVRational) { encoder->frameCycles * encoder->frameskip, encoder->cycles };
+	context->framerate = (AVRational) { encoder->cycles, encoder->frameCycles * encoder->frameskip };
+	context->gop_size = 60;
+	context->max_b_frames = 0;
+	if (encoder->context->oformat->flags & AVFMT_GLOBALHEADER) {
+		context->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+	}
+	if (encoder->videoBitrate > 0) {
+		context->bit_rate = encoder->videoBitrate;
+	} else if (av_opt_find(context->priv_data, "cq", NULL, 0, 0)) {
+		// NVENC
+		av_opt_set_int(context->priv_data, "cq", -encoder->videoBitrate, 0);
+	} else if (av_opt_find(context->priv_data, "qp", NULL, 0, 0)) {
+		// VAAPI
+		av_opt_set_int(context->priv_data, "qp", -encoder->videoBitrate, 0);
+	} else {
+		context->flags |= AV_CODEC_FLAG_QSCALE;
+		context->global_quality = -encoder->videoBitrate * FF_QP2LAMBDA;
+	}
+
+	if (avcodec_open2(context, codec, NULL) < 0) {
+		avcodec_free_context(&context);
+		return NULL;
+	}
+	return context;
+}
+
+bool _ffmpegOpenHardwareVideo(struct FFmpegEncoder* encoder, const AVCodec* swCodec) {
+	static const struct {
+		const char* suffix;
+		enum AVHWDeviceType type;
+	} devices[] = {
+		{ "nvenc", AV_HWDEVICE_TYPE_CUDA },
+		{ "vaapi", AV_HWDEVICE_TYPE_VAAPI },
+		{ "qsv", AV_HWDEVICE_TYPE_QSV },
+		{ "videotoolbox", AV_HWDEVICE_TYPE_VIDEOTOOLBOX },
+		{ "mediacodec", AV_HWDEVICE_TYPE_MEDIACODEC },
+	};
+
+	const char* format;
+	switch (swCodec->id) {
+	case AV_CODEC_ID_H264:
+		format = "h264";
+		break;
+	case AV_CODEC_ID_HEVC:
+		format = "hevc";
+		break;
+	case AV_CODEC_ID_VP9:
+		format = "vp9";
+		break;
+	case AV_CODEC_ID_AV1:
+		format = "av1";
+		break;
+	default:
+		return false;
+	}
+	// Hardware encoders can't do lossless or RGB output, so leave those to the software encoder
+	if (encoder->videoBitrate == 0 || strcmp(swCodec->name, "libx264rgb") == 0) {
+		return false;
+	}
+
+	size_t i;
+	for (i = 0; i < sizeof(devices) / sizeof(*devices); ++i) {
+		char name[32];
+		snprintf(name, sizeof(name), "%s_%s", format, devices[i].suffix);
+		const AVCodec* codec = avcodec_find_encoder_by_name(name);
+		if (!codec) {
+			continue;
+		}
+		bool uploadFrames;
+		struct AVCodecContext* context = _ffmpegTryHardwareVideo(encoder, codec, devices[i].type, &uploadFrames);
+		if (!context) {
+			continue;
+		}
+
+		encoder->video = context;
+		encoder->videoStream = avformat_new_stream(encoder->context, NULL);
+		encoder->videoStream->time_base = context->time_base;
+		encoder->videoStream->avg_frame_rate = context->framerate;
+		avcodec_parameters_from_context(encoder->videoStream->codecpar, context);
+
+		encoder->videoFrame = av_frame_alloc();
+		encoder->videoFrame->format = uploadFrames ? AV_PIX_FMT_NV12 : context->pix_fmt;
+		encoder->videoFrame->width = context->width;
+		encoder->videoFrame->height = context->height;
+		encoder->videoFrame->pts = 0;
+		av_frame_get_buffer(encoder->videoFrame, 32);
+		if (uploadFrames) {
+			encoder->hwFrame = av_frame_alloc();
+		}
+		_ffmpegSetVideoDimensions(&encoder->d, encoder->iwidth, encoder->iheight);
+		return true;
+	}
+	return false;
+}
+#endif
+
+static uint32_t _ffmpegColorToARGB(mColor color) {
+#ifndef COLOR_16_BIT
+	return 0xFF000000 | ((color & 0xFF) << 16) | (color & 0xFF00) | ((color >> 16) & 0xFF);
+#elif defined(COLOR_5_6_5)
+	unsigned g = (color >> 5) & 0x3F;
+	return 0xFF000000 | (M_R8(color) << 16) | (((g << 2) | (g >> 4)) << 8) | ((((color >> 11) & 0x1F) * 0x21) >> 2);
+#else
+	return 0xFF000000 | (M_R8(color) << 16) | (M_G8(color) << 8) | M_B8(color);
+#endif
+}
+
+static void _ffmpegResetPalette(struct FFmpegEncoder* encoder) {
+	encoder->paletteSize = 0;
+	encoder->paletteHashed = 0;
+	memset(encoder->paletteValues, 0xFF, sizeof(encoder->paletteValues));
+}
+
+static int _ffmpegNearestPaletteEntry(struct FFmpegEncoder* encoder, uint32_t argb) {
+	int best = 0;
+	int bestDistance = INT_MAX;
+	unsigned i;
+	for (i = 0; i < encoder->paletteSize; ++i) {
+		int dr = (int) ((argb >> 16) & 0xFF) - (int) ((encoder->palette[i] >> 16) & 0xFF);
+		int dg = (int) ((argb >> 8) & 0xFF) - (int) ((encoder->palette[i] >> 8) & 0xFF);
+		int db = (int) (argb & 0xFF) - (int) (encoder->palette[i] & 0xFF);
+		int distance = dr * dr + dg * dg + db * db;
+		if (distance < bestDistance) {
+			bestDistance = distance;
+			best = i;
+		}
+	}
+	return best;
+}
+
+// Returns -1 if the color isn't in the palette and there's no room for it, unless
+// approximate is set, in which case the closest entry is used instead
+static int _ffmpegPaletteIndex(struct FFmpegEncoder* encoder, mColor color, bool approximate) {
+	uint32_t slot = ((uint32_t) color * 0x9E3779B1U) >> 22;
+	while (encoder->paletteValues[slot] >= 0) {
+		if (encoder->paletteKeys[slot] == color) {
+			return encoder->paletteValues[slot];
+		}
+		slot = (slot + 1) & (FFMPEG_PALETTE_HASH_SIZE - 1);
+	}
+
+	int index;
+	uint32_t argb = _ffmpegColorToARGB(color);
+	if (encoder->paletteSize < 256) {
+		index = encoder->paletteSize;
+		encoder->palette[index] = argb;
+		++encoder->paletteSize;
+	} else if (approximate) {
+		index = _ffmpegNearestPaletteEntry(encoder, argb);
+	} else {
+		return -1;
+	}
+	// Keep the table at most half full so probes stay short
+	if (encoder->paletteHashed < FFMPEG_PALETTE_HASH_SIZE / 2) {
+		encoder->paletteKeys[slot] = color;
+		encoder->paletteValues[slot] = index;
+		++encoder->paletteHashed;
+	}
+	return index;
+}
+
+static bool _ffmpegPalettizeRect(struct FFmpegEncoder* encoder, const mColor* pixels, size_t stride, int left, int top, int right, int bottom, bool approximate) {
+	AVFrame* frame = encoder->videoFrame;
+	int owidth = frame->width;
+	int oheight = frame->height;
+	int ox0 = (left * owidth + encoder->iwidth - 1) / encoder->iwidth;
+	int ox1 = ((right + 1) * owidth + encoder->iwidth - 1) / encoder->iwidth;
+	int oy0 = (top * oheight + encoder->iheight - 1) / encoder->iheight;
+	int oy1 = ((bottom + 1) * oheight + encoder->iheight - 1) / encoder->iheight;
+	int y;
+	for (y = oy0; y < oy1 && y < oheight; ++y) {
+		const mColor* row = &pixels[(y * encoder->iheight / oheight) * stride];
+		uint8_t* out = &frame->data[0][y * frame->linesize[0]];
+		int x;
+		for (x = ox0; x < ox1 && x < owidth; ++x) {
+			int index = _ffmpegPaletteIndex(encoder, row[x * encoder->iwidth / owidth], approximate);
+			if (index < 0) {
+				return false;
+			}
+			out[x] = index;
+		}
+	}
+	return true;
+}
+
+void _ffmpegPalettizeFrame(struct FFmpegEncoder* encoder, const mColor* pixels, size_t stride) {
+	int width = encoder->iwidth;
+	int height = encoder->iheight;
+	int top = 0;
+	int bottom = height - 1;
+	int left = 0;
+	int right = width - 1;
+
+	if (encoder->hasLastFrame) {
+		// Only the region that changed since the last frame needs to be remapped
+		const mColor* last = encoder->lastPixels;
+		while (top < height && memcmp(&pixels[top * stride], &last[top * width], width * BYTES_PER_PIXEL) == 0) {
+			++top;
+		}
+		if (top == height) {
+			return;
+		}
+		while (memcmp(&pixels[bottom * stride], &last[bottom * width], width * BYTES_PER_PIXEL) == 0) {
+			--bottom;
+		}
+		left = width;
+		right = 0;
+		int y;
+		for (y = top; y <= bottom; ++y) {
+			const mColor* row = &pixels[y * stride];
+			const mColor* lastRow = &last[y * width];
+			int x;
+			for (x = 0; x < left; ++x) {
+				if (row[x] != lastRow[x]) {
+					left = x;
+					break;
+				}
+			}
+			for (x = width - 1; x > right; --x) {
+				if (row[x] != lastRow[x]) {
+					right = x;
+					break;
+				}
+			}
+		}
+		if (right < left) {
+			right = left;
+		}
+	}
+
+	if (!encoder->hasLastFrame || !_ffmpegPalettizeRect(encoder, pixels, stride, left, top, right, bottom, false)) {
+		// Earlier frames' indices may now be stale, so the whole frame gets redone
+		_ffmpegResetPalette(encoder);
+		_ffmpegPalettizeRect(encoder, pixels, stride, 0, 0, width - 1, height - 1, true);
+		top = 0;
+		bottom = height - 1;
+		left = 0;
+		right = width - 1;
+	}
+
+	int y;
+	for (y = top; y <= bottom; ++y) {
+		memcpy(&encoder->lastPixels[y * width + left], &pixels[y * stride + left], (right - left + 1) * BYTES_PER_PIXEL);
+	}
+	encoder->hasLastFrame = true;
+	memcpy(encoder->videoFrame->data[1], encoder->palette, encoder->paletteSize * sizeof(uint32_t));
+	memset(&encoder->videoFrame->data[1][encoder->paletteSize * sizeof(uint32_t)], 0, (256 - encoder->paletteSize) * sizeof(uint32_t));
+}
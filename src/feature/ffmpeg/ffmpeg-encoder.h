@@ -11,10 +11,38 @@
 CXX_GUARD_START
 
 #include <mgba/core/interface.h>
+#include <mgba-util/threading.h>
 
 #include "feature/ffmpeg/ffmpeg-common.h"
 
 #define FFMPEG_FILTERS_MAX 4
+#define FFMPEG_QUEUE_SIZE 16
+#define FFMPEG_QUEUE_AUDIO_SAMPLES 1024
+#define FFMPEG_PALETTE_HASH_SIZE 1024
+
+enum FFmpegEncoderQueuePolicy {
+	FFMPEG_QUEUE_BLOCK = 0,
+	FFMPEG_QUEUE_DROP_VIDEO,
+};
+
+struct FFmpegEncoderQueueStats {
+	size_t depth;
+	size_t maxDepth;
+	uint64_t queued;
+	uint64_t dropped;
+	uint64_t stalls;
+};
+
+#ifndef DISABLE_THREADING
+struct FFmpegEncoderQueueEntry {
+	bool isVideo;
+	int64_t frame;
+	mColor* pixels;
+	size_t pixelsCapacity;
+	int16_t* samples;
+	size_t nSamples;
+};
+#endif
 
 struct FFmpegEncoder {
 	struct mAVStream d;
@@ -64,13 +92,48 @@ struct FFmpegEncoder {
 	bool loop;
 	int64_t currentVideoFrame;
 	struct SwsContext* scaleContext;
+	unsigned integerScale;
 	struct AVStream* videoStream;
+	bool hardwareAccel;
+	struct AVFrame* hwFrame;
 
 	struct AVFilterGraph* graph;
 	struct AVFilterContext* source;
 	struct AVFilterContext* sink;
 	struct AVFilterContext* filters[FFMPEG_FILTERS_MAX];
 	struct AVFrame* sinkFrame;
+
+	// Palette reuse for PAL8 output: instead of running palettegen over the whole
+	// recording, each frame is mapped against the previous frame's palette, which
+	// only gets rebuilt once a frame no longer fits in it
+	bool paletteReuse;
+	mColor* lastPixels;
+	bool hasLastFrame;
+	uint32_t palette[256];
+	unsigned paletteSize;
+	unsigned paletteHashed;
+	uint32_t paletteKeys[FFMPEG_PALETTE_HASH_SIZE];
+	int16_t paletteValues[FFMPEG_PALETTE_HASH_SIZE];
+
+	bool threaded;
+	enum FFmpegEncoderQueuePolicy queuePolicy;
+#ifndef DISABLE_THREADING
+	// When threaded, frames and audio chunks are copied into a fixed ring and
+	// everything past that (scaling, resampling, encoding and muxing) happens
+	// on the worker. The producer only touches the slot after the last queued one
+	bool threadRunning;
+	bool threadShutdown;
+	Thread thread;
+	Mutex queueMutex;
+	Condition workerCond;
+	Condition producerCond;
+	struct FFmpegEncoderQueueEntry queue[FFMPEG_QUEUE_SIZE];
+	size_t queueHead;
+	size_t queueDepth;
+	int16_t* stagedAudio;
+	size_t stagedSamples;
+	struct FFmpegEncoderQueueStats queueStats;
+#endif
 };
 
 void FFmpegEncoderInit(struct FFmpegEncoder*);
@@ -81,6 +144,10 @@ void FFmpegEncoderSetDimensions(struct FFmpegEncoder*, int width, int height);
 void FFmpegEncoderSetInputFrameRate(struct FFmpegEncoder*, int numerator, int denominator);
 void FFmpegEncoderSetInputSampleRate(struct FFmpegEncoder*, int sampleRate);
 void FFmpegEncoderSetLooping(struct FFmpegEncoder*, bool loop);
+void FFmpegEncoderSetHardwareAcceleration(struct FFmpegEncoder*, bool enable);
+void FFmpegEncoderSetPaletteReuse(struct FFmpegEncoder*, bool enable);
+void FFmpegEncoderSetThreaded(struct FFmpegEncoder*, bool threaded, enum FFmpegEncoderQueuePolicy policy);
+void FFmpegEncoderGetQueueStats(struct FFmpegEncoder*, struct FFmpegEncoderQueueStats* stats);
 bool FFmpegEncoderVerifyContainer(struct FFmpegEncoder*);
 bool FFmpegEncoderOpen(struct FFmpegEncoder*, const char* outfile);
 void FFmpegEncoderClose(struct FFmpegEncoder*);
@@ -7,6 +7,10 @@
 
 #include <libswscale/swscale.h>
 
+#if defined(__SSE2__) && !defined(COLOR_16_BIT)
+#include <emmintrin.h>
+#endif
+
 static const int _qualityToFlags[] = {
 	SWS_POINT,
 	SWS_FAST_BILINEAR,
@@ -34,3 +38,120 @@ void FFmpegScale(const void* input, int iwidth, int iheight, unsigned istride,
 	sws_scale(scaleContext, (const uint8_t* const*) &input, (const int*) &istride, 0, iheight, (uint8_t* const*) &output, (const int*) &ostride);
 	sws_freeContext(scaleContext);
 }
+
+// BT.601 limited range, same as swscale's default for RGB to YUV
+static inline void _rgbToYUV(int r, int g, int b, uint8_t* y, uint8_t* u, uint8_t* v) {
+	*y = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+	*u = (112 * b - 38 * r - 74 * g + 0x8080) >> 8;
+	*v = (112 * r - 94 * g - 18 * b + 0x8080) >> 8;
+}
+
+static void _convertRow(const mColor* row, int width, uint8_t* y, uint8_t* u, uint8_t* v) {
+	int x = 0;
+#if defined(__SSE2__) && !defined(COLOR_16_BIT)
+	// All of the intermediate sums fit in 16 unsigned bits, so wrapping arithmetic is exact
+	__m128i mask = _mm_set1_epi32(0xFF);
+	__m128i zero = _mm_setzero_si128();
+	for (; x + 8 <= width; x += 8) {
+		__m128i lo = _mm_loadu_si128((const __m128i*) &row[x]);
+		__m128i hi = _mm_loadu_si128((const __m128i*) &row[x + 4]);
+		__m128i r = _mm_packs_epi32(_mm_and_si128(lo, mask), _mm_and_si128(hi, mask));
+		__m128i g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(lo, 8), mask), _mm_and_si128(_mm_srli_epi32(hi, 8), mask));
+		__m128i b = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(lo, 16), mask), _mm_and_si128(_mm_srli_epi32(hi, 16), mask));
+
+		__m128i luma = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(66)), _mm_mullo_epi16(g, _mm_set1_epi16(129)));
+		luma = _mm_add_epi16(luma, _mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(25)), _mm_set1_epi16(128)));
+		luma = _mm_add_epi16(_mm_srli_epi16(luma, 8), _mm_set1_epi16(16));
+
+		__m128i cb = _mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(112)), _mm_set1_epi16(0x8080));
+		cb = _mm_sub_epi16(cb, _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(38)), _mm_mullo_epi16(g, _mm_set1_epi16(74))));
+		cb = _mm_srli_epi16(cb, 8);
+
+		__m128i cr = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(112)), _mm_set1_epi16(0x8080));
+		cr = _mm_sub_epi16(cr, _mm_add_epi16(_mm_mullo_epi16(g, _mm_set1_epi16(94)), _mm_mullo_epi16(b, _mm_set1_epi16(18))));
+		cr = _mm_srli_epi16(cr, 8);
+
+		_mm_storel_epi64((__m128i*) &y[x], _mm_packus_epi16(luma, zero));
+		_mm_storel_epi64((__m128i*) &u[x], _mm_packus_epi16(cb, zero));
+		_mm_storel_epi64((__m128i*) &v[x], _mm_packus_epi16(cr, zero));
+	}
+#endif
+	for (; x < width; ++x) {
+		mColor color = row[x];
+#ifndef COLOR_16_BIT
+		_rgbToYUV(color & 0xFF, (color >> 8) & 0xFF, (color >> 16) & 0xFF, &y[x], &u[x], &v[x]);
+#elif defined(COLOR_5_6_5)
+		int g = (color >> 5) & 0x3F;
+		_rgbToYUV(M_R8(color), (g << 2) | (g >> 4), (((color >> 11) & 0x1F) * 0x21) >> 2, &y[x], &u[x], &v[x]);
+#else
+		_rgbToYUV(M_R8(color), M_G8(color), M_B8(color), &y[x], &u[x], &v[x]);
+#endif
+	}
+}
+
+static void _widenPlane(const uint8_t* src, int width, int height, unsigned factor, uint8_t* dst, int stride) {
+	int owidth = width * factor;
+	int y;
+	for (y = 0; y < height; ++y) {
+		uint8_t* row = &dst[y * factor * stride];
+		const uint8_t* in = &src[y * width];
+		if (factor == 1) {
+			memcpy(row, in, width);
+			continue;
+		}
+		int x;
+		for (x = 0; x < width; ++x) {
+			memset(&row[x * factor], in[x], factor);
+		}
+		unsigned i;
+		for (i = 1; i < factor; ++i) {
+			memcpy(&row[i * stride], row, owidth);
+		}
+	}
+}
+
+static void _averageChroma(const uint8_t* src, int width, int height, unsigned scale, uint8_t* dst, int stride) {
+	int owidth = width * scale;
+	int oheight = height * scale;
+	int cwidth = (owidth + 1) / 2;
+	int cheight = (oheight + 1) / 2;
+	int cy;
+	for (cy = 0; cy < cheight; ++cy) {
+		int y1 = cy * 2 + 1 < oheight ? cy * 2 + 1 : oheight - 1;
+		const uint8_t* row0 = &src[(cy * 2 / scale) * width];
+		const uint8_t* row1 = &src[(y1 / scale) * width];
+		uint8_t* out = &dst[cy * stride];
+		int cx;
+		for (cx = 0; cx < cwidth; ++cx) {
+			int x1 = cx * 2 + 1 < owidth ? cx * 2 + 1 : owidth - 1;
+			int x0 = cx * 2 / scale;
+			x1 /= scale;
+			out[cx] = (row0[x0] + row0[x1] + row1[x0] + row1[x1] + 2) >> 2;
+		}
+	}
+}
+
+void FFmpegScaleIntegerToYUV420(const mColor* input, int iwidth, int iheight, size_t istride,
+                                unsigned scale, uint8_t* const planes[3], const int strides[3]) {
+	size_t size = iwidth * iheight;
+	uint8_t* buffer = malloc(size * 3);
+	uint8_t* luma = buffer;
+	uint8_t* cb = &buffer[size];
+	uint8_t* cr = &buffer[size * 2];
+
+	int y;
+	for (y = 0; y < iheight; ++y) {
+		_convertRow(&input[y * istride], iwidth, &luma[y * iwidth], &cb[y * iwidth], &cr[y * iwidth]);
+	}
+
+	_widenPlane(luma, iwidth, iheight, scale, planes[0], strides[0]);
+	if (!(scale & 1)) {
+		// Every chroma sample falls inside a single source pixel
+		_widenPlane(cb, iwidth, iheight, scale / 2, planes[1], strides[1]);
+		_widenPlane(cr, iwidth, iheight, scale / 2, planes[2], strides[2]);
+	} else {
+		_averageChroma(cb, iwidth, iheight, scale, planes[1], strides[1]);
+		_averageChroma(cr, iwidth, iheight, scale, planes[2], strides[2]);
+	}
+	free(buffer);
+}
@@ -16,6 +16,9 @@ void FFmpegScale(const void* input, int iwidth, int iheight, unsigned istride,
                  void* output, int owidth, int oheight, unsigned ostride,
                  enum mColorFormat format, int quality);
 
+void FFmpegScaleIntegerToYUV420(const mColor* input, int iwidth, int iheight, size_t istride,
+                                unsigned scale, uint8_t* const planes[3], const int strides[3]);
+
 CXX_GUARD_END
 
 #endif
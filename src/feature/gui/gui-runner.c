@@ -7,6 +7,7 @@
 
 #include <mgba/core/core.h>
 #include <mgba/core/serialize.h>
+#include <mgba/core/state-thumbnail.h>
 #include "feature/gui/gui-config.h"
 #include "feature/gui/cheats.h"
 #include <mgba/internal/gba/gba.h>
@@ -15,7 +16,6 @@
 #include <mgba-util/gui/file-select.h>
 #include <mgba-util/gui/font.h>
 #include <mgba-util/gui/menu.h>
-#include <mgba-util/image/png-io.h>
 #include <mgba-util/memory.h>
 #include <mgba-util/vfs.h>
 
@@ -128,39 +128,27 @@ static void _drawState(struct GUIBackground* background, void* id) {
 			gbaBackground->p->drawScreenshot(gbaBackground->p, pixels, gbaBackground->w, gbaBackground->h, true);
 			return;
 		} else if (gbaBackground->screenshotId != (stateId | SCREENSHOT_INVALID)) {
-			struct VFile* vf = mCoreGetState(gbaBackground->p->core, stateId, false);
-			bool success = false;
-			unsigned w, h;
-			if (vf && isPNG(vf)) {
-				png_structp png = PNGReadOpen(vf, PNG_HEADER_BYTES);
-				png_infop info = png_create_info_struct(png);
-				png_infop end = png_create_info_struct(png);
-				success = png && info && end;
-				success = success && PNGReadHeader(png, info);
-				w = png_get_image_width(png, info);
-				h = png_get_image_height(png, info);
-				size_t size = w * h * BYTES_PER_PIXEL;
-				success = success && (w < 0x4000) && (h < 0x4000);
-				if (success) {
-					if (size != gbaBackground->imageSize) {
-						mappedMemoryFree(pixels, gbaBackground->imageSize);
-						pixels = anonymousMemoryMap(size);
-						gbaBackground->image = pixels;
-						gbaBackground->imageSize = size;
-					}
-					success = pixels;
-				}
-				success = success && PNGReadPixels(png, info, pixels, w, h, w);
-				if (success) {
-					gbaBackground->w = w;
-					gbaBackground->h = h;
+			struct mStateThumbnail thumbnail;
+			mStateThumbnailInit(&thumbnail);
+			bool success = mCoreLoadStateThumbnail(gbaBackground->p->core, stateId, &thumbnail) && thumbnail.pixels;
+			unsigned w = thumbnail.width;
+			unsigned h = thumbnail.height;
+			size_t size = w * h * BYTES_PER_PIXEL;
+			if (success) {
+				if (size != gbaBackground->imageSize) {
+					mappedMemoryFree(pixels, gbaBackground->imageSize);
+					pixels = anonymousMemoryMap(size);
+					gbaBackground->image = pixels;
+					gbaBackground->imageSize = size;
 				}
-				success = success && PNGReadFooter(png, end);
-				PNGReadClose(png, info, end);
+				success = pixels;
 			}
-			if (vf) {
-				vf->close(vf);
+			if (success) {
+				memcpy(pixels, thumbnail.pixels, size);
+				gbaBackground->w = w;
+				gbaBackground->h = h;
 			}
+			mStateThumbnailDeinit(&thumbnail);
 			if (success) {
 				gbaBackground->p->drawScreenshot(gbaBackground->p, pixels, w, h, true);
 				gbaBackground->screenshotId = stateId | SCREENSHOT_VALID;
@@ -0,0 +1,215 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/feature/netplay.h>
+
+#include <mgba/core/log.h>
+
+// Every message is a type and player byte followed by a frame number and any payload.
+// The first message each side sends is a greeting with the protocol version in place
+// of a player, and a magic number in place of a frame.
+#define NETPLAY_HEADER_SIZE 6
+#define NETPLAY_HELLO 0x80
+#define NETPLAY_MAGIC 0x4C4E626D
+#define NETPLAY_VERSION 2
+
+mLOG_DEFINE_CATEGORY(NETPLAY, "Netplay", "feature.netplay");
+
+static void _netplaySend(struct mCoreRollbackTransport* transport, const struct mCoreRollbackMessage* message);
+static bool _netplayReceive(struct mCoreRollbackTransport* transport, struct mCoreRollbackMessage* message);
+
+static size_t _messageSize(uint8_t type) {
+	switch (type) {
+	case NETPLAY_HELLO:
+		return NETPLAY_HEADER_SIZE;
+	case mROLLBACK_MESSAGE_INPUT:
+		return NETPLAY_HEADER_SIZE + 4;
+	case mROLLBACK_MESSAGE_CHECKSUM:
+		return NETPLAY_HEADER_SIZE + 8;
+	default:
+		return 0;
+	}
+}
+
+// Fields aren't aligned within a message, so they go through properly aligned copies
+static void _write32(uint8_t* buffer, uint32_t value) {
+	uint32_t aligned;
+	STORE_32LE(value, 0, &aligned);
+	memcpy(buffer, &aligned, sizeof(aligned));
+}
+
+static void _write64(uint8_t* buffer, uint64_t value) {
+	uint64_t aligned;
+	STORE_64LE(value, 0, &aligned);
+	memcpy(buffer, &aligned, sizeof(aligned));
+}
+
+static uint32_t _read32(const uint8_t* buffer) {
+	uint32_t aligned;
+	uint32_t value;
+	memcpy(&aligned, buffer, sizeof(aligned));
+	LOAD_32LE(value, 0, &aligned);
+	return value;
+}
+
+static uint64_t _read64(const uint8_t* buffer) {
+	uint64_t aligned;
+	uint64_t value;
+	memcpy(&aligned, buffer, sizeof(aligned));
+	LOAD_64LE(value, 0, &aligned);
+	return value;
+}
+
+static bool _sendMessage(struct mNetplayTransport* netplay, uint8_t type, uint8_t player, uint32_t frame, uint64_t payload) {
+	uint8_t message[mNETPLAY_MESSAGE_SIZE];
+	size_t size = _messageSize(type);
+	message[0] = type;
+	message[1] = player;
+	_write32(&message[2], frame);
+	if (type == mROLLBACK_MESSAGE_INPUT) {
+		_write32(&message[NETPLAY_HEADER_SIZE], payload);
+	} else if (type == mROLLBACK_MESSAGE_CHECKSUM) {
+		_write64(&message[NETPLAY_HEADER_SIZE], payload);
+	}
+	size_t sent = 0;
+	while (sent < size) {
+		ssize_t result = SocketSend(netplay->socket, &message[sent], size - sent);
+		if (result > 0) {
+			sent += result;
+		} else if (!SocketWouldBlock()) {
+			return false;
+		} else {
+			Socket writes = netplay->socket;
+			SocketPoll(0, NULL, &writes, NULL, 100);
+		}
+	}
+	return true;
+}
+
+static void _disconnect(struct mNetplayTransport* netplay) {
+	if (netplay->connected) {
+		mLOG(NETPLAY, WARN, "Peer disconnected");
+		netplay->connected = false;
+	}
+}
+
+static bool _start(struct mNetplayTransport* netplay) {
+	netplay->d.send = _netplaySend;
+	netplay->d.receive = _netplayReceive;
+	netplay->buffered = 0;
+	SocketSetTCPPush(netplay->socket, 1);
+	if (!SocketSetBlocking(netplay->socket, false)) {
+		mNetplayTransportDeinit(netplay);
+		return false;
+	}
+	netplay->connected = true;
+	if (!_sendMessage(netplay, NETPLAY_HELLO, NETPLAY_VERSION, NETPLAY_MAGIC, 0)) {
+		mNetplayTransportDeinit(netplay);
+		return false;
+	}
+	return true;
+}
+
+bool mNetplayTransportListen(struct mNetplayTransport* netplay, int port, const struct Address* bindAddress, int timeoutMs) {
+	memset(netplay, 0, sizeof(*netplay));
+	netplay->socket = INVALID_SOCKET;
+	Socket server = SocketOpenTCP(port, bindAddress);
+	if (SOCKET_FAILED(server)) {
+		mLOG(NETPLAY, ERROR, "Couldn't open socket");
+		return false;
+	}
+	if (SocketListen(server, 1)) {
+		mLOG(NETPLAY, ERROR, "Couldn't listen on port");
+		SocketClose(server);
+		return false;
+	}
+	Socket reads = server;
+	if (SocketPoll(1, &reads, NULL, NULL, timeoutMs) < 1) {
+		SocketClose(server);
+		return false;
+	}
+	netplay->socket = SocketAccept(server, NULL);
+	SocketClose(server);
+	if (SOCKET_FAILED(netplay->socket)) {
+		return false;
+	}
+	return _start(netplay);
+}
+
+bool mNetplayTransportConnect(struct mNetplayTransport* netplay, int port, const struct Address* address) {
+	memset(netplay, 0, sizeof(*netplay));
+	netplay->socket = SocketConnectTCP(port, address);
+	if (SOCKET_FAILED(netplay->socket)) {
+		mLOG(NETPLAY, ERROR, "Couldn't connect to peer");
+		return false;
+	}
+	return _start(netplay);
+}
+
+void mNetplayTransportDeinit(struct mNetplayTransport* netplay) {
+	if (!SOCKET_FAILED(netplay->socket)) {
+		SocketClose(netplay->socket);
+		netplay->socket = INVALID_SOCKET;
+	}
+	netplay->connected = false;
+}
+
+void _netplaySend(struct mCoreRollbackTransport* transport, const struct mCoreRollbackMessage* message) {
+	struct mNetplayTransport* netplay = (struct mNetplayTransport*) transport;
+	if (!netplay->connected) {
+		return;
+	}
+	uint64_t payload = message->type == mROLLBACK_MESSAGE_CHECKSUM ? message->checksum : message->keys;
+	if (!_sendMessage(netplay, message->type, message->player, message->frame, payload)) {
+		_disconnect(netplay);
+	}
+}
+
+bool _netplayReceive(struct mCoreRollbackTransport* transport, struct mCoreRollbackMessage* message) {
+	struct mNetplayTransport* netplay = (struct mNetplayTransport*) transport;
+	while (netplay->connected) {
+		size_t size = netplay->buffered ? _messageSize(netplay->buffer[0]) : 1;
+		if (!size) {
+			mLOG(NETPLAY, ERROR, "Received unknown message type %02X", netplay->buffer[0]);
+			_disconnect(netplay);
+			return false;
+		}
+		if (netplay->buffered < size) {
+			ssize_t result = SocketRecv(netplay->socket, &netplay->buffer[netplay->buffered], size - netplay->buffered);
+			if (result < 0 && SocketWouldBlock()) {
+				return false;
+			}
+			if (result <= 0) {
+				_disconnect(netplay);
+				return false;
+			}
+			netplay->buffered += result;
+			continue;
+		}
+		netplay->buffered = 0;
+
+		uint8_t type = netplay->buffer[0];
+		message->player = netplay->buffer[1];
+		message->frame = _read32(&netplay->buffer[2]);
+		switch (type) {
+		case NETPLAY_HELLO:
+			if (message->frame != NETPLAY_MAGIC || message->player != NETPLAY_VERSION) {
+				mLOG(NETPLAY, ERROR, "Peer uses an incompatible protocol");
+				_disconnect(netplay);
+			}
+			continue;
+		case mROLLBACK_MESSAGE_INPUT:
+			message->type = mROLLBACK_MESSAGE_INPUT;
+			message->keys = _read32(&netplay->buffer[NETPLAY_HEADER_SIZE]);
+			break;
+		case mROLLBACK_MESSAGE_CHECKSUM:
+			message->type = mROLLBACK_MESSAGE_CHECKSUM;
+			message->checksum = _read64(&netplay->buffer[NETPLAY_HEADER_SIZE]);
+			break;
+		}
+		return true;
+	}
+	return false;
+}
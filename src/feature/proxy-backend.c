@@ -116,6 +116,21 @@ static void _mVideoProxyBackendSetImage(struct VideoBackend* v, enum VideoLayer
 	mVideoProxyBackendSubmit(proxy, &cmd, NULL);
 }
 
+static void _mVideoProxyBackendSetImageRect(struct VideoBackend* v, enum VideoLayer layer, const struct mRectangle* rect, const void* frame) {
+	struct mVideoProxyBackend* proxy = (struct mVideoProxyBackend*) v;
+	struct mVideoBackendCommand cmd = {
+		.cmd = mVB_CMD_SET_IMAGE_RECT,
+		.layer = layer,
+		.data = {
+			.r = {
+				.rect = *rect,
+				.image = frame,
+			}
+		}
+	};
+	mVideoProxyBackendSubmit(proxy, &cmd, NULL);
+}
+
 static void _mVideoProxyBackendDrawFrame(struct VideoBackend* v) {
 	struct mVideoProxyBackend* proxy = (struct mVideoProxyBackend*) v;
 	struct mVideoBackendCommand cmd = {
@@ -138,36 +153,27 @@ void mVideoProxyBackendInit(struct mVideoProxyBackend* proxy, struct VideoBacken
 	proxy->d.setImageSize = _mVideoProxyBackendSetImageSize;
 	proxy->d.imageSize = _mVideoProxyBackendImageSize;
 	proxy->d.setImage = _mVideoProxyBackendSetImage;
+	proxy->d.setImageRect = _mVideoProxyBackendSetImageRect;
 	proxy->d.drawFrame = _mVideoProxyBackendDrawFrame;
 	proxy->backend = backend;
 
 	RingFIFOInit(&proxy->in, sizeof(union mVideoBackendCommandData) * 0x80);
 	RingFIFOInit(&proxy->out, sizeof(union mVideoBackendCommandData) * 0x80);
-	MutexInit(&proxy->inLock);
-	MutexInit(&proxy->outLock);
-	ConditionInit(&proxy->inWait);
-	ConditionInit(&proxy->outWait);
 
 	proxy->wakeupCb = NULL;
 	proxy->context = NULL;
 }
 
 void mVideoProxyBackendDeinit(struct mVideoProxyBackend* proxy) {
-	ConditionDeinit(&proxy->inWait);
-	ConditionDeinit(&proxy->outWait);
-	MutexDeinit(&proxy->inLock);
-	MutexDeinit(&proxy->outLock);
 	RingFIFODeinit(&proxy->in);
 	RingFIFODeinit(&proxy->out);
 }
 
 void mVideoProxyBackendSubmit(struct mVideoProxyBackend* proxy, const struct mVideoBackendCommand* cmd, union mVideoBackendCommandData* out) {
-	MutexLock(&proxy->inLock);
-	while (!RingFIFOWrite(&proxy->in, cmd, sizeof(*cmd))) {
+	if (!RingFIFOWrite(&proxy->in, cmd, sizeof(*cmd))) {
 		mLOG(VIDEO, DEBUG, "Can't write command. Proxy thread asleep?");
-		ConditionWait(&proxy->inWait, &proxy->inLock);
+		RingFIFOWriteWait(&proxy->in, cmd, sizeof(*cmd));
 	}
-	MutexUnlock(&proxy->inLock);
 	if (proxy->wakeupCb) {
 		proxy->wakeupCb(proxy, proxy->context);
 	}
@@ -176,11 +182,7 @@ void mVideoProxyBackendSubmit(struct mVideoProxyBackend* proxy, const struct mVi
 		return;
 	}
 
-	MutexLock(&proxy->outLock);
-	while (!RingFIFORead(&proxy->out, out, sizeof(*out))) {
-		ConditionWait(&proxy->outWait, &proxy->outLock);
-	}
-	MutexUnlock(&proxy->outLock);
+	RingFIFOReadWait(&proxy->out, out, sizeof(*out));
 }
 
 bool mVideoProxyBackendRun(struct mVideoProxyBackend* proxy, bool block) {
@@ -225,6 +227,13 @@ bool mVideoProxyBackendRun(struct mVideoProxyBackend* proxy, bool block) {
 			case mVB_CMD_DRAW_FRAME:
 				proxy->backend->drawFrame(proxy->backend);
 				break;
+			case mVB_CMD_SET_IMAGE_RECT:
+				if (proxy->backend->setImageRect) {
+					proxy->backend->setImageRect(proxy->backend, cmd.layer, &cmd.data.r.rect, cmd.data.r.image);
+				} else {
+					proxy->backend->setImage(proxy->backend, cmd.layer, cmd.data.r.image);
+				}
+				break;
 			}
 			if (mVideoProxyBackendCommandIsBlocking(cmd.cmd)) {
 				mVideoProxyBackendWriteOut(proxy, &out);
@@ -236,32 +245,21 @@ bool mVideoProxyBackendRun(struct mVideoProxyBackend* proxy, bool block) {
 }
 
 bool mVideoProxyBackendReadIn(struct mVideoProxyBackend* proxy, struct mVideoBackendCommand* cmd, bool block) {
-	bool gotCmd = false;
-	MutexLock(&proxy->inLock);
-	do {
-		gotCmd = RingFIFORead(&proxy->in, cmd, sizeof(*cmd));
-		ConditionWake(&proxy->inWait);
-		// TODO: interlock?
-		if (block && !gotCmd) {
-			mLOG(VIDEO, DEBUG, "Can't read command. Runner thread asleep?");
-		}
-	} while (block && !gotCmd);
-	MutexUnlock(&proxy->inLock);
-	return gotCmd;
+	if (RingFIFORead(&proxy->in, cmd, sizeof(*cmd))) {
+		return true;
+	}
+	if (!block) {
+		return false;
+	}
+	mLOG(VIDEO, DEBUG, "Can't read command. Runner thread asleep?");
+	return RingFIFOReadWait(&proxy->in, cmd, sizeof(*cmd));
 }
 
 void mVideoProxyBackendWriteOut(struct mVideoProxyBackend* proxy, const union mVideoBackendCommandData* out) {
-	bool gotReply = false;
-	MutexLock(&proxy->outLock);
-	while (!gotReply) {
-		gotReply = RingFIFOWrite(&proxy->out, out, sizeof(*out));
-		ConditionWake(&proxy->outWait);
-		// TOOD: interlock?
-		if (!gotReply) {
-			mLOG(VIDEO, DEBUG, "Can't write reply. Runner thread asleep?");
-		}
+	if (!RingFIFOWrite(&proxy->out, out, sizeof(*out))) {
+		mLOG(VIDEO, DEBUG, "Can't write reply. Runner thread asleep?");
+		RingFIFOWriteWait(&proxy->out, out, sizeof(*out));
 	}
-	MutexUnlock(&proxy->outLock);
 }
 
 bool mVideoProxyBackendCommandIsBlocking(enum mVideoBackendCommandType cmd) {
@@ -279,6 +277,7 @@ bool mVideoProxyBackendCommandIsBlocking(enum mVideoBackendCommandType cmd) {
 	case mVB_CMD_SWAP:
 	case mVB_CMD_IMAGE_SIZE:
 	case mVB_CMD_SET_IMAGE:
+	case mVB_CMD_SET_IMAGE_RECT:
 		return true;
 	}
 
@@ -6,18 +6,58 @@
 #include "no-intro.h"
 
 #include <mgba-util/string.h>
+#include <mgba-util/table.h>
 #include <mgba-util/vector.h>
 #include <mgba-util/vfs.h>
 
 #include <sqlite3.h>
 
+static const char mNI_MAGIC[] = "mNI\1";
+
+// The prebuilt index is laid out as the header, the entries sorted by CRC32,
+// the entry numbers sorted by MD5 and then by SHA-1, and finally the string pool
+struct NoIntroIndexHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t count;
+	uint32_t md5Offset;
+	uint32_t sha1Offset;
+	uint32_t stringsOffset;
+	uint32_t stringsSize;
+	uint32_t reserved;
+};
+static_assert(sizeof(struct NoIntroIndexHeader) == 0x20, "NoIntroIndexHeader struct sized wrong");
+
+struct NoIntroIndexEntry {
+	uint32_t crc32;
+	uint32_t size;
+	uint32_t name;
+	uint32_t romName;
+	uint8_t md5[16];
+	uint8_t sha1[20];
+	uint32_t flags;
+};
+static_assert(sizeof(struct NoIntroIndexEntry) == 0x38, "NoIntroIndexEntry struct sized wrong");
+
 struct NoIntroDB {
 	sqlite3* db;
 	sqlite3_stmt* crc32;
 	sqlite3_stmt* md5;
 	sqlite3_stmt* sha1;
+
+	struct VFile* index;
+	void* mapped;
+	size_t mappedSize;
+	uint32_t count;
+	const struct NoIntroIndexEntry* entries;
+	const uint8_t* md5Order;
+	const uint8_t* sha1Order;
+	const char* strings;
+	uint32_t stringsSize;
 };
 
+static void _extractGame(sqlite3_stmt* stmt, struct NoIntroGame* game);
+
 struct NoIntroDB* NoIntroDBLoad(const char* path) {
 	struct NoIntroDB* db = calloc(1, sizeof(*db));
 
@@ -80,6 +120,9 @@ error:
 }
 
 bool NoIntroDBLoadClrMamePro(struct NoIntroDB* db, struct VFile* vf) {
+	if (!db->db) {
+		return false;
+	}
 	struct NoIntroGame buffer = { 0 };
 
 	sqlite3_stmt* gamedbTable = NULL;
@@ -308,7 +351,222 @@ bool NoIntroDBLoadClrMamePro(struct NoIntroDB* db, struct VFile* vf) {
 	return true;
 }
 
+static bool _validIndexRange(uint32_t offset, uint64_t size, size_t total) {
+	return offset >= sizeof(struct NoIntroIndexHeader) && offset <= total && size <= total - offset;
+}
+
+struct NoIntroDB* NoIntroDBLoadIndex(struct VFile* vf) {
+	ssize_t size = vf->size(vf);
+	if (size < (ssize_t) sizeof(struct NoIntroIndexHeader)) {
+		return NULL;
+	}
+	void* mapped = vf->map(vf, size, MAP_READ);
+	if (!mapped) {
+		return NULL;
+	}
+
+	const struct NoIntroIndexHeader* header = mapped;
+	uint32_t version;
+	uint32_t count;
+	uint32_t md5Offset;
+	uint32_t sha1Offset;
+	uint32_t stringsOffset;
+	uint32_t stringsSize;
+	LOAD_32LE(version, 0, &header->version);
+	LOAD_32LE(count, 0, &header->count);
+	LOAD_32LE(md5Offset, 0, &header->md5Offset);
+	LOAD_32LE(sha1Offset, 0, &header->sha1Offset);
+	LOAD_32LE(stringsOffset, 0, &header->stringsOffset);
+	LOAD_32LE(stringsSize, 0, &header->stringsSize);
+	const char* strings = (const char*) mapped + stringsOffset;
+	if (memcmp(header->magic, mNI_MAGIC, sizeof(header->magic)) != 0 || version != 1 ||
+	    !_validIndexRange(sizeof(*header), (uint64_t) count * sizeof(struct NoIntroIndexEntry), size) ||
+	    !_validIndexRange(md5Offset, (uint64_t) count * sizeof(uint32_t), size) ||
+	    !_validIndexRange(sha1Offset, (uint64_t) count * sizeof(uint32_t), size) ||
+	    !_validIndexRange(stringsOffset, stringsSize, size) ||
+	    !stringsSize || strings[stringsSize - 1]) {
+		vf->unmap(vf, mapped, size);
+		return NULL;
+	}
+
+	struct NoIntroDB* db = calloc(1, sizeof(*db));
+	db->index = vf;
+	db->mapped = mapped;
+	db->mappedSize = size;
+	db->count = count;
+	db->entries = (const struct NoIntroIndexEntry*) &header[1];
+	db->md5Order = (const uint8_t*) mapped + md5Offset;
+	db->sha1Order = (const uint8_t*) mapped + sha1Offset;
+	db->strings = strings;
+	db->stringsSize = stringsSize;
+	return db;
+}
+
+struct NoIntroIndexRow {
+	struct NoIntroIndexEntry entry;
+	uint32_t row;
+};
+
+struct NoIntroIndexHash {
+	uint8_t hash[20];
+	uint32_t entry;
+};
+
+static int _rowCompare(const void* a, const void* b) {
+	const struct NoIntroIndexRow* ra = a;
+	const struct NoIntroIndexRow* rb = b;
+	if (ra->entry.crc32 != rb->entry.crc32) {
+		return ra->entry.crc32 < rb->entry.crc32 ? -1 : 1;
+	}
+	// Keep rows with the same CRC32 in database order so lookups stay stable
+	if (ra->row != rb->row) {
+		return ra->row < rb->row ? -1 : 1;
+	}
+	return 0;
+}
+
+static int _hashCompare(const void* a, const void* b) {
+	const struct NoIntroIndexHash* ha = a;
+	const struct NoIntroIndexHash* hb = b;
+	int cmp = memcmp(ha->hash, hb->hash, sizeof(ha->hash));
+	if (cmp) {
+		return cmp;
+	}
+	if (ha->entry != hb->entry) {
+		return ha->entry < hb->entry ? -1 : 1;
+	}
+	return 0;
+}
+
+static uint32_t _poolString(struct Table* pool, char** strings, size_t* size, size_t* capacity, const char* string) {
+	if (!string) {
+		string = "";
+	}
+	// Offsets are stored biased by one so that a missing key can be told apart from offset zero
+	uintptr_t offset = (uintptr_t) HashTableLookup(pool, string);
+	if (offset) {
+		return offset - 1;
+	}
+	size_t length = strlen(string) + 1;
+	while (*size + length > *capacity) {
+		*capacity *= 2;
+		*strings = realloc(*strings, *capacity);
+	}
+	memcpy(&(*strings)[*size], string, length);
+	offset = *size;
+	*size += length;
+	HashTableInsert(pool, string, (void*) (offset + 1));
+	return offset;
+}
+
+static bool _writeHashOrder(struct VFile* vf, struct NoIntroIndexHash* hashes, const struct NoIntroIndexRow* rows, size_t count, size_t hashOffset, size_t hashSize) {
+	size_t i;
+	for (i = 0; i < count; ++i) {
+		memset(hashes[i].hash, 0, sizeof(hashes[i].hash));
+		memcpy(hashes[i].hash, (const uint8_t*) &rows[i].entry + hashOffset, hashSize);
+		hashes[i].entry = i;
+	}
+	qsort(hashes, count, sizeof(*hashes), _hashCompare);
+	for (i = 0; i < count; ++i) {
+		uint32_t entry;
+		STORE_32LE(hashes[i].entry, 0, &entry);
+		if (vf->write(vf, &entry, sizeof(entry)) != sizeof(entry)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool NoIntroDBWriteIndex(const struct NoIntroDB* db, struct VFile* vf) {
+	if (!db->db) {
+		return false;
+	}
+	sqlite3_stmt* select = NULL;
+	static const char selectAll[] = "SELECT games.name, roms.name, size, crc32, md5, sha1, flags FROM games JOIN roms USING (gid) ORDER BY roms.rowid;";
+	if (sqlite3_prepare_v2(db->db, selectAll, -1, &select, NULL)) {
+		return false;
+	}
+
+	struct Table pool;
+	HashTableInit(&pool, 0x2000, NULL);
+	size_t stringsSize = 0;
+	size_t stringsCapacity = 0x10000;
+	char* strings = malloc(stringsCapacity);
+
+	size_t count = 0;
+	size_t capacity = 0x1000;
+	struct NoIntroIndexRow* rows = malloc(capacity * sizeof(*rows));
+	while (sqlite3_step(select) == SQLITE_ROW) {
+		if (count == capacity) {
+			capacity *= 2;
+			rows = realloc(rows, capacity * sizeof(*rows));
+		}
+		struct NoIntroIndexRow* row = &rows[count];
+		struct NoIntroGame game = {0};
+		_extractGame(select, &game);
+		memset(row, 0, sizeof(*row));
+		row->row = count;
+		row->entry.crc32 = game.crc32;
+		row->entry.size = game.size;
+		row->entry.name = _poolString(&pool, &strings, &stringsSize, &stringsCapacity, game.name);
+		row->entry.romName = _poolString(&pool, &strings, &stringsSize, &stringsCapacity, game.romName);
+		memcpy(row->entry.md5, game.md5, sizeof(row->entry.md5));
+		memcpy(row->entry.sha1, game.sha1, sizeof(row->entry.sha1));
+		row->entry.flags = game.verified;
+		++count;
+	}
+	sqlite3_finalize(select);
+	HashTableDeinit(&pool);
+	if (!stringsSize) {
+		strings[0] = '\0';
+		stringsSize = 1;
+	}
+
+	qsort(rows, count, sizeof(*rows), _rowCompare);
+
+	struct NoIntroIndexHeader header = {0};
+	size_t md5Offset = sizeof(header) + count * sizeof(struct NoIntroIndexEntry);
+	size_t sha1Offset = md5Offset + count * sizeof(uint32_t);
+	size_t stringsOffset = sha1Offset + count * sizeof(uint32_t);
+	memcpy(header.magic, mNI_MAGIC, sizeof(header.magic));
+	STORE_32LE(1, 0, &header.version);
+	STORE_32LE(count, 0, &header.count);
+	STORE_32LE(md5Offset, 0, &header.md5Offset);
+	STORE_32LE(sha1Offset, 0, &header.sha1Offset);
+	STORE_32LE(stringsOffset, 0, &header.stringsOffset);
+	STORE_32LE(stringsSize, 0, &header.stringsSize);
+
+	bool success = vf->write(vf, &header, sizeof(header)) == sizeof(header);
+	size_t i;
+	for (i = 0; i < count && success; ++i) {
+		struct NoIntroIndexEntry entry = rows[i].entry;
+		STORE_32LE(rows[i].entry.crc32, 0, &entry.crc32);
+		STORE_32LE(rows[i].entry.size, 0, &entry.size);
+		STORE_32LE(rows[i].entry.name, 0, &entry.name);
+		STORE_32LE(rows[i].entry.romName, 0, &entry.romName);
+		STORE_32LE(rows[i].entry.flags, 0, &entry.flags);
+		success = vf->write(vf, &entry, sizeof(entry)) == sizeof(entry);
+	}
+	if (success) {
+		struct NoIntroIndexHash* hashes = malloc((count ? count : 1) * sizeof(*hashes));
+		success = _writeHashOrder(vf, hashes, rows, count, offsetof(struct NoIntroIndexEntry, md5), sizeof(rows->entry.md5)) &&
+		          _writeHashOrder(vf, hashes, rows, count, offsetof(struct NoIntroIndexEntry, sha1), sizeof(rows->entry.sha1));
+		free(hashes);
+	}
+	if (success) {
+		success = vf->write(vf, strings, stringsSize) == (ssize_t) stringsSize;
+	}
+
+	free(rows);
+	free(strings);
+	return success;
+}
+
 void NoIntroDBDestroy(struct NoIntroDB* db) {
+	if (db->index) {
+		db->index->unmap(db->index, db->mapped, db->mappedSize);
+		db->index->close(db->index);
+	}
 	if (db->crc32) {
 		sqlite3_finalize(db->crc32);
 	}
@@ -324,7 +582,7 @@ void NoIntroDBDestroy(struct NoIntroDB* db) {
 	free(db);
 }
 
-void _extractGame(sqlite3_stmt* stmt, struct NoIntroGame* game) {
+static void _extractGame(sqlite3_stmt* stmt, struct NoIntroGame* game) {
 	game->name = (const char*) sqlite3_column_text(stmt, 0);
 	game->romName = (const char*) sqlite3_column_text(stmt, 1);
 	game->size = sqlite3_column_int(stmt, 2);
@@ -340,10 +598,79 @@ void _extractGame(sqlite3_stmt* stmt, struct NoIntroGame* game) {
 	game->verified = sqlite3_column_int(stmt, 6);
 }
 
+static void _extractIndexGame(const struct NoIntroDB* db, uint32_t index, struct NoIntroGame* game) {
+	const struct NoIntroIndexEntry* entry = &db->entries[index];
+	uint32_t name;
+	uint32_t romName;
+	uint32_t flags;
+	LOAD_32LE(game->crc32, 0, &entry->crc32);
+	LOAD_32LE(game->size, 0, &entry->size);
+	LOAD_32LE(name, 0, &entry->name);
+	LOAD_32LE(romName, 0, &entry->romName);
+	LOAD_32LE(flags, 0, &entry->flags);
+	game->name = name < db->stringsSize ? &db->strings[name] : "";
+	game->romName = romName < db->stringsSize ? &db->strings[romName] : "";
+	memcpy(game->md5, entry->md5, sizeof(game->md5));
+	memcpy(game->sha1, entry->sha1, sizeof(game->sha1));
+	game->verified = flags & 1;
+}
+
+static bool _lookupIndexHash(const struct NoIntroDB* db, const uint8_t* order, size_t hashOffset, const uint8_t* hash, size_t hashSize, struct NoIntroGame* game) {
+	uint32_t low = 0;
+	uint32_t high = db->count;
+	while (low < high) {
+		uint32_t mid = low + (high - low) / 2;
+		uint32_t index;
+		LOAD_32LE(index, mid * sizeof(uint32_t), order);
+		if (index >= db->count) {
+			return false;
+		}
+		if (memcmp((const uint8_t*) &db->entries[index] + hashOffset, hash, hashSize) < 0) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	if (low == db->count) {
+		return false;
+	}
+	uint32_t index;
+	LOAD_32LE(index, low * sizeof(uint32_t), order);
+	if (index >= db->count || memcmp((const uint8_t*) &db->entries[index] + hashOffset, hash, hashSize) != 0) {
+		return false;
+	}
+	_extractIndexGame(db, index, game);
+	return true;
+}
+
 bool NoIntroDBLookupGameByCRC(const struct NoIntroDB* db, uint32_t crc32, struct NoIntroGame* game) {
 	if (!db) {
 		return false;
 	}
+	if (db->mapped) {
+		uint32_t low = 0;
+		uint32_t high = db->count;
+		while (low < high) {
+			uint32_t mid = low + (high - low) / 2;
+			uint32_t entry;
+			LOAD_32LE(entry, 0, &db->entries[mid].crc32);
+			if (entry < crc32) {
+				low = mid + 1;
+			} else {
+				high = mid;
+			}
+		}
+		if (low == db->count) {
+			return false;
+		}
+		uint32_t entry;
+		LOAD_32LE(entry, 0, &db->entries[low].crc32);
+		if (entry != crc32) {
+			return false;
+		}
+		_extractIndexGame(db, low, game);
+		return true;
+	}
 	sqlite3_clear_bindings(db->crc32);
 	sqlite3_reset(db->crc32);
 	sqlite3_bind_int(db->crc32, 1, crc32);
@@ -358,6 +685,9 @@ bool NoIntroDBLookupGameByMD5(const struct NoIntroDB* db, const uint8_t* md5, st
 	if (!db) {
 		return false;
 	}
+	if (db->mapped) {
+		return _lookupIndexHash(db, db->md5Order, offsetof(struct NoIntroIndexEntry, md5), md5, 16, game);
+	}
 	sqlite3_clear_bindings(db->md5);
 	sqlite3_reset(db->md5);
 	sqlite3_bind_blob(db->md5, 1, md5, 16, NULL);
@@ -372,6 +702,9 @@ bool NoIntroDBLookupGameBySHA1(const struct NoIntroDB* db, const uint8_t* sha1,
 	if (!db) {
 		return false;
 	}
+	if (db->mapped) {
+		return _lookupIndexHash(db, db->sha1Order, offsetof(struct NoIntroIndexEntry, sha1), sha1, 20, game);
+	}
 	sqlite3_clear_bindings(db->sha1);
 	sqlite3_reset(db->sha1);
 	sqlite3_bind_blob(db->sha1, 1, sha1, 20, NULL);
@@ -25,6 +25,8 @@ struct VFile;
 
 struct NoIntroDB* NoIntroDBLoad(const char* path);
 bool NoIntroDBLoadClrMamePro(struct NoIntroDB* db, struct VFile* vf);
+struct NoIntroDB* NoIntroDBLoadIndex(struct VFile* vf);
+bool NoIntroDBWriteIndex(const struct NoIntroDB* db, struct VFile* vf);
 void NoIntroDBDestroy(struct NoIntroDB* db);
 bool NoIntroDBLookupGameByCRC(const struct NoIntroDB* db, uint32_t crc32, struct NoIntroGame* game);
 bool NoIntroDBLookupGameByMD5(const struct NoIntroDB* db, const uint8_t* md5, struct NoIntroGame* game);
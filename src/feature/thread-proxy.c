@@ -5,6 +5,7 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/feature/thread-proxy.h>
 
+#include <mgba/core/host-trace.h>
 #include <mgba/core/tile-cache.h>
 #include <mgba/internal/gba/gba.h>
 
@@ -28,6 +29,8 @@ static void _wake(struct mVideoLogger* logger, int y);
 void mVideoThreadProxyCreate(struct mVideoThreadProxy* renderer) {
 	mVideoLoggerRendererCreate(&renderer->d, false);
 	renderer->d.block = true;
+	renderer->d.sharedVRAM = true;
+	memset(&renderer->threadPolicy, 0, sizeof(renderer->threadPolicy));
 
 	renderer->d.init = mVideoThreadProxyInit;
 	renderer->d.reset = mVideoThreadProxyReset;
@@ -104,15 +107,18 @@ static bool _writeData(struct mVideoLogger* logger, const void* data, size_t len
 	struct mVideoThreadProxy* proxyRenderer = (struct mVideoThreadProxy*) logger;
 	while (!RingFIFOWrite(&proxyRenderer->dirtyQueue, data, length)) {
 		mLOG(GBA_VIDEO, DEBUG, "Can't write %"PRIz"u bytes. Proxy thread asleep?", length);
+		mTRACE_BEGIN("Proxy: queue full");
 		MutexLock(&proxyRenderer->mutex);
 		if (proxyRenderer->threadState == PROXY_THREAD_STOPPED) {
 			mLOG(GBA_VIDEO, ERROR, "Proxy thread stopped prematurely!");
 			MutexUnlock(&proxyRenderer->mutex);
+			mTRACE_END();
 			return false;
 		}
 		ConditionWake(&proxyRenderer->toThreadCond);
 		ConditionWait(&proxyRenderer->fromThreadCond, &proxyRenderer->mutex);
 		MutexUnlock(&proxyRenderer->mutex);
+		mTRACE_END();
 	}
 	return true;
 }
@@ -136,6 +142,7 @@ static bool _readData(struct mVideoLogger* logger, void* data, size_t length, bo
 
 static void _postEvent(struct mVideoLogger* logger, enum mVideoLoggerEvent event) {
 	struct mVideoThreadProxy* proxyRenderer = (struct mVideoThreadProxy*) logger;
+	mTRACE_BEGIN("Proxy: post event");
 	MutexLock(&proxyRenderer->mutex);
 	proxyRenderer->event = event;
 	while (proxyRenderer->event) {
@@ -143,6 +150,7 @@ static void _postEvent(struct mVideoLogger* logger, enum mVideoLoggerEvent event
 		ConditionWait(&proxyRenderer->fromThreadCond, &proxyRenderer->mutex);
 	}
 	MutexUnlock(&proxyRenderer->mutex);
+	mTRACE_END();
 }
 
 static void _lock(struct mVideoLogger* logger) {
@@ -157,12 +165,14 @@ static void _wait(struct mVideoLogger* logger) {
 		_proxyThreadRecover(proxyRenderer);
 		return;
 	}
+	mTRACE_BEGIN("Proxy: wait for renderer");
 	MutexLock(&proxyRenderer->mutex);
 	while (RingFIFOSize(&proxyRenderer->dirtyQueue)) {
 		ConditionWake(&proxyRenderer->toThreadCond);
 		ConditionWait(&proxyRenderer->fromThreadCond, &proxyRenderer->mutex);
 	}
 	MutexUnlock(&proxyRenderer->mutex);
+	mTRACE_END();
 }
 
 static void _unlock(struct mVideoLogger* logger) {
@@ -180,6 +190,8 @@ static void _wake(struct mVideoLogger* logger, int y) {
 static THREAD_ENTRY _proxyThread(void* logger) {
 	struct mVideoThreadProxy* proxyRenderer = logger;
 	ThreadSetName("Proxy Rendering");
+	mTRACE_THREAD_NAME("Proxy Rendering");
+	ThreadSetPolicy(&proxyRenderer->threadPolicy);
 
 	MutexLock(&proxyRenderer->mutex);
 	ConditionWake(&proxyRenderer->fromThreadCond);
@@ -190,15 +202,19 @@ static THREAD_ENTRY _proxyThread(void* logger) {
 		}
 		proxyRenderer->threadState = PROXY_THREAD_BUSY;
 		if (proxyRenderer->event) {
+			mTRACE_BEGIN("Proxy: handle event");
 			proxyRenderer->d.handleEvent(&proxyRenderer->d, proxyRenderer->event);
 			proxyRenderer->event = 0;
+			mTRACE_END();
 		} else {
 			MutexUnlock(&proxyRenderer->mutex);
+			mTRACE_BEGIN("Proxy: render");
 			if (!mVideoLoggerRendererRun(&proxyRenderer->d, false)) {
 				// FIFO was corrupted
 				proxyRenderer->threadState = PROXY_THREAD_STOPPED;
 				mLOG(GBA_VIDEO, ERROR, "Proxy thread queue got corrupted!");
 			}
+			mTRACE_END();
 			MutexLock(&proxyRenderer->mutex);
 		}
 		ConditionWake(&proxyRenderer->fromThreadCond);
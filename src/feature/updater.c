@@ -37,6 +37,12 @@ static void _updateUpdate(struct mUpdate* update, const char* item, const char*
 		update->commit = value;
 	} else if (strcmp("sha256", item) == 0) {
 		update->sha256 = value;
+	} else if (strcmp("delta", item) == 0) {
+		update->deltaPath = value;
+	} else if (strcmp("delta.size", item) == 0) {
+		update->deltaSize = strtoull(value, NULL, 10);
+	} else if (strcmp("delta.base", item) == 0) {
+		update->deltaBase = value;
 	}
 }
 
@@ -140,6 +146,16 @@ void mUpdateRecord(struct mCoreConfig* config, const char* prefix, const struct
 	mCoreConfigSetValue(config, key, update->commit);
 	snprintf(key, sizeof(key), "%s.sha256", prefix);
 	mCoreConfigSetValue(config, key, update->sha256);
+	snprintf(key, sizeof(key), "%s.delta", prefix);
+	mCoreConfigSetValue(config, key, update->deltaPath);
+	snprintf(key, sizeof(key), "%s.delta.size", prefix);
+	if (update->deltaPath) {
+		mCoreConfigSetUIntValue(config, key, update->deltaSize);
+	} else {
+		mCoreConfigSetValue(config, key, NULL);
+	}
+	snprintf(key, sizeof(key), "%s.delta.base", prefix);
+	mCoreConfigSetValue(config, key, update->deltaBase);
 }
 
 bool mUpdateLoad(const struct mCoreConfig* config, const char* prefix, struct mUpdate* update) {
@@ -162,6 +178,14 @@ bool mUpdateLoad(const struct mCoreConfig* config, const char* prefix, struct mU
 	update->commit = mCoreConfigGetValue(config, key);
 	snprintf(key, sizeof(key), "%s.sha256", prefix);
 	update->sha256 = mCoreConfigGetValue(config, key);
+	snprintf(key, sizeof(key), "%s.delta", prefix);
+	update->deltaPath = mCoreConfigGetValue(config, key);
+	snprintf(key, sizeof(key), "%s.delta.size", prefix);
+	size = 0;
+	mCoreConfigGetUIntValue(config, key, &size);
+	update->deltaSize = size;
+	snprintf(key, sizeof(key), "%s.delta.base", prefix);
+	update->deltaBase = mCoreConfigGetValue(config, key);
 	return true;
 }
 
@@ -225,3 +249,14 @@ bool mUpdateGetArchivePath(const struct mCoreConfig* config, char* out, size_t o
 	snprintf(&out[start], outLength, PATH_SEP "update.%s", extension);
 	return true;
 }
+
+bool mUpdateGetBaseArchivePath(const char* extension, char* out, size_t outLength) {
+	if (!extension) {
+		return false;
+	}
+	mCoreConfigDirectory(out, outLength);
+	size_t start = strlen(out);
+	outLength -= start;
+	snprintf(&out[start], outLength, PATH_SEP "update-base.%s", extension);
+	return true;
+}
@@ -6,6 +6,8 @@
 #include <mgba/feature/video-logger.h>
 
 #include <mgba-util/memory.h>
+#include <mgba-util/threading.h>
+#include <mgba-util/vector.h>
 #include <mgba-util/vfs.h>
 #include <mgba-util/math.h>
 
@@ -22,6 +24,8 @@
 
 #define BUFFER_BASE_SIZE 0x20000
 #define MAX_BLOCK_SIZE 0x800000
+#define MAX_COMPRESSION_THREADS 8
+#define COMPRESSION_QUEUE_SIZE (MAX_COMPRESSION_THREADS * 2)
 
 const char mVL_MAGIC[] = "mVL\0";
 
@@ -43,11 +47,14 @@ enum mVLBlockType {
 	mVL_BLOCK_INITIAL_STATE,
 	mVL_BLOCK_CHANNEL_HEADER,
 	mVL_BLOCK_DATA,
+	mVL_BLOCK_KEYFRAME,
+	mVL_BLOCK_INDEX,
 	mVL_BLOCK_FOOTER = 0x784C566D
 };
 
 enum mVLHeaderFlag {
-	mVL_FLAG_HAS_INITIAL_STATE = 1
+	mVL_FLAG_HAS_INITIAL_STATE = 1,
+	mVL_FLAG_HAS_INDEX = 2
 };
 
 struct mVLBlockHeader {
@@ -91,6 +98,32 @@ struct mVideoLogChannel {
 	struct mCircleBuffer buffer;
 };
 
+// The index block sits right before the footer and lists the frame number and file
+// offset of each keyframe block. Keyframes hold a savestate taken once a frame has
+// been finished and flushed, so reading can resume right after one.
+struct mVLIndexEntry {
+	uint32_t frame;
+	off_t offset;
+};
+
+DECLARE_VECTOR(mVLIndex, struct mVLIndexEntry);
+DEFINE_VECTOR(mVLIndex, struct mVLIndexEntry);
+
+#ifdef USE_ZLIB
+struct mVLCompressionJob {
+	uint32_t blockType;
+	uint32_t channelId;
+	uint32_t frame;
+	void* data;
+	size_t size;
+	size_t capacity;
+	void* compressed;
+	size_t compressedSize;
+	size_t compressedCapacity;
+	bool done;
+};
+#endif
+
 struct mVideoLogContext {
 	void* initialState;
 	size_t initialStateSize;
@@ -101,6 +134,31 @@ struct mVideoLogContext {
 	bool compression;
 	uint32_t activeChannel;
 	struct VFile* backing;
+	struct mCore* core;
+	uint32_t flags;
+
+	uint32_t frames;
+	unsigned indexInterval;
+	bool keyframePending;
+	struct mVLIndex index;
+	ssize_t seekEntry;
+
+#ifdef USE_ZLIB
+	// Blocks are independent deflate streams, so they're compressed on worker
+	// threads and written out in order as they finish
+	struct mVLCompressionJob jobs[COMPRESSION_QUEUE_SIZE];
+	size_t jobWrite;
+	size_t jobNext;
+	size_t jobQueued;
+#ifndef DISABLE_THREADING
+	unsigned nThreads;
+	Thread threads[MAX_COMPRESSION_THREADS];
+	Mutex jobMutex;
+	Condition jobCond;
+	Condition jobDoneCond;
+	bool stopping;
+#endif
+#endif
 };
 
 
@@ -111,6 +169,9 @@ static bool _readData(struct mVideoLogger* logger, void* data, size_t length, bo
 static ssize_t mVideoLoggerReadChannel(struct mVideoLogChannel* channel, void* data, size_t length);
 static ssize_t mVideoLoggerWriteChannel(struct mVideoLogChannel* channel, const void* data, size_t length);
 
+static void _finishFrame(struct mVideoLogContext* context);
+static void _flushFrame(struct mVideoLogContext* context);
+
 static inline size_t _roundUp(size_t value, int shift) {
 	value += (1 << shift) - 1;
 	return value >> shift;
@@ -136,6 +197,7 @@ void mVideoLoggerRendererCreate(struct mVideoLogger* logger, bool readonly) {
 
 	logger->block = readonly;
 	logger->waitOnFlush = !readonly;
+	logger->sharedVRAM = false;
 }
 
 void mVideoLoggerRendererInit(struct mVideoLogger* logger) {
@@ -146,6 +208,20 @@ void mVideoLoggerRendererInit(struct mVideoLogger* logger) {
 	logger->vramDirtyBitmap = calloc(_roundUp(logger->vramSize, 17), sizeof(uint32_t));
 	logger->oamDirtyBitmap = calloc(_roundUp(logger->oamSize, 6), sizeof(uint32_t));
 
+	// Swaps carry a single word of the dirty bitmap
+	if (logger->vramSize > 0x20000) {
+		logger->sharedVRAM = false;
+	}
+	if (logger->sharedVRAM) {
+		logger->vramBuffers[0] = logger->vram;
+		logger->vramBuffers[1] = anonymousMemoryMap(logger->vramSize);
+		logger->vramStaleBitmap[0] = calloc(_roundUp(logger->vramSize, 17), sizeof(uint32_t));
+		logger->vramStaleBitmap[1] = calloc(_roundUp(logger->vramSize, 17), sizeof(uint32_t));
+		logger->vramBack = 1;
+		logger->vramSwapsQueued = 0;
+		logger->vramSwapsDone = 0;
+	}
+
 	if (logger->init) {
 		logger->init(logger);
 	}
@@ -157,8 +233,15 @@ void mVideoLoggerRendererDeinit(struct mVideoLogger* logger) {
 	}
 
 	mappedMemoryFree(logger->palette, logger->paletteSize);
-	mappedMemoryFree(logger->vram, logger->vramSize);
 	mappedMemoryFree(logger->oam, logger->oamSize);
+	if (logger->sharedVRAM) {
+		mappedMemoryFree(logger->vramBuffers[0], logger->vramSize);
+		mappedMemoryFree(logger->vramBuffers[1], logger->vramSize);
+		free(logger->vramStaleBitmap[0]);
+		free(logger->vramStaleBitmap[1]);
+	} else {
+		mappedMemoryFree(logger->vram, logger->vramSize);
+	}
 
 	free(logger->vramDirtyBitmap);
 	free(logger->oamDirtyBitmap);
@@ -171,6 +254,21 @@ void mVideoLoggerRendererReset(struct mVideoLogger* logger) {
 	if (logger->reset) {
 		logger->reset(logger);
 	}
+
+	if (logger->sharedVRAM) {
+		// Any swaps still queued were dropped by the reset, so bring both snapshots up to date
+		size_t i;
+		for (i = 0; i < logger->vramSize; i += 0x1000) {
+			const uint16_t* block = logger->vramBlock(logger, i);
+			memcpy(&logger->vramBuffers[0][i >> 1], block, 0x1000);
+			memcpy(&logger->vramBuffers[1][i >> 1], block, 0x1000);
+		}
+		memset(logger->vramStaleBitmap[0], 0, sizeof(uint32_t) * _roundUp(logger->vramSize, 17));
+		memset(logger->vramStaleBitmap[1], 0, sizeof(uint32_t) * _roundUp(logger->vramSize, 17));
+		logger->vramBack = logger->vram == logger->vramBuffers[0];
+		logger->vramSwapsQueued = 0;
+		ATOMIC_STORE(logger->vramSwapsDone, 0);
+	}
 }
 
 void mVideoLoggerRendererWriteVideoRegister(struct mVideoLogger* logger, uint32_t address, uint16_t value) {
@@ -211,7 +309,47 @@ void mVideoLoggerRendererWriteOAM(struct mVideoLogger* logger, uint32_t address,
 	logger->writeData(logger, &dirty, sizeof(dirty));
 }
 
+static void _flushSharedVRAM(struct mVideoLogger* logger) {
+	uint32_t dirty = logger->vramDirtyBitmap[0];
+	if (!dirty) {
+		return;
+	}
+	unsigned swapsDone;
+	ATOMIC_LOAD(swapsDone, logger->vramSwapsDone);
+	int back = logger->vramBack;
+	if (swapsDone != logger->vramSwapsQueued) {
+		// The reader may still be using either snapshot, so these blocks go through the
+		// queue and land in the one it swaps to last
+		logger->vramStaleBitmap[back][0] |= dirty;
+		return;
+	}
+
+	uint32_t changed = dirty | logger->vramStaleBitmap[back][0];
+	logger->vramDirtyBitmap[0] = 0;
+	logger->vramStaleBitmap[back][0] = 0;
+	logger->vramStaleBitmap[!back][0] |= dirty;
+	int j;
+	for (j = 0; j < mVL_MAX_CHANNELS; ++j) {
+		if (changed & (1U << j)) {
+			memcpy(&logger->vramBuffers[back][j * 0x800], logger->vramBlock(logger, j * 0x1000), 0x1000);
+		}
+	}
+
+	struct mVideoLoggerDirtyInfo swap = {
+		DIRTY_VRAM_SWAP,
+		back,
+		changed,
+		0xDEADBEEF,
+	};
+	++logger->vramSwapsQueued;
+	logger->vramBack = !back;
+	logger->writeData(logger, &swap, sizeof(swap));
+}
+
 static void _flushVRAM(struct mVideoLogger* logger) {
+	if (logger->sharedVRAM) {
+		_flushSharedVRAM(logger);
+	}
 	size_t i;
 	for (i = 0; i < _roundUp(logger->vramSize, 17); ++i) {
 		if (logger->vramDirtyBitmap[i]) {
@@ -265,6 +403,10 @@ void mVideoLoggerRendererFlush(struct mVideoLogger* logger) {
 		0xDEADBEEF,
 	};
 	logger->writeData(logger, &dirty, sizeof(dirty));
+	if (logger->writeData == _writeData && logger->dataContext) {
+		struct mVideoLogChannel* channel = logger->dataContext;
+		_flushFrame(channel->p);
+	}
 	if (logger->waitOnFlush && logger->wait) {
 		logger->wait(logger);
 	}
@@ -278,6 +420,10 @@ void mVideoLoggerRendererFinishFrame(struct mVideoLogger* logger) {
 		0xDEADBEEF,
 	};
 	logger->writeData(logger, &dirty, sizeof(dirty));
+	if (logger->writeData == _writeData && logger->dataContext) {
+		struct mVideoLogChannel* channel = logger->dataContext;
+		_finishFrame(channel->p);
+	}
 }
 
 void mVideoLoggerWriteBuffer(struct mVideoLogger* logger, uint32_t bufferId, uint32_t offset, uint32_t length, const void* data) {
@@ -327,6 +473,14 @@ bool mVideoLoggerRendererRun(struct mVideoLogger* logger, bool block) {
 				return true;
 			}
 			break;
+		case DIRTY_VRAM_SWAP:
+			if (!logger->sharedVRAM || item.address > 1) {
+				return false;
+			}
+			logger->vram = logger->vramBuffers[item.address];
+			logger->parsePacket(logger, &item);
+			ATOMIC_ADD(logger->vramSwapsDone, 1);
+			break;
 		default:
 			return false;
 		}
@@ -372,52 +526,30 @@ static bool _readData(struct mVideoLogger* logger, void* data, size_t length, bo
 }
 
 #ifdef USE_ZLIB
-static void _copyVf(struct VFile* dest, struct VFile* src) {
-	size_t size = src->size(src);
-	void* mem = src->map(src, size, MAP_READ);
-	dest->write(dest, mem, size);
-	src->unmap(src, mem, size);
-}
-
-static void _compress(struct VFile* dest, struct VFile* src) {
-	uint8_t writeBuffer[0x800];
-	uint8_t compressBuffer[0x400];
+static bool _compress(const void* in, size_t size, void** out, size_t* outSize, size_t* capacity) {
 	z_stream zstr = {0};
-	zstr.avail_in = 0;
-	zstr.avail_out = sizeof(compressBuffer);
-	zstr.next_out = (Bytef*) compressBuffer;
 	if (deflateInit(&zstr, 9) != Z_OK) {
-		return;
+		return false;
 	}
-
-	while (true) {
-		size_t read = src->read(src, writeBuffer, sizeof(writeBuffer));
-		if (!read) {
-			break;
-		}
-		zstr.avail_in = read;
-		zstr.next_in = (Bytef*) writeBuffer;
-		while (zstr.avail_in) {
-			if (deflate(&zstr, Z_NO_FLUSH) == Z_STREAM_ERROR) {
-				break;
-			}
-			dest->write(dest, compressBuffer, sizeof(compressBuffer) - zstr.avail_out);
-			zstr.avail_out = sizeof(compressBuffer);
-			zstr.next_out = (Bytef*) compressBuffer;
+	size_t bound = deflateBound(&zstr, size);
+	if (bound > *capacity) {
+		free(*out);
+		*out = malloc(bound);
+		if (!*out) {
+			*capacity = 0;
+			deflateEnd(&zstr);
+			return false;
 		}
+		*capacity = bound;
 	}
-
-	do {
-		zstr.avail_out = sizeof(compressBuffer);
-		zstr.next_out = (Bytef*) compressBuffer;
-		zstr.avail_in = 0;
-		int ret = deflate(&zstr, Z_FINISH);
-		if (ret == Z_STREAM_ERROR) {
-			break;
-		}
-		dest->write(dest, compressBuffer, sizeof(compressBuffer) - zstr.avail_out);
-	} while (sizeof(compressBuffer) - zstr.avail_out);
+	zstr.next_in = (Bytef*) in;
+	zstr.avail_in = size;
+	zstr.next_out = (Bytef*) *out;
+	zstr.avail_out = bound;
+	int ret = deflate(&zstr, Z_FINISH);
+	*outSize = bound - zstr.avail_out;
 	deflateEnd(&zstr);
+	return ret == Z_STREAM_END;
 }
 
 static bool _decompress(struct VFile* dest, struct VFile* src, size_t compressedLength) {
@@ -502,8 +634,11 @@ struct mVideoLogContext* mVideoLogContextCreate(struct mCore* core) {
 	memset(context, 0, sizeof(*context));
 
 	context->write = !!core;
+	context->core = core;
 	context->initialStateSize = 0;
 	context->initialState = NULL;
+	mVLIndexInit(&context->index, 0);
+	context->seekEntry = -1;
 
 #ifdef USE_ZLIB
 	context->compression = true;
@@ -556,14 +691,14 @@ void mVideoLogContextWriteHeader(struct mVideoLogContext* context, struct mCore*
 		if (context->compression) {
 			STORE_32LE(mVL_FLAG_BLOCK_COMPRESSED, 0, &chheader.flags);
 
-			struct VFile* vfm = VFileMemChunk(NULL, 0);
-			struct VFile* src = VFileFromConstMemory(context->initialState, context->initialStateSize);
-			_compress(vfm, src);
-			src->close(src);
-			STORE_32LE(vfm->size(vfm), 0, &chheader.length);
+			void* compressed = NULL;
+			size_t compressedSize = 0;
+			size_t capacity = 0;
+			_compress(context->initialState, context->initialStateSize, &compressed, &compressedSize, &capacity);
+			STORE_32LE(compressedSize, 0, &chheader.length);
 			context->backing->write(context->backing, &chheader, sizeof(chheader));
-			_copyVf(context->backing, vfm);
-			vfm->close(vfm);
+			context->backing->write(context->backing, compressed, compressedSize);
+			free(compressed);
 		} else
 #endif
 		{
@@ -618,6 +753,7 @@ bool _readHeader(struct mVideoLogContext* context) {
 
 	uint32_t flags;
 	LOAD_32LE(flags, 0, &header.flags);
+	context->flags = flags;
 	if (flags & mVL_FLAG_HAS_INITIAL_STATE) {
 		struct mVLBlockHeader header;
 		if (!_readBlockHeader(context, &header)) {
@@ -656,6 +792,56 @@ bool _readHeader(struct mVideoLogContext* context) {
 	return true;
 }
 
+static bool _readIndex(struct mVideoLogContext* context) {
+	struct VFile* vf = context->backing;
+	off_t end = vf->seek(vf, 0, SEEK_END);
+	uint32_t size;
+	if (end < (off_t) (sizeof(struct mVideoLogHeader) + sizeof(struct mVLBlockHeader) * 2 + sizeof(size))) {
+		return false;
+	}
+	vf->seek(vf, end - sizeof(struct mVLBlockHeader) - sizeof(size), SEEK_SET);
+	if (vf->read(vf, &size, sizeof(size)) != sizeof(size)) {
+		return false;
+	}
+	LOAD_32LE(size, 0, &size);
+	if (size < sizeof(struct mVLBlockHeader) + sizeof(uint32_t) * 3 || (off_t) size > end - (off_t) sizeof(struct mVLBlockHeader)) {
+		return false;
+	}
+	vf->seek(vf, end - sizeof(struct mVLBlockHeader) - size, SEEK_SET);
+	struct mVLBlockHeader header;
+	if (!_readBlockHeader(context, &header) || header.blockType != mVL_BLOCK_INDEX || header.length != size - sizeof(header)) {
+		return false;
+	}
+	uint32_t* data = malloc(header.length);
+	if (!data) {
+		return false;
+	}
+	if (vf->read(vf, data, header.length) != (ssize_t) header.length) {
+		free(data);
+		return false;
+	}
+	uint32_t entries;
+	LOAD_32LE(entries, 0, data);
+	if (header.length != sizeof(uint32_t) * (3 + (size_t) entries * 3)) {
+		free(data);
+		return false;
+	}
+	LOAD_32LE(context->frames, 4, data);
+	mVLIndexClear(&context->index);
+	uint32_t i;
+	for (i = 0; i < entries; ++i) {
+		struct mVLIndexEntry* entry = mVLIndexAppend(&context->index);
+		uint32_t low;
+		uint32_t high;
+		LOAD_32LE(entry->frame, 8 + i * 12, data);
+		LOAD_32LE(low, 12 + i * 12, data);
+		LOAD_32LE(high, 16 + i * 12, data);
+		entry->offset = ((uint64_t) high << 32) | low;
+	}
+	free(data);
+	return true;
+}
+
 bool mVideoLogContextLoad(struct mVideoLogContext* context, struct VFile* vf) {
 	context->backing = vf;
 
@@ -664,6 +850,13 @@ bool mVideoLogContextLoad(struct mVideoLogContext* context, struct VFile* vf) {
 	}
 
 	off_t pointer = context->backing->seek(context->backing, 0, SEEK_CUR);
+	if (context->flags & mVL_FLAG_HAS_INDEX) {
+		// A broken index only costs seeking, so playback goes on without it
+		if (!_readIndex(context)) {
+			mVLIndexClear(&context->index);
+		}
+		context->backing->seek(context->backing, pointer, SEEK_SET);
+	}
 
 	size_t i;
 	for (i = 0; i < context->nChannels; ++i) {
@@ -679,31 +872,193 @@ bool mVideoLogContextLoad(struct mVideoLogContext* context, struct VFile* vf) {
 	return true;
 }
 
+static void _recordKeyframe(struct mVideoLogContext* context, uint32_t frame) {
+	struct mVLIndexEntry* entry = mVLIndexAppend(&context->index);
+	entry->frame = frame;
+	entry->offset = context->backing->seek(context->backing, 0, SEEK_CUR);
+}
+
 #ifdef USE_ZLIB
-static void _flushBufferCompressed(struct mVideoLogContext* context) {
-	struct mCircleBuffer* buffer = &context->channels[context->activeChannel].buffer;
-	if (!mCircleBufferSize(buffer)) {
-		return;
+static void _writeJob(struct mVideoLogContext* context, struct mVLCompressionJob* job) {
+	if (job->blockType == mVL_BLOCK_KEYFRAME) {
+		_recordKeyframe(context, job->frame);
 	}
-	struct VFile* vfm = VFileMemChunk(NULL, 0);
-	struct VFile* src = VFileFIFO(buffer);
-	_compress(vfm, src);
-	src->close(src);
-
-	size_t size = vfm->size(vfm);
-
 	struct mVLBlockHeader header = { 0 };
-	STORE_32LE(mVL_BLOCK_DATA, 0, &header.blockType);
-	STORE_32LE(context->activeChannel, 0, &header.channelId);
+	STORE_32LE(job->blockType, 0, &header.blockType);
+	STORE_32LE(job->channelId, 0, &header.channelId);
 	STORE_32LE(mVL_FLAG_BLOCK_COMPRESSED, 0, &header.flags);
-	STORE_32LE(size, 0, &header.length);
+	STORE_32LE(job->compressedSize, 0, &header.length);
 
 	context->backing->write(context->backing, &header, sizeof(header));
-	_copyVf(context->backing, vfm);
-	vfm->close(vfm);
+	context->backing->write(context->backing, job->compressed, job->compressedSize);
+}
+
+#ifndef DISABLE_THREADING
+static THREAD_ENTRY _compressionThread(void* user) {
+	struct mVideoLogContext* context = user;
+	ThreadSetName("Video Log Compression");
+	MutexLock(&context->jobMutex);
+	while (true) {
+		while (context->jobNext == context->jobQueued && !context->stopping) {
+			ConditionWait(&context->jobCond, &context->jobMutex);
+		}
+		if (context->jobNext == context->jobQueued) {
+			break;
+		}
+		struct mVLCompressionJob* job = &context->jobs[context->jobNext % COMPRESSION_QUEUE_SIZE];
+		++context->jobNext;
+		MutexUnlock(&context->jobMutex);
+
+		if (!_compress(job->data, job->size, &job->compressed, &job->compressedSize, &job->compressedCapacity)) {
+			job->compressedSize = 0;
+		}
+
+		MutexLock(&context->jobMutex);
+		job->done = true;
+		ConditionWake(&context->jobDoneCond);
+	}
+	MutexUnlock(&context->jobMutex);
+	THREAD_EXIT(0);
+}
+
+// Writes out finished blocks in order, waiting for all of them if wait is set
+static void _writeFinishedJobs(struct mVideoLogContext* context, bool wait) {
+	MutexLock(&context->jobMutex);
+	while (context->jobWrite != context->jobQueued) {
+		struct mVLCompressionJob* job = &context->jobs[context->jobWrite % COMPRESSION_QUEUE_SIZE];
+		if (!job->done) {
+			if (!wait) {
+				break;
+			}
+			ConditionWait(&context->jobDoneCond, &context->jobMutex);
+			continue;
+		}
+		MutexUnlock(&context->jobMutex);
+		if (job->compressedSize) {
+			_writeJob(context, job);
+		}
+		MutexLock(&context->jobMutex);
+		++context->jobWrite;
+		// Wake anyone waiting for a free slot
+		ConditionWake(&context->jobDoneCond);
+	}
+	MutexUnlock(&context->jobMutex);
 }
 #endif
 
+// Returns a free job with room for size bytes, waiting for one to be written out if needed
+static struct mVLCompressionJob* _nextJob(struct mVideoLogContext* context, size_t size) {
+#ifndef DISABLE_THREADING
+	if (context->nThreads) {
+		MutexLock(&context->jobMutex);
+		while (context->jobQueued - context->jobWrite == COMPRESSION_QUEUE_SIZE) {
+			MutexUnlock(&context->jobMutex);
+			_writeFinishedJobs(context, false);
+			MutexLock(&context->jobMutex);
+			if (context->jobQueued - context->jobWrite == COMPRESSION_QUEUE_SIZE) {
+				ConditionWait(&context->jobDoneCond, &context->jobMutex);
+			}
+		}
+		MutexUnlock(&context->jobMutex);
+	}
+#endif
+
+	struct mVLCompressionJob* job = &context->jobs[context->jobQueued % COMPRESSION_QUEUE_SIZE];
+	if (size > job->capacity) {
+		free(job->data);
+		job->data = malloc(size);
+		job->capacity = job->data ? size : 0;
+		if (!job->data) {
+			return NULL;
+		}
+	}
+	job->size = size;
+	job->done = false;
+	return job;
+}
+
+static void _submitJob(struct mVideoLogContext* context, struct mVLCompressionJob* job) {
+#ifndef DISABLE_THREADING
+	if (context->nThreads) {
+		MutexLock(&context->jobMutex);
+		++context->jobQueued;
+		ConditionWake(&context->jobCond);
+		MutexUnlock(&context->jobMutex);
+		_writeFinishedJobs(context, false);
+		return;
+	}
+#endif
+	if (_compress(job->data, job->size, &job->compressed, &job->compressedSize, &job->compressedCapacity)) {
+		_writeJob(context, job);
+	}
+}
+
+static void _flushBufferCompressed(struct mVideoLogContext* context) {
+	struct mCircleBuffer* buffer = &context->channels[context->activeChannel].buffer;
+	size_t size = mCircleBufferSize(buffer);
+	if (!size) {
+		return;
+	}
+	struct mVLCompressionJob* job = _nextJob(context, size);
+	if (!job) {
+		mCircleBufferClear(buffer);
+		return;
+	}
+	job->blockType = mVL_BLOCK_DATA;
+	job->channelId = context->activeChannel;
+	job->size = mCircleBufferRead(buffer, job->data, size);
+	_submitJob(context, job);
+}
+
+static void _stopCompressionThreads(struct mVideoLogContext* context) {
+#ifndef DISABLE_THREADING
+	if (!context->nThreads) {
+		return;
+	}
+	_writeFinishedJobs(context, true);
+	MutexLock(&context->jobMutex);
+	context->stopping = true;
+	ConditionWake(&context->jobCond);
+	MutexUnlock(&context->jobMutex);
+	unsigned i;
+	for (i = 0; i < context->nThreads; ++i) {
+		ThreadJoin(&context->threads[i]);
+	}
+	context->nThreads = 0;
+	context->stopping = false;
+	MutexDeinit(&context->jobMutex);
+	ConditionDeinit(&context->jobCond);
+	ConditionDeinit(&context->jobDoneCond);
+#else
+	UNUSED(context);
+#endif
+}
+#endif
+
+void mVideoLogContextSetCompressionThreads(struct mVideoLogContext* context, unsigned threads) {
+#if defined(USE_ZLIB) && !defined(DISABLE_THREADING)
+	if (!context->write) {
+		return;
+	}
+	if (threads > MAX_COMPRESSION_THREADS) {
+		threads = MAX_COMPRESSION_THREADS;
+	}
+	_stopCompressionThreads(context);
+	if (!threads) {
+		return;
+	}
+	MutexInit(&context->jobMutex);
+	ConditionInit(&context->jobCond);
+	ConditionInit(&context->jobDoneCond);
+	for (context->nThreads = 0; context->nThreads < threads; ++context->nThreads) {
+		ThreadCreate(&context->threads[context->nThreads], _compressionThread, context);
+	}
+#else
+	UNUSED(context);
+	UNUSED(threads);
+#endif
+}
+
 static void _flushBuffer(struct mVideoLogContext* context) {
 #ifdef USE_ZLIB
 	if (context->compression) {
@@ -730,9 +1085,108 @@ static void _flushBuffer(struct mVideoLogContext* context) {
 	}
 }
 
+static void _writeKeyframe(struct mVideoLogContext* context) {
+	struct mCore* core = context->core;
+	_flushBuffer(context);
+
+	struct VFile* vf = VFileMemChunk(NULL, core->stateSize(core));
+	if (!mCoreSaveStateNamed(core, vf, 0)) {
+		vf->close(vf);
+		return;
+	}
+	size_t size = vf->size(vf);
+	void* state = vf->map(vf, size, MAP_READ);
+
+#ifdef USE_ZLIB
+	if (context->compression) {
+		struct mVLCompressionJob* job = _nextJob(context, size);
+		if (job) {
+			job->blockType = mVL_BLOCK_KEYFRAME;
+			job->channelId = 0;
+			job->frame = context->frames;
+			memcpy(job->data, state, size);
+			_submitJob(context, job);
+		}
+	} else
+#endif
+	{
+		_recordKeyframe(context, context->frames);
+		struct mVLBlockHeader header = { 0 };
+		STORE_32LE(mVL_BLOCK_KEYFRAME, 0, &header.blockType);
+		STORE_32LE(size, 0, &header.length);
+		context->backing->write(context->backing, &header, sizeof(header));
+		context->backing->write(context->backing, state, size);
+	}
+	vf->unmap(vf, state, size);
+	vf->close(vf);
+}
+
+static void _finishFrame(struct mVideoLogContext* context) {
+	++context->frames;
+	if (context->indexInterval && context->core && !(context->frames % context->indexInterval)) {
+		context->keyframePending = true;
+	}
+}
+
+static void _flushFrame(struct mVideoLogContext* context) {
+	// Playback of a frame ends at the flush following it, so the keyframe has to go after that
+	if (context->keyframePending) {
+		context->keyframePending = false;
+		_writeKeyframe(context);
+	}
+}
+
+static void _writeIndex(struct mVideoLogContext* context) {
+	size_t entries = mVLIndexSize(&context->index);
+	// Entry count, frame count, one frame/offset triple per entry, then the size of the
+	// whole block so a reader can find it by working back from the footer
+	size_t size = sizeof(uint32_t) * (3 + entries * 3);
+	uint32_t* data = malloc(size);
+	if (!data) {
+		return;
+	}
+	STORE_32LE(entries, 0, data);
+	STORE_32LE(context->frames, 4, data);
+	size_t i;
+	for (i = 0; i < entries; ++i) {
+		const struct mVLIndexEntry* entry = mVLIndexGetConstPointer(&context->index, i);
+		uint64_t offset = entry->offset;
+		STORE_32LE(entry->frame, 8 + i * 12, data);
+		STORE_32LE(offset, 12 + i * 12, data);
+		STORE_32LE(offset >> 32, 16 + i * 12, data);
+	}
+	STORE_32LE(sizeof(struct mVLBlockHeader) + size, size - 4, data);
+
+	struct mVLBlockHeader header = { 0 };
+	STORE_32LE(mVL_BLOCK_INDEX, 0, &header.blockType);
+	STORE_32LE(size, 0, &header.length);
+	context->backing->write(context->backing, &header, sizeof(header));
+	context->backing->write(context->backing, data, size);
+	free(data);
+
+	// The header went out before there was an index, so it needs updating now
+	off_t end = context->backing->seek(context->backing, 0, SEEK_CUR);
+	uint32_t flags;
+	context->backing->seek(context->backing, offsetof(struct mVideoLogHeader, flags), SEEK_SET);
+	if (context->backing->read(context->backing, &flags, sizeof(flags)) == sizeof(flags)) {
+		LOAD_32LE(flags, 0, &flags);
+		flags |= mVL_FLAG_HAS_INDEX;
+		STORE_32LE(flags, 0, &flags);
+		context->backing->seek(context->backing, offsetof(struct mVideoLogHeader, flags), SEEK_SET);
+		context->backing->write(context->backing, &flags, sizeof(flags));
+	}
+	context->backing->seek(context->backing, end, SEEK_SET);
+}
+
 void mVideoLogContextDestroy(struct mCore* core, struct mVideoLogContext* context, bool closeVF) {
 	if (context->write) {
 		_flushBuffer(context);
+#ifdef USE_ZLIB
+		_stopCompressionThreads(context);
+#endif
+		if (mVLIndexSize(&context->index)) {
+			_writeIndex(context);
+		}
 
 		struct mVLBlockHeader header = { 0 };
 		STORE_32LE(mVL_BLOCK_FOOTER, 0, &header.blockType);
@@ -758,6 +1212,14 @@ void mVideoLogContextDestroy(struct mCore* core, struct mVideoLogContext* contex
 #endif
 	}
 
+	mVLIndexDeinit(&context->index);
+#ifdef USE_ZLIB
+	for (i = 0; i < COMPRESSION_QUEUE_SIZE; ++i) {
+		free(context->jobs[i].data);
+		free(context->jobs[i].compressed);
+	}
+#endif
+
 	if (closeVF && context->backing) {
 		context->backing->close(context->backing);
 	}
@@ -765,11 +1227,58 @@ void mVideoLogContextDestroy(struct mCore* core, struct mVideoLogContext* contex
 	free(context);
 }
 
+// Reads the savestate out of a keyframe block, and where the log continues after it
+static struct VFile* _readKeyframe(struct mVideoLogContext* context, const struct mVLIndexEntry* entry, off_t* pointer) {
+	struct VFile* vf = context->backing;
+	vf->seek(vf, entry->offset, SEEK_SET);
+	struct mVLBlockHeader header;
+	if (!_readBlockHeader(context, &header) || header.blockType != mVL_BLOCK_KEYFRAME || !header.length) {
+		return NULL;
+	}
+	struct VFile* state = VFileMemChunk(NULL, 0);
+	if (header.flags & mVL_FLAG_BLOCK_COMPRESSED) {
+#ifdef USE_ZLIB
+		if (!_decompress(state, vf, header.length)) {
+			state->close(state);
+			return NULL;
+		}
+#else
+		state->close(state);
+		return NULL;
+#endif
+	} else {
+		state->truncate(state, header.length);
+		void* data = state->map(state, header.length, MAP_WRITE);
+		bool ok = vf->read(vf, data, header.length) == (ssize_t) header.length;
+		state->unmap(state, data, header.length);
+		if (!ok) {
+			state->close(state);
+			return NULL;
+		}
+	}
+	*pointer = entry->offset + sizeof(header) + header.length;
+	return state;
+}
+
 void mVideoLogContextRewind(struct mVideoLogContext* context, struct mCore* core) {
 	_readHeader(context);
+	off_t pointer = context->backing->seek(context->backing, 0, SEEK_CUR);
+
+	struct VFile* keyframe = NULL;
+	if (context->seekEntry >= 0) {
+		keyframe = _readKeyframe(context, mVLIndexGetConstPointer(&context->index, context->seekEntry), &pointer);
+		context->seekEntry = -1;
+	}
+
 	if (core) {
 		struct VFile* vf;
-		if (context->initialStateSize < core->stateSize(core)) {
+		if (keyframe) {
+			vf = keyframe;
+			if ((size_t) vf->size(vf) < core->stateSize(core)) {
+				vf->truncate(vf, core->stateSize(core));
+			}
+			vf->seek(vf, 0, SEEK_SET);
+		} else if (context->initialStateSize < core->stateSize(core)) {
 			vf = VFileMemChunk(NULL, core->stateSize(core));
 			vf->write(vf, context->initialState, context->initialStateSize);
 		} else {
@@ -777,10 +1286,10 @@ void mVideoLogContextRewind(struct mVideoLogContext* context, struct mCore* core
 		}
 		mCoreLoadStateNamed(core, vf, 0);
 		vf->close(vf);
+	} else if (keyframe) {
+		keyframe->close(keyframe);
 	}
 
-	off_t pointer = context->backing->seek(context->backing, 0, SEEK_CUR);
-
 	size_t i;
 	for (i = 0; i < context->nChannels; ++i) {
 		mCircleBufferClear(&context->channels[i].injectedBuffer);
@@ -796,6 +1305,42 @@ void mVideoLogContextRewind(struct mVideoLogContext* context, struct mCore* core
 	}
 }
 
+void mVideoLogContextSetIndexInterval(struct mVideoLogContext* context, unsigned frames) {
+	context->indexInterval = frames;
+}
+
+uint32_t mVideoLogContextFrameCount(const struct mVideoLogContext* context) {
+	return context->frames;
+}
+
+uint32_t mVideoLogContextSeek(struct mVideoLogContext* context, uint32_t frame) {
+	context->seekEntry = -1;
+	uint32_t keyframe = 0;
+	size_t i;
+	for (i = 0; i < mVLIndexSize(&context->index); ++i) {
+		const struct mVLIndexEntry* entry = mVLIndexGetConstPointer(&context->index, i);
+		if (entry->frame > frame) {
+			break;
+		}
+		context->seekEntry = i;
+		keyframe = entry->frame;
+	}
+	return keyframe;
+}
+
+bool mVideoLogPlayerSeek(struct mCore* core, uint32_t frame) {
+	if (!core->videoLogger || !core->videoLogger->dataContext) {
+		return false;
+	}
+	struct mVideoLogChannel* channel = core->videoLogger->dataContext;
+	uint32_t keyframe = mVideoLogContextSeek(channel->p, frame);
+	core->reset(core);
+	for (; keyframe < frame; ++keyframe) {
+		core->runFrame(core);
+	}
+	return true;
+}
+
 void* mVideoLogContextInitialState(struct mVideoLogContext* context, size_t* size) {
 	if (size) {
 		*size = context->initialStateSize;
@@ -5,6 +5,7 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/internal/gb/audio.h>
 
+#include <mgba/core/host-trace.h>
 #include <mgba/core/interface.h>
 #include <mgba/core/sync.h>
 #include <mgba/internal/gb/gb.h>
@@ -57,6 +58,7 @@ void GBAudioInit(struct GBAudio* audio, size_t samples, uint8_t* nr52, enum GBAu
 	audio->forceDisableCh[2] = false;
 	audio->forceDisableCh[3] = false;
 	audio->masterVolume = GB_AUDIO_VOLUME_MAX;
+	audio->skipMixing = false;
 	audio->nr52 = nr52;
 	audio->style = style;
 	if (style == GB_AUDIO_GBA) {
@@ -792,8 +794,19 @@ void GBAudioSample(struct GBAudio* audio, int32_t timestamp) {
 	timestamp -= audio->lastSample;
 	timestamp -= audio->sampleIndex * interval;
 
-	int sample;
-	for (sample = audio->sampleIndex; timestamp >= interval && sample < GB_MAX_SAMPLES; ++sample, timestamp -= interval) {
+	int sample = audio->sampleIndex;
+	if (audio->skipMixing) {
+		if (timestamp >= interval) {
+			sample += timestamp / interval;
+			if (sample > GB_MAX_SAMPLES) {
+				sample = GB_MAX_SAMPLES;
+			}
+			// Advance the channels as far as mixing would have
+			GBAudioRun(audio, (sample - 1) * interval + audio->lastSample, 0x1F);
+		}
+		timestamp = 0;
+	}
+	for (; timestamp >= interval && sample < GB_MAX_SAMPLES; ++sample, timestamp -= interval) {
 		int16_t sampleLeft = 0;
 		int16_t sampleRight = 0;
 		GBAudioRun(audio, sample * interval + audio->lastSample, 0x1F);
@@ -820,8 +833,12 @@ void GBAudioSample(struct GBAudio* audio, int32_t timestamp) {
 static void _sample(struct mTiming* timing, void* user, uint32_t cyclesLate) {
 	struct GBAudio* audio = user;
 	GBAudioSample(audio, mTimingCurrentTime(audio->timing));
+	if (audio->skipMixing) {
+		mTimingSchedule(timing, &audio->sampleEvent, audio->sampleInterval * audio->timingFactor - cyclesLate);
+		return;
+	}
 
-	mCoreSyncLockAudio(audio->p->sync);
+	mTRACE_BEGIN("Audio: produce");
 	mAudioBufferWrite(&audio->buffer, (int16_t*) audio->currentSamples, GB_MAX_SAMPLES);
 	if (audio->p->stream) {
 		if (audio->p->stream->postAudioFrame) {
@@ -842,6 +859,7 @@ static void _sample(struct mTiming* timing, void* user, uint32_t cyclesLate) {
 		// Interrupted
 		audio->p->earlyExit = true;
 	}
+	mTRACE_END();
 	mTimingSchedule(timing, &audio->sampleEvent, audio->sampleInterval * audio->timingFactor - cyclesLate);
 }
 
@@ -5,6 +5,7 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/gb/core.h>
 
+#include <mgba/core/cache-set.h>
 #include <mgba/core/core.h>
 #include <mgba/internal/debugger/symbols.h>
 #include <mgba/internal/gb/cheats.h>
@@ -17,6 +18,9 @@
 #include <mgba/internal/gb/overrides.h>
 #include <mgba/internal/gb/renderers/software.h>
 #include <mgba/internal/gb/renderers/proxy.h>
+#ifdef BUILD_GLES3
+#include <mgba/internal/gb/renderers/gl.h>
+#endif
 #include <mgba/internal/gb/serialize.h>
 #include <mgba/internal/sm83/sm83.h>
 #include <mgba/internal/sm83/debugger/debugger.h>
@@ -62,6 +66,15 @@ static const struct mCoreMemoryBlock _GBCMemoryBlocks[] = {
 	{ GB_BASE_HRAM, "hram", "HRAM", "High RAM", GB_BASE_HRAM, GB_BASE_HRAM + GB_SIZE_HRAM, GB_SIZE_HRAM, mCORE_MEMORY_RW | mCORE_MEMORY_MAPPED },
 };
 
+static const struct mStateSection _GBStateSections[] = {
+	{ mSTATE_SECTION_CPU, offsetof(struct GBSerializedState, cpu), sizeof(((struct GBSerializedState*) 0)->cpu) },
+	{ mSTATE_SECTION_OAM, offsetof(struct GBSerializedState, oam), GB_SIZE_OAM },
+	{ mSTATE_SECTION_IO, offsetof(struct GBSerializedState, io), GB_SIZE_IO },
+	{ mSTATE_SECTION_HRAM, offsetof(struct GBSerializedState, hram), GB_SIZE_HRAM },
+	{ mSTATE_SECTION_VRAM, offsetof(struct GBSerializedState, vram), GB_SIZE_VRAM },
+	{ mSTATE_SECTION_WRAM, offsetof(struct GBSerializedState, wram), GB_SIZE_WORKING_RAM },
+};
+
 static const struct mCoreScreenRegion _GBScreenRegions[] = {
 	{ 0, "Screen", 0, 0, GB_VIDEO_HORIZONTAL_PIXELS, GB_VIDEO_VERTICAL_PIXELS }
 };
@@ -93,6 +106,9 @@ struct GBCore {
 	struct mCore d;
 	struct GBVideoRenderer dummyRenderer;
 	struct GBVideoSoftwareRenderer renderer;
+#ifdef BUILD_GLES3
+	struct GBVideoGLRenderer glRenderer;
+#endif
 #ifndef MINIMAL_CORE
 	struct GBVideoProxyRenderer proxyRenderer;
 	struct mVideoLogContext* logContext;
@@ -121,6 +137,7 @@ static bool _GBCoreInit(struct mCore* core) {
 	core->cpu = cpu;
 	core->board = gb;
 	core->timing = &gb->timing;
+	core->videoLogger = NULL;
 	gbcore->overrides = NULL;
 	gbcore->debuggerPlatform = NULL;
 	gbcore->cheatDevice = NULL;
@@ -144,6 +161,11 @@ static bool _GBCoreInit(struct mCore* core) {
 	GBVideoSoftwareRendererCreate(&gbcore->renderer);
 	gbcore->renderer.outputBuffer = NULL;
 
+#ifdef BUILD_GLES3
+	GBVideoGLRendererCreate(&gbcore->glRenderer);
+	gbcore->glRenderer.outputTex = -1;
+#endif
+
 #ifndef MINIMAL_CORE
 	gbcore->proxyRenderer.logger = NULL;
 #endif
@@ -189,6 +211,12 @@ static enum mPlatform _GBCorePlatform(const struct mCore* core) {
 static bool _GBCoreSupportsFeature(const struct mCore* core, enum mCoreFeature feature) {
 	UNUSED(core);
 	switch (feature) {
+	case mCORE_FEATURE_OPENGL:
+#ifdef BUILD_GLES3
+		return true;
+#else
+		return false;
+#endif
 	default:
 		return false;
 	}
@@ -259,8 +287,27 @@ static void _GBCoreLoadConfig(struct mCore* core, const struct mCoreConfig* conf
 	mCoreConfigCopyValue(&core->config, config, "gb.colors");
 	mCoreConfigCopyValue(&core->config, config, "useCgbColors");
 	mCoreConfigCopyValue(&core->config, config, "allowOpposingDirections");
+	mCoreConfigCopyValue(&core->config, config, "skipAudio");
+	mCoreConfigCopyValue(&core->config, config, "hwaccelVideo");
+	mCoreConfigCopyValue(&core->config, config, "videoScale");
+
+	const char* idleOptimization = mCoreConfigGetValue(config, "idleOptimization");
+	if (idleOptimization) {
+		if (strcasecmp(idleOptimization, "ignore") == 0) {
+			gb->idleOptimization = GB_IDLE_LOOP_IGNORE;
+		} else if (strcasecmp(idleOptimization, "remove") == 0) {
+			gb->idleOptimization = GB_IDLE_LOOP_REMOVE;
+		} else if (strcasecmp(idleOptimization, "detect") == 0) {
+			if (gb->idleLoop == GB_IDLE_LOOP_NONE) {
+				gb->idleOptimization = GB_IDLE_LOOP_DETECT;
+			} else {
+				gb->idleOptimization = GB_IDLE_LOOP_REMOVE;
+			}
+		}
+	}
 
 	mCoreConfigGetBoolValue(config, "allowOpposingDirections", &gb->allowOpposingDirections);
+	mCoreConfigGetBoolValue(config, "skipAudio", &gb->audio.skipMixing);
 
 	if (mCoreConfigGetBoolValue(config, "sgb.borders", &gb->video.sgbBorders)) {
 		gb->video.renderer->enableSGBBorder(gb->video.renderer, gb->video.sgbBorders);
@@ -318,12 +365,59 @@ static void _GBCoreReloadConfigOption(struct mCore* core, const char* option, co
 		mCoreConfigGetBoolValue(config, "allowOpposingDirections", &gb->allowOpposingDirections);
 		return;
 	}
+	if (strcmp("skipAudio", option) == 0) {
+		if (config != &core->config) {
+			mCoreConfigCopyValue(&core->config, config, "skipAudio");
+		}
+		mCoreConfigGetBoolValue(config, "skipAudio", &gb->audio.skipMixing);
+		return;
+	}
 	if (strcmp("sgb.borders", option) == 0) {
 		if (mCoreConfigGetBoolValue(config, "sgb.borders", &gb->video.sgbBorders)) {
 			gb->video.renderer->enableSGBBorder(gb->video.renderer, gb->video.sgbBorders);
 		}
 	}
 
+	struct GBCore* gbcore = (struct GBCore*) core;
+#ifdef BUILD_GLES3
+	if (strcmp("videoScale", option) == 0) {
+		if (config != &core->config) {
+			mCoreConfigCopyValue(&core->config, config, "videoScale");
+		}
+		bool value;
+		if (gbcore->glRenderer.outputTex != (unsigned) -1 && mCoreConfigGetBoolValue(&core->config, "hwaccelVideo", &value) && value) {
+			int scale;
+			mCoreConfigGetIntValue(config, "videoScale", &scale);
+			GBVideoGLRendererSetScale(&gbcore->glRenderer, scale);
+		}
+		return;
+	}
+#endif
+	if (strcmp("hwaccelVideo", option) == 0) {
+		struct GBVideoRenderer* renderer = NULL;
+		if (gbcore->renderer.outputBuffer) {
+			renderer = &gbcore->renderer.d;
+		}
+#ifdef BUILD_GLES3
+		bool value;
+		if (gbcore->glRenderer.outputTex != (unsigned) -1 && mCoreConfigGetBoolValue(&core->config, "hwaccelVideo", &value) && value) {
+			mCoreConfigGetIntValue(&core->config, "videoScale", &gbcore->glRenderer.scale);
+			renderer = &gbcore->glRenderer.d;
+		} else {
+			gbcore->glRenderer.scale = 1;
+		}
+#endif
+#ifndef MINIMAL_CORE
+		if (renderer && core->videoLogger) {
+			GBVideoProxyRendererCreate(&gbcore->proxyRenderer, renderer, core->videoLogger);
+			renderer = &gbcore->proxyRenderer.d;
+		}
+#endif
+		if (renderer) {
+			GBVideoAssociateRenderer(&gb->video, renderer);
+		}
+	}
+
 	if (strcmp("gb.pal", option) == 0) {
 		int color;
 		if (mCoreConfigGetIntValue(config, "gb.pal[0]", &color)) {
@@ -382,22 +476,30 @@ static void _GBCoreBaseVideoSize(const struct mCore* core, unsigned* width, unsi
 	*height = SGB_VIDEO_VERTICAL_PIXELS;
 }
 
+static unsigned _GBCoreVideoScale(const struct mCore* core) {
+#ifdef BUILD_GLES3
+	const struct GBCore* gbcore = (const struct GBCore*) core;
+	if (gbcore->glRenderer.outputTex != (unsigned) -1) {
+		return gbcore->glRenderer.scale;
+	}
+#else
+	UNUSED(core);
+#endif
+	return 1;
+}
+
 static void _GBCoreCurrentVideoSize(const struct mCore* core, unsigned* width, unsigned* height) {
 	const struct GB* gb = core->board;
+	unsigned scale = _GBCoreVideoScale(core);
 	if (gb && (!(gb->model & GB_MODEL_SGB) || !gb->video.sgbBorders)) {
-		*width = GB_VIDEO_HORIZONTAL_PIXELS;
-		*height = GB_VIDEO_VERTICAL_PIXELS;
+		*width = GB_VIDEO_HORIZONTAL_PIXELS * scale;
+		*height = GB_VIDEO_VERTICAL_PIXELS * scale;
 	} else {
-		*width = SGB_VIDEO_HORIZONTAL_PIXELS;
-		*height = SGB_VIDEO_VERTICAL_PIXELS;
+		*width = SGB_VIDEO_HORIZONTAL_PIXELS * scale;
+		*height = SGB_VIDEO_VERTICAL_PIXELS * scale;
 	}
 }
 
-static unsigned _GBCoreVideoScale(const struct mCore* core) {
-	UNUSED(core);
-	return 1;
-}
-
 static size_t _GBCoreScreenRegions(const struct mCore* core, const struct mCoreScreenRegion** regions) {
 	const struct GB* gb = core->board;
 	if (gb && (!(gb->model & GB_MODEL_SGB) || !gb->video.sgbBorders)) {
@@ -416,18 +518,34 @@ static void _GBCoreSetVideoBuffer(struct mCore* core, mColor* buffer, size_t str
 }
 
 static void _GBCoreSetVideoGLTex(struct mCore* core, unsigned texid) {
+#ifdef BUILD_GLES3
+	struct GBCore* gbcore = (struct GBCore*) core;
+	gbcore->glRenderer.outputTex = texid;
+	gbcore->glRenderer.outputTexDirty = true;
+#else
 	UNUSED(core);
 	UNUSED(texid);
+#endif
+}
+
+static void _GBCoreSetRenderSkip(struct mCore* core, bool skip) {
+	struct GB* gb = core->board;
+	gb->video.renderSkip = skip;
 }
 
 static void _GBCoreGetPixels(struct mCore* core, const void** buffer, size_t* stride) {
-	struct GBCore* gbcore = (struct GBCore*) core;
-	gbcore->renderer.d.getPixels(&gbcore->renderer.d, stride, buffer);
+	struct GB* gb = core->board;
+	gb->video.renderer->getPixels(gb->video.renderer, stride, buffer);
+}
+
+static unsigned _GBCoreGetPixelsLatency(struct mCore* core) {
+	UNUSED(core);
+	return 0;
 }
 
 static void _GBCorePutPixels(struct mCore* core, const void* buffer, size_t stride) {
-	struct GBCore* gbcore = (struct GBCore*) core;
-	gbcore->renderer.d.putPixels(&gbcore->renderer.d, stride, buffer);
+	struct GB* gb = core->board;
+	gb->video.renderer->putPixels(gb->video.renderer, stride, buffer);
 }
 
 static struct mAudioBuffer* _GBCoreGetAudioBuffer(struct mCore* core) {
@@ -450,6 +568,15 @@ static size_t _GBCoreGetAudioBufferSize(struct mCore* core) {
 	return gb->audio.samples;
 }
 
+static void _GBCoreSetAudioSkip(struct mCore* core, bool skip) {
+	struct GB* gb = core->board;
+	gb->audio.skipMixing = skip;
+	if (!skip) {
+		// Fall back to whatever the configuration asks for
+		mCoreConfigGetBoolValue(&core->config, "skipAudio", &gb->audio.skipMixing);
+	}
+}
+
 static void _GBCoreAddCoreCallbacks(struct mCore* core, struct mCoreCallbacks* coreCallbacks) {
 	struct GB* gb = core->board;
 	*mCoreCallbacksListAppend(&gb->coreCallbacks) = *coreCallbacks;
@@ -556,8 +683,33 @@ static void _GBCoreChecksum(const struct mCore* core, void* data, enum mCoreChec
 static void _GBCoreReset(struct mCore* core) {
 	struct GBCore* gbcore = (struct GBCore*) core;
 	struct GB* gb = (struct GB*) core->board;
-	if (gbcore->renderer.outputBuffer) {
-		GBVideoAssociateRenderer(&gb->video, &gbcore->renderer.d);
+	if (gbcore->renderer.outputBuffer
+#ifdef BUILD_GLES3
+	    || gbcore->glRenderer.outputTex != (unsigned) -1
+#endif
+	) {
+		struct GBVideoRenderer* renderer = NULL;
+		if (gbcore->renderer.outputBuffer) {
+			renderer = &gbcore->renderer.d;
+		}
+#ifdef BUILD_GLES3
+		bool value;
+		if (gbcore->glRenderer.outputTex != (unsigned) -1 && mCoreConfigGetBoolValue(&core->config, "hwaccelVideo", &value) && value) {
+			mCoreConfigGetIntValue(&core->config, "videoScale", &gbcore->glRenderer.scale);
+			renderer = &gbcore->glRenderer.d;
+		} else {
+			gbcore->glRenderer.scale = 1;
+		}
+#endif
+#ifndef MINIMAL_CORE
+		if (renderer && core->videoLogger) {
+			GBVideoProxyRendererCreate(&gbcore->proxyRenderer, renderer, core->videoLogger);
+			renderer = &gbcore->proxyRenderer.d;
+		}
+#endif
+		if (renderer) {
+			GBVideoAssociateRenderer(&gb->video, renderer);
+		}
 	}
 
 	if (gb->memory.rom) {
@@ -732,12 +884,12 @@ static void _GBCoreRunFrame(struct mCore* core) {
 	struct GB* gb = core->board;
 	uint32_t frameCounter = gb->video.frameCounter;
 	while (gb->video.frameCounter == frameCounter) {
-		SM83Run(core->cpu);
+		SM83RunLoop(core->cpu);
 	}
 }
 
 static void _GBCoreRunLoop(struct mCore* core) {
-	SM83Run(core->cpu);
+	SM83RunLoop(core->cpu);
 }
 
 static void _GBCoreStep(struct mCore* core) {
@@ -765,6 +917,53 @@ static bool _GBCoreSaveState(struct mCore* core, void* state) {
 	return true;
 }
 
+static uint32_t _GBCoreLoadStateIncremental(struct mCore* core, const void* state, uint32_t since) {
+	struct GB* gb = core->board;
+	if (!GBDeserializeIncremental(gb, state, since)) {
+		return 0;
+	}
+	return GBMemoryCheckpoint(&gb->memory);
+}
+
+static uint32_t _GBCoreSaveStateIncremental(struct mCore* core, void* state, uint32_t since, struct mStateRangeList* written) {
+	struct SM83Core* cpu = core->cpu;
+	struct GB* gb = core->board;
+	while (cpu->executionState != SM83_CORE_FETCH) {
+		SM83Tick(cpu);
+	}
+	GBSerializeIncremental(gb, state, since);
+	if (written) {
+		mStateRangeListAdd(written, 0, offsetof(struct GBSerializedState, vram));
+		mStateRangeListAddDirtyPages(written, offsetof(struct GBSerializedState, vram), gb->memory.dirtyPages, GB_DIRTY_PAGES_MAX, since);
+		mStateRangeListAdd(written, offsetof(struct GBSerializedState, wram) + GB_SIZE_WORKING_RAM, sizeof(struct GBSerializedState) - offsetof(struct GBSerializedState, wram) - GB_SIZE_WORKING_RAM);
+	}
+	return GBMemoryCheckpoint(&gb->memory);
+}
+
+static uint32_t _GBCoreDirtyState(struct mCore* core, uint32_t since, uint32_t* checkpoint) {
+	struct GB* gb = core->board;
+	struct GBMemory* memory = &gb->memory;
+	uint32_t dirty = 0;
+	if (memory->ioDirty > since) {
+		dirty |= mCORE_DIRTY_IO;
+	}
+	if (memory->paletteDirty > since) {
+		dirty |= mCORE_DIRTY_PALETTE;
+	}
+	if (memory->oamDirty > since) {
+		dirty |= mCORE_DIRTY_OAM;
+	}
+	size_t i;
+	for (i = GB_DIRTY_PAGES_VRAM; i < GB_DIRTY_PAGES_WRAM; ++i) {
+		if (memory->dirtyPages[i] > since) {
+			dirty |= mCORE_DIRTY_VRAM;
+			break;
+		}
+	}
+	*checkpoint = GBMemoryCheckpoint(memory);
+	return dirty;
+}
+
 static bool _GBCoreLoadExtraState(struct mCore* core, const struct mStateExtdata* extdata) {
 	UNUSED(core);
 	UNUSED(extdata);
@@ -777,6 +976,36 @@ static bool _GBCoreSaveExtraState(struct mCore* core, struct mStateExtdata* extd
 	return true;
 }
 
+static bool _GBCoreFork(struct mCore* core, struct mCore* target) {
+	struct GBCore* gbcore = (struct GBCore*) core;
+	struct GBCore* targetcore = (struct GBCore*) target;
+	struct GB* gb = core->board;
+	struct GB* clone = target->board;
+	if (!GBCloneROM(clone, gb)) {
+		return false;
+	}
+	GBCloneBIOS(clone, gb);
+
+	struct VFile* vf;
+	if (gb->memory.sram) {
+		vf = VFileMemChunk(gb->memory.sram, gb->sramSize);
+	} else {
+		vf = VFileMemChunk(NULL, 0);
+	}
+	if (!vf) {
+		return false;
+	}
+	GBLoadSave(clone, vf);
+
+	clone->idleLoop = gb->idleLoop;
+	clone->idleOptimization = gb->idleOptimization;
+
+	targetcore->hasOverride = gbcore->hasOverride;
+	targetcore->override = gbcore->override;
+	target->reset(target);
+	return true;
+}
+
 static void _GBCoreSetKeys(struct mCore* core, uint32_t keys) {
 	struct GBCore* gbcore = (struct GBCore*) core;
 	gbcore->keys = keys;
@@ -920,6 +1149,12 @@ static void _GBCoreRawWrite32(struct mCore* core, uint32_t address, int segment,
 	GBPatch8(cpu, address + 3, value >> 24, NULL, segment);
 }
 
+static size_t _GBListStateSections(const struct mCore* core, const struct mStateSection** sections) {
+	UNUSED(core);
+	*sections = _GBStateSections;
+	return sizeof(_GBStateSections) / sizeof(*_GBStateSections);
+}
+
 size_t _GBListMemoryBlocks(const struct mCore* core, const struct mCoreMemoryBlock** blocks) {
 	struct GBCore* gbcore = (struct GBCore*) core;
 	*blocks = gbcore->memoryBlocks;
@@ -937,12 +1172,15 @@ void* _GBGetMemoryBlock(struct mCore* core, size_t id, size_t* sizeOut) {
 		return gb->memory.rom;
 	case GB_REGION_VRAM:
 		*sizeOut = GB_SIZE_VRAM_BANK0 * (isCgb ? 1 : 2);
+		// Writes through the returned pointer bypass the dirty page tracking
+		GBMemoryMarkDirty(&gb->memory);
 		return gb->video.vram;
 	case GB_REGION_EXTERNAL_RAM:
 		*sizeOut = gb->sramSize;
 		return gb->memory.sram;
 	case GB_REGION_WORKING_RAM_BANK0:
 		*sizeOut = GB_SIZE_WORKING_RAM_BANK0 * (isCgb ? 8 : 2);
+		GBMemoryMarkDirty(&gb->memory);
 		return gb->memory.wram;
 	case GB_BASE_OAM:
 		*sizeOut = GB_SIZE_OAM;
@@ -953,6 +1191,49 @@ void* _GBGetMemoryBlock(struct mCore* core, size_t id, size_t* sizeOut) {
 	}
 }
 
+static void _GBCoreListMemoryUsage(const struct mCore* core, struct mCoreMemoryUsageList* list) {
+	const struct GBCore* gbcore = (const struct GBCore*) core;
+	const struct GB* gb = core->board;
+
+	mCoreMemoryUsageAdd(list, "core", NULL, sizeof(*gbcore), mCORE_MEMORY_ANONYMOUS);
+	mCoreMemoryUsageAdd(list, "board", gb, sizeof(*gb), mCORE_MEMORY_ANONYMOUS);
+	mCoreMemoryUsageAdd(list, "cpu", core->cpu, sizeof(struct SM83Core), mCORE_MEMORY_ANONYMOUS);
+	mCoreMemoryUsageAdd(list, "ram", gb->memory.arena, GB_SIZE_ARENA, mCORE_MEMORY_ANONYMOUS);
+	if (gb->memory.rom) {
+		enum mCoreMemoryBacking backing = mCORE_MEMORY_ANONYMOUS;
+		if (gb->romShared) {
+			backing = mCORE_MEMORY_SHARED;
+		} else if (gb->isPristine && gb->romVf) {
+			backing = mCORE_MEMORY_FILE;
+		}
+		mCoreMemoryUsageAdd(list, "rom", gb->memory.rom, gb->memory.romSize, backing);
+	}
+	if (gb->memory.romBase && gb->memory.romBase != gb->memory.rom) {
+		mCoreMemoryUsageAdd(list, "bios", NULL, GB_SIZE_CART_BANK0, mCORE_MEMORY_ANONYMOUS);
+	}
+	if (gb->memory.sram) {
+		enum mCoreMemoryBacking backing = gb->sramVf && gb->sramVf == gb->sramRealVf ? mCORE_MEMORY_FILE : mCORE_MEMORY_ANONYMOUS;
+		mCoreMemoryUsageAdd(list, "savedata", gb->memory.sram, gb->sramSize, backing);
+	}
+
+	if (gb->video.renderer->cache) {
+		mCoreMemoryUsageAdd(list, "renderer-cache", NULL, mCacheSetMemoryUsage(gb->video.renderer->cache), mCORE_MEMORY_ANONYMOUS);
+	}
+
+	if (gbcore->cheatDevice) {
+		mCoreMemoryUsageAdd(list, "cheats", NULL, mCheatDeviceMemoryUsage(gbcore->cheatDevice), mCORE_MEMORY_ANONYMOUS);
+	}
+#ifdef ENABLE_DEBUGGERS
+	if (gbcore->debuggerPlatform) {
+		const struct SM83Debugger* debugger = (const struct SM83Debugger*) gbcore->debuggerPlatform;
+		size_t size = sizeof(*debugger);
+		size += debugger->breakpoints.capacity * sizeof(struct mBreakpoint);
+		size += debugger->watchpoints.capacity * sizeof(struct mWatchpoint);
+		mCoreMemoryUsageAdd(list, "debugger", NULL, size, mCORE_MEMORY_ANONYMOUS);
+	}
+#endif
+}
+
 static size_t _GBCoreListRegisters(const struct mCore* core, const struct mCoreRegisterInfo** list) {
 	UNUSED(core);
 	*list = _GBRegisters;
@@ -1280,14 +1561,26 @@ static void _GBCoreAdjustVideoLayer(struct mCore* core, size_t id, int32_t x, in
 	case GB_LAYER_BACKGROUND:
 		gbcore->renderer.offsetScx = x;
 		gbcore->renderer.offsetScy = y;
+#ifdef BUILD_GLES3
+		gbcore->glRenderer.offsetScx = x;
+		gbcore->glRenderer.offsetScy = y;
+#endif
 		break;
 	case GB_LAYER_WINDOW:
 		gbcore->renderer.offsetWx = x;
 		gbcore->renderer.offsetWy = y;
+#ifdef BUILD_GLES3
+		gbcore->glRenderer.offsetWx = x;
+		gbcore->glRenderer.offsetWy = y;
+#endif
 		break;
 	case GB_LAYER_OBJ:
 		gbcore->renderer.objOffsetX = x;
 		gbcore->renderer.objOffsetY = y;
+#ifdef BUILD_GLES3
+		gbcore->glRenderer.objOffsetX = x;
+		gbcore->glRenderer.objOffsetY = y;
+#endif
 		break;
 	default:
 		return;
@@ -1343,12 +1636,15 @@ struct mCore* GBCoreCreate(void) {
 	core->screenRegions = _GBCoreScreenRegions;
 	core->setVideoBuffer = _GBCoreSetVideoBuffer;
 	core->setVideoGLTex = _GBCoreSetVideoGLTex;
+	core->setRenderSkip = _GBCoreSetRenderSkip;
 	core->getPixels = _GBCoreGetPixels;
+	core->getPixelsLatency = _GBCoreGetPixelsLatency;
 	core->putPixels = _GBCorePutPixels;
 	core->audioSampleRate = _GBCoreAudioSampleRate;
 	core->getAudioBuffer = _GBCoreGetAudioBuffer;
 	core->setAudioBufferSize = _GBCoreSetAudioBufferSize;
 	core->getAudioBufferSize = _GBCoreGetAudioBufferSize;
+	core->setAudioSkip = _GBCoreSetAudioSkip;
 	core->setAVStream = _GBCoreSetAVStream;
 	core->addCoreCallbacks = _GBCoreAddCoreCallbacks;
 	core->clearCoreCallbacks = _GBCoreClearCoreCallbacks;
@@ -1361,6 +1657,7 @@ struct mCore* GBCoreCreate(void) {
 	core->unloadROM = _GBCoreUnloadROM;
 	core->romSize = _GBCoreROMSize;
 	core->checksum = _GBCoreChecksum;
+	core->setROMPath = NULL;
 	core->reset = _GBCoreReset;
 	core->runFrame = _GBCoreRunFrame;
 	core->runLoop = _GBCoreRunLoop;
@@ -1368,8 +1665,12 @@ struct mCore* GBCoreCreate(void) {
 	core->stateSize = _GBCoreStateSize;
 	core->loadState = _GBCoreLoadState;
 	core->saveState = _GBCoreSaveState;
+	core->loadStateIncremental = _GBCoreLoadStateIncremental;
+	core->saveStateIncremental = _GBCoreSaveStateIncremental;
+	core->dirtyState = _GBCoreDirtyState;
 	core->loadExtraState = _GBCoreLoadExtraState;
 	core->saveExtraState = _GBCoreSaveExtraState;
+	core->fork = _GBCoreFork;
 	core->setKeys = _GBCoreSetKeys;
 	core->addKeys = _GBCoreAddKeys;
 	core->clearKeys = _GBCoreClearKeys;
@@ -1393,7 +1694,9 @@ struct mCore* GBCoreCreate(void) {
 	core->rawWrite16 = _GBCoreRawWrite16;
 	core->rawWrite32 = _GBCoreRawWrite32;
 	core->listMemoryBlocks = _GBListMemoryBlocks;
+	core->listStateSections = _GBListStateSections;
 	core->getMemoryBlock = _GBGetMemoryBlock;
+	core->listMemoryUsage = _GBCoreListMemoryUsage;
 	core->listRegisters = _GBCoreListRegisters;
 	core->readRegister = _GBCoreReadRegister;
 	core->writeRegister = _GBCoreWriteRegister;
@@ -1495,14 +1798,15 @@ static bool _GBVLPLoadState(struct mCore* core, const void* buffer) {
 	struct GB* gb = (struct GB*) core->board;
 	const struct GBSerializedState* state = buffer;
 
-	gb->timing.root = NULL;
+	mTimingDescheduleAll(&gb->timing);
 	gb->model = state->model;
 
 	gb->cpu->pc = GB_BASE_HRAM;
 	gb->cpu->memory.setActiveRegion(gb->cpu, gb->cpu->pc);
 
 	GBVideoReset(&gb->video);
-	GBVideoDeserialize(&gb->video, state);
+	GBVideoDeserialize(&gb->video, state, 0);
+	GBMemoryMarkDirty(&gb->memory);
 	GBIODeserialize(gb, state);
 	GBAudioReset(&gb->audio);
 	if (gb->model & GB_MODEL_SGB) {
@@ -1529,6 +1833,10 @@ struct mCore* GBVideoLogPlayerCreate(void) {
 	core->reset = _GBVLPReset;
 	core->loadROM = _GBVLPLoadROM;
 	core->loadState = _GBVLPLoadState;
+	core->loadStateIncremental = NULL;
+	core->saveStateIncremental = NULL;
+	core->dirtyState = NULL;
+	core->listStateSections = NULL;
 	core->isROM = _returnTrue;
 	return core;
 }
@@ -27,6 +27,7 @@ static void GBVideoProxyRendererGetPixels(struct GBVideoRenderer* renderer, size
 static void GBVideoProxyRendererPutPixels(struct GBVideoRenderer* renderer, size_t stride, const void* pixels);
 
 static bool _parsePacket(struct mVideoLogger* logger, const struct mVideoLoggerDirtyInfo* packet);
+static void _handleEvent(struct mVideoLogger* logger, enum mVideoLoggerEvent event);
 static uint16_t* _vramBlock(struct mVideoLogger* logger, uint32_t address);
 
 void GBVideoProxyRendererCreate(struct GBVideoProxyRenderer* renderer, struct GBVideoRenderer* backend, struct mVideoLogger* logger) {
@@ -61,6 +62,7 @@ void GBVideoProxyRendererCreate(struct GBVideoProxyRenderer* renderer, struct GB
 	renderer->logger = logger;
 	logger->context = renderer;
 	logger->parsePacket = _parsePacket;
+	logger->handleEvent = _handleEvent;
 	logger->vramBlock = _vramBlock;
 	logger->paletteSize = 0;
 	logger->vramSize = GB_SIZE_VRAM;
@@ -134,21 +136,55 @@ void GBVideoProxyRendererInit(struct GBVideoRenderer* renderer, enum GBModel mod
 	_init(proxyRenderer);
 
 	proxyRenderer->model = model;
-	proxyRenderer->backend->init(proxyRenderer->backend, model, borders);
+	proxyRenderer->borders = borders;
+	proxyRenderer->backend->sgbCharRam = renderer->sgbCharRam;
+	proxyRenderer->backend->sgbMapRam = renderer->sgbMapRam;
+	proxyRenderer->backend->sgbPalRam = renderer->sgbPalRam;
+	proxyRenderer->backend->sgbAttributeFiles = renderer->sgbAttributeFiles;
+	proxyRenderer->backend->sgbAttributes = renderer->sgbAttributes;
+	if (proxyRenderer->logger->block && proxyRenderer->logger->wait) {
+		// The backend may need to be set up on the thread that draws, e.g. for OpenGL
+		proxyRenderer->logger->postEvent(proxyRenderer->logger, LOGGER_EVENT_INIT);
+	} else {
+		proxyRenderer->backend->init(proxyRenderer->backend, model, borders);
+	}
 }
 
 void GBVideoProxyRendererDeinit(struct GBVideoRenderer* renderer) {
 	struct GBVideoProxyRenderer* proxyRenderer = (struct GBVideoProxyRenderer*) renderer;
 
-	proxyRenderer->backend->deinit(proxyRenderer->backend);
+	if (proxyRenderer->logger->block && proxyRenderer->logger->wait) {
+		mVideoLoggerRendererFlush(proxyRenderer->logger);
+		proxyRenderer->logger->postEvent(proxyRenderer->logger, LOGGER_EVENT_DEINIT);
+	} else {
+		proxyRenderer->backend->deinit(proxyRenderer->backend);
+	}
 
 	mVideoLoggerRendererDeinit(proxyRenderer->logger);
 }
 
+static void _handleEvent(struct mVideoLogger* logger, enum mVideoLoggerEvent event) {
+	struct GBVideoProxyRenderer* proxyRenderer = logger->context;
+	switch (event) {
+	default:
+		break;
+	case LOGGER_EVENT_INIT:
+		proxyRenderer->backend->init(proxyRenderer->backend, proxyRenderer->model, proxyRenderer->borders);
+		break;
+	case LOGGER_EVENT_DEINIT:
+		proxyRenderer->backend->deinit(proxyRenderer->backend);
+		break;
+	case LOGGER_EVENT_GET_PIXELS:
+		proxyRenderer->backend->getPixels(proxyRenderer->backend, &logger->pixelStride, &logger->pixelBuffer);
+		break;
+	}
+}
+
 static bool _parsePacket(struct mVideoLogger* logger, const struct mVideoLoggerDirtyInfo* item) {
 	struct GBVideoProxyRenderer* proxyRenderer = logger->context;
 	uint8_t sgbPacket[16];
 	struct GBObj legacyBuffer[GB_VIDEO_MAX_OBJ];
+	uint32_t address;
 	switch (item->type) {
 	case DIRTY_REGISTER:
 		proxyRenderer->backend->writeVideoRegister(proxyRenderer->backend, item->address, item->value);
@@ -167,7 +203,19 @@ static bool _parsePacket(struct mVideoLogger* logger, const struct mVideoLoggerD
 	case DIRTY_VRAM:
 		if (item->address <= GB_SIZE_VRAM - 0x1000) {
 			logger->readData(logger, &logger->vram[item->address >> 1], 0x1000, true);
-			proxyRenderer->backend->writeVRAM(proxyRenderer->backend, item->address);
+			// The whole block changed, so let the backend know about every tile in it
+			uint16_t address;
+			for (address = item->address; address < item->address + 0x1000; address += 16) {
+				proxyRenderer->backend->writeVRAM(proxyRenderer->backend, address);
+			}
+		}
+		break;
+	case DIRTY_VRAM_SWAP:
+		proxyRenderer->backend->vram = (uint8_t*) logger->vram;
+		for (address = 0; address < GB_SIZE_VRAM; address += 16) {
+			if (item->value & (1U << (address >> 12))) {
+				proxyRenderer->backend->writeVRAM(proxyRenderer->backend, address);
+			}
 		}
 		break;
 	case DIRTY_SCANLINE:
@@ -12,6 +12,7 @@
 
 #include <mgba/core/core.h>
 #include <mgba/core/cheats.h>
+#include <mgba/core/shared-rom.h>
 #include <mgba-util/crc32.h>
 #include <mgba-util/memory.h>
 #include <mgba-util/math.h>
@@ -70,6 +71,7 @@ static void GBIllegal(struct SM83Core* cpu);
 static void GBStop(struct SM83Core* cpu);
 
 static void _enableInterrupts(struct mTiming* timing, void* user, uint32_t cyclesLate);
+static uint32_t _GBBiosCRC32(struct VFile* vf);
 
 void GBCreate(struct GB* gb) {
 	gb->d.id = GB_COMPONENT_MAGIC;
@@ -98,12 +100,16 @@ static void GBInit(void* cpu, struct mCPUComponent* component) {
 
 	gb->model = GB_MODEL_AUTODETECT;
 
+	gb->idleOptimization = GB_IDLE_LOOP_REMOVE;
+	gb->idleLoop = GB_IDLE_LOOP_NONE;
+
 	gb->biosVf = NULL;
 	gb->romVf = NULL;
 	gb->sramVf = NULL;
 	gb->sramRealVf = NULL;
 
 	gb->isPristine = false;
+	gb->romShared = false;
 	gb->pristineRomSize = 0;
 	gb->yankedRomSize = 0;
 	gb->sramSize = 0;
@@ -208,7 +214,17 @@ bool GBLoadROM(struct GB* gb, struct VFile* vf) {
 	}
 	gb->yankedRomSize = 0;
 	gb->memory.romSize = gb->pristineRomSize;
+	// The checksum reads the whole ROM anyway, so let the reads start ahead of it
+	mappedMemoryAdvise(gb->memory.rom, gb->memory.romSize, mMEMORY_ADVICE_READ_AHEAD);
 	gb->romCrc32 = doCrc32(gb->memory.rom, gb->memory.romSize);
+	if (mSharedROMIsEnabled()) {
+		void* sharedRom = mSharedROMAcquire(gb->memory.rom, gb->memory.romSize, GB_SIZE_CART_MAX, gb->romCrc32);
+		if (sharedRom) {
+			vf->unmap(vf, gb->memory.rom, gb->pristineRomSize);
+			gb->memory.rom = sharedRom;
+			gb->romShared = true;
+		}
+	}
 	GBMBCReset(gb);
 
 	if (gb->cpu) {
@@ -223,6 +239,49 @@ bool GBLoadROM(struct GB* gb, struct VFile* vf) {
 	return true;
 }
 
+bool GBCloneROM(struct GB* gb, const struct GB* source) {
+	if (!source->memory.rom) {
+		return false;
+	}
+	GBUnloadROM(gb);
+	void* rom = NULL;
+	if (source->romShared && source->isPristine) {
+		rom = mSharedROMDuplicate(source->memory.rom);
+	}
+	if (rom) {
+		gb->romShared = true;
+		gb->isPristine = true;
+	} else {
+		rom = anonymousMemoryMap(GB_SIZE_CART_MAX);
+		if (!rom) {
+			return false;
+		}
+		size_t size = source->memory.romSize;
+		if (source->yankedRomSize) {
+			size = source->yankedRomSize;
+		}
+		memcpy(rom, source->memory.rom, size);
+		gb->isPristine = false;
+	}
+	gb->memory.rom = rom;
+	gb->gbx = source->gbx;
+	gb->pristineRomSize = source->pristineRomSize;
+	gb->memory.romSize = source->memory.romSize;
+	gb->yankedRomSize = source->yankedRomSize;
+	gb->yankedMbc = source->yankedMbc;
+	gb->romCrc32 = source->romCrc32;
+	GBMBCReset(gb);
+
+	if (gb->cpu) {
+		struct SM83Core* cpu = gb->cpu;
+		if (!gb->memory.romBase) {
+			GBMBCSwitchBank0(gb, 0);
+		}
+		cpu->memory.setActiveRegion(cpu, cpu->pc);
+	}
+	return true;
+}
+
 void GBYankROM(struct GB* gb) {
 	gb->yankedRomSize = gb->memory.romSize;
 	gb->yankedMbc = gb->memory.mbcType;
@@ -253,6 +312,7 @@ static void GBSramDeinit(struct GB* gb) {
 		mappedMemoryFree(gb->memory.sram, gb->sramSize);
 	}
 	gb->memory.sram = NULL;
+	GBMemoryUpdatePages(&gb->memory);
 }
 
 bool GBLoadSave(struct GB* gb, struct VFile* vf) {
@@ -368,6 +428,7 @@ void GBResizeSram(struct GB* gb, size_t size) {
 	if (gb->sramSize < size) {
 		gb->sramSize = size;
 	}
+	GBMemoryUpdatePages(&gb->memory);
 }
 
 void GBSramClean(struct GB* gb, uint32_t frameCount) {
@@ -439,7 +500,12 @@ void GBUnloadROM(struct GB* gb) {
 	if (romBase >= 0 && ((size_t) romBase < gb->memory.romSize || (size_t) romBase < gb->yankedRomSize)) {
 		gb->memory.romBase = NULL;
 	}
-	if (gb->memory.rom && !gb->isPristine) {
+	if (gb->romShared) {
+		gb->yankedRomSize = 0;
+		mSharedROMRelease(gb->memory.rom);
+		gb->memory.rom = NULL;
+		gb->romShared = false;
+	} else if (gb->memory.rom && !gb->isPristine) {
 		if (gb->yankedRomSize) {
 			gb->yankedRomSize = 0;
 		}
@@ -460,6 +526,7 @@ void GBUnloadROM(struct GB* gb) {
 	gb->isPristine = false;
 	gb->pristineRomSize = 0;
 	gb->memory.romSize = 0;
+	gb->idleLoop = GB_IDLE_LOOP_NONE;
 
 	if (!gb->sramDirty) {
 		gb->sramMaskWriteback = false;
@@ -493,6 +560,32 @@ void GBLoadBIOS(struct GB* gb, struct VFile* vf) {
 	gb->biosVf = vf;
 }
 
+void GBCloneBIOS(struct GB* gb, const struct GB* source) {
+	ssize_t size = 0;
+	if (source->biosVf) {
+		size = source->biosVf->size(source->biosVf);
+	}
+	if (gb->biosVf) {
+		if (size > 0 && gb->biosVf->size(gb->biosVf) == size && _GBBiosCRC32(gb->biosVf) == _GBBiosCRC32(source->biosVf)) {
+			return;
+		}
+		gb->biosVf->close(gb->biosVf);
+		gb->biosVf = NULL;
+	}
+	if (size <= 0) {
+		return;
+	}
+	struct VFile* vf = VFileMemChunk(NULL, size);
+	if (!vf) {
+		return;
+	}
+	void* bios = vf->map(vf, size, MAP_WRITE);
+	source->biosVf->seek(source->biosVf, 0, SEEK_SET);
+	source->biosVf->read(source->biosVf, bios, size);
+	vf->unmap(vf, bios, size);
+	gb->biosVf = vf;
+}
+
 void GBApplyPatch(struct GB* gb, struct Patch* patch) {
 	size_t patchedSize = patch->outputSize(patch, gb->memory.romSize);
 	if (!patchedSize) {
@@ -509,7 +602,10 @@ void GBApplyPatch(struct GB* gb, struct Patch* patch) {
 		mappedMemoryFree(newRom, GB_SIZE_CART_MAX);
 		return;
 	}
-	if (gb->romVf && gb->isPristine) {
+	if (gb->romShared) {
+		mSharedROMRelease(gb->memory.rom);
+		gb->romShared = false;
+	} else if (gb->romVf && gb->isPristine) {
 #ifndef FIXED_ROM_BUFFER
 		gb->romVf->unmap(gb->romVf, gb->memory.rom, gb->pristineRomSize);
 #endif
@@ -527,6 +623,7 @@ void GBApplyPatch(struct GB* gb, struct Patch* patch) {
 		GBMBCInit(gb);
 	}
 	gb->romCrc32 = doCrc32(gb->memory.rom, gb->memory.romSize);
+	GBMemoryUpdatePages(&gb->memory);
 	gb->cpu->memory.setActiveRegion(gb->cpu, gb->cpu->pc);
 }
 
@@ -539,9 +636,10 @@ void GBDestroy(struct GB* gb) {
 		gb->biosVf = 0;
 	}
 
-	GBMemoryDeinit(gb);
 	GBAudioDeinit(&gb->audio);
+	// The renderer may still be using VRAM until it's deinitialized
 	GBVideoDeinit(&gb->video);
+	GBMemoryDeinit(gb);
 	GBSIODeinit(&gb->sio);
 	mCoreCallbacksListDeinit(&gb->coreCallbacks);
 }
@@ -618,6 +716,10 @@ void GBReset(struct SM83Core* cpu) {
 	gb->earlyExit = false;
 	gb->doubleSpeed = 0;
 
+	gb->lastJump = GB_IDLE_LOOP_NONE;
+	gb->idleDetectionStep = 0;
+	gb->idleDetectionFailures = 0;
+
 	if (gb->yankedRomSize) {
 		gb->memory.romSize = gb->yankedRomSize;
 		gb->memory.mbcType = gb->yankedMbc;
@@ -670,6 +772,7 @@ void GBReset(struct SM83Core* cpu) {
 	}
 
 	GBVideoReset(&gb->video);
+	GBMemoryMarkDirty(&gb->memory);
 	GBTimerReset(&gb->timer);
 	GBIOReset(gb);
 	GBAudioReset(&gb->audio);
@@ -855,6 +958,7 @@ void GBMapBIOS(struct GB* gb) {
 			memcpy(&gb->memory.romBase[0x100], &gb->memory.rom[0x100], 0x100);
 		}
 	}
+	GBMemoryUpdatePages(&gb->memory);
 }
 
 void GBUnmapBIOS(struct GB* gb) {
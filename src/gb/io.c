@@ -198,6 +198,7 @@ void GBIOReset(struct GB* gb) {
 }
 
 void GBIOWrite(struct GB* gb, unsigned address, uint8_t value) {
+	gb->memory.ioDirty = gb->memory.dirtyGeneration;
 	switch (address) {
 	case GB_REG_SB:
 		GBSIOWriteSB(&gb->sio, value);
@@ -425,13 +426,18 @@ void GBIOWrite(struct GB* gb, unsigned address, uint8_t value) {
 	case GB_REG_SCX:
 	case GB_REG_WY:
 	case GB_REG_WX:
-		GBVideoProcessDots(&gb->video, 0);
+		// Rewriting the same value can't change what's drawn, so don't split the line for it
+		if (value != gb->memory.io[address]) {
+			GBVideoProcessDots(&gb->video, 0);
+		}
 		value = gb->video.renderer->writeVideoRegister(gb->video.renderer, address, value);
 		break;
 	case GB_REG_BGP:
 	case GB_REG_OBP0:
 	case GB_REG_OBP1:
-		GBVideoProcessDots(&gb->video, 0);
+		if (value != gb->memory.io[address]) {
+			GBVideoProcessDots(&gb->video, 0);
+		}
 		GBVideoWritePalette(&gb->video, address, value);
 		break;
 	case GB_REG_STAT:
@@ -673,6 +679,34 @@ uint8_t GBIORead(struct GB* gb, unsigned address) {
 	return gb->memory.io[address] | _registerMask[address];
 }
 
+bool GBIOIsReadConstant(unsigned address) {
+	switch (address) {
+	case GB_REG_WAVE_0:
+	case GB_REG_WAVE_1:
+	case GB_REG_WAVE_2:
+	case GB_REG_WAVE_3:
+	case GB_REG_WAVE_4:
+	case GB_REG_WAVE_5:
+	case GB_REG_WAVE_6:
+	case GB_REG_WAVE_7:
+	case GB_REG_WAVE_8:
+	case GB_REG_WAVE_9:
+	case GB_REG_WAVE_A:
+	case GB_REG_WAVE_B:
+	case GB_REG_WAVE_C:
+	case GB_REG_WAVE_D:
+	case GB_REG_WAVE_E:
+	case GB_REG_WAVE_F:
+	case GB_REG_PCM12:
+	case GB_REG_PCM34:
+		// These catch the audio up to the current cycle before reading
+		return false;
+	default:
+		// Everything else only changes on writes or events
+		return true;
+	}
+}
+
 void GBTestKeypadIRQ(struct GB* gb) {
 	_readKeys(gb);
 }
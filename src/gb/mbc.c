@@ -32,6 +32,7 @@ void GBMBCSwitchBank(struct GB* gb, int bank) {
 	}
 	gb->memory.romBank = &gb->memory.rom[bankStart];
 	gb->memory.currentBank = bank;
+	GBMemoryUpdatePages(&gb->memory);
 	if (gb->cpu->pc < GB_BASE_VRAM) {
 		gb->cpu->memory.setActiveRegion(gb->cpu, gb->cpu->pc);
 	}
@@ -45,6 +46,7 @@ void GBMBCSwitchBank0(struct GB* gb, int bank) {
 	}
 	gb->memory.romBase = &gb->memory.rom[bankStart];
 	gb->memory.currentBank0 = bank;
+	GBMemoryUpdatePages(&gb->memory);
 	if (gb->cpu->pc < GB_SIZE_CART_BANK0) {
 		gb->cpu->memory.setActiveRegion(gb->cpu, gb->cpu->pc);
 	}
@@ -88,6 +90,7 @@ void GBMBCSwitchHalfBank(struct GB* gb, int half, int bank) {
 		}
 		gb->memory.currentBank1 = bank;
 	}
+	GBMemoryUpdatePages(&gb->memory);
 	if (gb->cpu->pc < GB_BASE_VRAM) {
 		gb->cpu->memory.setActiveRegion(gb->cpu, gb->cpu->pc);
 	}
@@ -253,6 +256,7 @@ void GBMBCSwitchSramBank(struct GB* gb, int bank) {
 	}
 	gb->memory.sramBank = &gb->memory.sram[bankStart];
 	gb->memory.sramCurrentBank = bank;
+	GBMemoryUpdatePages(&gb->memory);
 }
 
 void GBMBCSwitchSramHalfBank(struct GB* gb, int half, int bank) {
@@ -270,6 +274,7 @@ void GBMBCSwitchSramHalfBank(struct GB* gb, int half, int bank) {
 		gb->memory.sramBank1 = &gb->memory.sram[bankStart];
 		gb->memory.currentSramBank1 = bank;
 	}
+	GBMemoryUpdatePages(&gb->memory);
 }
 
 void GBMBCInit(struct GB* gb) {
@@ -552,6 +557,7 @@ void GBMBCInit(struct GB* gb) {
 	} else if (gb->memory.mbcType == GB_TAMA5) {
 		GBMBCTAMA5Read(gb);
 	}
+	GBMemoryUpdatePages(&gb->memory);
 }
 
 void GBMBCReset(struct GB* gb) {
@@ -586,6 +592,7 @@ void GBMBCReset(struct GB* gb) {
 		break;
 	}
 	gb->memory.sramBank = gb->memory.sram;
+	GBMemoryUpdatePages(&gb->memory);
 }
 
 void _GBMBCAppendSaveSuffix(struct GB* gb, const void* buffer, size_t size) {
@@ -72,6 +72,56 @@ uint8_t _GBPocketCamRead(struct GBMemory* memory, uint16_t address) {
 	return memory->sramBank[address & (GB_SIZE_EXTERNAL_RAM - 1)];
 }
 
+static bool _GBPocketCamConvertRow(const void* image, size_t stride, enum mColorFormat format, size_t y, uint8_t* gray) {
+	size_t x;
+	switch (format) {
+	case mCOLOR_XBGR8:
+	case mCOLOR_XRGB8:
+	case mCOLOR_ARGB8:
+	case mCOLOR_ABGR8:
+	case mCOLOR_BGRX8:
+	case mCOLOR_RGBX8:
+	case mCOLOR_RGBA8:
+	case mCOLOR_BGRA8: {
+		const uint32_t* row = &((const uint32_t*) image)[y * stride];
+		for (x = 0; x < GBCAM_WIDTH; ++x) {
+			gray[x] = mColorConvert(row[x], format, mCOLOR_L8);
+		}
+		break;
+	}
+	case mCOLOR_BGR5:
+	case mCOLOR_RGB5:
+	case mCOLOR_ARGB5:
+	case mCOLOR_ABGR5:
+	case mCOLOR_BGR565:
+	case mCOLOR_RGB565:
+	case mCOLOR_BGRA5:
+	case mCOLOR_RGBA5: {
+		const uint16_t* row = &((const uint16_t*) image)[y * stride];
+		for (x = 0; x < GBCAM_WIDTH; ++x) {
+			gray[x] = mColorConvert(row[x], format, mCOLOR_L8);
+		}
+		break;
+	}
+	case mCOLOR_L8:
+		memcpy(gray, &((const uint8_t*) image)[y * stride], GBCAM_WIDTH);
+		break;
+	default:
+		return false;
+	}
+	return true;
+}
+
+static uint64_t _GBPocketCamPackLanes(const uint8_t* values) {
+	// Leftmost pixel in the top lane, so that the lanes gather into bits in screen order
+	return ((uint64_t) values[0] << 48) | ((uint64_t) values[1] << 32) | ((uint64_t) values[2] << 16) | values[3];
+}
+
+static unsigned _GBPocketCamGatherLanes(uint64_t lanes) {
+	// Collect bit 8 of each 16-bit lane into a nybble
+	return ((((lanes >> 8) & 0x0001000100010001ULL) * 0x0000200040008001ULL) >> 45) & 0xF;
+}
+
 void _GBPocketCamCapture(struct GBMemory* memory) {
 	if (!memory->cam) {
 		return;
@@ -83,60 +133,59 @@ void _GBPocketCamCapture(struct GBMemory* memory) {
 	if (!image) {
 		return;
 	}
-	memset(&memory->sram[0x100], 0, GBCAM_HEIGHT * GBCAM_WIDTH / 4);
 	struct GBPocketCamState* pocketCam = &memory->mbcState.pocketCam;
+	uint16_t exposure = (pocketCam->registers[2] << 8) | (pocketCam->registers[3]);
+
+	// Exposure scaling is monotonic, so the dither matrix can be turned into thresholds on
+	// the unscaled gray values up front instead of scaling every pixel
+	uint64_t thresholds[4][3];
 	size_t x, y;
-	for (y = 0; y < GBCAM_HEIGHT; ++y) {
-		for (x = 0; x < GBCAM_WIDTH; ++x) {
-			uint32_t gray;
-			uint32_t color;
-			switch (format) {
-			case mCOLOR_XBGR8:
-			case mCOLOR_XRGB8:
-			case mCOLOR_ARGB8:
-			case mCOLOR_ABGR8:
-			case mCOLOR_BGRX8:
-			case mCOLOR_RGBX8:
-			case mCOLOR_RGBA8:
-			case mCOLOR_BGRA8:
-				color = ((const uint32_t*) image)[y * stride + x];
-				break;
-			case mCOLOR_BGR5:
-			case mCOLOR_RGB5:
-			case mCOLOR_ARGB5:
-			case mCOLOR_ABGR5:
-			case mCOLOR_BGR565:
-			case mCOLOR_RGB565:
-			case mCOLOR_BGRA5:
-			case mCOLOR_RGBA5:
-				color = ((const uint16_t*) image)[y * stride + x];
-				break;
-			case mCOLOR_L8:
-				color = ((const uint8_t*) image)[y * stride + x];
-				break;
-			default:
-				mLOG(GB_MBC, WARN, "Unsupported pixel format: %X", format);
-				return;
+	for (y = 0; y < 4; ++y) {
+		int i;
+		for (i = 0; i < 3; ++i) {
+			uint16_t row[4];
+			for (x = 0; x < 4; ++x) {
+				// Smallest gray value that scales to at least the threshold
+				unsigned threshold = pocketCam->registers[3 * (x + 4 * y) + 6 + i];
+				if (!threshold) {
+					row[x] = 0;
+				} else if (!exposure) {
+					row[x] = 0x100;
+				} else {
+					unsigned gray = (threshold * 0x100 + exposure - 1) / exposure;
+					row[x] = gray > 0x100 ? 0x100 : gray - 1;
+				}
 			}
-			uint16_t exposure = (pocketCam->registers[2] << 8) | (pocketCam->registers[3]);
-			gray = mColorConvert(color, format, mCOLOR_L8);
-			gray = (gray + 1) * exposure / 0x100;
-			// TODO: Additional processing
-			int matrixEntry = 3 * ((x & 3) + 4 * (y & 3));
-			if (gray < pocketCam->registers[matrixEntry + 6]) {
-				gray = 0x101;
-			} else if (gray < pocketCam->registers[matrixEntry + 7]) {
-				gray = 0x100;
-			} else if (gray < pocketCam->registers[matrixEntry + 8]) {
-				gray = 0x001;
-			} else {
-				gray = 0;
+			thresholds[y][i] = ((uint64_t) row[0] << 48) | ((uint64_t) row[1] << 32) | ((uint64_t) row[2] << 16) | row[3];
+		}
+	}
+
+	uint8_t gray[GBCAM_WIDTH];
+	for (y = 0; y < GBCAM_HEIGHT; ++y) {
+		if (!_GBPocketCamConvertRow(image, stride, format, y, gray)) {
+			mLOG(GB_MBC, WARN, "Unsupported pixel format: %X", format);
+			memset(&memory->sram[0x100], 0, GBCAM_HEIGHT * GBCAM_WIDTH / 4);
+			return;
+		}
+		const uint64_t* threshold = thresholds[y & 3];
+		// TODO: Additional processing
+		for (x = 0; x < GBCAM_WIDTH; x += 8) {
+			uint8_t planes[2] = { 0, 0 };
+			int half;
+			for (half = 0; half < 2; ++half) {
+				// Each gray value sits in a 16-bit lane with bit 8 set as a guard, so that
+				// subtracting a threshold leaves the guard set exactly when it's not below it
+				uint64_t lanes = _GBPocketCamPackLanes(&gray[x + half * 4]) | 0x0100010001000100ULL;
+				uint64_t dark = ~(lanes - threshold[0]);
+				uint64_t mid = ~dark & ~(lanes - threshold[1]);
+				uint64_t light = ~dark & ~mid & ~(lanes - threshold[2]);
+				int shift = half ? 0 : 4;
+				planes[0] |= _GBPocketCamGatherLanes(dark | light) << shift;
+				planes[1] |= _GBPocketCamGatherLanes(dark | mid) << shift;
 			}
-			int coord = (((x >> 3) & 0xF) * 8 + (y & 0x7)) * 2 + (y & ~0x7) * 0x20;
-			uint16_t existing;
-			LOAD_16LE(existing, coord + 0x100, memory->sram);
-			existing |= gray << (7 - (x & 7));
-			STORE_16LE(existing, coord + 0x100, memory->sram);
+			int coord = ((x >> 3) * 8 + (y & 0x7)) * 2 + (y & ~0x7) * 0x20;
+			memory->sram[coord + 0x100] = planes[0];
+			memory->sram[coord + 0x101] = planes[1];
 		}
 	}
 }
@@ -6,6 +6,7 @@
 #include <mgba/internal/gb/memory.h>
 
 #include <mgba/core/interface.h>
+#include <mgba/core/shared-rom.h>
 #include <mgba/internal/defines.h>
 #include <mgba/internal/gb/gb.h>
 #include <mgba/internal/gb/io.h>
@@ -51,6 +52,9 @@ static const enum GBBus _oamBlockCGB[] = {
 
 static const uint8_t _blockedRegion[1] = { 0xFF };
 
+#define IDLE_LOOP_THRESHOLD 10000
+#define IDLE_LOOP_MAX_INSTRUCTIONS 16
+
 static void _pristineCow(struct GB* gba);
 
 static uint8_t GBCartLoad8(struct SM83Core* cpu, uint16_t address) {
@@ -66,9 +70,246 @@ static uint8_t GBCartLoad8(struct SM83Core* cpu, uint16_t address) {
 	return value;
 }
 
+static uint32_t _idleLoopKey(struct GB* gb, uint16_t address) {
+	if (address >= GB_BASE_CART_BANK1 && address < GB_BASE_VRAM) {
+		return address | (gb->memory.currentBank << 16);
+	}
+	return address;
+}
+
+static bool _isIdleLoad(struct GB* gb, uint16_t address) {
+	switch (address >> 12) {
+	case GB_REGION_CART_BANK0:
+	case GB_REGION_CART_BANK0 + 1:
+	case GB_REGION_CART_BANK0 + 2:
+	case GB_REGION_CART_BANK0 + 3:
+		return !gb->memory.mbcReadBank0;
+	case GB_REGION_CART_BANK1:
+	case GB_REGION_CART_BANK1 + 1:
+	case GB_REGION_CART_BANK1 + 2:
+	case GB_REGION_CART_BANK1 + 3:
+		return !gb->memory.mbcReadBank1;
+	case GB_REGION_WORKING_RAM_BANK0:
+	case GB_REGION_WORKING_RAM_BANK1:
+		return true;
+	case GB_REGION_OTHER:
+		if (address >= GB_BASE_HRAM) {
+			return true;
+		}
+		if (address >= GB_BASE_IO) {
+			return GBIOIsReadConstant(address - GB_BASE_IO);
+		}
+		return false;
+	default:
+		return false;
+	}
+}
+
+static void _analyzeForIdleLoop(struct GB* gb, struct SM83Core* cpu, uint16_t address) {
+	// Registers are numbered as in the opcodes: B, C, D, E, H, L, (HL), A
+	unsigned tainted = 0;
+	uint16_t nextAddress = address;
+	gb->idleDetectionStep = -1;
+	if (address >= GB_BASE_VRAM || (address < GB_BASE_CART_BANK1 ? gb->memory.mbcReadBank0 : gb->memory.mbcReadBank1)) {
+		return;
+	}
+	int i;
+	for (i = 0; i < IDLE_LOOP_MAX_INSTRUCTIONS && nextAddress < GB_BASE_VRAM; ++i) {
+		uint8_t opcode = GBView8(cpu, nextAddress, -1);
+		uint16_t immediate = GBView8(cpu, nextAddress + 1, -1) | (GBView8(cpu, nextAddress + 2, -1) << 8);
+		int dest = (opcode >> 3) & 7;
+		int src = opcode & 7;
+		uint16_t target = 0;
+		switch (opcode) {
+		case 0x00: // NOP
+		case 0x07: // RLCA
+		case 0x0F: // RRCA
+		case 0x17: // RLA
+		case 0x1F: // RRA
+		case 0x27: // DAA
+		case 0x2F: // CPL
+		case 0x37: // SCF
+		case 0x3F: // CCF
+			nextAddress += 1;
+			continue;
+		case 0x0A: // LD A, (BC)
+			if ((tainted & 0x03) || !_isIdleLoad(gb, cpu->bc)) {
+				return;
+			}
+			nextAddress += 1;
+			continue;
+		case 0x1A: // LD A, (DE)
+			if ((tainted & 0x0C) || !_isIdleLoad(gb, cpu->de)) {
+				return;
+			}
+			nextAddress += 1;
+			continue;
+		case 0xF0: // LDH A, (n)
+			if (!_isIdleLoad(gb, GB_BASE_IO | (immediate & 0xFF))) {
+				return;
+			}
+			nextAddress += 2;
+			continue;
+		case 0xF2: // LD A, (C)
+			if ((tainted & 0x02) || !_isIdleLoad(gb, GB_BASE_IO | cpu->c)) {
+				return;
+			}
+			nextAddress += 1;
+			continue;
+		case 0xFA: // LD A, (nn)
+			if (!_isIdleLoad(gb, immediate)) {
+				return;
+			}
+			nextAddress += 3;
+			continue;
+		case 0xCB:
+			dest = immediate & 7;
+			if (dest == 6) {
+				// Only BIT leaves (HL) alone
+				if ((immediate & 0xC0) != 0x40 || (tainted & 0x30) || !_isIdleLoad(gb, cpu->hl)) {
+					return;
+				}
+			} else if ((immediate & 0xC0) != 0x40) {
+				tainted |= 1 << dest;
+			}
+			nextAddress += 2;
+			continue;
+		case 0x18: // JR e
+		case 0x20: // JR NZ, e
+		case 0x28: // JR Z, e
+		case 0x30: // JR NC, e
+		case 0x38: // JR C, e
+			target = nextAddress + 2 + (int8_t) immediate;
+			nextAddress += 2;
+			break;
+		case 0xC2: // JP NZ, nn
+		case 0xC3: // JP nn
+		case 0xCA: // JP Z, nn
+		case 0xD2: // JP NC, nn
+		case 0xDA: // JP C, nn
+			target = immediate;
+			nextAddress += 3;
+			break;
+		case 0x76: // HALT
+			return;
+		default:
+			if (opcode >= 0x40 && opcode < 0xC0) {
+				// LD r, r' and 8-bit arithmetic on A
+				if (opcode < 0x80 && dest == 6) {
+					return;
+				}
+				if (src == 6 && ((tainted & 0x30) || !_isIdleLoad(gb, cpu->hl))) {
+					return;
+				}
+				if (opcode < 0x80) {
+					tainted |= 1 << dest;
+				}
+				nextAddress += 1;
+				continue;
+			}
+			if ((opcode & 0xC7) == 0xC6) {
+				// 8-bit arithmetic on A with an immediate
+				nextAddress += 2;
+				continue;
+			}
+			if (opcode < 0x40 && (opcode & 0x06) == 0x04 && dest != 6) {
+				// INC r, DEC r
+				tainted |= 1 << dest;
+				nextAddress += 1;
+				continue;
+			}
+			if (opcode < 0x40 && src == 6 && dest != 6) {
+				// LD r, n
+				tainted |= 1 << dest;
+				nextAddress += 2;
+				continue;
+			}
+			if (opcode < 0x30 && (opcode & 0x0F) == 0x01) {
+				// LD rr, nn
+				tainted |= 3 << ((opcode >> 4) * 2);
+				nextAddress += 3;
+				continue;
+			}
+			if (opcode < 0x30 && (opcode & 0x0F) == 0x09) {
+				// ADD HL, rr
+				tainted |= 0x30;
+				nextAddress += 1;
+				continue;
+			}
+			if (opcode < 0x30 && (opcode & 0x07) == 0x03) {
+				// INC rr, DEC rr
+				tainted |= 3 << ((opcode >> 4) * 2);
+				nextAddress += 1;
+				continue;
+			}
+			// Anything else could write to memory, touch the stack or change the interrupt state
+			return;
+		}
+		if (target == address) {
+			gb->idleLoop = _idleLoopKey(gb, address);
+			gb->idleOptimization = GB_IDLE_LOOP_REMOVE;
+			return;
+		}
+		if (opcode == 0x18 || opcode == 0xC3) {
+			return;
+		}
+		// A conditional branch out of the loop is never taken while the loop is still looping
+	}
+}
+
+static void _checkIdleLoop(struct GB* gb, struct SM83Core* cpu, uint16_t address) {
+	uint32_t key = _idleLoopKey(gb, address);
+	uint16_t registers[5] = { cpu->af, cpu->bc, cpu->de, cpu->hl, cpu->sp };
+	if (key == gb->idleLoop) {
+		int32_t now = mTimingCurrentTime(&gb->timing);
+		// Events run since the last iteration started could have changed what it read
+		bool eventsRun = (int32_t) (gb->timing.masterCycles - gb->idleLoopTime) > 0;
+		if (key == gb->lastJump && !eventsRun && !memcmp(gb->cachedRegisters, registers, sizeof(registers))) {
+			// Nothing the loop reads can change until the next event, so every iteration until
+			// then will be the same as the last one. One is left over to run up to the event.
+			int32_t period = now - gb->idleLoopTime;
+			if (period > 0) {
+				int32_t iterations = (cpu->nextEvent - cpu->cycles) / period - 1;
+				if (iterations > 0) {
+					cpu->cycles += iterations * period;
+					now += iterations * period;
+				}
+			}
+		}
+		memcpy(gb->cachedRegisters, registers, sizeof(registers));
+		gb->idleLoopTime = now;
+	} else if (gb->idleOptimization >= GB_IDLE_LOOP_DETECT) {
+		if (key == gb->lastJump) {
+			switch (gb->idleDetectionStep) {
+			case 0:
+				memcpy(gb->cachedRegisters, registers, sizeof(registers));
+				++gb->idleDetectionStep;
+				break;
+			case 1:
+				if (memcmp(gb->cachedRegisters, registers, sizeof(registers))) {
+					gb->idleDetectionStep = -1;
+					++gb->idleDetectionFailures;
+					if (gb->idleDetectionFailures > IDLE_LOOP_THRESHOLD) {
+						gb->idleOptimization = GB_IDLE_LOOP_IGNORE;
+					}
+					break;
+				}
+				_analyzeForIdleLoop(gb, cpu, address);
+				break;
+			}
+		} else {
+			gb->idleDetectionStep = 0;
+		}
+	}
+	gb->lastJump = key;
+}
+
 static void GBSetActiveRegion(struct SM83Core* cpu, uint16_t address) {
 	struct GB* gb = (struct GB*) cpu->master;
 	struct GBMemory* memory = &gb->memory;
+	if (gb->idleOptimization >= GB_IDLE_LOOP_REMOVE) {
+		_checkIdleLoop(gb, cpu, address);
+	}
 	switch (address >> 12) {
 	case GB_REGION_CART_BANK0:
 	case GB_REGION_CART_BANK0 + 1:
@@ -150,8 +391,16 @@ void GBMemoryInit(struct GB* gb) {
 	cpu->memory.setActiveRegion = GBSetActiveRegion;
 	cpu->memory.accessSource = mACCESS_UNKNOWN;
 
-	gb->memory.wram = NULL;
+#ifdef ENABLE_HUGE_PAGES
+	gb->memory.arena = hugeMemoryMap(GB_SIZE_ARENA);
+#else
+	gb->memory.arena = anonymousMemoryMap(GB_SIZE_ARENA);
+#endif
+	mappedMemoryAdvise(gb->memory.arena, GB_SIZE_ARENA, mMEMORY_ADVICE_PREFAULT);
+	gb->memory.wram = &gb->memory.arena[GB_ARENA_WRAM];
 	gb->memory.wramBank = NULL;
+	gb->memory.dirtyGeneration = 1;
+	GBMemoryMarkDirty(&gb->memory);
 	gb->memory.rom = NULL;
 	gb->memory.romBank = NULL;
 	gb->memory.romSize = 0;
@@ -159,6 +408,8 @@ void GBMemoryInit(struct GB* gb) {
 	gb->memory.mbcType = GB_MBC_AUTODETECT;
 	gb->memory.mbcRead = NULL;
 	gb->memory.mbcWrite = NULL;
+	memset(gb->memory.readPages, 0, sizeof(gb->memory.readPages));
+	memset(gb->memory.writePages, 0, sizeof(gb->memory.writePages));
 
 	gb->memory.rtc = NULL;
 	gb->memory.rotation = NULL;
@@ -169,17 +420,23 @@ void GBMemoryInit(struct GB* gb) {
 }
 
 void GBMemoryDeinit(struct GB* gb) {
-	mappedMemoryFree(gb->memory.wram, GB_SIZE_WORKING_RAM);
-	if (gb->memory.rom) {
+#ifdef ENABLE_HUGE_PAGES
+	hugeMemoryFree(gb->memory.arena, GB_SIZE_ARENA);
+#else
+	mappedMemoryFree(gb->memory.arena, GB_SIZE_ARENA);
+#endif
+	gb->memory.arena = NULL;
+	gb->memory.wram = NULL;
+	if (gb->romShared) {
+		mSharedROMRelease(gb->memory.rom);
+		gb->romShared = false;
+	} else if (gb->memory.rom) {
 		mappedMemoryFree(gb->memory.rom, gb->memory.romSize);
 	}
 }
 
 void GBMemoryReset(struct GB* gb) {
-	if (gb->memory.wram) {
-		mappedMemoryFree(gb->memory.wram, GB_SIZE_WORKING_RAM);
-	}
-	gb->memory.wram = anonymousMemoryMap(GB_SIZE_WORKING_RAM);
+	memset(gb->memory.wram, 0, GB_SIZE_WORKING_RAM);
 	if (gb->model >= GB_MODEL_CGB) {
 		uint32_t* base = (uint32_t*) gb->memory.wram;
 		size_t i;
@@ -231,6 +488,7 @@ void GBMemoryReset(struct GB* gb) {
 	memset(&gb->memory.hram, 0, sizeof(gb->memory.hram));
 
 	GBMBCReset(gb);
+	GBMemoryUpdatePages(&gb->memory);
 }
 
 void GBMemorySwitchWramBank(struct GBMemory* memory, int bank) {
@@ -240,6 +498,67 @@ void GBMemorySwitchWramBank(struct GBMemory* memory, int bank) {
 	}
 	memory->wramBank = &memory->wram[GB_SIZE_WORKING_RAM_BANK0 * bank];
 	memory->wramCurrentBank = bank;
+	GBMemoryUpdatePages(memory);
+}
+
+void GBMemoryUpdatePages(struct GBMemory* memory) {
+	// Anything with side effects, or that the MBC wants to see, keeps going through the
+	// full handlers, so this has to be called whenever one of the inputs here changes
+	memset(memory->readPages, 0, sizeof(memory->readPages));
+	memset(memory->writePages, 0, sizeof(memory->writePages));
+	size_t offset;
+	if (memory->romBase && !memory->mbcReadBank0) {
+		for (offset = 0; offset < GB_SIZE_CART_BANK0; offset += GB_SIZE_ACCESS_PAGE) {
+			if (GB_BASE_CART_BANK0 + offset + GB_SIZE_ACCESS_PAGE <= memory->romSize) {
+				memory->readPages[(GB_BASE_CART_BANK0 + offset) >> GB_ACCESS_PAGE_SHIFT] = &memory->romBase[offset];
+			}
+		}
+	}
+	if (memory->romBank && !memory->mbcReadBank1) {
+		bool split = memory->mbcType == GB_MBC6 || (memory->mbcType == GB_UNL_NT_NEW && memory->mbcState.ntNew.splitMode);
+		for (offset = 0; offset < GB_SIZE_CART_BANK0; offset += GB_SIZE_ACCESS_PAGE) {
+			const uint8_t** page = &memory->readPages[(GB_BASE_CART_BANK1 + offset) >> GB_ACCESS_PAGE_SHIFT];
+			if (split && offset >= GB_SIZE_CART_HALFBANK) {
+				*page = memory->romBank1 ? &memory->romBank1[offset - GB_SIZE_CART_HALFBANK] : NULL;
+			} else if (GB_BASE_CART_BANK1 + offset + GB_SIZE_ACCESS_PAGE <= memory->romSize) {
+				*page = &memory->romBank[offset];
+			}
+		}
+	}
+	if (memory->sram && memory->sramBank && memory->sramAccess && !memory->rtcAccess && !memory->mbcRead) {
+		for (offset = 0; offset < GB_SIZE_EXTERNAL_RAM; offset += GB_SIZE_ACCESS_PAGE) {
+			memory->readPages[(GB_BASE_EXTERNAL_RAM + offset) >> GB_ACCESS_PAGE_SHIFT] = &memory->sramBank[offset];
+		}
+	}
+	if (memory->wramBank) {
+		if (!memory->mbcReadHigh) {
+			memory->readPages[GB_REGION_WORKING_RAM_BANK0] = memory->wram;
+			memory->readPages[GB_REGION_WORKING_RAM_BANK1] = memory->wramBank;
+			memory->readPages[GB_REGION_WORKING_RAM_BANK0 + 2] = memory->wram;
+		}
+		if (!memory->mbcWriteHigh) {
+			memory->writePages[GB_REGION_WORKING_RAM_BANK0] = memory->wram;
+			memory->writePages[GB_REGION_WORKING_RAM_BANK1] = memory->wramBank;
+			memory->writePages[GB_REGION_WORKING_RAM_BANK0 + 2] = memory->wram;
+		}
+	}
+}
+
+void GBMemoryMarkDirty(struct GBMemory* memory) {
+	size_t i;
+	for (i = 0; i < GB_DIRTY_PAGES_MAX; ++i) {
+		memory->dirtyPages[i] = memory->dirtyGeneration;
+	}
+	memory->ioDirty = memory->dirtyGeneration;
+	memory->paletteDirty = memory->dirtyGeneration;
+	memory->oamDirty = memory->dirtyGeneration;
+}
+
+uint32_t GBMemoryCheckpoint(struct GBMemory* memory) {
+	// Stamps are 32-bit, so this would take over a year of checkpointing every frame to wrap
+	uint32_t checkpoint = memory->dirtyGeneration;
+	++memory->dirtyGeneration;
+	return checkpoint;
 }
 
 uint8_t GBLoad8(struct SM83Core* cpu, uint16_t address) {
@@ -256,6 +575,15 @@ uint8_t GBLoad8(struct SM83Core* cpu, uint16_t address) {
 			return 0xFF;
 		}
 	}
+	const uint8_t* page = memory->readPages[address >> GB_ACCESS_PAGE_SHIFT];
+	if (LIKELY(page)) {
+		uint8_t value = page[address & (GB_SIZE_ACCESS_PAGE - 1)];
+		if (address < GB_BASE_WORKING_RAM_BANK0) {
+			memory->cartBus = value;
+			memory->cartBusPc = cpu->pc;
+		}
+		return value;
+	}
 	switch (address >> 12) {
 	case GB_REGION_CART_BANK0:
 	case GB_REGION_CART_BANK0 + 1:
@@ -345,6 +673,11 @@ uint8_t GBLoad8(struct SM83Core* cpu, uint16_t address) {
 	}
 }
 
+#define MARK_DIRTY_WRAM(BYTE) \
+	memory->dirtyPages[GB_DIRTY_PAGES_WRAM + (((BYTE) - memory->wram) >> mSTATE_PAGE_SHIFT)] = memory->dirtyGeneration
+#define MARK_DIRTY_VRAM(BYTE) \
+	memory->dirtyPages[GB_DIRTY_PAGES_VRAM + (((BYTE) - gb->video.vram) >> mSTATE_PAGE_SHIFT)] = memory->dirtyGeneration
+
 void GBStore8(struct SM83Core* cpu, uint16_t address, int8_t value) {
 	struct GB* gb = (struct GB*) cpu->master;
 	struct GBMemory* memory = &gb->memory;
@@ -359,6 +692,12 @@ void GBStore8(struct SM83Core* cpu, uint16_t address, int8_t value) {
 			return;
 		}
 	}
+	uint8_t* page = memory->writePages[address >> GB_ACCESS_PAGE_SHIFT];
+	if (LIKELY(page)) {
+		page[address & (GB_SIZE_ACCESS_PAGE - 1)] = value;
+		MARK_DIRTY_WRAM(&page[address & (GB_SIZE_ACCESS_PAGE - 1)]);
+		return;
+	}
 	switch (address >> 12) {
 	case GB_REGION_CART_BANK0:
 	case GB_REGION_CART_BANK0 + 1:
@@ -369,6 +708,7 @@ void GBStore8(struct SM83Core* cpu, uint16_t address, int8_t value) {
 	case GB_REGION_CART_BANK1 + 2:
 	case GB_REGION_CART_BANK1 + 3:
 		memory->mbcWrite(gb, address, value);
+		GBMemoryUpdatePages(memory);
 		cpu->memory.setActiveRegion(cpu, cpu->pc);
 		return;
 	case GB_REGION_VRAM:
@@ -376,6 +716,7 @@ void GBStore8(struct SM83Core* cpu, uint16_t address, int8_t value) {
 		if (gb->video.mode != 3) {
 			gb->video.renderer->writeVRAM(gb->video.renderer, (address & (GB_SIZE_VRAM_BANK0 - 1)) | (GB_SIZE_VRAM_BANK0 * gb->video.vramCurrentBank));
 			gb->video.vramBank[address & (GB_SIZE_VRAM_BANK0 - 1)] = value;
+			MARK_DIRTY_VRAM(&gb->video.vramBank[address & (GB_SIZE_VRAM_BANK0 - 1)]);
 		}
 		return;
 	case GB_REGION_EXTERNAL_RAM:
@@ -389,27 +730,34 @@ void GBStore8(struct SM83Core* cpu, uint16_t address, int8_t value) {
 			}
 		} else {
 			memory->mbcWrite(gb, address, value);
+			GBMemoryUpdatePages(memory);
 		}
 		return;
 	case GB_REGION_WORKING_RAM_BANK0:
 	case GB_REGION_WORKING_RAM_BANK0 + 2:
 		if (memory->mbcWriteHigh) {
 			memory->mbcWrite(gb, address, value);
+			GBMemoryUpdatePages(memory);
 		}
 		memory->wram[address & (GB_SIZE_WORKING_RAM_BANK0 - 1)] = value;
+		MARK_DIRTY_WRAM(&memory->wram[address & (GB_SIZE_WORKING_RAM_BANK0 - 1)]);
 		return;
 	case GB_REGION_WORKING_RAM_BANK1:
 		if (memory->mbcWriteHigh) {
 			memory->mbcWrite(gb, address, value);
+			GBMemoryUpdatePages(memory);
 		}
 		memory->wramBank[address & (GB_SIZE_WORKING_RAM_BANK0 - 1)] = value;
+		MARK_DIRTY_WRAM(&memory->wramBank[address & (GB_SIZE_WORKING_RAM_BANK0 - 1)]);
 		return;
 	default:
 		if (address < GB_BASE_OAM) {
 			memory->wramBank[address & (GB_SIZE_WORKING_RAM_BANK0 - 1)] = value;
+			MARK_DIRTY_WRAM(&memory->wramBank[address & (GB_SIZE_WORKING_RAM_BANK0 - 1)]);
 		} else if (address < GB_BASE_UNUSABLE) {
 			if (gb->video.mode < 2) {
 				gb->video.oam.raw[address & 0xFF] = value;
+				gb->memory.oamDirty = gb->memory.dirtyGeneration;
 				gb->video.renderer->writeOAM(gb->video.renderer, address & 0xFF);
 			}
 		} else if (address < GB_BASE_IO) {
@@ -592,8 +940,69 @@ uint8_t GBMemoryWriteHDMA5(struct GB* gb, uint8_t value) {
 	return value & 0x7F;
 }
 
+// Bytes a DMA transfer can copy in one go from the page table. The PPU only looks at
+// OAM and VRAM on its own mode changes, and while DMA runs the CPU is either stalled
+// or kept off the source and destination buses, so copying ahead is invisible as long
+// as it stops short of the next mode change. The final byte is never included, so it
+// still lands, and releases the CPU, at the cycle it always did. Nothing is batched
+// while the memory accessors are hooked, e.g. by debugger watchpoints, so that they
+// still see every byte.
+static int _GBMemoryDMABatch(struct GB* gb, uint16_t source, int remaining, int cyclesPerByte, uint32_t cyclesLate) {
+	if (remaining < 2 || !gb->memory.readPages[source >> GB_ACCESS_PAGE_SHIFT]) {
+		return 0;
+	}
+	if (gb->cpu->memory.load8 != GBLoad8 || gb->cpu->memory.store8 != GBStore8) {
+		return 0;
+	}
+	int batch = remaining - 1;
+	int toPageEnd = GB_SIZE_ACCESS_PAGE - (source & (GB_SIZE_ACCESS_PAGE - 1));
+	if (batch > toPageEnd) {
+		batch = toPageEnd;
+	}
+	if (mTimingIsScheduled(&gb->timing, &gb->video.modeEvent)) {
+		int32_t until = mTimingUntil(&gb->timing, &gb->video.modeEvent) + (int32_t) cyclesLate;
+		if (until <= 0) {
+			return 0;
+		}
+		int beforeMode = (until + cyclesPerByte - 1) / cyclesPerByte;
+		if (batch > beforeMode) {
+			batch = beforeMode;
+		}
+	}
+	return batch > 1 ? batch : 0;
+}
+
+static const uint8_t* _GBMemoryDMARead(struct GB* gb, uint16_t source, int length) {
+	const uint8_t* block = &gb->memory.readPages[source >> GB_ACCESS_PAGE_SHIFT][source & (GB_SIZE_ACCESS_PAGE - 1)];
+	if (source < GB_BASE_WORKING_RAM_BANK0) {
+		gb->memory.cartBus = block[length - 1];
+		gb->memory.cartBusPc = gb->cpu->pc;
+	}
+	return block;
+}
+
 void _GBMemoryDMAService(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 	struct GB* gb = context;
+	int cyclesPerByte = 4 * (2 - gb->doubleSpeed);
+	int batch = 0;
+	// The CPU keeps running during OAM DMA, so with the LCD off it could turn it on at any time
+	if (mTimingIsScheduled(timing, &gb->video.modeEvent)) {
+		batch = _GBMemoryDMABatch(gb, gb->memory.dmaSource, gb->memory.dmaRemaining, cyclesPerByte, cyclesLate);
+	}
+	if (batch) {
+		const uint8_t* block = _GBMemoryDMARead(gb, gb->memory.dmaSource, batch);
+		memcpy(&gb->video.oam.raw[gb->memory.dmaDest], block, batch);
+		int i;
+		gb->memory.oamDirty = gb->memory.dirtyGeneration;
+		for (i = 0; i < batch; ++i) {
+			gb->video.renderer->writeOAM(gb->video.renderer, gb->memory.dmaDest + i);
+		}
+		gb->memory.dmaSource += batch;
+		gb->memory.dmaDest += batch;
+		gb->memory.dmaRemaining -= batch;
+		mTimingSchedule(timing, &gb->memory.dmaEvent, cyclesPerByte * batch - cyclesLate);
+		return;
+	}
 	int dmaRemaining = gb->memory.dmaRemaining;
 	gb->memory.dmaRemaining = 0;
 	enum mMemoryAccessSource oldAccess = gb->cpu->memory.accessSource;
@@ -601,19 +1010,54 @@ void _GBMemoryDMAService(struct mTiming* timing, void* context, uint32_t cyclesL
 	uint8_t b = GBLoad8(gb->cpu, gb->memory.dmaSource);
 	// TODO: Can DMA write OAM during modes 2-3?
 	gb->video.oam.raw[gb->memory.dmaDest] = b;
+	gb->memory.oamDirty = gb->memory.dirtyGeneration;
 	gb->video.renderer->writeOAM(gb->video.renderer, gb->memory.dmaDest);
 	gb->cpu->memory.accessSource = oldAccess;
 	++gb->memory.dmaSource;
 	++gb->memory.dmaDest;
 	gb->memory.dmaRemaining = dmaRemaining - 1;
 	if (gb->memory.dmaRemaining) {
-		mTimingSchedule(timing, &gb->memory.dmaEvent, 4 * (2 - gb->doubleSpeed) - cyclesLate);
+		mTimingSchedule(timing, &gb->memory.dmaEvent, cyclesPerByte - cyclesLate);
+	}
+}
+
+static int _GBMemoryHDMABatch(struct GB* gb, uint32_t cyclesLate) {
+	struct GBMemory* memory = &gb->memory;
+	// OAM DMA blocks some sources, and VRAM can't be written during mode 3
+	if (memory->dmaRemaining || gb->video.mode == 3) {
+		return 0;
 	}
+	int batch = _GBMemoryDMABatch(gb, memory->hdmaSource, memory->hdmaRemaining, 4, cyclesLate);
+	if (batch > GB_BASE_EXTERNAL_RAM - memory->hdmaDest) {
+		batch = GB_BASE_EXTERNAL_RAM - memory->hdmaDest;
+	}
+	return batch > 1 ? batch : 0;
 }
 
 void _GBMemoryHDMAService(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 	struct GB* gb = context;
+	struct GBMemory* memory = &gb->memory;
 	gb->cpuBlocked = true;
+	int batch = _GBMemoryHDMABatch(gb, cyclesLate);
+	if (batch) {
+		const uint8_t* block = _GBMemoryDMARead(gb, memory->hdmaSource, batch);
+		uint16_t offset = memory->hdmaDest & (GB_SIZE_VRAM_BANK0 - 1);
+		int i;
+		for (i = 0; i < batch; ++i) {
+			gb->video.renderer->writeVRAM(gb->video.renderer, (offset + i) | (GB_SIZE_VRAM_BANK0 * gb->video.vramCurrentBank));
+		}
+		memcpy(&gb->video.vramBank[offset], block, batch);
+		for (i = 0; i < batch; i += mSTATE_PAGE_SIZE) {
+			MARK_DIRTY_VRAM(&gb->video.vramBank[offset + i]);
+		}
+		MARK_DIRTY_VRAM(&gb->video.vramBank[offset + batch - 1]);
+		memory->hdmaSource += batch;
+		memory->hdmaDest += batch;
+		memory->hdmaRemaining -= batch;
+		mTimingDeschedule(timing, &memory->hdmaEvent);
+		mTimingSchedule(timing, &memory->hdmaEvent, 4 * batch - cyclesLate);
+		return;
+	}
 	enum mMemoryAccessSource oldAccess = gb->cpu->memory.accessSource;
 	gb->cpu->memory.accessSource = mACCESS_DMA;
 	uint8_t b = gb->cpu->memory.load8(gb->cpu, gb->memory.hdmaSource);
@@ -676,12 +1120,14 @@ void GBPatch8(struct SM83Core* cpu, uint16_t address, int8_t value, int8_t* old,
 		if (segment < 0) {
 			oldValue = gb->video.vramBank[address & (GB_SIZE_VRAM_BANK0 - 1)];
 			gb->video.vramBank[address & (GB_SIZE_VRAM_BANK0 - 1)] = value;
+			MARK_DIRTY_VRAM(&gb->video.vramBank[address & (GB_SIZE_VRAM_BANK0 - 1)]);
 			gb->video.renderer->writeVRAM(gb->video.renderer, (address & (GB_SIZE_VRAM_BANK0 - 1)) + GB_SIZE_VRAM_BANK0 * gb->video.vramCurrentBank);
 		} else if (segment == 1 && gb->model < GB_MODEL_CGB) {
 			return;
 		} else if (segment < 2) {
 			oldValue = gb->video.vram[(address & (GB_SIZE_VRAM_BANK0 - 1)) + segment * GB_SIZE_VRAM_BANK0];
-			gb->video.vramBank[(address & (GB_SIZE_VRAM_BANK0 - 1)) + segment * GB_SIZE_VRAM_BANK0] = value;
+			gb->video.vram[(address & (GB_SIZE_VRAM_BANK0 - 1)) + segment * GB_SIZE_VRAM_BANK0] = value;
+			MARK_DIRTY_VRAM(&gb->video.vram[(address & (GB_SIZE_VRAM_BANK0 - 1)) + segment * GB_SIZE_VRAM_BANK0]);
 			gb->video.renderer->writeVRAM(gb->video.renderer, (address & (GB_SIZE_VRAM_BANK0 - 1)) + segment * GB_SIZE_VRAM_BANK0);
 		} else {
 			return;
@@ -703,11 +1149,13 @@ void GBPatch8(struct SM83Core* cpu, uint16_t address, int8_t value, int8_t* old,
 	case GB_REGION_WORKING_RAM_BANK0 + 2:
 		oldValue = memory->wram[address & (GB_SIZE_WORKING_RAM_BANK0 - 1)];
 		memory->wram[address & (GB_SIZE_WORKING_RAM_BANK0 - 1)] = value;
+		MARK_DIRTY_WRAM(&memory->wram[address & (GB_SIZE_WORKING_RAM_BANK0 - 1)]);
 		break;
 	case GB_REGION_WORKING_RAM_BANK1:
 		if (segment < 0) {
 			oldValue = memory->wramBank[address & (GB_SIZE_WORKING_RAM_BANK0 - 1)];
 			memory->wramBank[address & (GB_SIZE_WORKING_RAM_BANK0 - 1)] = value;
+			MARK_DIRTY_WRAM(&memory->wramBank[address & (GB_SIZE_WORKING_RAM_BANK0 - 1)]);
 		} else if (segment < 8) {
 			if (segment == 0) {
 				segment = 1;
@@ -716,6 +1164,7 @@ void GBPatch8(struct SM83Core* cpu, uint16_t address, int8_t value, int8_t* old,
 			}
 			oldValue = memory->wram[(address & (GB_SIZE_WORKING_RAM_BANK0 - 1)) + segment * GB_SIZE_WORKING_RAM_BANK0];
 			memory->wram[(address & (GB_SIZE_WORKING_RAM_BANK0 - 1)) + segment * GB_SIZE_WORKING_RAM_BANK0] = value;
+			MARK_DIRTY_WRAM(&memory->wram[(address & (GB_SIZE_WORKING_RAM_BANK0 - 1)) + segment * GB_SIZE_WORKING_RAM_BANK0]);
 		} else {
 			return;
 		}
@@ -724,9 +1173,11 @@ void GBPatch8(struct SM83Core* cpu, uint16_t address, int8_t value, int8_t* old,
 		if (address < GB_BASE_OAM) {
 			oldValue = memory->wramBank[address & (GB_SIZE_WORKING_RAM_BANK0 - 1)];
 			memory->wramBank[address & (GB_SIZE_WORKING_RAM_BANK0 - 1)] = value;
+			MARK_DIRTY_WRAM(&memory->wramBank[address & (GB_SIZE_WORKING_RAM_BANK0 - 1)]);
 		} else if (address < GB_BASE_UNUSABLE) {
 			oldValue = gb->video.oam.raw[address & 0xFF];
 			gb->video.oam.raw[address & 0xFF] = value;
+			gb->memory.oamDirty = gb->memory.dirtyGeneration;
 			gb->video.renderer->writeOAM(gb->video.renderer, address & 0xFF);
 		} else if (address < GB_BASE_HRAM) {
 			mLOG(GB_MEM, STUB, "Unimplemented memory Patch8: 0x%08X", address);
@@ -744,9 +1195,9 @@ void GBPatch8(struct SM83Core* cpu, uint16_t address, int8_t value, int8_t* old,
 	}
 }
 
-void GBMemorySerialize(const struct GB* gb, struct GBSerializedState* state) {
+void GBMemorySerialize(const struct GB* gb, struct GBSerializedState* state, uint32_t since) {
 	const struct GBMemory* memory = &gb->memory;
-	memcpy(state->wram, memory->wram, GB_SIZE_WORKING_RAM);
+	mStateCopyDirtyPages(state->wram, memory->wram, &memory->dirtyPages[GB_DIRTY_PAGES_WRAM], GB_SIZE_WORKING_RAM >> mSTATE_PAGE_SHIFT, since);
 	memcpy(state->hram, memory->hram, GB_SIZE_HRAM);
 	STORE_16LE(memory->currentBank, 0, &state->memory.currentBank);
 	state->memory.wramCurrentBank = memory->wramCurrentBank;
@@ -880,9 +1331,9 @@ void GBMemorySerialize(const struct GB* gb, struct GBSerializedState* state) {
 	}
 }
 
-void GBMemoryDeserialize(struct GB* gb, const struct GBSerializedState* state) {
+void GBMemoryDeserialize(struct GB* gb, const struct GBSerializedState* state, uint32_t since) {
 	struct GBMemory* memory = &gb->memory;
-	memcpy(memory->wram, state->wram, GB_SIZE_WORKING_RAM);
+	mStateCopyDirtyPages(memory->wram, state->wram, &memory->dirtyPages[GB_DIRTY_PAGES_WRAM], GB_SIZE_WORKING_RAM >> mSTATE_PAGE_SHIFT, since);
 	memcpy(memory->hram, state->hram, GB_SIZE_HRAM);
 	LOAD_16LE(memory->currentBank, 0, &state->memory.currentBank);
 	memory->wramCurrentBank = state->memory.wramCurrentBank;
@@ -1058,12 +1509,18 @@ void GBMemoryDeserialize(struct GB* gb, const struct GBSerializedState* state) {
 	default:
 		break;
 	}
+	GBMemoryUpdatePages(memory);
 }
 
 void _pristineCow(struct GB* gb) {
 	if (!gb->isPristine) {
 		return;
 	}
+	if (gb->romShared) {
+		// Shared views are already copy-on-write, page by page
+		gb->isPristine = false;
+		return;
+	}
 	void* newRom = anonymousMemoryMap(GB_SIZE_CART_MAX);
 	memcpy(newRom, gb->memory.rom, gb->memory.romSize);
 	memset(((uint8_t*) newRom) + gb->memory.romSize, 0xFF, GB_SIZE_CART_MAX - gb->memory.romSize);
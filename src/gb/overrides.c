@@ -667,37 +667,37 @@ static const struct GBCartridgeOverride _sgbOverrides[] = {
 };
 
 static const struct GBCartridgeOverride _overrides[] = {
-	{ 0xA61F3EE1, GB_MODEL_AUTODETECT, GB_M161, { 0 } }, // Mani 4 in 1 - Tetris + Alleyway + Yakuman + Tennis
+	{ 0xA61F3EE1, GB_MODEL_AUTODETECT, GB_M161, { 0 }, GB_IDLE_LOOP_NONE }, // Mani 4 in 1 - Tetris + Alleyway + Yakuman + Tennis
 
 	// Pokemon Spaceworld 1997 demo
-	{ 0x232A067D, GB_MODEL_AUTODETECT, GB_MBC3_RTC, { 0 } }, // Gold (debug)
-	{ 0x630ED957, GB_MODEL_AUTODETECT, GB_MBC3_RTC, { 0 } }, // Gold (non-debug)
-	{ 0x5AFF0038, GB_MODEL_AUTODETECT, GB_MBC3_RTC, { 0 } }, // Silver (debug)
-	{ 0xA61856BD, GB_MODEL_AUTODETECT, GB_MBC3_RTC, { 0 } }, // Silver (non-debug)
+	{ 0x232A067D, GB_MODEL_AUTODETECT, GB_MBC3_RTC, { 0 }, GB_IDLE_LOOP_NONE }, // Gold (debug)
+	{ 0x630ED957, GB_MODEL_AUTODETECT, GB_MBC3_RTC, { 0 }, GB_IDLE_LOOP_NONE }, // Gold (non-debug)
+	{ 0x5AFF0038, GB_MODEL_AUTODETECT, GB_MBC3_RTC, { 0 }, GB_IDLE_LOOP_NONE }, // Silver (debug)
+	{ 0xA61856BD, GB_MODEL_AUTODETECT, GB_MBC3_RTC, { 0 }, GB_IDLE_LOOP_NONE }, // Silver (non-debug)
 	// Unlicensed bootlegs
-	{ 0x30F8F86C, GB_MODEL_AUTODETECT, GB_UNL_PKJD, { 0 } }, // Pokemon Jade Version (Telefang Speed bootleg)
-	{ 0xE1147E75, GB_MODEL_AUTODETECT, GB_UNL_NT_OLD_1, { 0 } }, // Rockman 8
-	{ 0xEFF88FAA, GB_MODEL_AUTODETECT, GB_UNL_NT_OLD_1, { 0 } }, // True Color 25 in 1 (NT-9920)
-	{ 0x811925D9, GB_MODEL_AUTODETECT, GB_UNL_NT_OLD_2, { 0 } }, // 23 in 1 (CR2011)
-	{ 0x62A8016A, GB_MODEL_AUTODETECT, GB_UNL_NT_OLD_2, { 0 } }, // 29 in 1 (CR2020)
-	{ 0x5758D6D9, GB_MODEL_AUTODETECT, GB_UNL_NT_OLD_2, { 0 } }, // Caise Gedou 24 in 1 Diannao Huamian Xuan Game (CY2060)
-	{ 0x62A8016A, GB_MODEL_AUTODETECT, GB_UNL_NT_OLD_2, { 0 } }, // Caise Gedou 29 in 1 Diannao Huamian Xuan Game (CY2061)
-	{ 0x80265A64, GB_MODEL_AUTODETECT, GB_UNL_NT_OLD_2, { 0 } }, // Rockman X4 (Megaman X4)
-	{ 0x805459DE, GB_MODEL_AUTODETECT, GB_UNL_NT_OLD_2, { 0 } }, // Sonic Adventure 8
-	{ 0x0B1B808A, GB_MODEL_AUTODETECT, GB_UNL_NT_OLD_2, { 0 } }, // Super Donkey Kong 5
-	{ 0x0B1B808A, GB_MODEL_AUTODETECT, GB_UNL_NT_OLD_2, { 0 } }, // Super Donkey Kong 5 (Alt)
-	{ 0x4650EB9A, GB_MODEL_AUTODETECT, GB_UNL_NT_OLD_2, { 0 } }, // Super Mario Special 3
-	{ 0xB289D95A, GB_MODEL_AUTODETECT, GB_UNL_NT_NEW, { 0 } }, // Capcom vs SNK - Millennium Fight 2001
-	{ 0x688D6713, GB_MODEL_AUTODETECT, GB_UNL_NT_NEW, { 0 } }, // Digimon 02 4
-	{ 0x8931A272, GB_MODEL_AUTODETECT, GB_UNL_NT_NEW, { 0 } }, // Digimon 2
-	{ 0x79083C6B, GB_MODEL_AUTODETECT, GB_UNL_NT_NEW, { 0 } }, // Digimon Pocket
-	{ 0x0C5047EE, GB_MODEL_AUTODETECT, GB_UNL_NT_NEW, { 0 } }, // Harry Potter 3
-	{ 0x8AC634B7, GB_MODEL_AUTODETECT, GB_UNL_NT_NEW, { 0 } }, // Pokemon Diamond (Special Pikachu Edition)
-	{ 0x8628A287, GB_MODEL_AUTODETECT, GB_UNL_NT_NEW, { 0 } }, // Pokemon Jade (Special Pikachu Edition)
-	{ 0xBC75D7B8, GB_MODEL_AUTODETECT, GB_UNL_NT_NEW, { 0 } }, // Pokemon - Mewtwo Strikes Back
-	{ 0xFF0B60CC, GB_MODEL_AUTODETECT, GB_UNL_NT_NEW, { 0 } }, // Shuma Baolong 02 4
-	{ 0x14A992A6, GB_MODEL_AUTODETECT, GB_UNL_NT_NEW, { 0 } }, // /Street Fighter Zero 4
-	{ 0x3EF5AFB2, GB_MODEL_AUTODETECT, GB_UNL_LI_CHENG, { 0 } }, // Pokemon Jade Version (Telefang Speed bootleg)
+	{ 0x30F8F86C, GB_MODEL_AUTODETECT, GB_UNL_PKJD, { 0 }, GB_IDLE_LOOP_NONE }, // Pokemon Jade Version (Telefang Speed bootleg)
+	{ 0xE1147E75, GB_MODEL_AUTODETECT, GB_UNL_NT_OLD_1, { 0 }, GB_IDLE_LOOP_NONE }, // Rockman 8
+	{ 0xEFF88FAA, GB_MODEL_AUTODETECT, GB_UNL_NT_OLD_1, { 0 }, GB_IDLE_LOOP_NONE }, // True Color 25 in 1 (NT-9920)
+	{ 0x811925D9, GB_MODEL_AUTODETECT, GB_UNL_NT_OLD_2, { 0 }, GB_IDLE_LOOP_NONE }, // 23 in 1 (CR2011)
+	{ 0x62A8016A, GB_MODEL_AUTODETECT, GB_UNL_NT_OLD_2, { 0 }, GB_IDLE_LOOP_NONE }, // 29 in 1 (CR2020)
+	{ 0x5758D6D9, GB_MODEL_AUTODETECT, GB_UNL_NT_OLD_2, { 0 }, GB_IDLE_LOOP_NONE }, // Caise Gedou 24 in 1 Diannao Huamian Xuan Game (CY2060)
+	{ 0x62A8016A, GB_MODEL_AUTODETECT, GB_UNL_NT_OLD_2, { 0 }, GB_IDLE_LOOP_NONE }, // Caise Gedou 29 in 1 Diannao Huamian Xuan Game (CY2061)
+	{ 0x80265A64, GB_MODEL_AUTODETECT, GB_UNL_NT_OLD_2, { 0 }, GB_IDLE_LOOP_NONE }, // Rockman X4 (Megaman X4)
+	{ 0x805459DE, GB_MODEL_AUTODETECT, GB_UNL_NT_OLD_2, { 0 }, GB_IDLE_LOOP_NONE }, // Sonic Adventure 8
+	{ 0x0B1B808A, GB_MODEL_AUTODETECT, GB_UNL_NT_OLD_2, { 0 }, GB_IDLE_LOOP_NONE }, // Super Donkey Kong 5
+	{ 0x0B1B808A, GB_MODEL_AUTODETECT, GB_UNL_NT_OLD_2, { 0 }, GB_IDLE_LOOP_NONE }, // Super Donkey Kong 5 (Alt)
+	{ 0x4650EB9A, GB_MODEL_AUTODETECT, GB_UNL_NT_OLD_2, { 0 }, GB_IDLE_LOOP_NONE }, // Super Mario Special 3
+	{ 0xB289D95A, GB_MODEL_AUTODETECT, GB_UNL_NT_NEW, { 0 }, GB_IDLE_LOOP_NONE }, // Capcom vs SNK - Millennium Fight 2001
+	{ 0x688D6713, GB_MODEL_AUTODETECT, GB_UNL_NT_NEW, { 0 }, GB_IDLE_LOOP_NONE }, // Digimon 02 4
+	{ 0x8931A272, GB_MODEL_AUTODETECT, GB_UNL_NT_NEW, { 0 }, GB_IDLE_LOOP_NONE }, // Digimon 2
+	{ 0x79083C6B, GB_MODEL_AUTODETECT, GB_UNL_NT_NEW, { 0 }, GB_IDLE_LOOP_NONE }, // Digimon Pocket
+	{ 0x0C5047EE, GB_MODEL_AUTODETECT, GB_UNL_NT_NEW, { 0 }, GB_IDLE_LOOP_NONE }, // Harry Potter 3
+	{ 0x8AC634B7, GB_MODEL_AUTODETECT, GB_UNL_NT_NEW, { 0 }, GB_IDLE_LOOP_NONE }, // Pokemon Diamond (Special Pikachu Edition)
+	{ 0x8628A287, GB_MODEL_AUTODETECT, GB_UNL_NT_NEW, { 0 }, GB_IDLE_LOOP_NONE }, // Pokemon Jade (Special Pikachu Edition)
+	{ 0xBC75D7B8, GB_MODEL_AUTODETECT, GB_UNL_NT_NEW, { 0 }, GB_IDLE_LOOP_NONE }, // Pokemon - Mewtwo Strikes Back
+	{ 0xFF0B60CC, GB_MODEL_AUTODETECT, GB_UNL_NT_NEW, { 0 }, GB_IDLE_LOOP_NONE }, // Shuma Baolong 02 4
+	{ 0x14A992A6, GB_MODEL_AUTODETECT, GB_UNL_NT_NEW, { 0 }, GB_IDLE_LOOP_NONE }, // /Street Fighter Zero 4
+	{ 0x3EF5AFB2, GB_MODEL_AUTODETECT, GB_UNL_LI_CHENG, { 0 }, GB_IDLE_LOOP_NONE }, // Pokemon Jade Version (Telefang Speed bootleg)
 
 	{ 0, 0, 0, { 0 } }
 };
@@ -778,6 +778,7 @@ bool GBOverrideFind(const struct Configuration* config, struct GBCartridgeOverri
 	override->model = GB_MODEL_AUTODETECT;
 	override->mbc = GB_MBC_AUTODETECT;
 	memset(override->gbColors, 0, sizeof(override->gbColors));
+	override->idleLoop = GB_IDLE_LOOP_NONE;
 	bool found = false;
 
 	int i;
@@ -794,6 +795,7 @@ bool GBOverrideFind(const struct Configuration* config, struct GBCartridgeOverri
 		snprintf(sectionName, sizeof(sectionName), "gb.override.%08X", override->headerCrc32);
 		const char* model = ConfigurationGetValue(config, sectionName, "model");
 		const char* mbc = ConfigurationGetValue(config, sectionName, "mbc");
+		const char* idleLoop = ConfigurationGetValue(config, sectionName, "idleLoop");
 		const char* pal[12] = {
 			ConfigurationGetValue(config, sectionName, "pal[0]"),
 			ConfigurationGetValue(config, sectionName, "pal[1]"),
@@ -823,6 +825,15 @@ bool GBOverrideFind(const struct Configuration* config, struct GBCartridgeOverri
 			}
 		}
 
+		if (idleLoop) {
+			char* end;
+			uint32_t address = strtoul(idleLoop, &end, 16);
+			if (end && !*end) {
+				override->idleLoop = address;
+				found = true;
+			}
+		}
+
 		for (i = 0; i < 12; ++i) {
 			if (!pal[i]) {
 				continue;
@@ -896,6 +907,15 @@ void GBOverrideSave(struct Configuration* config, const struct GBCartridgeOverri
 	} else {
 		ConfigurationClearValue(config, sectionName, "mbc");
 	}
+
+	if (override->idleLoop != GB_IDLE_LOOP_NONE) {
+		// GBOverrideFind parses this as hex
+		char idleLoop[9];
+		snprintf(idleLoop, sizeof(idleLoop), "%X", override->idleLoop);
+		ConfigurationSetValue(config, sectionName, "idleLoop", idleLoop);
+	} else {
+		ConfigurationClearValue(config, sectionName, "idleLoop");
+	}
 }
 
 size_t GBColorPresetList(const struct GBColorPreset** presets) {
@@ -928,6 +948,13 @@ void GBOverrideApply(struct GB* gb, const struct GBCartridgeOverride* override)
 			GBVideoSetPalette(&gb->video, i + 8, override->gbColors[i]);
 		}
 	}
+
+	if (override->idleLoop != GB_IDLE_LOOP_NONE) {
+		gb->idleLoop = override->idleLoop;
+		if (gb->idleOptimization == GB_IDLE_LOOP_DETECT) {
+			gb->idleOptimization = GB_IDLE_LOOP_REMOVE;
+		}
+	}
 }
 
 void GBOverrideApplyDefaults(struct GB* gb) {
@@ -0,0 +1,861 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/internal/gb/renderers/gl.h>
+
+#ifdef BUILD_GLES3
+
+#include <mgba/core/cache-set.h>
+#include <mgba/internal/gb/io.h>
+#include <mgba/internal/gb/renderers/cache-set.h>
+#include <mgba-util/memory.h>
+
+#define SPAN_DISABLE_BG 0x100
+#define SPAN_DISABLE_OBJ 0x200
+#define SPAN_CGB 0x400
+#define SPAN_NO_WINDOW 0x100
+
+static void GBVideoGLRendererInit(struct GBVideoRenderer* renderer, enum GBModel model, bool borders);
+static void GBVideoGLRendererDeinit(struct GBVideoRenderer* renderer);
+static uint8_t GBVideoGLRendererWriteVideoRegister(struct GBVideoRenderer* renderer, uint16_t address, uint8_t value);
+static void GBVideoGLRendererWriteSGBPacket(struct GBVideoRenderer* renderer, uint8_t* data);
+static void GBVideoGLRendererWritePalette(struct GBVideoRenderer* renderer, int index, uint16_t value);
+static void GBVideoGLRendererWriteVRAM(struct GBVideoRenderer* renderer, uint16_t address);
+static void GBVideoGLRendererWriteOAM(struct GBVideoRenderer* renderer, uint16_t oam);
+static void GBVideoGLRendererDrawRange(struct GBVideoRenderer* renderer, int startX, int endX, int y);
+static void GBVideoGLRendererFinishScanline(struct GBVideoRenderer* renderer, int y);
+static void GBVideoGLRendererFinishFrame(struct GBVideoRenderer* renderer);
+static void GBVideoGLRendererEnableSGBBorder(struct GBVideoRenderer* renderer, bool enable);
+static void GBVideoGLRendererGetPixels(struct GBVideoRenderer* renderer, size_t* stride, const void** pixels);
+static void GBVideoGLRendererPutPixels(struct GBVideoRenderer* renderer, size_t stride, const void* pixels);
+
+static void _initFramebuffers(struct GBVideoGLRenderer* renderer);
+static void _uploadVram(struct GBVideoGLRenderer* renderer);
+static void _drawSpans(struct GBVideoGLRenderer* renderer);
+
+static const GLchar* const _gles3Header =
+	"#version 300 es\n"
+	"#define OUT(n) layout(location = n)\n"
+	"precision highp float;\n"
+	"precision highp int;\n"
+	"precision highp sampler2D;\n"
+	"precision highp isampler2D;\n"
+	"precision highp usampler2D;\n";
+
+static const GLchar* const _gl3Header =
+	"#version 330 core\n"
+	"#define OUT(n) layout(location = n)\n"
+	"precision highp float;\n";
+
+static const char* const _vertexShader =
+	"in vec2 position;\n"
+	"layout(location = 1) in ivec4 inRect;\n"
+	"layout(location = 2) in ivec4 inBg;\n"
+	"layout(location = 3) in ivec4 inWindow;\n"
+	"flat out ivec4 rect;\n"
+	"flat out ivec4 bg;\n"
+	"flat out ivec4 window;\n"
+
+	"void main() {\n"
+	"	vec2 local = vec2(mix(float(inRect.x), float(inRect.y), position.x), float(inRect.z) + position.y);\n"
+	"	gl_Position = vec4(local * 2. / vec2(160., 144.) - 1., 0., 1.);\n"
+	"	rect = inRect;\n"
+	"	bg = inBg;\n"
+	"	window = inWindow;\n"
+	"}";
+
+// Everything on the line is resolved here at once: the background or window pixel, then the
+// first object in priority order that shows up over it, and then the palette row of the span
+static const char* const _renderSpan =
+	"flat in ivec4 rect;\n"
+	"flat in ivec4 bg;\n"
+	"flat in ivec4 window;\n"
+	"uniform usampler2D vram;\n"
+	"uniform sampler2D palette;\n"
+	"uniform isampler2D objs;\n"
+	"uniform int scale;\n"
+	"OUT(0) out vec4 color;\n"
+
+	"int vramByte(int address) {\n"
+	"	return int(texelFetch(vram, ivec2(address & 255, address >> 8), 0).r);\n"
+	"}\n"
+
+	"int tilePixel(int address, int x) {\n"
+	"	int bit = 7 - x;\n"
+	"	return ((vramByte(address) >> bit) & 1) | (((vramByte(address + 1) >> bit) & 1) << 1);\n"
+	"}\n"
+
+	"ivec3 renderMap(int map, int x, int y, int flags) {\n"
+	"	x &= 255;\n"
+	"	y &= 255;\n"
+	"	int mapAddress = map + ((y >> 3) << 5) + (x >> 3);\n"
+	"	int tile = vramByte(mapAddress);\n"
+	"	if ((flags & 0x10) == 0) {\n"
+	"		tile = 256 + ((tile ^ 0x80) - 0x80);\n"
+	"	}\n"
+	"	int localX = x & 7;\n"
+	"	int localY = y & 7;\n"
+	"	int bank = 0;\n"
+	"	int pal = 0;\n"
+	"	int priority = 0;\n"
+	"	if ((flags & 0x400) != 0) {\n"
+	"		int attr = vramByte(mapAddress + 0x2000);\n"
+	"		pal = attr & 7;\n"
+	"		bank = (attr & 8) << 10;\n"
+	"		if ((attr & 0x20) != 0) {\n"
+	"			localX = 7 - localX;\n"
+	"		}\n"
+	"		if ((attr & 0x40) != 0) {\n"
+	"			localY = 7 - localY;\n"
+	"		}\n"
+	"		if ((attr & 0x80) != 0 && (flags & 1) != 0) {\n"
+	"			priority = 1;\n"
+	"		}\n"
+	"	}\n"
+	"	return ivec3(tilePixel(bank + tile * 16 + localY * 2, localX), pal, priority);\n"
+	"}\n"
+
+	"void main() {\n"
+	"	int x = int(gl_FragCoord.x) / scale;\n"
+	"	int y = rect.z;\n"
+	"	int flags = bg.w;\n"
+	"	bool cgb = (flags & 0x400) != 0;\n"
+	"	ivec3 pixel = ivec3(0);\n"
+	"	if ((flags & 1) != 0 || cgb) {\n"
+	"		if (x >= bg.z) {\n"
+	"			pixel = renderMap(0x1800 + ((flags & 0x40) << 4), x + window.x, window.y, flags);\n"
+	"		} else if ((flags & 0x100) == 0) {\n"
+	"			pixel = renderMap(0x1800 + ((flags & 0x08) << 7), x + bg.x, bg.y, flags);\n"
+	"		}\n"
+	"	}\n"
+	"	int index = pixel.y * 4 + pixel.x;\n"
+	"	if ((flags & 2) != 0 && (flags & 0x200) == 0) {\n"
+	"		bool masked = pixel.x != 0 && ((flags & 1) != 0 || !cgb);\n"
+	"		for (int i = 0; i < window.z; ++i) {\n"
+	"			ivec4 obj = texelFetch(objs, ivec2(i, window.w), 0);\n"
+	"			int localX = x - obj.x + 8;\n"
+	"			if (localX < 0 || localX >= 8) {\n"
+	"				continue;\n"
+	"			}\n"
+	"			int dy = y - obj.y;\n"
+	"			int localY = (dy - 16) & 7;\n"
+	"			int tile = obj.z;\n"
+	"			if ((flags & 4) != 0) {\n"
+	"				if ((obj.w & 0x40) != 0 ? dy < -8 : dy >= -8) {\n"
+	"					++tile;\n"
+	"				}\n"
+	"				tile -= obj.z & 1;\n"
+	"			}\n"
+	"			if ((obj.w & 0x20) != 0) {\n"
+	"				localX = 7 - localX;\n"
+	"			}\n"
+	"			if ((obj.w & 0x40) != 0) {\n"
+	"				localY = 7 - localY;\n"
+	"			}\n"
+	"			int bank = 0;\n"
+	"			int pal = (obj.w >> 4) & 1;\n"
+	"			if (cgb) {\n"
+	"				bank = (obj.w & 8) << 10;\n"
+	"				pal = obj.w & 7;\n"
+	"			}\n"
+	"			int objColor = tilePixel(bank + tile * 16 + localY * 2, localX);\n"
+	"			if (objColor == 0 || (masked && ((obj.w & 0x80) != 0 || pixel.z != 0))) {\n"
+	"				continue;\n"
+	"			}\n"
+	"			index = 32 + pal * 4 + objColor;\n"
+	"			break;\n"
+	"		}\n"
+	"	}\n"
+	"	color = vec4(texelFetch(palette, ivec2(index, rect.w), 0).rgb, 1.);\n"
+	"}";
+
+static const GLint _vertices[] = {
+	0, 0,
+	0, 1,
+	1, 1,
+	1, 0,
+};
+
+void GBVideoGLRendererCreate(struct GBVideoGLRenderer* renderer) {
+	memset(renderer, 0, sizeof(*renderer));
+	renderer->d.init = GBVideoGLRendererInit;
+	renderer->d.deinit = GBVideoGLRendererDeinit;
+	renderer->d.writeVideoRegister = GBVideoGLRendererWriteVideoRegister;
+	renderer->d.writeSGBPacket = GBVideoGLRendererWriteSGBPacket;
+	renderer->d.writePalette = GBVideoGLRendererWritePalette;
+	renderer->d.writeVRAM = GBVideoGLRendererWriteVRAM;
+	renderer->d.writeOAM = GBVideoGLRendererWriteOAM;
+	renderer->d.drawRange = GBVideoGLRendererDrawRange;
+	renderer->d.finishScanline = GBVideoGLRendererFinishScanline;
+	renderer->d.finishFrame = GBVideoGLRendererFinishFrame;
+	renderer->d.enableSGBBorder = GBVideoGLRendererEnableSGBBorder;
+	renderer->d.getPixels = GBVideoGLRendererGetPixels;
+	renderer->d.putPixels = GBVideoGLRendererPutPixels;
+
+	renderer->d.disableBG = false;
+	renderer->d.disableOBJ = false;
+	renderer->d.disableWIN = false;
+
+	renderer->d.highlightBG = false;
+	renderer->d.highlightWIN = false;
+	int i;
+	for (i = 0; i < GB_VIDEO_MAX_OBJ; ++i) {
+		renderer->d.highlightOBJ[i] = false;
+	}
+	renderer->d.highlightColor = M_COLOR_WHITE;
+	renderer->d.highlightAmount = 0;
+
+	renderer->scale = 1;
+}
+
+static unsigned _outputWidth(const struct GBVideoGLRenderer* glRenderer) {
+	if (glRenderer->sgb && glRenderer->sgbBorders) {
+		return SGB_VIDEO_HORIZONTAL_PIXELS;
+	}
+	return GB_VIDEO_HORIZONTAL_PIXELS;
+}
+
+static unsigned _outputHeight(const struct GBVideoGLRenderer* glRenderer) {
+	if (glRenderer->sgb && glRenderer->sgbBorders) {
+		return SGB_VIDEO_VERTICAL_PIXELS;
+	}
+	return GB_VIDEO_VERTICAL_PIXELS;
+}
+
+static void _freeTemporaryBuffer(struct GBVideoGLRenderer* glRenderer) {
+	if (glRenderer->temporaryBuffer) {
+		mappedMemoryFree(glRenderer->temporaryBuffer, _outputWidth(glRenderer) * _outputHeight(glRenderer) * glRenderer->scale * glRenderer->scale * BYTES_PER_PIXEL);
+		glRenderer->temporaryBuffer = NULL;
+	}
+}
+
+static void _initTexture(GLuint tex, GLenum internalFormat, GLsizei width, GLsizei height, GLenum format, GLenum type) {
+	glBindTexture(GL_TEXTURE_2D, tex);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, 0);
+}
+
+static void _initFramebuffers(struct GBVideoGLRenderer* glRenderer) {
+	glBindFramebuffer(GL_FRAMEBUFFER, glRenderer->fbo[GB_GL_FBO_OUTPUT]);
+	_initTexture(glRenderer->outputTex, GL_RGB, _outputWidth(glRenderer) * glRenderer->scale, _outputHeight(glRenderer) * glRenderer->scale, GL_RGB, GL_UNSIGNED_BYTE);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, glRenderer->outputTex, 0);
+	glRenderer->outputTexDirty = false;
+
+	if (glRenderer->sgb) {
+		glBindFramebuffer(GL_FRAMEBUFFER, glRenderer->fbo[GB_GL_FBO_SGB]);
+		_initTexture(glRenderer->sgbTex, GL_RGBA, SGB_VIDEO_HORIZONTAL_PIXELS, SGB_VIDEO_VERTICAL_PIXELS, GL_RGBA, GL_UNSIGNED_BYTE);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, glRenderer->sgbTex, 0);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+static void _compileProgram(struct GBVideoGLRenderer* glRenderer) {
+	char log[2048];
+	const GLchar* shaderBuffer[2];
+	const GLubyte* version = glGetString(GL_VERSION);
+	if (strncmp((const char*) version, "OpenGL ES ", strlen("OpenGL ES ")) != 0) {
+		shaderBuffer[0] = _gl3Header;
+	} else {
+		shaderBuffer[0] = _gles3Header;
+	}
+
+	GLuint program = glCreateProgram();
+	glRenderer->program = program;
+
+	GLuint vs = glCreateShader(GL_VERTEX_SHADER);
+	shaderBuffer[1] = _vertexShader;
+	glShaderSource(vs, 2, shaderBuffer, 0);
+	glCompileShader(vs);
+	glGetShaderInfoLog(vs, sizeof(log), 0, log);
+	if (log[0]) {
+		mLOG(GB_VIDEO, ERROR, "Vertex shader compilation failure: %s", log);
+	}
+
+	GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
+	shaderBuffer[1] = _renderSpan;
+	glShaderSource(fs, 2, shaderBuffer, 0);
+	glCompileShader(fs);
+	glGetShaderInfoLog(fs, sizeof(log), 0, log);
+	if (log[0]) {
+		mLOG(GB_VIDEO, ERROR, "Fragment shader compilation failure: %s", log);
+	}
+
+	glAttachShader(program, vs);
+	glAttachShader(program, fs);
+	glLinkProgram(program);
+	glGetProgramInfoLog(program, sizeof(log), 0, log);
+	if (log[0]) {
+		mLOG(GB_VIDEO, ERROR, "Program link failure: %s", log);
+	}
+	glDeleteShader(vs);
+	glDeleteShader(fs);
+
+	glRenderer->uniforms[GB_GL_UNIFORM_VRAM] = glGetUniformLocation(program, "vram");
+	glRenderer->uniforms[GB_GL_UNIFORM_PALETTE] = glGetUniformLocation(program, "palette");
+	glRenderer->uniforms[GB_GL_UNIFORM_OBJS] = glGetUniformLocation(program, "objs");
+	glRenderer->uniforms[GB_GL_UNIFORM_SCALE] = glGetUniformLocation(program, "scale");
+
+	glGenVertexArrays(1, &glRenderer->vao);
+	glBindVertexArray(glRenderer->vao);
+	glBindBuffer(GL_ARRAY_BUFFER, glRenderer->vbo);
+	GLuint positionLocation = glGetAttribLocation(program, "position");
+	glEnableVertexAttribArray(positionLocation);
+	glVertexAttribPointer(positionLocation, 2, GL_INT, GL_FALSE, 0, NULL);
+
+	const GLsizei stride = sizeof(struct GBVideoGLSpan);
+	glBindBuffer(GL_ARRAY_BUFFER, glRenderer->spanVbo);
+	GLuint i;
+	for (i = GB_GL_SPAN_ATTR_RECT; i <= GB_GL_SPAN_ATTR_WINDOW; ++i) {
+		glEnableVertexAttribArray(i);
+		glVertexAttribDivisor(i, 1);
+	}
+	glVertexAttribIPointer(GB_GL_SPAN_ATTR_RECT, 4, GL_INT, stride, (const GLvoid*) offsetof(struct GBVideoGLSpan, rect));
+	glVertexAttribIPointer(GB_GL_SPAN_ATTR_BG, 4, GL_INT, stride, (const GLvoid*) offsetof(struct GBVideoGLSpan, bg));
+	glVertexAttribIPointer(GB_GL_SPAN_ATTR_WINDOW, 4, GL_INT, stride, (const GLvoid*) offsetof(struct GBVideoGLSpan, window));
+	glBindVertexArray(0);
+}
+
+static void _sgbEnter(struct GBVideoGLRenderer* glRenderer) {
+	struct GBVideoRenderer* sgb = &glRenderer->sgb->d;
+	sgb->vram = glRenderer->d.vram;
+	sgb->oam = glRenderer->d.oam;
+	sgb->cache = glRenderer->d.cache;
+	sgb->sgbCharRam = glRenderer->d.sgbCharRam;
+	sgb->sgbMapRam = glRenderer->d.sgbMapRam;
+	sgb->sgbPalRam = glRenderer->d.sgbPalRam;
+	sgb->sgbRenderMode = glRenderer->d.sgbRenderMode;
+	sgb->sgbAttributes = glRenderer->d.sgbAttributes;
+	sgb->sgbAttributeFiles = glRenderer->d.sgbAttributeFiles;
+	sgb->disableBG = glRenderer->d.disableBG;
+	sgb->disableOBJ = glRenderer->d.disableOBJ;
+	sgb->disableWIN = glRenderer->d.disableWIN;
+	glRenderer->sgb->offsetScx = glRenderer->offsetScx;
+	glRenderer->sgb->offsetScy = glRenderer->offsetScy;
+	glRenderer->sgb->offsetWx = glRenderer->offsetWx;
+	glRenderer->sgb->offsetWy = glRenderer->offsetWy;
+	glRenderer->sgb->objOffsetX = glRenderer->objOffsetX;
+	glRenderer->sgb->objOffsetY = glRenderer->objOffsetY;
+}
+
+static void _sgbLeave(struct GBVideoGLRenderer* glRenderer) {
+	glRenderer->d.sgbRenderMode = glRenderer->sgb->d.sgbRenderMode;
+}
+
+static void GBVideoGLRendererInit(struct GBVideoRenderer* renderer, enum GBModel model, bool borders) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+	glRenderer->temporaryBuffer = NULL;
+	glRenderer->lcdc = 0;
+	glRenderer->scy = 0;
+	glRenderer->scx = 0;
+	glRenderer->wy = 0;
+	glRenderer->wx = 0;
+	glRenderer->currentWy = 0;
+	glRenderer->currentWx = 0;
+	glRenderer->lastY = GB_VIDEO_VERTICAL_PIXELS;
+	glRenderer->lastX = 0;
+	glRenderer->hasWindow = false;
+	glRenderer->model = model;
+	glRenderer->sgbBorders = borders;
+
+	glRenderer->vramDirty = 0xFFFFFFFF;
+	memset(glRenderer->palette, 0, sizeof(glRenderer->palette));
+	glRenderer->paletteDirty = true;
+	glRenderer->paletteRow = 0;
+	glRenderer->nextPalette = 0;
+	glRenderer->firstPalette = 0;
+	glRenderer->objMax = 0;
+	glRenderer->objRow = 0;
+	glRenderer->firstObjRow = GB_VIDEO_VERTICAL_PIXELS;
+	glRenderer->lastObjRow = -1;
+	glRenderer->nSpans = 0;
+
+	glGenFramebuffers(GB_GL_FBO_MAX, glRenderer->fbo);
+
+	glGenTextures(1, &glRenderer->vramTex);
+	_initTexture(glRenderer->vramTex, GL_R8UI, 256, GB_SIZE_VRAM / 256, GL_RED_INTEGER, GL_UNSIGNED_BYTE);
+
+	glGenTextures(1, &glRenderer->paletteTex);
+	_initTexture(glRenderer->paletteTex, GL_RGBA8, 64, GB_GL_PALETTE_ROWS, GL_RGBA, GL_UNSIGNED_BYTE);
+
+	glGenTextures(1, &glRenderer->objTex);
+	_initTexture(glRenderer->objTex, GL_RGBA16I, GB_VIDEO_MAX_LINE_OBJ, GB_VIDEO_VERTICAL_PIXELS, GL_RGBA_INTEGER, GL_SHORT);
+
+	glGenBuffers(1, &glRenderer->vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, glRenderer->vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(_vertices), _vertices, GL_STATIC_DRAW);
+
+	glGenBuffers(1, &glRenderer->spanVbo);
+	glBindBuffer(GL_ARRAY_BUFFER, glRenderer->spanVbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(glRenderer->spans), NULL, GL_STREAM_DRAW);
+
+	_compileProgram(glRenderer);
+
+	if (model & GB_MODEL_SGB) {
+		glRenderer->sgb = malloc(sizeof(*glRenderer->sgb));
+		GBVideoSoftwareRendererCreate(glRenderer->sgb);
+		glRenderer->sgb->outputBuffer = anonymousMemoryMap(SGB_VIDEO_HORIZONTAL_PIXELS * SGB_VIDEO_VERTICAL_PIXELS * BYTES_PER_PIXEL);
+		glRenderer->sgb->outputBufferStride = SGB_VIDEO_HORIZONTAL_PIXELS;
+		glGenTextures(1, &glRenderer->sgbTex);
+		_sgbEnter(glRenderer);
+		glRenderer->sgb->d.init(&glRenderer->sgb->d, model, borders);
+		_sgbLeave(glRenderer);
+	}
+
+	_initFramebuffers(glRenderer);
+}
+
+static void GBVideoGLRendererDeinit(struct GBVideoRenderer* renderer) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+	_freeTemporaryBuffer(glRenderer);
+	glDeleteFramebuffers(GB_GL_FBO_MAX, glRenderer->fbo);
+	glDeleteTextures(1, &glRenderer->vramTex);
+	glDeleteTextures(1, &glRenderer->paletteTex);
+	glDeleteTextures(1, &glRenderer->objTex);
+	glDeleteBuffers(1, &glRenderer->vbo);
+	glDeleteBuffers(1, &glRenderer->spanVbo);
+	glDeleteProgram(glRenderer->program);
+	glDeleteVertexArrays(1, &glRenderer->vao);
+
+	if (glRenderer->sgb) {
+		glRenderer->sgb->d.deinit(&glRenderer->sgb->d);
+		mappedMemoryFree(glRenderer->sgb->outputBuffer, SGB_VIDEO_HORIZONTAL_PIXELS * SGB_VIDEO_VERTICAL_PIXELS * BYTES_PER_PIXEL);
+		free(glRenderer->sgb);
+		glRenderer->sgb = NULL;
+		glDeleteTextures(1, &glRenderer->sgbTex);
+	}
+}
+
+static void GBVideoGLRendererUpdateWindow(struct GBVideoGLRenderer* renderer, bool before, bool after, uint8_t oldWy) {
+	if (renderer->lastY >= GB_VIDEO_VERTICAL_PIXELS || !(after || before)) {
+		return;
+	}
+	if (!renderer->hasWindow && renderer->lastX == GB_VIDEO_HORIZONTAL_PIXELS && renderer->lastY != oldWy) {
+		return;
+	}
+	if (renderer->lastY >= oldWy) {
+		if (!after) {
+			renderer->currentWy -= renderer->lastY;
+			renderer->hasWindow = true;
+		} else if (!before) {
+			if (!renderer->hasWindow) {
+				renderer->currentWy = renderer->lastY - renderer->wy;
+				if (renderer->lastY >= renderer->wy && renderer->lastX > renderer->wx) {
+					++renderer->currentWy;
+				}
+			} else {
+				renderer->currentWy += renderer->lastY;
+			}
+		} else if (renderer->wy != oldWy) {
+			renderer->currentWy += oldWy - renderer->wy;
+			renderer->hasWindow = true;
+		}
+	}
+}
+
+static bool _inWindow(struct GBVideoGLRenderer* renderer) {
+	return GBRegisterLCDCIsWindow(renderer->lcdc) && GB_VIDEO_HORIZONTAL_PIXELS + 7 > renderer->wx;
+}
+
+static uint8_t GBVideoGLRendererWriteVideoRegister(struct GBVideoRenderer* renderer, uint16_t address, uint8_t value) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+	if (glRenderer->sgb) {
+		_sgbEnter(glRenderer);
+		value = glRenderer->sgb->d.writeVideoRegister(&glRenderer->sgb->d, address, value);
+		_sgbLeave(glRenderer);
+		return value;
+	}
+	if (renderer->cache) {
+		GBVideoCacheWriteVideoRegister(renderer->cache, address, value);
+	}
+	bool wasWindow = _inWindow(glRenderer);
+	uint8_t wy = glRenderer->wy;
+	switch (address) {
+	case GB_REG_LCDC:
+		glRenderer->lcdc = value;
+		GBVideoGLRendererUpdateWindow(glRenderer, wasWindow, _inWindow(glRenderer), wy);
+		break;
+	case GB_REG_SCY:
+		glRenderer->scy = value;
+		break;
+	case GB_REG_SCX:
+		glRenderer->scx = value;
+		break;
+	case GB_REG_WY:
+		glRenderer->wy = value;
+		GBVideoGLRendererUpdateWindow(glRenderer, wasWindow, _inWindow(glRenderer), wy);
+		break;
+	case GB_REG_WX:
+		glRenderer->wx = value;
+		GBVideoGLRendererUpdateWindow(glRenderer, wasWindow, _inWindow(glRenderer), wy);
+		break;
+	}
+	return value;
+}
+
+static void GBVideoGLRendererWriteSGBPacket(struct GBVideoRenderer* renderer, uint8_t* data) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+	if (glRenderer->sgb) {
+		_sgbEnter(glRenderer);
+		glRenderer->sgb->d.writeSGBPacket(&glRenderer->sgb->d, data);
+		_sgbLeave(glRenderer);
+	}
+}
+
+static void GBVideoGLRendererWritePalette(struct GBVideoRenderer* renderer, int index, uint16_t value) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+	if (glRenderer->sgb) {
+		_sgbEnter(glRenderer);
+		glRenderer->sgb->d.writePalette(&glRenderer->sgb->d, index, value);
+		_sgbLeave(glRenderer);
+		return;
+	}
+	if (renderer->cache) {
+		mCacheSetWritePalette(renderer->cache, index, mColorFrom555(value));
+	}
+	if (index >= 64) {
+		return;
+	}
+	unsigned r = M_R8(value);
+	unsigned g = M_G8(value);
+	unsigned b = M_B8(value);
+	if (glRenderer->model == GB_MODEL_AGB) {
+		r = M_R5(value) * M_R5(value);
+		g = M_G5(value) * M_G5(value);
+		b = M_B5(value) * M_B5(value);
+		r >>= 2;
+		r += r >> 4;
+		g >>= 2;
+		g += g >> 4;
+		b >>= 2;
+		b += b >> 4;
+	}
+	glRenderer->palette[index][0] = r;
+	glRenderer->palette[index][1] = g;
+	glRenderer->palette[index][2] = b;
+	glRenderer->palette[index][3] = 0xFF;
+	glRenderer->paletteDirty = true;
+}
+
+static void GBVideoGLRendererWriteVRAM(struct GBVideoRenderer* renderer, uint16_t address) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+	if (glRenderer->sgb) {
+		_sgbEnter(glRenderer);
+		glRenderer->sgb->d.writeVRAM(&glRenderer->sgb->d, address);
+		_sgbLeave(glRenderer);
+		return;
+	}
+	// This is called before the write lands, so the upload waits until the next range is drawn
+	glRenderer->vramDirty |= 1U << ((address & (GB_SIZE_VRAM - 1)) >> 9);
+	if (renderer->cache) {
+		mCacheSetWriteVRAM(renderer->cache, address);
+	}
+}
+
+static void GBVideoGLRendererWriteOAM(struct GBVideoRenderer* renderer, uint16_t oam) {
+	UNUSED(renderer);
+	UNUSED(oam);
+	// Objects are picked up at the start of each line
+}
+
+static void _uploadVram(struct GBVideoGLRenderer* glRenderer) {
+	glBindTexture(GL_TEXTURE_2D, glRenderer->vramTex);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	while (glRenderer->vramDirty) {
+		int first = __builtin_ctz(glRenderer->vramDirty);
+		int last = first;
+		while (last < 31 && (glRenderer->vramDirty & (1U << (last + 1)))) {
+			++last;
+		}
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, first * 2, 256, (last - first + 1) * 2, GL_RED_INTEGER, GL_UNSIGNED_BYTE, &glRenderer->d.vram[first * 512]);
+		if (last == 31) {
+			glRenderer->vramDirty = 0;
+		} else {
+			glRenderer->vramDirty &= ~((2U << last) - 1);
+		}
+	}
+}
+
+static void _cleanOAM(struct GBVideoGLRenderer* renderer, int y) {
+	int spriteHeight = 8;
+	if (GBRegisterLCDCIsObjSize(renderer->lcdc)) {
+		spriteHeight = 16;
+	}
+	int o = 0;
+	int i;
+	int16_t ids[GB_VIDEO_MAX_LINE_OBJ];
+	for (i = 0; i < GB_VIDEO_MAX_OBJ && o < GB_VIDEO_MAX_LINE_OBJ; ++i) {
+		uint8_t oy = renderer->d.oam->obj[i].y;
+		if (y < oy - 16 || y >= oy - 16 + spriteHeight) {
+			continue;
+		}
+		ids[o] = (renderer->d.oam->obj[i].x << 7) | i;
+		++o;
+	}
+	if (renderer->model < GB_MODEL_CGB) {
+		// Objects further left win on DMG, so put them in that order
+		int j;
+		for (i = 1; i < o; ++i) {
+			int16_t id = ids[i];
+			for (j = i; j > 0 && ids[j - 1] > id; --j) {
+				ids[j] = ids[j - 1];
+			}
+			ids[j] = id;
+		}
+	}
+	for (i = 0; i < o; ++i) {
+		const struct GBObj* obj = &renderer->d.oam->obj[ids[i] & 0x7F];
+		renderer->objs[y][i][0] = obj->x + renderer->objOffsetX;
+		renderer->objs[y][i][1] = obj->y + renderer->objOffsetY;
+		renderer->objs[y][i][2] = obj->tile;
+		renderer->objs[y][i][3] = obj->attr;
+	}
+	renderer->objMax = o;
+	renderer->objRow = y;
+	if (y < renderer->firstObjRow) {
+		renderer->firstObjRow = y;
+	}
+	if (y > renderer->lastObjRow) {
+		renderer->lastObjRow = y;
+	}
+}
+
+static void GBVideoGLRendererDrawRange(struct GBVideoRenderer* renderer, int startX, int endX, int y) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+	if (glRenderer->sgb) {
+		_sgbEnter(glRenderer);
+		glRenderer->sgb->d.drawRange(&glRenderer->sgb->d, startX, endX, y);
+		_sgbLeave(glRenderer);
+		return;
+	}
+	glRenderer->lastY = y;
+	glRenderer->lastX = endX;
+	if (startX >= endX) {
+		return;
+	}
+
+	if (glRenderer->vramDirty) {
+		// Anything already queued needs to see VRAM as it was before
+		_drawSpans(glRenderer);
+		_uploadVram(glRenderer);
+	}
+	if (glRenderer->nSpans == GB_GL_MAX_SPANS) {
+		_drawSpans(glRenderer);
+	}
+	if (glRenderer->paletteDirty) {
+		if (glRenderer->nextPalette == GB_GL_PALETTE_ROWS) {
+			_drawSpans(glRenderer);
+			glRenderer->nextPalette = 0;
+			glRenderer->firstPalette = 0;
+		}
+		memcpy(glRenderer->shadowPalette[glRenderer->nextPalette], glRenderer->palette, sizeof(glRenderer->palette));
+		glRenderer->paletteRow = glRenderer->nextPalette;
+		++glRenderer->nextPalette;
+		glRenderer->paletteDirty = false;
+	}
+	if (startX == 0) {
+		_cleanOAM(glRenderer, y);
+	}
+
+	bool cgb = glRenderer->model >= GB_MODEL_CGB;
+	int windowX = SPAN_NO_WINDOW;
+	int wy = glRenderer->wy + glRenderer->currentWy;
+	int wx = glRenderer->wx + glRenderer->currentWx - 7;
+	if (GBRegisterLCDCIsBgEnable(glRenderer->lcdc) || cgb) {
+		if (GBRegisterLCDCIsWindow(glRenderer->lcdc) && wy == y && wx <= endX) {
+			glRenderer->hasWindow = true;
+		}
+		if (GBRegisterLCDCIsWindow(glRenderer->lcdc) && glRenderer->hasWindow && wx <= endX && !renderer->disableWIN) {
+			windowX = wx;
+		}
+	}
+
+	struct GBVideoGLSpan* span = &glRenderer->spans[glRenderer->nSpans];
+	++glRenderer->nSpans;
+	span->rect[0] = startX;
+	span->rect[1] = endX;
+	span->rect[2] = y;
+	span->rect[3] = glRenderer->paletteRow;
+	span->bg[0] = glRenderer->scx - glRenderer->offsetScx;
+	span->bg[1] = glRenderer->scy + y - glRenderer->offsetScy;
+	span->bg[2] = windowX;
+	span->bg[3] = glRenderer->lcdc;
+	if (renderer->disableBG) {
+		span->bg[3] |= SPAN_DISABLE_BG;
+	}
+	if (renderer->disableOBJ) {
+		span->bg[3] |= SPAN_DISABLE_OBJ;
+	}
+	if (cgb) {
+		span->bg[3] |= SPAN_CGB;
+	}
+	span->window[0] = -wx - glRenderer->offsetWx;
+	span->window[1] = y - wy - glRenderer->offsetWy;
+	span->window[2] = glRenderer->objMax;
+	span->window[3] = glRenderer->objRow;
+}
+
+static void _drawSpans(struct GBVideoGLRenderer* glRenderer) {
+	if (!glRenderer->nSpans) {
+		return;
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	if (glRenderer->firstPalette < glRenderer->nextPalette) {
+		glBindTexture(GL_TEXTURE_2D, glRenderer->paletteTex);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, glRenderer->firstPalette, 64, glRenderer->nextPalette - glRenderer->firstPalette, GL_RGBA, GL_UNSIGNED_BYTE, glRenderer->shadowPalette[glRenderer->firstPalette]);
+		glRenderer->firstPalette = glRenderer->nextPalette;
+	}
+	if (glRenderer->firstObjRow <= glRenderer->lastObjRow) {
+		glBindTexture(GL_TEXTURE_2D, glRenderer->objTex);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, glRenderer->firstObjRow, GB_VIDEO_MAX_LINE_OBJ, glRenderer->lastObjRow - glRenderer->firstObjRow + 1, GL_RGBA_INTEGER, GL_SHORT, glRenderer->objs[glRenderer->firstObjRow]);
+		glRenderer->firstObjRow = GB_VIDEO_VERTICAL_PIXELS;
+		glRenderer->lastObjRow = -1;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, glRenderer->spanVbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(glRenderer->spans), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, glRenderer->nSpans * sizeof(struct GBVideoGLSpan), glRenderer->spans);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, glRenderer->fbo[GB_GL_FBO_OUTPUT]);
+	if (glRenderer->outputTexDirty) {
+		_initFramebuffers(glRenderer);
+		glBindFramebuffer(GL_FRAMEBUFFER, glRenderer->fbo[GB_GL_FBO_OUTPUT]);
+	}
+	glDisable(GL_SCISSOR_TEST);
+	glDisable(GL_BLEND);
+	glViewport(0, 0, GB_VIDEO_HORIZONTAL_PIXELS * glRenderer->scale, GB_VIDEO_VERTICAL_PIXELS * glRenderer->scale);
+	glUseProgram(glRenderer->program);
+	glBindVertexArray(glRenderer->vao);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, glRenderer->vramTex);
+	glActiveTexture(GL_TEXTURE0 + 1);
+	glBindTexture(GL_TEXTURE_2D, glRenderer->paletteTex);
+	glActiveTexture(GL_TEXTURE0 + 2);
+	glBindTexture(GL_TEXTURE_2D, glRenderer->objTex);
+	glUniform1i(glRenderer->uniforms[GB_GL_UNIFORM_VRAM], 0);
+	glUniform1i(glRenderer->uniforms[GB_GL_UNIFORM_PALETTE], 1);
+	glUniform1i(glRenderer->uniforms[GB_GL_UNIFORM_OBJS], 2);
+	glUniform1i(glRenderer->uniforms[GB_GL_UNIFORM_SCALE], glRenderer->scale);
+	glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, glRenderer->nSpans);
+	glBindVertexArray(0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glRenderer->nSpans = 0;
+}
+
+static void GBVideoGLRendererFinishScanline(struct GBVideoRenderer* renderer, int y) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+	if (glRenderer->sgb) {
+		_sgbEnter(glRenderer);
+		glRenderer->sgb->d.finishScanline(&glRenderer->sgb->d, y);
+		_sgbLeave(glRenderer);
+		return;
+	}
+	glRenderer->lastX = 0;
+	glRenderer->currentWx = 0;
+}
+
+static void _finishSGBFrame(struct GBVideoGLRenderer* glRenderer) {
+	_sgbEnter(glRenderer);
+	glRenderer->sgb->d.finishFrame(&glRenderer->sgb->d);
+	_sgbLeave(glRenderer);
+
+	unsigned width = _outputWidth(glRenderer);
+	unsigned height = _outputHeight(glRenderer);
+	if (glRenderer->outputTexDirty) {
+		_initFramebuffers(glRenderer);
+	}
+	glBindTexture(GL_TEXTURE_2D, glRenderer->sgbTex);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, SGB_VIDEO_HORIZONTAL_PIXELS);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, glRenderer->sgb->outputBuffer);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+	glDisable(GL_SCISSOR_TEST);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, glRenderer->fbo[GB_GL_FBO_SGB]);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, glRenderer->fbo[GB_GL_FBO_OUTPUT]);
+	glBlitFramebuffer(0, 0, width, height, 0, 0, width * glRenderer->scale, height * glRenderer->scale, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+static void GBVideoGLRendererFinishFrame(struct GBVideoRenderer* renderer) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+	if (glRenderer->sgb) {
+		_finishSGBFrame(glRenderer);
+		return;
+	}
+	_drawSpans(glRenderer);
+	if (!GBRegisterLCDCIsEnable(glRenderer->lcdc)) {
+		if (glRenderer->outputTexDirty) {
+			_initFramebuffers(glRenderer);
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, glRenderer->fbo[GB_GL_FBO_OUTPUT]);
+		glDisable(GL_SCISSOR_TEST);
+		glClearColor(glRenderer->palette[0][0] / 255.f, glRenderer->palette[0][1] / 255.f, glRenderer->palette[0][2] / 255.f, 1.f);
+		glClear(GL_COLOR_BUFFER_BIT);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	// Each frame starts over with its own palette rows
+	glRenderer->nextPalette = 0;
+	glRenderer->firstPalette = 0;
+	glRenderer->paletteDirty = true;
+
+	glRenderer->lastY = GB_VIDEO_VERTICAL_PIXELS;
+	glRenderer->lastX = 0;
+	glRenderer->currentWy = 0;
+	glRenderer->currentWx = 0;
+	glRenderer->hasWindow = false;
+}
+
+static void GBVideoGLRendererEnableSGBBorder(struct GBVideoRenderer* renderer, bool enable) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+	if (!glRenderer->sgb || enable == glRenderer->sgbBorders) {
+		return;
+	}
+	// The output changes size, so it gets set up again before the next frame is drawn
+	_freeTemporaryBuffer(glRenderer);
+	_sgbEnter(glRenderer);
+	glRenderer->sgb->d.enableSGBBorder(&glRenderer->sgb->d, enable);
+	_sgbLeave(glRenderer);
+	glRenderer->sgbBorders = enable;
+	glRenderer->outputTexDirty = true;
+}
+
+static void GBVideoGLRendererGetPixels(struct GBVideoRenderer* renderer, size_t* stride, const void** pixels) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+	unsigned width = _outputWidth(glRenderer) * glRenderer->scale;
+	unsigned height = _outputHeight(glRenderer) * glRenderer->scale;
+	*stride = width;
+	if (!glRenderer->temporaryBuffer) {
+		glRenderer->temporaryBuffer = anonymousMemoryMap(width * height * BYTES_PER_PIXEL);
+	}
+	*pixels = glRenderer->temporaryBuffer;
+	glFinish();
+	glBindFramebuffer(GL_FRAMEBUFFER, glRenderer->fbo[GB_GL_FBO_OUTPUT]);
+	glPixelStorei(GL_PACK_ROW_LENGTH, width);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*) glRenderer->temporaryBuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+static void GBVideoGLRendererPutPixels(struct GBVideoRenderer* renderer, size_t stride, const void* pixels) {
+	// TODO
+	UNUSED(renderer);
+	UNUSED(stride);
+	UNUSED(pixels);
+}
+
+void GBVideoGLRendererSetScale(struct GBVideoGLRenderer* renderer, int scale) {
+	if (scale == renderer->scale) {
+		return;
+	}
+	_freeTemporaryBuffer(renderer);
+	renderer->scale = scale;
+	renderer->outputTexDirty = true;
+}
+
+#endif
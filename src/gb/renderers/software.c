@@ -17,6 +17,7 @@
 #define PAL_HIGHLIGHT_BG (PAL_HIGHLIGHT | PAL_BG)
 #define PAL_HIGHLIGHT_OBJ (PAL_HIGHLIGHT | PAL_OBJ)
 #define PAL_SGB_BORDER 0x40
+#define SGB_BORDER_TRANSPARENT 0xFF
 #define OBJ_PRIORITY 0x100
 #define OBJ_PRIO_MASK 0x0FF
 
@@ -55,43 +56,35 @@ static void _clearScreen(struct GBVideoSoftwareRenderer* renderer) {
 	}
 }
 
-static void _regenerateSGBBorder(struct GBVideoSoftwareRenderer* renderer) {
-	int i;
-	for (i = 0; i < 0x40; ++i) {
-		uint16_t color;
-		LOAD_16LE(color, 0x800 + i * 2, renderer->d.sgbMapRam);
-		renderer->d.writePalette(&renderer->d, i + PAL_SGB_BORDER, color);
-	}
+static void _decodeSGBBorder(struct GBVideoSoftwareRenderer* renderer) {
+	memset(renderer->sgbBorderMask, 0, sizeof(renderer->sgbBorderMask));
 	int x, y;
 	for (y = 0; y < 224; ++y) {
 		int localY = y & 0x7;
-		if (!localY && y >= 40 && y < 184) {
-			renderer->sgbBorderMask[(y - 40) >> 3] = 0;
-		}
+		uint8_t* indices = &renderer->sgbBorderCache[y * 256];
 		for (x = 0; x < 256; x += 8) {
 			uint16_t mapData;
 			LOAD_16LE(mapData, (x >> 2) + (y & ~7) * 8, renderer->d.sgbMapRam);
 			if (UNLIKELY(SGBBgAttributesGetTile(mapData) >= 0x100)) {
+				memset(&indices[x], SGB_BORDER_TRANSPARENT, 8);
 				continue;
 			}
 
-			if (x >= 48 && x < 208 && y >= 40 && y < 184) {
-				if (!localY) {
-					unsigned tileBase = SGBBgAttributesGetTile(mapData) * 8;
-					uint32_t bits = 0;
-					bits |= ((uint32_t*) renderer->d.sgbCharRam)[tileBase + 0];
-					bits |= ((uint32_t*) renderer->d.sgbCharRam)[tileBase + 1];
-					bits |= ((uint32_t*) renderer->d.sgbCharRam)[tileBase + 2];
-					bits |= ((uint32_t*) renderer->d.sgbCharRam)[tileBase + 3];
-					bits |= ((uint32_t*) renderer->d.sgbCharRam)[tileBase + 4];
-					bits |= ((uint32_t*) renderer->d.sgbCharRam)[tileBase + 5];
-					bits |= ((uint32_t*) renderer->d.sgbCharRam)[tileBase + 6];
-					bits |= ((uint32_t*) renderer->d.sgbCharRam)[tileBase + 7];
-					if (bits) {
-						renderer->sgbBorderMask[(y - 40) >> 3] |= 1 << ((x - 48) >> 3);
-					}
+			bool inWindow = x >= 48 && x < 208 && y >= 40 && y < 184;
+			if (inWindow && !localY) {
+				unsigned tileBase = SGBBgAttributesGetTile(mapData) * 8;
+				uint32_t bits = 0;
+				bits |= ((uint32_t*) renderer->d.sgbCharRam)[tileBase + 0];
+				bits |= ((uint32_t*) renderer->d.sgbCharRam)[tileBase + 1];
+				bits |= ((uint32_t*) renderer->d.sgbCharRam)[tileBase + 2];
+				bits |= ((uint32_t*) renderer->d.sgbCharRam)[tileBase + 3];
+				bits |= ((uint32_t*) renderer->d.sgbCharRam)[tileBase + 4];
+				bits |= ((uint32_t*) renderer->d.sgbCharRam)[tileBase + 5];
+				bits |= ((uint32_t*) renderer->d.sgbCharRam)[tileBase + 6];
+				bits |= ((uint32_t*) renderer->d.sgbCharRam)[tileBase + 7];
+				if (bits) {
+					renderer->sgbBorderMask[(y - 40) >> 3] |= 1 << ((x - 48) >> 3);
 				}
-				continue;
 			}
 
 			int yFlip = 0;
@@ -105,7 +98,6 @@ static void _regenerateSGBBorder(struct GBVideoSoftwareRenderer* renderer) {
 			tileData[2] = renderer->d.sgbCharRam[tileBase + 0x10];
 			tileData[3] = renderer->d.sgbCharRam[tileBase + 0x11];
 
-			size_t base = y * renderer->outputBufferStride + x;
 			int paletteBase = SGBBgAttributesGetPalette(mapData) * 0x10;
 			int colorSelector;
 
@@ -113,9 +105,43 @@ static void _regenerateSGBBorder(struct GBVideoSoftwareRenderer* renderer) {
 			if (SGBBgAttributesIsXFlip(mapData)) {
 				xFlip = 7;
 			}
+			int i;
 			for (i = 7; i >= 0; --i) {
 				colorSelector = (tileData[0] >> i & 0x1) << 0 | (tileData[1] >> i & 0x1) << 1 | (tileData[2] >> i & 0x1) << 2 | (tileData[3] >> i & 0x1) << 3;
-				renderer->outputBuffer[(base + 7 - i) ^ xFlip] = renderer->palette[paletteBase | colorSelector];
+				if (inWindow && !colorSelector) {
+					// The border only covers the game where it isn't transparent
+					indices[(x + 7 - i) ^ xFlip] = SGB_BORDER_TRANSPARENT;
+				} else {
+					indices[(x + 7 - i) ^ xFlip] = paletteBase | colorSelector;
+				}
+			}
+		}
+	}
+	renderer->sgbBorderDirty = false;
+}
+
+static void _regenerateSGBBorder(struct GBVideoSoftwareRenderer* renderer) {
+	int i;
+	for (i = 0; i < 0x40; ++i) {
+		uint16_t color;
+		LOAD_16LE(color, 0x800 + i * 2, renderer->d.sgbMapRam);
+		renderer->d.writePalette(&renderer->d, i + PAL_SGB_BORDER, color);
+	}
+	if (renderer->sgbBorderDirty) {
+		_decodeSGBBorder(renderer);
+	}
+	int x, y;
+	for (y = 0; y < 224; ++y) {
+		const uint8_t* indices = &renderer->sgbBorderCache[y * 256];
+		mColor* row = &renderer->outputBuffer[y * renderer->outputBufferStride];
+		for (x = 0; x < 256; ++x) {
+			if (x == 48 && y >= 40 && y < 184) {
+				// The game window is drawn over a scanline at a time
+				x = 207;
+				continue;
+			}
+			if (indices[x] != SGB_BORDER_TRANSPARENT) {
+				row[x] = renderer->palette[indices[x]];
 			}
 		}
 	}
@@ -187,6 +213,29 @@ static void _parseAttrLine(struct GBVideoSoftwareRenderer* renderer, int start)
 	}
 }
 
+static void _decodeTile(struct GBVideoSoftwareRenderer* renderer, unsigned tile) {
+	const uint8_t* data = &renderer->d.vram[tile * 16];
+	uint8_t* pixels = &renderer->tileCache[tile * 64];
+	int y;
+	for (y = 0; y < 8; ++y) {
+		uint8_t tileDataLower = data[y * 2];
+		uint8_t tileDataUpper = data[y * 2 + 1];
+		int x;
+		for (x = 0; x < 8; ++x) {
+			pixels[y * 8 + x] = ((tileDataUpper >> (7 - x)) & 1) << 1 | ((tileDataLower >> (7 - x)) & 1);
+		}
+	}
+	renderer->tileDirty[tile >> 5] &= ~(1U << (tile & 31));
+}
+
+static inline const uint8_t* _tileRow(struct GBVideoSoftwareRenderer* renderer, unsigned address) {
+	unsigned tile = address >> 4;
+	if (UNLIKELY(renderer->tileDirty[tile >> 5] & (1U << (tile & 31)))) {
+		_decodeTile(renderer, tile);
+	}
+	return &renderer->tileCache[(address & ~1) << 2];
+}
+
 static bool _inWindow(struct GBVideoSoftwareRenderer* renderer) {
 	return GBRegisterLCDCIsWindow(renderer->lcdc) && GB_VIDEO_HORIZONTAL_PIXELS + 7 > renderer->wx;
 }
@@ -255,6 +304,8 @@ static void GBVideoSoftwareRendererInit(struct GBVideoRenderer* renderer, enum G
 
 	memset(softwareRenderer->palette, 0, sizeof(softwareRenderer->palette));
 	memset(softwareRenderer->sgbBorderMask, 0, sizeof(softwareRenderer->sgbBorderMask));
+	softwareRenderer->sgbBorderDirty = true;
+	memset(softwareRenderer->tileDirty, 0xFF, sizeof(softwareRenderer->tileDirty));
 
 	softwareRenderer->lastHighlightAmount = 0;
 }
@@ -481,8 +532,16 @@ static void GBVideoSoftwareRendererWriteSGBPacket(struct GBVideoRenderer* render
 			}
 		}
 
+		break;
+	case SGB_PAL_TRN:
+	case SGB_CHR_TRN:
+	case SGB_PCT_TRN:
+		softwareRenderer->sgbBorderDirty = true;
 		break;
 	case SGB_ATRC_EN:
+		// Loading a state sends this after replacing the border data
+		softwareRenderer->sgbBorderDirty = true;
+		// Fall through
 	case SGB_MASK_EN:
 		if (softwareRenderer->sgbBorders && !renderer->sgbRenderMode) {
 			_regenerateSGBBorder(softwareRenderer);
@@ -551,6 +610,10 @@ static void GBVideoSoftwareRendererWritePalette(struct GBVideoRenderer* renderer
 }
 
 static void GBVideoSoftwareRendererWriteVRAM(struct GBVideoRenderer* renderer, uint16_t address) {
+	struct GBVideoSoftwareRenderer* softwareRenderer = (struct GBVideoSoftwareRenderer*) renderer;
+	// This is called before the write lands, so only mark the tile for decoding later
+	unsigned tile = (address & (GB_SIZE_VRAM - 1)) >> 4;
+	softwareRenderer->tileDirty[tile >> 5] |= 1U << (tile & 31);
 	if (renderer->cache) {
 		mCacheSetWriteVRAM(renderer->cache, address);
 	}
@@ -709,41 +772,14 @@ static void GBVideoSoftwareRendererDrawRange(struct GBVideoRenderer* renderer, i
 		}
 		if (softwareRenderer->sgbBorderMask[y >> 3]) {
 			uint32_t borderMask = softwareRenderer->sgbBorderMask[y >> 3];
-			int localY = y & 0x7;
-			for (x = startX; x < endX; x += 8) {
+			const uint8_t* indices = &softwareRenderer->sgbBorderCache[(y + 40) * 256 + 48];
+			for (x = startX; x < endX; ++x) {
 				if (!(borderMask & (1 << (x >> 3)))) {
+					x |= 7;
 					continue;
 				}
-				uint16_t mapData;
-				LOAD_16LE(mapData, (x >> 2) + 12 + (y & ~7) * 8 + 320, softwareRenderer->d.sgbMapRam);
-				if (UNLIKELY(SGBBgAttributesGetTile(mapData) >= 0x100)) {
-					continue;
-				}
-
-				int yFlip = 0;
-				if (SGBBgAttributesIsYFlip(mapData)) {
-					yFlip = 7;
-				}
-				unsigned tileBase = (SGBBgAttributesGetTile(mapData) * 16 + (localY ^ yFlip)) * 2;
-				uint8_t tileData[4];
-				tileData[0] = softwareRenderer->d.sgbCharRam[tileBase + 0x00];
-				tileData[1] = softwareRenderer->d.sgbCharRam[tileBase + 0x01];
-				tileData[2] = softwareRenderer->d.sgbCharRam[tileBase + 0x10];
-				tileData[3] = softwareRenderer->d.sgbCharRam[tileBase + 0x11];
-
-				int paletteBase = SGBBgAttributesGetPalette(mapData) * 0x10;
-				int colorSelector;
-
-				int flip = 0;
-				if (SGBBgAttributesIsXFlip(mapData)) {
-					flip = 7;
-				}
-				int i;
-				for (i = 7; i >= 0; --i) {
-					colorSelector = (tileData[0] >> i & 0x1) << 0 | (tileData[1] >> i & 0x1) << 1 | (tileData[2] >> i & 0x1) << 2 | (tileData[3] >> i & 0x1) << 3;
-					if (colorSelector) {
-						row[(x + 7 - i) ^ flip] = softwareRenderer->palette[paletteBase | colorSelector];
-					}
+				if (indices[x] != SGB_BORDER_TRANSPARENT) {
+					row[x] = softwareRenderer->palette[indices[x]];
 				}
 			}
 		}
@@ -872,6 +908,11 @@ static void GBVideoSoftwareRendererFinishFrame(struct GBVideoRenderer* renderer)
 		case SGB_PAL_TRN:
 		case SGB_CHR_TRN:
 		case SGB_PCT_TRN:
+			if (softwareRenderer->sgbTransfer == 1) {
+				// The transferred data landed during this frame
+				softwareRenderer->sgbBorderDirty = true;
+			}
+			// Fall through
 		case SGB_ATRC_EN:
 		case SGB_MASK_EN:
 			if (softwareRenderer->sgbBorders && !renderer->sgbRenderMode) {
@@ -910,7 +951,7 @@ static void GBVideoSoftwareRendererEnableSGBBorder(struct GBVideoRenderer* rende
 }
 
 static void GBVideoSoftwareRendererDrawBackground(struct GBVideoSoftwareRenderer* renderer, uint8_t* maps, int startX, int endX, int sx, int sy, bool highlight) {
-	uint8_t* data = renderer->d.vram;
+	unsigned data = 0;
 	uint8_t* attr = &maps[GB_SIZE_VRAM_BANK0];
 	if (!GBRegisterLCDCIsTileData(renderer->lcdc)) {
 		data += 0x1000;
@@ -922,45 +963,43 @@ static void GBVideoSoftwareRendererDrawBackground(struct GBVideoSoftwareRenderer
 	}
 	int x;
 	if ((startX + sx) & 7) {
+		// Every pixel before the next tile boundary comes from the same tile
 		int startX2 = startX + 8 - ((startX + sx) & 7);
-		for (x = startX; x < startX2; ++x) {
-			uint8_t* localData = data;
-			int localY = bottomY;
-			int topX = ((x + sx) >> 3) & 0x1F;
-			int bottomX = 7 - ((x + sx) & 7);
-			int bgTile;
-			if (GBRegisterLCDCIsTileData(renderer->lcdc)) {
-				bgTile = maps[topX + topY];
-			} else {
-				bgTile = ((int8_t*) maps)[topX + topY];
+		unsigned localData = data;
+		int localY = bottomY;
+		int topX = ((startX + sx) >> 3) & 0x1F;
+		int flip = 0;
+		int bgTile;
+		if (GBRegisterLCDCIsTileData(renderer->lcdc)) {
+			bgTile = maps[topX + topY];
+		} else {
+			bgTile = ((int8_t*) maps)[topX + topY];
+		}
+		int p = highlight ? PAL_HIGHLIGHT_BG : PAL_BG;
+		if (renderer->model >= GB_MODEL_CGB) {
+			GBObjAttributes attrs = attr[topX + topY];
+			p |= GBObjAttributesGetCGBPalette(attrs) * 4;
+			if (GBObjAttributesIsPriority(attrs) && GBRegisterLCDCIsBgEnable(renderer->lcdc)) {
+				p |= OBJ_PRIORITY;
 			}
-			int p = highlight ? PAL_HIGHLIGHT_BG : PAL_BG;
-			if (renderer->model >= GB_MODEL_CGB) {
-				GBObjAttributes attrs = attr[topX + topY];
-				p |= GBObjAttributesGetCGBPalette(attrs) * 4;
-				if (GBObjAttributesIsPriority(attrs) && GBRegisterLCDCIsBgEnable(renderer->lcdc)) {
-					p |= OBJ_PRIORITY;
-				}
-				if (GBObjAttributesIsBank(attrs)) {
-					localData += GB_SIZE_VRAM_BANK0;
-				}
-				if (GBObjAttributesIsYFlip(attrs)) {
-					localY = 7 - bottomY;
-				}
-				if (GBObjAttributesIsXFlip(attrs)) {
-					bottomX = 7 - bottomX;
-				}
+			if (GBObjAttributesIsBank(attrs)) {
+				localData += GB_SIZE_VRAM_BANK0;
+			}
+			if (GBObjAttributesIsYFlip(attrs)) {
+				localY = 7 - bottomY;
+			}
+			if (GBObjAttributesIsXFlip(attrs)) {
+				flip = 7;
 			}
-			uint8_t tileDataLower = localData[(bgTile * 8 + localY) * 2];
-			uint8_t tileDataUpper = localData[(bgTile * 8 + localY) * 2 + 1];
-			tileDataUpper >>= bottomX;
-			tileDataLower >>= bottomX;
-			renderer->row[x] = p | ((tileDataUpper & 1) << 1) | (tileDataLower & 1);
+		}
+		const uint8_t* pixels = _tileRow(renderer, localData + (bgTile * 8 + localY) * 2);
+		for (x = startX; x < startX2; ++x) {
+			renderer->row[x] = p | pixels[((x + sx) & 7) ^ flip];
 		}
 		startX = startX2;
 	}
 	for (x = startX; x < endX; x += 8) {
-		uint8_t* localData = data;
+		unsigned localData = data;
 		int localY = bottomY;
 		int topX = ((x + sx) >> 3) & 0x1F;
 		int bgTile;
@@ -983,29 +1022,27 @@ static void GBVideoSoftwareRendererDrawBackground(struct GBVideoSoftwareRenderer
 				localY = 7 - bottomY;
 			}
 			if (GBObjAttributesIsXFlip(attrs)) {
-				uint8_t tileDataLower = localData[(bgTile * 8 + localY) * 2];
-				uint8_t tileDataUpper = localData[(bgTile * 8 + localY) * 2 + 1];
-				renderer->row[x + 0] = p | ((tileDataUpper & 1) << 1) | (tileDataLower & 1);
-				renderer->row[x + 1] = p | (tileDataUpper & 2) | ((tileDataLower & 2) >> 1);
-				renderer->row[x + 2] = p | ((tileDataUpper & 4) >> 1) | ((tileDataLower & 4) >> 2);
-				renderer->row[x + 3] = p | ((tileDataUpper & 8) >> 2) | ((tileDataLower & 8) >> 3);
-				renderer->row[x + 4] = p | ((tileDataUpper & 16) >> 3) | ((tileDataLower & 16) >> 4);
-				renderer->row[x + 5] = p | ((tileDataUpper & 32) >> 4) | ((tileDataLower & 32) >> 5);
-				renderer->row[x + 6] = p | ((tileDataUpper & 64) >> 5) | ((tileDataLower & 64) >> 6);
-				renderer->row[x + 7] = p | ((tileDataUpper & 128) >> 6) | ((tileDataLower & 128) >> 7);
+				const uint8_t* pixels = _tileRow(renderer, localData + (bgTile * 8 + localY) * 2);
+				renderer->row[x + 0] = p | pixels[7];
+				renderer->row[x + 1] = p | pixels[6];
+				renderer->row[x + 2] = p | pixels[5];
+				renderer->row[x + 3] = p | pixels[4];
+				renderer->row[x + 4] = p | pixels[3];
+				renderer->row[x + 5] = p | pixels[2];
+				renderer->row[x + 6] = p | pixels[1];
+				renderer->row[x + 7] = p | pixels[0];
 				continue;
 			}
 		}
-		uint8_t tileDataLower = localData[(bgTile * 8 + localY) * 2];
-		uint8_t tileDataUpper = localData[(bgTile * 8 + localY) * 2 + 1];
-		renderer->row[x + 7] = p | ((tileDataUpper & 1) << 1) | (tileDataLower & 1);
-		renderer->row[x + 6] = p | (tileDataUpper & 2) | ((tileDataLower & 2) >> 1);
-		renderer->row[x + 5] = p | ((tileDataUpper & 4) >> 1) | ((tileDataLower & 4) >> 2);
-		renderer->row[x + 4] = p | ((tileDataUpper & 8) >> 2) | ((tileDataLower & 8) >> 3);
-		renderer->row[x + 3] = p | ((tileDataUpper & 16) >> 3) | ((tileDataLower & 16) >> 4);
-		renderer->row[x + 2] = p | ((tileDataUpper & 32) >> 4) | ((tileDataLower & 32) >> 5);
-		renderer->row[x + 1] = p | ((tileDataUpper & 64) >> 5) | ((tileDataLower & 64) >> 6);
-		renderer->row[x + 0] = p | ((tileDataUpper & 128) >> 6) | ((tileDataLower & 128) >> 7);
+		const uint8_t* pixels = _tileRow(renderer, localData + (bgTile * 8 + localY) * 2);
+		renderer->row[x + 0] = p | pixels[0];
+		renderer->row[x + 1] = p | pixels[1];
+		renderer->row[x + 2] = p | pixels[2];
+		renderer->row[x + 3] = p | pixels[3];
+		renderer->row[x + 4] = p | pixels[4];
+		renderer->row[x + 5] = p | pixels[5];
+		renderer->row[x + 6] = p | pixels[6];
+		renderer->row[x + 7] = p | pixels[7];
 	}
 }
 
@@ -1024,7 +1061,7 @@ static void GBVideoSoftwareRendererDrawObj(struct GBVideoSoftwareRenderer* rende
 	if (startX < 0) {
 		startX = 0;
 	}
-	uint8_t* data = renderer->d.vram;
+	unsigned data = 0;
 	int tileOffset = 0;
 	int bottomY;
 	int objY = obj->obj.y + renderer->objOffsetY;
@@ -1057,96 +1094,15 @@ static void GBVideoSoftwareRendererDrawObj(struct GBVideoSoftwareRenderer* rende
 	} else {
 		p |= (GBObjAttributesGetPalette(obj->obj.attr) + 8) * 4;
 	}
-	int bottomX;
-	int x = startX;
+	int flip = GBObjAttributesIsXFlip(obj->obj.attr) ? 7 : 0;
 	int objTile = obj->obj.tile + tileOffset;
-	if ((x - objX) & 7) {
-		for (; x < endX; ++x) {
-			if (GBObjAttributesIsXFlip(obj->obj.attr)) {
-				bottomX = (x - objX) & 7;
-			} else {
-				bottomX = 7 - ((x - objX) & 7);
-			}
-			uint8_t tileDataLower = data[(objTile * 8 + bottomY) * 2];
-			uint8_t tileDataUpper = data[(objTile * 8 + bottomY) * 2 + 1];
-			tileDataUpper >>= bottomX;
-			tileDataLower >>= bottomX;
-			unsigned current = renderer->row[x];
-			if (((tileDataUpper | tileDataLower) & 1) && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
-				renderer->row[x] = p | ((tileDataUpper & 1) << 1) | (tileDataLower & 1);
-			}
-		}
-	} else if (GBObjAttributesIsXFlip(obj->obj.attr)) {
-		uint8_t tileDataLower = data[(objTile * 8 + bottomY) * 2];
-		uint8_t tileDataUpper = data[(objTile * 8 + bottomY) * 2 + 1];
-		unsigned current;
-		current = renderer->row[x];
-		if (((tileDataUpper | tileDataLower) & 1) && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
-			renderer->row[x] = p | ((tileDataUpper & 1) << 1) | (tileDataLower & 1);
-		}
-		current = renderer->row[x + 1];
-		if (((tileDataUpper | tileDataLower) & 2) && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
-			renderer->row[x + 1] = p | (tileDataUpper & 2) | ((tileDataLower & 2) >> 1);
-		}
-		current = renderer->row[x + 2];
-		if (((tileDataUpper | tileDataLower) & 4) && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
-			renderer->row[x + 2] = p | ((tileDataUpper & 4) >> 1) | ((tileDataLower & 4) >> 2);
-		}
-		current = renderer->row[x + 3];
-		if (((tileDataUpper | tileDataLower) & 8) && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
-			renderer->row[x + 3] = p | ((tileDataUpper & 8) >> 2) | ((tileDataLower & 8) >> 3);
-		}
-		current = renderer->row[x + 4];
-		if (((tileDataUpper | tileDataLower) & 16) && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
-			renderer->row[x + 4] = p | ((tileDataUpper & 16) >> 3) | ((tileDataLower & 16) >> 4);
-		}
-		current = renderer->row[x + 5];
-		if (((tileDataUpper | tileDataLower) & 32) && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
-			renderer->row[x + 5] = p | ((tileDataUpper & 32) >> 4) | ((tileDataLower & 32) >> 5);
-		}
-		current = renderer->row[x + 6];
-		if (((tileDataUpper | tileDataLower) & 64) && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
-			renderer->row[x + 6] = p | ((tileDataUpper & 64) >> 5) | ((tileDataLower & 64) >> 6);
-		}
-		current = renderer->row[x + 7];
-		if (((tileDataUpper | tileDataLower) & 128) && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
-			renderer->row[x + 7] = p | ((tileDataUpper & 128) >> 6) | ((tileDataLower & 128) >> 7);
-		}
-	} else {
-		uint8_t tileDataLower = data[(objTile * 8 + bottomY) * 2];
-		uint8_t tileDataUpper = data[(objTile * 8 + bottomY) * 2 + 1];
-		unsigned current;
-		current = renderer->row[x + 7];
-		if (((tileDataUpper | tileDataLower) & 1) && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
-			renderer->row[x + 7] = p | ((tileDataUpper & 1) << 1) | (tileDataLower & 1);
-		}
-		current = renderer->row[x + 6];
-		if (((tileDataUpper | tileDataLower) & 2) && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
-			renderer->row[x + 6] = p | (tileDataUpper & 2) | ((tileDataLower & 2) >> 1);
-		}
-		current = renderer->row[x + 5];
-		if (((tileDataUpper | tileDataLower) & 4) && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
-			renderer->row[x + 5] = p | ((tileDataUpper & 4) >> 1) | ((tileDataLower & 4) >> 2);
-		}
-		current = renderer->row[x + 4];
-		if (((tileDataUpper | tileDataLower) & 8) && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
-			renderer->row[x + 4] = p | ((tileDataUpper & 8) >> 2) | ((tileDataLower & 8) >> 3);
-		}
-		current = renderer->row[x + 3];
-		if (((tileDataUpper | tileDataLower) & 16) && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
-			renderer->row[x + 3] = p | ((tileDataUpper & 16) >> 3) | ((tileDataLower & 16) >> 4);
-		}
-		current = renderer->row[x + 2];
-		if (((tileDataUpper | tileDataLower) & 32) && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
-			renderer->row[x + 2] = p | ((tileDataUpper & 32) >> 4) | ((tileDataLower & 32) >> 5);
-		}
-		current = renderer->row[x + 1];
-		if (((tileDataUpper | tileDataLower) & 64) && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
-			renderer->row[x + 1] = p | ((tileDataUpper & 64) >> 5) | ((tileDataLower & 64) >> 6);
-		}
-		current = renderer->row[x];
-		if (((tileDataUpper | tileDataLower) & 128) && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
-			renderer->row[x] = p | ((tileDataUpper & 128) >> 6) | ((tileDataLower & 128) >> 7);
+	const uint8_t* pixels = _tileRow(renderer, data + (objTile * 8 + bottomY) * 2);
+	int x;
+	for (x = startX; x < endX; ++x) {
+		unsigned color = pixels[((x - objX) & 7) ^ flip];
+		unsigned current = renderer->row[x];
+		if (color && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
+			renderer->row[x] = p | color;
 		}
 	}
 }
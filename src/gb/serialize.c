@@ -17,6 +17,10 @@ MGBA_EXPORT const uint32_t GBSavestateMagic = 0x00400000;
 MGBA_EXPORT const uint32_t GBSavestateVersion = 0x00000003;
 
 void GBSerialize(struct GB* gb, struct GBSerializedState* state) {
+	GBSerializeIncremental(gb, state, 0);
+}
+
+void GBSerializeIncremental(struct GB* gb, struct GBSerializedState* state, uint32_t since) {
 	STORE_32LE(GBSavestateMagic + GBSavestateVersion, 0, &state->versionMagic);
 	STORE_32LE(gb->romCrc32, 0, &state->romCrc32);
 	STORE_32LE(gb->timing.masterCycles, 0, &state->masterCycles);
@@ -58,9 +62,9 @@ void GBSerialize(struct GB* gb, struct GBSerializedState* state) {
 	STORE_32LE(flags, 0, &state->cpu.flags);
 	STORE_32LE(gb->eiPending.when - mTimingCurrentTime(&gb->timing), 0, &state->cpu.eiPending);
 
-	GBMemorySerialize(gb, state);
+	GBMemorySerialize(gb, state, since);
 	GBIOSerialize(gb, state);
-	GBVideoSerialize(&gb->video, state);
+	GBVideoSerialize(&gb->video, state, since);
 	GBTimerSerialize(&gb->timer, state);
 	GBAudioSerialize(&gb->audio, state);
 
@@ -70,6 +74,10 @@ void GBSerialize(struct GB* gb, struct GBSerializedState* state) {
 }
 
 bool GBDeserialize(struct GB* gb, const struct GBSerializedState* state) {
+	return GBDeserializeIncremental(gb, state, 0);
+}
+
+bool GBDeserializeIncremental(struct GB* gb, const struct GBSerializedState* state, uint32_t since) {
 	bool error = false;
 	int32_t check;
 	uint32_t ucheck;
@@ -185,7 +193,7 @@ bool GBDeserialize(struct GB* gb, const struct GBSerializedState* state) {
 
 	LOAD_32LE(gb->cpu->cycles, 0, &state->cpu.cycles);
 	LOAD_32LE(gb->cpu->nextEvent, 0, &state->cpu.nextEvent);
-	gb->timing.root = NULL;
+	mTimingDescheduleAll(&gb->timing);
 
 	uint32_t when;
 	LOAD_32LE(when, 0, &state->cpu.eiPending);
@@ -208,8 +216,8 @@ bool GBDeserialize(struct GB* gb, const struct GBSerializedState* state) {
 	}
 
 	GBUnmapBIOS(gb);
-	GBMemoryDeserialize(gb, state);
-	GBVideoDeserialize(&gb->video, state);
+	GBMemoryDeserialize(gb, state, since);
+	GBVideoDeserialize(&gb->video, state, since);
 	GBIODeserialize(gb, state);
 	GBTimerDeserialize(&gb->timer, state);
 	GBAudioDeserialize(&gb->audio, state);
@@ -221,7 +229,12 @@ bool GBDeserialize(struct GB* gb, const struct GBSerializedState* state) {
 	if (gb->model & GB_MODEL_SGB && canSgb) {
 		GBSGBDeserialize(gb, state);
 	}
+	if (!since) {
+		GBMemoryMarkDirty(&gb->memory);
+	}
 
+	// The time of the last idle loop iteration doesn't carry over
+	gb->lastJump = GB_IDLE_LOOP_NONE;
 	gb->cpu->memory.setActiveRegion(gb->cpu, gb->cpu->pc);
 
 	mTimingInterrupt(&gb->timing);
@@ -8,6 +8,7 @@
 #include <mgba/core/core.h>
 #include <mgba/gb/core.h>
 #include <mgba/internal/gb/gb.h>
+#include <mgba/internal/gb/io.h>
 #include <mgba/internal/gb/mbc.h>
 #include <mgba-util/vfs.h>
 
@@ -74,7 +75,64 @@ M_TEST_DEFINE(patchROMBank2) {
 	assert_int_equal(GBView8(gb->cpu, GB_SIZE_CART_BANK0, 2), newExpected);
 }
 
+M_TEST_DEFINE(loadSwitchedROMBank) {
+	struct mCore* core = *state;
+	struct GB* gb = core->board;
+
+	core->reset(core);
+	gb->memory.rom[GB_SIZE_CART_BANK0 * 2 + 0x1234] = 0x52;
+	gb->memory.rom[GB_SIZE_CART_BANK0 * 3 + 0x1234] = 0x53;
+	GBMBCSwitchBank(gb, 2);
+	assert_int_equal(GBLoad8(gb->cpu, GB_BASE_CART_BANK1 + 0x1234), 0x52);
+	GBMBCSwitchBank(gb, 3);
+	assert_int_equal(GBLoad8(gb->cpu, GB_BASE_CART_BANK1 + 0x1234), 0x53);
+}
+
+M_TEST_DEFINE(storeSwitchedWramBank) {
+	struct mCore* core = *state;
+	struct GB* gb = core->board;
+
+	core->reset(core);
+	GBMemorySwitchWramBank(&gb->memory, 2);
+	GBStore8(gb->cpu, GB_BASE_WORKING_RAM_BANK1 + 0x10, 0x62);
+	GBMemorySwitchWramBank(&gb->memory, 3);
+	GBStore8(gb->cpu, GB_BASE_WORKING_RAM_BANK1 + 0x10, 0x63);
+	assert_int_equal(gb->memory.wram[GB_SIZE_WORKING_RAM_BANK0 * 2 + 0x10], 0x62);
+	assert_int_equal(gb->memory.wram[GB_SIZE_WORKING_RAM_BANK0 * 3 + 0x10], 0x63);
+	assert_int_equal(GBLoad8(gb->cpu, GB_BASE_WORKING_RAM_BANK1 + 0x10), 0x63);
+
+	GBStore8(gb->cpu, GB_BASE_WORKING_RAM_BANK0 + 0x20, 0x70);
+	assert_int_equal(GBLoad8(gb->cpu, GB_BASE_WORKING_RAM_BANK0 + 0x2020), 0x70);
+}
+
+M_TEST_DEFINE(dirtyState) {
+	struct mCore* core = *state;
+	struct GB* gb = core->board;
+	uint32_t checkpoint;
+	int8_t old;
+
+	core->reset(core);
+	assert_int_equal(core->dirtyState(core, 0, &checkpoint), mCORE_DIRTY_ALL);
+	assert_int_equal(core->dirtyState(core, checkpoint, &checkpoint), 0);
+
+	GBPatch8(gb->cpu, GB_BASE_OAM + 4, 0x12, &old, 0);
+	assert_int_equal(core->dirtyState(core, checkpoint, &checkpoint), mCORE_DIRTY_OAM);
+
+	GBStore8(gb->cpu, GB_BASE_IO | GB_REG_BGP, 0x1B);
+	assert_int_equal(core->dirtyState(core, checkpoint, &checkpoint), mCORE_DIRTY_IO | mCORE_DIRTY_PALETTE);
+
+	GBPatch8(gb->cpu, GB_BASE_VRAM + 0x10, 0x34, &old, 0);
+	assert_int_equal(core->dirtyState(core, checkpoint, &checkpoint), mCORE_DIRTY_VRAM);
+
+	// Work RAM isn't part of the video state
+	GBStore8(gb->cpu, GB_BASE_WORKING_RAM_BANK0 + 0x30, 0x56);
+	assert_int_equal(core->dirtyState(core, checkpoint, &checkpoint), 0);
+}
+
 M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(GBMemory,
 	cmocka_unit_test(patchROMBank0),
 	cmocka_unit_test(patchROMBank1),
-	cmocka_unit_test(patchROMBank2))
+	cmocka_unit_test(patchROMBank2),
+	cmocka_unit_test(loadSwitchedROMBank),
+	cmocka_unit_test(storeSwitchedWramBank),
+	cmocka_unit_test(dirtyState))
@@ -7,6 +7,7 @@
 
 #include <mgba/core/sync.h>
 #include <mgba/core/cache-set.h>
+#include <mgba/core/host-trace.h>
 #include <mgba/internal/gb/gb.h>
 #include <mgba/internal/gb/io.h>
 #include <mgba/internal/gb/renderers/cache-set.h>
@@ -32,6 +33,7 @@ static void GBVideoDummyRendererGetPixels(struct GBVideoRenderer* renderer, size
 static void GBVideoDummyRendererPutPixels(struct GBVideoRenderer* renderer, size_t stride, const void* pixels);
 
 static void _cleanOAM(struct GBVideo* video, int y);
+static void _updateSkip(struct GBVideo* video);
 
 static void _endMode0(struct mTiming* timing, void* context, uint32_t cyclesLate);
 static void _endMode1(struct mTiming* timing, void* context, uint32_t cyclesLate);
@@ -281,8 +283,9 @@ static const uint8_t _defaultBorderChardata[] = {
 
 void GBVideoInit(struct GBVideo* video) {
 	video->renderer = NULL;
-	video->vram = anonymousMemoryMap(GB_SIZE_VRAM);
+	video->vram = &video->p->memory.arena[GB_ARENA_VRAM];
 	video->frameskip = 0;
+	video->renderSkip = false;
 
 	video->modeEvent.context = video;
 	video->modeEvent.name = "GB Video Mode";
@@ -317,6 +320,7 @@ void GBVideoReset(struct GBVideo* video) {
 
 	video->frameCounter = 0;
 	video->frameskipCounter = 0;
+	video->skipFrame = false;
 
 	GBVideoSwitchBank(video, 0);
 	memset(video->vram, 0, GB_SIZE_VRAM);
@@ -421,7 +425,6 @@ void GBVideoReset(struct GBVideo* video) {
 
 void GBVideoDeinit(struct GBVideo* video) {
 	video->renderer->deinit(video->renderer);
-	mappedMemoryFree(video->vram, GB_SIZE_VRAM);
 	if (video->renderer->sgbCharRam) {
 		mappedMemoryFree(video->renderer->sgbCharRam, SGB_SIZE_CHAR_RAM);
 		video->renderer->sgbCharRam = NULL;
@@ -545,7 +548,7 @@ void GBVideoSkipBIOS(struct GBVideo* video) {
 
 void _endMode0(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 	struct GBVideo* video = context;
-	if (video->frameskipCounter <= 0) {
+	if (!video->skipFrame) {
 		video->renderer->finishScanline(video->renderer, video->ly);
 	}
 	int lyc = video->p->memory.io[GB_REG_LYC];
@@ -599,6 +602,7 @@ void _endMode1(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 	if (video->ly == GB_VIDEO_VERTICAL_TOTAL_PIXELS + 1) {
 		video->ly = 0;
 		video->p->memory.io[GB_REG_LY] = video->ly;
+		_updateSkip(video);
 		next = GB_VIDEO_MODE_2_LENGTH;
 		video->mode = 2;
 		video->modeEvent.callback = _endMode2;
@@ -676,9 +680,13 @@ void _updateFrameCount(struct mTiming* timing, void* context, uint32_t cyclesLat
 		mTimingSchedule(timing, &video->frameEvent, GB_VIDEO_TOTAL_LENGTH << 1);
 	}
 
+	if (!video->skipFrame) {
+		mTRACE_BEGIN("Renderer: finish frame");
+		video->renderer->finishFrame(video->renderer);
+		mTRACE_END();
+	}
 	--video->frameskipCounter;
 	if (video->frameskipCounter < 0) {
-		video->renderer->finishFrame(video->renderer);
 		video->frameskipCounter = video->frameskip;
 	}
 	GBFrameEnded(video->p);
@@ -689,6 +697,11 @@ void _updateFrameCount(struct mTiming* timing, void* context, uint32_t cyclesLat
 	GBFrameStarted(video->p);
 }
 
+static void _updateSkip(struct GBVideo* video) {
+	// Streams still need every frame, even if the renderer is told not to bother
+	video->skipFrame = video->frameskipCounter > 0 || (video->renderSkip && !(video->p->stream && video->p->stream->postVideoFrame));
+}
+
 static void _cleanOAM(struct GBVideo* video, int y) {
 	int spriteHeight = 8;
 	if (GBRegisterLCDCIsObjSize(video->p->memory.io[GB_REG_LCDC])) {
@@ -720,8 +733,10 @@ void GBVideoProcessDots(struct GBVideo* video, uint32_t cyclesLate) {
 	if (oldX < 0) {
 		oldX = 0;
 	}
-	if (video->frameskipCounter <= 0) {
+	if (!video->skipFrame) {
+		mTRACE_BEGIN("Renderer: draw range");
 		video->renderer->drawRange(video->renderer, oldX, video->x, video->ly);
+		mTRACE_END();
 	}
 }
 
@@ -735,6 +750,7 @@ void GBVideoWriteLCDC(struct GBVideo* video, GBRegisterLCDC value) {
 
 		video->ly = 0;
 		video->p->memory.io[GB_REG_LY] = 0;
+		_updateSkip(video);
 		GBRegisterSTAT oldStat = video->stat;
 		video->stat = GBRegisterSTATSetMode(video->stat, 0);
 		video->stat = GBRegisterSTATSetLYC(video->stat, video->ly == video->p->memory.io[GB_REG_LYC]);
@@ -792,6 +808,7 @@ void GBVideoWriteLYC(struct GBVideo* video, uint8_t value) {
 }
 
 void GBVideoWritePalette(struct GBVideo* video, uint16_t address, uint8_t value) {
+	video->p->memory.paletteDirty = video->p->memory.dirtyGeneration;
 	if (video->p->model < GB_MODEL_SGB) {
 		switch (address) {
 		case GB_REG_BGP:
@@ -1123,7 +1140,7 @@ static void GBVideoDummyRendererPutPixels(struct GBVideoRenderer* renderer, size
 	// Nothing to do
 }
 
-void GBVideoSerialize(const struct GBVideo* video, struct GBSerializedState* state) {
+void GBVideoSerialize(const struct GBVideo* video, struct GBSerializedState* state, uint32_t since) {
 	STORE_16LE(video->x, 0, &state->video.x);
 	STORE_16LE(video->ly, 0, &state->video.ly);
 	STORE_32LE(video->frameCounter, 0, &state->video.frameCounter);
@@ -1148,11 +1165,11 @@ void GBVideoSerialize(const struct GBVideo* video, struct GBSerializedState* sta
 	STORE_32LE(video->modeEvent.when - mTimingCurrentTime(&video->p->timing), 0, &state->video.nextMode);
 	STORE_32LE(video->frameEvent.when - mTimingCurrentTime(&video->p->timing), 0, &state->video.nextFrame);
 
-	memcpy(state->vram, video->vram, GB_SIZE_VRAM);
+	mStateCopyDirtyPages(state->vram, video->vram, &video->p->memory.dirtyPages[GB_DIRTY_PAGES_VRAM], GB_SIZE_VRAM >> mSTATE_PAGE_SHIFT, since);
 	memcpy(state->oam, &video->oam.raw, GB_SIZE_OAM);
 }
 
-void GBVideoDeserialize(struct GBVideo* video, const struct GBSerializedState* state) {
+void GBVideoDeserialize(struct GBVideo* video, const struct GBSerializedState* state, uint32_t since) {
 	LOAD_16LE(video->x, 0, &state->video.x);
 	LOAD_16LE(video->ly, 0, &state->video.ly);
 	LOAD_32LE(video->frameCounter, 0, &state->video.frameCounter);
@@ -1208,7 +1225,7 @@ void GBVideoDeserialize(struct GBVideo* video, const struct GBSerializedState* s
 		video->renderer->writePalette(video->renderer, i, video->palette[i]);
 	}
 
-	memcpy(video->vram, state->vram, GB_SIZE_VRAM);
+	mStateCopyDirtyPages(video->vram, state->vram, &video->p->memory.dirtyPages[GB_DIRTY_PAGES_VRAM], GB_SIZE_VRAM >> mSTATE_PAGE_SHIFT, since);
 	memcpy(&video->oam.raw, state->oam, GB_SIZE_OAM);
 
 	_cleanOAM(video, video->ly);
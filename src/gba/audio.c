@@ -6,15 +6,15 @@
 #include <mgba/internal/gba/audio.h>
 
 #include <mgba/internal/arm/macros.h>
+#include <mgba/core/host-trace.h>
 #include <mgba/core/sync.h>
 #include <mgba/internal/gba/dma.h>
+#include <mgba/internal/gba/extra/audio-mixer.h>
 #include <mgba/internal/gba/gba.h>
 #include <mgba/internal/gba/io.h>
 #include <mgba/internal/gba/serialize.h>
 #include <mgba/internal/gba/video.h>
 
-#define MP2K_LOCK_MAX 8
-
 mLOG_DEFINE_CATEGORY(GBA_AUDIO, "GBA Audio", "gba.audio");
 
 const unsigned GBA_AUDIO_SAMPLES = 2048;
@@ -23,6 +23,7 @@ const int GBA_AUDIO_VOLUME_MAX = 0x100;
 static const int SAMPLE_INTERVAL = GBA_ARM7TDMI_FREQUENCY / 0x4000;
 
 static int _applyBias(struct GBAAudio* audio, int sample);
+static void _flushSamples(struct GBAAudio* audio);
 static void _sample(struct mTiming* timing, void* user, uint32_t cyclesLate);
 
 void GBAAudioInit(struct GBAAudio* audio, size_t samples) {
@@ -39,14 +40,20 @@ void GBAAudioInit(struct GBAAudio* audio, size_t samples) {
 	audio->psg.timing = &audio->p->timing;
 	audio->psg.frameEvent.context = audio;
 	audio->samples = samples;
+	audio->pendingBlocks = 0;
+	audio->pendingSamples = 0;
 
 	audio->forceDisableChA = false;
 	audio->forceDisableChB = false;
 	audio->masterVolume = GBA_AUDIO_VOLUME_MAX;
+	audio->skipMixing = false;
+	audio->mixer = NULL;
+	audio->externalMixing = false;
 	audio->sampleInterval = GBA_ARM7TDMI_FREQUENCY / 0x8000;
 }
 
 void GBAAudioReset(struct GBAAudio* audio) {
+	_flushSamples(audio);
 	GBAudioReset(&audio->psg);
 	mTimingDeschedule(&audio->p->timing, &audio->psg.frameEvent);
 	mTimingSchedule(&audio->p->timing, &audio->psg.frameEvent, 0);
@@ -82,6 +89,7 @@ void GBAAudioReset(struct GBAAudio* audio) {
 	audio->chBLeft = false;
 	audio->chBTimer = false;
 	audio->enable = false;
+	audio->externalMixing = false;
 	if (audio->sampleInterval != GBA_ARM7TDMI_FREQUENCY / 0x8000) {
 		audio->sampleInterval = GBA_ARM7TDMI_FREQUENCY / 0x8000;
 		if (audio->p->stream && audio->p->stream->audioRateChanged) {
@@ -116,6 +124,22 @@ void GBAAudioScheduleFifoDma(struct GBAAudio* audio, int number, struct GBADMA*
 		mLOG(GBA_AUDIO, GAME_ERROR, "Invalid FIFO destination: 0x%08X", info->dest);
 		return;
 	}
+	if (audio->mixer) {
+		// MP2K streams both of its buffers out of its work area, so look for its magic
+		// at the offsets of the right and left buffers
+		static const uint32_t offsets[] = { 0x350, 0x980 };
+		size_t i;
+		for (i = 0; i < sizeof(offsets) / sizeof(*offsets); ++i) {
+			if (info->source < GBA_BASE_EWRAM + offsets[i]) {
+				continue;
+			}
+			uint32_t value = GBAView32(audio->p->cpu, info->source - offsets[i]);
+			if (value - MP2K_MAGIC <= MP2K_LOCK_MAX) {
+				audio->mixer->engage(audio->mixer, info->source - offsets[i]);
+				break;
+			}
+		}
+	}
 }
 
 void GBAAudioWriteSOUND1CNT_LO(struct GBAAudio* audio, uint16_t value) {
@@ -202,6 +226,8 @@ void GBAAudioWriteSOUNDCNT_HI(struct GBAAudio* audio, uint16_t value) {
 		audio->chB.fifoWrite = 0;
 		audio->chB.fifoRead = 0;
 	}
+	GBATimerReschedule(audio->p, 0);
+	GBATimerReschedule(audio->p, 1);
 }
 
 void GBAAudioWriteSOUNDCNT_X(struct GBAAudio* audio, uint16_t value) {
@@ -221,6 +247,8 @@ void GBAAudioWriteSOUNDCNT_X(struct GBAAudio* audio, uint16_t value) {
 		audio->volumeChB = 0;
 		audio->p->memory.io[GBA_REG(SOUNDCNT_HI)] &= 0xFF00;
 	}
+	GBATimerReschedule(audio->p, 0);
+	GBATimerReschedule(audio->p, 1);
 }
 
 void GBAAudioWriteSOUNDBIAS(struct GBAAudio* audio, uint16_t value) {
@@ -235,6 +263,8 @@ void GBAAudioWriteSOUNDBIAS(struct GBAAudio* audio, uint16_t value) {
 		if (audio->sampleIndex >= GBA_MAX_SAMPLES) {
 			audio->sampleIndex = 0;
 		}
+		// Samples produced at the old rate need to go out before the stream hears about the new one
+		_flushSamples(audio);
 		if (audio->p->stream && audio->p->stream->audioRateChanged) {
 			audio->p->stream->audioRateChanged(audio->p->stream, GBA_ARM7TDMI_FREQUENCY / audio->sampleInterval);
 		}
@@ -353,8 +383,19 @@ void GBAAudioSample(struct GBAAudio* audio, int32_t timestamp) {
 	timestamp -= audio->sampleIndex * audio->sampleInterval; // TODO: This can break if the interval changes between samples
 
 	int maxSample = 2 << GBARegisterSOUNDBIASGetResolution(audio->soundbias);
-	int sample;
-	for (sample = audio->sampleIndex; timestamp >= audio->sampleInterval && sample < maxSample; ++sample, timestamp -= audio->sampleInterval) {
+	int sample = audio->sampleIndex;
+	if (audio->skipMixing) {
+		if (timestamp >= audio->sampleInterval) {
+			sample += timestamp / audio->sampleInterval;
+			if (sample > maxSample) {
+				sample = maxSample;
+			}
+			// Advance the PSG channels as far as mixing would have
+			GBAudioRun(&audio->psg, (sample - 1) * audio->sampleInterval + audio->lastSample, 0xF);
+		}
+		timestamp = 0;
+	}
+	for (; timestamp >= audio->sampleInterval && sample < maxSample; ++sample, timestamp -= audio->sampleInterval) {
 		int16_t sampleLeft = 0;
 		int16_t sampleRight = 0;
 		int psgShift = 4 - audio->volume;
@@ -363,23 +404,29 @@ void GBAAudioSample(struct GBAAudio* audio, int32_t timestamp) {
 		sampleLeft >>= psgShift;
 		sampleRight >>= psgShift;
 
+		int16_t sampleA = audio->chA.samples[sample] << 2;
+		int16_t sampleB = audio->chB.samples[sample] << 2;
+		if (audio->externalMixing) {
+			audio->mixer->step(audio->mixer, &sampleA, &sampleB);
+		}
+
 		if (!audio->forceDisableChA) {
 			if (audio->chALeft) {
-				sampleLeft += (audio->chA.samples[sample] << 2) >> !audio->volumeChA;
+				sampleLeft += sampleA >> !audio->volumeChA;
 			}
 
 			if (audio->chARight) {
-				sampleRight += (audio->chA.samples[sample] << 2) >> !audio->volumeChA;
+				sampleRight += sampleA >> !audio->volumeChA;
 			}
 		}
 
 		if (!audio->forceDisableChB) {
 			if (audio->chBLeft) {
-				sampleLeft += (audio->chB.samples[sample] << 2) >> !audio->volumeChB;
+				sampleLeft += sampleB >> !audio->volumeChB;
 			}
 
 			if (audio->chBRight) {
-				sampleRight += (audio->chB.samples[sample] << 2) >> !audio->volumeChB;
+				sampleRight += sampleB >> !audio->volumeChB;
 			}
 		}
 
@@ -396,21 +443,21 @@ void GBAAudioSample(struct GBAAudio* audio, int32_t timestamp) {
 	}
 }
 
-static void _sample(struct mTiming* timing, void* user, uint32_t cyclesLate) {
-	struct GBAAudio* audio = user;
-	GBAAudioSample(audio, mTimingCurrentTime(&audio->p->timing) - cyclesLate);
-
-	int samples = 2 << GBARegisterSOUNDBIASGetResolution(audio->soundbias);
-	memset(audio->chA.samples, audio->chA.samples[samples - 1], sizeof(audio->chA.samples));
-	memset(audio->chB.samples, audio->chB.samples[samples - 1], sizeof(audio->chB.samples));
+static void _flushSamples(struct GBAAudio* audio) {
+	unsigned samples = audio->pendingSamples;
+	audio->pendingBlocks = 0;
+	audio->pendingSamples = 0;
+	if (!samples) {
+		return;
+	}
 
-	mCoreSyncLockAudio(audio->p->sync);
-	mAudioBufferWrite(&audio->psg.buffer, (int16_t*) audio->currentSamples, samples);
+	mTRACE_BEGIN("Audio: produce");
+	mAudioBufferWrite(&audio->psg.buffer, (int16_t*) audio->pending, samples);
 	if (audio->p->stream) {
 		if (audio->p->stream->postAudioFrame) {
-			int i;
+			unsigned i;
 			for (i = 0; i < samples; ++i) {
-				audio->p->stream->postAudioFrame(audio->p->stream, audio->currentSamples[i].left,audio->currentSamples[i].right);
+				audio->p->stream->postAudioFrame(audio->p->stream, audio->pending[i].left, audio->pending[i].right);
 			}
 		}
 		if (audio->p->stream->postAudioBuffer) {
@@ -425,6 +472,31 @@ static void _sample(struct mTiming* timing, void* user, uint32_t cyclesLate) {
 		// Interrupted
 		audio->p->earlyExit = true;
 	}
+	mTRACE_END();
+}
+
+static void _sample(struct mTiming* timing, void* user, uint32_t cyclesLate) {
+	struct GBAAudio* audio = user;
+	GBAAudioSample(audio, mTimingCurrentTime(&audio->p->timing) - cyclesLate);
+
+	int samples = 2 << GBARegisterSOUNDBIASGetResolution(audio->soundbias);
+	memset(audio->chA.samples, audio->chA.samples[samples - 1], sizeof(audio->chA.samples));
+	memset(audio->chB.samples, audio->chB.samples[samples - 1], sizeof(audio->chB.samples));
+
+	if (audio->skipMixing) {
+		if (audio->pendingSamples) {
+			_flushSamples(audio);
+		}
+	} else {
+		// Mixing still has to happen on every block to stay exact, but locking the
+		// buffer and waking up the consumer don't, so batch those up
+		memcpy(&audio->pending[audio->pendingSamples], audio->currentSamples, samples * sizeof(*audio->currentSamples));
+		audio->pendingSamples += samples;
+		++audio->pendingBlocks;
+		if (audio->pendingBlocks == GBA_AUDIO_FLUSH_BLOCKS) {
+			_flushSamples(audio);
+		}
+	}
 
 	mTimingSchedule(timing, &audio->sampleEvent, SAMPLE_INTERVAL - cyclesLate);
 }
@@ -552,4 +624,10 @@ void GBAAudioDeserialize(struct GBAAudio* audio, const struct GBASerializedState
 		audio->lastSample = when - SAMPLE_INTERVAL;
 	}
 	mTimingSchedule(&audio->p->timing, &audio->sampleEvent, when);
+
+	if (audio->mixer) {
+		// The mixer's voices aren't saved, so pick them back up from the engine's work area
+		audio->externalMixing = false;
+		audio->mixer->vblank(audio->mixer);
+	}
 }
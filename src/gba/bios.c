@@ -22,6 +22,7 @@ static void _unHuffman(struct GBA* gba);
 static void _unRl(struct GBA* gba, int width);
 static void _unFilter(struct GBA* gba, int inwidth, int outwidth);
 static void _unBitPack(struct GBA* gba);
+static uint32_t _cpuSet(struct GBA* gba, bool fast);
 
 static int _mulWait(int32_t r) {
 	if ((r & 0xFFFFFF00) == 0xFFFFFF00 || !(r & 0xFFFFFF00)) {
@@ -39,6 +40,9 @@ static void _RegisterRamReset(struct GBA* gba) {
 	uint32_t registers = gba->cpu->gprs[0];
 	struct ARMCore* cpu = gba->cpu;
 	cpu->memory.store16(cpu, GBA_BASE_IO | GBA_REG_DISPCNT, 0x0080, 0);
+	if (registers & 0x0B) {
+		GBAMemoryMarkDirty(&gba->memory);
+	}
 	if (registers & 0x01) {
 		memset(gba->memory.wram, 0, GBA_SIZE_EWRAM);
 	}
@@ -481,6 +485,8 @@ void GBASwi16(struct ARMCore* cpu, int immediate) {
 		if (cpu->gprs[1] & (cpu->gprs[2] & (1 << 26) ? 3 : 1)) {
 			mLOG(GBA_BIOS, GAME_ERROR, "Misaligned CpuSet destination");
 		}
+		// The BIOS stalls for as long as r3 says, or does the whole thing itself if it's 0
+		cpu->gprs[3] = _cpuSet(gba, immediate == GBA_SWI_CPU_FAST_SET);
 		ARMRaiseSWI(cpu);
 		return;
 	case GBA_SWI_GET_BIOS_CHECKSUM:
@@ -628,6 +634,343 @@ uint32_t GBAChecksum(uint32_t* memory, size_t size) {
 	return sum;
 }
 
+// Unless something like a watchpoint has hooked the memory interface, the decompressors go
+// straight to the backing memory for the common regions, adding the same cycles that
+// GBALoad* and GBAStore* would. Everything else goes through the memory interface.
+static bool _canAccessDirectly(const struct ARMCore* cpu) {
+	return cpu->memory.load8 == GBALoad8 && cpu->memory.load16 == GBALoad16 && cpu->memory.load32 == GBALoad32 &&
+	       cpu->memory.store8 == GBAStore8 && cpu->memory.store16 == GBAStore16 && cpu->memory.store32 == GBAStore32;
+}
+
+static inline bool _isDirectVRAM(uint32_t address) {
+	return (address >> BASE_OFFSET) == GBA_REGION_VRAM && (address & 0x0001FFFF) < GBA_SIZE_VRAM;
+}
+
+static inline bool _vramStalls(struct GBA* gba, uint32_t address) {
+	return gba->video.stallMask && (address & 0x0001FFFF) < ((GBARegisterDISPCNTGetMode(gba->memory.io[GBA_REG(DISPCNT)]) >= 3) ? 0x00014000 : 0x00010000);
+}
+
+static inline void _addLoadWait(struct GBA* gba, uint32_t address, int32_t wait, int* cycles) {
+	if (!cycles) {
+		return;
+	}
+	wait += 2;
+	if (address < GBA_BASE_ROM0) {
+		wait = GBAMemoryStall(gba->cpu, wait);
+	}
+	*cycles += wait;
+}
+
+static inline void _addStoreWait(struct GBA* gba, uint32_t address, int32_t wait, int* cycles) {
+	if (!cycles) {
+		return;
+	}
+	++wait;
+	if (address < GBA_BASE_ROM0) {
+		wait = GBAMemoryStall(gba->cpu, wait);
+	}
+	*cycles += wait;
+}
+
+static inline uint32_t _load8(struct GBA* gba, bool direct, uint32_t address, int* cycles) {
+	const struct GBAFastRegion* fast = &gba->memory.fastRegions[address >> BASE_OFFSET];
+	if (!direct || (address & fast->mask) >= fast->limit) {
+		return gba->cpu->memory.load8(gba->cpu, address, cycles);
+	}
+	_addLoadWait(gba, address, gba->memory.waitstatesNonseq16[address >> BASE_OFFSET], cycles);
+	return ((uint8_t*) fast->base)[address & fast->mask];
+}
+
+static inline uint32_t _load16(struct GBA* gba, bool direct, uint32_t address, int* cycles) {
+	uint32_t value;
+	const struct GBAFastRegion* fast = &gba->memory.fastRegions[address >> BASE_OFFSET];
+	if (!direct) {
+		return gba->cpu->memory.load16(gba->cpu, address, cycles);
+	} else if ((address & fast->mask & -2) < fast->limit) {
+		LOAD_16(value, address & fast->mask & -2, fast->base);
+		_addLoadWait(gba, address, gba->memory.waitstatesNonseq16[address >> BASE_OFFSET], cycles);
+	} else if (_isDirectVRAM(address)) {
+		LOAD_16(value, address & 0x0001FFFE, gba->video.vram);
+		int32_t wait = 0;
+		if (_vramStalls(gba, address)) {
+			wait += GBAMemoryStallVRAM(gba, wait, 0);
+		}
+		_addLoadWait(gba, address, wait, cycles);
+	} else {
+		return gba->cpu->memory.load16(gba->cpu, address, cycles);
+	}
+	int rotate = (address & 1) << 3;
+	return ROR(value, rotate);
+}
+
+static inline uint32_t _load32(struct GBA* gba, bool direct, uint32_t address, int* cycles) {
+	uint32_t value;
+	const struct GBAFastRegion* fast = &gba->memory.fastRegions[address >> BASE_OFFSET];
+	if (!direct || (address & fast->mask & -4) >= fast->limit) {
+		return gba->cpu->memory.load32(gba->cpu, address, cycles);
+	}
+	LOAD_32(value, address & fast->mask & -4, fast->base);
+	_addLoadWait(gba, address, gba->memory.waitstatesNonseq32[address >> BASE_OFFSET], cycles);
+	int rotate = (address & 3) << 3;
+	return ROR(value, rotate);
+}
+
+static inline void _store8(struct GBA* gba, bool direct, uint32_t address, uint8_t value, int* cycles) {
+	struct GBAMemory* memory = &gba->memory;
+	const struct GBAFastRegion* fast = &memory->fastRegions[address >> BASE_OFFSET];
+	if (!direct || address >= GBA_BASE_IO || (address & fast->mask) >= fast->limit) {
+		gba->cpu->memory.store8(gba->cpu, address, value, cycles);
+		return;
+	}
+	((uint8_t*) fast->base)[address & fast->mask] = value;
+	fast->dirty[(address & fast->mask) >> mSTATE_PAGE_SHIFT] = memory->dirtyGeneration;
+	_addStoreWait(gba, address, memory->waitstatesNonseq16[address >> BASE_OFFSET], cycles);
+}
+
+static inline void _store16(struct GBA* gba, bool direct, uint32_t address, uint16_t value, int* cycles) {
+	struct GBAMemory* memory = &gba->memory;
+	const struct GBAFastRegion* fast = &memory->fastRegions[address >> BASE_OFFSET];
+	if (!direct) {
+		gba->cpu->memory.store16(gba->cpu, address, value, cycles);
+	} else if (address < GBA_BASE_IO && (address & fast->mask & -2) < fast->limit) {
+		STORE_16(value, address & fast->mask & -2, fast->base);
+		fast->dirty[(address & fast->mask) >> mSTATE_PAGE_SHIFT] = memory->dirtyGeneration;
+		_addStoreWait(gba, address, memory->waitstatesNonseq16[address >> BASE_OFFSET], cycles);
+	} else if (_isDirectVRAM(address)) {
+		uint16_t oldValue;
+		LOAD_16(oldValue, address & 0x0001FFFE, gba->video.vram);
+		if (value != oldValue) {
+			STORE_16(value, address & 0x0001FFFE, gba->video.vram);
+			memory->dirtyPages[GBA_DIRTY_PAGES_VRAM + ((address & 0x0001FFFE) >> mSTATE_PAGE_SHIFT)] = memory->dirtyGeneration;
+			gba->video.renderer->writeVRAM(gba->video.renderer, address & 0x0001FFFE);
+		}
+		int32_t wait = 0;
+		if (_vramStalls(gba, address)) {
+			wait += GBAMemoryStallVRAM(gba, wait, 0);
+		}
+		_addStoreWait(gba, address, wait, cycles);
+	} else {
+		gba->cpu->memory.store16(gba->cpu, address, value, cycles);
+	}
+}
+
+static inline void _store32(struct GBA* gba, bool direct, uint32_t address, uint32_t value, int* cycles) {
+	struct GBAMemory* memory = &gba->memory;
+	const struct GBAFastRegion* fast = &memory->fastRegions[address >> BASE_OFFSET];
+	if (!direct) {
+		gba->cpu->memory.store32(gba->cpu, address, value, cycles);
+	} else if (address < GBA_BASE_IO && (address & fast->mask & -4) < fast->limit) {
+		STORE_32(value, address & fast->mask & -4, fast->base);
+		fast->dirty[(address & fast->mask) >> mSTATE_PAGE_SHIFT] = memory->dirtyGeneration;
+		_addStoreWait(gba, address, memory->waitstatesNonseq32[address >> BASE_OFFSET], cycles);
+	} else if (_isDirectVRAM(address)) {
+		uint32_t oldValue;
+		LOAD_32(oldValue, address & 0x0001FFFC, gba->video.vram);
+		if (value != oldValue) {
+			STORE_32(value, address & 0x0001FFFC, gba->video.vram);
+			memory->dirtyPages[GBA_DIRTY_PAGES_VRAM + ((address & 0x0001FFFC) >> mSTATE_PAGE_SHIFT)] = memory->dirtyGeneration;
+			gba->video.renderer->writeVRAM(gba->video.renderer, (address & 0x0001FFFC) + 2);
+			gba->video.renderer->writeVRAM(gba->video.renderer, address & 0x0001FFFC);
+		}
+		int32_t wait = 1;
+		if (_vramStalls(gba, address)) {
+			wait += GBAMemoryStallVRAM(gba, wait, 1);
+		}
+		_addStoreWait(gba, address, wait, cycles);
+	} else {
+		gba->cpu->memory.store32(gba->cpu, address, value, cycles);
+	}
+}
+
+// Finds size bytes at address in a single fast region, or returns NULL. Spans that will be
+// written must also be in RAM, i.e. EWRAM or IWRAM.
+static uint8_t* _directSpan(struct GBA* gba, uint32_t address, uint32_t size, bool write) {
+	const struct GBAFastRegion* fast = &gba->memory.fastRegions[address >> BASE_OFFSET];
+	if (write && (address >= GBA_BASE_IO || !fast->dirty)) {
+		return NULL;
+	}
+	uint32_t offset = address & fast->mask;
+	if (offset >= fast->limit || size > fast->limit - offset) {
+		return NULL;
+	}
+	return &((uint8_t*) fast->base)[offset];
+}
+
+static void _markSpanDirty(struct GBA* gba, uint32_t address, uint32_t size) {
+	const struct GBAFastRegion* fast = &gba->memory.fastRegions[address >> BASE_OFFSET];
+	uint32_t page = (address & fast->mask) >> mSTATE_PAGE_SHIFT;
+	uint32_t end = ((address & fast->mask) + size - 1) >> mSTATE_PAGE_SHIFT;
+	for (; page <= end; ++page) {
+		fast->dirty[page] = gba->memory.dirtyGeneration;
+	}
+}
+
+// Copies a run byte by byte, as the BIOS does, when it overlaps itself, e.g. an LZ77
+// back-reference closer than its own length
+static void _copyRun(uint8_t* to, const uint8_t* from, uint32_t size) {
+	if (from < to + size && to < from + size) {
+		uint32_t i;
+		for (i = 0; i < size; ++i) {
+			to[i] = from[i];
+		}
+	} else {
+		memcpy(to, from, size);
+	}
+}
+
+// Cycles for an LDM or STM of count words, as GBALoadMultiple and GBAStoreMultiple count them,
+// plus fetching it from the BIOS. An LDM takes one more on top of that.
+static inline int32_t _multipleCycles(const struct GBAMemory* memory, uint32_t address, int count) {
+	int region = address >> BASE_OFFSET;
+	return 1 + memory->waitstatesSeq32[region] - memory->waitstatesNonseq32[region] + count * (memory->waitstatesSeq32[region] + 1);
+}
+
+// Does a CpuSet or CpuFastSet here in one go when it's between plain memory, doesn't overlap
+// itself and would be done before the next event, and returns how long the BIOS should then
+// stall for to take as long as its own loop would have, in steps of 4 cycles. Returns 0 to
+// leave it to the BIOS instead.
+static uint32_t _cpuSet(struct GBA* gba, bool fast) {
+	struct ARMCore* cpu = gba->cpu;
+	struct GBAMemory* memory = &gba->memory;
+	uint32_t source = cpu->gprs[0];
+	uint32_t dest = cpu->gprs[1];
+	bool fill = cpu->gprs[2] & 0x01000000;
+	uint32_t width = fast || (cpu->gprs[2] & 0x04000000) ? 4 : 2;
+	// The count is shifted up by 12 and back down, so only its low 20 bits matter
+	uint32_t count = cpu->gprs[2] & 0x000FFFFF;
+	if (fast) {
+		count = (count + 7) & ~7;
+	}
+	if (!count || ((source | dest) & (width - 1)) || !_canAccessDirectly(cpu)) {
+		return 0;
+	}
+	uint32_t size = count * width;
+	const uint8_t* from = _directSpan(gba, source, fill ? width : size, false);
+	uint8_t* to = NULL;
+	bool video = true;
+	switch (dest >> BASE_OFFSET) {
+	case GBA_REGION_EWRAM:
+	case GBA_REGION_IWRAM:
+		video = false;
+		// Fall through
+	case GBA_REGION_PALETTE_RAM:
+	case GBA_REGION_OAM:
+		to = _directSpan(gba, dest, size, false);
+		break;
+	case GBA_REGION_VRAM:
+		if (!gba->video.stallMask && (dest & 0x0001FFFF) < GBA_SIZE_VRAM && size <= GBA_SIZE_VRAM - (dest & 0x0001FFFF)) {
+			to = &((uint8_t*) gba->video.vram)[dest & 0x0001FFFF];
+		}
+		break;
+	}
+	if (!from || !to || (!fill && from < to + size && to < from + size)) {
+		return 0;
+	}
+
+	// How long the BIOS would take to do it, and how long it takes to get to the stall and back
+	// instead, besides the stall itself. Each instruction fetch from the BIOS takes a cycle.
+	int32_t cycles;
+	int32_t stub;
+	if (fast) {
+		int32_t block = 4 /* cmp, blt */ + _multipleCycles(memory, dest, 8);
+		if (fill) {
+			// The stub reads the fill value again for r3, so that cancels out
+			cycles = 100;
+			stub = 70;
+		} else {
+			cycles = 93;
+			block += 1 + _multipleCycles(memory, source, 8);
+			// The stub reads the start of the last block back for r3
+			stub = 70 + 3 + memory->waitstatesNonseq32[dest >> BASE_OFFSET];
+		}
+		cycles += block * (count / 8);
+	} else {
+		int32_t unit;
+		if (width == 4) {
+			unit = 4 /* cmp, blt */ + _multipleCycles(memory, dest, 1);
+			if (fill) {
+				cycles = 88 + 1 + _multipleCycles(memory, source, 1);
+			} else {
+				cycles = 91;
+				unit += 1 + _multipleCycles(memory, source, 1);
+			}
+		} else {
+			unit = 4 /* cmp, blt */ + 2 + memory->waitstatesNonseq16[dest >> BASE_OFFSET];
+			if (fill) {
+				cycles = 92 + 3 + memory->waitstatesNonseq16[source >> BASE_OFFSET];
+			} else {
+				cycles = 90;
+				unit += 3 + memory->waitstatesNonseq16[source >> BASE_OFFSET];
+			}
+		}
+		cycles += unit * count;
+		stub = 69;
+	}
+	if (cycles < stub + 4) {
+		return 0;
+	}
+	// The BIOS takes IRQs while it copies, and scanlines, DMAs and timers keep going, so
+	// doing it in one go is only invisible if none of them can happen before it's done
+	if (gba->timing.interrupted || cycles >= mTimingNextEvent(&gba->timing)) {
+		return 0;
+	}
+
+	uint32_t value = 0;
+	if (fill) {
+		if (width == 4) {
+			LOAD_32(value, 0, from);
+		} else {
+			LOAD_16(value, 0, from);
+		}
+	}
+	if (video) {
+		uint32_t i;
+		for (i = 0; i < size; i += width) {
+			if (width == 4) {
+				if (!fill) {
+					LOAD_32(value, i, from);
+				}
+				_store32(gba, true, dest + i, value, NULL);
+			} else {
+				if (!fill) {
+					LOAD_16(value, i, from);
+				}
+				_store16(gba, true, dest + i, value, NULL);
+			}
+		}
+	} else {
+		if (!fill) {
+			memcpy(to, from, size);
+		} else if (width == 4) {
+			uint32_t i;
+			for (i = 0; i < size; i += 4) {
+				STORE_32(value, i, to);
+			}
+		} else {
+			uint32_t i;
+			for (i = 0; i < size; i += 2) {
+				STORE_16(value, i, to);
+			}
+		}
+		_markSpanDirty(gba, dest, size);
+	}
+
+	// Leave r0 and r1 where the BIOS would have
+	if (width == 4) {
+		if (fast) {
+			if (!fill) {
+				cpu->gprs[0] += size;
+			}
+		} else {
+			cpu->gprs[0] += fill ? 4 : size;
+		}
+		cpu->gprs[1] += size;
+	}
+	cycles -= stub;
+	cpu->cycles += cycles & 3;
+	return cycles & ~3;
+}
+
 static void _unLz77(struct GBA* gba, int width) {
 	struct ARMCore* cpu = gba->cpu;
 	uint32_t source = cpu->gprs[0];
@@ -635,7 +978,8 @@ static void _unLz77(struct GBA* gba, int width) {
 	int cycles = 20;
 	enum mMemoryAccessSource oldAccess = cpu->memory.accessSource;
 	cpu->memory.accessSource = mACCESS_DECOMPRESS;
-	int remaining = (cpu->memory.load32(cpu, source, &cycles) & 0xFFFFFF00) >> 8;
+	bool direct = _canAccessDirectly(cpu);
+	int remaining = (_load32(gba, direct, source, &cycles) & 0xFFFFFF00) >> 8;
 	// We assume the signature byte (0x10) is correct
 	int blockheader = 0; // Some compilers warn if this isn't set, even though it's trivially provably always set
 	source += 4;
@@ -650,10 +994,29 @@ static void _unLz77(struct GBA* gba, int width) {
 			cycles += 18;
 			if (blockheader & 0x80) {
 				// Compressed
-				int block = cpu->memory.load8(cpu, source + 1, &cycles) | (cpu->memory.load8(cpu, source, &cycles) << 8);
+				int block = _load8(gba, direct, source + 1, &cycles) | (_load8(gba, direct, source, &cycles) << 8);
 				source += 2;
 				disp = dest - (block & 0x0FFF) - 1;
 				bytes = (block >> 12) + 3;
+				if (width == 1 && direct && bytes <= remaining) {
+					uint8_t* to = _directSpan(gba, dest, bytes, true);
+					const uint8_t* from = _directSpan(gba, disp, bytes, false);
+					if (to && from) {
+						int32_t loadWait = gba->memory.waitstatesNonseq16[disp >> BASE_OFFSET] + 2;
+						int32_t storeWait = gba->memory.waitstatesNonseq16[dest >> BASE_OFFSET] + 1;
+						bool loadStalls = disp < GBA_BASE_ROM0;
+						_copyRun(to, from, bytes);
+						_markSpanDirty(gba, dest, bytes);
+						remaining -= bytes;
+						disp += bytes;
+						dest += bytes;
+						for (; bytes; --bytes) {
+							cycles += 10;
+							cycles += loadStalls ? GBAMemoryStall(cpu, loadWait) : loadWait;
+							cycles += GBAMemoryStall(cpu, storeWait);
+						}
+					}
+				}
 				while (bytes--) {
 					cycles += 10;
 					if (remaining) {
@@ -667,36 +1030,36 @@ static void _unLz77(struct GBA* gba, int width) {
 						}
 					}
 					if (width == 2) {
-						byte = (int16_t) cpu->memory.load16(cpu, disp & ~1, &cycles);
+						byte = (int16_t) _load16(gba, direct, disp & ~1, &cycles);
 						if (dest & 1) {
 							byte >>= (disp & 1) * 8;
 							halfword |= byte << 8;
-							cpu->memory.store16(cpu, dest ^ 1, halfword, &cycles);
+							_store16(gba, direct, dest ^ 1, halfword, &cycles);
 						} else {
 							byte >>= (disp & 1) * 8;
 							halfword = byte & 0xFF;
 						}
 						cycles += 4;
 					} else {
-						byte = cpu->memory.load8(cpu, disp, &cycles);
-						cpu->memory.store8(cpu, dest, byte, &cycles);
+						byte = _load8(gba, direct, disp, &cycles);
+						_store8(gba, direct, dest, byte, &cycles);
 					}
 					++disp;
 					++dest;
 				}
 			} else {
 				// Uncompressed
-				byte = cpu->memory.load8(cpu, source, &cycles);
+				byte = _load8(gba, direct, source, &cycles);
 				++source;
 				if (width == 2) {
 					if (dest & 1) {
 						halfword |= byte << 8;
-						cpu->memory.store16(cpu, dest ^ 1, halfword, &cycles);
+						_store16(gba, direct, dest ^ 1, halfword, &cycles);
 					} else {
 						halfword = byte;
 					}
 				} else {
-					cpu->memory.store8(cpu, dest, byte, &cycles);
+					_store8(gba, direct, dest, byte, &cycles);
 				}
 				++dest;
 				--remaining;
@@ -704,7 +1067,7 @@ static void _unLz77(struct GBA* gba, int width) {
 			blockheader <<= 1;
 			--blocksRemaining;
 		} else {
-			blockheader = cpu->memory.load8(cpu, source, &cycles);
+			blockheader = _load8(gba, direct, source, &cycles);
 			++source;
 			blocksRemaining = 8;
 		}
@@ -727,7 +1090,8 @@ static void _unHuffman(struct GBA* gba) {
 	uint32_t dest = cpu->gprs[1];
 	enum mMemoryAccessSource oldAccess = cpu->memory.accessSource;
 	cpu->memory.accessSource = mACCESS_DECOMPRESS;
-	uint32_t header = cpu->memory.load32(cpu, source, 0);
+	bool direct = _canAccessDirectly(cpu);
+	uint32_t header = _load32(gba, direct, source, 0);
 	int remaining = header >> 8;
 	unsigned bits = header & 0xF;
 	if (bits == 0) {
@@ -740,7 +1104,7 @@ static void _unHuffman(struct GBA* gba) {
 		return;
 	}
 	// We assume the signature byte (0x20) is correct
-	int treesize = (cpu->memory.load8(cpu, source + 4, 0) << 1) + 1;
+	int treesize = (_load8(gba, direct, source + 4, 0) << 1) + 1;
 	int block = 0;
 	uint32_t treeBase = source + 5;
 	source += 5 + treesize;
@@ -749,28 +1113,28 @@ static void _unHuffman(struct GBA* gba) {
 	int bitsRemaining;
 	int readBits;
 	int bitsSeen = 0;
-	node = cpu->memory.load8(cpu, nPointer, 0);
+	node = _load8(gba, direct, nPointer, 0);
 	while (remaining > 0) {
-		uint32_t bitstream = cpu->memory.load32(cpu, source, 0);
+		uint32_t bitstream = _load32(gba, direct, source, 0);
 		source += 4;
 		for (bitsRemaining = 32; bitsRemaining > 0 && remaining > 0; --bitsRemaining, bitstream <<= 1) {
 			uint32_t next = (nPointer & ~1) + HuffmanNodeGetOffset(node) * 2 + 2;
 			if (bitstream & 0x80000000) {
 				// Go right
 				if (HuffmanNodeIsRTerm(node)) {
-					readBits = cpu->memory.load8(cpu, next + 1, 0);
+					readBits = _load8(gba, direct, next + 1, 0);
 				} else {
 					nPointer = next + 1;
-					node = cpu->memory.load8(cpu, nPointer, 0);
+					node = _load8(gba, direct, nPointer, 0);
 					continue;
 				}
 			} else {
 				// Go left
 				if (HuffmanNodeIsLTerm(node)) {
-					readBits = cpu->memory.load8(cpu, next, 0);
+					readBits = _load8(gba, direct, next, 0);
 				} else {
 					nPointer = next;
-					node = cpu->memory.load8(cpu, nPointer, 0);
+					node = _load8(gba, direct, nPointer, 0);
 					continue;
 				}
 			}
@@ -778,10 +1142,10 @@ static void _unHuffman(struct GBA* gba) {
 			block |= (readBits & ((1 << bits) - 1)) << bitsSeen;
 			bitsSeen += bits;
 			nPointer = treeBase;
-			node = cpu->memory.load8(cpu, nPointer, 0);
+			node = _load8(gba, direct, nPointer, 0);
 			if (bitsSeen == 32) {
 				bitsSeen = 0;
-				cpu->memory.store32(cpu, dest, block, 0);
+				_store32(gba, direct, dest, block, 0);
 				dest += 4;
 				remaining -= 4;
 				block = 0;
@@ -798,7 +1162,8 @@ static void _unRl(struct GBA* gba, int width) {
 	uint32_t source = cpu->gprs[0];
 	enum mMemoryAccessSource oldAccess = cpu->memory.accessSource;
 	cpu->memory.accessSource = mACCESS_DECOMPRESS;
-	int remaining = (cpu->memory.load32(cpu, source & 0xFFFFFFFC, 0) & 0xFFFFFF00) >> 8;
+	bool direct = _canAccessDirectly(cpu);
+	int remaining = (_load32(gba, direct, source & 0xFFFFFFFC, 0) & 0xFFFFFF00) >> 8;
 	int padding = (4 - remaining) & 0x3;
 	// We assume the signature byte (0x30) is correct
 	int blockheader;
@@ -807,44 +1172,68 @@ static void _unRl(struct GBA* gba, int width) {
 	uint32_t dest = cpu->gprs[1];
 	int halfword = 0;
 	while (remaining > 0) {
-		blockheader = cpu->memory.load8(cpu, source, 0);
+		blockheader = _load8(gba, direct, source, 0);
 		++source;
 		if (blockheader & 0x80) {
 			// Compressed
 			blockheader &= 0x7F;
 			blockheader += 3;
-			block = cpu->memory.load8(cpu, source, 0);
+			block = _load8(gba, direct, source, 0);
 			++source;
+			if (width == 1 && direct) {
+				int run = blockheader < remaining ? blockheader : remaining;
+				uint8_t* to = _directSpan(gba, dest, run, true);
+				if (to) {
+					memset(to, block, run);
+					_markSpanDirty(gba, dest, run);
+					remaining -= run;
+					blockheader -= run;
+					dest += run;
+				}
+			}
 			while (blockheader-- && remaining) {
 				--remaining;
 				if (width == 2) {
 					if (dest & 1) {
 						halfword |= block << 8;
-						cpu->memory.store16(cpu, dest ^ 1, halfword, 0);
+						_store16(gba, direct, dest ^ 1, halfword, 0);
 					} else {
 						halfword = block;
 					}
 				} else {
-					cpu->memory.store8(cpu, dest, block, 0);
+					_store8(gba, direct, dest, block, 0);
 				}
 				++dest;
 			}
 		} else {
 			// Uncompressed
 			blockheader++;
+			if (width == 1 && direct) {
+				int run = blockheader < remaining ? blockheader : remaining;
+				uint8_t* to = _directSpan(gba, dest, run, true);
+				const uint8_t* from = _directSpan(gba, source, run, false);
+				if (to && from) {
+					_copyRun(to, from, run);
+					_markSpanDirty(gba, dest, run);
+					remaining -= run;
+					blockheader -= run;
+					source += run;
+					dest += run;
+				}
+			}
 			while (blockheader-- && remaining) {
 				--remaining;
-				int byte = cpu->memory.load8(cpu, source, 0);
+				int byte = _load8(gba, direct, source, 0);
 				++source;
 				if (width == 2) {
 					if (dest & 1) {
 						halfword |= byte << 8;
-						cpu->memory.store16(cpu, dest ^ 1, halfword, 0);
+						_store16(gba, direct, dest ^ 1, halfword, 0);
 					} else {
 						halfword = byte;
 					}
 				} else {
-					cpu->memory.store8(cpu, dest, byte, 0);
+					_store8(gba, direct, dest, byte, 0);
 				}
 				++dest;
 			}
@@ -856,11 +1245,11 @@ static void _unRl(struct GBA* gba, int width) {
 			++dest;
 		}
 		for (; padding > 0; padding -= 2, dest += 2) {
-			cpu->memory.store16(cpu, dest, 0, 0);
+			_store16(gba, direct, dest, 0, 0);
 		}
 	} else {
 		while (padding--) {
-			cpu->memory.store8(cpu, dest, 0, 0);
+			_store8(gba, direct, dest, 0, 0);
 			++dest;
 		}
 	}
@@ -875,7 +1264,8 @@ static void _unFilter(struct GBA* gba, int inwidth, int outwidth) {
 	uint32_t dest = cpu->gprs[1];
 	enum mMemoryAccessSource oldAccess = cpu->memory.accessSource;
 	cpu->memory.accessSource = mACCESS_DECOMPRESS;
-	uint32_t header = cpu->memory.load32(cpu, source, 0);
+	bool direct = _canAccessDirectly(cpu);
+	uint32_t header = _load32(gba, direct, source, 0);
 	int remaining = header >> 8;
 	// We assume the signature nybble (0x8) is correct
 	uint16_t halfword = 0;
@@ -884,25 +1274,25 @@ static void _unFilter(struct GBA* gba, int inwidth, int outwidth) {
 	while (remaining > 0) {
 		uint16_t new;
 		if (inwidth == 1) {
-			new = cpu->memory.load8(cpu, source, 0);
+			new = _load8(gba, direct, source, 0);
 		} else {
-			new = cpu->memory.load16(cpu, source, 0);
+			new = _load16(gba, direct, source, 0);
 		}
 		new += old;
 		if (outwidth > inwidth) {
 			halfword >>= 8;
 			halfword |= (new << 8);
 			if (source & 1) {
-				cpu->memory.store16(cpu, dest, halfword, 0);
+				_store16(gba, direct, dest, halfword, 0);
 				dest += outwidth;
 				remaining -= outwidth;
 			}
 		} else if (outwidth == 1) {
-			cpu->memory.store8(cpu, dest, new, 0);
+			_store8(gba, direct, dest, new, 0);
 			dest += outwidth;
 			remaining -= outwidth;
 		} else {
-			cpu->memory.store16(cpu, dest, new, 0);
+			_store16(gba, direct, dest, new, 0);
 			dest += outwidth;
 			remaining -= outwidth;
 		}
@@ -8,6 +8,7 @@
 
 #include <mgba/internal/arm/macros.h>
 #include <mgba/internal/gba/gba.h>
+#include <mgba-util/hash.h>
 #include <mgba-util/memory.h>
 
 #ifdef USE_FFMPEG
@@ -186,10 +187,12 @@ void GBACartEReaderInit(struct GBACartEReader* ereader) {
 	if (ereader->p->memory.savedata.data[0xD000] == 0xFF) {
 		memset(&ereader->p->memory.savedata.data[0xD000], 0, 0x1000);
 		memcpy(&ereader->p->memory.savedata.data[0xD000], EREADER_CALIBRATION_TEMPLATE, sizeof(EREADER_CALIBRATION_TEMPLATE));
+		GBASavedataMarkDirty(&ereader->p->memory.savedata, 0xD000, 0x1000);
 	}
 	if (ereader->p->memory.savedata.data[0xE000] == 0xFF) {
 		memset(&ereader->p->memory.savedata.data[0xE000], 0, 0x1000);
 		memcpy(&ereader->p->memory.savedata.data[0xE000], EREADER_CALIBRATION_TEMPLATE, sizeof(EREADER_CALIBRATION_TEMPLATE));
+		GBASavedataMarkDirty(&ereader->p->memory.savedata, 0xE000, 0x1000);
 	}
 }
 
@@ -198,6 +201,10 @@ void GBACartEReaderDeinit(struct GBACartEReader* ereader) {
 		mappedMemoryFree(ereader->dots, EREADER_DOTCODE_SIZE);
 		ereader->dots = NULL;
 	}
+	if (ereader->pixels) {
+		mappedMemoryFree(ereader->pixels, EREADER_DOTCODE_PIXELS_SIZE);
+		ereader->pixels = NULL;
+	}
 	int i;
 	for (i = 0; i < EREADER_CARDS_MAX; ++i) {
 		if (!ereader->cards[i].data) {
@@ -207,6 +214,16 @@ void GBACartEReaderDeinit(struct GBACartEReader* ereader) {
 		ereader->cards[i].data = NULL;
 		ereader->cards[i].size = 0;
 	}
+	for (i = 0; i < EREADER_SCAN_CACHE_SIZE; ++i) {
+		struct EReaderScanImage* image = &ereader->scanCache[i];
+		if (!image->pixels) {
+			continue;
+		}
+		free(image->card.data);
+		free(image->pixels);
+		memset(image, 0, sizeof(*image));
+	}
+	ereader->nextScanCache = 0;
 }
 
 void GBACartEReaderWrite(struct GBACartEReader* ereader, uint32_t address, uint16_t value) {
@@ -363,11 +380,7 @@ static void _eReaderReedSolomon(const uint8_t* input, uint8_t* output) {
 	}
 }
 
-void GBACartEReaderScan(struct GBACartEReader* ereader, const void* data, size_t size) {
-	if (!ereader->dots) {
-		ereader->dots = anonymousMemoryMap(EREADER_DOTCODE_SIZE);
-	}
-	ereader->scanX = -24;
+static bool _eReaderGenerateDots(struct GBACartEReader* ereader, const void* data, size_t size) {
 	memset(ereader->dots, 0, EREADER_DOTCODE_SIZE);
 
 	uint8_t blockRS[44][0x10];
@@ -411,7 +424,7 @@ void GBACartEReaderScan(struct GBACartEReader* ereader, const void* data, size_t
 		blocks = 80;
 		break;
 	default:
-		return;
+		return false;
 	}
 
 	const uint8_t* cdata = data;
@@ -422,21 +435,16 @@ void GBACartEReaderScan(struct GBACartEReader* ereader, const void* data, size_t
 			const uint8_t* line = &cdata[(i + 2) * blocks];
 			uint8_t* origin = &ereader->dots[EREADER_DOTCODE_STRIDE * i + 200];
 			for (x = 0; x < blocks; ++x) {
-				uint8_t byte = line[x];
+				uint64_t byte = line[x];
 				if (x == 123) {
 					byte &= 0xE0;
 				}
-				origin[x * 8 + 0] = (byte >> 7) & 1;
-				origin[x * 8 + 1] = (byte >> 6) & 1;
-				origin[x * 8 + 2] = (byte >> 5) & 1;
-				origin[x * 8 + 3] = (byte >> 4) & 1;
-				origin[x * 8 + 4] = (byte >> 3) & 1;
-				origin[x * 8 + 5] = (byte >> 2) & 1;
-				origin[x * 8 + 6] = (byte >> 1) & 1;
-				origin[x * 8 + 7] = byte & 1;
+				// Spread the bits out to one per byte, most significant bit first
+				uint64_t spread = ((byte * 0x8040201008040201ULL) >> 7) & 0x0101010101010101ULL;
+				STORE_64LE(spread, x * 8, origin);
 			}
 		}
-		return;
+		return true;
 	}
 
 	for (i = 0; i < blocks + 1; ++i) {
@@ -564,6 +572,74 @@ void GBACartEReaderScan(struct GBACartEReader* ereader, const void* data, size_t
 			b += 26;
 		}
 	}
+	return true;
+}
+
+static void _eReaderPackDots(const uint8_t* dots, uint8_t* pixels) {
+	// Eight dots fill exactly three bytes of pixels
+	size_t i;
+	for (i = 0; i < EREADER_DOTCODE_SIZE / 8; ++i) {
+		uint64_t group;
+		LOAD_64LE(group, i * 8, dots);
+		uint32_t bits = (group * 0x0102040810204080ULL) >> 56;
+		bits = (bits | (bits << 8)) & 0x00F00F;
+		bits = (bits | (bits << 4)) & 0x0C30C3;
+		bits = (bits | (bits << 2)) & 0x249249;
+		bits |= (bits << 1) | (bits << 2);
+		pixels[i * 3 + 0] = bits;
+		pixels[i * 3 + 1] = bits >> 8;
+		pixels[i * 3 + 2] = bits >> 16;
+	}
+	memset(&pixels[EREADER_DOTCODE_SIZE * 3 / 8], 0, EREADER_DOTCODE_PIXELS_SIZE - EREADER_DOTCODE_SIZE * 3 / 8);
+}
+
+static struct EReaderScanImage* _eReaderFindScanImage(struct GBACartEReader* ereader, uint32_t hash, const void* data, size_t size) {
+	int i;
+	for (i = 0; i < EREADER_SCAN_CACHE_SIZE; ++i) {
+		struct EReaderScanImage* image = &ereader->scanCache[i];
+		if (image->pixels && image->hash == hash && image->card.size == size && memcmp(image->card.data, data, size) == 0) {
+			return image;
+		}
+	}
+	return NULL;
+}
+
+static void _eReaderStoreScanImage(struct GBACartEReader* ereader, uint32_t hash, const void* data, size_t size) {
+	struct EReaderScanImage* image = &ereader->scanCache[ereader->nextScanCache];
+	ereader->nextScanCache = (ereader->nextScanCache + 1) % EREADER_SCAN_CACHE_SIZE;
+	if (!image->pixels) {
+		image->pixels = malloc(EREADER_DOTCODE_PIXELS_SIZE);
+	}
+	free(image->card.data);
+	image->hash = hash;
+	image->card.data = malloc(size);
+	memcpy(image->card.data, data, size);
+	image->card.size = size;
+	memcpy(image->pixels, ereader->pixels, EREADER_DOTCODE_PIXELS_SIZE);
+}
+
+void GBACartEReaderScan(struct GBACartEReader* ereader, const void* data, size_t size) {
+	if (!ereader->dots) {
+		ereader->dots = anonymousMemoryMap(EREADER_DOTCODE_SIZE);
+	}
+	if (!ereader->pixels) {
+		ereader->pixels = anonymousMemoryMap(EREADER_DOTCODE_PIXELS_SIZE);
+	}
+	ereader->scanX = -24;
+
+	// Generating the image is the slow part, and the same cards tend to get scanned repeatedly
+	uint32_t hash = hash32(data, size, 0);
+	struct EReaderScanImage* image = _eReaderFindScanImage(ereader, hash, data, size);
+	if (image) {
+		memcpy(ereader->pixels, image->pixels, EREADER_DOTCODE_PIXELS_SIZE);
+		return;
+	}
+	if (!_eReaderGenerateDots(ereader, data, size)) {
+		memset(ereader->pixels, 0, EREADER_DOTCODE_PIXELS_SIZE);
+		return;
+	}
+	_eReaderPackDots(ereader->dots, ereader->pixels);
+	_eReaderStoreScanImage(ereader, hash, data, size);
 }
 
 void _eReaderReset(struct GBACartEReader* ereader) {
@@ -679,35 +755,32 @@ void _eReaderWriteControl1(struct GBACartEReader* ereader, uint8_t value) {
 
 void _eReaderReadData(struct GBACartEReader* ereader) {
 	memset(ereader->data, 0, EREADER_BLOCK_SIZE);
-	if (!ereader->dots) {
+	if (!ereader->pixels) {
 		_eReaderScanCard(ereader);
 	}
-	if (ereader->dots) {
+	if (ereader->pixels) {
 		int y = ereader->scanY - 10;
 		if (y < 0 || y >= 120) {
 			memset(ereader->data, 0, EREADER_BLOCK_SIZE);
 		} else {
 			int i;
-			uint8_t* origin = &ereader->dots[EREADER_DOTCODE_STRIDE * (y / 3) + 16];
+			int origin = (EREADER_DOTCODE_STRIDE * (y / 3) + 16) * 3;
 			for (i = 0; i < 20; ++i) {
 				uint16_t word = 0;
 				int x = ereader->scanX + i * 16;
-				word |= origin[(x +  0) / 3] << 8;
-				word |= origin[(x +  1) / 3] << 9;
-				word |= origin[(x +  2) / 3] << 10;
-				word |= origin[(x +  3) / 3] << 11;
-				word |= origin[(x +  4) / 3] << 12;
-				word |= origin[(x +  5) / 3] << 13;
-				word |= origin[(x +  6) / 3] << 14;
-				word |= origin[(x +  7) / 3] << 15;
-				word |= origin[(x +  8) / 3];
-				word |= origin[(x +  9) / 3] << 1;
-				word |= origin[(x + 10) / 3] << 2;
-				word |= origin[(x + 11) / 3] << 3;
-				word |= origin[(x + 12) / 3] << 4;
-				word |= origin[(x + 13) / 3] << 5;
-				word |= origin[(x + 14) / 3] << 6;
-				word |= origin[(x + 15) / 3] << 7;
+				if (x >= 0) {
+					uint32_t pixels;
+					LOAD_32LE(pixels, (origin + x) >> 3, ereader->pixels);
+					pixels >>= (origin + x) & 7;
+					word = ((pixels & 0xFF) << 8) | ((pixels >> 8) & 0xFF);
+				} else {
+					// Division truncates towards zero here, which shifts these dots over by a pixel
+					int k;
+					for (k = 0; k < 16; ++k) {
+						int pixel = origin + (x + k) / 3 * 3;
+						word |= ((ereader->pixels[pixel >> 3] >> (pixel & 7)) & 1) << ((k + 8) & 15);
+					}
+				}
 				STORE_16(word, (19 - i) << 1, ereader->data);
 			}
 		}
@@ -724,8 +797,8 @@ void _eReaderReadData(struct GBACartEReader* ereader) {
 
 
 void _eReaderScanCard(struct GBACartEReader* ereader) {
-	if (ereader->dots) {
-		memset(ereader->dots, 0, EREADER_DOTCODE_SIZE);
+	if (ereader->pixels) {
+		memset(ereader->pixels, 0, EREADER_DOTCODE_PIXELS_SIZE);
 	}
 	int i;
 	for (i = 0; i < EREADER_CARDS_MAX; ++i) {
@@ -55,6 +55,7 @@ void GBAUnlCartDetect(struct GBA* gba) {
 			gba->memory.unl.multi.rom = gba->romVf->map(gba->romVf, gba->memory.unl.multi.fullSize, MAP_READ);
 			gba->memory.rom = gba->memory.unl.multi.rom;
 			gba->memory.hw.gpioBase = NULL;
+			GBAMemoryUpdateFastRegions(gba);
 
 			gba->memory.unl.multi.settle.context = gba;
 			gba->memory.unl.multi.settle.callback = _multicartSettle;
@@ -72,6 +73,7 @@ void GBAUnlCartReset(struct GBA* gba) {
 		gba->memory.unl.multi.locked = false;
 		gba->memory.rom = gba->memory.unl.multi.rom;
 		gba->memory.romSize = GBA_SIZE_ROM0;
+		GBAMemoryUpdateFastRegions(gba);
 	}
 }
 
@@ -80,6 +82,7 @@ void GBAUnlCartUnload(struct GBA* gba) {
 		gba->romVf->unmap(gba->romVf, gba->memory.unl.multi.rom, gba->memory.unl.multi.size);
 		gba->memory.unl.multi.rom = NULL;
 		gba->memory.rom = NULL;
+		GBAMemoryUpdateFastRegions(gba);
 	}
 }
 
@@ -167,6 +170,7 @@ static void _multicartSettle(struct mTiming* timing, void* context, uint32_t cyc
 	}
 	gba->memory.rom = gba->memory.unl.multi.rom + offset;
 	gba->memory.romSize = size;
+	GBAMemoryUpdateFastRegions(gba);
 }
 
 void GBAUnlCartSerialize(const struct GBA* gba, struct GBASerializedState* state) {
@@ -243,6 +247,7 @@ void GBAUnlCartDeserialize(struct GBA* gba, const struct GBASerializedState* sta
 		} else {
 			gba->memory.romSize = size;
 			gba->memory.rom = unl->multi.rom + offset;
+			GBAMemoryUpdateFastRegions(gba);
 		}
 		LOAD_32(multiFlags, 0, &state->multicart.flags);
 		unl->multi.locked = GBASerializedMulticartFlagsGetLocked(multiFlags);
@@ -72,10 +72,44 @@ static struct mCheatSet* GBACheatSetCreate(struct mCheatDevice* device, const ch
 	return &set->d;
 }
 
+// Work RAM is allocated once per core and has no side effects beyond page stamps
+static bool GBACheatMapMemory(struct mCheatDevice* device, uint32_t address, struct mCheatMemoryMap* map) {
+	if (!device->p) {
+		return false;
+	}
+	struct GBA* gba = device->p->board;
+	struct GBAMemory* memory = &gba->memory;
+	switch (address >> BASE_OFFSET) {
+	case GBA_REGION_EWRAM:
+		if (!memory->wram) {
+			return false;
+		}
+		map->base = (uint8_t*) memory->wram;
+		map->size = GBA_SIZE_EWRAM;
+		map->offset = address & (GBA_SIZE_EWRAM - 1);
+		map->dirtyPages = &memory->dirtyPages[GBA_DIRTY_PAGES_EWRAM];
+		break;
+	case GBA_REGION_IWRAM:
+		if (!memory->iwram) {
+			return false;
+		}
+		map->base = (uint8_t*) memory->iwram;
+		map->size = GBA_SIZE_IWRAM;
+		map->offset = address & (GBA_SIZE_IWRAM - 1);
+		map->dirtyPages = &memory->dirtyPages[GBA_DIRTY_PAGES_IWRAM];
+		break;
+	default:
+		return false;
+	}
+	map->dirtyGeneration = &memory->dirtyGeneration;
+	return true;
+}
+
 struct mCheatDevice* GBACheatDeviceCreate(void) {
 	struct mCheatDevice* device = malloc(sizeof(*device));
 	mCheatDeviceCreate(device);
 	device->createSet = GBACheatSetCreate;
+	device->mapMemory = GBACheatMapMemory;
 	return device;
 }
 
@@ -5,16 +5,21 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/gba/core.h>
 
+#include <mgba/core/cache-set.h>
+#include <mgba/core/checksum-cache.h>
 #include <mgba/core/core.h>
 #include <mgba/core/log.h>
 #include <mgba/core/serialize.h>
+#include <mgba/internal/arm/block-cache.h>
 #include <mgba/internal/arm/debugger/debugger.h>
 #include <mgba/internal/arm/isa-inlines.h>
+#include <mgba/internal/arm/jit.h>
 #include <mgba/internal/debugger/symbols.h>
 #include <mgba/internal/gba/cheats.h>
 #include <mgba/internal/gba/gba.h>
 #include <mgba/internal/gba/io.h>
 #include <mgba/internal/gba/debugger/cli.h>
+#include <mgba/internal/gba/extra/audio-mixer.h>
 #include <mgba/internal/gba/overrides.h>
 #ifndef DISABLE_THREADING
 #include <mgba/feature/thread-proxy.h>
@@ -22,6 +27,7 @@
 #ifdef BUILD_GLES3
 #include <mgba/internal/gba/renderers/gl.h>
 #endif
+#include <mgba/internal/gba/renderers/parallel.h>
 #include <mgba/internal/gba/renderers/proxy.h>
 #include <mgba/internal/gba/renderers/video-software.h>
 #include <mgba/internal/gba/savedata.h>
@@ -161,6 +167,16 @@ static const struct mCoreMemoryBlock _GBAMemoryBlocksEEPROM512[] = {
 	{ GBA_REGION_SRAM_MIRROR, "eeprom", "EEPROM", "EEPROM (512B)", 0, GBA_SIZE_EEPROM, GBA_SIZE_EEPROM512, mCORE_MEMORY_RW },
 };
 
+static const struct mStateSection _GBAStateSections[] = {
+	{ mSTATE_SECTION_CPU, offsetof(struct GBASerializedState, cpu), sizeof(((struct GBASerializedState*) 0)->cpu) },
+	{ mSTATE_SECTION_IO, offsetof(struct GBASerializedState, io), GBA_SIZE_IO },
+	{ mSTATE_SECTION_PALETTE, offsetof(struct GBASerializedState, pram), GBA_SIZE_PALETTE_RAM },
+	{ mSTATE_SECTION_OAM, offsetof(struct GBASerializedState, oam), GBA_SIZE_OAM },
+	{ mSTATE_SECTION_VRAM, offsetof(struct GBASerializedState, vram), GBA_SIZE_VRAM },
+	{ mSTATE_SECTION_IWRAM, offsetof(struct GBASerializedState, iwram), GBA_SIZE_IWRAM },
+	{ mSTATE_SECTION_WRAM, offsetof(struct GBASerializedState, wram), GBA_SIZE_EWRAM },
+};
+
 static const struct mCoreScreenRegion _GBAScreenRegions[] = {
 	{ 0, "Screen", 0, 0, GBA_VIDEO_HORIZONTAL_PIXELS, GBA_VIDEO_VERTICAL_PIXELS }
 };
@@ -206,10 +222,14 @@ struct GBACore {
 	struct GBAVideoProxyRenderer vlProxy;
 	struct GBAVideoProxyRenderer proxyRenderer;
 	struct mVideoLogContext* logContext;
+	struct GBAAudioMixer* audioMixer;
 #endif
 	struct mCoreCallbacks logCallbacks;
 #ifndef DISABLE_THREADING
 	struct mVideoThreadProxy threadProxy;
+#ifndef MINIMAL_CORE
+	struct GBAVideoParallelRenderer parallelRenderer;
+#endif
 #endif
 	struct mCPUComponent* components[CPU_COMPONENT_MAX];
 	const struct Configuration* overrides;
@@ -220,6 +240,14 @@ struct GBACore {
 	struct mCoreMemoryBlock memoryBlocks[12];
 	size_t nMemoryBlocks;
 	int memoryBlockType;
+#ifdef ENABLE_VFS
+	struct Configuration idleLoopCache;
+	bool idleLoopCacheEnabled;
+	bool idleLoopCacheLoaded;
+	uint32_t knownIdleLoop;
+	char* romPath;
+	struct mChecksumCacheEntry knownChecksums;
+#endif
 };
 
 #define _MAX(A, B) ((A > B) ? (A) : (B))
@@ -246,6 +274,40 @@ static_assert(sizeof(((struct GBACore*) 0)->memoryBlocks) >=
 	"GBACore memoryBlocks sized too small");
 #undef _MAX
 
+#ifdef ENABLE_VFS
+static void _GBACoreIdleLoopCachePath(char* path) {
+	mCoreConfigDirectory(path, PATH_MAX);
+	strncat(path, PATH_SEP GBA_IDLE_LOOP_CACHE_FILE, PATH_MAX - strlen(path));
+}
+
+static void _GBACoreLoadIdleLoopCache(struct GBACore* gbacore) {
+	if (gbacore->idleLoopCacheLoaded) {
+		return;
+	}
+	char path[PATH_MAX + 1];
+	_GBACoreIdleLoopCachePath(path);
+	ConfigurationRead(&gbacore->idleLoopCache, path);
+	gbacore->idleLoopCacheLoaded = true;
+}
+
+static void _GBACoreUpdateIdleLoopCache(struct GBACore* gbacore) {
+	struct GBA* gba = gbacore->d.board;
+	gbacore->knownIdleLoop = gba->idleLoop;
+	// Only remember loops that detection has confirmed, not ones it has since given up on
+	if (!gbacore->idleLoopCacheEnabled || gba->idleLoop == GBA_IDLE_LOOP_NONE || gba->idleOptimization != IDLE_LOOP_REMOVE) {
+		return;
+	}
+	_GBACoreLoadIdleLoopCache(gbacore);
+	GBAIdleLoopCacheSave(&gbacore->idleLoopCache, gba->romCrc32, gba->idleLoop);
+
+	char path[PATH_MAX + 1];
+	_GBACoreIdleLoopCachePath(path);
+	if (!ConfigurationWrite(&gbacore->idleLoopCache, path)) {
+		mLOG(GBA, WARN, "Could not write idle loop cache to %s", path);
+	}
+}
+#endif
+
 static bool _GBACoreInit(struct mCore* core) {
 	struct GBACore* gbacore = (struct GBACore*) core;
 
@@ -268,6 +330,15 @@ static bool _GBACoreInit(struct mCore* core) {
 	gbacore->cheatDevice = NULL;
 #ifndef MINIMAL_CORE
 	gbacore->logContext = NULL;
+	gbacore->audioMixer = NULL;
+#endif
+#ifdef ENABLE_VFS
+	ConfigurationInit(&gbacore->idleLoopCache);
+	gbacore->idleLoopCacheEnabled = false;
+	gbacore->idleLoopCacheLoaded = false;
+	gbacore->knownIdleLoop = GBA_IDLE_LOOP_NONE;
+	gbacore->romPath = NULL;
+	memset(&gbacore->knownChecksums, 0, sizeof(gbacore->knownChecksums));
 #endif
 
 	GBACreate(gba);
@@ -323,6 +394,13 @@ static void _GBACoreDeinit(struct mCore* core) {
 	if (gbacore->cheatDevice) {
 		mCheatDeviceDestroy(gbacore->cheatDevice);
 	}
+#ifndef MINIMAL_CORE
+	free(gbacore->audioMixer);
+#endif
+#ifdef ENABLE_VFS
+	ConfigurationDeinit(&gbacore->idleLoopCache);
+	free(gbacore->romPath);
+#endif
 	mCoreConfigFreeOpts(&core->opts);
 	free(core);
 }
@@ -381,16 +459,35 @@ static void _GBACoreLoadConfig(struct mCore* core, const struct mCoreConfig* con
 	}
 
 	mCoreConfigGetBoolValue(config, "allowOpposingDirections", &gba->allowOpposingDirections);
+	mCoreConfigGetBoolValue(config, "skipAudio", &gba->audio.skipMixing);
+#ifdef ENABLE_VFS
+	mCoreConfigGetBoolValue(config, "idleLoopCache", &((struct GBACore*) core)->idleLoopCacheEnabled);
+#endif
+
+	bool blockCache;
+	if (mCoreConfigGetBoolValue(config, "blockCache", &blockCache)) {
+		ARMBlockCacheEnable(core->cpu, blockCache);
+	}
+#ifdef ENABLE_JIT
+	bool jit;
+	if (mCoreConfigGetBoolValue(config, "jit", &jit)) {
+		ARMJITEnable(core->cpu, jit);
+	}
+#endif
 
 	mCoreConfigCopyValue(&core->config, config, "allowOpposingDirections");
+	mCoreConfigCopyValue(&core->config, config, "skipAudio");
 	mCoreConfigCopyValue(&core->config, config, "gba.bios");
 	mCoreConfigCopyValue(&core->config, config, "gba.forceGbp");
+	mCoreConfigCopyValue(&core->config, config, "gba.audioHle");
 	mCoreConfigCopyValue(&core->config, config, "vbaBugCompat");
 
 #ifndef DISABLE_THREADING
 	mCoreConfigCopyValue(&core->config, config, "threadedVideo");
+	mCoreConfigCopyValue(&core->config, config, "threadedVideo.workers");
 #endif
 	mCoreConfigCopyValue(&core->config, config, "hwaccelVideo");
+	mCoreConfigCopyValue(&core->config, config, "hwaccelVideo.asyncReadback");
 	mCoreConfigCopyValue(&core->config, config, "videoScale");
 }
 
@@ -440,6 +537,29 @@ static void _GBACoreReloadConfigOption(struct mCore* core, const char* option, c
 		mCoreConfigGetBoolValue(config, "allowOpposingDirections", &gba->allowOpposingDirections);
 		return;
 	}
+	if (strcmp("skipAudio", option) == 0) {
+		if (config != &core->config) {
+			mCoreConfigCopyValue(&core->config, config, "skipAudio");
+		}
+		mCoreConfigGetBoolValue(config, "skipAudio", &gba->audio.skipMixing);
+		return;
+	}
+	if (strcmp("blockCache", option) == 0) {
+		bool blockCache;
+		if (mCoreConfigGetBoolValue(config, "blockCache", &blockCache)) {
+			ARMBlockCacheEnable(core->cpu, blockCache);
+		}
+		return;
+	}
+#ifdef ENABLE_JIT
+	if (strcmp("jit", option) == 0) {
+		bool jit;
+		if (mCoreConfigGetBoolValue(config, "jit", &jit)) {
+			ARMJITEnable(core->cpu, jit);
+		}
+		return;
+	}
+#endif
 
 	struct GBACore* gbacore = (struct GBACore*) core;
 #ifdef BUILD_GLES3
@@ -455,6 +575,15 @@ static void _GBACoreReloadConfigOption(struct mCore* core, const char* option, c
 		}
 		return;
 	}
+	if (strcmp("hwaccelVideo.asyncReadback", option) == 0) {
+		if (config != &core->config) {
+			mCoreConfigCopyValue(&core->config, config, "hwaccelVideo.asyncReadback");
+		}
+		bool value = false;
+		mCoreConfigGetBoolValue(&core->config, "hwaccelVideo.asyncReadback", &value);
+		gbacore->glRenderer.asyncReadback = value;
+		return;
+	}
 #endif
 	if (strcmp("hwaccelVideo", option) == 0) {
 		struct GBAVideoRenderer* renderer = NULL;
@@ -465,6 +594,9 @@ static void _GBACoreReloadConfigOption(struct mCore* core, const char* option, c
 		bool value;
 		if (gbacore->glRenderer.outputTex != (unsigned) -1 && mCoreConfigGetBoolValue(&core->config, "hwaccelVideo", &value) && value) {
 			mCoreConfigGetIntValue(&core->config, "videoScale", &gbacore->glRenderer.scale);
+			value = false;
+			mCoreConfigGetBoolValue(&core->config, "hwaccelVideo.asyncReadback", &value);
+			gbacore->glRenderer.asyncReadback = value;
 			renderer = &gbacore->glRenderer.d;
 		} else {
 			gbacore->glRenderer.scale = 1;
@@ -553,11 +685,35 @@ static void _GBACoreSetVideoGLTex(struct mCore* core, unsigned texid) {
 #endif
 }
 
+static void _GBACoreSetRenderSkip(struct mCore* core, bool skip) {
+	struct GBA* gba = core->board;
+	gba->video.renderSkip = skip;
+}
+
 static void _GBACoreGetPixels(struct mCore* core, const void** buffer, size_t* stride) {
 	struct GBA* gba = core->board;
 	gba->video.renderer->getPixels(gba->video.renderer, stride, buffer);
 }
 
+static unsigned _GBACoreGetPixelsLatency(struct mCore* core) {
+#ifdef BUILD_GLES3
+	struct GBACore* gbacore = (struct GBACore*) core;
+	struct GBA* gba = core->board;
+	struct GBAVideoRenderer* renderer = gba->video.renderer;
+#ifndef MINIMAL_CORE
+	if (renderer == &gbacore->proxyRenderer.d) {
+		renderer = gbacore->proxyRenderer.backend;
+	}
+#endif
+	if (renderer == &gbacore->glRenderer.d) {
+		return GBAVideoGLRendererReadbackLatency(&gbacore->glRenderer);
+	}
+#else
+	UNUSED(core);
+#endif
+	return 0;
+}
+
 static void _GBACorePutPixels(struct mCore* core, const void* buffer, size_t stride) {
 	struct GBA* gba = core->board;
 	gba->video.renderer->putPixels(gba->video.renderer, stride, buffer);
@@ -583,6 +739,15 @@ static size_t _GBACoreGetAudioBufferSize(struct mCore* core) {
 	return gba->audio.samples;
 }
 
+static void _GBACoreSetAudioSkip(struct mCore* core, bool skip) {
+	struct GBA* gba = core->board;
+	gba->audio.skipMixing = skip;
+	if (!skip) {
+		// Fall back to whatever the configuration asks for
+		mCoreConfigGetBoolValue(&core->config, "skipAudio", &gba->audio.skipMixing);
+	}
+}
+
 static void _GBACoreAddCoreCallbacks(struct mCore* core, struct mCoreCallbacks* coreCallbacks) {
 	struct GBA* gba = core->board;
 	*mCoreCallbacksListAppend(&gba->coreCallbacks) = *coreCallbacks;
@@ -626,7 +791,27 @@ static bool _GBACoreLoadROM(struct mCore* core, struct VFile* vf) {
 		return GBALoadMB(core->board, vf);
 	}
 	gbacore->memoryBlockType = -2;
+#ifdef ENABLE_VFS
+	if (!gbacore->romPath) {
+		return GBALoadROM(core->board, vf);
+	}
+	struct mChecksumCacheEntry* known = &gbacore->knownChecksums;
+	if (known->known & (1 << mCHECKSUM_CRC32)) {
+		return GBALoadROMKnownCrc32(core->board, vf, known->crc32);
+	}
+	if (!GBALoadROM(core->board, vf)) {
+		return false;
+	}
+	struct GBA* gba = core->board;
+	if (gba->pristineRomSize == (size_t) vf->size(vf)) {
+		known->crc32 = gba->romCrc32;
+		known->known |= 1 << mCHECKSUM_CRC32;
+		mChecksumCacheStore(gbacore->romPath, known);
+	}
+	return true;
+#else
 	return GBALoadROM(core->board, vf);
+#endif
 }
 
 static bool _GBACoreLoadBIOS(struct mCore* core, struct VFile* vf, int type) {
@@ -669,6 +854,11 @@ static void _GBACoreUnloadROM(struct mCore* core) {
 		mCheatDeviceDestroy(gbacore->cheatDevice);
 		gbacore->cheatDevice = NULL;
 	}
+#ifdef ENABLE_VFS
+	free(gbacore->romPath);
+	gbacore->romPath = NULL;
+	memset(&gbacore->knownChecksums, 0, sizeof(gbacore->knownChecksums));
+#endif
 	GBAUnloadROM(core->board);
 }
 
@@ -683,8 +873,47 @@ static size_t _GBACoreROMSize(const struct mCore* core) {
 	return gba->pristineRomSize;
 }
 
+#ifdef ENABLE_VFS
+static void _GBACoreSetROMPath(struct mCore* core, const char* path) {
+	struct GBACore* gbacore = (struct GBACore*) core;
+	free(gbacore->romPath);
+	gbacore->romPath = path ? strdup(path) : NULL;
+	if (path) {
+		mChecksumCacheLookup(path, &gbacore->knownChecksums);
+	} else {
+		memset(&gbacore->knownChecksums, 0, sizeof(gbacore->knownChecksums));
+	}
+}
+
+static bool _GBACoreCachedChecksum(const struct GBACore* gbacore, void* data, enum mCoreChecksumType type) {
+	const struct mChecksumCacheEntry* known = &gbacore->knownChecksums;
+	struct mChecksumCacheEntry entry;
+	if (!(known->known & (1 << type))) {
+		// It may have been hashed in the background since the ROM was loaded
+		if (!mChecksumCacheLookup(gbacore->romPath, &entry) || !(entry.known & (1 << type))) {
+			return false;
+		}
+		known = &entry;
+	}
+	if (type == mCHECKSUM_MD5) {
+		memcpy(data, known->md5, sizeof(known->md5));
+	} else {
+		memcpy(data, known->sha1, sizeof(known->sha1));
+	}
+	return true;
+}
+#endif
+
 static void _GBACoreChecksum(const struct mCore* core, void* data, enum mCoreChecksumType type) {
 	const struct GBA* gba = (const struct GBA*) core->board;
+#ifdef ENABLE_VFS
+	// The CRC32 is worked out at load time, but the others mean reading the whole file
+	const struct GBACore* gbacore = (const struct GBACore*) core;
+	bool cacheable = gbacore->romPath && (gba->romVf || gba->mbVf) && type != mCHECKSUM_CRC32;
+	if (cacheable && _GBACoreCachedChecksum(gbacore, data, type)) {
+		return;
+	}
+#endif
 	switch (type) {
 	case mCHECKSUM_CRC32:
 		memcpy(data, &gba->romCrc32, sizeof(gba->romCrc32));
@@ -716,6 +945,17 @@ static void _GBACoreChecksum(const struct mCore* core, void* data, enum mCoreChe
 		}
 		break;
 	}
+#ifdef ENABLE_VFS
+	if (cacheable) {
+		struct mChecksumCacheEntry entry = { .known = 1 << type };
+		if (type == mCHECKSUM_MD5) {
+			memcpy(entry.md5, data, sizeof(entry.md5));
+		} else {
+			memcpy(entry.sha1, data, sizeof(entry.sha1));
+		}
+		mChecksumCacheStore(gbacore->romPath, &entry);
+	}
+#endif
 	return;
 }
 
@@ -736,6 +976,9 @@ static void _GBACoreReset(struct mCore* core) {
 #ifdef BUILD_GLES3
 		if (gbacore->glRenderer.outputTex != (unsigned) -1 && mCoreConfigGetBoolValue(&core->config, "hwaccelVideo", &value) && value) {
 			mCoreConfigGetIntValue(&core->config, "videoScale", &gbacore->glRenderer.scale);
+			value = false;
+			mCoreConfigGetBoolValue(&core->config, "hwaccelVideo.asyncReadback", &value);
+			gbacore->glRenderer.asyncReadback = value;
 			renderer = &gbacore->glRenderer.d;
 		} else {
 			gbacore->glRenderer.scale = 1;
@@ -743,7 +986,22 @@ static void _GBACoreReset(struct mCore* core) {
 #endif
 #ifndef DISABLE_THREADING
 		if (mCoreConfigGetBoolValue(&core->config, "threadedVideo", &value) && value) {
+#ifndef MINIMAL_CORE
+			int workers = 0;
+			mCoreConfigGetIntValue(&core->config, "threadedVideo.workers", &workers);
+			if (workers > 1 && renderer == &gbacore->renderer.d && (!core->videoLogger || core->videoLogger == &gbacore->threadProxy.d)) {
+				core->videoLogger = NULL;
+				if (gba->video.renderer == &gbacore->parallelRenderer.d) {
+					// Stop the old workers before reconfiguring
+					GBAVideoAssociateRenderer(&gba->video, &gbacore->dummyRenderer);
+				}
+				GBAVideoParallelRendererCreate(&gbacore->parallelRenderer, &gbacore->renderer, workers);
+				mCoreConfigGetThreadPolicy(&core->config, &gbacore->parallelRenderer.threadPolicy);
+				renderer = &gbacore->parallelRenderer.d;
+			} else
+#endif
 			if (!core->videoLogger) {
+				mCoreConfigGetThreadPolicy(&core->config, &gbacore->threadProxy.threadPolicy);
 				core->videoLogger = &gbacore->threadProxy.d;
 			}
 		}
@@ -763,6 +1021,22 @@ static void _GBACoreReset(struct mCore* core) {
 		}
 	}
 
+#ifndef MINIMAL_CORE
+	bool audioHle = false;
+	mCoreConfigGetBoolValue(&core->config, "gba.audioHle", &audioHle);
+	if (audioHle && !gbacore->audioMixer) {
+		gbacore->audioMixer = malloc(sizeof(*gbacore->audioMixer));
+		GBAAudioMixerCreate(gbacore->audioMixer);
+		((struct ARMCore*) core->cpu)->components[GBA_COMPONENT_AUDIO_MIXER] = &gbacore->audioMixer->d;
+		ARMHotplugAttach(core->cpu, GBA_COMPONENT_AUDIO_MIXER);
+	} else if (!audioHle && gbacore->audioMixer) {
+		ARMHotplugDetach(core->cpu, GBA_COMPONENT_AUDIO_MIXER);
+		((struct ARMCore*) core->cpu)->components[GBA_COMPONENT_AUDIO_MIXER] = NULL;
+		free(gbacore->audioMixer);
+		gbacore->audioMixer = NULL;
+	}
+#endif
+
 	bool forceGbp = false;
 	bool vbaBugCompat = true;
 	mCoreConfigGetBoolValue(&core->config, "gba.forceGbp", &forceGbp);
@@ -775,6 +1049,19 @@ static void _GBACoreReset(struct mCore* core) {
 	} else {
 		GBAOverrideApplyDefaults(gba, gbacore->overrides);
 	}
+#ifdef ENABLE_VFS
+	if (gbacore->idleLoopCacheEnabled && gba->memory.rom && gba->idleLoop == GBA_IDLE_LOOP_NONE) {
+		uint32_t idleLoop;
+		_GBACoreLoadIdleLoopCache(gbacore);
+		if (GBAIdleLoopCacheFind(&gbacore->idleLoopCache, gba->romCrc32, &idleLoop)) {
+			gba->idleLoop = idleLoop;
+			if (gba->idleOptimization == IDLE_LOOP_DETECT) {
+				gba->idleOptimization = IDLE_LOOP_REMOVE;
+			}
+		}
+	}
+	gbacore->knownIdleLoop = gba->idleLoop;
+#endif
 	if (forceGbp) {
 		gba->memory.hw.devices |= HW_GB_PLAYER_DETECTION;
 	}
@@ -850,10 +1137,21 @@ static void _GBACoreRunFrame(struct mCore* core) {
 	while (gba->video.frameCounter == frameCounter && mTimingCurrentTime(&gba->timing) - startCycle < VIDEO_TOTAL_LENGTH + VIDEO_HORIZONTAL_LENGTH) {
 		ARMRunLoop(core->cpu);
 	}
+#ifdef ENABLE_VFS
+	if (UNLIKELY(((struct GBACore*) core)->knownIdleLoop != gba->idleLoop)) {
+		_GBACoreUpdateIdleLoopCache((struct GBACore*) core);
+	}
+#endif
 }
 
 static void _GBACoreRunLoop(struct mCore* core) {
 	ARMRunLoop(core->cpu);
+#ifdef ENABLE_VFS
+	struct GBA* gba = core->board;
+	if (UNLIKELY(((struct GBACore*) core)->knownIdleLoop != gba->idleLoop)) {
+		_GBACoreUpdateIdleLoopCache((struct GBACore*) core);
+	}
+#endif
 }
 
 static void _GBACoreStep(struct mCore* core) {
@@ -874,6 +1172,48 @@ static bool _GBACoreSaveState(struct mCore* core, void* state) {
 	return true;
 }
 
+static uint32_t _GBACoreLoadStateIncremental(struct mCore* core, const void* state, uint32_t since) {
+	struct GBA* gba = core->board;
+	if (!GBADeserializeIncremental(gba, state, since)) {
+		return 0;
+	}
+	return GBAMemoryCheckpoint(&gba->memory);
+}
+
+static uint32_t _GBACoreSaveStateIncremental(struct mCore* core, void* state, uint32_t since, struct mStateRangeList* written) {
+	struct GBA* gba = core->board;
+	GBASerializeIncremental(gba, state, since);
+	if (written) {
+		mStateRangeListAdd(written, 0, offsetof(struct GBASerializedState, vram));
+		mStateRangeListAddDirtyPages(written, offsetof(struct GBASerializedState, vram), gba->memory.dirtyPages, GBA_DIRTY_PAGES_MAX, since);
+	}
+	return GBAMemoryCheckpoint(&gba->memory);
+}
+
+static uint32_t _GBACoreDirtyState(struct mCore* core, uint32_t since, uint32_t* checkpoint) {
+	struct GBA* gba = core->board;
+	struct GBAMemory* memory = &gba->memory;
+	uint32_t dirty = 0;
+	if (memory->ioDirty > since) {
+		dirty |= mCORE_DIRTY_IO;
+	}
+	if (memory->paletteDirty > since) {
+		dirty |= mCORE_DIRTY_PALETTE;
+	}
+	if (memory->oamDirty > since) {
+		dirty |= mCORE_DIRTY_OAM;
+	}
+	size_t i;
+	for (i = GBA_DIRTY_PAGES_VRAM; i < GBA_DIRTY_PAGES_IWRAM; ++i) {
+		if (memory->dirtyPages[i] > since) {
+			dirty |= mCORE_DIRTY_VRAM;
+			break;
+		}
+	}
+	*checkpoint = GBAMemoryCheckpoint(memory);
+	return dirty;
+}
+
 static bool _GBACoreLoadExtraState(struct mCore* core, const struct mStateExtdata* extdata) {
 	struct GBA* gba = core->board;
 	struct mStateExtdataItem item;
@@ -951,6 +1291,33 @@ static bool _GBACoreSaveExtraState(struct mCore* core, struct mStateExtdata* ext
 	return true;
 }
 
+static bool _GBACoreFork(struct mCore* core, struct mCore* target) {
+	struct GBACore* gbacore = (struct GBACore*) core;
+	struct GBACore* targetcore = (struct GBACore*) target;
+	struct GBA* gba = core->board;
+	struct GBA* clone = target->board;
+	if (!GBACloneROM(clone, gba)) {
+		return false;
+	}
+	GBACloneBIOS(clone, gba);
+
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	if (!vf) {
+		return false;
+	}
+	GBASavedataClone(&gba->memory.savedata, vf);
+	GBALoadSave(clone, vf);
+
+	targetcore->hasOverride = gbacore->hasOverride;
+	targetcore->override = gbacore->override;
+	target->reset(target);
+
+	// Idle loops found at runtime aren't part of the savestate
+	clone->idleLoop = gba->idleLoop;
+	clone->idleOptimization = gba->idleOptimization;
+	return true;
+}
+
 static void _GBACoreSetKeys(struct mCore* core, uint32_t keys) {
 	struct GBA* gba = core->board;
 	gba->keysActive = keys;
@@ -1094,6 +1461,12 @@ static void _GBACoreRawWrite32(struct mCore* core, uint32_t address, int segment
 	GBAPatch32(cpu, address, value, NULL);
 }
 
+static size_t _GBACoreListStateSections(const struct mCore* core, const struct mStateSection** sections) {
+	UNUSED(core);
+	*sections = _GBAStateSections;
+	return sizeof(_GBAStateSections) / sizeof(*_GBAStateSections);
+}
+
 size_t _GBACoreListMemoryBlocks(const struct mCore* core, const struct mCoreMemoryBlock** blocks) {
 	const struct GBA* gba = core->board;
 	struct GBACore* gbacore = (struct GBACore*) core;
@@ -1153,15 +1526,19 @@ void* _GBACoreGetMemoryBlock(struct mCore* core, size_t id, size_t* sizeOut) {
 		return gba->memory.bios;
 	case GBA_REGION_EWRAM:
 		*sizeOut = GBA_SIZE_EWRAM;
+		// Writes through the returned pointer bypass the dirty page tracking
+		GBAMemoryMarkDirty(&gba->memory);
 		return gba->memory.wram;
 	case GBA_REGION_IWRAM:
 		*sizeOut = GBA_SIZE_IWRAM;
+		GBAMemoryMarkDirty(&gba->memory);
 		return gba->memory.iwram;
 	case GBA_REGION_PALETTE_RAM:
 		*sizeOut = GBA_SIZE_PALETTE_RAM;
 		return gba->video.palette;
 	case GBA_REGION_VRAM:
 		*sizeOut = GBA_SIZE_VRAM;
+		GBAMemoryMarkDirty(&gba->memory);
 		return gba->video.vram;
 	case GBA_REGION_OAM:
 		*sizeOut = GBA_SIZE_OAM;
@@ -1183,6 +1560,79 @@ void* _GBACoreGetMemoryBlock(struct mCore* core, size_t id, size_t* sizeOut) {
 	}
 }
 
+static void _GBACoreListMemoryUsage(const struct mCore* core, struct mCoreMemoryUsageList* list) {
+	const struct GBACore* gbacore = (const struct GBACore*) core;
+	const struct GBA* gba = core->board;
+	const struct ARMCore* cpu = core->cpu;
+
+	mCoreMemoryUsageAdd(list, "core", NULL, sizeof(*gbacore), mCORE_MEMORY_ANONYMOUS);
+	mCoreMemoryUsageAdd(list, "board", gba, sizeof(*gba), mCORE_MEMORY_ANONYMOUS);
+	mCoreMemoryUsageAdd(list, "cpu", cpu, sizeof(*cpu), mCORE_MEMORY_ANONYMOUS);
+	mCoreMemoryUsageAdd(list, "ram", gba->memory.arena, GBA_SIZE_ARENA, mCORE_MEMORY_ANONYMOUS);
+	if (gba->memory.rom) {
+		enum mCoreMemoryBacking backing = mCORE_MEMORY_ANONYMOUS;
+		if (gba->romShared) {
+			backing = mCORE_MEMORY_SHARED;
+		} else if (gba->isPristine && gba->romVf) {
+			backing = mCORE_MEMORY_FILE;
+		}
+		mCoreMemoryUsageAdd(list, "rom", gba->memory.rom, gba->memory.romSize, backing);
+	}
+	if (gba->biosVf) {
+		mCoreMemoryUsageAdd(list, "bios", gba->memory.bios, GBA_SIZE_BIOS, mCORE_MEMORY_FILE);
+	}
+	if (gba->memory.savedata.data) {
+		const struct GBASavedata* savedata = &gba->memory.savedata;
+		enum mCoreMemoryBacking backing = savedata->vf && savedata->vf == savedata->realVf ? mCORE_MEMORY_FILE : mCORE_MEMORY_ANONYMOUS;
+		mCoreMemoryUsageAdd(list, "savedata", savedata->data, GBASavedataSize(savedata), backing);
+	}
+	if (gba->memory.agbPrintBuffer) {
+		mCoreMemoryUsageAdd(list, "agb-print", gba->memory.agbPrintBuffer, GBA_SIZE_AGB_PRINT, mCORE_MEMORY_ANONYMOUS);
+	}
+	if (gba->memory.agbPrintBufferBackup) {
+		mCoreMemoryUsageAdd(list, "agb-print-backup", gba->memory.agbPrintBufferBackup, GBA_SIZE_AGB_PRINT, mCORE_MEMORY_ANONYMOUS);
+	}
+	if (gba->memory.ereader.dots) {
+		mCoreMemoryUsageAdd(list, "e-reader", gba->memory.ereader.dots, EREADER_DOTCODE_SIZE, mCORE_MEMORY_ANONYMOUS);
+	}
+	if (gba->memory.ereader.pixels) {
+		mCoreMemoryUsageAdd(list, "e-reader-scan", gba->memory.ereader.pixels, EREADER_DOTCODE_PIXELS_SIZE, mCORE_MEMORY_ANONYMOUS);
+	}
+	if (cpu->blockCache) {
+		mCoreMemoryUsageAdd(list, "block-cache", cpu->blockCache, sizeof(*cpu->blockCache), mCORE_MEMORY_ANONYMOUS);
+#ifdef ENABLE_JIT
+		if (cpu->blockCache->jit) {
+			mCoreMemoryUsageAdd(list, "jit", cpu->blockCache->jit->arena, ARM_JIT_ARENA_SIZE, mCORE_MEMORY_ANONYMOUS);
+		}
+#endif
+	}
+
+	if (gba->video.renderer->cache) {
+		mCoreMemoryUsageAdd(list, "renderer-cache", NULL, mCacheSetMemoryUsage(gba->video.renderer->cache), mCORE_MEMORY_ANONYMOUS);
+	}
+#ifndef DISABLE_THREADING
+	if (core->videoLogger == &gbacore->threadProxy.d && gbacore->threadProxy.dirtyQueue.data) {
+		mCoreMemoryUsageAdd(list, "renderer-queue", NULL, RingFIFOCapacity(&gbacore->threadProxy.dirtyQueue), mCORE_MEMORY_ANONYMOUS);
+	}
+#ifndef MINIMAL_CORE
+	mCoreMemoryUsageAdd(list, "renderer-workers", NULL, GBAVideoParallelRendererMemoryUsage(&gbacore->parallelRenderer), mCORE_MEMORY_ANONYMOUS);
+#endif
+#endif
+
+	if (gbacore->cheatDevice) {
+		mCoreMemoryUsageAdd(list, "cheats", NULL, mCheatDeviceMemoryUsage(gbacore->cheatDevice), mCORE_MEMORY_ANONYMOUS);
+	}
+#ifdef ENABLE_DEBUGGERS
+	if (gbacore->debuggerPlatform) {
+		const struct ARMDebugger* debugger = (const struct ARMDebugger*) gbacore->debuggerPlatform;
+		size_t size = sizeof(*debugger);
+		size += (debugger->breakpoints.capacity + debugger->swBreakpoints.capacity) * sizeof(struct ARMDebugBreakpoint);
+		size += debugger->watchpoints.capacity * sizeof(struct mWatchpoint);
+		mCoreMemoryUsageAdd(list, "debugger", NULL, size, mCORE_MEMORY_ANONYMOUS);
+	}
+#endif
+}
+
 static size_t _GBACoreListRegisters(const struct mCore* core, const struct mCoreRegisterInfo** list) {
 	UNUSED(core);
 	*list = _GBARegisters;
@@ -1200,6 +1650,7 @@ static bool _GBACoreReadRegister(const struct mCore* core, const char* name, voi
 	case 'c':
 	case 'C':
 		if (strcmp(name, "cpsr") == 0 || strcmp(name, "CPSR") == 0) {
+			_ARMMaterializeFlags(cpu);
 			*value = cpu->cpsr.packed;
 			_ARMReadCPSR(cpu);
 			return true;
@@ -1259,6 +1710,7 @@ static bool _GBACoreWriteRegister(struct mCore* core, const char* name, const vo
 	case 'c':
 	case 'C':
 		if (strcmp(name, "cpsr") == 0) {
+			cpu->lazyFlags = ARM_LAZY_NONE;
 			cpu->cpsr.packed = value & 0xF00000FF;
 			_ARMReadCPSR(cpu);
 			return true;
@@ -1632,12 +2084,15 @@ struct mCore* GBACoreCreate(void) {
 	core->screenRegions = _GBACoreScreenRegions;
 	core->setVideoBuffer = _GBACoreSetVideoBuffer;
 	core->setVideoGLTex = _GBACoreSetVideoGLTex;
+	core->setRenderSkip = _GBACoreSetRenderSkip;
 	core->getPixels = _GBACoreGetPixels;
+	core->getPixelsLatency = _GBACoreGetPixelsLatency;
 	core->putPixels = _GBACorePutPixels;
 	core->audioSampleRate = _GBACoreAudioSampleRate;
 	core->getAudioBuffer = _GBACoreGetAudioBuffer;
 	core->setAudioBufferSize = _GBACoreSetAudioBufferSize;
 	core->getAudioBufferSize = _GBACoreGetAudioBufferSize;
+	core->setAudioSkip = _GBACoreSetAudioSkip;
 	core->addCoreCallbacks = _GBACoreAddCoreCallbacks;
 	core->clearCoreCallbacks = _GBACoreClearCoreCallbacks;
 	core->setAVStream = _GBACoreSetAVStream;
@@ -1650,6 +2105,11 @@ struct mCore* GBACoreCreate(void) {
 	core->unloadROM = _GBACoreUnloadROM;
 	core->romSize = _GBACoreROMSize;
 	core->checksum = _GBACoreChecksum;
+#ifdef ENABLE_VFS
+	core->setROMPath = _GBACoreSetROMPath;
+#else
+	core->setROMPath = NULL;
+#endif
 	core->reset = _GBACoreReset;
 	core->runFrame = _GBACoreRunFrame;
 	core->runLoop = _GBACoreRunLoop;
@@ -1657,8 +2117,12 @@ struct mCore* GBACoreCreate(void) {
 	core->stateSize = _GBACoreStateSize;
 	core->loadState = _GBACoreLoadState;
 	core->saveState = _GBACoreSaveState;
+	core->loadStateIncremental = _GBACoreLoadStateIncremental;
+	core->saveStateIncremental = _GBACoreSaveStateIncremental;
+	core->dirtyState = _GBACoreDirtyState;
 	core->loadExtraState = _GBACoreLoadExtraState;
 	core->saveExtraState = _GBACoreSaveExtraState;
+	core->fork = _GBACoreFork;
 	core->setKeys = _GBACoreSetKeys;
 	core->addKeys = _GBACoreAddKeys;
 	core->clearKeys = _GBACoreClearKeys;
@@ -1682,7 +2146,9 @@ struct mCore* GBACoreCreate(void) {
 	core->rawWrite16 = _GBACoreRawWrite16;
 	core->rawWrite32 = _GBACoreRawWrite32;
 	core->listMemoryBlocks = _GBACoreListMemoryBlocks;
+	core->listStateSections = _GBACoreListStateSections;
 	core->getMemoryBlock = _GBACoreGetMemoryBlock;
+	core->listMemoryUsage = _GBACoreListMemoryUsage;
 	core->listRegisters = _GBACoreListRegisters;
 	core->readRegister = _GBACoreReadRegister;
 	core->writeRegister = _GBACoreWriteRegister;
@@ -1783,7 +2249,7 @@ static bool _GBAVLPLoadROM(struct mCore* core, struct VFile* vf) {
 static bool _GBAVLPLoadState(struct mCore* core, const void* state) {
 	struct GBA* gba = (struct GBA*) core->board;
 
-	gba->timing.root = NULL;
+	mTimingDescheduleAll(&gba->timing);
 	gba->cpu->gprs[ARM_PC] = GBA_BASE_EWRAM;
 	gba->cpu->memory.setActiveRegion(gba->cpu, gba->cpu->gprs[ARM_PC]);
 
@@ -1791,7 +2257,8 @@ static bool _GBAVLPLoadState(struct mCore* core, const void* state) {
 	GBAHalt(gba);
 	gba->cpu->memory.store16(gba->cpu, GBA_BASE_IO | GBA_REG_IME, 0, NULL);
 	gba->cpu->memory.store16(gba->cpu, GBA_BASE_IO | GBA_REG_IE, 0, NULL);
-	GBAVideoDeserialize(&gba->video, state);
+	GBAVideoDeserialize(&gba->video, state, 0);
+	GBAMemoryMarkDirty(&gba->memory);
 	GBAIODeserialize(gba, state);
 	GBAAudioReset(&gba->audio);
 
@@ -1809,7 +2276,12 @@ struct mCore* GBAVideoLogPlayerCreate(void) {
 	core->deinit = _GBAVLPDeinit;
 	core->reset = _GBAVLPReset;
 	core->loadROM = _GBAVLPLoadROM;
+	core->setROMPath = NULL;
 	core->loadState = _GBAVLPLoadState;
+	core->loadStateIncremental = NULL;
+	core->saveStateIncremental = NULL;
+	core->dirtyState = NULL;
+	core->listStateSections = NULL;
 	core->isROM = _returnTrue;
 	return core;
 }
@@ -5,6 +5,7 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/internal/gba/dma.h>
 
+#include <mgba/internal/arm/macros.h>
 #include <mgba/internal/gba/gba.h>
 #include <mgba/internal/gba/io.h>
 
@@ -13,6 +14,8 @@ mLOG_DEFINE_CATEGORY(GBA_DMA, "GBA DMA", "gba.dma");
 static void _dmaEvent(struct mTiming* timing, void* context, uint32_t cyclesLate);
 
 static void GBADMAService(struct GBA* gba, int number, struct GBADMA* info);
+static void _bulkTransfer(struct GBA* gba, struct GBADMA* info, int sourceOffset, int destOffset);
+static void _fifoTransfer(struct GBA* gba, struct GBADMA* info, int sourceOffset);
 
 static const int DMA_OFFSET[] = { 1, -1, 0, 1 };
 
@@ -316,6 +319,14 @@ void GBADMAService(struct GBA* gba, int number, struct GBADMA* info) {
 	info->nextDest += destOffset;
 	--info->nextCount;
 
+	if (info->nextCount && source) {
+		if ((number == 1 || number == 2) && GBADMARegisterGetTiming(info->reg) == GBA_DMA_TIMING_CUSTOM) {
+			_fifoTransfer(gba, info, sourceOffset);
+		} else {
+			_bulkTransfer(gba, info, sourceOffset, destOffset);
+		}
+	}
+
 	gba->performingDMA = 0;
 	cpu->memory.accessSource = oldAccess;
 
@@ -339,6 +350,161 @@ void GBADMAService(struct GBA* gba, int number, struct GBADMA* info) {
 	GBADMAUpdate(gba);
 }
 
+// How many of the remaining units of a transfer would run before anything else could
+// observe them; every unit after the first costs the same, and each one has to finish
+// before the next event
+static uint32_t _unseenUnits(struct GBA* gba, struct GBADMA* info) {
+	struct GBAMemory* memory = &gba->memory;
+	if (gba->timing.interrupted) {
+		return 0;
+	}
+	int i;
+	for (i = 0; i < 4; ++i) {
+		struct GBADMA* dma = &memory->dma[i];
+		if (dma != info && GBADMARegisterIsEnable(dma->reg) && dma->nextCount) {
+			return 0;
+		}
+	}
+
+	int32_t unitCycles = 2 + info->cycles;
+	int32_t start = info->when - mTimingCurrentTime(&gba->timing);
+	int32_t until = mTimingNextEvent(&gba->timing);
+	if (unitCycles <= 0 || start >= until) {
+		return 0;
+	}
+	int64_t fit = ((int64_t) until - 1 - start) / unitCycles + 1;
+	uint32_t units = info->nextCount;
+	if (fit < units) {
+		units = fit;
+	}
+	return units;
+}
+
+// Performs as many of the remaining units of a RAM-to-RAM transfer as would run before
+// anything else could observe them, charging the same cycles the event-driven path would
+static void _bulkTransfer(struct GBA* gba, struct GBADMA* info, int sourceOffset, int destOffset) {
+	struct GBAMemory* memory = &gba->memory;
+	struct ARMCore* cpu = gba->cpu;
+	uint32_t width = 2 << GBADMARegisterGetWidth(info->reg);
+	uint32_t source = info->nextSource;
+	uint32_t dest = info->nextDest;
+
+	if (source >= GBA_BASE_IO || dest >= GBA_BASE_IO || sourceOffset < 0 || destOffset <= 0) {
+		return;
+	}
+	// Debugger watchpoints and the like hook the access functions, so they need to see every unit
+	if (width == 4 ? (cpu->memory.load32 != GBALoad32 || cpu->memory.store32 != GBAStore32)
+	               : (cpu->memory.load16 != GBALoad16 || cpu->memory.store16 != GBAStore16)) {
+		return;
+	}
+
+	const struct GBAFastRegion* sourceFast = &memory->fastRegions[source >> BASE_OFFSET];
+	const struct GBAFastRegion* destFast = &memory->fastRegions[dest >> BASE_OFFSET];
+	uint32_t sourceBase = source & sourceFast->mask;
+	uint32_t destBase = dest & destFast->mask;
+	if (sourceBase >= sourceFast->limit || destBase >= destFast->limit) {
+		return;
+	}
+
+	uint32_t units = _unseenUnits(gba, info);
+	if (units > (destFast->limit - destBase) / width) {
+		units = (destFast->limit - destBase) / width;
+	}
+	if (sourceOffset && units > (sourceFast->limit - sourceBase) / width) {
+		units = (sourceFast->limit - sourceBase) / width;
+	}
+	if (!units) {
+		return;
+	}
+
+	uint8_t* sourcePtr = (uint8_t*) sourceFast->base + sourceBase;
+	uint8_t* destPtr = (uint8_t*) destFast->base + destBase;
+	uint32_t size = units * width;
+	uint32_t value = 0;
+	if (sourceOffset && (sourcePtr + size <= destPtr || destPtr + size <= sourcePtr)) {
+		memcpy(destPtr, sourcePtr, size);
+		if (width == 4) {
+			LOAD_32(value, size - 4, sourcePtr);
+		} else {
+			LOAD_16(value, size - 2, sourcePtr);
+		}
+	} else {
+		// Overlapping copies have to be done in order, the same way the hardware would
+		uint32_t offset;
+		for (offset = 0; offset < size; offset += width) {
+			if (width == 4) {
+				LOAD_32(value, sourceOffset ? offset : 0, sourcePtr);
+				STORE_32(value, offset, destPtr);
+			} else {
+				LOAD_16(value, sourceOffset ? offset : 0, sourcePtr);
+				STORE_16(value, offset, destPtr);
+			}
+		}
+	}
+	uint32_t page;
+	for (page = destBase >> mSTATE_PAGE_SHIFT; page <= (destBase + size - 1) >> mSTATE_PAGE_SHIFT; ++page) {
+		destFast->dirty[page] = memory->dirtyGeneration;
+	}
+	if (width == 2) {
+		value &= 0xFFFF;
+		value |= value << 16;
+	}
+	memory->dmaTransferRegister = value;
+	gba->bus = value;
+
+	info->when += units * (2 + info->cycles);
+	info->nextSource += sourceOffset * units;
+	info->nextDest += destOffset * units;
+	info->nextCount -= units;
+}
+
+// Feeds the rest of a sound FIFO refill straight from memory into the FIFO, the same way
+// _bulkTransfer does for RAM, instead of taking a trip through the scheduler for each word
+static void _fifoTransfer(struct GBA* gba, struct GBADMA* info, int sourceOffset) {
+	struct GBAMemory* memory = &gba->memory;
+	struct ARMCore* cpu = gba->cpu;
+	uint32_t source = info->nextSource;
+	uint32_t dest = info->nextDest;
+
+	if (dest != (GBA_BASE_IO | GBA_REG_FIFO_A_LO) && dest != (GBA_BASE_IO | GBA_REG_FIFO_B_LO)) {
+		return;
+	}
+	if (sourceOffset < 0 || GBADMARegisterGetWidth(info->reg) != 1) {
+		return;
+	}
+	if (cpu->memory.load32 != GBALoad32 || cpu->memory.store32 != GBAStore32) {
+		return;
+	}
+
+	const struct GBAFastRegion* sourceFast = &memory->fastRegions[source >> BASE_OFFSET];
+	uint32_t sourceBase = source & sourceFast->mask;
+	if (sourceBase >= sourceFast->limit) {
+		return;
+	}
+
+	uint32_t units = _unseenUnits(gba, info);
+	if (sourceOffset && units > (sourceFast->limit - sourceBase) / 4) {
+		units = (sourceFast->limit - sourceBase) / 4;
+	}
+	if (!units) {
+		return;
+	}
+
+	const uint8_t* sourcePtr = (const uint8_t*) sourceFast->base + sourceBase;
+	uint32_t value = 0;
+	uint32_t i;
+	for (i = 0; i < units; ++i) {
+		LOAD_32(value, sourceOffset * i, sourcePtr);
+		GBAIOWrite32(gba, dest & (OFFSET_MASK - 3), value);
+	}
+	memory->dmaTransferRegister = value;
+	gba->bus = value;
+
+	info->when += units * (2 + info->cycles);
+	info->nextSource += sourceOffset * units;
+	info->nextCount -= units;
+}
+
 void GBADMARecalculateCycles(struct GBA* gba) {
 	int i;
 	for (i = 0; i < 4; ++i) {
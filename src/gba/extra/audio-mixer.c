@@ -0,0 +1,236 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/internal/gba/extra/audio-mixer.h>
+
+#include <mgba/internal/arm/arm.h>
+#include <mgba/internal/gba/gba.h>
+#include <mgba/internal/gba/memory.h>
+
+#define MP2K_CHANNEL_START 0x80
+#define MP2K_CHANNEL_STOP 0x40
+#define MP2K_CHANNEL_ECHO 0x04
+#define MP2K_CHANNEL_ENVELOPE 0x03
+#define MP2K_CHANNEL_ON (MP2K_CHANNEL_START | MP2K_CHANNEL_STOP | MP2K_CHANNEL_ECHO | MP2K_CHANNEL_ENVELOPE)
+
+#define MP2K_TYPE_FIXED 0x08
+#define MP2K_TYPE_CGB 0x07
+
+#define MP2K_WAVE_LOOP 0xC000
+#define MP2K_WAVE_DATA 0x10
+
+static_assert(offsetof(struct GBAMP2kContext, chans) == 0x50, "GBAMP2kContext struct laid out wrong");
+static_assert(sizeof(struct GBAMP2kSoundChannel) == 0x40, "GBAMP2kSoundChannel struct sized wrong");
+
+static void _mp2kInit(void* cpu, struct mCPUComponent* component);
+static void _mp2kDeinit(struct mCPUComponent* component);
+
+static bool _mp2kEngage(struct GBAAudioMixer* mixer, uint32_t address);
+static void _mp2kVblank(struct GBAAudioMixer* mixer);
+static void _mp2kStep(struct GBAAudioMixer* mixer, int16_t* chA, int16_t* chB);
+
+void GBAAudioMixerCreate(struct GBAAudioMixer* mixer) {
+	mixer->d.init = _mp2kInit;
+	mixer->d.deinit = _mp2kDeinit;
+	mixer->engage = _mp2kEngage;
+	mixer->vblank = _mp2kVblank;
+	mixer->step = _mp2kStep;
+}
+
+void _mp2kInit(void* cpu, struct mCPUComponent* component) {
+	struct ARMCore* arm = cpu;
+	struct GBA* gba = (struct GBA*) arm->master;
+	struct GBAAudioMixer* mixer = (struct GBAAudioMixer*) component;
+	gba->audio.mixer = mixer;
+	gba->audio.externalMixing = false;
+	mixer->p = &gba->audio;
+	mixer->contextAddress = 0;
+	memset(&mixer->context, 0, sizeof(mixer->context));
+	memset(mixer->voices, 0, sizeof(mixer->voices));
+}
+
+void _mp2kDeinit(struct mCPUComponent* component) {
+	struct GBAAudioMixer* mixer = (struct GBAAudioMixer*) component;
+	mixer->p->mixer = NULL;
+	mixer->p->externalMixing = false;
+}
+
+static inline int8_t _sampleAt(struct GBA* gba, uint32_t address) {
+	const struct GBAFastRegion* fast = &gba->memory.fastRegions[address >> BASE_OFFSET];
+	if ((address & fast->mask) < fast->limit) {
+		return ((int8_t*) fast->base)[address & fast->mask];
+	}
+	return GBAView8(gba->cpu, address);
+}
+
+static void _mp2kLoadChannel(struct ARMCore* cpu, struct GBAMP2kSoundChannel* channel, uint32_t base) {
+	channel->status = GBAView8(cpu, base + offsetof(struct GBAMP2kSoundChannel, status));
+	channel->type = GBAView8(cpu, base + offsetof(struct GBAMP2kSoundChannel, type));
+	channel->rightVolume = GBAView8(cpu, base + offsetof(struct GBAMP2kSoundChannel, rightVolume));
+	channel->leftVolume = GBAView8(cpu, base + offsetof(struct GBAMP2kSoundChannel, leftVolume));
+	channel->adsr.attack = GBAView8(cpu, base + offsetof(struct GBAMP2kSoundChannel, adsr.attack));
+	channel->envelopeV = GBAView8(cpu, base + offsetof(struct GBAMP2kSoundChannel, envelopeV));
+	channel->envelopeRight = GBAView8(cpu, base + offsetof(struct GBAMP2kSoundChannel, envelopeRight));
+	channel->envelopeLeft = GBAView8(cpu, base + offsetof(struct GBAMP2kSoundChannel, envelopeLeft));
+	channel->ct = GBAView32(cpu, base + offsetof(struct GBAMP2kSoundChannel, ct));
+	channel->fw = GBAView32(cpu, base + offsetof(struct GBAMP2kSoundChannel, fw));
+	channel->freq = GBAView32(cpu, base + offsetof(struct GBAMP2kSoundChannel, freq));
+	channel->waveData = GBAView32(cpu, base + offsetof(struct GBAMP2kSoundChannel, waveData));
+	channel->cp = GBAView32(cpu, base + offsetof(struct GBAMP2kSoundChannel, cp));
+}
+
+static void _mp2kSetupVoice(struct GBAAudioMixer* mixer, const struct GBAMP2kSoundChannel* channel, struct GBAMP2kVoice* voice) {
+	struct ARMCore* cpu = mixer->p->p->cpu;
+	const struct GBAMP2kContext* context = &mixer->context;
+	voice->active = false;
+	if (!(channel->status & MP2K_CHANNEL_ON) || (channel->type & MP2K_TYPE_CGB) || !channel->waveData) {
+		// PSG channels are still played by the PSG itself
+		return;
+	}
+
+	uint32_t wave = channel->waveData;
+	uint32_t size = GBAView32(cpu, wave + 12);
+	uint32_t loopStart = GBAView32(cpu, wave + 8);
+	voice->loop = (GBAView16(cpu, wave + 2) & MP2K_WAVE_LOOP) && loopStart < size;
+	voice->loopStart = wave + MP2K_WAVE_DATA + loopStart;
+	voice->loopLength = voice->loop ? size - loopStart : 0;
+
+	int volumeRight = channel->envelopeRight;
+	int volumeLeft = channel->envelopeLeft;
+	if (channel->status & MP2K_CHANNEL_START) {
+		// The engine hasn't picked up this note yet, so start it the way it will
+		voice->current = wave + MP2K_WAVE_DATA;
+		voice->remaining = size;
+		voice->position = 0;
+		int envelope = ((context->masterVolume + 1) * channel->adsr.attack) >> 4;
+		volumeRight = (envelope * channel->rightVolume) >> 8;
+		volumeLeft = (envelope * channel->leftVolume) >> 8;
+	} else {
+		voice->current = channel->cp;
+		voice->remaining = channel->ct;
+		// The engine keeps 23 bits of fractional position
+		voice->position = (channel->type & MP2K_TYPE_FIXED) ? 0 : (channel->fw >> 7) & 0xFFFF;
+	}
+	if (!voice->remaining) {
+		return;
+	}
+	voice->volumeRight = volumeRight;
+	voice->volumeLeft = volumeLeft;
+
+	// Steps are in 16.16 source samples per output sample. Non-fixed channels advance
+	// freq * divFreq / 2^23 source samples for each sample the engine mixes.
+	uint64_t rate = GBA_ARM7TDMI_FREQUENCY / mixer->p->sampleInterval;
+	if (channel->type & MP2K_TYPE_FIXED) {
+		voice->step = ((uint64_t) context->pcmFreq << 16) / rate;
+	} else {
+		voice->step = ((uint64_t) channel->freq * (uint32_t) context->divFreq * (uint32_t) context->pcmFreq >> 7) / rate;
+	}
+	voice->active = true;
+}
+
+static void _mp2kReload(struct GBAAudioMixer* mixer) {
+	struct ARMCore* cpu = mixer->p->p->cpu;
+	struct GBAMP2kContext* context = &mixer->context;
+	uint32_t base = mixer->contextAddress;
+	context->magic = GBAView32(cpu, base + offsetof(struct GBAMP2kContext, magic));
+	context->pcmFreq = GBAView32(cpu, base + offsetof(struct GBAMP2kContext, pcmFreq));
+	if (context->magic - MP2K_MAGIC > MP2K_LOCK_MAX || context->pcmFreq <= 0) {
+		// The engine was shut down or its work area was reused
+		mixer->contextAddress = 0;
+		mixer->p->externalMixing = false;
+		return;
+	}
+	context->maxChans = GBAView8(cpu, base + offsetof(struct GBAMP2kContext, maxChans));
+	context->masterVolume = GBAView8(cpu, base + offsetof(struct GBAMP2kContext, masterVolume));
+	context->divFreq = GBAView32(cpu, base + offsetof(struct GBAMP2kContext, divFreq));
+
+	size_t i;
+	for (i = 0; i < MP2K_MAX_SOUND_CHANNELS; ++i) {
+		if (i >= context->maxChans) {
+			mixer->voices[i].active = false;
+			continue;
+		}
+		_mp2kLoadChannel(cpu, &context->chans[i], base + offsetof(struct GBAMP2kContext, chans) + i * sizeof(struct GBAMP2kSoundChannel));
+		_mp2kSetupVoice(mixer, &context->chans[i], &mixer->voices[i]);
+	}
+	mixer->p->externalMixing = true;
+}
+
+bool _mp2kEngage(struct GBAAudioMixer* mixer, uint32_t address) {
+	if (address != mixer->contextAddress) {
+		mLOG(GBA_AUDIO, DEBUG, "Found MP2K context at %08X", address);
+		mixer->contextAddress = address;
+		_mp2kReload(mixer);
+	}
+	return mixer->p->externalMixing;
+}
+
+void _mp2kVblank(struct GBAAudioMixer* mixer) {
+	if (!mixer->contextAddress) {
+		return;
+	}
+	// The engine mixes a frame ahead of the FIFOs, so picking up its state here keeps
+	// the voices continuous from one frame to the next
+	_mp2kReload(mixer);
+}
+
+void _mp2kStep(struct GBAAudioMixer* mixer, int16_t* chA, int16_t* chB) {
+	struct GBA* gba = mixer->p->p;
+	int32_t right = 0;
+	int32_t left = 0;
+	size_t i;
+	for (i = 0; i < MP2K_MAX_SOUND_CHANNELS; ++i) {
+		struct GBAMP2kVoice* voice = &mixer->voices[i];
+		if (!voice->active) {
+			continue;
+		}
+
+		// Interpolate between source samples instead of holding them like the engine does
+		int32_t sample = _sampleAt(gba, voice->current);
+		uint32_t next = 0;
+		if (voice->remaining > 1) {
+			next = voice->current + 1;
+		} else if (voice->loop) {
+			next = voice->loopStart;
+		}
+		if (next) {
+			sample = (sample << 8) + (((_sampleAt(gba, next) - sample) * (int32_t) voice->position) >> 8);
+		} else {
+			sample <<= 8;
+		}
+		right += (sample * voice->volumeRight) >> 8;
+		left += (sample * voice->volumeLeft) >> 8;
+
+		voice->position += voice->step;
+		uint32_t advance = voice->position >> 16;
+		voice->position &= 0xFFFF;
+		while (advance >= voice->remaining) {
+			advance -= voice->remaining;
+			if (!voice->loop) {
+				voice->active = false;
+				break;
+			}
+			voice->current = voice->loopStart;
+			voice->remaining = voice->loopLength;
+		}
+		voice->current += advance;
+		voice->remaining -= advance;
+	}
+
+	// The engine saturates each buffer to 8 bits; keep the extra precision but not the range
+	if (right > 0x7FFF) {
+		right = 0x7FFF;
+	} else if (right < -0x8000) {
+		right = -0x8000;
+	}
+	if (left > 0x7FFF) {
+		left = 0x7FFF;
+	} else if (left < -0x8000) {
+		left = -0x8000;
+	}
+	// The engine feeds the right buffer to FIFO A and the left buffer to FIFO B
+	*chA = right >> 6;
+	*chB = left >> 6;
+}
@@ -0,0 +1,447 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/internal/gba/renderers/parallel.h>
+
+#include <mgba/core/cache-set.h>
+#include <mgba/core/host-trace.h>
+#include <mgba/internal/gba/gba.h>
+#include <mgba/internal/gba/io.h>
+#include <mgba/internal/gba/renderers/cache-set.h>
+
+#include <mgba-util/memory.h>
+
+#ifndef DISABLE_THREADING
+
+#define QUEUE_SIZE 0x100000
+#define VRAM_BLOCK_SIZE 0x1000
+
+enum GBAVideoParallelCommandType {
+	PARALLEL_REGISTER = 0,
+	PARALLEL_VRAM,
+	PARALLEL_PALETTE,
+	PARALLEL_OAM,
+	PARALLEL_SCANLINE,
+	PARALLEL_FRAME,
+};
+
+struct GBAVideoParallelCommand {
+	uint16_t type;
+	uint16_t value;
+	uint32_t address;
+};
+
+static void GBAVideoParallelRendererInit(struct GBAVideoRenderer* renderer);
+static void GBAVideoParallelRendererReset(struct GBAVideoRenderer* renderer);
+static void GBAVideoParallelRendererDeinit(struct GBAVideoRenderer* renderer);
+static uint32_t GBAVideoParallelRendererId(const struct GBAVideoRenderer* renderer);
+static bool GBAVideoParallelRendererLoadState(struct GBAVideoRenderer* renderer, const void* state, size_t size);
+static void GBAVideoParallelRendererSaveState(struct GBAVideoRenderer* renderer, void** state, size_t* size);
+static uint16_t GBAVideoParallelRendererWriteVideoRegister(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value);
+static void GBAVideoParallelRendererWriteVRAM(struct GBAVideoRenderer* renderer, uint32_t address);
+static void GBAVideoParallelRendererWritePalette(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value);
+static void GBAVideoParallelRendererWriteOAM(struct GBAVideoRenderer* renderer, uint32_t oam);
+static void GBAVideoParallelRendererDrawScanline(struct GBAVideoRenderer* renderer, int y);
+static void GBAVideoParallelRendererFinishFrame(struct GBAVideoRenderer* renderer);
+static void GBAVideoParallelRendererGetPixels(struct GBAVideoRenderer* renderer, size_t* stride, const void** pixels);
+static void GBAVideoParallelRendererPutPixels(struct GBAVideoRenderer* renderer, size_t stride, const void* pixels);
+
+static THREAD_ENTRY _workerThread(void* context);
+
+void GBAVideoParallelRendererCreate(struct GBAVideoParallelRenderer* renderer, struct GBAVideoSoftwareRenderer* backend, int nWorkers) {
+	memset(renderer, 0, sizeof(*renderer));
+	renderer->d.init = GBAVideoParallelRendererInit;
+	renderer->d.reset = GBAVideoParallelRendererReset;
+	renderer->d.deinit = GBAVideoParallelRendererDeinit;
+	renderer->d.rendererId = GBAVideoParallelRendererId;
+	renderer->d.loadState = GBAVideoParallelRendererLoadState;
+	renderer->d.saveState = GBAVideoParallelRendererSaveState;
+	renderer->d.writeVideoRegister = GBAVideoParallelRendererWriteVideoRegister;
+	renderer->d.writeVRAM = GBAVideoParallelRendererWriteVRAM;
+	renderer->d.writeOAM = GBAVideoParallelRendererWriteOAM;
+	renderer->d.writePalette = GBAVideoParallelRendererWritePalette;
+	renderer->d.drawScanline = GBAVideoParallelRendererDrawScanline;
+	renderer->d.finishFrame = GBAVideoParallelRendererFinishFrame;
+	renderer->d.getPixels = GBAVideoParallelRendererGetPixels;
+	renderer->d.putPixels = GBAVideoParallelRendererPutPixels;
+
+	renderer->d.disableBG[0] = false;
+	renderer->d.disableBG[1] = false;
+	renderer->d.disableBG[2] = false;
+	renderer->d.disableBG[3] = false;
+	renderer->d.disableOBJ = false;
+	renderer->d.disableWIN[0] = false;
+	renderer->d.disableWIN[1] = false;
+	renderer->d.disableOBJWIN = false;
+
+	renderer->d.highlightBG[0] = false;
+	renderer->d.highlightBG[1] = false;
+	renderer->d.highlightBG[2] = false;
+	renderer->d.highlightBG[3] = false;
+	int i;
+	for (i = 0; i < 128; ++i) {
+		renderer->d.highlightOBJ[i] = false;
+	}
+	renderer->d.highlightColor = M_COLOR_WHITE;
+	renderer->d.highlightAmount = 0;
+
+	if (nWorkers < 1) {
+		nWorkers = 1;
+	} else if (nWorkers > GBA_VIDEO_PARALLEL_MAX_WORKERS) {
+		nWorkers = GBA_VIDEO_PARALLEL_MAX_WORKERS;
+	}
+	renderer->nWorkers = nWorkers;
+	renderer->backend = backend;
+}
+
+static void _copyMemory(struct GBAVideoParallelRenderer* renderer, struct GBAVideoParallelWorker* worker) {
+	memcpy(worker->vram, renderer->d.vram, GBA_SIZE_VRAM);
+	memcpy(worker->palette, renderer->d.palette, GBA_SIZE_PALETTE_RAM);
+	memcpy(worker->oam, renderer->d.oam, GBA_SIZE_OAM);
+}
+
+// Must only be called while the workers are idle
+static void _syncWorkers(struct GBAVideoParallelRenderer* renderer) {
+	int i;
+	for (i = 0; i < renderer->nWorkers; ++i) {
+		struct GBAVideoSoftwareRenderer* worker = &renderer->workers[i].renderer;
+		memcpy(worker->d.disableBG, renderer->d.disableBG, sizeof(worker->d.disableBG));
+		worker->d.disableOBJ = renderer->d.disableOBJ;
+		memcpy(worker->d.disableWIN, renderer->d.disableWIN, sizeof(worker->d.disableWIN));
+		worker->d.disableOBJWIN = renderer->d.disableOBJWIN;
+		memcpy(worker->d.highlightBG, renderer->d.highlightBG, sizeof(worker->d.highlightBG));
+		memcpy(worker->d.highlightOBJ, renderer->d.highlightOBJ, sizeof(worker->d.highlightOBJ));
+		worker->d.highlightAmount = renderer->d.highlightAmount;
+		worker->d.highlightColor = renderer->d.highlightColor;
+
+		if (worker->outputBuffer != renderer->backend->outputBuffer || worker->outputBufferStride != renderer->backend->outputBufferStride) {
+			worker->outputBuffer = renderer->backend->outputBuffer;
+			worker->outputBufferStride = renderer->backend->outputBufferStride;
+			memset(worker->scanlineDirty, 0xFFFFFFFF, sizeof(worker->scanlineDirty));
+		}
+	}
+}
+
+static void _publish(struct GBAVideoParallelRenderer* renderer, bool wake) {
+	MutexLock(&renderer->mutex);
+	renderer->published = renderer->written;
+	if (wake) {
+		ConditionWake(&renderer->toWorkerCond);
+	}
+	MutexUnlock(&renderer->mutex);
+}
+
+// Waits for every worker to replay everything written so far, then rewinds the queue
+static void _drain(struct GBAVideoParallelRenderer* renderer) {
+	MutexLock(&renderer->mutex);
+	renderer->published = renderer->written;
+	ConditionWake(&renderer->toWorkerCond);
+	int i;
+	for (i = 0; i < renderer->nWorkers; ++i) {
+		while (renderer->workers[i].read != renderer->published) {
+			ConditionWait(&renderer->fromWorkerCond, &renderer->mutex);
+		}
+	}
+	for (i = 0; i < renderer->nWorkers; ++i) {
+		renderer->workers[i].read = 0;
+	}
+	renderer->written = 0;
+	renderer->published = 0;
+	MutexUnlock(&renderer->mutex);
+}
+
+static uint8_t* _reserve(struct GBAVideoParallelRenderer* renderer, size_t length) {
+	if (renderer->written + length > QUEUE_SIZE) {
+		_drain(renderer);
+	}
+	uint8_t* data = &renderer->queue[renderer->written];
+	renderer->written += length;
+	return data;
+}
+
+static void _writeCommand(struct GBAVideoParallelRenderer* renderer, enum GBAVideoParallelCommandType type, uint32_t address, uint16_t value) {
+	struct GBAVideoParallelCommand command = {
+		.type = type,
+		.value = value,
+		.address = address,
+	};
+	memcpy(_reserve(renderer, sizeof(command)), &command, sizeof(command));
+}
+
+static void _flushVRAM(struct GBAVideoParallelRenderer* renderer) {
+	uint32_t dirty = renderer->vramDirty;
+	renderer->vramDirty = 0;
+	uint32_t address;
+	for (address = 0; dirty; dirty >>= 1, address += VRAM_BLOCK_SIZE) {
+		if (!(dirty & 1)) {
+			continue;
+		}
+		struct GBAVideoParallelCommand command = {
+			.type = PARALLEL_VRAM,
+			.address = address,
+		};
+		uint8_t* data = _reserve(renderer, sizeof(command) + VRAM_BLOCK_SIZE);
+		memcpy(data, &command, sizeof(command));
+		memcpy(&data[sizeof(command)], &renderer->d.vram[address >> 1], VRAM_BLOCK_SIZE);
+	}
+}
+
+static void _replay(struct GBAVideoParallelWorker* worker, size_t read, size_t end) {
+	struct GBAVideoRenderer* backend = &worker->renderer.d;
+	const uint8_t* queue = worker->p->queue;
+	while (read < end) {
+		struct GBAVideoParallelCommand command;
+		memcpy(&command, &queue[read], sizeof(command));
+		read += sizeof(command);
+		switch (command.type) {
+		case PARALLEL_REGISTER:
+			backend->writeVideoRegister(backend, command.address, command.value);
+			break;
+		case PARALLEL_VRAM:
+			memcpy(&worker->vram[command.address >> 1], &queue[read], VRAM_BLOCK_SIZE);
+			read += VRAM_BLOCK_SIZE;
+			backend->writeVRAM(backend, command.address);
+			break;
+		case PARALLEL_PALETTE:
+			STORE_16LE(command.value, command.address, worker->palette);
+			backend->writePalette(backend, command.address, command.value);
+			break;
+		case PARALLEL_OAM:
+			STORE_16LE(command.value, command.address << 1, worker->oam->raw);
+			backend->writeOAM(backend, command.address);
+			break;
+		case PARALLEL_SCANLINE:
+			mTRACE_BEGIN("Renderer: draw scanline");
+			backend->drawScanline(backend, command.address);
+			mTRACE_END();
+			break;
+		case PARALLEL_FRAME:
+			mTRACE_BEGIN("Renderer: finish frame");
+			backend->finishFrame(backend);
+			mTRACE_END();
+			break;
+		}
+	}
+}
+
+static THREAD_ENTRY _workerThread(void* context) {
+	struct GBAVideoParallelWorker* worker = context;
+	struct GBAVideoParallelRenderer* renderer = worker->p;
+	ThreadSetName("Parallel Rendering");
+	mTRACE_THREAD_NAME("Parallel Rendering");
+	ThreadSetPolicy(&renderer->threadPolicy);
+
+	MutexLock(&renderer->mutex);
+	while (!renderer->stopping) {
+		if (worker->read == renderer->published) {
+			ConditionWait(&renderer->toWorkerCond, &renderer->mutex);
+			continue;
+		}
+		size_t read = worker->read;
+		size_t end = renderer->published;
+		MutexUnlock(&renderer->mutex);
+		_replay(worker, read, end);
+		MutexLock(&renderer->mutex);
+		worker->read = end;
+		ConditionWake(&renderer->fromWorkerCond);
+	}
+	MutexUnlock(&renderer->mutex);
+	THREAD_EXIT(0);
+}
+
+void GBAVideoParallelRendererInit(struct GBAVideoRenderer* renderer) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+	MutexInit(&parallelRenderer->mutex);
+	ConditionInit(&parallelRenderer->toWorkerCond);
+	ConditionInit(&parallelRenderer->fromWorkerCond);
+	parallelRenderer->stopping = false;
+	parallelRenderer->queue = anonymousMemoryMap(QUEUE_SIZE);
+	parallelRenderer->written = 0;
+	parallelRenderer->published = 0;
+	parallelRenderer->vramDirty = 0;
+
+	parallelRenderer->workers = calloc(parallelRenderer->nWorkers, sizeof(*parallelRenderer->workers));
+	int i;
+	for (i = 0; i < parallelRenderer->nWorkers; ++i) {
+		struct GBAVideoParallelWorker* worker = &parallelRenderer->workers[i];
+		worker->p = parallelRenderer;
+		worker->vram = anonymousMemoryMap(GBA_SIZE_VRAM);
+		worker->palette = anonymousMemoryMap(GBA_SIZE_PALETTE_RAM);
+		worker->oam = anonymousMemoryMap(GBA_SIZE_OAM);
+		_copyMemory(parallelRenderer, worker);
+
+		GBAVideoSoftwareRendererCreate(&worker->renderer);
+		worker->renderer.d.vram = worker->vram;
+		worker->renderer.d.palette = worker->palette;
+		worker->renderer.d.oam = worker->oam;
+		worker->renderer.d.cache = NULL;
+		worker->renderer.drawStartY = GBA_VIDEO_VERTICAL_PIXELS * i / parallelRenderer->nWorkers;
+		worker->renderer.drawEndY = GBA_VIDEO_VERTICAL_PIXELS * (i + 1) / parallelRenderer->nWorkers;
+	}
+	_syncWorkers(parallelRenderer);
+	for (i = 0; i < parallelRenderer->nWorkers; ++i) {
+		struct GBAVideoParallelWorker* worker = &parallelRenderer->workers[i];
+		worker->renderer.d.init(&worker->renderer.d);
+		ThreadCreate(&worker->thread, _workerThread, worker);
+	}
+}
+
+void GBAVideoParallelRendererReset(struct GBAVideoRenderer* renderer) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+	_drain(parallelRenderer);
+	parallelRenderer->vramDirty = 0;
+	_syncWorkers(parallelRenderer);
+	int i;
+	for (i = 0; i < parallelRenderer->nWorkers; ++i) {
+		struct GBAVideoParallelWorker* worker = &parallelRenderer->workers[i];
+		_copyMemory(parallelRenderer, worker);
+		worker->renderer.d.reset(&worker->renderer.d);
+	}
+}
+
+void GBAVideoParallelRendererDeinit(struct GBAVideoRenderer* renderer) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+	MutexLock(&parallelRenderer->mutex);
+	parallelRenderer->stopping = true;
+	ConditionWake(&parallelRenderer->toWorkerCond);
+	MutexUnlock(&parallelRenderer->mutex);
+
+	int i;
+	for (i = 0; i < parallelRenderer->nWorkers; ++i) {
+		struct GBAVideoParallelWorker* worker = &parallelRenderer->workers[i];
+		ThreadJoin(&worker->thread);
+		worker->renderer.d.deinit(&worker->renderer.d);
+		mappedMemoryFree(worker->vram, GBA_SIZE_VRAM);
+		mappedMemoryFree(worker->palette, GBA_SIZE_PALETTE_RAM);
+		mappedMemoryFree(worker->oam, GBA_SIZE_OAM);
+	}
+	free(parallelRenderer->workers);
+	parallelRenderer->workers = NULL;
+	mappedMemoryFree(parallelRenderer->queue, QUEUE_SIZE);
+	parallelRenderer->queue = NULL;
+
+	ConditionDeinit(&parallelRenderer->toWorkerCond);
+	ConditionDeinit(&parallelRenderer->fromWorkerCond);
+	MutexDeinit(&parallelRenderer->mutex);
+}
+
+size_t GBAVideoParallelRendererMemoryUsage(const struct GBAVideoParallelRenderer* renderer) {
+	if (!renderer->workers) {
+		return 0;
+	}
+	size_t worker = sizeof(*renderer->workers) + GBA_SIZE_VRAM + GBA_SIZE_PALETTE_RAM + GBA_SIZE_OAM;
+	return QUEUE_SIZE + worker * renderer->nWorkers;
+}
+
+uint32_t GBAVideoParallelRendererId(const struct GBAVideoRenderer* renderer) {
+	const struct GBAVideoParallelRenderer* parallelRenderer = (const struct GBAVideoParallelRenderer*) renderer;
+	return parallelRenderer->backend->d.rendererId(&parallelRenderer->backend->d);
+}
+
+bool GBAVideoParallelRendererLoadState(struct GBAVideoRenderer* renderer, const void* state, size_t size) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+	_drain(parallelRenderer);
+	bool success = true;
+	int i;
+	for (i = 0; i < parallelRenderer->nWorkers; ++i) {
+		struct GBAVideoRenderer* worker = &parallelRenderer->workers[i].renderer.d;
+		if (!worker->loadState(worker, state, size)) {
+			success = false;
+		}
+	}
+	return success;
+}
+
+void GBAVideoParallelRendererSaveState(struct GBAVideoRenderer* renderer, void** state, size_t* size) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+	_drain(parallelRenderer);
+	struct GBAVideoRenderer* worker = &parallelRenderer->workers[0].renderer.d;
+	worker->saveState(worker, state, size);
+}
+
+uint16_t GBAVideoParallelRendererWriteVideoRegister(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+	switch (address) {
+	case GBA_REG_DISPCNT:
+		value &= 0xFFF7;
+		break;
+	case GBA_REG_BG0CNT:
+	case GBA_REG_BG1CNT:
+		value &= 0xDFFF;
+		break;
+	case GBA_REG_BG0HOFS:
+	case GBA_REG_BG0VOFS:
+	case GBA_REG_BG1HOFS:
+	case GBA_REG_BG1VOFS:
+	case GBA_REG_BG2HOFS:
+	case GBA_REG_BG2VOFS:
+	case GBA_REG_BG3HOFS:
+	case GBA_REG_BG3VOFS:
+		value &= 0x01FF;
+		break;
+	}
+	if (address > GBA_REG_BLDY) {
+		return value;
+	}
+	if (renderer->cache) {
+		GBAVideoCacheWriteVideoRegister(renderer->cache, address, value);
+	}
+	_writeCommand(parallelRenderer, PARALLEL_REGISTER, address, value);
+	return value;
+}
+
+void GBAVideoParallelRendererWriteVRAM(struct GBAVideoRenderer* renderer, uint32_t address) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+	parallelRenderer->vramDirty |= 1U << (address / VRAM_BLOCK_SIZE);
+	if (renderer->cache) {
+		mCacheSetWriteVRAM(renderer->cache, address);
+	}
+}
+
+void GBAVideoParallelRendererWritePalette(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+	_writeCommand(parallelRenderer, PARALLEL_PALETTE, address, value);
+	if (renderer->cache) {
+		mCacheSetWritePalette(renderer->cache, address >> 1, mColorFrom555(value));
+	}
+}
+
+void GBAVideoParallelRendererWriteOAM(struct GBAVideoRenderer* renderer, uint32_t oam) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+	_writeCommand(parallelRenderer, PARALLEL_OAM, oam, renderer->oam->raw[oam]);
+}
+
+void GBAVideoParallelRendererDrawScanline(struct GBAVideoRenderer* renderer, int y) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+	_flushVRAM(parallelRenderer);
+	_writeCommand(parallelRenderer, PARALLEL_SCANLINE, y, 0);
+	_publish(parallelRenderer, (y & 15) == 15);
+}
+
+void GBAVideoParallelRendererFinishFrame(struct GBAVideoRenderer* renderer) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+	_writeCommand(parallelRenderer, PARALLEL_FRAME, 0, 0);
+	_drain(parallelRenderer);
+	_syncWorkers(parallelRenderer);
+}
+
+static void GBAVideoParallelRendererGetPixels(struct GBAVideoRenderer* renderer, size_t* stride, const void** pixels) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+	_drain(parallelRenderer);
+	_syncWorkers(parallelRenderer);
+	struct GBAVideoRenderer* worker = &parallelRenderer->workers[0].renderer.d;
+	worker->getPixels(worker, stride, pixels);
+}
+
+static void GBAVideoParallelRendererPutPixels(struct GBAVideoRenderer* renderer, size_t stride, const void* pixels) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+	_drain(parallelRenderer);
+	_syncWorkers(parallelRenderer);
+	// The output buffer is shared, so any one worker can fill it in
+	struct GBAVideoRenderer* worker = &parallelRenderer->workers[0].renderer.d;
+	worker->putPixels(worker, stride, pixels);
+}
+
+#endif
@@ -214,6 +214,7 @@ static void _handleEvent(struct mVideoLogger* logger, enum mVideoLoggerEvent eve
 
 static bool _parsePacket(struct mVideoLogger* logger, const struct mVideoLoggerDirtyInfo* item) {
 	struct GBAVideoProxyRenderer* proxyRenderer = logger->context;
+	uint32_t address;
 	switch (item->type) {
 	case DIRTY_REGISTER:
 		proxyRenderer->backend->writeVideoRegister(proxyRenderer->backend, item->address, item->value);
@@ -238,6 +239,14 @@ static bool _parsePacket(struct mVideoLogger* logger, const struct mVideoLoggerD
 			logger->readData(logger, NULL, 0x1000, true);
 		}
 		break;
+	case DIRTY_VRAM_SWAP:
+		proxyRenderer->backend->vram = logger->vram;
+		for (address = 0; address < GBA_SIZE_VRAM; address += 0x1000) {
+			if (item->value & (1U << (address >> 12))) {
+				proxyRenderer->backend->writeVRAM(proxyRenderer->backend, address);
+			}
+		}
+		break;
 	case DIRTY_SCANLINE:
 		_copyExtraState(proxyRenderer);
 		if (item->address < GBA_VIDEO_VERTICAL_PIXELS) {
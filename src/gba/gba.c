@@ -14,6 +14,8 @@
 #include <mgba/internal/gba/io.h>
 #include <mgba/internal/gba/overrides.h>
 
+#include <mgba/core/shared-rom.h>
+
 #include <mgba-util/patch.h>
 #include <mgba-util/crc32.h>
 #include <mgba-util/math.h>
@@ -25,6 +27,8 @@
 #include <mgba-util/elf-read.h>
 #endif
 
+#include "gba/hle-bios.h"
+
 #define GBA_IRQ_DELAY 7
 
 mLOG_DEFINE_CATEGORY(GBA, "GBA", "gba");
@@ -127,6 +131,7 @@ static void GBAInit(void* cpu, struct mCPUComponent* component) {
 	gba->performingDMA = false;
 
 	gba->isPristine = false;
+	gba->romShared = false;
 	gba->pristineRomSize = 0;
 	gba->yankedRomSize = 0;
 
@@ -143,7 +148,12 @@ void GBAUnloadROM(struct GBA* gba) {
 	if (gba->memory.unl.type) {
 		GBAUnlCartUnload(gba);
 	}
-	if (gba->memory.rom && !gba->isPristine) {
+	if (gba->romShared) {
+		gba->yankedRomSize = 0;
+		mSharedROMRelease(gba->memory.rom);
+		gba->memory.rom = NULL;
+		gba->romShared = false;
+	} else if (gba->memory.rom && !gba->isPristine) {
 		if (gba->yankedRomSize) {
 			gba->yankedRomSize = 0;
 		}
@@ -165,6 +175,7 @@ void GBAUnloadROM(struct GBA* gba) {
 	gba->memory.romSize = 0;
 	gba->memory.romMask = 0;
 	gba->isPristine = false;
+	GBAMemoryUpdateFastRegions(gba);
 
 	if (!gba->memory.savedata.dirty) {
 		gba->memory.savedata.maskWriteback = false;
@@ -188,8 +199,9 @@ void GBADestroy(struct GBA* gba) {
 		gba->biosVf = 0;
 	}
 
-	GBAMemoryDeinit(gba);
+	// The renderer may still be using VRAM until it's deinitialized
 	GBAVideoDeinit(&gba->video);
+	GBAMemoryDeinit(gba);
 	GBAAudioDeinit(&gba->audio);
 	GBASIODeinit(&gba->sio);
 	mTimingDeinit(&gba->timing);
@@ -284,6 +296,7 @@ void GBAReset(struct ARMCore* cpu) {
 	if (GBAIsMB(gba->mbVf) && !isELF) {
 		gba->mbVf->seek(gba->mbVf, 0, SEEK_SET);
 		gba->mbVf->read(gba->mbVf, gba->memory.wram, GBA_SIZE_EWRAM);
+		GBAMemoryMarkDirty(&gba->memory);
 	}
 
 	gba->lastJump = 0;
@@ -398,6 +411,7 @@ bool GBALoadNull(struct GBA* gba) {
 	gba->memory.romSize = GBA_SIZE_ROM0;
 	gba->memory.romMask = GBA_SIZE_ROM0 - 1;
 	gba->romCrc32 = 0;
+	GBAMemoryUpdateFastRegions(gba);
 
 	if (gba->cpu) {
 		gba->cpu->memory.setActiveRegion(gba->cpu, gba->cpu->gprs[ARM_PC]);
@@ -412,6 +426,7 @@ bool GBALoadMB(struct GBA* gba, struct VFile* vf) {
 	vf->seek(vf, 0, SEEK_SET);
 	memset(gba->memory.wram, 0, GBA_SIZE_EWRAM);
 	off_t read = vf->read(vf, gba->memory.wram, GBA_SIZE_EWRAM);
+	GBAMemoryMarkDirty(&gba->memory);
 	if (read < 0) {
 		return false;
 	}
@@ -429,7 +444,7 @@ void GBAUnloadMB(struct GBA* gba) {
 	}
 }
 
-bool GBALoadROM(struct GBA* gba, struct VFile* vf) {
+static bool _GBALoadROM(struct GBA* gba, struct VFile* vf, const uint32_t* knownCrc32) {
 	if (!vf) {
 		return false;
 	}
@@ -479,7 +494,16 @@ bool GBALoadROM(struct GBA* gba, struct VFile* vf) {
 	}
 	gba->yankedRomSize = 0;
 	gba->memory.romMask = toPow2(gba->memory.romSize) - 1;
-	gba->romCrc32 = doCrc32(gba->memory.rom, gba->pristineRomSize);
+	if (knownCrc32 && gba->pristineRomSize == (size_t) vf->size(vf)) {
+		// A checksum of the file only stands in for one of the ROM if all of the file was loaded
+		gba->romCrc32 = *knownCrc32;
+	} else if (gba->isPristine) {
+		// Checksum the file instead of the mapping so that only the pages the game
+		// actually touches get faulted in
+		gba->romCrc32 = fileCrc32(vf, gba->pristineRomSize);
+	} else {
+		gba->romCrc32 = doCrc32(gba->memory.rom, gba->pristineRomSize);
+	}
 	if (popcount32(gba->memory.romSize) != 1) {
 		// This ROM is either a bad dump or homebrew. Emulate flash cart behavior.
 #ifndef FIXED_ROM_BUFFER
@@ -491,6 +515,29 @@ bool GBALoadROM(struct GBA* gba, struct VFile* vf) {
 		gba->memory.romMask = GBA_SIZE_ROM0 - 1;
 		gba->isPristine = false;
 	}
+#ifndef FIXED_ROM_BUFFER
+	if (gba->isPristine && mSharedROMIsEnabled()) {
+		void* sharedRom = mSharedROMAcquire(gba->memory.rom, gba->memory.romSize, GBA_SIZE_ROM0, gba->romCrc32);
+		if (sharedRom) {
+			vf->unmap(vf, gba->memory.rom, gba->pristineRomSize);
+			gba->memory.rom = sharedRom;
+			gba->romShared = true;
+		}
+	}
+	if (!gba->romShared) {
+		// Pull the ROM into the page cache in the background, rather than stalling on
+		// disk reads the first time the game touches each page
+		int advice = mMEMORY_ADVICE_READ_AHEAD;
+#ifdef ENABLE_HUGE_PAGES
+		if (!gba->isPristine) {
+			// Only the anonymous copies can use huge pages, not file mappings
+			advice |= mMEMORY_ADVICE_HUGE_PAGES;
+		}
+#endif
+		mappedMemoryAdvise(gba->memory.rom, gba->memory.romSize, advice);
+	}
+#endif
+	GBAMemoryUpdateFastRegions(gba);
 	if (gba->cpu && gba->memory.activeRegion >= GBA_REGION_ROM0) {
 		gba->cpu->memory.setActiveRegion(gba->cpu, gba->cpu->gprs[ARM_PC]);
 	}
@@ -500,6 +547,80 @@ bool GBALoadROM(struct GBA* gba, struct VFile* vf) {
 	return true;
 }
 
+bool GBALoadROM(struct GBA* gba, struct VFile* vf) {
+	return _GBALoadROM(gba, vf, NULL);
+}
+
+bool GBALoadROMKnownCrc32(struct GBA* gba, struct VFile* vf, uint32_t crc32) {
+	return _GBALoadROM(gba, vf, &crc32);
+}
+
+bool GBACloneROM(struct GBA* gba, const struct GBA* source) {
+#ifdef FIXED_ROM_BUFFER
+	UNUSED(gba);
+	UNUSED(source);
+	return false;
+#else
+	if (!source->memory.rom || source->mbVf || source->memory.unl.type == GBA_UNL_CART_MULTICART) {
+		return false;
+	}
+	GBAUnloadROM(gba);
+	void* rom = NULL;
+	if (source->romShared && source->isPristine) {
+		rom = mSharedROMDuplicate(source->memory.rom);
+	}
+	if (rom) {
+		gba->romShared = true;
+		gba->isPristine = true;
+	} else {
+		rom = anonymousMemoryMap(GBA_SIZE_ROM0);
+		if (!rom) {
+			return false;
+		}
+		size_t size = source->memory.romSize;
+		if (source->yankedRomSize) {
+			size = source->yankedRomSize;
+		}
+		memcpy(rom, source->memory.rom, size);
+		gba->isPristine = false;
+	}
+	gba->memory.rom = rom;
+	gba->memory.romSize = source->memory.romSize;
+	gba->memory.romMask = source->memory.romMask;
+	gba->pristineRomSize = source->pristineRomSize;
+	gba->yankedRomSize = source->yankedRomSize;
+	gba->romCrc32 = source->romCrc32;
+	GBAMemoryUpdateFastRegions(gba);
+	if (gba->cpu && gba->memory.activeRegion >= GBA_REGION_ROM0) {
+		gba->cpu->memory.setActiveRegion(gba->cpu, gba->cpu->gprs[ARM_PC]);
+	}
+	GBAHardwareInit(&gba->memory.hw, &((uint16_t*) gba->memory.rom)[GPIO_REG_DATA >> 1]);
+	GBAUnlCartDetect(gba);
+	return true;
+#endif
+}
+
+void GBACloneBIOS(struct GBA* gba, const struct GBA* source) {
+	if (!source->biosVf) {
+		if (gba->biosVf) {
+			gba->biosVf->unmap(gba->biosVf, gba->memory.bios, GBA_SIZE_BIOS);
+			gba->biosVf->close(gba->biosVf);
+			gba->biosVf = NULL;
+			gba->memory.bios = (uint32_t*) hleBios;
+			gba->memory.fullBios = 0;
+			gba->biosChecksum = GBAChecksum(gba->memory.bios, GBA_SIZE_BIOS);
+		}
+		return;
+	}
+	if (gba->biosVf && memcmp(gba->memory.bios, source->memory.bios, GBA_SIZE_BIOS) == 0) {
+		return;
+	}
+	struct VFile* vf = VFileMemChunk(source->memory.bios, GBA_SIZE_BIOS);
+	if (vf) {
+		GBALoadBIOS(gba, vf);
+	}
+}
+
 bool GBALoadSave(struct GBA* gba, struct VFile* sav) {
 	enum GBASavedataType type = gba->memory.savedata.type;
 	GBASavedataDeinit(&gba->memory.savedata);
@@ -514,6 +635,7 @@ void GBAYankROM(struct GBA* gba) {
 	gba->yankedRomSize = gba->memory.romSize;
 	gba->memory.romSize = 0;
 	gba->memory.romMask = 0;
+	GBAMemoryUpdateFastRegions(gba);
 	GBARaiseIRQ(gba, GBA_IRQ_GAMEPAK, 0);
 }
 
@@ -562,7 +684,10 @@ void GBAApplyPatch(struct GBA* gba, struct Patch* patch) {
 	}
 	if (gba->memory.rom) {
 #ifndef FIXED_ROM_BUFFER
-		if (!gba->isPristine) {
+		if (gba->romShared) {
+			mSharedROMRelease(gba->memory.rom);
+			gba->romShared = false;
+		} else if (!gba->isPristine) {
 			mappedMemoryFree(gba->memory.rom, gba->memory.romSize);
 		} else {
 			gba->romVf->unmap(gba->romVf, gba->memory.rom, gba->pristineRomSize);
@@ -575,6 +700,7 @@ void GBAApplyPatch(struct GBA* gba, struct Patch* patch) {
 	gba->memory.romSize = patchedSize;
 	gba->memory.romMask = toPow2(patchedSize) - 1;
 	gba->romCrc32 = doCrc32(gba->memory.rom, gba->memory.romSize);
+	GBAMemoryUpdateFastRegions(gba);
 }
 
 void GBARaiseIRQ(struct GBA* gba, enum GBAIRQ irq, uint32_t cyclesLate) {
@@ -24,7 +24,7 @@ const uint8_t hleBios[GBA_SIZE_BIOS] = {
 	0xb0, 0x01, 0x00, 0x00, 0xb4, 0x01, 0x00, 0x00, 0xb0, 0x01, 0x00, 0x00,
 	0xcc, 0x01, 0x00, 0x00, 0xc4, 0x01, 0x00, 0x00, 0x48, 0x03, 0x00, 0x00,
 	0x48, 0x03, 0x00, 0x00, 0x48, 0x03, 0x00, 0x00, 0x48, 0x03, 0x00, 0x00,
-	0x48, 0x03, 0x00, 0x00, 0x14, 0x02, 0x00, 0x00, 0xa8, 0x02, 0x00, 0x00,
+	0x48, 0x03, 0x00, 0x00, 0x8c, 0x04, 0x00, 0x00, 0x9c, 0x04, 0x00, 0x00,
 	0xb0, 0x01, 0x00, 0x00, 0xb0, 0x01, 0x00, 0x00, 0xb0, 0x01, 0x00, 0x00,
 	0xb0, 0x01, 0x00, 0x00, 0x48, 0x03, 0x00, 0x00, 0x48, 0x03, 0x00, 0x00,
 	0xb0, 0x01, 0x00, 0x00, 0xb0, 0x01, 0x00, 0x00, 0xb0, 0x01, 0x00, 0x00,
@@ -99,5 +99,9 @@ const uint8_t hleBios[GBA_SIZE_BIOS] = {
 	0x00, 0x10, 0xa0, 0xe3, 0x02, 0xe3, 0xa0, 0x03, 0x02, 0xe4, 0xa0, 0x13,
 	0x0e, 0xf0, 0xb0, 0xe1, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf0, 0x29, 0xe1,
 	0xf0, 0x7f, 0x00, 0x03, 0x00, 0x20, 0xfe, 0x09, 0x00, 0xc0, 0xff, 0x09,
-	0x00, 0x7f, 0x00, 0x03, 0xa0, 0x7f, 0x00, 0x03, 0xe0, 0x7f, 0x00, 0x03
+	0x00, 0x7f, 0x00, 0x03, 0xa0, 0x7f, 0x00, 0x03, 0xe0, 0x7f, 0x00, 0x03,
+	0x03, 0xb0, 0xb0, 0xe1, 0x5f, 0xff, 0xff, 0x0a, 0x17, 0x3e, 0xa0, 0xe3,
+	0xaa, 0xff, 0xff, 0xea, 0x03, 0xb0, 0xb0, 0xe1, 0x80, 0xff, 0xff, 0x0a,
+	0x01, 0x04, 0x12, 0xe3, 0x00, 0x30, 0x90, 0x15, 0x20, 0x30, 0x11, 0x05,
+	0xa4, 0xff, 0xff, 0xea
 };
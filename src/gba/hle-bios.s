@@ -77,8 +77,8 @@ swiTable:
 .word Sqrt                    @ 0x08
 .word ArcTan                  @ 0x09
 .word ArcTan2                 @ 0x0A
-.word CpuSet                  @ 0x0B
-.word CpuFastSet              @ 0x0C
+.word CpuSetStall             @ 0x0B
+.word CpuFastSetStall         @ 0x0C
 .word GetBiosChecksum         @ 0x0D
 .word BgAffineSet             @ 0x0E
 .word ObjAffineSet            @ 0x0F
@@ -398,3 +398,19 @@ movs  pc, lr
 .word 0xE129F000
 
 .ltorg
+
+@ CpuSet and CpuFastSet are done ahead of time when both ends are plain memory, in which case
+@ r3 holds how long to stall for. Otherwise it's 0, and they run here as usual.
+CpuSetStall:
+movs   r11, r3
+beq    CpuSet
+mov    r3, #0x170  @ Match official BIOS's clobbered r3
+b      StallCall
+
+CpuFastSetStall:
+movs   r11, r3
+beq    CpuFastSet
+tst    r2, #0x01000000
+ldrne  r3, [r0]
+ldreq  r3, [r1, #-32]
+b      StallCall
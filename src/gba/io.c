@@ -297,286 +297,487 @@ void GBAIOInit(struct GBA* gba) {
 	}
 }
 
-void GBAIOWrite(struct GBA* gba, uint32_t address, uint16_t value) {
-	if (address < GBA_REG_SOUND1CNT_LO && (address > GBA_REG_VCOUNT || address < GBA_REG_DISPSTAT)) {
-		gba->memory.io[address >> 1] = gba->video.renderer->writeVideoRegister(gba->video.renderer, address, value);
-		return;
+typedef void (*GBAIOWriteHandler)(struct GBA* gba, uint32_t address, uint16_t value);
+typedef uint32_t (*GBAIOWrite32Handler)(struct GBA* gba, uint32_t address, uint32_t value);
+typedef uint16_t (*GBAIOReadHandler)(struct GBA* gba, uint32_t address);
+
+enum GBAIOReadType {
+	IO_READ_UNUSED = 0,
+	IO_READ_PLAIN,
+	IO_READ_PSG,
+	IO_READ_ZERO,
+	IO_READ_UNUSED_ZERO,
+	IO_READ_WRITE_ONLY,
+	IO_READ_HANDLER,
+};
+
+// Registers without a write handler and with a nonzero write mask are stored directly.
+// Otherwise the write mask is applied before the handler is called, and the handler is
+// responsible for storing the register, if needed. Entries that are entirely zero are
+// unused registers.
+struct GBAIORegisterInfo {
+	uint8_t read;
+	bool readConstant;
+	uint16_t writeMask;
+	GBAIOReadHandler readHandler;
+	GBAIOWriteHandler write;
+	GBAIOWrite32Handler write32;
+};
+
+static void _writeDISPSTAT(struct GBA* gba, uint32_t address, uint16_t value) {
+	UNUSED(address);
+	GBAVideoWriteDISPSTAT(&gba->video, value);
+}
+
+static void _writeReadOnly(struct GBA* gba, uint32_t address, uint16_t value) {
+	UNUSED(gba);
+	UNUSED(value);
+	mLOG(GBA_IO, GAME_ERROR, "Write to read-only I/O register: %03X", address);
+}
+
+#define DEFINE_AUDIO_WRITE(REG, MASK) \
+	static void _write ## REG(struct GBA* gba, uint32_t address, uint16_t value) { \
+		GBAAudioWrite ## REG(&gba->audio, value); \
+		gba->memory.io[address >> 1] = value & MASK; \
 	}
 
-	if (address >= GBA_REG_SOUND1CNT_LO && address <= GBA_REG_SOUNDCNT_LO && !gba->audio.enable) {
-		// Ignore writes to most audio registers if the hardware is off.
-		return;
+DEFINE_AUDIO_WRITE(SOUND1CNT_LO, 0x007F)
+DEFINE_AUDIO_WRITE(SOUND1CNT_HI, 0xFFC0)
+DEFINE_AUDIO_WRITE(SOUND1CNT_X, 0x4000)
+DEFINE_AUDIO_WRITE(SOUND2CNT_LO, 0xFFC0)
+DEFINE_AUDIO_WRITE(SOUND2CNT_HI, 0x4000)
+DEFINE_AUDIO_WRITE(SOUND3CNT_LO, 0x00E0)
+DEFINE_AUDIO_WRITE(SOUND3CNT_HI, 0xE000)
+DEFINE_AUDIO_WRITE(SOUND3CNT_X, 0x4000)
+DEFINE_AUDIO_WRITE(SOUND4CNT_LO, 0xFF00)
+DEFINE_AUDIO_WRITE(SOUND4CNT_HI, 0x40FF)
+DEFINE_AUDIO_WRITE(SOUNDCNT_LO, 0xFF77)
+DEFINE_AUDIO_WRITE(SOUNDCNT_HI, 0x770F)
+DEFINE_AUDIO_WRITE(SOUNDBIAS, 0xFFFF)
+
+#undef DEFINE_AUDIO_WRITE
+
+static void _writeSOUNDCNT_X(struct GBA* gba, uint32_t address, uint16_t value) {
+	GBAAudioWriteSOUNDCNT_X(&gba->audio, value);
+	gba->memory.io[address >> 1] = (value & 0x0080) | (gba->memory.io[GBA_REG(SOUNDCNT_X)] & 0xF);
+}
+
+static uint32_t _writeWaveRAM(struct GBA* gba, uint32_t address, uint32_t value) {
+	GBAAudioWriteWaveRAM(&gba->audio, (address - GBA_REG_WAVE_RAM0_LO) >> 2, value);
+	return value;
+}
+
+static uint32_t _writeFIFO(struct GBA* gba, uint32_t address, uint32_t value) {
+	return GBAAudioWriteFIFO(&gba->audio, address, value);
+}
+
+static uint32_t _writeDMASAD(struct GBA* gba, uint32_t address, uint32_t value) {
+	return GBADMAWriteSAD(gba, (address - GBA_REG_DMA0SAD_LO) / 12, value);
+}
+
+static uint32_t _writeDMADAD(struct GBA* gba, uint32_t address, uint32_t value) {
+	return GBADMAWriteDAD(gba, (address - GBA_REG_DMA0DAD_LO) / 12, value);
+}
+
+static void _write32(struct GBA* gba, uint32_t address, uint32_t value);
+
+// Halves of 32-bit registers are combined with the other half and written together
+static void _writeLowHalf(struct GBA* gba, uint32_t address, uint16_t value) {
+	_write32(gba, address, (gba->memory.io[(address >> 1) + 1] << 16) | value);
+	gba->memory.io[address >> 1] = value;
+}
+
+static void _writeHighHalf(struct GBA* gba, uint32_t address, uint16_t value) {
+	_write32(gba, address - 2, gba->memory.io[(address >> 1) - 1] | (value << 16));
+	gba->memory.io[address >> 1] = value;
+}
+
+static void _writeFIFOLowHalf(struct GBA* gba, uint32_t address, uint16_t value) {
+	_write32(gba, address, (gba->memory.io[(address >> 1) + 1] << 16) | value);
+}
+
+static void _writeFIFOHighHalf(struct GBA* gba, uint32_t address, uint16_t value) {
+	_write32(gba, address - 2, gba->memory.io[(address >> 1) - 1] | (value << 16));
+}
+
+static void _writeDMACNT_LO(struct GBA* gba, uint32_t address, uint16_t value) {
+	int dma = (address - GBA_REG_DMA0CNT_LO) / 12;
+	GBADMAWriteCNT_LO(gba, dma, dma == 3 ? value : value & 0x3FFF);
+	gba->memory.io[address >> 1] = value;
+}
+
+static void _writeDMACNT_HI(struct GBA* gba, uint32_t address, uint16_t value) {
+	gba->memory.io[address >> 1] = GBADMAWriteCNT_HI(gba, (address - GBA_REG_DMA0CNT_HI) / 12, value);
+}
+
+static void _writeTMCNT_LO(struct GBA* gba, uint32_t address, uint16_t value) {
+	GBATimerWriteTMCNT_LO(gba, (address - GBA_REG_TM0CNT_LO) >> 2, value);
+}
+
+static void _writeTMCNT_HI(struct GBA* gba, uint32_t address, uint16_t value) {
+	GBATimerWriteTMCNT_HI(gba, (address - GBA_REG_TM0CNT_HI) >> 2, value);
+	gba->memory.io[address >> 1] = value;
+}
+
+static void _writeSIOCNT(struct GBA* gba, uint32_t address, uint16_t value) {
+	GBASIOWriteSIOCNT(&gba->sio, value);
+	gba->memory.io[address >> 1] = value;
+}
+
+static void _writeRCNT(struct GBA* gba, uint32_t address, uint16_t value) {
+	GBASIOWriteRCNT(&gba->sio, value);
+	gba->memory.io[address >> 1] = value;
+}
+
+static void _writeSIORegister(struct GBA* gba, uint32_t address, uint16_t value) {
+	gba->memory.io[address >> 1] = GBASIOWriteRegister(&gba->sio, address, value);
+}
+
+static void _writeJOY_TRANS(struct GBA* gba, uint32_t address, uint16_t value) {
+	gba->memory.io[GBA_REG(JOYSTAT)] |= JOYSTAT_TRANS;
+	gba->memory.io[address >> 1] = GBASIOWriteRegister(&gba->sio, address, value);
+}
+
+static void _writeKEYCNT(struct GBA* gba, uint32_t address, uint16_t value) {
+	if (gba->keysLast < 0x400) {
+		gba->keysLast &= gba->memory.io[address >> 1] | ~value;
 	}
+	gba->memory.io[address >> 1] = value;
+	GBATestKeypadIRQ(gba);
+}
 
-	switch (address) {
-	// Video
-	case GBA_REG_DISPSTAT:
-		value &= 0xFFF8;
-		GBAVideoWriteDISPSTAT(&gba->video, value);
-		return;
+static void _writeWAITCNT(struct GBA* gba, uint32_t address, uint16_t value) {
+	GBAAdjustWaitstates(gba, value);
+	gba->memory.io[address >> 1] = value;
+}
+
+static void _writeIE(struct GBA* gba, uint32_t address, uint16_t value) {
+	UNUSED(address);
+	gba->memory.io[GBA_REG(IE)] = value;
+	GBATestIRQ(gba, 1);
+}
+
+static void _writeIF(struct GBA* gba, uint32_t address, uint16_t value) {
+	UNUSED(address);
+	gba->memory.io[GBA_REG(IF)] &= ~value;
+	GBATestIRQ(gba, 1);
+}
+
+static void _writeIME(struct GBA* gba, uint32_t address, uint16_t value) {
+	UNUSED(address);
+	gba->memory.io[GBA_REG(IME)] = value;
+	GBATestIRQ(gba, 1);
+}
 
-	case GBA_REG_VCOUNT:
-		mLOG(GBA_IO, GAME_ERROR, "Write to read-only I/O register: %03X", address);
+static void _writePOSTFLG(struct GBA* gba, uint32_t address, uint16_t value) {
+	if (gba->memory.activeRegion != GBA_REGION_BIOS) {
+		mLOG(GBA_IO, GAME_ERROR, "Write to BIOS-only I/O register: %03X", address);
 		return;
+	}
+	if (gba->memory.io[address >> 1]) {
+		if (value & 0x8000) {
+			GBAStop(gba);
+		} else {
+			GBAHalt(gba);
+		}
+	}
+	gba->memory.io[address >> 1] = value & ~0x8000;
+}
 
-	// Audio
-	case GBA_REG_SOUND1CNT_LO:
-		GBAAudioWriteSOUND1CNT_LO(&gba->audio, value);
-		value &= 0x007F;
-		break;
-	case GBA_REG_SOUND1CNT_HI:
-		GBAAudioWriteSOUND1CNT_HI(&gba->audio, value);
-		value &= 0xFFC0;
-		break;
-	case GBA_REG_SOUND1CNT_X:
-		GBAAudioWriteSOUND1CNT_X(&gba->audio, value);
-		value &= 0x4000;
-		break;
-	case GBA_REG_SOUND2CNT_LO:
-		GBAAudioWriteSOUND2CNT_LO(&gba->audio, value);
-		value &= 0xFFC0;
-		break;
-	case GBA_REG_SOUND2CNT_HI:
-		GBAAudioWriteSOUND2CNT_HI(&gba->audio, value);
-		value &= 0x4000;
-		break;
-	case GBA_REG_SOUND3CNT_LO:
-		GBAAudioWriteSOUND3CNT_LO(&gba->audio, value);
-		value &= 0x00E0;
-		break;
-	case GBA_REG_SOUND3CNT_HI:
-		GBAAudioWriteSOUND3CNT_HI(&gba->audio, value);
-		value &= 0xE000;
-		break;
-	case GBA_REG_SOUND3CNT_X:
-		GBAAudioWriteSOUND3CNT_X(&gba->audio, value);
-		value &= 0x4000;
-		break;
-	case GBA_REG_SOUND4CNT_LO:
-		GBAAudioWriteSOUND4CNT_LO(&gba->audio, value);
-		value &= 0xFF00;
-		break;
-	case GBA_REG_SOUND4CNT_HI:
-		GBAAudioWriteSOUND4CNT_HI(&gba->audio, value);
-		value &= 0x40FF;
-		break;
-	case GBA_REG_SOUNDCNT_LO:
-		GBAAudioWriteSOUNDCNT_LO(&gba->audio, value);
-		value &= 0xFF77;
-		break;
-	case GBA_REG_SOUNDCNT_HI:
-		GBAAudioWriteSOUNDCNT_HI(&gba->audio, value);
-		value &= 0x770F;
-		break;
-	case GBA_REG_SOUNDCNT_X:
-		GBAAudioWriteSOUNDCNT_X(&gba->audio, value);
-		value &= 0x0080;
-		value |= gba->memory.io[GBA_REG(SOUNDCNT_X)] & 0xF;
-		break;
-	case GBA_REG_SOUNDBIAS:
-		value &= 0xC3FE;
-		GBAAudioWriteSOUNDBIAS(&gba->audio, value);
-		break;
+// Reading this takes two cycles (1N+1I), so let's remove them preemptively
+static uint16_t _readTMCNT_LO(struct GBA* gba, uint32_t address) {
+	GBATimerUpdateRegister(gba, (address - GBA_REG_TM0CNT_LO) >> 2, 2);
+	return gba->memory.io[address >> 1];
+}
 
-	case GBA_REG_WAVE_RAM0_LO:
-	case GBA_REG_WAVE_RAM1_LO:
-	case GBA_REG_WAVE_RAM2_LO:
-	case GBA_REG_WAVE_RAM3_LO:
-		GBAIOWrite32(gba, address, (gba->memory.io[(address >> 1) + 1] << 16) | value);
-		break;
+static uint16_t _readKEYINPUT(struct GBA* gba, uint32_t address) {
+	size_t c;
+	for (c = 0; c < mCoreCallbacksListSize(&gba->coreCallbacks); ++c) {
+		struct mCoreCallbacks* callbacks = mCoreCallbacksListGetPointer(&gba->coreCallbacks, c);
+		if (callbacks->keysRead) {
+			callbacks->keysRead(callbacks->context);
+		}
+	}
+	bool allowOpposingDirections = gba->allowOpposingDirections;
+	if (gba->keyCallback) {
+		gba->keysActive = gba->keyCallback->readKeys(gba->keyCallback);
+		if (!allowOpposingDirections) {
+			allowOpposingDirections = gba->keyCallback->requireOpposingDirections;
+		}
+	}
+	uint16_t input = gba->keysActive;
+	if (!allowOpposingDirections) {
+		unsigned rl = input & 0x030;
+		unsigned ud = input & 0x0C0;
+		input &= 0x30F;
+		if (rl != 0x030) {
+			input |= rl;
+		}
+		if (ud != 0x0C0) {
+			input |= ud;
+		}
+	}
+	gba->memory.io[address >> 1] = 0x3FF ^ input;
+	return gba->memory.io[address >> 1];
+}
 
-	case GBA_REG_WAVE_RAM0_HI:
-	case GBA_REG_WAVE_RAM1_HI:
-	case GBA_REG_WAVE_RAM2_HI:
-	case GBA_REG_WAVE_RAM3_HI:
-		GBAIOWrite32(gba, address - 2, gba->memory.io[(address >> 1) - 1] | (value << 16));
-		break;
+static uint16_t _readSIOCNT(struct GBA* gba, uint32_t address) {
+	UNUSED(address);
+	return gba->sio.siocnt;
+}
 
-	case GBA_REG_FIFO_A_LO:
-	case GBA_REG_FIFO_B_LO:
-		GBAIOWrite32(gba, address, (gba->memory.io[(address >> 1) + 1] << 16) | value);
-		return;
+static uint16_t _readRCNT(struct GBA* gba, uint32_t address) {
+	UNUSED(address);
+	return gba->sio.rcnt;
+}
 
-	case GBA_REG_FIFO_A_HI:
-	case GBA_REG_FIFO_B_HI:
-		GBAIOWrite32(gba, address - 2, gba->memory.io[(address >> 1) - 1] | (value << 16));
-		return;
+static uint16_t _readJOY_RECV(struct GBA* gba, uint32_t address) {
+	gba->memory.io[GBA_REG(JOYSTAT)] &= ~JOYSTAT_RECV;
+	return gba->memory.io[address >> 1];
+}
 
-	// DMA
-	case GBA_REG_DMA0SAD_LO:
-	case GBA_REG_DMA0DAD_LO:
-	case GBA_REG_DMA1SAD_LO:
-	case GBA_REG_DMA1DAD_LO:
-	case GBA_REG_DMA2SAD_LO:
-	case GBA_REG_DMA2DAD_LO:
-	case GBA_REG_DMA3SAD_LO:
-	case GBA_REG_DMA3DAD_LO:
-		GBAIOWrite32(gba, address, (gba->memory.io[(address >> 1) + 1] << 16) | value);
-		break;
+// Wave RAM can be written and read even if the audio hardware is disabled.
+// However, it is not possible to switch between the two banks because it
+// isn't possible to write to register SOUND3CNT_LO.
+static uint16_t _readWaveRAM(struct GBA* gba, uint32_t address) {
+	uint32_t value = GBAAudioReadWaveRAM(&gba->audio, (address - GBA_REG_WAVE_RAM0_LO) >> 2);
+	if (address & 2) {
+		return value >> 16;
+	}
+	return value & 0xFFFF;
+}
 
-	case GBA_REG_DMA0SAD_HI:
-	case GBA_REG_DMA0DAD_HI:
-	case GBA_REG_DMA1SAD_HI:
-	case GBA_REG_DMA1DAD_HI:
-	case GBA_REG_DMA2SAD_HI:
-	case GBA_REG_DMA2DAD_HI:
-	case GBA_REG_DMA3SAD_HI:
-	case GBA_REG_DMA3DAD_HI:
-		GBAIOWrite32(gba, address - 2, gba->memory.io[(address >> 1) - 1] | (value << 16));
-		break;
+#define PLAIN(MASK, WRITE) { .read = IO_READ_PLAIN, .writeMask = MASK, .write = WRITE }
+#define PLAIN_CONSTANT(MASK, WRITE) { .read = IO_READ_PLAIN, .readConstant = true, .writeMask = MASK, .write = WRITE }
+#define PSG(WRITE) { .read = IO_READ_PSG, .readConstant = true, .writeMask = 0xFFFF, .write = WRITE }
+#define WRITE_ONLY(WRITE, WRITE32) { .read = IO_READ_WRITE_ONLY, .writeMask = 0xFFFF, .write = WRITE, .write32 = WRITE32 }
+#define SPECIAL(READ, MASK, WRITE) { .read = IO_READ_HANDLER, .readHandler = READ, .writeMask = MASK, .write = WRITE }
+#define UNUSED_ZERO { .read = IO_READ_UNUSED_ZERO }
 
-	case GBA_REG_DMA0CNT_LO:
-		GBADMAWriteCNT_LO(gba, 0, value & 0x3FFF);
-		break;
-	case GBA_REG_DMA0CNT_HI:
-		value = GBADMAWriteCNT_HI(gba, 0, value);
-		break;
-	case GBA_REG_DMA1CNT_LO:
-		GBADMAWriteCNT_LO(gba, 1, value & 0x3FFF);
-		break;
-	case GBA_REG_DMA1CNT_HI:
-		value = GBADMAWriteCNT_HI(gba, 1, value);
-		break;
-	case GBA_REG_DMA2CNT_LO:
-		GBADMAWriteCNT_LO(gba, 2, value & 0x3FFF);
-		break;
-	case GBA_REG_DMA2CNT_HI:
-		value = GBADMAWriteCNT_HI(gba, 2, value);
-		break;
-	case GBA_REG_DMA3CNT_LO:
-		GBADMAWriteCNT_LO(gba, 3, value);
-		break;
-	case GBA_REG_DMA3CNT_HI:
-		value = GBADMAWriteCNT_HI(gba, 3, value);
-		break;
+// Video registers other than DISPSTAT and VCOUNT are written through the renderer,
+// so only their read behavior is described here.
+static const struct GBAIORegisterInfo _ioRegisters[GBA_SIZE_IO >> 1] = {
+	// Video
+	[GBA_REG(DISPCNT)] = PLAIN(0, NULL),
+	[GBA_REG(STEREOCNT)] = PLAIN(0, NULL),
+	[GBA_REG(DISPSTAT)] = PLAIN(0xFFF8, _writeDISPSTAT),
+	[GBA_REG(VCOUNT)] = PLAIN(0xFFFF, _writeReadOnly),
+	[GBA_REG(BG0CNT)] = PLAIN_CONSTANT(0, NULL),
+	[GBA_REG(BG1CNT)] = PLAIN_CONSTANT(0, NULL),
+	[GBA_REG(BG2CNT)] = PLAIN_CONSTANT(0, NULL),
+	[GBA_REG(BG3CNT)] = PLAIN_CONSTANT(0, NULL),
+	[GBA_REG(BG0HOFS)] = WRITE_ONLY(NULL, NULL),
+	[GBA_REG(BG0VOFS)] = WRITE_ONLY(NULL, NULL),
+	[GBA_REG(BG1HOFS)] = WRITE_ONLY(NULL, NULL),
+	[GBA_REG(BG1VOFS)] = WRITE_ONLY(NULL, NULL),
+	[GBA_REG(BG2HOFS)] = WRITE_ONLY(NULL, NULL),
+	[GBA_REG(BG2VOFS)] = WRITE_ONLY(NULL, NULL),
+	[GBA_REG(BG3HOFS)] = WRITE_ONLY(NULL, NULL),
+	[GBA_REG(BG3VOFS)] = WRITE_ONLY(NULL, NULL),
+	[GBA_REG(BG2PA)] = WRITE_ONLY(NULL, NULL),
+	[GBA_REG(BG2PB)] = WRITE_ONLY(NULL, NULL),
+	[GBA_REG(BG2PC)] = WRITE_ONLY(NULL, NULL),
+	[GBA_REG(BG2PD)] = WRITE_ONLY(NULL, NULL),
+	[GBA_REG(BG2X_LO)] = WRITE_ONLY(NULL, NULL),
+	[GBA_REG(BG2X_HI)] = WRITE_ONLY(NULL, NULL),
+	[GBA_REG(BG2Y_LO)] = WRITE_ONLY(NULL, NULL),
+	[GBA_REG(BG2Y_HI)] = WRITE_ONLY(NULL, NULL),
+	[GBA_REG(BG3PA)] = WRITE_ONLY(NULL, NULL),
+	[GBA_REG(BG3PB)] = WRITE_ONLY(NULL, NULL),
+	[GBA_REG(BG3PC)] = WRITE_ONLY(NULL, NULL),
+	[GBA_REG(BG3PD)] = WRITE_ONLY(NULL, NULL),
+	[GBA_REG(BG3X_LO)] = WRITE_ONLY(NULL, NULL),
+	[GBA_REG(BG3X_HI)] = WRITE_ONLY(NULL, NULL),
+	[GBA_REG(BG3Y_LO)] = WRITE_ONLY(NULL, NULL),
+	[GBA_REG(BG3Y_HI)] = WRITE_ONLY(NULL, NULL),
+	[GBA_REG(WIN0H)] = WRITE_ONLY(NULL, NULL),
+	[GBA_REG(WIN1H)] = WRITE_ONLY(NULL, NULL),
+	[GBA_REG(WIN0V)] = WRITE_ONLY(NULL, NULL),
+	[GBA_REG(WIN1V)] = WRITE_ONLY(NULL, NULL),
+	[GBA_REG(WININ)] = PLAIN_CONSTANT(0, NULL),
+	[GBA_REG(WINOUT)] = PLAIN_CONSTANT(0, NULL),
+	[GBA_REG(MOSAIC)] = WRITE_ONLY(NULL, NULL),
+	[GBA_REG(BLDCNT)] = PLAIN_CONSTANT(0, NULL),
+	[GBA_REG(BLDALPHA)] = PLAIN_CONSTANT(0, NULL),
+	[GBA_REG(BLDY)] = WRITE_ONLY(NULL, NULL),
 
-	// Timers
-	case GBA_REG_TM0CNT_LO:
-		GBATimerWriteTMCNT_LO(gba, 0, value);
-		return;
-	case GBA_REG_TM1CNT_LO:
-		GBATimerWriteTMCNT_LO(gba, 1, value);
-		return;
-	case GBA_REG_TM2CNT_LO:
-		GBATimerWriteTMCNT_LO(gba, 2, value);
-		return;
-	case GBA_REG_TM3CNT_LO:
-		GBATimerWriteTMCNT_LO(gba, 3, value);
-		return;
+	// Audio
+	[GBA_REG(SOUND1CNT_LO)] = PSG(_writeSOUND1CNT_LO),
+	[GBA_REG(SOUND1CNT_HI)] = PSG(_writeSOUND1CNT_HI),
+	[GBA_REG(SOUND1CNT_X)] = PSG(_writeSOUND1CNT_X),
+	[0x066 >> 1] = UNUSED_ZERO,
+	[GBA_REG(SOUND2CNT_LO)] = PSG(_writeSOUND2CNT_LO),
+	[0x06A >> 1] = UNUSED_ZERO,
+	[GBA_REG(SOUND2CNT_HI)] = PSG(_writeSOUND2CNT_HI),
+	[0x06E >> 1] = UNUSED_ZERO,
+	[GBA_REG(SOUND3CNT_LO)] = PSG(_writeSOUND3CNT_LO),
+	[GBA_REG(SOUND3CNT_HI)] = PSG(_writeSOUND3CNT_HI),
+	[GBA_REG(SOUND3CNT_X)] = PSG(_writeSOUND3CNT_X),
+	[0x076 >> 1] = UNUSED_ZERO,
+	[GBA_REG(SOUND4CNT_LO)] = PSG(_writeSOUND4CNT_LO),
+	[0x07A >> 1] = UNUSED_ZERO,
+	[GBA_REG(SOUND4CNT_HI)] = PSG(_writeSOUND4CNT_HI),
+	[0x07E >> 1] = UNUSED_ZERO,
+	[GBA_REG(SOUNDCNT_LO)] = PSG(_writeSOUNDCNT_LO),
+	[GBA_REG(SOUNDCNT_HI)] = PLAIN_CONSTANT(0xFFFF, _writeSOUNDCNT_HI),
+	[GBA_REG(SOUNDCNT_X)] = PLAIN(0xFFFF, _writeSOUNDCNT_X),
+	[0x086 >> 1] = UNUSED_ZERO,
+	[GBA_REG(SOUNDBIAS)] = PLAIN(0xC3FE, _writeSOUNDBIAS),
+	[0x08A >> 1] = UNUSED_ZERO,
+	[GBA_REG(WAVE_RAM0_LO)] = { .read = IO_READ_HANDLER, .readHandler = _readWaveRAM, .writeMask = 0xFFFF, .write = _writeLowHalf, .write32 = _writeWaveRAM },
+	[GBA_REG(WAVE_RAM0_HI)] = SPECIAL(_readWaveRAM, 0xFFFF, _writeHighHalf),
+	[GBA_REG(WAVE_RAM1_LO)] = { .read = IO_READ_HANDLER, .readHandler = _readWaveRAM, .writeMask = 0xFFFF, .write = _writeLowHalf, .write32 = _writeWaveRAM },
+	[GBA_REG(WAVE_RAM1_HI)] = SPECIAL(_readWaveRAM, 0xFFFF, _writeHighHalf),
+	[GBA_REG(WAVE_RAM2_LO)] = { .read = IO_READ_HANDLER, .readHandler = _readWaveRAM, .writeMask = 0xFFFF, .write = _writeLowHalf, .write32 = _writeWaveRAM },
+	[GBA_REG(WAVE_RAM2_HI)] = SPECIAL(_readWaveRAM, 0xFFFF, _writeHighHalf),
+	[GBA_REG(WAVE_RAM3_LO)] = { .read = IO_READ_HANDLER, .readHandler = _readWaveRAM, .writeMask = 0xFFFF, .write = _writeLowHalf, .write32 = _writeWaveRAM },
+	[GBA_REG(WAVE_RAM3_HI)] = SPECIAL(_readWaveRAM, 0xFFFF, _writeHighHalf),
+	[GBA_REG(FIFO_A_LO)] = WRITE_ONLY(_writeFIFOLowHalf, _writeFIFO),
+	[GBA_REG(FIFO_A_HI)] = WRITE_ONLY(_writeFIFOHighHalf, NULL),
+	[GBA_REG(FIFO_B_LO)] = WRITE_ONLY(_writeFIFOLowHalf, _writeFIFO),
+	[GBA_REG(FIFO_B_HI)] = WRITE_ONLY(_writeFIFOHighHalf, NULL),
 
-	case GBA_REG_TM0CNT_HI:
-		value &= 0x00C7;
-		GBATimerWriteTMCNT_HI(gba, 0, value);
-		break;
-	case GBA_REG_TM1CNT_HI:
-		value &= 0x00C7;
-		GBATimerWriteTMCNT_HI(gba, 1, value);
-		break;
-	case GBA_REG_TM2CNT_HI:
-		value &= 0x00C7;
-		GBATimerWriteTMCNT_HI(gba, 2, value);
-		break;
-	case GBA_REG_TM3CNT_HI:
-		value &= 0x00C7;
-		GBATimerWriteTMCNT_HI(gba, 3, value);
-		break;
+	// DMA
+	[GBA_REG(DMA0SAD_LO)] = WRITE_ONLY(_writeLowHalf, _writeDMASAD),
+	[GBA_REG(DMA0SAD_HI)] = WRITE_ONLY(_writeHighHalf, NULL),
+	[GBA_REG(DMA0DAD_LO)] = WRITE_ONLY(_writeLowHalf, _writeDMADAD),
+	[GBA_REG(DMA0DAD_HI)] = WRITE_ONLY(_writeHighHalf, NULL),
+	[GBA_REG(DMA0CNT_LO)] = { .read = IO_READ_ZERO, .writeMask = 0xFFFF, .write = _writeDMACNT_LO },
+	[GBA_REG(DMA0CNT_HI)] = PLAIN(0xFFFF, _writeDMACNT_HI),
+	[GBA_REG(DMA1SAD_LO)] = WRITE_ONLY(_writeLowHalf, _writeDMASAD),
+	[GBA_REG(DMA1SAD_HI)] = WRITE_ONLY(_writeHighHalf, NULL),
+	[GBA_REG(DMA1DAD_LO)] = WRITE_ONLY(_writeLowHalf, _writeDMADAD),
+	[GBA_REG(DMA1DAD_HI)] = WRITE_ONLY(_writeHighHalf, NULL),
+	[GBA_REG(DMA1CNT_LO)] = { .read = IO_READ_ZERO, .writeMask = 0xFFFF, .write = _writeDMACNT_LO },
+	[GBA_REG(DMA1CNT_HI)] = PLAIN(0xFFFF, _writeDMACNT_HI),
+	[GBA_REG(DMA2SAD_LO)] = WRITE_ONLY(_writeLowHalf, _writeDMASAD),
+	[GBA_REG(DMA2SAD_HI)] = WRITE_ONLY(_writeHighHalf, NULL),
+	[GBA_REG(DMA2DAD_LO)] = WRITE_ONLY(_writeLowHalf, _writeDMADAD),
+	[GBA_REG(DMA2DAD_HI)] = WRITE_ONLY(_writeHighHalf, NULL),
+	[GBA_REG(DMA2CNT_LO)] = { .read = IO_READ_ZERO, .writeMask = 0xFFFF, .write = _writeDMACNT_LO },
+	[GBA_REG(DMA2CNT_HI)] = PLAIN(0xFFFF, _writeDMACNT_HI),
+	[GBA_REG(DMA3SAD_LO)] = WRITE_ONLY(_writeLowHalf, _writeDMASAD),
+	[GBA_REG(DMA3SAD_HI)] = WRITE_ONLY(_writeHighHalf, NULL),
+	[GBA_REG(DMA3DAD_LO)] = WRITE_ONLY(_writeLowHalf, _writeDMADAD),
+	[GBA_REG(DMA3DAD_HI)] = WRITE_ONLY(_writeHighHalf, NULL),
+	[GBA_REG(DMA3CNT_LO)] = { .read = IO_READ_ZERO, .writeMask = 0xFFFF, .write = _writeDMACNT_LO },
+	[GBA_REG(DMA3CNT_HI)] = PLAIN(0xFFFF, _writeDMACNT_HI),
+
+	// Timers
+	[GBA_REG(TM0CNT_LO)] = SPECIAL(_readTMCNT_LO, 0xFFFF, _writeTMCNT_LO),
+	[GBA_REG(TM0CNT_HI)] = PLAIN_CONSTANT(0x00C7, _writeTMCNT_HI),
+	[GBA_REG(TM1CNT_LO)] = SPECIAL(_readTMCNT_LO, 0xFFFF, _writeTMCNT_LO),
+	[GBA_REG(TM1CNT_HI)] = PLAIN_CONSTANT(0x00C7, _writeTMCNT_HI),
+	[GBA_REG(TM2CNT_LO)] = SPECIAL(_readTMCNT_LO, 0xFFFF, _writeTMCNT_LO),
+	[GBA_REG(TM2CNT_HI)] = PLAIN_CONSTANT(0x00C7, _writeTMCNT_HI),
+	[GBA_REG(TM3CNT_LO)] = SPECIAL(_readTMCNT_LO, 0xFFFF, _writeTMCNT_LO),
+	[GBA_REG(TM3CNT_HI)] = PLAIN_CONSTANT(0x00C7, _writeTMCNT_HI),
 
 	// SIO
-	case GBA_REG_SIOCNT:
-		value &= 0x7FFF;
-		GBASIOWriteSIOCNT(&gba->sio, value);
-		break;
-	case GBA_REG_RCNT:
-		value &= 0xC1FF;
-		GBASIOWriteRCNT(&gba->sio, value);
-		break;
-	case GBA_REG_JOY_TRANS_LO:
-	case GBA_REG_JOY_TRANS_HI:
-		gba->memory.io[GBA_REG(JOYSTAT)] |= JOYSTAT_TRANS;
-		// Fall through
-	case GBA_REG_SIODATA32_LO:
-	case GBA_REG_SIODATA32_HI:
-	case GBA_REG_SIOMLT_SEND:
-	case GBA_REG_JOYCNT:
-	case GBA_REG_JOYSTAT:
-	case GBA_REG_JOY_RECV_LO:
-	case GBA_REG_JOY_RECV_HI:
-		value = GBASIOWriteRegister(&gba->sio, address, value);
-		break;
+	[GBA_REG(SIOMULTI0)] = PLAIN(0xFFFF, _writeSIORegister),
+	[GBA_REG(SIOMULTI1)] = PLAIN(0xFFFF, _writeSIORegister),
+	[GBA_REG(SIOMULTI2)] = { .read = IO_READ_PLAIN },
+	[GBA_REG(SIOMULTI3)] = { .read = IO_READ_PLAIN },
+	[GBA_REG(SIOCNT)] = SPECIAL(_readSIOCNT, 0x7FFF, _writeSIOCNT),
+	[GBA_REG(SIOMLT_SEND)] = PLAIN(0xFFFF, _writeSIORegister),
+	[GBA_REG(KEYINPUT)] = { .read = IO_READ_HANDLER, .readConstant = true, .readHandler = _readKEYINPUT },
+	[GBA_REG(KEYCNT)] = PLAIN_CONSTANT(0xC3FF, _writeKEYCNT),
+	[GBA_REG(RCNT)] = SPECIAL(_readRCNT, 0xC1FF, _writeRCNT),
+	[0x136 >> 1] = UNUSED_ZERO,
+	[GBA_REG(JOYCNT)] = PLAIN(0xFFFF, _writeSIORegister),
+	[0x142 >> 1] = UNUSED_ZERO,
+	[GBA_REG(JOY_RECV_LO)] = SPECIAL(_readJOY_RECV, 0xFFFF, _writeSIORegister),
+	[GBA_REG(JOY_RECV_HI)] = SPECIAL(_readJOY_RECV, 0xFFFF, _writeSIORegister),
+	[GBA_REG(JOY_TRANS_LO)] = PLAIN(0xFFFF, _writeJOY_TRANS),
+	[GBA_REG(JOY_TRANS_HI)] = PLAIN(0xFFFF, _writeJOY_TRANS),
+	[GBA_REG(JOYSTAT)] = PLAIN(0xFFFF, _writeSIORegister),
+	[0x15A >> 1] = UNUSED_ZERO,
 
-	// Interrupts and misc
-	case GBA_REG_KEYCNT:
-		value &= 0xC3FF;
-		if (gba->keysLast < 0x400) {
-			gba->keysLast &= gba->memory.io[address >> 1] | ~value;
-		}
-		gba->memory.io[address >> 1] = value;
-		GBATestKeypadIRQ(gba);
-		return;
-	case GBA_REG_WAITCNT:
-		value &= 0x5FFF;
-		GBAAdjustWaitstates(gba, value);
-		break;
-	case GBA_REG_IE:
-		gba->memory.io[GBA_REG(IE)] = value;
-		GBATestIRQ(gba, 1);
-		return;
-	case GBA_REG_IF:
-		value = gba->memory.io[GBA_REG(IF)] & ~value;
-		gba->memory.io[GBA_REG(IF)] = value;
-		GBATestIRQ(gba, 1);
+	// Interrupts, etc
+	[GBA_REG(IE)] = PLAIN_CONSTANT(0xFFFF, _writeIE),
+	[GBA_REG(IF)] = PLAIN(0xFFFF, _writeIF),
+	[GBA_REG(WAITCNT)] = PLAIN(0x5FFF, _writeWAITCNT),
+	[0x206 >> 1] = UNUSED_ZERO,
+	[GBA_REG(IME)] = PLAIN(0x0001, _writeIME),
+	// Some bad interrupt libraries will read from and write to this
+	[GBA_REG(MAX)] = { .read = IO_READ_ZERO, .writeMask = 0xFFFF },
+	[GBA_REG(POSTFLG)] = PLAIN(0xFFFF, _writePOSTFLG),
+	[0x302 >> 1] = UNUSED_ZERO,
+};
+
+#undef PLAIN
+#undef PLAIN_CONSTANT
+#undef PSG
+#undef WRITE_ONLY
+#undef SPECIAL
+#undef UNUSED_ZERO
+
+static void _write32(struct GBA* gba, uint32_t address, uint32_t value) {
+	value = _ioRegisters[address >> 1].write32(gba, address, value);
+	gba->memory.io[address >> 1] = value;
+	gba->memory.io[(address >> 1) + 1] = value >> 16;
+}
+
+static void _writeUnused(struct GBA* gba, uint32_t address, uint16_t value) {
+	if (address >= GBA_REG_DEBUG_STRING && address - GBA_REG_DEBUG_STRING < sizeof(gba->debugString)) {
+		STORE_16LE(value, address - GBA_REG_DEBUG_STRING, gba->debugString);
 		return;
-	case GBA_REG_IME:
-		gba->memory.io[GBA_REG(IME)] = value & 1;
-		GBATestIRQ(gba, 1);
+	}
+	mLOG(GBA_IO, STUB, "Stub I/O register write: %03X", address);
+	if (address >= GBA_REG_MAX) {
+		mLOG(GBA_IO, GAME_ERROR, "Write to unused I/O register: %03X", address);
 		return;
-	case GBA_REG_MAX:
-		// Some bad interrupt libraries will write to this
-		break;
-	case GBA_REG_POSTFLG:
-		if (gba->memory.activeRegion == GBA_REGION_BIOS) {
-			if (gba->memory.io[address >> 1]) {
-				if (value & 0x8000) {
-					GBAStop(gba);
-				} else {
-					GBAHalt(gba);
-				}
-			}
-			value &= ~0x8000;
-		} else {
-			mLOG(GBA_IO, GAME_ERROR, "Write to BIOS-only I/O register: %03X", address);
-			return;
-		}
-		break;
+	}
+	gba->memory.io[address >> 1] = value;
+}
+
+// These registers sit outside of the normal I/O block
+static void _writeExternal(struct GBA* gba, uint32_t address, uint16_t value) {
+	switch (address) {
 	case GBA_REG_EXWAITCNT_HI:
-		// This register sits outside of the normal I/O block, so we need to stash it somewhere unused
-		address = GBA_REG_INTERNAL_EXWAITCNT_HI;
+		// We need to stash this register somewhere unused
 		value &= 0xFF00;
 		GBAAdjustEWRAMWaitstates(gba, value);
-		break;
+		gba->memory.io[GBA_REG(INTERNAL_EXWAITCNT_HI)] = value;
+		return;
 	case GBA_REG_DEBUG_ENABLE:
 		gba->debug = value == 0xC0DE;
 		return;
 	case GBA_REG_DEBUG_FLAGS:
 		if (gba->debug) {
 			GBADebug(gba, value);
-
-			return;
-		}
-		// Fall through
-	default:
-		if (address >= GBA_REG_DEBUG_STRING && address - GBA_REG_DEBUG_STRING < sizeof(gba->debugString)) {
-			STORE_16LE(value, address - GBA_REG_DEBUG_STRING, gba->debugString);
-			return;
-		}
-		mLOG(GBA_IO, STUB, "Stub I/O register write: %03X", address);
-		if (address >= GBA_REG_MAX) {
-			mLOG(GBA_IO, GAME_ERROR, "Write to unused I/O register: %03X", address);
 			return;
 		}
 		break;
 	}
-	gba->memory.io[address >> 1] = value;
+	_writeUnused(gba, address, value);
+}
+
+void GBAIOWrite(struct GBA* gba, uint32_t address, uint16_t value) {
+	gba->memory.ioDirty = gba->memory.dirtyGeneration;
+	if (address < GBA_REG_SOUND1CNT_LO && (address > GBA_REG_VCOUNT || address < GBA_REG_DISPSTAT)) {
+		gba->memory.io[address >> 1] = gba->video.renderer->writeVideoRegister(gba->video.renderer, address, value);
+		return;
+	}
+
+	if (address >= GBA_REG_SOUND1CNT_LO && address <= GBA_REG_SOUNDCNT_LO && !gba->audio.enable) {
+		// Ignore writes to most audio registers if the hardware is off.
+		return;
+	}
+
+	if (address >= GBA_SIZE_IO) {
+		_writeExternal(gba, address, value);
+		return;
+	}
+
+	const struct GBAIORegisterInfo* info = &_ioRegisters[address >> 1];
+	if (info->write) {
+		info->write(gba, address, value & info->writeMask);
+	} else if (info->writeMask) {
+		gba->memory.io[address >> 1] = value & info->writeMask;
+	} else {
+		_writeUnused(gba, address, value);
+	}
 }
 
 void GBAIOWrite8(struct GBA* gba, uint32_t address, uint8_t value) {
@@ -680,329 +881,79 @@ void GBAIOWrite8(struct GBA* gba, uint32_t address, uint8_t value) {
 }
 
 void GBAIOWrite32(struct GBA* gba, uint32_t address, uint32_t value) {
-	switch (address) {
-	// Wave RAM can be written and read even if the audio hardware is disabled.
-	// However, it is not possible to switch between the two banks because it
-	// isn't possible to write to register SOUND3CNT_LO.
-	case GBA_REG_WAVE_RAM0_LO:
-		GBAAudioWriteWaveRAM(&gba->audio, 0, value);
-		break;
-	case GBA_REG_WAVE_RAM1_LO:
-		GBAAudioWriteWaveRAM(&gba->audio, 1, value);
-		break;
-	case GBA_REG_WAVE_RAM2_LO:
-		GBAAudioWriteWaveRAM(&gba->audio, 2, value);
-		break;
-	case GBA_REG_WAVE_RAM3_LO:
-		GBAAudioWriteWaveRAM(&gba->audio, 3, value);
-		break;
-	case GBA_REG_FIFO_A_LO:
-	case GBA_REG_FIFO_B_LO:
-		value = GBAAudioWriteFIFO(&gba->audio, address, value);
-		break;
-	case GBA_REG_DMA0SAD_LO:
-		value = GBADMAWriteSAD(gba, 0, value);
-		break;
-	case GBA_REG_DMA0DAD_LO:
-		value = GBADMAWriteDAD(gba, 0, value);
-		break;
-	case GBA_REG_DMA1SAD_LO:
-		value = GBADMAWriteSAD(gba, 1, value);
-		break;
-	case GBA_REG_DMA1DAD_LO:
-		value = GBADMAWriteDAD(gba, 1, value);
-		break;
-	case GBA_REG_DMA2SAD_LO:
-		value = GBADMAWriteSAD(gba, 2, value);
-		break;
-	case GBA_REG_DMA2DAD_LO:
-		value = GBADMAWriteDAD(gba, 2, value);
-		break;
-	case GBA_REG_DMA3SAD_LO:
-		value = GBADMAWriteSAD(gba, 3, value);
-		break;
-	case GBA_REG_DMA3DAD_LO:
-		value = GBADMAWriteDAD(gba, 3, value);
-		break;
-	default:
-		if (address >= GBA_REG_DEBUG_STRING && address - GBA_REG_DEBUG_STRING < sizeof(gba->debugString)) {
-			STORE_32LE(value, address - GBA_REG_DEBUG_STRING, gba->debugString);
-			return;
-		}
-		GBAIOWrite(gba, address, value & 0xFFFF);
-		GBAIOWrite(gba, address | 2, value >> 16);
+	if (address < GBA_SIZE_IO && _ioRegisters[address >> 1].write32) {
+		gba->memory.ioDirty = gba->memory.dirtyGeneration;
+		_write32(gba, address, value);
 		return;
 	}
-	gba->memory.io[address >> 1] = value;
-	gba->memory.io[(address >> 1) + 1] = value >> 16;
+	if (address >= GBA_REG_DEBUG_STRING && address - GBA_REG_DEBUG_STRING < sizeof(gba->debugString)) {
+		STORE_32LE(value, address - GBA_REG_DEBUG_STRING, gba->debugString);
+		return;
+	}
+	GBAIOWrite(gba, address, value & 0xFFFF);
+	GBAIOWrite(gba, address | 2, value >> 16);
 }
 
 bool GBAIOIsReadConstant(uint32_t address) {
-	switch (address) {
-	default:
+	if (address >= GBA_SIZE_IO || (address & 1)) {
 		return false;
-	case GBA_REG_BG0CNT:
-	case GBA_REG_BG1CNT:
-	case GBA_REG_BG2CNT:
-	case GBA_REG_BG3CNT:
-	case GBA_REG_WININ:
-	case GBA_REG_WINOUT:
-	case GBA_REG_BLDCNT:
-	case GBA_REG_BLDALPHA:
-	case GBA_REG_SOUND1CNT_LO:
-	case GBA_REG_SOUND1CNT_HI:
-	case GBA_REG_SOUND1CNT_X:
-	case GBA_REG_SOUND2CNT_LO:
-	case GBA_REG_SOUND2CNT_HI:
-	case GBA_REG_SOUND3CNT_LO:
-	case GBA_REG_SOUND3CNT_HI:
-	case GBA_REG_SOUND3CNT_X:
-	case GBA_REG_SOUND4CNT_LO:
-	case GBA_REG_SOUND4CNT_HI:
-	case GBA_REG_SOUNDCNT_LO:
-	case GBA_REG_SOUNDCNT_HI:
-	case GBA_REG_TM0CNT_HI:
-	case GBA_REG_TM1CNT_HI:
-	case GBA_REG_TM2CNT_HI:
-	case GBA_REG_TM3CNT_HI:
-	case GBA_REG_KEYINPUT:
-	case GBA_REG_KEYCNT:
-	case GBA_REG_IE:
-		return true;
 	}
+	return _ioRegisters[address >> 1].readConstant;
 }
 
-uint16_t GBAIORead(struct GBA* gba, uint32_t address) {
-	if (!GBAIOIsReadConstant(address)) {
-		// Most IO reads need to disable idle removal
-		gba->haltPending = false;
-	}
-
+static uint16_t _readExternal(struct GBA* gba, uint32_t address) {
 	switch (address) {
-	// Reading this takes two cycles (1N+1I), so let's remove them preemptively
-	case GBA_REG_TM0CNT_LO:
-		GBATimerUpdateRegister(gba, 0, 2);
-		break;
-	case GBA_REG_TM1CNT_LO:
-		GBATimerUpdateRegister(gba, 1, 2);
-		break;
-	case GBA_REG_TM2CNT_LO:
-		GBATimerUpdateRegister(gba, 2, 2);
-		break;
-	case GBA_REG_TM3CNT_LO:
-		GBATimerUpdateRegister(gba, 3, 2);
-		break;
-
-	case GBA_REG_KEYINPUT: {
-			size_t c;
-			for (c = 0; c < mCoreCallbacksListSize(&gba->coreCallbacks); ++c) {
-				struct mCoreCallbacks* callbacks = mCoreCallbacksListGetPointer(&gba->coreCallbacks, c);
-				if (callbacks->keysRead) {
-					callbacks->keysRead(callbacks->context);
-				}
-			}
-			bool allowOpposingDirections = gba->allowOpposingDirections;
-			if (gba->keyCallback) {
-				gba->keysActive = gba->keyCallback->readKeys(gba->keyCallback);
-				if (!allowOpposingDirections) {
-					allowOpposingDirections = gba->keyCallback->requireOpposingDirections;
-				}
-			}
-			uint16_t input = gba->keysActive;
-			if (!allowOpposingDirections) {
-				unsigned rl = input & 0x030;
-				unsigned ud = input & 0x0C0;
-				input &= 0x30F;
-				if (rl != 0x030) {
-					input |= rl;
-				}
-				if (ud != 0x0C0) {
-					input |= ud;
-				}
-			}
-			gba->memory.io[address >> 1] = 0x3FF ^ input;
+	// These registers sit outside of the normal I/O block, so we need to stash them somewhere unused
+	case GBA_REG_EXWAITCNT_LO:
+	case GBA_REG_EXWAITCNT_HI:
+		return gba->memory.io[(address + GBA_REG_INTERNAL_EXWAITCNT_LO - GBA_REG_EXWAITCNT_LO) >> 1];
+	case GBA_REG_DEBUG_ENABLE:
+		if (gba->debug) {
+			return 0x1DEA;
 		}
 		break;
-	case GBA_REG_SIOCNT:
-		return gba->sio.siocnt;
-	case GBA_REG_RCNT:
-		return gba->sio.rcnt;
-
-	case GBA_REG_BG0HOFS:
-	case GBA_REG_BG0VOFS:
-	case GBA_REG_BG1HOFS:
-	case GBA_REG_BG1VOFS:
-	case GBA_REG_BG2HOFS:
-	case GBA_REG_BG2VOFS:
-	case GBA_REG_BG3HOFS:
-	case GBA_REG_BG3VOFS:
-	case GBA_REG_BG2PA:
-	case GBA_REG_BG2PB:
-	case GBA_REG_BG2PC:
-	case GBA_REG_BG2PD:
-	case GBA_REG_BG2X_LO:
-	case GBA_REG_BG2X_HI:
-	case GBA_REG_BG2Y_LO:
-	case GBA_REG_BG2Y_HI:
-	case GBA_REG_BG3PA:
-	case GBA_REG_BG3PB:
-	case GBA_REG_BG3PC:
-	case GBA_REG_BG3PD:
-	case GBA_REG_BG3X_LO:
-	case GBA_REG_BG3X_HI:
-	case GBA_REG_BG3Y_LO:
-	case GBA_REG_BG3Y_HI:
-	case GBA_REG_WIN0H:
-	case GBA_REG_WIN1H:
-	case GBA_REG_WIN0V:
-	case GBA_REG_WIN1V:
-	case GBA_REG_MOSAIC:
-	case GBA_REG_BLDY:
-	case GBA_REG_FIFO_A_LO:
-	case GBA_REG_FIFO_A_HI:
-	case GBA_REG_FIFO_B_LO:
-	case GBA_REG_FIFO_B_HI:
-	case GBA_REG_DMA0SAD_LO:
-	case GBA_REG_DMA0SAD_HI:
-	case GBA_REG_DMA0DAD_LO:
-	case GBA_REG_DMA0DAD_HI:
-	case GBA_REG_DMA1SAD_LO:
-	case GBA_REG_DMA1SAD_HI:
-	case GBA_REG_DMA1DAD_LO:
-	case GBA_REG_DMA1DAD_HI:
-	case GBA_REG_DMA2SAD_LO:
-	case GBA_REG_DMA2SAD_HI:
-	case GBA_REG_DMA2DAD_LO:
-	case GBA_REG_DMA2DAD_HI:
-	case GBA_REG_DMA3SAD_LO:
-	case GBA_REG_DMA3SAD_HI:
-	case GBA_REG_DMA3DAD_LO:
-	case GBA_REG_DMA3DAD_HI:
-		// Write-only register
-		mLOG(GBA_IO, GAME_ERROR, "Read from write-only I/O register: %03X", address);
-		return GBALoadBad(gba->cpu);
+	}
+	mLOG(GBA_IO, GAME_ERROR, "Read from unused I/O register: %03X", address);
+	return GBALoadBad(gba->cpu);
+}
 
-	case GBA_REG_DMA0CNT_LO:
-	case GBA_REG_DMA1CNT_LO:
-	case GBA_REG_DMA2CNT_LO:
-	case GBA_REG_DMA3CNT_LO:
-		// Many, many things read from the DMA register
-	case GBA_REG_MAX:
-		// Some bad interrupt libraries will read from this
-		// (Silent) write-only register
-		return 0;
+uint16_t GBAIORead(struct GBA* gba, uint32_t address) {
+	if (address >= GBA_SIZE_IO) {
+		gba->haltPending = false;
+		return _readExternal(gba, address);
+	}
 
-	case GBA_REG_JOY_RECV_LO:
-	case GBA_REG_JOY_RECV_HI:
-		gba->memory.io[GBA_REG(JOYSTAT)] &= ~JOYSTAT_RECV;
-		break;
+	const struct GBAIORegisterInfo* info = &_ioRegisters[address >> 1];
+	if (!info->readConstant) {
+		// Most IO reads need to disable idle removal
+		gba->haltPending = false;
+	}
 
-	// Wave RAM can be written and read even if the audio hardware is disabled.
-	// However, it is not possible to switch between the two banks because it
-	// isn't possible to write to register SOUND3CNT_LO.
-	case GBA_REG_WAVE_RAM0_LO:
-		return GBAAudioReadWaveRAM(&gba->audio, 0) & 0xFFFF;
-	case GBA_REG_WAVE_RAM0_HI:
-		return GBAAudioReadWaveRAM(&gba->audio, 0) >> 16;
-	case GBA_REG_WAVE_RAM1_LO:
-		return GBAAudioReadWaveRAM(&gba->audio, 1) & 0xFFFF;
-	case GBA_REG_WAVE_RAM1_HI:
-		return GBAAudioReadWaveRAM(&gba->audio, 1) >> 16;
-	case GBA_REG_WAVE_RAM2_LO:
-		return GBAAudioReadWaveRAM(&gba->audio, 2) & 0xFFFF;
-	case GBA_REG_WAVE_RAM2_HI:
-		return GBAAudioReadWaveRAM(&gba->audio, 2) >> 16;
-	case GBA_REG_WAVE_RAM3_LO:
-		return GBAAudioReadWaveRAM(&gba->audio, 3) & 0xFFFF;
-	case GBA_REG_WAVE_RAM3_HI:
-		return GBAAudioReadWaveRAM(&gba->audio, 3) >> 16;
-
-	case GBA_REG_SOUND1CNT_LO:
-	case GBA_REG_SOUND1CNT_HI:
-	case GBA_REG_SOUND1CNT_X:
-	case GBA_REG_SOUND2CNT_LO:
-	case GBA_REG_SOUND2CNT_HI:
-	case GBA_REG_SOUND3CNT_LO:
-	case GBA_REG_SOUND3CNT_HI:
-	case GBA_REG_SOUND3CNT_X:
-	case GBA_REG_SOUND4CNT_LO:
-	case GBA_REG_SOUND4CNT_HI:
-	case GBA_REG_SOUNDCNT_LO:
+	switch (info->read) {
+	case IO_READ_PLAIN:
+		return gba->memory.io[address >> 1];
+	case IO_READ_HANDLER:
+		return info->readHandler(gba, address);
+	case IO_READ_PSG:
 		if (!GBAudioEnableIsEnable(gba->memory.io[GBA_REG(SOUNDCNT_X)])) {
 			// TODO: Is writing allowed when the circuit is disabled?
 			return 0;
 		}
-		// Fall through
-	case GBA_REG_DISPCNT:
-	case GBA_REG_STEREOCNT:
-	case GBA_REG_DISPSTAT:
-	case GBA_REG_VCOUNT:
-	case GBA_REG_BG0CNT:
-	case GBA_REG_BG1CNT:
-	case GBA_REG_BG2CNT:
-	case GBA_REG_BG3CNT:
-	case GBA_REG_WININ:
-	case GBA_REG_WINOUT:
-	case GBA_REG_BLDCNT:
-	case GBA_REG_BLDALPHA:
-	case GBA_REG_SOUNDCNT_HI:
-	case GBA_REG_SOUNDCNT_X:
-	case GBA_REG_SOUNDBIAS:
-	case GBA_REG_DMA0CNT_HI:
-	case GBA_REG_DMA1CNT_HI:
-	case GBA_REG_DMA2CNT_HI:
-	case GBA_REG_DMA3CNT_HI:
-	case GBA_REG_TM0CNT_HI:
-	case GBA_REG_TM1CNT_HI:
-	case GBA_REG_TM2CNT_HI:
-	case GBA_REG_TM3CNT_HI:
-	case GBA_REG_KEYCNT:
-	case GBA_REG_SIOMULTI0:
-	case GBA_REG_SIOMULTI1:
-	case GBA_REG_SIOMULTI2:
-	case GBA_REG_SIOMULTI3:
-	case GBA_REG_SIOMLT_SEND:
-	case GBA_REG_JOYCNT:
-	case GBA_REG_JOY_TRANS_LO:
-	case GBA_REG_JOY_TRANS_HI:
-	case GBA_REG_JOYSTAT:
-	case GBA_REG_IE:
-	case GBA_REG_IF:
-	case GBA_REG_WAITCNT:
-	case GBA_REG_IME:
-	case GBA_REG_POSTFLG:
-		// Handled transparently by registers
-		break;
-	case 0x066:
-	case 0x06A:
-	case 0x06E:
-	case 0x076:
-	case 0x07A:
-	case 0x07E:
-	case 0x086:
-	case 0x08A:
-	case 0x136:
-	case 0x142:
-	case 0x15A:
-	case 0x206:
-	case 0x302:
+		return gba->memory.io[address >> 1];
+	case IO_READ_ZERO:
+		// Many, many things read from the DMA register
+		return 0;
+	case IO_READ_UNUSED_ZERO:
 		mLOG(GBA_IO, GAME_ERROR, "Read from unused I/O register: %03X", address);
 		return 0;
-	// These registers sit outside of the normal I/O block, so we need to stash them somewhere unused
-	case GBA_REG_EXWAITCNT_LO:
-	case GBA_REG_EXWAITCNT_HI:
-		address += GBA_REG_INTERNAL_EXWAITCNT_LO - GBA_REG_EXWAITCNT_LO;
-		break;
-	case GBA_REG_DEBUG_ENABLE:
-		if (gba->debug) {
-			return 0x1DEA;
-		}
-		// Fall through
+	case IO_READ_WRITE_ONLY:
+		mLOG(GBA_IO, GAME_ERROR, "Read from write-only I/O register: %03X", address);
+		return GBALoadBad(gba->cpu);
+	case IO_READ_UNUSED:
 	default:
 		mLOG(GBA_IO, GAME_ERROR, "Read from unused I/O register: %03X", address);
 		return GBALoadBad(gba->cpu);
 	}
-	return gba->memory.io[address >> 1];
 }
 
 void GBAIOSerialize(struct GBA* gba, struct GBASerializedState* state) {
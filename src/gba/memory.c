@@ -5,6 +5,7 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/internal/gba/memory.h>
 
+#include <mgba/core/shared-rom.h>
 #include <mgba/internal/arm/decoder.h>
 #include <mgba/internal/arm/macros.h>
 #include <mgba/internal/defines.h>
@@ -29,8 +30,6 @@ static uint8_t _deadbeef[4] = { 0x10, 0xB7, 0x10, 0xE7 }; // Illegal instruction
 static const uint32_t _agbPrintFunc = 0x4770DFFA; // swi 0xFA; bx lr
 
 static void GBASetActiveRegion(struct ARMCore* cpu, uint32_t region);
-static int32_t GBAMemoryStall(struct ARMCore* cpu, int32_t wait);
-static int32_t GBAMemoryStallVRAM(struct GBA* gba, int32_t wait, int extra);
 
 static const char GBA_BASE_WAITSTATES[16] = { 0, 0, 2, 0, 0, 0, 0, 0, 4, 4, 4, 4, 4, 4, 4 };
 static const char GBA_BASE_WAITSTATES_32[16] = { 0, 0, 5, 0, 0, 1, 1, 0, 7, 7, 9, 9, 13, 13, 9 };
@@ -90,20 +89,42 @@ void GBAMemoryInit(struct GBA* gba) {
 	gba->memory.agbPrintBuffer = NULL;
 	gba->memory.agbPrintBufferBackup = NULL;
 
-	gba->memory.wram = anonymousMemoryMap(GBA_SIZE_EWRAM + GBA_SIZE_IWRAM);
-	gba->memory.iwram = &gba->memory.wram[GBA_SIZE_EWRAM >> 2];
+#ifdef ENABLE_HUGE_PAGES
+	gba->memory.arena = hugeMemoryMap(GBA_SIZE_ARENA);
+#else
+	gba->memory.arena = anonymousMemoryMap(GBA_SIZE_ARENA);
+#endif
+	// Fault the arena in up front, rather than a page at a time during the first frames
+	mappedMemoryAdvise(gba->memory.arena, GBA_SIZE_ARENA, mMEMORY_ADVICE_PREFAULT);
+	gba->memory.wram = (uint32_t*) &gba->memory.arena[GBA_ARENA_EWRAM];
+	gba->memory.iwram = (uint32_t*) &gba->memory.arena[GBA_ARENA_IWRAM];
+	memset(gba->memory.fastRegions, 0, sizeof(gba->memory.fastRegions));
+	GBAMemoryUpdateFastRegions(gba);
+	gba->memory.dirtyGeneration = 1;
+	GBAMemoryMarkDirty(&gba->memory);
 
 	GBADMAInit(gba);
 	GBAUnlCartInit(gba);
 
 	gba->memory.ereader.p = gba;
 	gba->memory.ereader.dots = NULL;
+	gba->memory.ereader.pixels = NULL;
 	memset(gba->memory.ereader.cards, 0, sizeof(gba->memory.ereader.cards));
+	memset(gba->memory.ereader.scanCache, 0, sizeof(gba->memory.ereader.scanCache));
+	gba->memory.ereader.nextScanCache = 0;
 }
 
 void GBAMemoryDeinit(struct GBA* gba) {
-	mappedMemoryFree(gba->memory.wram, GBA_SIZE_EWRAM + GBA_SIZE_IWRAM);
-	if (gba->memory.rom) {
+#ifdef ENABLE_HUGE_PAGES
+	hugeMemoryFree(gba->memory.arena, GBA_SIZE_ARENA);
+#else
+	mappedMemoryFree(gba->memory.arena, GBA_SIZE_ARENA);
+#endif
+	gba->memory.arena = NULL;
+	if (gba->romShared) {
+		mSharedROMRelease(gba->memory.rom);
+		gba->romShared = false;
+	} else if (gba->memory.rom) {
 		mappedMemoryFree(gba->memory.rom, gba->memory.romSize);
 	}
 	if (gba->memory.agbPrintBuffer) {
@@ -128,6 +149,8 @@ void GBAMemoryReset(struct GBA* gba) {
 	memset(gba->memory.io, 0, sizeof(gba->memory.io));
 	GBAAdjustWaitstates(gba, 0);
 	GBAAdjustEWRAMWaitstates(gba, 0x0D00);
+	GBAMemoryUpdateFastRegions(gba);
+	GBAMemoryMarkDirty(&gba->memory);
 
 	GBAMemoryClearAGBPrint(gba);
 
@@ -170,6 +193,38 @@ void GBAMemoryClearAGBPrint(struct GBA* gba) {
 	}
 }
 
+void GBAMemoryUpdateFastRegions(struct GBA* gba) {
+	struct GBAMemory* memory = &gba->memory;
+	memory->fastRegions[GBA_REGION_EWRAM] = (struct GBAFastRegion) { memory->wram, GBA_SIZE_EWRAM - 1, memory->wram ? GBA_SIZE_EWRAM : 0, &memory->dirtyPages[GBA_DIRTY_PAGES_EWRAM] };
+	memory->fastRegions[GBA_REGION_IWRAM] = (struct GBAFastRegion) { memory->iwram, GBA_SIZE_IWRAM - 1, memory->iwram ? GBA_SIZE_IWRAM : 0, &memory->dirtyPages[GBA_DIRTY_PAGES_IWRAM] };
+	// Palette RAM and OAM are only fast for loads; stores have to notify the renderer
+	memory->fastRegions[GBA_REGION_PALETTE_RAM] = (struct GBAFastRegion) { gba->video.palette, GBA_SIZE_PALETTE_RAM - 1, GBA_SIZE_PALETTE_RAM };
+	memory->fastRegions[GBA_REGION_OAM] = (struct GBAFastRegion) { gba->video.oam.raw, GBA_SIZE_OAM - 1, GBA_SIZE_OAM };
+
+	// ROM2_EX is left out since it may be backed by EEPROM or the e-Reader
+	int i;
+	for (i = GBA_REGION_ROM0; i < GBA_REGION_ROM2_EX; ++i) {
+		memory->fastRegions[i] = (struct GBAFastRegion) { memory->rom, GBA_SIZE_ROM0 - 1, memory->rom ? memory->romSize : 0 };
+	}
+}
+
+void GBAMemoryMarkDirty(struct GBAMemory* memory) {
+	size_t i;
+	for (i = 0; i < GBA_DIRTY_PAGES_MAX; ++i) {
+		memory->dirtyPages[i] = memory->dirtyGeneration;
+	}
+	memory->ioDirty = memory->dirtyGeneration;
+	memory->paletteDirty = memory->dirtyGeneration;
+	memory->oamDirty = memory->dirtyGeneration;
+}
+
+uint32_t GBAMemoryCheckpoint(struct GBAMemory* memory) {
+	// Stamps are 32-bit, so this would take over a year of checkpointing every frame to wrap
+	uint32_t checkpoint = memory->dirtyGeneration;
+	++memory->dirtyGeneration;
+	return checkpoint;
+}
+
 static void _analyzeForIdleLoop(struct GBA* gba, struct ARMCore* cpu, uint32_t address) {
 	struct ARMInstructionInfo info;
 	uint32_t nextAddress = address;
@@ -486,6 +541,20 @@ uint32_t GBALoad32(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 	int wait = 0;
 	char* waitstatesRegion = memory->waitstatesNonseq32;
 
+	const struct GBAFastRegion* fast = &memory->fastRegions[address >> BASE_OFFSET];
+	if (LIKELY((address & fast->mask & -4) < fast->limit)) {
+		LOAD_32(value, address & fast->mask & -4, fast->base);
+		if (cycleCounter) {
+			wait = waitstatesRegion[address >> BASE_OFFSET] + 2;
+			if (address < GBA_BASE_ROM0) {
+				wait = GBAMemoryStall(cpu, wait);
+			}
+			*cycleCounter += wait;
+		}
+		int rotate = (address & 3) << 3;
+		return ROR(value, rotate);
+	}
+
 	switch (address >> BASE_OFFSET) {
 	case GBA_REGION_BIOS:
 		LOAD_BIOS;
@@ -544,6 +613,20 @@ uint32_t GBALoad16(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 	uint32_t value = 0;
 	int wait = 0;
 
+	const struct GBAFastRegion* fast = &memory->fastRegions[address >> BASE_OFFSET];
+	if (LIKELY((address & fast->mask & -2) < fast->limit)) {
+		LOAD_16(value, address & fast->mask & -2, fast->base);
+		if (cycleCounter) {
+			wait = memory->waitstatesNonseq16[address >> BASE_OFFSET] + 2;
+			if (address < GBA_BASE_ROM0) {
+				wait = GBAMemoryStall(cpu, wait);
+			}
+			*cycleCounter += wait;
+		}
+		int rotate = (address & 1) << 3;
+		return ROR(value, rotate);
+	}
+
 	switch (address >> BASE_OFFSET) {
 	case GBA_REGION_BIOS:
 		if (address < GBA_SIZE_BIOS) {
@@ -659,6 +742,19 @@ uint32_t GBALoad8(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 	uint32_t value = 0;
 	int wait = 0;
 
+	const struct GBAFastRegion* fast = &memory->fastRegions[address >> BASE_OFFSET];
+	if (LIKELY((address & fast->mask) < fast->limit)) {
+		value = ((uint8_t*) fast->base)[address & fast->mask];
+		if (cycleCounter) {
+			wait = memory->waitstatesNonseq16[address >> BASE_OFFSET] + 2;
+			if (address < GBA_BASE_ROM0) {
+				wait = GBAMemoryStall(cpu, wait);
+			}
+			*cycleCounter += wait;
+		}
+		return value;
+	}
+
 	switch (address >> BASE_OFFSET) {
 	case GBA_REGION_BIOS:
 		if (address < GBA_SIZE_BIOS) {
@@ -762,12 +858,20 @@ uint32_t GBALoad8(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 	return value;
 }
 
+#define MARK_DIRTY(PAGES, OFFSET) \
+	memory->dirtyPages[(PAGES) + ((OFFSET) >> mSTATE_PAGE_SHIFT)] = memory->dirtyGeneration
+
+#define MARK_STATE_DIRTY(FIELD) \
+	memory->FIELD = memory->dirtyGeneration
+
 #define STORE_EWRAM \
 	STORE_32(value, address & (GBA_SIZE_EWRAM - 4), memory->wram); \
+	MARK_DIRTY(GBA_DIRTY_PAGES_EWRAM, address & (GBA_SIZE_EWRAM - 4)); \
 	wait += waitstatesRegion[GBA_REGION_EWRAM];
 
 #define STORE_IWRAM \
-	STORE_32(value, address & (GBA_SIZE_IWRAM - 4), memory->iwram);
+	STORE_32(value, address & (GBA_SIZE_IWRAM - 4), memory->iwram); \
+	MARK_DIRTY(GBA_DIRTY_PAGES_IWRAM, address & (GBA_SIZE_IWRAM - 4));
 
 #define STORE_IO \
 	GBAIOWrite32(gba, address & (OFFSET_MASK - 3), value);
@@ -776,6 +880,7 @@ uint32_t GBALoad8(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 	LOAD_32(oldValue, address & (GBA_SIZE_PALETTE_RAM - 4), gba->video.palette); \
 	if (oldValue != value) { \
 		STORE_32(value, address & (GBA_SIZE_PALETTE_RAM - 4), gba->video.palette); \
+		MARK_STATE_DIRTY(paletteDirty); \
 		gba->video.renderer->writePalette(gba->video.renderer, (address & (GBA_SIZE_PALETTE_RAM - 4)) + 2, value >> 16); \
 		gba->video.renderer->writePalette(gba->video.renderer, address & (GBA_SIZE_PALETTE_RAM - 4), value); \
 	} \
@@ -789,6 +894,7 @@ uint32_t GBALoad8(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 			LOAD_32(oldValue, address & 0x00017FFC, gba->video.vram); \
 			if (oldValue != value) { \
 				STORE_32(value, address & 0x00017FFC, gba->video.vram); \
+				MARK_DIRTY(GBA_DIRTY_PAGES_VRAM, address & 0x00017FFC); \
 				gba->video.renderer->writeVRAM(gba->video.renderer, (address & 0x00017FFC) + 2); \
 				gba->video.renderer->writeVRAM(gba->video.renderer, (address & 0x00017FFC)); \
 			} \
@@ -797,6 +903,7 @@ uint32_t GBALoad8(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 		LOAD_32(oldValue, address & 0x0001FFFC, gba->video.vram); \
 		if (oldValue != value) { \
 			STORE_32(value, address & 0x0001FFFC, gba->video.vram); \
+			MARK_DIRTY(GBA_DIRTY_PAGES_VRAM, address & 0x0001FFFC); \
 			gba->video.renderer->writeVRAM(gba->video.renderer, (address & 0x0001FFFC) + 2); \
 			gba->video.renderer->writeVRAM(gba->video.renderer, (address & 0x0001FFFC)); \
 		} \
@@ -810,6 +917,7 @@ uint32_t GBALoad8(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 	LOAD_32(oldValue, address & (GBA_SIZE_OAM - 4), gba->video.oam.raw); \
 	if (oldValue != value) { \
 		STORE_32(value, address & (GBA_SIZE_OAM - 4), gba->video.oam.raw); \
+		MARK_STATE_DIRTY(oamDirty); \
 		gba->video.renderer->writeOAM(gba->video.renderer, (address & (GBA_SIZE_OAM - 4)) >> 1); \
 		gba->video.renderer->writeOAM(gba->video.renderer, ((address & (GBA_SIZE_OAM - 4)) >> 1) + 1); \
 	}
@@ -835,6 +943,16 @@ void GBAStore32(struct ARMCore* cpu, uint32_t address, int32_t value, int* cycle
 	int32_t oldValue;
 	char* waitstatesRegion = memory->waitstatesNonseq32;
 
+	const struct GBAFastRegion* fast = &memory->fastRegions[address >> BASE_OFFSET];
+	if (LIKELY(address < GBA_BASE_IO && (address & fast->mask & -4) < fast->limit)) {
+		STORE_32(value, address & fast->mask & -4, fast->base);
+		fast->dirty[(address & fast->mask) >> mSTATE_PAGE_SHIFT] = memory->dirtyGeneration;
+		if (cycleCounter) {
+			*cycleCounter += GBAMemoryStall(cpu, waitstatesRegion[address >> BASE_OFFSET] + 1);
+		}
+		return;
+	}
+
 	switch (address >> BASE_OFFSET) {
 	case GBA_REGION_EWRAM:
 		STORE_EWRAM;
@@ -886,13 +1004,25 @@ void GBAStore16(struct ARMCore* cpu, uint32_t address, int16_t value, int* cycle
 	int wait = 0;
 	int16_t oldValue;
 
+	const struct GBAFastRegion* fast = &memory->fastRegions[address >> BASE_OFFSET];
+	if (LIKELY(address < GBA_BASE_IO && (address & fast->mask & -2) < fast->limit)) {
+		STORE_16(value, address & fast->mask & -2, fast->base);
+		fast->dirty[(address & fast->mask) >> mSTATE_PAGE_SHIFT] = memory->dirtyGeneration;
+		if (cycleCounter) {
+			*cycleCounter += GBAMemoryStall(cpu, memory->waitstatesNonseq16[address >> BASE_OFFSET] + 1);
+		}
+		return;
+	}
+
 	switch (address >> BASE_OFFSET) {
 	case GBA_REGION_EWRAM:
 		STORE_16(value, address & (GBA_SIZE_EWRAM - 2), memory->wram);
+		MARK_DIRTY(GBA_DIRTY_PAGES_EWRAM, address & (GBA_SIZE_EWRAM - 1));
 		wait = memory->waitstatesNonseq16[GBA_REGION_EWRAM];
 		break;
 	case GBA_REGION_IWRAM:
 		STORE_16(value, address & (GBA_SIZE_IWRAM - 2), memory->iwram);
+		MARK_DIRTY(GBA_DIRTY_PAGES_IWRAM, address & (GBA_SIZE_IWRAM - 1));
 		break;
 	case GBA_REGION_IO:
 		GBAIOWrite(gba, address & (OFFSET_MASK - 1), value);
@@ -901,6 +1031,7 @@ void GBAStore16(struct ARMCore* cpu, uint32_t address, int16_t value, int* cycle
 		LOAD_16(oldValue, address & (GBA_SIZE_PALETTE_RAM - 2), gba->video.palette);
 		if (oldValue != value) {
 			STORE_16(value, address & (GBA_SIZE_PALETTE_RAM - 2), gba->video.palette);
+			MARK_STATE_DIRTY(paletteDirty);
 			gba->video.renderer->writePalette(gba->video.renderer, address & (GBA_SIZE_PALETTE_RAM - 2), value);
 		}
 		break;
@@ -913,12 +1044,14 @@ void GBAStore16(struct ARMCore* cpu, uint32_t address, int16_t value, int* cycle
 			LOAD_16(oldValue, address & 0x00017FFE, gba->video.vram);
 			if (value != oldValue) {
 				STORE_16(value, address & 0x00017FFE, gba->video.vram);
+				MARK_DIRTY(GBA_DIRTY_PAGES_VRAM, address & 0x00017FFE);
 				gba->video.renderer->writeVRAM(gba->video.renderer, address & 0x00017FFE);
 			}
 		} else {
 			LOAD_16(oldValue, address & 0x0001FFFE, gba->video.vram);
 			if (value != oldValue) {
 				STORE_16(value, address & 0x0001FFFE, gba->video.vram);
+				MARK_DIRTY(GBA_DIRTY_PAGES_VRAM, address & 0x0001FFFE);
 				gba->video.renderer->writeVRAM(gba->video.renderer, address & 0x0001FFFE);
 			}
 		}
@@ -930,6 +1063,7 @@ void GBAStore16(struct ARMCore* cpu, uint32_t address, int16_t value, int* cycle
 		LOAD_16(oldValue, address & (GBA_SIZE_OAM - 2), gba->video.oam.raw);
 		if (value != oldValue) {
 			STORE_16(value, address & (GBA_SIZE_OAM - 2), gba->video.oam.raw);
+			MARK_STATE_DIRTY(oamDirty);
 			gba->video.renderer->writeOAM(gba->video.renderer, (address & (GBA_SIZE_OAM - 2)) >> 1);
 		}
 		break;
@@ -1031,13 +1165,25 @@ void GBAStore8(struct ARMCore* cpu, uint32_t address, int8_t value, int* cycleCo
 	int wait = 0;
 	uint16_t oldValue;
 
+	const struct GBAFastRegion* fast = &memory->fastRegions[address >> BASE_OFFSET];
+	if (LIKELY(address < GBA_BASE_IO && (address & fast->mask) < fast->limit)) {
+		((int8_t*) fast->base)[address & fast->mask] = value;
+		fast->dirty[(address & fast->mask) >> mSTATE_PAGE_SHIFT] = memory->dirtyGeneration;
+		if (cycleCounter) {
+			*cycleCounter += GBAMemoryStall(cpu, memory->waitstatesNonseq16[address >> BASE_OFFSET] + 1);
+		}
+		return;
+	}
+
 	switch (address >> BASE_OFFSET) {
 	case GBA_REGION_EWRAM:
 		((int8_t*) memory->wram)[address & (GBA_SIZE_EWRAM - 1)] = value;
+		MARK_DIRTY(GBA_DIRTY_PAGES_EWRAM, address & (GBA_SIZE_EWRAM - 1));
 		wait = memory->waitstatesNonseq16[GBA_REGION_EWRAM];
 		break;
 	case GBA_REGION_IWRAM:
 		((int8_t*) memory->iwram)[address & (GBA_SIZE_IWRAM - 1)] = value;
+		MARK_DIRTY(GBA_DIRTY_PAGES_IWRAM, address & (GBA_SIZE_IWRAM - 1));
 		break;
 	case GBA_REGION_IO:
 		GBAIOWrite8(gba, address & OFFSET_MASK, value);
@@ -1053,6 +1199,7 @@ void GBAStore8(struct ARMCore* cpu, uint32_t address, int8_t value, int* cycleCo
 		oldValue = gba->video.renderer->vram[(address & 0x1FFFE) >> 1];
 		if (oldValue != (((uint8_t) value) | (value << 8))) {
 			gba->video.renderer->vram[(address & 0x1FFFE) >> 1] = ((uint8_t) value) | (value << 8);
+			MARK_DIRTY(GBA_DIRTY_PAGES_VRAM, address & 0x1FFFE);
 			gba->video.renderer->writeVRAM(gba->video.renderer, address & 0x0001FFFE);
 		}
 		if (gba->video.stallMask) {
@@ -1083,15 +1230,16 @@ void GBAStore8(struct ARMCore* cpu, uint32_t address, int8_t value, int* cycleCo
 		} else if (memory->savedata.type == GBA_SAVEDATA_SRAM) {
 			if (memory->unl.type) {
 				GBAUnlCartWriteSRAM(gba, address & 0xFFFF, value);
+				GBASavedataMarkDirty(&memory->savedata, 0, GBA_SIZE_SRAM);
 			} else {
 				memory->savedata.data[address & (GBA_SIZE_SRAM - 1)] = value;
+				GBASavedataMarkDirty(&memory->savedata, address & (GBA_SIZE_SRAM - 1), 1);
 			}
-			memory->savedata.dirty |= mSAVEDATA_DIRT_NEW;
 		} else if (memory->hw.devices & HW_TILT) {
 			GBAHardwareTiltWrite(&memory->hw, address & OFFSET_MASK, value);
 		} else if (memory->savedata.type == GBA_SAVEDATA_SRAM512) {
 			memory->savedata.data[address & (GBA_SIZE_SRAM512 - 1)] = value;
-			memory->savedata.dirty |= mSAVEDATA_DIRT_NEW;
+			GBASavedataMarkDirty(&memory->savedata, address & (GBA_SIZE_SRAM512 - 1), 1);
 		} else {
 			mLOG(GBA_MEM, GAME_ERROR, "Writing to non-existent SRAM: 0x%08X", address);
 		}
@@ -1232,10 +1380,12 @@ void GBAPatch32(struct ARMCore* cpu, uint32_t address, int32_t value, int32_t* o
 	case GBA_REGION_EWRAM:
 		LOAD_32(oldValue, address & (GBA_SIZE_EWRAM - 4), memory->wram);
 		STORE_32(value, address & (GBA_SIZE_EWRAM - 4), memory->wram);
+		MARK_DIRTY(GBA_DIRTY_PAGES_EWRAM, address & (GBA_SIZE_EWRAM - 1));
 		break;
 	case GBA_REGION_IWRAM:
 		LOAD_32(oldValue, address & (GBA_SIZE_IWRAM - 4), memory->iwram);
 		STORE_32(value, address & (GBA_SIZE_IWRAM - 4), memory->iwram);
+		MARK_DIRTY(GBA_DIRTY_PAGES_IWRAM, address & (GBA_SIZE_IWRAM - 1));
 		break;
 	case GBA_REGION_IO:
 		mLOG(GBA_MEM, STUB, "Unimplemented memory Patch32: 0x%08X", address);
@@ -1243,6 +1393,7 @@ void GBAPatch32(struct ARMCore* cpu, uint32_t address, int32_t value, int32_t* o
 	case GBA_REGION_PALETTE_RAM:
 		LOAD_32(oldValue, address & (GBA_SIZE_PALETTE_RAM - 4), gba->video.palette);
 		STORE_32(value, address & (GBA_SIZE_PALETTE_RAM - 4), gba->video.palette);
+		MARK_STATE_DIRTY(paletteDirty);
 		gba->video.renderer->writePalette(gba->video.renderer, address & (GBA_SIZE_PALETTE_RAM - 4), value);
 		gba->video.renderer->writePalette(gba->video.renderer, (address & (GBA_SIZE_PALETTE_RAM - 4)) + 2, value >> 16);
 		break;
@@ -1250,11 +1401,13 @@ void GBAPatch32(struct ARMCore* cpu, uint32_t address, int32_t value, int32_t* o
 		if ((address & 0x0001FFFF) < GBA_SIZE_VRAM) {
 			LOAD_32(oldValue, address & 0x0001FFFC, gba->video.vram);
 			STORE_32(value, address & 0x0001FFFC, gba->video.vram);
+			MARK_DIRTY(GBA_DIRTY_PAGES_VRAM, address & 0x0001FFFC);
 			gba->video.renderer->writeVRAM(gba->video.renderer, address & 0x0001FFFC);
 			gba->video.renderer->writeVRAM(gba->video.renderer, (address & 0x0001FFFC) | 2);
 		} else {
 			LOAD_32(oldValue, address & 0x00017FFC, gba->video.vram);
 			STORE_32(value, address & 0x00017FFC, gba->video.vram);
+			MARK_DIRTY(GBA_DIRTY_PAGES_VRAM, address & 0x00017FFC);
 			gba->video.renderer->writeVRAM(gba->video.renderer, address & 0x00017FFC);
 			gba->video.renderer->writeVRAM(gba->video.renderer, (address & 0x00017FFC) | 2);
 		}
@@ -1262,6 +1415,7 @@ void GBAPatch32(struct ARMCore* cpu, uint32_t address, int32_t value, int32_t* o
 	case GBA_REGION_OAM:
 		LOAD_32(oldValue, address & (GBA_SIZE_OAM - 4), gba->video.oam.raw);
 		STORE_32(value, address & (GBA_SIZE_OAM - 4), gba->video.oam.raw);
+		MARK_STATE_DIRTY(oamDirty);
 		gba->video.renderer->writeOAM(gba->video.renderer, (address & (GBA_SIZE_OAM - 4)) >> 1);
 		gba->video.renderer->writeOAM(gba->video.renderer, ((address & (GBA_SIZE_OAM - 4)) + 2) >> 1);
 		break;
@@ -1275,6 +1429,7 @@ void GBAPatch32(struct ARMCore* cpu, uint32_t address, int32_t value, int32_t* o
 		if ((address & (GBA_SIZE_ROM0 - 4)) >= gba->memory.romSize) {
 			gba->memory.romSize = (address & (GBA_SIZE_ROM0 - 4)) + 4;
 			gba->memory.romMask = toPow2(gba->memory.romSize) - 1;
+			GBAMemoryUpdateFastRegions(gba);
 		}
 		LOAD_32(oldValue, address & (GBA_SIZE_ROM0 - 4), gba->memory.rom);
 		STORE_32(value, address & (GBA_SIZE_ROM0 - 4), gba->memory.rom);
@@ -1306,10 +1461,12 @@ void GBAPatch16(struct ARMCore* cpu, uint32_t address, int16_t value, int16_t* o
 	case GBA_REGION_EWRAM:
 		LOAD_16(oldValue, address & (GBA_SIZE_EWRAM - 2), memory->wram);
 		STORE_16(value, address & (GBA_SIZE_EWRAM - 2), memory->wram);
+		MARK_DIRTY(GBA_DIRTY_PAGES_EWRAM, address & (GBA_SIZE_EWRAM - 1));
 		break;
 	case GBA_REGION_IWRAM:
 		LOAD_16(oldValue, address & (GBA_SIZE_IWRAM - 2), memory->iwram);
 		STORE_16(value, address & (GBA_SIZE_IWRAM - 2), memory->iwram);
+		MARK_DIRTY(GBA_DIRTY_PAGES_IWRAM, address & (GBA_SIZE_IWRAM - 1));
 		break;
 	case GBA_REGION_IO:
 		mLOG(GBA_MEM, STUB, "Unimplemented memory Patch16: 0x%08X", address);
@@ -1317,22 +1474,26 @@ void GBAPatch16(struct ARMCore* cpu, uint32_t address, int16_t value, int16_t* o
 	case GBA_REGION_PALETTE_RAM:
 		LOAD_16(oldValue, address & (GBA_SIZE_PALETTE_RAM - 2), gba->video.palette);
 		STORE_16(value, address & (GBA_SIZE_PALETTE_RAM - 2), gba->video.palette);
+		MARK_STATE_DIRTY(paletteDirty);
 		gba->video.renderer->writePalette(gba->video.renderer, address & (GBA_SIZE_PALETTE_RAM - 2), value);
 		break;
 	case GBA_REGION_VRAM:
 		if ((address & 0x0001FFFF) < GBA_SIZE_VRAM) {
 			LOAD_16(oldValue, address & 0x0001FFFE, gba->video.vram);
 			STORE_16(value, address & 0x0001FFFE, gba->video.vram);
+			MARK_DIRTY(GBA_DIRTY_PAGES_VRAM, address & 0x0001FFFE);
 			gba->video.renderer->writeVRAM(gba->video.renderer, address & 0x0001FFFE);
 		} else {
 			LOAD_16(oldValue, address & 0x00017FFE, gba->video.vram);
 			STORE_16(value, address & 0x00017FFE, gba->video.vram);
+			MARK_DIRTY(GBA_DIRTY_PAGES_VRAM, address & 0x00017FFE);
 			gba->video.renderer->writeVRAM(gba->video.renderer, address & 0x00017FFE);
 		}
 		break;
 	case GBA_REGION_OAM:
 		LOAD_16(oldValue, address & (GBA_SIZE_OAM - 2), gba->video.oam.raw);
 		STORE_16(value, address & (GBA_SIZE_OAM - 2), gba->video.oam.raw);
+		MARK_STATE_DIRTY(oamDirty);
 		gba->video.renderer->writeOAM(gba->video.renderer, (address & (GBA_SIZE_OAM - 2)) >> 1);
 		break;
 	case GBA_REGION_ROM0:
@@ -1345,6 +1506,7 @@ void GBAPatch16(struct ARMCore* cpu, uint32_t address, int16_t value, int16_t* o
 		if ((address & (GBA_SIZE_ROM0 - 2)) >= gba->memory.romSize) {
 			gba->memory.romSize = (address & (GBA_SIZE_ROM0 - 2)) + 2;
 			gba->memory.romMask = toPow2(gba->memory.romSize) - 1;
+			GBAMemoryUpdateFastRegions(gba);
 		}
 		LOAD_16(oldValue, address & (GBA_SIZE_ROM0 - 2), gba->memory.rom);
 		STORE_16(value, address & (GBA_SIZE_ROM0 - 2), gba->memory.rom);
@@ -1388,10 +1550,12 @@ void GBAPatch8(struct ARMCore* cpu, uint32_t address, int8_t value, int8_t* old)
 	case GBA_REGION_EWRAM:
 		oldValue = ((int8_t*) memory->wram)[address & (GBA_SIZE_EWRAM - 1)];
 		((int8_t*) memory->wram)[address & (GBA_SIZE_EWRAM - 1)] = value;
+		MARK_DIRTY(GBA_DIRTY_PAGES_EWRAM, address & (GBA_SIZE_EWRAM - 1));
 		break;
 	case GBA_REGION_IWRAM:
 		oldValue = ((int8_t*) memory->iwram)[address & (GBA_SIZE_IWRAM - 1)];
 		((int8_t*) memory->iwram)[address & (GBA_SIZE_IWRAM - 1)] = value;
+		MARK_DIRTY(GBA_DIRTY_PAGES_IWRAM, address & (GBA_SIZE_IWRAM - 1));
 		break;
 	case GBA_REGION_IO:
 		mLOG(GBA_MEM, STUB, "Unimplemented memory Patch8: 0x%08X", address);
@@ -1400,6 +1564,7 @@ void GBAPatch8(struct ARMCore* cpu, uint32_t address, int8_t value, int8_t* old)
 		LOAD_16(alignedValue, address & (GBA_SIZE_PALETTE_RAM - 2), gba->video.palette);
 		MUNGE8;
 		STORE_16(alignedValue, address & (GBA_SIZE_PALETTE_RAM - 2), gba->video.palette);
+		MARK_STATE_DIRTY(paletteDirty);
 		gba->video.renderer->writePalette(gba->video.renderer, address & (GBA_SIZE_PALETTE_RAM - 2), alignedValue);
 		break;
 	case GBA_REGION_VRAM:
@@ -1407,11 +1572,13 @@ void GBAPatch8(struct ARMCore* cpu, uint32_t address, int8_t value, int8_t* old)
 			LOAD_16(alignedValue, address & 0x0001FFFE, gba->video.vram);
 			MUNGE8;
 			STORE_16(alignedValue, address & 0x0001FFFE, gba->video.vram);
+			MARK_DIRTY(GBA_DIRTY_PAGES_VRAM, address & 0x0001FFFE);
 			gba->video.renderer->writeVRAM(gba->video.renderer, address & 0x0001FFFE);
 		} else {
 			LOAD_16(alignedValue, address & 0x00017FFE, gba->video.vram);
 			MUNGE8;
 			STORE_16(alignedValue, address & 0x00017FFE, gba->video.vram);
+			MARK_DIRTY(GBA_DIRTY_PAGES_VRAM, address & 0x00017FFE);
 			gba->video.renderer->writeVRAM(gba->video.renderer, address & 0x00017FFE);
 		}
 		break;
@@ -1419,6 +1586,7 @@ void GBAPatch8(struct ARMCore* cpu, uint32_t address, int8_t value, int8_t* old)
 		LOAD_16(alignedValue, address & (GBA_SIZE_OAM - 2), gba->video.oam.raw);
 		MUNGE8;
 		STORE_16(alignedValue, address & (GBA_SIZE_OAM - 2), gba->video.oam.raw);
+		MARK_STATE_DIRTY(oamDirty);
 		gba->video.renderer->writeOAM(gba->video.renderer, (address & (GBA_SIZE_OAM - 2)) >> 1);
 		break;
 	case GBA_REGION_ROM0:
@@ -1431,6 +1599,7 @@ void GBAPatch8(struct ARMCore* cpu, uint32_t address, int8_t value, int8_t* old)
 		if ((address & (GBA_SIZE_ROM0 - 1)) >= gba->memory.romSize) {
 			gba->memory.romSize = (address & (GBA_SIZE_ROM0 - 2)) + 2;
 			gba->memory.romMask = toPow2(gba->memory.romSize) - 1;
+			GBAMemoryUpdateFastRegions(gba);
 		}
 		oldValue = ((int8_t*) memory->rom)[address & (GBA_SIZE_ROM0 - 1)];
 		((int8_t*) memory->rom)[address & (GBA_SIZE_ROM0 - 1)] = value;
@@ -1513,43 +1682,57 @@ uint32_t GBALoadMultiple(struct ARMCore* cpu, uint32_t address, int mask, enum L
 	}
 	int wait = memory->waitstatesSeq32[region] - memory->waitstatesNonseq32[region];
 
-	switch (region) {
-	case GBA_REGION_BIOS:
-		LDM_LOOP(LOAD_BIOS);
-		break;
-	case GBA_REGION_EWRAM:
-		LDM_LOOP(LOAD_EWRAM);
-		break;
-	case GBA_REGION_IWRAM:
-		LDM_LOOP(LOAD_IWRAM);
-		break;
-	case GBA_REGION_IO:
-		LDM_LOOP(LOAD_IO);
-		break;
-	case GBA_REGION_PALETTE_RAM:
-		LDM_LOOP(LOAD_PALETTE_RAM);
-		break;
-	case GBA_REGION_VRAM:
-		LDM_LOOP(LOAD_VRAM);
-		break;
-	case GBA_REGION_OAM:
-		LDM_LOOP(LOAD_OAM);
-		break;
-	case GBA_REGION_ROM0:
-	case GBA_REGION_ROM0_EX:
-	case GBA_REGION_ROM1:
-	case GBA_REGION_ROM1_EX:
-	case GBA_REGION_ROM2:
-	case GBA_REGION_ROM2_EX:
-		LDM_LOOP(LOAD_CART);
-		break;
-	case GBA_REGION_SRAM:
-	case GBA_REGION_SRAM_MIRROR:
-		LDM_LOOP(LOAD_SRAM);
-		break;
-	default:
-		LDM_LOOP(LOAD_BAD);
-		break;
+	const struct GBAFastRegion* fast = &memory->fastRegions[region];
+	int count = popcount32(mask);
+	if (mask && (address & fast->mask) + (count << 2) <= fast->limit) {
+		// The whole transfer is in contiguous memory, so skip the per-register dispatch
+		uintptr_t base = (uintptr_t) fast->base + (address & fast->mask);
+		int bits = mask;
+		int j;
+		for (j = 0; bits; ++j, bits &= bits - 1) {
+			LOAD_32(cpu->gprs[ctz32(bits)], j << 2, base);
+		}
+		wait += count * (waitstatesRegion[region] + 1);
+		address += count << 2;
+	} else {
+		switch (region) {
+		case GBA_REGION_BIOS:
+			LDM_LOOP(LOAD_BIOS);
+			break;
+		case GBA_REGION_EWRAM:
+			LDM_LOOP(LOAD_EWRAM);
+			break;
+		case GBA_REGION_IWRAM:
+			LDM_LOOP(LOAD_IWRAM);
+			break;
+		case GBA_REGION_IO:
+			LDM_LOOP(LOAD_IO);
+			break;
+		case GBA_REGION_PALETTE_RAM:
+			LDM_LOOP(LOAD_PALETTE_RAM);
+			break;
+		case GBA_REGION_VRAM:
+			LDM_LOOP(LOAD_VRAM);
+			break;
+		case GBA_REGION_OAM:
+			LDM_LOOP(LOAD_OAM);
+			break;
+		case GBA_REGION_ROM0:
+		case GBA_REGION_ROM0_EX:
+		case GBA_REGION_ROM1:
+		case GBA_REGION_ROM1_EX:
+		case GBA_REGION_ROM2:
+		case GBA_REGION_ROM2_EX:
+			LDM_LOOP(LOAD_CART);
+			break;
+		case GBA_REGION_SRAM:
+		case GBA_REGION_SRAM_MIRROR:
+			LDM_LOOP(LOAD_SRAM);
+			break;
+		default:
+			LDM_LOOP(LOAD_BAD);
+			break;
+		}
 	}
 
 	if (cycleCounter) {
@@ -1635,40 +1818,62 @@ uint32_t GBAStoreMultiple(struct ARMCore* cpu, uint32_t address, int mask, enum
 	}
 	int wait = memory->waitstatesSeq32[region] - memory->waitstatesNonseq32[region];
 
-	switch (region) {
-	case GBA_REGION_EWRAM:
-		STM_LOOP(STORE_EWRAM);
-		break;
-	case GBA_REGION_IWRAM:
-		STM_LOOP(STORE_IWRAM);
-		break;
-	case GBA_REGION_IO:
-		STM_LOOP(STORE_IO);
-		break;
-	case GBA_REGION_PALETTE_RAM:
-		STM_LOOP(STORE_PALETTE_RAM);
-		break;
-	case GBA_REGION_VRAM:
-		STM_LOOP(STORE_VRAM);
-		break;
-	case GBA_REGION_OAM:
-		STM_LOOP(STORE_OAM);
-		break;
-	case GBA_REGION_ROM0:
-	case GBA_REGION_ROM0_EX:
-	case GBA_REGION_ROM1:
-	case GBA_REGION_ROM1_EX:
-	case GBA_REGION_ROM2:
-	case GBA_REGION_ROM2_EX:
-		STM_LOOP(STORE_CART);
-		break;
-	case GBA_REGION_SRAM:
-	case GBA_REGION_SRAM_MIRROR:
-		STM_LOOP(STORE_SRAM);
-		break;
-	default:
-		STM_LOOP(STORE_BAD);
-		break;
+	const struct GBAFastRegion* fast = &memory->fastRegions[region];
+	int count = popcount32(mask);
+	if (mask && address < GBA_BASE_IO && (address & fast->mask) + (count << 2) <= fast->limit) {
+		// The whole transfer is in contiguous RAM, so skip the per-register dispatch
+		uintptr_t base = (uintptr_t) fast->base + (address & fast->mask);
+		int bits = mask;
+		int j;
+		for (j = 0; bits; ++j, bits &= bits - 1) {
+			i = ctz32(bits);
+			value = cpu->gprs[i];
+			if (i == ARM_PC) {
+				value += WORD_SIZE_ARM;
+			}
+			STORE_32(value, j << 2, base);
+		}
+		// At most 64 bytes are written, so they can't span more than two pages
+		fast->dirty[(address & fast->mask) >> mSTATE_PAGE_SHIFT] = memory->dirtyGeneration;
+		fast->dirty[((address & fast->mask) + (count << 2) - 1) >> mSTATE_PAGE_SHIFT] = memory->dirtyGeneration;
+		wait += count * (waitstatesRegion[region] + 1);
+		address += count << 2;
+	} else {
+		switch (region) {
+		case GBA_REGION_EWRAM:
+			STM_LOOP(STORE_EWRAM);
+			break;
+		case GBA_REGION_IWRAM:
+			STM_LOOP(STORE_IWRAM);
+			break;
+		case GBA_REGION_IO:
+			STM_LOOP(STORE_IO);
+			break;
+		case GBA_REGION_PALETTE_RAM:
+			STM_LOOP(STORE_PALETTE_RAM);
+			break;
+		case GBA_REGION_VRAM:
+			STM_LOOP(STORE_VRAM);
+			break;
+		case GBA_REGION_OAM:
+			STM_LOOP(STORE_OAM);
+			break;
+		case GBA_REGION_ROM0:
+		case GBA_REGION_ROM0_EX:
+		case GBA_REGION_ROM1:
+		case GBA_REGION_ROM1_EX:
+		case GBA_REGION_ROM2:
+		case GBA_REGION_ROM2_EX:
+			STM_LOOP(STORE_CART);
+			break;
+		case GBA_REGION_SRAM:
+		case GBA_REGION_SRAM_MIRROR:
+			STM_LOOP(STORE_SRAM);
+			break;
+		default:
+			STM_LOOP(STORE_BAD);
+			break;
+		}
 	}
 
 	if (cycleCounter) {
@@ -1892,20 +2097,25 @@ int32_t GBAMemoryStallVRAM(struct GBA* gba, int32_t wait, int extra) {
 	return stall;
 }
 
-void GBAMemorySerialize(const struct GBAMemory* memory, struct GBASerializedState* state) {
-	memcpy(state->wram, memory->wram, GBA_SIZE_EWRAM);
-	memcpy(state->iwram, memory->iwram, GBA_SIZE_IWRAM);
+void GBAMemorySerialize(const struct GBAMemory* memory, struct GBASerializedState* state, uint32_t since) {
+	mStateCopyDirtyPages(state->wram, memory->wram, &memory->dirtyPages[GBA_DIRTY_PAGES_EWRAM], GBA_SIZE_EWRAM >> mSTATE_PAGE_SHIFT, since);
+	mStateCopyDirtyPages(state->iwram, memory->iwram, &memory->dirtyPages[GBA_DIRTY_PAGES_IWRAM], GBA_SIZE_IWRAM >> mSTATE_PAGE_SHIFT, since);
 }
 
-void GBAMemoryDeserialize(struct GBAMemory* memory, const struct GBASerializedState* state) {
-	memcpy(memory->wram, state->wram, GBA_SIZE_EWRAM);
-	memcpy(memory->iwram, state->iwram, GBA_SIZE_IWRAM);
+void GBAMemoryDeserialize(struct GBAMemory* memory, const struct GBASerializedState* state, uint32_t since) {
+	mStateCopyDirtyPages(memory->wram, state->wram, &memory->dirtyPages[GBA_DIRTY_PAGES_EWRAM], GBA_SIZE_EWRAM >> mSTATE_PAGE_SHIFT, since);
+	mStateCopyDirtyPages(memory->iwram, state->iwram, &memory->dirtyPages[GBA_DIRTY_PAGES_IWRAM], GBA_SIZE_IWRAM >> mSTATE_PAGE_SHIFT, since);
 }
 
 void _pristineCow(struct GBA* gba) {
 	if (!gba->isPristine) {
 		return;
 	}
+	if (gba->romShared) {
+		// Shared views are already copy-on-write, page by page
+		gba->isPristine = false;
+		return;
+	}
 #if !defined(FIXED_ROM_BUFFER) && !defined(__wii__)
 	void* newRom = anonymousMemoryMap(GBA_SIZE_ROM0);
 	memcpy(newRom, gba->memory.rom, gba->memory.romSize);
@@ -1918,6 +2128,7 @@ void _pristineCow(struct GBA* gba) {
 	}
 	gba->memory.rom = newRom;
 	gba->memory.hw.gpioBase = &((uint16_t*) gba->memory.rom)[GPIO_REG_DATA >> 1];
+	GBAMemoryUpdateFastRegions(gba);
 #endif
 	gba->isPristine = false;
 }
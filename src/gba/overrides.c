@@ -323,6 +323,30 @@ void GBAOverrideSave(struct Configuration* config, const struct GBACartridgeOver
 	}
 }
 
+bool GBAIdleLoopCacheFind(const struct Configuration* config, uint32_t crc32, uint32_t* idleLoop) {
+	char key[9];
+	snprintf(key, sizeof(key), "%08X", crc32);
+	const char* value = ConfigurationGetValue(config, "idleLoops", key);
+	if (!value) {
+		return false;
+	}
+	char* end;
+	uint32_t address = strtoul(value, &end, 16);
+	if (!end || *end) {
+		return false;
+	}
+	*idleLoop = address;
+	return true;
+}
+
+void GBAIdleLoopCacheSave(struct Configuration* config, uint32_t crc32, uint32_t idleLoop) {
+	char key[9];
+	char value[9];
+	snprintf(key, sizeof(key), "%08X", crc32);
+	snprintf(value, sizeof(value), "%08X", idleLoop);
+	ConfigurationSetValue(config, "idleLoops", key, value);
+}
+
 void GBAOverrideApply(struct GBA* gba, const struct GBACartridgeOverride* override) {
 	if (override->savetype != GBA_SAVEDATA_AUTODETECT) {
 		GBASavedataForceType(&gba->memory.savedata, override->savetype);
@@ -7,51 +7,58 @@
 
 #include <mgba/gba/interface.h>
 
+bool GBAVideoRendererCleanSprite(struct GBAObj* oam, int index, struct GBAVideoRendererSprite* sprite, int offsetY) {
+	struct GBAObj obj;
+	LOAD_16LE(obj.a, 0, &oam[index].a);
+	LOAD_16LE(obj.b, 0, &oam[index].b);
+	LOAD_16LE(obj.c, 0, &oam[index].c);
+	if (!GBAObjAttributesAIsTransformed(obj.a) && GBAObjAttributesAIsDisable(obj.a)) {
+		return false;
+	}
+	int width = GBAVideoObjSizes[GBAObjAttributesAGetShape(obj.a) * 4 + GBAObjAttributesBGetSize(obj.b)][0];
+	int height = GBAVideoObjSizes[GBAObjAttributesAGetShape(obj.a) * 4 + GBAObjAttributesBGetSize(obj.b)][1];
+	int32_t x = (uint32_t) GBAObjAttributesBGetX(obj.b) << 23;
+	x >>= 23;
+	int cycles;
+	if (GBAObjAttributesAIsTransformed(obj.a)) {
+		height <<= GBAObjAttributesAGetDoubleSize(obj.a);
+		width <<= GBAObjAttributesAGetDoubleSize(obj.a);
+		cycles = 8 + width * 2;
+		if (x < 0) {
+			cycles += x;
+		}
+	} else {
+		cycles = width - 2;
+		if (x < 0) {
+			if (x + width < 0) {
+				return false;
+			}
+			cycles += x >> 1;
+		}
+	}
+	if (GBAObjAttributesAGetY(obj.a) >= GBA_VIDEO_VERTICAL_PIXELS && GBAObjAttributesAGetY(obj.a) + height < VIDEO_VERTICAL_TOTAL_PIXELS) {
+		return false;
+	}
+	if (GBAObjAttributesBGetX(obj.b) >= GBA_VIDEO_HORIZONTAL_PIXELS && GBAObjAttributesBGetX(obj.b) + width < 512) {
+		return false;
+	}
+	int y = GBAObjAttributesAGetY(obj.a) + offsetY;
+	if (y + height > 256) {
+		y -= 256;
+	}
+	sprite->y = y;
+	sprite->endY = y + height;
+	sprite->cycles = cycles;
+	sprite->obj = obj;
+	sprite->index = index;
+	return true;
+}
+
 int GBAVideoRendererCleanOAM(struct GBAObj* oam, struct GBAVideoRendererSprite* sprites, int offsetY) {
 	int i;
 	int oamMax = 0;
 	for (i = 0; i < 128; ++i) {
-		struct GBAObj obj;
-		LOAD_16LE(obj.a, 0, &oam[i].a);
-		LOAD_16LE(obj.b, 0, &oam[i].b);
-		LOAD_16LE(obj.c, 0, &oam[i].c);
-		if (GBAObjAttributesAIsTransformed(obj.a) || !GBAObjAttributesAIsDisable(obj.a)) {
-			int width = GBAVideoObjSizes[GBAObjAttributesAGetShape(obj.a) * 4 + GBAObjAttributesBGetSize(obj.b)][0];
-			int height = GBAVideoObjSizes[GBAObjAttributesAGetShape(obj.a) * 4 + GBAObjAttributesBGetSize(obj.b)][1];
-			int32_t x = (uint32_t) GBAObjAttributesBGetX(obj.b) << 23;
-			x >>= 23;
-			int cycles;
-			if (GBAObjAttributesAIsTransformed(obj.a)) {
-				height <<= GBAObjAttributesAGetDoubleSize(obj.a);
-				width <<= GBAObjAttributesAGetDoubleSize(obj.a);
-				cycles = 8 + width * 2;
-				if (x < 0) {
-					cycles += x;
-				}
-			} else {
-				cycles = width - 2;
-				if (x < 0) {
-					if (x + width < 0) {
-						continue;
-					}
-					cycles += x >> 1;
-				}
-			}
-			if (GBAObjAttributesAGetY(obj.a) >= GBA_VIDEO_VERTICAL_PIXELS && GBAObjAttributesAGetY(obj.a) + height < VIDEO_VERTICAL_TOTAL_PIXELS) {
-				continue;
-			}
-			if (GBAObjAttributesBGetX(obj.b) >= GBA_VIDEO_HORIZONTAL_PIXELS && GBAObjAttributesBGetX(obj.b) + width < 512) {
-				continue;
-			}
-			int y = GBAObjAttributesAGetY(obj.a) + offsetY;
-			if (y + height > 256) {
-				y -= 256;
-			}
-			sprites[oamMax].y = y;
-			sprites[oamMax].endY = y + height;
-			sprites[oamMax].cycles = cycles;
-			sprites[oamMax].obj = obj;
-			sprites[oamMax].index = i;
+		if (GBAVideoRendererCleanSprite(oam, i, &sprites[oamMax], offsetY)) {
 			++oamMax;
 		}
 	}
@@ -38,7 +38,7 @@ static void GBAVideoGLRendererWriteBGY_LO(struct GBAVideoGLBackground* bg, uint1
 static void GBAVideoGLRendererWriteBGY_HI(struct GBAVideoGLBackground* bg, uint16_t value);
 static void GBAVideoGLRendererWriteBLDCNT(struct GBAVideoGLRenderer* renderer, uint16_t value);
 
-static void GBAVideoGLRendererDrawSprite(struct GBAVideoGLRenderer* renderer, struct GBAObj* sprite, int y, int spriteY);
+static void GBAVideoGLRendererDrawSprites(struct GBAVideoGLRenderer* renderer, int y);
 static void GBAVideoGLRendererDrawBackgroundMode0(struct GBAVideoGLRenderer* renderer, struct GBAVideoGLBackground* background, int y);
 static void GBAVideoGLRendererDrawBackgroundMode2(struct GBAVideoGLRenderer* renderer, struct GBAVideoGLBackground* background, int y);
 static void GBAVideoGLRendererDrawBackgroundMode3(struct GBAVideoGLRenderer* renderer, struct GBAVideoGLBackground* background, int y);
@@ -47,6 +47,15 @@ static void GBAVideoGLRendererDrawBackgroundMode5(struct GBAVideoGLRenderer* ren
 static void GBAVideoGLRendererDrawWindow(struct GBAVideoGLRenderer* renderer, int y);
 
 static void _cleanRegister(struct GBAVideoGLRenderer* renderer, int address, uint16_t value);
+static void _initUploadBuffers(struct GBAVideoGLRenderer* renderer);
+static void _deinitUploadBuffers(struct GBAVideoGLRenderer* renderer);
+static void _uploadVram(struct GBAVideoGLRenderer* renderer);
+static void _uploadPalette(struct GBAVideoGLRenderer* renderer);
+static void _startReadback(struct GBAVideoGLRenderer* renderer);
+static bool _finishReadback(struct GBAVideoGLRenderer* renderer);
+static void _deinitReadback(struct GBAVideoGLRenderer* renderer);
+static void _initSpriteInstances(struct GBAVideoGLRenderer* renderer, struct GBAVideoGLShader* shader);
+static void _bindSpriteInstances(struct GBAVideoGLRenderer* renderer, const struct GBAVideoGLShader* shader, int first);
 static void _drawScanlines(struct GBAVideoGLRenderer* renderer, int lastY);
 static void _finalizeLayers(struct GBAVideoGLRenderer* renderer);
 
@@ -393,92 +402,130 @@ static const char* const _renderMode4 =
 	"	color = texelFetch(palette, ivec2(entry, int(texCoord.y)), 0);\n"
 	"}";
 
+static const char* const _vertexShaderObj =
+	"in vec2 position;\n"
+	"layout(location = 1) in ivec4 inRect;\n"
+	"layout(location = 2) in ivec4 inTile;\n"
+	"layout(location = 3) in ivec4 inFlags;\n"
+	"layout(location = 4) in vec4 inTransform;\n"
+	"layout(location = 5) in ivec4 inDims;\n"
+	"layout(location = 6) in int inIndex;\n"
+	"uniform ivec2 maxPos;\n"
+	"out vec2 texCoord;\n"
+	"flat out ivec4 rect;\n"
+	"flat out ivec4 tileInfo;\n"
+	"flat out ivec4 objFlags;\n"
+	"flat out vec4 transform;\n"
+	"flat out ivec4 dims;\n"
+	"flat out int index;\n"
+
+	"void main() {\n"
+	"	vec2 local = position * vec2(inRect.zw);\n"
+	"	gl_Position = vec4((vec2(inRect.xy) + local) * 2. / vec2(maxPos) - 1., 0., 1.);\n"
+	"	texCoord = local;\n"
+	"	rect = inRect;\n"
+	"	tileInfo = inTile;\n"
+	"	objFlags = inFlags;\n"
+	"	transform = inTransform;\n"
+	"	dims = inDims;\n"
+	"	index = inIndex;\n"
+	"}";
+
 static const struct GBAVideoGLUniform _uniformsObj[] = {
-	{ "loc", GBA_GL_VS_LOC, },
 	{ "maxPos", GBA_GL_VS_MAXPOS, },
 	{ "vram", GBA_GL_OBJ_VRAM, },
 	{ "palette", GBA_GL_OBJ_PALETTE, },
-	{ "charBase", GBA_GL_OBJ_CHARBASE, },
-	{ "stride", GBA_GL_OBJ_STRIDE, },
-	{ "localPalette", GBA_GL_OBJ_LOCALPALETTE, },
-	{ "inflags", GBA_GL_OBJ_INFLAGS, },
-	{ "transform", GBA_GL_OBJ_TRANSFORM, },
-	{ "dims", GBA_GL_OBJ_DIMS, },
 	{ "objwin", GBA_GL_OBJ_OBJWIN, },
-	{ "mosaic", GBA_GL_OBJ_MOSAIC, },
-	{ "cyclesRemaining", GBA_GL_OBJ_CYCLES, },
-	{ "tile", GBA_GL_OBJ_TILE, },
+	{ "cyclesExhausted", GBA_GL_OBJ_CYCLES, },
 	{ 0 }
 };
 
+// rect is the sprite's x, y, and total width and height, tileInfo is its character base, tile,
+// stride and palette (-1 for 256-color), and dims is its width, height and mosaic size
 static const char* const _renderObj =
 	MOSAIC
 	"in vec2 texCoord;\n"
+	"flat in ivec4 rect;\n"
+	"flat in ivec4 tileInfo;\n"
+	"flat in ivec4 objFlags;\n"
+	"flat in vec4 transform;\n"
+	"flat in ivec4 dims;\n"
+	"flat in int index;\n"
 	"uniform isampler2D vram;\n"
 	"uniform sampler2D palette;\n"
-	"uniform int charBase;\n"
-	"uniform int tile;\n"
-	"uniform int stride;\n"
-	"uniform int localPalette;\n"
-	"uniform ivec4 inflags;\n"
-	"uniform mat2x2 transform;\n"
-	"uniform ivec4 dims;\n"
 	"uniform ivec3 objwin;\n"
-	"uniform ivec4 mosaic;\n"
-	"uniform int cyclesRemaining[160];\n"
+	"uniform int cyclesExhausted[160];\n"
 	"OUT(0) out vec4 color;\n"
 	"OUT(1) out ivec4 flags;\n"
 	"OUT(2) out ivec4 window;\n"
 
-	"int renderTile(int tile, int paletteId, ivec2 localCoord);\n"
-	"int mask(int);\n"
-	"#define VRAM_MASK & 191\n"
+	"int renderTile(int tile, ivec2 localCoord) {\n"
+	"	int entry;\n"
+	"	if (tileInfo.w < 0) {\n"
+	"		int address = tileInfo.x + tile * 32 + (localCoord.x >> 1) + (localCoord.y << 2);\n"
+	"		int halfrow = texelFetch(vram, ivec2(address & 255, (address >> 8) & 191), 0).r;\n"
+	"		entry = (halfrow >> (8 * (localCoord.x & 1))) & 255;\n"
+	"	} else {\n"
+	"		int address = tileInfo.x + tile * 16 + (localCoord.x >> 2) + (localCoord.y << 1);\n"
+	"		int halfrow = texelFetch(vram, ivec2(address & 255, (address >> 8) & 191), 0).r;\n"
+	"		entry = (halfrow >> (4 * (localCoord.x & 3))) & 15;\n"
+	"	}\n"
+	"	if (entry == 0) {\n"
+	"		discard;\n"
+	"	}\n"
+	"	if (tileInfo.w < 0) {\n"
+	"		return entry;\n"
+	"	}\n"
+	"	return tileInfo.w * 16 + entry;\n"
+	"}\n"
+
+	"int mask(int tile) {\n"
+	"	return tile & (tileInfo.w < 0 ? 15 : 31);\n"
+	"}\n"
 
 	"void main() {\n"
 	"	vec2 incoord = texCoord;\n"
-	"	if (mosaic.x > 1) {\n"
+	"	if (dims.z > 1) {\n"
 	"		int x = int(incoord.x);\n"
-	"		x = MOSAIC(mosaic.z + x, mosaic.x) - mosaic.z;\n"
-	"		incoord.x = float(clamp(x, 0, dims.z - 1));\n"
-	"	} else if (mosaic.x < -1) {\n"
-	"		int x = dims.z - int(incoord.x) - 1;\n"
-	"		x = dims.z - MOSAIC(mosaic.z + x, -mosaic.x) + mosaic.z - 1;\n"
-	"		incoord.x = float(clamp(x, 0, dims.z - 1));\n"
+	"		x = MOSAIC(rect.x + x, dims.z) - rect.x;\n"
+	"		incoord.x = float(clamp(x, 0, rect.z - 1));\n"
+	"	} else if (dims.z < -1) {\n"
+	"		int x = rect.z - int(incoord.x) - 1;\n"
+	"		x = rect.z - MOSAIC(rect.x + x, -dims.z) + rect.x - 1;\n"
+	"		incoord.x = float(clamp(x, 0, rect.z - 1));\n"
 	"	}\n"
-	"	if (cyclesRemaining[int(incoord.y) + mosaic.w] <= 0) {\n"
+	"	if (index >= cyclesExhausted[int(incoord.y) + rect.y]) {\n"
 	"		discard;\n"
 	"	}\n"
-	"	if (mosaic.y > 1) {\n"
+	"	if (dims.w > 1) {\n"
 	"		int y = int(incoord.y);\n"
-	"		y = MOSAIC(mosaic.w + y, mosaic.y) - mosaic.w;"
-	"		incoord.y = float(clamp(y, 0, dims.w - 1));\n"
+	"		y = MOSAIC(rect.y + y, dims.w) - rect.y;"
+	"		incoord.y = float(clamp(y, 0, rect.w - 1));\n"
 	"	}\n"
-	"	ivec2 coord = ivec2(transform * (incoord - vec2(dims.zw) / 2.) + vec2(dims.xy) / 2.);\n"
+	"	ivec2 coord = ivec2(mat2(transform) * (incoord - vec2(rect.zw) / 2.) + vec2(dims.xy) / 2.);\n"
 	"	if ((coord & ~(dims.xy - 1)) != ivec2(0, 0)) {\n"
 	"		discard;\n"
 	"	}\n"
-	"	int paletteEntry = renderTile(mask((coord.x >> 3) + tile) + (coord.y >> 3) * stride, localPalette, coord & 7);\n"
-	"	color = texelFetch(palette, ivec2(paletteEntry + 256, int(texCoord.y) + mosaic.w), 0);\n"
-	"	flags = inflags;\n"
+	"	int paletteEntry = renderTile(mask((coord.x >> 3) + tileInfo.y) + (coord.y >> 3) * tileInfo.z, coord & 7);\n"
+	"	color = texelFetch(palette, ivec2(paletteEntry + 256, int(texCoord.y) + rect.y), 0);\n"
+	"	flags = objFlags;\n"
 	"	gl_FragDepth = float(flags.x) / 16.;\n"
 	"	window = ivec4(objwin, 0);\n"
 	"}\n";
 
 static const struct GBAVideoGLUniform _uniformsObjPriority[] = {
-	{ "loc", GBA_GL_VS_LOC, },
 	{ "maxPos", GBA_GL_VS_MAXPOS, },
-	{ "inflags", GBA_GL_OBJ_INFLAGS, },
 	{ 0 }
 };
 
 static const char* const _renderObjPriority =
 	"in vec2 texCoord;\n"
-	"uniform ivec4 inflags;\n"
+	"flat in ivec4 objFlags;\n"
 	"OUT(0) out vec4 color;\n"
 	"OUT(1) out ivec4 flags;\n"
 
 	"void main() {\n"
-	"	flags = inflags;\n"
+	"	flags = objFlags;\n"
 	"	gl_FragDepth = float(flags.x) / 16.;\n"
 	"	color = vec4(0., 0., 0., 0.);"
 	"}";
@@ -732,6 +779,29 @@ static void _compileShader(struct GBAVideoGLRenderer* glRenderer, struct GBAVide
 	}
 }
 
+static void _initSpriteInstances(struct GBAVideoGLRenderer* glRenderer, struct GBAVideoGLShader* shader) {
+	glBindVertexArray(shader->vao);
+	GLuint i;
+	for (i = GBA_GL_OBJ_ATTR_RECT; i <= GBA_GL_OBJ_ATTR_INDEX; ++i) {
+		glEnableVertexAttribArray(i);
+		glVertexAttribDivisor(i, 1);
+	}
+	_bindSpriteInstances(glRenderer, shader, 0);
+}
+
+static void _bindSpriteInstances(struct GBAVideoGLRenderer* glRenderer, const struct GBAVideoGLShader* shader, int first) {
+	const GLsizei stride = sizeof(struct GBAVideoGLSpriteInstance);
+	uintptr_t base = first * sizeof(struct GBAVideoGLSpriteInstance);
+	glBindVertexArray(shader->vao);
+	glBindBuffer(GL_ARRAY_BUFFER, glRenderer->spriteVbo);
+	glVertexAttribIPointer(GBA_GL_OBJ_ATTR_RECT, 4, GL_INT, stride, (const GLvoid*) (base + offsetof(struct GBAVideoGLSpriteInstance, rect)));
+	glVertexAttribIPointer(GBA_GL_OBJ_ATTR_TILE, 4, GL_INT, stride, (const GLvoid*) (base + offsetof(struct GBAVideoGLSpriteInstance, tile)));
+	glVertexAttribIPointer(GBA_GL_OBJ_ATTR_FLAGS, 4, GL_INT, stride, (const GLvoid*) (base + offsetof(struct GBAVideoGLSpriteInstance, flags)));
+	glVertexAttribPointer(GBA_GL_OBJ_ATTR_TRANSFORM, 4, GL_FLOAT, GL_FALSE, stride, (const GLvoid*) (base + offsetof(struct GBAVideoGLSpriteInstance, transform)));
+	glVertexAttribIPointer(GBA_GL_OBJ_ATTR_DIMS, 4, GL_INT, stride, (const GLvoid*) (base + offsetof(struct GBAVideoGLSpriteInstance, dims)));
+	glVertexAttribIPointer(GBA_GL_OBJ_ATTR_INDEX, 1, GL_INT, stride, (const GLvoid*) (base + offsetof(struct GBAVideoGLSpriteInstance, index)));
+}
+
 static void _deleteShader(struct GBAVideoGLShader* shader) {
 	glDeleteProgram(shader->program);
 	glDeleteVertexArrays(1, &shader->vao);
@@ -777,6 +847,170 @@ static void _initFramebuffers(struct GBAVideoGLRenderer* glRenderer) {
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
+void _initUploadBuffers(struct GBAVideoGLRenderer* glRenderer) {
+	glRenderer->persistentUpload = false;
+	glRenderer->activeUpload = 0;
+	glRenderer->uploadOffset = 0;
+	memset(glRenderer->uploadFence, 0, sizeof(glRenderer->uploadFence));
+#ifdef GL_MAP_PERSISTENT_BIT
+	const GLubyte* version = glGetString(GL_VERSION);
+	if (strncmp((const char*) version, "OpenGL ES ", strlen("OpenGL ES ")) == 0) {
+		return;
+	}
+	GLint major = 0;
+	GLint minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	bool supported = major > 4 || (major == 4 && minor >= 4);
+	if (!supported) {
+		GLint nExtensions = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &nExtensions);
+		GLint i;
+		for (i = 0; i < nExtensions; ++i) {
+			if (strcmp((const char*) glGetStringi(GL_EXTENSIONS, i), "GL_ARB_buffer_storage") == 0) {
+				supported = true;
+				break;
+			}
+		}
+	}
+	if (!supported) {
+		return;
+	}
+
+	glGenBuffers(GBA_GL_UPLOAD_BUFFERS, glRenderer->uploadBuffer);
+	int i;
+	for (i = 0; i < GBA_GL_UPLOAD_BUFFERS; ++i) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, glRenderer->uploadBuffer[i]);
+		glBufferStorage(GL_PIXEL_UNPACK_BUFFER, GBA_GL_UPLOAD_SIZE, NULL, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT);
+		glRenderer->uploadMap[i] = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, GBA_GL_UPLOAD_SIZE, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_FLUSH_EXPLICIT_BIT);
+		if (!glRenderer->uploadMap[i]) {
+			break;
+		}
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	if (i < GBA_GL_UPLOAD_BUFFERS) {
+		mLOG(GBA_VIDEO, WARN, "Could not map upload buffers, falling back to synchronous uploads");
+		glDeleteBuffers(GBA_GL_UPLOAD_BUFFERS, glRenderer->uploadBuffer);
+		return;
+	}
+	glRenderer->persistentUpload = true;
+#endif
+}
+
+void _deinitUploadBuffers(struct GBAVideoGLRenderer* glRenderer) {
+	if (!glRenderer->persistentUpload) {
+		return;
+	}
+	int i;
+	for (i = 0; i < GBA_GL_UPLOAD_BUFFERS; ++i) {
+		if (glRenderer->uploadFence[i]) {
+			glDeleteSync(glRenderer->uploadFence[i]);
+			glRenderer->uploadFence[i] = 0;
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, glRenderer->uploadBuffer[i]);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glDeleteBuffers(GBA_GL_UPLOAD_BUFFERS, glRenderer->uploadBuffer);
+	glRenderer->persistentUpload = false;
+}
+
+// Each frame writes its uploads into the next buffer in the ring, so the only time this has to
+// wait is if the GPU is more than a couple of frames behind. If a frame uploads more than fits,
+// the rest goes through the synchronous path. The buffer is left bound for the upload.
+static uint8_t* _reserveUpload(struct GBAVideoGLRenderer* glRenderer, size_t size) {
+	if (!glRenderer->persistentUpload || glRenderer->uploadOffset + size > GBA_GL_UPLOAD_SIZE) {
+		return NULL;
+	}
+	int active = glRenderer->activeUpload;
+	if (glRenderer->uploadFence[active]) {
+		glClientWaitSync(glRenderer->uploadFence[active], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		glDeleteSync(glRenderer->uploadFence[active]);
+		glRenderer->uploadFence[active] = 0;
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, glRenderer->uploadBuffer[active]);
+	uint8_t* map = &glRenderer->uploadMap[active][glRenderer->uploadOffset];
+	glRenderer->uploadOffset += (size + 0xFF) & ~0xFF;
+	return map;
+}
+
+static void _flushUpload(struct GBAVideoGLRenderer* glRenderer, const uint8_t* start, size_t size) {
+	uint8_t* base = glRenderer->uploadMap[glRenderer->activeUpload];
+	glFlushMappedBufferRange(GL_PIXEL_UNPACK_BUFFER, start - base, size);
+}
+
+static void _finishUploads(struct GBAVideoGLRenderer* glRenderer) {
+	if (!glRenderer->persistentUpload || !glRenderer->uploadOffset) {
+		return;
+	}
+	glRenderer->uploadFence[glRenderer->activeUpload] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glRenderer->activeUpload = (glRenderer->activeUpload + 1) % GBA_GL_UPLOAD_BUFFERS;
+	glRenderer->uploadOffset = 0;
+}
+
+void _uploadVram(struct GBAVideoGLRenderer* glRenderer) {
+	int ranges[12][2];
+	int nRanges = 0;
+	int first = -1;
+	int i;
+	for (i = 0; i < 25; ++i) {
+		if (!(glRenderer->vramDirty & (1 << i))) {
+			if (first >= 0) {
+				ranges[nRanges][0] = first;
+				ranges[nRanges][1] = i;
+				++nRanges;
+				first = -1;
+			}
+		} else if (first < 0) {
+			first = i;
+		}
+	}
+	glRenderer->vramDirty = 0;
+	if (!nRanges) {
+		return;
+	}
+
+	size_t start = ranges[0][0] * 0x1000;
+	size_t size = ranges[nRanges - 1][1] * 0x1000 - start;
+	uint8_t* map = _reserveUpload(glRenderer, size);
+	uintptr_t offset = 0;
+	if (map) {
+		offset = map - glRenderer->uploadMap[glRenderer->activeUpload];
+		for (i = 0; i < nRanges; ++i) {
+			memcpy(&map[ranges[i][0] * 0x1000 - start], &glRenderer->d.vram[2048 * ranges[i][0]], (ranges[i][1] - ranges[i][0]) * 0x1000);
+		}
+		_flushUpload(glRenderer, map, size);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, glRenderer->vramTex);
+	for (i = 0; i < nRanges; ++i) {
+		const GLvoid* data = &glRenderer->d.vram[2048 * ranges[i][0]];
+		if (map) {
+			data = (const GLvoid*) (offset + ranges[i][0] * 0x1000 - start);
+		}
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 8 * ranges[i][0], 256, 8 * (ranges[i][1] - ranges[i][0]), GL_RED_INTEGER, GL_UNSIGNED_SHORT, data);
+	}
+	if (map) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+}
+
+void _uploadPalette(struct GBAVideoGLRenderer* glRenderer) {
+	const GLvoid* data = glRenderer->shadowPalette;
+	uint8_t* map = _reserveUpload(glRenderer, sizeof(glRenderer->shadowPalette));
+	if (map) {
+		memcpy(map, glRenderer->shadowPalette, sizeof(glRenderer->shadowPalette));
+		_flushUpload(glRenderer, map, sizeof(glRenderer->shadowPalette));
+		data = (const GLvoid*) (uintptr_t) (map - glRenderer->uploadMap[glRenderer->activeUpload]);
+	}
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, glRenderer->paletteTex);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 512, GBA_VIDEO_VERTICAL_PIXELS, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, data);
+	if (map) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+}
+
 void GBAVideoGLRendererInit(struct GBAVideoRenderer* renderer) {
 	struct GBAVideoGLRenderer* glRenderer = (struct GBAVideoGLRenderer*) renderer;
 	glRenderer->temporaryBuffer = NULL;
@@ -809,6 +1043,7 @@ void GBAVideoGLRendererInit(struct GBAVideoRenderer* renderer) {
 	}
 
 	_initFramebuffers(glRenderer);
+	_initUploadBuffers(glRenderer);
 
 	char log[2048];
 	const GLchar* shaderBuffer[4];
@@ -852,16 +1087,27 @@ void GBAVideoGLRendererInit(struct GBAVideoRenderer* renderer) {
 	shaderBuffer[2] = _interpolate;
 	_compileShader(glRenderer, &glRenderer->bgShader[5], shaderBuffer, 3, vs, _uniformsMode35, log);
 
-	shaderBuffer[1] = _renderObj;
+	GLuint objVs = glCreateShader(GL_VERTEX_SHADER);
+	shaderBuffer[1] = _vertexShaderObj;
+	glShaderSource(objVs, 2, shaderBuffer, 0);
+	glCompileShader(objVs);
+	glGetShaderInfoLog(objVs, 2048, 0, log);
+	if (log[0]) {
+		mLOG(GBA_VIDEO, ERROR, "Vertex shader compilation failure: %s", log);
+	}
 
-	shaderBuffer[2] = _renderTile16;
-	_compileShader(glRenderer, &glRenderer->objShader[0], shaderBuffer, 3, vs, _uniformsObj, log);
+	glGenBuffers(1, &glRenderer->spriteVbo);
+	glBindBuffer(GL_ARRAY_BUFFER, glRenderer->spriteVbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(glRenderer->spriteInstances), NULL, GL_STREAM_DRAW);
 
-	shaderBuffer[2] = _renderTile256;
-	_compileShader(glRenderer, &glRenderer->objShader[1], shaderBuffer, 3, vs, _uniformsObj, log);
+	shaderBuffer[1] = _renderObj;
+	_compileShader(glRenderer, &glRenderer->objShader[0], shaderBuffer, 2, objVs, _uniformsObj, log);
+	_initSpriteInstances(glRenderer, &glRenderer->objShader[0]);
 
 	shaderBuffer[1] = _renderObjPriority;
-	_compileShader(glRenderer, &glRenderer->objShader[2], shaderBuffer, 2, vs, _uniformsObjPriority, log);
+	_compileShader(glRenderer, &glRenderer->objShader[1], shaderBuffer, 2, objVs, _uniformsObjPriority, log);
+	_initSpriteInstances(glRenderer, &glRenderer->objShader[1]);
+	glDeleteShader(objVs);
 
 	shaderBuffer[1] = _renderWindow;
 	_compileShader(glRenderer, &glRenderer->windowShader, shaderBuffer, 2, vs, _uniformsWindow, log);
@@ -885,6 +1131,9 @@ void GBAVideoGLRendererDeinit(struct GBAVideoRenderer* renderer) {
 	glDeleteTextures(1, &glRenderer->vramTex);
 	glDeleteTextures(1, &glRenderer->paletteTex);
 	glDeleteBuffers(1, &glRenderer->vbo);
+	glDeleteBuffers(1, &glRenderer->spriteVbo);
+	_deinitUploadBuffers(glRenderer);
+	_deinitReadback(glRenderer);
 
 	_deleteShader(&glRenderer->bgShader[0]);
 	_deleteShader(&glRenderer->bgShader[1]);
@@ -892,7 +1141,6 @@ void GBAVideoGLRendererDeinit(struct GBAVideoRenderer* renderer) {
 	_deleteShader(&glRenderer->bgShader[3]);
 	_deleteShader(&glRenderer->objShader[0]);
 	_deleteShader(&glRenderer->objShader[1]);
-	_deleteShader(&glRenderer->objShader[2]);
 	_deleteShader(&glRenderer->finalizeShader);
 
 	int i;
@@ -1413,26 +1661,12 @@ void GBAVideoGLRendererDrawScanline(struct GBAVideoRenderer* renderer, int y) {
 		}
 		if (!glRenderer->paletteDirtyScanlines) {
 			glRenderer->paletteDirty = false;
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, glRenderer->paletteTex);
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 512, GBA_VIDEO_VERTICAL_PIXELS, 0, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, glRenderer->shadowPalette);
+			_uploadPalette(glRenderer);
 		}
 	}
 
 	if (_needsVramUpload(glRenderer, y)) {
-		int first = -1;
-		glBindTexture(GL_TEXTURE_2D, glRenderer->vramTex);
-		for (i = 0; i < 25; ++i) {
-			if (!(glRenderer->vramDirty & (1 << i))) {
-				if (first >= 0) {
-					glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 8 * first, 256, 8 * (i - first), GL_RED_INTEGER, GL_UNSIGNED_SHORT, &glRenderer->d.vram[2048 * first]);
-					first = -1;
-				}
-			} else if (first < 0) {
-				first = i;
-			}
-		}
-		glRenderer->vramDirty = 0;
+		_uploadVram(glRenderer);
 	}
 
 	if (glRenderer->oamDirty) {
@@ -1496,41 +1730,14 @@ void _drawScanlines(struct GBAVideoGLRenderer* glRenderer, int y) {
 	}
 
 	if (glRenderer->paletteDirty) {
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, glRenderer->paletteTex);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 512, GBA_VIDEO_VERTICAL_PIXELS, 0, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, glRenderer->shadowPalette);
+		_uploadPalette(glRenderer);
 	}
 
 	GBAVideoGLRendererDrawWindow(glRenderer, y);
 	if (GBARegisterDISPCNTIsObjEnable(glRenderer->dispcnt) && !glRenderer->d.disableOBJ) {
 		glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
 		glDepthFunc(GL_LESS);
-		for (i = 0; i < glRenderer->oamMax; ++i) {
-			struct GBAVideoRendererSprite* sprite = &glRenderer->sprites[i];
-			if ((y < sprite->y && (sprite->endY - 256 < 0 || glRenderer->firstY >= sprite->endY - 256)) || glRenderer->firstY >= sprite->endY) {
-				continue;
-			}
-
-			GBAVideoGLRendererDrawSprite(glRenderer, &sprite->obj, y, sprite->y);
-
-			int startY = sprite->y;
-			int endY = sprite->endY;
-
-			if (endY >= 256) {
-				startY -= 256;
-				endY -= 256;
-			}
-			if (startY < glRenderer->firstY) {
-				startY = glRenderer->firstY;
-			}
-			if (endY > y) {
-				endY = y;
-			}
-			int j;
-			for (j = startY; j <= endY; ++j) {
-				glRenderer->spriteCycles[j] -= sprite->cycles;
-			}
-		}
+		GBAVideoGLRendererDrawSprites(glRenderer, y);
 		glDisable(GL_DEPTH_TEST);
 		glDisable(GL_STENCIL_TEST);
 	}
@@ -1578,6 +1785,8 @@ void GBAVideoGLRendererFinishFrame(struct GBAVideoRenderer* renderer) {
 	struct GBAVideoGLRenderer* glRenderer = (struct GBAVideoGLRenderer*) renderer;
 	_drawScanlines(glRenderer, GBA_VIDEO_VERTICAL_PIXELS - 1);
 	_finalizeLayers(glRenderer);
+	_finishUploads(glRenderer);
+	_startReadback(glRenderer);
 	glDisable(GL_SCISSOR_TEST);
 	glBindVertexArray(0);
 	glRenderer->firstAffine = -1;
@@ -1588,18 +1797,117 @@ void GBAVideoGLRendererFinishFrame(struct GBAVideoRenderer* renderer) {
 	glRenderer->bg[3].affine.sy = glRenderer->bg[3].refy;
 }
 
+void _startReadback(struct GBAVideoGLRenderer* glRenderer) {
+	if (!glRenderer->asyncReadback) {
+		_deinitReadback(glRenderer);
+		return;
+	}
+	GLsizeiptr size = GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS * glRenderer->scale * glRenderer->scale * BYTES_PER_PIXEL;
+	int i;
+	if (!glRenderer->readbackBuffer[0]) {
+		glGenBuffers(2, glRenderer->readbackBuffer);
+		for (i = 0; i < 2; ++i) {
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, glRenderer->readbackBuffer[i]);
+			glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+		}
+	}
+
+	i = glRenderer->readbackCounter & 1;
+	if (glRenderer->readbackFence[i]) {
+		glDeleteSync(glRenderer->readbackFence[i]);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, glRenderer->fbo[GBA_GL_FBO_OUTPUT]);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, glRenderer->readbackBuffer[i]);
+	glPixelStorei(GL_PACK_ROW_LENGTH, GBA_VIDEO_HORIZONTAL_PIXELS * glRenderer->scale);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, GBA_VIDEO_HORIZONTAL_PIXELS * glRenderer->scale, GBA_VIDEO_VERTICAL_PIXELS * glRenderer->scale, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glRenderer->readbackFence[i] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glRenderer->readbackFrame[i] = glRenderer->readbackCounter;
+	++glRenderer->readbackCounter;
+}
+
+// Picks up the newest readback the GPU has already finished, if there is one
+bool _finishReadback(struct GBAVideoGLRenderer* glRenderer) {
+	unsigned newest = glRenderer->readbackCounter - 1;
+	int i;
+	for (i = 0; i < 2; ++i) {
+		int slot = (newest - i) & 1;
+		if (!glRenderer->readbackFence[slot]) {
+			continue;
+		}
+		GLenum status = glClientWaitSync(glRenderer->readbackFence[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+			continue;
+		}
+		size_t size = GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS * glRenderer->scale * glRenderer->scale * BYTES_PER_PIXEL;
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, glRenderer->readbackBuffer[slot]);
+		const void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+		if (data) {
+			memcpy(glRenderer->temporaryBuffer, data, size);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		if (!data) {
+			return false;
+		}
+		glRenderer->readbackPixelsFrame = glRenderer->readbackFrame[slot];
+		glRenderer->readbackPixelsValid = true;
+
+		// Anything older than this is no use anymore
+		for (; i < 2; ++i) {
+			slot = (newest - i) & 1;
+			if (glRenderer->readbackFence[slot]) {
+				glDeleteSync(glRenderer->readbackFence[slot]);
+				glRenderer->readbackFence[slot] = 0;
+			}
+		}
+		return true;
+	}
+	return glRenderer->readbackPixelsValid;
+}
+
+void _deinitReadback(struct GBAVideoGLRenderer* glRenderer) {
+	int i;
+	for (i = 0; i < 2; ++i) {
+		if (glRenderer->readbackFence[i]) {
+			glDeleteSync(glRenderer->readbackFence[i]);
+			glRenderer->readbackFence[i] = 0;
+		}
+	}
+	if (glRenderer->readbackBuffer[0]) {
+		glDeleteBuffers(2, glRenderer->readbackBuffer);
+		glRenderer->readbackBuffer[0] = 0;
+		glRenderer->readbackBuffer[1] = 0;
+	}
+	glRenderer->readbackPixelsValid = false;
+}
+
 void GBAVideoGLRendererGetPixels(struct GBAVideoRenderer* renderer, size_t* stride, const void** pixels) {
 	struct GBAVideoGLRenderer* glRenderer = (struct GBAVideoGLRenderer*) renderer;
 	*stride = GBA_VIDEO_HORIZONTAL_PIXELS * glRenderer->scale;
 	if (!glRenderer->temporaryBuffer) {
 		glRenderer->temporaryBuffer = anonymousMemoryMap(GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS * glRenderer->scale * glRenderer->scale * BYTES_PER_PIXEL);
 	}
+	*pixels = glRenderer->temporaryBuffer;
+	if (glRenderer->asyncReadback && glRenderer->readbackBuffer[0] && _finishReadback(glRenderer)) {
+		return;
+	}
 	glFinish();
 	glBindFramebuffer(GL_FRAMEBUFFER, glRenderer->fbo[GBA_GL_FBO_OUTPUT]);
 	glPixelStorei(GL_PACK_ROW_LENGTH, GBA_VIDEO_HORIZONTAL_PIXELS * glRenderer->scale);
 	glPixelStorei(GL_PACK_ALIGNMENT, 1);
 	glReadPixels(0, 0, GBA_VIDEO_HORIZONTAL_PIXELS * glRenderer->scale, GBA_VIDEO_VERTICAL_PIXELS * glRenderer->scale, GL_RGBA, GL_UNSIGNED_BYTE, (void*) glRenderer->temporaryBuffer);
-	*pixels = glRenderer->temporaryBuffer;
+	glRenderer->readbackPixelsFrame = glRenderer->readbackCounter - 1;
+	glRenderer->readbackPixelsValid = glRenderer->asyncReadback;
+}
+
+unsigned GBAVideoGLRendererReadbackLatency(const struct GBAVideoGLRenderer* renderer) {
+	if (!renderer->asyncReadback || !renderer->readbackPixelsValid) {
+		return 0;
+	}
+	return renderer->readbackCounter - 1 - renderer->readbackPixelsFrame;
 }
 
 void GBAVideoGLRendererPutPixels(struct GBAVideoRenderer* renderer, size_t stride, const void* pixels) {
@@ -1730,7 +2038,7 @@ void _finalizeLayers(struct GBAVideoGLRenderer* renderer) {
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-void GBAVideoGLRendererDrawSprite(struct GBAVideoGLRenderer* renderer, struct GBAObj* sprite, int y, int spriteY) {
+static bool _prepareSprite(struct GBAVideoGLRenderer* renderer, struct GBAObj* sprite, int spriteY, struct GBAVideoGLSpriteInstance* instance) {
 	int width = GBAVideoObjSizes[GBAObjAttributesAGetShape(sprite->a) * 4 + GBAObjAttributesBGetSize(sprite->b)][0];
 	int height = GBAVideoObjSizes[GBAObjAttributesAGetShape(sprite->a) * 4 + GBAObjAttributesBGetSize(sprite->b)][1];
 	int32_t x = (uint32_t) GBAObjAttributesBGetX(sprite->b) << 23;
@@ -1738,7 +2046,7 @@ void GBAVideoGLRendererDrawSprite(struct GBAVideoGLRenderer* renderer, struct GB
 	x += renderer->objOffsetX;
 
 	if (GBARegisterDISPCNTGetMode(renderer->dispcnt) >= 3 && GBAObjAttributesCGetTile(sprite->c) < 512) {
-		return;
+		return false;
 	}
 
 	int align = GBAObjAttributesAIs256Color(sprite->a) && !GBARegisterDISPCNTIsObjCharacterMapping(renderer->dispcnt);
@@ -1768,32 +2076,25 @@ void GBAVideoGLRendererDrawSprite(struct GBAVideoGLRenderer* renderer, struct GB
 
 	if (x + totalWidth <= 0 || x >= GBA_VIDEO_HORIZONTAL_PIXELS) {
 		// These sprites aren't displayed but affect cycle counting
-		return;
+		return false;
 	}
 
-	const struct GBAVideoGLShader* shader = &renderer->objShader[GBAObjAttributesAGet256Color(sprite->a)];
-	const GLuint* uniforms = shader->uniforms;
-	glBindFramebuffer(GL_FRAMEBUFFER, renderer->fbo[GBA_GL_FBO_OBJ]);
-	glViewport(x * renderer->scale, spriteY * renderer->scale, totalWidth * renderer->scale, totalHeight * renderer->scale);
-	glScissor(x * renderer->scale, renderer->firstY * renderer->scale, totalWidth * renderer->scale, (y - renderer->firstY + 1) * renderer->scale);
-	glUseProgram(shader->program);
-	glBindVertexArray(shader->vao);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, renderer->vramTex);
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, renderer->paletteTex);
-	glUniform2i(uniforms[GBA_GL_VS_LOC], totalHeight, 0);
-	glUniform2i(uniforms[GBA_GL_VS_MAXPOS], totalWidth, totalHeight);
-	glUniform1i(uniforms[GBA_GL_OBJ_VRAM], 0);
-	glUniform1i(uniforms[GBA_GL_OBJ_PALETTE], 1);
-	glUniform1i(uniforms[GBA_GL_OBJ_CHARBASE], charBase);
-	glUniform1i(uniforms[GBA_GL_OBJ_TILE], tile);
-	glUniform1i(uniforms[GBA_GL_OBJ_STRIDE], stride);
-	glUniform1i(uniforms[GBA_GL_OBJ_LOCALPALETTE], GBAObjAttributesCGetPalette(sprite->c));
-	glUniform4i(uniforms[GBA_GL_OBJ_INFLAGS], GBAObjAttributesCGetPriority(sprite->c),
-	                                          (renderer->target1Obj || GBAObjAttributesAGetMode(sprite->a) == OBJ_MODE_SEMITRANSPARENT) | (renderer->target2Obj * 2) | (renderer->blendEffect * 4),
-	                                          renderer->blda, GBAObjAttributesAGetMode(sprite->a) == OBJ_MODE_SEMITRANSPARENT);
-	glUniform1iv(uniforms[GBA_GL_OBJ_CYCLES], GBA_VIDEO_VERTICAL_PIXELS, renderer->spriteCycles);
+	if (GBAObjAttributesAGetMode(sprite->a) == OBJ_MODE_OBJWIN && !GBARegisterDISPCNTIsObjwinEnable(renderer->dispcnt)) {
+		return false;
+	}
+
+	instance->rect[0] = x;
+	instance->rect[1] = spriteY;
+	instance->rect[2] = totalWidth;
+	instance->rect[3] = totalHeight;
+	instance->tile[0] = charBase;
+	instance->tile[1] = tile;
+	instance->tile[2] = stride;
+	instance->tile[3] = GBAObjAttributesAIs256Color(sprite->a) ? -1 : GBAObjAttributesCGetPalette(sprite->c);
+	instance->flags[0] = GBAObjAttributesCGetPriority(sprite->c);
+	instance->flags[1] = (renderer->target1Obj || GBAObjAttributesAGetMode(sprite->a) == OBJ_MODE_SEMITRANSPARENT) | (renderer->target2Obj * 2) | (renderer->blendEffect * 4);
+	instance->flags[2] = renderer->blda;
+	instance->flags[3] = GBAObjAttributesAGetMode(sprite->a) == OBJ_MODE_SEMITRANSPARENT;
 	if (GBAObjAttributesAIsTransformed(sprite->a)) {
 		struct GBAOAMMatrix mat;
 		LOAD_16(mat.a, 0, &renderer->d.oam->mat[GBAObjAttributesBGetMatIndex(sprite->b)].a);
@@ -1801,64 +2102,191 @@ void GBAVideoGLRendererDrawSprite(struct GBAVideoGLRenderer* renderer, struct GB
 		LOAD_16(mat.c, 0, &renderer->d.oam->mat[GBAObjAttributesBGetMatIndex(sprite->b)].c);
 		LOAD_16(mat.d, 0, &renderer->d.oam->mat[GBAObjAttributesBGetMatIndex(sprite->b)].d);
 
-		glUniformMatrix2fv(uniforms[GBA_GL_OBJ_TRANSFORM], 1, GL_FALSE, (GLfloat[]) { mat.a / 256.f, mat.c / 256.f, mat.b / 256.f, mat.d / 256.f });
+		instance->transform[0] = mat.a / 256.f;
+		instance->transform[1] = mat.c / 256.f;
+		instance->transform[2] = mat.b / 256.f;
+		instance->transform[3] = mat.d / 256.f;
 	} else {
-		int flipX = 1;
-		int flipY = 1;
+		instance->transform[0] = GBAObjAttributesBIsHFlip(sprite->b) ? -1 : 1;
+		instance->transform[1] = 0;
+		instance->transform[2] = 0;
+		instance->transform[3] = GBAObjAttributesBIsVFlip(sprite->b) ? -1 : 1;
+	}
+	instance->dims[0] = width;
+	instance->dims[1] = height;
+	if (GBAObjAttributesAIsMosaic(sprite->a) && GBAObjAttributesAGetMode(sprite->a) != OBJ_MODE_OBJWIN) {
+		int mosaicH = GBAMosaicControlGetObjH(renderer->mosaic) + 1;
 		if (GBAObjAttributesBIsHFlip(sprite->b)) {
-			flipX = -1;
+			mosaicH = -mosaicH;
 		}
-		if (GBAObjAttributesBIsVFlip(sprite->b)) {
-			flipY = -1;
+		instance->dims[2] = mosaicH;
+		instance->dims[3] = GBAMosaicControlGetObjV(renderer->mosaic) + 1;
+	} else {
+		instance->dims[2] = 0;
+		instance->dims[3] = 0;
+	}
+	return true;
+}
+
+// Drawing a sprite's priority pass before the next sprite's color pass only matters if they
+// overlap and the earlier sprite doesn't lose on priority, so everything else can share draws
+static bool _spriteRunConflicts(const struct GBAVideoGLSpriteInstance* sprites, int start, int next, int firstY, int y) {
+	const struct GBAVideoGLSpriteInstance* sprite = &sprites[next];
+	int i;
+	for (i = start; i < next; ++i) {
+		const struct GBAVideoGLSpriteInstance* other = &sprites[i];
+		if (other->flags[0] > sprite->flags[0]) {
+			continue;
+		}
+		int left = other->rect[0] > sprite->rect[0] ? other->rect[0] : sprite->rect[0];
+		int right = other->rect[0] + other->rect[2] < sprite->rect[0] + sprite->rect[2] ? other->rect[0] + other->rect[2] : sprite->rect[0] + sprite->rect[2];
+		int top = other->rect[1] > sprite->rect[1] ? other->rect[1] : sprite->rect[1];
+		int bottom = other->rect[1] + other->rect[3] < sprite->rect[1] + sprite->rect[3] ? other->rect[1] + other->rect[3] : sprite->rect[1] + sprite->rect[3];
+		if (left < 0) {
+			left = 0;
+		}
+		if (right > GBA_VIDEO_HORIZONTAL_PIXELS) {
+			right = GBA_VIDEO_HORIZONTAL_PIXELS;
+		}
+		if (top < firstY) {
+			top = firstY;
+		}
+		if (bottom > y + 1) {
+			bottom = y + 1;
+		}
+		if (left < right && top < bottom) {
+			return true;
 		}
-		glUniformMatrix2fv(uniforms[GBA_GL_OBJ_TRANSFORM], 1, GL_FALSE, (GLfloat[]) { flipX, 0, 0, flipY });
 	}
-	glUniform4i(uniforms[GBA_GL_OBJ_DIMS], width, height, totalWidth, totalHeight);
-	if (GBAObjAttributesAGetMode(sprite->a) == OBJ_MODE_OBJWIN) {
+	return false;
+}
+
+static void _drawSpriteRun(struct GBAVideoGLRenderer* renderer, int first, int count) {
+	const struct GBAVideoGLShader* shader = &renderer->objShader[0];
+	glUseProgram(shader->program);
+	_bindSpriteInstances(renderer, shader, first);
+	glStencilFunc(GL_ALWAYS, 1, 1);
+	glDrawBuffers(2, (GLenum[]) { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 });
+	glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, count);
+
+	// Update the pixel priority for already-written pixels
+	shader = &renderer->objShader[1];
+	glUseProgram(shader->program);
+	_bindSpriteInstances(renderer, shader, first);
+	glStencilFunc(GL_EQUAL, 1, 1);
+	glDrawBuffers(2, (GLenum[]) { GL_NONE, GL_COLOR_ATTACHMENT1 });
+	glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, count);
+}
+
+void GBAVideoGLRendererDrawSprites(struct GBAVideoGLRenderer* renderer, int y) {
+	struct GBAVideoGLSpriteInstance* instances = renderer->spriteInstances;
+	GLint cyclesExhausted[GBA_VIDEO_VERTICAL_PIXELS];
+	int nSprites = 0;
+	int nObjwin = 0;
+	int index = 0;
+	int i;
+	for (i = 0; i < GBA_VIDEO_VERTICAL_PIXELS; ++i) {
+		cyclesExhausted[i] = renderer->spriteCycles[i] <= 0 ? 0 : 128;
+	}
+
+	// OBJWIN sprites only write to the window layer, so they can go in any order. They're kept at
+	// the end of the instance list, and regular sprites at the start
+	for (i = 0; i < renderer->oamMax; ++i) {
+		struct GBAVideoRendererSprite* sprite = &renderer->sprites[i];
+		if ((y < sprite->y && (sprite->endY - 256 < 0 || renderer->firstY >= sprite->endY - 256)) || renderer->firstY >= sprite->endY) {
+			continue;
+		}
+
+		struct GBAVideoGLSpriteInstance* instance = &instances[nSprites];
+		if (GBAObjAttributesAGetMode(sprite->obj.a) == OBJ_MODE_OBJWIN) {
+			instance = &instances[127 - nObjwin];
+		}
+		if (_prepareSprite(renderer, &sprite->obj, sprite->y, instance)) {
+			instance->index = index;
+			if (GBAObjAttributesAGetMode(sprite->obj.a) == OBJ_MODE_OBJWIN) {
+				++nObjwin;
+			} else {
+				++nSprites;
+			}
+		}
+		++index;
+
+		int startY = sprite->y;
+		int endY = sprite->endY;
+
+		if (endY >= 256) {
+			startY -= 256;
+			endY -= 256;
+		}
+		if (startY < renderer->firstY) {
+			startY = renderer->firstY;
+		}
+		if (endY > y) {
+			endY = y;
+		}
+		int j;
+		for (j = startY; j <= endY; ++j) {
+			renderer->spriteCycles[j] -= sprite->cycles;
+			if (renderer->spriteCycles[j] <= 0 && cyclesExhausted[j] > index) {
+				cyclesExhausted[j] = index;
+			}
+		}
+	}
+	if (!nSprites && !nObjwin) {
+		return;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, renderer->spriteVbo);
+	if (nSprites) {
+		glBufferSubData(GL_ARRAY_BUFFER, 0, nSprites * sizeof(*instances), instances);
+	}
+	if (nObjwin) {
+		glBufferSubData(GL_ARRAY_BUFFER, (128 - nObjwin) * sizeof(*instances), nObjwin * sizeof(*instances), &instances[128 - nObjwin]);
+	}
+
+	const struct GBAVideoGLShader* shader = &renderer->objShader[0];
+	const GLuint* uniforms = shader->uniforms;
+	glBindFramebuffer(GL_FRAMEBUFFER, renderer->fbo[GBA_GL_FBO_OBJ]);
+	glViewport(0, 0, GBA_VIDEO_HORIZONTAL_PIXELS * renderer->scale, GBA_VIDEO_VERTICAL_PIXELS * renderer->scale);
+	glScissor(0, renderer->firstY * renderer->scale, GBA_VIDEO_HORIZONTAL_PIXELS * renderer->scale, (y - renderer->firstY + 1) * renderer->scale);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, renderer->vramTex);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, renderer->paletteTex);
+	glUseProgram(shader->program);
+	glUniform2i(uniforms[GBA_GL_VS_MAXPOS], GBA_VIDEO_HORIZONTAL_PIXELS, GBA_VIDEO_VERTICAL_PIXELS);
+	glUniform1i(uniforms[GBA_GL_OBJ_VRAM], 0);
+	glUniform1i(uniforms[GBA_GL_OBJ_PALETTE], 1);
+	glUniform1iv(uniforms[GBA_GL_OBJ_CYCLES], GBA_VIDEO_VERTICAL_PIXELS, cyclesExhausted);
+
+	if (nObjwin) {
 		// OBJWIN writes do not affect pixel priority
 		glDisable(GL_STENCIL_TEST);
 		glDisable(GL_DEPTH_TEST);
 		glDepthMask(GL_FALSE);
 		glStencilMask(0);
-		int window = renderer->objwin & 0x3F;
-		glUniform3i(uniforms[GBA_GL_OBJ_OBJWIN], window, renderer->bldb, renderer->bldy);
+		glUniform3i(uniforms[GBA_GL_OBJ_OBJWIN], renderer->objwin & 0x3F, renderer->bldb, renderer->bldy);
 		glDrawBuffers(3, (GLenum[]) { GL_NONE, GL_NONE, GL_COLOR_ATTACHMENT2 });
-	} else {
+		_bindSpriteInstances(renderer, shader, 128 - nObjwin);
+		glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, nObjwin);
+	}
+
+	if (nSprites) {
 		glEnable(GL_STENCIL_TEST);
 		glEnable(GL_DEPTH_TEST);
 		glDepthMask(GL_TRUE);
 		glStencilMask(1);
-		glStencilFunc(GL_ALWAYS, 1, 1);
 		glUniform3i(uniforms[GBA_GL_OBJ_OBJWIN], 0, 0, 0);
-		glDrawBuffers(2, (GLenum[]) { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 });
-	}
-	if (GBAObjAttributesAIsMosaic(sprite->a) && GBAObjAttributesAGetMode(sprite->a) != OBJ_MODE_OBJWIN) {
-		int mosaicH = GBAMosaicControlGetObjH(renderer->mosaic) + 1;
-		if (GBAObjAttributesBIsHFlip(sprite->b)) {
-			mosaicH = -mosaicH;
+		glUseProgram(renderer->objShader[1].program);
+		glUniform2i(renderer->objShader[1].uniforms[GBA_GL_VS_MAXPOS], GBA_VIDEO_HORIZONTAL_PIXELS, GBA_VIDEO_VERTICAL_PIXELS);
+
+		int start = 0;
+		for (i = 1; i <= nSprites; ++i) {
+			if (i == nSprites || _spriteRunConflicts(instances, start, i, renderer->firstY, y)) {
+				_drawSpriteRun(renderer, start, i - start);
+				start = i;
+			}
 		}
-		glUniform4i(uniforms[GBA_GL_OBJ_MOSAIC], mosaicH, GBAMosaicControlGetObjV(renderer->mosaic) + 1, x, spriteY);
-	} else {
-		glUniform4i(uniforms[GBA_GL_OBJ_MOSAIC], 0, 0, x, spriteY);
-	}
-	if (GBAObjAttributesAGetMode(sprite->a) != OBJ_MODE_OBJWIN || GBARegisterDISPCNTIsObjwinEnable(renderer->dispcnt)) {
-		glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
-	}
-
-	if (GBAObjAttributesAGetMode(sprite->a) != OBJ_MODE_OBJWIN) {
-		// Update the pixel priority for already-written pixels
-		shader = &renderer->objShader[2];
-		uniforms = shader->uniforms;
-		glStencilFunc(GL_EQUAL, 1, 1);
-		glUseProgram(shader->program);
-		glDrawBuffers(2, (GLenum[]) { GL_NONE, GL_COLOR_ATTACHMENT1 });
-		glBindVertexArray(shader->vao);
-		glUniform2i(uniforms[GBA_GL_VS_LOC], totalHeight, 0);
-		glUniform2i(uniforms[GBA_GL_VS_MAXPOS], totalWidth, totalHeight);
-		glUniform4i(uniforms[GBA_GL_OBJ_INFLAGS], GBAObjAttributesCGetPriority(sprite->c),
-		                                          (renderer->target1Obj || GBAObjAttributesAGetMode(sprite->a) == OBJ_MODE_SEMITRANSPARENT) | (renderer->target2Obj * 2) | (renderer->blendEffect * 4),
-		                                          renderer->blda, GBAObjAttributesAGetMode(sprite->a) == OBJ_MODE_SEMITRANSPARENT);
-		glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
 	}
 
 	glDrawBuffers(1, (GLenum[]) { GL_COLOR_ATTACHMENT0 });
@@ -2129,6 +2557,7 @@ void GBAVideoGLRendererSetScale(struct GBAVideoGLRenderer* renderer, int scale)
 		mappedMemoryFree(renderer->temporaryBuffer, GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS * renderer->scale * renderer->scale * BYTES_PER_PIXEL);
 		renderer->temporaryBuffer = NULL;
 	}
+	_deinitReadback(renderer);
 	renderer->scale = scale;
 	_initFramebuffers(renderer);
 	renderer->paletteDirty = true;
@@ -8,6 +8,14 @@
 #include <mgba/core/interface.h>
 #include <mgba/internal/gba/gba.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define AFFINE_VECTOR_PIXELS 8
+
 #define BACKGROUND_BITMAP_ITERATE(W, H) \
 	x += background->dx; \
 	y += background->dy; \
@@ -17,6 +25,80 @@
 	localX = x; \
 	localY = y;
 
+// Fetches the 8bpp color index of count affine background pixels, starting at x, y.
+// Pixels that fall outside of a background that doesn't wrap come out as 0, which is
+// transparent. Map and tile offsets are computed a vector at a time; the loads
+// themselves stay scalar, as neither SSE2 nor NEON can gather.
+static void _fetchAffineRow(uint8_t* out, const uint8_t* screenBase, const uint8_t* charBase, int size, bool wrap, int32_t x, int32_t y, int32_t dx, int32_t dy, int count) {
+	int32_t sizeMask = (0x8000 << size) - 1;
+	int32_t clipMask = wrap ? 0 : ~sizeMask;
+	int outX = 0;
+#if defined(__SSE2__) || defined(__ARM_NEON)
+	uint32_t mapIndex[AFFINE_VECTOR_PIXELS];
+	uint32_t tileOffset[AFFINE_VECTOR_PIXELS];
+	uint32_t visible[AFFINE_VECTOR_PIXELS];
+	int i;
+#if defined(__SSE2__)
+	__m128i xs = _mm_setr_epi32(x, x + dx, x + dx * 2, x + dx * 3);
+	__m128i ys = _mm_setr_epi32(y, y + dy, y + dy * 2, y + dy * 3);
+#else
+	int32_t lanes[4] = { x, x + dx, x + dx * 2, x + dx * 3 };
+	int32x4_t xs = vld1q_s32(lanes);
+	lanes[0] = y;
+	lanes[1] = y + dy;
+	lanes[2] = y + dy * 2;
+	lanes[3] = y + dy * 3;
+	int32x4_t ys = vld1q_s32(lanes);
+#endif
+	for (; outX + AFFINE_VECTOR_PIXELS <= count; outX += AFFINE_VECTOR_PIXELS) {
+		for (i = 0; i < AFFINE_VECTOR_PIXELS; i += 4) {
+#if defined(__SSE2__)
+			__m128i mask = _mm_set1_epi32(sizeMask);
+			__m128i clipped = _mm_and_si128(_mm_or_si128(xs, ys), _mm_set1_epi32(clipMask));
+			__m128i localX = _mm_and_si128(xs, mask);
+			__m128i localY = _mm_and_si128(ys, mask);
+			__m128i row = _mm_and_si128(_mm_srli_epi32(localY, 7), _mm_set1_epi32(0x7F0));
+			__m128i map = _mm_add_epi32(_mm_srli_epi32(localX, 11), _mm_sll_epi32(row, _mm_cvtsi32_si128(size)));
+			__m128i tile = _mm_add_epi32(_mm_srli_epi32(_mm_and_si128(localY, _mm_set1_epi32(0x700)), 5), _mm_srli_epi32(_mm_and_si128(localX, _mm_set1_epi32(0x700)), 8));
+			_mm_storeu_si128((__m128i*) &mapIndex[i], map);
+			_mm_storeu_si128((__m128i*) &tileOffset[i], tile);
+			_mm_storeu_si128((__m128i*) &visible[i], _mm_cmpeq_epi32(clipped, _mm_setzero_si128()));
+			xs = _mm_add_epi32(xs, _mm_set1_epi32(dx * 4));
+			ys = _mm_add_epi32(ys, _mm_set1_epi32(dy * 4));
+#else
+			uint32x4_t mask = vdupq_n_u32(sizeMask);
+			uint32x4_t clipped = vandq_u32(vreinterpretq_u32_s32(vorrq_s32(xs, ys)), vdupq_n_u32(clipMask));
+			uint32x4_t localX = vandq_u32(vreinterpretq_u32_s32(xs), mask);
+			uint32x4_t localY = vandq_u32(vreinterpretq_u32_s32(ys), mask);
+			uint32x4_t row = vandq_u32(vshrq_n_u32(localY, 7), vdupq_n_u32(0x7F0));
+			uint32x4_t map = vaddq_u32(vshrq_n_u32(localX, 11), vshlq_u32(row, vdupq_n_s32(size)));
+			uint32x4_t tile = vaddq_u32(vshrq_n_u32(vandq_u32(localY, vdupq_n_u32(0x700)), 5), vshrq_n_u32(vandq_u32(localX, vdupq_n_u32(0x700)), 8));
+			vst1q_u32(&mapIndex[i], map);
+			vst1q_u32(&tileOffset[i], tile);
+			vst1q_u32(&visible[i], vceqq_u32(clipped, vdupq_n_u32(0)));
+			xs = vaddq_s32(xs, vdupq_n_s32(dx * 4));
+			ys = vaddq_s32(ys, vdupq_n_s32(dy * 4));
+#endif
+		}
+		for (i = 0; i < AFFINE_VECTOR_PIXELS; ++i) {
+			out[outX + i] = charBase[(screenBase[mapIndex[i]] << 6) + tileOffset[i]] & visible[i];
+		}
+	}
+	x += outX * dx;
+	y += outX * dy;
+#endif
+	for (; outX < count; ++outX, x += dx, y += dy) {
+		if ((x | y) & clipMask) {
+			out[outX] = 0;
+			continue;
+		}
+		int32_t localX = x & sizeMask;
+		int32_t localY = y & sizeMask;
+		uint8_t mapData = screenBase[(localX >> 11) + (((localY >> 7) & 0x7F0) << size)];
+		out[outX] = charBase[(mapData << 6) + ((localY & 0x700) >> 5) + ((localX & 0x700) >> 8)];
+	}
+}
+
 #define MODE_2_COORD_OVERFLOW \
 	localX = x & (sizeAdjusted - 1); \
 	localY = y & (sizeAdjusted - 1); \
@@ -53,6 +135,15 @@
 		} \
 	}
 
+#define MODE_2_ROW_LOOP(BLEND, OBJWIN) \
+	for (outX = renderer->start, pixel = &renderer->row[outX]; outX < renderer->end; ++outX, ++pixel) { \
+		uint32_t current = *pixel; \
+		pixelData = rowData[outX]; \
+		if (pixelData && IS_WRITABLE(current)) { \
+			COMPOSITE_256_ ## OBJWIN (BLEND, 0); \
+		} \
+	}
+
 #define DRAW_BACKGROUND_MODE_2(BLEND, OBJWIN) \
 	if (background->overflow) { \
 		if (mosaicH > 1) { \
@@ -61,7 +152,7 @@
 			MODE_2_NO_MOSAIC(); \
 			MODE_2_LOOP(MODE_2_MOSAIC, MODE_2_COORD_OVERFLOW, BLEND, OBJWIN); \
 		} else { \
-			MODE_2_LOOP(MODE_2_NO_MOSAIC, MODE_2_COORD_OVERFLOW, BLEND, OBJWIN); \
+			MODE_2_ROW_LOOP(BLEND, OBJWIN); \
 		} \
 	} else { \
 		if (mosaicH > 1) { \
@@ -72,7 +163,7 @@
 			} \
 			MODE_2_LOOP(MODE_2_MOSAIC, MODE_2_COORD_NO_OVERFLOW, BLEND, OBJWIN); \
 		} else { \
-			MODE_2_LOOP(MODE_2_NO_MOSAIC, MODE_2_COORD_NO_OVERFLOW, BLEND, OBJWIN); \
+			MODE_2_ROW_LOOP(BLEND, OBJWIN); \
 		} \
 	}
 
@@ -89,6 +180,13 @@ void GBAVideoSoftwareRendererDrawBackgroundMode2(struct GBAVideoSoftwareRenderer
 	int outX;
 	uint32_t* pixel;
 
+	// Without mosaic, every pixel of the row can be fetched up front
+	uint8_t rowData[GBA_VIDEO_HORIZONTAL_PIXELS];
+	if (mosaicH <= 1 && renderer->end > renderer->start) {
+		_fetchAffineRow(&rowData[renderer->start], screenBase, charBase, background->size, background->overflow,
+		                x + background->dx, y + background->dy, background->dx, background->dy, renderer->end - renderer->start);
+	}
+
 	if (!objwinSlowPath) {
 		if (!(flags & FLAG_TARGET_2)) {
 			DRAW_BACKGROUND_MODE_2(NoBlend, NO_OBJWIN);
@@ -104,9 +202,190 @@ void GBAVideoSoftwareRendererDrawBackgroundMode2(struct GBAVideoSoftwareRenderer
 	}
 }
 
+// The bitmap modes pick one specialized loop per scanline, so the blend target, the
+// object window and any brighten/darken effect aren't rechecked for every pixel. The
+// effect is applied when a color is fetched, which mosaic then repeats as is. Opaque
+// 16-bit pixels keep compositing with the object window variants even without the
+// slow path, since they carry over an object window flag that may already be there.
+#define BITMAP_EFFECT_NONE(COLOR) (COLOR)
+#define BITMAP_EFFECT_BRIGHTEN(COLOR) _brighten(COLOR, renderer->bldy)
+#define BITMAP_EFFECT_DARKEN(COLOR) _darken(COLOR, renderer->bldy)
+
+#define BITMAP_16_COMPOSITE_NO_OBJWIN(BLEND) \
+	{ \
+		unsigned mergedFlags = flags; \
+		if (current & FLAG_OBJWIN) { \
+			mergedFlags = objwinFlags; \
+		} \
+		_composite ## BLEND ## Objwin(renderer, pixel, color | mergedFlags, current); \
+	}
+
+#define BITMAP_16_COMPOSITE_OBJWIN(BLEND) \
+	if ((!(current & FLAG_OBJWIN)) != background->objwinOnly) { \
+		unsigned mergedFlags = flags; \
+		if (current & FLAG_OBJWIN) { \
+			mergedFlags = objwinFlags; \
+		} \
+		_composite ## BLEND ## Objwin(renderer, pixel, color | mergedFlags, current); \
+	}
+
+#define BITMAP_8_COMPOSITE_NO_OBJWIN(BLEND) \
+	_composite ## BLEND ## NoObjwin(renderer, pixel, palette[color] | flags, current);
+
+#define BITMAP_8_COMPOSITE_OBJWIN(BLEND) \
+	if (background->objwinForceEnable || (!(current & FLAG_OBJWIN)) == background->objwinOnly) { \
+		mColor* currentPalette = (current & FLAG_OBJWIN) ? objwinPalette : palette; \
+		unsigned mergedFlags = flags; \
+		if (current & FLAG_OBJWIN) { \
+			mergedFlags = objwinFlags; \
+		} \
+		_composite ## BLEND ## Objwin(renderer, pixel, currentPalette[color] | mergedFlags, current); \
+	}
+
+#define BITMAP_16_FETCH(W, H, ADDRESS, EFFECT) \
+	BACKGROUND_BITMAP_ITERATE(W, H); \
+	if (!mosaicWait) { \
+		LOAD_16(color, ADDRESS, renderer->d.vram); \
+		color = EFFECT(mColorFrom555(color)); \
+		mosaicWait = mosaicH; \
+	} else { \
+		--mosaicWait; \
+	}
+
+#define BITMAP_16_LOOP(W, H, ADDRESS, EFFECT, BLEND, OBJWIN) \
+	for (outX = renderer->start, pixel = &renderer->row[outX]; outX < renderer->end; ++outX, ++pixel) { \
+		BITMAP_16_FETCH(W, H, ADDRESS, EFFECT) \
+		uint32_t current = *pixel; \
+		BITMAP_16_COMPOSITE_ ## OBJWIN(BLEND) \
+	}
+
+#define BITMAP_16_SPAN_LOOP(BLEND, OBJWIN) \
+	for (i = 0; i < length; ++i, ++pixel) { \
+		uint32_t color = colors[i]; \
+		uint32_t current = *pixel; \
+		BITMAP_16_COMPOSITE_ ## OBJWIN(BLEND) \
+	}
+
+#define BITMAP_8_FETCH_ITERATE \
+	BACKGROUND_BITMAP_ITERATE(GBA_VIDEO_HORIZONTAL_PIXELS, GBA_VIDEO_VERTICAL_PIXELS); \
+	if (!mosaicWait) { \
+		color = ((uint8_t*)renderer->d.vram)[offset + (localX >> 8) + (localY >> 8) * GBA_VIDEO_HORIZONTAL_PIXELS]; \
+		mosaicWait = mosaicH; \
+	} else { \
+		--mosaicWait; \
+	}
+
+#define BITMAP_8_FETCH_SPAN \
+	color = indices[outX - start];
+
+#define BITMAP_8_LOOP(FETCH, START, END, BLEND, OBJWIN) \
+	for (outX = START, pixel = &renderer->row[outX]; outX < END; ++outX, ++pixel) { \
+		BITMAP_8_FETCH_ ## FETCH \
+		uint32_t current = *pixel; \
+		if (color && IS_WRITABLE(current)) { \
+			BITMAP_8_COMPOSITE_ ## OBJWIN(BLEND) \
+		} \
+	}
+
+#define DRAW_BITMAP_SPECIALIZED(LOOP, ...) \
+	if (!objwinSlowPath) { \
+		if (!(flags & FLAG_TARGET_2)) { \
+			LOOP(__VA_ARGS__, NoBlend, NO_OBJWIN); \
+		} else { \
+			LOOP(__VA_ARGS__, Blend, NO_OBJWIN); \
+		} \
+	} else { \
+		if (!(flags & FLAG_TARGET_2)) { \
+			LOOP(__VA_ARGS__, NoBlend, OBJWIN); \
+		} else { \
+			LOOP(__VA_ARGS__, Blend, OBJWIN); \
+		} \
+	}
+
+#define DRAW_BITMAP_16(W, H, ADDRESS) \
+	if (!variant) { \
+		DRAW_BITMAP_SPECIALIZED(BITMAP_16_LOOP, W, H, ADDRESS, BITMAP_EFFECT_NONE); \
+	} else if (renderer->blendEffect == BLEND_BRIGHTEN) { \
+		color = BITMAP_EFFECT_BRIGHTEN(color); \
+		DRAW_BITMAP_SPECIALIZED(BITMAP_16_LOOP, W, H, ADDRESS, BITMAP_EFFECT_BRIGHTEN); \
+	} else if (renderer->blendEffect == BLEND_DARKEN) { \
+		color = BITMAP_EFFECT_DARKEN(color); \
+		DRAW_BITMAP_SPECIALIZED(BITMAP_16_LOOP, W, H, ADDRESS, BITMAP_EFFECT_DARKEN); \
+	}
+
+// With an identity transform and no mosaic, screen pixels map one to one onto a single
+// row of the bitmap, so the visible span can be found once instead of per pixel.
+static bool _bitmapIdentitySpan(const struct GBAVideoSoftwareRenderer* renderer, const struct GBAVideoSoftwareBackground* background, int width, int height, int* column, int* row, int* start, int* end) {
+	if (background->dx != 0x100 || background->dy || background->mosaic) {
+		return false;
+	}
+	*start = renderer->start;
+	*end = renderer->end;
+	if (background->sy < 0 || (background->sy >> 8) >= height) {
+		*end = *start;
+		return true;
+	}
+	int32_t firstColumn = background->sx >> 8;
+	if (*start < -firstColumn) {
+		*start = -firstColumn;
+	}
+	if (*end > width - firstColumn) {
+		*end = width - firstColumn;
+	}
+	*column = firstColumn + *start;
+	*row = background->sy >> 8;
+	return true;
+}
+
+static void _drawBitmap16Span(struct GBAVideoSoftwareRenderer* renderer, struct GBAVideoSoftwareBackground* background, uint32_t offset, int start, int end,
+                              uint32_t flags, uint32_t objwinFlags, bool variant, int objwinSlowPath) {
+	if (variant && renderer->blendEffect != BLEND_BRIGHTEN && renderer->blendEffect != BLEND_DARKEN) {
+		return;
+	}
+	uint32_t colors[GBA_VIDEO_HORIZONTAL_PIXELS];
+	int length = end - start;
+	int i;
+	for (i = 0; i < length; ++i) {
+		uint16_t color;
+		LOAD_16(color, offset + i * 2, renderer->d.vram);
+		colors[i] = mColorFrom555(color);
+	}
+	if (variant && renderer->blendEffect == BLEND_BRIGHTEN) {
+		for (i = 0; i < length; ++i) {
+			colors[i] = _brighten(colors[i], renderer->bldy);
+		}
+	} else if (variant) {
+		for (i = 0; i < length; ++i) {
+			colors[i] = _darken(colors[i], renderer->bldy);
+		}
+	}
+	uint32_t* pixel = &renderer->row[start];
+	if (!objwinSlowPath) {
+		if (!(flags & FLAG_TARGET_2)) {
+			BITMAP_16_SPAN_LOOP(NoBlend, NO_OBJWIN);
+		} else {
+			BITMAP_16_SPAN_LOOP(Blend, NO_OBJWIN);
+		}
+	} else {
+		if (!(flags & FLAG_TARGET_2)) {
+			BITMAP_16_SPAN_LOOP(NoBlend, OBJWIN);
+		} else {
+			BITMAP_16_SPAN_LOOP(Blend, OBJWIN);
+		}
+	}
+}
+
 void GBAVideoSoftwareRendererDrawBackgroundMode3(struct GBAVideoSoftwareRenderer* renderer, struct GBAVideoSoftwareBackground* background, int inY) {
 	BACKGROUND_BITMAP_INIT;
 
+	int column, row, start, end;
+	if (_bitmapIdentitySpan(renderer, background, GBA_VIDEO_HORIZONTAL_PIXELS, GBA_VIDEO_VERTICAL_PIXELS, &column, &row, &start, &end)) {
+		if (start < end) {
+			_drawBitmap16Span(renderer, background, (column + row * GBA_VIDEO_HORIZONTAL_PIXELS) << 1, start, end, flags, objwinFlags, variant, objwinSlowPath);
+		}
+		return;
+	}
+
 	uint32_t color = renderer->normalPalette[0];
 	if (mosaicWait && localX >= 0 && localY >= 0 && (localX >> 8) < GBA_VIDEO_HORIZONTAL_PIXELS && (localY >> 8) < GBA_VIDEO_VERTICAL_PIXELS) {
 		LOAD_16(color, ((localX >> 8) + (localY >> 8) * GBA_VIDEO_HORIZONTAL_PIXELS) << 1, renderer->d.vram);
@@ -115,32 +394,7 @@ void GBAVideoSoftwareRendererDrawBackgroundMode3(struct GBAVideoSoftwareRenderer
 
 	int outX;
 	uint32_t* pixel;
-	for (outX = renderer->start, pixel = &renderer->row[outX]; outX < renderer->end; ++outX, ++pixel) {
-		BACKGROUND_BITMAP_ITERATE(GBA_VIDEO_HORIZONTAL_PIXELS, GBA_VIDEO_VERTICAL_PIXELS);
-
-		if (!mosaicWait) {
-			LOAD_16(color, ((localX >> 8) + (localY >> 8) * GBA_VIDEO_HORIZONTAL_PIXELS) << 1, renderer->d.vram);
-			color = mColorFrom555(color);
-			mosaicWait = mosaicH;
-		} else {
-			--mosaicWait;
-		}
-
-		uint32_t current = *pixel;
-		if (!objwinSlowPath || (!(current & FLAG_OBJWIN)) != background->objwinOnly) {
-			unsigned mergedFlags = flags;
-			if (current & FLAG_OBJWIN) {
-				mergedFlags = objwinFlags;
-			}
-			if (!variant) {
-				_compositeBlendObjwin(renderer, pixel, color | mergedFlags, current);
-			} else if (renderer->blendEffect == BLEND_BRIGHTEN) {
-				_compositeBlendObjwin(renderer, pixel, _brighten(color, renderer->bldy) | mergedFlags, current);
-			} else if (renderer->blendEffect == BLEND_DARKEN) {
-				_compositeBlendObjwin(renderer, pixel, _darken(color, renderer->bldy) | mergedFlags, current);
-			}
-		}
-	}
+	DRAW_BITMAP_16(GBA_VIDEO_HORIZONTAL_PIXELS, GBA_VIDEO_VERTICAL_PIXELS, ((localX >> 8) + (localY >> 8) * GBA_VIDEO_HORIZONTAL_PIXELS) << 1);
 }
 
 void GBAVideoSoftwareRendererDrawBackgroundMode4(struct GBAVideoSoftwareRenderer* renderer, struct GBAVideoSoftwareBackground* background, int inY) {
@@ -157,31 +411,23 @@ void GBAVideoSoftwareRendererDrawBackgroundMode4(struct GBAVideoSoftwareRenderer
 
 	int outX;
 	uint32_t* pixel;
-	for (outX = renderer->start, pixel = &renderer->row[outX]; outX < renderer->end; ++outX, ++pixel) {
-		BACKGROUND_BITMAP_ITERATE(GBA_VIDEO_HORIZONTAL_PIXELS, GBA_VIDEO_VERTICAL_PIXELS);
-
-		if (!mosaicWait) {
-			color = ((uint8_t*)renderer->d.vram)[offset + (localX >> 8) + (localY >> 8) * GBA_VIDEO_HORIZONTAL_PIXELS];
-
-			mosaicWait = mosaicH;
-		} else {
-			--mosaicWait;
+	int column, row, start, end;
+	if (_bitmapIdentitySpan(renderer, background, GBA_VIDEO_HORIZONTAL_PIXELS, GBA_VIDEO_VERTICAL_PIXELS, &column, &row, &start, &end)) {
+		if (start >= end) {
+			return;
 		}
-
-		uint32_t current = *pixel;
-		if (color && IS_WRITABLE(current)) {
-			if (!objwinSlowPath) {
-				_compositeBlendNoObjwin(renderer, pixel, palette[color] | flags, current);
-			} else if (background->objwinForceEnable || (!(current & FLAG_OBJWIN)) == background->objwinOnly) {
-				mColor* currentPalette = (current & FLAG_OBJWIN) ? objwinPalette : palette;
-				unsigned mergedFlags = flags;
-				if (current & FLAG_OBJWIN) {
-					mergedFlags = objwinFlags;
-				}
-				_compositeBlendObjwin(renderer, pixel, currentPalette[color] | mergedFlags, current);
-			}
+		const uint8_t* indices = &((const uint8_t*) renderer->d.vram)[offset + column + row * GBA_VIDEO_HORIZONTAL_PIXELS];
+		// Mode 4 never swaps in the normal palette for pixels that get reblended, so the
+		// shared row compositor only matches when the normal palette is in use anyway
+		if (!objwinSlowPath && palette == renderer->normalPalette) {
+			GBAVideoSoftwareRendererCompositeDecodedRow(renderer, palette, flags, flags & FLAG_TARGET_2, indices, start, end);
+		} else {
+			DRAW_BITMAP_SPECIALIZED(BITMAP_8_LOOP, SPAN, start, end);
 		}
+		return;
 	}
+
+	DRAW_BITMAP_SPECIALIZED(BITMAP_8_LOOP, ITERATE, renderer->start, renderer->end);
 }
 
 void GBAVideoSoftwareRendererDrawBackgroundMode5(struct GBAVideoSoftwareRenderer* renderer, struct GBAVideoSoftwareBackground* background, int inY) {
@@ -197,32 +443,15 @@ void GBAVideoSoftwareRendererDrawBackgroundMode5(struct GBAVideoSoftwareRenderer
 		color = mColorFrom555(color);
 	}
 
-	int outX;
-	uint32_t* pixel;
-	for (outX = renderer->start, pixel = &renderer->row[outX]; outX < renderer->end; ++outX, ++pixel) {
-		BACKGROUND_BITMAP_ITERATE(160, 128);
-
-		if (!mosaicWait) {
-			LOAD_16(color, offset + (localX >> 8) * 2 + (localY >> 8) * 320, renderer->d.vram);
-			color = mColorFrom555(color);
-			mosaicWait = mosaicH;
-		} else {
-			--mosaicWait;
-		}
-
-		uint32_t current = *pixel;
-		if (!objwinSlowPath || (!(current & FLAG_OBJWIN)) != background->objwinOnly) {
-			unsigned mergedFlags = flags;
-			if (current & FLAG_OBJWIN) {
-				mergedFlags = objwinFlags;
-			}
-			if (!variant) {
-				_compositeBlendObjwin(renderer, pixel, color | mergedFlags, current);
-			} else if (renderer->blendEffect == BLEND_BRIGHTEN) {
-				_compositeBlendObjwin(renderer, pixel, _brighten(color, renderer->bldy) | mergedFlags, current);
-			} else if (renderer->blendEffect == BLEND_DARKEN) {
-				_compositeBlendObjwin(renderer, pixel, _darken(color, renderer->bldy) | mergedFlags, current);
-			}
+	int column, row, start, end;
+	if (_bitmapIdentitySpan(renderer, background, 160, 128, &column, &row, &start, &end)) {
+		if (start < end) {
+			_drawBitmap16Span(renderer, background, offset + column * 2 + row * 320, start, end, flags, objwinFlags, variant, objwinSlowPath);
 		}
+		return;
 	}
+
+	int outX;
+	uint32_t* pixel;
+	DRAW_BITMAP_16(160, 128, offset + (localX >> 8) * 2 + (localY >> 8) * 320);
 }
@@ -0,0 +1,290 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "gba/renderers/software-private.h"
+
+// Row-wide versions of the compositing and color effect helpers. Where the target has
+// vector instructions as part of its baseline (SSE2 on x86-64, NEON on AArch64 and
+// NEON-enabled ARM builds), four pixels are processed at a time without branching.
+// The vector paths must produce exactly what the scalar helpers do, so they only cover
+// the 8-bit per channel color format; 16-bit color builds always use the scalar code.
+#ifndef COLOR_16_BIT
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define ROW_VECTOR
+typedef __m128i RowVector;
+
+static inline RowVector _vecLoad(const uint32_t* src) {
+	return _mm_loadu_si128((const __m128i*) src);
+}
+
+static inline RowVector _vecLoadBytes(const uint8_t* src) {
+	uint32_t bytes;
+	memcpy(&bytes, src, sizeof(bytes));
+	__m128i zero = _mm_setzero_si128();
+	return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero);
+}
+
+static inline void _vecStore(uint32_t* dest, RowVector value) {
+	_mm_storeu_si128((__m128i*) dest, value);
+}
+
+static inline RowVector _vecSplat(uint32_t value) {
+	return _mm_set1_epi32(value);
+}
+
+static inline RowVector _vecAnd(RowVector a, RowVector b) {
+	return _mm_and_si128(a, b);
+}
+
+static inline RowVector _vecAndNot(RowVector a, RowVector b) {
+	return _mm_andnot_si128(b, a);
+}
+
+static inline RowVector _vecSelect(RowVector mask, RowVector a, RowVector b) {
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static inline RowVector _vecEqual(RowVector a, RowVector b) {
+	return _mm_cmpeq_epi32(a, b);
+}
+
+static inline RowVector _vecTest(RowVector a, uint32_t bits) {
+	return _mm_xor_si128(_mm_cmpeq_epi32(_mm_and_si128(a, _mm_set1_epi32(bits)), _mm_setzero_si128()), _mm_set1_epi32(-1));
+}
+
+static inline RowVector _vecGreaterEqual(RowVector a, RowVector b) {
+	// SSE2 only has signed comparisons, so flip the sign bits first
+	__m128i sign = _mm_set1_epi32(0x80000000);
+	__m128i less = _mm_cmpgt_epi32(_mm_xor_si128(b, sign), _mm_xor_si128(a, sign));
+	return _mm_xor_si128(less, _mm_set1_epi32(-1));
+}
+
+static inline RowVector _vecMix(int weightA, RowVector colorA, int weightB, RowVector colorB) {
+	__m128i zero = _mm_setzero_si128();
+	__m128i wa = _mm_set1_epi16(weightA);
+	__m128i wb = _mm_set1_epi16(weightB);
+	__m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(colorA, zero), wa), _mm_mullo_epi16(_mm_unpacklo_epi8(colorB, zero), wb));
+	__m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(colorA, zero), wa), _mm_mullo_epi16(_mm_unpackhi_epi8(colorB, zero), wb));
+	// Saturating the pack matches the clamping in mColorMix5Bit
+	__m128i mixed = _mm_packus_epi16(_mm_srli_epi16(lo, 4), _mm_srli_epi16(hi, 4));
+	return _mm_and_si128(mixed, _mm_set1_epi32(0x00FFFFFF));
+}
+
+static inline RowVector _vecBrighten(RowVector color, int y) {
+	__m128i zero = _mm_setzero_si128();
+	__m128i max = _mm_set1_epi16(0xFF);
+	__m128i wy = _mm_set1_epi16(y);
+	__m128i lo = _mm_unpacklo_epi8(color, zero);
+	__m128i hi = _mm_unpackhi_epi8(color, zero);
+	lo = _mm_add_epi16(lo, _mm_srli_epi16(_mm_mullo_epi16(_mm_sub_epi16(max, lo), wy), 4));
+	hi = _mm_add_epi16(hi, _mm_srli_epi16(_mm_mullo_epi16(_mm_sub_epi16(max, hi), wy), 4));
+	return _mm_and_si128(_mm_packus_epi16(lo, hi), _mm_set1_epi32(0x00FFFFFF));
+}
+
+static inline RowVector _vecDarken(RowVector color, int y) {
+	__m128i zero = _mm_setzero_si128();
+	__m128i wy = _mm_set1_epi16(16 - y);
+	// _darken rounds the lowest channel up and the others down
+	__m128i bias = _mm_set_epi16(0, 0, 0, 15, 0, 0, 0, 15);
+	__m128i lo = _mm_unpacklo_epi8(color, zero);
+	__m128i hi = _mm_unpackhi_epi8(color, zero);
+	lo = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(lo, wy), bias), 4);
+	hi = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(hi, wy), bias), 4);
+	return _mm_and_si128(_mm_packus_epi16(lo, hi), _mm_set1_epi32(0x00FFFFFF));
+}
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define ROW_VECTOR
+typedef uint32x4_t RowVector;
+
+static inline RowVector _vecLoad(const uint32_t* src) {
+	return vld1q_u32(src);
+}
+
+static inline RowVector _vecLoadBytes(const uint8_t* src) {
+	uint32_t bytes;
+	memcpy(&bytes, src, sizeof(bytes));
+	uint16x8_t wide = vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(bytes)));
+	return vmovl_u16(vget_low_u16(wide));
+}
+
+static inline void _vecStore(uint32_t* dest, RowVector value) {
+	vst1q_u32(dest, value);
+}
+
+static inline RowVector _vecSplat(uint32_t value) {
+	return vdupq_n_u32(value);
+}
+
+static inline RowVector _vecAnd(RowVector a, RowVector b) {
+	return vandq_u32(a, b);
+}
+
+static inline RowVector _vecAndNot(RowVector a, RowVector b) {
+	return vbicq_u32(a, b);
+}
+
+static inline RowVector _vecSelect(RowVector mask, RowVector a, RowVector b) {
+	return vbslq_u32(mask, a, b);
+}
+
+static inline RowVector _vecEqual(RowVector a, RowVector b) {
+	return vceqq_u32(a, b);
+}
+
+static inline RowVector _vecTest(RowVector a, uint32_t bits) {
+	return vtstq_u32(a, vdupq_n_u32(bits));
+}
+
+static inline RowVector _vecGreaterEqual(RowVector a, RowVector b) {
+	return vcgeq_u32(a, b);
+}
+
+static inline RowVector _vecMix(int weightA, RowVector colorA, int weightB, RowVector colorB) {
+	uint8x16_t a = vreinterpretq_u8_u32(colorA);
+	uint8x16_t b = vreinterpretq_u8_u32(colorB);
+	uint16x8_t lo = vmlaq_n_u16(vmulq_n_u16(vmovl_u8(vget_low_u8(a)), weightA), vmovl_u8(vget_low_u8(b)), weightB);
+	uint16x8_t hi = vmlaq_n_u16(vmulq_n_u16(vmovl_u8(vget_high_u8(a)), weightA), vmovl_u8(vget_high_u8(b)), weightB);
+	// Saturating the narrow matches the clamping in mColorMix5Bit
+	uint8x16_t mixed = vcombine_u8(vqshrn_n_u16(lo, 4), vqshrn_n_u16(hi, 4));
+	return vandq_u32(vreinterpretq_u32_u8(mixed), vdupq_n_u32(0x00FFFFFF));
+}
+
+static inline RowVector _vecBrighten(RowVector color, int y) {
+	uint8x16_t c = vreinterpretq_u8_u32(color);
+	uint16x8_t max = vdupq_n_u16(0xFF);
+	uint16x8_t lo = vmovl_u8(vget_low_u8(c));
+	uint16x8_t hi = vmovl_u8(vget_high_u8(c));
+	lo = vaddq_u16(lo, vshrq_n_u16(vmulq_n_u16(vsubq_u16(max, lo), y), 4));
+	hi = vaddq_u16(hi, vshrq_n_u16(vmulq_n_u16(vsubq_u16(max, hi), y), 4));
+	uint8x16_t result = vcombine_u8(vmovn_u16(lo), vmovn_u16(hi));
+	return vandq_u32(vreinterpretq_u32_u8(result), vdupq_n_u32(0x00FFFFFF));
+}
+
+static inline RowVector _vecDarken(RowVector color, int y) {
+	static const uint16_t biasLanes[8] = { 15, 0, 0, 0, 15, 0, 0, 0 };
+	uint8x16_t c = vreinterpretq_u8_u32(color);
+	// _darken rounds the lowest channel up and the others down
+	uint16x8_t bias = vld1q_u16(biasLanes);
+	uint16x8_t lo = vshrq_n_u16(vmlaq_n_u16(bias, vmovl_u8(vget_low_u8(c)), 16 - y), 4);
+	uint16x8_t hi = vshrq_n_u16(vmlaq_n_u16(bias, vmovl_u8(vget_high_u8(c)), 16 - y), 4);
+	uint8x16_t result = vcombine_u8(vmovn_u16(lo), vmovn_u16(hi));
+	return vandq_u32(vreinterpretq_u32_u8(result), vdupq_n_u32(0x00FFFFFF));
+}
+#endif
+#endif
+
+static inline void _compositeDecodedPixel(struct GBAVideoSoftwareRenderer* renderer, const mColor* palette, uint32_t flags, bool blend, uint32_t* pixel, int pixelData) {
+	uint32_t current = *pixel;
+	if (!pixelData || !IS_WRITABLE(current)) {
+		return;
+	}
+	unsigned color;
+	if ((current & (FLAG_IS_BACKGROUND | FLAG_REBLEND)) == FLAG_REBLEND) {
+		color = renderer->normalPalette[pixelData];
+	} else {
+		color = palette[pixelData];
+	}
+	if (blend) {
+		_compositeBlendNoObjwin(renderer, pixel, color | flags, current);
+	} else {
+		_compositeNoBlendNoObjwin(renderer, pixel, color | flags, current);
+	}
+}
+
+void GBAVideoSoftwareRendererCompositeDecodedRow(struct GBAVideoSoftwareRenderer* renderer, const mColor* palette, uint32_t flags, bool blend, const uint8_t* decoded, int x, int end) {
+	uint32_t* pixel = &renderer->row[x];
+#ifdef ROW_VECTOR
+	uint32_t colors[GBA_VIDEO_HORIZONTAL_PIXELS];
+	uint32_t normalColors[GBA_VIDEO_HORIZONTAL_PIXELS];
+	bool reblend = palette != renderer->normalPalette;
+	int length = end - x;
+	int i;
+	for (i = 0; i < length; ++i) {
+		colors[i] = palette[decoded[i]] | flags;
+	}
+	if (reblend) {
+		for (i = 0; i < length; ++i) {
+			normalColors[i] = renderer->normalPalette[decoded[i]] | flags;
+		}
+	}
+	for (i = 0; i + 4 <= length; i += 4) {
+		RowVector current = _vecLoad(&pixel[i]);
+		RowVector color = _vecLoad(&colors[i]);
+		RowVector active = _vecAnd(_vecTest(_vecLoadBytes(&decoded[i]), 0xFF), _vecTest(current, 0xFE000000));
+		if (reblend) {
+			RowVector useNormal = _vecEqual(_vecAnd(current, _vecSplat(FLAG_IS_BACKGROUND | FLAG_REBLEND)), _vecSplat(FLAG_REBLEND));
+			color = _vecSelect(useNormal, _vecLoad(&normalColors[i]), color);
+		}
+		RowVector below = _vecGreaterEqual(color, current);
+		RowVector kept = _vecAnd(current, _vecSplat(0x00FFFFFF | FLAG_REBLEND | FLAG_OBJWIN));
+		RowVector result;
+		if (blend) {
+			RowVector mix = _vecAnd(_vecTest(current, FLAG_TARGET_1), _vecTest(color, FLAG_TARGET_2));
+			kept = _vecSelect(mix, _vecMix(renderer->blda, current, renderer->bldb, color), kept);
+			result = _vecSelect(below, kept, _vecAndNot(color, _vecSplat(FLAG_TARGET_2)));
+		} else {
+			result = _vecSelect(below, kept, color);
+		}
+		_vecStore(&pixel[i], _vecSelect(active, result, current));
+	}
+	pixel += i;
+	decoded += i;
+	x += i;
+#endif
+	for (; x < end; ++x, ++pixel, ++decoded) {
+		_compositeDecodedPixel(renderer, palette, flags, blend, pixel, *decoded);
+	}
+}
+
+void GBAVideoSoftwareRendererBlendBackdrop(struct GBAVideoSoftwareRenderer* renderer, uint32_t backdrop, int x, int end) {
+#ifdef ROW_VECTOR
+	RowVector backdropVector = _vecSplat(backdrop);
+	for (; x + 4 <= end; x += 4) {
+		RowVector color = _vecLoad(&renderer->row[x]);
+		RowVector mixed = _vecMix(renderer->bldb, backdropVector, renderer->blda, color);
+		_vecStore(&renderer->row[x], _vecSelect(_vecTest(color, FLAG_TARGET_1), mixed, color));
+	}
+#endif
+	for (; x < end; ++x) {
+		uint32_t color = renderer->row[x];
+		if (color & FLAG_TARGET_1) {
+			renderer->row[x] = mColorMix5Bit(renderer->bldb, backdrop, renderer->blda, color);
+		}
+	}
+}
+
+void GBAVideoSoftwareRendererBrightenRow(struct GBAVideoSoftwareRenderer* renderer, uint32_t mask, uint32_t match, int x, int end) {
+#ifdef ROW_VECTOR
+	for (; x + 4 <= end; x += 4) {
+		RowVector color = _vecLoad(&renderer->row[x]);
+		RowVector selected = _vecEqual(_vecAnd(color, _vecSplat(mask)), _vecSplat(match));
+		_vecStore(&renderer->row[x], _vecSelect(selected, _vecBrighten(color, renderer->bldy), color));
+	}
+#endif
+	for (; x < end; ++x) {
+		uint32_t color = renderer->row[x];
+		if ((color & mask) == match) {
+			renderer->row[x] = _brighten(color, renderer->bldy);
+		}
+	}
+}
+
+void GBAVideoSoftwareRendererDarkenRow(struct GBAVideoSoftwareRenderer* renderer, uint32_t mask, uint32_t match, int x, int end) {
+#ifdef ROW_VECTOR
+	for (; x + 4 <= end; x += 4) {
+		RowVector color = _vecLoad(&renderer->row[x]);
+		RowVector selected = _vecEqual(_vecAnd(color, _vecSplat(mask)), _vecSplat(match));
+		_vecStore(&renderer->row[x], _vecSelect(selected, _vecDarken(color, renderer->bldy), color));
+	}
+#endif
+	for (; x < end; ++x) {
+		uint32_t color = renderer->row[x];
+		if ((color & mask) == match) {
+			renderer->row[x] = _darken(color, renderer->bldy);
+		}
+	}
+}
@@ -15,54 +15,6 @@
 	screenBase = yBase + (xBase >> 3); \
 	LOAD_16(mapData, screenBase << 1, vram); \
 
-#define DRAW_BACKGROUND_MODE_0_TILE_SUFFIX_16(BLEND, OBJWIN) \
-	paletteData = GBA_TEXT_MAP_PALETTE(mapData) << 4; \
-	charBase = (background->charBase + (GBA_TEXT_MAP_TILE(mapData) << 5)) + (localY << 2); \
-	LOAD_32(tileData, charBase, vram); \
-	if (!GBA_TEXT_MAP_HFLIP(mapData)) { \
-		tileData >>= 4 * mod8; \
-		for (; outX < end; ++outX, ++pixel) { \
-			BACKGROUND_DRAW_PIXEL_16(BLEND, OBJWIN, 0); \
-		} \
-	} else { \
-		for (outX = end - 1; outX >= renderer->start; --outX) { \
-			uint32_t* pixel = &renderer->row[outX]; \
-			BACKGROUND_DRAW_PIXEL_16(BLEND, OBJWIN, 0); \
-		} \
-	}
-
-#define DRAW_BACKGROUND_MODE_0_TILE_PREFIX_16(BLEND, OBJWIN) \
-	charBase = (background->charBase + (GBA_TEXT_MAP_TILE(mapData) << 5)) + (localY << 2); \
-	LOAD_32(tileData, charBase, vram); \
-	paletteData = GBA_TEXT_MAP_PALETTE(mapData) << 4; \
-	pixel = &renderer->row[outX]; \
-	if (!GBA_TEXT_MAP_HFLIP(mapData)) { \
-		if (outX < renderer->start) { \
-			tileData >>= 4 * (renderer->start - outX); \
-			outX = renderer->start; \
-			pixel = &renderer->row[outX]; \
-		} \
-		for (; outX < renderer->end; ++outX, ++pixel) { \
-			BACKGROUND_DRAW_PIXEL_16(BLEND, OBJWIN, 0); \
-		} \
-	} else { \
-		tileData >>= 4 * (0x8 - mod8); \
-		int end = renderer->end - 8; \
-		if (end < -1) { \
-			end = -1; \
-		} \
-		outX = renderer->end - 1; \
-		pixel = &renderer->row[outX]; \
-		for (; outX > end; --outX, --pixel) { \
-			BACKGROUND_DRAW_PIXEL_16(BLEND, OBJWIN, 0); \
-		} \
-		/* Needed for consistency checks */ \
-		if (VIDEO_CHECKS) { \
-			outX = renderer->end; \
-			pixel = &renderer->row[outX]; \
-		} \
-	}
-
 #define DRAW_BACKGROUND_MODE_0_MOSAIC_16(BLEND, OBJWIN) \
 	x = inX & 7; \
 	if (mosaicWait) { \
@@ -141,182 +93,6 @@
 		x = 0; \
 	}
 
-#define DRAW_BACKGROUND_MODE_0_TILES_16(BLEND, OBJWIN) \
-	for (; tileX < tileEnd; ++tileX) { \
-		mapData = background->mapCache[(localX >> 3) & 0x3F]; \
-		localX += 8; \
-		localY = inY & 0x7; \
-		if (GBA_TEXT_MAP_VFLIP(mapData)) { \
-			localY = 7 - localY; \
-		} \
-		paletteData = GBA_TEXT_MAP_PALETTE(mapData) << 4; \
-		charBase = (background->charBase + (GBA_TEXT_MAP_TILE(mapData) << 5)) + (localY << 2); \
-		if (UNLIKELY(charBase >= 0x10000)) { \
-			pixel += 8; \
-			continue; \
-		} \
-		if (!GBA_TEXT_MAP_HFLIP(mapData)) { \
-			LOAD_32(tileData, charBase, vram); \
-		} else { \
-			LOAD_32BE(tileData, charBase, vram); \
-			tileData = ((tileData & 0xF0F0F0F0) >> 4) | ((tileData & 0x0F0F0F0F) << 4); \
-		} \
-		if (tileData) { \
-			BACKGROUND_DRAW_PIXEL_16(BLEND, OBJWIN, 0); \
-			BACKGROUND_DRAW_PIXEL_16(BLEND, OBJWIN, 1); \
-			BACKGROUND_DRAW_PIXEL_16(BLEND, OBJWIN, 2); \
-			BACKGROUND_DRAW_PIXEL_16(BLEND, OBJWIN, 3); \
-			BACKGROUND_DRAW_PIXEL_16(BLEND, OBJWIN, 4); \
-			BACKGROUND_DRAW_PIXEL_16(BLEND, OBJWIN, 5); \
-			BACKGROUND_DRAW_PIXEL_16(BLEND, OBJWIN, 6); \
-			BACKGROUND_DRAW_PIXEL_16(BLEND, OBJWIN, 7); \
-		} \
-		pixel += 8; \
-	}
-
-#define DRAW_BACKGROUND_MODE_0_TILE_SUFFIX_256(BLEND, OBJWIN) \
-	charBase = (background->charBase + (GBA_TEXT_MAP_TILE(mapData) << 6)) + (localY << 3); \
-	int end2 = end - 4; \
-	if (!GBA_TEXT_MAP_HFLIP(mapData)) { \
-		int shift = inX & 0x3; \
-		if (LIKELY(charBase < 0x10000)) { \
-			if (end2 > outX) { \
-				LOAD_32(tileData, charBase, vram); \
-				tileData >>= 8 * shift; \
-				shift = 0; \
-				for (; outX < end2; ++outX, ++pixel) { \
-					BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 0); \
-				} \
-			} \
-		} \
-		\
-		if (LIKELY(charBase < 0x10000)) { \
-			LOAD_32(tileData, charBase + 4, vram); \
-			tileData >>= 8 * shift; \
-			for (; outX < end; ++outX, ++pixel) { \
-				BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 0); \
-			} \
-		} \
-	} else { \
-		int start = outX; \
-		outX = end - 1; \
-		pixel = &renderer->row[outX]; \
-		if (LIKELY(charBase < 0x10000)) { \
-			if (end2 > start) { \
-				LOAD_32(tileData, charBase, vram); \
-				for (; outX >= end2; --outX, --pixel) { \
-					BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 0); \
-				} \
-				charBase += 4; \
-			} \
-		} \
-		\
-		if (LIKELY(charBase < 0x10000)) { \
-			LOAD_32(tileData, charBase, vram); \
-			for (; outX >= renderer->start; --outX, --pixel) { \
-				BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 0); \
-			} \
-		} \
-		outX = end; \
-		pixel = &renderer->row[outX]; \
-	}
-
-#define DRAW_BACKGROUND_MODE_0_TILE_PREFIX_256(BLEND, OBJWIN) \
-	charBase = (background->charBase + (GBA_TEXT_MAP_TILE(mapData) << 6)) + (localY << 3); \
-	if (UNLIKELY(charBase >= 0x10000)) { \
-		return; \
-	} \
-	int end = mod8 - 4; \
-	pixel = &renderer->row[outX]; \
-	if (!GBA_TEXT_MAP_HFLIP(mapData)) { \
-		if (end > 0) { \
-			LOAD_32(tileData, charBase, vram); \
-			for (; outX < renderer->end - end; ++outX, ++pixel) { \
-				BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 0); \
-			} \
-			charBase += 4; \
-		} \
-		\
-		LOAD_32(tileData, charBase, vram); \
-		for (; outX < renderer->end; ++outX, ++pixel) { \
-			BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 0); \
-		} \
-	} else { \
-		int shift = (8 - mod8) & 0x3; \
-		int start = outX; \
-		outX = renderer->end - 1; \
-		pixel = &renderer->row[outX]; \
-		if (end > 0) { \
-			LOAD_32(tileData, charBase, vram); \
-			tileData >>= 8 * shift; \
-			for (; outX >= start + 4; --outX, --pixel) { \
-				BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 0); \
-			} \
-			shift = 0; \
-		} \
-		\
-		LOAD_32(tileData, charBase + 4, vram); \
-		tileData >>= 8 * shift; \
-		for (; outX >= start; --outX, --pixel) { \
-			BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 0); \
-		} \
-		/* Needed for consistency checks */ \
-		if (VIDEO_CHECKS) { \
-			outX = renderer->end; \
-			pixel = &renderer->row[outX]; \
-		} \
-	}
-
-#define DRAW_BACKGROUND_MODE_0_TILES_256(BLEND, OBJWIN) \
-	for (; tileX < tileEnd; ++tileX) { \
-		mapData = background->mapCache[(localX >> 3) & 0x3F]; \
-		localX += 8; \
-		localY = inY & 0x7; \
-		if (GBA_TEXT_MAP_VFLIP(mapData)) { \
-			localY = 7 - localY; \
-		} \
-		charBase = (background->charBase + (GBA_TEXT_MAP_TILE(mapData) << 6)) + (localY << 3); \
-		if (UNLIKELY(charBase >= 0x10000)) { \
-			pixel += 8; \
-			continue; \
-		} \
-		if (!GBA_TEXT_MAP_HFLIP(mapData)) { \
-			LOAD_32(tileData, charBase, vram); \
-			if (tileData) { \
-					BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 0); \
-					BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 1); \
-					BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 2); \
-					BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 3); \
-			} \
-			pixel += 4; \
-			LOAD_32(tileData, charBase + 4, vram); \
-			if (tileData) { \
-					BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 0); \
-					BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 1); \
-					BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 2); \
-					BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 3); \
-			} \
-			pixel += 4; \
-		} else { \
-			LOAD_32(tileData, charBase + 4, vram); \
-			if (tileData) { \
-				BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 3); \
-				BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 2); \
-				BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 1); \
-				BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 0); \
-			} \
-			pixel += 4; \
-			LOAD_32(tileData, charBase, vram); \
-			if (tileData) { \
-				BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 3); \
-				BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 2); \
-				BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 1); \
-				BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 0); \
-			} \
-			pixel += 4; \
-		} \
-	}
-
 #define DRAW_BACKGROUND_MODE_0_MOSAIC_256(BLEND, OBJWIN) \
 	x = inX & 7; \
 	if (mosaicWait) { \
@@ -411,78 +187,93 @@
 		x = 0; \
 	}
 
-#define DRAW_BACKGROUND_MODE_0(BPP, BLEND, OBJWIN) \
+#define DRAW_BACKGROUND_MODE_0_MOSAIC(BPP, BLEND, OBJWIN) \
 	uint32_t* pixel = &renderer->row[outX]; \
-	if (background->mosaic && GBAMosaicControlGetBgH(renderer->mosaic)) { \
-		int mosaicH = GBAMosaicControlGetBgH(renderer->mosaic) + 1; \
-		int x; \
-		int mosaicWait = (mosaicH - outX + GBA_VIDEO_HORIZONTAL_PIXELS * mosaicH) % mosaicH; \
-		int carryData = 0; \
-		paletteData = 0; /* Quiets compiler warning */ \
-		DRAW_BACKGROUND_MODE_0_MOSAIC_ ## BPP (BLEND, OBJWIN) \
-		return; \
-	} \
-	\
-	if (inX & 0x7) { \
-		localX = tileX * 8 + inX; \
-		BACKGROUND_TEXT_SELECT_CHARACTER; \
-		localY = inY & 0x7; \
-		if (GBA_TEXT_MAP_VFLIP(mapData)) { \
-			localY = 7 - localY; \
-		} \
-		int mod8 = inX & 0x7; \
-		int end = outX + 0x8 - mod8; \
-		if (end > renderer->end) { \
-			end = renderer->end; \
-		} \
-		if (UNLIKELY(end == outX)) { \
-			return; \
-		} \
-		if (UNLIKELY(end < outX)) { \
-			mLOG(GBA_VIDEO, FATAL, "Out of bounds background draw!"); \
-			return; \
-		} \
-		DRAW_BACKGROUND_MODE_0_TILE_SUFFIX_ ## BPP (BLEND, OBJWIN) \
-		outX = end; \
-		if (tileX < tileEnd) { \
-			++tileX; \
-		} else if (VIDEO_CHECKS && UNLIKELY(tileX > tileEnd)) { \
-			mLOG(GBA_VIDEO, FATAL, "Invariant doesn't hold in background draw! tileX (%u) > tileEnd (%u)", tileX, tileEnd); \
-			return; \
-		} \
-		length -= end - renderer->start; \
-	} \
-	/*! TODO: Make sure these lines can be removed */ \
-	/*!*/ pixel = &renderer->row[outX]; \
-	outX += (tileEnd - tileX) * 8; \
-	/*!*/ if (VIDEO_CHECKS &&  UNLIKELY(outX > GBA_VIDEO_HORIZONTAL_PIXELS)) { \
-	/*!*/	mLOG(GBA_VIDEO, FATAL, "Out of bounds background draw would occur!"); \
-	/*!*/	return; \
-	/*!*/ } \
-	localX = (tileX * 8 + inX) & 0x1FF; \
-	DRAW_BACKGROUND_MODE_0_TILES_ ## BPP (BLEND, OBJWIN) \
-	if (length & 0x7) { \
-		localX = tileX * 8 + inX; \
-		BACKGROUND_TEXT_SELECT_CHARACTER; \
-		localY = inY & 0x7; \
-		if (GBA_TEXT_MAP_VFLIP(mapData)) { \
-			localY = 7 - localY; \
-		} \
-		int mod8 = length & 0x7; \
-		if (VIDEO_CHECKS && UNLIKELY(outX + mod8 != renderer->end)) { \
-			mLOG(GBA_VIDEO, FATAL, "Invariant doesn't hold in background draw!"); \
-			return; \
+	int mosaicH = GBAMosaicControlGetBgH(renderer->mosaic) + 1; \
+	int x; \
+	int mosaicWait = (mosaicH - outX + GBA_VIDEO_HORIZONTAL_PIXELS * mosaicH) % mosaicH; \
+	int carryData = 0; \
+	paletteData = 0; /* Quiets compiler warning */ \
+	DRAW_BACKGROUND_MODE_0_MOSAIC_ ## BPP (BLEND, OBJWIN)
+
+#define DRAW_BACKGROUND_MODE_0_DECODED(BLEND, OBJWIN) \
+	uint32_t* pixel = &renderer->row[outX]; \
+	for (; outX < renderer->end; ++outX, ++pixel) { \
+		pixelData = *decoded; \
+		++decoded; \
+		current = *pixel; \
+		if (pixelData && IS_WRITABLE(current)) { \
+			COMPOSITE_256_ ## OBJWIN (BLEND, 0); \
 		} \
-		DRAW_BACKGROUND_MODE_0_TILE_PREFIX_ ## BPP (BLEND, OBJWIN) \
-	} \
-	if (VIDEO_CHECKS && UNLIKELY(&renderer->row[outX] != pixel)) { \
-		mLOG(GBA_VIDEO, FATAL, "Background draw ended in the wrong place! Diff: %" PRIXPTR, &renderer->row[outX] - pixel); \
-	} \
-	if (VIDEO_CHECKS && UNLIKELY(outX > GBA_VIDEO_HORIZONTAL_PIXELS)) { \
-		mLOG(GBA_VIDEO, FATAL, "Out of bounds background draw occurred!"); \
-		return; \
 	}
 
+// Tile rows are decoded into one byte per pixel before compositing. For 16-color
+// backgrounds the byte carries the palette bank too, and 0 is always transparent,
+// so both color depths share a single compositing loop.
+static inline uint32_t _expandNibbles(uint32_t nibbles, uint32_t paletteData) {
+	nibbles = (nibbles | (nibbles << 8)) & 0x00FF00FF;
+	nibbles = (nibbles | (nibbles << 4)) & 0x0F0F0F0F;
+	uint32_t opaque = ((nibbles + 0x7F7F7F7F) >> 7) & 0x01010101;
+	return nibbles | (opaque * paletteData);
+}
+
+static void _decodeRow16(const struct GBAVideoSoftwareBackground* background, const uint16_t* vram, int inX, int inY, int length, uint32_t* decoded) {
+	int tiles = ((inX & 0x7) + length + 7) >> 3;
+	// Partially covered tiles at either end of the span have never been checked for overflowing into OBJ VRAM
+	int firstPartial = (inX & 0x7) ? 0 : -1;
+	int lastPartial = ((inX + length) & 0x7) ? tiles - 1 : -1;
+	int localX = inX;
+	int tile;
+	for (tile = 0; tile < tiles; ++tile, localX += 8) {
+		uint16_t mapData = background->mapCache[(localX >> 3) & 0x3F];
+		int localY = inY & 0x7;
+		if (GBA_TEXT_MAP_VFLIP(mapData)) {
+			localY = 7 - localY;
+		}
+		uint32_t charBase = (background->charBase + (GBA_TEXT_MAP_TILE(mapData) << 5)) + (localY << 2);
+		uint32_t tileData;
+		if (UNLIKELY(charBase >= 0x10000) && tile != firstPartial && tile != lastPartial) {
+			tileData = 0;
+		} else if (!GBA_TEXT_MAP_HFLIP(mapData)) {
+			LOAD_32(tileData, charBase, vram);
+		} else {
+			LOAD_32BE(tileData, charBase, vram);
+			tileData = ((tileData & 0xF0F0F0F0) >> 4) | ((tileData & 0x0F0F0F0F) << 4);
+		}
+		uint32_t paletteData = GBA_TEXT_MAP_PALETTE(mapData) << 4;
+		STORE_32LE(_expandNibbles(tileData & 0xFFFF, paletteData), tile * 8, decoded);
+		STORE_32LE(_expandNibbles(tileData >> 16, paletteData), tile * 8 + 4, decoded);
+	}
+}
+
+static void _decodeRow256(const struct GBAVideoSoftwareBackground* background, const uint16_t* vram, int inX, int inY, int length, uint32_t* decoded) {
+	int tiles = ((inX & 0x7) + length + 7) >> 3;
+	int localX = inX;
+	int tile;
+	for (tile = 0; tile < tiles; ++tile, localX += 8) {
+		uint16_t mapData = background->mapCache[(localX >> 3) & 0x3F];
+		int localY = inY & 0x7;
+		if (GBA_TEXT_MAP_VFLIP(mapData)) {
+			localY = 7 - localY;
+		}
+		uint32_t charBase = (background->charBase + (GBA_TEXT_MAP_TILE(mapData) << 6)) + (localY << 3);
+		uint32_t left;
+		uint32_t right;
+		if (UNLIKELY(charBase >= 0x10000)) {
+			left = 0;
+			right = 0;
+		} else if (!GBA_TEXT_MAP_HFLIP(mapData)) {
+			LOAD_32(left, charBase, vram);
+			LOAD_32(right, charBase + 4, vram);
+		} else {
+			LOAD_32BE(left, charBase + 4, vram);
+			LOAD_32BE(right, charBase, vram);
+		}
+		STORE_32LE(left, tile * 8, decoded);
+		STORE_32LE(right, tile * 8 + 4, decoded);
+	}
+}
+
 void GBAVideoSoftwareRendererDrawBackgroundMode0(struct GBAVideoSoftwareRenderer* renderer, struct GBAVideoSoftwareBackground* background, int y) {
 	int inX = (renderer->start + background->x - background->offsetX) & 0x1FF;
 	int length = renderer->end - renderer->start;
@@ -531,7 +322,6 @@ void GBAVideoSoftwareRendererDrawBackgroundMode0(struct GBAVideoSoftwareRenderer
 	int pixelData;
 	int paletteData;
 	int tileX;
-	int tileEnd = ((length + inX) >> 3) - (inX >> 3);
 	uint16_t* vram = renderer->d.vram;
 
 	if (background->yCache != inY >> 3) {
@@ -543,33 +333,56 @@ void GBAVideoSoftwareRendererDrawBackgroundMode0(struct GBAVideoSoftwareRenderer
 		background->yCache = inY >> 3;
 	}
 
+	if (!background->mosaic || !GBAMosaicControlGetBgH(renderer->mosaic)) {
+		if (length <= 0) {
+			return;
+		}
+		uint32_t decodedRow[GBA_VIDEO_HORIZONTAL_PIXELS / 4 + 4];
+		if (!background->multipalette) {
+			_decodeRow16(background, vram, inX, inY, length, decodedRow);
+		} else {
+			_decodeRow256(background, vram, inX, inY, length, decodedRow);
+		}
+		const uint8_t* decoded = (const uint8_t*) decodedRow + (inX & 0x7);
+		if (!objwinSlowPath) {
+			GBAVideoSoftwareRendererCompositeDecodedRow(renderer, palette, flags, flags & FLAG_TARGET_2, decoded, outX, renderer->end);
+		} else {
+			if (!(flags & FLAG_TARGET_2)) {
+				DRAW_BACKGROUND_MODE_0_DECODED(NoBlend, OBJWIN);
+			} else {
+				DRAW_BACKGROUND_MODE_0_DECODED(Blend, OBJWIN);
+			}
+		}
+		return;
+	}
+
 	tileX = 0;
 	if (!objwinSlowPath) {
 		if (!(flags & FLAG_TARGET_2)) {
 			if (!background->multipalette) {
-				DRAW_BACKGROUND_MODE_0(16, NoBlend, NO_OBJWIN);
+				DRAW_BACKGROUND_MODE_0_MOSAIC(16, NoBlend, NO_OBJWIN);
 			} else {
-				DRAW_BACKGROUND_MODE_0(256, NoBlend, NO_OBJWIN);
+				DRAW_BACKGROUND_MODE_0_MOSAIC(256, NoBlend, NO_OBJWIN);
 			}
 		} else {
 			if (!background->multipalette) {
-				DRAW_BACKGROUND_MODE_0(16, Blend, NO_OBJWIN);
+				DRAW_BACKGROUND_MODE_0_MOSAIC(16, Blend, NO_OBJWIN);
 			} else {
-				DRAW_BACKGROUND_MODE_0(256, Blend, NO_OBJWIN);
+				DRAW_BACKGROUND_MODE_0_MOSAIC(256, Blend, NO_OBJWIN);
 			}
 		}
 	} else {
 		if (!(flags & FLAG_TARGET_2)) {
 			if (!background->multipalette) {
-				DRAW_BACKGROUND_MODE_0(16, NoBlend, OBJWIN);
+				DRAW_BACKGROUND_MODE_0_MOSAIC(16, NoBlend, OBJWIN);
 			} else {
-				DRAW_BACKGROUND_MODE_0(256, NoBlend, OBJWIN);
+				DRAW_BACKGROUND_MODE_0_MOSAIC(256, NoBlend, OBJWIN);
 			}
 		} else {
 			if (!background->multipalette) {
-				DRAW_BACKGROUND_MODE_0(16, Blend, OBJWIN);
+				DRAW_BACKGROUND_MODE_0_MOSAIC(16, Blend, OBJWIN);
 			} else {
-				DRAW_BACKGROUND_MODE_0(256, Blend, OBJWIN);
+				DRAW_BACKGROUND_MODE_0_MOSAIC(256, Blend, OBJWIN);
 			}
 		}
 	}
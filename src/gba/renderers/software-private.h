@@ -31,6 +31,11 @@ void GBAVideoSoftwareRendererDrawBackgroundMode5(struct GBAVideoSoftwareRenderer
 int GBAVideoSoftwareRendererPreprocessSprite(struct GBAVideoSoftwareRenderer* renderer, struct GBAObj* sprite, int index, int y);
 void GBAVideoSoftwareRendererPostprocessSprite(struct GBAVideoSoftwareRenderer* renderer, unsigned priority);
 
+void GBAVideoSoftwareRendererCompositeDecodedRow(struct GBAVideoSoftwareRenderer* renderer, const mColor* palette, uint32_t flags, bool blend, const uint8_t* decoded, int x, int end);
+void GBAVideoSoftwareRendererBlendBackdrop(struct GBAVideoSoftwareRenderer* renderer, uint32_t backdrop, int x, int end);
+void GBAVideoSoftwareRendererBrightenRow(struct GBAVideoSoftwareRenderer* renderer, uint32_t mask, uint32_t match, int x, int end);
+void GBAVideoSoftwareRendererDarkenRow(struct GBAVideoSoftwareRenderer* renderer, uint32_t mask, uint32_t match, int x, int end);
+
 static inline unsigned _brighten(unsigned color, int y);
 static inline unsigned _darken(unsigned color, int y);
 
@@ -175,8 +180,8 @@ static inline void _compositeNoBlendNoObjwin(struct GBAVideoSoftwareRenderer* re
 	int32_t y = background->sy + (renderer->start - 1) * background->dy;                                              \
 	int mosaicH = 0;                                                                                                  \
 	int mosaicWait = 0;                                                                                               \
-	int32_t localX;                                                                                                   \
-	int32_t localY;                                                                                                   \
+	int32_t localX = 0;                                                                                               \
+	int32_t localY = 0;                                                                                               \
 	if (background->mosaic) {                                                                                         \
 		int mosaicV = GBAMosaicControlGetBgV(renderer->mosaic) + 1;                                                   \
 		mosaicH = GBAMosaicControlGetBgH(renderer->mosaic) + 1;                                                       \
@@ -10,6 +10,7 @@
 #include <mgba/internal/gba/io.h>
 #include <mgba/internal/gba/renderers/cache-set.h>
 
+#include <mgba-util/math.h>
 #include <mgba-util/memory.h>
 
 #define DIRTY_SCANLINE(R, Y) R->scanlineDirty[Y >> 5] |= (1U << (Y & 0x1F))
@@ -40,12 +41,14 @@ static void GBAVideoSoftwareRendererWriteBGY_HI(struct GBAVideoSoftwareBackgroun
 static void GBAVideoSoftwareRendererWriteBLDCNT(struct GBAVideoSoftwareRenderer* renderer, uint16_t value);
 
 static void GBAVideoSoftwareRendererStepWindow(struct GBAVideoSoftwareRenderer* renderer, int y);
+static void GBAVideoSoftwareRendererStepBackgrounds(struct GBAVideoSoftwareRenderer* renderer, int y);
 static void GBAVideoSoftwareRendererPreprocessBuffer(struct GBAVideoSoftwareRenderer* renderer);
 static void GBAVideoSoftwareRendererPostprocessBuffer(struct GBAVideoSoftwareRenderer* renderer);
 static int GBAVideoSoftwareRendererPreprocessSpriteLayer(struct GBAVideoSoftwareRenderer* renderer, int y);
 
 static void _updatePalettes(struct GBAVideoSoftwareRenderer* renderer);
 static void _updateFlags(struct GBAVideoSoftwareRenderer* renderer, struct GBAVideoSoftwareBackground* bg);
+static void _updateSprite(struct GBAVideoSoftwareRenderer* renderer, int index);
 
 static void _breakWindow(struct GBAVideoSoftwareRenderer* softwareRenderer, struct WindowN* win);
 static void _breakWindowInner(struct GBAVideoSoftwareRenderer* softwareRenderer, struct WindowN* win);
@@ -88,6 +91,8 @@ void GBAVideoSoftwareRendererCreate(struct GBAVideoSoftwareRenderer* renderer) {
 	renderer->d.highlightAmount = 0;
 
 	renderer->temporaryBuffer = NULL;
+	renderer->drawStartY = 0;
+	renderer->drawEndY = GBA_VIDEO_VERTICAL_PIXELS;
 }
 
 static void GBAVideoSoftwareRendererInit(struct GBAVideoRenderer* renderer) {
@@ -133,7 +138,6 @@ static void GBAVideoSoftwareRendererReset(struct GBAVideoRenderer* renderer) {
 	softwareRenderer->objwin = (struct WindowControl) { .priority = 2 };
 	softwareRenderer->winout = (struct WindowControl) { .priority = 3 };
 	softwareRenderer->oamDirty = 1;
-	softwareRenderer->oamMax = 0;
 
 	softwareRenderer->mosaic = 0;
 	softwareRenderer->stereo = false;
@@ -143,6 +147,8 @@ static void GBAVideoSoftwareRendererReset(struct GBAVideoRenderer* renderer) {
 	softwareRenderer->objOffsetY = 0;
 
 	memset(softwareRenderer->scanlineDirty, 0xFFFFFFFF, sizeof(softwareRenderer->scanlineDirty));
+	softwareRenderer->frameClean = false;
+	softwareRenderer->ioClean = false;
 	memset(softwareRenderer->cache, 0, sizeof(softwareRenderer->cache));
 	memset(softwareRenderer->nextIo, 0, sizeof(softwareRenderer->nextIo));
 
@@ -393,6 +399,13 @@ static uint16_t GBAVideoSoftwareRendererWriteVideoRegister(struct GBAVideoRender
 	default:
 		mLOG(GBA_VIDEO, GAME_ERROR, "Invalid video register: 0x%03X", address);
 	}
+	// Writing an affine reference point restarts it even if the value is the same
+	if (softwareRenderer->nextIo[address >> 1] != value ||
+	    (address >= GBA_REG_BG2X_LO && address <= GBA_REG_BG2Y_HI) ||
+	    (address >= GBA_REG_BG3X_LO && address <= GBA_REG_BG3Y_HI)) {
+		softwareRenderer->frameClean = false;
+		softwareRenderer->ioClean = false;
+	}
 	softwareRenderer->nextIo[address >> 1] = value;
 	if (softwareRenderer->cache[softwareRenderer->nextY].io[address >> 1] != value) {
 		softwareRenderer->cache[softwareRenderer->nextY].io[address >> 1] = value;
@@ -415,8 +428,10 @@ static void GBAVideoSoftwareRendererWriteVRAM(struct GBAVideoRenderer* renderer,
 
 static void GBAVideoSoftwareRendererWriteOAM(struct GBAVideoRenderer* renderer, uint32_t oam) {
 	struct GBAVideoSoftwareRenderer* softwareRenderer = (struct GBAVideoSoftwareRenderer*) renderer;
-	UNUSED(oam);
-	softwareRenderer->oamDirty = 1;
+	// The last halfword of each entry is affine data and doesn't move the sprite
+	if ((oam & 3) != 3) {
+		softwareRenderer->spriteDirty[oam >> 7] |= 1U << ((oam >> 2) & 31);
+	}
 	memset(softwareRenderer->scanlineDirty, 0xFFFFFFFF, sizeof(softwareRenderer->scanlineDirty));
 }
 
@@ -568,23 +583,26 @@ static void GBAVideoSoftwareRendererDrawScanline(struct GBAVideoRenderer* render
 	}
 
 	bool dirty = softwareRenderer->scanlineDirty[y >> 5] & (1U << (y & 0x1F));
-	if (memcmp(softwareRenderer->nextIo, softwareRenderer->cache[y].io, sizeof(softwareRenderer->nextIo))) {
-		memcpy(softwareRenderer->cache[y].io, softwareRenderer->nextIo, sizeof(softwareRenderer->nextIo));
-		dirty = true;
-	}
-
-	if (GBARegisterDISPCNTGetMode(softwareRenderer->dispcnt) != 0) {
-		if (softwareRenderer->cache[y].scale[0][0] != softwareRenderer->bg[2].sx ||
-		    softwareRenderer->cache[y].scale[0][1] != softwareRenderer->bg[2].sy ||
-		    softwareRenderer->cache[y].scale[1][0] != softwareRenderer->bg[3].sx ||
-		    softwareRenderer->cache[y].scale[1][1] != softwareRenderer->bg[3].sy) {
+	if (!softwareRenderer->ioClean) {
+		// Otherwise the registers and affine reference points are known to match last frame
+		if (memcmp(softwareRenderer->nextIo, softwareRenderer->cache[y].io, sizeof(softwareRenderer->nextIo))) {
+			memcpy(softwareRenderer->cache[y].io, softwareRenderer->nextIo, sizeof(softwareRenderer->nextIo));
 			dirty = true;
 		}
+
+		if (GBARegisterDISPCNTGetMode(softwareRenderer->dispcnt) != 0) {
+			if (softwareRenderer->cache[y].scale[0][0] != softwareRenderer->bg[2].sx ||
+			    softwareRenderer->cache[y].scale[0][1] != softwareRenderer->bg[2].sy ||
+			    softwareRenderer->cache[y].scale[1][0] != softwareRenderer->bg[3].sx ||
+			    softwareRenderer->cache[y].scale[1][1] != softwareRenderer->bg[3].sy) {
+				dirty = true;
+			}
+		}
+		softwareRenderer->cache[y].scale[0][0] = softwareRenderer->bg[2].sx;
+		softwareRenderer->cache[y].scale[0][1] = softwareRenderer->bg[2].sy;
+		softwareRenderer->cache[y].scale[1][0] = softwareRenderer->bg[3].sx;
+		softwareRenderer->cache[y].scale[1][1] = softwareRenderer->bg[3].sy;
 	}
-	softwareRenderer->cache[y].scale[0][0] = softwareRenderer->bg[2].sx;
-	softwareRenderer->cache[y].scale[0][1] = softwareRenderer->bg[2].sy;
-	softwareRenderer->cache[y].scale[1][0] = softwareRenderer->bg[3].sx;
-	softwareRenderer->cache[y].scale[1][1] = softwareRenderer->bg[3].sy;
 
 	GBAVideoSoftwareRendererStepWindow(softwareRenderer, y);
 	if (softwareRenderer->cache[y].windowOn[0] != softwareRenderer->winN[0].on ||
@@ -609,16 +627,24 @@ static void GBAVideoSoftwareRendererDrawScanline(struct GBAVideoRenderer* render
 	}
 
 	CLEAN_SCANLINE(softwareRenderer, y);
+	softwareRenderer->frameClean = false;
 
-	mColor* row = &softwareRenderer->outputBuffer[softwareRenderer->outputBufferStride * y];
 	if (GBARegisterDISPCNTIsForcedBlank(softwareRenderer->dispcnt)) {
-		int x;
-		for (x = 0; x < GBA_VIDEO_HORIZONTAL_PIXELS; ++x) {
-			row[x] = M_COLOR_WHITE;
+		if (y >= softwareRenderer->drawStartY && y < softwareRenderer->drawEndY) {
+			mColor* row = &softwareRenderer->outputBuffer[softwareRenderer->outputBufferStride * y];
+			int x;
+			for (x = 0; x < GBA_VIDEO_HORIZONTAL_PIXELS; ++x) {
+				row[x] = M_COLOR_WHITE;
+			}
 		}
 		return;
 	}
 
+	if (y < softwareRenderer->drawStartY || y >= softwareRenderer->drawEndY) {
+		GBAVideoSoftwareRendererStepBackgrounds(softwareRenderer, y);
+		return;
+	}
+
 	GBAVideoSoftwareRendererPreprocessBuffer(softwareRenderer);
 	softwareRenderer->spriteCyclesRemaining = GBARegisterDISPCNTIsHblankIntervalFree(softwareRenderer->dispcnt) ? OBJ_HBLANK_FREE_LENGTH : OBJ_LENGTH;
 	int spriteLayers = GBAVideoSoftwareRendererPreprocessSpriteLayer(softwareRenderer, y);
@@ -675,35 +701,9 @@ static void GBAVideoSoftwareRendererDrawScanline(struct GBAVideoRenderer* render
 	}
 
 	GBAVideoSoftwareRendererPostprocessBuffer(softwareRenderer);
+	GBAVideoSoftwareRendererStepBackgrounds(softwareRenderer, y);
 
-	if (GBARegisterDISPCNTGetMode(softwareRenderer->dispcnt) != 0) {
-		if (softwareRenderer->bg[2].enabled == ENABLED_MAX) {
-			softwareRenderer->bg[2].sx += softwareRenderer->bg[2].dmx;
-			softwareRenderer->bg[2].sy += softwareRenderer->bg[2].dmy;
-		}
-		if (softwareRenderer->bg[3].enabled == ENABLED_MAX) {
-			softwareRenderer->bg[3].sx += softwareRenderer->bg[3].dmx;
-			softwareRenderer->bg[3].sy += softwareRenderer->bg[3].dmy;
-		}
-	}
-
-	if (softwareRenderer->bg[0].enabled != 0 && softwareRenderer->bg[0].enabled < ENABLED_MAX) {
-		++softwareRenderer->bg[0].enabled;
-		DIRTY_SCANLINE(softwareRenderer, y);
-	}
-	if (softwareRenderer->bg[1].enabled != 0 && softwareRenderer->bg[1].enabled < ENABLED_MAX) {
-		++softwareRenderer->bg[1].enabled;
-		DIRTY_SCANLINE(softwareRenderer, y);
-	}
-	if (softwareRenderer->bg[2].enabled != 0 && softwareRenderer->bg[2].enabled < ENABLED_MAX) {
-		++softwareRenderer->bg[2].enabled;
-		DIRTY_SCANLINE(softwareRenderer, y);
-	}
-	if (softwareRenderer->bg[3].enabled != 0 && softwareRenderer->bg[3].enabled < ENABLED_MAX) {
-		++softwareRenderer->bg[3].enabled;
-		DIRTY_SCANLINE(softwareRenderer, y);
-	}
-
+	mColor* row = &softwareRenderer->outputBuffer[softwareRenderer->outputBufferStride * y];
 	int x;
 	if (softwareRenderer->stereo) {
 		for (x = 0; x < GBA_VIDEO_HORIZONTAL_PIXELS; x += 4) {
@@ -735,6 +735,8 @@ static void GBAVideoSoftwareRendererFinishFrame(struct GBAVideoRenderer* rendere
 	struct GBAVideoSoftwareRenderer* softwareRenderer = (struct GBAVideoSoftwareRenderer*) renderer;
 
 	softwareRenderer->nextY = 0;
+	softwareRenderer->ioClean = softwareRenderer->frameClean;
+	softwareRenderer->frameClean = true;
 	if (softwareRenderer->temporaryBuffer) {
 		mappedMemoryFree(softwareRenderer->temporaryBuffer, GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS * 4);
 		softwareRenderer->temporaryBuffer = 0;
@@ -891,6 +893,36 @@ void GBAVideoSoftwareRendererStepWindow(struct GBAVideoSoftwareRenderer* softwar
 	}
 }
 
+static void GBAVideoSoftwareRendererStepBackgrounds(struct GBAVideoSoftwareRenderer* softwareRenderer, int y) {
+	if (GBARegisterDISPCNTGetMode(softwareRenderer->dispcnt) != 0) {
+		if (softwareRenderer->bg[2].enabled == ENABLED_MAX) {
+			softwareRenderer->bg[2].sx += softwareRenderer->bg[2].dmx;
+			softwareRenderer->bg[2].sy += softwareRenderer->bg[2].dmy;
+		}
+		if (softwareRenderer->bg[3].enabled == ENABLED_MAX) {
+			softwareRenderer->bg[3].sx += softwareRenderer->bg[3].dmx;
+			softwareRenderer->bg[3].sy += softwareRenderer->bg[3].dmy;
+		}
+	}
+
+	if (softwareRenderer->bg[0].enabled != 0 && softwareRenderer->bg[0].enabled < ENABLED_MAX) {
+		++softwareRenderer->bg[0].enabled;
+		DIRTY_SCANLINE(softwareRenderer, y);
+	}
+	if (softwareRenderer->bg[1].enabled != 0 && softwareRenderer->bg[1].enabled < ENABLED_MAX) {
+		++softwareRenderer->bg[1].enabled;
+		DIRTY_SCANLINE(softwareRenderer, y);
+	}
+	if (softwareRenderer->bg[2].enabled != 0 && softwareRenderer->bg[2].enabled < ENABLED_MAX) {
+		++softwareRenderer->bg[2].enabled;
+		DIRTY_SCANLINE(softwareRenderer, y);
+	}
+	if (softwareRenderer->bg[3].enabled != 0 && softwareRenderer->bg[3].enabled < ENABLED_MAX) {
+		++softwareRenderer->bg[3].enabled;
+		DIRTY_SCANLINE(softwareRenderer, y);
+	}
+}
+
 void GBAVideoSoftwareRendererPreprocessBuffer(struct GBAVideoSoftwareRenderer* softwareRenderer) {
 	int x;
 	for (x = 0; x < GBA_VIDEO_HORIZONTAL_PIXELS; x += 4) {
@@ -972,12 +1004,8 @@ void GBAVideoSoftwareRendererPostprocessBuffer(struct GBAVideoSoftwareRenderer*
 				backdrop |= softwareRenderer->variantPalette[0];
 			}
 			int end = softwareRenderer->windows[w].endX;
-			for (; x < end; ++x) {
-				uint32_t color = softwareRenderer->row[x];
-				if (color & FLAG_TARGET_1) {
-					softwareRenderer->row[x] = mColorMix5Bit(softwareRenderer->bldb, backdrop, softwareRenderer->blda, color);
-				}
-			}
+			GBAVideoSoftwareRendererBlendBackdrop(softwareRenderer, backdrop, x, end);
+			x = end;
 		}
 	}
 	if (softwareRenderer->forceTarget1 && (softwareRenderer->blendEffect == BLEND_DARKEN || softwareRenderer->blendEffect == BLEND_BRIGHTEN)) {
@@ -998,48 +1026,69 @@ void GBAVideoSoftwareRendererPostprocessBuffer(struct GBAVideoSoftwareRenderer*
 				continue;
 			}
 			if (softwareRenderer->blendEffect == BLEND_DARKEN) {
-				for (; x < end; ++x) {
-					uint32_t color = softwareRenderer->row[x];
-					if ((color & mask) == match) {
-						softwareRenderer->row[x] = _darken(color, softwareRenderer->bldy);
-					}
-				}
+				GBAVideoSoftwareRendererDarkenRow(softwareRenderer, mask, match, x, end);
 			} else if (softwareRenderer->blendEffect == BLEND_BRIGHTEN) {
-				for (; x < end; ++x) {
-					uint32_t color = softwareRenderer->row[x];
-					if ((color & mask) == match) {
-						softwareRenderer->row[x] = _brighten(color, softwareRenderer->bldy);
-					}
-				}
+				GBAVideoSoftwareRendererBrightenRow(softwareRenderer, mask, match, x, end);
 			}
+			x = end;
 		}
 	}
 }
 
+static void _updateSprite(struct GBAVideoSoftwareRenderer* renderer, int index) {
+	struct GBAVideoRendererSprite* sprite = &renderer->sprites[index];
+	uint32_t bit = 1U << (index & 31);
+	int y;
+	for (y = sprite->y < 0 ? 0 : sprite->y; y < sprite->endY && y < GBA_VIDEO_VERTICAL_PIXELS; ++y) {
+		renderer->spriteRows[y][index >> 5] &= ~bit;
+	}
+	if (!GBAVideoRendererCleanSprite(renderer->d.oam->obj, index, sprite, renderer->objOffsetY)) {
+		sprite->y = 0;
+		sprite->endY = 0;
+		return;
+	}
+	for (y = sprite->y < 0 ? 0 : sprite->y; y < sprite->endY && y < GBA_VIDEO_VERTICAL_PIXELS; ++y) {
+		renderer->spriteRows[y][index >> 5] |= bit;
+	}
+}
+
 int GBAVideoSoftwareRendererPreprocessSpriteLayer(struct GBAVideoSoftwareRenderer* renderer, int y) {
 	int w;
 	int spriteLayers = 0;
 	if (GBARegisterDISPCNTIsObjEnable(renderer->dispcnt) && !renderer->d.disableOBJ) {
 		if (renderer->oamDirty) {
-			renderer->oamMax = GBAVideoRendererCleanOAM(renderer->d.oam->obj, renderer->sprites, renderer->objOffsetY);
+			memset(renderer->spriteRows, 0, sizeof(renderer->spriteRows));
+			memset(renderer->sprites, 0, sizeof(renderer->sprites));
+			memset(renderer->spriteDirty, 0xFF, sizeof(renderer->spriteDirty));
 			renderer->oamDirty = false;
 		}
+		for (w = 0; w < 4; ++w) {
+			while (renderer->spriteDirty[w]) {
+				int index = w * 32 + ctz32(renderer->spriteDirty[w]);
+				renderer->spriteDirty[w] &= renderer->spriteDirty[w] - 1;
+				_updateSprite(renderer, index);
+			}
+		}
 		int mosaicV = GBAMosaicControlGetObjV(renderer->mosaic) + 1;
 		int mosaicY = y - (y % mosaicV);
 		int lastIndex = 0;
 		int i;
-		for (i = 0; i < renderer->oamMax; ++i) {
+		for (i = 0; i < 128; ++i) {
+			uint32_t row = renderer->spriteRows[y][i >> 5] >> (i & 31);
+			if (!row) {
+				i |= 31;
+				continue;
+			}
+			i += ctz32(row);
 			struct GBAVideoRendererSprite* sprite = &renderer->sprites[i];
 			int localY = y;
 			renderer->end = 0;
+			// Skipped sprites still take up OAM search time
 			renderer->spriteCyclesRemaining -= 2 * (sprite->index - lastIndex);
 			lastIndex = sprite->index;
 			if (renderer->spriteCyclesRemaining <= 0) {
 				break;
 			}
-			if (y < sprite->y || y >= sprite->endY) {
-				continue;
-			}
 			if (GBAObjAttributesAIsMosaic(sprite->obj.a) && mosaicV > 1) {
 				localY = mosaicY;
 				if (localY < sprite->y && sprite->y < GBA_VIDEO_VERTICAL_PIXELS) {
@@ -35,6 +35,7 @@ mLOG_DEFINE_CATEGORY(GBA_SAVE, "GBA Savedata", "gba.savedata");
 static void _flashSwitchBank(struct GBASavedata* savedata, int bank);
 static void _flashErase(struct GBASavedata* savedata);
 static void _flashEraseSector(struct GBASavedata* savedata, uint16_t sectorStart);
+static void _extendDirtyRange(struct GBASavedata* savedata, uint32_t offset, uint32_t size);
 
 static void _ashesToAshes(struct mTiming* timing, void* user, uint32_t cyclesLate) {
 	UNUSED(timing);
@@ -57,6 +58,8 @@ void GBASavedataInit(struct GBASavedata* savedata, struct VFile* vf) {
 	savedata->maskWriteback = false;
 	savedata->dirty = 0;
 	savedata->dirtAge = 0;
+	savedata->dirtyStart = 0;
+	savedata->dirtyEnd = 0;
 	savedata->dust.name = "GBA Savedata Settling";
 	savedata->dust.priority = 0x70;
 	savedata->dust.context = savedata;
@@ -198,6 +201,7 @@ bool GBASavedataLoad(struct GBASavedata* savedata, struct VFile* in) {
 		}
 		ssize_t size = GBASavedataSize(savedata);
 		in->seek(in, 0, SEEK_SET);
+		_extendDirtyRange(savedata, 0, size);
 		return in->read(in, savedata->data, size) == size;
 	} else if (savedata->vf) {
 		off_t read = 0;
@@ -263,6 +267,25 @@ void GBASavedataForceType(struct GBASavedata* savedata, enum GBASavedataType typ
 	}
 }
 
+void GBASavedataMarkDirty(struct GBASavedata* savedata, uint32_t offset, uint32_t size) {
+	savedata->dirty |= mSAVEDATA_DIRT_NEW;
+	_extendDirtyRange(savedata, offset, size);
+}
+
+void _extendDirtyRange(struct GBASavedata* savedata, uint32_t offset, uint32_t size) {
+	if (savedata->dirtyStart >= savedata->dirtyEnd) {
+		savedata->dirtyStart = offset;
+		savedata->dirtyEnd = offset + size;
+		return;
+	}
+	if (offset < savedata->dirtyStart) {
+		savedata->dirtyStart = offset;
+	}
+	if (offset + size > savedata->dirtyEnd) {
+		savedata->dirtyEnd = offset + size;
+	}
+}
+
 void GBASavedataInitFlash(struct GBASavedata* savedata) {
 	if (savedata->type == GBA_SAVEDATA_AUTODETECT) {
 		savedata->type = GBA_SAVEDATA_FLASH512;
@@ -290,6 +313,7 @@ void GBASavedataInitFlash(struct GBASavedata* savedata) {
 	savedata->currentBank = savedata->data;
 	if (end < GBA_SIZE_FLASH512) {
 		memset(&savedata->data[end], 0xFF, flashSize - end);
+		_extendDirtyRange(savedata, end, flashSize - end);
 	}
 }
 
@@ -317,6 +341,7 @@ void GBASavedataInitEEPROM(struct GBASavedata* savedata) {
 	}
 	if (end < GBA_SIZE_EEPROM512) {
 		memset(&savedata->data[end], 0xFF, GBA_SIZE_EEPROM512 - end);
+		_extendDirtyRange(savedata, end, GBA_SIZE_EEPROM512 - end);
 	}
 }
 
@@ -341,6 +366,7 @@ void GBASavedataInitSRAM(struct GBASavedata* savedata) {
 
 	if (end < GBA_SIZE_SRAM) {
 		memset(&savedata->data[end], 0xFF, GBA_SIZE_SRAM - end);
+		_extendDirtyRange(savedata, end, GBA_SIZE_SRAM - end);
 	}
 }
 
@@ -365,6 +391,7 @@ void GBASavedataInitSRAM512(struct GBASavedata* savedata) {
 
 	if (end < GBA_SIZE_SRAM512) {
 		memset(&savedata->data[end], 0xFF, GBA_SIZE_SRAM512 - end);
+		_extendDirtyRange(savedata, end, GBA_SIZE_SRAM512 - end);
 	}
 }
 
@@ -394,7 +421,7 @@ void GBASavedataWriteFlash(struct GBASavedata* savedata, uint16_t address, uint8
 	case FLASH_STATE_RAW:
 		switch (savedata->command) {
 		case FLASH_COMMAND_PROGRAM:
-			savedata->dirty |= mSAVEDATA_DIRT_NEW;
+			GBASavedataMarkDirty(savedata, savedata->currentBank - savedata->data + address, 1);
 			savedata->currentBank[address] = value;
 			savedata->command = FLASH_COMMAND_NONE;
 			mTimingDeschedule(savedata->timing, &savedata->dust);
@@ -492,6 +519,7 @@ static void _ensureEeprom(struct GBASavedata* savedata, uint32_t size) {
 		savedata->vf->truncate(savedata->vf, GBA_SIZE_EEPROM);
 		savedata->data = savedata->vf->map(savedata->vf, GBA_SIZE_EEPROM, savedata->mapMode);
 		memset(&savedata->data[GBA_SIZE_EEPROM512], 0xFF, GBA_SIZE_EEPROM - GBA_SIZE_EEPROM512);
+		_extendDirtyRange(savedata, GBA_SIZE_EEPROM512, GBA_SIZE_EEPROM - GBA_SIZE_EEPROM512);
 	} else {
 		savedata->data = savedata->vf->map(savedata->vf, GBA_SIZE_EEPROM, savedata->mapMode);
 	}
@@ -526,7 +554,7 @@ void GBASavedataWriteEEPROM(struct GBASavedata* savedata, uint16_t value, uint32
 			uint8_t current = savedata->data[savedata->writeAddress >> 3];
 			current &= ~(1 << (0x7 - (savedata->writeAddress & 0x7)));
 			current |= (value & 0x1) << (0x7 - (savedata->writeAddress & 0x7));
-			savedata->dirty |= mSAVEDATA_DIRT_NEW;
+			GBASavedataMarkDirty(savedata, savedata->writeAddress >> 3, 1);
 			savedata->data[savedata->writeAddress >> 3] = current;
 			mTimingDeschedule(savedata->timing, &savedata->dust);
 			mTimingSchedule(savedata->timing, &savedata->dust, EEPROM_SETTLE_CYCLES);
@@ -585,8 +613,20 @@ void GBASavedataClean(struct GBASavedata* savedata, uint32_t frameCount) {
 			GBASavedataUnmask(savedata);
 		}
 		if (savedata->mapMode & MAP_WRITE) {
+			// Only write back what changed since the last sync; anything that marked the
+			// savedata dirty without saying where falls back to writing all of it
 			size_t size = GBASavedataSize(savedata);
-			if (savedata->data && savedata->vf->sync(savedata->vf, savedata->data, size)) {
+			if (savedata->dirtyEnd > size) {
+				savedata->dirtyEnd = size;
+			}
+			if (savedata->dirtyStart >= savedata->dirtyEnd) {
+				savedata->dirtyStart = 0;
+				savedata->dirtyEnd = size;
+			}
+			size_t start = savedata->dirtyStart;
+			if (savedata->data && savedata->vf->sync(savedata->vf, &savedata->data[start], savedata->dirtyEnd - start)) {
+				savedata->dirtyStart = 0;
+				savedata->dirtyEnd = 0;
 				GBASavedataRTCWrite(savedata);
 				mLOG(GBA_SAVE, INFO, "Savedata synced");
 			} else {
@@ -770,21 +810,21 @@ void _flashSwitchBank(struct GBASavedata* savedata, int bank) {
 
 void _flashErase(struct GBASavedata* savedata) {
 	mLOG(GBA_SAVE, DEBUG, "Performing flash chip erase");
-	savedata->dirty |= mSAVEDATA_DIRT_NEW;
 	size_t size = GBA_SIZE_FLASH512;
 	if (savedata->type == GBA_SAVEDATA_FLASH1M) {
 		size = GBA_SIZE_FLASH1M;
 	}
+	GBASavedataMarkDirty(savedata, 0, size);
 	memset(savedata->data, 0xFF, size);
 }
 
 void _flashEraseSector(struct GBASavedata* savedata, uint16_t sectorStart) {
 	mLOG(GBA_SAVE, DEBUG, "Performing flash sector erase at 0x%04x", sectorStart);
-	savedata->dirty |= mSAVEDATA_DIRT_NEW;
 	size_t size = 0x1000;
 	if (savedata->type == GBA_SAVEDATA_FLASH1M) {
 		mLOG(GBA_SAVE, DEBUG, "Performing unknown sector-size erase at 0x%04x", sectorStart);
 	}
+	GBASavedataMarkDirty(savedata, savedata->currentBank - savedata->data + (sectorStart & ~(size - 1)), size);
 	savedata->settling = sectorStart >> 12;
 	mTimingDeschedule(savedata->timing, &savedata->dust);
 	mTimingSchedule(savedata->timing, &savedata->dust, FLASH_ERASE_CYCLES);
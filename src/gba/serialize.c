@@ -25,6 +25,10 @@ struct GBABundledState {
 };
 
 void GBASerialize(struct GBA* gba, struct GBASerializedState* state) {
+	GBASerializeIncremental(gba, state, 0);
+}
+
+void GBASerializeIncremental(struct GBA* gba, struct GBASerializedState* state, uint32_t since) {
 	STORE_32(GBASavestateMagic + GBASavestateVersion, 0, &state->versionMagic);
 	STORE_32(gba->biosChecksum, 0, &state->biosChecksum);
 	STORE_32(gba->romCrc32, 0, &state->romCrc32);
@@ -52,6 +56,7 @@ void GBASerialize(struct GBA* gba, struct GBASerializedState* state) {
 	for (i = 0; i < 16; ++i) {
 		STORE_32(gba->cpu->gprs[i], i * sizeof(state->cpu.gprs[0]), state->cpu.gprs);
 	}
+	ARMMaterializeFlags(gba->cpu);
 	STORE_32(gba->cpu->cpsr.packed, 0, &state->cpu.cpsr.packed);
 	STORE_32(gba->cpu->spsr.packed, 0, &state->cpu.spsr.packed);
 	STORE_32(gba->cpu->cycles, 0, &state->cpu.cycles);
@@ -81,10 +86,10 @@ void GBASerialize(struct GBA* gba, struct GBASerializedState* state) {
 	STORE_32(miscFlags, 0, &state->miscFlags);
 	STORE_32(gba->biosStall, 0, &state->biosStall);
 
-	GBAMemorySerialize(&gba->memory, state);
+	GBAMemorySerialize(&gba->memory, state, since);
 	GBAIOSerialize(gba, state);
 	GBAUnlCartSerialize(gba, state);
-	GBAVideoSerialize(&gba->video, state);
+	GBAVideoSerialize(&gba->video, state, since);
 	GBAAudioSerialize(&gba->audio, state);
 	GBASavedataSerialize(&gba->memory.savedata, state);
 
@@ -94,6 +99,10 @@ void GBASerialize(struct GBA* gba, struct GBASerializedState* state) {
 }
 
 bool GBADeserialize(struct GBA* gba, const struct GBASerializedState* state) {
+	return GBADeserializeIncremental(gba, state, 0);
+}
+
+bool GBADeserializeIncremental(struct GBA* gba, const struct GBASerializedState* state, uint32_t since) {
 	bool error = false;
 	int32_t check;
 	uint32_t ucheck;
@@ -166,6 +175,7 @@ bool GBADeserialize(struct GBA* gba, const struct GBASerializedState* state) {
 		LOAD_32(gba->cpu->gprs[i], i * sizeof(gba->cpu->gprs[0]), state->cpu.gprs);
 	}
 	LOAD_32(gba->cpu->cpsr.packed, 0, &state->cpu.cpsr.packed);
+	gba->cpu->lazyFlags = ARM_LAZY_NONE;
 	LOAD_32(gba->cpu->spsr.packed, 0, &state->cpu.spsr.packed);
 	LOAD_32(gba->cpu->cycles, 0, &state->cpu.cycles);
 	LOAD_32(gba->cpu->nextEvent, 0, &state->cpu.nextEvent);
@@ -226,8 +236,8 @@ bool GBADeserialize(struct GBA* gba, const struct GBASerializedState* state) {
 	gba->keysLast = GBASerializedMiscFlagsGetKeyIRQKeys(miscFlags);
 	LOAD_32(gba->biosStall, 0, &state->biosStall);
 
-	GBAVideoDeserialize(&gba->video, state);
-	GBAMemoryDeserialize(&gba->memory, state);
+	GBAVideoDeserialize(&gba->video, state, since);
+	GBAMemoryDeserialize(&gba->memory, state, since);
 	GBAIODeserialize(gba, state);
 	GBAAudioDeserialize(&gba->audio, state);
 	GBASavedataDeserialize(&gba->memory.savedata, state);
@@ -235,6 +245,9 @@ bool GBADeserialize(struct GBA* gba, const struct GBASerializedState* state) {
 	if (gba->memory.matrix.size) {
 		GBAMatrixDeserialize(gba, state);
 	}
+	if (!since) {
+		GBAMemoryMarkDirty(&gba->memory);
+	}
 
 	mTimingInterrupt(&gba->timing);
 
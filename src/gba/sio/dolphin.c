@@ -30,6 +30,8 @@ static int GBASIODolphinConnectedDevices(struct GBASIODriver* driver);
 static void GBASIODolphinProcessEvents(struct mTiming* timing, void* context, uint32_t cyclesLate);
 
 static int32_t _processCommand(struct GBASIODolphin* dol, uint32_t cyclesLate);
+static bool _readClocks(struct GBASIODolphin* dol);
+static void _prefetch(struct GBASIODolphin* dol);
 static void _flush(struct GBASIODolphin* dol);
 
 void GBASIODolphinCreate(struct GBASIODolphin* dol) {
@@ -93,6 +95,7 @@ bool GBASIODolphinConnect(struct GBASIODolphin* dol, const struct Address* addre
 	SocketSetBlocking(dol->data, false);
 	SocketSetBlocking(dol->clock, false);
 	SocketSetTCPPush(dol->data, true);
+	SocketSetTCPPush(dol->clock, true);
 	return true;
 }
 
@@ -135,27 +138,28 @@ void GBASIODolphinProcessEvents(struct mTiming* timing, void* context, uint32_t
 
 	dol->clockSlice -= cyclesLate;
 
-	int32_t clockSlice;
-
 	int32_t nextEvent = CLOCK_GRAIN;
 	switch (dol->state) {
 	case WAIT_FOR_FIRST_CLOCK:
 		dol->clockSlice = 0;
 		// Fall through
 	case WAIT_FOR_CLOCK:
-		if (dol->clockSlice < 0) {
-			Socket r = dol->clock;
-			SocketPoll(1, &r, 0, 0, CLOCK_WAIT);
-		}
-		if (SocketRecv(dol->clock, &clockSlice, 4) == 4) {
-			clockSlice = ntohl(clockSlice);
-			dol->clockSlice += clockSlice;
+		if (_readClocks(dol)) {
 			dol->state = WAIT_FOR_COMMAND;
 			nextEvent = 0;
+		} else if (dol->clockSlice < 0) {
+			// Out of time, so the next command is probably on its way too
+			_prefetch(dol);
+			Socket r = dol->clock;
+			SocketPoll(1, &r, 0, 0, CLOCK_WAIT);
+			if (_readClocks(dol)) {
+				dol->state = WAIT_FOR_COMMAND;
+				nextEvent = 0;
+			}
 		}
 		// Fall through
 	case WAIT_FOR_COMMAND:
-		if (dol->clockSlice < -VIDEO_TOTAL_LENGTH * 4) {
+		if (dol->clockSlice < -VIDEO_TOTAL_LENGTH * 4 && !dol->dataLength) {
 			Socket r = dol->data;
 			SocketPoll(1, &r, 0, 0, CLOCK_WAIT);
 		}
@@ -170,37 +174,85 @@ void GBASIODolphinProcessEvents(struct mTiming* timing, void* context, uint32_t
 	mTimingSchedule(timing, &dol->event, nextEvent);
 }
 
+// Clock slices are taken in batches: everything that has arrived is added up at once
+// instead of one slice per event
+bool _readClocks(struct GBASIODolphin* dol) {
+	uint8_t buffer[DOLPHIN_BUFFER_SIZE];
+	bool gotClock = false;
+	while (true) {
+		memcpy(buffer, dol->clockBuffer, dol->clockLength);
+		ssize_t gotten = SocketRecv(dol->clock, &buffer[dol->clockLength], sizeof(buffer) - dol->clockLength);
+		if (gotten <= 0) {
+			break;
+		}
+		size_t length = dol->clockLength + gotten;
+		size_t offset;
+		for (offset = 0; offset + 4 <= length; offset += 4) {
+			uint32_t clockSlice;
+			memcpy(&clockSlice, &buffer[offset], sizeof(clockSlice));
+			dol->clockSlice += (int32_t) ntohl(clockSlice);
+			gotClock = true;
+		}
+		dol->clockLength = length - offset;
+		memcpy(dol->clockBuffer, &buffer[offset], dol->clockLength);
+	}
+	return gotClock;
+}
+
+// Reads ahead whatever the data socket has, so commands are already buffered by the
+// time their clock arrives, and partially received commands aren't lost
+void _prefetch(struct GBASIODolphin* dol) {
+	if (dol->dataLength == sizeof(dol->dataBuffer)) {
+		return;
+	}
+	ssize_t gotten = SocketRecv(dol->data, &dol->dataBuffer[dol->dataLength], sizeof(dol->dataBuffer) - dol->dataLength);
+	if (gotten > 0) {
+		dol->dataLength += gotten;
+	}
+}
+
 void _flush(struct GBASIODolphin* dol) {
 	uint8_t buffer[32];
 	while (SocketRecv(dol->clock, buffer, sizeof(buffer)) == sizeof(buffer));
 	while (SocketRecv(dol->data, buffer, sizeof(buffer)) == sizeof(buffer));
+	dol->dataLength = 0;
+	dol->clockLength = 0;
 }
 
 int32_t _processCommand(struct GBASIODolphin* dol, uint32_t cyclesLate) {
 	// This does not include the stop bits due to compatibility reasons
 	int bitsOnLine = 8;
 	uint8_t buffer[6];
-	int gotten = SocketRecv(dol->data, buffer, 1);
-	if (gotten < 1) {
-		return -1;
+	size_t length = 1;
+	if (!dol->dataLength) {
+		_prefetch(dol);
+		if (!dol->dataLength) {
+			return -1;
+		}
 	}
 
-	switch (buffer[0]) {
+	switch (dol->dataBuffer[0]) {
 	case JOY_RESET:
 	case JOY_POLL:
 		bitsOnLine += 24;
 		break;
 	case JOY_RECV:
-		gotten = SocketRecv(dol->data, &buffer[1], 4);
-		if (gotten < 4) {
-			return -1;
+		length = 5;
+		if (dol->dataLength < length) {
+			_prefetch(dol);
+			if (dol->dataLength < length) {
+				return -1;
+			}
 		}
-		mLOG(GBA_SIO, DEBUG, "DOL recv: %02X%02X%02X%02X", buffer[1], buffer[2], buffer[3], buffer[4]);
+		mLOG(GBA_SIO, DEBUG, "DOL recv: %02X%02X%02X%02X", dol->dataBuffer[1], dol->dataBuffer[2], dol->dataBuffer[3], dol->dataBuffer[4]);
 		// Fall through
 	case JOY_TRANS:
 		bitsOnLine += 40;
 		break;
 	}
+	memcpy(buffer, dol->dataBuffer, length);
+	dol->dataLength -= length;
+	memmove(dol->dataBuffer, &dol->dataBuffer[length], dol->dataLength);
 
 	if (!dol->active) {
 		return 0;
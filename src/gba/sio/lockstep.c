@@ -11,8 +11,9 @@
 #define DRIVER_ID 0x6B636F4C
 #define DRIVER_STATE_VERSION 1
 #define LOCKSTEP_INTERVAL 4096
+#define LOCKSTEP_CATCH_UP 1024
 #define UNLOCKED_INTERVAL 4096
-#define HARD_SYNC_INTERVAL 0x80000
+#define DEFAULT_MAX_SKEW 0x80000
 #define TARGET(P) (1 << (P))
 #define TARGET_ALL 0xF
 #define TARGET_PRIMARY 0x1
@@ -202,6 +203,7 @@ static void GBASIOLockstepDriverReset(struct GBASIODriver* driver) {
 			if (!TableLookup(&coordinator->players, id)) {
 				TableInsert(&coordinator->players, id, player);
 				lockstep->lockstepId = id;
+				lockstep->player = player;
 				break;
 			}
 		}
@@ -228,7 +230,7 @@ static void GBASIOLockstepDriverReset(struct GBASIODriver* driver) {
 	int32_t nextEvent;
 	_setReady(coordinator, player, player->playerId, player->mode);
 	if (TableSize(&coordinator->players) == 1) {
-		coordinator->cycle = mTimingCurrentTime(&lockstep->d.p->p->timing);
+		ATOMIC_STORE(coordinator->cycle, mTimingCurrentTime(&lockstep->d.p->p->timing));
 		nextEvent = LOCKSTEP_INTERVAL;
 	} else {
 		_setReady(coordinator, player, 0, coordinator->transferMode);
@@ -331,6 +333,7 @@ static bool GBASIOLockstepDriverLoadState(struct GBASIODriver* driver, const voi
 	}
 	player->freeList = &player->buffer[0];
 	player->queue = NULL;
+	ATOMIC_STORE(player->pendingEvents, 0);
 
 	struct GBASIOLockstepEvent** lastEvent = &player->queue;
 	for (i = 0; i < GBASIOLockstepSerializedFlagsGetNumEvents(flags) && i < MAX_LOCKSTEP_EVENTS; ++i) {
@@ -357,10 +360,12 @@ static bool GBASIOLockstepDriverLoadState(struct GBASIODriver* driver, const voi
 			LOAD_32LE(event->finishCycle, 0, &stateEvent->finishCycle);
 			break;
 		}
+		ATOMIC_ADD(player->pendingEvents, 1);
 	}
 
 	if (player->playerId == 0) {
-		LOAD_32LE(coordinator->cycle, 0, &state->coordinator.cycle);
+		LOAD_32LE(check, 0, &state->coordinator.cycle);
+		ATOMIC_STORE(coordinator->cycle, check);
 		LOAD_32LE(coordinator->waiting, 0, &state->coordinator.waiting);
 		LOAD_32LE(coordinator->nextHardSync, 0, &state->coordinator.nextHardSync);
 		for (i = 0; i < 4; ++i) {
@@ -620,6 +625,7 @@ void GBASIOLockstepCoordinatorInit(struct GBASIOLockstepCoordinator* coordinator
 	memset(coordinator, 0, sizeof(*coordinator));
 	MutexInit(&coordinator->mutex);
 	TableInit(&coordinator->players, 8, free);
+	coordinator->maxSkew = DEFAULT_MAX_SKEW;
 }
 
 void GBASIOLockstepCoordinatorDeinit(struct GBASIOLockstepCoordinator* coordinator) {
@@ -666,7 +672,7 @@ void _advanceCycle(struct GBASIOLockstepCoordinator* coordinator, struct GBASIOL
 	int32_t newCycle = GBASIOLockstepTime(player);
 	mASSERT_DEBUG(newCycle - coordinator->cycle >= 0);
 	coordinator->nextHardSync -= newCycle - coordinator->cycle;
-	coordinator->cycle = newCycle;
+	ATOMIC_STORE(coordinator->cycle, newCycle);
 }
 
 void _removePlayer(struct GBASIOLockstepCoordinator* coordinator, struct GBASIOLockstepPlayer* player) {
@@ -680,6 +686,7 @@ void _removePlayer(struct GBASIOLockstepCoordinator* coordinator, struct GBASIOL
 	coordinator->waiting = 0;
 	coordinator->transferActive = false;
 
+	player->driver->player = NULL;
 	TableRemove(&coordinator->players, player->driver->lockstepId);
 	_reconfigPlayers(coordinator);
 
@@ -702,11 +709,11 @@ void _reconfigPlayers(struct GBASIOLockstepCoordinator* coordinator) {
 		coordinator->attachedPlayers[0] = p0;
 
 		struct GBASIOLockstepPlayer* player = TableIteratorGetValue(&coordinator->players, &iter);
-		coordinator->cycle = mTimingCurrentTime(&player->driver->d.p->p->timing);
-		coordinator->nextHardSync = HARD_SYNC_INTERVAL;
+		ATOMIC_STORE(coordinator->cycle, mTimingCurrentTime(&player->driver->d.p->p->timing));
+		coordinator->nextHardSync = coordinator->maxSkew;
 
 		if (player->playerId != 0) {
-			player->playerId = 0;
+			ATOMIC_STORE(player->playerId, 0);
 			if (player->driver->user->playerIdChanged) {
 				player->driver->user->playerIdChanged(player->driver->user, player->playerId);
 			}
@@ -760,7 +767,7 @@ void _reconfigPlayers(struct GBASIOLockstepCoordinator* coordinator) {
 					}
 					coordinator->attachedPlayers[seen] = pid;
 					if (player->playerId != seen) {
-						player->playerId = seen;
+						ATOMIC_STORE(player->playerId, seen);
 						if (player->driver->user->playerIdChanged) {
 							player->driver->user->playerIdChanged(player->driver->user, player->playerId);
 						}
@@ -865,14 +872,34 @@ void _enqueueEvent(struct GBASIOLockstepCoordinator* coordinator, const struct G
 		}
 		newEvent->next = next;
 		*previous = newEvent;
+		ATOMIC_ADD(player->pendingEvents, 1);
 	}
 }
 
 void _lockstepEvent(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 	struct GBASIOLockstepDriver* lockstep = context;
 	struct GBASIOLockstepCoordinator* coordinator = lockstep->coordinator;
+	struct GBASIOLockstepPlayer* player = lockstep->player;
+	if (player) {
+		// Secondaries that are behind the shared clock with nothing queued have nothing to
+		// exchange until they catch up, so they can keep running without the lock. Events
+		// from the primary are never timestamped before the clock, so none can be missed.
+		int playerId;
+		int pendingEvents;
+		int32_t cycle;
+		// The clock is published after events are enqueued, so load it first
+		ATOMIC_LOAD(cycle, coordinator->cycle);
+		ATOMIC_LOAD(playerId, player->playerId);
+		ATOMIC_LOAD(pendingEvents, player->pendingEvents);
+		int32_t until = cycle - GBASIOLockstepTime(player);
+		if (playerId > 0 && !pendingEvents && until > LOCKSTEP_CATCH_UP) {
+			mTimingSchedule(timing, &lockstep->event, until);
+			return;
+		}
+	}
+
 	MutexLock(&coordinator->mutex);
-	struct GBASIOLockstepPlayer* player = TableLookup(&coordinator->players, lockstep->lockstepId);
+	player = TableLookup(&coordinator->players, lockstep->lockstepId);
 	struct GBASIO* sio = player->driver->d.p;
 	mASSERT(player->playerId >= 0 && player->playerId < 4);
 
@@ -894,7 +921,7 @@ void _lockstepEvent(struct mTiming* timing, void* context, uint32_t cyclesLate)
 			if (!coordinator->waiting) {
 				_hardSync(coordinator, player);
 			}
-			coordinator->nextHardSync += HARD_SYNC_INTERVAL;
+			coordinator->nextHardSync += coordinator->maxSkew;
 		}
 	}
 
@@ -908,6 +935,7 @@ void _lockstepEvent(struct mTiming* timing, void* context, uint32_t cyclesLate)
 			break;
 		}
 		player->queue = event->next;
+		ATOMIC_SUB(player->pendingEvents, 1);
 		struct GBASIOLockstepEvent reply = {
 			.playerId = player->playerId,
 			.timestamp = GBASIOLockstepTime(player),
@@ -962,7 +990,9 @@ void _lockstepEvent(struct mTiming* timing, void* context, uint32_t cyclesLate)
 		nextEvent = player->queue->timestamp - GBASIOLockstepTime(player);
 	}
 
-	if (player->playerId != 0 && nextEvent <= LOCKSTEP_INTERVAL) {
+	// Only sleep once nearly caught up to the shared clock, so that secondaries
+	// keep running in parallel with the primary for as long as possible
+	if (player->playerId != 0 && nextEvent <= LOCKSTEP_CATCH_UP) {
 		if (!player->queue || wasDetach) {
 			GBASIOLockstepPlayerSleep(player);
 			// XXX: Is there a better way to gain sync lock at the beginning?
@@ -1061,3 +1091,15 @@ size_t GBASIOLockstepCoordinatorAttached(struct GBASIOLockstepCoordinator* coord
 	MutexUnlock(&coordinator->mutex);
 	return count;
 }
+
+void GBASIOLockstepCoordinatorSetMaxSkew(struct GBASIOLockstepCoordinator* coordinator, int32_t cycles) {
+	if (cycles < LOCKSTEP_INTERVAL) {
+		cycles = LOCKSTEP_INTERVAL;
+	}
+	MutexLock(&coordinator->mutex);
+	coordinator->maxSkew = cycles;
+	if (coordinator->nextHardSync > cycles) {
+		coordinator->nextHardSync = cycles;
+	}
+	MutexUnlock(&coordinator->mutex);
+}
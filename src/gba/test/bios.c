@@ -0,0 +1,119 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/gba/core.h>
+#include <mgba/internal/arm/arm.h>
+#include <mgba/internal/gba/gba.h>
+#include <mgba/internal/gba/io.h>
+
+#define PROGRAM 0x03000000
+#define IRQ_HANDLER 0x03000010
+#define SOURCE 0x02010000
+#define DEST 0x02000000
+// Long enough to span several scanlines
+#define WORDS 0x800
+
+// Runs a CpuFastSet of WORDS words from SOURCE to DEST from Thumb code in IWRAM, with the
+// given IRQs enabled in IE
+static struct mCore* _setupCpuFastSet(uint16_t irqs) {
+	struct mCore* core = GBACoreCreate();
+	assert_non_null(core);
+	assert_true(core->init(core));
+	mCoreInitConfig(core, NULL);
+	core->reset(core);
+	struct GBA* gba = core->board;
+
+	core->rawWrite16(core, PROGRAM, -1, 0xDF0C); // swi 0x0C
+	core->rawWrite16(core, PROGRAM + 2, -1, 0xE7FE); // b .
+	core->rawWrite32(core, IRQ_HANDLER, -1, 0xE12FFF1E); // bx lr
+	core->rawWrite32(core, 0x03007FFC, -1, IRQ_HANDLER);
+	uint32_t i;
+	for (i = 0; i < WORDS; ++i) {
+		core->rawWrite32(core, SOURCE + i * 4, -1, i + 1);
+		core->rawWrite32(core, DEST + i * 4, -1, 0);
+	}
+
+	GBAIOWrite(gba, GBA_REG_IE, irqs);
+	GBAIOWrite(gba, GBA_REG_IME, 1);
+
+	int32_t value = MODE_SYSTEM | 0x20; // Thumb, IRQs enabled
+	assert_true(core->writeRegister(core, "cpsr", &value));
+	value = SOURCE;
+	assert_true(core->writeRegister(core, "r0", &value));
+	value = DEST;
+	assert_true(core->writeRegister(core, "r1", &value));
+	value = WORDS;
+	assert_true(core->writeRegister(core, "r2", &value));
+	value = PROGRAM;
+	assert_true(core->writeRegister(core, "pc", &value));
+	// Catch up on the events the setup interrupted, like the CPU would before running on
+	struct ARMCore* cpu = core->cpu;
+	cpu->irqh.processEvents(cpu);
+	return core;
+}
+
+static void _finishCpuFastSet(struct mCore* core) {
+	struct ARMCore* cpu = core->cpu;
+	int i;
+	for (i = 0; i < 0x100000 && cpu->gprs[ARM_PC] != PROGRAM + 4; ++i) {
+		ARMRun(cpu);
+	}
+	assert_int_equal(cpu->gprs[ARM_PC], PROGRAM + 4);
+	uint32_t word;
+	for (word = 0; word < WORDS; ++word) {
+		assert_int_equal(core->rawRead32(core, DEST + word * 4, -1), word + 1);
+	}
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+}
+
+M_TEST_DEFINE(cpuFastSetAcrossIrq) {
+	struct mCore* core = _setupCpuFastSet(1 << GBA_IRQ_TIMER0);
+	struct GBA* gba = core->board;
+	struct ARMCore* cpu = core->cpu;
+	GBAIOWrite(gba, GBA_REG_TM0CNT_LO, 0xFF00);
+	GBAIOWrite(gba, GBA_REG_TM0CNT_HI, 0x00C0);
+	cpu->irqh.processEvents(cpu);
+
+	int i;
+	for (i = 0; i < 0x10000 && cpu->cpsr.priv != MODE_IRQ; ++i) {
+		ARMRun(cpu);
+	}
+	assert_int_equal(cpu->cpsr.priv, MODE_IRQ);
+
+	// The IRQ comes in partway through the copy, so the handler has to see it half done
+	assert_int_equal(core->rawRead32(core, DEST, -1), 1);
+	assert_int_equal(core->rawRead32(core, DEST + (WORDS - 1) * 4, -1), 0);
+
+	GBAIOWrite(gba, GBA_REG_TM0CNT_HI, 0);
+	GBAIOWrite(gba, GBA_REG_IF, 1 << GBA_IRQ_TIMER0);
+	_finishCpuFastSet(core);
+}
+
+M_TEST_DEFINE(cpuFastSetAcrossScanline) {
+	struct mCore* core = _setupCpuFastSet(0);
+	struct GBA* gba = core->board;
+	struct ARMCore* cpu = core->cpu;
+	uint16_t vcount = gba->memory.io[GBA_REG(VCOUNT)];
+
+	int i;
+	for (i = 0; i < 0x10000 && gba->memory.io[GBA_REG(VCOUNT)] == vcount; ++i) {
+		ARMRun(cpu);
+	}
+	assert_int_not_equal(gba->memory.io[GBA_REG(VCOUNT)], vcount);
+
+	// The next scanline starts partway through the copy, so it has to be half done then
+	assert_int_equal(core->rawRead32(core, DEST, -1), 1);
+	assert_int_equal(core->rawRead32(core, DEST + (WORDS - 1) * 4, -1), 0);
+
+	_finishCpuFastSet(core);
+}
+
+M_TEST_SUITE_DEFINE(GBABIOS,
+	cmocka_unit_test(cpuFastSetAcrossIrq),
+	cmocka_unit_test(cpuFastSetAcrossScanline))
@@ -6,7 +6,11 @@
 #include "util/test/suite.h"
 
 #include <mgba/core/core.h>
+#include <mgba/core/serialize.h>
 #include <mgba/gba/core.h>
+#include <mgba/internal/gba/video.h>
+#include <mgba-util/audio-buffer.h>
+#include <mgba-util/vfs.h>
 
 M_TEST_DEFINE(create) {
 	struct mCore* core = GBACoreCreate();
@@ -44,8 +48,135 @@ M_TEST_DEFINE(loadNullROM) {
 	core->deinit(core);
 }
 
+M_TEST_DEFINE(renderSkip) {
+	struct mCore* core = GBACoreCreate();
+	assert_non_null(core);
+	assert_true(core->init(core));
+	mCoreInitConfig(core, NULL);
+	mColor* buffer = calloc(GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS, sizeof(*buffer));
+	core->setVideoBuffer(core, buffer, GBA_VIDEO_HORIZONTAL_PIXELS);
+	core->reset(core);
+	core->runFrame(core);
+
+	memset(buffer, 0xA5, GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS * sizeof(*buffer));
+	core->setRenderSkip(core, true);
+	core->runFrame(core);
+	core->runFrame(core);
+	assert_int_equal(buffer[0], (mColor) 0xA5A5A5A5);
+
+	core->setRenderSkip(core, false);
+	core->runFrame(core);
+	core->runFrame(core);
+	assert_int_not_equal(buffer[0], (mColor) 0xA5A5A5A5);
+
+	free(buffer);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+}
+
+M_TEST_DEFINE(audioSkip) {
+	struct mCore* core = GBACoreCreate();
+	assert_non_null(core);
+	assert_true(core->init(core));
+	mCoreInitConfig(core, NULL);
+	core->reset(core);
+	struct mAudioBuffer* buffer = core->getAudioBuffer(core);
+
+	core->setAudioSkip(core, true);
+	mAudioBufferClear(buffer);
+	core->runFrame(core);
+	core->runFrame(core);
+	assert_int_equal(mAudioBufferAvailable(buffer), 0);
+
+	core->setAudioSkip(core, false);
+	core->runFrame(core);
+	core->runFrame(core);
+	assert_int_not_equal(mAudioBufferAvailable(buffer), 0);
+
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+}
+
+M_TEST_DEFINE(coreFork) {
+	// Increments a counter at the start of IWRAM forever
+	static const uint32_t program[] = {
+		0xE3A00403, // mov r0, #0x03000000
+		0xE5901000, // ldr r1, [r0]
+		0xE2811001, // add r1, #1
+		0xE5801000, // str r1, [r0]
+		0xEAFFFFFB, // b 4
+	};
+	uint8_t rom[0x400] = {0};
+	size_t i;
+	for (i = 0; i < sizeof(program) / sizeof(*program); ++i) {
+		STORE_32LE(program[i], i * 4, rom);
+	}
+
+	struct mCore* core = GBACoreCreate();
+	assert_non_null(core);
+	assert_true(core->init(core));
+	mCoreInitConfig(core, NULL);
+	assert_true(core->loadROM(core, VFileMemChunk(rom, sizeof(rom))));
+	core->reset(core);
+	core->runFrame(core);
+
+	struct mCore* clone = mCoreClone(core);
+	assert_non_null(clone);
+	uint32_t counter = core->busRead32(core, 0x03000000);
+	assert_int_equal(clone->busRead32(clone, 0x03000000), counter);
+	assert_int_equal(clone->frameCounter(clone), core->frameCounter(core));
+
+	core->runFrame(core);
+	clone->runFrame(clone);
+	assert_int_not_equal(core->busRead32(core, 0x03000000), counter);
+	assert_int_equal(clone->busRead32(clone, 0x03000000), core->busRead32(core, 0x03000000));
+
+	clone->busWrite32(clone, 0x03000000, 0);
+	assert_int_not_equal(core->busRead32(core, 0x03000000), 0);
+
+	assert_true(mCoreFork(core, clone));
+	assert_int_equal(clone->busRead32(clone, 0x03000000), core->busRead32(core, 0x03000000));
+
+	mCoreConfigDeinit(&clone->config);
+	clone->deinit(clone);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+}
+
+M_TEST_DEFINE(stateHash) {
+	struct mCore* core = GBACoreCreate();
+	assert_non_null(core);
+	assert_true(core->init(core));
+	mCoreInitConfig(core, NULL);
+	core->reset(core);
+	core->runFrame(core);
+
+	struct mStateHash context;
+	mStateHashInit(&context);
+	uint64_t hash = mCoreHashState(core, &context);
+	assert_int_equal(mCoreHashState(core, NULL), hash);
+	assert_int_equal(mCoreHashState(core, &context), hash);
+
+	uint8_t value = core->rawRead8(core, 0x02010000, -1);
+	core->rawWrite8(core, 0x02010000, -1, value ^ 0xFF);
+	uint64_t changed = mCoreHashState(core, &context);
+	assert_int_not_equal(changed, hash);
+	assert_int_equal(mCoreHashState(core, NULL), changed);
+
+	core->rawWrite8(core, 0x02010000, -1, value);
+	assert_int_equal(mCoreHashState(core, &context), hash);
+
+	mStateHashDeinit(&context);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+}
+
 M_TEST_SUITE_DEFINE(GBACore,
 	cmocka_unit_test(create),
 	cmocka_unit_test(platform),
 	cmocka_unit_test(reset),
-	cmocka_unit_test(loadNullROM))
+	cmocka_unit_test(loadNullROM),
+	cmocka_unit_test(renderSkip),
+	cmocka_unit_test(audioSkip),
+	cmocka_unit_test(coreFork),
+	cmocka_unit_test(stateHash))
@@ -0,0 +1,91 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/internal/defines.h>
+#include <mgba/internal/gba/cart/gpio.h>
+#include <mgba/internal/gba/memory.h>
+#include <mgba/internal/gba/savedata.h>
+#include <mgba-util/vfs.h>
+
+struct SavedataTest {
+	struct GBASavedata savedata;
+	struct GBACartridgeHardware hw;
+};
+
+static int savedataSetup(void** state) {
+	struct SavedataTest* test = calloc(1, sizeof(*test));
+	GBASavedataInit(&test->savedata, VFileMemChunk(NULL, 0));
+	test->savedata.gpio = &test->hw;
+	GBASavedataInitSRAM(&test->savedata);
+	*state = test;
+	return 0;
+}
+
+static int savedataTeardown(void** state) {
+	struct SavedataTest* test = *state;
+	struct VFile* vf = test->savedata.vf;
+	GBASavedataDeinit(&test->savedata);
+	vf->close(vf);
+	free(test);
+	return 0;
+}
+
+static void _clean(struct GBASavedata* savedata) {
+	GBASavedataClean(savedata, 0);
+	GBASavedataClean(savedata, mSAVEDATA_CLEANUP_THRESHOLD + 1);
+}
+
+M_TEST_DEFINE(dirtyRangeFill) {
+	struct SavedataTest* test = *state;
+	assert_int_equal(test->savedata.dirtyStart, 0);
+	assert_int_equal(test->savedata.dirtyEnd, GBA_SIZE_SRAM);
+	assert_false(test->savedata.dirty);
+
+	GBASavedataMarkDirty(&test->savedata, 0x10, 1);
+	_clean(&test->savedata);
+	assert_false(test->savedata.dirty);
+	assert_int_equal(test->savedata.dirtyStart, 0);
+	assert_int_equal(test->savedata.dirtyEnd, 0);
+}
+
+M_TEST_DEFINE(dirtyRangeGrow) {
+	struct SavedataTest* test = *state;
+	GBASavedataMarkDirty(&test->savedata, 0, 1);
+	_clean(&test->savedata);
+
+	GBASavedataMarkDirty(&test->savedata, 0x200, 1);
+	assert_int_equal(test->savedata.dirtyStart, 0x200);
+	assert_int_equal(test->savedata.dirtyEnd, 0x201);
+
+	GBASavedataMarkDirty(&test->savedata, 0x100, 0x10);
+	GBASavedataMarkDirty(&test->savedata, 0x180, 1);
+	assert_int_equal(test->savedata.dirtyStart, 0x100);
+	assert_int_equal(test->savedata.dirtyEnd, 0x201);
+	assert_true(test->savedata.dirty);
+}
+
+M_TEST_DEFINE(dirtyRangeFallback) {
+	struct SavedataTest* test = *state;
+	GBASavedataMarkDirty(&test->savedata, 0, 1);
+	_clean(&test->savedata);
+
+	// Marking dirty without a range still syncs everything
+	test->savedata.data[0x7FFF] = 0x5A;
+	test->savedata.dirty |= mSAVEDATA_DIRT_NEW;
+	_clean(&test->savedata);
+	assert_int_equal(test->savedata.dirtyEnd, 0);
+
+	uint8_t value = 0;
+	test->savedata.vf->seek(test->savedata.vf, 0x7FFF, SEEK_SET);
+	assert_int_equal(test->savedata.vf->read(test->savedata.vf, &value, 1), 1);
+	assert_int_equal(value, 0x5A);
+}
+
+M_TEST_SUITE_DEFINE(GBASavedata,
+	cmocka_unit_test_setup_teardown(dirtyRangeFill, savedataSetup, savedataTeardown),
+	cmocka_unit_test_setup_teardown(dirtyRangeGrow, savedataSetup, savedataTeardown),
+	cmocka_unit_test_setup_teardown(dirtyRangeFallback, savedataSetup, savedataTeardown))
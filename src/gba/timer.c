@@ -10,12 +10,40 @@
 
 #define GBA_REG_TMCNT_LO(X) (GBA_REG_TM0CNT_LO + ((X) << 2))
 
+// Lazy timers only need to be refreshed often enough that lastEvent doesn't fall too far behind
+#define LAZY_REFRESH_INTERVAL 0x4000000
+
+static bool _isObserved(struct GBA* gba, int timerId) {
+	if (GBATimerFlagsIsDoIrq(gba->timers[timerId].flags)) {
+		return true;
+	}
+	if (timerId < 3) {
+		GBATimerFlags nextFlags = gba->timers[timerId + 1].flags;
+		if (GBATimerFlagsIsCountUp(nextFlags) && GBATimerFlagsIsEnable(nextFlags)) {
+			return true;
+		}
+	}
+	if (gba->audio.enable && timerId < 2) {
+		if ((gba->audio.chALeft || gba->audio.chARight) && gba->audio.chATimer == timerId) {
+			return true;
+		}
+		if ((gba->audio.chBLeft || gba->audio.chBRight) && gba->audio.chBTimer == timerId) {
+			return true;
+		}
+	}
+	return false;
+}
+
 static void GBATimerUpdate(struct GBA* gba, int timerId, uint32_t cyclesLate) {
 	struct GBATimer* timer = &gba->timers[timerId];
 	if (GBATimerFlagsIsCountUp(timer->flags)) {
 		gba->memory.io[GBA_REG_TMCNT_LO(timerId) >> 1] = timer->reload;
 	} else {
+		bool lazy = GBATimerFlagsIsLazy(timer->flags);
 		GBATimerUpdateRegister(gba, timerId, cyclesLate);
+		if (lazy) {
+			return;
+		}
 	}
 
 	if (GBATimerFlagsIsDoIrq(timer->flags)) {
@@ -91,30 +119,48 @@ void GBATimerUpdateRegister(struct GBA* gba, int timer, int32_t cyclesLate) {
 
 	// Align timer
 	int prescaleBits = GBATimerFlagsGetPrescaleBits(currentTimer->flags);
-	int32_t currentTime = mTimingCurrentTime(&gba->timing) - cyclesLate;
 	int32_t tickMask = (1 << prescaleBits) - 1;
-	currentTime &= ~tickMask;
+	int32_t overflowTime = mTimingCurrentTime(&gba->timing) & ~tickMask;
+	int32_t currentTime = (mTimingCurrentTime(&gba->timing) - cyclesLate) & ~tickMask;
+
+	// Find the last overflow up until now, even if the register is read as of a few cycles
+	// earlier, since an overflow event would already have fired for it. Lazy timers can
+	// overflow many times between updates.
+	int32_t baseTime = currentTimer->lastEvent;
+	int32_t base = gba->memory.io[GBA_REG_TMCNT_LO(timer) >> 1];
+	int32_t tickIncrement = ((overflowTime - baseTime) >> prescaleBits) + base;
+	if (tickIncrement >= 0x10000) {
+		int32_t sinceOverflow = (tickIncrement - 0x10000) % (0x10000 - currentTimer->reload);
+		baseTime = overflowTime - (sinceOverflow << prescaleBits);
+		base = currentTimer->reload;
+	}
 
 	// Update register
-	int32_t tickIncrement = currentTime - currentTimer->lastEvent;
+	tickIncrement = ((currentTime - baseTime) >> prescaleBits) + base;
 	currentTimer->lastEvent = currentTime;
-	tickIncrement >>= prescaleBits;
-	tickIncrement += gba->memory.io[GBA_REG_TMCNT_LO(timer) >> 1];
-	while (tickIncrement >= 0x10000) {
-		tickIncrement -= 0x10000 - currentTimer->reload;
-	}
 	gba->memory.io[GBA_REG_TMCNT_LO(timer) >> 1] = tickIncrement;
 
 	// Schedule next update
-	tickIncrement = (0x10000 - tickIncrement) << prescaleBits;
-	currentTime += tickIncrement;
+	if (_isObserved(gba, timer)) {
+		currentTimer->flags = GBATimerFlagsClearLazy(currentTimer->flags);
+		tickIncrement = (0x10000 - tickIncrement) << prescaleBits;
+		currentTime += tickIncrement;
+	} else {
+		currentTimer->flags = GBATimerFlagsFillLazy(currentTimer->flags);
+		currentTime += LAZY_REFRESH_INTERVAL;
+	}
 	currentTime &= ~tickMask;
 	mTimingDeschedule(&gba->timing, &currentTimer->event);
 	mTimingScheduleAbsolute(&gba->timing, &currentTimer->event, currentTime);
 }
 
 void GBATimerWriteTMCNT_LO(struct GBA* gba, int timer, uint16_t reload) {
-	gba->timers[timer].reload = reload;
+	struct GBATimer* currentTimer = &gba->timers[timer];
+	if (GBATimerFlagsIsLazy(currentTimer->flags) && mTimingIsScheduled(&gba->timing, &currentTimer->event)) {
+		// Catch up on overflows that happened with the old reload value
+		GBATimerUpdateRegister(gba, timer, 0);
+	}
+	currentTimer->reload = reload;
 }
 
 void GBATimerWriteTMCNT_HI(struct GBA* gba, int timer, uint16_t control) {
@@ -149,5 +195,21 @@ void GBATimerWriteTMCNT_HI(struct GBA* gba, int timer, uint16_t control) {
 			currentTimer->lastEvent = mTimingCurrentTime(&gba->timing) & ~tickMask;
 			GBATimerUpdateRegister(gba, timer, 0);
 		}
+	} else {
+		GBATimerReschedule(gba, timer);
+	}
+	if (timer > 0) {
+		GBATimerReschedule(gba, timer - 1);
+	}
+}
+
+void GBATimerReschedule(struct GBA* gba, int timer) {
+	struct GBATimer* currentTimer = &gba->timers[timer];
+	if (!mTimingIsScheduled(&gba->timing, &currentTimer->event)) {
+		return;
+	}
+	bool lazy = GBATimerFlagsIsLazy(currentTimer->flags);
+	if (lazy == _isObserved(gba, timer)) {
+		GBATimerUpdateRegister(gba, timer, 0);
 	}
 }
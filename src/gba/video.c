@@ -7,8 +7,10 @@
 
 #include <mgba/core/sync.h>
 #include <mgba/core/cache-set.h>
+#include <mgba/core/host-trace.h>
 #include <mgba/internal/arm/macros.h>
 #include <mgba/internal/gba/dma.h>
+#include <mgba/internal/gba/extra/audio-mixer.h>
 #include <mgba/internal/gba/gba.h>
 #include <mgba/internal/gba/io.h>
 #include <mgba/internal/gba/renderers/cache-set.h>
@@ -55,8 +57,9 @@ MGBA_EXPORT const int GBAVideoObjSizes[16][2] = {
 
 void GBAVideoInit(struct GBAVideo* video) {
 	video->renderer = NULL;
-	video->vram = anonymousMemoryMap(GBA_SIZE_VRAM);
+	video->vram = (uint16_t*) &video->p->memory.arena[GBA_ARENA_VRAM];
 	video->frameskip = 0;
+	video->renderSkip = false;
 	video->event.name = "GBA Video";
 	video->event.callback = NULL;
 	video->event.context = video;
@@ -79,6 +82,7 @@ void GBAVideoReset(struct GBAVideo* video) {
 
 	video->frameCounter = 0;
 	video->frameskipCounter = 0;
+	video->skipFrame = false;
 	video->stallMask = 0;
 
 	memset(video->palette, 0, sizeof(video->palette));
@@ -94,7 +98,6 @@ void GBAVideoReset(struct GBAVideo* video) {
 
 void GBAVideoDeinit(struct GBAVideo* video) {
 	video->renderer->deinit(video->renderer);
-	mappedMemoryFree(video->vram, GBA_SIZE_VRAM);
 }
 
 void GBAVideoDummyRendererCreate(struct GBAVideoRenderer* renderer) {
@@ -170,13 +173,20 @@ void _startHdraw(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 	switch (video->vcount) {
 	case 0:
 		GBAFrameStarted(video->p);
+		// Streams still need every frame, even if the renderer is told not to bother
+		video->skipFrame = video->frameskipCounter > 0 || (video->renderSkip && !(video->p->stream && video->p->stream->postVideoFrame));
 		break;
 	case GBA_VIDEO_VERTICAL_PIXELS:
 		video->p->memory.io[GBA_REG(DISPSTAT)] = GBARegisterDISPSTATFillInVblank(dispstat);
-		if (video->frameskipCounter <= 0) {
+		if (!video->skipFrame) {
+			mTRACE_BEGIN("Renderer: finish frame");
 			video->renderer->finishFrame(video->renderer);
+			mTRACE_END();
 		}
 		GBADMARunVblank(video->p, -cyclesLate);
+		if (video->p->audio.mixer) {
+			video->p->audio.mixer->vblank(video->p->audio.mixer);
+		}
 		if (GBARegisterDISPSTATIsVblankIRQ(dispstat)) {
 			GBARaiseIRQ(video->p, GBA_IRQ_VBLANK, cyclesLate);
 		}
@@ -203,8 +213,10 @@ void _startHblank(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 	// Begin Hblank
 	GBARegisterDISPSTAT dispstat = video->p->memory.io[GBA_REG(DISPSTAT)];
 	dispstat = GBARegisterDISPSTATFillInHblank(dispstat);
-	if (video->vcount < GBA_VIDEO_VERTICAL_PIXELS && video->frameskipCounter <= 0) {
+	if (video->vcount < GBA_VIDEO_VERTICAL_PIXELS && !video->skipFrame) {
+		mTRACE_BEGIN("Renderer: draw scanline");
 		video->renderer->drawScanline(video->renderer, video->vcount);
+		mTRACE_END();
 	}
 
 	if (video->vcount < GBA_VIDEO_VERTICAL_PIXELS) {
@@ -404,8 +416,8 @@ static void GBAVideoDummyRendererPutPixels(struct GBAVideoRenderer* renderer, si
 	// Nothing to do
 }
 
-void GBAVideoSerialize(const struct GBAVideo* video, struct GBASerializedState* state) {
-	memcpy(state->vram, video->vram, GBA_SIZE_VRAM);
+void GBAVideoSerialize(const struct GBAVideo* video, struct GBASerializedState* state, uint32_t since) {
+	mStateCopyDirtyPages(state->vram, video->vram, &video->p->memory.dirtyPages[GBA_DIRTY_PAGES_VRAM], GBA_SIZE_VRAM >> mSTATE_PAGE_SHIFT, since);
 	memcpy(state->oam, video->oam.raw, GBA_SIZE_OAM);
 	memcpy(state->pram, video->palette, GBA_SIZE_PALETTE_RAM);
 	STORE_32(video->event.when - mTimingCurrentTime(&video->p->timing), 0, &state->video.nextEvent);
@@ -419,8 +431,8 @@ void GBAVideoSerialize(const struct GBAVideo* video, struct GBASerializedState*
 	STORE_32(video->frameCounter, 0, &state->video.frameCounter);
 }
 
-void GBAVideoDeserialize(struct GBAVideo* video, const struct GBASerializedState* state) {
-	memcpy(video->vram, state->vram, GBA_SIZE_VRAM);
+void GBAVideoDeserialize(struct GBAVideo* video, const struct GBASerializedState* state, uint32_t since) {
+	mStateCopyDirtyPages(video->vram, state->vram, &video->p->memory.dirtyPages[GBA_DIRTY_PAGES_VRAM], GBA_SIZE_VRAM >> mSTATE_PAGE_SHIFT, since);
 	uint16_t value;
 	int i;
 	for (i = 0; i < GBA_SIZE_OAM; i += 2) {
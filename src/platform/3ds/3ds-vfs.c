@@ -16,6 +16,8 @@ struct VFile3DS {
 
 	Handle handle;
 	u64 offset;
+	uint8_t* mapping;
+	size_t mapSize;
 };
 
 struct VDirEntry3DS {
@@ -71,6 +73,8 @@ struct VFile* VFileOpen3DS(FS_Archive* archive, const char* path, int flags) {
 	}
 
 	vf3d->offset = 0;
+	vf3d->mapping = NULL;
+	vf3d->mapSize = 0;
 
 	vf3d->d.close = _vf3dClose;
 	vf3d->d.seek = _vf3dSeek;
@@ -144,6 +148,8 @@ static void* _vf3dMap(struct VFile* vf, size_t size, int flags) {
 	if (buffer) {
 		u32 sizeRead;
 		FSFILE_Read(vf3d->handle, &sizeRead, 0, buffer, size);
+		vf3d->mapping = buffer;
+		vf3d->mapSize = size;
 	}
 	return buffer;
 }
@@ -152,6 +158,10 @@ static void _vf3dUnmap(struct VFile* vf, void* memory, size_t size) {
 	struct VFile3DS* vf3d = (struct VFile3DS*) vf;
 	u32 sizeWritten;
 	FSFILE_Write(vf3d->handle, &sizeWritten, 0, memory, size, FS_WRITE_FLUSH | FS_WRITE_UPDATE_TIME);
+	if (memory == vf3d->mapping) {
+		vf3d->mapping = NULL;
+		vf3d->mapSize = 0;
+	}
 	mappedMemoryFree(memory, size);
 }
 
@@ -170,8 +180,12 @@ ssize_t _vf3dSize(struct VFile* vf) {
 static bool _vf3dSync(struct VFile* vf, void* buffer, size_t size) {
 	struct VFile3DS* vf3d = (struct VFile3DS*) vf;
 	if (buffer) {
+		u64 offset = 0;
+		if ((uint8_t*) buffer >= vf3d->mapping && (uint8_t*) buffer < vf3d->mapping + vf3d->mapSize) {
+			offset = (uint8_t*) buffer - vf3d->mapping;
+		}
 		u32 sizeWritten;
-		Result res = FSFILE_Write(vf3d->handle, &sizeWritten, 0, buffer, size, FS_WRITE_FLUSH | FS_WRITE_UPDATE_TIME);
+		Result res = FSFILE_Write(vf3d->handle, &sizeWritten, offset, buffer, size, FS_WRITE_FLUSH | FS_WRITE_UPDATE_TIME);
 		return R_SUCCEEDED(res);
 	}
 	FSFILE_Flush(vf3d->handle);
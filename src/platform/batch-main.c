@@ -0,0 +1,651 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/config.h>
+#include <mgba/core/core.h>
+#include <mgba/core/log.h>
+#include <mgba/core/shared-rom.h>
+#ifdef ENABLE_SCRIPTING
+#include <mgba/script.h>
+#include <mgba/core/scripting.h>
+#endif
+
+#include <mgba/feature/commandline.h>
+#include <mgba-util/crc32.h>
+#include <mgba-util/string.h>
+#include <mgba-util/threading.h>
+#include <mgba-util/vector.h>
+#include <mgba-util/vfs.h>
+
+#include <errno.h>
+#include <signal.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#define BATCH_OPTIONS "F:j:J:o:R:"
+static const char* const batchUsage =
+	"Each positional argument is a ROM to run as its own job\n"
+	"\n"
+	"Additional options:\n"
+	"  -F FRAMES        Default frame budget for each job (default 3600)\n"
+	"  -j THREADS       Number of worker threads (default: one per CPU)\n"
+	"  -J FILE          Read jobs from FILE, one per line: ROM<TAB>FRAMES[<TAB>SCRIPT...]\n"
+	"  -o FILE          Write results to FILE instead of stdout\n"
+	"  -R REGISTER      Report the value of REGISTER when each job finishes\n"
+#ifdef ENABLE_SCRIPTING
+	"  --script FILE    Run a script in every job. Can be passed multiple times\n"
+#endif
+	;
+
+enum BatchStatus {
+	BATCH_PENDING = 0,
+	BATCH_BUDGET,
+	BATCH_SHUTDOWN,
+	BATCH_INTERRUPTED,
+	BATCH_LOAD_ERROR,
+	BATCH_SCRIPT_ERROR,
+};
+
+struct BatchJob {
+	char* path;
+	unsigned frames;
+	struct StringList scripts;
+
+	enum BatchStatus status;
+	unsigned framesRun;
+	uint32_t videoCrc32;
+	int32_t returnCode;
+};
+
+DECLARE_VECTOR(BatchJobList, struct BatchJob);
+DEFINE_VECTOR(BatchJobList, struct BatchJob);
+
+struct BatchOpts {
+	unsigned frames;
+	unsigned threads;
+	char* outputPath;
+	char* returnCodeRegister;
+	struct StringList jobFiles;
+	struct StringList roms;
+	struct StringList scripts;
+};
+
+struct BatchWorker;
+
+struct BatchLogger {
+	struct mLogger d;
+	struct BatchWorker* worker;
+};
+
+// Each worker owns a deque of job indices. The owner takes from the back and
+// idle workers steal from the front, so contention only happens when stealing
+struct BatchQueue {
+	Mutex mutex;
+	size_t* jobs;
+	size_t front;
+	size_t back;
+};
+
+struct BatchContext {
+	struct BatchJobList jobs;
+	struct BatchWorker* workers;
+	size_t nWorkers;
+	const struct BatchOpts* opts;
+	const struct mArguments* args;
+	struct mCoreConfig config;
+	struct mLogFilter logFilter;
+	Mutex logMutex;
+};
+
+struct BatchWorker {
+	Thread thread;
+	size_t id;
+	struct BatchContext* context;
+	struct BatchQueue queue;
+	struct BatchLogger logger;
+
+	struct mCore* core;
+	struct mCoreCallbacks callbacks;
+	mColor* videoBuffer;
+	size_t currentJob;
+	bool shutdown;
+};
+
+static void _batchShutdown(int signal);
+static bool _parseBatchOpts(struct mSubParser* parser, int option, const char* arg);
+static bool _parseLongBatchOpts(struct mSubParser* parser, const char* option, const char* arg);
+static bool _handleBatchExtraArg(struct mSubParser* parser, const char* arg);
+static bool _loadJobFile(struct BatchJobList* jobs, const char* path, unsigned defaultFrames);
+static void _addJob(struct BatchJobList* jobs, const char* path, unsigned frames);
+static void _deinitJobs(struct BatchJobList* jobs);
+static unsigned _defaultThreads(void);
+
+static THREAD_ENTRY _batchWorkerRun(void* context);
+static bool _takeJob(struct BatchWorker* worker, size_t* job);
+static void _runJob(struct BatchWorker* worker, struct BatchJob* job);
+static bool _prepareCore(struct BatchWorker* worker, const char* path);
+static void _batchCoreShutdown(void* context);
+static void _batchLog(struct mLogger* logger, int category, enum mLogLevel level, const char* format, va_list args);
+static void _writeResults(const struct BatchJobList* jobs, FILE* out);
+
+static volatile bool _dispatchExiting = false;
+
+int main(int argc, char* argv[]) {
+	signal(SIGINT, _batchShutdown);
+
+	int ret = 1;
+	size_t i;
+
+	struct BatchOpts batchOpts = { .frames = 3600 };
+	StringListInit(&batchOpts.jobFiles, 0);
+	StringListInit(&batchOpts.roms, 0);
+	StringListInit(&batchOpts.scripts, 0);
+	struct mSubParser subparser = {
+		.usage = batchUsage,
+		.parse = _parseBatchOpts,
+		.parseLong = _parseLongBatchOpts,
+		.handleExtraArg = _handleBatchExtraArg,
+		.extraOptions = BATCH_OPTIONS,
+		.longOptions = (struct mOption[]) {
+			{
+				.name = "script",
+				.arg = true,
+			},
+			{0}
+		},
+		.opts = &batchOpts
+	};
+
+	struct BatchContext context = { .opts = &batchOpts };
+	BatchJobListInit(&context.jobs, 0);
+
+	struct mArguments args;
+	context.args = &args;
+	bool parsed = mArgumentsParse(&args, argc, argv, &subparser, 1);
+	if (args.fname) {
+		*StringListAppend(&batchOpts.roms) = strdup(args.fname);
+	}
+	if (!StringListSize(&batchOpts.roms) && !StringListSize(&batchOpts.jobFiles)) {
+		parsed = false;
+	}
+	if (!parsed || args.showHelp) {
+		usage(argv[0], "[option ...] [ROM ...]", NULL, &subparser, 1);
+		ret = !parsed;
+		goto argsExit;
+	}
+	if (args.showVersion) {
+		version(argv[0]);
+		ret = 0;
+		goto argsExit;
+	}
+
+	for (i = 0; i < StringListSize(&batchOpts.jobFiles); ++i) {
+		const char* jobFile = *StringListGetConstPointer(&batchOpts.jobFiles, i);
+		if (!_loadJobFile(&context.jobs, jobFile, batchOpts.frames)) {
+			fprintf(stderr, "Could not read job file %s\n", jobFile);
+			goto argsExit;
+		}
+	}
+	for (i = 0; i < StringListSize(&batchOpts.roms); ++i) {
+		_addJob(&context.jobs, *StringListGetConstPointer(&batchOpts.roms, i), batchOpts.frames);
+	}
+
+	FILE* output = stdout;
+	if (batchOpts.outputPath) {
+		output = fopen(batchOpts.outputPath, "w");
+		if (!output) {
+			fprintf(stderr, "Could not open %s for writing\n", batchOpts.outputPath);
+			goto argsExit;
+		}
+	}
+
+	// All cores share one configuration; it is only read once the workers start
+	mCoreConfigInit(&context.config, "batch");
+	mCoreConfigLoad(&context.config);
+	mCoreConfigSetDefaultValue(&context.config, "idleOptimization", "remove");
+	mCoreConfigSetDefaultIntValue(&context.config, "logLevel", mLOG_FATAL | mLOG_ERROR);
+	mArgumentsApply(&args, NULL, 0, &context.config);
+	mLogFilterInit(&context.logFilter);
+	mLogFilterLoad(&context.logFilter, &context.config);
+	MutexInit(&context.logMutex);
+	// Jobs running the same game share a single copy of the ROM
+	mSharedROMInit();
+
+	size_t nJobs = BatchJobListSize(&context.jobs);
+	context.nWorkers = batchOpts.threads ? batchOpts.threads : _defaultThreads();
+	if (context.nWorkers > nJobs) {
+		context.nWorkers = nJobs;
+	}
+	if (!context.nWorkers) {
+		context.nWorkers = 1;
+	}
+	context.workers = calloc(context.nWorkers, sizeof(*context.workers));
+
+	// Hand out contiguous runs of jobs up front; stealing evens out the rest
+	size_t start = 0;
+	for (i = 0; i < context.nWorkers; ++i) {
+		struct BatchWorker* worker = &context.workers[i];
+		size_t count = nJobs / context.nWorkers + (i < nJobs % context.nWorkers);
+		worker->id = i;
+		worker->context = &context;
+		worker->logger.d.log = _batchLog;
+		worker->logger.d.filter = &context.logFilter;
+		worker->logger.worker = worker;
+		worker->currentJob = SIZE_MAX;
+		MutexInit(&worker->queue.mutex);
+		worker->queue.jobs = calloc(count ? count : 1, sizeof(size_t));
+		worker->queue.front = 0;
+		worker->queue.back = count;
+		size_t j;
+		for (j = 0; j < count; ++j) {
+			worker->queue.jobs[j] = start + j;
+		}
+		start += count;
+	}
+	for (i = 0; i < context.nWorkers; ++i) {
+		ThreadCreate(&context.workers[i].thread, _batchWorkerRun, &context.workers[i]);
+	}
+	for (i = 0; i < context.nWorkers; ++i) {
+		ThreadJoin(&context.workers[i].thread);
+		MutexDeinit(&context.workers[i].queue.mutex);
+		free(context.workers[i].queue.jobs);
+	}
+	free(context.workers);
+	mSharedROMDeinit();
+
+	_writeResults(&context.jobs, output);
+	if (output != stdout) {
+		fclose(output);
+	}
+
+	ret = 0;
+	for (i = 0; i < nJobs; ++i) {
+		enum BatchStatus status = BatchJobListGetPointer(&context.jobs, i)->status;
+		if (status != BATCH_BUDGET && status != BATCH_SHUTDOWN) {
+			ret = 1;
+		}
+	}
+
+	MutexDeinit(&context.logMutex);
+	mLogFilterDeinit(&context.logFilter);
+	mCoreConfigDeinit(&context.config);
+
+argsExit:
+	_deinitJobs(&context.jobs);
+	for (i = 0; i < StringListSize(&batchOpts.jobFiles); ++i) {
+		free(*StringListGetPointer(&batchOpts.jobFiles, i));
+	}
+	StringListDeinit(&batchOpts.jobFiles);
+	for (i = 0; i < StringListSize(&batchOpts.roms); ++i) {
+		free(*StringListGetPointer(&batchOpts.roms, i));
+	}
+	StringListDeinit(&batchOpts.roms);
+	for (i = 0; i < StringListSize(&batchOpts.scripts); ++i) {
+		free(*StringListGetPointer(&batchOpts.scripts, i));
+	}
+	StringListDeinit(&batchOpts.scripts);
+	free(batchOpts.outputPath);
+	free(batchOpts.returnCodeRegister);
+	mArgumentsDeinit(&args);
+
+	return ret;
+}
+
+static void _batchShutdown(int signal) {
+	UNUSED(signal);
+	_dispatchExiting = true;
+}
+
+static THREAD_ENTRY _batchWorkerRun(void* context) {
+	struct BatchWorker* worker = context;
+	ThreadSetName("Batch Worker");
+	mLogSetThreadLogger(&worker->logger.d);
+
+	size_t job;
+	while (!_dispatchExiting && _takeJob(worker, &job)) {
+		worker->currentJob = job;
+		_runJob(worker, BatchJobListGetPointer(&worker->context->jobs, job));
+		worker->currentJob = SIZE_MAX;
+	}
+
+	if (worker->core) {
+		worker->core->unloadROM(worker->core);
+		mCoreConfigDeinit(&worker->core->config);
+		worker->core->deinit(worker->core);
+		worker->core = NULL;
+	}
+	free(worker->videoBuffer);
+	worker->videoBuffer = NULL;
+	mLogSetThreadLogger(NULL);
+	THREAD_EXIT(0);
+}
+
+static bool _takeJob(struct BatchWorker* worker, size_t* job) {
+	struct BatchQueue* queue = &worker->queue;
+	bool found = false;
+	MutexLock(&queue->mutex);
+	if (queue->back > queue->front) {
+		--queue->back;
+		*job = queue->jobs[queue->back];
+		found = true;
+	}
+	MutexUnlock(&queue->mutex);
+	if (found) {
+		return true;
+	}
+
+	struct BatchContext* context = worker->context;
+	size_t i;
+	for (i = 1; i < context->nWorkers && !found; ++i) {
+		struct BatchQueue* victim = &context->workers[(worker->id + i) % context->nWorkers].queue;
+		MutexLock(&victim->mutex);
+		if (victim->back > victim->front) {
+			*job = victim->jobs[victim->front];
+			++victim->front;
+			found = true;
+		}
+		MutexUnlock(&victim->mutex);
+	}
+	// Jobs never spawn more jobs, so once every queue is empty the pool is done
+	return found;
+}
+
+static bool _prepareCore(struct BatchWorker* worker, const char* path) {
+	struct mCore* core = worker->core;
+	// Reuse the last core if it can run this ROM, which skips reinitializing
+	// the core and reloading its BIOS
+	if (core && mCoreLoadFile(core, path)) {
+		return true;
+	}
+	if (core) {
+		mCoreConfigDeinit(&core->config);
+		core->deinit(core);
+		worker->core = NULL;
+	}
+
+	core = mCoreFind(path);
+	if (!core) {
+		return false;
+	}
+	core->init(core);
+	mCoreInitConfig(core, NULL);
+	mCoreLoadForeignConfig(core, &worker->context->config);
+
+	unsigned width, height;
+	core->baseVideoSize(core, &width, &height);
+	free(worker->videoBuffer);
+	worker->videoBuffer = calloc(width * height, BYTES_PER_PIXEL);
+	core->setVideoBuffer(core, worker->videoBuffer, width);
+
+	worker->callbacks = (struct mCoreCallbacks) {
+		.shutdown = _batchCoreShutdown,
+		.context = worker,
+	};
+	core->addCoreCallbacks(core, &worker->callbacks);
+	worker->core = core;
+
+	return mCoreLoadFile(core, path);
+}
+
+static void _runJob(struct BatchWorker* worker, struct BatchJob* job) {
+	const struct BatchContext* context = worker->context;
+	const struct BatchOpts* opts = context->opts;
+	if (!_prepareCore(worker, job->path)) {
+		mLOG(STATUS, ERROR, "Failed to load %s", job->path);
+		job->status = BATCH_LOAD_ERROR;
+		return;
+	}
+	struct mCore* core = worker->core;
+	core->reset(core);
+	mArgumentsApplyFileLoads(context->args, core);
+	worker->shutdown = false;
+
+#ifdef ENABLE_SCRIPTING
+	struct mScriptContext scriptContext;
+	size_t nScripts = StringListSize(&opts->scripts) + StringListSize(&job->scripts);
+	if (nScripts) {
+		mScriptContextInit(&scriptContext);
+		mScriptContextAttachStdlib(&scriptContext);
+		mScriptContextAttachImage(&scriptContext);
+		mScriptContextAttachLogger(&scriptContext, NULL);
+		mScriptContextAttachSocket(&scriptContext);
+#ifdef USE_JSON_C
+		mScriptContextAttachStorage(&scriptContext);
+#endif
+		mScriptContextRegisterEngines(&scriptContext);
+		mScriptContextAttachCore(&scriptContext, core);
+
+		size_t i;
+		for (i = 0; i < nScripts; ++i) {
+			const char* script;
+			if (i < StringListSize(&opts->scripts)) {
+				script = *StringListGetConstPointer(&opts->scripts, i);
+			} else {
+				script = *StringListGetConstPointer(&job->scripts, i - StringListSize(&opts->scripts));
+			}
+			if (!mScriptContextLoadFile(&scriptContext, script)) {
+				mLOG(STATUS, ERROR, "Failed to load script \"%s\"", script);
+				job->status = BATCH_SCRIPT_ERROR;
+				goto scriptsError;
+			}
+		}
+	}
+#endif
+
+	uint32_t startFrame = core->frameCounter(core);
+	while (!worker->shutdown && !_dispatchExiting && core->frameCounter(core) - startFrame < job->frames) {
+		core->runFrame(core);
+	}
+	job->framesRun = core->frameCounter(core) - startFrame;
+	if (worker->shutdown) {
+		job->status = BATCH_SHUTDOWN;
+	} else if (_dispatchExiting) {
+		job->status = BATCH_INTERRUPTED;
+	} else {
+		job->status = BATCH_BUDGET;
+	}
+
+	unsigned width, height;
+	const void* pixels;
+	size_t stride;
+	core->currentVideoSize(core, &width, &height);
+	core->getPixels(core, &pixels, &stride);
+	uint32_t crc = 0;
+	unsigned y;
+	for (y = 0; y < height; ++y) {
+		crc = crc32(crc, (const uint8_t*) pixels + y * stride * BYTES_PER_PIXEL, width * BYTES_PER_PIXEL);
+	}
+	job->videoCrc32 = crc;
+
+	if (opts->returnCodeRegister) {
+		core->readRegister(core, opts->returnCodeRegister, &job->returnCode);
+	}
+
+#ifdef ENABLE_SCRIPTING
+scriptsError:
+	if (nScripts) {
+		mScriptContextDeinit(&scriptContext);
+	}
+#endif
+	core->unloadROM(core);
+}
+
+static void _batchCoreShutdown(void* context) {
+	struct BatchWorker* worker = context;
+	worker->shutdown = true;
+}
+
+static void _batchLog(struct mLogger* logger, int category, enum mLogLevel level, const char* format, va_list args) {
+	UNUSED(level);
+	struct BatchWorker* worker = ((struct BatchLogger*) logger)->worker;
+	struct BatchContext* context = worker->context;
+	MutexLock(&context->logMutex);
+	if (worker->currentJob != SIZE_MAX) {
+		fprintf(stderr, "[%s] ", BatchJobListGetPointer(&context->jobs, worker->currentJob)->path);
+	}
+	fprintf(stderr, "%s: ", mLogCategoryName(category));
+	vfprintf(stderr, format, args);
+	fprintf(stderr, "\n");
+	MutexUnlock(&context->logMutex);
+}
+
+static void _writeResults(const struct BatchJobList* jobs, FILE* out) {
+	static const char* const statusNames[] = {
+		[BATCH_PENDING] = "skipped",
+		[BATCH_BUDGET] = "budget",
+		[BATCH_SHUTDOWN] = "shutdown",
+		[BATCH_INTERRUPTED] = "interrupted",
+		[BATCH_LOAD_ERROR] = "load-error",
+		[BATCH_SCRIPT_ERROR] = "script-error",
+	};
+	size_t i;
+	for (i = 0; i < BatchJobListSize(jobs); ++i) {
+		const struct BatchJob* job = BatchJobListGetConstPointer(jobs, i);
+		fprintf(out, "%s\t%s\t%u\t%08X\t%" PRId32 "\n", job->path, statusNames[job->status], job->framesRun, job->videoCrc32, job->returnCode);
+	}
+}
+
+static void _addJob(struct BatchJobList* jobs, const char* path, unsigned frames) {
+	struct BatchJob* job = BatchJobListAppend(jobs);
+	memset(job, 0, sizeof(*job));
+	job->path = strdup(path);
+	job->frames = frames;
+	StringListInit(&job->scripts, 0);
+}
+
+static bool _loadJobFile(struct BatchJobList* jobs, const char* path, unsigned defaultFrames) {
+	struct VFile* vf = VFileOpen(path, O_RDONLY);
+	if (!vf) {
+		return false;
+	}
+	char line[PATH_MAX * 4];
+	while (vf->readline(vf, line, sizeof(line)) > 0) {
+		char* end = &line[strlen(line)];
+		while (end > line && (end[-1] == '\n' || end[-1] == '\r')) {
+			--end;
+		}
+		*end = '\0';
+		if (!line[0] || line[0] == '#') {
+			continue;
+		}
+
+		char* field = strchr(line, '\t');
+		if (field) {
+			*field = '\0';
+			++field;
+		}
+		_addJob(jobs, line, defaultFrames);
+		if (!field) {
+			continue;
+		}
+
+		struct BatchJob* job = BatchJobListGetPointer(jobs, BatchJobListSize(jobs) - 1);
+		char* next = strchr(field, '\t');
+		if (next) {
+			*next = '\0';
+			++next;
+		}
+		if (field[0]) {
+			char* parseEnd;
+			errno = 0;
+			unsigned long frames = strtoul(field, &parseEnd, 10);
+			if (!errno && !*parseEnd && frames <= UINT_MAX) {
+				job->frames = frames;
+			}
+		}
+		while (next) {
+			field = next;
+			next = strchr(field, '\t');
+			if (next) {
+				*next = '\0';
+				++next;
+			}
+			if (field[0]) {
+				*StringListAppend(&job->scripts) = strdup(field);
+			}
+		}
+	}
+	vf->close(vf);
+	return true;
+}
+
+static void _deinitJobs(struct BatchJobList* jobs) {
+	size_t i;
+	for (i = 0; i < BatchJobListSize(jobs); ++i) {
+		struct BatchJob* job = BatchJobListGetPointer(jobs, i);
+		size_t j;
+		for (j = 0; j < StringListSize(&job->scripts); ++j) {
+			free(*StringListGetPointer(&job->scripts, j));
+		}
+		StringListDeinit(&job->scripts);
+		free(job->path);
+	}
+	BatchJobListDeinit(jobs);
+}
+
+static unsigned _defaultThreads(void) {
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	return cpus > 0 ? cpus : 1;
+#else
+	return 1;
+#endif
+}
+
+static bool _parseBatchOpts(struct mSubParser* parser, int option, const char* arg) {
+	struct BatchOpts* opts = parser->opts;
+	char* parseEnd;
+	unsigned long value;
+	errno = 0;
+	switch (option) {
+	case 'F':
+	case 'j':
+		value = strtoul(arg, &parseEnd, 10);
+		if (errno || *parseEnd || value > UINT_MAX) {
+			return false;
+		}
+		if (option == 'F') {
+			opts->frames = value;
+		} else {
+			opts->threads = value;
+		}
+		return true;
+	case 'J':
+		*StringListAppend(&opts->jobFiles) = strdup(arg);
+		return true;
+	case 'o':
+		free(opts->outputPath);
+		opts->outputPath = strdup(arg);
+		return true;
+	case 'R':
+		free(opts->returnCodeRegister);
+		opts->returnCodeRegister = strdup(arg);
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool _parseLongBatchOpts(struct mSubParser* parser, const char* option, const char* arg) {
+	struct BatchOpts* opts = parser->opts;
+	if (strcmp(option, "script") == 0) {
+		*StringListAppend(&opts->scripts) = strdup(arg);
+		return true;
+	}
+	return false;
+}
+
+static bool _handleBatchExtraArg(struct mSubParser* parser, const char* arg) {
+	struct BatchOpts* opts = parser->opts;
+	*StringListAppend(&opts->roms) = strdup(arg);
+	return true;
+}
@@ -9,7 +9,9 @@
 #include <mgba/core/config.h>
 #include <mgba/core/core.h>
 #include <mgba/core/log.h>
+#include <mgba/core/movie.h>
 #include <mgba/core/serialize.h>
+#include <mgba/core/timing.h>
 #include <mgba/debugger/debugger.h>
 #ifdef M_CORE_GBA
 #include <mgba/internal/gba/gba.h>
@@ -23,11 +25,14 @@
 #endif
 
 #include <mgba/feature/commandline.h>
+#include <mgba-util/image.h>
+#include <mgba-util/socket.h>
 #include <mgba-util/vector.h>
 #include <mgba-util/vfs.h>
 
 #include <errno.h>
 #include <signal.h>
+#include <time.h>
 
 #define HEADLESS_OPTIONS "S:R:"
 static const char* const headlessUsage =
@@ -37,12 +42,66 @@ static const char* const headlessUsage =
 #ifdef ENABLE_SCRIPTING
 	"  --script FILE    Run a script on start. Can be passed multiple times\n"
 #endif
+	"  --metrics-port PORT  Serve Prometheus metrics over HTTP on the given port\n"
+	"  --control PORT   Wait for a controller to connect on the given local port and run frames\n"
+	"                   as it requests, exiting when it disconnects\n"
+	"  --control-shm FILE  Return data requested by the controller through a shared file\n"
+	"  --movie FILE     Play back an input movie as fast as possible, exiting when it ends\n"
 	;
 
 struct HeadlessOpts {
 	int exitSwiImmediate;
 	char* returnCodeRegister;
 	struct StringList scripts;
+	int metricsPort;
+	int controlPort;
+	char* controlShm;
+	char* movie;
+};
+
+// Counters for the metrics endpoint. Rates are measured over windows of about a second,
+// so that scrapers that don't compute rates themselves still get something useful.
+struct HeadlessMetrics {
+	Socket server;
+	struct mTimingProfile profile;
+	uint64_t startTime;
+	uint64_t windowStart;
+	uint64_t windowCpu;
+	uint32_t windowFrame;
+	double fps;
+	double cpuPerFrame;
+	double stateLoadTime;
+	bool stateLoaded;
+};
+
+// The control protocol lets an external process run batches of frames without a round
+// trip per frame. All fields are little-endian 32-bit words. Each request is:
+//   frames, keys, flags, nRanges, then nRanges pairs of (address, size)
+// The keys are held for the given number of frames, after which the ranges are read
+// without side effects, followed by the framebuffer if CONTROL_FRAMEBUFFER is set, in
+// rows of width * BYTES_PER_PIXEL. The response is:
+//   status, frame counter, width, height, payload size
+// followed by the payload itself, unless a shared file was given. In that case, the
+// payload is written to the start of the file instead, which the controller must have
+// made large enough beforehand.
+#define CONTROL_MAX_RANGES 64
+#define CONTROL_MAX_PAYLOAD 0x4000000
+#define CONTROL_FRAMEBUFFER 1
+
+enum HeadlessControlStatus {
+	CONTROL_OK = 0,
+	CONTROL_BAD_REQUEST = 1,
+	CONTROL_SHM_TOO_SMALL = 2,
+};
+
+struct HeadlessControl {
+	Socket server;
+	struct VFile* shm;
+	uint8_t* shmData;
+	size_t shmSize;
+	uint8_t* payload;
+	size_t payloadCapacity;
+	mColor* videoBuffer;
 };
 
 static void _headlessShutdown(int signal);
@@ -52,6 +111,16 @@ static bool _parseSwi(const char* regStr, int* oSwi);
 
 static bool _headlessCheckResiger(void);
 
+static bool _metricsInit(struct HeadlessMetrics* metrics, int port);
+static void _metricsDeinit(struct HeadlessMetrics* metrics);
+static void _metricsPoll(struct HeadlessMetrics* metrics);
+static uint64_t _wallClock(void);
+
+static void _controlSetVideoBuffer(struct HeadlessControl* control);
+static bool _controlInit(struct HeadlessControl* control, int port, const char* shmPath);
+static void _controlDeinit(struct HeadlessControl* control);
+static void _controlRun(struct HeadlessControl* control, struct HeadlessMetrics* metrics);
+
 static struct mCore* core;
 
 static bool _dispatchExiting = false;
@@ -77,7 +146,9 @@ int main(int argc, char * argv[]) {
 	int uncleanExit = 1;
 	size_t i;
 
-	struct HeadlessOpts headlessOpts = { 3, NULL };
+	struct HeadlessOpts headlessOpts = { 3, NULL, .metricsPort = -1, .controlPort = -1 };
+	struct HeadlessMetrics metrics = { .server = INVALID_SOCKET };
+	struct HeadlessControl control = { .server = INVALID_SOCKET };
 	StringListInit(&headlessOpts.scripts, 0);
 	struct mSubParser subparser = {
 		.usage = headlessUsage,
@@ -89,6 +160,22 @@ int main(int argc, char * argv[]) {
 				.name = "script",
 				.arg = true,
 			},
+			{
+				.name = "metrics-port",
+				.arg = true,
+			},
+			{
+				.name = "control",
+				.arg = true,
+			},
+			{
+				.name = "control-shm",
+				.arg = true,
+			},
+			{
+				.name = "movie",
+				.arg = true,
+			},
 			{0}
 		},
 		.opts = &headlessOpts
@@ -178,6 +265,9 @@ int main(int argc, char * argv[]) {
 	}
 #endif
 
+	if (headlessOpts.controlPort >= 0) {
+		_controlSetVideoBuffer(&control);
+	}
 	core->reset(core);
 
 	mArgumentsApplyFileLoads(&args, core);
@@ -187,7 +277,9 @@ int main(int argc, char * argv[]) {
 		savestate = VFileOpen(args.savestate, O_RDONLY);
 	}
 	if (savestate) {
-		mCoreLoadStateNamed(core, savestate, 0);
+		uint64_t start = _wallClock();
+		metrics.stateLoaded = mCoreLoadStateNamed(core, savestate, 0);
+		metrics.stateLoadTime = (_wallClock() - start) / 1e9;
 		savestate->close(savestate);
 	}
 
@@ -216,19 +308,55 @@ int main(int argc, char * argv[]) {
 	}
 #endif
 
+	if (headlessOpts.metricsPort >= 0 && !_metricsInit(&metrics, headlessOpts.metricsPort)) {
+		mLOG(STATUS, ERROR, "Failed to listen for metrics on port %i", headlessOpts.metricsPort);
+		goto scriptsError;
+	}
+	struct mCoreMovie movie;
+	mCoreMovieInit(&movie, 0);
+	if (headlessOpts.movie) {
+		struct VFile* vf = VFileOpen(headlessOpts.movie, O_RDONLY);
+		bool loaded = vf && mCoreMovieLoad(&movie, vf);
+		if (vf) {
+			vf->close(vf);
+		}
+		if (!loaded || !mCoreMovieStartPlayback(&movie, core)) {
+			mLOG(STATUS, ERROR, "Failed to play movie \"%s\"", headlessOpts.movie);
+			goto movieError;
+		}
+	}
+	if (headlessOpts.controlPort >= 0 && !_controlInit(&control, headlessOpts.controlPort, headlessOpts.controlShm)) {
+		mLOG(STATUS, ERROR, "Failed to set up control on port %i", headlessOpts.controlPort);
+		goto movieError;
+	}
+
+	if (headlessOpts.movie) {
+		// Without a frontend there's nothing to sync to, so this runs flat out
+		while (!_dispatchExiting && mCoreMovieRunFrame(&movie, core, 0)) {
+			_metricsPoll(&metrics);
+		}
+	} else if (headlessOpts.controlPort >= 0) {
+		_controlRun(&control, &metrics);
+	} else
 #ifdef ENABLE_DEBUGGERS
 	if (hasDebugger) {
 		do {
 			mDebuggerRun(&debugger);
+			_metricsPoll(&metrics);
 		} while (!_dispatchExiting && debugger.state != DEBUGGER_SHUTDOWN);
 	} else
 #endif
 	do {
 		core->runLoop(core);
+		_metricsPoll(&metrics);
 	} while (!_dispatchExiting);
 	cleanExit = true;
 
+movieError:
+	mCoreMovieDeinit(&movie);
 scriptsError:
+	_controlDeinit(&control);
+	_metricsDeinit(&metrics);
 	core->unloadROM(core);
 
 #ifdef ENABLE_SCRIPTING
@@ -253,6 +381,8 @@ loadError:
 	}
 
 argsExit:
+	free(headlessOpts.controlShm);
+	free(headlessOpts.movie);
 	for (i = 0; i < StringListSize(&headlessOpts.scripts); ++i) {
 		free(*StringListGetPointer(&headlessOpts.scripts, i));
 	}
@@ -345,6 +475,421 @@ static void _headlessSwi32(struct ARMCore* cpu, int immediate) {
 }
 #endif
 
+static uint64_t _wallClock(void) {
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec * UINT64_C(1000000000) + tv.tv_usec * UINT64_C(1000);
+#endif
+}
+
+static uint64_t _cpuClock(void) {
+#ifdef CLOCK_PROCESS_CPUTIME_ID
+	struct timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+#else
+	return clock() * (UINT64_C(1000000000) / CLOCKS_PER_SEC);
+#endif
+}
+
+static bool _metricsInit(struct HeadlessMetrics* metrics, int port) {
+	SocketSubsystemInit();
+	metrics->server = SocketOpenTCP(port, NULL);
+	if (SOCKET_FAILED(metrics->server)) {
+		SocketSubsystemDeinit();
+		return false;
+	}
+	if (SOCKET_FAILED(SocketListen(metrics->server, 4)) || !SocketSetBlocking(metrics->server, false)) {
+		SocketClose(metrics->server);
+		metrics->server = INVALID_SOCKET;
+		SocketSubsystemDeinit();
+		return false;
+	}
+#ifndef _WIN32
+	// A scraper hanging up early shouldn't take the instance down with it
+	signal(SIGPIPE, SIG_IGN);
+#endif
+
+	// No clock is attached, so this only counts events and doesn't slow down the scheduler much
+	mTimingProfileReset(&metrics->profile);
+	metrics->profile.clock = NULL;
+	if (!core->timing->profile) {
+		core->timing->profile = &metrics->profile;
+	}
+
+	metrics->startTime = _wallClock();
+	metrics->windowStart = metrics->startTime;
+	metrics->windowCpu = _cpuClock();
+	metrics->windowFrame = core->frameCounter(core);
+	return true;
+}
+
+static void _metricsDeinit(struct HeadlessMetrics* metrics) {
+	if (SOCKET_FAILED(metrics->server)) {
+		return;
+	}
+	if (core->timing->profile == &metrics->profile) {
+		core->timing->profile = NULL;
+	}
+	SocketClose(metrics->server);
+	metrics->server = INVALID_SOCKET;
+	SocketSubsystemDeinit();
+}
+
+static char _metricsBuffer[0x8000];
+static size_t _metricsLength;
+
+ATTRIBUTE_FORMAT(printf, 1, 2)
+static void _metricsAppend(const char* format, ...) {
+	va_list args;
+	va_start(args, format);
+	int length = vsnprintf(&_metricsBuffer[_metricsLength], sizeof(_metricsBuffer) - _metricsLength, format, args);
+	va_end(args);
+	if (length > 0) {
+		_metricsLength += length;
+		if (_metricsLength >= sizeof(_metricsBuffer)) {
+			_metricsLength = sizeof(_metricsBuffer) - 1;
+		}
+	}
+}
+
+static void _metricsCounter(const char* name, const char* help, const char* type) {
+	_metricsAppend("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+static void _metricsWrite(struct HeadlessMetrics* metrics, Socket client) {
+	static const char header[] = "HTTP/1.0 200 OK\r\n"
+		"Content-Type: text/plain; version=0.0.4\r\n"
+		"Connection: close\r\n\r\n";
+	const struct mTimingProfile* profile = &metrics->profile;
+	uint64_t now = _wallClock();
+	size_t i;
+
+	_metricsLength = 0;
+	_metricsCounter("mgba_uptime_seconds", "Time since the metrics endpoint started", "gauge");
+	_metricsAppend("mgba_uptime_seconds %.3f\n", (now - metrics->startTime) / 1e9);
+	_metricsCounter("mgba_frames_total", "Frames emulated since the game was reset", "counter");
+	_metricsAppend("mgba_frames_total %u\n", core->frameCounter(core));
+	_metricsCounter("mgba_emulated_fps", "Frames emulated per second of host time over the last second", "gauge");
+	_metricsAppend("mgba_emulated_fps %.3f\n", metrics->fps);
+	_metricsCounter("mgba_host_cpu_seconds_total", "Host CPU time used by the process", "counter");
+	_metricsAppend("mgba_host_cpu_seconds_total %.6f\n", _cpuClock() / 1e9);
+	_metricsCounter("mgba_host_cpu_seconds_per_frame", "Host CPU time used per emulated frame over the last second", "gauge");
+	_metricsAppend("mgba_host_cpu_seconds_per_frame %.9f\n", metrics->cpuPerFrame);
+	if (metrics->stateLoaded) {
+		_metricsCounter("mgba_savestate_load_seconds", "Time taken to load the savestate passed on the command line", "gauge");
+		_metricsAppend("mgba_savestate_load_seconds %.6f\n", metrics->stateLoadTime);
+	}
+
+	struct mCoreMemoryUsageList memoryUsage;
+	mCoreMemoryUsageListInit(&memoryUsage, 0);
+	mCoreListMemoryUsage(core, &memoryUsage);
+	_metricsCounter("mgba_memory_bytes", "Host memory held by the core", "gauge");
+	for (i = 0; i < mCoreMemoryUsageListSize(&memoryUsage); ++i) {
+		const struct mCoreMemoryUsage* usage = mCoreMemoryUsageListGetConstPointer(&memoryUsage, i);
+		_metricsAppend("mgba_memory_bytes{block=\"%s\",backing=\"%s\"} %" PRIz "u\n",
+		               usage->name, mCoreMemoryBackingName(usage->backing), usage->size);
+	}
+	_metricsCounter("mgba_memory_resident_bytes", "Host memory held by the core that is resident", "gauge");
+	for (i = 0; i < mCoreMemoryUsageListSize(&memoryUsage); ++i) {
+		const struct mCoreMemoryUsage* usage = mCoreMemoryUsageListGetConstPointer(&memoryUsage, i);
+		_metricsAppend("mgba_memory_resident_bytes{block=\"%s\",backing=\"%s\"} %" PRIz "u\n",
+		               usage->name, mCoreMemoryBackingName(usage->backing), usage->resident);
+	}
+	mCoreMemoryUsageListDeinit(&memoryUsage);
+
+	if (core->timing->profile == profile) {
+		_metricsCounter("mgba_scheduler_events_total", "Scheduler events fired", "counter");
+		for (i = 0; i < profile->nEntries; ++i) {
+			_metricsAppend("mgba_scheduler_events_total{event=\"%s\"} %" PRIu64 "\n",
+			               profile->entries[i].name ? profile->entries[i].name : "other", profile->entries[i].count);
+		}
+		_metricsCounter("mgba_scheduler_lateness_cycles_total", "Cycles by which scheduler events fired late", "counter");
+		for (i = 0; i < profile->nEntries; ++i) {
+			_metricsAppend("mgba_scheduler_lateness_cycles_total{event=\"%s\"} %" PRIu64 "\n",
+			               profile->entries[i].name ? profile->entries[i].name : "other", profile->entries[i].lateness);
+		}
+		_metricsCounter("mgba_scheduler_reschedules_total", "Scheduler events moved before they fired", "counter");
+		for (i = 0; i < profile->nEntries; ++i) {
+			_metricsAppend("mgba_scheduler_reschedules_total{event=\"%s\"} %" PRIu64 "\n",
+			               profile->entries[i].name ? profile->entries[i].name : "other", profile->entries[i].reschedules);
+		}
+		_metricsCounter("mgba_scheduler_deschedules_total", "Scheduler events removed before they fired", "counter");
+		for (i = 0; i < profile->nEntries; ++i) {
+			_metricsAppend("mgba_scheduler_deschedules_total{event=\"%s\"} %" PRIu64 "\n",
+			               profile->entries[i].name ? profile->entries[i].name : "other", profile->entries[i].deschedules);
+		}
+	}
+
+	SocketSend(client, header, sizeof(header) - 1);
+	SocketSend(client, _metricsBuffer, _metricsLength);
+}
+
+static void _metricsPoll(struct HeadlessMetrics* metrics) {
+	if (SOCKET_FAILED(metrics->server)) {
+		return;
+	}
+	uint64_t now = _wallClock();
+	if (now - metrics->windowStart >= 1000000000) {
+		uint64_t cpu = _cpuClock();
+		uint32_t frame = core->frameCounter(core);
+		uint32_t frames = frame - metrics->windowFrame;
+		metrics->fps = frames * 1e9 / (now - metrics->windowStart);
+		metrics->cpuPerFrame = frames ? (cpu - metrics->windowCpu) / 1e9 / frames : 0;
+		metrics->windowStart = now;
+		metrics->windowCpu = cpu;
+		metrics->windowFrame = frame;
+	}
+
+	Socket client = SocketAccept(metrics->server, NULL);
+	if (SOCKET_FAILED(client)) {
+		return;
+	}
+	// The request itself doesn't matter, as every path gets the metrics, but it has to be
+	// read before closing, or the connection may be reset before the response arrives
+	char request[1024];
+	Socket reads[] = { client };
+	SocketSetBlocking(client, true);
+	if (SocketPoll(1, reads, NULL, NULL, 100) > 0) {
+		SocketRecv(client, request, sizeof(request));
+		_metricsWrite(metrics, client);
+	}
+	SocketClose(client);
+}
+
+static void _controlSetVideoBuffer(struct HeadlessControl* control) {
+	// Without a buffer, the core skips rendering entirely, so this has to be set up
+	// before the core is reset
+	unsigned width, height;
+	core->baseVideoSize(core, &width, &height);
+	control->videoBuffer = calloc(width * height, BYTES_PER_PIXEL);
+	core->setVideoBuffer(core, control->videoBuffer, width);
+}
+
+static bool _controlInit(struct HeadlessControl* control, int port, const char* shmPath) {
+	if (shmPath) {
+		control->shm = VFileOpen(shmPath, O_RDWR);
+		if (!control->shm) {
+			return false;
+		}
+		control->shmSize = control->shm->size(control->shm);
+		control->shmData = control->shm->map(control->shm, control->shmSize, MAP_WRITE);
+		if (!control->shmData) {
+			control->shm->close(control->shm);
+			control->shm = NULL;
+			return false;
+		}
+	}
+
+	// The controller is trusted with the game, so it has to be on this machine
+	struct Address loopback = {
+		.version = IPV4,
+		.ipv4 = 0x7F000001,
+	};
+	SocketSubsystemInit();
+	control->server = SocketOpenTCP(port, &loopback);
+	if (SOCKET_FAILED(control->server)) {
+		SocketSubsystemDeinit();
+		return false;
+	}
+	if (SOCKET_FAILED(SocketListen(control->server, 1))) {
+		SocketClose(control->server);
+		control->server = INVALID_SOCKET;
+		SocketSubsystemDeinit();
+		return false;
+	}
+#ifndef _WIN32
+	signal(SIGPIPE, SIG_IGN);
+#endif
+	return true;
+}
+
+static void _controlDeinit(struct HeadlessControl* control) {
+	if (!SOCKET_FAILED(control->server)) {
+		SocketClose(control->server);
+		control->server = INVALID_SOCKET;
+		SocketSubsystemDeinit();
+	}
+	if (control->shm) {
+		control->shm->unmap(control->shm, control->shmData, control->shmSize);
+		control->shm->close(control->shm);
+		control->shm = NULL;
+	}
+	if (control->videoBuffer) {
+		core->setVideoBuffer(core, NULL, 0);
+		free(control->videoBuffer);
+		control->videoBuffer = NULL;
+	}
+	free(control->payload);
+	control->payload = NULL;
+}
+
+static bool _controlRecv(Socket socket, void* buffer, size_t size) {
+	uint8_t* bytes = buffer;
+	while (size) {
+		ssize_t received = SocketRecv(socket, bytes, size);
+		if (received <= 0) {
+			return false;
+		}
+		bytes += received;
+		size -= received;
+	}
+	return true;
+}
+
+static bool _controlSend(Socket socket, const void* buffer, size_t size) {
+	const uint8_t* bytes = buffer;
+	while (size) {
+		ssize_t sent = SocketSend(socket, bytes, size);
+		if (sent <= 0) {
+			return false;
+		}
+		bytes += sent;
+		size -= sent;
+	}
+	return true;
+}
+
+static bool _controlHandle(struct HeadlessControl* control, Socket client, struct HeadlessMetrics* metrics) {
+	uint8_t header[16];
+	uint8_t ranges[CONTROL_MAX_RANGES * 8];
+	uint8_t response[20];
+	uint32_t frames;
+	uint32_t keys;
+	uint32_t flags;
+	uint32_t nRanges;
+	if (!_controlRecv(client, header, sizeof(header))) {
+		return false;
+	}
+	LOAD_32LE(frames, 0, header);
+	LOAD_32LE(keys, 4, header);
+	LOAD_32LE(flags, 8, header);
+	LOAD_32LE(nRanges, 12, header);
+
+	enum HeadlessControlStatus status = CONTROL_OK;
+	if (nRanges > CONTROL_MAX_RANGES) {
+		// There's no way to skip over the rest of the request, so give up on this controller
+		STORE_32LE(CONTROL_BAD_REQUEST, 0, response);
+		memset(&response[4], 0, sizeof(response) - 4);
+		_controlSend(client, response, sizeof(response));
+		return false;
+	}
+	if (!_controlRecv(client, ranges, nRanges * 8)) {
+		return false;
+	}
+
+	unsigned width = 0;
+	unsigned height = 0;
+	size_t payloadSize = 0;
+	size_t i;
+	for (i = 0; i < nRanges; ++i) {
+		uint32_t size;
+		LOAD_32LE(size, i * 8 + 4, ranges);
+		payloadSize += size;
+		if (payloadSize > CONTROL_MAX_PAYLOAD) {
+			status = CONTROL_BAD_REQUEST;
+		}
+	}
+
+	core->setKeys(core, keys);
+	for (i = 0; i < frames && !_dispatchExiting; ++i) {
+		core->runFrame(core);
+		_metricsPoll(metrics);
+	}
+
+	if (flags & CONTROL_FRAMEBUFFER) {
+		core->currentVideoSize(core, &width, &height);
+		payloadSize += width * height * BYTES_PER_PIXEL;
+	}
+
+	uint8_t* payload = NULL;
+	if (status != CONTROL_OK) {
+		payloadSize = 0;
+	} else if (control->shm) {
+		if (payloadSize > control->shmSize) {
+			status = CONTROL_SHM_TOO_SMALL;
+			payloadSize = 0;
+		} else {
+			payload = control->shmData;
+		}
+	} else {
+		if (payloadSize > control->payloadCapacity) {
+			free(control->payload);
+			control->payload = malloc(payloadSize);
+			control->payloadCapacity = payloadSize;
+		}
+		payload = control->payload;
+	}
+
+	if (payload) {
+		uint8_t* out = payload;
+		for (i = 0; i < nRanges; ++i) {
+			uint32_t address;
+			uint32_t size;
+			uint32_t j;
+			LOAD_32LE(address, i * 8, ranges);
+			LOAD_32LE(size, i * 8 + 4, ranges);
+			for (j = 0; j < size; ++j) {
+				out[j] = core->rawRead8(core, address + j, -1);
+			}
+			out += size;
+		}
+		if (flags & CONTROL_FRAMEBUFFER) {
+			const void* pixels;
+			size_t stride;
+			core->getPixels(core, &pixels, &stride);
+			unsigned y;
+			for (y = 0; y < height; ++y) {
+				memcpy(out, (const uint8_t*) pixels + y * stride * BYTES_PER_PIXEL, width * BYTES_PER_PIXEL);
+				out += width * BYTES_PER_PIXEL;
+			}
+		}
+	}
+
+	STORE_32LE(status, 0, response);
+	STORE_32LE(core->frameCounter(core), 4, response);
+	STORE_32LE(width, 8, response);
+	STORE_32LE(height, 12, response);
+	STORE_32LE(payloadSize, 16, response);
+	if (!_controlSend(client, response, sizeof(response))) {
+		return false;
+	}
+	if (payload && !control->shm && !_controlSend(client, payload, payloadSize)) {
+		return false;
+	}
+	return true;
+}
+
+static void _controlRun(struct HeadlessControl* control, struct HeadlessMetrics* metrics) {
+	Socket client = INVALID_SOCKET;
+	while (!_dispatchExiting) {
+		// Poll rather than block in accept, so that an interrupt can still get through
+		Socket reads[] = { control->server };
+		if (SocketPoll(1, reads, NULL, NULL, 100) > 0) {
+			client = SocketAccept(control->server, NULL);
+			if (!SOCKET_FAILED(client)) {
+				break;
+			}
+		}
+		_metricsPoll(metrics);
+	}
+	if (SOCKET_FAILED(client)) {
+		return;
+	}
+	SocketSetTCPPush(client, 1);
+	while (!_dispatchExiting) {
+		if (!_controlHandle(control, client, metrics)) {
+			break;
+		}
+	}
+	SocketClose(client);
+}
+
 static bool _parseHeadlessOpts(struct mSubParser* parser, int option, const char* arg) {
 	struct HeadlessOpts* opts = parser->opts;
 	errno = 0;
@@ -365,6 +910,36 @@ static bool _parseLongHeadlessOpts(struct mSubParser* parser, const char* option
 		*StringListAppend(&opts->scripts) = strdup(arg);
 		return true;
 	}
+	if (strcmp(option, "metrics-port") == 0) {
+		char* parseEnd;
+		errno = 0;
+		long port = strtol(arg, &parseEnd, 10);
+		if (errno || port < 0 || port > UINT16_MAX || *parseEnd) {
+			return false;
+		}
+		opts->metricsPort = port;
+		return true;
+	}
+	if (strcmp(option, "control") == 0) {
+		char* parseEnd;
+		errno = 0;
+		long port = strtol(arg, &parseEnd, 10);
+		if (errno || port < 0 || port > UINT16_MAX || *parseEnd) {
+			return false;
+		}
+		opts->controlPort = port;
+		return true;
+	}
+	if (strcmp(option, "control-shm") == 0) {
+		free(opts->controlShm);
+		opts->controlShm = strdup(arg);
+		return true;
+	}
+	if (strcmp(option, "movie") == 0) {
+		free(opts->movie);
+		opts->movie = strdup(arg);
+		return true;
+	}
 	return false;
 }
 
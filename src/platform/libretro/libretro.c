@@ -39,6 +39,13 @@
 #define VIDEO_HEIGHT_MAX 224
 #define VIDEO_BUFF_SIZE  (VIDEO_WIDTH_MAX * VIDEO_HEIGHT_MAX * sizeof(mColor))
 
+/* Fast savestates, as used by run-ahead, are a small
+ * header followed by the core's own state and then
+ * the savedata. The header holds a magic number and
+ * how much of the savedata follows. */
+#define FAST_STATE_MAGIC       0x5346626D
+#define FAST_STATE_HEADER_SIZE 8
+
 static retro_environment_t environCallback;
 static retro_video_refresh_t videoCallback;
 static retro_audio_sample_batch_t audioCallback;
@@ -67,6 +74,12 @@ static int32_t _readGyroZ(struct mRotationSource* source);
 
 static struct mCore* core;
 static mColor* outputBuffer = NULL;
+static mColor* videoBuffer = NULL;
+static size_t videoBufferStride;
+static enum retro_pixel_format pixelFormat;
+static bool renderSkipped;
+static bool audioSkipped;
+static int frameskip;
 static int16_t *audioSampleBuffer = NULL;
 static size_t audioSampleBufferSize;
 static float audioSamplesPerFrameAvg;
@@ -314,6 +327,7 @@ static void _reloadSettings(void) {
 	if (environCallback(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value) {
 		opts.frameskip = strtol(var.value, NULL, 10);
 	}
+	frameskip = opts.frameskip;
 
 	_loadAudioLowPassFilterSettings();
 
@@ -428,19 +442,18 @@ void retro_get_system_av_info(struct retro_system_av_info* info) {
 }
 
 void retro_init(void) {
-	enum retro_pixel_format fmt;
 #ifdef COLOR_16_BIT
 #ifdef COLOR_5_6_5
-	fmt = RETRO_PIXEL_FORMAT_RGB565;
+	pixelFormat = RETRO_PIXEL_FORMAT_RGB565;
 #else
 #warning This pixel format is unsupported. Please use -DCOLOR_16-BIT -DCOLOR_5_6_5
-	fmt = RETRO_PIXEL_FORMAT_0RGB1555;
+	pixelFormat = RETRO_PIXEL_FORMAT_0RGB1555;
 #endif
 #else
 #warning This pixel format is unsupported. Please use -DCOLOR_16-BIT -DCOLOR_5_6_5
-	fmt = RETRO_PIXEL_FORMAT_XRGB8888;
+	pixelFormat = RETRO_PIXEL_FORMAT_XRGB8888;
 #endif
-	environCallback(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &fmt);
+	environCallback(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &pixelFormat);
 
 	struct retro_input_descriptor inputDescriptors[] = {
 		{ 0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_A, "A" },
@@ -538,6 +551,39 @@ void retro_deinit(void) {
 	audioLowPassRightPrev = 0;
 }
 
+static void _updateVideoBuffer(bool videoEnabled) {
+#ifdef M_CORE_GBA
+	/* Drawing straight into the frontend's framebuffer
+	 * saves it a copy. The framebuffer is only valid
+	 * until retro_run() returns and its contents are
+	 * unspecified, so it has to be drawn in full: the
+	 * GBA renderer redraws every line whenever it is
+	 * handed a buffer, but frames skipped by frameskip
+	 * wouldn't be drawn at all. */
+	if (videoEnabled && !frameskip && core->platform(core) == mPLATFORM_GBA) {
+		unsigned width, height;
+		core->currentVideoSize(core, &width, &height);
+		struct retro_framebuffer fb = {
+			.width = width,
+			.height = height,
+			.access_flags = RETRO_MEMORY_ACCESS_WRITE
+		};
+		if (environCallback(RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER, &fb) && fb.data &&
+		    fb.format == pixelFormat && !(fb.pitch % BYTES_PER_PIXEL) && fb.pitch >= width * BYTES_PER_PIXEL) {
+			videoBuffer = fb.data;
+			videoBufferStride = fb.pitch / BYTES_PER_PIXEL;
+			core->setVideoBuffer(core, videoBuffer, videoBufferStride);
+			return;
+		}
+	}
+#endif
+	if (videoBuffer != outputBuffer) {
+		videoBuffer = outputBuffer;
+		videoBufferStride = VIDEO_WIDTH_MAX;
+		core->setVideoBuffer(core, videoBuffer, videoBufferStride);
+	}
+}
+
 void retro_run(void) {
 	if (deferredSetup) {
 		_doDeferredSetup();
@@ -563,7 +609,8 @@ void retro_run(void) {
 		var.key = "mgba_frameskip";
 		var.value = 0;
 		if (environCallback(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value) {
-			mCoreConfigSetIntValue(&core->config, "frameskip", strtol(var.value, NULL, 10));
+			frameskip = strtol(var.value, NULL, 10);
+			mCoreConfigSetIntValue(&core->config, "frameskip", frameskip);
 			core->reloadConfigOption(core, "frameskip", NULL);
 		}
 
@@ -608,10 +655,29 @@ void retro_run(void) {
 		}
 	}
 
+	/* Run-ahead and preemptive frames tell us when
+	 * their output is going to be thrown away, in
+	 * which case it needn't be rendered or mixed */
+	int avEnable;
+	if (!environCallback(RETRO_ENVIRONMENT_GET_AUDIO_VIDEO_ENABLE, &avEnable)) {
+		avEnable = 3;
+	}
+	bool videoEnabled = avEnable & 1;
+	bool audioEnabled = avEnable & 2;
+	if (renderSkipped == videoEnabled) {
+		renderSkipped = !videoEnabled;
+		core->setRenderSkip(core, renderSkipped);
+	}
+	if (audioSkipped == audioEnabled) {
+		audioSkipped = !audioEnabled;
+		core->setAudioSkip(core, audioSkipped);
+	}
+	_updateVideoBuffer(videoEnabled);
+
 	core->runFrame(core);
 	unsigned width, height;
 	core->currentVideoSize(core, &width, &height);
-	videoCallback(outputBuffer, width, height, BYTES_PER_PIXEL * 256);
+	videoCallback(videoBuffer, width, height, BYTES_PER_PIXEL * videoBufferStride);
 
 #ifdef M_CORE_GBA
 	if (core->platform(core) == mPLATFORM_GBA) {
@@ -833,6 +899,9 @@ static void _setupMaps(struct mCore* core) {
 }
 
 void retro_reset(void) {
+	/* The frontend's framebuffer is gone by now, and
+	 * resetting can draw into the current buffer */
+	_updateVideoBuffer(false);
 	core->reset(core);
 	mRumbleIntegratorReset(&rumble);
 	_setupMaps(core);
@@ -866,7 +935,11 @@ bool retro_load_game(const struct retro_game_info* game) {
 
 	outputBuffer = malloc(VIDEO_BUFF_SIZE);
 	memset(outputBuffer, 0xFF, VIDEO_BUFF_SIZE);
-	core->setVideoBuffer(core, outputBuffer, VIDEO_WIDTH_MAX);
+	videoBuffer = outputBuffer;
+	videoBufferStride = VIDEO_WIDTH_MAX;
+	core->setVideoBuffer(core, videoBuffer, videoBufferStride);
+	renderSkipped = false;
+	audioSkipped = false;
 
 	#ifdef M_CORE_GBA
 	/* GBA emulation produces a fairly regular number
@@ -1002,10 +1075,60 @@ void retro_unload_game(void) {
 	savedata = 0;
 }
 
+static bool _useFastSavestates(void) {
+	int avEnable;
+	return environCallback(RETRO_ENVIRONMENT_GET_AUDIO_VIDEO_ENABLE, &avEnable) && (avEnable & 4);
+}
+
+static size_t _fastSavestateSize(void) {
+	/* The size can't depend on the save type, since
+	 * that may only be detected later on */
+	return FAST_STATE_HEADER_SIZE + core->stateSize(core) + GBA_SIZE_FLASH1M;
+}
+
+static bool _saveFastState(uint8_t* state, size_t size) {
+	if (size < _fastSavestateSize()) {
+		return false;
+	}
+	/* RTC data, if any, comes right after the save RAM */
+	size_t savedataSize = retro_get_memory_size(RETRO_MEMORY_SAVE_RAM) + retro_get_memory_size(RETRO_MEMORY_RTC);
+	if (savedataSize > GBA_SIZE_FLASH1M) {
+		savedataSize = GBA_SIZE_FLASH1M;
+	}
+	size_t stateSize = core->stateSize(core);
+	STORE_32LE(FAST_STATE_MAGIC, 0, state);
+	STORE_32LE(savedataSize, 4, state);
+	core->saveState(core, &state[FAST_STATE_HEADER_SIZE]);
+	memcpy(&state[FAST_STATE_HEADER_SIZE + stateSize], savedata, savedataSize);
+	return true;
+}
+
+static bool _loadFastState(const uint8_t* state, size_t size) {
+	uint32_t magic;
+	uint32_t savedataSize;
+	size_t stateSize = core->stateSize(core);
+	if (size < FAST_STATE_HEADER_SIZE + stateSize) {
+		return false;
+	}
+	LOAD_32LE(magic, 0, state);
+	LOAD_32LE(savedataSize, 4, state);
+	if (magic != FAST_STATE_MAGIC || savedataSize > GBA_SIZE_FLASH1M || size - FAST_STATE_HEADER_SIZE - stateSize < savedataSize) {
+		return false;
+	}
+	if (!core->loadState(core, &state[FAST_STATE_HEADER_SIZE])) {
+		return false;
+	}
+	memcpy(savedata, &state[FAST_STATE_HEADER_SIZE + stateSize], savedataSize);
+	return true;
+}
+
 size_t retro_serialize_size(void) {
 	if (deferredSetup) {
 		_doDeferredSetup();
 	}
+	if (_useFastSavestates()) {
+		return _fastSavestateSize();
+	}
 	struct VFile* vfm = VFileMemChunk(NULL, 0);
 	mCoreSaveStateNamed(core, vfm, SAVESTATE_SAVEDATA | SAVESTATE_RTC);
 	size_t size = vfm->size(vfm);
@@ -1017,6 +1140,9 @@ bool retro_serialize(void* data, size_t size) {
 	if (deferredSetup) {
 		_doDeferredSetup();
 	}
+	if (_useFastSavestates()) {
+		return _saveFastState(data, size);
+	}
 	struct VFile* vfm = VFileMemChunk(NULL, 0);
 	mCoreSaveStateNamed(core, vfm, SAVESTATE_SAVEDATA | SAVESTATE_RTC);
 	if ((ssize_t) size > vfm->size(vfm)) {
@@ -1035,6 +1161,13 @@ bool retro_unserialize(const void* data, size_t size) {
 	if (deferredSetup) {
 		_doDeferredSetup();
 	}
+	if (size >= FAST_STATE_HEADER_SIZE) {
+		uint32_t magic;
+		LOAD_32LE(magic, 0, data);
+		if (magic == FAST_STATE_MAGIC) {
+			return _loadFastState(data, size);
+		}
+	}
 	struct VFile* vfm = VFileFromConstMemory(data, size);
 	bool success = mCoreLoadStateNamed(core, vfm, SAVESTATE_RTC);
 	vfm->close(vfm);
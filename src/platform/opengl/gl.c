@@ -5,6 +5,7 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include "gl.h"
 
+#include <mgba-util/image.h>
 #include <mgba-util/math.h>
 
 static const GLint _glVertices[] = {
@@ -29,6 +30,20 @@ static inline void _initTex(void) {
 #endif
 }
 
+static void _uploadTex(int x, int y, int width, int height, const void* frame) {
+#ifdef COLOR_16_BIT
+#ifdef COLOR_5_6_5
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, frame);
+#else
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_RGBA, GL_UNSIGNED_SHORT_1_5_5_5_REV, frame);
+#endif
+#elif defined(__BIG_ENDIAN__)
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8_REV, frame);
+#else
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, frame);
+#endif
+}
+
 static void mGLContextInit(struct VideoBackend* v, WHandle handle) {
 	UNUSED(handle);
 	struct mGLContext* context = (struct mGLContext*) v;
@@ -276,17 +291,36 @@ void mGLContextPostFrame(struct VideoBackend* v, enum VideoLayer layer, const vo
 		width = context->layerDims[layer].width;
 		height = context->layerDims[layer].height;
 	}
-#ifdef COLOR_16_BIT
-#ifdef COLOR_5_6_5
-	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, frame);
-#else
-	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_SHORT_1_5_5_5_REV, frame);
-#endif
-#elif defined(__BIG_ENDIAN__)
-	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8_REV, frame);
-#else
-	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, frame);
-#endif
+	_uploadTex(0, 0, width, height, frame);
+}
+
+static void mGLContextPostFrameRect(struct VideoBackend* v, enum VideoLayer layer, const struct mRectangle* rect, const void* frame) {
+	struct mGLContext* context = (struct mGLContext*) v;
+	if (layer >= VIDEO_LAYER_MAX) {
+		return;
+	}
+	if (layer == VIDEO_LAYER_IMAGE) {
+		// The image is double-buffered, so the other texture doesn't have the rest of it
+		mGLContextPostFrame(v, layer, frame);
+		return;
+	}
+
+	int width = context->imageSizes[layer].width;
+	int height = context->imageSizes[layer].height;
+
+	if (width <= 0 || height <= 0) {
+		width = context->layerDims[layer].width;
+		height = context->layerDims[layer].height;
+	}
+	struct mRectangle dirty = { .width = width, .height = height };
+	if (!mRectangleIntersection(&dirty, rect)) {
+		return;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, context->layers[layer]);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+	_uploadTex(dirty.x, dirty.y, dirty.width, dirty.height, (const uint8_t*) frame + (dirty.y * width + dirty.x) * BYTES_PER_PIXEL);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
 }
 
 void mGLContextCreate(struct mGLContext* context) {
@@ -300,5 +334,6 @@ void mGLContextCreate(struct mGLContext* context) {
 	context->d.setImageSize = mGLContextSetImageSize;
 	context->d.imageSize = mGLContextImageSize;
 	context->d.setImage = mGLContextPostFrame;
+	context->d.setImageRect = mGLContextPostFrameRect;
 	context->d.drawFrame = mGLContextDrawFrame;
 }
@@ -8,6 +8,7 @@
 #include <mgba/core/log.h>
 #include <mgba-util/configuration.h>
 #include <mgba-util/formatting.h>
+#include <mgba-util/image.h>
 #include <mgba-util/math.h>
 #include <mgba-util/vector.h>
 #include <mgba-util/vfs.h>
@@ -120,6 +121,8 @@ static void mGLES2ContextInit(struct VideoBackend* v, WHandle handle) {
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 		context->imageSizes[i].width = -1;
 		context->imageSizes[i].height = -1;
+		context->texSizes[i].width = 0;
+		context->texSizes[i].height = 0;
 	}
 	context->width = 1;
 	context->height = 1;
@@ -201,7 +204,9 @@ static void mGLES2ContextInit(struct VideoBackend* v, WHandle handle) {
 	context->finalShader.tex = 0;
 }
 
-static inline void _setTexDims(int width, int height) {
+static inline void _setTexDims(struct mSize* texSize, int width, int height) {
+	texSize->width = width;
+	texSize->height = height;
 #ifdef COLOR_16_BIT
 #ifdef COLOR_5_6_5
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, 0);
@@ -226,7 +231,7 @@ static void mGLES2ContextSetLayerDimensions(struct VideoBackend* v, enum VideoLa
 
 		glBindTexture(GL_TEXTURE_2D, context->tex[layer]);
 		if (context->imageSizes[layer].width <= 0 || context->imageSizes[layer].height <= 0) {
-			_setTexDims(dims->width, dims->height);
+			_setTexDims(&context->texSizes[layer], dims->width, dims->height);
 		}
 	}
 
@@ -269,6 +274,15 @@ static void mGLES2ContextDeinit(struct VideoBackend* v) {
 	context->overlayShader.fbo = 0;
 	mGLES2ShaderDeinit(&context->overlayShader);
 	free(context->initialShader.uniforms);
+	size_t i;
+	for (i = 0; i < mGLES2_MAX_FRAMEBUFFERS; ++i) {
+		struct mGLES2Framebuffer* framebuffer = &context->framebuffers[i];
+		if (framebuffer->fbo) {
+			glDeleteFramebuffers(1, &framebuffer->fbo);
+			glDeleteTextures(1, &framebuffer->tex);
+		}
+		memset(framebuffer, 0, sizeof(*framebuffer));
+	}
 }
 
 static void mGLES2ContextResized(struct VideoBackend* v, unsigned w, unsigned h, unsigned maxW, unsigned maxH) {
@@ -315,9 +329,65 @@ static void mGLES2ContextClear(struct VideoBackend* v) {
 	glClear(GL_COLOR_BUFFER_BIT);
 }
 
-static void _drawShaderEx(struct mGLES2Context* context, struct mGLES2Shader* shader, int layer) {
-	GLint viewport[4];
-	glGetIntegerv(GL_VIEWPORT, viewport);
+static void _allocateTexture(enum mGLES2Format format, int width, int height) {
+	switch (format) {
+	case mGLES2_FORMAT_RGB565:
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, 0);
+		break;
+#if defined(GL_RGBA16F) && defined(GL_HALF_FLOAT)
+	case mGLES2_FORMAT_RGBA16F:
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_HALF_FLOAT, 0);
+		break;
+#endif
+	default:
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, 0);
+		break;
+	}
+}
+
+// Finds a shared framebuffer to draw a pass into, other than the one holding its input,
+// replacing whichever went unused the longest if none match
+static struct mGLES2Framebuffer* _acquireFramebuffer(struct mGLES2Context* context, int width, int height, enum mGLES2Format format, GLuint input) {
+	struct mGLES2Framebuffer* spare = NULL;
+	size_t i;
+	for (i = 0; i < mGLES2_MAX_FRAMEBUFFERS; ++i) {
+		struct mGLES2Framebuffer* framebuffer = &context->framebuffers[i];
+		if (framebuffer->fbo && framebuffer->tex == input) {
+			continue;
+		}
+		if (framebuffer->fbo && framebuffer->width == width && framebuffer->height == height && framebuffer->format == format) {
+			framebuffer->lastUsed = context->frameCounter;
+			return framebuffer;
+		}
+		if (!spare || (spare->fbo && (!framebuffer->fbo || framebuffer->lastUsed < spare->lastUsed))) {
+			spare = framebuffer;
+		}
+	}
+	if (!spare->fbo) {
+		glGenFramebuffers(1, &spare->fbo);
+		glGenTextures(1, &spare->tex);
+		glBindTexture(GL_TEXTURE_2D, spare->tex);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	} else {
+		glBindTexture(GL_TEXTURE_2D, spare->tex);
+	}
+	_allocateTexture(format, width, height);
+	glBindFramebuffer(GL_FRAMEBUFFER, spare->fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, spare->tex, 0);
+	if (format != mGLES2_FORMAT_RGB8 && glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		mLOG(OPENGL, WARN, "Shader pass format %i is not supported, falling back to RGB8", format);
+		_allocateTexture(mGLES2_FORMAT_RGB8, width, height);
+	}
+	glBindTexture(GL_TEXTURE_2D, input);
+	spare->width = width;
+	spare->height = height;
+	spare->format = format;
+	spare->lastUsed = context->frameCounter;
+	return spare;
+}
+
+static void _shaderSize(const struct mGLES2Context* context, const struct mGLES2Shader* shader, const GLint* viewport, int* width, int* height, int* padWidth, int* padHeight) {
 	int drawW = shader->width;
 	int drawH = shader->height;
 	int padW = 0;
@@ -340,6 +410,20 @@ static void _drawShaderEx(struct mGLES2Context* context, struct mGLES2Shader* sh
 		drawW -= drawW % context->width;
 		drawH -= drawH % context->height;
 	}
+	*width = drawW;
+	*height = drawH;
+	*padWidth = padW;
+	*padHeight = padH;
+}
+
+static void _drawShaderTo(struct mGLES2Context* context, struct mGLES2Shader* shader, int layer, GLuint fbo, GLuint tex) {
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	int drawW;
+	int drawH;
+	int padW;
+	int padH;
+	_shaderSize(context, shader, viewport, &drawW, &drawH, &padW, &padH);
 
 	if (shader->dirty) {
 		if (shader->tex && (shader->width <= 0 || shader->height <= 0)) {
@@ -358,7 +442,7 @@ static void _drawShaderEx(struct mGLES2Context* context, struct mGLES2Shader* sh
 		glViewport(padW, padH, drawW, drawH);
 	}
 
-	glBindFramebuffer(GL_FRAMEBUFFER, shader->fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
 	if (shader->blend) {
 		glEnable(GL_BLEND);
 		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -438,7 +522,11 @@ static void _drawShaderEx(struct mGLES2Context* context, struct mGLES2Shader* sh
 		}
 	}
 	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
-	glBindTexture(GL_TEXTURE_2D, shader->tex);
+	glBindTexture(GL_TEXTURE_2D, tex);
+}
+
+static void _drawShaderEx(struct mGLES2Context* context, struct mGLES2Shader* shader, int layer) {
+	_drawShaderTo(context, shader, layer, shader->fbo, shader->tex);
 }
 
 static void _drawShader(struct mGLES2Context* context, struct mGLES2Shader* shader) {
@@ -476,13 +564,49 @@ void mGLES2ContextDrawFrame(struct VideoBackend* v) {
 		}
 	}
 
+	// The first pass reads the image at its native size
+	GLint input;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &input);
+	int inputW = context->width;
+	int inputH = context->height;
+	bool drawnFinal = false;
+	++context->frameCounter;
+	const GLint passViewport[4] = { 0, 0, viewport[2], viewport[3] };
 	size_t n;
 	for (n = 0; n < context->nShaders; ++n) {
+		struct mGLES2Shader* shader = &context->shaders[n];
 		glViewport(0, 0, viewport[2], viewport[3]);
-		_drawShader(context, &context->shaders[n]);
+		int drawW;
+		int drawH;
+		int padW;
+		int padH;
+		_shaderSize(context, shader, passViewport, &drawW, &drawH, &padW, &padH);
+		if (shader->passthrough && !shader->blend && !padW && !padH && drawW == inputW && drawH == inputH) {
+			// Copying the input as-is wouldn't change anything
+			continue;
+		}
+		if (n == context->nShaders - 1 && !shader->width && !shader->height && !shader->blend && !shader->integerScaling) {
+			// The last pass is already the size of the output, so it can skip the copy there
+			glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+			_drawShaderTo(context, shader, -1, context->finalShader.fbo, 0);
+			drawnFinal = true;
+			break;
+		}
+		if (shader->pooled) {
+			struct mGLES2Framebuffer* framebuffer = _acquireFramebuffer(context, drawW + padW * 2, drawH + padH * 2, shader->format, input);
+			_drawShaderTo(context, shader, -1, framebuffer->fbo, framebuffer->tex);
+			input = framebuffer->tex;
+		} else {
+			_drawShader(context, shader);
+			input = shader->tex;
+		}
+		inputW = drawW + padW * 2;
+		inputH = drawH + padH * 2;
 	}
 	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
-	_drawShader(context, &context->finalShader);
+	if (!drawnFinal) {
+		_drawShader(context, &context->finalShader);
+	}
 	if (v->interframeBlending) {
 		context->interframeShader.blend = false;
 		glBindTexture(GL_TEXTURE_2D, context->tex[VIDEO_LAYER_IMAGE]);
@@ -515,7 +639,7 @@ static void mGLES2ContextSetImageSize(struct VideoBackend* v, enum VideoLayer la
 		context->imageSizes[layer].width = width;
 		context->imageSizes[layer].height = height;
 	}
-	_setTexDims(width, height);
+	_setTexDims(&context->texSizes[layer], width, height);
 }
 
 static void mGLES2ContextImageSize(struct VideoBackend* v, enum VideoLayer layer, int* width, int* height) {
@@ -533,6 +657,20 @@ static void mGLES2ContextImageSize(struct VideoBackend* v, enum VideoLayer layer
 	}
 }
 
+static void _uploadTex(int x, int y, int width, int height, const void* frame) {
+#ifdef COLOR_16_BIT
+#ifdef COLOR_5_6_5
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, frame);
+#else
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_RGBA, GL_UNSIGNED_SHORT_1_5_5_5_REV, frame);
+#endif
+#elif defined(__BIG_ENDIAN__)
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8_REV, frame);
+#else
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, frame);
+#endif
+}
+
 void mGLES2ContextPostFrame(struct VideoBackend* v, enum VideoLayer layer, const void* frame) {
 	struct mGLES2Context* context = (struct mGLES2Context*) v;
 	if (layer >= VIDEO_LAYER_MAX) {
@@ -547,16 +685,45 @@ void mGLES2ContextPostFrame(struct VideoBackend* v, enum VideoLayer layer, const
 		height = context->layerDims[layer].height;
 	}
 	glBindTexture(GL_TEXTURE_2D, context->tex[layer]);
-#ifdef COLOR_16_BIT
-#ifdef COLOR_5_6_5
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, frame);
-#else
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_SHORT_1_5_5_5_REV, frame);
-#endif
-#elif defined(__BIG_ENDIAN__)
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8_REV, frame);
+	if (width != context->texSizes[layer].width || height != context->texSizes[layer].height) {
+		_setTexDims(&context->texSizes[layer], width, height);
+	}
+	// Updating the existing storage in place avoids having the driver reallocate
+	// (or orphan and copy) the texture every frame
+	_uploadTex(0, 0, width, height, frame);
+}
+
+static void mGLES2ContextPostFrameRect(struct VideoBackend* v, enum VideoLayer layer, const struct mRectangle* rect, const void* frame) {
+	struct mGLES2Context* context = (struct mGLES2Context*) v;
+	if (layer >= VIDEO_LAYER_MAX) {
+		return;
+	}
+
+	int width = context->imageSizes[layer].width;
+	int height = context->imageSizes[layer].height;
+
+	if (width <= 0 || height <= 0) {
+		width = context->layerDims[layer].width;
+		height = context->layerDims[layer].height;
+	}
+	if (width != context->texSizes[layer].width || height != context->texSizes[layer].height) {
+		// The texture has to be reallocated, so the whole image is needed anyway
+		mGLES2ContextPostFrame(v, layer, frame);
+		return;
+	}
+	struct mRectangle dirty = { .width = width, .height = height };
+	if (!mRectangleIntersection(&dirty, rect)) {
+		return;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, context->tex[layer]);
+#ifdef GL_UNPACK_ROW_LENGTH
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+	_uploadTex(dirty.x, dirty.y, dirty.width, dirty.height, (const uint8_t*) frame + (dirty.y * width + dirty.x) * BYTES_PER_PIXEL);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
 #else
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, frame);
+	// Without a row length, only whole rows can be uploaded from the middle of the image
+	_uploadTex(0, dirty.y, width, dirty.height, (const uint8_t*) frame + dirty.y * width * BYTES_PER_PIXEL);
 #endif
 }
 
@@ -571,9 +738,12 @@ void mGLES2ContextCreate(struct mGLES2Context* context) {
 	context->d.setImageSize = mGLES2ContextSetImageSize;
 	context->d.imageSize = mGLES2ContextImageSize;
 	context->d.setImage = mGLES2ContextPostFrame;
+	context->d.setImageRect = mGLES2ContextPostFrameRect;
 	context->d.drawFrame = mGLES2ContextDrawFrame;
 	context->shaders = 0;
 	context->nShaders = 0;
+	memset(context->framebuffers, 0, sizeof(context->framebuffers));
+	context->frameCounter = 0;
 }
 
 void mGLES2ContextUseFramebuffer(struct mGLES2Context* context) {
@@ -603,6 +773,9 @@ void mGLES2ShaderInit(struct mGLES2Shader* shader, const char* vs, const char* f
 	shader->filter = false;
 	shader->blend = false;
 	shader->dirty = true;
+	shader->passthrough = !vs && !fs;
+	shader->pooled = false;
+	shader->format = mGLES2_FORMAT_RGB8;
 	shader->uniforms = uniforms;
 	shader->nUniforms = nUniforms;
 	glGenFramebuffers(1, &shader->fbo);
@@ -722,9 +895,20 @@ void mGLES2ShaderAttach(struct mGLES2Context* context, struct mGLES2Shader* shad
 	context->nShaders = nShaders;
 	size_t i;
 	for (i = 0; i < nShaders; ++i) {
-		glBindFramebuffer(GL_FRAMEBUFFER, context->shaders[i].fbo);
-		glClearColor(0.f, 0.f, 0.f, 1.f);
-		glClear(GL_COLOR_BUFFER_BIT);
+		if (!context->shaders[i].blend) {
+			// Passes that don't blend over their last output don't need to keep it around
+			context->shaders[i].pooled = true;
+			if (context->shaders[i].fbo) {
+				glDeleteFramebuffers(1, &context->shaders[i].fbo);
+				glDeleteTextures(1, &context->shaders[i].tex);
+				context->shaders[i].fbo = 0;
+				context->shaders[i].tex = 0;
+			}
+		} else {
+			glBindFramebuffer(GL_FRAMEBUFFER, context->shaders[i].fbo);
+			glClearColor(0.f, 0.f, 0.f, 1.f);
+			glClear(GL_COLOR_BUFFER_BIT);
+		}
 
 #ifdef BUILD_GLES3
 		if (context->shaders[i].vao != (GLuint) -1) {
@@ -1174,6 +1358,12 @@ bool mGLES2ShaderLoad(struct VideoShader* shader, struct VDir* dir) {
 				if (b) {
 					shaderBlock[n].filter = b;
 				}
+				const char* format = ConfigurationGetValue(&description, passName, "format");
+				if (format && !strcmp(format, "rgb565")) {
+					shaderBlock[n].format = mGLES2_FORMAT_RGB565;
+				} else if (format && !strcmp(format, "rgba16f")) {
+					shaderBlock[n].format = mGLES2_FORMAT_RGBA16F;
+				}
 				free(fssrc);
 				free(vssrc);
 			}
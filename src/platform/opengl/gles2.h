@@ -54,6 +54,26 @@ struct mGLES2Uniform {
 	const char* readableName;
 };
 
+// Intermediate formats a pass that doesn't blend can ask for in its manifest, if it doesn't
+// need full precision (or needs more range). Formats the GPU can't render to fall back to RGB8.
+enum mGLES2Format {
+	mGLES2_FORMAT_RGB8 = 0,
+	mGLES2_FORMAT_RGB565,
+	mGLES2_FORMAT_RGBA16F,
+};
+
+// Enough for every pass of the longest shader, plus the one being read from
+#define mGLES2_MAX_FRAMEBUFFERS 9
+
+struct mGLES2Framebuffer {
+	GLuint fbo;
+	GLuint tex;
+	int width;
+	int height;
+	enum mGLES2Format format;
+	unsigned lastUsed;
+};
+
 struct mGLES2Shader {
 	int width;
 	int height;
@@ -61,6 +81,12 @@ struct mGLES2Shader {
 	bool filter;
 	bool blend;
 	bool dirty;
+	// Passes without a shader of their own just copy their input
+	bool passthrough;
+	// Set on attached passes that don't blend, and so don't need to keep their output from the
+	// last frame: these draw into framebuffers shared between passes instead of their own
+	bool pooled;
+	enum mGLES2Format format;
 	GLuint tex;
 	GLuint fbo;
 	GLuint vao;
@@ -84,6 +110,7 @@ struct mGLES2Context {
 
 	struct mRectangle layerDims[VIDEO_LAYER_MAX];
 	struct mSize imageSizes[VIDEO_LAYER_MAX];
+	struct mSize texSizes[VIDEO_LAYER_MAX];
 	int x;
 	int y;
 	int width;
@@ -96,6 +123,9 @@ struct mGLES2Context {
 
 	struct mGLES2Shader* shaders;
 	size_t nShaders;
+
+	struct mGLES2Framebuffer framebuffers[mGLES2_MAX_FRAMEBUFFERS];
+	unsigned frameCounter;
 };
 
 void mGLES2ContextCreate(struct mGLES2Context*);
@@ -5,6 +5,10 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba-util/memory.h>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
 #ifndef DISABLE_ANON_MMAP
 #ifdef __SANITIZE_ADDRESS__
 #define DISABLE_ANON_MMAP
@@ -16,8 +20,6 @@
 #endif
 
 #ifndef DISABLE_ANON_MMAP
-#include <sys/mman.h>
-
 void* anonymousMemoryMap(size_t size) {
 	return mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
 }
@@ -25,6 +27,110 @@ void* anonymousMemoryMap(size_t size) {
 void mappedMemoryFree(void* memory, size_t size) {
 	munmap(memory, size);
 }
+
+#ifdef MADV_HUGEPAGE
+#define HUGE_PAGE_SIZE 0x200000
+
+void* hugeMemoryMap(size_t size) {
+	size = (size + HUGE_PAGE_SIZE - 1) & ~(size_t) (HUGE_PAGE_SIZE - 1);
+	// Transparent huge pages need the region to be aligned, so map an extra huge page
+	// and trim off whatever isn't needed on either side
+	uint8_t* mapping = mmap(0, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+	if (mapping == MAP_FAILED) {
+		return NULL;
+	}
+	uint8_t* start = (uint8_t*) (((uintptr_t) mapping + HUGE_PAGE_SIZE - 1) & ~(uintptr_t) (HUGE_PAGE_SIZE - 1));
+	if (start != mapping) {
+		munmap(mapping, start - mapping);
+	}
+	munmap(start + size, mapping + HUGE_PAGE_SIZE - start);
+	madvise(start, size, MADV_HUGEPAGE);
+	return start;
+}
+
+void hugeMemoryFree(void* memory, size_t size) {
+	size = (size + HUGE_PAGE_SIZE - 1) & ~(size_t) (HUGE_PAGE_SIZE - 1);
+	munmap(memory, size);
+}
+#else
+void* hugeMemoryMap(size_t size) {
+	return anonymousMemoryMap(size);
+}
+
+void hugeMemoryFree(void* memory, size_t size) {
+	mappedMemoryFree(memory, size);
+}
+#endif
+
+void mappedMemoryAdvise(void* memory, size_t size, int advice) {
+	// madvise wants a page-aligned start
+	uintptr_t start = (uintptr_t) memory & ~(uintptr_t) 0xFFF;
+	size += (uintptr_t) memory - start;
+#ifdef MADV_HUGEPAGE
+	if (advice & mMEMORY_ADVICE_HUGE_PAGES) {
+		madvise((void*) start, size, MADV_HUGEPAGE);
+	}
+#endif
+	if (advice & mMEMORY_ADVICE_READ_AHEAD) {
+		madvise((void*) start, size, MADV_WILLNEED);
+	}
+	if (advice & mMEMORY_ADVICE_PREFAULT) {
+#ifdef MADV_POPULATE_WRITE
+		if (madvise((void*) start, size, MADV_POPULATE_WRITE) == 0) {
+			return;
+		}
+#endif
+		// Older kernels don't know MADV_POPULATE_WRITE, so touch each page instead
+		volatile uint8_t* bytes = memory;
+		size_t i;
+		for (i = 0; i < size; i += 0x1000) {
+			bytes[i] = bytes[i];
+		}
+	}
+}
+
+size_t mappedMemoryResident(const void* memory, size_t size) {
+	if (!memory || !size) {
+		return 0;
+	}
+	long pageSize = sysconf(_SC_PAGESIZE);
+	if (pageSize <= 0) {
+		return size;
+	}
+	uintptr_t start = (uintptr_t) memory & ~(uintptr_t) (pageSize - 1);
+	uintptr_t end = (uintptr_t) memory + size;
+	size_t nPages = (end - start + pageSize - 1) / pageSize;
+	unsigned char vec[256];
+	size_t resident = 0;
+	size_t page;
+	// Check a chunk of pages at a time so the vector can stay on the stack
+	for (page = 0; page < nPages; page += sizeof(vec)) {
+		size_t chunk = nPages - page;
+		if (chunk > sizeof(vec)) {
+			chunk = sizeof(vec);
+		}
+		if (mincore((void*) (start + page * pageSize), chunk * pageSize, (void*) vec) != 0) {
+			// Not all of it is mapped, e.g. for memory that came from the heap
+			return size;
+		}
+		size_t i;
+		for (i = 0; i < chunk; ++i) {
+			if (!(vec[i] & 1)) {
+				continue;
+			}
+			uintptr_t pageStart = start + (page + i) * pageSize;
+			uintptr_t pageEnd = pageStart + pageSize;
+			if (pageStart < (uintptr_t) memory) {
+				pageStart = (uintptr_t) memory;
+			}
+			if (pageEnd > end) {
+				pageEnd = end;
+			}
+			resident += pageEnd - pageStart;
+		}
+	}
+	return resident;
+}
 #else
 void* anonymousMemoryMap(size_t size) {
 	return calloc(1, size);
@@ -34,4 +140,69 @@ void mappedMemoryFree(void* memory, size_t size) {
 	UNUSED(size);
 	free(memory);
 }
+
+void* hugeMemoryMap(size_t size) {
+	return anonymousMemoryMap(size);
+}
+
+void hugeMemoryFree(void* memory, size_t size) {
+	mappedMemoryFree(memory, size);
+}
+
+void mappedMemoryAdvise(void* memory, size_t size, int advice) {
+	if (advice & mMEMORY_ADVICE_PREFAULT) {
+		volatile uint8_t* bytes = memory;
+		size_t i;
+		for (i = 0; i < size; i += 0x1000) {
+			bytes[i] = bytes[i];
+		}
+	}
+}
+
+size_t mappedMemoryResident(const void* memory, size_t size) {
+	UNUSED(memory);
+	return size;
+}
 #endif
+
+bool sharedMemoryCreate(struct SharedMemory* memory, size_t size) {
+#if defined(__linux__) && defined(MFD_CLOEXEC)
+	int fd = memfd_create("mgba", MFD_CLOEXEC);
+#else
+	static unsigned counter = 0;
+	char name[64];
+	snprintf(name, sizeof(name), "/mgba-%ld-%u", (long) getpid(), ATOMIC_ADD(counter, 1));
+	int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd >= 0) {
+		// Only the descriptor is needed, so don't leave the name lying around
+		shm_unlink(name);
+	}
+#endif
+	if (fd < 0) {
+		return false;
+	}
+	if (ftruncate(fd, size) < 0) {
+		close(fd);
+		return false;
+	}
+	memory->handle = fd;
+	memory->size = size;
+	return true;
+}
+
+void sharedMemoryDestroy(struct SharedMemory* memory) {
+	close(memory->handle);
+	memory->handle = -1;
+}
+
+void* sharedMemoryMap(const struct SharedMemory* memory, bool copyOnWrite) {
+	void* mapping = mmap(0, memory->size, PROT_READ | PROT_WRITE, copyOnWrite ? MAP_PRIVATE : MAP_SHARED, memory->handle, 0);
+	if (mapping == MAP_FAILED) {
+		return NULL;
+	}
+	return mapping;
+}
+
+void sharedMemoryUnmap(const struct SharedMemory* memory, void* mapping) {
+	munmap(mapping, memory->size);
+}
@@ -315,6 +315,10 @@ void mPSP2SetFrameLimiter(struct mGUIRunner* runner, bool limit) {
 
 void mPSP2Setup(struct mGUIRunner* runner) {
 	mCoreConfigSetDefaultIntValue(&runner->config, "threadedVideo", 1);
+	// Emulation stays on the first core, and the scanlines are split between the other two
+	mCoreConfigSetDefaultIntValue(&runner->config, "threadedVideo.workers", 2);
+	mCoreConfigSetDefaultValue(&runner->config, "threadAffinity", "6");
+	ThreadSetAffinity(1);
 	mCoreLoadForeignConfig(runner->core, &runner->config);
 
 	sceTouchGetPanelInfo(SCE_TOUCH_PORT_FRONT, &panelInfo[SCE_TOUCH_PORT_FRONT]);
@@ -30,3 +30,43 @@ void mappedMemoryFree(void* memory, size_t size) {
 		sceKernelFreeMemBlock(uid);
 	}
 }
+
+void* hugeMemoryMap(size_t size) {
+	return anonymousMemoryMap(size);
+}
+
+void hugeMemoryFree(void* memory, size_t size) {
+	mappedMemoryFree(memory, size);
+}
+
+void mappedMemoryAdvise(void* memory, size_t size, int advice) {
+	UNUSED(memory);
+	UNUSED(size);
+	UNUSED(advice);
+}
+
+size_t mappedMemoryResident(const void* memory, size_t size) {
+	UNUSED(memory);
+	return size;
+}
+
+bool sharedMemoryCreate(struct SharedMemory* memory, size_t size) {
+	UNUSED(memory);
+	UNUSED(size);
+	return false;
+}
+
+void sharedMemoryDestroy(struct SharedMemory* memory) {
+	UNUSED(memory);
+}
+
+void* sharedMemoryMap(const struct SharedMemory* memory, bool copyOnWrite) {
+	UNUSED(memory);
+	UNUSED(copyOnWrite);
+	return NULL;
+}
+
+void sharedMemoryUnmap(const struct SharedMemory* memory, void* mapping) {
+	UNUSED(memory);
+	UNUSED(mapping);
+}
@@ -19,6 +19,8 @@ struct VFileSce {
 	struct VFile d;
 
 	SceUID fd;
+	uint8_t* mapping;
+	size_t mapSize;
 };
 
 struct VDirEntrySce {
@@ -75,6 +77,9 @@ struct VFile* VFileOpenSce(const char* path, int flags, SceMode mode) {
 		return 0;
 	}
 
+	vfsce->mapping = NULL;
+	vfsce->mapSize = 0;
+
 	vfsce->d.close = _vfsceClose;
 	vfsce->d.seek = _vfsceSeek;
 	vfsce->d.read = _vfsceRead;
@@ -122,6 +127,8 @@ static void* _vfsceMap(struct VFile* vf, size_t size, int flags) {
 		sceIoLseek(vfsce->fd, 0, SEEK_SET);
 		sceIoRead(vfsce->fd, buffer, size);
 		sceIoLseek(vfsce->fd, cur, SEEK_SET);
+		vfsce->mapping = buffer;
+		vfsce->mapSize = size;
 	}
 	return buffer;
 }
@@ -133,6 +140,10 @@ static void _vfsceUnmap(struct VFile* vf, void* memory, size_t size) {
 	sceIoWrite(vfsce->fd, memory, size);
 	sceIoLseek(vfsce->fd, cur, SEEK_SET);
 	sceIoSyncByFd(vfsce->fd, 0);
+	if (memory == vfsce->mapping) {
+		vfsce->mapping = NULL;
+		vfsce->mapSize = 0;
+	}
 	mappedMemoryFree(memory, size);
 }
 
@@ -153,7 +164,11 @@ ssize_t _vfsceSize(struct VFile* vf) {
 bool _vfsceSync(struct VFile* vf, void* buffer, size_t size) {
 	struct VFileSce* vfsce = (struct VFileSce*) vf;
 	if (buffer && size) {
-		int res = sceIoPwrite(vfsce->fd, buffer, size, 0);
+		SceOff offset = 0;
+		if ((uint8_t*) buffer >= vfsce->mapping && (uint8_t*) buffer < vfsce->mapping + vfsce->mapSize) {
+			offset = (uint8_t*) buffer - vfsce->mapping;
+		}
+		int res = sceIoPwrite(vfsce->fd, buffer, size, offset);
 		if (res < 0 || (size_t) res != size) {
 			return false;
 		}
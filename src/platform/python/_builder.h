@@ -46,6 +46,7 @@ void free(void*);
 #define PYEXPORT extern "Python+C"
 #include "platform/python/core.h"
 #include "platform/python/log.h"
+#include "platform/python/vecenv.h"
 #include "platform/python/vfs-py.h"
 #undef PYEXPORT
 
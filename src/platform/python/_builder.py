@@ -45,6 +45,7 @@ ffi.set_source("mgba._pylib", """
 #define PYEXPORT
 #include "platform/python/core.h"
 #include "platform/python/log.h"
+#include "platform/python/vecenv.h"
 #include "platform/python/vfs-py.h"
 #undef PYEXPORT
 """, include_dirs=[incdir, srcdir],
@@ -52,7 +53,7 @@ ffi.set_source("mgba._pylib", """
      libraries=["mgba"],
      library_dirs=[bindir],
      runtime_library_dirs=[libdir],
-     sources=[os.path.join(pydir, path) for path in ["vfs-py.c", "core.c", "log.c"]])
+     sources=[os.path.join(pydir, path) for path in ["vfs-py.c", "core.c", "log.c", "vecenv.c"]])
 
 preprocessed = subprocess.check_output(cpp + ["-fno-inline", "-P"] + cppflags + [os.path.join(pydir, "_builder.h")], universal_newlines=True)
 
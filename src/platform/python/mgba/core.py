@@ -5,6 +5,7 @@
 # file, You can obtain one at http://mozilla.org/MPL/2.0/.
 from ._pylib import ffi, lib  # pylint: disable=no-name-in-module
 from . import tile
+from .memory import memory_blocks
 from cached_property import cached_property
 from functools import wraps
 
@@ -323,6 +324,15 @@ class Core(object):
         self._core.getGameCode(self._core, code)
         return ffi.string(code, 12).decode("ascii")
 
+    @property
+    def memory_blocks(self):
+        """The core's memory blocks, whose contents can be viewed without copying."""
+        return memory_blocks(self._core)
+
+    @property
+    def audio_buffer(self):
+        return AudioBuffer(self._core.getAudioBuffer(self._core), self)
+
     def add_frame_callback(self, callback):
         self._callbacks.video_frame_ended.append(callback)
 
@@ -331,6 +341,54 @@ class Core(object):
         return self._native.romCrc32
 
 
+class AudioBuffer(object):
+    """The ring buffer the core writes samples to.
+
+    Samples are signed 16-bit and interleaved by channel. peek() returns the unread
+    samples as up to two memoryviews into the ring, since they can wrap around its end;
+    consume() then marks them as read. Neither copies, and the views stay valid until
+    the samples are overwritten, which can happen as soon as they've been consumed and
+    the core runs again. read() copies the samples into a writable buffer instead, e.g. a
+    preallocated NumPy array. The buffer itself is replaced if the core's audio buffer
+    size is changed, so don't hold on to this object across that.
+    """
+    def __init__(self, native, owner):
+        self._native = native
+        self._owner = owner
+
+    @property
+    def channels(self):
+        return self._native.channels
+
+    @property
+    def capacity(self):
+        return lib.mAudioBufferCapacity(self._native)
+
+    @property
+    def available(self):
+        return lib.mAudioBufferAvailable(self._native)
+
+    def _samples(self, start, count):
+        data = ffi.buffer(self._native.data + start * self.channels, count * self.channels * 2)
+        return memoryview(data).cast("B").cast("h", (count, self.channels))
+
+    def peek(self):
+        available = self.available
+        start = self._native.readPosition % self.capacity
+        first = min(available, self.capacity - start)
+        views = [self._samples(start, first)]
+        if available > first:
+            views.append(self._samples(0, available - first))
+        return views
+
+    def consume(self, count):
+        return lib.mAudioBufferRead(self._native, ffi.NULL, count)
+
+    def read(self, out):
+        samples = ffi.from_buffer("int16_t[]", out, require_writable=True)
+        return lib.mAudioBufferRead(self._native, samples, len(samples) // self.channels)
+
+
 class ICoreOwner(object):
     def claim(self):
         raise NotImplementedError
@@ -11,6 +11,11 @@ try:
 except ImportError:
     pass
 
+try:
+    import numpy
+except ImportError:
+    pass
+
 
 class Image:
     def __init__(self, width, height, stride=0, alpha=False):
@@ -32,6 +37,29 @@ class Image:
         png_file.write_close()
         return success
 
+    def view(self):
+        """Return a (height, stride) memoryview of the pixels without copying them.
+
+        The view shares memory with this image, so it changes whenever the core draws
+        into the image. It keeps the image's buffer alive, but should not be used after
+        the image has been reconstituted.
+        """
+        pixel_format = "H" if ffi.sizeof("mColor") == 2 else "I"
+        return memoryview(ffi.buffer(self.buffer)).cast("B").cast(pixel_format, (self.height, self.stride))
+
+    if 'numpy' in globals():
+        def to_numpy(self):
+            """Return the pixels as a NumPy array that shares memory with this image.
+
+            With 32-bit colors the array is (height, width, 4) bytes in RGBX order (RGBA if
+            the image has alpha); with 16-bit colors it is (height, width) of raw colors.
+            The same lifetime rules as view() apply; copy the array to keep a frame.
+            """
+            pixels = numpy.frombuffer(ffi.buffer(self.buffer), dtype=numpy.uint8)
+            if ffi.sizeof("mColor") == 2:
+                return pixels.view(numpy.uint16).reshape(self.height, self.stride)[:, :self.width]
+            return pixels.reshape(self.height, self.stride, 4)[:, :self.width]
+
     if 'PImage' in globals():
         def to_pil(self):
             colorspace = "RGBA" if self.alpha else "RGBX"
@@ -68,6 +68,41 @@ class MemoryView(object):
         self._raw_write(self._core, self._base + address, segment, value & self._mask)
 
 
+class MemoryBlock(object):
+    """A memory block as described by the core, e.g. work RAM or save data.
+
+    view() returns the block's backing storage as a writable memoryview without copying,
+    so numpy.asarray() on it gives a live array of the block. The view points straight
+    into the core and is only valid until the core is deinitialized or the block is
+    reallocated, which can happen when a ROM, save or save state is loaded, so fetch a
+    new view after any of those. Writes through it bypass the bus, so they have no side
+    effects and aren't noticed by anything tracking memory writes.
+    """
+    def __init__(self, core, native):
+        self._core = core
+        self.id = native.id  # pylint: disable=invalid-name
+        self.short_name = ffi.string(native.shortName).decode("ascii")
+        self.long_name = ffi.string(native.longName).decode("ascii")
+        self.start = native.start
+        self.end = native.end
+        self.size = native.size
+        self.flags = native.flags
+        self.max_segment = native.maxSegment
+
+    def view(self):
+        size = ffi.new("size_t*")
+        data = self._core.getMemoryBlock(self._core, self.id, size)
+        if data == ffi.NULL:
+            return None
+        return memoryview(ffi.buffer(data, size[0]))
+
+
+def memory_blocks(core):
+    blocks = ffi.new("const struct mCoreMemoryBlock**")
+    count = core.listMemoryBlocks(core, blocks)
+    return [MemoryBlock(core, blocks[0][i]) for i in range(count)]
+
+
 class MemorySearchResult(object):
     def __init__(self, memory, result):
         self.address = result.address
@@ -126,6 +161,14 @@ class Memory(object):
     def __len__(self):
         return self.size
 
+    def view(self):
+        """Return the memory block backing this region without copying, or None if
+        it isn't backed by one. See MemoryBlock for how long the view stays valid."""
+        for block in memory_blocks(self._core):
+            if block.start == self.base:
+                return block.view()
+        return None
+
     def search(self, value, type=SEARCH_GUESS, flags=RW, limit=10000, old_results=[]):
         results = ffi.new("struct mCoreMemorySearchResults*")
         lib.mCoreMemorySearchResultsInit(results, len(old_results))
@@ -0,0 +1,121 @@
+# Copyright (c) 2013-2026 Jeffrey Pfau
+#
+# This Source Code Form is subject to the terms of the Mozilla Public
+# License, v. 2.0. If a copy of the MPL was not distributed with this
+# file, You can obtain one at http://mozilla.org/MPL/2.0/.
+from ._pylib import ffi, lib  # pylint: disable=no-name-in-module
+
+try:
+    import numpy
+except ImportError:
+    pass
+
+
+class VecEnv(object):
+    """Many instances of one game, stepped together from a single call.
+
+    Every instance runs its own core, and step() runs all of them on a pool of native
+    threads with the GIL released. Observations are written straight into one stacked
+    array of frames, and any RAM regions added with add_region() are copied into one
+    stacked array of bytes, so a step costs one call no matter how many instances there
+    are. Both arrays are reused: the next step overwrites them, so copy anything that
+    needs to be kept.
+
+    With NumPy, observations are (count, height, width, 4) bytes in RGBX order for
+    32-bit colors, or (count, height, width) of raw 16-bit colors, and RAM is
+    (count, region size) bytes. Without it they are flat memoryviews of the same data.
+    """
+    def __init__(self, path, count, threads=None, regions=()):
+        if threads is None:
+            threads = count
+        self._native = lib.mPythonVecEnvCreate(path.encode("UTF-8"), count, threads)
+        if self._native == ffi.NULL:
+            raise RuntimeError("Could not load {} instances of {}".format(count, path))
+        self.count = count
+
+        width = ffi.new("unsigned*")
+        height = ffi.new("unsigned*")
+        lib.mPythonVecEnvVideoSize(self._native, width, height)
+        self._width = width[0]
+        self._height = height[0]
+        frame_size = self._width * self._height * ffi.sizeof("mColor")
+        self._video = bytearray(count * frame_size)
+        lib.mPythonVecEnvSetVideoBuffer(self._native, ffi.cast("mColor*", ffi.from_buffer(self._video)))
+
+        self._keys = ffi.new("uint32_t[]", count)
+        self._ram = bytearray()
+        self._ram_buffer = ffi.NULL
+        for address, size in regions:
+            self.add_region(address, size)
+
+    def close(self):
+        if self._native != ffi.NULL:
+            lib.mPythonVecEnvDestroy(self._native)
+            self._native = ffi.NULL
+
+    def __del__(self):
+        self.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, type, value, traceback):
+        self.close()
+
+    def add_region(self, address, size):
+        """Copy size bytes at address out of every instance's memory after each step."""
+        if not lib.mPythonVecEnvAddRegion(self._native, address, size):
+            raise ValueError("Region {:08X}+{:X} isn't within one memory block".format(address, size))
+        self._ram = bytearray(self.count * lib.mPythonVecEnvRegionSize(self._native))
+        self._ram_buffer = ffi.from_buffer("uint8_t[]", self._ram)
+
+    @property
+    def video_size(self):
+        width = ffi.new("unsigned*")
+        height = ffi.new("unsigned*")
+        lib.mPythonVecEnvCurrentVideoSize(self._native, width, height)
+        return width[0], height[0]
+
+    @property
+    def observations(self):
+        width, height = self.video_size
+        if 'numpy' not in globals():
+            return memoryview(self._video)
+        pixels = numpy.frombuffer(self._video, dtype=numpy.uint8)
+        if ffi.sizeof("mColor") == 2:
+            pixels = pixels.view(numpy.uint16).reshape(self.count, self._height, self._width)
+        else:
+            pixels = pixels.reshape(self.count, self._height, self._width, 4)
+        return pixels[:, :height, :width]
+
+    @property
+    def ram(self):
+        if 'numpy' not in globals():
+            return memoryview(self._ram)
+        return numpy.frombuffer(self._ram, dtype=numpy.uint8).reshape(self.count, -1)
+
+    def step(self, keys, frames=1):
+        """Hold keys[i] on instance i for the given number of frames.
+
+        Returns the observations and RAM after the last frame, as described above.
+        """
+        if len(keys) != self.count:
+            raise ValueError("Expected {} key sets, got {}".format(self.count, len(keys)))
+        for i, key in enumerate(keys):
+            self._keys[i] = int(key)
+        lib.mPythonVecEnvStep(self._native, self._keys, frames, self._ram_buffer)
+        return self.observations, self.ram
+
+    def reset(self, indices=None, state=None):
+        """Reset the given instances, or all of them, optionally loading a save state into them."""
+        if indices is None:
+            indices = range(self.count)
+        if state is not None:
+            if len(state) != lib.mPythonVecEnvStateSize(self._native):
+                raise ValueError("State is the wrong size")
+            state = ffi.from_buffer(state)
+        for index in indices:
+            if not lib.mPythonVecEnvReset(self._native, index):
+                raise IndexError(index)
+            if state is not None and not lib.mPythonVecEnvLoadState(self._native, index, state):
+                raise RuntimeError("Could not load state into instance {}".format(index))
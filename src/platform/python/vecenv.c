@@ -0,0 +1,296 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "vecenv.h"
+
+#include <mgba/core/core.h>
+#include <mgba/core/interface.h>
+#include <mgba-util/threading.h>
+
+struct mPythonVecEnvRegion {
+	uint32_t address;
+	uint32_t size;
+};
+
+struct mPythonVecEnvWorker {
+	Thread thread;
+	struct mPythonVecEnv* env;
+	size_t id;
+};
+
+struct mPythonVecEnv {
+	struct mCore** cores;
+	size_t nCores;
+	unsigned width;
+	unsigned height;
+	mColor* videoBuffer;
+
+	struct mPythonVecEnvRegion* regions;
+	size_t nRegions;
+	size_t regionSize;
+
+	// The calling thread does the share of worker 0, so only the others get threads
+	struct mPythonVecEnvWorker* workers;
+	size_t nWorkers;
+	Mutex mutex;
+	Condition start;
+	Condition done;
+	unsigned generation;
+	size_t pending;
+	bool shutdown;
+
+	const uint32_t* keys;
+	unsigned frames;
+	uint8_t* ram;
+};
+
+static THREAD_ENTRY _vecEnvWorkerRun(void* context);
+
+static const uint8_t* _resolveRegion(struct mCore* core, const struct mPythonVecEnvRegion* region) {
+	const struct mCoreMemoryBlock* blocks;
+	size_t nBlocks = core->listMemoryBlocks(core, &blocks);
+	size_t i;
+	for (i = 0; i < nBlocks; ++i) {
+		const struct mCoreMemoryBlock* block = &blocks[i];
+		if (block->flags & mCORE_MEMORY_VIRTUAL) {
+			continue;
+		}
+		if (region->address < block->start || region->address - block->start >= block->end - block->start) {
+			continue;
+		}
+		size_t size;
+		const uint8_t* memory = core->getMemoryBlock(core, block->id, &size);
+		size_t offset = region->address - block->start;
+		if (!memory || offset + region->size > size) {
+			return NULL;
+		}
+		return &memory[offset];
+	}
+	return NULL;
+}
+
+static void _runCore(struct mPythonVecEnv* env, size_t i) {
+	struct mCore* core = env->cores[i];
+	core->setKeys(core, env->keys[i]);
+	unsigned frame;
+	for (frame = 0; frame < env->frames; ++frame) {
+		core->runFrame(core);
+	}
+	if (!env->ram) {
+		return;
+	}
+	// Blocks can be reallocated, e.g. when a save type is detected, so look them up anew
+	uint8_t* ram = &env->ram[i * env->regionSize];
+	size_t r;
+	for (r = 0; r < env->nRegions; ++r) {
+		const struct mPythonVecEnvRegion* region = &env->regions[r];
+		const uint8_t* memory = _resolveRegion(core, region);
+		if (memory) {
+			memcpy(ram, memory, region->size);
+		} else {
+			memset(ram, 0xFF, region->size);
+		}
+		ram += region->size;
+	}
+}
+
+static void _runShare(struct mPythonVecEnv* env, size_t worker) {
+	size_t i;
+	for (i = worker; i < env->nCores; i += env->nWorkers) {
+		_runCore(env, i);
+	}
+}
+
+struct mPythonVecEnv* mPythonVecEnvCreate(const char* path, size_t nCores, unsigned nThreads) {
+	if (!nCores) {
+		return NULL;
+	}
+	struct mPythonVecEnv* env = calloc(1, sizeof(*env));
+	env->cores = calloc(nCores, sizeof(*env->cores));
+	MutexInit(&env->mutex);
+	ConditionInit(&env->start);
+	ConditionInit(&env->done);
+
+	bool loaded = true;
+	size_t i;
+	for (i = 0; i < nCores && loaded; ++i) {
+		struct mCore* core = mCoreFind(path);
+		if (!core) {
+			break;
+		}
+		if (!core->init(core)) {
+			free(core);
+			break;
+		}
+		env->cores[i] = core;
+		++env->nCores;
+		mCoreInitConfig(core, NULL);
+		if (!i) {
+			core->baseVideoSize(core, &env->width, &env->height);
+			env->videoBuffer = calloc(nCores * env->width * env->height, BYTES_PER_PIXEL);
+		}
+		core->setVideoBuffer(core, &env->videoBuffer[i * env->width * env->height], env->width);
+		loaded = mCoreLoadFile(core, path);
+		if (loaded) {
+			core->reset(core);
+		}
+	}
+	if (env->nCores < nCores || !loaded) {
+		mPythonVecEnvDestroy(env);
+		return NULL;
+	}
+
+	if (!nThreads) {
+		nThreads = 1;
+	}
+	if (nThreads > nCores) {
+		nThreads = nCores;
+	}
+	env->nWorkers = nThreads;
+	env->workers = calloc(nThreads, sizeof(*env->workers));
+	for (i = 1; i < nThreads; ++i) {
+		env->workers[i].env = env;
+		env->workers[i].id = i;
+		ThreadCreate(&env->workers[i].thread, _vecEnvWorkerRun, &env->workers[i]);
+	}
+	return env;
+}
+
+void mPythonVecEnvDestroy(struct mPythonVecEnv* env) {
+	size_t i;
+	if (env->workers) {
+		MutexLock(&env->mutex);
+		env->shutdown = true;
+		ConditionWake(&env->start);
+		MutexUnlock(&env->mutex);
+		for (i = 1; i < env->nWorkers; ++i) {
+			ThreadJoin(&env->workers[i].thread);
+		}
+		free(env->workers);
+	}
+	for (i = 0; i < env->nCores; ++i) {
+		struct mCore* core = env->cores[i];
+		mCoreConfigDeinit(&core->config);
+		core->deinit(core);
+	}
+	ConditionDeinit(&env->done);
+	ConditionDeinit(&env->start);
+	MutexDeinit(&env->mutex);
+	free(env->regions);
+	free(env->videoBuffer);
+	free(env->cores);
+	free(env);
+}
+
+size_t mPythonVecEnvCores(const struct mPythonVecEnv* env) {
+	return env->nCores;
+}
+
+void mPythonVecEnvVideoSize(const struct mPythonVecEnv* env, unsigned* width, unsigned* height) {
+	*width = env->width;
+	*height = env->height;
+}
+
+void mPythonVecEnvCurrentVideoSize(const struct mPythonVecEnv* env, unsigned* width, unsigned* height) {
+	env->cores[0]->currentVideoSize(env->cores[0], width, height);
+}
+
+void mPythonVecEnvSetVideoBuffer(struct mPythonVecEnv* env, mColor* buffer) {
+	if (!buffer) {
+		buffer = env->videoBuffer;
+	}
+	size_t i;
+	for (i = 0; i < env->nCores; ++i) {
+		struct mCore* core = env->cores[i];
+		core->setVideoBuffer(core, &buffer[i * env->width * env->height], env->width);
+	}
+}
+
+bool mPythonVecEnvAddRegion(struct mPythonVecEnv* env, uint32_t address, uint32_t size) {
+	struct mPythonVecEnvRegion region = {
+		.address = address,
+		.size = size
+	};
+	if (!size || !_resolveRegion(env->cores[0], &region)) {
+		return false;
+	}
+	env->regions = realloc(env->regions, (env->nRegions + 1) * sizeof(*env->regions));
+	env->regions[env->nRegions] = region;
+	++env->nRegions;
+	env->regionSize += size;
+	return true;
+}
+
+size_t mPythonVecEnvRegionSize(const struct mPythonVecEnv* env) {
+	return env->regionSize;
+}
+
+bool mPythonVecEnvReset(struct mPythonVecEnv* env, size_t core) {
+	if (core >= env->nCores) {
+		return false;
+	}
+	env->cores[core]->reset(env->cores[core]);
+	return true;
+}
+
+size_t mPythonVecEnvStateSize(const struct mPythonVecEnv* env) {
+	return env->cores[0]->stateSize(env->cores[0]);
+}
+
+bool mPythonVecEnvLoadState(struct mPythonVecEnv* env, size_t core, const void* state) {
+	if (core >= env->nCores) {
+		return false;
+	}
+	return env->cores[core]->loadState(env->cores[core], state);
+}
+
+void mPythonVecEnvStep(struct mPythonVecEnv* env, const uint32_t* keys, unsigned frames, uint8_t* ram) {
+	MutexLock(&env->mutex);
+	env->keys = keys;
+	env->frames = frames;
+	env->ram = ram;
+	env->pending = env->nWorkers - 1;
+	++env->generation;
+	ConditionWake(&env->start);
+	MutexUnlock(&env->mutex);
+
+	_runShare(env, 0);
+
+	MutexLock(&env->mutex);
+	while (env->pending) {
+		ConditionWait(&env->done, &env->mutex);
+	}
+	MutexUnlock(&env->mutex);
+}
+
+static THREAD_ENTRY _vecEnvWorkerRun(void* context) {
+	struct mPythonVecEnvWorker* worker = context;
+	struct mPythonVecEnv* env = worker->env;
+	ThreadSetName("Python VecEnv Worker");
+
+	// Steps can't start before every worker exists, so none can be missed here
+	unsigned generation = 0;
+	MutexLock(&env->mutex);
+	while (true) {
+		while (env->generation == generation && !env->shutdown) {
+			ConditionWait(&env->start, &env->mutex);
+		}
+		if (env->shutdown) {
+			break;
+		}
+		generation = env->generation;
+		MutexUnlock(&env->mutex);
+
+		_runShare(env, worker->id);
+
+		MutexLock(&env->mutex);
+		--env->pending;
+		if (!env->pending) {
+			ConditionWake(&env->done);
+		}
+	}
+	MutexUnlock(&env->mutex);
+	THREAD_EXIT(0);
+}
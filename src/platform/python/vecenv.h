@@ -0,0 +1,45 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef PYTHON_VECENV_H
+#define PYTHON_VECENV_H
+
+#include <mgba-util/common.h>
+#include <mgba-util/image.h>
+
+CXX_GUARD_START
+
+// Runs many instances of one game side by side on a pool of native threads, so that
+// one call from Python can step all of them. Every instance draws into its own slice
+// of a stacked frame buffer, and registered RAM regions are copied out after a step.
+struct mPythonVecEnv;
+
+struct mPythonVecEnv* mPythonVecEnvCreate(const char* path, size_t nCores, unsigned nThreads);
+void mPythonVecEnvDestroy(struct mPythonVecEnv*);
+
+size_t mPythonVecEnvCores(const struct mPythonVecEnv*);
+// Every instance's frame is laid out in the largest size the core can draw, and the
+// picture fills the top left corner of it at the current size.
+void mPythonVecEnvVideoSize(const struct mPythonVecEnv*, unsigned* width, unsigned* height);
+void mPythonVecEnvCurrentVideoSize(const struct mPythonVecEnv*, unsigned* width, unsigned* height);
+// Points instance i at buffer + i * width * height. NULL goes back to internal buffers.
+void mPythonVecEnvSetVideoBuffer(struct mPythonVecEnv*, mColor* buffer);
+
+// Regions must lie within a single memory block. The RAM of each step is laid out
+// as each instance's regions back to back, in the order they were added.
+bool mPythonVecEnvAddRegion(struct mPythonVecEnv*, uint32_t address, uint32_t size);
+size_t mPythonVecEnvRegionSize(const struct mPythonVecEnv*);
+
+bool mPythonVecEnvReset(struct mPythonVecEnv*, size_t core);
+size_t mPythonVecEnvStateSize(const struct mPythonVecEnv*);
+bool mPythonVecEnvLoadState(struct mPythonVecEnv*, size_t core, const void* state);
+
+// Holds keys[i] on instance i for the given number of frames, then fills ram, if
+// not NULL, with nCores * mPythonVecEnvRegionSize bytes.
+void mPythonVecEnvStep(struct mPythonVecEnv*, const uint32_t* keys, unsigned frames, uint8_t* ram);
+
+CXX_GUARD_END
+
+#endif
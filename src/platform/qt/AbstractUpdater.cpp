@@ -84,7 +84,7 @@ void AbstractUpdater::updateDownloaded(QNetworkReply* reply) {
 		emit updateDone(false);
 		return;
 	}
-	QFile f(destination());
+	QFile f(downloadDestination());
 	if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
 		emit updateDone(false);
 		return;
@@ -98,5 +98,13 @@ void AbstractUpdater::updateDownloaded(QNetworkReply* reply) {
 	}
 	f.flush();
 	f.close();
+
+	QUrl fallback = finishDownload();
+	if (fallback.isValid()) {
+		m_isUpdating = true;
+		QNetworkReply* reply = GBAApp::app()->httpGet(fallback);
+		chaseRedirects(reply, &AbstractUpdater::updateDownloaded);
+		return;
+	}
 	emit updateDone(true);
 }
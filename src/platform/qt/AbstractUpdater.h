@@ -8,6 +8,7 @@
 #include <QByteArray>
 #include <QFile>
 #include <QObject>
+#include <QUrl>
 
 class QNetworkReply;
 
@@ -33,6 +34,11 @@ protected:
 	virtual QUrl manifestLocation() const = 0;
 	virtual QUrl parseManifest(const QByteArray&) = 0;
 	virtual QString destination() const = 0;
+	// Where a download gets written, if it still needs to be turned into the update itself
+	virtual QString downloadDestination() const { return destination(); }
+	// Called once a download is written. If this returns a URL, that gets downloaded instead,
+	// e.g. to fall back to something else when the download turned out to be unusable.
+	virtual QUrl finishDownload() { return {}; }
 
 private slots:
 	void progress(qint64 progress, qint64 max);
@@ -5,6 +5,7 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include "ApplicationUpdater.h"
 
+#include <QCryptographicHash>
 #include <QDir>
 #include <QFileInfo>
 #include <QRegularExpression>
@@ -12,10 +13,15 @@
 #include "ApplicationUpdatePrompt.h"
 #include "ConfigController.h"
 #include "GBAApp.h"
+#include "LogController.h"
+#include "VFileDevice.h"
 
 #include <mgba/core/version.h>
 #include <mgba/feature/updater.h>
+#include <mgba-util/patch.h>
+#include <mgba-util/patch/bps.h>
 #include <mgba-util/table.h>
+#include <mgba-util/vfs.h>
 
 using namespace QGBA;
 
@@ -56,6 +62,8 @@ ApplicationUpdater::ApplicationUpdater(ConfigController* config, QObject* parent
 		QByteArray arg0 = GBAApp::app()->arguments().at(0).toUtf8();
 		QByteArray path = updateInfo().url.path().toUtf8();
 		mUpdateRegister(config->config(), arg0.constData(), path.constData());
+		// Once installed, this is what the next update's patch has to be made against
+		config->setOption("update.base", QString::fromLatin1(updateInfo().sha256.toHex()));
 		config->write();
 	});
 }
@@ -134,12 +142,48 @@ QUrl ApplicationUpdater::parseManifest(const QByteArray& manifest) {
 		return {};
 	}
 
-	return m_updates[m_channel].url;
+	const UpdateInfo& info = m_updates[m_channel];
+	m_delta = false;
+	if (!m_deltaFailed && info.deltaUrl.isValid() && !info.deltaBase.isEmpty()) {
+		QByteArray base = QByteArray::fromHex(m_config->getOption("update.base").toLatin1());
+		if (base == info.deltaBase && QFileInfo::exists(baseArchive())) {
+			m_delta = true;
+			return info.deltaUrl;
+		}
+	}
+	return info.url;
 }
 
 QString ApplicationUpdater::destination() const {
-	QFileInfo path(updateInfo().url.path());
 	QDir dir(ConfigController::cacheDir());
+	return dir.filePath(QLatin1String("update.") + archiveSuffix());
+}
+
+QString ApplicationUpdater::downloadDestination() const {
+	if (!m_delta) {
+		return destination();
+	}
+	QDir dir(ConfigController::cacheDir());
+	return dir.filePath(QLatin1String("update.bps"));
+}
+
+QUrl ApplicationUpdater::finishDownload() {
+	if (!m_delta) {
+		return {};
+	}
+	bool applied = applyDelta();
+	QFile::remove(downloadDestination());
+	m_delta = false;
+	if (applied) {
+		return {};
+	}
+	LOG(QT, WARN) << tr("Could not apply the update patch, downloading the full update instead");
+	m_deltaFailed = true;
+	return updateInfo().url;
+}
+
+QString ApplicationUpdater::archiveSuffix() const {
+	QFileInfo path(updateInfo().url.path());
 	// QFileInfo::completeSuffix will eat all .'s in the filename...including
 	// ones in the version string, turning mGBA-1.0.0-win32.7z into
 	// 0.0-win32.7z instead of the intended .7z
@@ -148,7 +192,64 @@ QString ApplicationUpdater::destination() const {
 	if (path.completeBaseName().endsWith(".tar")) {
 		suffix = "tar." + suffix;
 	}
-	return dir.filePath(QLatin1String("update.") + suffix);
+	return suffix;
+}
+
+QString ApplicationUpdater::baseArchive() const {
+	QString suffix = archiveSuffix();
+	if (suffix == QLatin1String("appimage")) {
+		// The AppImage gets moved into place whole, so the installed one is the last update
+		return GBAApp::app()->arguments().at(0);
+	}
+	QByteArray extension = suffix.toUtf8();
+	char path[PATH_MAX];
+	if (!mUpdateGetBaseArchivePath(extension.constData(), path, sizeof(path))) {
+		return {};
+	}
+	return QString::fromUtf8(path);
+}
+
+bool ApplicationUpdater::applyDelta() {
+	VFile* base = VFileDevice::open(baseArchive(), O_RDONLY);
+	if (!base) {
+		return false;
+	}
+	VFile* delta = VFileDevice::open(downloadDestination(), O_RDONLY);
+	if (!delta) {
+		base->close(base);
+		return false;
+	}
+
+	bool success = false;
+	ssize_t baseSize = base->size(base);
+	void* baseData = nullptr;
+	if (baseSize > 0) {
+		baseData = base->map(base, baseSize, MAP_READ);
+	}
+	Patch patch{};
+	patch.vf = delta;
+	if (baseData && loadPatchBPS(&patch)) {
+		size_t size = patch.outputSize(&patch, baseSize);
+		QByteArray output;
+		if (size && size <= INT_MAX) {
+			output.resize(size);
+		}
+		if (!output.isEmpty() && patch.applyPatch(&patch, baseData, baseSize, output.data(), size)) {
+			// The patch only checks CRC32s, so the result still has to match the full update
+			QByteArray hash = QCryptographicHash::hash(output, QCryptographicHash::Sha256);
+			QFile update(destination());
+			if (hash == updateInfo().sha256 && update.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+				success = update.write(output) == output.size();
+				update.close();
+			}
+		}
+	}
+	if (baseData) {
+		base->unmap(base, baseData, baseSize);
+	}
+	base->close(base);
+	delta->close(delta);
+	return success;
 }
 
 const char* ApplicationUpdater::platform() {
@@ -193,6 +294,11 @@ ApplicationUpdater::UpdateInfo::UpdateInfo(const QString& prefix, const mUpdate*
 	if (update->sha256) {
 		sha256 = QByteArray::fromHex(update->sha256);
 	}
+	if (update->deltaPath && update->deltaBase) {
+		deltaUrl = QUrl(prefix + update->deltaPath);
+		deltaSize = update->deltaSize;
+		deltaBase = QByteArray::fromHex(update->deltaBase);
+	}
 }
 
 bool ApplicationUpdater::UpdateInfo::operator<(const ApplicationUpdater::UpdateInfo& other) const {
@@ -31,6 +31,9 @@ public:
 		size_t size;
 		QUrl url;
 		QByteArray sha256;
+		QUrl deltaUrl;
+		size_t deltaSize = 0;
+		QByteArray deltaBase;
 
 		bool operator<(const UpdateInfo&) const;
 		operator QString() const;
@@ -54,15 +57,22 @@ public:
 protected:
 	virtual QUrl manifestLocation() const override;
 	virtual QUrl parseManifest(const QByteArray&) override;
+	virtual QString downloadDestination() const override;
+	virtual QUrl finishDownload() override;
 
 private:
 	static const char* platform();
+	QString archiveSuffix() const;
+	QString baseArchive() const;
+	bool applyDelta();
 
 	ConfigController* m_config;
 	QHash<QString, UpdateInfo> m_updates;
 	QString m_channel;
 	QString m_bucket;
 	QDateTime m_lastCheck;
+	bool m_delta = false;
+	bool m_deltaFailed = false;
 };
 
 }
@@ -30,7 +30,18 @@ AssetView::AssetView(std::shared_ptr<CoreController> controller, QWidget* parent
 	m_updateTimer.setInterval(1);
 	connect(&m_updateTimer, &QTimer::timeout, this, static_cast<void(AssetView::*)()>(&AssetView::updateTiles));
 
-	connect(controller.get(), &CoreController::frameAvailable, &m_updateTimer,
+	// Only redraw when the game touched something shown here; loads can replace
+	// everything without the game running, so they always redraw
+	connect(controller.get(), &CoreController::stateChanged, this, [this](int dirty) {
+		if (dirty & m_dirtyMask) {
+			m_updateTimer.start();
+		}
+	});
+	connect(controller.get(), &CoreController::stateLoaded, &m_updateTimer,
+	        static_cast<void(QTimer::*)()>(&QTimer::start));
+	connect(controller.get(), &CoreController::rewound, &m_updateTimer,
+	        static_cast<void(QTimer::*)()>(&QTimer::start));
+	connect(controller.get(), &CoreController::didReset, &m_updateTimer,
 	        static_cast<void(QTimer::*)()>(&QTimer::start));
 	connect(controller.get(), &CoreController::stopping, &m_updateTimer, &QTimer::stop);
 }
@@ -112,6 +123,12 @@ void AssetView::compositeTile(const void* tBuffer, void* buffer, size_t stride,
 }
 
 QImage AssetView::compositeMap(int map, QVector<mMapCacheEntry>* mapStatus) {
+	QImage rawMap;
+	updateMap(map, mapStatus, &rawMap, true);
+	return rawMap;
+}
+
+bool AssetView::updateMap(int map, QVector<mMapCacheEntry>* mapStatus, QImage* image, bool force) {
 	mMapCache* mapCache = mMapCacheSetGetPointer(&m_cacheSet->maps, map);
 	int tilesW = 1 << mMapCacheSystemInfoGetTilesWide(mapCache->sysConfig);
 	int tilesH = 1 << mMapCacheSystemInfoGetTilesHigh(mapCache->sysConfig);
@@ -119,17 +136,30 @@ QImage AssetView::compositeMap(int map, QVector<mMapCacheEntry>* mapStatus) {
 		mapStatus->resize(tilesW * tilesH);
 		mapStatus->fill({});
 	}
-	QImage rawMap = QImage(QSize(tilesW * 8, tilesH * 8), QImage::Format_ARGB32);
-	uchar* bgBits = rawMap.bits();
+	QSize size(tilesW * 8, tilesH * 8);
+	if (image->size() != size || image->format() != QImage::Format_ARGB32) {
+		*image = QImage(size, QImage::Format_ARGB32);
+		force = true;
+	}
+	// Only tiles that the cache had to redraw get copied into the image
+	bool changed = force;
 	for (int j = 0; j < tilesH; ++j) {
 		for (int i = 0; i < tilesW; ++i) {
-			mMapCacheCleanTile(mapCache, mapStatus->data(), i, j);
-		}
-		for (int i = 0; i < 8; ++i) {
-			memcpy(static_cast<void*>(&bgBits[tilesW * 32 * (i + j * 8)]), mMapCacheGetRow(mapCache, i + j * 8), tilesW * 32);
+			if (!mMapCacheCleanTile(mapCache, mapStatus->data(), i, j) && !force) {
+				continue;
+			}
+			changed = true;
+			for (int y = 0; y < 8; ++y) {
+				const mColor* row = &mMapCacheGetRow(mapCache, y + j * 8)[i * 8];
+				QRgb* out = &reinterpret_cast<QRgb*>(image->scanLine(y + j * 8))[i * 8];
+				for (int x = 0; x < 8; ++x) {
+					uint32_t color = row[x];
+					out[x] = (color & 0xFF00FF00) | ((color & 0xFF) << 16) | ((color >> 16) & 0xFF);
+				}
+			}
 		}
 	}
-	return rawMap.rgbSwapped();
+	return changed;
 }
 
 QImage AssetView::compositeObj(const ObjInfo& objInfo) {
@@ -10,6 +10,7 @@
 #include <QWidget>
 
 #include <mgba/core/cache-set.h>
+#include <mgba/core/core.h>
 
 #include <memory>
 
@@ -32,6 +33,8 @@ protected slots:
 protected:
 	mCacheSet* const m_cacheSet;
 	std::shared_ptr<CoreController> m_controller;
+	// Which mCoreDirtyState parts trigger a redraw
+	int m_dirtyMask = mCORE_DIRTY_ALL;
 
 	struct ObjInfo {
 		unsigned tile;
@@ -55,6 +58,7 @@ protected:
 
 	static void compositeTile(const void* tile, void* image, size_t stride, size_t x, size_t y, int depth = 8);
 	QImage compositeMap(int map, QVector<mMapCacheEntry>*);
+	bool updateMap(int map, QVector<mMapCacheEntry>*, QImage* image, bool force = false);
 	QImage compositeObj(const ObjInfo&);
 
 	bool lookupObj(int id, struct ObjInfo*);
@@ -8,6 +8,7 @@
 #include "LogController.h"
 
 #include <mgba/core/core.h>
+#include <mgba/core/host-trace.h>
 #include <mgba/core/thread.h>
 #include <mgba/internal/gba/audio.h>
 
@@ -21,7 +22,7 @@ AudioDevice::AudioDevice(QObject* parent)
 {
 	setOpenMode(ReadOnly);
 	mAudioBufferInit(&m_buffer, 0x4000, 2);
-	mAudioResamplerInit(&m_resampler, mINTERPOLATOR_SINC);
+	mAudioResamplerInit(&m_resampler, mINTERPOLATOR_POLYPHASE);
 }
 
 AudioDevice::~AudioDevice() {
@@ -60,11 +61,13 @@ qint64 AudioDevice::readData(char* data, qint64 maxSize) {
 		return 0;
 	}
 
+	mTRACE_BEGIN("Audio: consume");
 	mCoreSyncLockAudio(&m_context->impl->sync);
 	mAudioResamplerProcess(&m_resampler);
 	if (mAudioBufferAvailable(&m_buffer) < 128) {
 		mCoreSyncConsumeAudio(&m_context->impl->sync);
 		// Audio is running slow...let's wait a tiny bit for more to come in
+		mTRACE_INSTANT("Audio: running slow");
 		QThread::usleep(100);
 		mCoreSyncLockAudio(&m_context->impl->sync);
 		mAudioResamplerProcess(&m_resampler);
@@ -76,6 +79,7 @@ qint64 AudioDevice::readData(char* data, qint64 maxSize) {
 	});
 	mAudioBufferRead(&m_buffer, reinterpret_cast<int16_t*>(data), available);
 	mCoreSyncConsumeAudio(&m_context->impl->sync);
+	mTRACE_END();
 	return available * sizeof(mStereoSample);
 }
 
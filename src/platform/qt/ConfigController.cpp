@@ -7,10 +7,14 @@
 
 #include "ActionMapper.h"
 #include "CoreController.h"
+#include "LogController.h"
 #include "scripting/AutorunScriptModel.h"
 
 #include <QDir>
 #include <QMenu>
+#include <QSaveFile>
+
+#include <mgba-util/vfs.h>
 
 #include <mgba/feature/commandline.h>
 #ifdef M_CORE_GB
@@ -20,6 +24,7 @@
 static const mOption s_frontendOptions[] = {
 	{ "ecard", true, '\0' },
 	{ "mb", true, '\0' },
+	{ "startup-trace", false, '\0' },
 #ifdef ENABLE_SCRIPTING
 	{ "script", true, '\0' },
 #endif
@@ -28,6 +33,9 @@ static const mOption s_frontendOptions[] = {
 
 using namespace QGBA;
 
+// Long enough to cover a slider being dragged or a window being resized
+static const int WRITE_DELAY_MS = 500;
+
 ConfigOption::ConfigOption(const QString& name, QObject* parent)
 	: QObject(parent)
 	, m_name(name)
@@ -132,6 +140,12 @@ ConfigController::ConfigController(QObject* parent)
 	fileName.append("qt.ini");
 	m_settings = std::make_unique<QSettings>(fileName, QSettings::IniFormat);
 
+	m_writeTimer.setSingleShot(true);
+	m_writeTimer.setInterval(WRITE_DELAY_MS);
+	connect(&m_writeTimer, &QTimer::timeout, this, &ConfigController::writePending);
+	// Writes have to land in the order they were made
+	m_writer.setMaxThreadCount(1);
+
 	mCoreConfigInit(&m_config, PORT);
 
 	m_opts.audioSync = CoreController::AUDIO_SYNC;
@@ -166,7 +180,9 @@ ConfigController::ConfigController(QObject* parent)
 	m_subparsers[1].usage = "Frontend options:\n"
 	      "  --ecard FILE   Scan an e-Reader card in the first loaded game\n"
 	      "                 Can be passed multiple times for multiple cards\n"
-	      "  --mb FILE      Boot a multiboot image with FILE inserted into the ROM slot"
+	      "  --mb FILE      Boot a multiboot image with FILE inserted into the ROM slot\n"
+	      "  --startup-trace\n"
+	      "                 Print how long each step of startup took"
 #ifdef ENABLE_SCRIPTING
 	    "\n  --script FILE  Run a script on start. Can be passed multiple times\n"
 #endif
@@ -189,6 +205,10 @@ ConfigController::ConfigController(QObject* parent)
 			self->m_argvOptions[optionName] = QString::fromUtf8(arg);
 			return true;
 		}
+		if (optionName == QLatin1String("startup-trace")) {
+			self->m_argvOptions[optionName] = true;
+			return true;
+		}
 #ifdef ENABLE_SCRIPTING
 		if (optionName == QLatin1String("script")) {
 			QStringList scripts;
@@ -217,6 +237,7 @@ ConfigController::ConfigController(QObject* parent)
 }
 
 ConfigController::~ConfigController() {
+	flush();
 	mCoreConfigDeinit(&m_config);
 	mCoreConfigFreeOpts(&m_opts);
 
@@ -231,6 +252,7 @@ bool ConfigController::parseArguments(int argc, char* argv[]) {
 	}
 
 	if (mArgumentsParse(&m_args, argc, argv, m_subparsers.data(), m_subparsers.size())) {
+		m_optionCache.clear();
 		mCoreConfigFreeOpts(&m_opts);
 		mArgumentsApply(&m_args, m_subparsers.data(), m_subparsers.size(), &m_config);
 		mCoreConfigMap(&m_config, &m_opts);
@@ -268,9 +290,14 @@ void ConfigController::updateOption(const char* key) {
 }
 
 QString ConfigController::getOption(const char* key, const QVariant& defaultVal) const {
-	const char* val = mCoreConfigGetValue(&m_config, key);
-	if (val) {
-		return QString(val);
+	QByteArray cacheKey(key);
+	auto cached = m_optionCache.constFind(cacheKey);
+	if (cached == m_optionCache.constEnd()) {
+		const char* val = mCoreConfigGetValue(&m_config, key);
+		cached = m_optionCache.insert(cacheKey, val ? QString(val) : QString());
+	}
+	if (!cached->isNull()) {
+		return *cached;
 	}
 	return defaultVal.toString();
 }
@@ -305,6 +332,7 @@ void ConfigController::saveOverride(const Override& override) {
 
 void ConfigController::setOption(const char* key, bool value) {
 	mCoreConfigSetIntValue(&m_config, key, value);
+	clearCachedOption(key);
 	QString optionName(key);
 	if (m_optionSet.contains(optionName)) {
 		m_optionSet[optionName]->setValue(value);
@@ -313,6 +341,7 @@ void ConfigController::setOption(const char* key, bool value) {
 
 void ConfigController::setOption(const char* key, int value) {
 	mCoreConfigSetIntValue(&m_config, key, value);
+	clearCachedOption(key);
 	QString optionName(key);
 	if (m_optionSet.contains(optionName)) {
 		m_optionSet[optionName]->setValue(value);
@@ -321,6 +350,7 @@ void ConfigController::setOption(const char* key, int value) {
 
 void ConfigController::setOption(const char* key, unsigned value) {
 	mCoreConfigSetUIntValue(&m_config, key, value);
+	clearCachedOption(key);
 	QString optionName(key);
 	if (m_optionSet.contains(optionName)) {
 		m_optionSet[optionName]->setValue(value);
@@ -329,6 +359,7 @@ void ConfigController::setOption(const char* key, unsigned value) {
 
 void ConfigController::setOption(const char* key, const char* value) {
 	mCoreConfigSetValue(&m_config, key, value);
+	clearCachedOption(key);
 	QString optionName(key);
 	if (m_optionSet.contains(optionName)) {
 		m_optionSet[optionName]->setValue(value);
@@ -428,15 +459,48 @@ constexpr const char* ConfigController::mruName(ConfigController::MRU mru) {
 	Q_UNREACHABLE();
 }
 
+void ConfigController::clearCachedOption(const char* key) {
+	m_optionCache.remove(QByteArray(key));
+}
+
 void ConfigController::write() {
-	mCoreConfigSave(&m_config);
-	m_settings->sync();
+	if (!m_writeTimer.isActive()) {
+		m_writeTimer.start();
+	}
 
 	mCoreConfigFreeOpts(&m_opts);
 	mCoreConfigMap(&m_config, &m_opts);
 }
 
+void ConfigController::flush() {
+	if (m_writeTimer.isActive()) {
+		m_writeTimer.stop();
+		writePending();
+	}
+	m_writer.waitForDone();
+}
+
+void ConfigController::writePending() {
+	// Only the serializing happens here; the slow part, actually writing it out, doesn't block the UI
+	struct VFile* vf = VFileMemChunk(nullptr, 0);
+	mCoreConfigSaveVFile(&m_config, vf);
+	QByteArray contents(vf->size(vf), Qt::Uninitialized);
+	vf->seek(vf, 0, SEEK_SET);
+	vf->read(vf, contents.data(), contents.size());
+	vf->close(vf);
+
+	char path[PATH_MAX];
+	mCoreConfigDirectory(path, sizeof(path));
+	QString fileName(QString::fromUtf8(path));
+	fileName.append(QDir::separator());
+	fileName.append("config.ini");
+	m_writer.start(new Writer(fileName, contents));
+
+	m_settings->sync();
+}
+
 void ConfigController::makePortable() {
+	flush();
 	mCoreConfigMakePortable(&m_config, nullptr);
 
 	QString fileName(configDir());
@@ -469,3 +533,17 @@ const QString& ConfigController::configDir() {
 const QString& ConfigController::cacheDir() {
 	return configDir();
 }
+
+ConfigController::Writer::Writer(const QString& path, const QByteArray& contents)
+	: m_path(path)
+	, m_contents(contents)
+{
+	setAutoDelete(true);
+}
+
+void ConfigController::Writer::run() {
+	QSaveFile file(m_path);
+	if (!file.open(QIODevice::WriteOnly) || file.write(m_contents) != m_contents.size() || !file.commit()) {
+		LOG(QT, ERROR) << ConfigController::tr("Failed to write config file %1").arg(m_path);
+	}
+}
@@ -10,6 +10,8 @@
 #include <QHash>
 #include <QObject>
 #include <QSettings>
+#include <QThreadPool>
+#include <QTimer>
 #include <QVariant>
 
 #include <array>
@@ -92,13 +94,13 @@ public:
 	QStringList getMRU(MRU = MRU::ROM) const;
 	QList<QVariant> getList(const QString& group) const;
 
-	Configuration* overrides() { return mCoreConfigGetOverrides(&m_config); }
+	Configuration* overrides() { m_optionCache.clear(); return mCoreConfigGetOverrides(&m_config); }
 	void saveOverride(const Override&);
 
-	Configuration* input() { return mCoreConfigGetInput(&m_config); }
+	Configuration* input() { m_optionCache.clear(); return mCoreConfigGetInput(&m_config); }
 
 	const mCoreConfig* config() const { return &m_config; }
-	mCoreConfig* config() { return &m_config; }
+	mCoreConfig* config() { m_optionCache.clear(); return &m_config; }
 
 	const mArguments* args() const { return &m_args; }
 	const mGraphicsOpts* graphicsOpts() const { return &m_graphicsOpts; }
@@ -120,12 +122,31 @@ public slots:
 	void setList(const QString& group, const QList<QVariant>& list);
 
 	void makePortable();
+	// Options take effect right away, but saving them to disk is put off briefly,
+	// so that a burst of changes only gets written once
 	void write();
+	// Writes out anything still pending and waits for it to hit the disk
+	void flush();
+
+private slots:
+	void writePending();
 
 private:
+	class Writer : public QRunnable {
+	public:
+		Writer(const QString& path, const QByteArray& contents);
+
+		void run() override;
+
+	private:
+		QString m_path;
+		QByteArray m_contents;
+	};
+
 	static constexpr const char* mruName(ConfigController::MRU);
 
-	Configuration* defaults() { return &m_config.defaultsTable; }
+	Configuration* defaults() { m_optionCache.clear(); return &m_config.defaultsTable; }
+	void clearCachedOption(const char* key);
 
 	mCoreConfig m_config;
 	mCoreOptions m_opts{};
@@ -135,6 +156,11 @@ private:
 	QStringList m_fnames;
 	bool m_parsed = false;
 
+	// Looked up options, decoded. Null entries are options that aren't set.
+	mutable QHash<QByteArray, QString> m_optionCache;
+	QTimer m_writeTimer;
+	QThreadPool m_writer;
+
 	QHash<QString, QVariant> m_argvOptions;
 	QHash<QString, ConfigOption*> m_optionSet;
 	std::unique_ptr<QSettings> m_settings;
@@ -16,8 +16,10 @@
 #include <QDateTime>
 #include <QMessageBox>
 #include <QMutexLocker>
+#include <QThread>
 
 #include <mgba/core/serialize.h>
+#include <mgba/core/state-thumbnail.h>
 #include <mgba/core/version.h>
 #include <mgba/feature/video-logger.h>
 #ifdef M_CORE_GBA
@@ -46,6 +48,14 @@ CoreController::CoreController(mCore* core, QObject* parent)
 	m_threadContext.userData = this;
 	updateROMInfo();
 
+	// Size every buffer for the largest picture up front, so that none of them move
+	// while the display is holding onto one
+	unsigned width, height;
+	core->baseVideoSize(core, &width, &height);
+	for (auto& buffer : m_buffers) {
+		buffer.resize(width * height * sizeof(mColor));
+	}
+
 #ifdef M_CORE_GBA
 	GBASIODolphinCreate(&m_dolphin);
 #endif
@@ -98,7 +108,7 @@ CoreController::CoreController(mCore* core, QObject* parent)
 		controller->m_frameCounter = -1;
 
 		if (!controller->m_hwaccel) {
-			context->core->setVideoBuffer(context->core, reinterpret_cast<mColor*>(controller->m_activeBuffer.data()), controller->screenDimensions().width());
+			context->core->setVideoBuffer(context->core, controller->activeBuffer(), controller->screenDimensions().width());
 		}
 
 		QString message(tr("Reset r%1-%2 %3").arg(gitRevision).arg(QLatin1String(gitCommitShort)).arg(controller->m_crc32, 8, 16, QLatin1Char('0')));
@@ -203,14 +213,18 @@ CoreController::CoreController(mCore* core, QObject* parent)
 			va_end(argc);
 			QMetaObject::invokeMethod(controller, "statusPosted", Q_ARG(const QString&, message));
 		}
-		message = QString::vasprintf(format, args);
-		QMetaObject::invokeMethod(controller, "logPosted", Q_ARG(int, level), Q_ARG(int, category), Q_ARG(const QString&, message));
 		if (level == mLOG_FATAL && !controller->m_crashSeen) {
+			va_list argc;
+			va_copy(argc, args);
+			message = QString::vasprintf(format, argc);
+			va_end(argc);
 			controller->m_crashSeen = true;
 			QMetaObject::invokeMethod(controller, "crashed", Q_ARG(const QString&, message));
 		}
+		controller->postLog(level, category, format, args);
 	};
 	m_threadContext.logger.logger = &m_logger;
+	RingFIFOInit(&m_logRing, sizeof(LogRecord) * LOG_RING_RECORDS);
 }
 
 CoreController::~CoreController() {
@@ -220,6 +234,12 @@ CoreController::~CoreController() {
 
 	mCoreThreadJoin(&m_threadContext);
 
+	LogRecord record;
+	while (RingFIFORead(&m_logRing, &record, sizeof(record))) {
+		free(record.spill);
+	}
+	RingFIFODeinit(&m_logRing);
+
 #ifdef ENABLE_DEBUGGERS
 	mDebuggerDeinit(&m_debugger);
 #endif
@@ -233,6 +253,53 @@ CoreController::~CoreController() {
 	m_threadContext.core->deinit(m_threadContext.core);
 }
 
+void CoreController::postLog(int level, int category, const char* format, va_list args) {
+	LogRecord record;
+	record.level = level;
+	record.category = category;
+	record.spill = nullptr;
+
+	va_list argc;
+	va_copy(argc, args);
+	int length = vsnprintf(record.text, sizeof(record.text), format, argc);
+	va_end(argc);
+	if (length < 0) {
+		return;
+	}
+	if (static_cast<size_t>(length) >= sizeof(record.text)) {
+		record.spill = static_cast<char*>(malloc(length + 1));
+		vsnprintf(record.spill, length + 1, format, args);
+	}
+
+	{
+		// The GUI thread may log through this logger while the core thread is interrupted
+		QMutexLocker locker(&m_logMutex);
+		if (!RingFIFOWrite(&m_logRing, &record, sizeof(record))) {
+			locker.unlock();
+			free(record.spill);
+			m_logDropped.fetchAndAddRelaxed(1);
+		}
+	}
+	if (m_logFlushPending.testAndSetOrdered(0, 1)) {
+		QMetaObject::invokeMethod(this, "flushLog", Qt::QueuedConnection);
+	}
+}
+
+void CoreController::flushLog() {
+	m_logFlushPending.storeRelease(0);
+	LogRecord record;
+	while (RingFIFORead(&m_logRing, &record, sizeof(record))) {
+		QString message(QString::fromUtf8(record.spill ? record.spill : record.text));
+		free(record.spill);
+		emit logPosted(record.level, record.category, message);
+	}
+	int dropped = m_logDropped.fetchAndStoreRelaxed(0);
+	if (dropped) {
+		static int qtCat = mLogCategoryById("platform.qt");
+		emit logPosted(mLOG_WARN, qtCat, tr("%n log message(s) dropped", nullptr, dropped));
+	}
+}
+
 void CoreController::setPath(const QString& path, const QString& base) {
 	m_path = path;
 	m_baseDirectory = base;
@@ -243,7 +310,29 @@ const mColor* CoreController::drawContext() {
 		return nullptr;
 	}
 	QMutexLocker locker(&m_bufferMutex);
-	return reinterpret_cast<const mColor*>(m_completeBuffer.constData());
+	if (m_completeFresh) {
+		std::swap(m_displayBuffer, m_completeBuffer);
+		m_completeFresh = false;
+	}
+	return reinterpret_cast<const mColor*>(m_buffers[m_displayBuffer].constData());
+}
+
+mColor* CoreController::activeBuffer() {
+	return reinterpret_cast<mColor*>(m_buffers[m_activeBuffer].data());
+}
+
+bool CoreController::canSwapBuffers() const {
+	// Only the GBA renderer redraws every pixel of each frame it draws, whereas the GB
+	// renderer keeps things like SGB borders around between frames. Loose sync with
+	// the threaded renderer can also leave it drawing after the frame has been handed off.
+	if (platform() != mPLATFORM_GBA) {
+		return false;
+	}
+	int threadedVideo = 0;
+	int flushScanline = -1;
+	mCoreConfigGetIntValue(&m_threadContext.core->config, "threadedVideo", &threadedVideo);
+	mCoreConfigGetIntValue(&m_threadContext.core->config, "threadedVideo.flushScanline", &flushScanline);
+	return !threadedVideo || flushScanline < 0;
 }
 
 QImage CoreController::getPixels() {
@@ -252,7 +341,8 @@ QImage CoreController::getPixels() {
 	size_t stride = size.width() * BYTES_PER_PIXEL;
 
 	if (!m_hwaccel) {
-		buffer = m_completeBuffer;
+		QMutexLocker locker(&m_bufferMutex);
+		buffer = m_buffers[m_completeFresh ? m_completeBuffer : m_displayBuffer];
 	} else {
 		Interrupter interrupter(this);
 		const void* pixels;
@@ -296,8 +386,10 @@ void CoreController::loadConfig(ConfigController* config) {
 	m_saveStateFlags = config->getOption("saveStateExtdata", m_saveStateFlags).toInt();
 	m_fastForwardRatio = config->getOption("fastForwardRatio", m_fastForwardRatio).toFloat();
 	m_fastForwardHeldRatio = config->getOption("fastForwardHeldRatio", m_fastForwardRatio).toFloat();
+	m_fastForwardInterval = config->getOption("fastForwardInterval", m_fastForwardInterval).toUInt();
 	m_videoSync = config->getOption("videoSync", m_videoSync).toInt();
 	m_audioSync = config->getOption("audioSync", m_audioSync).toInt();
+	m_frameLimiter = config->getOption("frameLimiter", m_frameLimiter).toInt();
 	m_fpsTarget = config->getOption("fpsTarget").toFloat();
 	m_autosave = config->getOption("autosave", false).toInt();
 	m_autoload = config->getOption("autoload", true).toInt();
@@ -308,15 +400,10 @@ void CoreController::loadConfig(ConfigController* config) {
 	mCoreConfigCopyValue(&m_threadContext.core->config, config->config(), "mute");
 	m_preload = config->getOption("preload", true).toInt();
 
-	QSize sizeBefore = screenDimensions();
-	m_activeBuffer.resize(256 * 224 * sizeof(mColor));
-	m_threadContext.core->setVideoBuffer(m_threadContext.core, reinterpret_cast<mColor*>(m_activeBuffer.data()), sizeBefore.width());
-
 	mCoreLoadForeignConfig(m_threadContext.core, config->config());
+	m_swapBuffers = canSwapBuffers();
 
-	QSize sizeAfter = screenDimensions();
-	m_activeBuffer.resize(sizeAfter.width() * sizeAfter.height() * sizeof(mColor));
-	m_threadContext.core->setVideoBuffer(m_threadContext.core, reinterpret_cast<mColor*>(m_activeBuffer.data()), sizeAfter.width());
+	m_threadContext.core->setVideoBuffer(m_threadContext.core, activeBuffer(), screenDimensions().width());
 
 	if (hasStarted()) {
 		updateFastForward();
@@ -472,11 +559,12 @@ std::weak_ptr<MemoryAccessLogController> CoreController::memoryAccessLogControll
 
 void CoreController::start() {
 	QSize size(screenDimensions());
-	m_activeBuffer.resize(size.width() * size.height() * sizeof(mColor));
-	m_activeBuffer.fill(0xFF);
-	m_completeBuffer = m_activeBuffer;
+	for (auto& buffer : m_buffers) {
+		buffer.fill(0xFF);
+	}
+	m_swapBuffers = canSwapBuffers();
 
-	m_threadContext.core->setVideoBuffer(m_threadContext.core, reinterpret_cast<mColor*>(m_activeBuffer.data()), size.width());
+	m_threadContext.core->setVideoBuffer(m_threadContext.core, activeBuffer(), size.width());
 
 	if (!m_patched) {
 		mCoreAutoloadPatch(m_threadContext.core);
@@ -536,9 +624,11 @@ void CoreController::setSync(bool sync) {
 	if (sync) {
 		m_threadContext.impl->sync.audioWait = m_audioSync;
 		m_threadContext.impl->sync.videoFrameWait = m_videoSync;
+		m_threadContext.impl->sync.frameLimit = m_frameLimiter;
 	} else {
 		m_threadContext.impl->sync.audioWait = false;
 		m_threadContext.impl->sync.videoFrameWait = false;
+		m_threadContext.impl->sync.frameLimit = false;
 	}
 }
 
@@ -596,6 +686,15 @@ void CoreController::forceFastForward(bool enable) {
 	emit fastForwardChanged(enable || m_fastForward);
 }
 
+void CoreController::setUnboundedFastForward(bool enable) {
+	if (m_unboundedFastForward == enable) {
+		return;
+	}
+	m_unboundedFastForward = enable;
+	updateFastForward();
+	emit fastForwardChanged(enable || m_fastForward || m_fastForwardForced);
+}
+
 void CoreController::changePlayer(int id) {
 	Interrupter interrupter(this);
 	int playerId = 0;
@@ -661,6 +760,7 @@ void CoreController::loadState(int slot) {
 			controller->m_backupLoadState = VFileDevice::openMemory();
 		}
 		mCoreSaveStateNamed(context->core, controller->m_backupLoadState, controller->m_saveStateFlags);
+		mCoreThreadFlushStates(context);
 		if (mCoreLoadState(context->core, controller->m_stateSlot, controller->m_loadStateFlags)) {
 			emit controller->frameAvailable();
 			emit controller->stateLoaded();
@@ -731,13 +831,15 @@ void CoreController::saveState(int slot) {
 	}
 	mCoreThreadRunFunction(&m_threadContext, [](mCoreThread* context) {
 		CoreController* controller = static_cast<CoreController*>(context->userData);
+		// A previous save to this slot may still be writing out
+		mCoreThreadFlushStates(context);
 		VFile* vf = mCoreGetState(context->core, controller->m_stateSlot, false);
 		if (vf) {
 			controller->m_backupSaveState.resize(vf->size(vf));
 			vf->read(vf, controller->m_backupSaveState.data(), controller->m_backupSaveState.size());
 			vf->close(vf);
 		}
-		mCoreSaveState(context->core, controller->m_stateSlot, controller->m_saveStateFlags);
+		mCoreThreadSaveState(context, controller->m_stateSlot, controller->m_saveStateFlags);
 	});
 }
 
@@ -810,10 +912,12 @@ void CoreController::saveBackupState() {
 
 	mCoreThreadRunFunction(&m_threadContext, [](mCoreThread* context) {
 		CoreController* controller = static_cast<CoreController*>(context->userData);
+		mCoreThreadFlushStates(context);
 		VFile* vf = mCoreGetState(context->core, controller->m_stateSlot, true);
 		if (vf) {
 			vf->write(vf, controller->m_backupSaveState.constData(), controller->m_backupSaveState.size());
 			vf->close(vf);
+			mCoreInvalidateStateThumbnail(context->core, controller->m_stateSlot);
 			mLOG(STATUS, INFO, "Undid state save");
 		}
 		controller->m_backupSaveState.clear();
@@ -938,7 +1042,7 @@ void CoreController::setAutofire(int key, bool enable) {
 #ifdef USE_PNG
 void CoreController::screenshot() {
 	mCoreThreadRunFunction(&m_threadContext, [](mCoreThread* context) {
-		mCoreTakeScreenshot(context->core);
+		mCoreThreadTakeScreenshot(context);
 	});
 }
 #endif
@@ -1177,6 +1281,10 @@ void CoreController::startVideoLog(VFile* vf, bool compression) {
 	m_vlVf = vf;
 	mVideoLogContextSetOutput(m_vl, m_vlVf);
 	mVideoLogContextSetCompression(m_vl, compression);
+	if (compression) {
+		mVideoLogContextSetCompressionThreads(m_vl, qMax(QThread::idealThreadCount() - 1, 1));
+	}
+	mVideoLogContextSetIndexInterval(m_vl, 60);
 	mVideoLogContextWriteHeader(m_vl, m_threadContext.core);
 }
 
@@ -1213,7 +1321,7 @@ void CoreController::setFramebufferHandle(int fb) {
 	if (hasStarted()) {
 		m_threadContext.core->reloadConfigOption(m_threadContext.core, "hwaccelVideo", NULL);
 		if (!m_hwaccel) {
-			m_threadContext.core->setVideoBuffer(m_threadContext.core, reinterpret_cast<mColor*>(m_activeBuffer.data()), screenDimensions().width());
+			m_threadContext.core->setVideoBuffer(m_threadContext.core, activeBuffer(), screenDimensions().width());
 		}
 	}
 }
@@ -1248,7 +1356,19 @@ void CoreController::finishFrame() {
 		m_threadContext.core->currentVideoSize(m_threadContext.core, &width, &height);
 
 		QMutexLocker locker(&m_bufferMutex);
-		memcpy(m_completeBuffer.data(), m_activeBuffer.constData(), width * height * BYTES_PER_PIXEL);
+		if (m_swapBuffers) {
+#ifdef M_CORE_GBA
+			// Skipped frames leave the active buffer untouched, so there's nothing new to hand over
+			if (!static_cast<GBA*>(m_threadContext.core->board)->video.skipFrame) {
+				std::swap(m_activeBuffer, m_completeBuffer);
+				m_completeFresh = true;
+				m_threadContext.core->setVideoBuffer(m_threadContext.core, activeBuffer(), width);
+			}
+#endif
+		} else {
+			memcpy(m_buffers[m_completeBuffer].data(), m_buffers[m_activeBuffer].constData(), width * height * BYTES_PER_PIXEL);
+			m_completeFresh = true;
+		}
 	}
 
 	{
@@ -1268,7 +1388,15 @@ void CoreController::finishFrame() {
 	}
 	updateKeys();
 
+	int dirty = mCORE_DIRTY_ALL;
+	if (m_threadContext.core->dirtyState) {
+		dirty = m_threadContext.core->dirtyState(m_threadContext.core, m_dirtyCheckpoint, &m_dirtyCheckpoint);
+	}
+
 	QMetaObject::invokeMethod(this, "frameAvailable");
+	if (dirty) {
+		QMetaObject::invokeMethod(this, "stateChanged", Q_ARG(int, dirty));
+	}
 }
 
 void CoreController::updatePlayerSave() {
@@ -1300,9 +1428,15 @@ void CoreController::updatePlayerSave() {
 }
 
 void CoreController::updateFastForward() {
-	// If we have "Fast forward" checked in the menu (m_fastForwardForced)
-	// or are holding the fast forward button (m_fastForward):
-	if (m_fastForward || m_fastForwardForced) {
+	// Unbounded fast forward renders only some frames and skips audio, on top of
+	// running unsynced like regular unbounded fast forward
+	if (m_unboundedFastForward) {
+		mCoreThreadSetUnboundedFastForward(&m_threadContext, m_fastForwardInterval ? m_fastForwardInterval : 1);
+		setSync(false);
+	} else if (m_fastForward || m_fastForwardForced) {
+		mCoreThreadSetUnboundedFastForward(&m_threadContext, 0);
+		// If we have "Fast forward" checked in the menu (m_fastForwardForced)
+		// or are holding the fast forward button (m_fastForward):
 		if (m_fastForwardVolume >= 0) {
 			m_threadContext.core->opts.volume = m_fastForwardVolume;
 		}
@@ -1317,6 +1451,7 @@ void CoreController::updateFastForward() {
 			if (m_fastForwardRatio > 0) {
 				m_threadContext.impl->sync.fpsTarget = m_fpsTarget * m_fastForwardRatio;
 				m_threadContext.impl->sync.audioWait = true;
+				m_threadContext.impl->sync.frameLimit = m_frameLimiter;
 			}
 		} else {
 			// If we are holding the fast forward button,
@@ -1324,9 +1459,11 @@ void CoreController::updateFastForward() {
 			if (m_fastForwardHeldRatio > 0) {
 				m_threadContext.impl->sync.fpsTarget = m_fpsTarget * m_fastForwardHeldRatio;
 				m_threadContext.impl->sync.audioWait = true;
+				m_threadContext.impl->sync.frameLimit = m_frameLimiter;
 			}
 		}
 	} else {
+		mCoreThreadSetUnboundedFastForward(&m_threadContext, 0);
 		if (!mCoreConfigGetIntValue(&m_threadContext.core->config, "volume", &m_threadContext.core->opts.volume)) {
 			m_threadContext.core->opts.volume = 0x100;
 		}
@@ -5,6 +5,7 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #pragma once
 
+#include <QAtomicInt>
 #include <QByteArray>
 #include <QFile>
 #include <QList>
@@ -21,6 +22,7 @@
 #include <mgba/core/interface.h>
 #include <mgba/core/thread.h>
 #include <mgba/core/cache-set.h>
+#include <mgba-util/ring-fifo.h>
 
 #ifdef M_CORE_GB
 #include <mgba/internal/gb/sio/printer.h>
@@ -155,6 +157,7 @@ public slots:
 
 	void setFastForward(bool);
 	void forceFastForward(bool);
+	void setUnboundedFastForward(bool);
 
 	void changePlayer(int id);
 
@@ -221,6 +224,9 @@ public slots:
 
 	void setFramebufferHandle(int fb);
 
+private slots:
+	void flushLog();
+
 signals:
 	void started();
 	void paused();
@@ -232,6 +238,8 @@ signals:
 	void didReset();
 	void stateLoaded();
 	void rewound();
+	// Once per frame, with the mCoreDirtyState parts the game touched during it
+	void stateChanged(int dirty);
 
 	void rewindChanged(bool);
 	void fastForwardChanged(bool);
@@ -246,6 +254,8 @@ private:
 	void updateKeys();
 	int updateAutofire();
 	void finishFrame();
+	mColor* activeBuffer();
+	bool canSwapBuffers() const;
 
 	void updatePlayerSave();
 
@@ -259,6 +269,22 @@ private:
 	} m_logger{};
 	bool m_crashSeen = false;
 
+	// Log messages are queued as fixed-size records so that the core thread never has
+	// to wait on the GUI; anything too long for a record is spilled to the heap
+	static constexpr size_t LOG_RECORD_TEXT = 496;
+	static constexpr size_t LOG_RING_RECORDS = 2048;
+	struct LogRecord {
+		int level;
+		int category;
+		char* spill;
+		char text[LOG_RECORD_TEXT];
+	};
+	void postLog(int level, int category, const char* format, va_list args);
+	RingFIFO m_logRing;
+	QMutex m_logMutex;
+	QAtomicInt m_logFlushPending;
+	QAtomicInt m_logDropped;
+
 	QString m_path;
 	QString m_baseDirectory;
 	QString m_savePath;
@@ -272,9 +298,17 @@ private:
 	QString m_dbTitle;
 	bool m_showResetInfo = false;
 
-	QByteArray m_activeBuffer;
-	QByteArray m_completeBuffer;
+	// Finished frames are handed to the display by trading buffers instead of copying
+	// them: the core draws into the active buffer, the newest finished frame waits in
+	// the complete buffer, and the display keeps its buffer until it asks for another
+	QByteArray m_buffers[3];
+	int m_activeBuffer = 0;
+	int m_completeBuffer = 1;
+	int m_displayBuffer = 2;
+	bool m_completeFresh = false;
+	bool m_swapBuffers = false;
 	bool m_hwaccel = false;
+	uint32_t m_dirtyCheckpoint = 0;
 
 	std::unique_ptr<mCacheSet> m_cacheSet;
 	std::unique_ptr<Override> m_override;
@@ -306,6 +340,7 @@ private:
 
 	bool m_audioSync = AUDIO_SYNC;
 	bool m_videoSync = VIDEO_SYNC;
+	bool m_frameLimiter = false;
 
 	bool m_autosave;
 	bool m_autoload;
@@ -321,6 +356,8 @@ private:
 	int m_fastForwardMute = -1;
 	float m_fastForwardRatio = -1.f;
 	float m_fastForwardHeldRatio = -1.f;
+	bool m_unboundedFastForward = false;
+	unsigned m_fastForwardInterval = mCORE_THREAD_UNBOUNDED_INTERVAL;
 	float m_fpsTarget;
 
 	bool m_mute;
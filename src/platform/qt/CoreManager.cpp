@@ -15,6 +15,7 @@
 #include <mgba/gba/core.h>
 #endif
 
+#include <mgba/core/checksum-cache.h>
 #include <mgba/core/core.h>
 #include <mgba-util/string.h>
 #include <mgba-util/vfs.h>
@@ -98,19 +99,29 @@ CoreController* CoreManager::loadGame(VFile* vf, const QString& path, const QStr
 		mCoreLoadForeignConfig(core, m_config);
 	}
 
+	QFileInfo info(base);
+	QByteArray romPath;
+	if (info.isDir()) {
+		info = QFileInfo(base + "/" + path);
+		// Only games that aren't in archives can be found in the checksum cache
+		if (core->setROMPath && mChecksumCacheIsEnabled()) {
+			romPath = info.canonicalFilePath().toUtf8();
+			core->setROMPath(core, romPath.constData());
+		}
+	}
+
 	if (m_preload) {
 		mCorePreloadVF(core, vf);
 	} else {
 		core->loadROM(core, vf);
 	}
+	if (!romPath.isEmpty()) {
+		mChecksumCacheHashInBackground(romPath.constData());
+	}
 
 	QByteArray bytes(path.toUtf8());
 	separatePath(bytes.constData(), nullptr, core->dirs.baseName, nullptr);
 
-	QFileInfo info(base);
-	if (info.isDir()) {
-		info = QFileInfo(base + "/" + path);
-	}
 	bytes = info.dir().canonicalPath().toUtf8();
 	mDirectorySetAttachBase(&core->dirs, VDirOpen(bytes.constData()));
 	if (!mCoreAutoloadSave(core)) {
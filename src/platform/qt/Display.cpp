@@ -97,6 +97,8 @@ void QGBA::Display::configure(ConfigController* config) {
 	filter(opts->resampleVideo);
 	config->updateOption("showOSD");
 	config->updateOption("showFrameCounter");
+	config->updateOption("showPresentStats");
+	config->updateOption("lowLatencyPresent");
 	config->updateOption("videoSync");
 #if defined(BUILD_GL) || defined(BUILD_GLES2) || defined(BUILD_GLES3)
 	if (opts->shader && supportsShaders()) {
@@ -150,6 +152,17 @@ void QGBA::Display::showFrameCounter(bool enable) {
 	}
 }
 
+void QGBA::Display::showPresentStats(bool enable) {
+	m_showPresentStats = enable;
+	if (!enable) {
+		m_messagePainter.clearPresentStats();
+	}
+}
+
+void QGBA::Display::lowLatencyPresent(bool enable) {
+	m_lowLatencyPresent = enable;
+}
+
 void QGBA::Display::filter(bool filter) {
 	m_filter = filter;
 }
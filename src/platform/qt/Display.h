@@ -44,6 +44,8 @@ public:
 	bool isFiltered() const { return m_filter; }
 	bool isShowOSD() const { return m_showOSD; }
 	bool isShowFrameCounter() const { return m_showFrameCounter; }
+	bool isShowPresentStats() const { return m_showPresentStats; }
+	bool isLowLatencyPresent() const { return m_lowLatencyPresent; }
 
 	QPoint normalizedPoint(CoreController*, const QPoint& localRef);
 
@@ -78,6 +80,8 @@ public slots:
 	virtual void interframeBlending(bool enable);
 	virtual void showOSDMessages(bool enable);
 	virtual void showFrameCounter(bool enable);
+	virtual void showPresentStats(bool enable);
+	virtual void lowLatencyPresent(bool enable);
 	virtual void filter(bool filter);
 	virtual void swapInterval(int interval) = 0;
 	virtual void framePosted() = 0;
@@ -100,6 +104,8 @@ private:
 	MessagePainter m_messagePainter;
 	bool m_showOSD = true;
 	bool m_showFrameCounter = false;
+	bool m_showPresentStats = false;
+	bool m_lowLatencyPresent = false;
 	bool m_lockAspectRatio = false;
 	bool m_lockIntegerScaling = false;
 	bool m_interframeBlending = false;
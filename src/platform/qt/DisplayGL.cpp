@@ -8,7 +8,6 @@
 #if defined(BUILD_GL) || defined(BUILD_GLES2) || defined(BUILD_GLES3) || defined(USE_EPOXY)
 
 #include <QApplication>
-#include <QMutexLocker>
 #include <QOpenGLExtraFunctions>
 #include <QOpenGLFunctions>
 #include <QOpenGLPaintDevice>
@@ -20,6 +19,7 @@
 
 #include <cmath>
 
+#include <mgba/core/config.h>
 #include <mgba/core/core.h>
 #include <mgba-util/math.h>
 #ifdef BUILD_GL
@@ -262,6 +262,8 @@ void DisplayGL::startDrawing(std::shared_ptr<CoreController> controller) {
 	interframeBlending(hasInterframeBlending());
 	showOSDMessages(isShowOSD());
 	showFrameCounter(isShowFrameCounter());
+	showPresentStats(isShowPresentStats());
+	lowLatencyPresent(isLowLatencyPresent());
 	filter(isFiltered());
 
 #if (QT_VERSION >= QT_VERSION_CHECK(5, 6, 0))
@@ -448,6 +450,16 @@ void DisplayGL::showFrameCounter(bool enable) {
 	QMetaObject::invokeMethod(m_painter.get(), "showFrameCounter", Q_ARG(bool, enable));
 }
 
+void DisplayGL::showPresentStats(bool enable) {
+	Display::showPresentStats(enable);
+	QMetaObject::invokeMethod(m_painter.get(), "showPresentStats", Q_ARG(bool, enable));
+}
+
+void DisplayGL::lowLatencyPresent(bool enable) {
+	Display::lowLatencyPresent(enable);
+	QMetaObject::invokeMethod(m_painter.get(), "lowLatencyPresent", Q_ARG(bool, enable));
+}
+
 void DisplayGL::filter(bool filter) {
 	Display::filter(filter);
 	QMetaObject::invokeMethod(m_painter.get(), "filter", Q_ARG(bool, filter));
@@ -547,11 +559,9 @@ PainterGL::PainterGL(QWindow* window, mGLWidget* widget, const QSurfaceFormat& f
 		m_surface = m_window;
 	}
 	m_supportsShaders = m_format.version() >= qMakePair(2, 0);
-	for (auto& buf : m_buffers) {
-		m_free.append(&buf.front());
-	}
 	connect(&m_drawTimer, &QTimer::timeout, this, &PainterGL::draw);
 	m_drawTimer.setSingleShot(true);
+	m_presentClock.start();
 }
 
 PainterGL::~PainterGL() {
@@ -581,6 +591,23 @@ void PainterGL::create() {
 	m_gl->create();
 	makeCurrent();
 
+#ifdef GL_SYNC_GPU_COMMANDS_COMPLETE
+	if (m_gl->isOpenGLES()) {
+		m_supportsFences = m_gl->format().majorVersion() >= 3;
+	} else {
+		m_supportsFences = m_gl->format().version() >= qMakePair(3, 2) || m_gl->hasExtension("GL_ARB_sync");
+	}
+#endif
+#ifdef Q_OS_WIN
+	m_supportsSwapTear = m_gl->hasExtension("WGL_EXT_swap_control_tear");
+#elif defined(USE_GLX)
+	if (QGuiApplication::platformName() == "xcb") {
+		::Display* display = glXGetCurrentDisplay();
+		const char* extensions = glXQueryExtensionsString(display, DefaultScreen(display));
+		m_supportsSwapTear = extensions && strstr(extensions, "GLX_EXT_swap_control_tear");
+	}
+#endif
+
 #ifdef BUILD_GL
 	mGLContext* glBackend;
 #endif
@@ -679,6 +706,11 @@ void PainterGL::destroy() {
 
 void PainterGL::setContext(std::shared_ptr<CoreController> context) {
 	m_context = std::move(context);
+	if (m_context) {
+		// Frames go through the three buffers in m_buffers, with the GUI thread
+		// filling one while this thread draws another
+		mCoreSyncSetTripleBuffer(&m_context->thread()->impl->sync, true);
+	}
 }
 
 void PainterGL::resizeContext() {
@@ -760,6 +792,19 @@ void PainterGL::showFrameCounter(bool enable) {
 	m_showFrameCounter = enable;
 }
 
+void PainterGL::showPresentStats(bool enable) {
+	m_showPresentStats = enable;
+}
+
+void PainterGL::lowLatencyPresent(bool enable) {
+	m_lowLatency = enable;
+	m_predictedDraw = 0;
+	if (m_started && m_swapInterval > 0) {
+		// Reapply the swap interval in case adaptive vsync needs to be toggled
+		swapInterval(m_swapInterval);
+	}
+}
+
 void PainterGL::filter(bool filter) {
 	m_backend->filter = filter;
 	if (m_started && !m_active) {
@@ -772,6 +817,10 @@ void PainterGL::swapInterval(int interval) {
 		return;
 	}
 	m_swapInterval = interval;
+	if (m_lowLatency && m_supportsSwapTear && interval > 0) {
+		// Adaptive vsync: tear instead of waiting a whole refresh if a frame is late
+		interval = -interval;
+	}
 #ifdef Q_OS_WIN
 	wglSwapIntervalEXT(interval);
 #elif defined(Q_OS_MAC)
@@ -815,15 +864,22 @@ void PainterGL::start() {
 #endif
 
 	m_buffer = nullptr;
+	m_bufferTime = -1;
+	m_lastPresent = -1;
 	m_active = true;
 	m_started = true;
+	mCoreSyncResetPresentStats(&m_context->thread()->impl->sync);
+
+	ThreadPolicy policy;
+	mCoreConfigGetThreadPolicy(&m_context->thread()->core->config, &policy);
+	ThreadSetPolicy(&policy);
 	resizeContext();
 	swapInterval(1);
 	emit started();
 }
 
 void PainterGL::draw() {
-	if (!m_started || m_queue.isEmpty()) {
+	if (!m_started || !dequeue()) {
 		return;
 	}
 
@@ -853,7 +909,7 @@ void PainterGL::draw() {
 	if (m_swapInterval != wantSwap) {
 		swapInterval(wantSwap);
 	}
-	dequeue();
+	m_frameReady = false;
 	bool forceRedraw = true;
 	if (!m_delayTimer.isValid()) {
 		m_delayTimer.start();
@@ -868,12 +924,78 @@ void PainterGL::draw() {
 			forceRedraw = m_delayTimer.nsecsElapsed() + OVERHEAD_NSEC >= 1000000000 / m_window->screen()->refreshRate();
 		}
 	}
+	if (forceRedraw && m_lowLatency && wantSwap && !sync->videoFrameWait) {
+		waitForVblank(sync);
+	}
 	mCoreSyncWaitFrameEnd(sync);
 
 	if (forceRedraw) {
 		m_delayTimer.restart();
-		performDraw();
-		m_backend->swap(m_backend);
+		present(sync);
+	}
+}
+
+void PainterGL::waitForVblank(mCoreSync* sync) {
+	if (m_lastPresent < 0 || !sync->videoTripleBuffer) {
+		return;
+	}
+	// Hold off drawing until just before the next predicted vblank, then pick up the
+	// newest frame the core has finished in the meantime
+	qint64 refresh = 1000000000LL / m_window->screen()->refreshRate();
+	qint64 now = m_presentClock.nsecsElapsed();
+	qint64 vblank = m_lastPresent + refresh;
+	if (vblank < now) {
+		vblank += ((now - vblank) / refresh + 1) * refresh;
+	}
+	qint64 deadline = vblank - m_predictedDraw - OVERHEAD_NSEC;
+	while (m_presentClock.nsecsElapsed() < deadline) {
+		QThread::usleep(500);
+	}
+	dequeue();
+}
+
+void PainterGL::present(mCoreSync* sync) {
+	qint64 start = m_presentClock.nsecsElapsed();
+	performDraw();
+#ifdef GL_SYNC_GPU_COMMANDS_COMPLETE
+	if (m_lowLatency && m_supportsFences) {
+		// Wait for the GPU so the swap doesn't queue behind unfinished work, and so the
+		// draw time used for prediction includes the time spent on the GPU
+		QOpenGLExtraFunctions* fn = m_gl->extraFunctions();
+		GLsync fence = fn->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		fn->glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 100000000);
+		fn->glDeleteSync(fence);
+	}
+#endif
+	qint64 drawTime = m_presentClock.nsecsElapsed() - start;
+	if (drawTime > m_predictedDraw) {
+		m_predictedDraw = drawTime;
+	} else {
+		m_predictedDraw += (drawTime - m_predictedDraw) / 16;
+	}
+	m_backend->swap(m_backend);
+
+	qint64 now = m_presentClock.nsecsElapsed();
+	unsigned missed = 0;
+	if (m_lastPresent >= 0 && m_swapInterval > 0) {
+		qint64 refresh = 1000000000LL / m_window->screen()->refreshRate();
+		qint64 intervals = (now - m_lastPresent + refresh / 2) / refresh;
+		if (intervals > 1) {
+			missed = intervals - 1;
+		}
+	}
+	m_lastPresent = now;
+	qint64 latency = m_bufferTime >= 0 ? (now - m_bufferTime) / 1000 : 0;
+	mCoreSyncReportPresent(sync, latency, missed, m_framesQueued.fetchAndStoreOrdered(0));
+
+	if (m_showPresentStats && m_messagePainter) {
+		mCorePresentStats stats;
+		mCoreSyncGetPresentStats(sync, &stats);
+		m_messagePainter->showPresentStats(tr("Latency %1 ms (avg %2 ms), %3 missed, depth %4")
+			.arg(stats.latency / 1000., 0, 'f', 1)
+			.arg(stats.averageLatency / 1000., 0, 'f', 1)
+			.arg(stats.missedVblanks)
+			.arg(stats.queueDepth));
 	}
 }
 
@@ -897,6 +1019,7 @@ void PainterGL::doStop() {
 	m_drawTimer.stop();
 	m_active = false;
 	m_started = false;
+	m_lastPresent = -1;
 	dequeueAll(false);
 	if (m_context) {
 		if (m_videoProxy) {
@@ -920,6 +1043,7 @@ void PainterGL::doStop() {
 void PainterGL::pause() {
 	m_drawTimer.stop();
 	m_active = false;
+	m_lastPresent = -1;
 	dequeueAll(true);
 }
 
@@ -946,51 +1070,42 @@ void PainterGL::performDraw() {
 }
 
 void PainterGL::enqueue(const uint32_t* backing) {
-	QMutexLocker locker(&m_mutex);
+	if (!m_context) {
+		return;
+	}
+	mCoreSync* sync = &m_context->thread()->impl->sync;
+	unsigned slot = sync->videoFrameBack;
 	uint32_t* buffer = nullptr;
 	if (backing) {
-		if (m_free.isEmpty()) {
-			buffer = m_queue.dequeue();
-		} else {
-			buffer = m_free.takeLast();
-		}
-		if (buffer) {
-			QSize size = m_context->screenDimensions();
-			memcpy(buffer, backing, size.width() * size.height() * BYTES_PER_PIXEL);
-		}
+		buffer = m_buffers[slot].data();
+		QSize size = m_context->screenDimensions();
+		memcpy(buffer, backing, size.width() * size.height() * BYTES_PER_PIXEL);
 	}
-	m_queue.enqueue(buffer);
+	m_slots[slot] = buffer;
+	m_slotTimes[slot] = m_presentClock.nsecsElapsed();
+	mCoreSyncPublishFrame(sync);
+	m_framesQueued.ref();
 }
 
-void PainterGL::dequeue() {
-	QMutexLocker locker(&m_mutex);
-	if (!m_queue.isEmpty()) {
-		uint32_t* buffer = m_queue.dequeue();
-		if (m_buffer) {
-			m_free.append(m_buffer);
-		}
-		m_buffer = buffer;
+bool PainterGL::dequeue() {
+	unsigned slot;
+	if (mCoreSyncTakeFrame(&m_context->thread()->impl->sync, &slot)) {
+		// Any older frame that hasn't been drawn yet is superseded by this one
+		m_buffer = m_slots[slot];
+		m_bufferTime = m_slotTimes[slot];
+		m_frameReady = true;
 	}
+	return m_frameReady;
 }
 
 void PainterGL::dequeueAll(bool keep) {
-	QMutexLocker locker(&m_mutex);
-	uint32_t* buffer = nullptr;
-	while (!m_queue.isEmpty()) {
-		buffer = m_queue.dequeue();
-		if (keep) {
-			if (m_buffer && buffer) {
-				m_free.append(m_buffer);
-				m_buffer = buffer;
-			}
-		} else if (buffer) {
-			m_free.append(buffer);
-		}
+	if (m_context) {
+		dequeue();
 	}
-	if (m_buffer && !keep) {
-		m_free.append(m_buffer);
+	if (!keep) {
 		m_buffer = nullptr;
 	}
+	m_frameReady = false;
 }
 
 void PainterGL::setVideoProxy(std::shared_ptr<VideoProxy> proxy) {
@@ -19,7 +19,6 @@
 #include <QAtomicInt>
 #include <QElapsedTimer>
 #include <QHash>
-#include <QList>
 #include <QMouseEvent>
 #include <QOffscreenSurface>
 #include <QOpenGLContext>
@@ -27,7 +26,6 @@
 #include <QOpenGLVertexArrayObject>
 #include <QOpenGLWidget>
 #include <QPainter>
-#include <QQueue>
 #include <QThread>
 #include <QTimer>
 
@@ -110,6 +108,8 @@ public slots:
 	void interframeBlending(bool enable) override;
 	void showOSDMessages(bool enable) override;
 	void showFrameCounter(bool enable) override;
+	void showPresentStats(bool enable) override;
+	void lowLatencyPresent(bool enable) override;
 	void filter(bool filter) override;
 	void swapInterval(int interval) override;
 	void framePosted() override;
@@ -179,6 +179,8 @@ public slots:
 	void interframeBlending(bool enable);
 	void showOSD(bool enable);
 	void showFrameCounter(bool enable);
+	void showPresentStats(bool enable);
+	void lowLatencyPresent(bool enable);
 	void filter(bool filter);
 	void swapInterval(int interval);
 	void resizeContext();
@@ -200,17 +202,21 @@ private slots:
 private:
 	void makeCurrent();
 	void performDraw();
-	void dequeue();
+	void waitForVblank(mCoreSync*);
+	void present(mCoreSync*);
+	bool dequeue();
 	void dequeueAll(bool keep = false);
 	void recenterLayers();
 
 	std::array<std::array<uint32_t, 0x100000>, 3> m_buffers;
-	QList<uint32_t*> m_free;
-	QQueue<uint32_t*> m_queue;
+	std::array<uint32_t*, 3> m_slots{};
+	std::array<qint64, 3> m_slotTimes{};
 	uint32_t* m_buffer = nullptr;
+	qint64 m_bufferTime = -1;
+	bool m_frameReady = false;
+	QAtomicInt m_framesQueued;
 
 	QPainter m_painter;
-	QMutex m_mutex;
 	QWindow* m_window;
 	QSurface* m_surface;
 	QSurfaceFormat m_format;
@@ -237,6 +243,14 @@ private:
 	QElapsedTimer m_delayTimer;
 	std::shared_ptr<VideoProxy> m_videoProxy;
 	int m_swapInterval = -1;
+
+	QElapsedTimer m_presentClock;
+	qint64 m_lastPresent = -1;
+	qint64 m_predictedDraw = 0;
+	bool m_lowLatency = false;
+	bool m_showPresentStats = false;
+	bool m_supportsFences = false;
+	bool m_supportsSwapTear = false;
 };
 
 }
@@ -29,6 +29,7 @@ DisplayQt::DisplayQt(QWidget* parent)
 	m_backend.setImageSize = &DisplayQt::setImageSize;
 	m_backend.imageSize = &DisplayQt::imageSize;
 	m_backend.setImage = &DisplayQt::setImage;
+	m_backend.setImageRect = &DisplayQt::setImageRect;
 	m_backend.drawFrame = &DisplayQt::drawFrame;
 	m_backend.filter = isFiltered();
 	m_backend.lockAspectRatio = isAspectRatioLocked();
@@ -262,6 +263,28 @@ void DisplayQt::setImage(struct VideoBackend* v, enum VideoLayer layer, const vo
 	self->m_layers[layer] = QImage(static_cast<const uchar*>(frame), image.width(), image.height(), QImage::Format_ARGB32).rgbSwapped();
 }
 
+void DisplayQt::setImageRect(struct VideoBackend* v, enum VideoLayer layer, const struct mRectangle* rect, const void* frame) {
+	DisplayQt* self = static_cast<DisplayQt*>(v->user);
+	if (layer >= self->m_layers.size()) {
+		return;
+	}
+	QImage& image = self->m_layers[layer];
+	QRect dirty = QRect(rect->x, rect->y, rect->width, rect->height) & image.rect();
+	if (dirty.isEmpty()) {
+		return;
+	}
+	const uint32_t* pixels = static_cast<const uint32_t*>(frame);
+	for (int y = dirty.top(); y <= dirty.bottom(); ++y) {
+		const uint32_t* in = &pixels[y * image.width()];
+		QRgb* out = reinterpret_cast<QRgb*>(image.scanLine(y));
+		for (int x = dirty.left(); x <= dirty.right(); ++x) {
+			// Same as QImage::rgbSwapped, but only on the pixels that changed
+			uint32_t color = in[x];
+			out[x] = (color & 0xFF00FF00) | ((color >> 16) & 0xFF) | ((color & 0xFF) << 16);
+		}
+	}
+}
+
 void DisplayQt::drawFrame(struct VideoBackend* v) {
 	QMetaObject::invokeMethod(static_cast<DisplayQt*>(v->user), "update");
 }
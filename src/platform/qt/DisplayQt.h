@@ -62,6 +62,7 @@ private:
 	static void setImageSize(struct VideoBackend*, enum VideoLayer, int w, int h);
 	static void imageSize(struct VideoBackend*, enum VideoLayer, int* w, int* h);
 	static void setImage(struct VideoBackend*, enum VideoLayer, const void* frame);
+	static void setImageRect(struct VideoBackend*, enum VideoLayer, const struct mRectangle*, const void* frame);
 	static void drawFrame(struct VideoBackend*);
 
 	VideoBackend m_backend{};
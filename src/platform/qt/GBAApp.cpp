@@ -11,6 +11,7 @@
 #include "ConfigController.h"
 #include "Display.h"
 #include "LogController.h"
+#include "StartupTrace.h"
 #include "VFileDevice.h"
 #include "Window.h"
 
@@ -18,7 +19,9 @@
 #include <QFileOpenEvent>
 #include <QFontDatabase>
 #include <QIcon>
+#include <QTimer>
 
+#include <mgba/core/checksum-cache.h>
 #include <mgba/core/version.h>
 #include <mgba/feature/updater.h>
 #include <mgba-util/socket.h>
@@ -55,6 +58,12 @@ GBAApp::GBAApp(int& argc, char* argv[], ConfigController* config)
 #endif
 
 	SocketSubsystemInit();
+#if defined(USE_LIBZIP) || defined(USE_MINIZIP)
+	// Games can outlive the app object while shutting down, so this is never deinitialized
+	VFileZipCacheInit(0x4000000);
+#endif
+	// Nor is this, though anything it hasn't written yet is written out on quitting
+	mChecksumCacheInit();
 	qRegisterMetaType<const uint32_t*>("const uint32_t*");
 	qRegisterMetaType<mCoreThread*>("mCoreThread*");
 
@@ -62,10 +71,19 @@ GBAApp::GBAApp(int& argc, char* argv[], ConfigController* config)
 		Display::setDriver(static_cast<Display::Driver>(m_configController->getQtOption("displayDriver").toInt()));
 	}
 
-	reloadGameDB();
+	// Nothing needs the game database before a game is loaded, so attach it once the window is up
+	QTimer::singleShot(0, this, [this]() {
+		gameDB();
+		StartupTrace::mark("Attach game database");
+	});
 
 	m_manager.setConfig(m_configController->config());
 	m_manager.setMultiplayerController(&m_multiplayer);
+	bool ok;
+	int maxSkew = m_configController->getOption("multiplayerMaxSkew").toInt(&ok);
+	if (ok && maxSkew > 0) {
+		m_multiplayer.setMaxSkew(maxSkew);
+	}
 
 	if (!m_configController->getQtOption("audioDriver").isNull()) {
 		AudioProcessor::setDriver(static_cast<AudioProcessor::Driver>(m_configController->getQtOption("audioDriver").toInt()));
@@ -115,6 +133,8 @@ void GBAApp::cleanup() {
 #ifdef USE_DISCORD_RPC
 	DiscordCoordinator::deinit();
 #endif
+
+	mChecksumCacheSync();
 }
 
 bool GBAApp::event(QEvent* event) {
@@ -131,6 +151,7 @@ Window* GBAApp::newWindow() {
 		return nullptr;
 	}
 	Window* w = new Window(&m_manager, m_configController, m_windows.count());
+	StartupTrace::mark("Create window");
 	connect(w, &Window::destroyed, [this, w]() {
 		m_windows.removeAll(w);
 		for (Window* w : m_windows) {
@@ -141,6 +162,7 @@ Window* GBAApp::newWindow() {
 	w->setAttribute(Qt::WA_DeleteOnClose);
 	w->loadConfig();
 	w->show();
+	StartupTrace::mark("Show window");
 	w->multiplayerChanged();
 	for (Window* w : m_windows) {
 		w->updateMultiplayerStatus(m_windows.count() < MAX_GBAS);
@@ -242,8 +264,29 @@ QString GBAApp::dataDir() {
 }
 
 #ifdef USE_SQLITE3
+const NoIntroDB* GBAApp::gameDB() {
+	if (!m_dbLoaded) {
+		reloadGameDB();
+	}
+	return m_db;
+}
+
 bool GBAApp::reloadGameDB() {
+	m_dbLoaded = true;
 	NoIntroDB* db = nullptr;
+	VFile* index = VFileDevice::open(dataDir() + "/nointro.idx", O_RDONLY);
+	if (index) {
+		// The prebuilt index is looked up straight from the mapping, so there's nothing left to parse
+		db = NoIntroDBLoadIndex(index);
+		if (db) {
+			if (m_db) {
+				NoIntroDBDestroy(m_db);
+			}
+			m_db = db;
+			return true;
+		}
+		index->close(index);
+	}
 	db = NoIntroDBLoad((ConfigController::configDir() + "/nointro.sqlite3").toUtf8().constData());
 	if (db && m_db) {
 		NoIntroDBDestroy(m_db);
@@ -257,6 +300,10 @@ bool GBAApp::reloadGameDB() {
 	return false;
 }
 #else
+const NoIntroDB* GBAApp::gameDB() {
+	return nullptr;
+}
+
 bool GBAApp::reloadGameDB() {
 	return false;
 }
@@ -323,7 +370,7 @@ bool GBAApp::waitOnJob(qint64 jobId, QObject* context, std::function<void ()>&&
 		}
 		callback();
 	});
-	m_workerJobCallbacks.insert(m_nextJob, connection);
+	m_workerJobCallbacks.insert(jobId, connection);
 	return true;
 }
 
@@ -395,6 +442,9 @@ void GBAApp::restartForUpdate() {
 void GBAApp::finishJob(qint64 jobId) {
 	m_workerJobs.remove(jobId);
 	emit jobFinished(jobId);
+	for (auto& job : m_workerJobCallbacks.values(jobId)) {
+		disconnect(job);
+	}
 	m_workerJobCallbacks.remove(jobId);
 }
 
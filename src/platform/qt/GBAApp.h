@@ -68,7 +68,7 @@ public:
 	QString getSaveFileName(QWidget* owner, const QString& title, const QString& filter = {}, const QString& path = {});
 	QString getOpenDirectoryName(QWidget* owner, const QString& title, const QString& path = {});
 
-	const NoIntroDB* gameDB() const { return m_db; }
+	const NoIntroDB* gameDB();
 	bool reloadGameDB();
 
 	QNetworkAccessManager* netman();
@@ -138,6 +138,7 @@ private:
 	QFont m_monospace;
 
 	NoIntroDB* m_db = nullptr;
+	bool m_dbLoaded = false;
 
 	QNetworkAccessManager m_netman;
 };
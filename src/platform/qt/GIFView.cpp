@@ -31,6 +31,8 @@ GIFView::GIFView(std::shared_ptr<CoreController> controller, QWidget* parent)
 
 	FFmpegEncoderInit(&m_encoder);
 	FFmpegEncoderSetAudio(&m_encoder, nullptr, 0);
+	FFmpegEncoderSetPaletteReuse(&m_encoder, true);
+	FFmpegEncoderSetThreaded(&m_encoder, true, FFMPEG_QUEUE_BLOCK);
 
 	setController(controller);
 }
@@ -16,9 +16,8 @@
 #include <QKeyEvent>
 #include <QPainter>
 
-#include <mgba/core/serialize.h>
+#include <mgba/core/state-thumbnail.h>
 #include <mgba/internal/gba/input.h>
-#include <mgba-util/memory.h>
 #include <mgba-util/vfs.h>
 
 using namespace QGBA;
@@ -179,42 +178,26 @@ bool LoadSaveState::eventFilter(QObject* object, QEvent* event) {
 
 void LoadSaveState::loadState(int slot) {
 	mCoreThread* thread = m_controller->thread();
-	VFile* vf = mCoreGetState(thread->core, slot, 0);
-	if (!vf) {
-		m_slots[slot - 1]->setText(tr("Empty"));
-		return;
-	}
-
-	mStateExtdata extdata;
-	mStateExtdataInit(&extdata);
-	void* state = mCoreExtractState(thread->core, vf, &extdata);
-	vf->seek(vf, 0, SEEK_SET);
-	if (!state) {
-		m_slots[slot - 1]->setText(tr("Corrupted"));
-		mStateExtdataDeinit(&extdata);
+	mStateThumbnail thumbnail;
+	mStateThumbnailInit(&thumbnail);
+	if (!mCoreLoadStateThumbnail(thread->core, slot, &thumbnail)) {
+		VFile* vf = mCoreGetState(thread->core, slot, 0);
+		if (vf) {
+			m_slots[slot - 1]->setText(tr("Corrupted"));
+			vf->close(vf);
+		} else {
+			m_slots[slot - 1]->setText(tr("Empty"));
+		}
 		return;
 	}
 
 	QDateTime creation;
 	QImage stateImage;
-
-	QSize size = m_controller->screenDimensions();
-	mStateExtdataItem item;
-	if (mStateExtdataGet(&extdata, EXTDATA_SCREENSHOT, &item)) {
-		mStateExtdataItem dims;
-		if (mStateExtdataGet(&extdata, EXTDATA_SCREENSHOT_DIMENSIONS, &dims) && dims.size == sizeof(uint16_t[2])) {
-			size.setWidth(static_cast<uint16_t*>(dims.data)[0]);
-			size.setHeight(static_cast<uint16_t*>(dims.data)[1]);
-		}
-		if (item.size >= static_cast<int32_t>(size.width() * size.height() * 4)) {
-			stateImage = QImage((uchar*) item.data, size.width(), size.height(), QImage::Format_ARGB32).rgbSwapped();
-		}
+	if (thumbnail.pixels) {
+		stateImage = QImage(reinterpret_cast<uchar*>(thumbnail.pixels), thumbnail.width, thumbnail.height, QImage::Format_ARGB32).rgbSwapped();
 	}
-
-	if (mStateExtdataGet(&extdata, EXTDATA_META_TIME, &item) && item.size == sizeof(uint64_t)) {
-		uint64_t creationUsec;
-		LOAD_64LE(creationUsec, 0, item.data);
-		creation = QDateTime::fromMSecsSinceEpoch(creationUsec / 1000LL);
+	if (thumbnail.creationUsec) {
+		creation = QDateTime::fromMSecsSinceEpoch(thumbnail.creationUsec / 1000LL);
 	}
 
 	if (!stateImage.isNull()) {
@@ -229,8 +212,7 @@ void LoadSaveState::loadState(int slot) {
 	} else {
 		m_slots[slot - 1]->setText(QString());
 	}
-	vf->close(vf);
-	mappedMemoryFree(state, thread->core->stateSize(thread->core));
+	mStateThumbnailDeinit(&thumbnail);
 }
 
 void LoadSaveState::triggerState(int slot) {
@@ -0,0 +1,100 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "LogModel.h"
+
+#include "LogController.h"
+
+using namespace QGBA;
+
+LogModel::LogModel(QObject* parent)
+	: QAbstractListModel(parent)
+{
+	// Bursts of messages are inserted in a single batch once control returns to the event loop
+	m_flushTimer.setSingleShot(true);
+	m_flushTimer.setInterval(0);
+	connect(&m_flushTimer, &QTimer::timeout, this, &LogModel::flush);
+}
+
+QVariant LogModel::data(const QModelIndex& index, int role) const {
+	if (!index.isValid() || index.row() >= m_entries.count()) {
+		return {};
+	}
+	switch (role) {
+	case Qt::DisplayRole:
+		return line(index.row());
+	case Qt::ToolTipRole:
+		return m_entries[index.row()].message;
+	default:
+		return {};
+	}
+}
+
+int LogModel::rowCount(const QModelIndex& parent) const {
+	if (parent.isValid()) {
+		return 0;
+	}
+	return m_entries.count();
+}
+
+QString LogModel::line(int row) const {
+	const Entry& entry = m_entries[row];
+	return QString("[%1] %2:\t%3").arg(LogController::toString(entry.level)).arg(mLogCategoryName(entry.category)).arg(entry.message);
+}
+
+void LogModel::postLog(int level, int category, const QString& log) {
+	m_pending.append({level, category, log});
+	if (m_lineLimit > 0 && m_pending.count() > m_lineLimit) {
+		m_pending.removeFirst();
+	}
+	if (!m_flushTimer.isActive()) {
+		m_flushTimer.start();
+	}
+}
+
+void LogModel::setLineLimit(int limit) {
+	m_lineLimit = limit;
+	if (m_lineLimit <= 0) {
+		return;
+	}
+	while (m_pending.count() > m_lineLimit) {
+		m_pending.removeFirst();
+	}
+	trim(m_lineLimit);
+}
+
+void LogModel::clear() {
+	m_pending.clear();
+	if (m_entries.isEmpty()) {
+		return;
+	}
+	beginResetModel();
+	m_entries.clear();
+	endResetModel();
+}
+
+void LogModel::flush() {
+	if (m_pending.isEmpty()) {
+		return;
+	}
+	if (m_lineLimit > 0) {
+		trim(m_lineLimit - m_pending.count());
+	}
+	int first = m_entries.count();
+	beginInsertRows(QModelIndex(), first, first + m_pending.count() - 1);
+	m_entries.append(m_pending);
+	endInsertRows();
+	m_pending.clear();
+}
+
+void LogModel::trim(int limit) {
+	int excess = m_entries.count() - limit;
+	if (excess <= 0) {
+		return;
+	}
+	beginRemoveRows(QModelIndex(), 0, excess - 1);
+	m_entries.erase(m_entries.begin(), m_entries.begin() + excess);
+	endRemoveRows();
+}
@@ -0,0 +1,49 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#pragma once
+
+#include <QAbstractListModel>
+#include <QList>
+#include <QTimer>
+
+namespace QGBA {
+
+class LogModel : public QAbstractListModel {
+Q_OBJECT
+
+public:
+	LogModel(QObject* parent = nullptr);
+
+	virtual QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+	virtual int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+
+	int lineLimit() const { return m_lineLimit; }
+	QString line(int row) const;
+
+public slots:
+	void postLog(int level, int category, const QString& log);
+	void setLineLimit(int limit);
+	void clear();
+
+private slots:
+	void flush();
+
+private:
+	struct Entry {
+		int level;
+		int category;
+		QString message;
+	};
+
+	void trim(int limit);
+
+	QList<Entry> m_entries;
+	QList<Entry> m_pending;
+	int m_lineLimit = 0;
+	QTimer m_flushTimer;
+};
+
+}
@@ -8,8 +8,12 @@
 #include "LogController.h"
 #include "Window.h"
 
-#include <QTextBlock>
-#include <QTextCursor>
+#include <QAction>
+#include <QApplication>
+#include <QClipboard>
+#include <QScrollBar>
+
+#include <algorithm>
 
 using namespace QGBA;
 
@@ -17,6 +21,27 @@ LogView::LogView(LogController* log, Window* window, QWidget* parent)
 	: QWidget(parent)
 {
 	m_ui.setupUi(this);
+	m_ui.view->setModel(&m_model);
+	m_model.setLineLimit(DEFAULT_LINE_LIMIT);
+
+	// Only follow new lines if the view was already scrolled to the end
+	connect(&m_model, &QAbstractItemModel::rowsAboutToBeInserted, this, [this]() {
+		QScrollBar* scrollBar = m_ui.view->verticalScrollBar();
+		m_followTail = scrollBar->value() == scrollBar->maximum();
+	});
+	connect(&m_model, &QAbstractItemModel::rowsInserted, this, [this]() {
+		if (m_followTail) {
+			m_ui.view->scrollToBottom();
+		}
+	});
+
+	QAction* copy = new QAction(tr("Copy"), m_ui.view);
+	copy->setShortcut(QKeySequence::Copy);
+	copy->setShortcutContext(Qt::WidgetShortcut);
+	connect(copy, &QAction::triggered, this, &LogView::copySelection);
+	m_ui.view->addAction(copy);
+	m_ui.view->setContextMenuPolicy(Qt::ActionsContextMenu);
+
 	connect(m_ui.levelDebug, &QAbstractButton::toggled, [this](bool set) {
 		setLevel(mLOG_DEBUG, set);
 	});
@@ -63,19 +88,12 @@ LogView::LogView(LogController* log, Window* window, QWidget* parent)
 }
 
 void LogView::postLog(int level, int category, const QString& log) {
-	QString line = QString("[%1] %2:\t%3").arg(LogController::toString(level)).arg(mLogCategoryName(category)).arg(log);
 	// TODO: Log to file
-	m_pendingLines.enqueue(line);
-	++m_lines;
-	if (m_lines > m_lineLimit) {
-		clearLine();
-	}
-	update();
+	m_model.postLog(level, category, log);
 }
 
 void LogView::clear() {
-	m_ui.view->clear();
-	m_lines = 0;
+	m_model.clear();
 }
 
 void LogView::setLevels(int levels) {
@@ -119,28 +137,18 @@ void LogView::setLevel(int level, bool set) {
 }
 
 void LogView::setMaxLines(int limit) {
-	m_lineLimit = limit;
-	while (m_lines > m_lineLimit) {
-		clearLine();
-	}
+	m_model.setLineLimit(limit);
 }
 
-void LogView::paintEvent(QPaintEvent* event) {
-	while (!m_pendingLines.isEmpty()) {
-		m_ui.view->appendPlainText(m_pendingLines.dequeue());
+void LogView::copySelection() {
+	QModelIndexList selection = m_ui.view->selectionModel()->selectedRows();
+	if (selection.isEmpty()) {
+		return;
 	}
-	QWidget::paintEvent(event);
-}
-
-void LogView::clearLine() {
-	if (m_ui.view->document()->isEmpty()) {
-		m_pendingLines.dequeue();
-	} else {
-		QTextCursor cursor(m_ui.view->document());
-		cursor.setPosition(0);
-		cursor.select(QTextCursor::BlockUnderCursor);
-		cursor.removeSelectedText();
-		cursor.deleteChar();
+	std::sort(selection.begin(), selection.end());
+	QStringList lines;
+	for (const QModelIndex& index : selection) {
+		lines.append(m_model.line(index.row()));
 	}
-	--m_lines;
+	QApplication::clipboard()->setText(lines.join('\n'));
 }
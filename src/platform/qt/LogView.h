@@ -5,9 +5,10 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #pragma once
 
-#include <QQueue>
 #include <QWidget>
 
+#include "LogModel.h"
+
 #include "ui_LogView.h"
 
 namespace QGBA {
@@ -32,21 +33,16 @@ public slots:
 
 private slots:
 	void setMaxLines(int);
-
-protected:
-	virtual void paintEvent(QPaintEvent*) override;
+	void copySelection();
 
 private:
 	static const int DEFAULT_LINE_LIMIT = 1000;
 
 	Ui::LogView m_ui;
-	int m_lines = 0;
-	int m_lineLimit = DEFAULT_LINE_LIMIT;
-	QQueue<QString> m_pendingLines;
+	LogModel m_model;
+	bool m_followTail = true;
 
 	void setLevel(int level, bool);
-
-	void clearLine();
 };
 
 }
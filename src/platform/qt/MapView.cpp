@@ -174,7 +174,8 @@ bool MapView::eventFilter(QObject*, QEvent* event) {
 	return true;
 }
 
-void MapView::updateTilesGBA(bool) {
+void MapView::updateTilesGBA(bool force) {
+	bool changed;
 	{
 		CoreController::Interrupter interrupter(m_controller);
 		int bitmap = -1;
@@ -241,13 +242,26 @@ void MapView::updateTilesGBA(bool) {
 			m_ui.bgInfo->setCustomProperty("priority", priority);
 			m_ui.bgInfo->setCustomProperty("offset", offset);
 			m_ui.bgInfo->setCustomProperty("transform", transform);
-			m_rawMap = QImage(QSize(width, height), QImage::Format_ARGB32);
-			uchar* bgBits = m_rawMap.bits();
+			// The image is reused between frames, so it has to be redrawn in full whenever it held something else
+			int source = bitmap * 2 + frame + 1;
+			if (m_rawMapSource != source || m_rawMap.size() != QSize(width, height) || m_rawMap.format() != QImage::Format_RGB32) {
+				m_rawMapSource = source;
+				m_rawMap = QImage(QSize(width, height), QImage::Format_RGB32);
+				force = true;
+			}
+			changed = force;
 			for (int j = 0; j < height; ++j) {
-				mBitmapCacheCleanRow(bitmapCache, m_bitmapStatus.data(), j);
-				memcpy(static_cast<void*>(&bgBits[width * j * 4]), mBitmapCacheGetRow(bitmapCache, j), width * 4);
+				if (!mBitmapCacheCleanRow(bitmapCache, m_bitmapStatus.data(), j) && !force) {
+					continue;
+				}
+				changed = true;
+				const mColor* row = mBitmapCacheGetRow(bitmapCache, j);
+				QRgb* out = reinterpret_cast<QRgb*>(m_rawMap.scanLine(j));
+				for (int i = 0; i < width; ++i) {
+					uint32_t color = row[i];
+					out[i] = 0xFF000000 | ((color & 0xFF) << 16) | (color & 0xFF00) | ((color >> 16) & 0xFF);
+				}
 			}
-			m_rawMap = m_rawMap.convertToFormat(QImage::Format_RGB32).rgbSwapped();
 		} else {
 			mMapCache* mapCache = mMapCacheSetGetPointer(&m_cacheSet->maps, m_map);
 			int tilesW = 1 << mMapCacheSystemInfoGetTilesWide(mapCache->sysConfig);
@@ -262,9 +276,16 @@ void MapView::updateTilesGBA(bool) {
 			m_ui.bgInfo->setCustomProperty("priority", priority);
 			m_ui.bgInfo->setCustomProperty("offset", offset);
 			m_ui.bgInfo->setCustomProperty("transform", transform);
-			m_rawMap = compositeMap(m_map, &m_mapStatus);
+			if (m_rawMapSource != -1 - m_map) {
+				m_rawMapSource = -1 - m_map;
+				force = true;
+			}
+			changed = updateMap(m_map, &m_mapStatus, &m_rawMap, force);
 		}
 	}
+	if (!changed) {
+		return;
+	}
 	QPixmap map = QPixmap::fromImage(m_rawMap.convertToFormat(QImage::Format_RGB32));
 	if (m_ui.magnification->value() > 1) {
 		map = map.scaled(map.size() * m_ui.magnification->value());
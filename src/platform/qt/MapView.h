@@ -47,6 +47,7 @@ private:
 	QVector<mBitmapCacheEntry> m_bitmapStatus{512 * 2}; // TODO: Correct size
 	int m_map = 0;
 	QImage m_rawMap;
+	int m_rawMapSource = 0;
 	int m_boundary;
 	int m_addressBase;
 	int m_addressWidth;
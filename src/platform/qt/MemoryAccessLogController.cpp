@@ -83,6 +83,7 @@ void MemoryAccessLogController::start(bool loadExisting, bool logExtra) {
 		return;
 	}
 	CoreController::Interrupter interrupter(m_controller);
+	mDebuggerAccessLoggerSetBatched(&m_logger, true);
 	mDebuggerAccessLoggerStart(&m_logger);
 	m_logExtra = logExtra;
 
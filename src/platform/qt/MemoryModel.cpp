@@ -17,6 +17,7 @@
 #include <QFileInfo>
 #include <QFontMetrics>
 #include <QPainter>
+#include <QPaintEvent>
 #include <QScrollBar>
 #include <QSlider>
 #include <QWheelEvent>
@@ -24,6 +25,8 @@
 #include <mgba/core/core.h>
 #include <mgba-util/vfs.h>
 
+#include <algorithm>
+
 using namespace QGBA;
 
 MemoryModel::MemoryModel(QWidget* parent)
@@ -120,6 +123,7 @@ MemoryModel::MemoryModel(QWidget* parent)
 
 void MemoryModel::setController(std::shared_ptr<CoreController> controller) {
 	m_core = controller->thread()->core;
+	m_snapshotRows = -1;
 }
 
 void MemoryModel::setRegion(uint32_t base, uint32_t size, const QString& name, int segment) {
@@ -303,6 +307,7 @@ void MemoryModel::deserialize(const QByteArray& bytes) {
 		}
 		break;
 	}
+	takeSnapshot();
 }
 
 QString MemoryModel::decodeText(const QByteArray& bytes) {
@@ -343,7 +348,91 @@ void MemoryModel::resizeEvent(QResizeEvent*) {
 	boundsCheck();
 }
 
-void MemoryModel::paintEvent(QPaintEvent*) {
+int MemoryModel::visibleRows() const {
+	int height = (viewport()->size().height() - m_cellHeight) / m_cellHeight;
+	if (height < 0) {
+		return 0;
+	}
+	uint32_t rows = (m_size + 15) / 16;
+	if (static_cast<uint32_t>(m_top) >= rows) {
+		return 0;
+	}
+	rows -= m_top;
+	return rows < static_cast<uint32_t>(height) ? rows : height;
+}
+
+QByteArray MemoryModel::readVisible() const {
+	uint32_t start = m_top * 16 + m_base;
+	uint32_t end = start + visibleRows() * 16;
+	if (end > m_base + m_size) {
+		end = m_base + m_size;
+	}
+	QByteArray bytes;
+	bytes.resize((end - start + m_align - 1) & ~(m_align - 1));
+	uint8_t* out = reinterpret_cast<uint8_t*>(bytes.data());
+	// Read with the same access width as the cells are shown with, since I/O registers
+	// don't necessarily read the same byte by byte
+	switch (m_align) {
+	case 1:
+		for (uint32_t address = start; address < end; ++address, ++out) {
+			*out = m_core->rawRead8(m_core, address, m_currentBank);
+		}
+		break;
+	case 2:
+		for (uint32_t address = start; address < end; address += 2, out += 2) {
+			STORE_16LE(m_core->rawRead16(m_core, address, m_currentBank), 0, out);
+		}
+		break;
+	case 4:
+		for (uint32_t address = start; address < end; address += 4, out += 4) {
+			STORE_32LE(m_core->rawRead32(m_core, address, m_currentBank), 0, out);
+		}
+		break;
+	}
+	return bytes;
+}
+
+bool MemoryModel::isSnapshotCurrent() const {
+	return m_snapshotStart == m_top * 16 + m_base && m_snapshotRows == visibleRows() &&
+	       m_snapshotBank == m_currentBank && m_snapshotAlign == m_align;
+}
+
+void MemoryModel::takeSnapshot() {
+	m_snapshot = readVisible();
+	m_snapshotStart = m_top * 16 + m_base;
+	m_snapshotRows = visibleRows();
+	m_snapshotBank = m_currentBank;
+	m_snapshotAlign = m_align;
+}
+
+void MemoryModel::refresh() {
+	if (!m_core) {
+		return;
+	}
+	if (!isSnapshotCurrent()) {
+		takeSnapshot();
+		viewport()->update();
+		return;
+	}
+	QByteArray bytes(readVisible());
+	QRegion dirty;
+	for (int offset = 0; offset < bytes.size(); offset += 16) {
+		int size = std::min(16, static_cast<int>(bytes.size()) - offset);
+		if (memcmp(&bytes.constData()[offset], &m_snapshot.constData()[offset], size) != 0) {
+			dirty += QRect(0, m_cellHeight * (offset / 16) + m_margins.top(), viewport()->size().width(), m_cellHeight);
+		}
+	}
+	m_snapshot = bytes;
+	if (!dirty.isEmpty()) {
+		viewport()->update(dirty);
+	}
+}
+
+void MemoryModel::paintEvent(QPaintEvent* event) {
+	if (!isSnapshotCurrent()) {
+		takeSnapshot();
+	}
+	const uint8_t* snapshot = reinterpret_cast<const uint8_t*>(m_snapshot.constData());
 	QPainter painter(viewport());
 	QPalette palette;
 	painter.setFont(m_font);
@@ -359,12 +448,12 @@ void MemoryModel::paintEvent(QPaintEvent*) {
 		painter.drawText(QRectF(QPointF(m_cellSize.width() * x + m_margins.left(), 0), m_cellSize), Qt::AlignHCenter,
 		                 QString::number(x, 16).toUpper());
 	}
-	int height = (viewport()->size().height() - m_cellHeight) / m_cellHeight;
-	for (int y = 0; y < height; ++y) {
+	for (int y = 0; y < m_snapshotRows; ++y) {
 		int yp = m_cellHeight * y + m_margins.top();
-		if ((y + m_top) * 16U >= m_size) {
-			break;
+		if (!event->rect().intersects(QRect(0, yp, viewport()->size().width(), m_cellHeight))) {
+			continue;
 		}
+		const uint8_t* row = &snapshot[y * 16];
 		QString data;
 		if (m_currentBank >= 0) {
 			data = arg2.arg(m_currentBank, 2, 16, c0).arg((y + m_top) * 16 + m_base, 4, 16, c0).toUpper();
@@ -393,12 +482,11 @@ void MemoryModel::paintEvent(QPaintEvent*) {
 				} else {
 					painter.setPen(palette.color(QPalette::WindowText));
 				}
-				uint16_t b = m_core->rawRead16(m_core, address, m_currentBank);
 				painter.drawStaticText(
 				    QPointF(m_cellSize.width() * (x + 1.0) - 2 * m_letterWidth + m_margins.left(), yp),
-				    m_staticNumbers[(b >> 8) & 0xFF]);
+				    m_staticNumbers[row[x + 1]]);
 				painter.drawStaticText(QPointF(m_cellSize.width() * (x + 1.0) + m_margins.left(), yp),
-				                       m_staticNumbers[b & 0xFF]);
+				                       m_staticNumbers[row[x]]);
 			}
 			break;
 		case 4:
@@ -421,18 +509,17 @@ void MemoryModel::paintEvent(QPaintEvent*) {
 				} else {
 					painter.setPen(palette.color(QPalette::WindowText));
 				}
-				uint32_t b = m_core->rawRead32(m_core, address, m_currentBank);
 				painter.drawStaticText(
 				    QPointF(m_cellSize.width() * (x + 2.0) - 4 * m_letterWidth + m_margins.left(), yp),
-				    m_staticNumbers[(b >> 24) & 0xFF]);
+				    m_staticNumbers[row[x + 3]]);
 				painter.drawStaticText(
 				    QPointF(m_cellSize.width() * (x + 2.0) - 2 * m_letterWidth + m_margins.left(), yp),
-				    m_staticNumbers[(b >> 16) & 0xFF]);
+				    m_staticNumbers[row[x + 2]]);
 				painter.drawStaticText(QPointF(m_cellSize.width() * (x + 2.0) + m_margins.left(), yp),
-				                       m_staticNumbers[(b >> 8) & 0xFF]);
+				                       m_staticNumbers[row[x + 1]]);
 				painter.drawStaticText(
 				    QPointF(m_cellSize.width() * (x + 2.0) + 2 * m_letterWidth + m_margins.left(), yp),
-				    m_staticNumbers[b & 0xFF]);
+				    m_staticNumbers[row[x]]);
 			}
 			break;
 		case 1:
@@ -454,34 +541,17 @@ void MemoryModel::paintEvent(QPaintEvent*) {
 				} else {
 					painter.setPen(palette.color(QPalette::WindowText));
 				}
-				uint8_t b = m_core->rawRead8(m_core, address, m_currentBank);
 				painter.drawStaticText(QPointF(m_cellSize.width() * (x + 0.5) - m_letterWidth + m_margins.left(), yp),
-				                       m_staticNumbers[b]);
+				                       m_staticNumbers[row[x]]);
 			}
 			break;
 		}
 		painter.setPen(palette.color(QPalette::WindowText));
 		for (int x = 0; x < 16; x += m_align) {
-			QByteArray array;
-			uint32_t b;
-			switch (m_align) {
-			case 1:
-				b = m_core->rawRead8(m_core, (y + m_top) * 16 + x + m_base, m_currentBank);
-				array.append((char) b);
-				break;
-			case 2:
-				b = m_core->rawRead16(m_core, (y + m_top) * 16 + x + m_base, m_currentBank);
-				array.append((char) b);
-				array.append((char) (b >> 8));
-				break;
-			case 4:
-				b = m_core->rawRead32(m_core, (y + m_top) * 16 + x + m_base, m_currentBank);
-				array.append((char) b);
-				array.append((char) (b >> 8));
-				array.append((char) (b >> 16));
-				array.append((char) (b >> 24));
+			if (y * 16 + x >= m_snapshot.size()) {
 				break;
 			}
+			QByteArray array(reinterpret_cast<const char*>(&row[x]), m_align);
 			QString unfilteredText = decodeText(array);
 			QString text;
 			if (unfilteredText.isEmpty()) {
@@ -642,6 +712,7 @@ void MemoryModel::keyPressEvent(QKeyEvent* event) {
 			m_core->rawWrite32(m_core, m_selection.first, m_currentBank, m_buffer);
 			break;
 		}
+		takeSnapshot();
 		m_bufferedNybbles = 0;
 		m_buffer = 0;
 		m_selection.first += m_align;
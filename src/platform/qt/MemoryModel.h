@@ -51,6 +51,8 @@ public slots:
 	void save();
 	void load();
 
+	void refresh();
+
 signals:
 	void selectionChanged(uint32_t start, uint32_t end);
 
@@ -65,6 +67,11 @@ protected:
 private:
 	void boundsCheck();
 
+	int visibleRows() const;
+	QByteArray readVisible() const;
+	bool isSnapshotCurrent() const;
+	void takeSnapshot();
+
 	bool isInSelection(uint32_t address);
 	bool isEditing(uint32_t address);
 	void drawEditingText(QPainter& painter, const QPointF& origin);
@@ -96,6 +103,13 @@ private:
 	uint32_t m_buffer;
 	int m_bufferedNybbles;
 	int m_currentBank;
+
+	// Visible memory as of the last refresh, stored little-endian one row of 16 bytes at a time
+	QByteArray m_snapshot;
+	uint32_t m_snapshotStart = 0;
+	int m_snapshotRows = 0;
+	int m_snapshotBank = -1;
+	int m_snapshotAlign = 0;
 };
 
 }
@@ -20,6 +20,7 @@ MemorySearch::MemorySearch(std::shared_ptr<CoreController> controller, QWidget*
 	m_ui.setupUi(this);
 
 	mCoreMemorySearchResultsInit(&m_results, 0);
+	mCoreMemorySearchCandidatesInit(&m_candidates);
 	connect(m_ui.search, &QPushButton::clicked, this, &MemorySearch::search);
 	connect(m_ui.value, &QLineEdit::returnPressed, this, &MemorySearch::search);
 	connect(m_ui.searchWithin, &QPushButton::clicked, this, &MemorySearch::searchWithin);
@@ -31,6 +32,7 @@ MemorySearch::MemorySearch(std::shared_ptr<CoreController> controller, QWidget*
 
 MemorySearch::~MemorySearch() {
 	mCoreMemorySearchResultsDeinit(&m_results);
+	mCoreMemorySearchCandidatesDeinit(&m_candidates);
 }
 
 bool MemorySearch::createParams(mCoreMemorySearchParams* params) {
@@ -133,6 +135,7 @@ bool MemorySearch::createParams(mCoreMemorySearchParams* params) {
 
 void MemorySearch::search() {
 	mCoreMemorySearchResultsClear(&m_results);
+	mCoreMemorySearchCandidatesClear(&m_candidates);
 
 	mCoreMemorySearchParams params;
 
@@ -140,7 +143,12 @@ void MemorySearch::search() {
 	mCore* core = m_controller->thread()->core;
 
 	if (createParams(&params)) {
-		mCoreMemorySearch(core, &params, &m_results, LIMIT);
+		// Integer searches keep every candidate, so only the first few need to be listed
+		if (mCoreMemorySearchCandidatesSearch(core, &params, &m_candidates)) {
+			mCoreMemorySearchCandidatesResults(&m_candidates, &m_results, 0, LIMIT);
+		} else {
+			mCoreMemorySearch(core, &params, &m_results, LIMIT);
+		}
 	}
 
 	refresh();
@@ -156,7 +164,14 @@ void MemorySearch::searchWithin() {
 		if (m_ui.opUnknown->isChecked()) {
 			params.op = mCORE_MEMORY_SEARCH_DELTA_ANY;
 		}
-		mCoreMemorySearchRepeat(core, &params, &m_results);
+		if (m_candidates.width && params.type == mCORE_MEMORY_SEARCH_INT) {
+			mCoreMemorySearchCandidatesNarrow(core, &params, &m_candidates);
+			mCoreMemorySearchResultsClear(&m_results);
+			mCoreMemorySearchCandidatesResults(&m_candidates, &m_results, 0, LIMIT);
+		} else {
+			mCoreMemorySearchCandidatesClear(&m_candidates);
+			mCoreMemorySearchRepeat(core, &params, &m_results);
+		}
 	}
 
 	refresh();
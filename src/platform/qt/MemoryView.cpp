@@ -11,6 +11,9 @@
 #include "MemoryDump.h"
 
 #include <mgba/core/core.h>
+#ifdef ENABLE_DEBUGGERS
+#include <mgba/internal/debugger/symbols.h>
+#endif
 
 using namespace QGBA;
 
@@ -208,6 +211,8 @@ MemoryView::MemoryView(std::shared_ptr<CoreController> controller, QWidget* pare
 	m_ui.accessLog->setModel(&m_malModel);
 #else
 	m_ui.accessLog->hide();
+	m_ui.symbolLabel->hide();
+	m_ui.symbolVal->hide();
 #endif
 }
 
@@ -246,7 +251,7 @@ void MemoryView::setSegment(int segment) {
 }
 
 void MemoryView::update() {
-	m_ui.hexfield->viewport()->update();
+	m_ui.hexfield->refresh();
 	updateStatus();
 #ifdef ENABLE_DEBUGGERS
 	m_malModel.update();
@@ -277,6 +282,20 @@ void MemoryView::updateStatus() {
 	QString text(m_ui.hexfield->decodeText(selection));
 	m_ui.stringVal->setPlainText(text);
 
+#ifdef ENABLE_DEBUGGERS
+	QString symbol;
+	if (core->symbolTable) {
+		uint32_t offset;
+		const char* name = mDebuggerSymbolNearest(core->symbolTable, m_selection.first, m_ui.segments->value(), &offset);
+		if (name && offset) {
+			symbol = QString("%1+0x%2").arg(QString::fromUtf8(name)).arg(offset, 0, 16);
+		} else if (name) {
+			symbol = QString::fromUtf8(name);
+		}
+	}
+	m_ui.symbolVal->setText(symbol);
+#endif
+
 	if (m_selection.first & (align - 1) || m_selection.second - m_selection.first != align) {
 		m_ui.sintVal->clear();
 		m_ui.sintVal->setReadOnly(true);
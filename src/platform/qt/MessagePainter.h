@@ -30,14 +30,20 @@ public slots:
 	void showFrameCounter(uint64_t);
 	void clearFrameCounter();
 
+	void showPresentStats(const QString&);
+	void clearPresentStats();
+
 private:
 	void redraw();
+	void drawCornerText(QPainter* painter, const QString& text, int line);
 
 	QMutex m_mutex;
 	QStaticText m_message;
 	qreal m_scaleFactor = 1;
 	uint64_t m_frameCounter;
 	bool m_drawFrameCounter = false;
+	QString m_presentStats;
+	bool m_drawPresentStats = false;
 
 	QPoint m_local;
 	QPixmap m_pixmap;
@@ -210,6 +210,9 @@ bool MultiplayerController::attachGame(CoreController* controller) {
 #ifdef M_CORE_GBA
 		case mPLATFORM_GBA:
 			GBASIOLockstepCoordinatorInit(&m_gbaCoordinator);
+			if (m_maxSkew) {
+				GBASIOLockstepCoordinatorSetMaxSkew(&m_gbaCoordinator, m_maxSkew);
+			}
 			break;
 #endif
 #ifdef M_CORE_GB
@@ -458,6 +461,15 @@ int MultiplayerController::saveId(CoreController* controller) const {
 	return -1;
 }
 
+void MultiplayerController::setMaxSkew(int32_t cycles) {
+	m_maxSkew = cycles;
+#ifdef M_CORE_GBA
+	if (m_platform == mPLATFORM_GBA) {
+		GBASIOLockstepCoordinatorSetMaxSkew(&m_gbaCoordinator, cycles);
+	}
+#endif
+}
+
 int MultiplayerController::attached() {
 	int num = 0;
 	switch (m_platform) {
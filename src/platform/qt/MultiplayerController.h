@@ -42,6 +42,8 @@ public:
 	int playerId(CoreController*) const;
 	int saveId(CoreController*) const;
 
+	void setMaxSkew(int32_t cycles);
+
 signals:
 	void gameAttached();
 	void gameDetached();
@@ -87,6 +89,7 @@ private:
 #endif
 
 	mPlatform m_platform = mPLATFORM_NONE;
+	int32_t m_maxSkew = 0;
 	int m_nextPid = 0;
 	int m_claimedIds = 0;
 	QHash<int, Player> m_pids;
@@ -208,6 +208,7 @@ void OverrideView::updateOverrides() {
 #ifdef M_CORE_GB
 	if (m_ui.tabWidget->currentWidget() == m_ui.tabGB) {
 		auto gb = std::make_unique<GBOverride>();
+		gb->override.idleLoop = GB_IDLE_LOOP_NONE;
 		gb->override.mbc = static_cast<GBMemoryBankControllerType>(m_ui.mbc->currentData().toInt());
 		gb->override.model = static_cast<GBModel>(m_ui.gbModel->currentData().toInt());
 		hasOverride = gb->override.mbc != GB_MBC_AUTODETECT || gb->override.model != GB_MODEL_AUTODETECT;
@@ -30,7 +30,14 @@ PaletteView::PaletteView(std::shared_ptr<CoreController> controller, QWidget* pa
 {
 	m_ui.setupUi(this);
 
-	connect(controller.get(), &CoreController::frameAvailable, this, &PaletteView::updatePalette);
+	connect(controller.get(), &CoreController::stateChanged, this, [this](int dirty) {
+		if (dirty & mCORE_DIRTY_PALETTE) {
+			updatePalette();
+		}
+	});
+	connect(controller.get(), &CoreController::stateLoaded, this, &PaletteView::updatePalette);
+	connect(controller.get(), &CoreController::rewound, this, &PaletteView::updatePalette);
+	connect(controller.get(), &CoreController::didReset, this, &PaletteView::updatePalette);
 	m_ui.bgGrid->setDimensions(QSize(16, 16));
 	m_ui.objGrid->setDimensions(QSize(16, 16));
 	int count = 256;
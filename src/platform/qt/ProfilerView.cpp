@@ -0,0 +1,162 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "ProfilerView.h"
+
+#include <QMessageBox>
+
+#include "CoreController.h"
+#include "GBAApp.h"
+#include "VFileDevice.h"
+
+using namespace QGBA;
+
+// Showing every address of a game without symbols would make the list unusably slow
+static const size_t MAX_ROWS = 500;
+
+ProfilerView::ProfilerView(std::shared_ptr<CoreController> controller, QWidget* parent)
+	: QWidget(parent)
+	, m_controller(controller)
+{
+	m_ui.setupUi(this);
+
+	mDebuggerProfilerInit(&m_profiler);
+	m_controller->attachDebuggerModule(&m_profiler.d, false);
+
+	connect(m_ui.start, &QAbstractButton::clicked, this, &ProfilerView::start);
+	connect(m_ui.stop, &QAbstractButton::clicked, this, &ProfilerView::stop);
+	connect(m_ui.clear, &QAbstractButton::clicked, this, &ProfilerView::clear);
+	connect(m_ui.exportButton, &QAbstractButton::clicked, this, &ProfilerView::exportFile);
+
+	m_refreshTimer.setInterval(1000);
+	connect(&m_refreshTimer, &QTimer::timeout, this, &ProfilerView::refresh);
+}
+
+ProfilerView::~ProfilerView() {
+	CoreController::Interrupter interrupter(m_controller.get());
+	m_controller->detachDebuggerModule(&m_profiler.d);
+	mDebuggerProfilerDeinit(&m_profiler);
+}
+
+void ProfilerView::start() {
+	bool started;
+	{
+		CoreController::Interrupter interrupter(m_controller.get());
+		mDebuggerProfilerClear(&m_profiler);
+		started = mDebuggerProfilerStart(&m_profiler, m_ui.period->value());
+	}
+	if (!started) {
+		QMessageBox::warning(this, tr("Profiler"), tr("Profiling is not supported for this platform."));
+		return;
+	}
+	m_ui.start->setEnabled(false);
+	m_ui.stop->setEnabled(true);
+	m_ui.period->setEnabled(false);
+	m_refreshTimer.start();
+	refresh();
+}
+
+void ProfilerView::stop() {
+	{
+		CoreController::Interrupter interrupter(m_controller.get());
+		mDebuggerProfilerStop(&m_profiler);
+	}
+	m_ui.start->setEnabled(true);
+	m_ui.stop->setEnabled(false);
+	m_ui.period->setEnabled(true);
+	m_refreshTimer.stop();
+	refresh();
+}
+
+void ProfilerView::clear() {
+	{
+		CoreController::Interrupter interrupter(m_controller.get());
+		mDebuggerProfilerClear(&m_profiler);
+	}
+	refresh();
+}
+
+void ProfilerView::refresh() {
+	struct Row {
+		QString name;
+		uint32_t address;
+		uint64_t self;
+		uint64_t total;
+	};
+	QList<Row> rows;
+	uint64_t nSamples;
+	size_t nFunctions;
+	{
+		// Names belong to the symbol table, so copy them out before the core runs again
+		CoreController::Interrupter interrupter(m_controller.get());
+		mDebuggerProfilerEntryList entries;
+		mDebuggerProfilerEntryListInit(&entries, 0);
+		mDebuggerProfilerHistogram(&m_profiler, &entries);
+		nSamples = m_profiler.nSamples;
+		nFunctions = mDebuggerProfilerEntryListSize(&entries);
+		for (size_t i = 0; i < nFunctions && i < MAX_ROWS; ++i) {
+			const mDebuggerProfilerEntry* entry = mDebuggerProfilerEntryListGetConstPointer(&entries, i);
+			rows.append({
+				entry->name ? QString::fromUtf8(entry->name) : QString(),
+				entry->address,
+				entry->self,
+				entry->total
+			});
+		}
+		mDebuggerProfilerEntryListDeinit(&entries);
+	}
+
+	if (!nSamples) {
+		m_ui.samples->setText(tr("No samples"));
+	} else {
+		m_ui.samples->setText(tr("%1 samples in %2 functions").arg(nSamples).arg(nFunctions));
+	}
+
+	m_ui.functions->clear();
+	QList<QTreeWidgetItem*> items;
+	for (const Row& row : rows) {
+		QTreeWidgetItem* item = new QTreeWidgetItem;
+		QString address = QString("%1").arg(row.address, 8, 16, QChar('0')).toUpper();
+		item->setText(0, row.name.isNull() ? tr("(unknown)") : row.name);
+		item->setText(1, address);
+		item->setText(2, QString::number(row.self));
+		item->setText(3, QString::number(row.self * 100.0 / nSamples, 'f', 2));
+		item->setText(4, QString::number(row.total * 100.0 / nSamples, 'f', 2));
+		for (int column = 2; column <= 4; ++column) {
+			item->setTextAlignment(column, Qt::AlignRight | Qt::AlignVCenter);
+		}
+		items.append(item);
+	}
+	m_ui.functions->addTopLevelItems(items);
+}
+
+void ProfilerView::exportFile() {
+	QString pprofFilter = tr("pprof profile (*.pb *.pprof)");
+	QString foldedFilter = tr("Folded stacks for flame graphs (*.folded *.txt)");
+	QString filename = GBAApp::app()->getSaveFileName(this, tr("Export profile"), foldedFilter + ";;" + pprofFilter);
+	if (filename.isEmpty()) {
+		return;
+	}
+	bool pprof = filename.endsWith(".pb") || filename.endsWith(".pprof");
+
+	VFile* vf = VFileDevice::open(filename, O_CREAT | O_TRUNC | O_WRONLY);
+	if (!vf) {
+		QMessageBox::warning(this, tr("Profiler"), tr("Could not open %1 for writing.").arg(filename));
+		return;
+	}
+	bool success;
+	{
+		CoreController::Interrupter interrupter(m_controller.get());
+		if (pprof) {
+			success = mDebuggerProfilerWritePprof(&m_profiler, vf);
+		} else {
+			success = mDebuggerProfilerWriteFolded(&m_profiler, vf);
+		}
+	}
+	vf->close(vf);
+	if (!success) {
+		QMessageBox::warning(this, tr("Profiler"), tr("Could not write the profile to %1.").arg(filename));
+	}
+}
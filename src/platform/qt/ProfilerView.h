@@ -0,0 +1,43 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#pragma once
+
+#include <QTimer>
+#include <QWidget>
+
+#include <memory>
+
+#include <mgba/internal/debugger/profiler.h>
+
+#include "ui_ProfilerView.h"
+
+namespace QGBA {
+
+class CoreController;
+
+class ProfilerView : public QWidget {
+Q_OBJECT
+
+public:
+	ProfilerView(std::shared_ptr<CoreController> controller, QWidget* parent = nullptr);
+	~ProfilerView();
+
+private slots:
+	void start();
+	void stop();
+	void clear();
+	void refresh();
+	void exportFile();
+
+private:
+	Ui::ProfilerView m_ui;
+
+	std::shared_ptr<CoreController> m_controller;
+	struct mDebuggerProfiler m_profiler;
+	QTimer m_refreshTimer;
+};
+
+}
@@ -497,6 +497,8 @@ void SettingsView::updateConfig() {
 	saveSetting("sampleRate", m_ui.sampleRate);
 	saveSetting("videoSync", m_ui.videoSync);
 	saveSetting("audioSync", m_ui.audioSync);
+	saveSetting("frameLimiter", m_ui.frameLimiter);
+	saveSetting("lowLatencyPresent", m_ui.lowLatencyPresent);
 	saveSetting("frameskip", m_ui.frameskip);
 	saveSetting("autofireThreshold", m_ui.autofireThreshold);
 	saveSetting("lockAspectRatio", m_ui.lockAspectRatio);
@@ -504,6 +506,7 @@ void SettingsView::updateConfig() {
 	saveSetting("interframeBlending", m_ui.interframeBlending);
 	saveSetting("showOSD", m_ui.showOSD);
 	saveSetting("showFrameCounter", m_ui.showFrameCounter);
+	saveSetting("showPresentStats", m_ui.showPresentStats);
 	saveSetting("showResetInfo", m_ui.showResetInfo);
 	saveSetting("volume", m_ui.volume);
 	saveSetting("mute", m_ui.mute);
@@ -591,6 +594,8 @@ void SettingsView::updateConfig() {
 	saveState |= m_ui.saveStateScreenshot->isChecked() ? SAVESTATE_SCREENSHOT : 0;
 	saveState |= m_ui.saveStateSave->isChecked() ? SAVESTATE_SAVEDATA : 0;
 	saveState |= m_ui.saveStateCheats->isChecked() ? SAVESTATE_CHEATS : 0;
+	// Only set from the config file for now, so keep it as it was
+	saveState |= loadSetting("saveStateExtdata").toInt() & SAVESTATE_SECTIONED;
 	saveSetting("saveStateExtdata", saveState);
 
 	QVariant audioDriver = m_ui.audioDriver->itemData(m_ui.audioDriver->currentIndex());
@@ -720,6 +725,8 @@ void SettingsView::reloadConfig() {
 	loadSetting("sampleRate", m_ui.sampleRate);
 	loadSetting("videoSync", m_ui.videoSync);
 	loadSetting("audioSync", m_ui.audioSync);
+	loadSetting("frameLimiter", m_ui.frameLimiter);
+	loadSetting("lowLatencyPresent", m_ui.lowLatencyPresent);
 	loadSetting("frameskip", m_ui.frameskip);
 	loadSetting("fpsTarget", m_ui.fpsTarget);
 	loadSetting("autofireThreshold", m_ui.autofireThreshold);
@@ -728,6 +735,7 @@ void SettingsView::reloadConfig() {
 	loadSetting("interframeBlending", m_ui.interframeBlending);
 	loadSetting("showOSD", m_ui.showOSD, true);
 	loadSetting("showFrameCounter", m_ui.showFrameCounter);
+	loadSetting("showPresentStats", m_ui.showPresentStats);
 	loadSetting("showResetInfo", m_ui.showResetInfo);
 	loadSetting("volume", m_ui.volume, 0x100);
 	loadSetting("mute", m_ui.mute, false);
@@ -0,0 +1,52 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "StartupTrace.h"
+
+#include <cstdio>
+
+using namespace QGBA;
+
+QElapsedTimer StartupTrace::s_timer;
+QList<QPair<const char*, qint64>> StartupTrace::s_marks;
+bool StartupTrace::s_enabled = false;
+bool StartupTrace::s_running = false;
+
+void StartupTrace::begin() {
+	s_marks.clear();
+	s_timer.start();
+	s_running = true;
+}
+
+void StartupTrace::setEnabled(bool enabled) {
+	s_enabled = enabled;
+}
+
+void StartupTrace::mark(const char* step) {
+	if (!s_running) {
+		return;
+	}
+	s_marks.append(qMakePair(step, s_timer.nsecsElapsed()));
+}
+
+void StartupTrace::finish(const char* step) {
+	if (!s_running) {
+		return;
+	}
+	mark(step);
+	s_running = false;
+	if (!s_enabled) {
+		return;
+	}
+
+	fprintf(stderr, "Startup trace:\n");
+	qint64 last = 0;
+	for (const auto& mark : s_marks) {
+		fprintf(stderr, "  %-28s %9.2f ms  (+%.2f ms)\n", mark.first, mark.second / 1e6, (mark.second - last) / 1e6);
+		last = mark.second;
+	}
+	fflush(stderr);
+	s_marks.clear();
+}
@@ -0,0 +1,31 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#pragma once
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QPair>
+
+namespace QGBA {
+
+class StartupTrace {
+public:
+	static void begin();
+	static void setEnabled(bool enabled);
+
+	static bool isRunning() { return s_running; }
+
+	static void mark(const char* step);
+	static void finish(const char* step);
+
+private:
+	static QElapsedTimer s_timer;
+	static QList<QPair<const char*, qint64>> s_marks;
+	static bool s_enabled;
+	static bool s_running;
+};
+
+}
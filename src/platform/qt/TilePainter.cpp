@@ -19,9 +19,9 @@ TilePainter::TilePainter(QWidget* parent)
 	setTileCount(3072);
 }
 
-void TilePainter::paintEvent(QPaintEvent*) {
+void TilePainter::paintEvent(QPaintEvent* event) {
 	QPainter painter(this);
-	painter.drawPixmap(QPoint(), m_backing);
+	painter.drawImage(event->rect(), m_backing, event->rect());
 }
 
 void TilePainter::resizeEvent(QResizeEvent*) {
@@ -32,7 +32,7 @@ void TilePainter::resizeEvent(QResizeEvent*) {
 	int calculatedHeight = (m_tileCount + w - 1) * m_size / w;
 	calculatedHeight -= calculatedHeight % m_size;
 	if (width() / m_size != m_backing.width() / m_size || m_backing.height() != calculatedHeight) {
-		m_backing = QPixmap(width(), calculatedHeight);
+		m_backing = QImage(width(), calculatedHeight, QImage::Format_ARGB32);
 		m_backing.fill(Qt::transparent);
 		emit needsRedraw();
 	}
@@ -63,14 +63,25 @@ void TilePainter::clearTile(int index) {
 }
 
 void TilePainter::setTile(int index, const mColor* data) {
-	QPainter painter(&m_backing);
 	int w = width() / m_size;
 	int x = index % w;
 	int y = index / w;
 	QRect r(x * m_size, y * m_size, m_size, m_size);
-	QImage tile(reinterpret_cast<const uchar*>(data), 8, 8, QImage::Format_ARGB32);
-	tile = tile.convertToFormat(QImage::Format_RGB32).rgbSwapped();
-	painter.drawImage(r, tile);
+	QRect clipped = r.intersected(m_backing.rect());
+	if (clipped.isEmpty()) {
+		return;
+	}
+	// Write straight into the backing instead of going through a QPainter, since this
+	// gets called for every tile that changed each frame
+	int scale = m_size / 8;
+	for (int ty = clipped.top(); ty <= clipped.bottom(); ++ty) {
+		const mColor* row = &data[(ty - r.top()) / scale * 8];
+		QRgb* out = reinterpret_cast<QRgb*>(m_backing.scanLine(ty));
+		for (int tx = clipped.left(); tx <= clipped.right(); ++tx) {
+			uint32_t color = row[(tx - r.left()) / scale];
+			out[tx] = 0xFF000000 | ((color & 0xFF) << 16) | (color & 0xFF00) | ((color >> 16) & 0xFF);
+		}
+	}
 	update(r);
 }
 
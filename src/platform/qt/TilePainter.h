@@ -6,6 +6,7 @@
 #pragma once
 
 #include <QColor>
+#include <QImage>
 #include <QWidget>
 #include <QVector>
 
@@ -19,7 +20,7 @@ Q_OBJECT
 public:
 	TilePainter(QWidget* parent = nullptr);
 
-	QPixmap backing() const { return m_backing; }
+	QPixmap backing() const { return QPixmap::fromImage(m_backing); }
 
 public slots:
 	void clearTile(int index);
@@ -37,7 +38,7 @@ protected:
 	void resizeEvent(QResizeEvent*) override;
 
 private:
-	QPixmap m_backing{256, 768};
+	QImage m_backing{256, 768, QImage::Format_ARGB32};
 	int m_size = 8;
 	int m_tileCount;
 };
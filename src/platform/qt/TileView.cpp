@@ -22,6 +22,7 @@ TileView::TileView(std::shared_ptr<CoreController> controller, QWidget* parent)
 	: AssetView(controller, parent)
 	, m_controller(controller)
 {
+	m_dirtyMask = mCORE_DIRTY_VRAM | mCORE_DIRTY_PALETTE;
 	m_ui.setupUi(this);
 	m_ui.tile->setController(controller);
 
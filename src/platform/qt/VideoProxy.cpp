@@ -55,11 +55,22 @@ void VideoProxy::attach(CoreController* controller) {
 void VideoProxy::detach(CoreController* controller) {
 	CoreController::Interrupter interrupter(controller);
 	if (controller->thread()->core->videoLogger == &m_logger) {
+		commitBatch();
 		m_logContext = nullptr;
 		controller->thread()->core->videoLogger = nullptr;
 	}
 }
 
+void VideoProxy::setBatched(bool batched) {
+	if (m_batched == batched) {
+		return;
+	}
+	// Batches are read before m_dirtyQueue, so whatever is already queued has to be
+	// replayed before switching
+	wait();
+	m_batched = batched;
+}
+
 void VideoProxy::setProxiedBackend(VideoBackend* backend) {
 	// TODO: This needs some safety around it
 	m_backend.backend = backend;
@@ -82,6 +93,12 @@ void VideoProxy::init() {
 void VideoProxy::reset() {
 	QMutexLocker locker(&m_mutex);
 	RingFIFOClear(&m_dirtyQueue);
+	m_batch.clear();
+	{
+		QMutexLocker batchLocker(&m_batchMutex);
+		m_batchesPending.fetchAndAddOrdered(-m_batches.size());
+		m_batches.clear();
+	}
 	m_toThreadCond.wakeAll();
 }
 
@@ -89,33 +106,96 @@ void VideoProxy::deinit() {
 }
 
 bool VideoProxy::writeData(const void* data, size_t length) {
+	if (m_batched) {
+		if (m_batch.size() + length > static_cast<size_t>(BATCH_SIZE)) {
+			commitBatch();
+		}
+		m_batch.append(static_cast<const char*>(data), length);
+		// The end of a frame shouldn't have to wait for the next scanline group
+		if (length == sizeof(mVideoLoggerDirtyInfo) && static_cast<const mVideoLoggerDirtyInfo*>(data)->type == DIRTY_FLUSH) {
+			commitBatch();
+		}
+		return true;
+	}
 	while (!RingFIFOWrite(&m_dirtyQueue, data, length)) {
-		if (QThread::currentThread() == thread()) {
-			// We're on the main thread
-			mLogSetThreadLogger(m_logContext);
-			mVideoLoggerRendererRun(&m_logger, false);
-		} else {
-			emit dataAvailable();
-			QMutexLocker locker(&m_mutex);
-			m_toThreadCond.wakeAll();
-			m_fromThreadCond.wait(&m_mutex);
+		waitForReader();
+	}
+	return true;
+}
+
+void VideoProxy::waitForReader() {
+	if (QThread::currentThread() == thread()) {
+		// We're on the main thread
+		mLogSetThreadLogger(m_logContext);
+		mVideoLoggerRendererRun(&m_logger, false);
+	} else {
+		emit dataAvailable();
+		QMutexLocker locker(&m_mutex);
+		m_toThreadCond.wakeAll();
+		m_fromThreadCond.wait(&m_mutex);
+	}
+}
+
+void VideoProxy::commitBatch() {
+	if (m_batch.isEmpty()) {
+		return;
+	}
+	while (true) {
+		{
+			QMutexLocker locker(&m_batchMutex);
+			if (m_batches.size() < MAX_BATCHES) {
+				m_batches.enqueue(m_batch);
+				m_batchesPending.ref();
+				break;
+			}
 		}
+		waitForReader();
+	}
+	m_batch = QByteArray();
+	m_batch.reserve(BATCH_SIZE);
+}
+
+bool VideoProxy::takeBatch() {
+	QMutexLocker locker(&m_batchMutex);
+	if (m_batches.isEmpty()) {
+		return false;
 	}
+	m_readBatch = m_batches.dequeue();
+	m_readOffset = 0;
 	return true;
 }
 
 bool VideoProxy::readData(void* data, size_t length, bool block) {
-	bool read = false;
 	while (true) {
-		read = RingFIFORead(&m_dirtyQueue, data, length);
-		if (!block || read) {
-			break;
+		if (m_readOffset < m_readBatch.size()) {
+			// Writes are never split between batches, so reads aren't either
+			if (static_cast<size_t>(m_readBatch.size() - m_readOffset) < length) {
+				return false;
+			}
+			if (data) {
+				memcpy(data, &m_readBatch.constData()[m_readOffset], length);
+			}
+			m_readOffset += length;
+			if (m_readOffset == m_readBatch.size()) {
+				m_readBatch.clear();
+				m_readOffset = 0;
+				m_batchesPending.deref();
+			}
+			return true;
+		}
+		if (takeBatch()) {
+			continue;
+		}
+		if (RingFIFORead(&m_dirtyQueue, data, length)) {
+			return true;
+		}
+		if (!block) {
+			return false;
 		}
 		QMutexLocker locker(&m_mutex);
 		m_fromThreadCond.wakeAll();
 		m_toThreadCond.wait(&m_mutex);
 	}
-	return read;
 }
 
 void VideoProxy::postEvent(enum mVideoLoggerEvent event) {
@@ -142,8 +222,9 @@ void VideoProxy::unlock() {
 }
 
 void VideoProxy::wait() {
+	commitBatch();
 	QMutexLocker locker(&m_mutex);
-	while (RingFIFOSize(&m_dirtyQueue)) {
+	while (RingFIFOSize(&m_dirtyQueue) || m_batchesPending.loadAcquire()) {
 		if (QThread::currentThread() == thread()) {
 			// We're on the main thread
 			mLogSetThreadLogger(m_logContext);
@@ -158,6 +239,7 @@ void VideoProxy::wait() {
 
 void VideoProxy::wake(int y) {
 	if ((y & 15) == 15) {
+		commitBatch();
 		emit dataAvailable();
 		m_toThreadCond.wakeAll();
 	}
@@ -5,6 +5,8 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #pragma once
 
+#include <QAtomicInt>
+#include <QByteArray>
 #include <QMutex>
 #include <QObject>
 #include <QQueue>
@@ -30,6 +32,7 @@ public:
 	void attach(CoreController*);
 	void detach(CoreController*);
 	void setBlocking(bool block) { m_logger.waitOnFlush = block; }
+	void setBatched(bool batched);
 
 	VideoBackend* backend() { return &m_backend.d; }
 	void setProxiedBackend(VideoBackend*);
@@ -50,6 +53,9 @@ private:
 
 	bool writeData(const void* data, size_t length);
 	bool readData(void* data, size_t length, bool block);
+	void waitForReader();
+	void commitBatch();
+	bool takeBatch();
 	void postEvent(enum mVideoLoggerEvent event);
 
 	void lock();
@@ -76,6 +82,19 @@ private:
 	struct mLogger* m_logContext = nullptr;
 
 	RingFIFO m_dirtyQueue;
+
+	// In batched mode, packets are recorded into m_batch and handed to the painter thread
+	// a scanline group at a time instead of going through m_dirtyQueue one by one
+	static constexpr int BATCH_SIZE = 0x10000;
+	static constexpr int MAX_BATCHES = 32;
+	bool m_batched = false;
+	QByteArray m_batch;
+	QMutex m_batchMutex;
+	QQueue<QByteArray> m_batches;
+	QAtomicInt m_batchesPending;
+	QByteArray m_readBatch;
+	int m_readOffset = 0;
+
 	QMutex m_mutex;
 	QWaitCondition m_toThreadCond;
 	QWaitCondition m_fromThreadCond;
@@ -128,6 +128,7 @@ VideoView::VideoView(std::shared_ptr<CoreController> controller, QWidget* parent
 	connect(m_ui.showAdvanced, &QAbstractButton::clicked, this, &VideoView::showAdvanced);
 
 	FFmpegEncoderInit(&m_encoder);
+	FFmpegEncoderSetThreaded(&m_encoder, true, FFMPEG_QUEUE_BLOCK);
 
 	updatePresets();
 
@@ -56,6 +56,7 @@
 #include "PaletteView.h"
 #include "PlacementControl.h"
 #include "PrinterView.h"
+#include "ProfilerView.h"
 #include "ReportView.h"
 #include "ROMInfo.h"
 #include "SaveConverter.h"
@@ -65,6 +66,7 @@
 #include "SensorView.h"
 #include "ShaderSelector.h"
 #include "ShortcutController.h"
+#include "StartupTrace.h"
 #include "TileView.h"
 #include "VideoProxy.h"
 #include "VideoView.h"
@@ -143,6 +145,13 @@ Window::Window(CoreManager* manager, ConfigController* config, int playerId, QWi
 		m_libraryView->setViewStyle(static_cast<LibraryStyle>(value.toInt()));
 	}, this);
 	m_config->updateOption("libraryStyle");
+	ConfigOption* libraryThreads = m_config->addOption("libraryThreads");
+	libraryThreads->connect([this](const QVariant& value) {
+		bool ok;
+		int threads = value.toInt(&ok);
+		m_libraryView->setScanThreads(ok ? threads : -1);
+	}, this);
+	m_config->updateOption("libraryThreads");
 
 	connect(m_libraryView, &LibraryController::startGame, [this]() {
 		VFile* output = m_libraryView->selectedVFile();
@@ -179,16 +188,8 @@ Window::Window(CoreManager* manager, ConfigController* config, int playerId, QWi
 	m_mustReset.setInterval(MUST_RESTART_TIMEOUT);
 	m_mustReset.setSingleShot(true);
 
-#ifdef BUILD_SDL
-	m_inputController.addInputDriver(std::make_shared<SDLInputDriver>(&m_inputController));
-#if SDL_VERSION_ATLEAST(2, 0, 0)
-	m_inputController.setGamepadDriver(SDL_BINDING_CONTROLLER);
-	m_inputController.setSensorDriver(SDL_BINDING_CONTROLLER);
-#else
-	m_inputController.setGamepadDriver(SDL_BINDING_BUTTON);
-	m_inputController.setSensorDriver(SDL_BINDING_BUTTON);
-#endif
-#endif
+	// Bringing up the gamepad subsystem can stall for a while, so wait until the window is shown
+	QTimer::singleShot(0, this, &Window::ensureInputDrivers);
 
 	m_shortcutController->setConfigController(m_config);
 	m_shortcutController->setActionMapper(&m_actions);
@@ -305,6 +306,7 @@ void Window::loadConfig() {
 	updateMRU();
 
 	m_inputController.setConfiguration(m_config);
+	m_configLoaded = true;
 
 	if (!m_config->getList("autorunSettings").isEmpty()) {
 		ensureScripting();
@@ -1139,6 +1141,7 @@ void Window::changeRenderer() {
 
 	CoreController::Interrupter interrupter(m_controller);
 	if (m_config->getOption("hwaccelVideo").toInt() && m_display->supportsShaders() && m_controller->supportsFeature(CoreController::Feature::OPENGL)) {
+		m_display->videoProxy()->setBatched(true);
 		m_display->videoProxy()->attach(m_controller.get());
 
 		int fb = m_display->framebufferHandle();
@@ -1186,6 +1189,9 @@ void Window::mustReset() {
 }
 
 void Window::recordFrame() {
+	if (StartupTrace::isRunning()) {
+		StartupTrace::finish("First frame");
+	}
 	m_frameList.append(m_frameTimer.nsecsElapsed());
 	m_frameTimer.restart();
 }
@@ -1467,6 +1473,12 @@ void Window::setupMenu(QMenuBar* menubar) {
 		m_controller->forceFastForward(value);
 	}, "emu", QKeySequence("Shift+Tab"));
 
+	m_actions.addHeldAction(tr("Unbounded fast forward (held)"), "holdUnboundedFastForward", [this](bool held) {
+		if (m_controller) {
+			m_controller->setUnboundedFastForward(held);
+		}
+	}, "emu");
+
 	m_actions.addMenu(tr("Fast forward speed"), "fastForwardSpeed", "emu");
 	ConfigOption* ffspeed = m_config->addOption("fastForwardRatio");
 	ffspeed->connect([this](const QVariant&) {
@@ -1793,6 +1805,7 @@ void Window::setupMenu(QMenuBar* menubar) {
 		connect(m_controller.get(), &CoreController::stopping, view, &QWidget::close);
 		openView(view);
 	}, "tools");
+	addGameAction(tr("&Profile game code..."), "profilerView", openControllerTView<ProfilerView>(), "tools");
 #endif
 
 #if defined(USE_FFMPEG) && defined(M_CORE_GBA)
@@ -1885,6 +1898,11 @@ void Window::setupOptions() {
 		reloadConfig();
 	}, this);
 
+	ConfigOption* frameLimiter = m_config->addOption("frameLimiter");
+	frameLimiter->connect([this](const QVariant&) {
+		reloadConfig();
+	}, this);
+
 	ConfigOption* skipBios = m_config->addOption("skipBios");
 	skipBios->connect([this](const QVariant&) {
 		reloadConfig();
@@ -1935,6 +1953,11 @@ void Window::setupOptions() {
 		reloadConfig();
 	}, this);
 
+	ConfigOption* runAhead = m_config->addOption("runAhead");
+	runAhead->connect([this](const QVariant&) {
+		reloadConfig();
+	}, this);
+
 	ConfigOption* allowOpposingDirections = m_config->addOption("allowOpposingDirections");
 	allowOpposingDirections->connect([this](const QVariant&) {
 		reloadConfig();
@@ -1981,6 +2004,20 @@ void Window::setupOptions() {
 		}
 	}, this);
 
+	ConfigOption* showPresentStats = m_config->addOption("showPresentStats");
+	showPresentStats->connect([this](const QVariant& value) {
+		if (m_display) {
+			m_display->showPresentStats(value.toBool());
+		}
+	}, this);
+
+	ConfigOption* lowLatencyPresent = m_config->addOption("lowLatencyPresent");
+	lowLatencyPresent->connect([this](const QVariant& value) {
+		if (m_display) {
+			m_display->lowLatencyPresent(value.toBool());
+		}
+	}, this);
+
 	ConfigOption* showResetInfo = m_config->addOption("showResetInfo");
 	showResetInfo->connect([this](const QVariant& value) {
 		if (m_controller) {
@@ -2070,6 +2107,27 @@ void Window::updateMRU() {
 	m_actions.rebuildMenu(menuBar(), this, *m_shortcutController);
 }
 
+void Window::ensureInputDrivers() {
+	if (m_inputDriversAttached) {
+		return;
+	}
+	m_inputDriversAttached = true;
+#ifdef BUILD_SDL
+	m_inputController.addInputDriver(std::make_shared<SDLInputDriver>(&m_inputController));
+#if SDL_VERSION_ATLEAST(2, 0, 0)
+	m_inputController.setGamepadDriver(SDL_BINDING_CONTROLLER);
+	m_inputController.setSensorDriver(SDL_BINDING_CONTROLLER);
+#else
+	m_inputController.setGamepadDriver(SDL_BINDING_BUTTON);
+	m_inputController.setSensorDriver(SDL_BINDING_BUTTON);
+#endif
+	if (m_configLoaded) {
+		m_inputController.setConfiguration(m_config);
+	}
+#endif
+	StartupTrace::mark("Attach input drivers");
+}
+
 void Window::ensureScripting() {
 #ifdef ENABLE_SCRIPTING
 	if (m_scripting) {
@@ -2180,6 +2238,7 @@ void Window::setController(CoreController* controller, const QString& fname) {
 	if (!m_display) {
 		reloadDisplayDriver();
 	}
+	ensureInputDrivers();
 
 	m_controller = std::shared_ptr<CoreController>(controller);
 	m_controller->setInputController(&m_inputController);
@@ -2281,6 +2340,7 @@ void Window::setController(CoreController* controller, const QString& fname) {
 	m_controller->loadConfig(m_config);
 	m_config->updateOption("showOSD");
 	m_config->updateOption("showFrameCounter");
+	m_config->updateOption("showPresentStats");
 	m_config->updateOption("showResetInfo");
 	m_controller->start();
 
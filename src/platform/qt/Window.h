@@ -175,6 +175,7 @@ private:
 	void clearMRU();
 	void updateMRU();
 
+	void ensureInputDrivers();
 	void ensureScripting();
 
 	template <typename T, typename... A> std::function<void()> openTView(A... arg);
@@ -232,6 +233,8 @@ private:
 	QTimer m_focusCheck;
 	bool m_autoresume = false;
 	bool m_wasOpened = false;
+	bool m_configLoaded = false;
+	bool m_inputDriversAttached = false;
 	QString m_pendingPatch;
 	QString m_pendingState;
 	bool m_pendingPause = false;
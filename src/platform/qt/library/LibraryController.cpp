@@ -13,15 +13,21 @@
 
 #include <QHeaderView>
 #include <QListView>
+#include <QMutexLocker>
 #include <QSortFilterProxyModel>
 #include <QTimer>
 #include <QTreeView>
 
 using namespace QGBA;
 
+// Entries are read from the database on a worker thread this many at a time, and each
+// page is added to the model as it arrives so big libraries don't stall the UI
+static const size_t REFRESH_PAGE_SIZE = 512;
+
 LibraryController::LibraryController(QWidget* parent, const QString& path, ConfigController* config)
 	: QStackedWidget(parent)
 	, m_config(config)
+	, m_queryLock(std::make_shared<QMutex>())
 {
 	if (!path.isNull()) {
 		// This can return NULL if the library is already open
@@ -31,7 +37,10 @@ LibraryController::LibraryController(QWidget* parent, const QString& path, Confi
 		m_library = std::shared_ptr<mLibrary>(mLibraryCreateEmpty(), mLibraryDestroy);
 	}
 
-	mLibraryAttachGameDB(m_library.get(), GBAApp::app()->gameDB());
+	// Called from the library's writer thread, so this is delivered as a queued signal
+	mLibrarySetProgressCallback(m_library.get(), [](void* context, size_t processed, size_t total) {
+		emit static_cast<LibraryController*>(context)->loadProgress(processed, total);
+	}, this);
 
 	m_libraryModel = new LibraryModel(this);
 
@@ -74,10 +83,17 @@ LibraryController::LibraryController(QWidget* parent, const QString& path, Confi
 	}
 	m_treeModel->sort(librarySort.toInt(), librarySortOrder.value<Qt::SortOrder>());
 	m_listModel->sort(0, Qt::AscendingOrder);
-	refresh();
+	// Listing needs the game database for titles, which isn't loaded until the window is up
+	QTimer::singleShot(0, this, [this]() {
+		mLibraryAttachGameDB(m_library.get(), GBAApp::app()->gameDB());
+		m_gameDBAttached = true;
+		refresh();
+	});
 }
 
 LibraryController::~LibraryController() {
+	// A directory load can outlive this object, so stop it from reporting back here
+	mLibrarySetProgressCallback(m_library.get(), nullptr, nullptr);
 }
 
 void LibraryController::setViewStyle(LibraryStyle newStyle) {
@@ -153,6 +169,7 @@ VFile* LibraryController::selectedVFile() {
 		libentry.filename = filenameUtf8.constData();
 		libentry.platform = mPLATFORM_NONE;
 		libentry.platformModels = M_LIBRARY_MODEL_UNKNOWN;
+		QMutexLocker locker(m_queryLock.get());
 		return mLibraryOpenVFile(m_library.get(), &libentry);
 	} else {
 		return nullptr;
@@ -181,7 +198,10 @@ void LibraryController::clear() {
 		return;
 	}
 
-	mLibraryClear(m_library.get());
+	{
+		QMutexLocker locker(m_queryLock.get());
+		mLibraryClear(m_library.get());
+	}
 	refresh();
 }
 
@@ -189,44 +209,89 @@ void LibraryController::refresh() {
 	if (m_libraryJob > 0) {
 		return;
 	}
+	if (m_refreshJob > 0) {
+		// Start over once the current pass is done, since it may have already passed the changes
+		m_refreshQueued = true;
+		return;
+	}
 
-	setDisabled(true);
+	if (!m_gameDBAttached) {
+		// The first listing is done once the game database is attached
+		return;
+	}
+
+	m_refreshSeen.clear();
+	fetchPage(0);
+}
 
-	QSet<QString> removedEntries(qListToSet(m_knownGames.keys()));
+void LibraryController::fetchPage(size_t offset) {
+	std::shared_ptr<mLibrary> library = m_library;
+	std::shared_ptr<QMutex> queryLock = m_queryLock;
+	std::shared_ptr<QList<LibraryEntry>> page = std::make_shared<QList<LibraryEntry>>();
+	m_refreshJob = GBAApp::app()->submitWorkerJob([library, queryLock, page, offset]() {
+		mLibraryListing listing;
+		mLibraryListingInit(&listing, 0);
+		{
+			QMutexLocker locker(queryLock.get());
+			mLibraryGetEntries(library.get(), &listing, REFRESH_PAGE_SIZE, offset, nullptr);
+		}
+		for (size_t i = 0; i < mLibraryListingSize(&listing); ++i) {
+			mLibraryEntry* entry = mLibraryListingGetPointer(&listing, i);
+			page->append(entry);
+			mLibraryEntryFree(entry);
+		}
+		mLibraryListingDeinit(&listing);
+	}, this, [this, page, offset]() {
+		addPage(*page);
+		if (static_cast<size_t>(page->size()) < REFRESH_PAGE_SIZE) {
+			finishRefresh();
+		} else {
+			fetchPage(offset + page->size());
+		}
+	});
+}
+
+void LibraryController::addPage(const QList<LibraryEntry>& page) {
 	QList<LibraryEntry> updatedEntries;
 	QList<LibraryEntry> newEntries;
-
-	mLibraryListing listing;
-	mLibraryListingInit(&listing, 0);
-	mLibraryGetEntries(m_library.get(), &listing, 0, 0, nullptr);
-	for (size_t i = 0; i < mLibraryListingSize(&listing); i++) {
-		const mLibraryEntry* entry = mLibraryListingGetConstPointer(&listing, i);
-		uint64_t checkHash = LibraryEntry::checkHash(entry);
-		QString fullpath = QStringLiteral("%1/%2").arg(entry->base, entry->filename);
-		if (!m_knownGames.contains(fullpath)) {
+	for (const LibraryEntry& entry : page) {
+		uint64_t checkHash = entry.checkHash();
+		auto known = m_knownGames.find(entry.fullpath);
+		if (known == m_knownGames.end()) {
 			newEntries.append(entry);
-		} else if (checkHash != m_knownGames[fullpath]) {
+			m_knownGames.insert(entry.fullpath, checkHash);
+		} else if (checkHash != *known) {
 			updatedEntries.append(entry);
+			*known = checkHash;
 		}
-		removedEntries.remove(fullpath);
-		m_knownGames[fullpath] = checkHash;
+		m_refreshSeen.insert(entry.fullpath);
 	}
 
-	// Check for entries that were removed
-	for (const QString& path : removedEntries) {
-		m_knownGames.remove(path);
-	}
-
-	m_libraryModel->removeEntries(removedEntries.values());
 	m_libraryModel->updateEntries(updatedEntries);
 	m_libraryModel->addEntries(newEntries);
+}
 
-	for (size_t i = 0; i < mLibraryListingSize(&listing); ++i) {
-		mLibraryEntryFree(mLibraryListingGetPointer(&listing, i));
+void LibraryController::finishRefresh() {
+	m_refreshJob = -1;
+
+	// Anything the pages didn't turn up is no longer in the library
+	QList<QString> removedEntries;
+	for (auto iter = m_knownGames.begin(); iter != m_knownGames.end();) {
+		if (m_refreshSeen.contains(iter.key())) {
+			++iter;
+		} else {
+			removedEntries.append(iter.key());
+			iter = m_knownGames.erase(iter);
+		}
 	}
-	mLibraryListingDeinit(&listing);
+	m_refreshSeen.clear();
+	m_libraryModel->removeEntries(removedEntries);
 
-	setDisabled(false);
+	if (m_refreshQueued) {
+		m_refreshQueued = false;
+		refresh();
+		return;
+	}
 	selectLastBootedGame();
 	emit doneLoading();
 }
@@ -249,6 +314,13 @@ void LibraryController::loadDirectory(const QString& dir, bool recursive) {
 	m_libraryJob.testAndSetOrdered(libraryJob, -1);
 }
 
+void LibraryController::setScanThreads(int threads) {
+	if (threads < 0) {
+		threads = M_LIBRARY_DEFAULT_THREADS;
+	}
+	mLibrarySetThreads(m_library.get(), threads);
+}
+
 void LibraryController::setShowFilename(bool showFilename) {
 	if (showFilename == m_showFilename) {
 		return;
@@ -11,6 +11,8 @@
 #include <QAtomicInteger>
 #include <QHash>
 #include <QList>
+#include <QMutex>
+#include <QSet>
 #include <QStackedWidget>
 #include <QTimer>
 
@@ -46,6 +48,7 @@ public:
 	LibraryStyle viewStyle() const { return m_currentStyle; }
 	void setViewStyle(LibraryStyle newStyle);
 	void setShowFilename(bool showFilename);
+	void setScanThreads(int threads);
 
 	void selectEntry(const QString& fullpath);
 	LibraryEntry selectedEntry();
@@ -62,6 +65,7 @@ public slots:
 signals:
 	void startGame();
 	void doneLoading();
+	void loadProgress(qint64 processed, qint64 total);
 
 private slots:
 	void refresh();
@@ -75,11 +79,21 @@ protected:
 
 private:
 	void loadDirectory(const QString&, bool recursive = true); // Called on separate thread
+	void fetchPage(size_t offset);
+	void addPage(const QList<LibraryEntry>& page);
+	void finishRefresh();
 	void updateViewStyle(LibraryStyle newStyle);
 
 	ConfigController* m_config = nullptr;
 	std::shared_ptr<mLibrary> m_library;
 	QAtomicInteger<qint64> m_libraryJob = -1;
+	// Guards the library's queries, which page fetches make from worker threads
+	std::shared_ptr<QMutex> m_queryLock;
+
+	qint64 m_refreshJob = -1;
+	bool m_refreshQueued = false;
+	bool m_gameDBAttached = false;
+	QSet<QString> m_refreshSeen;
 
 	LibraryStyle m_currentStyle;
 
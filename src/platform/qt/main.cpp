@@ -9,16 +9,20 @@
 
 #include "ConfigController.h"
 #include "GBAApp.h"
+#include "StartupTrace.h"
 #include "Window.h"
 
+#include <mgba/core/host-trace.h>
 #include <mgba/core/version.h>
 #include <mgba/gba/interface.h>
+#include <mgba-util/vfs.h>
 
 #ifdef BUILD_SDL
 #include "platform/sdl/sdl-events.h"
 #endif
 
 #include <QLibraryInfo>
+#include <QTimer>
 #include <QTranslator>
 
 #ifdef BUILD_GLES2
@@ -67,6 +71,8 @@ int main(int argc, char* argv[]) {
 #endif
 #endif
 
+	StartupTrace::begin();
+
 	ConfigController configController;
 
 	QLocale locale;
@@ -88,6 +94,19 @@ int main(int argc, char* argv[]) {
 		configController.usage(argv[0]);
 		return 1;
 	}
+	StartupTrace::setEnabled(configController.getArgvOption("startup-trace").toBool());
+	StartupTrace::mark("Load configuration");
+
+#ifdef ENABLE_HOST_TRACE
+	if (configController.args()->traceFile) {
+		const char* traceFile = configController.args()->traceFile;
+		if (mHostTraceStart(VFileOpen(traceFile, O_CREAT | O_TRUNC | O_WRONLY))) {
+			mTRACE_THREAD_NAME("GUI Thread");
+		} else {
+			qWarning("Could not open trace file %s", traceFile);
+		}
+	}
+#endif
 
 	QApplication::setApplicationName(projectName);
 	QApplication::setApplicationVersion(projectVersion);
@@ -102,6 +121,7 @@ int main(int argc, char* argv[]) {
 #endif
 
 	GBAApp application(argc, argv, &configController);
+	StartupTrace::mark("Create application");
 
 #ifndef Q_OS_MAC
 	QApplication::setWindowIcon(QIcon(":/res/mgba-256.png"));
@@ -131,12 +151,25 @@ int main(int argc, char* argv[]) {
 		application.installTranslator(&langTranslator);
 	}
 
+	StartupTrace::mark("Load translations");
+
 	Window* w = application.newWindow();
 	w->argumentsPassed();
+	if (configController.args()->fname) {
+		StartupTrace::mark("Load game");
+	} else {
+		// Without a game there's no first frame to wait for, so stop once the deferred work is done
+		QTimer::singleShot(0, []() {
+			StartupTrace::finish("Idle");
+		});
+	}
 
 	application.initMultiplayer();
 
 	int ret = application.exec();
+#ifdef ENABLE_HOST_TRACE
+	mHostTraceStop();
+#endif
 	if (ret != 0) {
 		return ret;
 	}
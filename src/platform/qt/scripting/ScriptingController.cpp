@@ -176,9 +176,51 @@ void ScriptingController::openAutorunEdit() {
 	emit autorunScriptsOpened(view);
 }
 
+void ScriptingController::setProfiling(bool enable) {
+	CoreController::Interrupter interrupter(m_controller);
+	m_profiling = enable;
+	mScriptContextSetProfiling(&m_scriptContext, enable);
+}
+
+void ScriptingController::resetProfile() {
+	CoreController::Interrupter interrupter(m_controller);
+	mScriptContextResetProfile(&m_scriptContext);
+}
+
+void ScriptingController::reportProfile() {
+	mScriptProfileList entries;
+	mScriptProfileListInit(&entries, 0);
+	{
+		CoreController::Interrupter interrupter(m_controller);
+		mScriptContextGetProfile(&m_scriptContext, &entries);
+		if (!mScriptProfileListSize(&entries)) {
+			mScriptProfileListDeinit(&entries);
+			emit log(tr("No script calls have been profiled"));
+			return;
+		}
+		emit log(QString("%1 %2 %3 %4  %5")
+			.arg(tr("calls"), 10)
+			.arg(tr("total (ms)"), 12)
+			.arg(tr("avg (us)"), 10)
+			.arg(tr("max (us)"), 10)
+			.arg(tr("name")));
+		for (size_t i = 0; i < mScriptProfileListSize(&entries); ++i) {
+			const mScriptProfileEntry* entry = mScriptProfileListGetConstPointer(&entries, i);
+			// Entry names belong to the context, so they need to be copied before it can run again
+			emit log(QString("%1 %2 %3 %4  %5")
+				.arg(static_cast<qulonglong>(entry->calls), 10)
+				.arg(entry->totalNsec / 1e6, 12, 'f', 3)
+				.arg(entry->totalNsec / 1e3 / entry->calls, 10, 'f', 1)
+				.arg(entry->maxNsec / 1e3, 10, 'f', 1)
+				.arg(QString::fromUtf8(entry->name)));
+		}
+	}
+	mScriptProfileListDeinit(&entries);
+}
+
 void ScriptingController::flushStorage() {
 #ifdef USE_JSON_C
-	mScriptStorageFlushAll(&m_scriptContext);
+	mScriptStorageFlushPending(&m_scriptContext);
 #endif
 }
 
@@ -358,6 +400,8 @@ void ScriptingController::init() {
 	mScriptContextAttachStorage(&m_scriptContext);
 #endif
 	mScriptContextRegisterEngines(&m_scriptContext);
+	mScriptContextSetProfiling(&m_scriptContext, m_profiling);
+	mScriptContextSetCompileCache(&m_scriptContext, m_config->getOption("scriptCompileCache").toInt());
 
 	mScriptContextAttachLogger(&m_scriptContext, &m_logger);
 	m_bufferModel->attachToContext(&m_scriptContext);
@@ -67,6 +67,10 @@ public slots:
 	void runCode(const QString& code);
 	void openAutorunEdit();
 
+	void setProfiling(bool enable);
+	void resetProfile();
+	void reportProfile();
+
 	void flushStorage();
 
 protected:
@@ -103,6 +107,7 @@ private:
 	std::shared_ptr<CoreController> m_controller;
 	InputController* m_inputController = nullptr;
 	ConfigController* m_config = nullptr;
+	bool m_profiling = false;
 
 	QTimer m_storageFlush;
 };
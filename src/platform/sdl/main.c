@@ -15,9 +15,12 @@
 #endif
 #endif
 
+#include <mgba/core/checksum-cache.h>
 #include <mgba/core/core.h>
 #include <mgba/core/config.h>
+#include <mgba/core/host-trace.h>
 #include <mgba/core/input.h>
+#include <mgba/core/input-latch.h>
 #include <mgba/core/serialize.h>
 #include <mgba/core/thread.h>
 #include <mgba/internal/gba/input.h>
@@ -37,6 +40,8 @@ static void mSDLDeinit(struct mSDLRenderer* renderer);
 static int mSDLRun(struct mSDLRenderer* renderer, struct mArguments* args);
 
 static struct mStandardLogger _logger;
+static struct mAsyncLogger _asyncLogger;
+static struct mLogger* _activeLogger = &_logger.d;
 
 static struct VFile* _state = NULL;
 
@@ -128,6 +133,13 @@ int main(int argc, char** argv) {
 	renderer.interframeBlending = renderer.core->opts.interframeBlending;
 	renderer.filter = renderer.core->opts.resampleVideo;
 
+#if defined(USE_VULKAN) && SDL_VERSION_ATLEAST(2, 0, 6)
+	bool useVulkan = false;
+	mCoreConfigGetBoolValue(&renderer.core->config, "vulkan", &useVulkan);
+	if (useVulkan && mSDLVKCommonInit(&renderer)) {
+		mSDLVKCreate(&renderer);
+	} else
+#endif
 #ifdef BUILD_GL
 	if (mSDLGLCommonInit(&renderer)) {
 		mSDLGLCreate(&renderer);
@@ -165,17 +177,40 @@ int main(int argc, char** argv) {
 	// TODO: Use opts and config
 	mStandardLoggerInit(&_logger);
 	mStandardLoggerConfig(&_logger, &renderer.core->config);
+	bool logAsync = false;
+	mCoreConfigGetBoolValue(&renderer.core->config, "logAsync", &logAsync);
+	if (logAsync) {
+		mAsyncLoggerInit(&_asyncLogger, &_logger.d);
+		_activeLogger = &_asyncLogger.d;
+	}
+#ifdef ENABLE_HOST_TRACE
+	if (args.traceFile) {
+		if (mHostTraceStart(VFileOpen(args.traceFile, O_CREAT | O_TRUNC | O_WRONLY))) {
+			mTRACE_THREAD_NAME("Main Thread");
+		} else {
+			printf("Could not open trace file %s\n", args.traceFile);
+		}
+	}
+#endif
+	mChecksumCacheInit();
 	ret = mSDLRun(&renderer, &args);
+#ifdef ENABLE_HOST_TRACE
+	mHostTraceStop();
+#endif
 	mSDLDetachPlayer(&renderer.events, &renderer.player);
 	mInputMapDeinit(&renderer.core->inputMap);
 
 	mSDLDeinit(&renderer);
+	if (logAsync) {
+		mAsyncLoggerDeinit(&_asyncLogger);
+	}
 	mStandardLoggerDeinit(&_logger);
 
 	mArgumentsDeinit(&args);
 	mCoreConfigFreeOpts(&opts);
 	mCoreConfigDeinit(&renderer.core->config);
 	renderer.core->deinit(renderer.core);
+	mChecksumCacheDeinit();
 
 	return ret;
 }
@@ -200,12 +235,15 @@ int wmain(int argc, wchar_t** argv) {
 #endif
 
 int mSDLRun(struct mSDLRenderer* renderer, struct mArguments* args) {
+	struct mInputLatch inputLatch;
 	struct mCoreThread thread = {
-		.core = renderer->core
+		.core = renderer->core,
+		.inputLatch = &inputLatch
 	};
 	if (!mCoreLoadFile(renderer->core, args->fname)) {
 		return 1;
 	}
+	mInputLatchInit(&inputLatch);
 	mCoreAutoloadSave(renderer->core);
 	mArgumentsApplyFileLoads(args, renderer->core);
 #ifdef ENABLE_SCRIPTING
@@ -236,7 +274,9 @@ int mSDLRun(struct mSDLRenderer* renderer, struct mArguments* args) {
 
 	renderer->audio.samples = renderer->core->opts.audioBuffers;
 	renderer->audio.sampleRate = 44100;
-	thread.logger.logger = &_logger.d;
+	renderer->audio.rateControl = 0.005f;
+	mCoreConfigGetFloatValue(&renderer->core->config, "audioRateControl", &renderer->audio.rateControl);
+	thread.logger.logger = _activeLogger;
 
 	bool didFail = !mCoreThreadStart(&thread);
 
@@ -279,9 +319,17 @@ int mSDLRun(struct mSDLRenderer* renderer, struct mArguments* args) {
 #endif
 
 		mCoreThreadJoin(&thread);
+
+		struct mInputLatchStats stats;
+		mInputLatchGetStats(&inputLatch, &stats);
+		if (stats.changes) {
+			mLOG(SDL_EVENTS, INFO, "Input latency: %.1f ms average, %.1f ms max over %" PRIu64 " changes",
+			     stats.averageLatency / 1000., stats.maxLatency / 1000., stats.changes);
+		}
 	} else {
 		printf("Could not run game. Are you sure the file exists and is a compatible game?\n");
 	}
+	mInputLatchDeinit(&inputLatch);
 	renderer->core->unloadROM(renderer->core);
 
 #ifdef ENABLE_SCRIPTING
@@ -301,11 +349,12 @@ int mSDLRun(struct mSDLRenderer* renderer, struct mArguments* args) {
 static void mSDLDeinit(struct mSDLRenderer* renderer) {
 	mSDLDeinitEvents(&renderer->events);
 	mSDLDeinitAudio(&renderer->audio);
+
+	// Surfaces and contexts have to go before the window they were made for
+	renderer->deinit(renderer);
 #if SDL_VERSION_ATLEAST(2, 0, 0)
 	SDL_DestroyWindow(renderer->window);
 #endif
 
-	renderer->deinit(renderer);
-
 	SDL_Quit();
 }
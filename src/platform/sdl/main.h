@@ -23,6 +23,10 @@ CXX_GUARD_START
 #include "platform/opengl/gles2.h"
 #endif
 
+#if defined(USE_VULKAN) && SDL_VERSION_ATLEAST(2, 0, 6)
+#include "platform/vulkan/vk.h"
+#endif
+
 #ifdef USE_PIXMAN
 #include <pixman.h>
 #endif
@@ -64,6 +68,10 @@ struct mSDLRenderer {
 #if defined(BUILD_GLES2) || defined(BUILD_GLES3) || defined(USE_EPOXY)
 	struct mGLES2Context gl2;
 #endif
+#if defined(USE_VULKAN) && SDL_VERSION_ATLEAST(2, 0, 6)
+	struct mVKContext vk;
+	struct VideoShader vkShader;
+#endif
 
 	struct VideoBackend* backend;
 
@@ -83,6 +91,11 @@ void mSDLGLCreate(struct mSDLRenderer* renderer);
 void mSDLGLES2Create(struct mSDLRenderer* renderer);
 #endif
 
+#if defined(USE_VULKAN) && SDL_VERSION_ATLEAST(2, 0, 6)
+bool mSDLVKCommonInit(struct mSDLRenderer* renderer);
+void mSDLVKCreate(struct mSDLRenderer* renderer);
+#endif
+
 CXX_GUARD_END
 
 #endif
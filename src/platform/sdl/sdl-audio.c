@@ -6,11 +6,16 @@
 #include "sdl-audio.h"
 
 #include <mgba/core/core.h>
+#include <mgba/core/host-trace.h>
 #include <mgba/core/thread.h>
 
+#define FILL_AVERAGE_TIME 0.25
+#define DRIFT_TIME 4
+
 mLOG_DEFINE_CATEGORY(SDL_AUDIO, "SDL Audio", "platform.sdl.audio");
 
 static void _mSDLAudioCallback(void* context, Uint8* data, int len);
+static void _mSDLAudioUpdateRate(struct mSDLAudio* audioContext, double sourceRate, double fauxClock, bool enabled);
 
 bool mSDLInitAudio(struct mSDLAudio* context, struct mCoreThread* threadContext) {
 #if defined(_WIN32) && SDL_VERSION_ATLEAST(2, 0, 8)
@@ -40,15 +45,26 @@ bool mSDLInitAudio(struct mSDLAudio* context, struct mCoreThread* threadContext)
 		return false;
 	}
 	context->core = 0;
+	context->fillAverage = 0;
+	context->rateDrift = 0;
+	context->threadPolicyApplied = false;
+	context->rateAdjust = 1;
+	context->fillLevel = 0;
+	context->underruns = 0;
 
 	mAudioBufferInit(&context->buffer, context->samples, context->obtainedSpec.channels);
-	mAudioResamplerInit(&context->resampler, mINTERPOLATOR_SINC);
+	mAudioResamplerInit(&context->resampler, mINTERPOLATOR_POLYPHASE);
 	mAudioResamplerSetDestination(&context->resampler, &context->buffer, context->obtainedSpec.freq);
 
 	if (threadContext) {
 		context->core = threadContext->core;
 		context->sync = &threadContext->impl->sync;
 
+		bool realtime = false;
+		mCoreConfigGetThreadPolicy(&context->core->config, &context->threadPolicy);
+		mCoreConfigGetBoolValue(&context->core->config, "audioRealtime", &realtime);
+		context->threadPolicy.priority = realtime ? THREAD_PRIO_REALTIME : THREAD_PRIO_NORMAL;
+
 #if SDL_VERSION_ATLEAST(2, 0, 0)
 		SDL_PauseAudioDevice(context->deviceId, 0);
 #else
@@ -68,6 +84,9 @@ void mSDLDeinitAudio(struct mSDLAudio* context) {
 	SDL_PauseAudio(1);
 	SDL_CloseAudio();
 #endif
+	if (context->underruns) {
+		mLOG(SDL_AUDIO, DEBUG, "Audio buffer ran dry %" PRIz "u times", context->underruns);
+	}
 	mAudioBufferDeinit(&context->buffer);
 	mAudioResamplerDeinit(&context->resampler);
 	SDL_QuitSubSystem(SDL_INIT_AUDIO);
@@ -97,6 +116,20 @@ static void _mSDLAudioCallback(void* context, Uint8* data, int len) {
 		memset(data, 0, len);
 		return;
 	}
+#ifndef DISABLE_THREADING
+	if (!audioContext->threadPolicyApplied) {
+		// SDL raises the priority of its audio threads itself, possibly past what
+		// THREAD_PRIO_HIGH would give, so only change it when asked for realtime
+		if (audioContext->threadPolicy.priority == THREAD_PRIO_REALTIME) {
+			ThreadSetPriority(THREAD_PRIO_REALTIME);
+		}
+		if (audioContext->threadPolicy.affinity) {
+			ThreadSetAffinity(audioContext->threadPolicy.affinity);
+		}
+		audioContext->threadPolicyApplied = true;
+	}
+#endif
+	mTRACE_BEGIN("Audio: consume");
 	struct mAudioBuffer* buffer = NULL;
 	unsigned sampleRate = 32768;
 	if (audioContext->core) {
@@ -104,15 +137,19 @@ static void _mSDLAudioCallback(void* context, Uint8* data, int len) {
 		sampleRate = audioContext->core->audioSampleRate(audioContext->core);
 	}
 	double fauxClock = 1;
+	bool audioWait = true;
 	if (audioContext->sync) {
 		if (audioContext->sync->fpsTarget > 0 && audioContext->core) {
 			fauxClock = mCoreCalculateFramerateRatio(audioContext->core, audioContext->sync->fpsTarget);
 		}
 		mCoreSyncLockAudio(audioContext->sync);
+		audioWait = audioContext->sync->audioWait;
 		audioContext->sync->audioHighWater = audioContext->samples + audioContext->resampler.highWaterMark + audioContext->resampler.lowWaterMark + (audioContext->samples >> 6);
 		audioContext->sync->audioHighWater *= sampleRate / (fauxClock * audioContext->obtainedSpec.freq);
 	}
 	mAudioResamplerSetSource(&audioContext->resampler, buffer, sampleRate / fauxClock, true);
+	// Audio sync already holds the buffer level steady by blocking the emulator
+	_mSDLAudioUpdateRate(audioContext, sampleRate / fauxClock, fauxClock, !audioWait);
 	mAudioResamplerProcess(&audioContext->resampler);
 	if (audioContext->sync) {
 		mCoreSyncConsumeAudio(audioContext->sync);
@@ -121,6 +158,65 @@ static void _mSDLAudioCallback(void* context, Uint8* data, int len) {
 	int available = mAudioBufferRead(&audioContext->buffer, (int16_t*) data, len);
 
 	if (available < len) {
+		++audioContext->underruns;
+		mTRACE_INSTANT("Audio: underrun");
 		memset(((short*) data) + audioContext->obtainedSpec.channels * available, 0, (len - available) * audioContext->obtainedSpec.channels * sizeof(short));
 	}
+	mTRACE_END();
+}
+
+static void _mSDLAudioUpdateRate(struct mSDLAudio* audioContext, double sourceRate, double fauxClock, bool enabled) {
+	struct mAudioResampler* resampler = &audioContext->resampler;
+	double destRate = audioContext->obtainedSpec.freq;
+
+	// Count everything queued up between the core and the device in output frames
+	double fill = mAudioBufferAvailable(resampler->source) - resampler->timestamp;
+	fill *= destRate / sourceRate;
+	fill += mAudioBufferAvailable(&audioContext->buffer);
+	if (fill < 0) {
+		fill = 0;
+	}
+	audioContext->fillLevel = fill;
+
+	if (!enabled || audioContext->rateControl <= 0) {
+		audioContext->fillAverage = fill;
+		audioContext->rateDrift = 0;
+		audioContext->rateAdjust = 1;
+	} else {
+		double dt = audioContext->samples / destRate;
+		audioContext->fillAverage += (fill - audioContext->fillAverage) * dt / FILL_AVERAGE_TIME;
+
+		// The core hands over a frame's worth of audio at a time when it's
+		// waiting on video, so aim to have that queued on top of one callback
+		double target = audioContext->samples;
+		if (audioContext->core) {
+			struct mCore* core = audioContext->core;
+			target += destRate * fauxClock * core->frameCycles(core) / core->frequency(core);
+		}
+		double error = (audioContext->fillAverage - target) / target;
+		if (error > 1) {
+			error = 1;
+		} else if (error < -1) {
+			error = -1;
+		}
+
+		// The proportional part reacts to jitter, while the drift term slowly
+		// soaks up any constant mismatch between the core and device clocks
+		audioContext->rateDrift += audioContext->rateControl * error * dt / DRIFT_TIME;
+		if (audioContext->rateDrift > audioContext->rateControl) {
+			audioContext->rateDrift = audioContext->rateControl;
+		} else if (audioContext->rateDrift < -audioContext->rateControl) {
+			audioContext->rateDrift = -audioContext->rateControl;
+		}
+
+		// Too much queued up means playing it back slightly faster, and vice versa
+		double adjust = audioContext->rateControl * error + audioContext->rateDrift;
+		if (adjust > audioContext->rateControl) {
+			adjust = audioContext->rateControl;
+		} else if (adjust < -audioContext->rateControl) {
+			adjust = -audioContext->rateControl;
+		}
+		audioContext->rateAdjust = 1 - adjust;
+	}
+	mAudioResamplerSetDestination(resampler, &audioContext->buffer, destRate * audioContext->rateAdjust);
 }
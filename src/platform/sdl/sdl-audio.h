@@ -13,6 +13,7 @@ CXX_GUARD_START
 #include <mgba/core/log.h>
 #include <mgba-util/audio-buffer.h>
 #include <mgba-util/audio-resampler.h>
+#include <mgba-util/threading.h>
 
 #include <SDL.h>
 // Altivec sometimes defines this
@@ -30,6 +31,10 @@ struct mSDLAudio {
 	// Input
 	size_t samples;
 	unsigned sampleRate;
+	// Largest fraction the output rate may be nudged by to keep the buffer level steady; 0 disables
+	float rateControl;
+	// Applied by the audio callback the first time it runs
+	struct ThreadPolicy threadPolicy;
 
 	// State
 	struct mAudioBuffer buffer;
@@ -42,6 +47,15 @@ struct mSDLAudio {
 
 	struct mCore* core;
 	struct mCoreSync* sync;
+
+	double fillAverage;
+	double rateDrift;
+	bool threadPolicyApplied;
+
+	// Monitoring
+	double rateAdjust;
+	size_t fillLevel;
+	size_t underruns;
 };
 
 struct mCoreThread;
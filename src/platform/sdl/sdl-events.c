@@ -7,6 +7,7 @@
 
 #include <mgba/core/core.h>
 #include <mgba/core/input.h>
+#include <mgba/core/input-latch.h>
 #include <mgba/core/serialize.h>
 #include <mgba/core/thread.h>
 #include <mgba/debugger/debugger.h>
@@ -462,6 +463,38 @@ void mSDLUpdateJoysticks(struct mSDLEvents* events, const struct Configuration*
 #endif
 }
 
+#if SDL_VERSION_ATLEAST(2, 0, 0)
+static uint64_t _mSDLEventTime(Uint32 timestamp) {
+	uint64_t now = mInputLatchNow();
+	// Events are stamped when SDL queues them, which can be a while before they're handled
+	Uint32 age = SDL_GetTicks() - timestamp;
+	if (timestamp && age < 1000) {
+		now -= age * UINT64_C(1000000);
+	}
+	return now;
+}
+
+#define EVENT_TIME(EVENT) _mSDLEventTime((EVENT)->timestamp)
+#else
+#define EVENT_TIME(EVENT) mInputLatchNow()
+#endif
+
+static void _mSDLChangeKeys(struct mCoreThread* context, uint32_t clearKeys, uint32_t addKeys, uint64_t timestamp) {
+	if (context->inputLatch) {
+		if (clearKeys) {
+			mInputLatchClearKeys(context->inputLatch, clearKeys, timestamp);
+		}
+		if (addKeys) {
+			mInputLatchAddKeys(context->inputLatch, addKeys, timestamp);
+		}
+		return;
+	}
+	mCoreThreadInterrupt(context);
+	context->core->clearKeys(context->core, clearKeys);
+	context->core->addKeys(context->core, addKeys);
+	mCoreThreadContinue(context);
+}
+
 static void _pauseAfterFrame(struct mCoreThread* context) {
 	context->frameCallback = 0;
 	mCoreThreadPauseFromThread(context);
@@ -473,16 +506,22 @@ static void _mSDLHandleKeypress(struct mCoreThread* context, struct mSDLPlayer*
 		key = mInputMapKey(sdlContext->bindings, SDL_BINDING_KEY, event->keysym.sym);
 	}
 	if (key != -1) {
-		mCoreThreadInterrupt(context);
 		if (event->type == SDL_KEYDOWN) {
-			context->core->addKeys(context->core, 1 << key);
+			_mSDLChangeKeys(context, 0, 1 << key, EVENT_TIME(event));
 		} else {
-			context->core->clearKeys(context->core, 1 << key);
+			_mSDLChangeKeys(context, 1 << key, 0, EVENT_TIME(event));
 		}
-		mCoreThreadContinue(context);
 		return;
 	}
 	if (event->keysym.sym == SDLK_TAB) {
+		if (event->type == SDL_KEYDOWN && (event->keysym.mod & KMOD_SHIFT)) {
+			// Holding shift as well skips rendering most frames and mixing audio entirely
+			unsigned interval = mCORE_THREAD_UNBOUNDED_INTERVAL;
+			mCoreConfigGetUIntValue(&context->core->config, "fastForwardInterval", &interval);
+			mCoreThreadSetUnboundedFastForward(context, interval);
+		} else if (event->type != SDL_KEYDOWN) {
+			mCoreThreadSetUnboundedFastForward(context, 0);
+		}
 		context->impl->sync.audioWait = event->type != SDL_KEYDOWN;
 		return;
 	}
@@ -500,7 +539,9 @@ static void _mSDLHandleKeypress(struct mCoreThread* context, struct mSDLPlayer*
 #endif
 #ifdef USE_PNG
 		case SDLK_F12:
-			mCoreTakeScreenshot(context->core);
+			mCoreThreadInterrupt(context);
+			mCoreThreadTakeScreenshot(context);
+			mCoreThreadContinue(context);
 			return;
 #endif
 		case SDLK_BACKSLASH:
@@ -545,7 +586,7 @@ static void _mSDLHandleKeypress(struct mCoreThread* context, struct mSDLPlayer*
 				case SDLK_F8:
 				case SDLK_F9:
 					mCoreThreadInterrupt(context);
-					mCoreSaveState(context->core, event->keysym.sym - SDLK_F1 + 1, SAVESTATE_SAVEDATA | SAVESTATE_SCREENSHOT | SAVESTATE_RTC);
+					mCoreThreadSaveState(context, event->keysym.sym - SDLK_F1 + 1, SAVESTATE_SAVEDATA | SAVESTATE_SCREENSHOT | SAVESTATE_RTC);
 					mCoreThreadContinue(context);
 					break;
 				default:
@@ -563,6 +604,7 @@ static void _mSDLHandleKeypress(struct mCoreThread* context, struct mSDLPlayer*
 				case SDLK_F8:
 				case SDLK_F9:
 					mCoreThreadInterrupt(context);
+					mCoreThreadFlushStates(context);
 					mCoreLoadState(context->core, event->keysym.sym - SDLK_F1 + 1, SAVESTATE_SCREENSHOT | SAVESTATE_RTC);
 					mCoreThreadContinue(context);
 					break;
@@ -583,13 +625,11 @@ static void _mSDLHandleControllerButton(struct mCoreThread* context, struct mSDL
 		return;
 	}
 
-	mCoreThreadInterrupt(context);
 	if (event->type == SDL_CONTROLLERBUTTONDOWN) {
-		context->core->addKeys(context->core, 1 << key);
+		_mSDLChangeKeys(context, 0, 1 << key, EVENT_TIME(event));
 	} else {
-		context->core->clearKeys(context->core, 1 << key);
+		_mSDLChangeKeys(context, 1 << key, 0, EVENT_TIME(event));
 	}
-	mCoreThreadContinue(context);
 }
 
 static void _mSDLHandleControllerAxis(struct mCoreThread* context, struct mSDLPlayer* sdlContext, const struct SDL_ControllerAxisEvent* event) {
@@ -600,10 +640,7 @@ static void _mSDLHandleControllerAxis(struct mCoreThread* context, struct mSDLPl
 		newKeys |= 1 << key;
 	}
 	clearKeys &= ~newKeys;
-	mCoreThreadInterrupt(context);
-	context->core->clearKeys(context->core, clearKeys);
-	context->core->addKeys(context->core, newKeys);
-	mCoreThreadContinue(context);
+	_mSDLChangeKeys(context, clearKeys, newKeys, EVENT_TIME(event));
 }
 
 static void _mSDLHandleWindowEvent(struct mSDLPlayer* sdlContext, const struct SDL_WindowEvent* event) {
@@ -621,13 +658,11 @@ static void _mSDLHandleJoyButton(struct mCoreThread* context, struct mSDLPlayer*
 		return;
 	}
 
-	mCoreThreadInterrupt(context);
 	if (event->type == SDL_JOYBUTTONDOWN) {
-		context->core->addKeys(context->core, 1 << key);
+		_mSDLChangeKeys(context, 0, 1 << key, EVENT_TIME(event));
 	} else {
-		context->core->clearKeys(context->core, 1 << key);
+		_mSDLChangeKeys(context, 1 << key, 0, EVENT_TIME(event));
 	}
-	mCoreThreadContinue(context);
 }
 
 static void _mSDLHandleJoyHat(struct mCoreThread* context, struct mSDLPlayer* sdlContext, const struct SDL_JoyHatEvent* event) {
@@ -638,10 +673,7 @@ static void _mSDLHandleJoyHat(struct mCoreThread* context, struct mSDLPlayer* sd
 
 	int keys = mInputMapHat(sdlContext->bindings, SDL_BINDING_BUTTON, event->hat, event->value);
 
-	mCoreThreadInterrupt(context);
-	context->core->clearKeys(context->core, allKeys ^ keys);
-	context->core->addKeys(context->core, keys);
-	mCoreThreadContinue(context);
+	_mSDLChangeKeys(context, allKeys ^ keys, keys, EVENT_TIME(event));
 }
 
 static void _mSDLHandleJoyAxis(struct mCoreThread* context, struct mSDLPlayer* sdlContext, const struct SDL_JoyAxisEvent* event) {
@@ -652,10 +684,7 @@ static void _mSDLHandleJoyAxis(struct mCoreThread* context, struct mSDLPlayer* s
 		newKeys |= 1 << key;
 	}
 	clearKeys &= ~newKeys;
-	mCoreThreadInterrupt(context);
-	context->core->clearKeys(context->core, clearKeys);
-	context->core->addKeys(context->core, newKeys);
-	mCoreThreadContinue(context);
+	_mSDLChangeKeys(context, clearKeys, newKeys, EVENT_TIME(event));
 }
 #endif
 
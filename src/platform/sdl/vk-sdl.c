@@ -0,0 +1,130 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "main.h"
+
+#include "gl-common.h"
+
+#include <mgba/core/core.h>
+#include <mgba/core/version.h>
+#include <mgba-util/vfs.h>
+
+#include <SDL_vulkan.h>
+
+#ifdef __linux__
+#include <malloc.h>
+#endif
+
+static bool mSDLVKInit(struct mSDLRenderer* renderer);
+static void mSDLVKDeinit(struct mSDLRenderer* renderer);
+
+static bool _createSurface(struct mVKContext* context, VkInstance instance, VkSurfaceKHR* surface) {
+	struct mSDLRenderer* renderer = context->d.user;
+	return SDL_Vulkan_CreateSurface(renderer->window, instance, surface);
+}
+
+bool mSDLVKCommonInit(struct mSDLRenderer* renderer) {
+	renderer->window = SDL_CreateWindow(projectName, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, renderer->viewportWidth, renderer->viewportHeight, SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE | (SDL_WINDOW_FULLSCREEN_DESKTOP * renderer->player.fullscreen));
+	if (!renderer->window) {
+		return false;
+	}
+
+	unsigned nExtensions = 0;
+	const char** extensions = NULL;
+	if (SDL_Vulkan_GetInstanceExtensions(renderer->window, &nExtensions, NULL)) {
+		extensions = calloc(nExtensions + 1, sizeof(*extensions));
+		if (!SDL_Vulkan_GetInstanceExtensions(renderer->window, &nExtensions, extensions)) {
+			free(extensions);
+			extensions = NULL;
+		}
+	}
+	if (!extensions) {
+		SDL_DestroyWindow(renderer->window);
+		renderer->window = NULL;
+		return false;
+	}
+
+	mVKContextCreate(&renderer->vk);
+	renderer->vk.d.user = renderer;
+	renderer->vk.d.lockAspectRatio = renderer->lockAspectRatio;
+	renderer->vk.d.lockIntegerScaling = renderer->lockIntegerScaling;
+	renderer->vk.d.interframeBlending = renderer->interframeBlending;
+	renderer->vk.d.filter = renderer->filter;
+	renderer->vk.getInstanceProcAddr = (PFN_vkGetInstanceProcAddr) SDL_Vulkan_GetVkGetInstanceProcAddr();
+	renderer->vk.instanceExtensions = extensions;
+	renderer->vk.nInstanceExtensions = nExtensions;
+	renderer->vk.createSurface = _createSurface;
+	// Without video sync, frames are paced by audio instead, so don't wait on vertical blank too
+	mVKContextSetVsync(&renderer->vk, renderer->core->opts.videoSync);
+	renderer->vk.d.init(&renderer->vk.d, 0);
+	if (!renderer->vk.device) {
+		// Let the caller fall back to another renderer
+		free(extensions);
+		SDL_DestroyWindow(renderer->window);
+		renderer->window = NULL;
+		return false;
+	}
+
+	SDL_GetWindowSize(renderer->window, &renderer->viewportWidth, &renderer->viewportHeight);
+	renderer->player.window = renderer->window;
+	if (renderer->lockIntegerScaling) {
+		SDL_SetWindowMinimumSize(renderer->window, renderer->width, renderer->height);
+	}
+	return true;
+}
+
+void mSDLVKCreate(struct mSDLRenderer* renderer) {
+	renderer->init = mSDLVKInit;
+	renderer->deinit = mSDLVKDeinit;
+	renderer->runloop = mSDLGLCommonRunloop;
+	renderer->backend = &renderer->vk.d;
+}
+
+bool mSDLVKInit(struct mSDLRenderer* renderer) {
+	size_t size = renderer->width * renderer->height * BYTES_PER_PIXEL;
+#ifdef _WIN32
+	renderer->outputBuffer = _aligned_malloc(size, 16);
+#elif defined(__linux__)
+	renderer->outputBuffer = memalign(16, size);
+#else
+	posix_memalign((void**) &renderer->outputBuffer, 16, size);
+#endif
+	memset(renderer->outputBuffer, 0, size);
+	renderer->core->setVideoBuffer(renderer->core, renderer->outputBuffer, renderer->width);
+
+#if defined(ENABLE_VFS) && defined(ENABLE_DIRECTORIES)
+	const char* shaderPath = mCoreConfigGetValue(&renderer->core->config, "shader");
+	if (shaderPath) {
+		struct VDir* dir = VDirOpen(shaderPath);
+		if (dir) {
+			if (mVKShaderLoad(&renderer->vkShader, dir)) {
+				mVKShaderAttach(&renderer->vk, renderer->vkShader.passes, renderer->vkShader.nPasses);
+			}
+			dir->close(dir);
+		}
+	}
+#endif
+
+	struct mRectangle dims = {
+		.x = 0,
+		.y = 0,
+		.width = renderer->width,
+		.height = renderer->height
+	};
+	renderer->vk.d.setLayerDimensions(&renderer->vk.d, VIDEO_LAYER_IMAGE, &dims);
+
+	mSDLGLDoViewport(renderer->viewportWidth, renderer->viewportHeight, &renderer->vk.d);
+	return true;
+}
+
+void mSDLVKDeinit(struct mSDLRenderer* renderer) {
+	mVKShaderDetach(&renderer->vk);
+	if (renderer->vk.d.deinit) {
+		renderer->vk.d.deinit(&renderer->vk.d);
+	}
+	mVKShaderFree(&renderer->vkShader);
+	free((void*) renderer->vk.instanceExtensions);
+	free(renderer->outputBuffer);
+}
@@ -296,6 +296,13 @@ static void _setup(struct mGUIRunner* runner) {
 	}
 	_updateRenderer(runner, fakeBool);
 
+	// The GL renderer has to stay on the thread that owns the context
+	int threadedVideo = !fakeBool;
+	if (threadedVideo) {
+		mCoreConfigGetIntValue(&runner->config, "threadedVideo", &threadedVideo);
+	}
+	mCoreConfigSetIntValue(&runner->core->config, "threadedVideo", threadedVideo);
+
 	mRumbleIntegratorReset(&rumble.d);
 	runner->core->setPeripheral(runner->core, mPERIPH_RUMBLE, &rumble.d.d);
 	runner->core->setPeripheral(runner->core, mPERIPH_ROTATION, &rotation);
@@ -840,6 +847,10 @@ static void hidTeardown(void) {
 }
 
 int main(int argc, char* argv[]) {
+	// Emulation and the UI share this thread on core 0, while ThreadCreate starts
+	// the render thread on core 1
+	svcSetThreadCoreMask(CUR_THREAD_HANDLE, 0, 1);
+
 	NWindow* window = nwindowGetDefault();
 	nwindowSetDimensions(window, 1920, 1080);
 
@@ -1034,6 +1045,31 @@ int main(int argc, char* argv[]) {
 				},
 				.nStates = 6
 			},
+			{
+				.title = "Render on a separate core",
+				.data = GUI_V_S("threadedVideo"),
+				.submenu = 0,
+				.state = 1,
+				.validStates = (const char*[]) {
+					"Off",
+					"On",
+				},
+				.nStates = 2
+			},
+			{
+				.title = "Sync",
+				.data = GUI_V_S("threadedVideo.flushScanline"),
+				.submenu = 0,
+				.state = 0,
+				.validStates = (const char*[]) {
+					"Loose (faster, can tear)", "Strict (slower, less input lag)"
+				},
+				.stateMappings = (const struct GUIVariant[]) {
+					GUI_V_I(0),
+					GUI_V_I(-1),
+				},
+				.nStates = 2
+			},
 			{
 				.title = "Use built-in brightness sensor for Boktai",
 				.data = GUI_V_S("useLightSensor"),
@@ -1046,7 +1082,7 @@ int main(int argc, char* argv[]) {
 				.nStates = 2
 			},
 		},
-		.nConfigExtra = 6,
+		.nConfigExtra = 8,
 		.setup = _setup,
 		.teardown = NULL,
 		.gameLoaded = _gameLoaded,
@@ -1062,6 +1098,8 @@ int main(int argc, char* argv[]) {
 		.running = _running
 	};
 	mGUIInit(&runner, "switch");
+	mCoreConfigSetDefaultIntValue(&runner.config, "threadedVideo", 1);
+	mCoreConfigSetDefaultIntValue(&runner.config, "threadedVideo.flushScanline", 0);
 
 	_mapKey(&runner.params.keyMap, AUTO_INPUT, HidNpadButton_A, GUI_INPUT_SELECT);
 	_mapKey(&runner.params.keyMap, AUTO_INPUT, HidNpadButton_B, GUI_INPUT_BACK);
@@ -0,0 +1,889 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/core.h>
+#include <mgba/core/lockstep.h>
+#include <mgba/core/thread.h>
+#include <mgba/core/timing.h>
+#include <mgba-util/audio-buffer.h>
+#include <mgba-util/audio-resampler.h>
+#include <mgba-util/crc32.h>
+#include <mgba-util/patch/fast.h>
+#include <mgba-util/table.h>
+#include <mgba-util/vfs.h>
+
+#ifdef M_CORE_GBA
+#include <mgba/gba/core.h>
+#include <mgba/internal/arm/arm.h>
+#include <mgba/internal/gba/gba.h>
+#include <mgba/internal/gba/io.h>
+#include <mgba/internal/gba/memory.h>
+#include <mgba/internal/gba/sio/lockstep.h>
+#include <mgba/internal/gba/video.h>
+#endif
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <sys/time.h>
+#include <time.h>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define BENCH_HAS_TSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAS_TSC
+#endif
+
+// Microbenchmarks for individual hot kernels. Each kernel runs on fixed, seeded inputs
+// so that numbers are comparable between builds, and is timed several times with the
+// fastest run reported. Cycles are read from the timestamp counter where there is one,
+// which ticks at a constant rate rather than the current core clock.
+
+#define DEFAULT_REPEATS 5
+
+#define TIMING_EVENTS 24
+#define TIMING_ITERATIONS 1000000
+
+#define GBA_ACCESS_ADDRESSES 4096
+#define GBA_ACCESS_PASSES 256
+#define GBA_DRAW_FRAMES 60
+#define GBA_LINK_FRAMES 600
+
+#define RESAMPLER_CHUNK 1024
+#define RESAMPLER_CHUNKS 512
+
+#define BYTE_BUFFER_SIZE 0x40000
+#define CRC32_PASSES 16
+#define PATCH_PASSES 16
+
+#define HASH_KEYS 1024
+#define HASH_LOOKUPS 1000000
+
+struct BenchKernel {
+	const char* name;
+	const char* unit;
+	void* (*setup)(void);
+	uint64_t (*run)(void* context);
+	void (*teardown)(void* context);
+};
+
+// Results are accumulated here so the compiler can't discard the work being measured
+static volatile uint32_t _sink;
+
+// Anything the emulator logs would only get in the way of the results
+static void _benchLog(struct mLogger* logger, int category, enum mLogLevel level, const char* format, va_list args) {
+	UNUSED(logger);
+	UNUSED(category);
+	UNUSED(level);
+	UNUSED(format);
+	UNUSED(args);
+}
+
+static struct mLogger _benchLogger = {
+	.log = _benchLog
+};
+
+static uint32_t _random(uint32_t* seed) {
+	*seed ^= *seed << 13;
+	*seed ^= *seed >> 17;
+	*seed ^= *seed << 5;
+	return *seed;
+}
+
+static uint64_t _benchClock(void) {
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec * UINT64_C(1000000000) + tv.tv_usec * UINT64_C(1000);
+#endif
+}
+
+static uint64_t _benchCycles(void) {
+#ifdef BENCH_HAS_TSC
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+struct TimingBenchEvent {
+	struct mTimingEvent event;
+	struct TimingBench* bench;
+	int32_t period;
+};
+
+struct TimingBench {
+	struct mTiming timing;
+	int32_t cycles;
+	int32_t nextEvent;
+	uint32_t seed;
+	uint32_t fired;
+	struct TimingBenchEvent events[TIMING_EVENTS];
+};
+
+static void _timingPeriodic(struct mTiming* timing, void* context, uint32_t cyclesLate) {
+	struct TimingBenchEvent* event = context;
+	++event->bench->fired;
+	mTimingSchedule(timing, &event->event, event->period - cyclesLate);
+}
+
+static void _timingOneShot(struct mTiming* timing, void* context, uint32_t cyclesLate) {
+	UNUSED(timing);
+	UNUSED(cyclesLate);
+	struct TimingBenchEvent* event = context;
+	++event->bench->fired;
+}
+
+// Self-rescheduling events stand in for audio, video, timers and so on, while the
+// others are rescheduled and descheduled from the outside the way MMIO writes do
+static void* _timingSetup(void) {
+	struct TimingBench* bench = calloc(1, sizeof(*bench));
+	mTimingInit(&bench->timing, &bench->cycles, &bench->nextEvent);
+	bench->nextEvent = INT_MAX;
+	bench->seed = 0x6D474241;
+	int i;
+	for (i = 0; i < TIMING_EVENTS; ++i) {
+		struct TimingBenchEvent* event = &bench->events[i];
+		event->bench = bench;
+		event->event.context = event;
+		event->event.name = "Bench";
+		event->event.priority = i & 7;
+		if (i < TIMING_EVENTS / 2) {
+			event->period = 64 + (_random(&bench->seed) & 0x3FF);
+			event->event.callback = _timingPeriodic;
+			mTimingSchedule(&bench->timing, &event->event, event->period);
+		} else {
+			event->event.callback = _timingOneShot;
+		}
+	}
+	return bench;
+}
+
+static uint64_t _timingRun(void* context) {
+	struct TimingBench* bench = context;
+	long n;
+	for (n = 0; n < TIMING_ITERATIONS; ++n) {
+		struct TimingBenchEvent* event = &bench->events[TIMING_EVENTS / 2 + _random(&bench->seed) % (TIMING_EVENTS - TIMING_EVENTS / 2)];
+		if (mTimingIsScheduled(&bench->timing, &event->event)) {
+			mTimingDeschedule(&bench->timing, &event->event);
+		}
+		mTimingSchedule(&bench->timing, &event->event, 16 + (_random(&bench->seed) & 0x7FF));
+
+		bench->cycles = 0;
+		bench->nextEvent = mTimingTick(&bench->timing, 8 + (_random(&bench->seed) & 0x3F));
+	}
+	_sink += bench->fired;
+	return TIMING_ITERATIONS;
+}
+
+static void _timingTeardown(void* context) {
+	struct TimingBench* bench = context;
+	mTimingDeinit(&bench->timing);
+	free(bench);
+}
+
+#ifdef M_CORE_GBA
+struct GBABench {
+	struct mCore* core;
+	struct GBA* gba;
+	uint32_t seed;
+	uint32_t addresses[GBA_ACCESS_ADDRESSES];
+	mColor* outputBuffer;
+};
+
+// A blank cartridge is enough to get a core into a runnable state; nothing is ever executed
+static struct GBABench* _gbaSetup(void) {
+	struct VFile* vf = VFileMemChunk(NULL, GBA_SIZE_ROM0 / 32);
+	if (!vf) {
+		return NULL;
+	}
+	uint8_t fixed = 0x96;
+	vf->seek(vf, 0xB2, SEEK_SET);
+	vf->write(vf, &fixed, 1);
+	vf->seek(vf, 0, SEEK_SET);
+
+	struct GBABench* bench = calloc(1, sizeof(*bench));
+	bench->core = GBACoreCreate();
+	if (!bench->core || !bench->core->init(bench->core)) {
+		vf->close(vf);
+		free(bench);
+		return NULL;
+	}
+	mCoreInitConfig(bench->core, NULL);
+	bench->outputBuffer = calloc(256 * GBA_VIDEO_VERTICAL_PIXELS, BYTES_PER_PIXEL);
+	bench->core->setVideoBuffer(bench->core, bench->outputBuffer, 256);
+	if (!bench->core->loadROM(bench->core, vf)) {
+		vf->close(vf);
+		mCoreConfigDeinit(&bench->core->config);
+		bench->core->deinit(bench->core);
+		free(bench->outputBuffer);
+		free(bench);
+		return NULL;
+	}
+	bench->core->reset(bench->core);
+	bench->gba = bench->core->board;
+	bench->seed = 0x6D474241;
+	return bench;
+}
+
+static void _gbaTeardown(void* context) {
+	struct GBABench* bench = context;
+	mCoreConfigDeinit(&bench->core->config);
+	bench->core->deinit(bench->core);
+	free(bench->outputBuffer);
+	free(bench);
+}
+
+static void _gbaFill(struct GBABench* bench, uint32_t base, uint32_t size) {
+	uint32_t i;
+	for (i = 0; i < size; i += 2) {
+		bench->core->busWrite16(bench->core, base + i, _random(&bench->seed));
+	}
+}
+
+static void _gbaWriteIO(struct GBABench* bench, uint32_t reg, uint16_t value) {
+	bench->core->busWrite16(bench->core, GBA_BASE_IO | reg, value);
+}
+
+static void* _gbaLoadSetup(void) {
+	struct GBABench* bench = _gbaSetup();
+	if (!bench) {
+		return NULL;
+	}
+	static const uint32_t regions[][2] = {
+		{ GBA_BASE_EWRAM, GBA_SIZE_EWRAM },
+		{ GBA_BASE_IWRAM, GBA_SIZE_IWRAM },
+		{ GBA_BASE_VRAM, GBA_SIZE_VRAM },
+		{ GBA_BASE_PALETTE_RAM, GBA_SIZE_PALETTE_RAM },
+		{ GBA_BASE_ROM0, GBA_SIZE_ROM0 / 32 },
+		{ GBA_BASE_ROM1, GBA_SIZE_ROM0 / 32 },
+	};
+	size_t i;
+	for (i = 0; i < GBA_ACCESS_ADDRESSES; ++i) {
+		const uint32_t* region = regions[_random(&bench->seed) % (sizeof(regions) / sizeof(*regions))];
+		bench->addresses[i] = region[0] + ((_random(&bench->seed) % region[1]) & ~3);
+	}
+	return bench;
+}
+
+static uint64_t _gbaLoadRun(void* context) {
+	struct GBABench* bench = context;
+	struct ARMCore* cpu = bench->gba->cpu;
+	uint32_t sum = 0;
+	int cycles = 0;
+	int pass;
+	size_t i;
+	for (pass = 0; pass < GBA_ACCESS_PASSES; ++pass) {
+		for (i = 0; i < GBA_ACCESS_ADDRESSES; ++i) {
+			sum += cpu->memory.load32(cpu, bench->addresses[i], &cycles);
+		}
+	}
+	_sink += sum + cycles;
+	return GBA_ACCESS_PASSES * GBA_ACCESS_ADDRESSES;
+}
+
+static void* _gbaStoreSetup(void) {
+	struct GBABench* bench = _gbaSetup();
+	if (!bench) {
+		return NULL;
+	}
+	// VRAM, palette and OAM stores also notify the renderer, so they're weighted
+	// the way a typical game's traffic is: mostly work RAM
+	static const uint32_t regions[][2] = {
+		{ GBA_BASE_EWRAM, GBA_SIZE_EWRAM },
+		{ GBA_BASE_IWRAM, GBA_SIZE_IWRAM },
+		{ GBA_BASE_IWRAM, GBA_SIZE_IWRAM },
+		{ GBA_BASE_EWRAM, GBA_SIZE_EWRAM },
+		{ GBA_BASE_VRAM, GBA_SIZE_VRAM },
+		{ GBA_BASE_PALETTE_RAM, GBA_SIZE_PALETTE_RAM },
+		{ GBA_BASE_OAM, GBA_SIZE_OAM },
+	};
+	size_t i;
+	for (i = 0; i < GBA_ACCESS_ADDRESSES; ++i) {
+		const uint32_t* region = regions[_random(&bench->seed) % (sizeof(regions) / sizeof(*regions))];
+		bench->addresses[i] = region[0] + ((_random(&bench->seed) % region[1]) & ~3);
+	}
+	return bench;
+}
+
+static uint64_t _gbaStoreRun(void* context) {
+	struct GBABench* bench = context;
+	struct ARMCore* cpu = bench->gba->cpu;
+	int cycles = 0;
+	int pass;
+	size_t i;
+	for (pass = 0; pass < GBA_ACCESS_PASSES; ++pass) {
+		for (i = 0; i < GBA_ACCESS_ADDRESSES; ++i) {
+			cpu->memory.store32(cpu, bench->addresses[i], pass ^ i, &cycles);
+		}
+	}
+	_sink += cycles;
+	return GBA_ACCESS_PASSES * GBA_ACCESS_ADDRESSES;
+}
+
+static void* _gbaDrawMode0Setup(void) {
+	struct GBABench* bench = _gbaSetup();
+	if (!bench) {
+		return NULL;
+	}
+	_gbaFill(bench, GBA_BASE_VRAM, 0x10000);
+	_gbaFill(bench, GBA_BASE_PALETTE_RAM, GBA_SIZE_PALETTE_RAM);
+	// Mix of 4bpp and 8bpp layers with different map sizes, all scrolled
+	_gbaWriteIO(bench, GBA_REG_BG0CNT, 0x0000);
+	_gbaWriteIO(bench, GBA_REG_BG1CNT, 0x4584);
+	_gbaWriteIO(bench, GBA_REG_BG2CNT, 0x8A09);
+	_gbaWriteIO(bench, GBA_REG_BG3CNT, 0xCF8E);
+	_gbaWriteIO(bench, GBA_REG_BG0HOFS, 3);
+	_gbaWriteIO(bench, GBA_REG_BG1HOFS, 117);
+	_gbaWriteIO(bench, GBA_REG_BG1VOFS, 29);
+	_gbaWriteIO(bench, GBA_REG_BG2HOFS, 250);
+	_gbaWriteIO(bench, GBA_REG_BG3VOFS, 77);
+	_gbaWriteIO(bench, GBA_REG_DISPCNT, 0x0F00);
+	return bench;
+}
+
+static void* _gbaDrawAffineSetup(void) {
+	struct GBABench* bench = _gbaSetup();
+	if (!bench) {
+		return NULL;
+	}
+	_gbaFill(bench, GBA_BASE_VRAM, 0x10000);
+	_gbaFill(bench, GBA_BASE_PALETTE_RAM, GBA_SIZE_PALETTE_RAM);
+	// One wrapping and one clipped layer, both rotated and scaled
+	_gbaWriteIO(bench, GBA_REG_BG2CNT, 0x6204);
+	_gbaWriteIO(bench, GBA_REG_BG3CNT, 0x5D09);
+	_gbaWriteIO(bench, GBA_REG_BG2PA, 0x00ED);
+	_gbaWriteIO(bench, GBA_REG_BG2PB, 0x0062);
+	_gbaWriteIO(bench, GBA_REG_BG2PC, 0xFF9E);
+	_gbaWriteIO(bench, GBA_REG_BG2PD, 0x00ED);
+	_gbaWriteIO(bench, GBA_REG_BG2X_LO, 0x1200);
+	_gbaWriteIO(bench, GBA_REG_BG2Y_LO, 0x0800);
+	_gbaWriteIO(bench, GBA_REG_BG3PA, 0x0140);
+	_gbaWriteIO(bench, GBA_REG_BG3PB, 0xFFC0);
+	_gbaWriteIO(bench, GBA_REG_BG3PC, 0x0040);
+	_gbaWriteIO(bench, GBA_REG_BG3PD, 0x0140);
+	_gbaWriteIO(bench, GBA_REG_BG3X_LO, 0xE000);
+	_gbaWriteIO(bench, GBA_REG_BG3X_HI, 0xFFFF);
+	_gbaWriteIO(bench, GBA_REG_DISPCNT, 0x0C02);
+	return bench;
+}
+
+static void* _gbaDrawMode3Setup(void) {
+	struct GBABench* bench = _gbaSetup();
+	if (!bench) {
+		return NULL;
+	}
+	_gbaFill(bench, GBA_BASE_VRAM, GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS * 2);
+	// Full screen, unscaled frame buffer, as used for video playback
+	_gbaWriteIO(bench, GBA_REG_DISPCNT, 0x0403);
+	return bench;
+}
+
+static void* _gbaDrawMode4Setup(void) {
+	struct GBABench* bench = _gbaSetup();
+	if (!bench) {
+		return NULL;
+	}
+	_gbaFill(bench, GBA_BASE_VRAM, 0x14000);
+	_gbaFill(bench, GBA_BASE_PALETTE_RAM, GBA_SIZE_PALETTE_RAM / 2);
+	// Unscaled back buffer, blended over the backdrop
+	_gbaWriteIO(bench, GBA_REG_BLDCNT, 0x2044);
+	_gbaWriteIO(bench, GBA_REG_BLDALPHA, 0x0C04);
+	_gbaWriteIO(bench, GBA_REG_DISPCNT, 0x0414);
+	return bench;
+}
+
+static void* _gbaDrawObjSetup(void) {
+	struct GBABench* bench = _gbaSetup();
+	if (!bench) {
+		return NULL;
+	}
+	_gbaFill(bench, GBA_BASE_VRAM | 0x10000, 0x8000);
+	_gbaFill(bench, GBA_BASE_PALETTE_RAM | 0x200, GBA_SIZE_PALETTE_RAM / 2);
+	// Every sprite is on screen; a quarter of them are affine and some are 8bpp
+	int i;
+	for (i = 0; i < 128; ++i) {
+		uint32_t base = GBA_BASE_OAM + i * 8;
+		uint16_t attr0 = _random(&bench->seed) % GBA_VIDEO_VERTICAL_PIXELS;
+		uint16_t attr1 = _random(&bench->seed) % GBA_VIDEO_HORIZONTAL_PIXELS;
+		uint16_t attr2 = (_random(&bench->seed) & 0x3FF) | ((i & 3) << 10) | ((i & 0xF) << 12);
+		attr0 |= (i % 3) << 14;
+		attr1 |= (i & 1 ? 2 : 1) << 14;
+		if (!(i & 3)) {
+			attr0 |= 0x100;
+			attr1 |= (i & 0x7C) << 7;
+		}
+		if (i % 5 == 0) {
+			attr0 |= 0x2000;
+		}
+		bench->core->busWrite16(bench->core, base, attr0);
+		bench->core->busWrite16(bench->core, base + 2, attr1);
+		bench->core->busWrite16(bench->core, base + 4, attr2);
+	}
+	for (i = 0; i < 32; ++i) {
+		uint32_t base = GBA_BASE_OAM + i * 32 + 6;
+		int16_t scale = 0xC0 + (i << 2);
+		int16_t shear = (i & 8 ? -1 : 1) * (i << 1);
+		bench->core->busWrite16(bench->core, base, scale);
+		bench->core->busWrite16(bench->core, base + 8, shear);
+		bench->core->busWrite16(bench->core, base + 16, -shear);
+		bench->core->busWrite16(bench->core, base + 24, scale);
+	}
+	_gbaWriteIO(bench, GBA_REG_DISPCNT, 0x1040);
+	return bench;
+}
+
+static uint64_t _gbaDrawRun(void* context) {
+	struct GBABench* bench = context;
+	struct GBAVideoRenderer* renderer = bench->gba->video.renderer;
+	int frame;
+	int y;
+	for (frame = 0; frame < GBA_DRAW_FRAMES; ++frame) {
+		// Defeat the unchanged scanline cache so every frame is drawn from scratch
+		renderer->writeVRAM(renderer, 0);
+		for (y = 0; y < GBA_VIDEO_VERTICAL_PIXELS; ++y) {
+			renderer->drawScanline(renderer, y);
+		}
+		renderer->finishFrame(renderer);
+	}
+	_sink += bench->outputBuffer[256 * (GBA_VIDEO_VERTICAL_PIXELS / 2) + GBA_VIDEO_HORIZONTAL_PIXELS / 2];
+	return GBA_DRAW_FRAMES * GBA_VIDEO_VERTICAL_PIXELS;
+}
+
+#ifndef DISABLE_THREADING
+// Sets up MULTI mode and has the primary start a new transfer as soon as the last one
+// finishes, so that every player spends the whole run synchronizing at transfer
+// boundaries. The secondaries try to start transfers too, which is ignored.
+static const uint32_t _gbaLinkCode[] = {
+	0xE3A00301, // mov r0, #0x04000000
+	0xE3A01000, // mov r1, #0
+	0xE2802C01, // add r2, r0, #0x100
+	0xE1C213B4, // strh r1, [r2, #0x34] @ RCNT
+	0xE3A01A02, // mov r1, #0x2000
+	0xE3811003, // orr r1, #3
+	0xE1C212B8, // strh r1, [r2, #0x28] @ SIOCNT
+	0xE1D232B8, // 1: ldrh r3, [r2, #0x28]
+	0xE3130080, // tst r3, #0x80
+	0x1AFFFFFC, // bne 1b
+	0xE3814080, // orr r4, r1, #0x80
+	0xE1C242B8, // strh r4, [r2, #0x28]
+	0xEAFFFFF9, // b 1b
+};
+
+struct GBALinkBench {
+	struct GBASIOLockstepCoordinator coordinator;
+	struct mCoreThread threads[MAX_GBAS];
+	struct mLockstepThreadUser users[MAX_GBAS];
+	struct GBASIOLockstepDriver drivers[MAX_GBAS];
+	mColor* outputBuffers[MAX_GBAS];
+	int players;
+
+	Mutex mutex;
+	Condition frameDone;
+	uint64_t frames[MAX_GBAS];
+};
+
+static void _gbaLinkFrame(struct mCoreThread* thread) {
+	struct GBALinkBench* bench = thread->userData;
+	MutexLock(&bench->mutex);
+	++bench->frames[thread - bench->threads];
+	ConditionWake(&bench->frameDone);
+	MutexUnlock(&bench->mutex);
+}
+
+// Players keep the order they were created in, the way the frontends assign them
+static int _gbaLinkRequestedId(struct mLockstepUser* user) {
+	struct mLockstepThreadUser* threadUser = (struct mLockstepThreadUser*) user;
+	struct GBALinkBench* bench = threadUser->thread->userData;
+	return threadUser - bench->users;
+}
+
+static void _gbaLinkTeardown(void* context) {
+	struct GBALinkBench* bench = context;
+	int i;
+	for (i = 0; i < bench->players; ++i) {
+		struct mCoreThread* thread = &bench->threads[i];
+		mCoreThreadInterrupt(thread);
+		thread->core->setPeripheral(thread->core, mPERIPH_GBA_LINK_PORT, NULL);
+		GBASIOLockstepCoordinatorDetach(&bench->coordinator, &bench->drivers[i]);
+		mCoreThreadContinue(thread);
+	}
+	for (i = 0; i < bench->players; ++i) {
+		mCoreThreadEnd(&bench->threads[i]);
+		mCoreThreadJoin(&bench->threads[i]);
+	}
+	for (i = 0; i < MAX_GBAS; ++i) {
+		struct mCore* core = bench->threads[i].core;
+		if (core) {
+			mCoreConfigDeinit(&core->config);
+			core->deinit(core);
+		}
+		free(bench->outputBuffers[i]);
+	}
+	GBASIOLockstepCoordinatorDeinit(&bench->coordinator);
+	ConditionDeinit(&bench->frameDone);
+	MutexDeinit(&bench->mutex);
+	free(bench);
+}
+
+static struct GBALinkBench* _gbaLinkSetup(int players) {
+	uint8_t rom[0x400] = {0};
+	uint32_t branch = 0xEA000000 | ((0xC0 - 8) / 4);
+	size_t i;
+	STORE_32LE(branch, 0, rom);
+	rom[0xB2] = 0x96;
+	for (i = 0; i < sizeof(_gbaLinkCode) / sizeof(*_gbaLinkCode); ++i) {
+		STORE_32LE(_gbaLinkCode[i], 0xC0 + i * 4, rom);
+	}
+
+	struct GBALinkBench* bench = calloc(1, sizeof(*bench));
+	MutexInit(&bench->mutex);
+	ConditionInit(&bench->frameDone);
+	GBASIOLockstepCoordinatorInit(&bench->coordinator);
+	int p;
+	for (p = 0; p < players; ++p) {
+		struct mCoreThread* thread = &bench->threads[p];
+		struct mCore* core = GBACoreCreate();
+		if (!core) {
+			break;
+		}
+		if (!core->init(core)) {
+			free(core);
+			break;
+		}
+		thread->core = core;
+		mCoreInitConfig(core, NULL);
+		bench->outputBuffers[p] = calloc(256 * GBA_VIDEO_VERTICAL_PIXELS, BYTES_PER_PIXEL);
+		core->setVideoBuffer(core, bench->outputBuffers[p], 256);
+		struct VFile* vf = VFileMemChunk(rom, sizeof(rom));
+		if (!core->loadROM(core, vf)) {
+			vf->close(vf);
+			break;
+		}
+		thread->userData = bench;
+		thread->frameCallback = _gbaLinkFrame;
+		thread->logger.logger = &_benchLogger;
+		mLockstepThreadUserInit(&bench->users[p], thread);
+		bench->users[p].d.requestedId = _gbaLinkRequestedId;
+		GBASIOLockstepDriverCreate(&bench->drivers[p], &bench->users[p].d);
+		GBASIOLockstepCoordinatorAttach(&bench->coordinator, &bench->drivers[p]);
+		if (!mCoreThreadStart(thread)) {
+			break;
+		}
+		++bench->players;
+	}
+	if (bench->players < players) {
+		_gbaLinkTeardown(bench);
+		return NULL;
+	}
+
+	// Cores are linked once they're running, the way they are in the frontends
+	for (p = 0; p < players; ++p) {
+		struct mCoreThread* thread = &bench->threads[p];
+		mCoreThreadInterrupt(thread);
+		thread->core->setPeripheral(thread->core, mPERIPH_GBA_LINK_PORT, &bench->drivers[p].d);
+		mCoreThreadContinue(thread);
+	}
+	return bench;
+}
+
+static void* _gbaLink2PSetup(void) {
+	return _gbaLinkSetup(2);
+}
+
+static void* _gbaLink4PSetup(void) {
+	return _gbaLinkSetup(4);
+}
+
+// The players run freely between runs, so each run counts the frames every player
+// produces until the slowest one has run a fixed number of them
+static uint64_t _gbaLinkRun(void* context) {
+	struct GBALinkBench* bench = context;
+	uint64_t start[MAX_GBAS];
+	uint64_t total = 0;
+	int i;
+	MutexLock(&bench->mutex);
+	memcpy(start, bench->frames, sizeof(start));
+	while (true) {
+		for (i = 0; i < bench->players; ++i) {
+			if (bench->frames[i] - start[i] < GBA_LINK_FRAMES) {
+				break;
+			}
+		}
+		if (i == bench->players) {
+			break;
+		}
+		ConditionWait(&bench->frameDone, &bench->mutex);
+	}
+	for (i = 0; i < bench->players; ++i) {
+		total += bench->frames[i] - start[i];
+	}
+	MutexUnlock(&bench->mutex);
+	return total;
+}
+#endif
+#endif
+
+struct ResamplerBench {
+	struct mAudioBuffer source;
+	struct mAudioBuffer destination;
+	struct mAudioResampler resampler;
+	int16_t samples[RESAMPLER_CHUNK * 2];
+};
+
+static void* _resamplerSetup(enum mInterpolatorType type) {
+	struct ResamplerBench* bench = calloc(1, sizeof(*bench));
+	mAudioBufferInit(&bench->source, RESAMPLER_CHUNK * 2, 2);
+	mAudioBufferInit(&bench->destination, RESAMPLER_CHUNK * 4, 2);
+	mAudioResamplerInit(&bench->resampler, type);
+	mAudioResamplerSetSource(&bench->resampler, &bench->source, 32768, true);
+	mAudioResamplerSetDestination(&bench->resampler, &bench->destination, 48000);
+	uint32_t seed = 0x6D474241;
+	size_t i;
+	for (i = 0; i < RESAMPLER_CHUNK * 2; ++i) {
+		bench->samples[i] = _random(&seed);
+	}
+	return bench;
+}
+
+static void* _resamplerSincSetup(void) {
+	return _resamplerSetup(mINTERPOLATOR_SINC);
+}
+
+static void* _resamplerPolyphaseSetup(void) {
+	return _resamplerSetup(mINTERPOLATOR_POLYPHASE);
+}
+
+static uint64_t _resamplerRun(void* context) {
+	struct ResamplerBench* bench = context;
+	uint64_t produced = 0;
+	int i;
+	for (i = 0; i < RESAMPLER_CHUNKS; ++i) {
+		mAudioBufferWrite(&bench->source, bench->samples, RESAMPLER_CHUNK);
+		produced += mAudioResamplerProcess(&bench->resampler);
+		mAudioBufferRead(&bench->destination, NULL, mAudioBufferAvailable(&bench->destination));
+	}
+	return produced;
+}
+
+static void _resamplerTeardown(void* context) {
+	struct ResamplerBench* bench = context;
+	mAudioResamplerDeinit(&bench->resampler);
+	mAudioBufferDeinit(&bench->source);
+	mAudioBufferDeinit(&bench->destination);
+	free(bench);
+}
+
+struct ByteBench {
+	uint8_t in[BYTE_BUFFER_SIZE];
+	uint8_t out[BYTE_BUFFER_SIZE];
+	struct PatchFast patch;
+};
+
+static void* _byteSetup(void) {
+	struct ByteBench* bench = malloc(sizeof(*bench));
+	uint32_t seed = 0x6D474241;
+	size_t i;
+	for (i = 0; i < BYTE_BUFFER_SIZE; ++i) {
+		bench->in[i] = _random(&seed);
+	}
+	memcpy(bench->out, bench->in, BYTE_BUFFER_SIZE);
+	// Sparse runs of changes, similar to what a frame does to work RAM
+	for (i = 0; i < 64; ++i) {
+		size_t off = _random(&seed) % BYTE_BUFFER_SIZE;
+		size_t length = _random(&seed) % 300;
+		for (; length && off < BYTE_BUFFER_SIZE; --length, ++off) {
+			bench->out[off] ^= _random(&seed) | 1;
+		}
+	}
+	initPatchFast(&bench->patch);
+	return bench;
+}
+
+static uint64_t _patchFastRun(void* context) {
+	struct ByteBench* bench = context;
+	int i;
+	for (i = 0; i < PATCH_PASSES; ++i) {
+		diffPatchFast(&bench->patch, bench->in, bench->out, BYTE_BUFFER_SIZE);
+	}
+	_sink += PatchFastExtentsSize(&bench->patch.extents);
+	return PATCH_PASSES * BYTE_BUFFER_SIZE;
+}
+
+static uint64_t _crc32Run(void* context) {
+	struct ByteBench* bench = context;
+	uint32_t crc = 0;
+	int i;
+	for (i = 0; i < CRC32_PASSES; ++i) {
+		crc ^= doCrc32(bench->in, BYTE_BUFFER_SIZE);
+	}
+	_sink += crc;
+	return CRC32_PASSES * BYTE_BUFFER_SIZE;
+}
+
+static void _byteTeardown(void* context) {
+	struct ByteBench* bench = context;
+	deinitPatchFast(&bench->patch);
+	free(bench);
+}
+
+struct HashBench {
+	struct Table table;
+	char keys[HASH_KEYS][16];
+	uint32_t seed;
+};
+
+static void* _hashSetup(void) {
+	struct HashBench* bench = malloc(sizeof(*bench));
+	HashTableInit(&bench->table, 0, NULL);
+	bench->seed = 0x6D474241;
+	size_t i;
+	for (i = 0; i < HASH_KEYS; ++i) {
+		snprintf(bench->keys[i], sizeof(bench->keys[i]), "key%08X", _random(&bench->seed));
+		HashTableInsert(&bench->table, bench->keys[i], bench->keys[i]);
+	}
+	return bench;
+}
+
+static uint64_t _hashRun(void* context) {
+	struct HashBench* bench = context;
+	uintptr_t sum = 0;
+	long i;
+	for (i = 0; i < HASH_LOOKUPS; ++i) {
+		sum += (uintptr_t) HashTableLookup(&bench->table, bench->keys[(i * 7) % HASH_KEYS]);
+	}
+	_sink += sum;
+	return HASH_LOOKUPS;
+}
+
+static void _hashTeardown(void* context) {
+	struct HashBench* bench = context;
+	HashTableDeinit(&bench->table);
+	free(bench);
+}
+
+static const struct BenchKernel _kernels[] = {
+	{ "timing", "tick", _timingSetup, _timingRun, _timingTeardown },
+#ifdef M_CORE_GBA
+	{ "gba-load", "load", _gbaLoadSetup, _gbaLoadRun, _gbaTeardown },
+	{ "gba-store", "store", _gbaStoreSetup, _gbaStoreRun, _gbaTeardown },
+	{ "gba-draw-mode0", "line", _gbaDrawMode0Setup, _gbaDrawRun, _gbaTeardown },
+	{ "gba-draw-affine", "line", _gbaDrawAffineSetup, _gbaDrawRun, _gbaTeardown },
+	{ "gba-draw-mode3", "line", _gbaDrawMode3Setup, _gbaDrawRun, _gbaTeardown },
+	{ "gba-draw-mode4", "line", _gbaDrawMode4Setup, _gbaDrawRun, _gbaTeardown },
+	{ "gba-draw-obj", "line", _gbaDrawObjSetup, _gbaDrawRun, _gbaTeardown },
+#ifndef DISABLE_THREADING
+	{ "gba-link-2p", "frame", _gbaLink2PSetup, _gbaLinkRun, _gbaLinkTeardown },
+	{ "gba-link-4p", "frame", _gbaLink4PSetup, _gbaLinkRun, _gbaLinkTeardown },
+#endif
+#endif
+	{ "resample-sinc", "sample", _resamplerSincSetup, _resamplerRun, _resamplerTeardown },
+	{ "resample-polyphase", "sample", _resamplerPolyphaseSetup, _resamplerRun, _resamplerTeardown },
+	{ "patch-fast", "byte", _byteSetup, _patchFastRun, _byteTeardown },
+	{ "crc32", "byte", _byteSetup, _crc32Run, _byteTeardown },
+	{ "hash-lookup", "lookup", _hashSetup, _hashRun, _hashTeardown },
+};
+
+static bool _runKernel(const struct BenchKernel* kernel, int repeats) {
+	void* context = kernel->setup();
+	if (!context) {
+		fprintf(stderr, "%s: setup failed\n", kernel->name);
+		return false;
+	}
+	// One untimed pass to settle caches and any lazily allocated state
+	uint64_t ops = kernel->run(context);
+	uint64_t bestTime = UINT64_MAX;
+	uint64_t bestCycles = UINT64_MAX;
+	int i;
+	for (i = 0; i < repeats; ++i) {
+		uint64_t startTime = _benchClock();
+		uint64_t startCycles = _benchCycles();
+		ops = kernel->run(context);
+		uint64_t cycles = _benchCycles() - startCycles;
+		uint64_t time = _benchClock() - startTime;
+		if (time < bestTime) {
+			bestTime = time;
+		}
+		if (cycles < bestCycles) {
+			bestCycles = cycles;
+		}
+	}
+	kernel->teardown(context);
+
+	if (!ops) {
+		ops = 1;
+	}
+#ifdef BENCH_HAS_TSC
+	printf("%-20s %12" PRIu64 " %-7s %10.2f %10.2f\n", kernel->name, ops, kernel->unit, bestTime / (double) ops, bestCycles / (double) ops);
+#else
+	printf("%-20s %12" PRIu64 " %-7s %10.2f %10s\n", kernel->name, ops, kernel->unit, bestTime / (double) ops, "-");
+#endif
+	return true;
+}
+
+static void _usage(const char* arg0) {
+	fprintf(stderr, "usage: %s [-l] [-n REPEATS] [KERNEL ...]\n", arg0);
+	fprintf(stderr, "  -l          List available kernels\n");
+	fprintf(stderr, "  -n REPEATS  Time each kernel REPEATS times and report the fastest (default %i)\n", DEFAULT_REPEATS);
+}
+
+int main(int argc, char** argv) {
+	const size_t nKernels = sizeof(_kernels) / sizeof(*_kernels);
+	int repeats = DEFAULT_REPEATS;
+	bool selected[sizeof(_kernels) / sizeof(*_kernels)] = { false };
+	bool anySelected = false;
+	size_t k;
+	int i;
+	for (i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "-l") == 0) {
+			for (k = 0; k < nKernels; ++k) {
+				printf("%s\n", _kernels[k].name);
+			}
+			return 0;
+		}
+		if (strcmp(argv[i], "-n") == 0) {
+			if (i + 1 >= argc) {
+				_usage(argv[0]);
+				return 1;
+			}
+			repeats = strtol(argv[++i], NULL, 10);
+			if (repeats < 1) {
+				_usage(argv[0]);
+				return 1;
+			}
+			continue;
+		}
+		for (k = 0; k < nKernels; ++k) {
+			if (strcmp(argv[i], _kernels[k].name) == 0) {
+				selected[k] = true;
+				anySelected = true;
+				break;
+			}
+		}
+		if (k == nKernels) {
+			fprintf(stderr, "Unknown kernel: %s\n", argv[i]);
+			_usage(argv[0]);
+			return 1;
+		}
+	}
+
+	mLogSetDefaultLogger(&_benchLogger);
+	printf("%-20s %12s %-7s %10s %10s\n", "kernel", "ops", "unit", "ns/op", "cycles/op");
+	bool ok = true;
+	for (k = 0; k < nKernels; ++k) {
+		if (anySelected && !selected[k]) {
+			continue;
+		}
+		if (!_runKernel(&_kernels[k], repeats)) {
+			ok = false;
+		}
+	}
+	return ok ? 0 : 1;
+}
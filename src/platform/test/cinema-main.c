@@ -6,11 +6,13 @@
 #include <mgba/core/config.h>
 #include <mgba/core/core.h>
 #include <mgba/core/log.h>
+#include <mgba/core/timing.h>
 #include <mgba/core/version.h>
 #include <mgba/feature/commandline.h>
 #include <mgba/feature/video-logger.h>
 
 #include <mgba-util/image/png-io.h>
+#include <mgba-util/math.h>
 #include <mgba-util/string.h>
 #include <mgba-util/table.h>
 #include <mgba-util/threading.h>
@@ -28,6 +30,12 @@
 #include <getopt.h>
 #endif
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #include <setjmp.h>
 #include <signal.h>
 #include <stdlib.h>
@@ -37,6 +45,7 @@
 #define MAX_TEST 200
 #define MAX_JOBS 128
 #define LOG_THRESHOLD 1000000
+#define CALIBRATION_RUNS 3
 
 static const struct option longOpts[] = {
 	{ "4up",        no_argument, 0, '4' },
@@ -46,6 +55,8 @@ static const struct option longOpts[] = {
 	{ "jobs",       required_argument, 0, 'j' },
 	{ "dry-run",    no_argument, 0, 'n' },
 	{ "outdir",     required_argument, 0, 'o' },
+	{ "perf",       no_argument, 0, 'p' },
+	{ "perf-fail",  required_argument, 0, 'P' },
 	{ "quiet",      no_argument, 0, 'q' },
 	{ "rebaseline", no_argument, 0, 'r' },
 	{ "rebaseline-missing", no_argument, 0, 'R' },
@@ -55,7 +66,7 @@ static const struct option longOpts[] = {
 	{ 0, 0, 0, 0 }
 };
 
-static const char shortOpts[] = "4b:dhj:no:qRrvx";
+static const char shortOpts[] = "4b:dhj:no:pP:qRrvx";
 
 enum CInemaStatus {
 	CI_PASS,
@@ -82,6 +93,12 @@ struct CInemaTest {
 	unsigned totalFrames;
 	uint64_t totalDistance;
 	uint64_t totalPixels;
+	// Host time spent emulating, including skipped frames
+	uint64_t runTime;
+	unsigned runFrames;
+	double speed;
+	double budget;
+	struct mTimingProfile profile;
 	jmp_buf errorCtx;
 };
 
@@ -119,6 +136,11 @@ static bool is4Up = false;
 static enum CInemaRebaseline rebaseline = CI_R_NONE;
 static enum CInemaRebaseline xbaseline = CI_R_NONE;
 static int verbosity = 0;
+static bool perf = false;
+static bool perfFail = false;
+static double perfTolerance = 10;
+// Frames per second the calibration test ran at, which budgets are relative to
+static double calibrationFps = 0;
 
 static struct Table configTree;
 static Mutex configMutex;
@@ -135,6 +157,7 @@ bool CInemaTestInit(struct CInemaTest*, const char* directory, const char* filen
 void CInemaTestRun(struct CInemaTest*);
 
 bool CInemaConfigGetUInt(struct Table* configTree, const char* testName, const char* key, unsigned* value);
+bool CInemaConfigGetFloat(struct Table* configTree, const char* testName, const char* key, double* value);
 void CInemaConfigLoad(struct Table* configTree, const char* testName, struct mCore* core);
 
 static void _log(struct mLogger* log, int category, enum mLogLevel level, const char* format, va_list args);
@@ -275,6 +298,14 @@ static bool parseCInemaArgs(int argc, char* const* argv) {
 			strlcpy(outdir, optarg, sizeof(outdir));
 			// TODO: Make directory
 			break;
+		case 'p':
+			perf = true;
+			break;
+		case 'P':
+			perf = true;
+			perfFail = true;
+			perfTolerance = strtod(optarg, NULL);
+			break;
 		case 'q':
 			--verbosity;
 			break;
@@ -299,13 +330,16 @@ static bool parseCInemaArgs(int argc, char* const* argv) {
 }
 
 static void usageCInema(const char* arg0) {
-	printf("usage: %s [-dhnqrRv] [-j JOBS] [-b BASE] [-o DIR] [--version] [test...]\n", arg0);
+	printf("usage: %s [-dhnpqrRv] [-j JOBS] [-b BASE] [-o DIR] [-P PERCENT] [--version] [test...]\n", arg0);
 	puts("  -b, --base BASE            Path to the CInema base directory");
 	puts("  -d, --diffs                Output image diffs from failures");
 	puts("  -h, --help                 Print this usage and exit");
 	puts("  -j, --jobs JOBS            Run a number of jobs in parallel");
 	puts("  -n, --dry-run              List all collected tests instead of running them");
 	puts("  -o, --output DIR           Path to output applicable results");
+	puts("  -p, --perf                 Measure emulation speed against the calibration test");
+	puts("                             and warn about tests that are over their budget");
+	puts("  -P, --perf-fail PERCENT    Fail tests slower than their budget by PERCENT (implies -p)");
 	puts("  -q, --quiet                Decrease log verbosity (can be repeated)");
 	puts("  -r, --rebaseline           Rewrite the baseline for failing tests");
 	puts("  -R, --rebaseline-missing   Write missing baselines tests only");
@@ -562,6 +596,20 @@ bool CInemaConfigGetUInt(struct Table* configTree, const char* testName, const c
 	return true;
 }
 
+bool CInemaConfigGetFloat(struct Table* configTree, const char* testName, const char* key, double* out) {
+	const char* charValue = CInemaConfigGet(configTree, testName, key);
+	if (!charValue) {
+		return false;
+	}
+	char* end;
+	double value = strtod(charValue, &end);
+	if (*end) {
+		return false;
+	}
+	*out = value;
+	return true;
+}
+
 void CInemaConfigLoad(struct Table* configTree, const char* testName, struct mCore* core) {
 	_loadConfigTree(configTree, testName);
 
@@ -792,78 +840,141 @@ static bool _updateInput(struct mCore* core, size_t frame, const char** input) {
 	return true;
 }
 
-static bool _compareImages(struct CInemaTest* restrict test, const struct CInemaImage* restrict image, const struct CInemaImage* restrict expected, int* restrict max, uint8_t** restrict outdiff) {
-	const uint8_t* testPixels = image->data;
-	const uint8_t* expectPixels = expected->data;
-	uint8_t* diff = NULL;
-	size_t x;
-	size_t y;
-	bool failed = false;
-	for (y = 0; y < image->height; ++y) {
-		for (x = 0; x < image->width; ++x) {
-			size_t pix = expected->stride * y + x;
-			size_t tpix = image->stride * y + x;
+struct CInemaRowDiff {
+	size_t failedPixels;
+	uint64_t distance;
+	int max;
+};
+
+// Compares one row of pixels, ignoring alpha. If diff is non-NULL, the per-channel distance
+// of every pixel in the row is written to it, laid out like the pixels themselves.
+static void _compareRow(const uint8_t* restrict test, const uint8_t* restrict expect, uint8_t* restrict diff, size_t width, struct CInemaRowDiff* restrict out) {
+	size_t x = 0;
+	out->failedPixels = 0;
+	out->distance = 0;
+	out->max = 0;
+#if defined(__SSE2__)
+	const __m128i mask = _mm_set1_epi32(0x00FFFFFF);
+	const __m128i zero = _mm_setzero_si128();
+	__m128i maxv = zero;
+	for (; x + 4 <= width; x += 4) {
+		__m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i*) &test[x * 4]), mask);
+		__m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i*) &expect[x * 4]), mask);
+		__m128i d = _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+		int same = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(d, zero)));
+		if (diff) {
+			_mm_storeu_si128((__m128i*) &diff[x * 4], d);
+		}
+		if (same == 0xF) {
+			continue;
+		}
+		out->failedPixels += 4 - popcount32(same);
+		__m128i sad = _mm_sad_epu8(d, zero);
+		out->distance += _mm_cvtsi128_si32(sad) + _mm_cvtsi128_si32(_mm_srli_si128(sad, 8));
+		maxv = _mm_max_epu8(maxv, d);
+	}
+	uint8_t lanes[16];
+	_mm_storeu_si128((__m128i*) lanes, maxv);
+	size_t i;
+	for (i = 0; i < sizeof(lanes); ++i) {
+		if (lanes[i] > out->max) {
+			out->max = lanes[i];
+		}
+	}
+#elif defined(__ARM_NEON) && !defined(__BIG_ENDIAN__)
+	const uint8x16_t mask = vreinterpretq_u8_u32(vdupq_n_u32(0x00FFFFFF));
+	uint8x16_t maxv = vdupq_n_u8(0);
+	for (; x + 4 <= width; x += 4) {
+		uint8x16_t d = vandq_u8(vabdq_u8(vld1q_u8(&test[x * 4]), vld1q_u8(&expect[x * 4])), mask);
+		if (diff) {
+			vst1q_u8(&diff[x * 4], d);
+		}
+		uint32x4_t changed = vshrq_n_u32(vtstq_u32(vreinterpretq_u32_u8(d), vreinterpretq_u32_u8(d)), 31);
+		uint64x2_t count = vpaddlq_u32(changed);
+		size_t failed = vgetq_lane_u64(count, 0) + vgetq_lane_u64(count, 1);
+		if (!failed) {
+			continue;
+		}
+		out->failedPixels += failed;
+		uint64x2_t sum = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(d)));
+		out->distance += vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1);
+		maxv = vmaxq_u8(maxv, d);
+	}
+	uint8_t lanes[16];
+	vst1q_u8(lanes, maxv);
+	size_t i;
+	for (i = 0; i < sizeof(lanes); ++i) {
+		if (lanes[i] > out->max) {
+			out->max = lanes[i];
+		}
+	}
+#endif
+	for (; x < width; ++x) {
 #ifndef __BIG_ENDIAN__
-			int testR = testPixels[tpix * 4 + 0];
-			int testG = testPixels[tpix * 4 + 1];
-			int testB = testPixels[tpix * 4 + 2];
-			int expectR = expectPixels[pix * 4 + 0];
-			int expectG = expectPixels[pix * 4 + 1];
-			int expectB = expectPixels[pix * 4 + 2];
+		int r = abs(expect[x * 4 + 0] - test[x * 4 + 0]);
+		int g = abs(expect[x * 4 + 1] - test[x * 4 + 1]);
+		int b = abs(expect[x * 4 + 2] - test[x * 4 + 2]);
 #else
-			int testB = testPixels[tpix * 4 + 1];
-			int testG = testPixels[tpix * 4 + 2];
-			int testR = testPixels[tpix * 4 + 3];
-			int expectB = expectPixels[pix * 4 + 1];
-			int expectG = expectPixels[pix * 4 + 2];
-			int expectR = expectPixels[pix * 4 + 3];
+		int b = abs(expect[x * 4 + 1] - test[x * 4 + 1]);
+		int g = abs(expect[x * 4 + 2] - test[x * 4 + 2]);
+		int r = abs(expect[x * 4 + 3] - test[x * 4 + 3]);
 #endif
-			int r = expectR - testR;
-			int g = expectG - testG;
-			int b = expectB - testB;
-			if (r | g | b) {
-				failed = true;
-				if (outdiff && !diff) {
-					diff = calloc(expected->stride * expected->height, BYTES_PER_PIXEL);
-					*outdiff = diff;
-				}
-				test->status = CI_FAIL;
-				if (r < 0) {
-					r = -r;
-				}
-				if (g < 0) {
-					g = -g;
-				}
-				if (b < 0) {
-					b = -b;
-				}
-
-				if (diff) {
-					if (r > *max) {
-						*max = r;
-					}
-					if (g > *max) {
-						*max = g;
-					}
-					if (b > *max) {
-						*max = b;
-					}
+		if (diff) {
 #ifndef __BIG_ENDIAN__
-					diff[pix * 4 + 0] = r;
-					diff[pix * 4 + 1] = g;
-					diff[pix * 4 + 2] = b;
+			diff[x * 4 + 0] = r;
+			diff[x * 4 + 1] = g;
+			diff[x * 4 + 2] = b;
 #else
-					diff[pix * 4 + 1] = b;
-					diff[pix * 4 + 2] = g;
-					diff[pix * 4 + 3] = r;
+			diff[x * 4 + 1] = b;
+			diff[x * 4 + 2] = g;
+			diff[x * 4 + 3] = r;
 #endif
-				}
+		}
+		if (!(r | g | b)) {
+			continue;
+		}
+		++out->failedPixels;
+		out->distance += r + g + b;
+		if (r > out->max) {
+			out->max = r;
+		}
+		if (g > out->max) {
+			out->max = g;
+		}
+		if (b > out->max) {
+			out->max = b;
+		}
+	}
+}
 
-				if (test) {
-					test->totalDistance += r + g + b;
-					++test->failedPixels;
-				}
-			}
+static bool _compareImages(struct CInemaTest* restrict test, const struct CInemaImage* restrict image, const struct CInemaImage* restrict expected, int* restrict max, uint8_t** restrict outdiff) {
+	const uint8_t* testPixels = image->data;
+	const uint8_t* expectPixels = expected->data;
+	uint8_t* diff = NULL;
+	size_t y;
+	bool failed = false;
+	for (y = 0; y < image->height; ++y) {
+		const uint8_t* testRow = &testPixels[image->stride * y * 4];
+		const uint8_t* expectRow = &expectPixels[expected->stride * y * 4];
+		struct CInemaRowDiff row;
+		_compareRow(testRow, expectRow, diff ? &diff[expected->stride * y * 4] : NULL, image->width, &row);
+		if (!row.failedPixels) {
+			continue;
+		}
+		failed = true;
+		if (outdiff && !diff) {
+			// Rows before this one matched, so only this row needs to be filled in
+			diff = calloc(expected->stride * expected->height, BYTES_PER_PIXEL);
+			*outdiff = diff;
+			_compareRow(testRow, expectRow, &diff[expected->stride * y * 4], image->width, &row);
+		}
+		test->status = CI_FAIL;
+		if (diff && row.max > *max) {
+			*max = row.max;
+		}
+		if (test) {
+			test->totalDistance += row.distance;
+			test->failedPixels += row.failedPixels;
 		}
 	}
 	return !failed;
@@ -996,6 +1107,40 @@ static void _replayBaseline(struct CInemaTest* test, struct FFmpegEncoder* encod
 }
 #endif
 
+static uint64_t _cinemaClock(void) {
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec * UINT64_C(1000000000) + tv.tv_usec * UINT64_C(1000);
+#endif
+}
+
+static double _budgetChange(const struct CInemaTest* test) {
+	return (test->speed - test->budget) * 100. / test->budget;
+}
+
+static void _checkBudget(struct CInemaTest* test) {
+	if (!calibrationFps || !test->runTime || test->status == CI_ERROR) {
+		return;
+	}
+	test->speed = test->runFrames * 1e9 / test->runTime / calibrationFps;
+
+	MutexLock(&configMutex);
+	bool hasBudget = CInemaConfigGetFloat(&configTree, test->name, "perf", &test->budget);
+	MutexUnlock(&configMutex);
+	if (!hasBudget || test->budget <= 0) {
+		test->budget = 0;
+		return;
+	}
+	if (perfFail && _budgetChange(test) < -perfTolerance) {
+		test->status = CI_FAIL;
+	}
+}
+
 void CInemaTestRun(struct CInemaTest* test) {
 	unsigned ignore = 0;
 	MutexLock(&configMutex);
@@ -1069,12 +1214,20 @@ void CInemaTestRun(struct CInemaTest* test) {
 	core->reset(core);
 
 	test->status = CI_PASS;
+	if (perf && verbosity >= 2) {
+		test->profile.clock = _cinemaClock;
+		mTimingProfileReset(&test->profile);
+		core->timing->profile = &test->profile;
+	}
 
 	unsigned minFrame = core->frameCounter(core);
+	uint64_t start = _cinemaClock();
 	size_t frame;
 	for (frame = 0; frame < skip; ++frame) {
 		core->runFrame(core);
 	}
+	test->runTime += _cinemaClock() - start;
+	test->runFrames += skip;
 	core->currentVideoSize(core, &image.width, &image.height);
 
 #ifdef USE_FFMPEG
@@ -1129,7 +1282,10 @@ void CInemaTestRun(struct CInemaTest* test) {
 		if (setjmp(test->errorCtx)) {
 			break;
 		}
+		start = _cinemaClock();
 		core->runFrame(core);
+		test->runTime += _cinemaClock() - start;
+		++test->runFrames;
 		++test->totalFrames;
 		unsigned frameCounter = core->frameCounter(core);
 		if (frameCounter <= minFrame) {
@@ -1275,7 +1431,9 @@ void CInemaTestRun(struct CInemaTest* test) {
 			test->status = CI_XPASS;
 		}
 	}
+	_checkBudget(test);
 
+	core->timing->profile = NULL;
 	free(image.data);
 	mCoreConfigDeinit(&core->config);
 	core->deinit(core);
@@ -1321,10 +1479,82 @@ static bool CInemaTask(struct CInemaTestList* tests, size_t i) {
 			CIlog(2, "\tfailed pixels: %" PRIu64 "/%" PRIu64 " (%1.3g%%)\n", test->failedPixels, test->totalPixels, test->failedPixels / (test->totalPixels * 0.01));
 			CIlog(2, "\tdistance: %" PRIu64 "/%" PRIu64 " (%1.3g%%)\n", test->totalDistance, test->totalPixels * 765, test->totalDistance / (test->totalPixels * 7.65));
 		}
+		if (test->budget) {
+			double change = _budgetChange(test);
+			CIlog(1, "\tspeed: %.3gx calibration, budget %.3gx (%+.1f%%)\n", test->speed, test->budget, change);
+			if (change < -perfTolerance) {
+				CIerr(0, "%s: %.3gx calibration speed is %.1f%% under its budget of %.3gx\n", test->name, test->speed, -change, test->budget);
+			}
+		} else if (test->speed) {
+			CIlog(1, "\tspeed: %.3gx calibration\n", test->speed);
+		}
+		if (test->profile.clock && test->runFrames) {
+			CIlog(2, "\tscheduler: %.1f%% of emulation time\n", test->profile.tickTime * 100. / test->runTime);
+			size_t i;
+			for (i = 0; i < test->profile.nEntries; ++i) {
+				const struct mTimingProfileEntry* entry = &test->profile.entries[i];
+				CIlog(2, "\t\t%-24s %8.2f us/frame %8.2f fires/frame\n", entry->name ? entry->name : "Other",
+				      entry->time / 1000. / test->runFrames, (double) entry->count / test->runFrames);
+			}
+		}
 	}
 	return success;
 }
 
+// Budgets are relative to the speed of the calibration test, so that they hold up on hosts
+// that are faster or slower overall. It gets the best of a few runs to even out noise.
+static bool _calibrate(void) {
+	const char* name = CInemaConfigGet(&configTree, "", "calibration");
+	if (!name) {
+		CIerr(0, "No calibration test configured\n");
+		return false;
+	}
+	char path[PATH_MAX];
+	testToPath(name, path);
+
+	struct CInemaTestList tests;
+	CInemaTestListInit(&tests, 0);
+	const struct CInemaTest* found = NULL;
+	if (collectTests(&tests, path)) {
+		size_t i;
+		for (i = 0; i < CInemaTestListSize(&tests); ++i) {
+			const struct CInemaTest* test = CInemaTestListGetConstPointer(&tests, i);
+			if (strncmp(test->name, name, sizeof(test->name)) == 0) {
+				found = test;
+				break;
+			}
+		}
+	}
+	if (!found) {
+		CIerr(0, "Calibration test %s not found\n", name);
+		CInemaTestListDeinit(&tests);
+		return false;
+	}
+
+	double best = 0;
+	int i;
+	for (i = 0; i < CALIBRATION_RUNS; ++i) {
+		struct CInemaTest test;
+		CInemaTestInit(&test, found->directory, found->filename);
+		ThreadLocalSetKey(currentTest, &test);
+		CInemaTestRun(&test);
+		ThreadLocalSetKey(currentTest, NULL);
+		if (test.status == CI_ERROR || test.status == CI_SKIP || !test.runTime) {
+			CIerr(0, "Calibration test %s did not run\n", name);
+			CInemaTestListDeinit(&tests);
+			return false;
+		}
+		double fps = test.runFrames * 1e9 / test.runTime;
+		if (fps > best) {
+			best = fps;
+		}
+	}
+	CInemaTestListDeinit(&tests);
+	CIlog(1, "Calibration: %s at %.1f fps\n", name, best);
+	calibrationFps = best;
+	return true;
+}
+
 static THREAD_ENTRY CInemaJob(void* context) {
 	struct CInemaTestList* tests = context;
 	struct CInemaLogStream stream;
@@ -1496,7 +1726,13 @@ int main(int argc, char** argv) {
 	ThreadLocalInitKey(&currentTest);
 	ThreadLocalSetKey(currentTest, NULL);
 
-	if (jobs == 1) {
+	if (perf && jobs > 1) {
+		CIerr(0, "Test speeds are less consistent when running multiple jobs\n");
+	}
+
+	if (perf && !dryRun && CInemaTestListSize(&tests) && !_calibrate()) {
+		status = 1;
+	} else if (jobs == 1) {
 		size_t i;
 		for (i = 0; i < CInemaTestListSize(&tests); ++i) {
 			bool success = CInemaTask(&tests, i);
@@ -19,7 +19,7 @@
 #include <errno.h>
 #include <signal.h>
 
-#define FUZZ_OPTIONS "F:M:NO:S:V:"
+#define FUZZ_OPTIONS "F:M:NO:PS:T:V:W:"
 #define FUZZ_USAGE \
 	"Additional options:\n" \
 	"  -F FRAMES        Run for the specified number of FRAMES before exiting\n" \
@@ -27,6 +27,17 @@
 	"  -O OFFSET        Offset to apply savestate overlay\n" \
 	"  -V FILE          Overlay a second savestate over the loaded savestate\n" \
 	"  -M FILE          Attach a memory access log file\n" \
+	"  -P               Persistent mode: boot once, then restore a snapshot for each test case\n" \
+	"  -T TYPE          Type of test case in persistent mode: keys (default) or save\n" \
+	"  -W FRAMES        Run for FRAMES before taking the snapshot in persistent mode\n" \
+
+// In persistent mode, a keys test case is a series of little-endian 16-bit key states,
+// one per frame. Unless -F is given, each test case runs for as many frames as it has key
+// states. A save test case replaces the savedata before running -F frames.
+enum FuzzInputType {
+	FUZZ_INPUT_KEYS = 0,
+	FUZZ_INPUT_SAVE,
+};
 
 struct FuzzOpts {
 	bool noVideo;
@@ -34,9 +45,24 @@ struct FuzzOpts {
 	size_t overlayOffset;
 	char* ssOverlay;
 	char* accessLog;
+	bool persistent;
+	enum FuzzInputType inputType;
+	int warmupFrames;
+};
+
+struct FuzzSnapshot {
+	void* state;
+	uint32_t checkpoint;
+	void* savedata;
+	size_t savedataSize;
 };
 
+#ifdef __AFL_FUZZ_TESTCASE_LEN
+__AFL_FUZZ_INIT();
+#endif
+
 static void _fuzzRunloop(struct mCore* core, int frames);
+static void _fuzzPersistent(struct mCore* core, const struct FuzzOpts* opts);
 static void _fuzzShutdown(int signal);
 static bool _parseFuzzOpts(struct mSubParser* parser, int option, const char* arg);
 
@@ -45,7 +71,7 @@ static bool _dispatchExiting = false;
 int main(int argc, char** argv) {
 	signal(SIGINT, _fuzzShutdown);
 
-	struct FuzzOpts fuzzOpts = { false, 0, 0, 0 };
+	struct FuzzOpts fuzzOpts = { false, 0, 0, 0, .inputType = FUZZ_INPUT_KEYS };
 	struct mSubParser subparser = {
 		.usage = FUZZ_USAGE,
 		.parse = _parseFuzzOpts,
@@ -91,7 +117,10 @@ int main(int argc, char** argv) {
 #endif
 
 #ifdef __AFL_HAVE_MANUAL_CONTROL
-	__AFL_INIT();
+	// Persistent mode starts the fork server once it's done booting instead
+	if (!fuzzOpts.persistent) {
+		__AFL_INIT();
+	}
 #endif
 
 	bool cleanExit = true;
@@ -130,6 +159,7 @@ int main(int argc, char** argv) {
 		mDebuggerAccessLoggerInit(&accessLog);
 		mDebuggerAttachModule(&debugger, &accessLog.d);
 		mDebuggerAccessLoggerOpen(&accessLog, vf, O_RDWR);
+		mDebuggerAccessLoggerSetBatched(&accessLog, true);
 		mDebuggerAccessLoggerStart(&accessLog);
 		hasDebugger = true;
 	}
@@ -159,7 +189,11 @@ int main(int argc, char** argv) {
 		savestate = NULL;
 	}
 
-	_fuzzRunloop(core, fuzzOpts.frames);
+	if (fuzzOpts.persistent) {
+		_fuzzPersistent(core, &fuzzOpts);
+	} else {
+		_fuzzRunloop(core, fuzzOpts.frames);
+	}
 
 	if (hasDebugger) {
 		core->detachDebugger(core);
@@ -195,6 +229,99 @@ static void _fuzzRunloop(struct mCore* core, int frames) {
 	} while (frames > 0 && !_dispatchExiting);
 }
 
+static void _fuzzTakeSnapshot(struct mCore* core, struct FuzzSnapshot* snapshot) {
+	snapshot->state = anonymousMemoryMap(core->stateSize(core));
+	snapshot->checkpoint = 0;
+	if (core->saveStateIncremental) {
+		snapshot->checkpoint = core->saveStateIncremental(core, snapshot->state, 0, NULL);
+	}
+	if (!snapshot->checkpoint) {
+		core->saveState(core, snapshot->state);
+	}
+	// Savedata isn't part of the state, so it has to be put back separately
+	snapshot->savedataSize = core->savedataClone(core, &snapshot->savedata);
+}
+
+static void _fuzzRestoreSnapshot(struct mCore* core, struct FuzzSnapshot* snapshot) {
+	// Only the pages the last test case touched need to be copied back
+	if (snapshot->checkpoint) {
+		snapshot->checkpoint = core->loadStateIncremental(core, snapshot->state, snapshot->checkpoint);
+	}
+	if (!snapshot->checkpoint) {
+		core->loadState(core, snapshot->state);
+	}
+	if (snapshot->savedataSize) {
+		core->savedataRestore(core, snapshot->savedata, snapshot->savedataSize, false);
+	}
+}
+
+static void _fuzzOneInput(struct mCore* core, struct FuzzSnapshot* snapshot, const struct FuzzOpts* opts, const uint8_t* data, size_t size) {
+	_fuzzRestoreSnapshot(core, snapshot);
+	int frames = opts->frames;
+	switch (opts->inputType) {
+	case FUZZ_INPUT_KEYS:
+		if (!frames) {
+			frames = size / 2;
+		}
+		int i;
+		uint16_t keys = 0;
+		for (i = 0; i < frames && !_dispatchExiting; ++i) {
+			if ((size_t) i * 2 + 1 < size) {
+				keys = data[i * 2] | (data[i * 2 + 1] << 8);
+			}
+			core->setKeys(core, keys);
+			core->runFrame(core);
+			mAudioBufferClear(core->getAudioBuffer(core));
+		}
+		break;
+	case FUZZ_INPUT_SAVE:
+		if (size) {
+			core->savedataRestore(core, data, size, false);
+		}
+		if (frames) {
+			_fuzzRunloop(core, frames);
+		}
+		break;
+	}
+}
+
+static void _fuzzPersistent(struct mCore* core, const struct FuzzOpts* opts) {
+	if (opts->warmupFrames) {
+		_fuzzRunloop(core, opts->warmupFrames);
+	}
+	struct FuzzSnapshot snapshot;
+	_fuzzTakeSnapshot(core, &snapshot);
+
+#ifdef __AFL_FUZZ_TESTCASE_LEN
+#ifdef __AFL_HAVE_MANUAL_CONTROL
+	__AFL_INIT();
+#endif
+	// Test cases come through shared memory, so there's no file I/O between runs
+	const uint8_t* data = __AFL_FUZZ_TESTCASE_BUF;
+	while (__AFL_LOOP(10000) && !_dispatchExiting) {
+		_fuzzOneInput(core, &snapshot, opts, data, __AFL_FUZZ_TESTCASE_LEN);
+	}
+#else
+	// Outside of AFL++, run the single test case given on stdin
+	size_t size = 0;
+	size_t capacity = 0x1000;
+	uint8_t* data = malloc(capacity);
+	size_t read;
+	while ((read = fread(&data[size], 1, capacity - size, stdin)) > 0) {
+		size += read;
+		if (size == capacity) {
+			capacity *= 2;
+			data = realloc(data, capacity);
+		}
+	}
+	_fuzzOneInput(core, &snapshot, opts, data, size);
+	free(data);
+#endif
+
+	mappedMemoryFree(snapshot.state, core->stateSize(core));
+	free(snapshot.savedata);
+}
+
 static void _fuzzShutdown(int signal) {
 	UNUSED(signal);
 	_dispatchExiting = true;
@@ -216,9 +343,24 @@ static bool _parseFuzzOpts(struct mSubParser* parser, int option, const char* ar
 	case 'O':
 		opts->overlayOffset = strtoul(arg, 0, 10);
 		return !errno;
+	case 'P':
+		opts->persistent = true;
+		return true;
+	case 'T':
+		if (strcmp(arg, "keys") == 0) {
+			opts->inputType = FUZZ_INPUT_KEYS;
+		} else if (strcmp(arg, "save") == 0) {
+			opts->inputType = FUZZ_INPUT_SAVE;
+		} else {
+			return false;
+		}
+		return true;
 	case 'V':
 		opts->ssOverlay = strdup(arg);
 		return true;
+	case 'W':
+		opts->warmupFrames = strtoul(arg, 0, 10);
+		return !errno;
 	default:
 		return false;
 	}
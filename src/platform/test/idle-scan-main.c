@@ -0,0 +1,146 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/config.h>
+#include <mgba/core/core.h>
+#include <mgba/core/log.h>
+#include <mgba/gba/interface.h>
+#include <mgba/internal/gba/gba.h>
+
+#include <mgba-util/configuration.h>
+#include <mgba-util/string.h>
+#include <mgba-util/vfs.h>
+
+#include <getopt.h>
+#include <stdio.h>
+
+// Runs each ROM headless with idle loop detection enabled and records what it finds in
+// the idle loop cache, so that later sessions start with the idle loop already known.
+
+#define DEFAULT_FRAMES 1200
+
+static void _log(struct mLogger* log, int category, enum mLogLevel level, const char* format, va_list args) {
+	UNUSED(log);
+	UNUSED(category);
+	UNUSED(level);
+	UNUSED(format);
+	UNUSED(args);
+}
+
+enum ScanResult {
+	SCAN_ERROR,
+	SCAN_KNOWN,
+	SCAN_FOUND,
+	SCAN_NOT_FOUND,
+};
+
+static enum ScanResult _scan(const char* fname, int frames, uint32_t* crc32, uint32_t* idleLoop) {
+	struct mCore* core = mCoreFind(fname);
+	if (!core) {
+		return SCAN_ERROR;
+	}
+	if (core->platform(core) != mPLATFORM_GBA || !core->init(core)) {
+		free(core);
+		return SCAN_ERROR;
+	}
+	if (!mCoreLoadFile(core, fname)) {
+		core->deinit(core);
+		return SCAN_ERROR;
+	}
+	mCoreConfigInit(&core->config, "idle-scan");
+	mCoreConfigSetDefaultValue(&core->config, "idleOptimization", "detect");
+	mCoreLoadConfig(core);
+	core->reset(core);
+
+	struct GBA* gba = core->board;
+	enum ScanResult result = SCAN_NOT_FOUND;
+	*crc32 = gba->romCrc32;
+	if (gba->idleLoop != GBA_IDLE_LOOP_NONE) {
+		// Overrides already cover this game
+		result = SCAN_KNOWN;
+	} else {
+		int i;
+		for (i = 0; i < frames && gba->idleOptimization == IDLE_LOOP_DETECT; ++i) {
+			core->runFrame(core);
+		}
+		if (gba->idleOptimization == IDLE_LOOP_REMOVE && gba->idleLoop != GBA_IDLE_LOOP_NONE) {
+			*idleLoop = gba->idleLoop;
+			result = SCAN_FOUND;
+		}
+	}
+
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+	return result;
+}
+
+int main(int argc, char** argv) {
+	int frames = DEFAULT_FRAMES;
+	char path[PATH_MAX + 1] = "";
+	int ch;
+	while ((ch = getopt(argc, argv, "f:o:")) != -1) {
+		switch (ch) {
+		case 'f':
+			frames = strtol(optarg, NULL, 10);
+			break;
+		case 'o':
+			strlcpy(path, optarg, sizeof(path));
+			break;
+		default:
+			frames = 0;
+			break;
+		}
+	}
+	if (optind >= argc || frames < 1) {
+		fprintf(stderr, "usage: %s [-f FRAMES] [-o FILE] ROM...\n", argv[0]);
+		fprintf(stderr, "Scans each ROM for %i frames by default and adds detected idle loops to FILE,\n", DEFAULT_FRAMES);
+		fprintf(stderr, "which defaults to " GBA_IDLE_LOOP_CACHE_FILE " in the configuration directory\n");
+		return 1;
+	}
+	if (!path[0]) {
+		mCoreConfigDirectory(path, PATH_MAX);
+		strncat(path, PATH_SEP GBA_IDLE_LOOP_CACHE_FILE, PATH_MAX - strlen(path));
+	}
+
+	struct mLogger logger = { .log = _log };
+	mLogSetDefaultLogger(&logger);
+
+	struct Configuration cache;
+	ConfigurationInit(&cache);
+	ConfigurationRead(&cache, path);
+
+	int found = 0;
+	for (; optind < argc; ++optind) {
+		const char* fname = argv[optind];
+		uint32_t crc32 = 0;
+		uint32_t idleLoop = GBA_IDLE_LOOP_NONE;
+		switch (_scan(fname, frames, &crc32, &idleLoop)) {
+		case SCAN_ERROR:
+			printf("%s: not a GBA ROM\n", fname);
+			break;
+		case SCAN_KNOWN:
+			printf("%s: %08X: idle loop already in overrides\n", fname, crc32);
+			break;
+		case SCAN_FOUND:
+			printf("%s: %08X: idle loop at %08X\n", fname, crc32, idleLoop);
+			GBAIdleLoopCacheSave(&cache, crc32, idleLoop);
+			++found;
+			break;
+		case SCAN_NOT_FOUND:
+			printf("%s: %08X: no idle loop found\n", fname, crc32);
+			break;
+		}
+	}
+
+	bool ok = true;
+	if (found) {
+		ok = ConfigurationWrite(&cache, path);
+		if (!ok) {
+			fprintf(stderr, "Could not write %s\n", path);
+		}
+	}
+	ConfigurationDeinit(&cache);
+	return !ok;
+}
@@ -7,12 +7,16 @@
 #include <mgba/core/config.h>
 #include <mgba/core/core.h>
 #include <mgba/core/serialize.h>
+#include <mgba/core/shared-rom.h>
+#include <mgba/core/timing.h>
 #include <mgba/gb/core.h>
 #include <mgba/gba/core.h>
 
 #include <mgba/feature/commandline.h>
 #include <mgba-util/socket.h>
 #include <mgba-util/string.h>
+#include <mgba-util/threading.h>
+#include <mgba-util/vector.h>
 #include <mgba-util/vfs.h>
 
 #ifdef __3DS__
@@ -37,31 +41,77 @@ size_t romBufferSize;
 
 #include <errno.h>
 #include <fcntl.h>
+#include <math.h>
 #include <signal.h>
 #include <inttypes.h>
 #include <sys/time.h>
+#include <time.h>
 
-#define PERF_OPTIONS "DF:L:NPS:T"
+#define PERF_OPTIONS "B:DF:IJK:L:NPR:S:TW:X:"
 #define PERF_USAGE \
 	"Benchmark options:\n" \
 	"  -F FRAMES        Run for the specified number of FRAMES before exiting\n" \
 	"  -N               Disable video rendering entirely\n" \
 	"  -T               Use threaded video rendering\n" \
 	"  -P               CSV output, useful for parsing\n" \
+	"  -J               JSON output, one object per line\n" \
 	"  -S SEC           Run for SEC in-game seconds before exiting\n" \
 	"  -L FILE          Load a savestate when starting the test\n" \
+	"  -R COUNT         Repeat the test COUNT times and report statistics\n" \
+	"  -W FRAMES        Run FRAMES untimed frames before each repetition\n" \
+	"  -I               Break down time by subsystem (adds some overhead)\n" \
+	"  -B FILE          Compare against a baseline saved from CSV output\n" \
+	"  -X PERCENT       Fail if slower than the baseline by PERCENT (default 5)\n" \
+	"  -K THREADS       Run the ROMs concurrently on up to THREADS threads and\n" \
+	"                   report throughput and scaling efficiency\n" \
 	"  -D               Act as a server"
 
+#define PERF_THROUGHPUT_CSV_HEADER "threads,roms,frames,duration,fps,fps_per_core,efficiency,renderer\n"
+#define PERF_CSV_HEADER "game_code,frames,duration,renderer,iterations,warmup,fps_mean,fps_median,fps_stddev,cpu,video,audio,dma,scheduler,other,baseline_fps,change\n"
+
 struct PerfOpts {
 	bool noVideo;
 	bool threadedVideo;
 	bool csv;
+	bool json;
+	bool instrument;
 	unsigned duration;
 	unsigned frames;
+	unsigned iterations;
+	unsigned warmup;
+	unsigned threads;
+	struct StringList roms;
 	char* savestate;
+	char* baseline;
+	double tolerance;
 	bool server;
 };
 
+enum PerfSubsystem {
+	PERF_CPU,
+	PERF_VIDEO,
+	PERF_AUDIO,
+	PERF_DMA,
+	PERF_SCHEDULER,
+	PERF_OTHER,
+	PERF_MAX
+};
+
+static const char* const _subsystemNames[PERF_MAX] = {
+	[PERF_CPU] = "cpu",
+	[PERF_VIDEO] = "video",
+	[PERF_AUDIO] = "audio",
+	[PERF_DMA] = "dma",
+	[PERF_SCHEDULER] = "scheduler",
+	[PERF_OTHER] = "other",
+};
+
+struct PerfStats {
+	double mean;
+	double median;
+	double stddev;
+};
+
 #ifdef __SWITCH__
 TimeType __nx_time_type = TimeType_LocalSystemClock;
 #endif
@@ -69,12 +119,18 @@ TimeType __nx_time_type = TimeType_LocalSystemClock;
 static void _mPerfRunloop(struct mCore* context, int* frames, bool quiet);
 static void _mPerfShutdown(int signal);
 static bool _parsePerfOpts(struct mSubParser* parser, int option, const char* arg);
+static bool _handlePerfExtraArg(struct mSubParser* parser, const char* arg);
 static void _log(struct mLogger*, int, enum mLogLevel, const char*, va_list);
 static bool _mPerfRunCore(const char* fname, const struct mArguments*, const struct PerfOpts*);
 static bool _mPerfRunServer(const struct mArguments*, const struct PerfOpts*);
+#ifndef DISABLE_THREADING
+static bool _mPerfRunThroughput(const struct mArguments*, const struct PerfOpts*);
+#endif
 
 static bool _dispatchExiting = false;
+static bool _regressed = false;
 static struct VFile* _savestate = 0;
+static struct VFile* _baseline = 0;
 static void* _outputBuffer = NULL;
 static Socket _socket = INVALID_SOCKET;
 static Socket _server = INVALID_SOCKET;
@@ -121,21 +177,31 @@ int main(int argc, char** argv) {
 	struct mLogger logger = { .log = _log };
 	mLogSetDefaultLogger(&logger);
 
-	struct PerfOpts perfOpts = { false, false, false, 0, 0, 0, false };
+	struct PerfOpts perfOpts = { .iterations = 1, .tolerance = 5 };
+	StringListInit(&perfOpts.roms, 0);
 	struct mSubParser subparser = {
 		.usage = PERF_USAGE,
 		.parse = _parsePerfOpts,
+		.handleExtraArg = _handlePerfExtraArg,
 		.extraOptions = PERF_OPTIONS,
 		.opts = &perfOpts
 	};
 
 	struct mArguments args = {};
 	bool parsed = mArgumentsParse(&args, argc, argv, &subparser, 1);
-	if (!args.fname && !perfOpts.server) {
+	if (args.fname) {
+		_handlePerfExtraArg(&subparser, args.fname);
+	}
+	if (!StringListSize(&perfOpts.roms) && !perfOpts.server) {
 		parsed = false;
 	}
+#ifdef DISABLE_THREADING
+	if (perfOpts.threads) {
+		parsed = false;
+	}
+#endif
 	if (!parsed || args.showHelp) {
-		usage(argv[0], NULL, NULL, &subparser, 1);
+		usage(argv[0], "Each ROM argument can also be a directory containing ROMs", NULL, &subparser, 1);
 		didFail = !parsed;
 		goto cleanup;
 	}
@@ -149,10 +215,17 @@ int main(int argc, char** argv) {
 		_savestate = VFileOpen(perfOpts.savestate, O_RDONLY);
 		free(perfOpts.savestate);
 	}
+	if (perfOpts.baseline) {
+		_baseline = VFileOpen(perfOpts.baseline, O_RDONLY);
+		if (!_baseline) {
+			fprintf(stderr, "Could not open baseline %s\n", perfOpts.baseline);
+		}
+		free(perfOpts.baseline);
+	}
 
 	_outputBuffer = malloc(256 * 256 * 4);
 	if (perfOpts.csv) {
-		puts("game_code,frames,duration,renderer");
+		printf("%s", perfOpts.threads ? PERF_THROUGHPUT_CSV_HEADER : PERF_CSV_HEADER);
 #ifdef __SWITCH__
 		consoleUpdate(NULL);
 #elif defined(GEKKO)
@@ -161,16 +234,36 @@ int main(int argc, char** argv) {
 	}
 	if (perfOpts.server) {
 		didFail = !_mPerfRunServer(&args, &perfOpts);
+#ifndef DISABLE_THREADING
+	} else if (perfOpts.threads) {
+		didFail = !_mPerfRunThroughput(&args, &perfOpts);
+#endif
 	} else {
-		didFail = !_mPerfRunCore(args.fname, &args, &perfOpts);
+		size_t i;
+		for (i = 0; i < StringListSize(&perfOpts.roms) && !_dispatchExiting; ++i) {
+			if (!_mPerfRunCore(*StringListGetPointer(&perfOpts.roms, i), &args, &perfOpts)) {
+				didFail = 1;
+			}
+		}
 	}
 	free(_outputBuffer);
 
 	if (_savestate) {
 		_savestate->close(_savestate);
 	}
+	if (_baseline) {
+		_baseline->close(_baseline);
+	}
+	if (_regressed) {
+		didFail = 1;
+	}
 	cleanup:
 	mArgumentsDeinit(&args);
+	size_t i;
+	for (i = 0; i < StringListSize(&perfOpts.roms); ++i) {
+		free(*StringListGetPointer(&perfOpts.roms, i));
+	}
+	StringListDeinit(&perfOpts.roms);
 
 #ifdef __3DS__
 	gfxExit();
@@ -189,16 +282,176 @@ int main(int argc, char** argv) {
 	return didFail;
 }
 
-bool _mPerfRunCore(const char* fname, const struct mArguments* args, const struct PerfOpts* perfOpts) {
+static uint64_t _perfClock(void) {
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec * UINT64_C(1000000000) + tv.tv_usec * UINT64_C(1000);
+#endif
+}
+
+static enum PerfSubsystem _classifyEvent(const char* name) {
+	if (!name) {
+		return PERF_OTHER;
+	}
+	if (strstr(name, "Video")) {
+		return PERF_VIDEO;
+	}
+	if (strstr(name, "Audio")) {
+		return PERF_AUDIO;
+	}
+	if (strstr(name, "DMA")) {
+		return PERF_DMA;
+	}
+	return PERF_OTHER;
+}
+
+static int _compareDoubles(const void* a, const void* b) {
+	double x = *(const double*) a;
+	double y = *(const double*) b;
+	return (x > y) - (x < y);
+}
+
+static struct PerfStats _computeStats(const double* values, size_t count) {
+	struct PerfStats stats = {0};
+	if (!count) {
+		return stats;
+	}
+	double* sorted = malloc(sizeof(*sorted) * count);
+	memcpy(sorted, values, sizeof(*sorted) * count);
+	qsort(sorted, count, sizeof(*sorted), _compareDoubles);
+	if (count & 1) {
+		stats.median = sorted[count / 2];
+	} else {
+		stats.median = (sorted[count / 2 - 1] + sorted[count / 2]) / 2;
+	}
+	free(sorted);
+
+	size_t i;
+	for (i = 0; i < count; ++i) {
+		stats.mean += values[i];
+	}
+	stats.mean /= count;
+	if (count > 1) {
+		double variance = 0;
+		for (i = 0; i < count; ++i) {
+			variance += (values[i] - stats.mean) * (values[i] - stats.mean);
+		}
+		stats.stddev = sqrt(variance / (count - 1));
+	}
+	return stats;
+}
+
+// Looks up the median FPS of a matching test in CSV output from a previous run
+static bool _findBaseline(const char* gameCode, const char* rendererName, double* fps) {
+	if (!_baseline) {
+		return false;
+	}
+	_baseline->seek(_baseline, 0, SEEK_SET);
+	char line[512];
+	enum {
+		COLUMN_GAME,
+		COLUMN_FRAMES,
+		COLUMN_DURATION,
+		COLUMN_RENDERER,
+		COLUMN_FPS,
+	};
+	static const char* const names[] = { "game_code", "frames", "duration", "renderer", "fps_median" };
+	int columns[sizeof(names) / sizeof(*names)];
+	size_t i;
+	for (i = 0; i < sizeof(names) / sizeof(*names); ++i) {
+		columns[i] = -1;
+	}
+	bool header = true;
+	while (_baseline->readline(_baseline, line, sizeof(line)) > 0) {
+		line[strcspn(line, "\r\n")] = '\0';
+		const char* fields[32];
+		size_t nFields = 0;
+		char* field = line;
+		while (nFields < sizeof(fields) / sizeof(*fields)) {
+			fields[nFields] = field;
+			++nFields;
+			field = strchr(field, ',');
+			if (!field) {
+				break;
+			}
+			*field = '\0';
+			++field;
+		}
+		if (header) {
+			for (i = 0; i < nFields; ++i) {
+				size_t j;
+				for (j = 0; j < sizeof(names) / sizeof(*names); ++j) {
+					if (strcmp(fields[i], names[j]) == 0) {
+						columns[j] = i;
+					}
+				}
+			}
+			if (columns[COLUMN_GAME] < 0) {
+				return false;
+			}
+			header = false;
+			continue;
+		}
+		if ((size_t) columns[COLUMN_GAME] >= nFields || strcmp(fields[columns[COLUMN_GAME]], gameCode) != 0) {
+			continue;
+		}
+		if (columns[COLUMN_RENDERER] >= 0 && (size_t) columns[COLUMN_RENDERER] < nFields && strcmp(fields[columns[COLUMN_RENDERER]], rendererName) != 0) {
+			continue;
+		}
+		if (columns[COLUMN_FPS] >= 0 && (size_t) columns[COLUMN_FPS] < nFields && fields[columns[COLUMN_FPS]][0]) {
+			*fps = strtod(fields[columns[COLUMN_FPS]], NULL);
+			return true;
+		}
+		if (columns[COLUMN_FRAMES] >= 0 && columns[COLUMN_DURATION] >= 0 && (size_t) columns[COLUMN_FRAMES] < nFields && (size_t) columns[COLUMN_DURATION] < nFields) {
+			double duration = strtod(fields[columns[COLUMN_DURATION]], NULL);
+			if (duration > 0) {
+				*fps = strtod(fields[columns[COLUMN_FRAMES]], NULL) * 1000000. / duration;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+static void _printJSONString(const char* string) {
+	putchar('"');
+	for (; *string; ++string) {
+		unsigned char c = *string;
+		if (c == '"' || c == '\\') {
+			printf("\\%c", c);
+		} else if (c < 0x20) {
+			printf("\\u%04x", c);
+		} else {
+			putchar(c);
+		}
+	}
+	putchar('"');
+}
+
+static const char* _rendererName(const struct PerfOpts* perfOpts) {
+	if (perfOpts->noVideo) {
+		return "none";
+	} else if (perfOpts->threadedVideo) {
+		return "threaded-software";
+	}
+	return "software";
+}
+
+static struct mCore* _mPerfLoadCore(const char* fname, const struct mArguments* args, const struct PerfOpts* perfOpts, void* outputBuffer) {
 	struct mCore* core = mCoreFind(fname);
 	if (!core) {
-		return false;
+		return NULL;
 	}
 
 	// TODO: Put back debugger
 	core->init(core);
 	if (!perfOpts->noVideo) {
-		core->setVideoBuffer(core, _outputBuffer, 256);
+		core->setVideoBuffer(core, outputBuffer, 256);
 	}
 	mCoreLoadFile(core, fname);
 	mCoreConfigInit(&core->config, "perf");
@@ -218,50 +471,212 @@ bool _mPerfRunCore(const char* fname, const struct mArguments* args, const struc
 	mCoreConfigLoadDefaults(&core->config, &opts);
 	mCoreConfigSetDefaultValue(&core->config, "idleOptimization", "detect");
 	mCoreLoadConfig(core);
+	mCoreConfigFreeOpts(&opts);
+	return core;
+}
 
+static void _mPerfReset(struct mCore* core) {
 	core->reset(core);
 	if (_savestate) {
+		_savestate->seek(_savestate, 0, SEEK_SET);
 		mCoreLoadStateNamed(core, _savestate, 0);
 	}
+}
+
+static void _mPerfUnloadCore(struct mCore* core) {
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+}
+
+bool _mPerfRunCore(const char* fname, const struct mArguments* args, const struct PerfOpts* perfOpts) {
+	struct mCore* core = _mPerfLoadCore(fname, args, perfOpts, _outputBuffer);
+	if (!core) {
+		return false;
+	}
 
 	struct mGameInfo info;
 	core->getGameInfo(core, &info);
 
-	int frames = perfOpts->frames;
-	if (!frames) {
-		frames = perfOpts->duration * 60;
+	const char* rendererName = _rendererName(perfOpts);
+	char gameCode[sizeof(info.system) + sizeof(info.code) + 1];
+	snprintf(gameCode, sizeof(gameCode), "%s-%s", info.system, info.code);
+
+	unsigned iterations = perfOpts->iterations;
+	double* fps = calloc(iterations, sizeof(*fps));
+	uint64_t* durations = calloc(iterations, sizeof(*durations));
+	struct mTimingProfile profile = { .clock = _perfClock };
+	mTimingProfileReset(&profile);
+	bool quiet = perfOpts->csv || perfOpts->json;
+	int frames = 0;
+	unsigned i;
+	for (i = 0; i < iterations && !_dispatchExiting; ++i) {
+		_mPerfReset(core);
+		unsigned warmup;
+		for (warmup = 0; warmup < perfOpts->warmup && !_dispatchExiting; ++warmup) {
+			core->runFrame(core);
+		}
+
+		frames = perfOpts->frames;
+		if (!frames) {
+			frames = perfOpts->duration * 60;
+		}
+		if (perfOpts->instrument) {
+			core->timing->profile = &profile;
+		}
+		struct timeval tv;
+		gettimeofday(&tv, 0);
+		uint64_t start = 1000000LL * tv.tv_sec + tv.tv_usec;
+		_mPerfRunloop(core, &frames, quiet);
+		gettimeofday(&tv, 0);
+		uint64_t end = 1000000LL * tv.tv_sec + tv.tv_usec;
+		core->timing->profile = NULL;
+		durations[i] = end - start;
+		fps[i] = durations[i] ? frames * 1000000. / durations[i] : 0;
+		if (!quiet) {
+			printf("%u frames in %" PRIu64 " microseconds: %g fps (%gx)\n", frames, durations[i], fps[i], fps[i] / 60.);
+		}
+	}
+	// An interrupted run only reports the iterations that actually finished
+	if (i < iterations) {
+		iterations = i ? i : 1;
 	}
-	struct timeval tv;
-	gettimeofday(&tv, 0);
-	uint64_t start = 1000000LL * tv.tv_sec + tv.tv_usec;
-	_mPerfRunloop(core, &frames, perfOpts->csv);
-	gettimeofday(&tv, 0);
-	uint64_t end = 1000000LL * tv.tv_sec + tv.tv_usec;
-	uint64_t duration = end - start;
 
-	mCoreConfigFreeOpts(&opts);
-	mCoreConfigDeinit(&core->config);
-	core->deinit(core);
+	// Measured before unloading, while everything the run allocated is still around
+	struct mCoreMemoryUsageList memoryUsage;
+	mCoreMemoryUsageListInit(&memoryUsage, 0);
+	size_t resident = mCoreListMemoryUsage(core, &memoryUsage);
+
+	_mPerfUnloadCore(core);
+
+	struct PerfStats stats = _computeStats(fps, iterations);
+	uint64_t totalDuration = 0;
+	for (i = 0; i < iterations; ++i) {
+		totalDuration += durations[i];
+	}
+	// With multiple iterations, the reported duration is the one matching the median
+	uint64_t duration = durations[0];
+	if (iterations > 1 && stats.median > 0) {
+		duration = frames * 1000000. / stats.median + 0.5;
+	}
+
+	// Per-iteration means of time spent in each subsystem, in microseconds
+	double breakdown[PERF_MAX] = {0};
+	if (perfOpts->instrument) {
+		double eventTime = 0;
+		for (i = 0; i < profile.nEntries; ++i) {
+			breakdown[_classifyEvent(profile.entries[i].name)] += profile.entries[i].time / 1000.;
+			eventTime += profile.entries[i].time / 1000.;
+		}
+		breakdown[PERF_SCHEDULER] = profile.tickTime / 1000. - eventTime;
+		breakdown[PERF_CPU] = totalDuration - profile.tickTime / 1000.;
+		for (i = 0; i < PERF_MAX; ++i) {
+			breakdown[i] /= iterations;
+		}
+	}
+
+	double baselineFps = 0;
+	bool hasBaseline = _findBaseline(gameCode, rendererName, &baselineFps) && baselineFps > 0;
+	double change = 0;
+	if (hasBaseline) {
+		change = (stats.median - baselineFps) * 100. / baselineFps;
+		if (change < -perfOpts->tolerance) {
+			_regressed = true;
+		}
+	}
 
-	float scaledFrames = frames * 1000000.f;
 	if (perfOpts->csv) {
-		char buffer[256];
-		const char* rendererName;
-		if (perfOpts->noVideo) {
-			rendererName = "none";
-		} else if (perfOpts->threadedVideo) {
-			rendererName = "threaded-software";
-		} else {
-			rendererName = "software";
+		char buffer[512];
+		size_t len = snprintf(buffer, sizeof(buffer), "%s,%i,%" PRIu64 ",%s,%u,%u,%.3f,%.3f,%.3f", gameCode, frames, duration, rendererName, iterations, perfOpts->warmup, stats.mean, stats.median, stats.stddev);
+		for (i = 0; i < PERF_MAX && len < sizeof(buffer); ++i) {
+			if (perfOpts->instrument) {
+				len += snprintf(&buffer[len], sizeof(buffer) - len, ",%.0f", breakdown[i]);
+			} else {
+				len += snprintf(&buffer[len], sizeof(buffer) - len, ",");
+			}
+		}
+		if (len < sizeof(buffer)) {
+			if (hasBaseline) {
+				len += snprintf(&buffer[len], sizeof(buffer) - len, ",%.3f,%.2f\n", baselineFps, change);
+			} else {
+				len += snprintf(&buffer[len], sizeof(buffer) - len, ",,\n");
+			}
 		}
-		snprintf(buffer, sizeof(buffer), "%s-%s,%i,%" PRIu64 ",%s\n", info.system, info.code, frames, duration, rendererName);
 		printf("%s", buffer);
 		if (_socket != INVALID_SOCKET) {
 			SocketSend(_socket, buffer, strlen(buffer));
 		}
+	} else if (perfOpts->json) {
+		printf("{\"game_code\":");
+		_printJSONString(gameCode);
+		printf(",\"renderer\":\"%s\",\"frames\":%i,\"warmup\":%u,\"iterations\":[", rendererName, frames, perfOpts->warmup);
+		for (i = 0; i < iterations; ++i) {
+			printf("%s{\"duration\":%" PRIu64 ",\"fps\":%.3f}", i ? "," : "", durations[i], fps[i]);
+		}
+		printf("],\"fps\":{\"mean\":%.3f,\"median\":%.3f,\"stddev\":%.3f}", stats.mean, stats.median, stats.stddev);
+		if (perfOpts->instrument) {
+			printf(",\"breakdown\":{");
+			for (i = 0; i < PERF_MAX; ++i) {
+				printf("%s\"%s\":%.0f", i ? "," : "", _subsystemNames[i], breakdown[i]);
+			}
+			printf("},\"events\":{");
+			for (i = 0; i < profile.nEntries; ++i) {
+				printf(i ? "," : "");
+				_printJSONString(profile.entries[i].name ? profile.entries[i].name : "Other");
+				const struct mTimingProfileEntry* entry = &profile.entries[i];
+				printf(":{\"time\":%.0f,\"count\":%" PRIu64 ",\"lateness\":%.2f,\"reschedules\":%" PRIu64 ",\"deschedules\":%" PRIu64 "}",
+				       entry->time / 1000. / iterations, entry->count / iterations,
+				       entry->count ? (double) entry->lateness / entry->count : 0.,
+				       entry->reschedules / iterations, entry->deschedules / iterations);
+			}
+			printf("}");
+		}
+		printf(",\"memory\":{\"resident\":%" PRIz "u,\"blocks\":[", resident);
+		for (i = 0; i < mCoreMemoryUsageListSize(&memoryUsage); ++i) {
+			const struct mCoreMemoryUsage* usage = mCoreMemoryUsageListGetConstPointer(&memoryUsage, i);
+			printf("%s{\"name\":\"%s\",\"size\":%" PRIz "u,\"resident\":%" PRIz "u,\"backing\":\"%s\"}", i ? "," : "",
+			       usage->name, usage->size, usage->resident, mCoreMemoryBackingName(usage->backing));
+		}
+		printf("]}");
+		if (hasBaseline) {
+			printf(",\"baseline\":{\"fps\":%.3f,\"change\":%.2f,\"regressed\":%s}", baselineFps, change, change < -perfOpts->tolerance ? "true" : "false");
+		}
+		printf("}\n");
 	} else {
-		printf("%u frames in %" PRIu64 " microseconds: %g fps (%gx)\n", frames, duration, scaledFrames / duration, scaledFrames / (duration * 60.f));
+		if (iterations > 1) {
+			printf("%u iterations: %g fps mean, %g fps median, %g fps stddev\n", iterations, stats.mean, stats.median, stats.stddev);
+		}
+		if (perfOpts->instrument) {
+			printf("Time per iteration:");
+			for (i = 0; i < PERF_MAX; ++i) {
+				printf(" %s %.0fus%s", _subsystemNames[i], breakdown[i], i + 1 < PERF_MAX ? "," : "\n");
+			}
+			double totalFrames = (double) frames * iterations;
+			printf("Scheduler events:\n");
+			printf("  %-24s %12s %10s %12s %12s %10s\n", "event", "fires/frame", "avg late", "resched/frm", "desched/frm", "us/frame");
+			for (i = 0; i < profile.nEntries; ++i) {
+				const struct mTimingProfileEntry* entry = &profile.entries[i];
+				printf("  %-24s %12.2f %10.2f %12.2f %12.2f %10.2f\n", entry->name ? entry->name : "Other",
+				       entry->count / totalFrames, entry->count ? (double) entry->lateness / entry->count : 0.,
+				       entry->reschedules / totalFrames, entry->deschedules / totalFrames, entry->time / 1000. / totalFrames);
+			}
+		}
+		printf("Memory: %" PRIz "u KiB resident\n", resident / 1024);
+		if (perfOpts->instrument) {
+			printf("  %-24s %10s %10s  %s\n", "block", "KiB", "resident", "backing");
+			for (i = 0; i < mCoreMemoryUsageListSize(&memoryUsage); ++i) {
+				const struct mCoreMemoryUsage* usage = mCoreMemoryUsageListGetConstPointer(&memoryUsage, i);
+				printf("  %-24s %10" PRIz "u %10" PRIz "u  %s\n", usage->name, usage->size / 1024, usage->resident / 1024, mCoreMemoryBackingName(usage->backing));
+			}
+		}
+		if (hasBaseline) {
+			printf("Baseline: %g fps, %+.2f%%%s\n", baselineFps, change, change < -perfOpts->tolerance ? " (regression)" : "");
+		} else if (_baseline) {
+			printf("No baseline found for %s (%s renderer)\n", gameCode, rendererName);
+		}
 	}
+	mCoreMemoryUsageListDeinit(&memoryUsage);
+	free(fps);
+	free(durations);
 #ifdef __SWITCH__
 	consoleUpdate(NULL);
 #endif
@@ -305,6 +720,157 @@ static void _mPerfRunloop(struct mCore* core, int* frames, bool quiet) {
 	}
 }
 
+#ifndef DISABLE_THREADING
+struct PerfWorker {
+	Thread thread;
+	struct mCore* core;
+	void* outputBuffer;
+	size_t rom;
+	int frames;
+	uint64_t duration;
+};
+
+struct PerfPass {
+	size_t nWorkers;
+	int frames;
+	uint64_t duration;
+	double fps;
+	double efficiency;
+};
+
+static uint64_t _usec(void) {
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return 1000000LL * tv.tv_sec + tv.tv_usec;
+}
+
+static THREAD_ENTRY _mPerfWorkerRun(void* context) {
+	struct PerfWorker* worker = context;
+	ThreadSetName("Perf Worker");
+	uint64_t start = _usec();
+	_mPerfRunloop(worker->core, &worker->frames, true);
+	worker->duration = _usec() - start;
+	THREAD_EXIT(0);
+}
+
+// Runs one core per worker at once, with worker i running ROM (first + i) modulo the number of ROMs.
+// Efficiency is how fast each core ran compared to running alone, averaged over all cores.
+static bool _mPerfRunPass(const struct mArguments* args, const struct PerfOpts* perfOpts, size_t nWorkers, size_t first, const double* soloFps, struct PerfPass* pass) {
+	size_t nRoms = StringListSize(&perfOpts->roms);
+	struct PerfWorker* workers = calloc(nWorkers, sizeof(*workers));
+	bool ok = true;
+	size_t i;
+	// Cores are all set up and warmed up before any of them start being timed
+	for (i = 0; i < nWorkers; ++i) {
+		struct PerfWorker* worker = &workers[i];
+		worker->rom = (first + i) % nRoms;
+		worker->outputBuffer = malloc(256 * 256 * 4);
+		worker->core = _mPerfLoadCore(*StringListGetConstPointer(&perfOpts->roms, worker->rom), args, perfOpts, worker->outputBuffer);
+		if (!worker->core) {
+			fprintf(stderr, "Could not load %s\n", *StringListGetConstPointer(&perfOpts->roms, worker->rom));
+			ok = false;
+			break;
+		}
+		_mPerfReset(worker->core);
+		unsigned warmup;
+		for (warmup = 0; warmup < perfOpts->warmup; ++warmup) {
+			worker->core->runFrame(worker->core);
+		}
+		worker->frames = perfOpts->frames;
+		if (!worker->frames) {
+			worker->frames = perfOpts->duration * 60;
+		}
+	}
+
+	if (ok) {
+		uint64_t start = _usec();
+		for (i = 0; i < nWorkers; ++i) {
+			ThreadCreate(&workers[i].thread, _mPerfWorkerRun, &workers[i]);
+		}
+		for (i = 0; i < nWorkers; ++i) {
+			ThreadJoin(&workers[i].thread);
+		}
+		pass->duration = _usec() - start;
+		pass->nWorkers = nWorkers;
+		pass->frames = 0;
+		pass->efficiency = 0;
+		for (i = 0; i < nWorkers; ++i) {
+			pass->frames += workers[i].frames;
+			if (soloFps && soloFps[workers[i].rom] > 0 && workers[i].duration) {
+				pass->efficiency += workers[i].frames * 1000000. / workers[i].duration / soloFps[workers[i].rom];
+			}
+		}
+		pass->efficiency /= nWorkers;
+		pass->fps = pass->duration ? pass->frames * 1000000. / pass->duration : 0;
+	}
+
+	for (i = 0; i < nWorkers; ++i) {
+		if (workers[i].core) {
+			_mPerfUnloadCore(workers[i].core);
+		}
+		free(workers[i].outputBuffer);
+	}
+	free(workers);
+	return ok;
+}
+
+static void _mPerfReportPass(const struct PerfOpts* perfOpts, const struct PerfPass* pass) {
+	size_t nRoms = StringListSize(&perfOpts->roms);
+	double perCore = pass->fps / pass->nWorkers;
+	if (perfOpts->csv) {
+		printf("%" PRIz "u,%" PRIz "u,%i,%" PRIu64 ",%.3f,%.3f,%.2f,%s\n", pass->nWorkers, nRoms, pass->frames, pass->duration, pass->fps, perCore, pass->efficiency * 100, _rendererName(perfOpts));
+	} else if (perfOpts->json) {
+		printf("{\"threads\":%" PRIz "u,\"roms\":%" PRIz "u,\"frames\":%i,\"duration\":%" PRIu64 ",\"fps\":%.3f,\"fps_per_core\":%.3f,\"efficiency\":%.2f,\"renderer\":\"%s\"}\n", pass->nWorkers, nRoms, pass->frames, pass->duration, pass->fps, perCore, pass->efficiency * 100, _rendererName(perfOpts));
+	} else {
+		printf("%" PRIz "u threads: %i frames in %" PRIu64 " microseconds: %g fps total, %g fps per core, %.1f%% scaling efficiency\n", pass->nWorkers, pass->frames, pass->duration, pass->fps, perCore, pass->efficiency * 100);
+	}
+	fflush(stdout);
+}
+
+static bool _mPerfRunThroughput(const struct mArguments* args, const struct PerfOpts* perfOpts) {
+	size_t nRoms = StringListSize(&perfOpts->roms);
+	double* soloFps = calloc(nRoms, sizeof(*soloFps));
+	bool ok = true;
+	// Cores running the same game share a single copy of the ROM, like in the batch runner
+	mSharedROMInit();
+
+	// The single-threaded pass runs each ROM alone, providing the reference for efficiency
+	struct PerfPass total = { .nWorkers = 1, .efficiency = 1 };
+	size_t i;
+	for (i = 0; i < nRoms && !_dispatchExiting; ++i) {
+		struct PerfPass pass;
+		if (!_mPerfRunPass(args, perfOpts, 1, i, NULL, &pass)) {
+			ok = false;
+			break;
+		}
+		soloFps[i] = pass.fps;
+		total.frames += pass.frames;
+		total.duration += pass.duration;
+	}
+	if (ok) {
+		total.fps = total.duration ? total.frames * 1000000. / total.duration : 0;
+		_mPerfReportPass(perfOpts, &total);
+	}
+
+	// Then double the number of threads each pass, finishing at the requested count
+	size_t nWorkers = 1;
+	while (ok && !_dispatchExiting && nWorkers < perfOpts->threads) {
+		nWorkers *= 2;
+		if (nWorkers > perfOpts->threads) {
+			nWorkers = perfOpts->threads;
+		}
+		struct PerfPass pass;
+		ok = _mPerfRunPass(args, perfOpts, nWorkers, 0, soloFps, &pass);
+		if (ok) {
+			_mPerfReportPass(perfOpts, &pass);
+		}
+	}
+	mSharedROMDeinit();
+	free(soloFps);
+	return ok;
+}
+#endif
+
 static bool _mPerfRunServer(const struct mArguments* args, const struct PerfOpts* perfOpts) {
 	SocketSubsystemInit();
 	_server = SocketOpenTCP(7216, NULL);
@@ -324,7 +890,7 @@ static bool _mPerfRunServer(const struct mArguments* args, const struct PerfOpts
 		return false;
 	}
 	if (perfOpts->csv) {
-		const char* header = "game_code,frames,duration,renderer\n";
+		const char* header = PERF_CSV_HEADER;
 		SocketSend(_socket, header, strlen(header));
 	}
 	char path[PATH_MAX];
@@ -361,18 +927,33 @@ static bool _parsePerfOpts(struct mSubParser* parser, int option, const char* ar
 	struct PerfOpts* opts = parser->opts;
 	errno = 0;
 	switch (option) {
+	case 'B':
+		opts->baseline = strdup(arg);
+		return true;
 	case 'D':
 		opts->server = true;
 		return true;
 	case 'F':
 		opts->frames = strtoul(arg, 0, 10);
 		return !errno;
+	case 'I':
+		opts->instrument = true;
+		return true;
+	case 'J':
+		opts->json = true;
+		return true;
+	case 'K':
+		opts->threads = strtoul(arg, 0, 10);
+		return !errno && opts->threads;
 	case 'N':
 		opts->noVideo = true;
 		return true;
 	case 'P':
 		opts->csv = true;
 		return true;
+	case 'R':
+		opts->iterations = strtoul(arg, 0, 10);
+		return !errno && opts->iterations;
 	case 'S':
 		opts->duration = strtoul(arg, 0, 10);
 		return !errno;
@@ -382,11 +963,56 @@ static bool _parsePerfOpts(struct mSubParser* parser, int option, const char* ar
 	case 'L':
 		opts->savestate = strdup(arg);
 		return true;
+	case 'W':
+		opts->warmup = strtoul(arg, 0, 10);
+		return !errno;
+	case 'X':
+		opts->tolerance = strtod(arg, 0);
+		return !errno;
 	default:
 		return false;
 	}
 }
 
+static int _compareStrings(const void* a, const void* b) {
+	return strcmp(*(const char* const*) a, *(const char* const*) b);
+}
+
+static bool _handlePerfExtraArg(struct mSubParser* parser, const char* arg) {
+	struct PerfOpts* opts = parser->opts;
+	struct VDir* dir = VDirOpen(arg);
+	if (!dir) {
+		*StringListAppend(&opts->roms) = strdup(arg);
+		return true;
+	}
+	size_t first = StringListSize(&opts->roms);
+	struct VDirEntry* entry;
+	while ((entry = dir->listNext(dir))) {
+		if (entry->type(entry) == VFS_DIRECTORY) {
+			continue;
+		}
+		// Skip anything in the directory that isn't a ROM
+		struct VFile* vf = dir->openFile(dir, entry->name(entry), O_RDONLY);
+		if (!vf) {
+			continue;
+		}
+		enum mPlatform platform = mCoreIsCompatible(vf);
+		vf->close(vf);
+		if (platform == mPLATFORM_NONE) {
+			continue;
+		}
+		char path[PATH_MAX];
+		snprintf(path, sizeof(path), "%s" PATH_SEP "%s", arg, entry->name(entry));
+		*StringListAppend(&opts->roms) = strdup(path);
+	}
+	dir->close(dir);
+	// Directory order isn't stable, but results should be comparable between runs
+	if (StringListSize(&opts->roms) > first) {
+		qsort(StringListGetPointer(&opts->roms, first), StringListSize(&opts->roms) - first, sizeof(char*), _compareStrings);
+	}
+	return true;
+}
+
 static void _log(struct mLogger* log, int category, enum mLogLevel level, const char* format, va_list args) {
 	UNUSED(log);
 	UNUSED(category);
@@ -0,0 +1,2196 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "vk.h"
+
+#include <mgba/core/log.h>
+#include <mgba/core/version.h>
+#include <mgba-util/configuration.h>
+#include <mgba-util/formatting.h>
+#include <mgba-util/image.h>
+#include <mgba-util/math.h>
+#include <mgba-util/vector.h>
+#include <mgba-util/vfs.h>
+
+mLOG_DECLARE_CATEGORY(VULKAN);
+mLOG_DEFINE_CATEGORY(VULKAN, "Vulkan", "video.vk");
+
+#define SPIRV_MAGIC 0x07230203
+#define TARGET_FORMAT VK_FORMAT_R8G8B8A8_UNORM
+
+#ifdef COLOR_16_BIT
+#ifdef COLOR_5_6_5
+#define LAYER_FORMAT VK_FORMAT_R5G6B5_UNORM_PACK16
+#else
+// Nothing in core Vulkan has red in the low bits, so swap red and blue when sampling instead
+#define LAYER_FORMAT VK_FORMAT_A1R5G5B5_UNORM_PACK16
+#define LAYER_SWIZZLE_RB
+#endif
+#else
+#define LAYER_FORMAT VK_FORMAT_A8B8G8R8_UNORM_PACK32
+#endif
+
+#define VK_INSTANCE_FUNCTIONS(X) \
+	X(vkDestroyInstance) \
+	X(vkEnumeratePhysicalDevices) \
+	X(vkGetPhysicalDeviceQueueFamilyProperties) \
+	X(vkGetPhysicalDeviceMemoryProperties) \
+	X(vkEnumerateDeviceExtensionProperties) \
+	X(vkCreateDevice) \
+	X(vkGetDeviceProcAddr) \
+	X(vkDestroySurfaceKHR) \
+	X(vkGetPhysicalDeviceSurfaceSupportKHR) \
+	X(vkGetPhysicalDeviceSurfaceCapabilitiesKHR) \
+	X(vkGetPhysicalDeviceSurfaceFormatsKHR) \
+	X(vkGetPhysicalDeviceSurfacePresentModesKHR)
+
+#define VK_DEVICE_FUNCTIONS(X) \
+	X(vkDestroyDevice) \
+	X(vkGetDeviceQueue) \
+	X(vkDeviceWaitIdle) \
+	X(vkCreateSwapchainKHR) \
+	X(vkDestroySwapchainKHR) \
+	X(vkGetSwapchainImagesKHR) \
+	X(vkAcquireNextImageKHR) \
+	X(vkQueuePresentKHR) \
+	X(vkQueueSubmit) \
+	X(vkCreateImage) \
+	X(vkDestroyImage) \
+	X(vkGetImageMemoryRequirements) \
+	X(vkBindImageMemory) \
+	X(vkCreateImageView) \
+	X(vkDestroyImageView) \
+	X(vkCreateBuffer) \
+	X(vkDestroyBuffer) \
+	X(vkGetBufferMemoryRequirements) \
+	X(vkBindBufferMemory) \
+	X(vkAllocateMemory) \
+	X(vkFreeMemory) \
+	X(vkMapMemory) \
+	X(vkUnmapMemory) \
+	X(vkCreateFramebuffer) \
+	X(vkDestroyFramebuffer) \
+	X(vkCreateRenderPass) \
+	X(vkDestroyRenderPass) \
+	X(vkCreateShaderModule) \
+	X(vkDestroyShaderModule) \
+	X(vkCreatePipelineLayout) \
+	X(vkDestroyPipelineLayout) \
+	X(vkCreateGraphicsPipelines) \
+	X(vkDestroyPipeline) \
+	X(vkCreateDescriptorSetLayout) \
+	X(vkDestroyDescriptorSetLayout) \
+	X(vkCreateDescriptorPool) \
+	X(vkDestroyDescriptorPool) \
+	X(vkResetDescriptorPool) \
+	X(vkAllocateDescriptorSets) \
+	X(vkUpdateDescriptorSets) \
+	X(vkCreateSampler) \
+	X(vkDestroySampler) \
+	X(vkCreateCommandPool) \
+	X(vkDestroyCommandPool) \
+	X(vkAllocateCommandBuffers) \
+	X(vkBeginCommandBuffer) \
+	X(vkEndCommandBuffer) \
+	X(vkCreateFence) \
+	X(vkDestroyFence) \
+	X(vkWaitForFences) \
+	X(vkResetFences) \
+	X(vkCreateSemaphore) \
+	X(vkDestroySemaphore) \
+	X(vkCmdPipelineBarrier) \
+	X(vkCmdCopyBufferToImage) \
+	X(vkCmdCopyImage) \
+	X(vkCmdClearColorImage) \
+	X(vkCmdBeginRenderPass) \
+	X(vkCmdEndRenderPass) \
+	X(vkCmdBindPipeline) \
+	X(vkCmdBindDescriptorSets) \
+	X(vkCmdPushConstants) \
+	X(vkCmdSetViewport) \
+	X(vkCmdSetScissor) \
+	X(vkCmdDraw)
+
+#define DECLARE_FUNCTION(NAME) PFN_ ## NAME NAME;
+struct mVKFunctions {
+	DECLARE_FUNCTION(vkCreateInstance)
+	VK_INSTANCE_FUNCTIONS(DECLARE_FUNCTION)
+	VK_DEVICE_FUNCTIONS(DECLARE_FUNCTION)
+};
+#undef DECLARE_FUNCTION
+
+// The push constants every pipeline gets, as described in vk.h
+struct mVKPushConstants {
+	float rect[4];
+	float texSize[2];
+	float outputSize[2];
+	float alpha;
+};
+
+// #version 450
+// layout(push_constant) uniform Push { vec4 rect; vec2 texSize; vec2 outputSize; float alpha; } push;
+// layout(location = 0) out vec2 texCoord;
+//
+// void main() {
+//	vec2 corner = vec2(gl_VertexIndex & 1, gl_VertexIndex >> 1);
+//	texCoord = corner;
+//	gl_Position = vec4(push.rect.xy + corner * push.rect.zw, 0.0, 1.0);
+// }
+static const uint32_t _vertexShader[] = {
+	0x07230203, 0x00010000, 0x00000000, 0x00000027, 0x00000000, 0x00020011, 0x00000001, 0x0003000E,
+	0x00000000, 0x00000001, 0x0008000F, 0x00000000, 0x00000001, 0x6E69616D, 0x00000000, 0x0000000F,
+	0x00000010, 0x00000011, 0x00040047, 0x0000000F, 0x0000000B, 0x0000002A, 0x00040047, 0x00000010,
+	0x0000000B, 0x00000000, 0x00040047, 0x00000011, 0x0000001E, 0x00000000, 0x00030047, 0x0000000B,
+	0x00000002, 0x00050048, 0x0000000B, 0x00000000, 0x00000023, 0x00000000, 0x00050048, 0x0000000B,
+	0x00000001, 0x00000023, 0x00000010, 0x00050048, 0x0000000B, 0x00000002, 0x00000023, 0x00000018,
+	0x00050048, 0x0000000B, 0x00000003, 0x00000023, 0x00000020, 0x00020013, 0x00000002, 0x00030021,
+	0x00000003, 0x00000002, 0x00030016, 0x00000004, 0x00000020, 0x00040017, 0x00000005, 0x00000004,
+	0x00000002, 0x00040017, 0x00000006, 0x00000004, 0x00000004, 0x00040015, 0x00000007, 0x00000020,
+	0x00000001, 0x00040020, 0x00000008, 0x00000001, 0x00000007, 0x00040020, 0x00000009, 0x00000003,
+	0x00000006, 0x00040020, 0x0000000A, 0x00000003, 0x00000005, 0x0006001E, 0x0000000B, 0x00000006,
+	0x00000005, 0x00000005, 0x00000004, 0x00040020, 0x0000000C, 0x00000009, 0x0000000B, 0x00040020,
+	0x0000000D, 0x00000009, 0x00000006, 0x0004002B, 0x00000007, 0x00000012, 0x00000000, 0x0004002B,
+	0x00000007, 0x00000013, 0x00000001, 0x0004002B, 0x00000004, 0x00000015, 0x00000000, 0x0004002B,
+	0x00000004, 0x00000016, 0x3F800000, 0x0004003B, 0x0000000C, 0x0000000E, 0x00000009, 0x0004003B,
+	0x00000008, 0x0000000F, 0x00000001, 0x0004003B, 0x00000009, 0x00000010, 0x00000003, 0x0004003B,
+	0x0000000A, 0x00000011, 0x00000003, 0x00050036, 0x00000002, 0x00000001, 0x00000000, 0x00000003,
+	0x000200F8, 0x00000017, 0x0004003D, 0x00000007, 0x00000018, 0x0000000F, 0x000500C7, 0x00000007,
+	0x00000019, 0x00000018, 0x00000013, 0x000500C3, 0x00000007, 0x0000001A, 0x00000018, 0x00000013,
+	0x0004006F, 0x00000004, 0x0000001B, 0x00000019, 0x0004006F, 0x00000004, 0x0000001C, 0x0000001A,
+	0x00050050, 0x00000005, 0x0000001D, 0x0000001B, 0x0000001C, 0x0003003E, 0x00000011, 0x0000001D,
+	0x00050041, 0x0000000D, 0x0000001E, 0x0000000E, 0x00000012, 0x0004003D, 0x00000006, 0x0000001F,
+	0x0000001E, 0x0007004F, 0x00000005, 0x00000020, 0x0000001F, 0x0000001F, 0x00000000, 0x00000001,
+	0x0007004F, 0x00000005, 0x00000021, 0x0000001F, 0x0000001F, 0x00000002, 0x00000003, 0x00050085,
+	0x00000005, 0x00000022, 0x0000001D, 0x00000021, 0x00050081, 0x00000005, 0x00000023, 0x00000020,
+	0x00000022, 0x00050051, 0x00000004, 0x00000024, 0x00000023, 0x00000000, 0x00050051, 0x00000004,
+	0x00000025, 0x00000023, 0x00000001, 0x00070050, 0x00000006, 0x00000026, 0x00000024, 0x00000025,
+	0x00000015, 0x00000016, 0x0003003E, 0x00000010, 0x00000026, 0x000100FD, 0x00010038,
+};
+
+// #version 450
+// layout(push_constant) uniform Push { vec4 rect; vec2 texSize; vec2 outputSize; float alpha; } push;
+// layout(set = 0, binding = 0) uniform sampler2D tex;
+// layout(location = 0) in vec2 texCoord;
+// layout(location = 0) out vec4 color;
+//
+// void main() {
+//	vec4 texel = texture(tex, texCoord);
+//	color = vec4(texel.rgb, push.alpha < 0.0 ? texel.a : push.alpha);
+// }
+static const uint32_t _fragmentShader[] = {
+	0x07230203, 0x00010000, 0x00000000, 0x00000023, 0x00000000, 0x00020011, 0x00000001, 0x0003000E,
+	0x00000000, 0x00000001, 0x0007000F, 0x00000004, 0x00000001, 0x6E69616D, 0x00000000, 0x00000014,
+	0x00000015, 0x00030010, 0x00000001, 0x00000007, 0x00040047, 0x00000014, 0x0000001E, 0x00000000,
+	0x00040047, 0x00000015, 0x0000001E, 0x00000000, 0x00040047, 0x00000013, 0x00000022, 0x00000000,
+	0x00040047, 0x00000013, 0x00000021, 0x00000000, 0x00030047, 0x0000000F, 0x00000002, 0x00050048,
+	0x0000000F, 0x00000000, 0x00000023, 0x00000000, 0x00050048, 0x0000000F, 0x00000001, 0x00000023,
+	0x00000010, 0x00050048, 0x0000000F, 0x00000002, 0x00000023, 0x00000018, 0x00050048, 0x0000000F,
+	0x00000003, 0x00000023, 0x00000020, 0x00020013, 0x00000002, 0x00030021, 0x00000003, 0x00000002,
+	0x00030016, 0x00000004, 0x00000020, 0x00040017, 0x00000005, 0x00000004, 0x00000002, 0x00040017,
+	0x00000006, 0x00000004, 0x00000003, 0x00040017, 0x00000007, 0x00000004, 0x00000004, 0x00040015,
+	0x00000008, 0x00000020, 0x00000001, 0x00020014, 0x00000009, 0x00090019, 0x0000000A, 0x00000004,
+	0x00000001, 0x00000000, 0x00000000, 0x00000000, 0x00000001, 0x00000000, 0x0003001B, 0x0000000B,
+	0x0000000A, 0x00040020, 0x0000000C, 0x00000000, 0x0000000B, 0x00040020, 0x0000000D, 0x00000001,
+	0x00000005, 0x00040020, 0x0000000E, 0x00000003, 0x00000007, 0x0006001E, 0x0000000F, 0x00000007,
+	0x00000005, 0x00000005, 0x00000004, 0x00040020, 0x00000010, 0x00000009, 0x0000000F, 0x00040020,
+	0x00000011, 0x00000009, 0x00000004, 0x0004002B, 0x00000008, 0x00000016, 0x00000003, 0x0004002B,
+	0x00000004, 0x00000017, 0x00000000, 0x0004003B, 0x00000010, 0x00000012, 0x00000009, 0x0004003B,
+	0x0000000C, 0x00000013, 0x00000000, 0x0004003B, 0x0000000D, 0x00000014, 0x00000001, 0x0004003B,
+	0x0000000E, 0x00000015, 0x00000003, 0x00050036, 0x00000002, 0x00000001, 0x00000000, 0x00000003,
+	0x000200F8, 0x00000018, 0x0004003D, 0x0000000B, 0x00000019, 0x00000013, 0x0004003D, 0x00000005,
+	0x0000001A, 0x00000014, 0x00050057, 0x00000007, 0x0000001B, 0x00000019, 0x0000001A, 0x00050041,
+	0x00000011, 0x0000001C, 0x00000012, 0x00000016, 0x0004003D, 0x00000004, 0x0000001D, 0x0000001C,
+	0x000500B8, 0x00000009, 0x0000001E, 0x0000001D, 0x00000017, 0x00050051, 0x00000004, 0x0000001F,
+	0x0000001B, 0x00000003, 0x000600A9, 0x00000004, 0x00000020, 0x0000001E, 0x0000001F, 0x0000001D,
+	0x0008004F, 0x00000006, 0x00000021, 0x0000001B, 0x0000001B, 0x00000000, 0x00000001, 0x00000002,
+	0x00050050, 0x00000007, 0x00000022, 0x00000021, 0x00000020, 0x0003003E, 0x00000015, 0x00000022,
+	0x000100FD, 0x00010038,
+};
+
+struct mVKUniformLayout {
+	const char* name;
+	unsigned columns;
+	unsigned rows;
+	uint32_t size;
+	uint32_t align;
+};
+
+// Push constant blocks are laid out like std430, where matrices are arrays of column vectors
+static const struct mVKUniformLayout _uniformLayouts[] = {
+	[mVK_UNIFORM_FLOAT] = { "float", 1, 1, 4, 4 },
+	[mVK_UNIFORM_FLOAT2] = { "float2", 1, 2, 8, 8 },
+	[mVK_UNIFORM_FLOAT3] = { "float3", 1, 3, 12, 16 },
+	[mVK_UNIFORM_FLOAT4] = { "float4", 1, 4, 16, 16 },
+	[mVK_UNIFORM_FLOAT2X2] = { "float2x2", 2, 2, 16, 8 },
+	[mVK_UNIFORM_FLOAT3X3] = { "float3x3", 3, 3, 48, 16 },
+	[mVK_UNIFORM_FLOAT4X4] = { "float4x4", 4, 4, 64, 16 },
+	[mVK_UNIFORM_INT] = { "int", 1, 1, 4, 4 },
+	[mVK_UNIFORM_INT2] = { "int2", 1, 2, 8, 8 },
+	[mVK_UNIFORM_INT3] = { "int3", 1, 3, 12, 16 },
+	[mVK_UNIFORM_INT4] = { "int4", 1, 4, 16, 16 },
+	[mVK_UNIFORM_BOOL] = { "bool", 1, 1, 4, 4 },
+	[mVK_UNIFORM_BOOL2] = { "bool2", 1, 2, 8, 8 },
+	[mVK_UNIFORM_BOOL3] = { "bool3", 1, 3, 12, 16 },
+	[mVK_UNIFORM_BOOL4] = { "bool4", 1, 4, 16, 16 },
+};
+
+static bool _loadInstanceFunctions(struct mVKContext* context) {
+	struct mVKFunctions* vk = context->vk;
+#define LOAD_FUNCTION(NAME) \
+	vk->NAME = (PFN_ ## NAME) context->getInstanceProcAddr(context->instance, #NAME); \
+	if (!vk->NAME) { \
+		mLOG(VULKAN, ERROR, "Could not load %s", #NAME); \
+		return false; \
+	}
+	VK_INSTANCE_FUNCTIONS(LOAD_FUNCTION)
+#undef LOAD_FUNCTION
+	return true;
+}
+
+static bool _loadDeviceFunctions(struct mVKContext* context) {
+	struct mVKFunctions* vk = context->vk;
+#define LOAD_FUNCTION(NAME) \
+	vk->NAME = (PFN_ ## NAME) vk->vkGetDeviceProcAddr(context->device, #NAME); \
+	if (!vk->NAME) { \
+		mLOG(VULKAN, ERROR, "Could not load %s", #NAME); \
+		return false; \
+	}
+	VK_DEVICE_FUNCTIONS(LOAD_FUNCTION)
+#undef LOAD_FUNCTION
+	return true;
+}
+
+static uint32_t _findMemoryType(const struct mVKContext* context, uint32_t typeBits, VkMemoryPropertyFlags properties) {
+	uint32_t i;
+	for (i = 0; i < context->memoryProperties.memoryTypeCount; ++i) {
+		if ((typeBits & (1 << i)) && (context->memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+			return i;
+		}
+	}
+	return UINT32_MAX;
+}
+
+static bool _allocateMemory(struct mVKContext* context, const VkMemoryRequirements* requirements, VkMemoryPropertyFlags properties, VkMemoryPropertyFlags fallback, VkDeviceMemory* memory) {
+	uint32_t type = _findMemoryType(context, requirements->memoryTypeBits, properties);
+	if (type == UINT32_MAX) {
+		type = _findMemoryType(context, requirements->memoryTypeBits, fallback);
+	}
+	if (type == UINT32_MAX) {
+		mLOG(VULKAN, ERROR, "No suitable memory type found");
+		return false;
+	}
+	VkMemoryAllocateInfo info = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+		.allocationSize = requirements->size,
+		.memoryTypeIndex = type
+	};
+	return context->vk->vkAllocateMemory(context->device, &info, NULL, memory) == VK_SUCCESS;
+}
+
+static void _destroyImage(struct mVKContext* context, struct mVKImage* image) {
+	struct mVKFunctions* vk = context->vk;
+	if (image->framebuffer) {
+		vk->vkDestroyFramebuffer(context->device, image->framebuffer, NULL);
+	}
+	if (image->view) {
+		vk->vkDestroyImageView(context->device, image->view, NULL);
+	}
+	if (image->image) {
+		vk->vkDestroyImage(context->device, image->image, NULL);
+	}
+	if (image->memory) {
+		vk->vkFreeMemory(context->device, image->memory, NULL);
+	}
+	memset(image, 0, sizeof(*image));
+}
+
+// Creates an image to sample from, which can also be drawn into if given a render pass
+static bool _createImage(struct mVKContext* context, struct mVKImage* image, int width, int height, VkFormat format, VkRenderPass renderPass) {
+	struct mVKFunctions* vk = context->vk;
+	memset(image, 0, sizeof(*image));
+	VkImageCreateInfo imageInfo = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+		.imageType = VK_IMAGE_TYPE_2D,
+		.format = format,
+		.extent = { width, height, 1 },
+		.mipLevels = 1,
+		.arrayLayers = 1,
+		.samples = VK_SAMPLE_COUNT_1_BIT,
+		.tiling = VK_IMAGE_TILING_OPTIMAL,
+		.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+		.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+		.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
+	};
+	if (renderPass) {
+		imageInfo.usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	}
+	if (vk->vkCreateImage(context->device, &imageInfo, NULL, &image->image) != VK_SUCCESS) {
+		goto error;
+	}
+
+	VkMemoryRequirements requirements;
+	vk->vkGetImageMemoryRequirements(context->device, image->image, &requirements);
+	if (!_allocateMemory(context, &requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, &image->memory)) {
+		goto error;
+	}
+	if (vk->vkBindImageMemory(context->device, image->image, image->memory, 0) != VK_SUCCESS) {
+		goto error;
+	}
+
+	VkImageViewCreateInfo viewInfo = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+		.image = image->image,
+		.viewType = VK_IMAGE_VIEW_TYPE_2D,
+		.format = format,
+		.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 }
+	};
+#ifdef LAYER_SWIZZLE_RB
+	if (format == LAYER_FORMAT) {
+		viewInfo.components.r = VK_COMPONENT_SWIZZLE_B;
+		viewInfo.components.b = VK_COMPONENT_SWIZZLE_R;
+	}
+#endif
+	if (vk->vkCreateImageView(context->device, &viewInfo, NULL, &image->view) != VK_SUCCESS) {
+		goto error;
+	}
+
+	if (renderPass) {
+		VkFramebufferCreateInfo framebufferInfo = {
+			.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+			.renderPass = renderPass,
+			.attachmentCount = 1,
+			.pAttachments = &image->view,
+			.width = width,
+			.height = height,
+			.layers = 1
+		};
+		if (vk->vkCreateFramebuffer(context->device, &framebufferInfo, NULL, &image->framebuffer) != VK_SUCCESS) {
+			goto error;
+		}
+	}
+	image->width = width;
+	image->height = height;
+	image->initialized = false;
+	return true;
+
+error:
+	mLOG(VULKAN, ERROR, "Could not create %ix%i image", width, height);
+	_destroyImage(context, image);
+	return false;
+}
+
+// Images the GPU may still be reading from can't be replaced until it's done with them. This
+// only happens when sizes change, so there's no point in keeping them around until then.
+static bool _resizeImage(struct mVKContext* context, struct mVKImage* image, int width, int height, VkFormat format, VkRenderPass renderPass) {
+	if (image->image && image->width == width && image->height == height) {
+		return true;
+	}
+	if (width <= 0 || height <= 0) {
+		return false;
+	}
+	if (image->image) {
+		context->vk->vkDeviceWaitIdle(context->device);
+		_destroyImage(context, image);
+	}
+	return _createImage(context, image, width, height, format, renderPass);
+}
+
+static void _destroyBuffer(struct mVKContext* context, struct mVKBuffer* buffer) {
+	struct mVKFunctions* vk = context->vk;
+	if (buffer->data) {
+		vk->vkUnmapMemory(context->device, buffer->memory);
+	}
+	if (buffer->buffer) {
+		vk->vkDestroyBuffer(context->device, buffer->buffer, NULL);
+	}
+	if (buffer->memory) {
+		vk->vkFreeMemory(context->device, buffer->memory, NULL);
+	}
+	memset(buffer, 0, sizeof(*buffer));
+}
+
+static bool _createBuffer(struct mVKContext* context, struct mVKBuffer* buffer, size_t size) {
+	struct mVKFunctions* vk = context->vk;
+	memset(buffer, 0, sizeof(*buffer));
+	VkBufferCreateInfo info = {
+		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.size = size,
+		.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		.sharingMode = VK_SHARING_MODE_EXCLUSIVE
+	};
+	if (vk->vkCreateBuffer(context->device, &info, NULL, &buffer->buffer) != VK_SUCCESS) {
+		goto error;
+	}
+	VkMemoryRequirements requirements;
+	vk->vkGetBufferMemoryRequirements(context->device, buffer->buffer, &requirements);
+	if (!_allocateMemory(context, &requirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &buffer->memory)) {
+		goto error;
+	}
+	if (vk->vkBindBufferMemory(context->device, buffer->buffer, buffer->memory, 0) != VK_SUCCESS) {
+		goto error;
+	}
+	if (vk->vkMapMemory(context->device, buffer->memory, 0, VK_WHOLE_SIZE, 0, &buffer->data) != VK_SUCCESS) {
+		buffer->data = NULL;
+		goto error;
+	}
+	buffer->size = size;
+	return true;
+
+error:
+	mLOG(VULKAN, ERROR, "Could not create %" PRIz "u byte staging buffer", size);
+	_destroyBuffer(context, buffer);
+	return false;
+}
+
+static VkRenderPass _createRenderPass(struct mVKContext* context, VkFormat format, VkAttachmentLoadOp loadOp, VkImageLayout initialLayout, VkImageLayout finalLayout) {
+	VkAttachmentDescription attachment = {
+		.format = format,
+		.samples = VK_SAMPLE_COUNT_1_BIT,
+		.loadOp = loadOp,
+		.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+		.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+		.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+		.initialLayout = initialLayout,
+		.finalLayout = finalLayout
+	};
+	VkAttachmentReference reference = {
+		.attachment = 0,
+		.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+	};
+	VkSubpassDescription subpass = {
+		.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+		.colorAttachmentCount = 1,
+		.pColorAttachments = &reference
+	};
+	// Targets are sampled and copied from between passes, so each pass has to wait for
+	// whatever used its target before, and whatever comes after has to wait for it
+	VkSubpassDependency dependencies[] = {
+		{
+			.srcSubpass = VK_SUBPASS_EXTERNAL,
+			.dstSubpass = 0,
+			.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+			.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+		},
+		{
+			.srcSubpass = 0,
+			.dstSubpass = VK_SUBPASS_EXTERNAL,
+			.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			.dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+			.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT
+		},
+	};
+	VkRenderPassCreateInfo info = {
+		.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+		.attachmentCount = 1,
+		.pAttachments = &attachment,
+		.subpassCount = 1,
+		.pSubpasses = &subpass,
+		.dependencyCount = sizeof(dependencies) / sizeof(*dependencies),
+		.pDependencies = dependencies
+	};
+	VkRenderPass renderPass;
+	if (context->vk->vkCreateRenderPass(context->device, &info, NULL, &renderPass) != VK_SUCCESS) {
+		mLOG(VULKAN, ERROR, "Could not create render pass");
+		return VK_NULL_HANDLE;
+	}
+	return renderPass;
+}
+
+static VkShaderModule _createShaderModule(struct mVKContext* context, const uint32_t* code, size_t size) {
+	VkShaderModuleCreateInfo info = {
+		.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+		.codeSize = size,
+		.pCode = code
+	};
+	VkShaderModule module;
+	if (context->vk->vkCreateShaderModule(context->device, &info, NULL, &module) != VK_SUCCESS) {
+		mLOG(VULKAN, ERROR, "Could not create shader module");
+		return VK_NULL_HANDLE;
+	}
+	return module;
+}
+
+static VkPipeline _createPipeline(struct mVKContext* context, VkShaderModule vertexShader, VkShaderModule fragmentShader, VkRenderPass renderPass, bool blend) {
+	VkPipelineShaderStageCreateInfo stages[] = {
+		{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			.stage = VK_SHADER_STAGE_VERTEX_BIT,
+			.module = vertexShader,
+			.pName = "main"
+		},
+		{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			.stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+			.module = fragmentShader,
+			.pName = "main"
+		},
+	};
+	// The quad is generated from the vertex index, so there's nothing to feed in
+	VkPipelineVertexInputStateCreateInfo vertexInput = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO
+	};
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+		.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP
+	};
+	VkPipelineViewportStateCreateInfo viewport = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+		.viewportCount = 1,
+		.scissorCount = 1
+	};
+	VkPipelineRasterizationStateCreateInfo rasterization = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+		.polygonMode = VK_POLYGON_MODE_FILL,
+		.cullMode = VK_CULL_MODE_NONE,
+		.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+		.lineWidth = 1.f
+	};
+	VkPipelineMultisampleStateCreateInfo multisample = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+		.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT
+	};
+	VkPipelineColorBlendAttachmentState attachment = {
+		.blendEnable = blend,
+		.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA,
+		.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+		.colorBlendOp = VK_BLEND_OP_ADD,
+		.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+		.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+		.alphaBlendOp = VK_BLEND_OP_ADD,
+		.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
+	};
+	VkPipelineColorBlendStateCreateInfo colorBlend = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+		.attachmentCount = 1,
+		.pAttachments = &attachment
+	};
+	static const VkDynamicState dynamicStates[] = {
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR,
+	};
+	VkPipelineDynamicStateCreateInfo dynamic = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+		.dynamicStateCount = sizeof(dynamicStates) / sizeof(*dynamicStates),
+		.pDynamicStates = dynamicStates
+	};
+	VkGraphicsPipelineCreateInfo info = {
+		.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+		.stageCount = 2,
+		.pStages = stages,
+		.pVertexInputState = &vertexInput,
+		.pInputAssemblyState = &inputAssembly,
+		.pViewportState = &viewport,
+		.pRasterizationState = &rasterization,
+		.pMultisampleState = &multisample,
+		.pColorBlendState = &colorBlend,
+		.pDynamicState = &dynamic,
+		.layout = context->pipelineLayout,
+		.renderPass = renderPass,
+		.subpass = 0
+	};
+	VkPipeline pipeline;
+	if (context->vk->vkCreateGraphicsPipelines(context->device, VK_NULL_HANDLE, 1, &info, NULL, &pipeline) != VK_SUCCESS) {
+		mLOG(VULKAN, ERROR, "Could not create pipeline");
+		return VK_NULL_HANDLE;
+	}
+	return pipeline;
+}
+
+static VkSampler _createSampler(struct mVKContext* context, VkFilter filter) {
+	VkSamplerCreateInfo info = {
+		.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+		.magFilter = filter,
+		.minFilter = filter,
+		.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+		.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+		.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+		.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+		.maxLod = 0.f
+	};
+	VkSampler sampler;
+	if (context->vk->vkCreateSampler(context->device, &info, NULL, &sampler) != VK_SUCCESS) {
+		mLOG(VULKAN, ERROR, "Could not create sampler");
+		return VK_NULL_HANDLE;
+	}
+	return sampler;
+}
+
+static bool _hasExtension(struct mVKContext* context, VkPhysicalDevice device, const char* name) {
+	struct mVKFunctions* vk = context->vk;
+	uint32_t count = 0;
+	if (vk->vkEnumerateDeviceExtensionProperties(device, NULL, &count, NULL) != VK_SUCCESS || !count) {
+		return false;
+	}
+	VkExtensionProperties* extensions = calloc(count, sizeof(*extensions));
+	bool found = false;
+	if (vk->vkEnumerateDeviceExtensionProperties(device, NULL, &count, extensions) == VK_SUCCESS) {
+		uint32_t i;
+		for (i = 0; i < count; ++i) {
+			if (!strcmp(extensions[i].extensionName, name)) {
+				found = true;
+				break;
+			}
+		}
+	}
+	free(extensions);
+	return found;
+}
+
+// Picks the first device that can both draw and present to the surface from the same queue
+static bool _selectDevice(struct mVKContext* context) {
+	struct mVKFunctions* vk = context->vk;
+	uint32_t nDevices = 0;
+	if (vk->vkEnumeratePhysicalDevices(context->instance, &nDevices, NULL) != VK_SUCCESS || !nDevices) {
+		mLOG(VULKAN, ERROR, "No Vulkan devices found");
+		return false;
+	}
+	VkPhysicalDevice* devices = calloc(nDevices, sizeof(*devices));
+	vk->vkEnumeratePhysicalDevices(context->instance, &nDevices, devices);
+	uint32_t i;
+	for (i = 0; i < nDevices && !context->physicalDevice; ++i) {
+		if (!_hasExtension(context, devices[i], VK_KHR_SWAPCHAIN_EXTENSION_NAME)) {
+			continue;
+		}
+		uint32_t nFamilies = 0;
+		vk->vkGetPhysicalDeviceQueueFamilyProperties(devices[i], &nFamilies, NULL);
+		VkQueueFamilyProperties* families = calloc(nFamilies, sizeof(*families));
+		vk->vkGetPhysicalDeviceQueueFamilyProperties(devices[i], &nFamilies, families);
+		uint32_t family;
+		for (family = 0; family < nFamilies; ++family) {
+			VkBool32 present = VK_FALSE;
+			if (!(families[family].queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+				continue;
+			}
+			if (vk->vkGetPhysicalDeviceSurfaceSupportKHR(devices[i], family, context->surface, &present) != VK_SUCCESS || !present) {
+				continue;
+			}
+			context->physicalDevice = devices[i];
+			context->queueFamily = family;
+			break;
+		}
+		free(families);
+	}
+	free(devices);
+	if (!context->physicalDevice) {
+		mLOG(VULKAN, ERROR, "No Vulkan device can present to this window");
+		return false;
+	}
+	vk->vkGetPhysicalDeviceMemoryProperties(context->physicalDevice, &context->memoryProperties);
+	return true;
+}
+
+static VkPresentModeKHR _selectPresentMode(struct mVKContext* context) {
+	// FIFO is the only mode that's always there, and the only one that waits for vblank
+	if (context->vsync) {
+		return VK_PRESENT_MODE_FIFO_KHR;
+	}
+	struct mVKFunctions* vk = context->vk;
+	uint32_t count = 0;
+	vk->vkGetPhysicalDeviceSurfacePresentModesKHR(context->physicalDevice, context->surface, &count, NULL);
+	VkPresentModeKHR* modes = calloc(count, sizeof(*modes));
+	vk->vkGetPhysicalDeviceSurfacePresentModesKHR(context->physicalDevice, context->surface, &count, modes);
+	VkPresentModeKHR mode = VK_PRESENT_MODE_FIFO_KHR;
+	uint32_t i;
+	for (i = 0; i < count; ++i) {
+		if (modes[i] == VK_PRESENT_MODE_MAILBOX_KHR) {
+			mode = modes[i];
+			break;
+		}
+		if (modes[i] == VK_PRESENT_MODE_IMMEDIATE_KHR) {
+			mode = modes[i];
+		}
+	}
+	free(modes);
+	return mode;
+}
+
+static bool _selectSurfaceFormat(struct mVKContext* context, VkSurfaceFormatKHR* format) {
+	struct mVKFunctions* vk = context->vk;
+	uint32_t count = 0;
+	vk->vkGetPhysicalDeviceSurfaceFormatsKHR(context->physicalDevice, context->surface, &count, NULL);
+	if (!count) {
+		return false;
+	}
+	VkSurfaceFormatKHR* formats = calloc(count, sizeof(*formats));
+	vk->vkGetPhysicalDeviceSurfaceFormatsKHR(context->physicalDevice, context->surface, &count, formats);
+	*format = formats[0];
+	if (count == 1 && formats[0].format == VK_FORMAT_UNDEFINED) {
+		format->format = VK_FORMAT_B8G8R8A8_UNORM;
+	}
+	uint32_t i;
+	for (i = 0; i < count; ++i) {
+		if ((formats[i].format == VK_FORMAT_B8G8R8A8_UNORM || formats[i].format == VK_FORMAT_R8G8B8A8_UNORM) && formats[i].colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
+			*format = formats[i];
+			break;
+		}
+	}
+	free(formats);
+	return true;
+}
+
+static void _destroySwapchainImages(struct mVKContext* context) {
+	struct mVKFunctions* vk = context->vk;
+	uint32_t i;
+	for (i = 0; i < context->nSwapchainImages; ++i) {
+		if (context->swapchainFramebuffers[i]) {
+			vk->vkDestroyFramebuffer(context->device, context->swapchainFramebuffers[i], NULL);
+		}
+		if (context->swapchainViews[i]) {
+			vk->vkDestroyImageView(context->device, context->swapchainViews[i], NULL);
+		}
+		if (context->renderFinished[i]) {
+			vk->vkDestroySemaphore(context->device, context->renderFinished[i], NULL);
+		}
+	}
+	free(context->swapchainImages);
+	free(context->swapchainViews);
+	free(context->swapchainFramebuffers);
+	free(context->renderFinished);
+	context->swapchainImages = NULL;
+	context->swapchainViews = NULL;
+	context->swapchainFramebuffers = NULL;
+	context->renderFinished = NULL;
+	context->nSwapchainImages = 0;
+}
+
+static bool _createSwapchain(struct mVKContext* context) {
+	struct mVKFunctions* vk = context->vk;
+	VkSurfaceCapabilitiesKHR caps;
+	if (vk->vkGetPhysicalDeviceSurfaceCapabilitiesKHR(context->physicalDevice, context->surface, &caps) != VK_SUCCESS) {
+		return false;
+	}
+	VkExtent2D extent = caps.currentExtent;
+	if (extent.width == UINT32_MAX) {
+		// The surface takes whatever size the swapchain is, so go by the window
+		extent.width = context->windowWidth;
+		extent.height = context->windowHeight;
+		if (extent.width < caps.minImageExtent.width) {
+			extent.width = caps.minImageExtent.width;
+		} else if (extent.width > caps.maxImageExtent.width) {
+			extent.width = caps.maxImageExtent.width;
+		}
+		if (extent.height < caps.minImageExtent.height) {
+			extent.height = caps.minImageExtent.height;
+		} else if (extent.height > caps.maxImageExtent.height) {
+			extent.height = caps.maxImageExtent.height;
+		}
+	}
+	if (!extent.width || !extent.height) {
+		// The window is minimized, so there's nothing to draw into until it comes back
+		return false;
+	}
+
+	VkSurfaceFormatKHR format;
+	if (!_selectSurfaceFormat(context, &format)) {
+		return false;
+	}
+	if (format.format != context->surfaceFormat.format || !context->presentPass) {
+		if (context->presentPipeline) {
+			vk->vkDestroyPipeline(context->device, context->presentPipeline, NULL);
+			context->presentPipeline = VK_NULL_HANDLE;
+		}
+		if (context->presentPass) {
+			vk->vkDestroyRenderPass(context->device, context->presentPass, NULL);
+		}
+		context->presentPass = _createRenderPass(context, format.format, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+		if (!context->presentPass) {
+			return false;
+		}
+		context->presentPipeline = _createPipeline(context, context->vertexShader, context->fragmentShader, context->presentPass, false);
+		if (!context->presentPipeline) {
+			return false;
+		}
+	}
+	context->surfaceFormat = format;
+	context->presentMode = _selectPresentMode(context);
+
+	// One more image than the minimum lets a frame be drawn while another waits to be shown
+	uint32_t nImages = caps.minImageCount + 1;
+	if (caps.maxImageCount && nImages > caps.maxImageCount) {
+		nImages = caps.maxImageCount;
+	}
+	VkCompositeAlphaFlagBitsKHR compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+	if (!(caps.supportedCompositeAlpha & compositeAlpha)) {
+		compositeAlpha = caps.supportedCompositeAlpha & -caps.supportedCompositeAlpha;
+	}
+	VkSwapchainKHR oldSwapchain = context->swapchain;
+	VkSwapchainCreateInfoKHR info = {
+		.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
+		.surface = context->surface,
+		.minImageCount = nImages,
+		.imageFormat = format.format,
+		.imageColorSpace = format.colorSpace,
+		.imageExtent = extent,
+		.imageArrayLayers = 1,
+		.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+		.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE,
+		.preTransform = caps.currentTransform,
+		.compositeAlpha = compositeAlpha,
+		.presentMode = context->presentMode,
+		.clipped = VK_TRUE,
+		.oldSwapchain = oldSwapchain
+	};
+	VkResult result = vk->vkCreateSwapchainKHR(context->device, &info, NULL, &context->swapchain);
+	if (oldSwapchain) {
+		vk->vkDestroySwapchainKHR(context->device, oldSwapchain, NULL);
+	}
+	if (result != VK_SUCCESS) {
+		mLOG(VULKAN, ERROR, "Could not create swapchain");
+		context->swapchain = VK_NULL_HANDLE;
+		return false;
+	}
+	context->extent = extent;
+
+	vk->vkGetSwapchainImagesKHR(context->device, context->swapchain, &nImages, NULL);
+	context->swapchainImages = calloc(nImages, sizeof(VkImage));
+	context->swapchainViews = calloc(nImages, sizeof(VkImageView));
+	context->swapchainFramebuffers = calloc(nImages, sizeof(VkFramebuffer));
+	context->renderFinished = calloc(nImages, sizeof(VkSemaphore));
+	context->nSwapchainImages = nImages;
+	vk->vkGetSwapchainImagesKHR(context->device, context->swapchain, &nImages, context->swapchainImages);
+	uint32_t i;
+	for (i = 0; i < nImages; ++i) {
+		VkImageViewCreateInfo viewInfo = {
+			.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+			.image = context->swapchainImages[i],
+			.viewType = VK_IMAGE_VIEW_TYPE_2D,
+			.format = format.format,
+			.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 }
+		};
+		if (vk->vkCreateImageView(context->device, &viewInfo, NULL, &context->swapchainViews[i]) != VK_SUCCESS) {
+			return false;
+		}
+		VkFramebufferCreateInfo framebufferInfo = {
+			.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+			.renderPass = context->presentPass,
+			.attachmentCount = 1,
+			.pAttachments = &context->swapchainViews[i],
+			.width = extent.width,
+			.height = extent.height,
+			.layers = 1
+		};
+		if (vk->vkCreateFramebuffer(context->device, &framebufferInfo, NULL, &context->swapchainFramebuffers[i]) != VK_SUCCESS) {
+			return false;
+		}
+		VkSemaphoreCreateInfo semaphoreInfo = {
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO
+		};
+		if (vk->vkCreateSemaphore(context->device, &semaphoreInfo, NULL, &context->renderFinished[i]) != VK_SUCCESS) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool _recreateSwapchain(struct mVKContext* context) {
+	context->vk->vkDeviceWaitIdle(context->device);
+	_destroySwapchainImages(context);
+	if (!_createSwapchain(context)) {
+		_destroySwapchainImages(context);
+		return false;
+	}
+	context->swapchainDirty = false;
+	return true;
+}
+
+static bool _initFrame(struct mVKContext* context, struct mVKFrame* frame) {
+	struct mVKFunctions* vk = context->vk;
+	VkCommandBufferAllocateInfo commandInfo = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+		.commandPool = context->commandPool,
+		.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+		.commandBufferCount = 1
+	};
+	if (vk->vkAllocateCommandBuffers(context->device, &commandInfo, &frame->commandBuffer) != VK_SUCCESS) {
+		return false;
+	}
+	VkFenceCreateInfo fenceInfo = {
+		.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO
+	};
+	if (vk->vkCreateFence(context->device, &fenceInfo, NULL, &frame->fence) != VK_SUCCESS) {
+		return false;
+	}
+	VkSemaphoreCreateInfo semaphoreInfo = {
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO
+	};
+	if (vk->vkCreateSemaphore(context->device, &semaphoreInfo, NULL, &frame->imageAvailable) != VK_SUCCESS) {
+		return false;
+	}
+	// One set for each layer, interframe blending, each pass and presenting
+	uint32_t nSets = VIDEO_LAYER_MAX + mVK_MAX_PASSES + 2;
+	VkDescriptorPoolSize poolSize = {
+		.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+		.descriptorCount = nSets
+	};
+	VkDescriptorPoolCreateInfo poolInfo = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.maxSets = nSets,
+		.poolSizeCount = 1,
+		.pPoolSizes = &poolSize
+	};
+	if (vk->vkCreateDescriptorPool(context->device, &poolInfo, NULL, &frame->descriptorPool) != VK_SUCCESS) {
+		return false;
+	}
+	return true;
+}
+
+static void _deinitFrame(struct mVKContext* context, struct mVKFrame* frame) {
+	struct mVKFunctions* vk = context->vk;
+	size_t i;
+	for (i = 0; i < VIDEO_LAYER_MAX; ++i) {
+		_destroyBuffer(context, &frame->staging[i]);
+	}
+	if (frame->descriptorPool) {
+		vk->vkDestroyDescriptorPool(context->device, frame->descriptorPool, NULL);
+	}
+	if (frame->imageAvailable) {
+		vk->vkDestroySemaphore(context->device, frame->imageAvailable, NULL);
+	}
+	if (frame->fence) {
+		vk->vkDestroyFence(context->device, frame->fence, NULL);
+	}
+	memset(frame, 0, sizeof(*frame));
+}
+
+static void _initShaderPass(struct mVKContext* context, struct mVKShader* shader);
+
+static bool _initDevice(struct mVKContext* context) {
+	if (!context->getInstanceProcAddr || !context->createSurface) {
+		mLOG(VULKAN, ERROR, "No Vulkan loader or surface provided");
+		return false;
+	}
+	context->vk = calloc(1, sizeof(*context->vk));
+	struct mVKFunctions* vk = context->vk;
+	vk->vkCreateInstance = (PFN_vkCreateInstance) context->getInstanceProcAddr(VK_NULL_HANDLE, "vkCreateInstance");
+	if (!vk->vkCreateInstance) {
+		mLOG(VULKAN, ERROR, "Could not load vkCreateInstance");
+		return false;
+	}
+
+	VkApplicationInfo appInfo = {
+		.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+		.pApplicationName = projectName,
+		.pEngineName = projectName,
+		.apiVersion = VK_API_VERSION_1_0
+	};
+	VkInstanceCreateInfo instanceInfo = {
+		.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+		.pApplicationInfo = &appInfo,
+		.enabledExtensionCount = context->nInstanceExtensions,
+		.ppEnabledExtensionNames = context->instanceExtensions
+	};
+	if (vk->vkCreateInstance(&instanceInfo, NULL, &context->instance) != VK_SUCCESS) {
+		mLOG(VULKAN, ERROR, "Could not create Vulkan instance");
+		return false;
+	}
+	if (!_loadInstanceFunctions(context)) {
+		return false;
+	}
+	if (!context->createSurface(context, context->instance, &context->surface)) {
+		mLOG(VULKAN, ERROR, "Could not create Vulkan surface");
+		context->surface = VK_NULL_HANDLE;
+		return false;
+	}
+	if (!_selectDevice(context)) {
+		return false;
+	}
+
+	float priority = 1.f;
+	VkDeviceQueueCreateInfo queueInfo = {
+		.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+		.queueFamilyIndex = context->queueFamily,
+		.queueCount = 1,
+		.pQueuePriorities = &priority
+	};
+	const char* const extensions[] = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+	VkDeviceCreateInfo deviceInfo = {
+		.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+		.queueCreateInfoCount = 1,
+		.pQueueCreateInfos = &queueInfo,
+		.enabledExtensionCount = 1,
+		.ppEnabledExtensionNames = extensions
+	};
+	if (vk->vkCreateDevice(context->physicalDevice, &deviceInfo, NULL, &context->device) != VK_SUCCESS) {
+		mLOG(VULKAN, ERROR, "Could not create Vulkan device");
+		context->device = VK_NULL_HANDLE;
+		return false;
+	}
+	if (!_loadDeviceFunctions(context)) {
+		return false;
+	}
+	vk->vkGetDeviceQueue(context->device, context->queueFamily, 0, &context->queue);
+
+	VkCommandPoolCreateInfo poolInfo = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+		.queueFamilyIndex = context->queueFamily
+	};
+	if (vk->vkCreateCommandPool(context->device, &poolInfo, NULL, &context->commandPool) != VK_SUCCESS) {
+		return false;
+	}
+	if (context->framesInFlight < 1) {
+		context->framesInFlight = 1;
+	} else if (context->framesInFlight > mVK_MAX_FRAMES_IN_FLIGHT) {
+		context->framesInFlight = mVK_MAX_FRAMES_IN_FLIGHT;
+	}
+	unsigned i;
+	for (i = 0; i < context->framesInFlight; ++i) {
+		if (!_initFrame(context, &context->frames[i])) {
+			return false;
+		}
+	}
+
+	VkDescriptorSetLayoutBinding binding = {
+		.binding = 0,
+		.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+		.descriptorCount = 1,
+		.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT
+	};
+	VkDescriptorSetLayoutCreateInfo setLayoutInfo = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		.bindingCount = 1,
+		.pBindings = &binding
+	};
+	if (vk->vkCreateDescriptorSetLayout(context->device, &setLayoutInfo, NULL, &context->descriptorSetLayout) != VK_SUCCESS) {
+		return false;
+	}
+	VkPushConstantRange pushConstants = {
+		.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+		.offset = 0,
+		.size = mVK_PUSH_CONSTANTS_SIZE
+	};
+	VkPipelineLayoutCreateInfo layoutInfo = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+		.setLayoutCount = 1,
+		.pSetLayouts = &context->descriptorSetLayout,
+		.pushConstantRangeCount = 1,
+		.pPushConstantRanges = &pushConstants
+	};
+	if (vk->vkCreatePipelineLayout(context->device, &layoutInfo, NULL, &context->pipelineLayout) != VK_SUCCESS) {
+		return false;
+	}
+
+	context->nearestSampler = _createSampler(context, VK_FILTER_NEAREST);
+	context->linearSampler = _createSampler(context, VK_FILTER_LINEAR);
+	context->vertexShader = _createShaderModule(context, _vertexShader, sizeof(_vertexShader));
+	context->fragmentShader = _createShaderModule(context, _fragmentShader, sizeof(_fragmentShader));
+	// Intermediate targets stay ready to sample between passes, so they can be read from
+	// whether or not anything drew into them this frame
+	context->clearPass = _createRenderPass(context, TARGET_FORMAT, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	context->loadPass = _createRenderPass(context, TARGET_FORMAT, VK_ATTACHMENT_LOAD_OP_LOAD, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	if (!context->nearestSampler || !context->linearSampler || !context->vertexShader || !context->fragmentShader || !context->clearPass || !context->loadPass) {
+		return false;
+	}
+	context->composePipeline = _createPipeline(context, context->vertexShader, context->fragmentShader, context->clearPass, false);
+	context->blendPipeline = _createPipeline(context, context->vertexShader, context->fragmentShader, context->clearPass, true);
+	if (!context->composePipeline || !context->blendPipeline) {
+		return false;
+	}
+	size_t n;
+	for (n = 0; n < context->nShaders; ++n) {
+		_initShaderPass(context, &context->shaders[n]);
+	}
+	context->swapchainDirty = true;
+	return true;
+}
+
+static void _destroyShaderPass(struct mVKContext* context, struct mVKShader* shader) {
+	struct mVKFunctions* vk = context->vk;
+	if (shader->pipeline) {
+		vk->vkDestroyPipeline(context->device, shader->pipeline, NULL);
+	}
+	if (shader->vertexShader) {
+		vk->vkDestroyShaderModule(context->device, shader->vertexShader, NULL);
+	}
+	if (shader->fragmentShader) {
+		vk->vkDestroyShaderModule(context->device, shader->fragmentShader, NULL);
+	}
+	_destroyImage(context, &shader->target);
+	shader->pipeline = VK_NULL_HANDLE;
+	shader->vertexShader = VK_NULL_HANDLE;
+	shader->fragmentShader = VK_NULL_HANDLE;
+}
+
+static void _deinitDevice(struct mVKContext* context) {
+	struct mVKFunctions* vk = context->vk;
+	if (!vk) {
+		return;
+	}
+	if (context->device) {
+		vk->vkDeviceWaitIdle(context->device);
+		size_t i;
+		for (i = 0; i < context->nShaders; ++i) {
+			_destroyShaderPass(context, &context->shaders[i]);
+		}
+		for (i = 0; i < VIDEO_LAYER_MAX; ++i) {
+			_destroyImage(context, &context->layers[i]);
+		}
+		_destroyImage(context, &context->frame);
+		_destroyImage(context, &context->lastImage);
+		_destroySwapchainImages(context);
+		if (context->swapchain) {
+			vk->vkDestroySwapchainKHR(context->device, context->swapchain, NULL);
+		}
+		if (context->presentPipeline) {
+			vk->vkDestroyPipeline(context->device, context->presentPipeline, NULL);
+		}
+		if (context->blendPipeline) {
+			vk->vkDestroyPipeline(context->device, context->blendPipeline, NULL);
+		}
+		if (context->composePipeline) {
+			vk->vkDestroyPipeline(context->device, context->composePipeline, NULL);
+		}
+		if (context->presentPass) {
+			vk->vkDestroyRenderPass(context->device, context->presentPass, NULL);
+		}
+		if (context->loadPass) {
+			vk->vkDestroyRenderPass(context->device, context->loadPass, NULL);
+		}
+		if (context->clearPass) {
+			vk->vkDestroyRenderPass(context->device, context->clearPass, NULL);
+		}
+		if (context->fragmentShader) {
+			vk->vkDestroyShaderModule(context->device, context->fragmentShader, NULL);
+		}
+		if (context->vertexShader) {
+			vk->vkDestroyShaderModule(context->device, context->vertexShader, NULL);
+		}
+		if (context->linearSampler) {
+			vk->vkDestroySampler(context->device, context->linearSampler, NULL);
+		}
+		if (context->nearestSampler) {
+			vk->vkDestroySampler(context->device, context->nearestSampler, NULL);
+		}
+		if (context->pipelineLayout) {
+			vk->vkDestroyPipelineLayout(context->device, context->pipelineLayout, NULL);
+		}
+		if (context->descriptorSetLayout) {
+			vk->vkDestroyDescriptorSetLayout(context->device, context->descriptorSetLayout, NULL);
+		}
+		for (i = 0; i < mVK_MAX_FRAMES_IN_FLIGHT; ++i) {
+			_deinitFrame(context, &context->frames[i]);
+		}
+		if (context->commandPool) {
+			vk->vkDestroyCommandPool(context->device, context->commandPool, NULL);
+		}
+		vk->vkDestroyDevice(context->device, NULL);
+	}
+	if (context->surface) {
+		vk->vkDestroySurfaceKHR(context->instance, context->surface, NULL);
+	}
+	if (context->instance) {
+		vk->vkDestroyInstance(context->instance, NULL);
+	}
+	free(vk);
+
+	// Keep what the frontend set up and the shader chain, which can be attached again later
+	struct mVKContext saved = *context;
+	memset(context, 0, sizeof(*context));
+	context->d = saved.d;
+	context->getInstanceProcAddr = saved.getInstanceProcAddr;
+	context->instanceExtensions = saved.instanceExtensions;
+	context->nInstanceExtensions = saved.nInstanceExtensions;
+	context->createSurface = saved.createSurface;
+	context->vsync = saved.vsync;
+	context->framesInFlight = saved.framesInFlight;
+	context->shaders = saved.shaders;
+	context->nShaders = saved.nShaders;
+}
+
+static void mVKContextInit(struct VideoBackend* v, WHandle handle) {
+	UNUSED(handle);
+	struct mVKContext* context = (struct mVKContext*) v;
+	memset(context->layerDims, 0, sizeof(context->layerDims));
+	int i;
+	for (i = 0; i < VIDEO_LAYER_MAX; ++i) {
+		context->imageSizes[i].width = -1;
+		context->imageSizes[i].height = -1;
+	}
+	context->width = 1;
+	context->height = 1;
+
+	if (!_initDevice(context)) {
+		// Leaves the device unset, which every other call checks for
+		_deinitDevice(context);
+	}
+}
+
+static void mVKContextDeinit(struct VideoBackend* v) {
+	struct mVKContext* context = (struct mVKContext*) v;
+	_deinitDevice(context);
+}
+
+static void _layerSize(const struct mVKContext* context, enum VideoLayer layer, int* width, int* height) {
+	if (context->imageSizes[layer].width <= 0 || context->imageSizes[layer].height <= 0) {
+		*width = context->layerDims[layer].width;
+		*height = context->layerDims[layer].height;
+	} else {
+		*width = context->imageSizes[layer].width;
+		*height = context->imageSizes[layer].height;
+	}
+}
+
+static void mVKContextSetLayerDimensions(struct VideoBackend* v, enum VideoLayer layer, const struct mRectangle* dims) {
+	struct mVKContext* context = (struct mVKContext*) v;
+	if (layer >= VIDEO_LAYER_MAX) {
+		return;
+	}
+	// Images are only reallocated once a frame is drawn at the new size
+	context->layerDims[layer] = *dims;
+
+	struct mRectangle frame;
+	VideoBackendGetFrame(v, &frame);
+	context->x = frame.x;
+	context->y = frame.y;
+	context->width = frame.width;
+	context->height = frame.height;
+}
+
+static void mVKContextLayerDimensions(const struct VideoBackend* v, enum VideoLayer layer, struct mRectangle* dims) {
+	struct mVKContext* context = (struct mVKContext*) v;
+	if (layer >= VIDEO_LAYER_MAX) {
+		return;
+	}
+	memcpy(dims, &context->layerDims[layer], sizeof(*dims));
+}
+
+static void mVKContextResized(struct VideoBackend* v, unsigned w, unsigned h, unsigned maxW, unsigned maxH) {
+	struct mVKContext* context = (struct mVKContext*) v;
+	unsigned drawW = w;
+	unsigned drawH = h;
+
+	if (maxW && drawW > maxW) {
+		drawW = maxW;
+	}
+
+	if (maxH && drawH > maxH) {
+		drawH = maxH;
+	}
+
+	unsigned lockW = context->width;
+	unsigned lockH = context->height;
+
+	if (v->lockAspectRatio) {
+		lockAspectRatioUInt(lockW, lockH, &drawW, &drawH);
+	}
+	if (v->lockIntegerScaling) {
+		lockIntegerRatioUInt(lockW, &drawW);
+		lockIntegerRatioUInt(lockH, &drawH);
+	}
+	context->viewport.x = (w - drawW) / 2;
+	context->viewport.y = (h - drawH) / 2;
+	context->viewport.width = drawW;
+	context->viewport.height = drawH;
+	if (w != context->windowWidth || h != context->windowHeight) {
+		context->windowWidth = w;
+		context->windowHeight = h;
+		context->swapchainDirty = true;
+	}
+}
+
+static void mVKContextSetImageSize(struct VideoBackend* v, enum VideoLayer layer, int width, int height) {
+	struct mVKContext* context = (struct mVKContext*) v;
+	if (layer >= VIDEO_LAYER_MAX) {
+		return;
+	}
+
+	if (width <= 0 || height <= 0) {
+		context->imageSizes[layer].width = -1;
+		context->imageSizes[layer].height = -1;
+	} else {
+		context->imageSizes[layer].width = width;
+		context->imageSizes[layer].height = height;
+	}
+}
+
+static void mVKContextImageSize(struct VideoBackend* v, enum VideoLayer layer, int* width, int* height) {
+	struct mVKContext* context = (struct mVKContext*) v;
+	if (layer >= VIDEO_LAYER_MAX) {
+		return;
+	}
+	_layerSize(context, layer, width, height);
+}
+
+static void _waitFrame(struct mVKContext* context, struct mVKFrame* frame) {
+	if (!frame->submitted) {
+		return;
+	}
+	context->vk->vkWaitForFences(context->device, 1, &frame->fence, VK_TRUE, UINT64_MAX);
+	context->vk->vkResetFences(context->device, 1, &frame->fence);
+	frame->submitted = false;
+}
+
+static void mVKContextSetImage(struct VideoBackend* v, enum VideoLayer layer, const void* frame) {
+	struct mVKContext* context = (struct mVKContext*) v;
+	if (!context->device || layer >= VIDEO_LAYER_MAX) {
+		return;
+	}
+	int width;
+	int height;
+	_layerSize(context, layer, &width, &height);
+	if (width <= 0 || height <= 0) {
+		return;
+	}
+
+	// Each frame in flight has its own staging buffers, so this only waits if the GPU is
+	// still copying out of the ones from framesInFlight frames ago
+	struct mVKFrame* slot = &context->frames[context->currentFrame];
+	_waitFrame(context, slot);
+	struct mVKBuffer* staging = &slot->staging[layer];
+	size_t size = (size_t) width * height * BYTES_PER_PIXEL;
+	if (staging->size < size) {
+		_destroyBuffer(context, staging);
+		if (!_createBuffer(context, staging, size)) {
+			return;
+		}
+	}
+	memcpy(staging->data, frame, size);
+	slot->stagingSizes[layer].width = width;
+	slot->stagingSizes[layer].height = height;
+	slot->dirty[layer].x = 0;
+	slot->dirty[layer].y = 0;
+	slot->dirty[layer].width = width;
+	slot->dirty[layer].height = height;
+}
+
+// Copies out of a staging buffer have to start on a 4-byte boundary, so grow the region by a
+// pixel if it doesn't
+static void _alignRegion(struct mRectangle* region, int stride) {
+	if (!((((size_t) region->y * stride + region->x) * BYTES_PER_PIXEL) & 3)) {
+		return;
+	}
+	if (region->x) {
+		--region->x;
+		++region->width;
+	} else {
+		--region->y;
+		++region->height;
+	}
+}
+
+static void mVKContextSetImageRect(struct VideoBackend* v, enum VideoLayer layer, const struct mRectangle* rect, const void* frame) {
+	struct mVKContext* context = (struct mVKContext*) v;
+	if (!context->device || layer >= VIDEO_LAYER_MAX) {
+		return;
+	}
+	int width;
+	int height;
+	_layerSize(context, layer, &width, &height);
+	struct mVKFrame* slot = &context->frames[context->currentFrame];
+	if (slot->stagingSizes[layer].width != width || slot->stagingSizes[layer].height != height || context->layers[layer].width != width || context->layers[layer].height != height) {
+		// The staging buffer or the layer has to be reallocated, so the whole image is needed anyway
+		mVKContextSetImage(v, layer, frame);
+		return;
+	}
+	struct mRectangle dirty = { .width = width, .height = height };
+	if (!mRectangleIntersection(&dirty, rect)) {
+		return;
+	}
+
+	_waitFrame(context, slot);
+	// The rest of this staging buffer is as old as the last frame that used it, so everything
+	// that gets uploaded from it has to be copied in fresh, not just the part that changed
+	if (slot->dirty[layer].width > 0 && slot->dirty[layer].height > 0) {
+		mRectangleUnion(&dirty, &slot->dirty[layer]);
+	}
+	_alignRegion(&dirty, width);
+	size_t stride = (size_t) width * BYTES_PER_PIXEL;
+	size_t offset = dirty.y * stride + dirty.x * BYTES_PER_PIXEL;
+	const uint8_t* src = (const uint8_t*) frame + offset;
+	uint8_t* dst = (uint8_t*) slot->staging[layer].data + offset;
+	int y;
+	for (y = 0; y < dirty.height; ++y) {
+		memcpy(&dst[y * stride], &src[y * stride], dirty.width * BYTES_PER_PIXEL);
+	}
+	slot->dirty[layer] = dirty;
+}
+
+static void _barrier(struct mVKContext* context, VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) {
+	VkImageMemoryBarrier barrier = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		.srcAccessMask = srcAccess,
+		.dstAccessMask = dstAccess,
+		.oldLayout = oldLayout,
+		.newLayout = newLayout,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = image,
+		.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 }
+	};
+	context->vk->vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, NULL, 0, NULL, 1, &barrier);
+}
+
+// New images have undefined contents, so they're cleared once before anything reads them
+static void _initializeImage(struct mVKContext* context, VkCommandBuffer commandBuffer, struct mVKImage* image, float alpha) {
+	if (!image->image || image->initialized) {
+		return;
+	}
+	VkClearColorValue color = { .float32 = { 0.f, 0.f, 0.f, alpha } };
+	VkImageSubresourceRange range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+	_barrier(context, commandBuffer, image->image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+	         VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+	context->vk->vkCmdClearColorImage(commandBuffer, image->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &color, 1, &range);
+	_barrier(context, commandBuffer, image->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+	         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+	         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+	         VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT);
+	image->initialized = true;
+}
+
+static void _uploadLayer(struct mVKContext* context, struct mVKFrame* slot, VkCommandBuffer commandBuffer, enum VideoLayer layer) {
+	struct mVKImage* image = &context->layers[layer];
+	struct mRectangle region = slot->dirty[layer];
+	if (region.width <= 0 || region.height <= 0) {
+		return;
+	}
+	memset(&slot->dirty[layer], 0, sizeof(slot->dirty[layer]));
+	if (!image->image || slot->stagingSizes[layer].width != image->width || slot->stagingSizes[layer].height != image->height) {
+		// The layer changed size since this was staged, so it's already out of date
+		return;
+	}
+	VkBufferImageCopy copy = {
+		.bufferOffset = ((VkDeviceSize) region.y * image->width + region.x) * BYTES_PER_PIXEL,
+		.bufferRowLength = image->width,
+		.bufferImageHeight = image->height,
+		.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 },
+		.imageOffset = { region.x, region.y, 0 },
+		.imageExtent = { region.width, region.height, 1 }
+	};
+	_barrier(context, commandBuffer, image->image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+	         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+	context->vk->vkCmdCopyBufferToImage(commandBuffer, slot->staging[layer].buffer, image->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
+	_barrier(context, commandBuffer, image->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+	         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+	         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT);
+}
+
+static void _shaderSize(const struct mVKContext* context, const struct mVKShader* shader, int* width, int* height) {
+	int drawW = shader->width;
+	int drawH = shader->height;
+	if (!drawW) {
+		drawW = context->viewport.width;
+	} else if (drawW < 0) {
+		drawW = context->width * -shader->width;
+	}
+	if (!drawH) {
+		drawH = context->viewport.height;
+	} else if (drawH < 0) {
+		drawH = context->height * -shader->height;
+	}
+	if (shader->integerScaling) {
+		drawW -= drawW % context->width;
+		drawH -= drawH % context->height;
+	}
+	*width = drawW;
+	*height = drawH;
+}
+
+static bool _prepareTargets(struct mVKContext* context) {
+	int width;
+	int height;
+	int layer;
+	for (layer = 0; layer < VIDEO_LAYER_MAX; ++layer) {
+		_layerSize(context, layer, &width, &height);
+		if (width > 0 && height > 0) {
+			_resizeImage(context, &context->layers[layer], width, height, LAYER_FORMAT, VK_NULL_HANDLE);
+		}
+	}
+	if (!_resizeImage(context, &context->frame, context->width, context->height, TARGET_FORMAT, context->clearPass)) {
+		return false;
+	}
+	if (context->d.interframeBlending) {
+		_layerSize(context, VIDEO_LAYER_IMAGE, &width, &height);
+		if (width > 0 && height > 0) {
+			_resizeImage(context, &context->lastImage, width, height, LAYER_FORMAT, VK_NULL_HANDLE);
+		}
+	}
+	size_t n;
+	for (n = 0; n < context->nShaders; ++n) {
+		struct mVKShader* shader = &context->shaders[n];
+		if (!shader->pipeline) {
+			continue;
+		}
+		_shaderSize(context, shader, &width, &height);
+		if (!_resizeImage(context, &shader->target, width, height, TARGET_FORMAT, shader->blend ? context->loadPass : context->clearPass)) {
+			_destroyImage(context, &shader->target);
+		}
+	}
+	return true;
+}
+
+static void _beginPass(struct mVKContext* context, VkCommandBuffer commandBuffer, VkRenderPass renderPass, VkFramebuffer framebuffer, unsigned width, unsigned height) {
+	struct mVKFunctions* vk = context->vk;
+	VkClearValue clear = { .color = { .float32 = { 0.f, 0.f, 0.f, 1.f } } };
+	VkRenderPassBeginInfo info = {
+		.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+		.renderPass = renderPass,
+		.framebuffer = framebuffer,
+		.renderArea = { { 0, 0 }, { width, height } },
+		.clearValueCount = 1,
+		.pClearValues = &clear
+	};
+	vk->vkCmdBeginRenderPass(commandBuffer, &info, VK_SUBPASS_CONTENTS_INLINE);
+	VkViewport viewport = { 0.f, 0.f, width, height, 0.f, 1.f };
+	VkRect2D scissor = { { 0, 0 }, { width, height } };
+	vk->vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+	vk->vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
+
+static void _draw(struct mVKContext* context, struct mVKFrame* slot, VkCommandBuffer commandBuffer, VkPipeline pipeline, const struct mVKImage* input, VkSampler sampler, const void* constants, uint32_t size) {
+	struct mVKFunctions* vk = context->vk;
+	VkDescriptorSet set;
+	VkDescriptorSetAllocateInfo allocateInfo = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+		.descriptorPool = slot->descriptorPool,
+		.descriptorSetCount = 1,
+		.pSetLayouts = &context->descriptorSetLayout
+	};
+	if (vk->vkAllocateDescriptorSets(context->device, &allocateInfo, &set) != VK_SUCCESS) {
+		return;
+	}
+	VkDescriptorImageInfo imageInfo = {
+		.sampler = sampler,
+		.imageView = input->view,
+		.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+	};
+	VkWriteDescriptorSet write = {
+		.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		.dstSet = set,
+		.dstBinding = 0,
+		.descriptorCount = 1,
+		.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+		.pImageInfo = &imageInfo
+	};
+	vk->vkUpdateDescriptorSets(context->device, 1, &write, 0, NULL);
+	vk->vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+	vk->vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, context->pipelineLayout, 0, 1, &set, 0, NULL);
+	vk->vkCmdPushConstants(commandBuffer, context->pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, size, constants);
+	vk->vkCmdDraw(commandBuffer, 4, 1, 0, 0);
+}
+
+static void _writeUniforms(uint8_t* constants, const struct mVKShader* shader) {
+	size_t u;
+	for (u = 0; u < shader->nUniforms; ++u) {
+		const struct mVKUniform* uniform = &shader->uniforms[u];
+		const struct mVKUniformLayout* layout = &_uniformLayouts[uniform->type];
+		// Each matrix column is padded out to the matrix's alignment, the same as a vector would be
+		unsigned c;
+		for (c = 0; c < layout->columns; ++c) {
+			memcpy(&constants[uniform->offset + c * layout->align], &uniform->value.fmat4x4[c * layout->rows], layout->rows * sizeof(float));
+		}
+	}
+}
+
+// Puts all of the layers together at the size of the frame, then runs the shader passes over it
+static const struct mVKImage* _recordCompose(struct mVKContext* context, struct mVKFrame* slot, VkCommandBuffer commandBuffer) {
+	struct mVKFunctions* vk = context->vk;
+	struct VideoBackend* v = &context->d;
+	bool interframeBlending = v->interframeBlending && context->lastImage.image && context->lastImage.width == context->layers[VIDEO_LAYER_IMAGE].width && context->lastImage.height == context->layers[VIDEO_LAYER_IMAGE].height;
+
+	_beginPass(context, commandBuffer, context->clearPass, context->frame.framebuffer, context->width, context->height);
+	int layer;
+	for (layer = 0; layer < VIDEO_LAYER_MAX; ++layer) {
+		const struct mRectangle* dims = &context->layerDims[layer];
+		if (dims->width < 1 || dims->height < 1 || !context->layers[layer].image) {
+			continue;
+		}
+		struct mVKPushConstants push = {
+			.rect = {
+				(dims->x - context->x) * 2.f / context->width - 1.f,
+				(dims->y - context->y) * 2.f / context->height - 1.f,
+				dims->width * 2.f / context->width,
+				dims->height * 2.f / context->height
+			},
+			.texSize = { context->width, context->height },
+			.outputSize = { context->width, context->height },
+			.alpha = -1.f
+		};
+		VkPipeline pipeline = context->composePipeline;
+		if (layer == VIDEO_LAYER_IMAGE) {
+			push.alpha = 1.f;
+		} else if (layer > VIDEO_LAYER_BACKGROUND) {
+			pipeline = context->blendPipeline;
+		}
+		_draw(context, slot, commandBuffer, pipeline, &context->layers[layer], context->nearestSampler, &push, sizeof(push));
+		if (layer == VIDEO_LAYER_IMAGE && interframeBlending) {
+			push.alpha = 0.5f;
+			_draw(context, slot, commandBuffer, context->blendPipeline, &context->lastImage, context->nearestSampler, &push, sizeof(push));
+		}
+	}
+	vk->vkCmdEndRenderPass(commandBuffer);
+
+	if (interframeBlending) {
+		// Keep this frame's image around to blend into the next one
+		struct mVKImage* image = &context->layers[VIDEO_LAYER_IMAGE];
+		_barrier(context, commandBuffer, image->image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+		_barrier(context, commandBuffer, context->lastImage.image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+		VkImageCopy copy = {
+			.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 },
+			.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 },
+			.extent = { image->width, image->height, 1 }
+		};
+		vk->vkCmdCopyImage(commandBuffer, image->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, context->lastImage.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
+		_barrier(context, commandBuffer, image->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		         VK_PIPELINE_STAGE_TRANSFER_BIT, 0, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0);
+		_barrier(context, commandBuffer, context->lastImage.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+	}
+
+	const struct mVKImage* input = &context->frame;
+	size_t n;
+	for (n = 0; n < context->nShaders; ++n) {
+		struct mVKShader* shader = &context->shaders[n];
+		if (!shader->pipeline || !shader->target.image) {
+			continue;
+		}
+		uint8_t constants[mVK_PUSH_CONSTANTS_SIZE] = {0};
+		struct mVKPushConstants push = {
+			.rect = { -1.f, -1.f, 2.f, 2.f },
+			.texSize = { context->width, context->height },
+			.outputSize = { shader->target.width, shader->target.height },
+			.alpha = -1.f
+		};
+		memcpy(constants, &push, sizeof(push));
+		_writeUniforms(constants, shader);
+		_beginPass(context, commandBuffer, shader->blend ? context->loadPass : context->clearPass, shader->target.framebuffer, shader->target.width, shader->target.height);
+		_draw(context, slot, commandBuffer, shader->pipeline, input, shader->filter ? context->linearSampler : context->nearestSampler, constants, sizeof(constants));
+		vk->vkCmdEndRenderPass(commandBuffer);
+		input = &shader->target;
+	}
+	return input;
+}
+
+static void _recordPresent(struct mVKContext* context, struct mVKFrame* slot, VkCommandBuffer commandBuffer, const struct mVKImage* input) {
+	struct mVKFunctions* vk = context->vk;
+	_beginPass(context, commandBuffer, context->presentPass, context->swapchainFramebuffers[context->imageIndex], context->extent.width, context->extent.height);
+	if (input) {
+		struct mRectangle dims = context->viewport;
+		if (dims.width <= 0 || dims.height <= 0 || !context->windowWidth || !context->windowHeight) {
+			dims.x = 0;
+			dims.y = 0;
+			dims.width = context->extent.width;
+			dims.height = context->extent.height;
+		} else if (context->extent.width != context->windowWidth || context->extent.height != context->windowHeight) {
+			// High-DPI windows can have more pixels than the units they're sized in
+			dims.x = dims.x * context->extent.width / context->windowWidth;
+			dims.y = dims.y * context->extent.height / context->windowHeight;
+			dims.width = dims.width * context->extent.width / context->windowWidth;
+			dims.height = dims.height * context->extent.height / context->windowHeight;
+		}
+		VkViewport viewport = { dims.x, dims.y, dims.width, dims.height, 0.f, 1.f };
+		vk->vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+		struct mVKPushConstants push = {
+			.rect = { -1.f, -1.f, 2.f, 2.f },
+			.texSize = { context->width, context->height },
+			.outputSize = { dims.width, dims.height },
+			.alpha = 1.f
+		};
+		_draw(context, slot, commandBuffer, context->presentPipeline, input, context->d.filter ? context->linearSampler : context->nearestSampler, &push, sizeof(push));
+	}
+	vk->vkCmdEndRenderPass(commandBuffer);
+}
+
+static bool _drawFrame(struct mVKContext* context, bool compose) {
+	struct mVKFunctions* vk = context->vk;
+	if (context->swapchainDirty && !_recreateSwapchain(context)) {
+		return false;
+	}
+	if (!context->swapchain) {
+		return false;
+	}
+	struct mVKFrame* slot = &context->frames[context->currentFrame];
+	_waitFrame(context, slot);
+	bool prepared = _prepareTargets(context);
+
+	VkResult result = vk->vkAcquireNextImageKHR(context->device, context->swapchain, UINT64_MAX, slot->imageAvailable, VK_NULL_HANDLE, &context->imageIndex);
+	if (result == VK_SUBOPTIMAL_KHR) {
+		// Still usable, but worth replacing once this frame is out
+		context->swapchainDirty = true;
+	} else if (result != VK_SUCCESS) {
+		if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+			context->swapchainDirty = true;
+		}
+		return false;
+	}
+
+	vk->vkResetDescriptorPool(context->device, slot->descriptorPool, 0);
+	VkCommandBuffer commandBuffer = slot->commandBuffer;
+	VkCommandBufferBeginInfo beginInfo = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+	};
+	vk->vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	const struct mVKImage* output = NULL;
+	if (prepared) {
+		// Even a frame that's only cleared has to pick up what was staged for it, since the
+		// next frame will stage into a different buffer
+		int layer;
+		for (layer = 0; layer < VIDEO_LAYER_MAX; ++layer) {
+			_initializeImage(context, commandBuffer, &context->layers[layer], 0.f);
+			_uploadLayer(context, slot, commandBuffer, layer);
+		}
+		_initializeImage(context, commandBuffer, &context->frame, 1.f);
+		_initializeImage(context, commandBuffer, &context->lastImage, 1.f);
+		size_t n;
+		for (n = 0; n < context->nShaders; ++n) {
+			_initializeImage(context, commandBuffer, &context->shaders[n].target, 1.f);
+		}
+		if (compose) {
+			output = _recordCompose(context, slot, commandBuffer);
+		}
+	}
+	_recordPresent(context, slot, commandBuffer, output);
+	vk->vkEndCommandBuffer(commandBuffer);
+
+	VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	VkSubmitInfo submitInfo = {
+		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		.waitSemaphoreCount = 1,
+		.pWaitSemaphores = &slot->imageAvailable,
+		.pWaitDstStageMask = &waitStage,
+		.commandBufferCount = 1,
+		.pCommandBuffers = &commandBuffer,
+		.signalSemaphoreCount = 1,
+		.pSignalSemaphores = &context->renderFinished[context->imageIndex]
+	};
+	if (vk->vkQueueSubmit(context->queue, 1, &submitInfo, slot->fence) != VK_SUCCESS) {
+		mLOG(VULKAN, ERROR, "Could not submit frame");
+		return false;
+	}
+	slot->submitted = true;
+	context->pendingPresent = true;
+	return true;
+}
+
+static void _present(struct mVKContext* context) {
+	if (!context->pendingPresent) {
+		return;
+	}
+	VkPresentInfoKHR info = {
+		.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+		.waitSemaphoreCount = 1,
+		.pWaitSemaphores = &context->renderFinished[context->imageIndex],
+		.swapchainCount = 1,
+		.pSwapchains = &context->swapchain,
+		.pImageIndices = &context->imageIndex
+	};
+	VkResult result = context->vk->vkQueuePresentKHR(context->queue, &info);
+	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+		context->swapchainDirty = true;
+	}
+	context->pendingPresent = false;
+	// Frames that never made it out keep their slot, so nothing staged for them gets skipped
+	context->currentFrame = (context->currentFrame + 1) % context->framesInFlight;
+}
+
+static void mVKContextClear(struct VideoBackend* v) {
+	struct mVKContext* context = (struct mVKContext*) v;
+	context->clearRequested = true;
+}
+
+static void mVKContextDrawFrame(struct VideoBackend* v) {
+	struct mVKContext* context = (struct mVKContext*) v;
+	if (!context->device) {
+		return;
+	}
+	// Only one frame at a time can be waiting to be presented
+	_present(context);
+	context->clearRequested = false;
+	_drawFrame(context, true);
+}
+
+static void mVKContextSwap(struct VideoBackend* v) {
+	struct mVKContext* context = (struct mVKContext*) v;
+	if (!context->device) {
+		return;
+	}
+	if (!context->pendingPresent && context->clearRequested) {
+		_drawFrame(context, false);
+	}
+	context->clearRequested = false;
+	_present(context);
+}
+
+void mVKContextCreate(struct mVKContext* context) {
+	memset(context, 0, sizeof(*context));
+	context->d.init = mVKContextInit;
+	context->d.deinit = mVKContextDeinit;
+	context->d.setLayerDimensions = mVKContextSetLayerDimensions;
+	context->d.layerDimensions = mVKContextLayerDimensions;
+	context->d.contextResized = mVKContextResized;
+	context->d.swap = mVKContextSwap;
+	context->d.clear = mVKContextClear;
+	context->d.setImageSize = mVKContextSetImageSize;
+	context->d.imageSize = mVKContextImageSize;
+	context->d.setImage = mVKContextSetImage;
+	context->d.setImageRect = mVKContextSetImageRect;
+	context->d.drawFrame = mVKContextDrawFrame;
+	context->vsync = true;
+	context->framesInFlight = 2;
+}
+
+void mVKContextSetVsync(struct mVKContext* context, bool vsync) {
+	if (context->vsync == vsync) {
+		return;
+	}
+	context->vsync = vsync;
+	context->swapchainDirty = true;
+}
+
+static void _initShaderPass(struct mVKContext* context, struct mVKShader* shader) {
+	VkShaderModule vertexShader = context->vertexShader;
+	VkShaderModule fragmentShader = context->fragmentShader;
+	if (shader->vertexCode) {
+		shader->vertexShader = _createShaderModule(context, shader->vertexCode, shader->vertexSize);
+		vertexShader = shader->vertexShader;
+	}
+	if (shader->fragmentCode) {
+		shader->fragmentShader = _createShaderModule(context, shader->fragmentCode, shader->fragmentSize);
+		fragmentShader = shader->fragmentShader;
+	}
+	if (!vertexShader || !fragmentShader) {
+		_destroyShaderPass(context, shader);
+		return;
+	}
+	// Both kinds of intermediate pass are compatible, so either works here
+	shader->pipeline = _createPipeline(context, vertexShader, fragmentShader, context->clearPass, shader->blend);
+	if (!shader->pipeline) {
+		_destroyShaderPass(context, shader);
+	}
+}
+
+void mVKShaderAttach(struct mVKContext* context, struct mVKShader* shaders, size_t nShaders) {
+	if (context->shaders) {
+		if (context->shaders == shaders && context->nShaders == nShaders) {
+			return;
+		}
+		mVKShaderDetach(context);
+	}
+	if (nShaders > mVK_MAX_PASSES) {
+		mLOG(VULKAN, WARN, "Only the first %i shader passes will be used", mVK_MAX_PASSES);
+		nShaders = mVK_MAX_PASSES;
+	}
+	context->shaders = shaders;
+	context->nShaders = nShaders;
+	if (!context->device) {
+		return;
+	}
+	size_t i;
+	for (i = 0; i < nShaders; ++i) {
+		_initShaderPass(context, &shaders[i]);
+	}
+}
+
+void mVKShaderDetach(struct mVKContext* context) {
+	if (!context->shaders) {
+		return;
+	}
+	if (context->device) {
+		context->vk->vkDeviceWaitIdle(context->device);
+		size_t i;
+		for (i = 0; i < context->nShaders; ++i) {
+			_destroyShaderPass(context, &context->shaders[i]);
+		}
+	}
+	context->shaders = NULL;
+	context->nShaders = 0;
+}
+
+static void _freePass(struct mVKShader* shader) {
+	free(shader->vertexCode);
+	free(shader->fragmentCode);
+	size_t u;
+	for (u = 0; u < shader->nUniforms; ++u) {
+		free((void*) shader->uniforms[u].name);
+		free((void*) shader->uniforms[u].readableName);
+	}
+	free(shader->uniforms);
+	memset(shader, 0, sizeof(*shader));
+}
+
+#ifdef ENABLE_VFS
+static bool _lookupIntValue(const struct Configuration* config, const char* section, const char* key, int* out) {
+	const char* charValue = ConfigurationGetValue(config, section, key);
+	if (!charValue) {
+		return false;
+	}
+	char* end;
+	unsigned long value = strtol(charValue, &end, 10);
+	if (*end) {
+		return false;
+	}
+	*out = value;
+	return true;
+}
+
+static bool _lookupFloatValue(const struct Configuration* config, const char* section, const char* key, float* out) {
+	const char* charValue = ConfigurationGetValue(config, section, key);
+	if (!charValue) {
+		return false;
+	}
+	char* end;
+	float value = strtof_u(charValue, &end);
+	if (*end) {
+		return false;
+	}
+	*out = value;
+	return true;
+}
+
+static bool _lookupBoolValue(const struct Configuration* config, const char* section, const char* key, uint32_t* out) {
+	const char* charValue = ConfigurationGetValue(config, section, key);
+	if (!charValue) {
+		return false;
+	}
+	if (!strcmp(charValue, "true")) {
+		*out = 1;
+		return true;
+	}
+	if (!strcmp(charValue, "false")) {
+		*out = 0;
+		return true;
+	}
+	char* end;
+	unsigned long value = strtol(charValue, &end, 10);
+	if (*end) {
+		return false;
+	}
+	*out = !!value;
+	return true;
+}
+
+DECLARE_VECTOR(mVKUniformList, struct mVKUniform);
+DEFINE_VECTOR(mVKUniformList, struct mVKUniform);
+
+static void _uniformHandler(const char* sectionName, void* user) {
+	struct mVKUniformList* uniforms = user;
+	unsigned passId;
+	int sentinel;
+	if (sscanf(sectionName, "pass.%u.uniform.%n", &passId, &sentinel) < 1) {
+		return;
+	}
+	struct mVKUniform* u = mVKUniformListAppend(uniforms);
+	u->name = sectionName;
+}
+
+// Vectors are given as name[i] and matrices as name[column,row], the same as for OpenGL shaders
+static void _loadValue(struct Configuration* description, const char* name, enum mVKUniformType type, const char* field, union mVKUniformValue* value) {
+	const struct mVKUniformLayout* layout = &_uniformLayouts[type];
+	char fieldName[24];
+	memset(value, 0, sizeof(*value));
+	unsigned c;
+	for (c = 0; c < layout->columns; ++c) {
+		unsigned r;
+		for (r = 0; r < layout->rows; ++r) {
+			const char* key = field;
+			if (layout->columns > 1) {
+				snprintf(fieldName, sizeof(fieldName), "%s[%u,%u]", field, c, r);
+				key = fieldName;
+			} else if (layout->rows > 1) {
+				snprintf(fieldName, sizeof(fieldName), "%s[%u]", field, r);
+				key = fieldName;
+			}
+			unsigned i = c * layout->rows + r;
+			if (type < mVK_UNIFORM_INT) {
+				_lookupFloatValue(description, name, key, &value->fmat4x4[i]);
+			} else if (type < mVK_UNIFORM_BOOL) {
+				_lookupIntValue(description, name, key, &value->ivec4[i]);
+			} else {
+				_lookupBoolValue(description, name, key, &value->bvec4[i]);
+			}
+		}
+	}
+}
+
+static bool _loadUniform(struct Configuration* description, size_t pass, struct mVKUniform* uniform) {
+	unsigned passId;
+	if (sscanf(uniform->name, "pass.%u.uniform.", &passId) < 1 || passId != pass) {
+		return false;
+	}
+	const char* type = ConfigurationGetValue(description, uniform->name, "type");
+	if (!type) {
+		return false;
+	}
+	size_t i;
+	for (i = 0; i < sizeof(_uniformLayouts) / sizeof(*_uniformLayouts); ++i) {
+		if (!strcmp(type, _uniformLayouts[i].name)) {
+			break;
+		}
+	}
+	if (i == sizeof(_uniformLayouts) / sizeof(*_uniformLayouts)) {
+		return false;
+	}
+	uniform->type = i;
+
+	// There's no way to look uniforms up by name in SPIR-V, so the manifest has to say where
+	// in the push constant block each one goes
+	const struct mVKUniformLayout* layout = &_uniformLayouts[i];
+	int offset;
+	if (!_lookupIntValue(description, uniform->name, "offset", &offset)) {
+		mLOG(VULKAN, WARN, "Uniform %s has no offset", uniform->name);
+		return false;
+	}
+	if (offset < mVK_PUSH_CONSTANTS_BASE || (uint32_t) offset % layout->align || (uint32_t) offset + layout->size > mVK_PUSH_CONSTANTS_SIZE) {
+		mLOG(VULKAN, WARN, "Uniform %s has invalid offset %i", uniform->name, offset);
+		return false;
+	}
+	uniform->offset = offset;
+	_loadValue(description, uniform->name, uniform->type, "default", &uniform->value);
+	_loadValue(description, uniform->name, uniform->type, "min", &uniform->min);
+	_loadValue(description, uniform->name, uniform->type, "max", &uniform->max);
+	const char* readable = ConfigurationGetValue(description, uniform->name, "readableName");
+	if (readable) {
+		uniform->readableName = strdup(readable);
+	} else {
+		uniform->readableName = 0;
+	}
+	uniform->name = strdup(strstr(uniform->name, "uniform.") + strlen("uniform."));
+	return true;
+}
+
+static bool _loadSpirv(struct VDir* dir, const char* name, uint32_t** code, size_t* size) {
+	if (name[0] == '.' || strstr(name, PATH_SEP)) {
+		return false;
+	}
+	struct VFile* vf = dir->openFile(dir, name, O_RDONLY);
+	if (!vf) {
+		return false;
+	}
+	ssize_t fileSize = vf->size(vf);
+	// A module needs at least its five-word header, and is only ever whole words
+	if (fileSize < 20 || fileSize & 3) {
+		vf->close(vf);
+		return false;
+	}
+	*code = malloc(fileSize);
+	if (vf->read(vf, *code, fileSize) != fileSize || (*code)[0] != SPIRV_MAGIC) {
+		mLOG(VULKAN, WARN, "%s is not a SPIR-V module", name);
+		free(*code);
+		*code = NULL;
+		vf->close(vf);
+		return false;
+	}
+	vf->close(vf);
+	*size = fileSize;
+	return true;
+}
+
+bool mVKShaderLoad(struct VideoShader* shader, struct VDir* dir) {
+	struct VFile* manifest = dir->openFile(dir, "manifest.ini", O_RDONLY);
+	if (!manifest) {
+		return false;
+	}
+	bool success = false;
+	struct Configuration description;
+	ConfigurationInit(&description);
+	if (ConfigurationReadVFile(&description, manifest)) {
+		int inShaders = 0;
+		success = _lookupIntValue(&description, "shader", "passes", &inShaders);
+		if (inShaders > mVK_MAX_PASSES || inShaders < 1) {
+			success = false;
+		}
+		if (success) {
+			struct mVKShader* shaderBlock = calloc(inShaders, sizeof(struct mVKShader));
+			int n;
+			for (n = 0; n < inShaders; ++n) {
+				char passName[16];
+				snprintf(passName, sizeof(passName), "pass.%u", n);
+				struct mVKShader* pass = &shaderBlock[n];
+				// GLSL sources are for the OpenGL backends; Vulkan needs them compiled ahead of time
+				const char* fs = ConfigurationGetValue(&description, passName, "spirvFragmentShader");
+				const char* vs = ConfigurationGetValue(&description, passName, "spirvVertexShader");
+				if (fs && !_loadSpirv(dir, fs, &pass->fragmentCode, &pass->fragmentSize)) {
+					success = false;
+					break;
+				}
+				if (vs && !_loadSpirv(dir, vs, &pass->vertexCode, &pass->vertexSize)) {
+					success = false;
+					break;
+				}
+				int value = 0;
+				_lookupIntValue(&description, passName, "width", &pass->width);
+				_lookupIntValue(&description, passName, "height", &pass->height);
+				if (_lookupIntValue(&description, passName, "integerScaling", &value)) {
+					pass->integerScaling = value;
+				}
+				value = 0;
+				if (_lookupIntValue(&description, passName, "blend", &value)) {
+					pass->blend = value;
+				}
+				value = 0;
+				if (_lookupIntValue(&description, passName, "filter", &value)) {
+					pass->filter = value;
+				}
+
+				struct mVKUniformList uniformVector;
+				mVKUniformListInit(&uniformVector, 0);
+				ConfigurationEnumerateSections(&description, _uniformHandler, &uniformVector);
+				size_t u;
+				for (u = 0; u < mVKUniformListSize(&uniformVector); ++u) {
+					struct mVKUniform* uniform = mVKUniformListGetPointer(&uniformVector, u);
+					if (!_loadUniform(&description, n, uniform)) {
+						mVKUniformListShift(&uniformVector, u, 1);
+						--u;
+					}
+				}
+				u = mVKUniformListSize(&uniformVector);
+				if (u) {
+					pass->uniforms = calloc(u, sizeof(*pass->uniforms));
+					memcpy(pass->uniforms, mVKUniformListGetPointer(&uniformVector, 0), sizeof(*pass->uniforms) * u);
+				}
+				pass->nUniforms = u;
+				mVKUniformListDeinit(&uniformVector);
+			}
+			if (success) {
+				shader->nPasses = inShaders;
+				shader->passes = shaderBlock;
+				shader->name = ConfigurationGetValue(&description, "shader", "name");
+				if (shader->name) {
+					shader->name = strdup(shader->name);
+				}
+				shader->author = ConfigurationGetValue(&description, "shader", "author");
+				if (shader->author) {
+					shader->author = strdup(shader->author);
+				}
+				shader->description = ConfigurationGetValue(&description, "shader", "description");
+				if (shader->description) {
+					shader->description = strdup(shader->description);
+				}
+			} else {
+				inShaders = n + 1;
+				for (n = 0; n < inShaders; ++n) {
+					_freePass(&shaderBlock[n]);
+				}
+				free(shaderBlock);
+			}
+		}
+	}
+	manifest->close(manifest);
+	ConfigurationDeinit(&description);
+	return success;
+}
+#endif
+
+void mVKShaderFree(struct VideoShader* shader) {
+	free((void*) shader->name);
+	free((void*) shader->author);
+	free((void*) shader->description);
+	shader->name = 0;
+	shader->author = 0;
+	shader->description = 0;
+	struct mVKShader* shaders = shader->passes;
+	size_t n;
+	for (n = 0; n < shader->nPasses; ++n) {
+		_freePass(&shaders[n]);
+	}
+	free(shaders);
+	shader->passes = 0;
+	shader->nPasses = 0;
+}
@@ -0,0 +1,219 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef VK_H
+#define VK_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+// Everything is loaded through the getInstanceProcAddr the frontend hands over, so nothing
+// links against the Vulkan loader directly
+#define VK_NO_PROTOTYPES
+#include <vulkan/vulkan.h>
+
+#include <mgba/feature/video-backend.h>
+
+#define mVK_MAX_FRAMES_IN_FLIGHT 3
+#define mVK_MAX_PASSES 8
+
+// Every pipeline gets the same push constant block, which the built-in vertex shader reads as:
+//   vec4 rect;       // Where to draw, in normalized device coordinates (x, y, width, height)
+//   vec2 texSize;    // Size of the composited frame
+//   vec2 outputSize; // Size of the pass being drawn
+//   float alpha;     // Alpha the built-in fragment shader draws with, or negative to keep the texture's
+// Shader passes can put their own uniforms after that, from mVK_PUSH_CONSTANTS_BASE up to
+// mVK_PUSH_CONSTANTS_SIZE, which is as much as every device is guaranteed to support.
+#define mVK_PUSH_CONSTANTS_BASE 36
+#define mVK_PUSH_CONSTANTS_SIZE 128
+
+enum mVKUniformType {
+	mVK_UNIFORM_FLOAT = 0,
+	mVK_UNIFORM_FLOAT2,
+	mVK_UNIFORM_FLOAT3,
+	mVK_UNIFORM_FLOAT4,
+	mVK_UNIFORM_FLOAT2X2,
+	mVK_UNIFORM_FLOAT3X3,
+	mVK_UNIFORM_FLOAT4X4,
+	mVK_UNIFORM_INT,
+	mVK_UNIFORM_INT2,
+	mVK_UNIFORM_INT3,
+	mVK_UNIFORM_INT4,
+	mVK_UNIFORM_BOOL,
+	mVK_UNIFORM_BOOL2,
+	mVK_UNIFORM_BOOL3,
+	mVK_UNIFORM_BOOL4,
+};
+
+union mVKUniformValue {
+	float f;
+	int32_t i;
+	uint32_t b;
+	float fvec2[2];
+	float fvec3[3];
+	float fvec4[4];
+	int32_t ivec2[2];
+	int32_t ivec3[3];
+	int32_t ivec4[4];
+	uint32_t bvec2[2];
+	uint32_t bvec3[3];
+	uint32_t bvec4[4];
+	float fmat2x2[4];
+	float fmat3x3[9];
+	float fmat4x4[16];
+};
+
+struct mVKUniform {
+	const char* name;
+	enum mVKUniformType type;
+	union mVKUniformValue value;
+	uint32_t offset;
+	union mVKUniformValue min;
+	union mVKUniformValue max;
+	const char* readableName;
+};
+
+struct mVKImage {
+	VkImage image;
+	VkDeviceMemory memory;
+	VkImageView view;
+	VkFramebuffer framebuffer;
+	int width;
+	int height;
+	// Cleared to a known layout the first time a frame uses it
+	bool initialized;
+};
+
+struct mVKBuffer {
+	VkBuffer buffer;
+	VkDeviceMemory memory;
+	void* data;
+	size_t size;
+};
+
+struct mVKShader {
+	int width;
+	int height;
+	bool integerScaling;
+	bool filter;
+	bool blend;
+
+	// SPIR-V as loaded, turned into modules and a pipeline when attached
+	uint32_t* vertexCode;
+	size_t vertexSize;
+	uint32_t* fragmentCode;
+	size_t fragmentSize;
+	VkShaderModule vertexShader;
+	VkShaderModule fragmentShader;
+	VkPipeline pipeline;
+	struct mVKImage target;
+
+	struct mVKUniform* uniforms;
+	size_t nUniforms;
+};
+
+// Everything a frame needs that the GPU may still be reading while the next one is built
+struct mVKFrame {
+	VkCommandBuffer commandBuffer;
+	VkFence fence;
+	VkSemaphore imageAvailable;
+	VkDescriptorPool descriptorPool;
+	struct mVKBuffer staging[VIDEO_LAYER_MAX];
+	struct mSize stagingSizes[VIDEO_LAYER_MAX];
+	// Parts of each staging buffer that still need to be copied into the layer; empty if none
+	struct mRectangle dirty[VIDEO_LAYER_MAX];
+	bool submitted;
+};
+
+struct mVKFunctions;
+
+struct mVKContext {
+	struct VideoBackend d;
+
+	// Filled in by the frontend before init
+	PFN_vkGetInstanceProcAddr getInstanceProcAddr;
+	const char* const* instanceExtensions;
+	uint32_t nInstanceExtensions;
+	bool (*createSurface)(struct mVKContext*, VkInstance, VkSurfaceKHR*);
+	// Whether presenting should wait for vertical blank. Without it, frames are presented in
+	// mailbox mode, replacing any frame still waiting instead of queueing up behind it.
+	bool vsync;
+	// How many frames may be queued on the GPU before drawing the next one waits
+	unsigned framesInFlight;
+
+	struct mVKFunctions* vk;
+	VkInstance instance;
+	VkSurfaceKHR surface;
+	VkPhysicalDevice physicalDevice;
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	VkDevice device;
+	uint32_t queueFamily;
+	VkQueue queue;
+	VkCommandPool commandPool;
+
+	VkSwapchainKHR swapchain;
+	VkSurfaceFormatKHR surfaceFormat;
+	VkExtent2D extent;
+	VkPresentModeKHR presentMode;
+	uint32_t nSwapchainImages;
+	VkImage* swapchainImages;
+	VkImageView* swapchainViews;
+	VkFramebuffer* swapchainFramebuffers;
+	VkSemaphore* renderFinished;
+	bool swapchainDirty;
+
+	VkRenderPass presentPass;
+	VkRenderPass clearPass;
+	VkRenderPass loadPass;
+	VkDescriptorSetLayout descriptorSetLayout;
+	VkPipelineLayout pipelineLayout;
+	VkSampler nearestSampler;
+	VkSampler linearSampler;
+	VkShaderModule vertexShader;
+	VkShaderModule fragmentShader;
+	VkPipeline composePipeline;
+	VkPipeline blendPipeline;
+	VkPipeline presentPipeline;
+
+	struct mVKImage layers[VIDEO_LAYER_MAX];
+	struct mRectangle layerDims[VIDEO_LAYER_MAX];
+	struct mSize imageSizes[VIDEO_LAYER_MAX];
+	struct mVKImage frame;
+	struct mVKImage lastImage;
+	int x;
+	int y;
+	int width;
+	int height;
+
+	unsigned windowWidth;
+	unsigned windowHeight;
+	struct mRectangle viewport;
+
+	struct mVKShader* shaders;
+	size_t nShaders;
+
+	struct mVKFrame frames[mVK_MAX_FRAMES_IN_FLIGHT];
+	unsigned currentFrame;
+	uint32_t imageIndex;
+	bool pendingPresent;
+	bool clearRequested;
+};
+
+void mVKContextCreate(struct mVKContext*);
+void mVKContextSetVsync(struct mVKContext*, bool vsync);
+
+void mVKShaderAttach(struct mVKContext*, struct mVKShader*, size_t nShaders);
+void mVKShaderDetach(struct mVKContext*);
+
+#ifdef ENABLE_VFS
+struct VDir;
+bool mVKShaderLoad(struct VideoShader*, struct VDir*);
+#endif
+void mVKShaderFree(struct VideoShader*);
+
+CXX_GUARD_END
+
+#endif
@@ -41,6 +41,11 @@
 #define TEX_W 256
 #define TEX_H 224
 
+// A texture four texels wide is stored linearly, so the core's output can be sampled
+// directly as a stack of these, each covering SLICE_H rows
+#define SLICE_TEX_H 1024
+#define SLICE_H (SLICE_TEX_H * 4 / TEX_W)
+
 #define ANALOG_DEADZONE 0x30
 
 static void _mapKey(struct mInputMap* map, uint32_t binding, int nativeKey, int key) {
@@ -123,6 +128,7 @@ static uint16_t* rescaleTexmem;
 static GXTexObj rescaleTex;
 static uint16_t* interframeTexmem;
 static GXTexObj interframeTex;
+static bool frameConverted = false;
 static bool sgbCrop = false;
 static int32_t tiltX;
 static int32_t tiltY;
@@ -1468,6 +1474,9 @@ void _gameLoaded(struct mGUIRunner* runner) {
 	}
 	memset(texmem, 0, TEX_W * TEX_H * BYTES_PER_PIXEL);
 	memset(interframeTexmem, 0, TEX_W * TEX_H * BYTES_PER_PIXEL);
+	DCFlushRange(texmem, TEX_W * TEX_H * BYTES_PER_PIXEL);
+	DCFlushRange(interframeTexmem, TEX_W * TEX_H * BYTES_PER_PIXEL);
+	frameConverted = false;
 	_unpaused(runner);
 }
 
@@ -1521,32 +1530,80 @@ void _unpaused(struct mGUIRunner* runner) {
 }
 
 void _prepareForFrame(struct mGUIRunner* runner) {
-	if (interframeBlending) {
-		memcpy(interframeTexmem, texmem, TEX_W * TEX_H * BYTES_PER_PIXEL);
+	UNUSED(runner);
+	if (interframeBlending && frameConverted) {
+		// The last frame drawn becomes the previous frame, and its texture gets reused
+		uint16_t* swapTexmem = texmem;
+		texmem = interframeTexmem;
+		interframeTexmem = swapTexmem;
+		GXTexObj swapTex = tex;
+		tex = interframeTex;
+		interframeTex = swapTex;
+		frameConverted = false;
 	}
 }
 
+static void _convertFrame(void) {
+	// GX can't sample the core's linear rows as one texture, so they are drawn 1:1 into
+	// the EFB from four-texel-wide slices and copied back out, leaving the tiling to the
+	// copy. Each column of four pixels in a slice steps down its texture by a whole row
+	// of the output per line, so it needs its own quad.
+	DCFlushRange(outputBuffer, TEX_W * TEX_H * BYTES_PER_PIXEL);
+	GX_InvalidateTexAll();
+	GX_SetBlendMode(GX_BM_NONE, GX_BL_ONE, GX_BL_ZERO, GX_LO_NOOP);
+	GX_SetNumTevStages(1);
+	GX_SetVtxAttrFmt(GX_VTXFMT0, GX_VA_TEX0, GX_TEX_ST, GX_F32, 0);
+
+	Mtx44 proj;
+	guOrtho(proj, 0, vmode->efbHeight, 0, vmode->fbWidth, 0, 300);
+	GX_LoadProjectionMtx(proj, GX_ORTHOGRAPHIC);
+
+	unsigned columns = (corew + 3) >> 2;
+	unsigned x, y;
+	for (y = 0; y < coreh; y += SLICE_H) {
+		GXTexObj slice;
+		GX_InitTexObj(&slice, &((uint16_t*) outputBuffer)[y * TEX_W], 4, SLICE_TEX_H, GX_TF_RGB565, GX_CLAMP, GX_CLAMP, GX_FALSE);
+		GX_InitTexObjFilterMode(&slice, GX_NEAR, GX_NEAR);
+		GX_LoadTexObj(&slice, GX_TEXMAP0);
+
+		GX_Begin(GX_QUADS, GX_VTXFMT0, columns * 4);
+		for (x = 0; x < columns; ++x) {
+			// Offset so that each pixel center lands on a texel center
+			float top = (x + 0.5f - TEX_W / 8) / SLICE_TEX_H;
+			float bottom = top + 1.f;
+			GX_Position2s16(x * 4, y + SLICE_H);
+			GX_Color1u32(0xFFFFFFFF);
+			GX_TexCoord2f32(0, bottom);
+
+			GX_Position2s16(x * 4 + 4, y + SLICE_H);
+			GX_Color1u32(0xFFFFFFFF);
+			GX_TexCoord2f32(1, bottom);
+
+			GX_Position2s16(x * 4 + 4, y);
+			GX_Color1u32(0xFFFFFFFF);
+			GX_TexCoord2f32(1, top);
+
+			GX_Position2s16(x * 4, y);
+			GX_Color1u32(0xFFFFFFFF);
+			GX_TexCoord2f32(0, top);
+		}
+		GX_End();
+	}
+
+	GX_SetTexCopySrc(0, 0, TEX_W, TEX_H);
+	GX_SetTexCopyDst(TEX_W, TEX_H, GX_TF_RGB565, GX_FALSE);
+	GX_CopyTex(texmem, GX_TRUE);
+	GX_PixModeSync();
+	frameConverted = true;
+}
+
 void _drawFrame(struct mGUIRunner* runner, bool faded) {
 	runner->core->currentVideoSize(runner->core, &corew, &coreh);
 	uint32_t color = 0xFFFFFF3F;
 	if (!faded) {
 		color |= 0xC0;
 	}
-	size_t x, y;
-	uint64_t* texdest = (uint64_t*) texmem;
-	uint64_t* texsrc = (uint64_t*) outputBuffer;
-	for (y = 0; y < coreh; y += 4) {
-		for (x = 0; x < corew >> 2; ++x) {
-			texdest[0 + x * 4 + y * 64] = texsrc[0   + x + y * 64];
-			texdest[1 + x * 4 + y * 64] = texsrc[64  + x + y * 64];
-			texdest[2 + x * 4 + y * 64] = texsrc[128 + x + y * 64];
-			texdest[3 + x * 4 + y * 64] = texsrc[192 + x + y * 64];
-		}
-	}
-	DCFlushRange(texdest, TEX_W * TEX_H * BYTES_PER_PIXEL);
-	if (interframeBlending) {
-		DCFlushRange(interframeTexmem, TEX_W * TEX_H * BYTES_PER_PIXEL);
-	}
+	_convertFrame();
 
 	if (faded || interframeBlending) {
 		GX_SetBlendMode(GX_BM_BLEND, GX_BL_SRCALPHA, GX_BL_INVSRCALPHA, GX_LO_NOOP);
@@ -1563,7 +1620,6 @@ void _drawFrame(struct mGUIRunner* runner, bool faded) {
 		GX_SetNumTevStages(1);
 	}
 
-	GX_SetVtxAttrFmt(GX_VTXFMT0, GX_VA_TEX0, GX_TEX_ST, GX_F32, 0);
 	s16 vertWidth = corew;
 	s16 vertHeight = coreh;
 
@@ -16,3 +16,80 @@ void mappedMemoryFree(void* memory, size_t size) {
 	// size is not useful here because we're freeing the memory, not decommitting it
 	VirtualFree(memory, 0, MEM_RELEASE);
 }
+
+void* hugeMemoryMap(size_t size) {
+	// Large pages need the lock pages in memory privilege, which most users don't have,
+	// so fall back to normal pages whenever they can't be had
+	SIZE_T largePage = GetLargePageMinimum();
+	if (largePage) {
+		SIZE_T largeSize = (size + largePage - 1) & ~(largePage - 1);
+		void* memory = VirtualAlloc(NULL, largeSize, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+		if (memory) {
+			return memory;
+		}
+	}
+	return anonymousMemoryMap(size);
+}
+
+void hugeMemoryFree(void* memory, size_t size) {
+	mappedMemoryFree(memory, size);
+}
+
+// PrefetchVirtualMemory only exists on Windows 8 and newer, so look it up at runtime
+struct _mMemoryRange {
+	PVOID address;
+	SIZE_T size;
+};
+typedef BOOL (WINAPI *_mPrefetchVirtualMemory)(HANDLE, ULONG_PTR, struct _mMemoryRange*, ULONG);
+
+void mappedMemoryAdvise(void* memory, size_t size, int advice) {
+	if (advice & mMEMORY_ADVICE_READ_AHEAD) {
+		static _mPrefetchVirtualMemory prefetch = NULL;
+		static bool resolved = false;
+		if (!resolved) {
+			prefetch = (_mPrefetchVirtualMemory) GetProcAddress(GetModuleHandleW(L"kernel32.dll"), "PrefetchVirtualMemory");
+			resolved = true;
+		}
+		if (prefetch) {
+			struct _mMemoryRange range = { memory, size };
+			prefetch(GetCurrentProcess(), 1, &range, 0);
+		}
+	}
+	if (advice & mMEMORY_ADVICE_PREFAULT) {
+		volatile uint8_t* bytes = memory;
+		size_t i;
+		for (i = 0; i < size; i += 0x1000) {
+			bytes[i] = bytes[i];
+		}
+	}
+}
+
+size_t mappedMemoryResident(const void* memory, size_t size) {
+	UNUSED(memory);
+	return size;
+}
+
+bool sharedMemoryCreate(struct SharedMemory* memory, size_t size) {
+	uint64_t size64 = size;
+	HANDLE handle = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, size64 >> 32, size64 & 0xFFFFFFFF, NULL);
+	if (!handle) {
+		return false;
+	}
+	memory->handle = (intptr_t) handle;
+	memory->size = size;
+	return true;
+}
+
+void sharedMemoryDestroy(struct SharedMemory* memory) {
+	CloseHandle((HANDLE) memory->handle);
+	memory->handle = 0;
+}
+
+void* sharedMemoryMap(const struct SharedMemory* memory, bool copyOnWrite) {
+	return MapViewOfFile((HANDLE) memory->handle, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_WRITE, 0, 0, memory->size);
+}
+
+void sharedMemoryUnmap(const struct SharedMemory* memory, void* mapping) {
+	UNUSED(memory);
+	UnmapViewOfFile(mapping);
+}
@@ -21,6 +21,8 @@ struct mScriptCanvasLayer {
 	bool sizeDirty;
 	bool dimsDirty;
 	bool contentsDirty;
+	bool rectDirty;
+	struct mRectangle dirtyRect;
 };
 
 struct mScriptCanvasContext {
@@ -208,7 +210,21 @@ static void mScriptCanvasLayerUpdate(struct mScriptCanvasLayer* layer) {
 	if (layer->contentsDirty) {
 		backend->setImage(backend, layer->layer, layer->image->data);
 		layer->contentsDirty = false;
+	} else if (layer->rectDirty) {
+		struct mRectangle bounds = {
+			.width = layer->image->width,
+			.height = layer->image->height,
+		};
+		// Anything marked outside of the image can't have changed it
+		if (mRectangleIntersection(&layer->dirtyRect, &bounds)) {
+			if (backend->setImageRect) {
+				backend->setImageRect(backend, layer->layer, &layer->dirtyRect, layer->image->data);
+			} else {
+				backend->setImage(backend, layer->layer, layer->image->data);
+			}
+		}
 	}
+	layer->rectDirty = false;
 	layer->dirty = false;
 }
 
@@ -225,6 +241,26 @@ static void mScriptCanvasLayerInvalidate(struct mScriptCanvasLayer* layer) {
 	layer->dirty = true;
 }
 
+static void mScriptCanvasLayerInvalidateRect(struct mScriptCanvasLayer* layer, int32_t x, int32_t y, int32_t width, int32_t height) {
+	if (width <= 0 || height <= 0) {
+		return;
+	}
+	struct mRectangle rect = {
+		.x = x,
+		.y = y,
+		.width = width,
+		.height = height,
+	};
+	// Everything changed since the last update gets uploaded as one rectangle
+	if (layer->rectDirty) {
+		mRectangleUnion(&layer->dirtyRect, &rect);
+	} else {
+		layer->dirtyRect = rect;
+		layer->rectDirty = true;
+	}
+	layer->dirty = true;
+}
+
 void mScriptContextAttachCanvas(struct mScriptContext* context) {
 	struct mScriptCanvasContext* canvas = calloc(1, sizeof(*canvas));
 	canvas->scale = 1;
@@ -273,6 +309,7 @@ mSCRIPT_DEFINE_STRUCT(mScriptCanvasContext)
 mSCRIPT_DEFINE_END;
 
 mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptCanvasLayer, update, mScriptCanvasLayerInvalidate, 0);
+mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptCanvasLayer, updateRect, mScriptCanvasLayerInvalidateRect, 4, S32, x, S32, y, S32, width, S32, height);
 mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptCanvasLayer, setPosition, mScriptCanvasLayerSetPosition, 2, S32, x, S32, y);
 
 mSCRIPT_DEFINE_STRUCT(mScriptCanvasLayer)
@@ -281,6 +318,8 @@ mSCRIPT_DEFINE_STRUCT(mScriptCanvasLayer)
 	)
 	mSCRIPT_DEFINE_DOCSTRING("Mark the contents of the layer as needed to be repainted")
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCanvasLayer, update)
+	mSCRIPT_DEFINE_DOCSTRING("Mark only part of the contents of the layer as needed to be repainted. This is cheaper than repainting the whole layer when only a small part of it changed")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCanvasLayer, updateRect)
 	mSCRIPT_DEFINE_DOCSTRING("Set the position of the layer in the canvas")
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCanvasLayer, setPosition)
 	mSCRIPT_DEFINE_DOCSTRING("The image that has the pixel contents of the image")
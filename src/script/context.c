@@ -4,12 +4,14 @@
  * License, v. 2.0. If a copy of the MPL was not distributed with this
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/script/context.h>
+#include <mgba/internal/script/types.h>
 #ifdef USE_LUA
 #include <mgba/internal/script/lua.h>
 #endif
 #include <mgba-util/threading.h>
 
 static ThreadLocal _threadContext;
+static int _threadContextReady = 0;
 
 #ifdef USE_PTHREADS
 static pthread_once_t _contextOnce = PTHREAD_ONCE_INIT;
@@ -30,6 +32,9 @@ static BOOL CALLBACK _createTLS(PINIT_ONCE once, PVOID param, PVOID* context) {
 #endif
 
 #define KEY_NAME_MAX 128
+#define PROFILE_NAME_MAX (KEY_NAME_MAX + 24)
+
+DEFINE_VECTOR(mScriptProfileList, struct mScriptProfileEntry);
 
 struct mScriptFileInfo {
 	const char* name;
@@ -37,11 +42,21 @@ struct mScriptFileInfo {
 	struct mScriptEngineContext* context;
 };
 
+struct mScriptCallbackSet {
+	struct mScriptContext* context;
+	const char* name;
+	struct Table callbacks;
+	size_t oneshots;
+	struct mScriptFrame frame;
+	bool frameInUse;
+};
+
 struct mScriptCallbackInfo {
 	struct mScriptValue* fn;
-	const char* callback;
+	struct mScriptCallbackSet* set;
 	uint32_t id;
 	bool oneshot;
+	char profileName[PROFILE_NAME_MAX];
 };
 
 static void _engineContextDestroy(void* ctx) {
@@ -79,19 +94,77 @@ static void _contextFindForFile(const char* key, void* value, void* user) {
 	}
 }
 
-static void _freeTable(void* data) {
-	struct Table* table = data;
+static uint64_t _profileNow(void) {
+#ifdef _WIN32
+	LARGE_INTEGER counter;
+	LARGE_INTEGER frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return (counter.QuadPart / frequency.QuadPart) * UINT64_C(1000000000) + (counter.QuadPart % frequency.QuadPart) * UINT64_C(1000000000) / frequency.QuadPart;
+#elif defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec * UINT64_C(1000000000) + tv.tv_usec * UINT64_C(1000);
+#endif
+}
+
+static void _recordProfile(struct mScriptContext* context, const char* name, uint64_t nsec) {
+	struct mScriptProfileEntry* entry = HashTableLookup(&context->profile, name);
+	if (!entry) {
+		entry = calloc(1, sizeof(*entry));
+		HashTableInsert(&context->profile, name, entry);
+	}
+	++entry->calls;
+	entry->totalNsec += nsec;
+	if (nsec > entry->maxNsec) {
+		entry->maxNsec = nsec;
+	}
+}
+
+static bool _invoke(struct mScriptContext* context, const struct mScriptValue* fn, struct mScriptFrame* frame, const char* profileName) {
+	if (!mScriptContextActivate(context)) {
+		return false;
+	}
+	bool res;
+	if (context->profiling && profileName) {
+		// Times are inclusive, so a callback's time includes that of the functions it calls
+		uint64_t start = _profileNow();
+		res = mScriptInvoke(fn, frame);
+		_recordProfile(context, profileName, _profileNow() - start);
+	} else {
+		res = mScriptInvoke(fn, frame);
+	}
+	mScriptContextDeactivate(context);
+	return res;
+}
+
+static int _profileCompare(const void* a, const void* b) {
+	const struct mScriptProfileEntry* entryA = a;
+	const struct mScriptProfileEntry* entryB = b;
+	if (entryA->totalNsec != entryB->totalNsec) {
+		return entryA->totalNsec < entryB->totalNsec ? 1 : -1;
+	}
+	return strcmp(entryA->name, entryB->name);
+}
+
+static void _freeCallbackSet(void* data) {
+	struct mScriptCallbackSet* set = data;
 
 	struct TableIterator iter;
-	if (TableIteratorStart(table, &iter)) {
+	if (TableIteratorStart(&set->callbacks, &iter)) {
 		do {
-			struct mScriptCallbackInfo* info = TableIteratorGetValue(table, &iter);
+			struct mScriptCallbackInfo* info = TableIteratorGetValue(&set->callbacks, &iter);
 			mScriptValueDeref(info->fn);
-		} while (TableIteratorNext(table, &iter));
+		} while (TableIteratorNext(&set->callbacks, &iter));
 	}
 
-	TableDeinit(table);
-	free(table);
+	TableDeinit(&set->callbacks);
+	mScriptFrameDeinit(&set->frame);
+	free(set);
 }
 
 void mScriptContextInit(struct mScriptContext* context) {
@@ -100,17 +173,23 @@ void mScriptContextInit(struct mScriptContext* context) {
 #elif _WIN32
 	InitOnceExecuteOnce(&_contextOnce, _createTLS, NULL, 0);
 #endif
+	ATOMIC_STORE(_threadContextReady, 1);
 	HashTableInit(&context->rootScope, 0, (void (*)(void*)) mScriptValueDeref);
 	HashTableInit(&context->engines, 0, _engineContextDestroy);
 	mScriptListInit(&context->refPool, 0);
 	TableInit(&context->weakrefs, 0, (void (*)(void*)) mScriptValueDeref);
 	context->nextWeakref = 1;
-	HashTableInit(&context->callbacks, 0, _freeTable);
+	HashTableInit(&context->callbacks, 0, _freeCallbackSet);
 	TableInit(&context->callbackId, 0, free);
 	context->nextCallbackId = 1;
 	context->constants = NULL;
 	HashTableInit(&context->docstrings, 0, NULL);
 	context->threadDepth = 0;
+	context->valuePool = NULL;
+	context->valuePoolSize = 0;
+	context->profiling = false;
+	HashTableInit(&context->profile, 0, free);
+	context->compileCache = false;
 }
 
 void mScriptContextDeinit(struct mScriptContext* context) {
@@ -122,6 +201,14 @@ void mScriptContextDeinit(struct mScriptContext* context) {
 	TableDeinit(&context->callbackId);
 	HashTableDeinit(&context->engines);
 	HashTableDeinit(&context->docstrings);
+	HashTableDeinit(&context->profile);
+
+	while (context->valuePool) {
+		struct mScriptValue* next = context->valuePool->value.opaque;
+		free(context->valuePool);
+		context->valuePool = next;
+	}
+	context->valuePoolSize = 0;
 }
 
 void mScriptContextFillPool(struct mScriptContext* context, struct mScriptValue* value) {
@@ -247,41 +334,85 @@ void mScriptContextDisownWeakref(struct mScriptContext* context, uint32_t weakre
 	poolEntry->refs = mSCRIPT_VALUE_UNREF;
 }
 
-void mScriptContextTriggerCallback(struct mScriptContext* context, const char* callback, struct mScriptList* args) {
-	struct Table* table = HashTableLookup(&context->callbacks, callback);
-	if (!table) {
-		return;
+struct mScriptCallbackSet* mScriptContextResolveCallback(struct mScriptContext* context, const char* callback) {
+	struct mScriptCallbackSet* set = HashTableLookup(&context->callbacks, callback);
+	if (set) {
+		return set;
 	}
+	set = calloc(1, sizeof(*set));
+	set->context = context;
+	TableInit(&set->callbacks, 0, NULL);
+	mScriptFrameInit(&set->frame);
+	HashTableInsert(&context->callbacks, callback, set);
+	// Steal the string from the table key, since it's guaranteed to outlive this struct
+	struct TableIterator iter;
+	HashTableIteratorLookup(&context->callbacks, &iter, callback);
+	set->name = HashTableIteratorGetKey(&context->callbacks, &iter);
+	return set;
+}
+
+void mScriptContextTriggerCallbackSet(struct mScriptCallbackSet* set, struct mScriptList* args) {
 	struct TableIterator iter;
-	if (!TableIteratorStart(table, &iter)) {
+	if (!TableIteratorStart(&set->callbacks, &iter)) {
 		return;
 	}
 
+	// The set keeps a frame around so triggering doesn't allocate, unless a callback
+	// ends up triggering the same set again while the frame is still in use
+	struct mScriptFrame localFrame;
+	struct mScriptFrame* frame = &set->frame;
+	bool nested = set->frameInUse;
+	if (nested) {
+		mScriptFrameInit(&localFrame);
+		frame = &localFrame;
+	}
+	set->frameInUse = true;
+
 	struct UInt32List oneshots;
-	UInt32ListInit(&oneshots, 0);
+	bool hasOneshots = false;
 	do {
-		struct mScriptFrame frame;
-		struct mScriptCallbackInfo* info = TableIteratorGetValue(table, &iter);
-		struct mScriptValue* fn = mScriptContextAccessWeakref(context, info->fn);
+		struct mScriptCallbackInfo* info = TableIteratorGetValue(&set->callbacks, &iter);
+		struct mScriptValue* fn = mScriptContextAccessWeakref(set->context, info->fn);
 		if (fn) {
-			mScriptFrameInit(&frame);
 			if (args) {
-				mScriptListCopy(&frame.stack, args);
+				mScriptListCopy(&frame->stack, args);
+			} else {
+				mScriptListClear(&frame->stack);
 			}
-			mScriptContextInvoke(context, fn, &frame);
-			mScriptFrameDeinit(&frame);
+			_invoke(set->context, fn, frame, info->profileName);
 		}
 
 		if (info->oneshot) {
+			if (!hasOneshots) {
+				UInt32ListInit(&oneshots, set->oneshots);
+				hasOneshots = true;
+			}
 			*UInt32ListAppend(&oneshots) = info->id;
 		}
-	} while (TableIteratorNext(table, &iter));
+	} while (TableIteratorNext(&set->callbacks, &iter));
 
-	size_t i;
-	for (i = 0; i < UInt32ListSize(&oneshots); ++i) {
-		mScriptContextRemoveCallback(context, *UInt32ListGetPointer(&oneshots, i));
+	if (nested) {
+		mScriptFrameDeinit(&localFrame);
+	} else {
+		mScriptListClear(&frame->stack);
+		set->frameInUse = false;
+	}
+
+	if (hasOneshots) {
+		size_t i;
+		for (i = 0; i < UInt32ListSize(&oneshots); ++i) {
+			mScriptContextRemoveCallback(set->context, *UInt32ListGetPointer(&oneshots, i));
+		}
+		UInt32ListDeinit(&oneshots);
 	}
-	UInt32ListDeinit(&oneshots);
+}
+
+void mScriptContextTriggerCallback(struct mScriptContext* context, const char* callback, struct mScriptList* args) {
+	struct mScriptCallbackSet* set = HashTableLookup(&context->callbacks, callback);
+	if (!set) {
+		return;
+	}
+	mScriptContextTriggerCallbackSet(set, args);
 }
 
 static uint32_t mScriptContextAddCallbackInternal(struct mScriptContext* context, const char* callback, struct mScriptValue* fn, bool oneshot) {
@@ -296,18 +427,13 @@ static uint32_t mScriptContextAddCallbackInternal(struct mScriptContext* context
 	} else if (fn->type->base != mSCRIPT_TYPE_FUNCTION) {
 		return 0;
 	}
-	struct Table* table = HashTableLookup(&context->callbacks, callback);
-	if (!table) {
-		table = calloc(1, sizeof(*table));
-		TableInit(table, 0, NULL);
-		HashTableInsert(&context->callbacks, callback, table);
-	}
+	struct mScriptCallbackSet* set = mScriptContextResolveCallback(context, callback);
 	struct mScriptCallbackInfo* info = malloc(sizeof(*info));
-	// Steal the string from the table key, since it's guaranteed to outlive this struct
-	struct TableIterator iter;
-	HashTableIteratorLookup(&context->callbacks, &iter, callback);
-	info->callback = HashTableIteratorGetKey(&context->callbacks, &iter);
+	info->set = set;
 	info->oneshot = oneshot;
+	if (oneshot) {
+		++set->oneshots;
+	}
 	if (fn->type->base == mSCRIPT_TYPE_WRAPPER) {
 		fn = mScriptValueUnwrap(fn);
 	}
@@ -323,7 +449,8 @@ static uint32_t mScriptContextAddCallbackInternal(struct mScriptContext* context
 		info->id = id;
 		break;
 	}
-	TableInsert(table, info->id, info);
+	snprintf(info->profileName, sizeof(info->profileName), "callback::%s#%u", set->name, info->id);
+	TableInsert(&set->callbacks, info->id, info);
 	return info->id;
 }
 
@@ -340,15 +467,41 @@ void mScriptContextRemoveCallback(struct mScriptContext* context, uint32_t cbid)
 	if (!info) {
 		return;
 	}
-	struct Table* table = HashTableLookup(&context->callbacks, info->callback);
-	if (!table) {
-		return;
+	struct mScriptCallbackSet* set = info->set;
+	if (info->oneshot) {
+		--set->oneshots;
 	}
 	mScriptValueDeref(info->fn);
-	TableRemove(table, cbid);
+	TableRemove(&set->callbacks, cbid);
 	TableRemove(&context->callbackId, cbid);
 }
 
+void mScriptContextSetProfiling(struct mScriptContext* context, bool enable) {
+	context->profiling = enable;
+}
+
+void mScriptContextResetProfile(struct mScriptContext* context) {
+	HashTableClear(&context->profile);
+}
+
+void mScriptContextGetProfile(struct mScriptContext* context, struct mScriptProfileList* list) {
+	mScriptProfileListClear(list);
+	struct TableIterator iter;
+	if (!HashTableIteratorStart(&context->profile, &iter)) {
+		return;
+	}
+	do {
+		struct mScriptProfileEntry* entry = mScriptProfileListAppend(list);
+		*entry = *(struct mScriptProfileEntry*) HashTableIteratorGetValue(&context->profile, &iter);
+		entry->name = HashTableIteratorGetKey(&context->profile, &iter);
+	} while (HashTableIteratorNext(&context->profile, &iter));
+	qsort(mScriptProfileListGetPointer(list, 0), mScriptProfileListSize(list), sizeof(struct mScriptProfileEntry), _profileCompare);
+}
+
+void mScriptContextSetCompileCache(struct mScriptContext* context, bool enable) {
+	context->compileCache = enable;
+}
+
 void mScriptContextExportConstants(struct mScriptContext* context, const char* nspace, struct mScriptKVPair* constants) {
 	if (!context->constants) {
 		context->constants = mScriptValueAlloc(mSCRIPT_TYPE_MS_TABLE);
@@ -443,6 +596,39 @@ struct mScriptContext* mScriptActiveContext(void) {
 	return ThreadLocalGetValue(_threadContext);
 }
 
+static struct mScriptContext* _poolContext(void) {
+	int ready;
+	ATOMIC_LOAD(ready, _threadContextReady);
+	if (!ready) {
+		// The thread-local key doesn't exist until the first context is created
+		return NULL;
+	}
+	return ThreadLocalGetValue(_threadContext);
+}
+
+struct mScriptValue* mScriptContextTakeValue(void) {
+	struct mScriptContext* context = _poolContext();
+	if (!context || !context->valuePool) {
+		return NULL;
+	}
+	struct mScriptValue* value = context->valuePool;
+	context->valuePool = value->value.opaque;
+	--context->valuePoolSize;
+	return value;
+}
+
+bool mScriptContextReturnValue(struct mScriptValue* value) {
+	struct mScriptContext* context = _poolContext();
+	if (!context || context->valuePoolSize >= mSCRIPT_VALUE_POOL_MAX) {
+		return false;
+	}
+	// Values are all the same size regardless of type, so any freed value can be reused
+	value->value.opaque = context->valuePool;
+	context->valuePool = value;
+	++context->valuePoolSize;
+	return true;
+}
+
 bool mScriptContextActivate(struct mScriptContext* context) {
 	struct mScriptContext* threadContext = ThreadLocalGetValue(_threadContext);
 	if (threadContext && threadContext != context) {
@@ -471,12 +657,7 @@ void mScriptContextDeactivate(struct mScriptContext* context) {
 }
 
 bool mScriptContextInvoke(struct mScriptContext* context, const struct mScriptValue* fn, struct mScriptFrame* frame) {
-	if (!mScriptContextActivate(context)) {
-		return false;
-	}
-	bool res = mScriptInvoke(fn, frame);
-	mScriptContextDeactivate(context);
-	return res;
+	return _invoke(context, fn, frame, fn->type->name);
 }
 
 bool mScriptInvoke(const struct mScriptValue* val, struct mScriptFrame* frame) {
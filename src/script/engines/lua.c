@@ -5,14 +5,18 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/internal/script/lua.h>
 
+#include <mgba/core/config.h>
 #include <mgba/internal/script/socket.h>
 #include <mgba/script/context.h>
 #include <mgba/script/macros.h>
 #include <mgba/script/types.h>
+#include <mgba-util/sha1.h>
 #include <mgba-util/string.h>
+#include <mgba-util/vfs.h>
 
 #include <lualib.h>
 #include <lauxlib.h>
+#include <sys/stat.h>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -87,13 +91,44 @@ static const char* _socketLuaSource =
 	"    if status == 0 then return 1 end\n"
 	"    return nil, socket.ERRORS[status] or ('error#' .. status)\n"
 	"  end,\n"
+	// All open sockets are polled together once per frame instead of each one separately
+	"  _watched = {},\n"
+	"  _watch = function(sock)\n"
+	"    if not socket._set then socket._set = _socket.createSet() end\n"
+	"    if socket._set:add(sock._s) then socket._watched[sock] = true end\n"
+	"    if not socket._onframecb then\n"
+	"      socket._onframecb = callbacks:add('frame', socket._poll)\n"
+	"    end\n"
+	"  end,\n"
+	"  _unwatch = function(sock)\n"
+	"    if not socket._watched[sock] then return end\n"
+	"    socket._watched[sock] = nil\n"
+	"    socket._set:remove(sock._s)\n"
+	"    if socket._set:size() == 0 and socket._onframecb then\n"
+	"      callbacks:remove(socket._onframecb)\n"
+	"      socket._onframecb = nil\n"
+	"    end\n"
+	"  end,\n"
+	"  _poll = function()\n"
+	"    if socket._set:poll(0) <= 0 then return end\n"
+	"    local ready = {}\n"
+	"    for sock in pairs(socket._watched) do\n"
+	"      if sock._s.ready ~= 0 then ready[#ready + 1] = sock end\n"
+	"    end\n"
+	"    for _, sock in ipairs(ready) do\n"
+	"      local status = sock._s.ready\n"
+	"      if status < 0 then\n"
+	"        local _, err = socket._wrap(sock._s.error)\n"
+	"        sock:_dispatch('error', err)\n"
+	"      elseif status > 0 then\n"
+	"        sock:_dispatch('received')\n"
+	"      end\n"
+	"    end\n"
+	"  end,\n"
 	"  _mt = {\n"
 	"    __index = {\n"
 	"      close = function(self)\n"
-	"        if self._onframecb then\n"
-	"          callbacks:remove(self._onframecb)\n"
-	"          self._onframecb = nil\n"
-	"        end\n"
+	"        socket._unwatch(self)\n"
 	"        self._callbacks = {}\n"
 	"        return self._s:close()\n"
 	"      end,\n"
@@ -126,7 +161,7 @@ static const char* _socketLuaSource =
 	"    __index = {\n"
 	"      _hook = function(self, status)\n"
 	"        if status == 0 then\n"
-	"          self._onframecb = callbacks:add('frame', function() self:poll() end)\n"
+	"          socket._watch(self)\n"
 	"        end\n"
 	"        return socket._wrap(status)\n"
 	"      end,\n"
@@ -902,6 +937,136 @@ static const char* _reader(lua_State* lua, void* context, size_t* size) {
 	return reader->block;
 }
 
+#if LUA_VERSION_NUM >= 502
+// Cached scripts are stored as the magic, the key they were compiled for, a SHA-1 of the
+// bytecode and then the bytecode. Lua doesn't check bytecode before running it, so any
+// that doesn't match its digest exactly is thrown away and the source compiled instead.
+#define LUA_CACHE_MAGIC "mLUABC\x1A\x01"
+#define LUA_CACHE_MAGIC_SIZE 8
+#define LUA_CACHE_HEADER_SIZE (LUA_CACHE_MAGIC_SIZE + 40)
+
+static void _luaCachePath(const uint8_t key[20], char* out) {
+	mCoreConfigDirectory(out, PATH_MAX);
+	strncat(out, PATH_SEP "script-cache" PATH_SEP, PATH_MAX - strlen(out));
+#ifdef _WIN32
+	WCHAR wout[MAX_PATH];
+	MultiByteToWideChar(CP_UTF8, 0, out, -1, wout, MAX_PATH);
+	CreateDirectoryW(wout, NULL);
+#else
+	mkdir(out, 0755);
+#endif
+
+	char name[sizeof(LUA_NAME) + 46];
+	size_t i;
+	for (i = 0; i < 20; ++i) {
+		snprintf(&name[i * 2], 3, "%02x", key[i]);
+	}
+	strlcpy(&name[40], "." LUA_NAME "c", sizeof(name) - 40);
+	strncat(out, name, PATH_MAX - strlen(out));
+}
+
+static void _luaCacheKey(const char* name, const char* source, size_t size, uint8_t key[20]) {
+	// Bytecode is only good for the release that wrote it, and it has the chunk name built in
+	struct SHA1Context ctx;
+	sha1Init(&ctx);
+	sha1Update(&ctx, LUA_RELEASE, sizeof(LUA_RELEASE));
+	sha1Update(&ctx, name, strlen(name) + 1);
+	sha1Update(&ctx, source, size);
+	sha1Finalize(key, &ctx);
+}
+
+static bool _luaLoadCached(struct mScriptEngineContextLua* luaContext, const uint8_t key[20], const char* name) {
+	char path[PATH_MAX + 1];
+	_luaCachePath(key, path);
+	struct VFile* vf = VFileOpen(path, O_RDONLY);
+	if (!vf) {
+		return false;
+	}
+	bool ok = false;
+	ssize_t size = vf->size(vf);
+	if (size > LUA_CACHE_HEADER_SIZE) {
+		uint8_t* data = malloc(size);
+		if (vf->read(vf, data, size) == size &&
+		    memcmp(data, LUA_CACHE_MAGIC, LUA_CACHE_MAGIC_SIZE) == 0 &&
+		    memcmp(&data[LUA_CACHE_MAGIC_SIZE], key, 20) == 0) {
+			uint8_t digest[20];
+			sha1Buffer(&data[LUA_CACHE_HEADER_SIZE], size - LUA_CACHE_HEADER_SIZE, digest);
+			if (memcmp(&data[LUA_CACHE_MAGIC_SIZE + 20], digest, 20) == 0) {
+				ok = luaL_loadbufferx(luaContext->lua, (const char*) &data[LUA_CACHE_HEADER_SIZE], size - LUA_CACHE_HEADER_SIZE, name, "b") == LUA_OK;
+				if (!ok) {
+					lua_pop(luaContext->lua, 1);
+				}
+			}
+		}
+		free(data);
+	}
+	vf->close(vf);
+	return ok;
+}
+
+static int _luaCacheWriter(lua_State* lua, const void* data, size_t size, void* context) {
+	UNUSED(lua);
+	struct VFile* vf = context;
+	return vf->write(vf, data, size) == (ssize_t) size ? 0 : 1;
+}
+
+static void _luaStoreCached(struct mScriptEngineContextLua* luaContext, const uint8_t key[20]) {
+	struct VFile* bytecode = VFileMemChunk(NULL, 0);
+	if (!bytecode) {
+		return;
+	}
+#if LUA_VERSION_NUM >= 503
+	int ret = lua_dump(luaContext->lua, _luaCacheWriter, bytecode, 0);
+#else
+	int ret = lua_dump(luaContext->lua, _luaCacheWriter, bytecode);
+#endif
+	size_t size = bytecode->size(bytecode);
+	if (!ret && size) {
+		void* data = bytecode->map(bytecode, size, MAP_READ);
+		uint8_t digest[20];
+		sha1Buffer(data, size, digest);
+
+		char path[PATH_MAX + 1];
+		_luaCachePath(key, path);
+		struct VFile* vf = VFileOpen(path, O_CREAT | O_TRUNC | O_WRONLY);
+		if (vf) {
+			vf->write(vf, LUA_CACHE_MAGIC, LUA_CACHE_MAGIC_SIZE);
+			vf->write(vf, key, 20);
+			vf->write(vf, digest, 20);
+			vf->write(vf, data, size);
+			vf->close(vf);
+		}
+		bytecode->unmap(bytecode, data, size);
+	}
+	bytecode->close(bytecode);
+}
+
+static int _luaLoadWithCache(struct mScriptEngineContextLua* luaContext, struct mScriptEngineLuaReader* reader, const char* name) {
+	ssize_t size = reader->vf->size(reader->vf);
+	char* source = size > 0 ? malloc(size) : NULL;
+	if (!source) {
+		return lua_load(luaContext->lua, _reader, reader, name, "t");
+	}
+	size = reader->vf->read(reader->vf, source, size);
+	if (size < 0) {
+		free(source);
+		return LUA_ERRFILE;
+	}
+
+	uint8_t key[20];
+	_luaCacheKey(name, source, size, key);
+	int ret = LUA_OK;
+	if (!_luaLoadCached(luaContext, key, name)) {
+		ret = luaL_loadbufferx(luaContext->lua, source, size, name, "t");
+		if (ret == LUA_OK) {
+			_luaStoreCached(luaContext, key);
+		}
+	}
+	free(source);
+	return ret;
+}
+#endif
+
 void _luaError(struct mScriptEngineContextLua* luaContext) {
 	struct mScriptValue* console = mScriptContextGetGlobal(luaContext->d.context, "console");
 	struct mScriptValue error = {0};
@@ -964,7 +1129,12 @@ bool _luaLoad(struct mScriptEngineContext* ctx, const char* filename, struct VFi
 		filename = name;
 	}
 #if LUA_VERSION_NUM >= 502
-	int ret = lua_load(luaContext->lua, _reader, &data, filename, "t");
+	int ret;
+	if (ctx->context->compileCache && name[0] == '@') {
+		ret = _luaLoadWithCache(luaContext, &data, filename);
+	} else {
+		ret = lua_load(luaContext->lua, _reader, &data, filename, "t");
+	}
 #else
 	int ret = lua_load(luaContext->lua, _reader, &data, filename);
 #endif
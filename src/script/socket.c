@@ -10,15 +10,50 @@
 #include <mgba/internal/script/socket.h>
 #include <mgba/script/macros.h>
 #include <mgba-util/socket.h>
+#include <mgba-util/vector.h>
+
+#ifdef _WIN32
+#if _WIN32_WINNT >= 0x0600
+#define USE_SOCKET_POLL
+typedef WSAPOLLFD PollFD;
+#define poll WSAPoll
+#endif
+#elif !defined(GEKKO) && !defined(__3DS__) && !defined(PSP2) && !defined(__SWITCH__)
+#include <poll.h>
+#define USE_SOCKET_POLL
+typedef struct pollfd PollFD;
+#endif
 
 struct mScriptSocket {
 	Socket socket;
 	struct Address address;
 	int32_t error;
+	int32_t ready;
 	uint16_t port;
 };
 mSCRIPT_DECLARE_STRUCT(mScriptSocket);
 
+DECLARE_VECTOR(mScriptSocketList, struct mScriptSocket*);
+DEFINE_VECTOR(mScriptSocketList, struct mScriptSocket*);
+
+#ifdef USE_SOCKET_POLL
+DECLARE_VECTOR(PollFDList, PollFD);
+DEFINE_VECTOR(PollFDList, PollFD);
+#endif
+
+struct mScriptSocketSet {
+	struct mScriptSocketList sockets;
+#ifdef USE_SOCKET_POLL
+	struct PollFDList fds;
+	bool dirty;
+#else
+	Socket* reads;
+	Socket* errors;
+	size_t capacity;
+#endif
+};
+mSCRIPT_DECLARE_STRUCT(mScriptSocketSet);
+
 static const struct _mScriptSocketErrorMapping {
 	int32_t nativeError;
 	enum mSocketErrorCode mappedError;
@@ -94,6 +129,7 @@ struct mScriptValue* _mScriptSocketCreate() {
 	struct mScriptSocket client = {
 		.socket = INVALID_SOCKET,
 		.error = mSCRIPT_SOCKERR_OK,
+		.ready = 0,
 		.port = 0
 	};
 
@@ -107,7 +143,9 @@ struct mScriptValue* _mScriptSocketCreate() {
 void _mScriptSocketClose(struct mScriptSocket* ssock) {
 	if (!SOCKET_FAILED(ssock->socket)) {
 		SocketClose(ssock->socket);
+		ssock->socket = INVALID_SOCKET;
 	}
+	ssock->ready = 0;
 }
 
 struct mScriptValue* _mScriptSocketAccept(struct mScriptSocket* ssock) {
@@ -196,6 +234,174 @@ uint32_t _mScriptSocketSelectOne(struct mScriptSocket* ssock, int64_t timeoutMil
 	return 1;
 }
 
+struct mScriptValue* _mScriptSocketSetCreate(void) {
+	struct mScriptSocketSet* set = calloc(1, sizeof(*set));
+	mScriptSocketListInit(&set->sockets, 0);
+#ifdef USE_SOCKET_POLL
+	PollFDListInit(&set->fds, 0);
+#endif
+
+	struct mScriptValue* result = mScriptValueAlloc(mSCRIPT_TYPE_MS_S(mScriptSocketSet));
+	result->value.opaque = set;
+	result->flags = mSCRIPT_VALUE_FLAG_FREE_BUFFER;
+	return result;
+}
+
+static void _mScriptSocketSetDeinit(struct mScriptSocketSet* set) {
+	mScriptSocketListDeinit(&set->sockets);
+#ifdef USE_SOCKET_POLL
+	PollFDListDeinit(&set->fds);
+#else
+	free(set->reads);
+	free(set->errors);
+#endif
+}
+
+static bool _mScriptSocketSetAdd(struct mScriptSocketSet* set, struct mScriptSocket* ssock) {
+	size_t i;
+	for (i = 0; i < mScriptSocketListSize(&set->sockets); ++i) {
+		if (*mScriptSocketListGetPointer(&set->sockets, i) == ssock) {
+			return false;
+		}
+	}
+	*mScriptSocketListAppend(&set->sockets) = ssock;
+	ssock->ready = 0;
+#ifdef USE_SOCKET_POLL
+	set->dirty = true;
+#endif
+	return true;
+}
+
+static bool _mScriptSocketSetRemove(struct mScriptSocketSet* set, struct mScriptSocket* ssock) {
+	size_t i;
+	for (i = 0; i < mScriptSocketListSize(&set->sockets); ++i) {
+		if (*mScriptSocketListGetPointer(&set->sockets, i) == ssock) {
+			mScriptSocketListShift(&set->sockets, i, 1);
+#ifdef USE_SOCKET_POLL
+			set->dirty = true;
+#endif
+			return true;
+		}
+	}
+	return false;
+}
+
+static uint32_t _mScriptSocketSetSize(const struct mScriptSocketSet* set) {
+	return mScriptSocketListSize(&set->sockets);
+}
+
+static void _mScriptSocketSetPendingError(struct mScriptSocket* ssock) {
+	int err = 0;
+	socklen_t length = sizeof(err);
+	if (getsockopt(ssock->socket, SOL_SOCKET, SO_ERROR, (char*) &err, &length) < 0 || !err) {
+		err = SocketError();
+	}
+	_mScriptSocketSetError(ssock, err);
+	ssock->ready = -1;
+}
+
+// Checks every socket in the set with a single system call, leaving the result of each
+// in its ready member: 1 if it can be read from, -1 if an error occurred, and 0 otherwise
+static int32_t _mScriptSocketSetPoll(struct mScriptSocketSet* set, int64_t timeoutMillis) {
+	size_t nSockets = mScriptSocketListSize(&set->sockets);
+	size_t i;
+	for (i = 0; i < nSockets; ++i) {
+		(*mScriptSocketListGetPointer(&set->sockets, i))->ready = 0;
+	}
+	if (!nSockets) {
+		return 0;
+	}
+
+#ifdef USE_SOCKET_POLL
+	if (set->dirty) {
+		PollFDListClear(&set->fds);
+		for (i = 0; i < nSockets; ++i) {
+			PollFD* fd = PollFDListAppend(&set->fds);
+			fd->fd = (*mScriptSocketListGetPointer(&set->sockets, i))->socket;
+			fd->events = POLLIN;
+		}
+		set->dirty = false;
+	}
+	// Sockets may have been reopened since they were added, so refresh the descriptors
+	for (i = 0; i < nSockets; ++i) {
+		PollFD* fd = PollFDListGetPointer(&set->fds, i);
+		fd->fd = (*mScriptSocketListGetPointer(&set->sockets, i))->socket;
+		fd->revents = 0;
+	}
+	if (timeoutMillis > INT_MAX) {
+		timeoutMillis = INT_MAX;
+	}
+	int result = poll(PollFDListGetPointer(&set->fds, 0), nSockets, timeoutMillis < 0 ? -1 : (int) timeoutMillis);
+	if (result <= 0) {
+		return result < 0 ? -1 : 0;
+	}
+	int32_t ready = 0;
+	for (i = 0; i < nSockets; ++i) {
+		const PollFD* fd = PollFDListGetPointer(&set->fds, i);
+		struct mScriptSocket* ssock = *mScriptSocketListGetPointer(&set->sockets, i);
+		if (SOCKET_FAILED(ssock->socket) || !fd->revents) {
+			continue;
+		}
+		if (fd->revents & (POLLERR | POLLNVAL)) {
+			_mScriptSocketSetPendingError(ssock);
+		} else {
+			// Hangups read as readable so that recv reports the disconnection
+			ssock->ready = 1;
+		}
+		++ready;
+	}
+	return ready;
+#else
+	if (set->capacity < nSockets + 1) {
+		set->capacity = (nSockets + 1) * 2;
+		set->reads = realloc(set->reads, set->capacity * sizeof(Socket));
+		set->errors = realloc(set->errors, set->capacity * sizeof(Socket));
+	}
+	size_t nValid = 0;
+	for (i = 0; i < nSockets; ++i) {
+		struct mScriptSocket* ssock = *mScriptSocketListGetPointer(&set->sockets, i);
+		if (SOCKET_FAILED(ssock->socket)) {
+			continue;
+		}
+		set->reads[nValid] = ssock->socket;
+		set->errors[nValid] = ssock->socket;
+		++nValid;
+	}
+	if (!nValid) {
+		return 0;
+	}
+	set->reads[nValid] = INVALID_SOCKET;
+	set->errors[nValid] = INVALID_SOCKET;
+	int result = SocketPoll(nValid, set->reads, NULL, set->errors, timeoutMillis);
+	if (result <= 0) {
+		return result < 0 ? -1 : 0;
+	}
+	int32_t ready = 0;
+	for (i = 0; i < nSockets; ++i) {
+		struct mScriptSocket* ssock = *mScriptSocketListGetPointer(&set->sockets, i);
+		if (SOCKET_FAILED(ssock->socket)) {
+			continue;
+		}
+		size_t j;
+		for (j = 0; j < nValid && !SOCKET_FAILED(set->errors[j]); ++j) {
+			if (set->errors[j] == ssock->socket) {
+				_mScriptSocketSetPendingError(ssock);
+				break;
+			}
+		}
+		for (j = 0; j < nValid && !SOCKET_FAILED(set->reads[j]) && !ssock->ready; ++j) {
+			if (set->reads[j] == ssock->socket) {
+				ssock->ready = 1;
+			}
+		}
+		if (ssock->ready) {
+			++ready;
+		}
+	}
+	return ready;
+#endif
+}
+
 mSCRIPT_BIND_FUNCTION(mScriptSocketCreate_Binding, W(mScriptSocket), _mScriptSocketCreate, 0);
 mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptSocket, close, _mScriptSocketClose, 0);
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptSocket, W(mScriptSocket), accept, _mScriptSocketAccept, 0);
@@ -251,20 +457,59 @@ mSCRIPT_DEFINE_STRUCT(mScriptSocket)
 		"One of the C.SOCKERR constants describing the last error on the socket."
 	)
 	mSCRIPT_DEFINE_STRUCT_MEMBER(mScriptSocket, S32, error)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"The result of the last struct::SocketSet.poll that included this socket: "
+		"1 if data is available to be read, -1 if an error has occurred, and 0 otherwise."
+	)
+	mSCRIPT_DEFINE_STRUCT_MEMBER(mScriptSocket, S32, ready)
 mSCRIPT_DEFINE_END;
 
 mSCRIPT_DEFINE_STRUCT_BINDING_DEFAULTS(mScriptSocket, listen)
 	mSCRIPT_S32(1)
 mSCRIPT_DEFINE_DEFAULTS_END;
 
+mSCRIPT_BIND_FUNCTION(mScriptSocketSetCreate_Binding, W(mScriptSocketSet), _mScriptSocketSetCreate, 0);
+mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptSocketSet, _deinit, _mScriptSocketSetDeinit, 0);
+mSCRIPT_DECLARE_STRUCT_METHOD(mScriptSocketSet, BOOL, add, _mScriptSocketSetAdd, 1, S(mScriptSocket), socket);
+mSCRIPT_DECLARE_STRUCT_METHOD(mScriptSocketSet, BOOL, remove, _mScriptSocketSetRemove, 1, S(mScriptSocket), socket);
+mSCRIPT_DECLARE_STRUCT_C_METHOD(mScriptSocketSet, U32, size, _mScriptSocketSetSize, 0);
+mSCRIPT_DECLARE_STRUCT_METHOD_WITH_DEFAULTS(mScriptSocketSet, S32, poll, _mScriptSocketSetPoll, 1, S64, timeoutMillis);
+
+mSCRIPT_DEFINE_STRUCT(mScriptSocketSet)
+	mSCRIPT_DEFINE_INTERNAL
+	mSCRIPT_DEFINE_CLASS_DOCSTRING(
+		"An internal set of sockets whose readiness is checked together. "
+		"The set does not keep its sockets alive, so sockets must be removed before they are freed."
+	)
+	mSCRIPT_DEFINE_STRUCT_DEINIT(mScriptSocketSet)
+	mSCRIPT_DEFINE_DOCSTRING("Adds a socket to the set. Returns false if it was already in the set.")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptSocketSet, add)
+	mSCRIPT_DEFINE_DOCSTRING("Removes a socket from the set. Returns false if it was not in the set.")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptSocketSet, remove)
+	mSCRIPT_DEFINE_DOCSTRING("Returns the number of sockets in the set.")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptSocketSet, size)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Checks the status of every socket in the set at once, waiting up to the timeout for one to become ready. "
+		"Returns the number of sockets that are ready, or -1 if polling failed. "
+		"The status of each socket is left in its struct::Socket.ready member."
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptSocketSet, poll)
+mSCRIPT_DEFINE_END;
+
+mSCRIPT_DEFINE_STRUCT_BINDING_DEFAULTS(mScriptSocketSet, poll)
+	mSCRIPT_S64(0)
+mSCRIPT_DEFINE_DEFAULTS_END;
+
 
 void mScriptContextAttachSocket(struct mScriptContext* context) {
 	mScriptContextExportNamespace(context, "_socket", (struct mScriptKVPair[]) {
 		mSCRIPT_KV_PAIR(create, &mScriptSocketCreate_Binding),
+		mSCRIPT_KV_PAIR(createSet, &mScriptSocketSetCreate_Binding),
 		mSCRIPT_KV_SENTINEL
 	});
 	mScriptContextSetDocstring(context, "_socket", "Basic TCP sockets library");
 	mScriptContextSetDocstring(context, "_socket.create", "Creates a new socket object");
+	mScriptContextSetDocstring(context, "_socket.createSet", "Creates a new set of sockets to poll together");
 	mScriptContextExportConstants(context, "SOCKERR", (struct mScriptKVPair[]) {
 		mSCRIPT_CONSTANT_PAIR(mSCRIPT_SOCKERR, UNKNOWN_ERROR),
 		mSCRIPT_CONSTANT_PAIR(mSCRIPT_SOCKERR, OK),
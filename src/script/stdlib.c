@@ -46,6 +46,96 @@ mSCRIPT_DECLARE_STRUCT_METHOD(mScriptCallbackManager, U32, add, _mScriptCallback
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptCallbackManager, U32, oneshot, _mScriptCallbackOneshot, 2, STR, callback, WRAPPER, function);
 mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptCallbackManager, remove, _mScriptCallbackRemove, 1, U32, cbid);
 
+struct mScriptProfiler {
+	struct mScriptContext* context;
+};
+
+static void _mScriptProfilerStart(struct mScriptProfiler* profiler) {
+	mScriptContextSetProfiling(profiler->context, true);
+}
+
+static void _mScriptProfilerStop(struct mScriptProfiler* profiler) {
+	mScriptContextSetProfiling(profiler->context, false);
+}
+
+static void _mScriptProfilerReset(struct mScriptProfiler* profiler) {
+	mScriptContextResetProfile(profiler->context);
+}
+
+static bool _mScriptProfilerIsRunning(const struct mScriptProfiler* profiler) {
+	return profiler->context->profiling;
+}
+
+static void _mScriptProfilerSetField(struct mScriptValue* table, const char* key, struct mScriptValue* value) {
+	struct mScriptValue* keyValue = mScriptStringCreateFromUTF8(key);
+	mScriptTableInsert(table, keyValue, value);
+	mScriptValueDeref(keyValue);
+	mScriptValueDeref(value);
+}
+
+static struct mScriptValue* _mScriptProfilerCreateU64(uint64_t value) {
+	struct mScriptValue* result = mScriptValueAlloc(mSCRIPT_TYPE_MS_U64);
+	result->value.u64 = value;
+	return result;
+}
+
+static struct mScriptValue* _mScriptProfilerStats(struct mScriptProfiler* profiler) {
+	struct mScriptProfileList entries;
+	mScriptProfileListInit(&entries, 0);
+	mScriptContextGetProfile(profiler->context, &entries);
+
+	struct mScriptValue* list = mScriptValueAlloc(mSCRIPT_TYPE_MS_LIST);
+	size_t i;
+	for (i = 0; i < mScriptProfileListSize(&entries); ++i) {
+		const struct mScriptProfileEntry* entry = mScriptProfileListGetConstPointer(&entries, i);
+		struct mScriptValue* table = mScriptValueAlloc(mSCRIPT_TYPE_MS_TABLE);
+		_mScriptProfilerSetField(table, "name", mScriptStringCreateFromUTF8(entry->name));
+		_mScriptProfilerSetField(table, "calls", _mScriptProfilerCreateU64(entry->calls));
+		_mScriptProfilerSetField(table, "totalUsec", _mScriptProfilerCreateU64(entry->totalNsec / 1000));
+		_mScriptProfilerSetField(table, "maxUsec", _mScriptProfilerCreateU64(entry->maxNsec / 1000));
+		// The list takes over the reference to the table
+		mScriptValueWrap(table, mScriptListAppend(list->value.list));
+	}
+	mScriptProfileListDeinit(&entries);
+	return list;
+}
+
+static struct mScriptValue* _mScriptProfilerReport(struct mScriptProfiler* profiler) {
+	struct mScriptProfileList entries;
+	mScriptProfileListInit(&entries, 0);
+	mScriptContextGetProfile(profiler->context, &entries);
+
+	size_t size = 0;
+	size_t capacity = 128 + mScriptProfileListSize(&entries) * 96;
+	char* buffer = malloc(capacity);
+	size += snprintf(buffer, capacity, "%10s %12s %10s %10s  %s\n", "calls", "total (ms)", "avg (us)", "max (us)", "name");
+	size_t i;
+	for (i = 0; i < mScriptProfileListSize(&entries); ++i) {
+		const struct mScriptProfileEntry* entry = mScriptProfileListGetConstPointer(&entries, i);
+		size_t needed = strlen(entry->name) + 64;
+		if (size + needed > capacity) {
+			capacity = (size + needed) * 2;
+			buffer = realloc(buffer, capacity);
+		}
+		size += snprintf(&buffer[size], capacity - size, "%10" PRIu64 " %12.3f %10.1f %10.1f  %s\n",
+		                 entry->calls, entry->totalNsec / 1e6, entry->totalNsec / 1e3 / entry->calls,
+		                 entry->maxNsec / 1e3, entry->name);
+	}
+	mScriptProfileListDeinit(&entries);
+
+	struct mScriptValue* report = mScriptStringCreateFromBytes(buffer, size);
+	free(buffer);
+	return report;
+}
+
+mSCRIPT_DECLARE_STRUCT(mScriptProfiler);
+mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptProfiler, start, _mScriptProfilerStart, 0);
+mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptProfiler, stop, _mScriptProfilerStop, 0);
+mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptProfiler, reset, _mScriptProfilerReset, 0);
+mSCRIPT_DECLARE_STRUCT_C_METHOD(mScriptProfiler, BOOL, isRunning, _mScriptProfilerIsRunning, 0);
+mSCRIPT_DECLARE_STRUCT_METHOD(mScriptProfiler, WLIST, stats, _mScriptProfilerStats, 0);
+mSCRIPT_DECLARE_STRUCT_METHOD(mScriptProfiler, WSTR, report, _mScriptProfilerReport, 0);
+
 static uint64_t mScriptMakeBitmask(struct mScriptList* list) {
 	size_t i;
 	uint64_t mask = 0;
@@ -101,6 +191,30 @@ mSCRIPT_DEFINE_STRUCT(mScriptCallbackManager)
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCallbackManager, remove)
 mSCRIPT_DEFINE_END;
 
+mSCRIPT_DEFINE_STRUCT(mScriptProfiler)
+	mSCRIPT_DEFINE_CLASS_DOCSTRING(
+		"A global singleton object `profiler` that measures how long callbacks and API functions take. "
+		"Each callback is tracked separately as `callback::<name>#<id>`, where the id is the one returned by "
+		"struct::mScriptCallbackManager.add. Times are inclusive, so the time spent in a callback also counts "
+		"the API functions it calls."
+	)
+	mSCRIPT_DEFINE_DOCSTRING("Start recording calls")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptProfiler, start)
+	mSCRIPT_DEFINE_DOCSTRING("Stop recording calls. The data recorded so far is kept")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptProfiler, stop)
+	mSCRIPT_DEFINE_DOCSTRING("Discard all of the data recorded so far")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptProfiler, reset)
+	mSCRIPT_DEFINE_DOCSTRING("Check if calls are currently being recorded")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptProfiler, isRunning)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Get a list of tables with the fields `name`, `calls`, `totalUsec` and `maxUsec`, "
+		"sorted with the most expensive entries first"
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptProfiler, stats)
+	mSCRIPT_DEFINE_DOCSTRING("Get a human-readable report of the recorded data, suitable for printing to the console")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptProfiler, report)
+mSCRIPT_DEFINE_END;
+
 static struct mScriptValue* _mRectangleNew(int32_t x, int32_t y, int32_t width, int32_t height) {
 	struct mRectangle* rect = malloc(sizeof(*rect));
 	rect->x = x;
@@ -207,6 +321,15 @@ void mScriptContextAttachStdlib(struct mScriptContext* context) {
 	mScriptContextSetGlobal(context, "callbacks", lib);
 	mScriptContextSetDocstring(context, "callbacks", "Singleton instance of struct::mScriptCallbackManager");
 
+	lib = mScriptValueAlloc(mSCRIPT_TYPE_MS_S(mScriptProfiler));
+	lib->value.opaque = calloc(1, sizeof(struct mScriptProfiler));
+	*(struct mScriptProfiler*) lib->value.opaque = (struct mScriptProfiler) {
+		.context = context
+	};
+	lib->flags = mSCRIPT_VALUE_FLAG_FREE_BUFFER;
+	mScriptContextSetGlobal(context, "profiler", lib);
+	mScriptContextSetDocstring(context, "profiler", "Singleton instance of struct::mScriptProfiler");
+
 	mScriptContextExportConstants(context, "SAVESTATE", (struct mScriptKVPair[]) {
 		mSCRIPT_CONSTANT_PAIR(SAVESTATE, SCREENSHOT),
 		mSCRIPT_CONSTANT_PAIR(SAVESTATE, SAVEDATA),
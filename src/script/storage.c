@@ -6,22 +6,44 @@
 #include <mgba/script/storage.h>
 
 #include <mgba/core/config.h>
+#include <mgba-util/threading.h>
 #include <mgba-util/vfs.h>
 
 #include <json.h>
 #include <sys/stat.h>
+#ifndef _WIN32
+#include <sys/time.h>
+#endif
 
 #define STORAGE_LEN_MAX 64
 
+// Automatic flushes wait this long after a bucket first changes, so that frequent
+// updates get written out together
+#define STORAGE_FLUSH_LATENCY_MS 1000
+
+struct mScriptStorageContext;
+
 struct mScriptStorageBucket {
+	struct mScriptStorageContext* storage;
 	char* name;
 	struct mScriptValue* root;
 	bool autoflush;
 	bool dirty;
+	uint64_t dirtySince;
 };
 
 struct mScriptStorageContext {
 	struct Table buckets;
+#ifndef DISABLE_THREADING
+	// Serialized buckets waiting for the writer thread, by bucket name
+	struct Table pending;
+	Mutex mutex;
+	// Held while a bucket file is being replaced, so that writes land in order
+	Mutex writeMutex;
+	Condition pendingAvailable;
+	Thread writer;
+	bool running;
+#endif
 };
 
 void mScriptStorageBucketDeinit(void*);
@@ -112,6 +134,31 @@ struct mScriptValue* mScriptStorageBucketGet(struct mScriptStorageBucket* bucket
 	return val;
 }
 
+static uint64_t _storageNow(void) {
+#ifdef _WIN32
+	LARGE_INTEGER counter;
+	LARGE_INTEGER frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return (counter.QuadPart / frequency.QuadPart) * UINT64_C(1000) + (counter.QuadPart % frequency.QuadPart) * UINT64_C(1000) / frequency.QuadPart;
+#elif defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * UINT64_C(1000) + ts.tv_nsec / 1000000;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec * UINT64_C(1000) + tv.tv_usec / 1000;
+#endif
+}
+
+static void _markDirty(struct mScriptStorageBucket* bucket) {
+	if (!bucket->dirty) {
+		bucket->dirty = true;
+		bucket->dirtySince = _storageNow();
+	}
+}
+
 void mScriptStorageBucketSet(struct mScriptStorageBucket* bucket, const char* key, struct mScriptValue* value) {
 	struct mScriptValue* vkey = mScriptStringCreateFromUTF8(key);
 	if (value->type->base == mSCRIPT_TYPE_WRAPPER) {
@@ -119,7 +166,7 @@ void mScriptStorageBucketSet(struct mScriptStorageBucket* bucket, const char* ke
 	}
 	mScriptTableInsert(bucket->root, vkey, value);
 	mScriptValueDeref(vkey);
-	bucket->dirty = true;
+	_markDirty(bucket);
 }
 
 void mScriptStorageBucketSetVoid(struct mScriptStorageBucket* bucket, const char* key, struct mScriptValue* value) {
@@ -127,7 +174,7 @@ void mScriptStorageBucketSetVoid(struct mScriptStorageBucket* bucket, const char
 	struct mScriptValue* vkey = mScriptStringCreateFromUTF8(key);
 	mScriptTableInsert(bucket->root, vkey, &mScriptValueNull);
 	mScriptValueDeref(vkey);
-	bucket->dirty = true;
+	_markDirty(bucket);
 }
 
 #define MAKE_SCALAR_SETTER(NAME, TYPE) \
@@ -138,7 +185,7 @@ void mScriptStorageBucketSetVoid(struct mScriptStorageBucket* bucket, const char
 		mScriptTableInsert(bucket->root, vkey, vval); \
 		mScriptValueDeref(vkey); \
 		mScriptValueDeref(vval); \
-		bucket->dirty = true; \
+		_markDirty(bucket); \
 	}
 
 MAKE_SCALAR_SETTER(SInt, S64)
@@ -279,17 +326,24 @@ bool mScriptStorageToJson(struct mScriptValue* value, struct json_object** out)
 #define JSON_C_TO_STRING_PRETTY_TAB 0
 #endif
 
-static bool _mScriptStorageBucketFlushVF(struct mScriptStorageBucket* bucket, struct VFile* vf) {
+static char* _mScriptStorageBucketSerialize(struct mScriptStorageBucket* bucket) {
 	struct json_object* rootObj;
-	bool ok = mScriptStorageToJson(bucket->root, &rootObj);
-	if (!ok) {
-		vf->close(vf);
-		return false;
+	if (!mScriptStorageToJson(bucket->root, &rootObj)) {
+		return NULL;
 	}
 
 	const char* json = json_object_to_json_string_ext(rootObj, JSON_C_TO_STRING_PRETTY | JSON_C_TO_STRING_PRETTY_TAB);
+	char* copy = NULL;
+	if (json) {
+		copy = strdup(json);
+	}
+	json_object_put(rootObj);
+	return copy;
+}
+
+static bool _mScriptStorageBucketFlushVF(struct mScriptStorageBucket* bucket, struct VFile* vf) {
+	char* json = _mScriptStorageBucketSerialize(bucket);
 	if (!json) {
-		json_object_put(rootObj);
 		vf->close(vf);
 		return false;
 	}
@@ -299,20 +353,136 @@ static bool _mScriptStorageBucketFlushVF(struct mScriptStorageBucket* bucket, st
 
 	bucket->dirty = false;
 
-	json_object_put(rootObj);
+	free(json);
 	return true;
 }
 
-bool mScriptStorageBucketFlush(struct mScriptStorageBucket* bucket) {
+static bool _mScriptStorageWriteFile(const char* bucketName, const char* json) {
 	char path[PATH_MAX];
-	mScriptStorageGetBucketPath(bucket->name, path);
-	struct VFile* vf = VFileOpen(path, O_WRONLY | O_CREAT | O_TRUNC);
+	char tmpPath[PATH_MAX + 4];
+	mScriptStorageGetBucketPath(bucketName, path);
+	snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+
+	// Write the whole file out before replacing the old one, so that the old contents
+	// are kept if writing fails partway through
+	struct VFile* vf = VFileOpen(tmpPath, O_WRONLY | O_CREAT | O_TRUNC);
 	if (!vf) {
 		return false;
 	}
-	return _mScriptStorageBucketFlushVF(bucket, vf);
+	size_t size = strlen(json);
+	bool ok = vf->write(vf, json, size) == (ssize_t) size;
+	vf->close(vf);
+	if (ok) {
+#ifdef _WIN32
+		WCHAR wpath[MAX_PATH];
+		WCHAR wtmpPath[MAX_PATH];
+		MultiByteToWideChar(CP_UTF8, 0, path, -1, wpath, MAX_PATH);
+		MultiByteToWideChar(CP_UTF8, 0, tmpPath, -1, wtmpPath, MAX_PATH);
+		ok = MoveFileExW(wtmpPath, wpath, MOVEFILE_REPLACE_EXISTING);
+#else
+		ok = rename(tmpPath, path) == 0;
+#endif
+	}
+	if (!ok) {
+		remove(tmpPath);
+	}
+	return ok;
 }
 
+bool mScriptStorageBucketFlush(struct mScriptStorageBucket* bucket) {
+	char* json = _mScriptStorageBucketSerialize(bucket);
+	if (!json) {
+		return false;
+	}
+#ifndef DISABLE_THREADING
+	struct mScriptStorageContext* storage = bucket->storage;
+	MutexLock(&storage->mutex);
+	// Anything still waiting to be written is older than this
+	free(HashTableLookup(&storage->pending, bucket->name));
+	HashTableRemove(&storage->pending, bucket->name);
+	MutexLock(&storage->writeMutex);
+	MutexUnlock(&storage->mutex);
+#endif
+	bool ok = _mScriptStorageWriteFile(bucket->name, json);
+#ifndef DISABLE_THREADING
+	MutexUnlock(&storage->writeMutex);
+#endif
+	free(json);
+	if (ok) {
+		bucket->dirty = false;
+	}
+	return ok;
+}
+
+static void _mScriptStorageBucketQueueFlush(struct mScriptStorageBucket* bucket) {
+#ifndef DISABLE_THREADING
+	char* json = _mScriptStorageBucketSerialize(bucket);
+	if (!json) {
+		return;
+	}
+	struct mScriptStorageContext* storage = bucket->storage;
+	MutexLock(&storage->mutex);
+	// If the previous flush hasn't been written yet, it's replaced instead of written twice
+	free(HashTableLookup(&storage->pending, bucket->name));
+	HashTableInsert(&storage->pending, bucket->name, json);
+	ConditionWake(&storage->pendingAvailable);
+	MutexUnlock(&storage->mutex);
+	bucket->dirty = false;
+#else
+	mScriptStorageBucketFlush(bucket);
+#endif
+}
+
+static void _mScriptStorageWritePending(struct mScriptStorageContext* storage, const char* bucketName) {
+#ifndef DISABLE_THREADING
+	MutexLock(&storage->mutex);
+	char* json = HashTableLookup(&storage->pending, bucketName);
+	HashTableRemove(&storage->pending, bucketName);
+	MutexLock(&storage->writeMutex);
+	MutexUnlock(&storage->mutex);
+	if (json) {
+		_mScriptStorageWriteFile(bucketName, json);
+		free(json);
+	}
+	MutexUnlock(&storage->writeMutex);
+#else
+	UNUSED(storage);
+	UNUSED(bucketName);
+#endif
+}
+
+#ifndef DISABLE_THREADING
+static THREAD_ENTRY _mScriptStorageWriteThread(void* context) {
+	struct mScriptStorageContext* storage = context;
+	ThreadSetName("Script Storage");
+	MutexLock(&storage->mutex);
+	while (true) {
+		struct TableIterator iter;
+		if (!HashTableIteratorStart(&storage->pending, &iter)) {
+			if (!storage->running) {
+				break;
+			}
+			ConditionWait(&storage->pendingAvailable, &storage->mutex);
+			continue;
+		}
+		char* name = strdup(HashTableIteratorGetKey(&storage->pending, &iter));
+		char* json = HashTableIteratorGetValue(&storage->pending, &iter);
+		HashTableRemove(&storage->pending, name);
+		MutexLock(&storage->writeMutex);
+		MutexUnlock(&storage->mutex);
+
+		_mScriptStorageWriteFile(name, json);
+		free(name);
+		free(json);
+
+		MutexUnlock(&storage->writeMutex);
+		MutexLock(&storage->mutex);
+	}
+	MutexUnlock(&storage->mutex);
+	THREAD_EXIT(0);
+}
+#endif
+
 void mScriptStorageBucketEnableAutoFlush(struct mScriptStorageBucket* bucket, bool enable) {
 	bucket->autoflush = enable;
 }
@@ -329,13 +499,16 @@ bool mScriptStorageSaveBucketVF(struct mScriptContext* context, const char* buck
 }
 
 bool mScriptStorageSaveBucket(struct mScriptContext* context, const char* bucketName) {
-	char path[PATH_MAX];
-	mScriptStorageGetBucketPath(bucketName, path);
-	struct VFile* vf = VFileOpen(path, O_WRONLY | O_CREAT | O_TRUNC);
-	if (!vf) {
+	struct mScriptValue* value = mScriptContextGetGlobal(context, "storage");
+	if (!value) {
+		return false;
+	}
+	struct mScriptStorageContext* storage = value->value.opaque;
+	struct mScriptStorageBucket* bucket = mScriptStorageGetBucket(storage, bucketName);
+	if (!bucket) {
 		return false;
 	}
-	return mScriptStorageSaveBucketVF(context, bucketName, vf);
+	return mScriptStorageBucketFlush(bucket);
 }
 
 struct mScriptValue* mScriptStorageFromJson(struct json_object* json) {
@@ -421,6 +594,8 @@ static struct mScriptValue* _mScriptStorageLoadJson(struct VFile* vf) {
 }
 
 bool mScriptStorageBucketReload(struct mScriptStorageBucket* bucket) {
+	// Make sure the file on disk isn't missing a flush that's still in progress
+	_mScriptStorageWritePending(bucket->storage, bucket->name);
 	char path[PATH_MAX];
 	mScriptStorageGetBucketPath(bucket->name, path);
 	struct VFile* vf = VFileOpen(path, O_RDONLY);
@@ -478,6 +653,14 @@ void mScriptContextAttachStorage(struct mScriptContext* context) {
 	value->value.opaque = storage;
 
 	HashTableInit(&storage->buckets, 0, mScriptStorageBucketDeinit);
+#ifndef DISABLE_THREADING
+	HashTableInit(&storage->pending, 0, NULL);
+	MutexInit(&storage->mutex);
+	MutexInit(&storage->writeMutex);
+	ConditionInit(&storage->pendingAvailable);
+	storage->running = true;
+	ThreadCreate(&storage->writer, _mScriptStorageWriteThread, storage);
+#endif
 
 	mScriptContextSetGlobal(context, "storage", value);
 	mScriptContextSetDocstring(context, "storage", "Singleton instance of struct::mScriptStorageContext");
@@ -492,8 +675,38 @@ void mScriptStorageFlushAll(struct mScriptContext* context) {
 	mScriptStorageContextFlushAll(storage);
 }
 
+void mScriptStorageFlushPending(struct mScriptContext* context) {
+	struct mScriptValue* value = mScriptContextGetGlobal(context, "storage");
+	if (!value) {
+		return;
+	}
+	struct mScriptStorageContext* storage = value->value.opaque;
+	uint64_t now = _storageNow();
+	struct TableIterator iter;
+	if (HashTableIteratorStart(&storage->buckets, &iter)) {
+		do {
+			struct mScriptStorageBucket* bucket = HashTableIteratorGetValue(&storage->buckets, &iter);
+			if (bucket->autoflush && bucket->dirty && now - bucket->dirtySince >= STORAGE_FLUSH_LATENCY_MS) {
+				_mScriptStorageBucketQueueFlush(bucket);
+			}
+		} while (HashTableIteratorNext(&storage->buckets, &iter));
+	}
+}
+
 void mScriptStorageContextDeinit(struct mScriptStorageContext* storage) {
 	HashTableDeinit(&storage->buckets);
+#ifndef DISABLE_THREADING
+	MutexLock(&storage->mutex);
+	storage->running = false;
+	ConditionWake(&storage->pendingAvailable);
+	MutexUnlock(&storage->mutex);
+	// The writer finishes everything that's still pending before exiting
+	ThreadJoin(&storage->writer);
+	HashTableDeinit(&storage->pending);
+	ConditionDeinit(&storage->pendingAvailable);
+	MutexDeinit(&storage->writeMutex);
+	MutexDeinit(&storage->mutex);
+#endif
 }
 
 void mScriptStorageContextFlushAll(struct mScriptStorageContext* storage) {
@@ -537,6 +750,7 @@ struct mScriptStorageBucket* mScriptStorageGetBucket(struct mScriptStorageContex
 	}
 
 	bucket = calloc(1, sizeof(*bucket));
+	bucket->storage = storage;
 	bucket->name = strdup(name);
 	bucket->autoflush = true;
 	if (!mScriptStorageBucketReload(bucket)) {
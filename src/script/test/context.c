@@ -94,8 +94,145 @@ M_TEST_DEFINE(disownWeakref) {
 	mScriptContextDeinit(&context);
 }
 
+static int32_t callbackTotal;
+static struct mScriptCallbackSet* nestedSet;
+static struct mScriptList* nestedArgs;
+
+static void _addToTotal(int32_t amount) {
+	callbackTotal += amount;
+}
+
+static void _retrigger(int32_t amount) {
+	callbackTotal += amount;
+	if (callbackTotal == amount) {
+		mScriptContextTriggerCallbackSet(nestedSet, nestedArgs);
+	}
+}
+
+mSCRIPT_BIND_VOID_FUNCTION(boundAddToTotal, _addToTotal, 1, S32, amount);
+mSCRIPT_BIND_VOID_FUNCTION(boundRetrigger, _retrigger, 1, S32, amount);
+
+M_TEST_DEFINE(resolvedCallbacks) {
+	struct mScriptContext context;
+	mScriptContextInit(&context);
+
+	struct mScriptList args;
+	mScriptListInit(&args, 1);
+	*mScriptListAppend(&args) = mSCRIPT_MAKE_S32(2);
+
+	struct mScriptCallbackSet* set = mScriptContextResolveCallback(&context, "test");
+	assert_non_null(set);
+	assert_ptr_equal(mScriptContextResolveCallback(&context, "test"), set);
+
+	callbackTotal = 0;
+	mScriptContextTriggerCallbackSet(set, &args);
+	assert_int_equal(callbackTotal, 0);
+
+	uint32_t cbid = mScriptContextAddCallback(&context, "test", &boundAddToTotal);
+	assert_int_not_equal(cbid, 0);
+	assert_int_not_equal(mScriptContextAddOneshot(&context, "test", &boundAddToTotal), 0);
+
+	mScriptContextTriggerCallbackSet(set, &args);
+	assert_int_equal(callbackTotal, 4);
+	mScriptContextTriggerCallback(&context, "test", &args);
+	assert_int_equal(callbackTotal, 6);
+
+	mScriptContextRemoveCallback(&context, cbid);
+	mScriptContextTriggerCallbackSet(set, &args);
+	assert_int_equal(callbackTotal, 6);
+
+	callbackTotal = 0;
+	nestedSet = mScriptContextResolveCallback(&context, "nested");
+	nestedArgs = &args;
+	mScriptContextAddCallback(&context, "nested", &boundRetrigger);
+	mScriptContextTriggerCallbackSet(nestedSet, &args);
+	assert_int_equal(callbackTotal, 4);
+
+	mScriptListDeinit(&args);
+	mScriptContextDeinit(&context);
+}
+
+M_TEST_DEFINE(recycleValues) {
+	struct mScriptContext context;
+	mScriptContextInit(&context);
+
+	struct mScriptValue* val = mScriptValueAlloc(mSCRIPT_TYPE_MS_S32);
+	mScriptValueDeref(val);
+	assert_int_equal(context.valuePoolSize, 0);
+
+	assert_true(mScriptContextActivate(&context));
+	val = mScriptValueAlloc(mSCRIPT_TYPE_MS_S32);
+	mScriptValueDeref(val);
+	assert_int_equal(context.valuePoolSize, 1);
+
+	struct mScriptValue* reused = mScriptValueAlloc(mSCRIPT_TYPE_MS_U32);
+	assert_ptr_equal(reused, val);
+	assert_int_equal(context.valuePoolSize, 0);
+	assert_int_equal(reused->refs, 1);
+	assert_int_equal(reused->flags, 0);
+	assert_ptr_equal(reused->type, mSCRIPT_TYPE_MS_U32);
+	mScriptValueDeref(reused);
+	mScriptContextDeactivate(&context);
+
+	assert_int_equal(context.valuePoolSize, 1);
+	mScriptContextDeinit(&context);
+}
+
+M_TEST_DEFINE(profileCallbacks) {
+	struct mScriptContext context;
+	mScriptContextInit(&context);
+
+	struct mScriptList args;
+	mScriptListInit(&args, 1);
+	*mScriptListAppend(&args) = mSCRIPT_MAKE_S32(1);
+
+	uint32_t cbid = mScriptContextAddCallback(&context, "test", &boundAddToTotal);
+	struct mScriptProfileList entries;
+	mScriptProfileListInit(&entries, 0);
+
+	callbackTotal = 0;
+	mScriptContextTriggerCallback(&context, "test", &args);
+	mScriptContextGetProfile(&context, &entries);
+	assert_int_equal(mScriptProfileListSize(&entries), 0);
+
+	mScriptContextSetProfiling(&context, true);
+	mScriptContextTriggerCallback(&context, "test", &args);
+	mScriptContextTriggerCallback(&context, "test", &args);
+	assert_int_equal(callbackTotal, 3);
+
+	char name[32];
+	snprintf(name, sizeof(name), "callback::test#%u", cbid);
+	mScriptContextGetProfile(&context, &entries);
+	assert_int_equal(mScriptProfileListSize(&entries), 1);
+	struct mScriptProfileEntry* entry = mScriptProfileListGetPointer(&entries, 0);
+	assert_string_equal(entry->name, name);
+	assert_int_equal(entry->calls, 2);
+	assert_true(entry->totalNsec >= entry->maxNsec);
+
+	struct mScriptFrame frame;
+	mScriptFrameInit(&frame);
+	mSCRIPT_PUSH(&frame.stack, S32, 1);
+	assert_true(mScriptContextInvoke(&context, &boundAddToTotal, &frame));
+	mScriptFrameDeinit(&frame);
+	mScriptContextGetProfile(&context, &entries);
+	assert_int_equal(mScriptProfileListSize(&entries), 2);
+
+	mScriptContextSetProfiling(&context, false);
+	mScriptContextResetProfile(&context);
+	mScriptContextTriggerCallback(&context, "test", &args);
+	mScriptContextGetProfile(&context, &entries);
+	assert_int_equal(mScriptProfileListSize(&entries), 0);
+
+	mScriptProfileListDeinit(&entries);
+	mScriptListDeinit(&args);
+	mScriptContextDeinit(&context);
+}
+
 M_TEST_SUITE_DEFINE(mScript,
 	cmocka_unit_test(weakrefBasic),
 	cmocka_unit_test(drainPool),
 	cmocka_unit_test(disownWeakref),
+	cmocka_unit_test(resolvedCallbacks),
+	cmocka_unit_test(recycleValues),
+	cmocka_unit_test(profileCallbacks),
 )
@@ -531,13 +531,13 @@ M_TEST_DEFINE(autoflush) {
 	TEST_PROGRAM("bucket:enableAutoFlush(true)")
 	TEST_PROGRAM("bucket.a = 1");
 	TEST_PROGRAM("storage:flushAll()");
-	TEST_PROGRAM("assert(bucket:reload())")
+	TEST_PROGRAM("assert(bucket:reload())");
 	TEST_PROGRAM("assert(bucket.a == 1)");
 
 	TEST_PROGRAM("bucket:enableAutoFlush(false)")
 	TEST_PROGRAM("bucket.a = 2");
 	TEST_PROGRAM("storage:flushAll()");
-	TEST_PROGRAM("assert(bucket:reload())")
+	TEST_PROGRAM("assert(bucket:reload())");
 	TEST_PROGRAM("assert(bucket.a == 1)");
 
 	TEST_PROGRAM("bucket:enableAutoFlush(false)")
@@ -545,12 +545,55 @@ M_TEST_DEFINE(autoflush) {
 	TEST_PROGRAM("storage:flushAll()");
 	TEST_PROGRAM("bucket:enableAutoFlush(true)")
 	TEST_PROGRAM("storage:flushAll()");
-	TEST_PROGRAM("assert(bucket:reload())")
+	TEST_PROGRAM("assert(bucket:reload())");
 	TEST_PROGRAM("assert(bucket.a == 3)");
 
 	mScriptContextDeinit(&context);
 }
 
+M_TEST_DEFINE(flushPending) {
+	SETUP_LUA;
+
+	TEST_PROGRAM("bucket = storage:getBucket('xtest')");
+	TEST_PROGRAM("assert(bucket)");
+	TEST_PROGRAM("assert(not bucket.a)");
+
+	// Changes are held back for a while so that quick successive updates get coalesced
+	TEST_PROGRAM("bucket.a = 1");
+	mScriptStorageFlushPending(&context);
+	TEST_PROGRAM("assert(not bucket:reload())");
+	TEST_PROGRAM("assert(bucket.a == 1)");
+
+	mScriptStorageFlushAll(&context);
+	TEST_PROGRAM("bucket.a = 2");
+	TEST_PROGRAM("assert(bucket:reload())");
+	TEST_PROGRAM("assert(bucket.a == 1)");
+
+	mScriptContextDeinit(&context);
+}
+
+M_TEST_DEFINE(flushOnDeinit) {
+	SETUP_LUA;
+
+	TEST_PROGRAM("bucket = storage:getBucket('xtest')");
+	TEST_PROGRAM("assert(bucket)");
+	TEST_PROGRAM("assert(not bucket.a)");
+	TEST_PROGRAM("bucket.a = 1");
+
+	mScriptContextDeinit(&context);
+
+	mScriptContextInit(&context);
+	lua = mScriptContextRegisterEngine(&context, mSCRIPT_ENGINE_LUA);
+	mScriptContextAttachStdlib(&context);
+	mScriptContextAttachStorage(&context);
+
+	TEST_PROGRAM("bucket = storage:getBucket('xtest')");
+	TEST_PROGRAM("assert(bucket)");
+	TEST_PROGRAM("assert(bucket.a == 1)");
+
+	mScriptContextDeinit(&context);
+}
+
 M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(mScriptStorage,
 	cmocka_unit_test(basicInt),
 	cmocka_unit_test(basicFloat),
@@ -581,4 +624,6 @@ M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(mScriptStorage,
 	cmocka_unit_test(deserializeError),
 	cmocka_unit_test(structuredRoundTrip),
 	cmocka_unit_test(autoflush),
+	cmocka_unit_test(flushPending),
+	cmocka_unit_test(flushOnDeinit),
 )
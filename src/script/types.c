@@ -881,8 +881,11 @@ void _lambdaFree(struct mScriptValue* value) {
 }
 
 struct mScriptValue* mScriptValueAlloc(const struct mScriptType* type) {
-	// TODO: Use an arena instead of just the generic heap
-	struct mScriptValue* val = malloc(sizeof(*val));
+	// Temporaries created while a context is active come from that context's freelist
+	struct mScriptValue* val = mScriptContextTakeValue();
+	if (!val) {
+		val = malloc(sizeof(*val));
+	}
 	val->refs = 1;
 	val->type = type;
 	val->flags = 0;
@@ -914,7 +917,9 @@ void mScriptValueDeref(struct mScriptValue* val) {
 	} else if (val->flags & mSCRIPT_VALUE_FLAG_FREE_BUFFER) {
 		free(val->value.opaque);
 	}
-	free(val);
+	if (!mScriptContextReturnValue(val)) {
+		free(val);
+	}
 }
 
 void mScriptValueWrap(struct mScriptValue* value, struct mScriptValue* out) {
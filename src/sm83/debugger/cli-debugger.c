@@ -54,6 +54,7 @@ static void _disassemble(struct CLIDebuggerSystem* debugger, struct CLIDebugVect
 
 static inline uint16_t _printLine(struct CLIDebugger* debugger, uint16_t address, int segment) {
 	struct CLIDebuggerBackend* be = debugger->backend;
+	struct SM83Debugger* platform = (struct SM83Debugger*) debugger->d.p->platform;
 	struct SM83InstructionInfo info = {{0}, 0};
 	char disassembly[48];
 	char* disPtr = disassembly;
@@ -62,16 +63,20 @@ static inline uint16_t _printLine(struct CLIDebugger* debugger, uint16_t address
 	}
 	be->printf(be, "%04X:  ", address);
 	uint8_t instruction;
+	uint32_t opcode = 0;
+	unsigned width = 0;
 	size_t bytesRemaining = 1;
 	for (bytesRemaining = 1; bytesRemaining; --bytesRemaining) {
 		instruction = debugger->d.p->core->rawRead8(debugger->d.p->core, address, segment);
 		disPtr += snprintf(disPtr, sizeof(disassembly) - (disPtr - disassembly), "%02X", instruction);
+		opcode |= instruction << (width * 8);
+		++width;
 		++address;
 		bytesRemaining += SM83Decode(instruction, &info);
 	};
 	disPtr[0] = '\t';
 	++disPtr;
-	SM83Disassemble(&info, address, disPtr, sizeof(disassembly) - (disPtr - disassembly));
+	SM83DebuggerDisassemble(platform, &info, opcode, width, address, disPtr, sizeof(disassembly) - (disPtr - disassembly));
 	be->printf(be, "%s\n", disassembly);
 	return address;
 }
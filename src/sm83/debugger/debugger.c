@@ -10,11 +10,15 @@
 #include <mgba/internal/sm83/decoder.h>
 #include <mgba/internal/sm83/sm83.h>
 #include <mgba/internal/sm83/debugger/memory-debugger.h>
+#include <mgba-util/string.h>
 
 static void _destroyBreakpoint(struct mDebugger* debugger, struct mBreakpoint* breakpoint) {
 	if (breakpoint->condition) {
 		parseFree(breakpoint->condition);
 	}
+	if (breakpoint->compiledCondition) {
+		parseProgramFree(breakpoint->compiledCondition);
+	}
 	TableRemove(&debugger->pointOwner, breakpoint->id);
 }
 
@@ -22,13 +26,29 @@ static void _destroyWatchpoint(struct mDebugger* debugger, struct mWatchpoint* w
 	if (watchpoint->condition) {
 		parseFree(watchpoint->condition);
 	}
+	if (watchpoint->compiledCondition) {
+		parseProgramFree(watchpoint->compiledCondition);
+	}
 	TableRemove(&debugger->pointOwner, watchpoint->id);
 }
 
+static void _rebuildBreakpointFilter(struct SM83Debugger* debugger) {
+	memset(debugger->breakpointFilter, 0, sizeof(debugger->breakpointFilter));
+	size_t i;
+	for (i = 0; i < mBreakpointListSize(&debugger->breakpoints); ++i) {
+		uint16_t address = mBreakpointListGetPointer(&debugger->breakpoints, i)->address;
+		debugger->breakpointFilter[address >> 5] |= 1U << (address & 31);
+	}
+}
+
 static void SM83DebuggerCheckBreakpoints(struct mDebuggerPlatform* d) {
 	struct SM83Debugger* debugger = (struct SM83Debugger*) d;
 	struct SM83Core* cpu = debugger->cpu;
 
+	if (!(debugger->breakpointFilter[cpu->pc >> 5] & (1U << (cpu->pc & 31)))) {
+		return;
+	}
+	bool removed = false;
 	size_t i;
 	for (i = 0; i < mBreakpointListSize(&debugger->breakpoints); ++i) {
 		struct mBreakpoint* breakpoint = mBreakpointListGetPointer(&debugger->breakpoints, i);
@@ -39,12 +59,8 @@ static void SM83DebuggerCheckBreakpoints(struct mDebuggerPlatform* d) {
 		if (breakpoint->segment >= 0 && breakpoint->segment != segment) {
 			continue;
 		}
-		if (breakpoint->condition) {
-			int32_t value;
-			int segment;
-			if (!mDebuggerEvaluateParseTree(d->p, breakpoint->condition, &value, &segment) || !(value || segment >= 0)) {
-				continue;
-			}
+		if (breakpoint->condition && !mDebuggerTestCondition(d->p, breakpoint->condition, breakpoint->compiledCondition)) {
+			continue;
 		}
 		struct mDebuggerEntryInfo info = {
 			.address = breakpoint->address,
@@ -56,9 +72,13 @@ static void SM83DebuggerCheckBreakpoints(struct mDebuggerPlatform* d) {
 		if (breakpoint->isTemporary) {
 			_destroyBreakpoint(debugger->d.p, breakpoint);
 			mBreakpointListShift(&debugger->breakpoints, i, 1);
+			removed = true;
 			--i;
 		}
 	}
+	if (removed) {
+		_rebuildBreakpointFilter(debugger);
+	}
 }
 
 static void SM83DebuggerInit(void* cpu, struct mDebuggerPlatform* platform);
@@ -75,6 +95,8 @@ static void SM83DebuggerCheckBreakpoints(struct mDebuggerPlatform*);
 static bool SM83DebuggerHasBreakpoints(struct mDebuggerPlatform*);
 static void SM83DebuggerTrace(struct mDebuggerPlatform*, char* out, size_t* length);
 static void SM83DebuggerNextInstructionInfo(struct mDebuggerPlatform* d, struct mDebuggerInstructionInfo* info);
+static size_t SM83DebuggerNextTraceEntry(struct mDebuggerPlatform* d, struct mDebuggerTraceEntry* entry, uint32_t* registers);
+static void SM83DebuggerFormatTraceEntry(struct mDebuggerPlatform* d, const struct mDebuggerTraceEntry* entry, char* out, size_t* length);
 
 struct mDebuggerPlatform* SM83DebuggerPlatformCreate(void) {
 	struct SM83Debugger* platform = malloc(sizeof(struct SM83Debugger));
@@ -93,6 +115,8 @@ struct mDebuggerPlatform* SM83DebuggerPlatformCreate(void) {
 	platform->d.setStackTraceMode = NULL;
 	platform->d.updateStackTrace = NULL;
 	platform->d.nextInstructionInfo = SM83DebuggerNextInstructionInfo;
+	platform->d.nextTraceEntry = SM83DebuggerNextTraceEntry;
+	platform->d.formatTraceEntry = SM83DebuggerFormatTraceEntry;
 	platform->printStatus = NULL;
 	return &platform->d;
 }
@@ -103,7 +127,9 @@ void SM83DebuggerInit(void* cpu, struct mDebuggerPlatform* platform) {
 	debugger->originalMemory = debugger->cpu->memory;
 	mBreakpointListInit(&debugger->breakpoints, 0);
 	mWatchpointListInit(&debugger->watchpoints, 0);
+	memset(debugger->breakpointFilter, 0, sizeof(debugger->breakpointFilter));
 	debugger->nextId = 1;
+	mDisassemblyCacheInit(&debugger->disassembly);
 }
 
 void SM83DebuggerDeinit(struct mDebuggerPlatform* platform) {
@@ -118,6 +144,7 @@ void SM83DebuggerDeinit(struct mDebuggerPlatform* platform) {
 		_destroyWatchpoint(debugger->d.p, mWatchpointListGetPointer(&debugger->watchpoints, i));
 	}
 	mWatchpointListDeinit(&debugger->watchpoints);
+	mDisassemblyCacheDeinit(&debugger->disassembly);
 }
 
 static void SM83DebuggerEnter(struct mDebuggerPlatform* platform, enum mDebuggerEntryReason reason, struct mDebuggerEntryInfo* info) {
@@ -133,8 +160,10 @@ static ssize_t SM83DebuggerSetBreakpoint(struct mDebuggerPlatform* d, struct mDe
 	struct mBreakpoint* breakpoint = mBreakpointListAppend(&debugger->breakpoints);
 	*breakpoint = *info;
 	breakpoint->id = debugger->nextId;
+	breakpoint->compiledCondition = parseCompileTree(debugger->d.p, info->condition);
 	TableInsert(&debugger->d.p->pointOwner, breakpoint->id, owner);
 	++debugger->nextId;
+	_rebuildBreakpointFilter(debugger);
 	return breakpoint->id;
 }
 
@@ -148,6 +177,7 @@ static bool SM83DebuggerClearBreakpoint(struct mDebuggerPlatform* d, ssize_t id)
 		if (breakpoint->id == id) {
 			_destroyBreakpoint(debugger->d.p, breakpoint);
 			mBreakpointListShift(breakpoints, i, 1);
+			_rebuildBreakpointFilter(debugger);
 			return true;
 		}
 	}
@@ -180,6 +210,7 @@ static ssize_t SM83DebuggerSetWatchpoint(struct mDebuggerPlatform* d, struct mDe
 	struct mWatchpoint* watchpoint = mWatchpointListAppend(&debugger->watchpoints);
 	*watchpoint = *info;
 	watchpoint->id = debugger->nextId;
+	watchpoint->compiledCondition = parseCompileTree(debugger->d.p, info->condition);
 	TableInsert(&debugger->d.p->pointOwner, watchpoint->id, owner);
 	++debugger->nextId;
 	return watchpoint->id;
@@ -219,6 +250,16 @@ static void SM83DebuggerListWatchpoints(struct mDebuggerPlatform* d, struct mDeb
 	}
 }
 
+void SM83DebuggerDisassemble(struct SM83Debugger* debugger, struct SM83InstructionInfo* info, uint32_t opcode, unsigned width, uint16_t pc, char* buffer, int blen) {
+	const char* text = mDisassemblyCacheLookup(&debugger->disassembly, pc, opcode, width);
+	if (text) {
+		strlcpy(buffer, text, blen);
+		return;
+	}
+	SM83Disassemble(info, pc, buffer, blen);
+	mDisassemblyCacheStore(&debugger->disassembly, pc, opcode, width, buffer);
+}
+
 static void SM83DebuggerTrace(struct mDebuggerPlatform* d, char* out, size_t* length) {
 	struct SM83Debugger* debugger = (struct SM83Debugger*) d;
 	struct SM83Core* cpu = debugger->cpu;
@@ -229,17 +270,21 @@ static void SM83DebuggerTrace(struct mDebuggerPlatform* d, char* out, size_t* le
 	char* disPtr = disassembly;
 	uint8_t instruction;
 	uint16_t address = cpu->pc;
+	uint32_t opcode = 0;
+	unsigned width = 0;
 	size_t bytesRemaining = 1;
 	for (bytesRemaining = 1; bytesRemaining; --bytesRemaining) {
 		instruction = debugger->d.p->core->rawRead8(debugger->d.p->core, address, -1);
 		disPtr += snprintf(disPtr, sizeof(disassembly) - (disPtr - disassembly), "%02X", instruction);
+		opcode |= instruction << (width * 8);
+		++width;
 		++address;
 		bytesRemaining += SM83Decode(instruction, &info);
 	};
 	disPtr[0] = ':';
 	disPtr[1] = ' ';
 	disPtr += 2;
-	SM83Disassemble(&info, address, disPtr, sizeof(disassembly) - (disPtr - disassembly));
+	SM83DebuggerDisassemble(debugger, &info, opcode, width, address, disPtr, sizeof(disassembly) - (disPtr - disassembly));
 
 	*length = snprintf(out, *length, "A: %02X F: %02X B: %02X C: %02X D: %02X E: %02X H: %02X L: %02X SP: %04X PC: %02X:%04X | %s",
 		               cpu->a, cpu->f.packed, cpu->b, cpu->c,
@@ -264,3 +309,59 @@ static void SM83DebuggerNextInstructionInfo(struct mDebuggerPlatform* d, struct
 		info->flagsEx[0] = mDebuggerAccessLogFlagsExFillErrorIllegalOpcode(info->flagsEx[0]);
 	}
 }
+
+static size_t SM83DebuggerNextTraceEntry(struct mDebuggerPlatform* d, struct mDebuggerTraceEntry* entry, uint32_t* registers) {
+	struct SM83Debugger* debugger = (struct SM83Debugger*) d;
+	struct SM83Core* cpu = debugger->cpu;
+	struct mCore* core = d->p->core;
+
+	// The segment rides in the upper half of the PC, since SM83 addresses are only 16 bits
+	int segment = cpu->memory.currentSegment(cpu, cpu->pc);
+	entry->pc = cpu->pc | ((segment & 0xFFFF) << 16);
+	entry->flags = cpu->f.packed;
+	entry->opcode = 0;
+	entry->width = 0;
+
+	struct SM83InstructionInfo info = {{0}};
+	uint16_t address = cpu->pc;
+	size_t bytesRemaining;
+	for (bytesRemaining = 1; bytesRemaining && entry->width < 4; --bytesRemaining) {
+		uint8_t instruction = core->rawRead8(core, address, -1);
+		entry->opcode |= instruction << (entry->width * 8);
+		++entry->width;
+		++address;
+		bytesRemaining += SM83Decode(instruction, &info);
+	}
+
+	registers[0] = cpu->a;
+	registers[1] = cpu->b;
+	registers[2] = cpu->c;
+	registers[3] = cpu->d;
+	registers[4] = cpu->e;
+	registers[5] = cpu->h;
+	registers[6] = cpu->l;
+	registers[7] = cpu->sp;
+	return 8;
+}
+
+static void SM83DebuggerFormatTraceEntry(struct mDebuggerPlatform* d, const struct mDebuggerTraceEntry* entry, char* out, size_t* length) {
+	struct SM83Debugger* debugger = (struct SM83Debugger*) d;
+	char disassembly[64];
+	char* disPtr = disassembly;
+
+	struct SM83InstructionInfo info = {{0}};
+	uint16_t address = entry->pc;
+	unsigned i;
+	for (i = 0; i < entry->width; ++i) {
+		uint8_t instruction = entry->opcode >> (i * 8);
+		disPtr += snprintf(disPtr, sizeof(disassembly) - (disPtr - disassembly), "%02X", instruction);
+		++address;
+		SM83Decode(instruction, &info);
+	}
+	disPtr[0] = ':';
+	disPtr[1] = ' ';
+	disPtr += 2;
+	SM83DebuggerDisassemble(debugger, &info, entry->opcode, entry->width, address, disPtr, sizeof(disassembly) - (disPtr - disassembly));
+
+	*length = snprintf(out, *length, "%02X:%04X F: %02X delta: %04X | %s", entry->pc >> 16, entry->pc & 0xFFFF, entry->flags, entry->changedRegisters, disassembly);
+}
@@ -45,12 +45,8 @@ static void _checkWatchpoints(struct SM83Debugger* debugger, uint16_t address, e
 	for (i = 0; i < mWatchpointListSize(&debugger->watchpoints); ++i) {
 		watchpoint = mWatchpointListGetPointer(&debugger->watchpoints, i);
 		if (watchpoint->type & type && address >= watchpoint->minAddress && address < watchpoint->maxAddress && (watchpoint->segment < 0 || watchpoint->segment == debugger->originalMemory.currentSegment(debugger->cpu, address))) {
-			if (watchpoint->condition) {
-				int32_t value;
-				int segment;
-				if (!mDebuggerEvaluateParseTree(debugger->d.p, watchpoint->condition, &value, &segment) || !(value || segment >= 0)) {
-					continue;
-				}
+			if (watchpoint->condition && !mDebuggerTestCondition(debugger->d.p, watchpoint->condition, watchpoint->compiledCondition)) {
+				continue;
 			}
 			uint8_t oldValue = debugger->originalMemory.load8(debugger->cpu, address);
 			if ((watchpoint->type & WATCHPOINT_CHANGE) && newValue == oldValue) {
@@ -148,24 +148,29 @@ static void _SM83Step(struct SM83Core* cpu) {
 	}
 }
 
+static void _SM83TickSplit(struct SM83Core* cpu) {
+	int t = cpu->tMultiplier;
+	if (cpu->cycles >= cpu->nextEvent) {
+		cpu->irqh.processEvents(cpu);
+	}
+	cpu->cycles += t;
+	++cpu->executionState;
+	if (cpu->cycles >= cpu->nextEvent) {
+		cpu->irqh.processEvents(cpu);
+	}
+	cpu->cycles += t;
+	++cpu->executionState;
+	if (cpu->cycles >= cpu->nextEvent) {
+		cpu->irqh.processEvents(cpu);
+	}
+}
+
 static inline bool _SM83TickInternal(struct SM83Core* cpu) {
 	bool running = true;
 	_SM83Step(cpu);
 	int t = cpu->tMultiplier;
 	if (cpu->cycles + t * 2 >= cpu->nextEvent) {
-		if (cpu->cycles >= cpu->nextEvent) {
-			cpu->irqh.processEvents(cpu);
-		}
-		cpu->cycles += t;
-		++cpu->executionState;
-		if (cpu->cycles >= cpu->nextEvent) {
-			cpu->irqh.processEvents(cpu);
-		}
-		cpu->cycles += t;
-		++cpu->executionState;
-		if (cpu->cycles >= cpu->nextEvent) {
-			cpu->irqh.processEvents(cpu);
-		}
+		_SM83TickSplit(cpu);
 		running = false;
 	} else {
 		cpu->cycles += t * 2;
@@ -197,3 +202,24 @@ void SM83Run(struct SM83Core* cpu) {
 		}
 	}
 }
+
+void SM83RunLoop(struct SM83Core* cpu) {
+	// Run M-cycles back to back until one comes close enough to the next event
+	// that it has to be split up, then finish the current instruction as SM83Run does
+	while (true) {
+		if (UNLIKELY(cpu->cycles >= cpu->nextEvent)) {
+			cpu->irqh.processEvents(cpu);
+			break;
+		}
+		if (UNLIKELY(!_SM83TickInternal(cpu))) {
+			break;
+		}
+	}
+	while (cpu->executionState != SM83_CORE_FETCH) {
+		if (cpu->cycles < cpu->nextEvent) {
+			_SM83TickInternal(cpu);
+		} else {
+			cpu->irqh.processEvents(cpu);
+		}
+	}
+}
@@ -0,0 +1,38 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba-util/vfs.h>
+
+#include "feature/sqlite3/no-intro.h"
+
+int main(int argc, char* argv[]) {
+	if (argc != 3) {
+		fprintf(stderr, "Usage: %s nointro.dat nointro.idx\n", argv[0]);
+		return 1;
+	}
+
+	struct VFile* dat = VFileOpen(argv[1], O_RDONLY);
+	if (!dat) {
+		return 2;
+	}
+	struct NoIntroDB* db = NoIntroDBLoad(":memory:");
+	if (!db) {
+		dat->close(dat);
+		return 3;
+	}
+	bool success = NoIntroDBLoadClrMamePro(db, dat);
+	dat->close(dat);
+
+	struct VFile* index = NULL;
+	if (success) {
+		index = VFileOpen(argv[2], O_WRONLY | O_CREAT | O_TRUNC);
+		success = index && NoIntroDBWriteIndex(db, index);
+	}
+	if (index) {
+		index->close(index);
+	}
+	NoIntroDBDestroy(db);
+	return success ? 0 : 4;
+}
@@ -264,7 +264,16 @@ int main(int argc, char* argv[]) {
 				fputs("An error occurred\n", logfile);
 			}
 			archive->close(archive);
-			unlink(updateArchive);
+			char baseArchive[PATH_MAX];
+			if (ok == 0 && mUpdateGetBaseArchivePath(extension, baseArchive, sizeof(baseArchive))) {
+				// Keep the archive around so the next update can be downloaded as a patch against it
+				unlink(baseArchive);
+				if (rename(updateArchive, baseArchive) < 0) {
+					unlink(updateArchive);
+				}
+			} else {
+				unlink(updateArchive);
+			}
 		}
 #ifdef __linux__
 		else if (strcmp(extension, "appimage") == 0) {
@@ -5,58 +5,131 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba-util/audio-buffer.h>
 
-#include <mgba-util/memory.h>
+static size_t _index(const struct mAudioBuffer* buffer, size_t position) {
+	if (position >= buffer->capacity) {
+		position -= buffer->capacity;
+	}
+	return position;
+}
+
+static size_t _advance(const struct mAudioBuffer* buffer, size_t position, size_t count) {
+	position += count;
+	if (position >= buffer->capacity * 2) {
+		position -= buffer->capacity * 2;
+	}
+	return position;
+}
+
+static size_t _size(const struct mAudioBuffer* buffer, size_t read, size_t write) {
+	size_t size;
+	if (write >= read) {
+		size = write - read;
+	} else {
+		size = buffer->capacity * 2 - read + write;
+	}
+	// Only possible if the buffer was cleared from the writing side mid-read
+	if (size > buffer->capacity) {
+		size = buffer->capacity;
+	}
+	return size;
+}
 
 void mAudioBufferInit(struct mAudioBuffer* buffer, size_t capacity, unsigned channels) {
-	mCircleBufferInit(&buffer->data, capacity * channels * sizeof(int16_t));
+	buffer->data = calloc(capacity * channels, sizeof(int16_t));
+	buffer->capacity = capacity;
 	buffer->channels = channels;
+	buffer->readPosition = 0;
+	buffer->writePosition = 0;
 }
 
 void mAudioBufferDeinit(struct mAudioBuffer* buffer) {
-	mCircleBufferDeinit(&buffer->data);
+	free(buffer->data);
+	buffer->data = NULL;
 }
 
 size_t mAudioBufferAvailable(const struct mAudioBuffer* buffer) {
-	return mCircleBufferSize(&buffer->data) / (buffer->channels * sizeof(int16_t));
+	uint32_t read;
+	uint32_t write;
+	ATOMIC_LOAD(read, buffer->readPosition);
+	ATOMIC_LOAD(write, buffer->writePosition);
+	return _size(buffer, read, write);
 }
 
 size_t mAudioBufferCapacity(const struct mAudioBuffer* buffer) {
-	return mCircleBufferCapacity(&buffer->data) / (buffer->channels * sizeof(int16_t));
+	return buffer->capacity;
 }
 
 void mAudioBufferClear(struct mAudioBuffer* buffer) {
-	mCircleBufferClear(&buffer->data);
+	uint32_t write;
+	ATOMIC_LOAD(write, buffer->writePosition);
+	ATOMIC_STORE(buffer->readPosition, write);
 }
 
 int16_t mAudioBufferPeek(const struct mAudioBuffer* buffer, unsigned channel, size_t offset) {
-	int16_t sample;
-	if (!mCircleBufferDump(&buffer->data, &sample, sizeof(int16_t), (offset * buffer->channels + channel) * sizeof(int16_t))) {
+	uint32_t read;
+	uint32_t write;
+	ATOMIC_LOAD(read, buffer->readPosition);
+	ATOMIC_LOAD(write, buffer->writePosition);
+	if (_size(buffer, read, write) <= offset) {
 		return 0;
 	}
-	return sample;
+	size_t index = _index(buffer, _index(buffer, read) + offset);
+	return buffer->data[index * buffer->channels + channel];
 }
 
 size_t mAudioBufferDump(const struct mAudioBuffer* buffer, int16_t* samples, size_t count, size_t offset) {
-	return mCircleBufferDump(&buffer->data,
-	                         samples,
-	                         count * buffer->channels * sizeof(int16_t),
-	                         offset * buffer->channels * sizeof(int16_t)) /
-	       (buffer->channels * sizeof(int16_t));
+	uint32_t read;
+	uint32_t write;
+	ATOMIC_LOAD(read, buffer->readPosition);
+	ATOMIC_LOAD(write, buffer->writePosition);
+	size_t size = _size(buffer, read, write);
+	if (size <= offset) {
+		return 0;
+	}
+	if (count > size - offset) {
+		count = size - offset;
+	}
+	size_t index = _index(buffer, _index(buffer, read) + offset);
+	size_t first = buffer->capacity - index;
+	if (first > count) {
+		first = count;
+	}
+	memcpy(samples, &buffer->data[index * buffer->channels], first * buffer->channels * sizeof(int16_t));
+	memcpy(&samples[first * buffer->channels], buffer->data, (count - first) * buffer->channels * sizeof(int16_t));
+	return count;
 }
 
 size_t mAudioBufferRead(struct mAudioBuffer* buffer, int16_t* samples, size_t count) {
-	return mCircleBufferRead(&buffer->data, samples, count * buffer->channels * sizeof(int16_t)) /
-	       (buffer->channels * sizeof(int16_t));
+	if (samples) {
+		count = mAudioBufferDump(buffer, samples, count, 0);
+	} else {
+		size_t available = mAudioBufferAvailable(buffer);
+		if (count > available) {
+			count = available;
+		}
+	}
+	ATOMIC_STORE(buffer->readPosition, _advance(buffer, buffer->readPosition, count));
+	return count;
 }
 
 size_t mAudioBufferWrite(struct mAudioBuffer* buffer, const int16_t* samples, size_t count) {
-	size_t free = mCircleBufferCapacity(&buffer->data) - mCircleBufferSize(&buffer->data);
-	if (count * buffer->channels * sizeof(int16_t) > free) {
-		if (!free) {
-			return 0;
-		}
-		count = free / (buffer->channels * sizeof(int16_t));
+	uint32_t read;
+	ATOMIC_LOAD(read, buffer->readPosition);
+	uint32_t write = buffer->writePosition;
+	size_t free = buffer->capacity - _size(buffer, read, write);
+	if (count > free) {
+		count = free;
+	}
+	if (!count) {
+		return 0;
+	}
+	size_t index = _index(buffer, write);
+	size_t first = buffer->capacity - index;
+	if (first > count) {
+		first = count;
 	}
-	return mCircleBufferWrite(&buffer->data, samples, count * buffer->channels * sizeof(int16_t)) /
-	       (buffer->channels * sizeof(int16_t));
+	memcpy(&buffer->data[index * buffer->channels], samples, first * buffer->channels * sizeof(int16_t));
+	memcpy(buffer->data, &samples[first * buffer->channels], (count - first) * buffer->channels * sizeof(int16_t));
+	ATOMIC_STORE(buffer->writePosition, _advance(buffer, write, count));
+	return count;
 }
@@ -8,6 +8,8 @@
 #include <mgba-util/audio-buffer.h>
 
 #define MAX_CHANNELS 2
+#define BLOCK_FRAMES 1024
+#define BLOCK_OUTPUT 256
 
 struct mAudioResamplerData {
 	struct mAudioResampler* resampler;
@@ -36,6 +38,11 @@ void mAudioResamplerInit(struct mAudioResampler* resampler, enum mInterpolatorTy
 		resampler->lowWaterMark = 0;
 		resampler->highWaterMark = 1;
 		break;
+	case mINTERPOLATOR_POLYPHASE:
+		mInterpolatorPolyphaseInit(&resampler->polyphase, 0, 0);
+		resampler->lowWaterMark = resampler->polyphase.taps / 2;
+		resampler->highWaterMark = resampler->polyphase.taps / 2;
+		break;
 	}
 }
 
@@ -47,6 +54,9 @@ void mAudioResamplerDeinit(struct mAudioResampler* resampler) {
 	case mINTERPOLATOR_COSINE:
 		mInterpolatorCosineDeinit(&resampler->cosine);
 		break;
+	case mINTERPOLATOR_POLYPHASE:
+		mInterpolatorPolyphaseDeinit(&resampler->polyphase);
+		break;
 	}
 	resampler->source = NULL;
 	resampler->destination = NULL;
@@ -63,10 +73,8 @@ void mAudioResamplerSetDestination(struct mAudioResampler* resampler, struct mAu
 	resampler->destRate = rate;
 }
 
-size_t mAudioResamplerProcess(struct mAudioResampler* resampler) {
+static double _processSamples(struct mAudioResampler* resampler, double timestamp, double timestep, size_t* read) {
 	int16_t sampleBuffer[MAX_CHANNELS] = {0};
-	double timestep = resampler->sourceRate / resampler->destRate;
-	double timestamp = resampler->timestamp;
 	struct mInterpolator* interp = &resampler->interp;
 	struct mAudioResamplerData context = {
 		.resampler = resampler,
@@ -76,9 +84,6 @@ size_t mAudioResamplerProcess(struct mAudioResampler* resampler) {
 		.context = &context,
 	};
 
-	size_t read = 0;
-	mASSERT(resampler->source->channels <= MAX_CHANNELS);
-
 	while (true) {
 		if (timestamp + resampler->highWaterMark >= mAudioBufferAvailable(resampler->source)) {
 			break;
@@ -96,7 +101,93 @@ size_t mAudioResamplerProcess(struct mAudioResampler* resampler) {
 			break;
 		}
 		timestamp += timestep;
-		++read;
+		++*read;
+	}
+	return timestamp;
+}
+
+static double _processBlocks(struct mAudioResampler* resampler, double timestamp, double timestep, size_t* read) {
+	struct mInterpolatorPolyphase* interp = &resampler->polyphase;
+	if (mInterpolatorPolyphaseSetStep(interp, timestep)) {
+		resampler->lowWaterMark = interp->taps / 2;
+		resampler->highWaterMark = interp->taps / 2;
+	}
+
+	int16_t block[BLOCK_FRAMES * MAX_CHANNELS];
+	float planar[MAX_CHANNELS][BLOCK_FRAMES];
+	const float* input[MAX_CHANNELS];
+	int16_t output[BLOCK_OUTPUT * MAX_CHANNELS];
+	unsigned channels = resampler->source->channels;
+	unsigned taps = interp->taps;
+	int start = 1 - (int) taps / 2;
+	unsigned channel;
+	for (channel = 0; channel < channels; ++channel) {
+		input[channel] = planar[channel];
+	}
+
+	while (true) {
+		size_t available = mAudioBufferAvailable(resampler->source);
+		if (timestamp + resampler->highWaterMark >= available) {
+			break;
+		}
+		size_t space = mAudioBufferCapacity(resampler->destination) - mAudioBufferAvailable(resampler->destination);
+		if (!space) {
+			break;
+		}
+
+		// Take as many outputs as the source, destination and block can cover at once
+		size_t count = (available - resampler->highWaterMark - timestamp) / timestep + 1;
+		size_t limit = (BLOCK_FRAMES - taps - 2) / timestep;
+		if (count > limit) {
+			count = limit ? limit : 1;
+		}
+		if (count > space) {
+			count = space;
+		}
+		if (count > BLOCK_OUTPUT) {
+			count = BLOCK_OUTPUT;
+		}
+		while (count > 1 && timestamp + (count - 1) * timestep + resampler->highWaterMark >= available) {
+			--count;
+		}
+
+		// One extra frame covers rounding differences in how the filter steps through time
+		int first = (int) timestamp + start;
+		size_t frames = (int) (timestamp + (count - 1) * timestep) - (int) timestamp + taps + 1;
+		size_t padding = 0;
+		if (first < 0) {
+			padding = -first;
+			memset(block, 0, padding * channels * sizeof(*block));
+		}
+		size_t dumped = padding + mAudioBufferDump(resampler->source, &block[padding * channels], frames - padding, first + padding);
+		if (dumped < frames) {
+			memset(&block[dumped * channels], 0, (frames - dumped) * channels * sizeof(*block));
+		}
+
+		size_t i;
+		for (i = 0; i < frames; ++i) {
+			for (channel = 0; channel < channels; ++channel) {
+				planar[channel][i] = block[i * channels + channel];
+			}
+		}
+
+		timestamp = mInterpolatorPolyphaseResample(interp, input, channels, output, count, timestamp - first, timestep) + first;
+		mAudioBufferWrite(resampler->destination, output, count);
+		*read += count;
+	}
+	return timestamp;
+}
+
+size_t mAudioResamplerProcess(struct mAudioResampler* resampler) {
+	double timestep = resampler->sourceRate / resampler->destRate;
+	double timestamp = resampler->timestamp;
+	size_t read = 0;
+	mASSERT(resampler->source->channels <= MAX_CHANNELS);
+
+	if (resampler->interpType == mINTERPOLATOR_POLYPHASE) {
+		timestamp = _processBlocks(resampler, timestamp, timestep, &read);
+	} else {
+		timestamp = _processSamples(resampler, timestamp, timestep, &read);
 	}
 
 	if (resampler->consume && timestamp > resampler->lowWaterMark) {
@@ -260,6 +260,7 @@ size_t mCircleBufferDump(const struct mCircleBuffer* buffer, void* output, size_
 			offset -= remaining;
 			data = buffer->data;
 			data += offset;
+			remaining = buffer->capacity - offset;
 		}
 	}
 
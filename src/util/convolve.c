@@ -5,6 +5,12 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba-util/convolve.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 void ConvolutionKernelCreate(struct ConvolutionKernel* kernel, size_t rank, size_t* dims) {
 	kernel->rank = rank;
 	kernel->dims = malloc(sizeof(kernel->dims[0]) * rank);
@@ -97,86 +103,202 @@ void Convolve1DPad0PackedS32(const int32_t* restrict src, int32_t* restrict dst,
 	}
 }
 
-void Convolve2DClampPacked8(const uint8_t* restrict src, uint8_t* restrict dst, size_t width, size_t height, size_t stride, const struct ConvolutionKernel* restrict kernel) {
-	if (kernel->rank != 2) {
-		return;
+// Checks whether a 2D kernel is the outer product of a row and a column, in which
+// case it can be applied as two much cheaper 1D passes
+static bool _separateKernel(const struct ConvolutionKernel* kernel, float* row, float* col) {
+	size_t kw = kernel->dims[0];
+	size_t kh = kernel->dims[1];
+	size_t px = 0;
+	size_t py = 0;
+	float max = 0.f;
+	size_t x, y;
+	for (y = 0; y < kh; ++y) {
+		for (x = 0; x < kw; ++x) {
+			float value = fabsf(kernel->kernel[y * kw + x]);
+			if (value > max) {
+				max = value;
+				px = x;
+				py = y;
+			}
+		}
 	}
-	size_t kx2 = kernel->dims[0] / 2;
-	size_t ky2 = kernel->dims[1] / 2;
-	size_t y;
-	for (y = 0; y < height; ++y) {
-		uint8_t* orow = &dst[y * stride];
-		size_t x;
-		for (x = 0; x < width; ++x) {
-			float sum = 0.f;
-			size_t ky;
-			for (ky = 0; ky < kernel->dims[1]; ++ky) {
-				size_t cy = 0;
-				if (y + ky > ky2) {
-					cy = y + ky - ky2;
-				}
-				if (cy >= height) {
-					cy = height - 1;
-				}
-				const uint8_t* irow = &src[cy * stride];
-				size_t kx;
-				for (kx = 0; kx < kernel->dims[0]; ++kx) {
-					size_t cx = 0;
-					if (x + kx > kx2) {
-						cx = x + kx - kx2;
-					}
-					if (cx >= width) {
-						cx = width - 1;
-					}
-					sum += irow[cx] * kernel->kernel[ky * kernel->dims[0] + kx];
-				}
+	if (max == 0.f) {
+		return false;
+	}
+	float pivot = kernel->kernel[py * kw + px];
+	for (x = 0; x < kw; ++x) {
+		row[x] = kernel->kernel[py * kw + x];
+	}
+	for (y = 0; y < kh; ++y) {
+		col[y] = kernel->kernel[y * kw + px] / pivot;
+	}
+	for (y = 0; y < kh; ++y) {
+		for (x = 0; x < kw; ++x) {
+			if (fabsf(kernel->kernel[y * kw + x] - col[y] * row[x]) > max * 1e-5f) {
+				return false;
 			}
-			*orow = sum;
-			++orow;
 		}
 	}
+	return true;
 }
 
-void Convolve2DClampChannels8(const uint8_t* restrict src, uint8_t* restrict dst, size_t width, size_t height, size_t stride, size_t channels, const struct ConvolutionKernel* restrict kernel) {
-	if (kernel->rank != 2) {
+// Widens a row to floats, repeating the edge pixels so the horizontal pass never needs to clamp
+static void _padRow(float* restrict out, const uint8_t* restrict in, size_t width, size_t channels, size_t left, size_t right) {
+	size_t x, c;
+	for (x = 0; x < left; ++x) {
+		for (c = 0; c < channels; ++c) {
+			*out++ = in[c];
+		}
+	}
+	for (x = 0; x < width * channels; ++x) {
+		*out++ = in[x];
+	}
+	for (x = 0; x < right; ++x) {
+		for (c = 0; c < channels; ++c) {
+			*out++ = in[(width - 1) * channels + c];
+		}
+	}
+}
+
+// acc[i] += sum(weights[k] * in[i + k * channels]) for each of the taps
+static void _accumulateRow(float* restrict acc, const float* restrict in, size_t length, size_t channels, const float* restrict weights, size_t taps) {
+	size_t i = 0;
+	size_t k;
+#if defined(__SSE2__)
+	for (; i + 4 <= length; i += 4) {
+		__m128 sum = _mm_loadu_ps(&acc[i]);
+		for (k = 0; k < taps; ++k) {
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(&in[i + k * channels]), _mm_set1_ps(weights[k])));
+		}
+		_mm_storeu_ps(&acc[i], sum);
+	}
+#elif defined(__ARM_NEON)
+	for (; i + 4 <= length; i += 4) {
+		float32x4_t sum = vld1q_f32(&acc[i]);
+		for (k = 0; k < taps; ++k) {
+			sum = vaddq_f32(sum, vmulq_n_f32(vld1q_f32(&in[i + k * channels]), weights[k]));
+		}
+		vst1q_f32(&acc[i], sum);
+	}
+#endif
+	for (; i < length; ++i) {
+		float sum = acc[i];
+		for (k = 0; k < taps; ++k) {
+			sum += in[i + k * channels] * weights[k];
+		}
+		acc[i] = sum;
+	}
+}
+
+// Truncates like a plain cast, but saturates instead of wrapping
+static void _storeRow(uint8_t* restrict out, const float* restrict in, size_t length) {
+	size_t i = 0;
+#if defined(__SSE2__)
+	for (; i + 8 <= length; i += 8) {
+		__m128i lo = _mm_cvttps_epi32(_mm_loadu_ps(&in[i]));
+		__m128i hi = _mm_cvttps_epi32(_mm_loadu_ps(&in[i + 4]));
+		__m128i words = _mm_packs_epi32(lo, hi);
+		_mm_storel_epi64((__m128i*) &out[i], _mm_packus_epi16(words, words));
+	}
+#elif defined(__ARM_NEON)
+	for (; i + 8 <= length; i += 8) {
+		uint16x4_t lo = vqmovn_u32(vcvtq_u32_f32(vld1q_f32(&in[i])));
+		uint16x4_t hi = vqmovn_u32(vcvtq_u32_f32(vld1q_f32(&in[i + 4])));
+		vst1_u8(&out[i], vqmovn_u16(vcombine_u16(lo, hi)));
+	}
+#endif
+	for (; i < length; ++i) {
+		float value = in[i];
+		if (value <= 0.f) {
+			out[i] = 0;
+		} else if (value >= 255.f) {
+			out[i] = 255;
+		} else {
+			out[i] = value;
+		}
+	}
+}
+
+static void _convolve2DClamp8(const uint8_t* restrict src, uint8_t* restrict dst, size_t width, size_t height, size_t stride, size_t channels, const struct ConvolutionKernel* restrict kernel) {
+	if (kernel->rank != 2 || !width || !height) {
 		return;
 	}
-	size_t kx2 = kernel->dims[0] / 2;
-	size_t ky2 = kernel->dims[1] / 2;
+	size_t kw = kernel->dims[0];
+	size_t kh = kernel->dims[1];
+	size_t length = width * channels;
 	size_t y;
+	if (!kw || !kh) {
+		for (y = 0; y < height; ++y) {
+			memset(&dst[y * stride], 0, length);
+		}
+		return;
+	}
+	size_t kx2 = kw / 2;
+	size_t ky2 = kh / 2;
+	size_t padded = (width + kw - 1) * channels;
+
+	float* row = malloc(sizeof(*row) * kw);
+	float* col = malloc(sizeof(*col) * kh);
+	bool separable = row && col && _separateKernel(kernel, row, col);
+	float* acc = malloc(sizeof(*acc) * length);
+	float* rows;
+	if (separable) {
+		rows = malloc(sizeof(*rows) * (length * height + padded));
+	} else {
+		rows = malloc(sizeof(*rows) * padded * height);
+	}
+	if (!row || !col || !acc || !rows) {
+		free(row);
+		free(col);
+		free(acc);
+		free(rows);
+		return;
+	}
+
+	if (separable) {
+		// Filter each row horizontally first, then blend the filtered rows vertically
+		float* pad = &rows[length * height];
+		for (y = 0; y < height; ++y) {
+			_padRow(pad, &src[y * stride], width, channels, kx2, kw - 1 - kx2);
+			memset(&rows[y * length], 0, sizeof(*rows) * length);
+			_accumulateRow(&rows[y * length], pad, length, channels, row, kw);
+		}
+	} else {
+		for (y = 0; y < height; ++y) {
+			_padRow(&rows[y * padded], &src[y * stride], width, channels, kx2, kw - 1 - kx2);
+		}
+	}
+
 	for (y = 0; y < height; ++y) {
-		uint8_t* orow = &dst[y * stride];
-		size_t x;
-		for (x = 0; x < width; ++x) {
-			size_t c;
-			for (c = 0; c < channels; ++c) {
-				float sum = 0.f;
-				size_t ky;
-				for (ky = 0; ky < kernel->dims[1]; ++ky) {
-					size_t cy = 0;
-					if (y + ky > ky2) {
-						cy = y + ky - ky2;
-					}
-					if (cy >= height) {
-						cy = height - 1;
-					}
-					const uint8_t* irow = &src[cy * stride];
-					size_t kx;
-					for (kx = 0; kx < kernel->dims[0]; ++kx) {
-						size_t cx = 0;
-						if (x + kx > kx2) {
-							cx = x + kx - kx2;
-						}
-						if (cx >= width) {
-							cx = width - 1;
-						}
-						cx *= channels;
-						sum += irow[cx + c] * kernel->kernel[ky * kernel->dims[0] + kx];
-					}
-				}
-				*orow = sum;
-				++orow;
+		memset(acc, 0, sizeof(*acc) * length);
+		size_t ky;
+		for (ky = 0; ky < kh; ++ky) {
+			size_t cy = 0;
+			if (y + ky > ky2) {
+				cy = y + ky - ky2;
+			}
+			if (cy >= height) {
+				cy = height - 1;
+			}
+			if (separable) {
+				_accumulateRow(acc, &rows[cy * length], length, 1, &col[ky], 1);
+			} else {
+				_accumulateRow(acc, &rows[cy * padded], length, channels, &kernel->kernel[ky * kw], kw);
 			}
 		}
+		_storeRow(&dst[y * stride], acc, length);
 	}
+
+	free(row);
+	free(col);
+	free(acc);
+	free(rows);
+}
+
+void Convolve2DClampPacked8(const uint8_t* restrict src, uint8_t* restrict dst, size_t width, size_t height, size_t stride, const struct ConvolutionKernel* restrict kernel) {
+	_convolve2DClamp8(src, dst, width, height, stride, 1, kernel);
+}
+
+void Convolve2DClampChannels8(const uint8_t* restrict src, uint8_t* restrict dst, size_t width, size_t height, size_t stride, size_t channels, const struct ConvolutionKernel* restrict kernel) {
+	_convolve2DClamp8(src, dst, width, height, stride, channels, kernel);
 }
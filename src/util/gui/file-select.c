@@ -8,11 +8,11 @@
 #include <mgba-util/gui/font.h>
 #include <mgba-util/gui/menu.h>
 #include <mgba-util/string.h>
+#include <mgba-util/threading.h>
 #include <mgba-util/vfs.h>
 
 #include <stdlib.h>
 
-#define ITERATION_SIZE 5
 #define SCANNING_THRESHOLD_1 50
 #ifdef __3DS__
 // 3DS is slooooow at opening files
@@ -20,14 +20,63 @@
 #else
 #define SCANNING_THRESHOLD_2 50
 #endif
+#define LISTING_CACHE_SIZE 4
 
-static void _cleanFiles(struct GUIMenuItemList* currentFiles) {
-	size_t size = GUIMenuItemListSize(currentFiles);
+// A directory being listed while its menu is shown. Entries are read and filtered in
+// chunks, on a separate thread if there is one, and merged into the menu as they come.
+struct GUIFileListing {
+	struct GUIMenuUpdater d;
+
+	struct VDir* dir;
+	char path[PATH_MAX];
+	bool (*filterName)(const char* name);
+	bool (*filterContents)(struct VFile*);
+	const char* preselect;
+	char title[64];
+
+	// Filtered by the lister, but not yet taken by the menu
+	struct GUIMenuItemList found;
+	size_t scanned;
+	bool done;
+	bool cancel;
+
+	// When a cached listing is shown, the new one is collected here and swapped in when it's done
+	struct GUIMenuItemList fresh;
+	bool fromCache;
+	bool complete;
+
+	// Once the cursor has been moved, or has found the preselected item, it's left alone
+	bool pinned;
+	size_t lastIndex;
+
+#ifndef DISABLE_THREADING
+	Mutex mutex;
+	Thread thread;
+#endif
+};
+
+struct GUIFileListingCache {
+	bool valid;
+	char path[PATH_MAX];
+	bool (*filterName)(const char* name);
+	bool (*filterContents)(struct VFile*);
+	struct GUIMenuItemList items;
+};
+
+// Most recently used first
+static struct GUIFileListingCache _listingCache[LISTING_CACHE_SIZE];
+
+static void _cleanItems(struct GUIMenuItemList* items, size_t start) {
+	size_t size = GUIMenuItemListSize(items);
 	size_t i;
-	for (i = 1; i < size; ++i) {
-		free((char*) GUIMenuItemListGetPointer(currentFiles, i)->title);
+	for (i = start; i < size; ++i) {
+		free((char*) GUIMenuItemListGetPointer(items, i)->title);
 	}
-	GUIMenuItemListClear(currentFiles);
+	GUIMenuItemListClear(items);
+}
+
+static void _cleanFiles(struct GUIMenuItemList* currentFiles) {
+	_cleanItems(currentFiles, 1);
 }
 
 static void _upDirectory(char* currentPath) {
@@ -48,132 +97,325 @@ static int _strpcmp(const void* a, const void* b) {
 	return strcasecmp(((const struct GUIMenuItem*) a)->title, ((const struct GUIMenuItem*) b)->title);
 }
 
-static bool _refreshDirectory(struct GUIParams* params, const char* currentPath, struct GUIMenuItemList* currentFiles, bool (*filterName)(const char* name), bool (*filterContents)(struct VFile*), const char* preselect) {
-	_cleanFiles(currentFiles);
+static void _copyItems(struct GUIMenuItemList* dest, const struct GUIMenuItemList* src, size_t start) {
+	size_t i;
+	for (i = start; i < GUIMenuItemListSize(src); ++i) {
+		const struct GUIMenuItem* item = GUIMenuItemListGetConstPointer(src, i);
+		*GUIMenuItemListAppend(dest) = (struct GUIMenuItem) { .title = strdup(item->title), .data = item->data };
+	}
+}
 
-	struct VDir* dir = VDirOpen(currentPath);
-	if (!dir) {
-		return false;
+// Returns 0, which is always "(Up)", if there's no such item
+static size_t _findItem(const struct GUIMenuItemList* items, const char* title) {
+	size_t low = 1;
+	size_t high = GUIMenuItemListSize(items);
+	while (low < high) {
+		size_t mid = low + (high - low) / 2;
+		if (strcasecmp(GUIMenuItemListGetConstPointer(items, mid)->title, title) < 0) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
 	}
-	*GUIMenuItemListAppend(currentFiles) = (struct GUIMenuItem) { .title = "(Up)" };
-	size_t i = 0;
-	size_t items = 0;
-	struct VDirEntry* de;
-	while ((de = dir->listNext(dir))) {
-		++i;
-		if (!(i % SCANNING_THRESHOLD_1)) {
-			uint32_t input = 0;
-			GUIPollInput(params, &input, 0);
-			if (input & (1 << GUI_INPUT_CANCEL)) {
-				dir->close(dir);
-				return false;
-			}
+	for (; low < GUIMenuItemListSize(items); ++low) {
+		const char* found = GUIMenuItemListGetConstPointer(items, low)->title;
+		if (strcasecmp(found, title) != 0) {
+			break;
+		}
+		if (strncmp(found, title, PATH_MAX) == 0) {
+			return low;
+		}
+	}
+	return 0;
+}
 
-			params->drawStart();
-			if (params->guiPrepare) {
-				params->guiPrepare();
-			}
-			GUIFontPrintf(params->font, 0, GUIFontHeight(params->font), GUI_ALIGN_LEFT, 0xFFFFFFFF, "(scanning for items: %"PRIz"u)", i);
-			GUIFontPrintf(params->font, 0, GUIFontHeight(params->font) * 2, GUI_ALIGN_LEFT, 0xFFFFFFFF, "%s", currentPath);
-			if (params->guiFinish) {
-				params->guiFinish();
-			}
-			params->drawEnd();
+static struct GUIFileListingCache* _findCache(const struct GUIFileListing* listing) {
+	size_t i;
+	for (i = 0; i < LISTING_CACHE_SIZE; ++i) {
+		struct GUIFileListingCache* cache = &_listingCache[i];
+		if (cache->valid && cache->filterName == listing->filterName && cache->filterContents == listing->filterContents &&
+		    strncmp(cache->path, listing->path, PATH_MAX) == 0) {
+			return cache;
+		}
+	}
+	return NULL;
+}
+
+static void _storeCache(const struct GUIFileListing* listing, const struct GUIMenuItemList* items) {
+	struct GUIFileListingCache* cache = _findCache(listing);
+	if (!cache) {
+		cache = &_listingCache[LISTING_CACHE_SIZE - 1];
+	}
+	if (cache->valid) {
+		_cleanItems(&cache->items, 0);
+	} else {
+		GUIMenuItemListInit(&cache->items, 0);
+	}
+	struct GUIFileListingCache entry = *cache;
+	memmove(&_listingCache[1], &_listingCache[0], (cache - _listingCache) * sizeof(*cache));
+	cache = &_listingCache[0];
+	*cache = entry;
+	cache->valid = true;
+	strlcpy(cache->path, listing->path, sizeof(cache->path));
+	cache->filterName = listing->filterName;
+	cache->filterContents = listing->filterContents;
+	_copyItems(&cache->items, items, 1);
+}
+
+static bool _listDirectory(struct GUIFileListing* listing) {
+	struct GUIMenuItem batch[SCANNING_THRESHOLD_1];
+	size_t chunk = listing->filterContents ? SCANNING_THRESHOLD_2 : SCANNING_THRESHOLD_1;
+	size_t found = 0;
+	size_t scanned;
+	bool more = true;
+	for (scanned = 0; scanned < chunk; ++scanned) {
+		struct VDirEntry* de = listing->dir->listNext(listing->dir);
+		if (!de) {
+			more = false;
+			break;
 		}
 		const char* name = de->name(de);
 		if (name[0] == '.') {
 			continue;
 		}
-		if (de->type(de) == VFS_DIRECTORY) {
+		enum VFSType type = de->type(de);
+		char* title;
+		if (type == VFS_DIRECTORY) {
 			size_t len = strlen(name) + 2;
-			char* n2 = malloc(len);
-			snprintf(n2, len, "%s/", name);
-			name = n2;
-		} else if (filterName && !filterName(name)) {
+			title = malloc(len);
+			snprintf(title, len, "%s/", name);
+		} else if (listing->filterName && !listing->filterName(name)) {
 			continue;
 		} else {
-			name = strdup(name);
-		}
-		*GUIMenuItemListAppend(currentFiles) = (struct GUIMenuItem) { .title = name, .data = GUI_V_U(de->type(de)) };
-		++items;
-	}
-	qsort(GUIMenuItemListGetPointer(currentFiles, 1), GUIMenuItemListSize(currentFiles) - 1, sizeof(struct GUIMenuItem), _strpcmp);
-	if (preselect || filterContents) {
-		i = 0;
-		size_t item = 0;
-		while (item < GUIMenuItemListSize(currentFiles)) {
-			++i;
-			// If we're not filtering the contents, this loop is fast, so there's no need to show updates
-			if (filterContents && !(i % SCANNING_THRESHOLD_2)) {
-				uint32_t input = 0;
-				GUIPollInput(params, &input, 0);
-				if (input & (1 << GUI_INPUT_CANCEL)) {
-					dir->close(dir);
-					return false;
-				}
-
-				params->drawStart();
-				if (params->guiPrepare) {
-					params->guiPrepare();
-				}
-				GUIFontPrintf(params->font, 0, GUIFontHeight(params->font), GUI_ALIGN_LEFT, 0xFFFFFFFF, "(scanning item %"PRIz"u of %"PRIz"u)", i, items);
-				GUIFontPrintf(params->font, 0, GUIFontHeight(params->font) * 2, GUI_ALIGN_LEFT, 0xFFFFFFFF, "%s", currentPath);
-				if (params->guiFinish) {
-					params->guiFinish();
-				}
-				params->drawEnd();
-			}
-			struct GUIMenuItem* testItem = GUIMenuItemListGetPointer(currentFiles, item);
-			if (!GUIVariantCompareUInt(testItem->data, VFS_FILE)) {
-				++item;
-				continue;
-			}
-			bool failed = false;
-			if (filterContents) {
-				struct VFile* vf = dir->openFile(dir, testItem->title, O_RDONLY);
+			if (listing->filterContents && type == VFS_FILE) {
+				struct VFile* vf = listing->dir->openFile(listing->dir, name, O_RDONLY);
 				if (!vf) {
-					failed = true;
-				} else {
-					if (!filterContents(vf)) {
-						failed = true;
-					}
-					vf->close(vf);
+					continue;
+				}
+				bool matches = listing->filterContents(vf);
+				vf->close(vf);
+				if (!matches) {
+					continue;
 				}
 			}
+			title = strdup(name);
+		}
+		batch[found] = (struct GUIMenuItem) { .title = title, .data = GUI_V_U(type) };
+		++found;
+	}
 
-			if (failed) {
-				free((char*) testItem->title);
-				GUIMenuItemListShift(currentFiles, item, 1);
-			} else {
-				if (preselect && strncmp(testItem->title, preselect, PATH_MAX) == 0) {
-					params->fileIndex = item;
-				}
-				++item;
+#ifndef DISABLE_THREADING
+	MutexLock(&listing->mutex);
+#endif
+	size_t i;
+	for (i = 0; i < found; ++i) {
+		*GUIMenuItemListAppend(&listing->found) = batch[i];
+	}
+	listing->scanned += scanned;
+	if (!more) {
+		listing->done = true;
+	}
+	if (listing->cancel) {
+		more = false;
+	}
+#ifndef DISABLE_THREADING
+	MutexUnlock(&listing->mutex);
+#endif
+	return more;
+}
+
+#ifndef DISABLE_THREADING
+static THREAD_ENTRY _listDirectoryThread(void* context) {
+	struct GUIFileListing* listing = context;
+	ThreadSetName("File Listing");
+	while (_listDirectory(listing));
+	THREAD_EXIT(0);
+}
+#endif
+
+// Merges sorted new items into the sorted menu in place, from the back, keeping the cursor on the same item
+static void _mergeItems(struct GUIMenu* menu, struct GUIMenuItemList* batch) {
+	size_t added = GUIMenuItemListSize(batch);
+	if (!added) {
+		return;
+	}
+	struct GUIMenuItem* newItems = GUIMenuItemListGetPointer(batch, 0);
+	qsort(newItems, added, sizeof(*newItems), _strpcmp);
+
+	size_t i = GUIMenuItemListSize(&menu->items);
+	GUIMenuItemListResize(&menu->items, added);
+	struct GUIMenuItem* items = GUIMenuItemListGetPointer(&menu->items, 0);
+	size_t j = added;
+	size_t k = i + added;
+	size_t index = menu->index;
+	while (j) {
+		if (i > 1 && strcasecmp(items[i - 1].title, newItems[j - 1].title) > 0) {
+			--i;
+			--k;
+			items[k] = items[i];
+			if (i == menu->index) {
+				index = k;
 			}
+		} else {
+			--j;
+			--k;
+			items[k] = newItems[j];
 		}
 	}
-	dir->close(dir);
+	menu->index = index;
+	GUIMenuItemListClear(batch);
+}
+
+static void _replaceItems(struct GUIMenu* menu, struct GUIMenuItemList* items) {
+	qsort(GUIMenuItemListGetPointer(items, 0), GUIMenuItemListSize(items), sizeof(struct GUIMenuItem), _strpcmp);
+	struct GUIMenuItemList newItems;
+	GUIMenuItemListInit(&newItems, GUIMenuItemListSize(items) + 1);
+	*GUIMenuItemListAppend(&newItems) = *GUIMenuItemListGetPointer(&menu->items, 0);
+	size_t i;
+	for (i = 0; i < GUIMenuItemListSize(items); ++i) {
+		*GUIMenuItemListAppend(&newItems) = *GUIMenuItemListGetPointer(items, i);
+	}
+	GUIMenuItemListClear(items);
+
+	if (menu->index) {
+		menu->index = _findItem(&newItems, GUIMenuItemListGetPointer(&menu->items, menu->index)->title);
+	}
+	_cleanFiles(&menu->items);
+	GUIMenuItemListDeinit(&menu->items);
+	menu->items = newItems;
+}
 
+static void _updateListing(struct GUIMenuUpdater* updater, struct GUIMenu* menu) {
+	struct GUIFileListing* listing = (struct GUIFileListing*) updater;
+	if (listing->complete) {
+		return;
+	}
+	if (menu->index != listing->lastIndex) {
+		listing->pinned = true;
+	}
+
+	struct GUIMenuItemList* batch = listing->fromCache ? &listing->fresh : NULL;
+	struct GUIMenuItemList newItems;
+	if (!batch) {
+		GUIMenuItemListInit(&newItems, 0);
+		batch = &newItems;
+	}
+#ifdef DISABLE_THREADING
+	_listDirectory(listing);
+#else
+	MutexLock(&listing->mutex);
+#endif
+	size_t i;
+	for (i = 0; i < GUIMenuItemListSize(&listing->found); ++i) {
+		*GUIMenuItemListAppend(batch) = *GUIMenuItemListGetPointer(&listing->found, i);
+	}
+	GUIMenuItemListClear(&listing->found);
+	size_t scanned = listing->scanned;
+	bool done = listing->done;
+#ifndef DISABLE_THREADING
+	MutexUnlock(&listing->mutex);
+#endif
+
+	if (!listing->fromCache) {
+		_mergeItems(menu, batch);
+		GUIMenuItemListDeinit(&newItems);
+	} else if (done) {
+		_replaceItems(menu, batch);
+	}
+	if (listing->preselect && !listing->pinned) {
+		size_t index = _findItem(&menu->items, listing->preselect);
+		if (index) {
+			menu->index = index;
+			listing->pinned = true;
+		}
+	}
+	listing->lastIndex = menu->index;
+
+	if (done) {
+		_storeCache(listing, &menu->items);
+		listing->complete = true;
+		menu->title = "Select file";
+	} else {
+		snprintf(listing->title, sizeof(listing->title), "Select file (scanning: %"PRIz"u)", scanned);
+		menu->title = listing->title;
+	}
+}
+
+static bool _startListing(struct GUIFileListing* listing, struct GUIMenu* menu, const char* path, bool (*filterName)(const char* name), bool (*filterContents)(struct VFile*), const char* preselect) {
+	struct VDir* dir = VDirOpen(path);
+	if (!dir) {
+		return false;
+	}
+	memset(listing, 0, sizeof(*listing));
+	listing->d.update = _updateListing;
+	listing->dir = dir;
+	strlcpy(listing->path, path, sizeof(listing->path));
+	listing->filterName = filterName;
+	listing->filterContents = filterContents;
+	listing->preselect = preselect;
+	GUIMenuItemListInit(&listing->found, 0);
+	GUIMenuItemListInit(&listing->fresh, 0);
+
+	_cleanFiles(&menu->items);
+	*GUIMenuItemListAppend(&menu->items) = (struct GUIMenuItem) { .title = "(Up)" };
+	struct GUIFileListingCache* cache = _findCache(listing);
+	if (cache) {
+		// Show what was there last time right away, and swap in the new listing once it's done
+		_copyItems(&menu->items, &cache->items, 0);
+		listing->fromCache = true;
+	}
+	menu->updater = &listing->d;
+	menu->title = "Select file";
+
+#ifndef DISABLE_THREADING
+	MutexInit(&listing->mutex);
+	ThreadCreate(&listing->thread, _listDirectoryThread, listing);
+#endif
 	return true;
 }
 
+static void _stopListing(struct GUIFileListing* listing, struct GUIMenu* menu) {
+	if (!listing->dir) {
+		return;
+	}
+#ifndef DISABLE_THREADING
+	MutexLock(&listing->mutex);
+	listing->cancel = true;
+	MutexUnlock(&listing->mutex);
+	ThreadJoin(&listing->thread);
+	MutexDeinit(&listing->mutex);
+#endif
+	_cleanItems(&listing->found, 0);
+	GUIMenuItemListDeinit(&listing->found);
+	_cleanItems(&listing->fresh, 0);
+	GUIMenuItemListDeinit(&listing->fresh);
+	listing->dir->close(listing->dir);
+	listing->dir = NULL;
+	menu->updater = NULL;
+	menu->title = "Select file";
+}
+
 bool GUISelectFile(struct GUIParams* params, char* outPath, size_t outLen, bool (*filterName)(const char* name), bool (*filterContents)(struct VFile*), const char* preselect) {
 	struct GUIMenu menu = {
 		.title = "Select file",
 		.subtitle = params->currentPath,
 	};
+	struct GUIFileListing listing;
+	listing.dir = NULL;
 	GUIMenuItemListInit(&menu.items, 0);
 	while (true) {
-		if (_refreshDirectory(params, params->currentPath, &menu.items, filterName, filterContents, preselect)) {
+		if (_startListing(&listing, &menu, params->currentPath, filterName, filterContents, preselect)) {
 			break;
 		}
 		if (strncmp(params->currentPath, params->basePath, PATH_MAX) == 0 || !params->currentPath[0]) {
 			mLOG(GUI_MENU, ERROR, "Failed to load base directory");
+			GUIMenuItemListDeinit(&menu.items);
 			return false;
 		}
 		_upDirectory(params->currentPath);
 	}
-	menu.index = params->fileIndex;
+	menu.index = params->fileIndex < GUIMenuItemListSize(&menu.items) ? params->fileIndex : 0;
+	listing.lastIndex = menu.index;
 
 	while (true) {
 		struct GUIMenuItem* item;
@@ -187,8 +429,9 @@ bool GUISelectFile(struct GUIParams* params, char* outPath, size_t outLen, bool
 				if (strncmp(params->currentPath, params->basePath, PATH_MAX) == 0) {
 					continue;
 				}
+				_stopListing(&listing, &menu);
 				_upDirectory(params->currentPath);
-				if (!_refreshDirectory(params, params->currentPath, &menu.items, filterName, filterContents, NULL)) {
+				if (!_startListing(&listing, &menu, params->currentPath, filterName, filterContents, NULL)) {
 					break;
 				}
 			} else {
@@ -199,37 +442,34 @@ bool GUISelectFile(struct GUIParams* params, char* outPath, size_t outLen, bool
 				}
 				snprintf(outPath, outLen, "%s%s%s", params->currentPath, sep, item->title);
 
-				struct GUIMenuItemList newFiles;
-				GUIMenuItemListInit(&newFiles, 0);
-				if (!_refreshDirectory(params, outPath, &newFiles, filterName, filterContents, NULL)) {
-					_cleanFiles(&newFiles);
-					GUIMenuItemListDeinit(&newFiles);
+				_stopListing(&listing, &menu);
+				if (!_startListing(&listing, &menu, outPath, filterName, filterContents, NULL)) {
 					_cleanFiles(&menu.items);
 					GUIMenuItemListDeinit(&menu.items);
 					return true;
-				} else {
-					_cleanFiles(&menu.items);
-					GUIMenuItemListDeinit(&menu.items);
-					menu.items = newFiles;
-					strlcpy(params->currentPath, outPath, PATH_MAX);
 				}
+				strlcpy(params->currentPath, outPath, PATH_MAX);
 			}
 			params->fileIndex = 0;
 			menu.index = 0;
+			listing.lastIndex = 0;
 		}
 		if (reason == GUI_MENU_EXIT_BACK) {
 			if (strncmp(params->currentPath, params->basePath, PATH_MAX) == 0) {
 				break;
 			}
+			_stopListing(&listing, &menu);
 			_upDirectory(params->currentPath);
-			if (!_refreshDirectory(params, params->currentPath, &menu.items, filterName, filterContents, NULL)) {
+			if (!_startListing(&listing, &menu, params->currentPath, filterName, filterContents, NULL)) {
 				break;
 			}
 			params->fileIndex = 0;
 			menu.index = 0;
+			listing.lastIndex = 0;
 		}
 	}
 
+	_stopListing(&listing, &menu);
 	_cleanFiles(&menu.items);
 	GUIMenuItemListDeinit(&menu.items);
 	return false;
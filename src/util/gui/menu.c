@@ -76,6 +76,9 @@ enum GUIMenuExitReason GUIShowMenu(struct GUIParams* params, struct GUIMenu* men
 			return GUI_MENU_EXIT_CANCEL;
 		}
 #endif
+		if (menu->updater) {
+			menu->updater->update(menu->updater, menu);
+		}
 		enum GUIMenuExitReason reason = GUIMenuRun(params, menu, &state);
 		switch (reason) {
 		case GUI_MENU_EXIT_BACK:
@@ -106,3 +106,93 @@ uint32_t hash32(const void* key, size_t len, uint32_t seed) {
 
 	return h1;
 }
+
+// wyhash was written by Wang Yi, and is released into the public domain.
+// This is the final version 4, without the optional secret generation.
+
+static const uint64_t wysecret[4] = {
+	0x2D358DCCAA6C78A5ULL, 0x8BB84B93962EACC9ULL, 0x4B33A62ED433D4A3ULL, 0x4D5A2DA51DE1AA47ULL
+};
+
+static FORCE_INLINE void wymum(uint64_t* a, uint64_t* b) {
+#if defined(__SIZEOF_INT128__)
+	__uint128_t r = *a;
+	r *= *b;
+	*a = (uint64_t) r;
+	*b = (uint64_t) (r >> 64);
+#else
+	uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t) *a, lb = (uint32_t) *b;
+	uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+	uint64_t t = rl + (rm0 << 32);
+	uint64_t c = t < rl;
+	uint64_t lo = t + (rm1 << 32);
+	c += lo < t;
+	*a = lo;
+	*b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static FORCE_INLINE uint64_t wymix(uint64_t a, uint64_t b) {
+	wymum(&a, &b);
+	return a ^ b;
+}
+
+static FORCE_INLINE uint64_t wyr8(const uint8_t* p) {
+	uint64_t v;
+	LOAD_64LE(v, 0, p);
+	return v;
+}
+
+static FORCE_INLINE uint64_t wyr4(const uint8_t* p) {
+	uint32_t v;
+	LOAD_32LE(v, 0, p);
+	return v;
+}
+
+static FORCE_INLINE uint64_t wyr3(const uint8_t* p, size_t k) {
+	return (((uint64_t) p[0]) << 16) | (((uint64_t) p[k >> 1]) << 8) | p[k - 1];
+}
+
+uint64_t hash64(const void* key, size_t len, uint64_t seed) {
+	const uint8_t* p = (const uint8_t*) key;
+	uint64_t a;
+	uint64_t b;
+	seed ^= wymix(seed ^ wysecret[0], wysecret[1]);
+	if (len <= 16) {
+		if (len >= 4) {
+			a = (wyr4(p) << 32) | wyr4(p + ((len >> 3) << 2));
+			b = (wyr4(p + len - 4) << 32) | wyr4(p + len - 4 - ((len >> 3) << 2));
+		} else if (len > 0) {
+			a = wyr3(p, len);
+			b = 0;
+		} else {
+			a = 0;
+			b = 0;
+		}
+	} else {
+		size_t i = len;
+		if (i >= 48) {
+			uint64_t see1 = seed;
+			uint64_t see2 = seed;
+			do {
+				seed = wymix(wyr8(p) ^ wysecret[1], wyr8(p + 8) ^ seed);
+				see1 = wymix(wyr8(p + 16) ^ wysecret[2], wyr8(p + 24) ^ see1);
+				see2 = wymix(wyr8(p + 32) ^ wysecret[3], wyr8(p + 40) ^ see2);
+				p += 48;
+				i -= 48;
+			} while (i >= 48);
+			seed ^= see1 ^ see2;
+		}
+		while (i > 16) {
+			seed = wymix(wyr8(p) ^ wysecret[1], wyr8(p + 8) ^ seed);
+			i -= 16;
+			p += 16;
+		}
+		a = wyr8(p + i - 16);
+		b = wyr8(p + i - 8);
+	}
+	a ^= wysecret[1];
+	b ^= seed;
+	wymum(&a, &b);
+	return wymix(a ^ wysecret[0] ^ len, b ^ wysecret[1]);
+}
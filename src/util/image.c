@@ -9,6 +9,12 @@
 #include <mgba-util/image/png-io.h>
 #include <mgba-util/vfs.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #define PIXEL(IM, X, Y) \
 	(void*) (((IM)->stride * (Y) + (X)) * (IM)->depth + (uintptr_t) (IM)->data)
 
@@ -258,6 +264,237 @@ struct mImage* mImageLoadVF(struct VFile* vf) {
 	return NULL;
 }
 
+// Packed formats are converted a whole row at a time by breaking them down into
+// per-channel shift and mask terms, which gives the same results as mColorConvert
+#define mCOLOR_MAX_TERMS 7
+
+struct mColorLayout {
+	unsigned depth;
+	// Red, green, blue, alpha. Formats with an X byte have an alpha slot that isn't alpha.
+	unsigned shift[4];
+	unsigned bits[4];
+	bool alpha;
+};
+
+struct mColorRowConverter {
+	unsigned srcDepth;
+	unsigned dstDepth;
+	unsigned nTerms;
+	uint32_t constant;
+	struct {
+		unsigned srcShift;
+		uint32_t mask;
+		unsigned dstShift;
+	} terms[mCOLOR_MAX_TERMS];
+};
+
+static bool _mColorLayout(enum mColorFormat format, struct mColorLayout* layout) {
+	static const struct {
+		enum mColorFormat format;
+		struct mColorLayout layout;
+	} layouts[] = {
+		{ mCOLOR_XBGR8, { 4, { 0, 8, 16, 24 }, { 8, 8, 8, 8 }, false } },
+		{ mCOLOR_XRGB8, { 4, { 16, 8, 0, 24 }, { 8, 8, 8, 8 }, false } },
+		{ mCOLOR_BGRX8, { 4, { 8, 16, 24, 0 }, { 8, 8, 8, 8 }, false } },
+		{ mCOLOR_RGBX8, { 4, { 24, 16, 8, 0 }, { 8, 8, 8, 8 }, false } },
+		{ mCOLOR_ABGR8, { 4, { 0, 8, 16, 24 }, { 8, 8, 8, 8 }, true } },
+		{ mCOLOR_ARGB8, { 4, { 16, 8, 0, 24 }, { 8, 8, 8, 8 }, true } },
+		{ mCOLOR_BGRA8, { 4, { 8, 16, 24, 0 }, { 8, 8, 8, 8 }, true } },
+		{ mCOLOR_RGBA8, { 4, { 24, 16, 8, 0 }, { 8, 8, 8, 8 }, true } },
+		{ mCOLOR_RGB5, { 2, { 10, 5, 0, 0 }, { 5, 5, 5, 0 }, false } },
+		{ mCOLOR_BGR5, { 2, { 0, 5, 10, 0 }, { 5, 5, 5, 0 }, false } },
+		{ mCOLOR_RGB565, { 2, { 11, 5, 0, 0 }, { 5, 6, 5, 0 }, false } },
+		{ mCOLOR_BGR565, { 2, { 0, 5, 11, 0 }, { 5, 6, 5, 0 }, false } },
+		{ mCOLOR_ARGB5, { 2, { 10, 5, 0, 15 }, { 5, 5, 5, 1 }, true } },
+		{ mCOLOR_ABGR5, { 2, { 0, 5, 10, 15 }, { 5, 5, 5, 1 }, true } },
+		{ mCOLOR_RGBA5, { 2, { 11, 6, 1, 0 }, { 5, 5, 5, 1 }, true } },
+		{ mCOLOR_BGRA5, { 2, { 1, 6, 11, 0 }, { 5, 5, 5, 1 }, true } },
+	};
+	size_t i;
+	for (i = 0; i < sizeof(layouts) / sizeof(*layouts); ++i) {
+		if (layouts[i].format == format) {
+			*layout = layouts[i].layout;
+			return true;
+		}
+	}
+	return false;
+}
+
+static void _mColorAddTerm(struct mColorRowConverter* converter, unsigned srcShift, unsigned bits, unsigned dstShift) {
+	converter->terms[converter->nTerms].srcShift = srcShift;
+	converter->terms[converter->nTerms].mask = (1U << bits) - 1;
+	converter->terms[converter->nTerms].dstShift = dstShift;
+	++converter->nTerms;
+}
+
+static bool _mColorRowConverterInit(struct mColorRowConverter* converter, enum mColorFormat from, enum mColorFormat to) {
+	struct mColorLayout src;
+	struct mColorLayout dst;
+	if (!_mColorLayout(from, &src) || !_mColorLayout(to, &dst)) {
+		return false;
+	}
+	converter->srcDepth = src.depth;
+	converter->dstDepth = dst.depth;
+	converter->nTerms = 0;
+	converter->constant = 0;
+
+	int i;
+	for (i = 0; i < 3; ++i) {
+		unsigned n = src.bits[i];
+		unsigned m = dst.bits[i];
+		if (m <= n) {
+			_mColorAddTerm(converter, src.shift[i] + n - m, m, dst.shift[i]);
+		} else {
+			// Widening replicates the top bits into the bottom, e.g. (c * 0x21) >> 2 for 5 to 8 bits
+			_mColorAddTerm(converter, src.shift[i], n, dst.shift[i] + m - n);
+			_mColorAddTerm(converter, src.shift[i] + 2 * n - m, m - n, dst.shift[i]);
+		}
+	}
+
+	if (dst.bits[3]) {
+		if (!dst.alpha || !src.alpha) {
+			converter->constant = ((1U << dst.bits[3]) - 1) << dst.shift[3];
+		} else if (src.bits[3] == dst.bits[3]) {
+			_mColorAddTerm(converter, src.shift[3], src.bits[3], dst.shift[3]);
+		} else {
+			// 1-bit alpha isn't a plain bit range of 8-bit alpha
+			return false;
+		}
+	}
+	return true;
+}
+
+static inline uint32_t _mColorRowConvertPixel(const struct mColorRowConverter* converter, uint32_t color) {
+	uint32_t out = converter->constant;
+	unsigned i;
+	for (i = 0; i < converter->nTerms; ++i) {
+		out |= ((color >> converter->terms[i].srcShift) & converter->terms[i].mask) << converter->terms[i].dstShift;
+	}
+	return out;
+}
+
+#if defined(__SSE2__)
+typedef __m128i _mColorVector;
+typedef __m128i _mColorShift;
+
+static inline _mColorVector _mColorSplat(uint32_t value) {
+	return _mm_set1_epi32(value);
+}
+
+static inline _mColorShift _mColorShiftCount(unsigned count, bool right) {
+	UNUSED(right);
+	return _mm_cvtsi32_si128(count);
+}
+
+static inline _mColorVector _mColorLoad16(const uint16_t* src) {
+	return _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*) src), _mm_setzero_si128());
+}
+
+static inline _mColorVector _mColorLoad32(const uint32_t* src) {
+	return _mm_loadu_si128((const __m128i*) src);
+}
+
+static inline void _mColorStore16(uint16_t* dst, _mColorVector pixels) {
+	// There's no unsigned saturating pack in SSE2, so bias into signed range and back
+	pixels = _mm_packs_epi32(_mm_sub_epi32(pixels, _mm_set1_epi32(0x8000)), _mm_setzero_si128());
+	_mm_storel_epi64((__m128i*) dst, _mm_xor_si128(pixels, _mm_set1_epi16(-0x8000)));
+}
+
+static inline void _mColorStore32(uint32_t* dst, _mColorVector pixels) {
+	_mm_storeu_si128((__m128i*) dst, pixels);
+}
+
+static inline _mColorVector _mColorTerm(_mColorVector out, _mColorVector pixels, _mColorShift srcShift, _mColorVector mask, _mColorShift dstShift) {
+	return _mm_or_si128(out, _mm_sll_epi32(_mm_and_si128(_mm_srl_epi32(pixels, srcShift), mask), dstShift));
+}
+#define mCOLOR_VECTOR_CONVERT
+#elif defined(__ARM_NEON)
+typedef uint32x4_t _mColorVector;
+typedef int32x4_t _mColorShift;
+
+static inline _mColorVector _mColorSplat(uint32_t value) {
+	return vdupq_n_u32(value);
+}
+
+static inline _mColorShift _mColorShiftCount(unsigned count, bool right) {
+	// NEON only shifts left; negative counts shift right
+	return vdupq_n_s32(right ? -(int32_t) count : (int32_t) count);
+}
+
+static inline _mColorVector _mColorLoad16(const uint16_t* src) {
+	return vmovl_u16(vld1_u16(src));
+}
+
+static inline _mColorVector _mColorLoad32(const uint32_t* src) {
+	return vld1q_u32(src);
+}
+
+static inline void _mColorStore16(uint16_t* dst, _mColorVector pixels) {
+	vst1_u16(dst, vmovn_u32(pixels));
+}
+
+static inline void _mColorStore32(uint32_t* dst, _mColorVector pixels) {
+	vst1q_u32(dst, pixels);
+}
+
+static inline _mColorVector _mColorTerm(_mColorVector out, _mColorVector pixels, _mColorShift srcShift, _mColorVector mask, _mColorShift dstShift) {
+	return vorrq_u32(out, vshlq_u32(vandq_u32(vshlq_u32(pixels, srcShift), mask), dstShift));
+}
+#define mCOLOR_VECTOR_CONVERT
+#endif
+
+static void _mColorRowConvert(const struct mColorRowConverter* converter, void* dst, const void* src, size_t count) {
+	size_t x = 0;
+#ifdef mCOLOR_VECTOR_CONVERT
+	_mColorShift srcShifts[mCOLOR_MAX_TERMS];
+	_mColorShift dstShifts[mCOLOR_MAX_TERMS];
+	_mColorVector masks[mCOLOR_MAX_TERMS];
+	_mColorVector constant = _mColorSplat(converter->constant);
+	unsigned i;
+	for (i = 0; i < converter->nTerms; ++i) {
+		srcShifts[i] = _mColorShiftCount(converter->terms[i].srcShift, true);
+		dstShifts[i] = _mColorShiftCount(converter->terms[i].dstShift, false);
+		masks[i] = _mColorSplat(converter->terms[i].mask);
+	}
+	for (; x + 4 <= count; x += 4) {
+		_mColorVector pixels;
+		if (converter->srcDepth == 2) {
+			pixels = _mColorLoad16(&((const uint16_t*) src)[x]);
+		} else {
+			pixels = _mColorLoad32(&((const uint32_t*) src)[x]);
+		}
+		_mColorVector out = constant;
+		for (i = 0; i < converter->nTerms; ++i) {
+			out = _mColorTerm(out, pixels, srcShifts[i], masks[i], dstShifts[i]);
+		}
+		if (converter->dstDepth == 2) {
+			_mColorStore16(&((uint16_t*) dst)[x], out);
+		} else {
+			_mColorStore32(&((uint32_t*) dst)[x], out);
+		}
+	}
+#endif
+	const uint8_t* srcPixel = (const uint8_t*) src + x * converter->srcDepth;
+	uint8_t* dstPixel = (uint8_t*) dst + x * converter->dstDepth;
+	for (; x < count; ++x, srcPixel += converter->srcDepth, dstPixel += converter->dstDepth) {
+		uint32_t color;
+		if (converter->srcDepth == 2) {
+			uint16_t color16;
+			memcpy(&color16, srcPixel, sizeof(color16));
+			color = color16;
+		} else {
+			memcpy(&color, srcPixel, sizeof(color));
+		}
+		color = _mColorRowConvertPixel(converter, color);
+		if (converter->dstDepth == 2) {
+			uint16_t color16 = color;
+			memcpy(dstPixel, &color16, sizeof(color16));
+		} else {
+			memcpy(dstPixel, &color, sizeof(color));
+		}
+	}
+}
+
 struct mImage* mImageConvertToFormat(const struct mImage* image, enum mColorFormat format) {
 	if (format == mCOLOR_PAL8) {
 		// Quantization shouldn't be handled here
@@ -278,8 +515,16 @@ struct mImage* mImageConvertToFormat(const struct mImage* image, enum mColorForm
 	newImage->stride = image->width;
 	newImage->data = malloc(image->width * image->height * newImage->depth);
 
-	// TODO: Implement more specializations, e.g. alpha narrowing/widening, channel swapping
 	size_t x, y;
+	struct mColorRowConverter converter;
+	if (_mColorRowConverterInit(&converter, image->format, format)) {
+		for (y = 0; y < newImage->height; ++y) {
+			_mColorRowConvert(&converter, ROW(newImage, y), ROW(image, y), newImage->width);
+		}
+		return newImage;
+	}
+
+	// TODO: Implement more specializations, e.g. 24-bit formats
 	for (y = 0; y < newImage->height; ++y) {
 		uintptr_t src = (uintptr_t) ROW(image, y);
 		uintptr_t dst = (uintptr_t) ROW(newImage, y);
@@ -320,11 +565,14 @@ bool mImageSave(const struct mImage* image, const char* path, const char* format
 #endif
 
 #ifdef USE_PNG
-bool mImageSavePNG(const struct mImage* image, struct VFile* vf) {
+bool mImageSavePNG(const struct mImage* image, struct VFile* vf, int compression) {
 	png_structp png = PNGWriteOpen(vf);
 	png_infop info = NULL;
 	bool ok = false;
 	if (png) {
+		if (compression >= 0) {
+			png_set_compression_level(png, compression > 9 ? 9 : compression);
+		}
 		if (image->format == mCOLOR_PAL8) {
 			info = PNGWriteHeaderPalette(png, image->width, image->height, image->palette, image->palSize);
 			if (info) {
@@ -342,16 +590,137 @@ bool mImageSavePNG(const struct mImage* image, struct VFile* vf) {
 }
 #endif
 
+static void _putBE32(uint8_t* out, uint32_t value) {
+	out[0] = value >> 24;
+	out[1] = value >> 16;
+	out[2] = value >> 8;
+	out[3] = value;
+}
+
+// See https://qoiformat.org/qoi-specification.pdf
+static bool mImageSaveQOI(const struct mImage* image, struct VFile* vf) {
+	size_t size = 14 + image->width * image->height * 5 + 8;
+	uint8_t* buffer = malloc(size);
+	if (!buffer) {
+		return false;
+	}
+	memcpy(buffer, "qoif", 4);
+	_putBE32(&buffer[4], image->width);
+	_putBE32(&buffer[8], image->height);
+	buffer[12] = 4;
+	buffer[13] = 0;
+
+	uint32_t index[64] = {0};
+	uint32_t previous = 0xFF000000;
+	unsigned run = 0;
+	size_t offset = 14;
+	unsigned x, y;
+	for (y = 0; y < image->height; ++y) {
+		for (x = 0; x < image->width; ++x) {
+			uint32_t color = mImageGetPixel(image, x, y);
+			if (color == previous) {
+				++run;
+				if (run == 62) {
+					buffer[offset++] = 0xC0 | (run - 1);
+					run = 0;
+				}
+				continue;
+			}
+			if (run) {
+				buffer[offset++] = 0xC0 | (run - 1);
+				run = 0;
+			}
+
+			int r = (color >> 16) & 0xFF;
+			int g = (color >> 8) & 0xFF;
+			int b = color & 0xFF;
+			int a = color >> 24;
+			unsigned hash = (r * 3 + g * 5 + b * 7 + a * 11) & 63;
+			if (index[hash] == color) {
+				buffer[offset++] = hash;
+			} else if ((color ^ previous) >> 24) {
+				buffer[offset++] = 0xFF;
+				buffer[offset++] = r;
+				buffer[offset++] = g;
+				buffer[offset++] = b;
+				buffer[offset++] = a;
+			} else {
+				int8_t dr = r - ((previous >> 16) & 0xFF);
+				int8_t dg = g - ((previous >> 8) & 0xFF);
+				int8_t db = b - (previous & 0xFF);
+				int8_t drg = dr - dg;
+				int8_t dbg = db - dg;
+				if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+					buffer[offset++] = 0x40 | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2);
+				} else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7) {
+					buffer[offset++] = 0x80 | (dg + 32);
+					buffer[offset++] = ((drg + 8) << 4) | (dbg + 8);
+				} else {
+					buffer[offset++] = 0xFE;
+					buffer[offset++] = r;
+					buffer[offset++] = g;
+					buffer[offset++] = b;
+				}
+			}
+			index[hash] = color;
+			previous = color;
+		}
+	}
+	if (run) {
+		buffer[offset++] = 0xC0 | (run - 1);
+	}
+	memcpy(&buffer[offset], "\0\0\0\0\0\0\0\1", 8);
+	offset += 8;
+
+	bool ok = vf->write(vf, buffer, offset) == (ssize_t) offset;
+	free(buffer);
+	return ok;
+}
+
+static bool mImageSavePPM(const struct mImage* image, struct VFile* vf) {
+	char header[32];
+	int headerSize = snprintf(header, sizeof(header), "P6\n%u %u\n255\n", image->width, image->height);
+	if (vf->write(vf, header, headerSize) != headerSize) {
+		return false;
+	}
+	size_t rowSize = image->width * 3;
+	uint8_t* row = malloc(rowSize);
+	if (!row) {
+		return false;
+	}
+	bool ok = true;
+	unsigned x, y;
+	for (y = 0; y < image->height && ok; ++y) {
+		for (x = 0; x < image->width; ++x) {
+			uint32_t color = mImageGetPixel(image, x, y);
+			row[x * 3] = color >> 16;
+			row[x * 3 + 1] = color >> 8;
+			row[x * 3 + 2] = color;
+		}
+		ok = vf->write(vf, row, rowSize) == (ssize_t) rowSize;
+	}
+	free(row);
+	return ok;
+}
+
 bool mImageSaveVF(const struct mImage* image, struct VFile* vf, const char* format) {
+	return mImageSaveVFCompressed(image, vf, format, -1);
+}
+
+bool mImageSaveVFCompressed(const struct mImage* image, struct VFile* vf, const char* format, int compression) {
 #ifdef USE_PNG
 	if (strcasecmp(format, "png") == 0) {
-		return mImageSavePNG(image, vf);
+		return mImageSavePNG(image, vf, compression);
 	}
 #else
-	UNUSED(image);
-	UNUSED(vf);
-	UNUSED(format);
+	UNUSED(compression);
 #endif
+	if (strcasecmp(format, "qoi") == 0) {
+		return mImageSaveQOI(image, vf);
+	}
+	if (strcasecmp(format, "ppm") == 0) {
+		return mImageSavePPM(image, vf);
+	}
 	return false;
 }
 
@@ -489,6 +858,20 @@ void mImageBlit(struct mImage* image, const struct mImage* source, int x, int y)
 
 	COMPOSITE_BOUNDS_INIT(source, image);
 
+	struct mColorRowConverter converter;
+	if (source->format == image->format && source->format != mCOLOR_PAL8) {
+		for (y = 0; y < srcRect.height; ++y) {
+			memcpy(PIXEL(image, dstStartX, dstStartY + y), PIXEL(source, srcStartX, srcStartY + y), srcRect.width * image->depth);
+		}
+		return;
+	}
+	if (_mColorRowConverterInit(&converter, source->format, image->format)) {
+		for (y = 0; y < srcRect.height; ++y) {
+			_mColorRowConvert(&converter, PIXEL(image, dstStartX, dstStartY + y), PIXEL(source, srcStartX, srcStartY + y), srcRect.width);
+		}
+		return;
+	}
+
 	for (y = 0; y < srcRect.height; ++y) {
 		uintptr_t srcPixel = (uintptr_t) PIXEL(source, srcStartX, srcStartY + y);
 		uintptr_t dstPixel = (uintptr_t) PIXEL(image, dstStartX, dstStartY + y);
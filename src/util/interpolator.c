@@ -5,15 +5,26 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba-util/interpolator.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 enum {
 	mSINC_RESOLUTION = 8192,
 	mSINC_WIDTH = 8,
 
 	mCOSINE_RESOLUTION = 8192,
+
+	mPOLYPHASE_PHASES = 256,
+	mPOLYPHASE_WIDTH = 8,
+	mPOLYPHASE_MAX_TAPS = 64,
 };
 
 static int16_t mInterpolatorSincInterpolate(const struct mInterpolator*, const struct mInterpolationData*, double time, double sampleStep);
 static int16_t mInterpolatorCosineInterpolate(const struct mInterpolator*, const struct mInterpolationData*, double time, double sampleStep);
+static int16_t mInterpolatorPolyphaseInterpolate(const struct mInterpolator*, const struct mInterpolationData*, double time, double sampleStep);
 
 void mInterpolatorSincInit(struct mInterpolatorSinc* interp, unsigned resolution, unsigned width) {
 	interp->d.interpolate = mInterpolatorSincInterpolate;
@@ -114,3 +125,168 @@ int16_t mInterpolatorCosineInterpolate(const struct mInterpolator* interpolator,
 	double factor = interp->lut[(size_t) (weight * interp->resolution)];
 	return left * factor + right * (1.0 - factor);
 }
+
+static void _polyphaseBuildBank(struct mInterpolatorPolyphase* interp) {
+	unsigned taps = interp->taps;
+	int half = taps / 2;
+	free(interp->bank);
+	free(interp->slope);
+	interp->bank = calloc((interp->phases + 1) * taps, sizeof(float));
+	interp->slope = calloc(interp->phases * taps, sizeof(float));
+
+	unsigned phase;
+	for (phase = 0; phase <= interp->phases; ++phase) {
+		float* row = &interp->bank[phase * taps];
+		double subsample = phase / (double) interp->phases;
+		double kernelSum = 0.0;
+		double kernels[mPOLYPHASE_MAX_TAPS];
+		unsigned i;
+		for (i = 0; i < taps; ++i) {
+			double distance = (int) i - (half - 1) - subsample;
+			double y = fabs(distance) / half;
+			if (y >= 1.0) {
+				kernels[i] = 0.0;
+				continue;
+			}
+			double x = M_PI * distance * interp->cutoff;
+			double sinc = x != 0.0 ? sin(x) / x : 1.0;
+			// Same three term Nuttall window as the plain sinc interpolator
+			double window = 0.40897 + 0.5 * cos(M_PI * y) + 0.09103 * cos(2 * M_PI * y);
+			kernels[i] = sinc * window;
+			kernelSum += kernels[i];
+		}
+		for (i = 0; i < taps; ++i) {
+			row[i] = kernels[i] / kernelSum;
+		}
+	}
+	for (phase = 0; phase < interp->phases; ++phase) {
+		unsigned i;
+		for (i = 0; i < taps; ++i) {
+			interp->slope[phase * taps + i] = interp->bank[(phase + 1) * taps + i] - interp->bank[phase * taps + i];
+		}
+	}
+}
+
+void mInterpolatorPolyphaseInit(struct mInterpolatorPolyphase* interp, unsigned phases, unsigned width) {
+	interp->d.interpolate = mInterpolatorPolyphaseInterpolate;
+
+	if (!phases) {
+		phases = mPOLYPHASE_PHASES;
+	}
+	if (!width) {
+		width = mPOLYPHASE_WIDTH;
+	}
+	interp->phases = phases;
+	interp->width = width;
+	interp->taps = 0;
+	interp->cutoff = 0;
+	interp->bank = NULL;
+	interp->slope = NULL;
+	mInterpolatorPolyphaseSetStep(interp, 1.0);
+}
+
+void mInterpolatorPolyphaseDeinit(struct mInterpolatorPolyphase* interp) {
+	free(interp->bank);
+	free(interp->slope);
+	interp->bank = NULL;
+	interp->slope = NULL;
+}
+
+bool mInterpolatorPolyphaseSetStep(struct mInterpolatorPolyphase* interp, double sampleStep) {
+	// When decimating, the cutoff has to drop to the output's Nyquist frequency,
+	// which needs proportionally more taps for the same filter quality
+	double cutoff = sampleStep > 1.0 ? 1.0 / sampleStep : 1.0;
+	if (interp->bank && fabs(cutoff - interp->cutoff) <= cutoff * 0.01) {
+		return false;
+	}
+	unsigned taps = ceil(2 * interp->width / cutoff);
+	taps = (taps + 3) & ~3;
+	if (taps > mPOLYPHASE_MAX_TAPS) {
+		taps = mPOLYPHASE_MAX_TAPS;
+	}
+	interp->taps = taps;
+	interp->cutoff = cutoff;
+	_polyphaseBuildBank(interp);
+	return true;
+}
+
+static inline int16_t _polyphaseClamp(float sample) {
+	if (sample >= INT16_MAX) {
+		return INT16_MAX;
+	}
+	if (sample <= INT16_MIN) {
+		return INT16_MIN;
+	}
+	return lrintf(sample);
+}
+
+// Applies one channel of the filter, blending between the two nearest phases.
+// Tap counts are always a multiple of four.
+static inline float _polyphaseApply(const float* input, const float* row, const float* slope, float weight, unsigned taps) {
+	unsigned i;
+#if defined(__SSE2__)
+	__m128 sum = _mm_setzero_ps();
+	__m128 mix = _mm_set1_ps(weight);
+	for (i = 0; i < taps; i += 4) {
+		__m128 kernel = _mm_add_ps(_mm_loadu_ps(&row[i]), _mm_mul_ps(_mm_loadu_ps(&slope[i]), mix));
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(&input[i]), kernel));
+	}
+	sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+	sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+	return _mm_cvtss_f32(sum);
+#elif defined(__ARM_NEON)
+	float32x4_t sum = vdupq_n_f32(0);
+	for (i = 0; i < taps; i += 4) {
+		float32x4_t kernel = vmlaq_n_f32(vld1q_f32(&row[i]), vld1q_f32(&slope[i]), weight);
+		sum = vmlaq_f32(sum, vld1q_f32(&input[i]), kernel);
+	}
+#ifdef __aarch64__
+	return vaddvq_f32(sum);
+#else
+	float32x2_t half = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+	return vget_lane_f32(vpadd_f32(half, half), 0);
+#endif
+#else
+	float sum = 0;
+	for (i = 0; i < taps; ++i) {
+		sum += input[i] * (row[i] + slope[i] * weight);
+	}
+	return sum;
+#endif
+}
+
+double mInterpolatorPolyphaseResample(const struct mInterpolatorPolyphase* interp, const float* const* input, unsigned channels, int16_t* output, size_t count, double time, double sampleStep) {
+	unsigned taps = interp->taps;
+	int start = 1 - (int) taps / 2;
+	size_t i;
+	for (i = 0; i < count; ++i, time += sampleStep) {
+		int index = time;
+		double position = (time - index) * interp->phases;
+		unsigned phase = position;
+		float weight = position - phase;
+		const float* row = &interp->bank[phase * taps];
+		const float* slope = &interp->slope[phase * taps];
+		unsigned channel;
+		for (channel = 0; channel < channels; ++channel) {
+			float sample = _polyphaseApply(&input[channel][index + start], row, slope, weight, taps);
+			output[i * channels + channel] = _polyphaseClamp(sample);
+		}
+	}
+	return time;
+}
+
+int16_t mInterpolatorPolyphaseInterpolate(const struct mInterpolator* interpolator, const struct mInterpolationData* data, double time, double sampleStep) {
+	UNUSED(sampleStep);
+	struct mInterpolatorPolyphase* interp = (struct mInterpolatorPolyphase*) interpolator;
+	float samples[mPOLYPHASE_MAX_TAPS];
+	const float* input = samples;
+	int index = floor(time);
+	int start = 1 - (int) interp->taps / 2;
+	unsigned i;
+	for (i = 0; i < interp->taps; ++i) {
+		samples[i] = data->at(index + start + (int) i, data->context);
+	}
+	int16_t sample;
+	mInterpolatorPolyphaseResample(interp, &input, 1, &sample, 1, time - index - start, 0);
+	return sample;
+}
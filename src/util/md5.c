@@ -21,28 +21,6 @@
 #define C 0x98BADCFE
 #define D 0x10325476
 
-static const uint32_t S[] = { 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
-                              5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20,
-                              4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
-                              6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21 };
-
-static const uint32_t K[] = { 0xD76AA478, 0xE8C7B756, 0x242070DB, 0xC1BDCEEE,
-                              0xF57C0FAF, 0x4787C62A, 0xA8304613, 0xFD469501,
-                              0x698098D8, 0x8B44F7AF, 0xFFFF5BB1, 0x895CD7BE,
-                              0x6B901122, 0xFD987193, 0xA679438E, 0x49B40821,
-                              0xF61E2562, 0xC040B340, 0x265E5A51, 0xE9B6C7AA,
-                              0xD62F105D, 0x02441453, 0xD8A1E681, 0xE7D3FBC8,
-                              0x21E1CDE6, 0xC33707D6, 0xF4D50D87, 0x455A14ED,
-                              0xA9E3E905, 0xFCEFA3F8, 0x676F02D9, 0x8D2A4C8A,
-                              0xFFFA3942, 0x8771F681, 0x6D9D6122, 0xFDE5380C,
-                              0xA4BEEA44, 0x4BDECFA9, 0xF6BB4B60, 0xBEBFBC70,
-                              0x289B7EC6, 0xEAA127FA, 0xD4EF3085, 0x04881D05,
-                              0xD9D4D039, 0xE6DB99E5, 0x1FA27CF8, 0xC4AC5665,
-                              0xF4292244, 0x432AFF97, 0xAB9423A7, 0xFC93A039,
-                              0x655B59C3, 0x8F0CCC92, 0xFFEFF47D, 0x85845DD1,
-                              0x6FA87E4F, 0xFE2CE6E0, 0xA3014314, 0x4E0811A1,
-                              0xF7537E82, 0xBD3AF235, 0x2AD7D2BB, 0xEB86D391 };
-
 /*
  * Padding used to make the size (in bits) of the input congruent to 448 mod 512
  */
@@ -56,64 +34,116 @@ static const uint8_t PADDING[] = { 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0
                                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
 
 /*
- * Bit-manipulation functions defined by the MD5 algorithm
+ * Bit-manipulation functions defined by the MD5 algorithm, rearranged to need fewer operations
  */
-#define F(X, Y, Z) (((X) & (Y)) | (~(X) & (Z)))
-#define G(X, Y, Z) (((X) & (Z)) | ((Y) & ~(Z)))
+#define F(X, Y, Z) ((((Y) ^ (Z)) & (X)) ^ (Z))
+#define G(X, Y, Z) ((((X) ^ (Y)) & (Z)) ^ (Y))
 #define H(X, Y, Z) ((X) ^ (Y) ^ (Z))
 #define I(X, Y, Z) ((Y) ^ ((X) | ~(Z)))
 
 /*
  * Rotates a 32-bit word left by n bits
  */
-static uint32_t rotateLeft(uint32_t x, uint32_t n) {
+static inline uint32_t rotateLeft(uint32_t x, uint32_t n) {
 	return (x << n) | (x >> (32 - n));
 }
 
+#define MD5_STEP(FN, W, X, Y, Z, IN, SHIFT, K) \
+	W = rotateLeft(W + FN(X, Y, Z) + (IN) + (K), SHIFT) + X;
+
 /*
- * Step on 512 bits of input with the main MD5 algorithm.
+ * Step on 512 bits of input with the main MD5 algorithm, fully unrolled
  */
-static void md5Step(uint32_t* buffer, const uint32_t* input) {
-	uint32_t AA = buffer[0];
-	uint32_t BB = buffer[1];
-	uint32_t CC = buffer[2];
-	uint32_t DD = buffer[3];
-
-	uint32_t E;
-
-	unsigned j;
-
-	for (unsigned i = 0; i < 64; ++i) {
-		switch (i / 16) {
-		case 0:
-			E = F(BB, CC, DD);
-			j = i & 0xF;
-			break;
-		case 1:
-			E = G(BB, CC, DD);
-			j = ((i * 5) + 1) & 0xF;
-			break;
-		case 2:
-			E = H(BB, CC, DD);
-			j = ((i * 3) + 5) & 0xF;
-			break;
-		default:
-			E = I(BB, CC, DD);
-			j = (i * 7) & 0xF;
-			break;
-		}
-
-		uint32_t temp = DD;
-		DD = CC;
-		CC = BB;
-		BB += rotateLeft(AA + E + K[i] + input[j], S[i]);
-		AA = temp;
+static void md5Step(uint32_t* buffer, const uint8_t* input) {
+	uint32_t x[16];
+	memcpy(x, input, sizeof(x));
+	unsigned i;
+	for (i = 0; i < 16; ++i) {
+		// Convert from little-endian; this is a no-op on little-endian hosts
+		LOAD_32LE(x[i], i * 4, x);
 	}
 
-	buffer[0] += AA;
-	buffer[1] += BB;
-	buffer[2] += CC;
-	buffer[3] += DD;
+	uint32_t a = buffer[0];
+	uint32_t b = buffer[1];
+	uint32_t c = buffer[2];
+	uint32_t d = buffer[3];
+
+	// Round 1
+	MD5_STEP(F, a, b, c, d, x[0], 7, 0xD76AA478);
+	MD5_STEP(F, d, a, b, c, x[1], 12, 0xE8C7B756);
+	MD5_STEP(F, c, d, a, b, x[2], 17, 0x242070DB);
+	MD5_STEP(F, b, c, d, a, x[3], 22, 0xC1BDCEEE);
+	MD5_STEP(F, a, b, c, d, x[4], 7, 0xF57C0FAF);
+	MD5_STEP(F, d, a, b, c, x[5], 12, 0x4787C62A);
+	MD5_STEP(F, c, d, a, b, x[6], 17, 0xA8304613);
+	MD5_STEP(F, b, c, d, a, x[7], 22, 0xFD469501);
+	MD5_STEP(F, a, b, c, d, x[8], 7, 0x698098D8);
+	MD5_STEP(F, d, a, b, c, x[9], 12, 0x8B44F7AF);
+	MD5_STEP(F, c, d, a, b, x[10], 17, 0xFFFF5BB1);
+	MD5_STEP(F, b, c, d, a, x[11], 22, 0x895CD7BE);
+	MD5_STEP(F, a, b, c, d, x[12], 7, 0x6B901122);
+	MD5_STEP(F, d, a, b, c, x[13], 12, 0xFD987193);
+	MD5_STEP(F, c, d, a, b, x[14], 17, 0xA679438E);
+	MD5_STEP(F, b, c, d, a, x[15], 22, 0x49B40821);
+
+	// Round 2
+	MD5_STEP(G, a, b, c, d, x[1], 5, 0xF61E2562);
+	MD5_STEP(G, d, a, b, c, x[6], 9, 0xC040B340);
+	MD5_STEP(G, c, d, a, b, x[11], 14, 0x265E5A51);
+	MD5_STEP(G, b, c, d, a, x[0], 20, 0xE9B6C7AA);
+	MD5_STEP(G, a, b, c, d, x[5], 5, 0xD62F105D);
+	MD5_STEP(G, d, a, b, c, x[10], 9, 0x02441453);
+	MD5_STEP(G, c, d, a, b, x[15], 14, 0xD8A1E681);
+	MD5_STEP(G, b, c, d, a, x[4], 20, 0xE7D3FBC8);
+	MD5_STEP(G, a, b, c, d, x[9], 5, 0x21E1CDE6);
+	MD5_STEP(G, d, a, b, c, x[14], 9, 0xC33707D6);
+	MD5_STEP(G, c, d, a, b, x[3], 14, 0xF4D50D87);
+	MD5_STEP(G, b, c, d, a, x[8], 20, 0x455A14ED);
+	MD5_STEP(G, a, b, c, d, x[13], 5, 0xA9E3E905);
+	MD5_STEP(G, d, a, b, c, x[2], 9, 0xFCEFA3F8);
+	MD5_STEP(G, c, d, a, b, x[7], 14, 0x676F02D9);
+	MD5_STEP(G, b, c, d, a, x[12], 20, 0x8D2A4C8A);
+
+	// Round 3
+	MD5_STEP(H, a, b, c, d, x[5], 4, 0xFFFA3942);
+	MD5_STEP(H, d, a, b, c, x[8], 11, 0x8771F681);
+	MD5_STEP(H, c, d, a, b, x[11], 16, 0x6D9D6122);
+	MD5_STEP(H, b, c, d, a, x[14], 23, 0xFDE5380C);
+	MD5_STEP(H, a, b, c, d, x[1], 4, 0xA4BEEA44);
+	MD5_STEP(H, d, a, b, c, x[4], 11, 0x4BDECFA9);
+	MD5_STEP(H, c, d, a, b, x[7], 16, 0xF6BB4B60);
+	MD5_STEP(H, b, c, d, a, x[10], 23, 0xBEBFBC70);
+	MD5_STEP(H, a, b, c, d, x[13], 4, 0x289B7EC6);
+	MD5_STEP(H, d, a, b, c, x[0], 11, 0xEAA127FA);
+	MD5_STEP(H, c, d, a, b, x[3], 16, 0xD4EF3085);
+	MD5_STEP(H, b, c, d, a, x[6], 23, 0x04881D05);
+	MD5_STEP(H, a, b, c, d, x[9], 4, 0xD9D4D039);
+	MD5_STEP(H, d, a, b, c, x[12], 11, 0xE6DB99E5);
+	MD5_STEP(H, c, d, a, b, x[15], 16, 0x1FA27CF8);
+	MD5_STEP(H, b, c, d, a, x[2], 23, 0xC4AC5665);
+
+	// Round 4
+	MD5_STEP(I, a, b, c, d, x[0], 6, 0xF4292244);
+	MD5_STEP(I, d, a, b, c, x[7], 10, 0x432AFF97);
+	MD5_STEP(I, c, d, a, b, x[14], 15, 0xAB9423A7);
+	MD5_STEP(I, b, c, d, a, x[5], 21, 0xFC93A039);
+	MD5_STEP(I, a, b, c, d, x[12], 6, 0x655B59C3);
+	MD5_STEP(I, d, a, b, c, x[3], 10, 0x8F0CCC92);
+	MD5_STEP(I, c, d, a, b, x[10], 15, 0xFFEFF47D);
+	MD5_STEP(I, b, c, d, a, x[1], 21, 0x85845DD1);
+	MD5_STEP(I, a, b, c, d, x[8], 6, 0x6FA87E4F);
+	MD5_STEP(I, d, a, b, c, x[15], 10, 0xFE2CE6E0);
+	MD5_STEP(I, c, d, a, b, x[6], 15, 0xA3014314);
+	MD5_STEP(I, b, c, d, a, x[13], 21, 0x4E0811A1);
+	MD5_STEP(I, a, b, c, d, x[4], 6, 0xF7537E82);
+	MD5_STEP(I, d, a, b, c, x[11], 10, 0xBD3AF235);
+	MD5_STEP(I, c, d, a, b, x[2], 15, 0x2AD7D2BB);
+	MD5_STEP(I, b, c, d, a, x[9], 21, 0xEB86D391);
+
+	buffer[0] += a;
+	buffer[1] += b;
+	buffer[2] += c;
+	buffer[3] += d;
 }
 
 /*
@@ -131,39 +161,30 @@ void md5Init(struct MD5Context* ctx) {
 /*
  * Add some amount of input to the context
  *
- * If the input fills out a block of 512 bits, apply the algorithm (md5Step)
- * and save the result in the buffer. Also updates the overall size.
+ * Whole blocks of 512 bits are run through the algorithm (md5Step) straight from the input,
+ * and anything left over is kept in the context for later. Also updates the overall size.
  */
 void md5Update(struct MD5Context* ctx, const void* input, size_t len) {
-	uint32_t buffer[16];
 	unsigned offset = ctx->size & 0x3F;
 	const uint8_t* inputBuffer = input;
 	ctx->size += len;
 
-	// Copy each byte in input_buffer into the next space in our context input
-	unsigned i;
-	for (i = 0; i < len; ++i) {
-		ctx->input[offset] = inputBuffer[i];
-
-		// If we've filled our context input, copy it into our local array input
-		// then reset the offset to 0 and fill in a new buffer.
-		// Every time we fill out a chunk, we run it through the algorithm
-		// to enable some back and forth between cpu and i/o
-		if (offset < 0x3F) {
-			++offset;
-			continue;
-		}
-
-		unsigned j;
-		for (j = 0; j < 16; ++j) {
-			// Convert to little-endian
-			// The local variable `input` our 512-bit chunk separated into 32-bit words
-			// we can use in calculations
-			LOAD_32LE(buffer[j], j * 4, ctx->input);
+	if (offset) {
+		// Top up the partial block left over from before
+		size_t fill = 0x40 - offset;
+		if (len < fill) {
+			memcpy(&ctx->input[offset], inputBuffer, len);
+			return;
 		}
-		md5Step(ctx->buffer, buffer);
-		offset = 0;
+		memcpy(&ctx->input[offset], inputBuffer, fill);
+		md5Step(ctx->buffer, ctx->input);
+		inputBuffer += fill;
+		len -= fill;
 	}
+	for (; len >= 0x40; len -= 0x40, inputBuffer += 0x40) {
+		md5Step(ctx->buffer, inputBuffer);
+	}
+	memcpy(ctx->input, inputBuffer, len);
 }
 
 /*
@@ -171,7 +192,6 @@ void md5Update(struct MD5Context* ctx, const void* input, size_t len) {
  * and save the result of the final iteration into digest.
  */
 void md5Finalize(struct MD5Context* ctx) {
-	uint32_t input[16];
 	int offset = ctx->size & 0x3F;
 	unsigned paddingLength = offset < 56 ? 56 - offset : (56 + 64) - offset;
 
@@ -181,14 +201,10 @@ void md5Finalize(struct MD5Context* ctx) {
 
 	// Do a final update (internal to this function)
 	// Last two 32-bit words are the two halves of the size (converted from bytes to bits)
-	unsigned j;
-	for (j = 0; j < 14; ++j) {
-		LOAD_32LE(input[j], j * 4, ctx->input);
-	}
-	input[14] = (uint32_t) (ctx->size * 8);
-	input[15] = (uint32_t) ((ctx->size * 8ULL) >> 32);
+	STORE_32LE((uint32_t) (ctx->size * 8), 56, ctx->input);
+	STORE_32LE((uint32_t) ((ctx->size * 8ULL) >> 32), 60, ctx->input);
 
-	md5Step(ctx->buffer, input);
+	md5Step(ctx->buffer, ctx->input);
 
 	// Move the result into digest (convert from little-endian)
 	unsigned i;
@@ -207,7 +223,7 @@ void md5Buffer(const void* input, size_t len, uint8_t* result) {
 
 bool md5File(struct VFile* vf, uint8_t* result) {
 	struct MD5Context ctx;
-	uint8_t buffer[2048];
+	uint8_t buffer[0x4000];
 	md5Init(&ctx);
 
 	ssize_t read;
@@ -13,3 +13,47 @@ void mappedMemoryFree(void* memory, size_t size) {
 	UNUSED(size);
 	free(memory);
 }
+
+void* hugeMemoryMap(size_t size) {
+	return anonymousMemoryMap(size);
+}
+
+void hugeMemoryFree(void* memory, size_t size) {
+	mappedMemoryFree(memory, size);
+}
+
+void mappedMemoryAdvise(void* memory, size_t size, int advice) {
+	if (advice & mMEMORY_ADVICE_PREFAULT) {
+		volatile uint8_t* bytes = memory;
+		size_t i;
+		for (i = 0; i < size; i += 0x1000) {
+			bytes[i] = bytes[i];
+		}
+	}
+}
+
+size_t mappedMemoryResident(const void* memory, size_t size) {
+	UNUSED(memory);
+	return size;
+}
+
+bool sharedMemoryCreate(struct SharedMemory* memory, size_t size) {
+	UNUSED(memory);
+	UNUSED(size);
+	return false;
+}
+
+void sharedMemoryDestroy(struct SharedMemory* memory) {
+	UNUSED(memory);
+}
+
+void* sharedMemoryMap(const struct SharedMemory* memory, bool copyOnWrite) {
+	UNUSED(memory);
+	UNUSED(copyOnWrite);
+	return NULL;
+}
+
+void sharedMemoryUnmap(const struct SharedMemory* memory, void* mapping) {
+	UNUSED(memory);
+	UNUSED(mapping);
+}
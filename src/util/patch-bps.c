@@ -0,0 +1,268 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba-util/patch/bps.h>
+
+#include <mgba-util/crc32.h>
+#include <mgba-util/patch.h>
+#include <mgba-util/vfs.h>
+
+enum {
+	IN_CHECKSUM = -12,
+	OUT_CHECKSUM = -8,
+	PATCH_CHECKSUM = -4,
+
+	BUFFER_SIZE = 0x1000
+};
+
+// Patches for large ROM hacks hold millions of commands, so they are read through a
+// buffer instead of going back to the VFile for every varint
+struct BPSStream {
+	struct VFile* vf;
+	size_t remaining;
+	size_t offset;
+	size_t size;
+	uint8_t block[BUFFER_SIZE];
+};
+
+static size_t _BPSOutputSize(struct Patch* patch, size_t inSize);
+static bool _BPSApplyPatch(struct Patch* patch, const void* in, size_t inSize, void* out, size_t outSize);
+
+static bool _streamInit(struct BPSStream* stream, struct VFile* vf);
+static bool _streamRead(struct BPSStream* stream, void* out, size_t length);
+static bool _streamSkip(struct BPSStream* stream, size_t length);
+static bool _decodeLength(struct BPSStream* stream, size_t* value);
+
+bool loadPatchBPS(struct Patch* patch) {
+	patch->vf->seek(patch->vf, 0, SEEK_SET);
+
+	char buffer[4];
+	if (patch->vf->read(patch->vf, buffer, 4) != 4) {
+		return false;
+	}
+
+	if (memcmp(buffer, "BPS1", 4) != 0) {
+		return false;
+	}
+
+	ssize_t filesize = patch->vf->size(patch->vf);
+	if (filesize < 4 - IN_CHECKSUM) {
+		return false;
+	}
+
+	uint32_t goodCrc32;
+	patch->vf->seek(patch->vf, PATCH_CHECKSUM, SEEK_END);
+	if (patch->vf->read(patch->vf, &goodCrc32, 4) != 4) {
+		return false;
+	}
+
+	uint32_t crc = fileCrc32(patch->vf, filesize + PATCH_CHECKSUM);
+	if (crc != goodCrc32) {
+		return false;
+	}
+
+	patch->outputSize = _BPSOutputSize;
+	patch->applyPatch = _BPSApplyPatch;
+	return true;
+}
+
+size_t _BPSOutputSize(struct Patch* patch, size_t inSize) {
+	struct BPSStream stream;
+	if (!_streamInit(&stream, patch->vf)) {
+		return 0;
+	}
+	size_t sourceSize;
+	size_t targetSize;
+	if (!_decodeLength(&stream, &sourceSize) || sourceSize != inSize) {
+		return 0;
+	}
+	if (!_decodeLength(&stream, &targetSize)) {
+		return 0;
+	}
+	return targetSize;
+}
+
+bool _BPSApplyPatch(struct Patch* patch, const void* in, size_t inSize, void* out, size_t outSize) {
+	patch->vf->seek(patch->vf, IN_CHECKSUM, SEEK_END);
+	uint32_t expectedInChecksum;
+	uint32_t expectedOutChecksum;
+	if (patch->vf->read(patch->vf, &expectedInChecksum, sizeof(expectedInChecksum)) != sizeof(expectedInChecksum)) {
+		return false;
+	}
+	if (patch->vf->read(patch->vf, &expectedOutChecksum, sizeof(expectedOutChecksum)) != sizeof(expectedOutChecksum)) {
+		return false;
+	}
+
+	uint32_t inputChecksum = doCrc32(in, inSize);
+	uint32_t outputChecksum = 0;
+
+	if (inputChecksum != expectedInChecksum) {
+		return false;
+	}
+	if (inSize > SSIZE_MAX || outSize > SSIZE_MAX) {
+		return false;
+	}
+
+	struct BPSStream stream;
+	if (!_streamInit(&stream, patch->vf)) {
+		return false;
+	}
+	size_t length;
+	if (!_decodeLength(&stream, &length)) { // Discard input size
+		return false;
+	}
+	if (!_decodeLength(&stream, &length) || length != outSize) {
+		return false;
+	}
+	if (!_decodeLength(&stream, &length) || !_streamSkip(&stream, length)) { // Skip metadata
+		return false;
+	}
+
+	size_t writeLocation = 0;
+	ssize_t readSourceLocation = 0;
+	ssize_t readTargetLocation = 0;
+	size_t readOffset;
+	uint8_t* writeBuffer = out;
+	const uint8_t* readBuffer = in;
+	while (stream.remaining || stream.offset < stream.size) {
+		size_t command;
+		if (!_decodeLength(&stream, &command)) {
+			return false;
+		}
+		length = (command >> 2) + 1;
+		if (writeLocation + length > outSize) {
+			return false;
+		}
+		size_t i;
+		switch (command & 0x3) {
+		case 0x0:
+			// SourceRead
+			if (writeLocation + length > inSize) {
+				return false;
+			}
+			memmove(&writeBuffer[writeLocation], &readBuffer[writeLocation], length);
+			break;
+		case 0x1:
+			// TargetRead
+			if (!_streamRead(&stream, &writeBuffer[writeLocation], length)) {
+				return false;
+			}
+			break;
+		case 0x2:
+			// SourceCopy
+			if (!_decodeLength(&stream, &readOffset)) {
+				return false;
+			}
+			if (readOffset & 1) {
+				readSourceLocation -= readOffset >> 1;
+			} else {
+				readSourceLocation += readOffset >> 1;
+			}
+			if (readSourceLocation < 0 || (size_t) readSourceLocation + length > inSize) {
+				return false;
+			}
+			memmove(&writeBuffer[writeLocation], &readBuffer[readSourceLocation], length);
+			readSourceLocation += length;
+			break;
+		case 0x3:
+			// TargetCopy
+			if (!_decodeLength(&stream, &readOffset)) {
+				return false;
+			}
+			if (readOffset & 1) {
+				readTargetLocation -= readOffset >> 1;
+			} else {
+				readTargetLocation += readOffset >> 1;
+			}
+			if (readTargetLocation < 0 || (size_t) readTargetLocation >= writeLocation) {
+				return false;
+			}
+			for (i = 0; i < length; ++i) {
+				// This needs to be bytewise as it can overlap
+				writeBuffer[writeLocation + i] = writeBuffer[readTargetLocation];
+				++readTargetLocation;
+			}
+			break;
+		}
+		outputChecksum = crc32(outputChecksum, &writeBuffer[writeLocation], length);
+		writeLocation += length;
+	}
+	if (expectedOutChecksum != outputChecksum) {
+		return false;
+	}
+	return true;
+}
+
+bool _streamInit(struct BPSStream* stream, struct VFile* vf) {
+	ssize_t filesize = vf->size(vf);
+	if (filesize < 4 - IN_CHECKSUM) {
+		return false;
+	}
+	stream->vf = vf;
+	stream->remaining = filesize + IN_CHECKSUM - 4;
+	stream->offset = 0;
+	stream->size = 0;
+	return vf->seek(vf, 4, SEEK_SET) == 4;
+}
+
+static bool _streamFill(struct BPSStream* stream) {
+	size_t size = sizeof(stream->block);
+	if (size > stream->remaining) {
+		size = stream->remaining;
+	}
+	if (!size) {
+		return false;
+	}
+	ssize_t read = stream->vf->read(stream->vf, stream->block, size);
+	if (read < 1) {
+		return false;
+	}
+	stream->remaining -= read;
+	stream->offset = 0;
+	stream->size = read;
+	return true;
+}
+
+bool _streamRead(struct BPSStream* stream, void* out, size_t length) {
+	uint8_t* buffer = out;
+	while (length) {
+		if (stream->offset == stream->size && !_streamFill(stream)) {
+			return false;
+		}
+		size_t chunk = stream->size - stream->offset;
+		if (chunk > length) {
+			chunk = length;
+		}
+		if (buffer) {
+			memcpy(buffer, &stream->block[stream->offset], chunk);
+			buffer += chunk;
+		}
+		stream->offset += chunk;
+		length -= chunk;
+	}
+	return true;
+}
+
+bool _streamSkip(struct BPSStream* stream, size_t length) {
+	return _streamRead(stream, NULL, length);
+}
+
+bool _decodeLength(struct BPSStream* stream, size_t* value) {
+	size_t shift = 1;
+	*value = 0;
+	while (true) {
+		if (stream->offset == stream->size && !_streamFill(stream)) {
+			return false;
+		}
+		uint8_t byte = stream->block[stream->offset];
+		++stream->offset;
+		*value += (byte & 0x7f) * shift;
+		if (byte & 0x80) {
+			return true;
+		}
+		shift <<= 7;
+		*value += shift;
+	}
+}
@@ -5,11 +5,112 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba-util/patch/fast.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 DEFINE_VECTOR(PatchFastExtents, struct PatchFastExtent);
 
 size_t _fastOutputSize(struct Patch* patch, size_t inSize);
 bool _fastApplyPatch(struct Patch* patch, const void* in, size_t inSize, void* out, size_t outSize);
 
+// Diffing works on 16-byte blocks, which map directly onto a vector register where available
+#if defined(__SSE2__)
+typedef __m128i _PatchFastBlock;
+
+static inline _PatchFastBlock _xorBlock(const void* a, const void* b) {
+	return _mm_xor_si128(_mm_loadu_si128(a), _mm_loadu_si128(b));
+}
+
+static inline _PatchFastBlock _orBlock(_PatchFastBlock a, _PatchFastBlock b) {
+	return _mm_or_si128(a, b);
+}
+
+static inline bool _blockIsZero(_PatchFastBlock block) {
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_setzero_si128())) == 0xFFFF;
+}
+
+static inline void _storeBlock(void* dest, _PatchFastBlock block) {
+	_mm_storeu_si128(dest, block);
+}
+#elif defined(__ARM_NEON)
+typedef uint32x4_t _PatchFastBlock;
+
+static inline _PatchFastBlock _xorBlock(const void* a, const void* b) {
+	return vreinterpretq_u32_u8(veorq_u8(vld1q_u8(a), vld1q_u8(b)));
+}
+
+static inline _PatchFastBlock _orBlock(_PatchFastBlock a, _PatchFastBlock b) {
+	return vorrq_u32(a, b);
+}
+
+static inline bool _blockIsZero(_PatchFastBlock block) {
+#ifdef __aarch64__
+	return !vmaxvq_u32(block);
+#else
+	uint32x2_t half = vorr_u32(vget_low_u32(block), vget_high_u32(block));
+	return !(vget_lane_u32(half, 0) | vget_lane_u32(half, 1));
+#endif
+}
+
+static inline void _storeBlock(void* dest, _PatchFastBlock block) {
+	vst1q_u8(dest, vreinterpretq_u8_u32(block));
+}
+#else
+typedef struct {
+	uint32_t w[4];
+} _PatchFastBlock;
+
+static inline _PatchFastBlock _xorBlock(const void* a, const void* b) {
+	_PatchFastBlock block;
+	uint32_t wb[4];
+	memcpy(block.w, a, sizeof(block.w));
+	memcpy(wb, b, sizeof(wb));
+	block.w[0] ^= wb[0];
+	block.w[1] ^= wb[1];
+	block.w[2] ^= wb[2];
+	block.w[3] ^= wb[3];
+	return block;
+}
+
+static inline _PatchFastBlock _orBlock(_PatchFastBlock a, _PatchFastBlock b) {
+	a.w[0] |= b.w[0];
+	a.w[1] |= b.w[1];
+	a.w[2] |= b.w[2];
+	a.w[3] |= b.w[3];
+	return a;
+}
+
+static inline bool _blockIsZero(_PatchFastBlock block) {
+	return !(block.w[0] | block.w[1] | block.w[2] | block.w[3]);
+}
+
+static inline void _storeBlock(void* dest, _PatchFastBlock block) {
+	memcpy(dest, block.w, sizeof(block.w));
+}
+#endif
+
+// Returns how many bytes at the start of the buffers are identical, in whole blocks.
+// Unchanged runs are by far the common case, so this checks four blocks at a time.
+static size_t _skipIdentical(const uint8_t* in, const uint8_t* out, size_t size) {
+	size_t off = 0;
+	for (; off + 64 <= size; off += 64) {
+		_PatchFastBlock a = _orBlock(_xorBlock(&in[off], &out[off]), _xorBlock(&in[off + 16], &out[off + 16]));
+		_PatchFastBlock b = _orBlock(_xorBlock(&in[off + 32], &out[off + 32]), _xorBlock(&in[off + 48], &out[off + 48]));
+		if (!_blockIsZero(_orBlock(a, b))) {
+			break;
+		}
+	}
+	for (; off < size; off += 16) {
+		if (!_blockIsZero(_xorBlock(&in[off], &out[off]))) {
+			break;
+		}
+	}
+	return off;
+}
+
 void initPatchFast(struct PatchFast* patch) {
 	PatchFastExtentsInit(&patch->extents, 32);
 	patch->d.outputSize = _fastOutputSize;
@@ -22,28 +123,36 @@ void deinitPatchFast(struct PatchFast* patch) {
 
 bool diffPatchFast(struct PatchFast* patch, const void* restrict in, const void* restrict out, size_t size) {
 	PatchFastExtentsClear(&patch->extents);
-	const uint32_t* iptr = in;
-	const uint32_t* optr = out;
+	return diffPatchFastRange(patch, in, out, 0, size);
+}
+
+bool diffPatchFastRange(struct PatchFast* patch, const void* restrict in, const void* restrict out, size_t offset, size_t size) {
+	const uint8_t* iptr = (const uint8_t*) in + offset;
+	const uint8_t* optr = (const uint8_t*) out + offset;
 	size_t extentOff = 0;
 	struct PatchFastExtent* extent = NULL;
-	size_t off;
-	for (off = 0; off < (size & ~15); off += 16) {
-		uint32_t a = iptr[0] ^ optr[0];
-		uint32_t b = iptr[1] ^ optr[1];
-		uint32_t c = iptr[2] ^ optr[2];
-		uint32_t d = iptr[3] ^ optr[3];
-		iptr += 4;
-		optr += 4;
-		if (a | b | c | d) {
+	size_t off = offset;
+	size_t end = offset + (size & ~15);
+	while (off < end) {
+		if (!extent) {
+			size_t skipped = _skipIdentical(iptr, optr, end - off);
+			off += skipped;
+			iptr += skipped;
+			optr += skipped;
+			if (off >= end) {
+				break;
+			}
+		}
+		_PatchFastBlock diff = _xorBlock(iptr, optr);
+		iptr += 16;
+		optr += 16;
+		if (!_blockIsZero(diff)) {
 			if (!extent) {
 				extent = PatchFastExtentsAppend(&patch->extents);
 				extent->offset = off;
 				extentOff = 0;
 			}
-			extent->extent[extentOff] = a;
-			extent->extent[extentOff + 1] = b;
-			extent->extent[extentOff + 2] = c;
-			extent->extent[extentOff + 3] = d;
+			_storeBlock(&extent->extent[extentOff], diff);
 			extentOff += 4;
 			if (extentOff == PATCH_FAST_EXTENT) {
 				extent->length = extentOff * 4;
@@ -53,21 +162,21 @@ bool diffPatchFast(struct PatchFast* patch, const void* restrict in, const void*
 			extent->length = extentOff * 4;
 			extent = NULL;
 		}
+		off += 16;
 	}
 	if (extent) {
 		extent->length = extentOff * 4;
 		extent = NULL;
 	}
-	const uint32_t* iptr8 = iptr;
-	const uint32_t* optr8 = optr;
-	for (; off < size; ++off) {
-		uint8_t a = iptr8[0] ^ optr8[0];
-		++iptr8;
-		++optr8;
+	for (; off < offset + size; ++off) {
+		uint8_t a = iptr[0] ^ optr[0];
+		++iptr;
+		++optr;
 		if (a) {
 			if (!extent) {
 				extent = PatchFastExtentsAppend(&patch->extents);
 				extent->offset = off;
+				extentOff = 0;
 			}
 			((uint8_t*) extent->extent)[extentOff] = a;
 			++extentOff;
@@ -84,6 +193,16 @@ bool diffPatchFast(struct PatchFast* patch, const void* restrict in, const void*
 	return true;
 }
 
+void appendPatchFast(struct PatchFast* patch, const struct PatchFast* other) {
+	size_t count = PatchFastExtentsSize(&other->extents);
+	if (!count) {
+		return;
+	}
+	size_t base = PatchFastExtentsSize(&patch->extents);
+	PatchFastExtentsResize(&patch->extents, count);
+	memcpy(PatchFastExtentsGetPointer(&patch->extents, base), PatchFastExtentsGetConstPointer(&other->extents, 0), count * sizeof(struct PatchFastExtent));
+}
+
 size_t _fastOutputSize(struct Patch* patch, size_t inSize) {
 	UNUSED(patch);
 	return inSize;
@@ -94,8 +213,8 @@ bool _fastApplyPatch(struct Patch* p, const void* in, size_t inSize, void* out,
 	if (inSize != outSize) {
 		return false;
 	}
-	const uint32_t* iptr = in;
-	uint32_t* optr = out;
+	const uint8_t* iptr = in;
+	uint8_t* optr = out;
 	size_t lastWritten = 0;
 	size_t s;
 	for (s = 0; s < PatchFastExtentsSize(&patch->extents); ++s) {
@@ -104,26 +223,19 @@ bool _fastApplyPatch(struct Patch* p, const void* in, size_t inSize, void* out,
 			return false;
 		}
 		memcpy(optr, iptr, extent->offset - lastWritten);
-		optr = (uint32_t*) out + extent->offset / 4;
-		iptr = (uint32_t*) in + extent->offset / 4;
-		uint32_t* eptr = extent->extent;
+		optr = (uint8_t*) out + extent->offset;
+		iptr = (const uint8_t*) in + extent->offset;
+		const uint8_t* eptr = (const uint8_t*) extent->extent;
 		size_t off;
 		for (off = 0; off < (extent->length & ~15); off += 16) {
-			optr[0] = iptr[0] ^ eptr[0];
-			optr[1] = iptr[1] ^ eptr[1];
-			optr[2] = iptr[2] ^ eptr[2];
-			optr[3] = iptr[3] ^ eptr[3];
-			optr += 4;
-			iptr += 4;
-			eptr += 4;
+			_storeBlock(&optr[off], _xorBlock(&iptr[off], &eptr[off]));
 		}
 		for (; off < extent->length; ++off) {
-			*(uint8_t*) optr = *(uint8_t*) iptr ^ *(uint8_t*) eptr;
-			++optr;
-			++iptr;
-			++eptr;
+			optr[off] = iptr[off] ^ eptr[off];
 		}
 		lastWritten = extent->offset + off;
+		optr = (uint8_t*) out + lastWritten;
+		iptr = (const uint8_t*) in + lastWritten;
 	}
 	memcpy(optr, iptr, outSize - lastWritten);
 	return true;
@@ -3,7 +3,7 @@
  * This Source Code Form is subject to the terms of the Mozilla Public
  * License, v. 2.0. If a copy of the MPL was not distributed with this
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
-#include <mgba-util/patch/ips.h>
+#include <mgba-util/patch/ups.h>
 
 #include <mgba-util/circle-buffer.h>
 #include <mgba-util/crc32.h>
@@ -21,7 +21,6 @@ enum {
 static size_t _UPSOutputSize(struct Patch* patch, size_t inSize);
 
 static bool _UPSApplyPatch(struct Patch* patch, const void* in, size_t inSize, void* out, size_t outSize);
-static bool _BPSApplyPatch(struct Patch* patch, const void* in, size_t inSize, void* out, size_t outSize);
 
 static size_t _decodeLength(struct VFile* vf, struct mCircleBuffer* buffer);
 
@@ -33,11 +32,7 @@ bool loadPatchUPS(struct Patch* patch) {
 		return false;
 	}
 
-	if (memcmp(buffer, "UPS1", 4) == 0) {
-		patch->applyPatch = _UPSApplyPatch;
-	} else if (memcmp(buffer, "BPS1", 4) == 0) {
-		patch->applyPatch = _BPSApplyPatch;
-	} else {
+	if (memcmp(buffer, "UPS1", 4) != 0) {
 		return false;
 	}
 
@@ -55,6 +50,7 @@ bool loadPatchUPS(struct Patch* patch) {
 	}
 
 	patch->outputSize = _UPSOutputSize;
+	patch->applyPatch = _UPSApplyPatch;
 	return true;
 }
 
@@ -127,102 +123,6 @@ bool _UPSApplyPatch(struct Patch* patch, const void* in, size_t inSize, void* ou
 	return true;
 }
 
-bool _BPSApplyPatch(struct Patch* patch, const void* in, size_t inSize, void* out, size_t outSize) {
-	patch->vf->seek(patch->vf, IN_CHECKSUM, SEEK_END);
-	uint32_t expectedInChecksum;
-	uint32_t expectedOutChecksum;
-	patch->vf->read(patch->vf, &expectedInChecksum, sizeof(expectedInChecksum));
-	patch->vf->read(patch->vf, &expectedOutChecksum, sizeof(expectedOutChecksum));
-
-	uint32_t inputChecksum = doCrc32(in, inSize);
-	uint32_t outputChecksum = 0;
-
-	if (inputChecksum != expectedInChecksum) {
-		return false;
-	}
-
-	ssize_t filesize = patch->vf->size(patch->vf);
-	patch->vf->seek(patch->vf, 4, SEEK_SET);
-	_decodeLength(patch->vf, NULL); // Discard input size
-	if (_decodeLength(patch->vf, NULL) != outSize) {
-		return false;
-	}
-	if (inSize > SSIZE_MAX || outSize > SSIZE_MAX) {
-		return false;
-	}
-	size_t metadataLength = _decodeLength(patch->vf, NULL);
-	patch->vf->seek(patch->vf, metadataLength, SEEK_CUR); // Skip metadata
-	size_t writeLocation = 0;
-	ssize_t readSourceLocation = 0;
-	ssize_t readTargetLocation = 0;
-	size_t readOffset;
-	uint8_t* writeBuffer = out;
-	const uint8_t* readBuffer = in;
-	while (patch->vf->seek(patch->vf, 0, SEEK_CUR) < filesize + IN_CHECKSUM) {
-		size_t command = _decodeLength(patch->vf, NULL);
-		size_t length = (command >> 2) + 1;
-		if (writeLocation + length > outSize) {
-			return false;
-		}
-		size_t i;
-		switch (command & 0x3) {
-		case 0x0:
-			// SourceRead
-			memmove(&writeBuffer[writeLocation], &readBuffer[writeLocation], length);
-			outputChecksum = crc32(outputChecksum, &writeBuffer[writeLocation], length);
-			writeLocation += length;
-			break;
-		case 0x1:
-			// TargetRead
-			if (patch->vf->read(patch->vf, &writeBuffer[writeLocation], length) != (ssize_t) length) {
-				return false;
-			}
-			outputChecksum = crc32(outputChecksum, &writeBuffer[writeLocation], length);
-			writeLocation += length;
-			break;
-		case 0x2:
-			// SourceCopy
-			readOffset = _decodeLength(patch->vf, NULL);
-			if (readOffset & 1) {
-				readSourceLocation -= readOffset >> 1;
-			} else {
-				readSourceLocation += readOffset >> 1;
-			}
-			if (readSourceLocation < 0 || readSourceLocation > (ssize_t) inSize) {
-				return false;
-			}
-			memmove(&writeBuffer[writeLocation], &readBuffer[readSourceLocation], length);
-			outputChecksum = crc32(outputChecksum, &writeBuffer[writeLocation], length);
-			writeLocation += length;
-			readSourceLocation += length;
-			break;
-		case 0x3:
-			// TargetCopy
-			readOffset = _decodeLength(patch->vf, NULL);
-			if (readOffset & 1) {
-				readTargetLocation -= readOffset >> 1;
-			} else {
-				readTargetLocation += readOffset >> 1;
-			}
-			if (readTargetLocation < 0 || readTargetLocation > (ssize_t) outSize) {
-				return false;
-			}
-			for (i = 0; i < length; ++i) {
-				// This needs to be bytewise as it can overlap
-				writeBuffer[writeLocation] = writeBuffer[readTargetLocation];
-				++writeLocation;
-				++readTargetLocation;
-			}
-			outputChecksum = crc32(outputChecksum, &writeBuffer[writeLocation - length], length);
-			break;
-		}
-	}
-	if (expectedOutChecksum != outputChecksum) {
-		return false;
-	}
-	return true;
-}
-
 size_t _decodeLength(struct VFile* vf, struct mCircleBuffer* buffer) {
 	size_t shift = 1;
 	size_t value = 0;
@@ -5,6 +5,7 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba-util/patch.h>
 
+#include <mgba-util/patch/bps.h>
 #include <mgba-util/patch/ips.h>
 #include <mgba-util/patch/ups.h>
 
@@ -19,6 +20,10 @@ bool loadPatch(struct VFile* vf, struct Patch* patch) {
 		return true;
 	}
 
+	if (loadPatchBPS(patch)) {
+		return true;
+	}
+
 	patch->outputSize = 0;
 	patch->applyPatch = 0;
 	return false;
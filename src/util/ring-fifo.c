@@ -10,12 +10,30 @@
 void RingFIFOInit(struct RingFIFO* buffer, size_t capacity) {
 	buffer->data = anonymousMemoryMap(capacity);
 	buffer->capacity = capacity;
+	MutexInit(&buffer->mutex);
+	ConditionInit(&buffer->cond);
+	buffer->waiting = 0;
 	RingFIFOClear(buffer);
 }
 
 void RingFIFODeinit(struct RingFIFO* buffer) {
 	mappedMemoryFree(buffer->data, buffer->capacity);
 	buffer->data = 0;
+	ConditionDeinit(&buffer->cond);
+	MutexDeinit(&buffer->mutex);
+}
+
+static void _wakeWaiting(struct RingFIFO* buffer) {
+	// The pointer that was just published has to be visible before the check, or a thread
+	// that saw the old pointer just before going to sleep could be missed
+	ATOMIC_FENCE();
+	int waiting;
+	ATOMIC_LOAD(waiting, buffer->waiting);
+	if (waiting) {
+		MutexLock(&buffer->mutex);
+		ConditionWake(&buffer->cond);
+		MutexUnlock(&buffer->mutex);
+	}
 }
 
 size_t RingFIFOCapacity(const struct RingFIFO* buffer) {
@@ -39,7 +57,7 @@ void RingFIFOClear(struct RingFIFO* buffer) {
 	ATOMIC_STORE_PTR(buffer->writePtr, buffer->data);
 }
 
-size_t RingFIFOWrite(struct RingFIFO* buffer, const void* value, size_t length) {
+static size_t _write(struct RingFIFO* buffer, const void* value, size_t length) {
 	void* data = buffer->writePtr;
 	void* end;
 	ATOMIC_LOAD_PTR(end, buffer->readPtr);
@@ -71,7 +89,7 @@ size_t RingFIFOWrite(struct RingFIFO* buffer, const void* value, size_t length)
 	return length;
 }
 
-size_t RingFIFORead(struct RingFIFO* buffer, void* output, size_t length) {
+static size_t _read(struct RingFIFO* buffer, void* output, size_t length) {
 	void* data = buffer->readPtr;
 	void* end;
 	ATOMIC_LOAD_PTR(end, buffer->writePtr);
@@ -102,3 +120,53 @@ size_t RingFIFORead(struct RingFIFO* buffer, void* output, size_t length) {
 	ATOMIC_STORE_PTR(buffer->readPtr, (void*) ((uintptr_t) data + length));
 	return length;
 }
+
+size_t RingFIFOWrite(struct RingFIFO* buffer, const void* value, size_t length) {
+	size_t written = _write(buffer, value, length);
+	if (written) {
+		_wakeWaiting(buffer);
+	}
+	return written;
+}
+
+size_t RingFIFORead(struct RingFIFO* buffer, void* output, size_t length) {
+	size_t read = _read(buffer, output, length);
+	if (read) {
+		_wakeWaiting(buffer);
+	}
+	return read;
+}
+
+size_t RingFIFOWriteWait(struct RingFIFO* buffer, const void* value, size_t length) {
+	size_t written = RingFIFOWrite(buffer, value, length);
+	if (written) {
+		return written;
+	}
+	MutexLock(&buffer->mutex);
+	ATOMIC_ADD(buffer->waiting, 1);
+	ATOMIC_FENCE();
+	while (!(written = _write(buffer, value, length))) {
+		ConditionWait(&buffer->cond, &buffer->mutex);
+	}
+	ATOMIC_SUB(buffer->waiting, 1);
+	MutexUnlock(&buffer->mutex);
+	_wakeWaiting(buffer);
+	return written;
+}
+
+size_t RingFIFOReadWait(struct RingFIFO* buffer, void* output, size_t length) {
+	size_t read = RingFIFORead(buffer, output, length);
+	if (read) {
+		return read;
+	}
+	MutexLock(&buffer->mutex);
+	ATOMIC_ADD(buffer->waiting, 1);
+	ATOMIC_FENCE();
+	while (!(read = _read(buffer, output, length))) {
+		ConditionWait(&buffer->cond, &buffer->mutex);
+	}
+	ATOMIC_SUB(buffer->waiting, 1);
+	MutexUnlock(&buffer->mutex);
+	_wakeWaiting(buffer);
+	return read;
+}
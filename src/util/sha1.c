@@ -18,6 +18,15 @@
 
 #include <mgba-util/vfs.h>
 
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SHA1_SHANI
+#include <cpuid.h>
+#include <immintrin.h>
+#elif (defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO)) && defined(__ARM_NEON)
+#define SHA1_ARM
+#include <arm_neon.h>
+#endif
+
 /* #define SHA1HANDSOFF * Copies data before messing with it. */
 
 #define SHA1HANDSOFF
@@ -163,6 +172,193 @@ static void sha1Transform(uint32_t state[5], const uint8_t buffer[64]) {
 #endif
 }
 
+#ifdef SHA1_SHANI
+static bool _hasShaNi(void) {
+	static int supported = -1;
+	if (supported < 0) {
+		unsigned a, b, c, d;
+		bool sha = false;
+		if (__get_cpuid(1, &a, &b, &c, &d) && (c & bit_SSSE3) && (c & bit_SSE4_1)) {
+			sha = __get_cpuid_count(7, 0, &a, &b, &c, &d) && (b & bit_SHA);
+		}
+		supported = sha;
+	}
+	return supported;
+}
+
+// Four rounds, finishing the schedule for the next message vector and starting the one after.
+// E and ENEXT alternate between calls, as do which of the message vectors play each role.
+#define SHANI_ROUNDS(E, ENEXT, X, NEXT, AFTER, LAST, F) \
+	E = _mm_sha1nexte_epu32(E, X); \
+	ENEXT = abcd; \
+	NEXT = _mm_sha1msg2_epu32(NEXT, X); \
+	abcd = _mm_sha1rnds4_epu32(abcd, E, F); \
+	LAST = _mm_sha1msg1_epu32(LAST, X); \
+	AFTER = _mm_xor_si128(AFTER, X);
+
+__attribute__((target("sha,ssse3,sse4.1")))
+static void _sha1BlocksShaNi(uint32_t state[5], const uint8_t* data, size_t blocks) {
+	const __m128i swap = _mm_set_epi64x(0x0001020304050607ULL, 0x08090A0B0C0D0E0FULL);
+	__m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*) state), 0x1B);
+	__m128i e0 = _mm_set_epi32(state[4], 0, 0, 0);
+	__m128i e1;
+
+	for (; blocks; --blocks, data += 64) {
+		__m128i abcdSaved = abcd;
+		__m128i e0Saved = e0;
+		__m128i msg0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) &data[0x00]), swap);
+		__m128i msg1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) &data[0x10]), swap);
+		__m128i msg2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) &data[0x20]), swap);
+		__m128i msg3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) &data[0x30]), swap);
+
+		// Rounds 0-15, before the schedule is fully underway
+		e0 = _mm_add_epi32(e0, msg0);
+		e1 = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+		e1 = _mm_sha1nexte_epu32(e1, msg1);
+		e0 = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+		msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+
+		e0 = _mm_sha1nexte_epu32(e0, msg2);
+		e1 = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+		msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+		msg0 = _mm_xor_si128(msg0, msg2);
+
+		SHANI_ROUNDS(e1, e0, msg3, msg0, msg1, msg2, 0);
+
+		// Rounds 16-67
+		SHANI_ROUNDS(e0, e1, msg0, msg1, msg2, msg3, 0);
+		SHANI_ROUNDS(e1, e0, msg1, msg2, msg3, msg0, 1);
+		SHANI_ROUNDS(e0, e1, msg2, msg3, msg0, msg1, 1);
+		SHANI_ROUNDS(e1, e0, msg3, msg0, msg1, msg2, 1);
+		SHANI_ROUNDS(e0, e1, msg0, msg1, msg2, msg3, 1);
+		SHANI_ROUNDS(e1, e0, msg1, msg2, msg3, msg0, 1);
+		SHANI_ROUNDS(e0, e1, msg2, msg3, msg0, msg1, 2);
+		SHANI_ROUNDS(e1, e0, msg3, msg0, msg1, msg2, 2);
+		SHANI_ROUNDS(e0, e1, msg0, msg1, msg2, msg3, 2);
+		SHANI_ROUNDS(e1, e0, msg1, msg2, msg3, msg0, 2);
+		SHANI_ROUNDS(e0, e1, msg2, msg3, msg0, msg1, 2);
+		SHANI_ROUNDS(e1, e0, msg3, msg0, msg1, msg2, 3);
+		SHANI_ROUNDS(e0, e1, msg0, msg1, msg2, msg3, 3);
+
+		// Rounds 68-79, with the schedule winding down
+		e1 = _mm_sha1nexte_epu32(e1, msg1);
+		e0 = abcd;
+		msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+		msg3 = _mm_xor_si128(msg3, msg1);
+
+		e0 = _mm_sha1nexte_epu32(e0, msg2);
+		e1 = abcd;
+		msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+
+		e1 = _mm_sha1nexte_epu32(e1, msg3);
+		e0 = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+
+		e0 = _mm_sha1nexte_epu32(e0, e0Saved);
+		abcd = _mm_add_epi32(abcd, abcdSaved);
+	}
+
+	_mm_storeu_si128((__m128i*) state, _mm_shuffle_epi32(abcd, 0x1B));
+	state[4] = _mm_extract_epi32(e0, 3);
+}
+#undef SHANI_ROUNDS
+#elif defined(SHA1_ARM)
+#define SHA1_K0 0x5A827999
+#define SHA1_K1 0x6ED9EBA1
+#define SHA1_K2 0x8F1BBCDC
+#define SHA1_K3 0xCA62C1D6
+
+// Four rounds using the message vector added into TMP, then adding the constant into the
+// one after next while it gets scheduled. E and ENEXT alternate between calls, as do TMP
+// and which of the message vectors play each role.
+#define ARM_ROUNDS(OP, E, ENEXT, TMP, NEXT, K, PREV, X, Y) \
+	ENEXT = vsha1h_u32(vgetq_lane_u32(abcd, 0)); \
+	abcd = OP(abcd, E, TMP); \
+	TMP = vaddq_u32(NEXT, vdupq_n_u32(K)); \
+	PREV = vsha1su1q_u32(PREV, NEXT); \
+	X = vsha1su0q_u32(X, Y, NEXT);
+
+static void _sha1BlocksArm(uint32_t state[5], const uint8_t* data, size_t blocks) {
+	uint32x4_t abcd = vld1q_u32(state);
+	uint32_t e0 = state[4];
+	uint32_t e1;
+
+	for (; blocks; --blocks, data += 64) {
+		uint32x4_t abcdSaved = abcd;
+		uint32_t e0Saved = e0;
+		uint32x4_t msg0 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(&data[0x00])));
+		uint32x4_t msg1 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(&data[0x10])));
+		uint32x4_t msg2 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(&data[0x20])));
+		uint32x4_t msg3 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(&data[0x30])));
+		uint32x4_t tmp0 = vaddq_u32(msg0, vdupq_n_u32(SHA1_K0));
+		uint32x4_t tmp1 = vaddq_u32(msg1, vdupq_n_u32(SHA1_K0));
+
+		// Rounds 0-3, before the schedule is underway
+		e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+		abcd = vsha1cq_u32(abcd, e0, tmp0);
+		tmp0 = vaddq_u32(msg2, vdupq_n_u32(SHA1_K0));
+		msg0 = vsha1su0q_u32(msg0, msg1, msg2);
+
+		// Rounds 4-67
+		ARM_ROUNDS(vsha1cq_u32, e1, e0, tmp1, msg3, SHA1_K0, msg0, msg1, msg2);
+		ARM_ROUNDS(vsha1cq_u32, e0, e1, tmp0, msg0, SHA1_K0, msg1, msg2, msg3);
+		ARM_ROUNDS(vsha1cq_u32, e1, e0, tmp1, msg1, SHA1_K1, msg2, msg3, msg0);
+		ARM_ROUNDS(vsha1cq_u32, e0, e1, tmp0, msg2, SHA1_K1, msg3, msg0, msg1);
+		ARM_ROUNDS(vsha1pq_u32, e1, e0, tmp1, msg3, SHA1_K1, msg0, msg1, msg2);
+		ARM_ROUNDS(vsha1pq_u32, e0, e1, tmp0, msg0, SHA1_K1, msg1, msg2, msg3);
+		ARM_ROUNDS(vsha1pq_u32, e1, e0, tmp1, msg1, SHA1_K1, msg2, msg3, msg0);
+		ARM_ROUNDS(vsha1pq_u32, e0, e1, tmp0, msg2, SHA1_K2, msg3, msg0, msg1);
+		ARM_ROUNDS(vsha1pq_u32, e1, e0, tmp1, msg3, SHA1_K2, msg0, msg1, msg2);
+		ARM_ROUNDS(vsha1mq_u32, e0, e1, tmp0, msg0, SHA1_K2, msg1, msg2, msg3);
+		ARM_ROUNDS(vsha1mq_u32, e1, e0, tmp1, msg1, SHA1_K2, msg2, msg3, msg0);
+		ARM_ROUNDS(vsha1mq_u32, e0, e1, tmp0, msg2, SHA1_K2, msg3, msg0, msg1);
+		ARM_ROUNDS(vsha1mq_u32, e1, e0, tmp1, msg3, SHA1_K3, msg0, msg1, msg2);
+		ARM_ROUNDS(vsha1mq_u32, e0, e1, tmp0, msg0, SHA1_K3, msg1, msg2, msg3);
+		ARM_ROUNDS(vsha1pq_u32, e1, e0, tmp1, msg1, SHA1_K3, msg2, msg3, msg0);
+		ARM_ROUNDS(vsha1pq_u32, e0, e1, tmp0, msg2, SHA1_K3, msg3, msg0, msg1);
+
+		// Rounds 68-79, once the schedule is done
+		e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+		abcd = vsha1pq_u32(abcd, e1, tmp1);
+		tmp1 = vaddq_u32(msg3, vdupq_n_u32(SHA1_K3));
+
+		e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+		abcd = vsha1pq_u32(abcd, e0, tmp0);
+
+		e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+		abcd = vsha1pq_u32(abcd, e1, tmp1);
+
+		e0 += e0Saved;
+		abcd = vaddq_u32(abcd, abcdSaved);
+	}
+
+	vst1q_u32(state, abcd);
+	state[4] = e0;
+}
+#undef ARM_ROUNDS
+#endif
+
+static void _sha1Blocks(uint32_t state[5], const uint8_t* data, size_t blocks) {
+#ifdef SHA1_SHANI
+	if (_hasShaNi()) {
+		_sha1BlocksShaNi(state, data, blocks);
+		return;
+	}
+#elif defined(SHA1_ARM)
+	_sha1BlocksArm(state, data, blocks);
+	return;
+#endif
+	for (; blocks; --blocks, data += 64) {
+		sha1Transform(state, data);
+	}
+}
+
 /* shaInit - Initialize new context */
 void sha1Init(struct SHA1Context* context) {
 	/* SHA1 initialization constants */
@@ -187,15 +383,15 @@ void sha1Update(struct SHA1Context* context, const void* data, size_t len) {
 	j = (j >> 3) & 63;
 	if ((j + len) > 63) {
 		memcpy(&context->buffer[j], data, (i = 64 - j));
-		sha1Transform(context->state, context->buffer);
-		for (; i + 63 < len; i += 64) {
-			sha1Transform(context->state, &((uint8_t*) data)[i]);
-		}
+		_sha1Blocks(context->state, context->buffer, 1);
+		size_t blocks = (len - i) / 64;
+		_sha1Blocks(context->state, &((const uint8_t*) data)[i], blocks);
+		i += blocks * 64;
 		j = 0;
 	} else {
 		i = 0;
 	}
-	memcpy(&context->buffer[j], &((uint8_t*) data)[i], len - i);
+	memcpy(&context->buffer[j], &((const uint8_t*) data)[i], len - i);
 }
 
 /* Add padding and return the message digest. */
@@ -224,21 +420,14 @@ void sha1Finalize(uint8_t digest[20], struct SHA1Context* context) {
 
 void sha1Buffer(const void* input, size_t len, uint8_t* result) {
 	struct SHA1Context ctx;
-	size_t i;
-
 	sha1Init(&ctx);
-	for (i = 0; i + 63 < len; i += 64) {
-		sha1Update(&ctx, &((const uint8_t*) input)[i], 64);
-	}
-	for (; i < len; ++i) {
-		sha1Update(&ctx, &((const uint8_t*) input)[i], 1);
-	}
+	sha1Update(&ctx, input, len);
 	sha1Finalize(result, &ctx);
 }
 
 bool sha1File(struct VFile* vf, uint8_t* result) {
 	struct SHA1Context ctx;
-	uint8_t buffer[2048];
+	uint8_t buffer[0x4000];
 	sha1Init(&ctx);
 
 	ssize_t read;
@@ -9,20 +9,30 @@
 #include <mgba-util/math.h>
 #include <mgba-util/string.h>
 
-#define LIST_INITIAL_SIZE 4
 #define TABLE_INITIAL_SIZE 8
-#define REBALANCE_THRESHOLD 4
-
-#define TABLE_COMPARATOR(LIST, INDEX) LIST->list[(INDEX)].key == key
-#define HASH_TABLE_STRNCMP_COMPARATOR(LIST, INDEX) LIST->list[(INDEX)].key == hash && strncmp(LIST->list[(INDEX)].stringKey, key, LIST->list[(INDEX)].keylen) == 0
-#define HASH_TABLE_MEMCMP_COMPARATOR(LIST, INDEX) LIST->list[(INDEX)].key == hash && LIST->list[(INDEX)].keylen == keylen && memcmp(LIST->list[(INDEX)].stringKey, key, LIST->list[(INDEX)].keylen) == 0
-#define HASH_TABLE_CUSTOM_COMPARATOR(LIST, INDEX) LIST->list[(INDEX)].key == hash && table->fn.equal(LIST->list[(INDEX)].stringKey, key)
-
-#define TABLE_LOOKUP_START(COMPARATOR, LIST) \
+#define TABLE_CONTROL_EMPTY 0
+#define TABLE_CONTROL_USED 0x80
+
+// Entries live directly in one array of slots and collisions are resolved by linear probing.
+// A parallel array holds one control byte per slot, which is zero for an empty slot or a
+// tag of seven hash bits otherwise, so a probe walks a single cache line of control bytes
+// and only touches the entries whose tag matches. Inserting never moves existing entries,
+// which keeps iterators valid while callbacks register more entries, and removal shifts
+// later entries back instead of leaving tombstones.
+
+#define TABLE_COMPARATOR(TABLE, INDEX) TABLE->table[(INDEX)].key == key
+#define HASH_TABLE_STRNCMP_COMPARATOR(TABLE, INDEX) TABLE->table[(INDEX)].key == hash && strncmp(TABLE->table[(INDEX)].stringKey, key, TABLE->table[(INDEX)].keylen) == 0
+#define HASH_TABLE_MEMCMP_COMPARATOR(TABLE, INDEX) TABLE->table[(INDEX)].key == hash && TABLE->table[(INDEX)].keylen == keylen && memcmp(TABLE->table[(INDEX)].stringKey, key, TABLE->table[(INDEX)].keylen) == 0
+#define HASH_TABLE_CUSTOM_COMPARATOR(TABLE, INDEX) TABLE->table[(INDEX)].key == hash && table->fn.equal(TABLE->table[(INDEX)].stringKey, key)
+
+// After the loop, i is either the matching slot or the empty slot that ended the probe
+#define TABLE_LOOKUP_START(COMPARATOR, TABLE, KEY) \
+	uint32_t mixed = _mix(KEY); \
+	uint8_t tag = _tag(mixed); \
 	size_t i; \
-	for (i = 0; i < LIST->nEntries; ++i) { \
-		if (COMPARATOR(LIST, i)) { \
-			struct TableTuple* lookupResult = &LIST->list[i]; \
+	for (i = mixed & (TABLE->tableSize - 1); TABLE->control[i] != TABLE_CONTROL_EMPTY; i = (i + 1) & (TABLE->tableSize - 1)) { \
+		if (TABLE->control[i] == tag && COMPARATOR(TABLE, i)) { \
+			struct TableTuple* lookupResult = &TABLE->table[i]; \
 			UNUSED(lookupResult);
 
 #define TABLE_LOOKUP_END \
@@ -37,197 +47,194 @@ struct TableTuple {
 	void* value;
 };
 
-struct TableList {
-	struct TableTuple* list;
-	size_t nEntries;
-	size_t listSize;
-};
+static inline uint32_t _mix(uint32_t key) {
+	// Integer tables are keyed directly by values like addresses, so spread them out first
+	key ^= key >> 16;
+	key *= 0x85EBCA6B;
+	key ^= key >> 13;
+	key *= 0xC2B2AE35;
+	key ^= key >> 16;
+	return key;
+}
 
-void HashTableInsertBinaryMoveKey(struct Table* table, void* key, size_t keylen, void* value);
+static inline uint8_t _tag(uint32_t mixed) {
+	return TABLE_CONTROL_USED | (mixed >> 25);
+}
 
-static inline const struct TableList* _getConstList(const struct Table* table, uint32_t key) {
-	uint32_t entry = key & (table->tableSize - 1);
-	return &table->table[entry];
+static void _allocate(struct Table* table, size_t size) {
+	table->tableSize = size;
+	table->table = malloc(size * sizeof(struct TableTuple));
+	table->control = calloc(size, sizeof(*table->control));
 }
 
-static inline struct TableList* _getList(struct Table* table, uint32_t key) {
-	uint32_t entry = key & (table->tableSize - 1);
-	return &table->table[entry];
+static size_t _findEmpty(const struct Table* table, uint32_t key) {
+	uint32_t mixed = _mix(key);
+	size_t i;
+	for (i = mixed & (table->tableSize - 1); table->control[i] != TABLE_CONTROL_EMPTY; i = (i + 1) & (table->tableSize - 1));
+	return i;
 }
 
-static struct TableList* _resizeAsNeeded(struct Table* table, struct TableList* list, uint32_t key) {
-	UNUSED(table);
-	UNUSED(key);
-	// TODO: Expand table if needed
-	if (list->nEntries + 1 == list->listSize) {
-		list->listSize *= 2;
-		list->list = realloc(list->list, list->listSize * sizeof(struct TableTuple));
+static void _resize(struct Table* table, size_t size) {
+	struct TableTuple* oldTable = table->table;
+	uint8_t* oldControl = table->control;
+	size_t oldSize = table->tableSize;
+	_allocate(table, size);
+
+	size_t i;
+	for (i = 0; i < oldSize; ++i) {
+		if (oldControl[i] == TABLE_CONTROL_EMPTY) {
+			continue;
+		}
+		size_t slot = _findEmpty(table, oldTable[i].key);
+		table->table[slot] = oldTable[i];
+		table->control[slot] = oldControl[i];
 	}
-	return list;
+	free(oldTable);
+	free(oldControl);
 }
 
-static void _removeItemFromList(struct Table* table, struct TableList* list, size_t item) {
-	--list->nEntries;
-	--table->size;
+// Grows the table if adding one more entry would fill it too far, returning whether it did
+static bool _resizeAsNeeded(struct Table* table) {
+	if ((table->size + 1) * 4 <= table->tableSize * 3) {
+		return false;
+	}
+	_resize(table, table->tableSize * 2);
+	return true;
+}
+
+static void _insertAt(struct Table* table, size_t slot, uint32_t key, char* stringKey, size_t keylen, void* value) {
+	table->control[slot] = _tag(_mix(key));
+	table->table[slot].key = key;
+	table->table[slot].stringKey = stringKey;
+	table->table[slot].keylen = keylen;
+	table->table[slot].value = value;
+	++table->size;
+}
+
+static void _releaseItem(struct Table* table, struct TableTuple* item) {
 	if (table->fn.deref) {
-		table->fn.deref(list->list[item].stringKey);
+		table->fn.deref(item->stringKey);
 	} else {
-		free(list->list[item].stringKey);
+		free(item->stringKey);
 	}
 	if (table->fn.deinitializer) {
-		table->fn.deinitializer(list->list[item].value);
+		table->fn.deinitializer(item->value);
 	}
-	if (item != list->nEntries) {
-		list->list[item] = list->list[list->nEntries];
+}
+
+static void _removeItem(struct Table* table, size_t item) {
+	// Release the entry only once it's out of the table, in case the deinitializer looks something up
+	struct TableTuple removed = table->table[item];
+	--table->size;
+
+	// Pull later entries in the same run back so that no probe ever stops early at the hole
+	size_t mask = table->tableSize - 1;
+	size_t next;
+	for (next = (item + 1) & mask; table->control[next] != TABLE_CONTROL_EMPTY; next = (next + 1) & mask) {
+		size_t home = _mix(table->table[next].key) & mask;
+		if (((next - home) & mask) >= ((next - item) & mask)) {
+			table->table[item] = table->table[next];
+			table->control[item] = table->control[next];
+			item = next;
+		}
 	}
+	table->control[item] = TABLE_CONTROL_EMPTY;
+	_releaseItem(table, &removed);
 }
 
-static void _rebalance(struct Table* table) {
-	struct Table newTable;
-	TableInit(&newTable, table->tableSize * REBALANCE_THRESHOLD, NULL);
-	memcpy(&newTable.fn, &table->fn, sizeof(newTable.fn));
-	newTable.seed = table->seed * 134775813 + 1;
-	size_t i;
-	for (i = 0; i < table->tableSize; ++i) {
-		struct TableList* list = &table->table[i];
-		size_t j;
-		for (j = 0; j < list->nEntries; ++j) {
-			if (!table->fn.equal) {
-				HashTableInsertBinaryMoveKey(&newTable, list->list[j].stringKey, list->list[j].keylen, list->list[j].value);
-			} else {
-				HashTableInsertCustom(&newTable, list->list[j].stringKey, list->list[j].value);
-				table->fn.deref(list->list[j].stringKey);
-			}
+static void _replaceValue(struct Table* table, struct TableTuple* item, void* value) {
+	if (value != item->value) {
+		if (table->fn.deinitializer) {
+			table->fn.deinitializer(item->value);
 		}
-		free(list->list);
+		item->value = value;
 	}
-	free(table->table);
-	table->tableSize = newTable.tableSize;
-	table->table = newTable.table;
-	table->seed = newTable.seed;
+}
+
+static bool _nextUsed(const struct Table* table, size_t* slot) {
+	for (; *slot < table->tableSize; ++*slot) {
+		if (table->control[*slot] != TABLE_CONTROL_EMPTY) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static inline uint32_t _hashKey(const struct Table* table, const void* key, size_t keylen) {
+	if (table->fn.hash) {
+		return table->fn.hash(key, keylen, table->seed);
+	}
+	return hash32(key, keylen, table->seed);
 }
 
 void TableInit(struct Table* table, size_t initialSize, void (*deinitializer)(void*)) {
-	if (initialSize < 2) {
+	if (initialSize < TABLE_INITIAL_SIZE) {
 		initialSize = TABLE_INITIAL_SIZE;
 	} else if (initialSize & (initialSize - 1)) {
 		initialSize = toPow2(initialSize);
 	}
-	table->tableSize = initialSize;
-	table->table = calloc(table->tableSize, sizeof(struct TableList));
+	_allocate(table, initialSize);
 	table->size = 0;
 	table->fn = (struct TableFunctions) {
 		.deinitializer = deinitializer
 	};
 	table->seed = 0;
-
-	size_t i;
-	for (i = 0; i < table->tableSize; ++i) {
-		table->table[i].listSize = LIST_INITIAL_SIZE;
-		table->table[i].nEntries = 0;
-		table->table[i].list = calloc(LIST_INITIAL_SIZE, sizeof(struct TableTuple));
-	}
 }
 
 void TableDeinit(struct Table* table) {
 	size_t i;
 	for (i = 0; i < table->tableSize; ++i) {
-		struct TableList* list = &table->table[i];
-		size_t j;
-		for (j = 0; j < list->nEntries; ++j) {
-			if (table->fn.deref) {
-				table->fn.deref(list->list[j].stringKey);
-			} else {
-				free(list->list[j].stringKey);
-			}
-			if (table->fn.deinitializer) {
-				table->fn.deinitializer(list->list[j].value);
-			}
+		if (table->control[i] != TABLE_CONTROL_EMPTY) {
+			_releaseItem(table, &table->table[i]);
 		}
-		free(list->list);
 	}
 	free(table->table);
-	table->table = 0;
+	free(table->control);
+	table->table = NULL;
+	table->control = NULL;
 	table->tableSize = 0;
+	table->size = 0;
 }
 
 void* TableLookup(const struct Table* table, uint32_t key) {
-	const struct TableList* list = _getConstList(table, key);
-	TABLE_LOOKUP_START(TABLE_COMPARATOR, list) {
+	TABLE_LOOKUP_START(TABLE_COMPARATOR, table, key) {
 		return lookupResult->value;
 	} TABLE_LOOKUP_END;
 	return 0;
 }
 
 void TableInsert(struct Table* table, uint32_t key, void* value) {
-	struct TableList* list = _getList(table, key);
-	if (table->size >= table->tableSize * REBALANCE_THRESHOLD) {
-		struct Table newTable;
-		TableInit(&newTable, table->tableSize * REBALANCE_THRESHOLD, NULL);
-		memcpy(&newTable.fn, &table->fn, sizeof(newTable.fn));
-		size_t i;
-		for (i = 0; i < table->tableSize; ++i) {
-			struct TableList* list = &table->table[i];
-			size_t j;
-			for (j = 0; j < list->nEntries; ++j) {
-				TableInsert(&newTable, list->list[j].key, list->list[j].value);
-			}
-			free(list->list);
-		}
-		free(table->table);
-		table->tableSize = newTable.tableSize;
-		table->table = newTable.table;
-		list = _getList(table, key);
-	}
-	TABLE_LOOKUP_START(TABLE_COMPARATOR, list) {
-		if (value != lookupResult->value) {
-			if (table->fn.deinitializer) {
-				table->fn.deinitializer(lookupResult->value);
-			}
-			lookupResult->value = value;
-		}
+	TABLE_LOOKUP_START(TABLE_COMPARATOR, table, key) {
+		_replaceValue(table, lookupResult, value);
 		return;
 	} TABLE_LOOKUP_END;
-	list = _resizeAsNeeded(table, list, key);
-	list->list[list->nEntries].key = key;
-	list->list[list->nEntries].stringKey = 0;
-	list->list[list->nEntries].value = value;
-	++list->nEntries;
-	++table->size;
+	if (_resizeAsNeeded(table)) {
+		i = _findEmpty(table, key);
+	}
+	_insertAt(table, i, key, NULL, 0, value);
 }
 
 void TableRemove(struct Table* table, uint32_t key) {
-	struct TableList* list = _getList(table, key);
-	TABLE_LOOKUP_START(TABLE_COMPARATOR, list) {
-		_removeItemFromList(table, list, i); // TODO: Move i out of the macro
+	TABLE_LOOKUP_START(TABLE_COMPARATOR, table, key) {
+		_removeItem(table, i);
 	} TABLE_LOOKUP_END;
 }
 
 void TableClear(struct Table* table) {
 	size_t i;
 	for (i = 0; i < table->tableSize; ++i) {
-		struct TableList* list = &table->table[i];
-		if (table->fn.deinitializer) {
-			size_t j;
-			for (j = 0; j < list->nEntries; ++j) {
-				table->fn.deinitializer(list->list[j].value);
-			}
+		if (table->control[i] != TABLE_CONTROL_EMPTY) {
+			_releaseItem(table, &table->table[i]);
 		}
-		free(list->list);
-		list->listSize = LIST_INITIAL_SIZE;
-		list->nEntries = 0;
-		list->list = calloc(LIST_INITIAL_SIZE, sizeof(struct TableTuple));
 	}
+	memset(table->control, TABLE_CONTROL_EMPTY, table->tableSize * sizeof(*table->control));
+	table->size = 0;
 }
 
 void TableEnumerate(const struct Table* table, void (*handler)(uint32_t key, void* value, void* user), void* user) {
 	size_t i;
-	for (i = 0; i < table->tableSize; ++i) {
-		const struct TableList* list = &table->table[i];
-		size_t j;
-		for (j = 0; j < list->nEntries; ++j) {
-			handler(list->list[j].key, list->list[j].value, user);
-		}
+	for (i = 0; _nextUsed(table, &i); ++i) {
+		handler(table->table[i].key, table->table[i].value, user);
 	}
 }
 
@@ -236,46 +243,31 @@ size_t TableSize(const struct Table* table) {
 }
 
 bool TableIteratorStart(const struct Table* table, struct TableIterator* iter) {
+	iter->bucket = 0;
 	iter->entry = 0;
-	for (iter->bucket = 0; iter->bucket < table->tableSize; ++iter->bucket) {
-		if (table->table[iter->bucket].nEntries) {
-			break;
-		}
-	}
-	return iter->bucket < table->tableSize;
+	return _nextUsed(table, &iter->bucket);
 }
 
 bool TableIteratorNext(const struct Table* table, struct TableIterator* iter) {
-	if (iter->entry + 1 < table->table[iter->bucket].nEntries) {
-		++iter->entry;
-		return true;
+	if (iter->bucket >= table->tableSize) {
+		return false;
 	}
-	if (iter->bucket + 1 < table->tableSize) {
-		iter->entry = 0;
-		for (++iter->bucket; iter->bucket < table->tableSize; ++iter->bucket) {
-			if (table->table[iter->bucket].nEntries) {
-				break;
-			}
-		}
-		return iter->bucket < table->tableSize;
-	}
-	return false;
+	++iter->bucket;
+	return _nextUsed(table, &iter->bucket);
 }
 
 uint32_t TableIteratorGetKey(const struct Table* table, const struct TableIterator* iter) {
-	return table->table[iter->bucket].list[iter->entry].key;
+	return table->table[iter->bucket].key;
 }
 
 void* TableIteratorGetValue(const struct Table* table, const struct TableIterator* iter) {
-	return table->table[iter->bucket].list[iter->entry].value;
+	return table->table[iter->bucket].value;
 }
 
 bool TableIteratorLookup(const struct Table* table, struct TableIterator* iter, uint32_t key) {
-	uint32_t bucket = key & (table->tableSize - 1);
-	const struct TableList* list = &table->table[bucket];
-	TABLE_LOOKUP_START(TABLE_COMPARATOR, list) {
-		iter->bucket = bucket;
-		iter->entry = i;
+	TABLE_LOOKUP_START(TABLE_COMPARATOR, table, key) {
+		iter->bucket = i;
+		iter->entry = 0;
 		return true;
 	} TABLE_LOOKUP_END;
 	return false;
@@ -296,28 +288,16 @@ void HashTableDeinit(struct Table* table) {
 }
 
 void* HashTableLookup(const struct Table* table, const char* key) {
-	uint32_t hash;
-	if (table->fn.hash) {
-		hash = table->fn.hash(key, strlen(key), table->seed);
-	} else {
-		hash = hash32(key, strlen(key), table->seed);
-	}
-	const struct TableList* list = _getConstList(table, hash);
-	TABLE_LOOKUP_START(HASH_TABLE_STRNCMP_COMPARATOR, list) {
+	uint32_t hash = _hashKey(table, key, strlen(key));
+	TABLE_LOOKUP_START(HASH_TABLE_STRNCMP_COMPARATOR, table, hash) {
 		return lookupResult->value;
 	} TABLE_LOOKUP_END;
 	return 0;
 }
 
 void* HashTableLookupBinary(const struct Table* table, const void* key, size_t keylen) {
-	uint32_t hash;
-	if (table->fn.hash) {
-		hash = table->fn.hash(key, keylen, table->seed);
-	} else {
-		hash = hash32(key, keylen, table->seed);
-	}
-	const struct TableList* list = _getConstList(table, hash);
-	TABLE_LOOKUP_START(HASH_TABLE_MEMCMP_COMPARATOR, list) {
+	uint32_t hash = _hashKey(table, key, keylen);
+	TABLE_LOOKUP_START(HASH_TABLE_MEMCMP_COMPARATOR, table, hash) {
 		return lookupResult->value;
 	} TABLE_LOOKUP_END;
 	return 0;
@@ -325,248 +305,105 @@ void* HashTableLookupBinary(const struct Table* table, const void* key, size_t k
 
 void* HashTableLookupCustom(const struct Table* table, void* key) {
 	uint32_t hash = table->fn.hash(key, 0, table->seed);
-	const struct TableList* list = _getConstList(table, hash);
-	TABLE_LOOKUP_START(HASH_TABLE_CUSTOM_COMPARATOR, list) {
+	TABLE_LOOKUP_START(HASH_TABLE_CUSTOM_COMPARATOR, table, hash) {
 		return lookupResult->value;
 	} TABLE_LOOKUP_END;
 	return 0;
 }
 
 void HashTableInsert(struct Table* table, const char* key, void* value) {
-	uint32_t hash;
-	if (table->fn.hash) {
-		hash = table->fn.hash(key, strlen(key), table->seed);
-	} else {
-		hash = hash32(key, strlen(key), table->seed);
-	}
-	struct TableList* list = _getList(table, hash);
-	if (table->size >= table->tableSize * REBALANCE_THRESHOLD) {
-		_rebalance(table);
-		if (table->fn.hash) {
-			hash = table->fn.hash(key, strlen(key), table->seed);
-		} else {
-			hash = hash32(key, strlen(key), table->seed);
-		}
-		list = _getList(table, hash);
-	}
-	TABLE_LOOKUP_START(HASH_TABLE_STRNCMP_COMPARATOR, list) {
-		if (value != lookupResult->value) {
-			if (table->fn.deinitializer) {
-				table->fn.deinitializer(lookupResult->value);
-			}
-			lookupResult->value = value;
-		}
+	size_t keylen = strlen(key);
+	uint32_t hash = _hashKey(table, key, keylen);
+	TABLE_LOOKUP_START(HASH_TABLE_STRNCMP_COMPARATOR, table, hash) {
+		_replaceValue(table, lookupResult, value);
 		return;
 	} TABLE_LOOKUP_END;
-	list = _resizeAsNeeded(table, list, hash);
-	list->list[list->nEntries].key = hash;
-	list->list[list->nEntries].stringKey = strdup(key);
-	list->list[list->nEntries].keylen = strlen(key);
-	list->list[list->nEntries].value = value;
-	++list->nEntries;
-	++table->size;
+	if (_resizeAsNeeded(table)) {
+		i = _findEmpty(table, hash);
+	}
+	_insertAt(table, i, hash, strdup(key), keylen, value);
 }
 
 void HashTableInsertBinary(struct Table* table, const void* key, size_t keylen, void* value) {
-	uint32_t hash;
-	if (table->fn.hash) {
-		hash = table->fn.hash(key, keylen, table->seed);
-	} else {
-		hash = hash32(key, keylen, table->seed);
-	}
-	struct TableList* list = _getList(table, hash);
-	if (table->size >= table->tableSize * REBALANCE_THRESHOLD) {
-		_rebalance(table);
-		if (table->fn.hash) {
-			hash = table->fn.hash(key, keylen, table->seed);
-		} else {
-			hash = hash32(key, keylen, table->seed);
-		}
-		list = _getList(table, hash);
-	}
-	TABLE_LOOKUP_START(HASH_TABLE_MEMCMP_COMPARATOR, list) {
-		if (value != lookupResult->value) {
-			if (table->fn.deinitializer) {
-				table->fn.deinitializer(lookupResult->value);
-			}
-			lookupResult->value = value;
-		}
+	uint32_t hash = _hashKey(table, key, keylen);
+	TABLE_LOOKUP_START(HASH_TABLE_MEMCMP_COMPARATOR, table, hash) {
+		_replaceValue(table, lookupResult, value);
 		return;
 	} TABLE_LOOKUP_END;
-	list = _resizeAsNeeded(table, list, hash);
-	list->list[list->nEntries].key = hash;
-	list->list[list->nEntries].stringKey = malloc(keylen);
-	memcpy(list->list[list->nEntries].stringKey, key, keylen);
-	list->list[list->nEntries].keylen = keylen;
-	list->list[list->nEntries].value = value;
-	++list->nEntries;
-	++table->size;
+	if (_resizeAsNeeded(table)) {
+		i = _findEmpty(table, hash);
+	}
+	char* keyCopy = malloc(keylen);
+	memcpy(keyCopy, key, keylen);
+	_insertAt(table, i, hash, keyCopy, keylen, value);
 }
 
 void HashTableInsertCustom(struct Table* table, void* key, void* value) {
 	uint32_t hash = table->fn.hash(key, 0, table->seed);
-	struct TableList* list = _getList(table, hash);
-	if (table->size >= table->tableSize * REBALANCE_THRESHOLD) {
-		_rebalance(table);
-		hash = table->fn.hash(key, 0, table->seed);
-		list = _getList(table, hash);
-	}
-	TABLE_LOOKUP_START(HASH_TABLE_CUSTOM_COMPARATOR, list) {
-		if (value != lookupResult->value) {
-			if (table->fn.deinitializer) {
-				table->fn.deinitializer(lookupResult->value);
-			}
-			lookupResult->value = value;
-		}
+	TABLE_LOOKUP_START(HASH_TABLE_CUSTOM_COMPARATOR, table, hash) {
+		_replaceValue(table, lookupResult, value);
 		return;
 	} TABLE_LOOKUP_END;
-	list = _resizeAsNeeded(table, list, hash);
-	list->list[list->nEntries].key = hash;
-	list->list[list->nEntries].stringKey = table->fn.ref(key);
-	list->list[list->nEntries].keylen = 0;
-	list->list[list->nEntries].value = value;
-	++list->nEntries;
-	++table->size;
-}
-
-void HashTableInsertBinaryMoveKey(struct Table* table, void* key, size_t keylen, void* value) {
-	uint32_t hash;
-	if (table->fn.hash) {
-		hash = table->fn.hash(key, keylen, table->seed);
-	} else {
-		hash = hash32(key, keylen, table->seed);
+	if (_resizeAsNeeded(table)) {
+		i = _findEmpty(table, hash);
 	}
-	struct TableList* list = _getList(table, hash);
-	if (table->size >= table->tableSize * REBALANCE_THRESHOLD) {
-		_rebalance(table);
-		if (table->fn.hash) {
-			hash = table->fn.hash(key, keylen, table->seed);
-		} else {
-			hash = hash32(key, keylen, table->seed);
-		}
-		list = _getList(table, hash);
-	}
-	TABLE_LOOKUP_START(HASH_TABLE_MEMCMP_COMPARATOR, list) {
-		if (value != lookupResult->value) {
-			if (table->fn.deinitializer) {
-				table->fn.deinitializer(lookupResult->value);
-			}
-			lookupResult->value = value;
-		}
-		return;
-	} TABLE_LOOKUP_END;
-	list = _resizeAsNeeded(table, list, hash);
-	list->list[list->nEntries].key = hash;
-	list->list[list->nEntries].stringKey = key;
-	list->list[list->nEntries].keylen = keylen;
-	list->list[list->nEntries].value = value;
-	++list->nEntries;
-	++table->size;
+	_insertAt(table, i, hash, table->fn.ref(key), 0, value);
 }
 
 void HashTableRemove(struct Table* table, const char* key) {
-	uint32_t hash;
-
-	if (table->fn.hash) {
-		hash = table->fn.hash(key, strlen(key), table->seed);
-	} else {
-		hash = hash32(key, strlen(key), table->seed);
-	}
-	struct TableList* list = _getList(table, hash);
-	TABLE_LOOKUP_START(HASH_TABLE_STRNCMP_COMPARATOR, list) {
-		_removeItemFromList(table, list, i); // TODO: Move i out of the macro
+	uint32_t hash = _hashKey(table, key, strlen(key));
+	TABLE_LOOKUP_START(HASH_TABLE_STRNCMP_COMPARATOR, table, hash) {
+		_removeItem(table, i);
 	} TABLE_LOOKUP_END;
 }
 
 void HashTableRemoveBinary(struct Table* table, const void* key, size_t keylen) {
-	uint32_t hash;
-	if (table->fn.hash) {
-		hash = table->fn.hash(key, keylen, table->seed);
-	} else {
-		hash = hash32(key, keylen, table->seed);
-	}
-	struct TableList* list = _getList(table, hash);
-	TABLE_LOOKUP_START(HASH_TABLE_MEMCMP_COMPARATOR, list) {
-		_removeItemFromList(table, list, i); // TODO: Move i out of the macro
+	uint32_t hash = _hashKey(table, key, keylen);
+	TABLE_LOOKUP_START(HASH_TABLE_MEMCMP_COMPARATOR, table, hash) {
+		_removeItem(table, i);
 	} TABLE_LOOKUP_END;
 }
 
 void HashTableRemoveCustom(struct Table* table, void* key) {
 	uint32_t hash = table->fn.hash(key, 0, table->seed);
-	struct TableList* list = _getList(table, hash);
-	TABLE_LOOKUP_START(HASH_TABLE_CUSTOM_COMPARATOR, list) {
-		_removeItemFromList(table, list, i); // TODO: Move i out of the macro
+	TABLE_LOOKUP_START(HASH_TABLE_CUSTOM_COMPARATOR, table, hash) {
+		_removeItem(table, i);
 	} TABLE_LOOKUP_END;
 }
 
 void HashTableClear(struct Table* table) {
-	size_t i;
-	for (i = 0; i < table->tableSize; ++i) {
-		struct TableList* list = &table->table[i];
-		size_t j;
-		for (j = 0; j < list->nEntries; ++j) {
-			if (table->fn.deinitializer) {
-				table->fn.deinitializer(list->list[j].value);
-			}
-			if (table->fn.deref) {
-				table->fn.deref(list->list[j].stringKey);
-			} else {
-				free(list->list[j].stringKey);
-			}
-		}
-		free(list->list);
-		list->listSize = LIST_INITIAL_SIZE;
-		list->nEntries = 0;
-		list->list = calloc(LIST_INITIAL_SIZE, sizeof(struct TableTuple));
-	}
+	TableClear(table);
 }
 
 void HashTableEnumerate(const struct Table* table, void (*handler)(const char* key, void* value, void* user), void* user) {
 	size_t i;
-	for (i = 0; i < table->tableSize; ++i) {
-		const struct TableList* list = &table->table[i];
-		size_t j;
-		for (j = 0; j < list->nEntries; ++j) {
-			handler(list->list[j].stringKey, list->list[j].value, user);
-		}
+	for (i = 0; _nextUsed(table, &i); ++i) {
+		handler(table->table[i].stringKey, table->table[i].value, user);
 	}
 }
 
 void HashTableEnumerateBinary(const struct Table* table, void (*handler)(const char* key, size_t keylen, void* value, void* user), void* user) {
 	size_t i;
-	for (i = 0; i < table->tableSize; ++i) {
-		const struct TableList* list = &table->table[i];
-		size_t j;
-		for (j = 0; j < list->nEntries; ++j) {
-			handler(list->list[j].stringKey, list->list[j].keylen, list->list[j].value, user);
-		}
+	for (i = 0; _nextUsed(table, &i); ++i) {
+		handler(table->table[i].stringKey, table->table[i].keylen, table->table[i].value, user);
 	}
 }
 
 void HashTableEnumerateCustom(const struct Table* table, void (*handler)(void* key, void* value, void* user), void* user) {
 	size_t i;
-	for (i = 0; i < table->tableSize; ++i) {
-		const struct TableList* list = &table->table[i];
-		size_t j;
-		for (j = 0; j < list->nEntries; ++j) {
-			handler((char*) list->list[j].stringKey, list->list[j].value, user);
-		}
+	for (i = 0; _nextUsed(table, &i); ++i) {
+		handler((char*) table->table[i].stringKey, table->table[i].value, user);
 	}
 }
 
 const char* HashTableSearch(const struct Table* table, bool (*predicate)(const char* key, const void* value, const void* user), const void* user) {
 	size_t i;
-	const char* result = NULL;
-	for (i = 0; i < table->tableSize; ++i) {
-		const struct TableList* list = &table->table[i];
-		size_t j;
-		for (j = 0; j < list->nEntries; ++j) {
-			if (predicate(list->list[j].stringKey, list->list[j].value, user)) {
-				return list->list[j].stringKey;
-			}
+	for (i = 0; _nextUsed(table, &i); ++i) {
+		if (predicate(table->table[i].stringKey, table->table[i].value, user)) {
+			return table->table[i].stringKey;
 		}
 	}
-	return result;
+	return NULL;
 }
 
 static bool HashTableRefEqual(const char* key, const void* value, const void* user) {
@@ -616,19 +453,19 @@ bool HashTableIteratorNext(const struct Table* table, struct TableIterator* iter
 }
 
 const char* HashTableIteratorGetKey(const struct Table* table, const struct TableIterator* iter) {
-	return table->table[iter->bucket].list[iter->entry].stringKey;
+	return table->table[iter->bucket].stringKey;
 }
 
 const void* HashTableIteratorGetBinaryKey(const struct Table* table, const struct TableIterator* iter) {
-	return table->table[iter->bucket].list[iter->entry].stringKey;
+	return table->table[iter->bucket].stringKey;
 }
 
 size_t HashTableIteratorGetBinaryKeyLen(const struct Table* table, const struct TableIterator* iter) {
-	return table->table[iter->bucket].list[iter->entry].keylen;
+	return table->table[iter->bucket].keylen;
 }
 
 void* HashTableIteratorGetCustomKey(const struct Table* table, const struct TableIterator* iter) {
-	return (char*) table->table[iter->bucket].list[iter->entry].stringKey;
+	return (char*) table->table[iter->bucket].stringKey;
 }
 
 void* HashTableIteratorGetValue(const struct Table* table, const struct TableIterator* iter) {
@@ -636,34 +473,20 @@ void* HashTableIteratorGetValue(const struct Table* table, const struct TableIte
 }
 
 bool HashTableIteratorLookup(const struct Table* table, struct TableIterator* iter, const char* key) {
-	uint32_t hash;
-	if (table->fn.hash) {
-		hash = table->fn.hash(key, strlen(key), table->seed);
-	} else {
-		hash = hash32(key, strlen(key), table->seed);
-	}
-	uint32_t bucket = hash & (table->tableSize - 1);
-	const struct TableList* list = &table->table[bucket];
-	TABLE_LOOKUP_START(HASH_TABLE_STRNCMP_COMPARATOR, list) {
-		iter->bucket = bucket;
-		iter->entry = i;
+	uint32_t hash = _hashKey(table, key, strlen(key));
+	TABLE_LOOKUP_START(HASH_TABLE_STRNCMP_COMPARATOR, table, hash) {
+		iter->bucket = i;
+		iter->entry = 0;
 		return true;
 	} TABLE_LOOKUP_END;
 	return false;
 }
 
 bool HashTableIteratorLookupBinary(const struct Table* table, struct TableIterator* iter, const void* key, size_t keylen) {
-	uint32_t hash;
-	if (table->fn.hash) {
-		hash = table->fn.hash(key, keylen, table->seed);
-	} else {
-		hash = hash32(key, keylen, table->seed);
-	}
-	uint32_t bucket = hash & (table->tableSize - 1);
-	const struct TableList* list = &table->table[bucket];
-	TABLE_LOOKUP_START(HASH_TABLE_MEMCMP_COMPARATOR, list) {
-		iter->bucket = bucket;
-		iter->entry = i;
+	uint32_t hash = _hashKey(table, key, keylen);
+	TABLE_LOOKUP_START(HASH_TABLE_MEMCMP_COMPARATOR, table, hash) {
+		iter->bucket = i;
+		iter->entry = 0;
 		return true;
 	} TABLE_LOOKUP_END;
 	return false;
@@ -671,11 +494,9 @@ bool HashTableIteratorLookupBinary(const struct Table* table, struct TableIterat
 
 bool HashTableIteratorLookupCustom(const struct Table* table, struct TableIterator* iter, void* key) {
 	uint32_t hash = table->fn.hash(key, 0, table->seed);
-	uint32_t bucket = hash & (table->tableSize - 1);
-	const struct TableList* list = &table->table[bucket];
-	TABLE_LOOKUP_START(HASH_TABLE_CUSTOM_COMPARATOR, list) {
-		iter->bucket = bucket;
-		iter->entry = i;
+	TABLE_LOOKUP_START(HASH_TABLE_CUSTOM_COMPARATOR, table, hash) {
+		iter->bucket = i;
+		iter->entry = 0;
 		return true;
 	} TABLE_LOOKUP_END;
 	return false;
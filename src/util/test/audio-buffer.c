@@ -0,0 +1,71 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba-util/audio-buffer.h>
+
+M_TEST_DEFINE(fullAndEmpty) {
+	struct mAudioBuffer buffer;
+	int16_t samples[16 * 2] = {0};
+
+	mAudioBufferInit(&buffer, 16, 2);
+	assert_int_equal(mAudioBufferAvailable(&buffer), 0);
+	assert_int_equal(mAudioBufferRead(&buffer, samples, 1), 0);
+
+	assert_int_equal(mAudioBufferWrite(&buffer, samples, 16), 16);
+	assert_int_equal(mAudioBufferAvailable(&buffer), 16);
+	assert_int_equal(mAudioBufferWrite(&buffer, samples, 1), 0);
+
+	assert_int_equal(mAudioBufferRead(&buffer, NULL, 16), 16);
+	assert_int_equal(mAudioBufferAvailable(&buffer), 0);
+
+	assert_int_equal(mAudioBufferWrite(&buffer, samples, 10), 10);
+	mAudioBufferClear(&buffer);
+	assert_int_equal(mAudioBufferAvailable(&buffer), 0);
+
+	mAudioBufferDeinit(&buffer);
+}
+
+M_TEST_DEFINE(wrap) {
+	struct mAudioBuffer buffer;
+	int16_t samples[24 * 2];
+	int16_t output[24 * 2];
+	size_t i;
+
+	for (i = 0; i < 24; ++i) {
+		samples[i * 2] = i;
+		samples[i * 2 + 1] = -i;
+	}
+
+	mAudioBufferInit(&buffer, 16, 2);
+
+	// Go around the buffer several times to cover every starting offset
+	for (i = 0; i < 48; ++i) {
+		assert_int_equal(mAudioBufferWrite(&buffer, samples, 12), 12);
+		assert_int_equal(mAudioBufferWrite(&buffer, &samples[12 * 2], 12), 4);
+		assert_int_equal(mAudioBufferAvailable(&buffer), 16);
+
+		assert_int_equal(mAudioBufferPeek(&buffer, 0, 13), 13);
+		assert_int_equal(mAudioBufferPeek(&buffer, 1, 13), -13);
+		assert_int_equal(mAudioBufferPeek(&buffer, 0, 16), 0);
+
+		assert_int_equal(mAudioBufferDump(&buffer, output, 24, 4), 12);
+		assert_memory_equal(output, &samples[4 * 2], 12 * 2 * sizeof(int16_t));
+
+		assert_int_equal(mAudioBufferRead(&buffer, output, 24), 16);
+		assert_memory_equal(output, samples, 16 * 2 * sizeof(int16_t));
+
+		assert_int_equal(mAudioBufferWrite(&buffer, samples, (i % 15) + 1), (i % 15) + 1);
+		assert_int_equal(mAudioBufferRead(&buffer, NULL, 16), (i % 15) + 1);
+	}
+
+	mAudioBufferDeinit(&buffer);
+}
+
+M_TEST_SUITE_DEFINE(mAudioBuffer,
+	cmocka_unit_test(fullAndEmpty),
+	cmocka_unit_test(wrap),
+)
@@ -0,0 +1,81 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba-util/audio-buffer.h>
+#include <mgba-util/audio-resampler.h>
+
+static int16_t _at(int index, const void* context) {
+	const int16_t* samples = context;
+	return samples[index];
+}
+
+M_TEST_DEFINE(polyphaseConstant) {
+	struct mAudioBuffer source;
+	struct mAudioBuffer destination;
+	struct mAudioResampler resampler;
+	int16_t samples[256 * 2];
+	size_t i;
+
+	mAudioBufferInit(&source, 0x800, 2);
+	mAudioBufferInit(&destination, 0x800, 2);
+	mAudioResamplerInit(&resampler, mINTERPOLATOR_POLYPHASE);
+	mAudioResamplerSetSource(&resampler, &source, 32768, true);
+	mAudioResamplerSetDestination(&resampler, &destination, 48000);
+
+	for (i = 0; i < 256; ++i) {
+		samples[i * 2] = 0x1234;
+		samples[i * 2 + 1] = -0x1234;
+	}
+	for (i = 0; i < 4; ++i) {
+		assert_int_equal(mAudioBufferWrite(&source, samples, 256), 256);
+		mAudioResamplerProcess(&resampler);
+	}
+	assert_true(mAudioBufferAvailable(&destination) > 1024);
+
+	// Skip the start, which is still fading in from silence
+	assert_int_equal(mAudioBufferRead(&destination, NULL, 64), 64);
+	while (mAudioBufferRead(&destination, samples, 1)) {
+		assert_int_equal(samples[0], 0x1234);
+		assert_int_equal(samples[1], -0x1234);
+	}
+
+	mAudioResamplerDeinit(&resampler);
+	mAudioBufferDeinit(&source);
+	mAudioBufferDeinit(&destination);
+}
+
+M_TEST_DEFINE(polyphaseMatchesInterpolate) {
+	struct mInterpolatorPolyphase interp;
+	int16_t samples[512];
+	float input[512];
+	const float* channels[1] = { input };
+	struct mInterpolationData data = {
+		.at = _at,
+		.context = samples,
+	};
+	size_t i;
+
+	for (i = 0; i < 512; ++i) {
+		samples[i] = (i * 7919) & 0x3FFF;
+		input[i] = samples[i];
+	}
+
+	mInterpolatorPolyphaseInit(&interp, 0, 0);
+	mInterpolatorPolyphaseSetStep(&interp, 2.5);
+	double time;
+	for (time = 64; time < 448; time += 0.73) {
+		int16_t block;
+		mInterpolatorPolyphaseResample(&interp, channels, 1, &block, 1, time, 2.5);
+		assert_int_equal(block, interp.d.interpolate(&interp.d, &data, time, 2.5));
+	}
+	mInterpolatorPolyphaseDeinit(&interp);
+}
+
+M_TEST_SUITE_DEFINE(mAudioResampler,
+	cmocka_unit_test(polyphaseConstant),
+	cmocka_unit_test(polyphaseMatchesInterpolate),
+)
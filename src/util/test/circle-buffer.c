@@ -970,6 +970,27 @@ M_TEST_DEFINE(dumpOffsetWrap) {
 	mCircleBufferDeinit(&buffer);
 }
 
+M_TEST_DEFINE(dumpOffsetPastWrap) {
+	struct mCircleBuffer buffer;
+	const char* data = " Lorem ipsum dolor sit amet, consectetur adipiscing elit placerat.";
+	char databuf[64];
+
+	mCircleBufferInit(&buffer, 64);
+
+	assert_int_equal(mCircleBufferWrite(&buffer, data, 64), 64);
+	assert_int_equal(mCircleBufferRead(&buffer, databuf, 56), 56);
+	assert_int_equal(mCircleBufferWrite(&buffer, data, 48), 48);
+	assert_int_equal(mCircleBufferSize(&buffer), 56);
+
+	assert_int_equal(mCircleBufferDump(&buffer, databuf, 32, 16), 32);
+	assert_memory_equal(&data[8], databuf, 32);
+
+	assert_int_equal(mCircleBufferDump(&buffer, databuf, 64, 8), 48);
+	assert_memory_equal(data, databuf, 48);
+
+	mCircleBufferDeinit(&buffer);
+}
+
 M_TEST_SUITE_DEFINE(mCircleBuffer,
 	cmocka_unit_test(basicCircle),
 	cmocka_unit_test(basicAlignment16),
@@ -992,4 +1013,5 @@ M_TEST_SUITE_DEFINE(mCircleBuffer,
 	cmocka_unit_test(dumpBasic),
 	cmocka_unit_test(dumpOffset),
 	cmocka_unit_test(dumpOffsetWrap),
+	cmocka_unit_test(dumpOffsetPastWrap),
 )
@@ -0,0 +1,175 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba-util/convolve.h>
+
+#define WIDTH 37
+#define HEIGHT 23
+#define STRIDE 160
+
+static void _fill(uint8_t* buffer, size_t size, uint32_t seed) {
+	size_t i;
+	for (i = 0; i < size; ++i) {
+		seed = seed * 1664525 + 1013904223;
+		buffer[i] = seed >> 24;
+	}
+}
+
+// Direct 2D convolution, for comparison
+static void _reference(const uint8_t* src, uint8_t* dst, size_t width, size_t height, size_t stride, size_t channels, const struct ConvolutionKernel* kernel) {
+	size_t kx2 = kernel->dims[0] / 2;
+	size_t ky2 = kernel->dims[1] / 2;
+	size_t x, y, c;
+	for (y = 0; y < height; ++y) {
+		for (x = 0; x < width; ++x) {
+			for (c = 0; c < channels; ++c) {
+				float sum = 0.f;
+				size_t kx, ky;
+				for (ky = 0; ky < kernel->dims[1]; ++ky) {
+					size_t cy = y + ky > ky2 ? y + ky - ky2 : 0;
+					if (cy >= height) {
+						cy = height - 1;
+					}
+					for (kx = 0; kx < kernel->dims[0]; ++kx) {
+						size_t cx = x + kx > kx2 ? x + kx - kx2 : 0;
+						if (cx >= width) {
+							cx = width - 1;
+						}
+						sum += src[cy * stride + cx * channels + c] * kernel->kernel[ky * kernel->dims[0] + kx];
+					}
+				}
+				if (sum <= 0.f) {
+					sum = 0.f;
+				} else if (sum >= 255.f) {
+					sum = 255.f;
+				}
+				dst[y * stride + x * channels + c] = sum;
+			}
+		}
+	}
+}
+
+static void _compare(const uint8_t* a, const uint8_t* b, size_t width, size_t height, size_t stride, int tolerance) {
+	size_t x, y;
+	for (y = 0; y < height; ++y) {
+		for (x = 0; x < width; ++x) {
+			int diff = a[y * stride + x] - b[y * stride + x];
+			assert_true(diff >= -tolerance && diff <= tolerance);
+		}
+	}
+}
+
+M_TEST_DEFINE(radialPacked) {
+	static uint8_t src[STRIDE * HEIGHT];
+	static uint8_t dst[STRIDE * HEIGHT];
+	static uint8_t expected[STRIDE * HEIGHT];
+	_fill(src, sizeof(src), 1);
+
+	size_t dims[] = { 7, 5 };
+	struct ConvolutionKernel kern;
+	ConvolutionKernelCreate(&kern, 2, dims);
+	ConvolutionKernelFillRadial(&kern, true);
+	Convolve2DClampPacked8(src, dst, WIDTH, HEIGHT, STRIDE, &kern);
+	_reference(src, expected, WIDTH, HEIGHT, STRIDE, 1, &kern);
+	ConvolutionKernelDestroy(&kern);
+
+	// Non-separable kernels sum in the same order, so the results are exact
+	_compare(dst, expected, WIDTH, HEIGHT, STRIDE, 0);
+}
+
+M_TEST_DEFINE(radialChannels) {
+	static uint8_t src[STRIDE * HEIGHT];
+	static uint8_t dst[STRIDE * HEIGHT];
+	static uint8_t expected[STRIDE * HEIGHT];
+	_fill(src, sizeof(src), 2);
+
+	size_t dims[] = { 7, 7 };
+	struct ConvolutionKernel kern;
+	ConvolutionKernelCreate(&kern, 2, dims);
+	ConvolutionKernelFillRadial(&kern, true);
+	Convolve2DClampChannels8(src, dst, WIDTH, HEIGHT, STRIDE, 3, &kern);
+	_reference(src, expected, WIDTH, HEIGHT, STRIDE, 3, &kern);
+	ConvolutionKernelDestroy(&kern);
+
+	_compare(dst, expected, WIDTH * 3, HEIGHT, STRIDE, 0);
+}
+
+M_TEST_DEFINE(separableChannels) {
+	static uint8_t src[STRIDE * HEIGHT];
+	static uint8_t dst[STRIDE * HEIGHT];
+	static uint8_t expected[STRIDE * HEIGHT];
+	_fill(src, sizeof(src), 3);
+
+	static const float row[] = { 0.1f, 0.2f, 0.4f, 0.2f, 0.1f };
+	static const float col[] = { 0.25f, 0.5f, 0.25f };
+	size_t dims[] = { 5, 3 };
+	struct ConvolutionKernel kern;
+	ConvolutionKernelCreate(&kern, 2, dims);
+	size_t x, y;
+	for (y = 0; y < 3; ++y) {
+		for (x = 0; x < 5; ++x) {
+			kern.kernel[y * 5 + x] = row[x] * col[y];
+		}
+	}
+	Convolve2DClampChannels8(src, dst, WIDTH, HEIGHT, STRIDE, 4, &kern);
+	_reference(src, expected, WIDTH, HEIGHT, STRIDE, 4, &kern);
+	ConvolutionKernelDestroy(&kern);
+
+	// Splitting the passes changes the rounding slightly
+	_compare(dst, expected, WIDTH * 4, HEIGHT, STRIDE, 1);
+}
+
+M_TEST_DEFINE(sharpenSaturates) {
+	static uint8_t src[STRIDE * HEIGHT];
+	static uint8_t dst[STRIDE * HEIGHT];
+	static uint8_t expected[STRIDE * HEIGHT];
+	_fill(src, sizeof(src), 4);
+
+	static const float sharpen[] = {
+		0.f, -1.f, 0.f,
+		-1.f, 5.f, -1.f,
+		0.f, -1.f, 0.f,
+	};
+	size_t dims[] = { 3, 3 };
+	struct ConvolutionKernel kern;
+	ConvolutionKernelCreate(&kern, 2, dims);
+	memcpy(kern.kernel, sharpen, sizeof(sharpen));
+	Convolve2DClampPacked8(src, dst, WIDTH, HEIGHT, STRIDE, &kern);
+	_reference(src, expected, WIDTH, HEIGHT, STRIDE, 1, &kern);
+	ConvolutionKernelDestroy(&kern);
+
+	_compare(dst, expected, WIDTH, HEIGHT, STRIDE, 0);
+}
+
+M_TEST_DEFINE(emptyKernel) {
+	static uint8_t src[STRIDE * HEIGHT];
+	static uint8_t dst[STRIDE * HEIGHT];
+	_fill(src, sizeof(src), 5);
+	memset(dst, 0xFF, sizeof(dst));
+
+	size_t dims[] = { 0, 0 };
+	struct ConvolutionKernel kern;
+	ConvolutionKernelCreate(&kern, 2, dims);
+	Convolve2DClampPacked8(src, dst, WIDTH, HEIGHT, STRIDE, &kern);
+	ConvolutionKernelDestroy(&kern);
+
+	size_t y;
+	for (y = 0; y < HEIGHT; ++y) {
+		size_t x;
+		for (x = 0; x < WIDTH; ++x) {
+			assert_int_equal(dst[y * STRIDE + x], 0);
+		}
+		assert_int_equal(dst[y * STRIDE + WIDTH], 0xFF);
+	}
+}
+
+M_TEST_SUITE_DEFINE(Convolve,
+	cmocka_unit_test(radialPacked),
+	cmocka_unit_test(radialChannels),
+	cmocka_unit_test(separableChannels),
+	cmocka_unit_test(sharpenSaturates),
+	cmocka_unit_test(emptyKernel))
@@ -6,6 +6,7 @@
 #include "util/test/suite.h"
 
 #include <mgba-util/crc32.h>
+#include <mgba-util/hash.h>
 #include <mgba-util/md5.h>
 #include <mgba-util/sha1.h>
 
@@ -24,6 +25,19 @@ M_TEST_DEFINE(helloWorldCrc32) {
 	assert_int_equal(doCrc32(buffer, strlen(buffer)), 0xEBE6C6E6);
 }
 
+M_TEST_DEFINE(longCrc32) {
+	uint8_t buffer[4096];
+	size_t i;
+	for (i = 0; i < sizeof(buffer); ++i) {
+		buffer[i] = i * 7 + (i >> 8);
+	}
+	assert_int_equal(doCrc32(buffer, 4096), 0x462C1E21);
+	assert_int_equal(doCrc32(&buffer[1], 4095), 0x45F2CB6D);
+	assert_int_equal(doCrc32(&buffer[3], 100), 0x6230AF1A);
+	assert_int_equal(doCrc32(&buffer[5], 64), 0xF30C6EFC);
+	assert_int_equal(doCrc32(&buffer[13], 1000), 0x447240B5);
+}
+
 #ifndef HAVE_CRC32
 M_TEST_DEFINE(stagedCrc32) {
 	uint8_t buffer[1] = { '\n\n' };
@@ -116,6 +130,51 @@ M_TEST_DEFINE(twoBlockMd5) {
 	}), 16);
 }
 
+M_TEST_DEFINE(longMd5) {
+	uint8_t buffer[4096];
+	size_t i;
+	for (i = 0; i < sizeof(buffer); ++i) {
+		buffer[i] = i * 7 + (i >> 8);
+	}
+	uint8_t digest[0x10] = {0};
+	md5Buffer(buffer, 4096, digest);
+	assert_memory_equal(digest, ((uint8_t[]) {
+		0x32, 0x69, 0x6F, 0xD7, 0xD1, 0x76, 0xA4, 0xAB,
+		0xE5, 0x1E, 0xF0, 0x96, 0xA8, 0x85, 0xFA, 0x89
+	}), 16);
+	md5Buffer(&buffer[1], 4095, digest);
+	assert_memory_equal(digest, ((uint8_t[]) {
+		0xA3, 0x06, 0x1F, 0x7A, 0x60, 0xAD, 0xCD, 0x69,
+		0xB9, 0x39, 0x72, 0xAE, 0x1E, 0x8A, 0x6F, 0x9D
+	}), 16);
+}
+
+M_TEST_DEFINE(stagedMd5) {
+	uint8_t buffer[1013];
+	size_t i;
+	for (i = 0; i < sizeof(buffer); ++i) {
+		buffer[i] = i * 7 + (i >> 8);
+	}
+	struct MD5Context ctx;
+	md5Init(&ctx);
+	// Pieces that straddle block boundaries in different ways
+	size_t offset = 13;
+	size_t size = 1;
+	while (offset < sizeof(buffer)) {
+		if (size > sizeof(buffer) - offset) {
+			size = sizeof(buffer) - offset;
+		}
+		md5Update(&ctx, &buffer[offset], size);
+		offset += size;
+		size = size * 3 % 97 + 1;
+	}
+	md5Finalize(&ctx);
+	assert_memory_equal(ctx.digest, ((uint8_t[]) {
+		0xD0, 0xF1, 0x24, 0x13, 0xF3, 0x87, 0xF4, 0xDA,
+		0xD4, 0x9C, 0x1E, 0x41, 0x5D, 0x68, 0x5A, 0x99
+	}), 16);
+}
+
 M_TEST_DEFINE(emptySha1) {
 	uint8_t buffer[1] = {0};
 	uint8_t digest[20] = {0};
@@ -202,10 +261,73 @@ M_TEST_DEFINE(twoBlockSha1) {
 	}), 20);
 }
 
+M_TEST_DEFINE(longSha1) {
+	uint8_t buffer[4096];
+	size_t i;
+	for (i = 0; i < sizeof(buffer); ++i) {
+		buffer[i] = i * 7 + (i >> 8);
+	}
+	uint8_t digest[20] = {0};
+	sha1Buffer(buffer, 4096, digest);
+	assert_memory_equal(digest, ((uint8_t[]) {
+		0xE3, 0xF9, 0x2A, 0x7F, 0x0D, 0x92, 0x3C, 0x8E, 0x43, 0x35,
+		0x2F, 0x9C, 0xEA, 0x7D, 0xA0, 0xC2, 0x6F, 0xB7, 0x82, 0x9B
+	}), 20);
+	sha1Buffer(&buffer[1], 4095, digest);
+	assert_memory_equal(digest, ((uint8_t[]) {
+		0x7F, 0xE2, 0x44, 0xF5, 0x39, 0xB7, 0xC6, 0x5D, 0x8D, 0x87,
+		0x4C, 0x6E, 0xC5, 0x3C, 0x72, 0xF7, 0xA0, 0xB1, 0x73, 0xD6
+	}), 20);
+}
+
+M_TEST_DEFINE(stagedSha1) {
+	uint8_t buffer[1013];
+	size_t i;
+	for (i = 0; i < sizeof(buffer); ++i) {
+		buffer[i] = i * 7 + (i >> 8);
+	}
+	struct SHA1Context ctx;
+	sha1Init(&ctx);
+	// Pieces that straddle block boundaries in different ways
+	size_t offset = 13;
+	size_t size = 1;
+	while (offset < sizeof(buffer)) {
+		if (size > sizeof(buffer) - offset) {
+			size = sizeof(buffer) - offset;
+		}
+		sha1Update(&ctx, &buffer[offset], size);
+		offset += size;
+		size = size * 3 % 97 + 1;
+	}
+	uint8_t digest[20] = {0};
+	sha1Finalize(digest, &ctx);
+	assert_memory_equal(digest, ((uint8_t[]) {
+		0x3A, 0xD3, 0x74, 0xB9, 0xB1, 0x5F, 0x2B, 0x4F, 0xDF, 0x85,
+		0x20, 0xC2, 0x43, 0xC2, 0xC9, 0x9A, 0xC9, 0x95, 0xD8, 0xFD
+	}), 20);
+}
+
+M_TEST_DEFINE(shortHash64) {
+	assert_int_equal(hash64("", 0, 0), 0x93228A4DE0EEC5A2ULL);
+	assert_int_equal(hash64("a", 1, 1), 0xC5BAC3DB178713C4ULL);
+	assert_int_equal(hash64("abc", 3, 2), 0xA97F2F7B1D9B3314ULL);
+	assert_int_equal(hash64("message digest", 14, 3), 0x786D1F1DF3801DF4ULL);
+}
+
+M_TEST_DEFINE(longHash64) {
+	const char* buffer = "abcdefghijklmnopqrstuvwxyz";
+	assert_int_equal(hash64(buffer, strlen(buffer), 4), 0xDCA5A8138AD37C87ULL);
+	buffer = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+	assert_int_equal(hash64(buffer, strlen(buffer), 5), 0xB9E734F117CFAF70ULL);
+	buffer = "12345678901234567890123456789012345678901234567890123456789012345678901234567890";
+	assert_int_equal(hash64(buffer, strlen(buffer), 6), 0x6CC5EAB49A92D617ULL);
+}
+
 M_TEST_SUITE_DEFINE(Hashes,
 	cmocka_unit_test(emptyCrc32),
 	cmocka_unit_test(newlineCrc32),
 	cmocka_unit_test(helloWorldCrc32),
+	cmocka_unit_test(longCrc32),
 #ifndef HAVE_CRC32
 	cmocka_unit_test(stagedCrc32),
 #endif
@@ -214,9 +336,15 @@ M_TEST_SUITE_DEFINE(Hashes,
 	cmocka_unit_test(fullBlockMd5),
 	cmocka_unit_test(overflowBlockMd5),
 	cmocka_unit_test(twoBlockMd5),
+	cmocka_unit_test(longMd5),
+	cmocka_unit_test(stagedMd5),
 	cmocka_unit_test(emptySha1),
 	cmocka_unit_test(newlineSha1),
 	cmocka_unit_test(fullBlockSha1),
 	cmocka_unit_test(overflowBlockSha1),
 	cmocka_unit_test(twoBlockSha1),
+	cmocka_unit_test(longSha1),
+	cmocka_unit_test(stagedSha1),
+	cmocka_unit_test(shortHash64),
+	cmocka_unit_test(longHash64),
 )
@@ -711,6 +711,49 @@ M_TEST_DEFINE(savePngPal8) {
 }
 #endif
 
+M_TEST_DEFINE(saveQoi) {
+	static const uint8_t expected[] = {
+		'q', 'o', 'i', 'f', 0, 0, 0, 4, 0, 0, 0, 1, 4, 0,
+		0xFE, 0x18, 0x10, 0x08, // RGB
+		0xC0, // Run of 1
+		0x7A, // Diff of (1, 0, 0)
+		0xFF, 0x18, 0x10, 0x08, 0x80, // RGBA
+		0, 0, 0, 0, 0, 0, 0, 1
+	};
+	struct mImage* image = mImageCreate(4, 1, mCOLOR_ARGB8);
+	mImageSetPixel(image, 0, 0, 0xFF181008);
+	mImageSetPixel(image, 1, 0, 0xFF181008);
+	mImageSetPixel(image, 2, 0, 0xFF191008);
+	mImageSetPixel(image, 3, 0, 0x80181008);
+
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	assert_true(mImageSaveVF(image, vf, "qoi"));
+	mImageDestroy(image);
+
+	uint8_t buffer[sizeof(expected) + 1];
+	assert_int_equal(vf->seek(vf, 0, SEEK_SET), 0);
+	assert_int_equal(vf->read(vf, buffer, sizeof(buffer)), sizeof(expected));
+	assert_memory_equal(buffer, expected, sizeof(expected));
+	vf->close(vf);
+}
+
+M_TEST_DEFINE(savePpm) {
+	static const uint8_t expected[] = "P6\n2 1\n255\n\x18\x10\x08\x10\x08\x18";
+	struct mImage* image = mImageCreate(2, 1, mCOLOR_RGB565);
+	mImageSetPixel(image, 0, 0, 0xFF181008);
+	mImageSetPixel(image, 1, 0, 0xFF100818);
+
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	assert_true(mImageSaveVF(image, vf, "ppm"));
+	mImageDestroy(image);
+
+	uint8_t buffer[sizeof(expected)];
+	assert_int_equal(vf->seek(vf, 0, SEEK_SET), 0);
+	assert_int_equal(vf->read(vf, buffer, sizeof(buffer)), sizeof(expected) - 1);
+	assert_memory_equal(buffer, expected, sizeof(expected) - 1);
+	vf->close(vf);
+}
+
 M_TEST_DEFINE(convert1x1) {
 	const enum mColorFormat formats[] = {
 		mCOLOR_XBGR8, mCOLOR_XRGB8,
@@ -2134,6 +2177,92 @@ M_TEST_DEFINE(painterDrawMaskBlend) {
 #undef COMPARE4X
 #undef COMPARE4
 
+M_TEST_DEFINE(convertWide) {
+	const enum mColorFormat formats[] = {
+		mCOLOR_XBGR8, mCOLOR_XRGB8,
+		mCOLOR_BGRX8, mCOLOR_RGBX8,
+		mCOLOR_ABGR8, mCOLOR_ARGB8,
+		mCOLOR_BGRA8, mCOLOR_RGBA8,
+		mCOLOR_RGB5, mCOLOR_BGR5,
+		mCOLOR_RGB565, mCOLOR_BGR565,
+		mCOLOR_ARGB5, mCOLOR_ABGR5,
+		mCOLOR_RGBA5, mCOLOR_BGRA5,
+		mCOLOR_RGB8, mCOLOR_BGR8,
+		mCOLOR_L8,
+		0
+	};
+
+	int i, j;
+	unsigned x, y;
+	for (i = 0; formats[i]; ++i) {
+		// Odd widths exercise both the vector and scalar parts of each row
+		struct mImage* src = calloc(1, sizeof(*src));
+		src->width = 13;
+		src->height = 3;
+		src->stride = 16;
+		src->format = formats[i];
+		src->depth = mColorFormatBytes(src->format);
+		src->data = calloc(src->stride * src->depth, src->height);
+		uint32_t seed = 0x12345678;
+		for (y = 0; y < src->height; ++y) {
+			for (x = 0; x < src->width; ++x) {
+				seed = seed * 1103515245 + 12345;
+				mImageSetPixelRaw(src, x, y, seed);
+			}
+		}
+		for (j = 0; formats[j]; ++j) {
+			struct mImage* dst = mImageConvertToFormat(src, formats[j]);
+			assert_non_null(dst);
+			for (y = 0; y < src->height; ++y) {
+				for (x = 0; x < src->width; ++x) {
+					uint32_t color = mImageGetPixelRaw(src, x, y);
+					assert_int_equal(mImageGetPixelRaw(dst, x, y), mColorConvert(color, formats[i], formats[j]));
+				}
+			}
+			mImageDestroy(dst);
+		}
+		mImageDestroy(src);
+	}
+}
+
+M_TEST_DEFINE(blitConvert) {
+	const enum mColorFormat formats[] = {
+		mCOLOR_XBGR8, mCOLOR_ARGB8,
+		mCOLOR_RGBA8, mCOLOR_RGB5,
+		mCOLOR_RGB565, mCOLOR_ABGR5,
+		mCOLOR_RGB8, mCOLOR_L8,
+		0
+	};
+
+	int i, j;
+	unsigned x, y;
+	for (i = 0; formats[i]; ++i) {
+		struct mImage* src = mImageCreate(11, 2, formats[i]);
+		uint32_t seed = 0x87654321;
+		for (y = 0; y < src->height; ++y) {
+			for (x = 0; x < src->width; ++x) {
+				seed = seed * 1103515245 + 12345;
+				mImageSetPixelRaw(src, x, y, seed);
+			}
+		}
+		for (j = 0; formats[j]; ++j) {
+			struct mImage* dst = mImageCreate(16, 4, formats[j]);
+			mImageBlit(dst, src, 3, 1);
+			for (y = 0; y < dst->height; ++y) {
+				for (x = 0; x < dst->width; ++x) {
+					uint32_t expected = 0;
+					if (x >= 3 && x < 14 && y >= 1 && y < 3) {
+						expected = mColorConvert(mImageGetPixelRaw(src, x - 3, y - 1), formats[i], formats[j]);
+					}
+					assert_int_equal(mImageGetPixelRaw(dst, x, y), expected);
+				}
+			}
+			mImageDestroy(dst);
+		}
+		mImageDestroy(src);
+	}
+}
+
 M_TEST_SUITE_DEFINE(Image,
 	cmocka_unit_test(zeroDim),
 	cmocka_unit_test(pitchRead),
@@ -2153,10 +2282,14 @@ M_TEST_SUITE_DEFINE(Image,
 	cmocka_unit_test(savePngL8),
 	cmocka_unit_test(savePngPal8),
 #endif
+	cmocka_unit_test(saveQoi),
+	cmocka_unit_test(savePpm),
 	cmocka_unit_test(convert1x1),
 	cmocka_unit_test(convert2x1),
 	cmocka_unit_test(convert1x2),
 	cmocka_unit_test(convert2x2),
+	cmocka_unit_test(convertWide),
+	cmocka_unit_test(blitConvert),
 	cmocka_unit_test(blitBoundaries),
 	cmocka_unit_test(painterFillRectangle),
 	cmocka_unit_test(painterFillRectangleBlend),
@@ -0,0 +1,165 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba-util/crc32.h>
+#include <mgba-util/patch.h>
+#include <mgba-util/vfs.h>
+
+#define SOURCE_SIZE 0x40
+#define LONG_READ 0x2345
+
+static void _writeLength(struct VFile* vf, size_t value) {
+	while (true) {
+		uint8_t byte = value & 0x7F;
+		value >>= 7;
+		if (!value) {
+			byte |= 0x80;
+			vf->write(vf, &byte, 1);
+			return;
+		}
+		vf->write(vf, &byte, 1);
+		--value;
+	}
+}
+
+static void _writeCommand(struct VFile* vf, int command, size_t length) {
+	_writeLength(vf, ((length - 1) << 2) | command);
+}
+
+static void _finish(struct VFile* vf, const uint8_t* source, const uint8_t* target, size_t targetSize) {
+	uint32_t crc = doCrc32(source, SOURCE_SIZE);
+	vf->write(vf, &crc, sizeof(crc));
+	crc = doCrc32(target, targetSize);
+	vf->write(vf, &crc, sizeof(crc));
+	crc = fileCrc32(vf, vf->size(vf));
+	vf->seek(vf, 0, SEEK_END);
+	vf->write(vf, &crc, sizeof(crc));
+}
+
+static void _fillSource(uint8_t* source) {
+	size_t i;
+	for (i = 0; i < SOURCE_SIZE; ++i) {
+		source[i] = i;
+	}
+}
+
+// Builds a patch exercising all four commands, and the target it should produce
+static struct VFile* _buildPatch(const uint8_t* source, uint8_t* target) {
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	vf->write(vf, "BPS1", 4);
+	_writeLength(vf, SOURCE_SIZE);
+	_writeLength(vf, SOURCE_SIZE);
+	_writeLength(vf, 3);
+	vf->write(vf, "abc", 3);
+
+	_writeCommand(vf, 0, 0x10);
+	memcpy(target, source, 0x10);
+
+	_writeCommand(vf, 1, 4);
+	vf->write(vf, "ABCD", 4);
+	memcpy(&target[0x10], "ABCD", 4);
+
+	_writeCommand(vf, 2, 8);
+	_writeLength(vf, 0x28 << 1);
+	memcpy(&target[0x14], &source[0x28], 8);
+
+	// Overlaps the bytes being written, so it repeats them
+	_writeCommand(vf, 3, 8);
+	_writeLength(vf, 0x18 << 1);
+	size_t i;
+	for (i = 0; i < 8; ++i) {
+		target[0x1C + i] = target[0x18 + i];
+	}
+
+	_writeCommand(vf, 0, SOURCE_SIZE - 0x24);
+	memcpy(&target[0x24], &source[0x24], SOURCE_SIZE - 0x24);
+
+	_finish(vf, source, target, SOURCE_SIZE);
+	return vf;
+}
+
+M_TEST_DEFINE(applyCommands) {
+	uint8_t source[SOURCE_SIZE];
+	uint8_t target[SOURCE_SIZE];
+	uint8_t result[SOURCE_SIZE];
+	_fillSource(source);
+	struct VFile* vf = _buildPatch(source, target);
+
+	struct Patch patch;
+	assert_true(loadPatch(vf, &patch));
+	assert_int_equal(patch.outputSize(&patch, SOURCE_SIZE), SOURCE_SIZE);
+	assert_int_equal(patch.outputSize(&patch, SOURCE_SIZE + 1), 0);
+	memset(result, 0, sizeof(result));
+	assert_true(patch.applyPatch(&patch, source, SOURCE_SIZE, result, SOURCE_SIZE));
+	assert_memory_equal(result, target, SOURCE_SIZE);
+	vf->close(vf);
+}
+
+M_TEST_DEFINE(applyLongRead) {
+	uint8_t source[SOURCE_SIZE];
+	static uint8_t target[LONG_READ + SOURCE_SIZE];
+	static uint8_t result[LONG_READ + SOURCE_SIZE];
+	_fillSource(source);
+
+	// A single TargetRead longer than the read buffer, followed by more commands
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	vf->write(vf, "BPS1", 4);
+	_writeLength(vf, SOURCE_SIZE);
+	_writeLength(vf, LONG_READ + SOURCE_SIZE);
+	_writeLength(vf, 0);
+	_writeCommand(vf, 1, LONG_READ);
+	size_t i;
+	for (i = 0; i < LONG_READ; ++i) {
+		target[i] = i * 7;
+	}
+	vf->write(vf, target, LONG_READ);
+	_writeCommand(vf, 2, SOURCE_SIZE);
+	_writeLength(vf, 0);
+	memcpy(&target[LONG_READ], source, SOURCE_SIZE);
+	_finish(vf, source, target, sizeof(target));
+
+	struct Patch patch;
+	assert_true(loadPatch(vf, &patch));
+	assert_int_equal(patch.outputSize(&patch, SOURCE_SIZE), sizeof(target));
+	assert_true(patch.applyPatch(&patch, source, SOURCE_SIZE, result, sizeof(result)));
+	assert_memory_equal(result, target, sizeof(target));
+	vf->close(vf);
+}
+
+M_TEST_DEFINE(rejectWrongSource) {
+	uint8_t source[SOURCE_SIZE];
+	uint8_t target[SOURCE_SIZE];
+	uint8_t result[SOURCE_SIZE];
+	_fillSource(source);
+	struct VFile* vf = _buildPatch(source, target);
+
+	struct Patch patch;
+	assert_true(loadPatch(vf, &patch));
+	source[0] ^= 1;
+	assert_false(patch.applyPatch(&patch, source, SOURCE_SIZE, result, SOURCE_SIZE));
+	vf->close(vf);
+}
+
+M_TEST_DEFINE(rejectCorruptPatch) {
+	uint8_t source[SOURCE_SIZE];
+	uint8_t target[SOURCE_SIZE];
+	_fillSource(source);
+	struct VFile* vf = _buildPatch(source, target);
+
+	uint8_t byte = 0;
+	vf->seek(vf, 12, SEEK_SET);
+	vf->write(vf, &byte, 1);
+	struct Patch patch;
+	assert_false(loadPatch(vf, &patch));
+	vf->close(vf);
+}
+
+M_TEST_SUITE_DEFINE(PatchBPS,
+	cmocka_unit_test(applyCommands),
+	cmocka_unit_test(applyLongRead),
+	cmocka_unit_test(rejectWrongSource),
+	cmocka_unit_test(rejectCorruptPatch))
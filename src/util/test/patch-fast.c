@@ -0,0 +1,112 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba-util/patch/fast.h>
+
+#define BUFFER_SIZE 0x2345
+
+static uint32_t _random(uint32_t* seed) {
+	*seed = *seed * 1664525 + 1013904223;
+	return *seed >> 8;
+}
+
+static void _fill(uint8_t* in, uint8_t* out, uint32_t seed) {
+	size_t i;
+	for (i = 0; i < BUFFER_SIZE; ++i) {
+		in[i] = _random(&seed);
+	}
+	memcpy(out, in, BUFFER_SIZE);
+	// Scatter runs of changes of varying length, including some at odd offsets
+	for (i = 0; i < 40; ++i) {
+		size_t off = _random(&seed) % BUFFER_SIZE;
+		size_t length = _random(&seed) % 700;
+		for (; length && off < BUFFER_SIZE; --length, ++off) {
+			out[off] ^= _random(&seed) | 1;
+		}
+	}
+}
+
+M_TEST_DEFINE(identical) {
+	static uint8_t in[BUFFER_SIZE];
+	static uint8_t out[BUFFER_SIZE];
+	struct PatchFast patch;
+	initPatchFast(&patch);
+	_fill(in, out, 1);
+	memcpy(out, in, BUFFER_SIZE);
+	assert_true(diffPatchFast(&patch, in, out, BUFFER_SIZE));
+	assert_int_equal(PatchFastExtentsSize(&patch.extents), 0);
+	deinitPatchFast(&patch);
+}
+
+M_TEST_DEFINE(roundTrip) {
+	static uint8_t in[BUFFER_SIZE];
+	static uint8_t out[BUFFER_SIZE];
+	static uint8_t result[BUFFER_SIZE];
+	struct PatchFast patch;
+	initPatchFast(&patch);
+	uint32_t seed;
+	for (seed = 0; seed < 16; ++seed) {
+		_fill(in, out, seed);
+		assert_true(diffPatchFast(&patch, in, out, BUFFER_SIZE));
+		memset(result, 0, sizeof(result));
+		assert_true(patch.d.applyPatch(&patch.d, in, BUFFER_SIZE, result, BUFFER_SIZE));
+		assert_memory_equal(result, out, BUFFER_SIZE);
+		assert_true(patch.d.applyPatch(&patch.d, out, BUFFER_SIZE, result, BUFFER_SIZE));
+		assert_memory_equal(result, in, BUFFER_SIZE);
+	}
+	deinitPatchFast(&patch);
+}
+
+M_TEST_DEFINE(splitRanges) {
+	static uint8_t in[BUFFER_SIZE];
+	static uint8_t out[BUFFER_SIZE];
+	static uint8_t result[BUFFER_SIZE];
+	struct PatchFast patch;
+	struct PatchFast second;
+	initPatchFast(&patch);
+	initPatchFast(&second);
+	static const size_t splits[] = { 0, 1, 16, 0x333, 0x1000, BUFFER_SIZE - 3 };
+	uint32_t seed;
+	size_t i;
+	for (seed = 0; seed < 4; ++seed) {
+		_fill(in, out, seed + 100);
+		for (i = 0; i < sizeof(splits) / sizeof(*splits); ++i) {
+			size_t split = splits[i];
+			PatchFastExtentsClear(&patch.extents);
+			PatchFastExtentsClear(&second.extents);
+			assert_true(diffPatchFastRange(&patch, in, out, 0, split));
+			assert_true(diffPatchFastRange(&second, in, out, split, BUFFER_SIZE - split));
+			appendPatchFast(&patch, &second);
+			assert_true(patch.d.applyPatch(&patch.d, in, BUFFER_SIZE, result, BUFFER_SIZE));
+			assert_memory_equal(result, out, BUFFER_SIZE);
+		}
+	}
+	deinitPatchFast(&patch);
+	deinitPatchFast(&second);
+}
+
+M_TEST_DEFINE(skippedRange) {
+	static uint8_t in[BUFFER_SIZE];
+	static uint8_t out[BUFFER_SIZE];
+	static uint8_t result[BUFFER_SIZE];
+	struct PatchFast patch;
+	initPatchFast(&patch);
+	_fill(in, out, 7);
+	// Bytes outside of the diffed range come straight from the input
+	assert_true(diffPatchFastRange(&patch, in, out, 0x101, 0x1003));
+	assert_true(patch.d.applyPatch(&patch.d, in, BUFFER_SIZE, result, BUFFER_SIZE));
+	assert_memory_equal(result, in, 0x101);
+	assert_memory_equal(&result[0x101], &out[0x101], 0x1003);
+	assert_memory_equal(&result[0x1104], &in[0x1104], BUFFER_SIZE - 0x1104);
+	deinitPatchFast(&patch);
+}
+
+M_TEST_SUITE_DEFINE(PatchFast,
+	cmocka_unit_test(identical),
+	cmocka_unit_test(roundTrip),
+	cmocka_unit_test(splitRanges),
+	cmocka_unit_test(skippedRange))
@@ -0,0 +1,108 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba-util/ring-fifo.h>
+
+#define FIFO_VALUES 100000
+
+M_TEST_DEFINE(basicFIFO) {
+	struct RingFIFO fifo;
+	RingFIFOInit(&fifo, 64);
+
+	uint32_t i;
+	for (i = 0; i < 8; ++i) {
+		assert_int_equal(RingFIFOWrite(&fifo, &i, sizeof(i)), sizeof(i));
+	}
+	assert_int_equal(RingFIFOSize(&fifo), 8 * sizeof(i));
+	for (i = 0; i < 8; ++i) {
+		uint32_t value;
+		assert_int_equal(RingFIFORead(&fifo, &value, sizeof(value)), sizeof(value));
+		assert_int_equal(value, i);
+	}
+	assert_int_equal(RingFIFOSize(&fifo), 0);
+
+	RingFIFODeinit(&fifo);
+}
+
+M_TEST_DEFINE(emptyFull) {
+	struct RingFIFO fifo;
+	RingFIFOInit(&fifo, 64);
+
+	uint32_t value = 0;
+	assert_int_equal(RingFIFORead(&fifo, &value, sizeof(value)), 0);
+
+	// One slot always stays unused, so that a full FIFO doesn't look empty
+	uint32_t i;
+	for (i = 0; i < 15; ++i) {
+		assert_int_equal(RingFIFOWrite(&fifo, &i, sizeof(i)), sizeof(i));
+	}
+	assert_int_equal(RingFIFOWrite(&fifo, &i, sizeof(i)), 0);
+
+	assert_int_equal(RingFIFORead(&fifo, &value, sizeof(value)), sizeof(value));
+	assert_int_equal(value, 0);
+	assert_int_equal(RingFIFORead(&fifo, &value, sizeof(value)), sizeof(value));
+	assert_int_equal(value, 1);
+	assert_int_equal(RingFIFOWrite(&fifo, &i, sizeof(i)), sizeof(i));
+
+	RingFIFODeinit(&fifo);
+}
+
+M_TEST_DEFINE(wrap) {
+	struct RingFIFO fifo;
+	RingFIFOInit(&fifo, 64);
+
+	uint32_t i;
+	uint32_t next = 0;
+	for (i = 0; i < 100; ++i) {
+		uint32_t value[3] = { i, i + 1, i + 2 };
+		assert_int_equal(RingFIFOWrite(&fifo, value, sizeof(value)), sizeof(value));
+		assert_int_equal(RingFIFORead(&fifo, value, sizeof(value)), sizeof(value));
+		assert_int_equal(value[0], next);
+		assert_int_equal(value[2], next + 2);
+		++next;
+	}
+
+	RingFIFODeinit(&fifo);
+}
+
+#ifndef DISABLE_THREADING
+static THREAD_ENTRY _produce(void* user) {
+	struct RingFIFO* fifo = user;
+	uint32_t i;
+	for (i = 0; i < FIFO_VALUES; ++i) {
+		RingFIFOWriteWait(fifo, &i, sizeof(i));
+	}
+	THREAD_EXIT(0);
+}
+
+M_TEST_DEFINE(waitThreads) {
+	struct RingFIFO fifo;
+	RingFIFOInit(&fifo, 64);
+
+	Thread thread;
+	ThreadCreate(&thread, _produce, &fifo);
+	uint32_t i;
+	for (i = 0; i < FIFO_VALUES; ++i) {
+		uint32_t value;
+		assert_int_equal(RingFIFOReadWait(&fifo, &value, sizeof(value)), sizeof(value));
+		assert_int_equal(value, i);
+	}
+	ThreadJoin(&thread);
+	assert_int_equal(RingFIFOSize(&fifo), 0);
+
+	RingFIFODeinit(&fifo);
+}
+#endif
+
+M_TEST_SUITE_DEFINE(RingFIFO,
+	cmocka_unit_test(basicFIFO),
+	cmocka_unit_test(emptyFull),
+	cmocka_unit_test(wrap),
+#ifndef DISABLE_THREADING
+	cmocka_unit_test(waitThreads),
+#endif
+)
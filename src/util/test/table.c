@@ -23,6 +23,44 @@ M_TEST_DEFINE(basic) {
 	TableDeinit(&table);
 }
 
+M_TEST_DEFINE(basicRemove) {
+	struct Table table;
+	TableInit(&table, 0, NULL);
+
+	size_t i;
+	for (i = 0; i < 5000; ++i) {
+		TableInsert(&table, i << 12, (void*) (i + 1));
+	}
+	for (i = 0; i < 5000; i += 2) {
+		TableRemove(&table, i << 12);
+	}
+	assert_int_equal(TableSize(&table), 2500);
+
+	for (i = 0; i < 5000; ++i) {
+		if (i & 1) {
+			assert_int_equal(i + 1, (size_t) TableLookup(&table, i << 12));
+		} else {
+			assert_null(TableLookup(&table, i << 12));
+		}
+	}
+
+	struct TableIterator iter;
+	size_t count = 0;
+	assert_true(TableIteratorStart(&table, &iter));
+	do {
+		assert_int_equal(TableIteratorGetKey(&table, &iter) >> 12, (uintptr_t) TableIteratorGetValue(&table, &iter) - 1);
+		++count;
+	} while (TableIteratorNext(&table, &iter));
+	assert_int_equal(count, 2500);
+
+	TableClear(&table);
+	assert_int_equal(TableSize(&table), 0);
+	assert_null(TableLookup(&table, 1 << 12));
+	assert_false(TableIteratorStart(&table, &iter));
+
+	TableDeinit(&table);
+}
+
 M_TEST_DEFINE(iterator) {
 	struct Table table;
 	struct TableIterator iter;
@@ -92,6 +130,34 @@ M_TEST_DEFINE(hash) {
 	HashTableDeinit(&table);
 }
 
+M_TEST_DEFINE(hashRemove) {
+	struct Table table;
+	HashTableInit(&table, 0, free);
+
+	size_t i;
+	char buffer[16];
+	for (i = 0; i < 5000; ++i) {
+		snprintf(buffer, sizeof(buffer), "%"PRIz"i", i);
+		HashTableInsert(&table, buffer, strdup(buffer));
+	}
+	for (i = 0; i < 5000; i += 3) {
+		snprintf(buffer, sizeof(buffer), "%"PRIz"i", i);
+		HashTableRemove(&table, buffer);
+	}
+	assert_int_equal(HashTableSize(&table), 3333);
+
+	for (i = 0; i < 5000; ++i) {
+		snprintf(buffer, sizeof(buffer), "%"PRIz"i", i);
+		if (i % 3) {
+			assert_string_equal(buffer, HashTableLookup(&table, buffer));
+		} else {
+			assert_null(HashTableLookup(&table, buffer));
+		}
+	}
+
+	HashTableDeinit(&table);
+}
+
 M_TEST_DEFINE(hashIterator) {
 	struct Table table;
 	struct TableIterator iter;
@@ -150,9 +216,11 @@ M_TEST_DEFINE(hashIteratorLookup) {
 
 M_TEST_SUITE_DEFINE(Table,
 	cmocka_unit_test(basic),
+	cmocka_unit_test(basicRemove),
 	cmocka_unit_test(iterator),
 	cmocka_unit_test(iteratorLookup),
 	cmocka_unit_test(hash),
+	cmocka_unit_test(hashRemove),
 	cmocka_unit_test(hashIterator),
 	cmocka_unit_test(hashIteratorLookup),
 )
@@ -174,6 +174,64 @@ M_TEST_DEFINE(mapMemChunk) {
 	vf->close(vf);
 }
 
+M_TEST_DEFINE(asyncRead) {
+	size_t size = 0x4C321;
+	uint8_t* bytes = malloc(size);
+	size_t i;
+	for (i = 0; i < size; ++i) {
+		bytes[i] = i * 7 + (i >> 11);
+	}
+	struct VFile* vf = VFileAsync(VFileMemChunk(bytes, size));
+	assert_non_null(vf);
+	assert_int_equal(vf->size(vf), size);
+
+	uint8_t buffer[0x3001];
+	size_t offset = 0;
+	while (offset < size) {
+		ssize_t read = vf->read(vf, buffer, sizeof(buffer));
+		assert_true(read > 0);
+		assert_memory_equal(buffer, &bytes[offset], read);
+		offset += read;
+	}
+	assert_int_equal(offset, size);
+	assert_int_equal(vf->read(vf, buffer, sizeof(buffer)), 0);
+
+	assert_int_equal(vf->seek(vf, 0x1234, SEEK_SET), 0x1234);
+	assert_int_equal(vf->read(vf, buffer, 0x100), 0x100);
+	assert_memory_equal(buffer, &bytes[0x1234], 0x100);
+
+	assert_int_equal(vf->seek(vf, -0x10, SEEK_END), size - 0x10);
+	assert_int_equal(vf->read(vf, buffer, sizeof(buffer)), 0x10);
+	assert_memory_equal(buffer, &bytes[size - 0x10], 0x10);
+	vf->close(vf);
+	free(bytes);
+}
+
+M_TEST_DEFINE(asyncWrite) {
+	struct VFile* vf = VFileAsync(VFileMemChunk(NULL, 0));
+	assert_non_null(vf);
+	uint32_t i;
+	for (i = 0; i < 0x10000; ++i) {
+		assert_int_equal(vf->write(vf, &i, sizeof(i)), sizeof(i));
+	}
+	assert_int_equal(vf->size(vf), 0x40000);
+
+	uint32_t value = 0xDEADBEEF;
+	assert_int_equal(vf->seek(vf, 0x100, SEEK_SET), 0x100);
+	assert_int_equal(vf->write(vf, &value, sizeof(value)), sizeof(value));
+
+	uint32_t read;
+	assert_int_equal(vf->seek(vf, 0xFC, SEEK_SET), 0xFC);
+	assert_int_equal(vf->read(vf, &read, sizeof(read)), sizeof(read));
+	assert_int_equal(read, 0x3F);
+	assert_int_equal(vf->read(vf, &read, sizeof(read)), sizeof(read));
+	assert_int_equal(read, 0xDEADBEEF);
+	assert_int_equal(vf->seek(vf, -4, SEEK_END), 0x3FFFC);
+	assert_int_equal(vf->read(vf, &read, sizeof(read)), sizeof(read));
+	assert_int_equal(read, 0xFFFF);
+	assert_true(vf->close(vf));
+}
+
 M_TEST_SUITE_DEFINE(VFS,
 #ifdef ENABLE_VFS
 	cmocka_unit_test(openNullPathR),
@@ -193,4 +251,6 @@ M_TEST_SUITE_DEFINE(VFS,
 	cmocka_unit_test(resizeMemChunk),
 	cmocka_unit_test(mapMem),
 	cmocka_unit_test(mapConstMem),
-	cmocka_unit_test(mapMemChunk))
+	cmocka_unit_test(mapMemChunk),
+	cmocka_unit_test(asyncRead),
+	cmocka_unit_test(asyncWrite))
@@ -0,0 +1,405 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba-util/vfs.h>
+
+#include <mgba-util/threading.h>
+
+#ifndef DISABLE_THREADING
+#define ASYNC_BLOCK_SIZE 0x10000
+#define ASYNC_BLOCKS 4
+
+struct VFileAsyncBlock {
+	uint8_t* data;
+	size_t offset;
+	size_t size;
+	bool ready;
+};
+
+// All access to the backing file happens on the worker thread, except for
+// operations that can't be deferred, which first wait for the worker to go idle
+struct VFileAsync {
+	struct VFile d;
+	struct VFile* backing;
+
+	Thread thread;
+	Mutex mutex;
+	Condition workerCond;
+	Condition clientCond;
+	bool shutdown;
+	bool busy;
+	bool error;
+
+	size_t position;
+
+	// Read-ahead window: ASYNC_BLOCKS blocks in a ring, starting at head, covering
+	// the file sequentially up to nextOffset. Bumping the generation discards the
+	// result of a read that was in flight when the window was moved
+	struct VFileAsyncBlock blocks[ASYNC_BLOCKS];
+	size_t head;
+	size_t count;
+	size_t nextOffset;
+	unsigned generation;
+	bool reading;
+	bool eof;
+
+	// Writes are gathered into one buffer while the other is being flushed
+	uint8_t* writeBuffer;
+	size_t writeOffset;
+	size_t writeSize;
+	uint8_t* flushBuffer;
+	size_t flushOffset;
+	size_t flushSize;
+	bool flushing;
+};
+
+static bool _vfaClose(struct VFile* vf);
+static off_t _vfaSeek(struct VFile* vf, off_t offset, int whence);
+static ssize_t _vfaRead(struct VFile* vf, void* buffer, size_t size);
+static ssize_t _vfaWrite(struct VFile* vf, const void* buffer, size_t size);
+static void* _vfaMap(struct VFile* vf, size_t size, int flags);
+static void _vfaUnmap(struct VFile* vf, void* memory, size_t size);
+static void _vfaTruncate(struct VFile* vf, size_t size);
+static ssize_t _vfaSize(struct VFile* vf);
+static bool _vfaSync(struct VFile* vf, void* buffer, size_t size);
+
+static THREAD_ENTRY _vfaRun(void* context);
+
+struct VFile* VFileAsync(struct VFile* backing) {
+	if (!backing) {
+		return NULL;
+	}
+
+	struct VFileAsync* vfa = calloc(1, sizeof(*vfa));
+	if (!vfa) {
+		return backing;
+	}
+	vfa->backing = backing;
+	size_t i;
+	for (i = 0; i < ASYNC_BLOCKS; ++i) {
+		vfa->blocks[i].data = malloc(ASYNC_BLOCK_SIZE);
+	}
+	vfa->writeBuffer = malloc(ASYNC_BLOCK_SIZE);
+	vfa->flushBuffer = malloc(ASYNC_BLOCK_SIZE);
+	vfa->reading = true;
+
+	MutexInit(&vfa->mutex);
+	ConditionInit(&vfa->workerCond);
+	ConditionInit(&vfa->clientCond);
+	if (ThreadCreate(&vfa->thread, _vfaRun, vfa)) {
+		ConditionDeinit(&vfa->clientCond);
+		ConditionDeinit(&vfa->workerCond);
+		MutexDeinit(&vfa->mutex);
+		for (i = 0; i < ASYNC_BLOCKS; ++i) {
+			free(vfa->blocks[i].data);
+		}
+		free(vfa->writeBuffer);
+		free(vfa->flushBuffer);
+		free(vfa);
+		return backing;
+	}
+
+	vfa->d.close = _vfaClose;
+	vfa->d.seek = _vfaSeek;
+	vfa->d.read = _vfaRead;
+	vfa->d.readline = VFileReadline;
+	vfa->d.write = _vfaWrite;
+	vfa->d.map = _vfaMap;
+	vfa->d.unmap = _vfaUnmap;
+	vfa->d.truncate = _vfaTruncate;
+	vfa->d.size = _vfaSize;
+	vfa->d.sync = _vfaSync;
+
+	return &vfa->d;
+}
+
+static THREAD_ENTRY _vfaRun(void* context) {
+	struct VFileAsync* vfa = context;
+	ThreadSetName("Async I/O");
+	MutexLock(&vfa->mutex);
+	while (!vfa->shutdown) {
+		if (vfa->flushing) {
+			vfa->busy = true;
+			MutexUnlock(&vfa->mutex);
+			bool ok = vfa->backing->seek(vfa->backing, vfa->flushOffset, SEEK_SET) >= 0 &&
+			          vfa->backing->write(vfa->backing, vfa->flushBuffer, vfa->flushSize) == (ssize_t) vfa->flushSize;
+			MutexLock(&vfa->mutex);
+			if (!ok) {
+				vfa->error = true;
+			}
+			vfa->flushing = false;
+			vfa->busy = false;
+			ConditionWake(&vfa->clientCond);
+			continue;
+		}
+		if (vfa->reading && !vfa->eof && vfa->count < ASYNC_BLOCKS) {
+			struct VFileAsyncBlock* block = &vfa->blocks[(vfa->head + vfa->count) % ASYNC_BLOCKS];
+			size_t offset = vfa->nextOffset;
+			unsigned generation = vfa->generation;
+			block->offset = offset;
+			block->size = 0;
+			block->ready = false;
+			++vfa->count;
+			vfa->nextOffset += ASYNC_BLOCK_SIZE;
+			vfa->busy = true;
+			MutexUnlock(&vfa->mutex);
+			ssize_t read = -1;
+			if (vfa->backing->seek(vfa->backing, offset, SEEK_SET) >= 0) {
+				read = vfa->backing->read(vfa->backing, block->data, ASYNC_BLOCK_SIZE);
+			}
+			MutexLock(&vfa->mutex);
+			vfa->busy = false;
+			if (generation == vfa->generation) {
+				if (read < ASYNC_BLOCK_SIZE) {
+					vfa->eof = true;
+					vfa->nextOffset = offset + (read > 0 ? read : 0);
+				}
+				block->size = read > 0 ? read : 0;
+				block->ready = true;
+			}
+			ConditionWake(&vfa->clientCond);
+			continue;
+		}
+		ConditionWait(&vfa->workerCond, &vfa->mutex);
+	}
+	MutexUnlock(&vfa->mutex);
+	THREAD_EXIT(0);
+}
+
+// Drops the read-ahead window, so the next read starts prefetching from wherever
+// the file is then. Must be called with the mutex held
+static void _vfaInvalidate(struct VFileAsync* vfa, bool reading) {
+	++vfa->generation;
+	vfa->count = 0;
+	vfa->eof = false;
+	vfa->nextOffset = vfa->position;
+	vfa->reading = reading;
+}
+
+// Hands the gathered writes to the worker. Must be called with the mutex held
+static void _vfaQueueFlush(struct VFileAsync* vfa) {
+	if (!vfa->writeSize) {
+		return;
+	}
+	while (vfa->flushing) {
+		ConditionWait(&vfa->clientCond, &vfa->mutex);
+	}
+	uint8_t* buffer = vfa->flushBuffer;
+	vfa->flushBuffer = vfa->writeBuffer;
+	vfa->flushOffset = vfa->writeOffset;
+	vfa->flushSize = vfa->writeSize;
+	vfa->writeBuffer = buffer;
+	vfa->writeSize = 0;
+	vfa->flushing = true;
+	ConditionWake(&vfa->workerCond);
+}
+
+// Flushes all writes and waits until the worker is done with the backing file,
+// so that it can be used directly. Must be called with the mutex held
+static void _vfaQuiesce(struct VFileAsync* vfa) {
+	_vfaQueueFlush(vfa);
+	vfa->reading = false;
+	while (vfa->flushing || vfa->busy) {
+		ConditionWait(&vfa->clientCond, &vfa->mutex);
+	}
+}
+
+bool _vfaClose(struct VFile* vf) {
+	struct VFileAsync* vfa = (struct VFileAsync*) vf;
+	MutexLock(&vfa->mutex);
+	_vfaQuiesce(vfa);
+	bool ok = !vfa->error;
+	vfa->shutdown = true;
+	ConditionWake(&vfa->workerCond);
+	MutexUnlock(&vfa->mutex);
+	ThreadJoin(&vfa->thread);
+
+	ConditionDeinit(&vfa->clientCond);
+	ConditionDeinit(&vfa->workerCond);
+	MutexDeinit(&vfa->mutex);
+	size_t i;
+	for (i = 0; i < ASYNC_BLOCKS; ++i) {
+		free(vfa->blocks[i].data);
+	}
+	free(vfa->writeBuffer);
+	free(vfa->flushBuffer);
+	if (!vfa->backing->close(vfa->backing)) {
+		ok = false;
+	}
+	free(vfa);
+	return ok;
+}
+
+off_t _vfaSeek(struct VFile* vf, off_t offset, int whence) {
+	struct VFileAsync* vfa = (struct VFileAsync*) vf;
+	MutexLock(&vfa->mutex);
+	size_t position;
+	switch (whence) {
+	case SEEK_SET:
+		position = 0;
+		break;
+	case SEEK_CUR:
+		position = vfa->position;
+		break;
+	case SEEK_END:
+		_vfaQuiesce(vfa);
+		position = vfa->backing->size(vfa->backing);
+		break;
+	default:
+		MutexUnlock(&vfa->mutex);
+		return -1;
+	}
+	if (offset < 0 && (size_t) -offset > position) {
+		MutexUnlock(&vfa->mutex);
+		return -1;
+	}
+	vfa->position = position + offset;
+	MutexUnlock(&vfa->mutex);
+	return vfa->position;
+}
+
+ssize_t _vfaRead(struct VFile* vf, void* buffer, size_t size) {
+	struct VFileAsync* vfa = (struct VFileAsync*) vf;
+	MutexLock(&vfa->mutex);
+	if (vfa->writeSize || vfa->flushing) {
+		// Anything prefetched may predate the writes
+		_vfaQuiesce(vfa);
+		_vfaInvalidate(vfa, true);
+	} else if (!vfa->reading) {
+		vfa->reading = true;
+	}
+
+	size_t bytesRead = 0;
+	while (bytesRead < size) {
+		size_t windowStart = vfa->count ? vfa->blocks[vfa->head].offset : vfa->nextOffset;
+		if (vfa->position < windowStart || vfa->position > vfa->nextOffset) {
+			_vfaInvalidate(vfa, true);
+			ConditionWake(&vfa->workerCond);
+			continue;
+		}
+		if (!vfa->count) {
+			if (vfa->eof) {
+				break;
+			}
+			ConditionWake(&vfa->workerCond);
+			ConditionWait(&vfa->clientCond, &vfa->mutex);
+			continue;
+		}
+		struct VFileAsyncBlock* block = &vfa->blocks[vfa->head];
+		if (!block->ready) {
+			ConditionWake(&vfa->workerCond);
+			ConditionWait(&vfa->clientCond, &vfa->mutex);
+			continue;
+		}
+		if (vfa->position >= block->offset + block->size) {
+			if (block->size < ASYNC_BLOCK_SIZE) {
+				// Short block, so this is the end of the file
+				break;
+			}
+			vfa->head = (vfa->head + 1) % ASYNC_BLOCKS;
+			--vfa->count;
+			ConditionWake(&vfa->workerCond);
+			continue;
+		}
+		size_t chunk = block->offset + block->size - vfa->position;
+		if (chunk > size - bytesRead) {
+			chunk = size - bytesRead;
+		}
+		memcpy(&((uint8_t*) buffer)[bytesRead], &block->data[vfa->position - block->offset], chunk);
+		bytesRead += chunk;
+		vfa->position += chunk;
+	}
+	MutexUnlock(&vfa->mutex);
+	return bytesRead;
+}
+
+ssize_t _vfaWrite(struct VFile* vf, const void* buffer, size_t size) {
+	struct VFileAsync* vfa = (struct VFileAsync*) vf;
+	MutexLock(&vfa->mutex);
+	if (vfa->error) {
+		MutexUnlock(&vfa->mutex);
+		return -1;
+	}
+	if (vfa->reading || vfa->count) {
+		_vfaInvalidate(vfa, false);
+	}
+	if (vfa->writeSize && vfa->position != vfa->writeOffset + vfa->writeSize) {
+		_vfaQueueFlush(vfa);
+	}
+	size_t written = 0;
+	while (written < size) {
+		if (!vfa->writeSize) {
+			vfa->writeOffset = vfa->position;
+		}
+		size_t chunk = ASYNC_BLOCK_SIZE - vfa->writeSize;
+		if (chunk > size - written) {
+			chunk = size - written;
+		}
+		if (buffer) {
+			memcpy(&vfa->writeBuffer[vfa->writeSize], &((const uint8_t*) buffer)[written], chunk);
+		} else {
+			memset(&vfa->writeBuffer[vfa->writeSize], 0, chunk);
+		}
+		vfa->writeSize += chunk;
+		vfa->position += chunk;
+		written += chunk;
+		if (vfa->writeSize == ASYNC_BLOCK_SIZE) {
+			_vfaQueueFlush(vfa);
+		}
+	}
+	MutexUnlock(&vfa->mutex);
+	return written;
+}
+
+void* _vfaMap(struct VFile* vf, size_t size, int flags) {
+	struct VFileAsync* vfa = (struct VFileAsync*) vf;
+	MutexLock(&vfa->mutex);
+	_vfaQuiesce(vfa);
+	_vfaInvalidate(vfa, false);
+	void* memory = vfa->backing->map(vfa->backing, size, flags);
+	MutexUnlock(&vfa->mutex);
+	return memory;
+}
+
+void _vfaUnmap(struct VFile* vf, void* memory, size_t size) {
+	struct VFileAsync* vfa = (struct VFileAsync*) vf;
+	MutexLock(&vfa->mutex);
+	_vfaQuiesce(vfa);
+	_vfaInvalidate(vfa, false);
+	vfa->backing->unmap(vfa->backing, memory, size);
+	MutexUnlock(&vfa->mutex);
+}
+
+void _vfaTruncate(struct VFile* vf, size_t size) {
+	struct VFileAsync* vfa = (struct VFileAsync*) vf;
+	MutexLock(&vfa->mutex);
+	_vfaQuiesce(vfa);
+	_vfaInvalidate(vfa, false);
+	vfa->backing->truncate(vfa->backing, size);
+	MutexUnlock(&vfa->mutex);
+}
+
+ssize_t _vfaSize(struct VFile* vf) {
+	struct VFileAsync* vfa = (struct VFileAsync*) vf;
+	MutexLock(&vfa->mutex);
+	_vfaQuiesce(vfa);
+	ssize_t size = vfa->backing->size(vfa->backing);
+	MutexUnlock(&vfa->mutex);
+	return size;
+}
+
+bool _vfaSync(struct VFile* vf, void* buffer, size_t size) {
+	struct VFileAsync* vfa = (struct VFileAsync*) vf;
+	MutexLock(&vfa->mutex);
+	_vfaQuiesce(vfa);
+	bool ok = vfa->backing->sync(vfa->backing, buffer, size) && !vfa->error;
+	MutexUnlock(&vfa->mutex);
+	return ok;
+}
+#else
+struct VFile* VFileAsync(struct VFile* backing) {
+	return backing;
+}
+#endif
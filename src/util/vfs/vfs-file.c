@@ -14,6 +14,8 @@ struct VFileFILE {
 	struct VFile d;
 	FILE* file;
 	bool writable;
+	uint8_t* mapping;
+	size_t mapSize;
 };
 
 static bool _vffClose(struct VFile* vf);
@@ -49,6 +51,8 @@ struct VFile* VFileFromFILE(FILE* file) {
 
 	vff->file = file;
 	vff->writable = false;
+	vff->mapping = NULL;
+	vff->mapSize = 0;
 	vff->d.close = _vffClose;
 	vff->d.seek = _vffSeek;
 	vff->d.read = _vffRead;
@@ -101,6 +105,8 @@ static void* _vffMap(struct VFile* vf, size_t size, int flags) {
 	fseek(vff->file, 0, SEEK_SET);
 	fread(mem, size, 1, vff->file);
 	fseek(vff->file, pos, SEEK_SET);
+	vff->mapping = mem;
+	vff->mapSize = size;
 	return mem;
 }
 
@@ -112,6 +118,10 @@ static void _vffUnmap(struct VFile* vf, void* memory, size_t size) {
 		fwrite(memory, size, 1, vff->file);
 		fseek(vff->file, pos, SEEK_SET);
 	}
+	if (memory == vff->mapping) {
+		vff->mapping = NULL;
+		vff->mapSize = 0;
+	}
 	mappedMemoryFree(memory, size);
 }
 
@@ -147,8 +157,13 @@ static ssize_t _vffSize(struct VFile* vf) {
 static bool _vffSync(struct VFile* vf, void* buffer, size_t size) {
 	struct VFileFILE* vff = (struct VFileFILE*) vf;
 	if (buffer && size) {
+		// A buffer inside the mapping only writes back its own part of the file
+		long offset = 0;
+		if ((uint8_t*) buffer >= vff->mapping && (uint8_t*) buffer < vff->mapping + vff->mapSize) {
+			offset = (uint8_t*) buffer - vff->mapping;
+		}
 		long pos = ftell(vff->file);
-		fseek(vff->file, 0, SEEK_SET);
+		fseek(vff->file, offset, SEEK_SET);
 		size_t res = fwrite(buffer, size, 1, vff->file);
 		fseek(vff->file, pos, SEEK_SET);
 		if (res != 1) {
@@ -10,6 +10,7 @@
 #include <mgba-util/memory.h>
 #include <mgba-util/string.h>
 #include <mgba-util/table.h>
+#include <mgba-util/vector.h>
 
 #include "third-party/lzma/7z.h"
 #include "third-party/lzma/7zAlloc.h"
@@ -19,6 +20,7 @@
 #include "third-party/lzma/7zVersion.h"
 
 #define BUFFER_SIZE 0x2000
+#define BLOCK_CACHE_SIZE 0x8000000
 
 struct VDirEntry7z {
 	struct VDirEntry d;
@@ -33,10 +35,26 @@ struct VDir7zAlloc {
 	struct Table allocs;
 };
 
+// A decoded solid block, shared by every file opened from it
+struct VDir7zBlock {
+	UInt32 index;
+	Byte* buffer;
+	size_t size;
+	size_t refs;
+	uint64_t lastUse;
+};
+
+DECLARE_VECTOR(VDir7zBlockList, struct VDir7zBlock*);
+DEFINE_VECTOR(VDir7zBlockList, struct VDir7zBlock*);
+
 struct VDir7z {
 	struct VDir d;
 	struct VDirEntry7z dirent;
 
+	struct VDir7zBlockList blocks;
+	size_t blocksSize;
+	uint64_t blockClock;
+
 	CFileInStream archiveStream;
 	CLookToRead2 lookStream;
 	CSzArEx db;
@@ -48,6 +66,7 @@ struct VFile7z {
 	struct VFile d;
 
 	struct VDir7z* vd;
+	struct VDir7zBlock* block;
 
 	size_t offset;
 
@@ -103,6 +122,36 @@ static void _vd7zFree(ISzAllocPtr p, void* address) {
 	}
 }
 
+static void _vd7zFreeBlock(struct VDir7z* vd, size_t index) {
+	struct VDir7zBlock* block = *VDir7zBlockListGetPointer(&vd->blocks, index);
+	VDir7zBlockListShift(&vd->blocks, index, 1);
+	vd->blocksSize -= block->size;
+	IAlloc_Free(&vd->allocImp.d, block->buffer);
+	free(block);
+}
+
+// Drops the least recently used blocks no file is reading from until the
+// decoded blocks fit in BLOCK_CACHE_SIZE again
+static void _vd7zTrimBlocks(struct VDir7z* vd) {
+	while (vd->blocksSize > BLOCK_CACHE_SIZE) {
+		size_t victim = SIZE_MAX;
+		size_t i;
+		for (i = 0; i < VDir7zBlockListSize(&vd->blocks); ++i) {
+			struct VDir7zBlock* block = *VDir7zBlockListGetPointer(&vd->blocks, i);
+			if (block->refs) {
+				continue;
+			}
+			if (victim == SIZE_MAX || block->lastUse < (*VDir7zBlockListGetPointer(&vd->blocks, victim))->lastUse) {
+				victim = i;
+			}
+		}
+		if (victim == SIZE_MAX) {
+			break;
+		}
+		_vd7zFreeBlock(vd, victim);
+	}
+}
+
 static void* _vd7zAllocTemp(ISzAllocPtr p, size_t size) {
 	UNUSED(p);
 	return malloc(size);
@@ -155,6 +204,10 @@ struct VDir* VDirOpen7z(const char* path, int flags) {
 		return 0;
 	}
 
+	VDir7zBlockListInit(&vd->blocks, 0);
+	vd->blocksSize = 0;
+	vd->blockClock = 0;
+
 	vd->dirent.index = -1;
 	vd->dirent.utf8 = 0;
 	vd->dirent.vd = vd;
@@ -173,7 +226,11 @@ struct VDir* VDirOpen7z(const char* path, int flags) {
 
 bool _vf7zClose(struct VFile* vf) {
 	struct VFile7z* vf7z = (struct VFile7z*) vf;
-	IAlloc_Free(&vf7z->vd->allocImp.d, vf7z->outBuffer);
+	if (vf7z->block) {
+		--vf7z->block->refs;
+		vf7z->block->lastUse = ++vf7z->vd->blockClock;
+		_vd7zTrimBlocks(vf7z->vd);
+	}
 	free(vf7z);
 	return true;
 }
@@ -260,6 +317,10 @@ ssize_t _vf7zSize(struct VFile* vf) {
 
 bool _vd7zClose(struct VDir* vd) {
 	struct VDir7z* vd7z = (struct VDir7z*) vd;
+	while (VDir7zBlockListSize(&vd7z->blocks)) {
+		_vd7zFreeBlock(vd7z, VDir7zBlockListSize(&vd7z->blocks) - 1);
+	}
+	VDir7zBlockListDeinit(&vd7z->blocks);
 	SzArEx_Free(&vd7z->db, &vd7z->allocImp.d);
 	File_Close(&vd7z->archiveStream.file);
 
@@ -328,23 +389,57 @@ struct VFile* _vd7zOpenFile(struct VDir* vd, const char* path, int mode) {
 		return 0; // No file found
 	}
 
-	struct VFile7z* vf = malloc(sizeof(struct VFile7z));
-	vf->vd = vd7z;
-
-	size_t outBufferSize;
-	UInt32 blockIndex;
+	// Files in the same solid block are usually opened one after another, so
+	// reuse the decoded block if it's still around instead of decoding it again
+	struct VDir7zBlock* block = NULL;
+	size_t b;
+	for (b = 0; b < VDir7zBlockListSize(&vd7z->blocks); ++b) {
+		struct VDir7zBlock* candidate = *VDir7zBlockListGetPointer(&vd7z->blocks, b);
+		if (candidate->index == vd7z->db.FileToFolder[i]) {
+			block = candidate;
+			break;
+		}
+	}
 
-	vf->outBuffer = 0;
+	UInt32 blockIndex = block ? block->index : (UInt32) -1;
+	Byte* outBuffer = block ? block->buffer : NULL;
+	size_t outBufferSize = block ? block->size : 0;
+	size_t bufferOffset;
+	size_t size;
 	SRes res = SzArEx_Extract(&vd7z->db, &vd7z->lookStream.vt, i, &blockIndex,
-		&vf->outBuffer, &outBufferSize,
-		&vf->bufferOffset, &vf->size,
+		&outBuffer, &outBufferSize,
+		&bufferOffset, &size,
 		&vd7z->allocImp.d, &vd7z->allocTempImp);
 
 	if (res != SZ_OK) {
-		free(vf);
+		if (!block) {
+			IAlloc_Free(&vd7z->allocImp.d, outBuffer);
+		}
 		return 0;
 	}
 
+	if (!block && outBuffer) {
+		block = malloc(sizeof(*block));
+		block->index = blockIndex;
+		block->buffer = outBuffer;
+		block->size = outBufferSize;
+		block->refs = 0;
+		*VDir7zBlockListAppend(&vd7z->blocks) = block;
+		vd7z->blocksSize += outBufferSize;
+	}
+
+	struct VFile7z* vf = malloc(sizeof(struct VFile7z));
+	vf->vd = vd7z;
+	vf->block = block;
+	vf->outBuffer = outBuffer;
+	vf->bufferOffset = bufferOffset;
+	vf->size = size;
+	if (block) {
+		++block->refs;
+		block->lastUse = ++vd7z->blockClock;
+		_vd7zTrimBlocks(vd7z);
+	}
+
 	vf->d.close = _vf7zClose;
 	vf->d.seek = _vf7zSeek;
 	vf->d.read = _vf7zRead;
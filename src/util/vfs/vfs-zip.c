@@ -6,7 +6,12 @@
 #include <mgba-util/vfs.h>
 
 #include <mgba-util/math.h>
+#include <mgba-util/memory.h>
 #include <mgba-util/string.h>
+#include <mgba-util/threading.h>
+#include <mgba-util/vector.h>
+
+struct VFileZipCacheEntry;
 
 #ifdef USE_LIBZIP
 #include <zip.h>
@@ -27,6 +32,7 @@ struct VDirZip {
 	struct VDir d;
 	struct zip* z;
 	bool write;
+	char* path;
 	struct VDirEntryZip dirent;
 };
 
@@ -43,6 +49,11 @@ struct VFileZip {
 	char* name;
 	bool write;
 	size_t bufferStart;
+
+	char* cacheKey;
+	uint32_t crc32;
+	struct VFileZipCacheEntry* cached;
+	void* view;
 };
 
 enum {
@@ -51,7 +62,6 @@ enum {
 #else
 #include <minizip/zip.h>
 #include <minizip/unzip.h>
-#include <mgba-util/memory.h>
 
 struct VDirEntryZip {
 	struct VDirEntry d;
@@ -65,10 +75,30 @@ struct VDirZip {
 	struct VDir d;
 	unzFile uz;
 	zipFile z;
+	char* path;
 	struct VDirEntryZip dirent;
 	bool atStart;
 };
 
+enum {
+	ZIP_CHECKPOINT_SPAN = 0x40000,
+	ZIP_WINDOW_SIZE = 0x8000,
+	ZIP_INPUT_SIZE = 0x4000,
+};
+
+// Enough inflate state to resume decompressing from the middle of a member:
+// the output and input offsets of a deflate block boundary, the bits of the
+// last input byte that belong to the next block, and the 32 KiB window
+struct VFileZipCheckpoint {
+	size_t out;
+	uint64_t in;
+	int bits;
+	uint8_t* window;
+};
+
+DECLARE_VECTOR(VFileZipCheckpointList, struct VFileZipCheckpoint);
+DEFINE_VECTOR(VFileZipCheckpointList, struct VFileZipCheckpoint);
+
 struct VFileZip {
 	struct VFile d;
 	unzFile uz;
@@ -76,9 +106,63 @@ struct VFileZip {
 	void* buffer;
 	size_t bufferSize;
 	size_t fileSize;
+
+	// Stored and deflated members are read from the archive directly instead
+	// of through the shared unzFile, so they can be seeked independently
+	struct VFile* raw;
+	uint64_t dataOffset;
+	uint64_t compressedSize;
+	bool deflated;
+	size_t position;
+
+	z_stream stream;
+	bool streamValid;
+	uint64_t inPos;
+	size_t outPos;
+	uint8_t* window;
+	size_t windowPos;
+	uint8_t* input;
+	struct VFileZipCheckpointList checkpoints;
+
+	char* cacheKey;
+	uint32_t crc32;
+	struct VFileZipCacheEntry* cached;
+	void* view;
 };
 #endif
 
+// Decompressed members are kept around after their files are closed, up to a
+// memory budget, so reopening the same archive doesn't inflate them again
+struct VFileZipCacheEntry {
+	struct SharedMemory memory;
+	void* contents;
+	char* key;
+	uint32_t crc32;
+	size_t size;
+	size_t refs;
+	uint64_t lastUse;
+	bool published;
+};
+
+DECLARE_VECTOR(VFileZipCacheList, struct VFileZipCacheEntry*);
+DEFINE_VECTOR(VFileZipCacheList, struct VFileZipCacheEntry*);
+
+static bool _cacheEnabled = false;
+static Mutex _cacheMutex;
+static struct VFileZipCacheList _cache;
+static size_t _cacheBudget;
+static size_t _cacheUsed;
+static uint64_t _cacheClock;
+
+struct VFileZipCached {
+	struct VFile d;
+	struct VFileZipCacheEntry* entry;
+	size_t offset;
+	void* view;
+	void* buffer;
+	size_t bufferSize;
+};
+
 static bool _vfzClose(struct VFile* vf);
 static off_t _vfzSeek(struct VFile* vf, off_t offset, int whence);
 static ssize_t _vfzRead(struct VFile* vf, void* buffer, size_t size);
@@ -99,6 +183,304 @@ static bool _vdzDeleteFile(struct VDir* vd, const char* path);
 static const char* _vdezName(struct VDirEntry* vde);
 static enum VFSType _vdezType(struct VDirEntry* vde);
 
+static bool _vfzcClose(struct VFile* vf);
+static off_t _vfzcSeek(struct VFile* vf, off_t offset, int whence);
+static ssize_t _vfzcRead(struct VFile* vf, void* buffer, size_t size);
+static ssize_t _vfzcWrite(struct VFile* vf, const void* buffer, size_t size);
+static void* _vfzcMap(struct VFile* vf, size_t size, int flags);
+static void _vfzcUnmap(struct VFile* vf, void* memory, size_t size);
+static ssize_t _vfzcSize(struct VFile* vf);
+
+void VFileZipCacheInit(size_t budget) {
+	if (_cacheEnabled) {
+		return;
+	}
+	MutexInit(&_cacheMutex);
+	VFileZipCacheListInit(&_cache, 0);
+	_cacheBudget = budget;
+	_cacheUsed = 0;
+	_cacheClock = 0;
+	_cacheEnabled = true;
+}
+
+static void _cacheDestroy(struct VFileZipCacheEntry* entry) {
+	sharedMemoryUnmap(&entry->memory, entry->contents);
+	sharedMemoryDestroy(&entry->memory);
+	free(entry->key);
+	free(entry);
+}
+
+void VFileZipCacheDeinit(void) {
+	if (!_cacheEnabled) {
+		return;
+	}
+	_cacheEnabled = false;
+	size_t i;
+	for (i = 0; i < VFileZipCacheListSize(&_cache); ++i) {
+		_cacheDestroy(*VFileZipCacheListGetPointer(&_cache, i));
+	}
+	VFileZipCacheListDeinit(&_cache);
+	MutexDeinit(&_cacheMutex);
+}
+
+static char* _cacheKey(const char* path, const char* member) {
+	if (!_cacheEnabled || !path) {
+		return NULL;
+	}
+	size_t pathLen = strlen(path);
+	size_t memberLen = strlen(member);
+	char* key = malloc(pathLen + memberLen + 2);
+	memcpy(key, path, pathLen);
+	key[pathLen] = '/';
+	memcpy(&key[pathLen + 1], member, memberLen + 1);
+	return key;
+}
+
+static void _cacheRemove(size_t index) {
+	struct VFileZipCacheEntry* entry = *VFileZipCacheListGetPointer(&_cache, index);
+	VFileZipCacheListShift(&_cache, index, 1);
+	_cacheUsed -= entry->size;
+	_cacheDestroy(entry);
+}
+
+// Evicts the least recently used entries that aren't in use until the cache
+// fits its budget again. Must be called with the mutex held
+static void _cacheTrim(void) {
+	while (_cacheUsed > _cacheBudget) {
+		size_t victim = SIZE_MAX;
+		size_t i;
+		for (i = 0; i < VFileZipCacheListSize(&_cache); ++i) {
+			struct VFileZipCacheEntry* entry = *VFileZipCacheListGetPointer(&_cache, i);
+			if (entry->refs) {
+				continue;
+			}
+			if (victim == SIZE_MAX || entry->lastUse < (*VFileZipCacheListGetPointer(&_cache, victim))->lastUse) {
+				victim = i;
+			}
+		}
+		if (victim == SIZE_MAX) {
+			break;
+		}
+		_cacheRemove(victim);
+	}
+}
+
+static struct VFileZipCacheEntry* _cacheAcquire(const char* key, uint32_t crc32, uint64_t size) {
+	if (!_cacheEnabled || !key) {
+		return NULL;
+	}
+	MutexLock(&_cacheMutex);
+	struct VFileZipCacheEntry* found = NULL;
+	size_t i;
+	for (i = 0; i < VFileZipCacheListSize(&_cache); ++i) {
+		struct VFileZipCacheEntry* entry = *VFileZipCacheListGetPointer(&_cache, i);
+		if (strcmp(entry->key, key) != 0) {
+			continue;
+		}
+		if (entry->crc32 == crc32 && entry->size == size) {
+			found = entry;
+			++found->refs;
+			found->lastUse = ++_cacheClock;
+		} else if (!entry->refs) {
+			// The archive changed since this was cached
+			_cacheRemove(i);
+		}
+		break;
+	}
+	MutexUnlock(&_cacheMutex);
+	return found;
+}
+
+static void _cacheRelease(struct VFileZipCacheEntry* entry) {
+	if (!entry->published) {
+		--entry->refs;
+		if (!entry->refs) {
+			_cacheDestroy(entry);
+		}
+		return;
+	}
+	MutexLock(&_cacheMutex);
+	--entry->refs;
+	entry->lastUse = ++_cacheClock;
+	_cacheTrim();
+	MutexUnlock(&_cacheMutex);
+}
+
+// Returns an unpublished entry with room for size bytes, to be filled in before
+// being handed to _cachePublish
+static struct VFileZipCacheEntry* _cacheCreate(const char* key, uint32_t crc32, size_t size) {
+	if (!size) {
+		return NULL;
+	}
+	struct VFileZipCacheEntry* entry = calloc(1, sizeof(*entry));
+	if (!sharedMemoryCreate(&entry->memory, size)) {
+		free(entry);
+		return NULL;
+	}
+	entry->contents = sharedMemoryMap(&entry->memory, false);
+	if (!entry->contents) {
+		sharedMemoryDestroy(&entry->memory);
+		free(entry);
+		return NULL;
+	}
+	entry->key = key ? strdup(key) : NULL;
+	entry->crc32 = crc32;
+	entry->size = size;
+	return entry;
+}
+
+// Adds a filled-in entry to the cache and returns a copy-on-write view of it,
+// which holds a reference until passed to _cacheUnmap. Entries that can't be
+// cached still work this way, but are destroyed along with their last view
+static void* _cachePublish(struct VFileZipCacheEntry* entry) {
+	void* view = sharedMemoryMap(&entry->memory, true);
+	if (!view) {
+		_cacheDestroy(entry);
+		return NULL;
+	}
+	entry->refs = 1;
+	if (!_cacheEnabled || !entry->key || entry->size > _cacheBudget) {
+		return view;
+	}
+	MutexLock(&_cacheMutex);
+	entry->published = true;
+	entry->lastUse = ++_cacheClock;
+	*VFileZipCacheListAppend(&_cache) = entry;
+	_cacheUsed += entry->size;
+	_cacheTrim();
+	MutexUnlock(&_cacheMutex);
+	return view;
+}
+
+static void* _cacheMap(struct VFileZipCacheEntry* entry) {
+	void* view = sharedMemoryMap(&entry->memory, true);
+	if (view && !entry->published) {
+		++entry->refs;
+	} else if (view) {
+		MutexLock(&_cacheMutex);
+		++entry->refs;
+		MutexUnlock(&_cacheMutex);
+	}
+	return view;
+}
+
+static void _cacheUnmap(struct VFileZipCacheEntry* entry, void* view) {
+	sharedMemoryUnmap(&entry->memory, view);
+	_cacheRelease(entry);
+}
+
+static struct VFile* _vfzcOpen(struct VFileZipCacheEntry* entry) {
+	struct VFileZipCached* vfzc = calloc(1, sizeof(struct VFileZipCached));
+	vfzc->entry = entry;
+
+	vfzc->d.close = _vfzcClose;
+	vfzc->d.seek = _vfzcSeek;
+	vfzc->d.read = _vfzcRead;
+	vfzc->d.readline = VFileReadline;
+	vfzc->d.write = _vfzcWrite;
+	vfzc->d.map = _vfzcMap;
+	vfzc->d.unmap = _vfzcUnmap;
+	vfzc->d.truncate = _vfzTruncate;
+	vfzc->d.size = _vfzcSize;
+	vfzc->d.sync = _vfzSync;
+
+	return &vfzc->d;
+}
+
+bool _vfzcClose(struct VFile* vf) {
+	struct VFileZipCached* vfzc = (struct VFileZipCached*) vf;
+	if (vfzc->view) {
+		_cacheUnmap(vfzc->entry, vfzc->view);
+	}
+	if (vfzc->buffer) {
+		mappedMemoryFree(vfzc->buffer, vfzc->bufferSize);
+	}
+	_cacheRelease(vfzc->entry);
+	free(vfzc);
+	return true;
+}
+
+off_t _vfzcSeek(struct VFile* vf, off_t offset, int whence) {
+	struct VFileZipCached* vfzc = (struct VFileZipCached*) vf;
+	size_t position;
+	switch (whence) {
+	case SEEK_SET:
+		position = 0;
+		break;
+	case SEEK_CUR:
+		position = vfzc->offset;
+		break;
+	case SEEK_END:
+		position = vfzc->entry->size;
+		break;
+	default:
+		return -1;
+	}
+	if (offset < 0 && (size_t) -offset > position) {
+		return -1;
+	}
+	position += offset;
+	if (position > vfzc->entry->size) {
+		return -1;
+	}
+	vfzc->offset = position;
+	return position;
+}
+
+ssize_t _vfzcRead(struct VFile* vf, void* buffer, size_t size) {
+	struct VFileZipCached* vfzc = (struct VFileZipCached*) vf;
+	if (size > vfzc->entry->size - vfzc->offset) {
+		size = vfzc->entry->size - vfzc->offset;
+	}
+	memcpy(buffer, &((uint8_t*) vfzc->entry->contents)[vfzc->offset], size);
+	vfzc->offset += size;
+	return size;
+}
+
+ssize_t _vfzcWrite(struct VFile* vf, const void* buffer, size_t size) {
+	UNUSED(vf);
+	UNUSED(buffer);
+	UNUSED(size);
+	return -1;
+}
+
+void* _vfzcMap(struct VFile* vf, size_t size, int flags) {
+	struct VFileZipCached* vfzc = (struct VFileZipCached*) vf;
+	UNUSED(flags);
+	if (size <= vfzc->entry->size && !vfzc->view) {
+		vfzc->view = _cacheMap(vfzc->entry);
+		if (vfzc->view) {
+			return vfzc->view;
+		}
+	}
+	if (vfzc->buffer) {
+		mappedMemoryFree(vfzc->buffer, vfzc->bufferSize);
+	}
+	vfzc->buffer = anonymousMemoryMap(size);
+	if (!vfzc->buffer) {
+		return NULL;
+	}
+	vfzc->bufferSize = size;
+	memcpy(vfzc->buffer, vfzc->entry->contents, size < vfzc->entry->size ? size : vfzc->entry->size);
+	return vfzc->buffer;
+}
+
+void _vfzcUnmap(struct VFile* vf, void* memory, size_t size) {
+	struct VFileZipCached* vfzc = (struct VFileZipCached*) vf;
+	if (memory && memory == vfzc->view) {
+		_cacheUnmap(vfzc->entry, vfzc->view);
+		vfzc->view = NULL;
+	} else if (memory && memory == vfzc->buffer) {
+		mappedMemoryFree(vfzc->buffer, size);
+		vfzc->buffer = NULL;
+	}
+}
+
+ssize_t _vfzcSize(struct VFile* vf) {
+	struct VFileZipCached* vfzc = (struct VFileZipCached*) vf;
+	return vfzc->entry->size;
+}
+
 #ifndef USE_LIBZIP
 static voidpf _vfmzOpen(voidpf opaque, const char* filename, int mode) {
 	UNUSED(opaque);
@@ -227,6 +609,7 @@ struct VDir* VDirOpenZip(const char* path, int flags) {
 	vd->d.openDir = _vdzOpenDir;
 	vd->d.deleteFile = _vdzDeleteFile;
 	vd->z = z;
+	vd->path = strdup(path);
 
 #ifdef USE_LIBZIP
 	vd->write = !!(flags & O_WRONLY);
@@ -260,6 +643,10 @@ bool _vfzClose(struct VFile* vf) {
 	}
 	free(vfz->name);
 	vfz->name = NULL;
+	if (vfz->view) {
+		_cacheUnmap(vfz->cached, vfz->view);
+	}
+	free(vfz->cacheKey);
 	if (vfz->zf && zip_fclose(vfz->zf) < 0) {
 		return false;
 	}
@@ -429,13 +816,27 @@ void* _vfzMap(struct VFile* vf, size_t size, int flags) {
 	if (vfz->bufferStart != start) {
 		return NULL;
 	}
+	if (vfz->cacheKey && vfz->readSize == vfz->fileSize && !vfz->view && _cacheEnabled && vfz->fileSize <= _cacheBudget) {
+		struct VFileZipCacheEntry* entry = _cacheCreate(vfz->cacheKey, vfz->crc32, vfz->fileSize);
+		if (entry) {
+			memcpy(entry->contents, vfz->buffer, vfz->fileSize);
+			vfz->view = _cachePublish(entry);
+			if (vfz->view) {
+				vfz->cached = entry;
+				return vfz->view;
+			}
+		}
+	}
 	return vfz->buffer;
 }
 
 void _vfzUnmap(struct VFile* vf, void* memory, size_t size) {
-	UNUSED(vf);
-	UNUSED(memory);
+	struct VFileZip* vfz = (struct VFileZip*) vf;
 	UNUSED(size);
+	if (memory && memory == vfz->view) {
+		_cacheUnmap(vfz->cached, vfz->view);
+		vfz->view = NULL;
+	}
 }
 
 void _vfzTruncate(struct VFile* vf, size_t size) {
@@ -454,6 +855,7 @@ bool _vdzClose(struct VDir* vd) {
 	if (zip_close(vdz->z) < 0) {
 		return false;
 	}
+	free(vdz->path);
 	free(vdz);
 	return true;
 }
@@ -486,6 +888,7 @@ struct VFile* _vdzOpenFile(struct VDir* vd, const char* path, int mode) {
 
 	struct zip_file* zf = NULL;
 	struct zip_stat s = {0};
+	char* cacheKey = NULL;
 	if ((mode & O_ACCMODE) == O_WRONLY) {
 		if (!vdz->write) {
 			return 0;
@@ -495,13 +898,25 @@ struct VFile* _vdzOpenFile(struct VDir* vd, const char* path, int mode) {
 			return 0;
 		}
 
+		if (s.valid & ZIP_STAT_CRC) {
+			cacheKey = _cacheKey(vdz->path, path);
+			struct VFileZipCacheEntry* cached = _cacheAcquire(cacheKey, s.crc, s.size);
+			if (cached) {
+				free(cacheKey);
+				return _vfzcOpen(cached);
+			}
+		}
+
 		zf = zip_fopen(vdz->z, path, 0);
 		if (!zf) {
+			free(cacheKey);
 			return 0;
 		}
 	}
 
 	struct VFileZip* vfz = calloc(1, sizeof(struct VFileZip));
+	vfz->cacheKey = cacheKey;
+	vfz->crc32 = s.crc;
 	vfz->zf = zf;
 	vfz->z = vdz->z;
 	vfz->fileSize = s.size;
@@ -558,9 +973,198 @@ static enum VFSType _vdezType(struct VDirEntry* vde) {
 	return VFS_FILE;
 }
 #else
+static void _vfzRestart(struct VFileZip* vfz, const struct VFileZipCheckpoint* checkpoint) {
+	inflateReset(&vfz->stream);
+	vfz->stream.avail_in = 0;
+	vfz->streamValid = false;
+	if (!checkpoint) {
+		vfz->inPos = 0;
+		vfz->outPos = 0;
+		vfz->windowPos = 0;
+		vfz->streamValid = true;
+		return;
+	}
+	vfz->inPos = checkpoint->in;
+	if (checkpoint->bits) {
+		uint8_t byte;
+		if (vfz->raw->seek(vfz->raw, vfz->dataOffset + checkpoint->in - 1, SEEK_SET) < 0 || vfz->raw->read(vfz->raw, &byte, 1) != 1) {
+			return;
+		}
+		inflatePrime(&vfz->stream, checkpoint->bits, byte >> (8 - checkpoint->bits));
+	}
+	inflateSetDictionary(&vfz->stream, checkpoint->window, ZIP_WINDOW_SIZE);
+	memcpy(vfz->window, checkpoint->window, ZIP_WINDOW_SIZE);
+	vfz->windowPos = 0;
+	vfz->outPos = checkpoint->out;
+	vfz->streamValid = true;
+}
+
+static void _vfzCheckpoint(struct VFileZip* vfz) {
+	size_t last = 0;
+	size_t nCheckpoints = VFileZipCheckpointListSize(&vfz->checkpoints);
+	if (nCheckpoints) {
+		last = VFileZipCheckpointListGetPointer(&vfz->checkpoints, nCheckpoints - 1)->out;
+	}
+	if (vfz->outPos < last + ZIP_CHECKPOINT_SPAN) {
+		return;
+	}
+	struct VFileZipCheckpoint* checkpoint = VFileZipCheckpointListAppend(&vfz->checkpoints);
+	checkpoint->out = vfz->outPos;
+	checkpoint->in = vfz->inPos - vfz->stream.avail_in;
+	checkpoint->bits = vfz->stream.data_type & 7;
+	checkpoint->window = malloc(ZIP_WINDOW_SIZE);
+	// The window is circular, so unroll it so it starts with the oldest byte
+	memcpy(checkpoint->window, &vfz->window[vfz->windowPos], ZIP_WINDOW_SIZE - vfz->windowPos);
+	memcpy(&checkpoint->window[ZIP_WINDOW_SIZE - vfz->windowPos], vfz->window, vfz->windowPos);
+}
+
+static const struct VFileZipCheckpoint* _vfzFindCheckpoint(const struct VFileZip* vfz, size_t position) {
+	const struct VFileZipCheckpoint* found = NULL;
+	size_t low = 0;
+	size_t high = VFileZipCheckpointListSize(&vfz->checkpoints);
+	while (low < high) {
+		size_t mid = low + (high - low) / 2;
+		const struct VFileZipCheckpoint* checkpoint = VFileZipCheckpointListGetConstPointer(&vfz->checkpoints, mid);
+		if (checkpoint->out <= position) {
+			found = checkpoint;
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return found;
+}
+
+// Inflates the next size bytes of the member into buffer, or discards them if
+// buffer is NULL, checkpointing at block boundaries along the way
+static ssize_t _vfzInflate(struct VFileZip* vfz, uint8_t* buffer, size_t size) {
+	size_t produced = 0;
+	while (produced < size) {
+		if (!vfz->stream.avail_in && vfz->inPos < vfz->compressedSize) {
+			size_t toRead = ZIP_INPUT_SIZE;
+			if (toRead > vfz->compressedSize - vfz->inPos) {
+				toRead = vfz->compressedSize - vfz->inPos;
+			}
+			if (vfz->raw->seek(vfz->raw, vfz->dataOffset + vfz->inPos, SEEK_SET) < 0) {
+				break;
+			}
+			ssize_t read = vfz->raw->read(vfz->raw, vfz->input, toRead);
+			if (read <= 0) {
+				break;
+			}
+			vfz->stream.next_in = vfz->input;
+			vfz->stream.avail_in = read;
+			vfz->inPos += read;
+		}
+		size_t chunk = ZIP_WINDOW_SIZE - vfz->windowPos;
+		if (chunk > size - produced) {
+			chunk = size - produced;
+		}
+		vfz->stream.next_out = &vfz->window[vfz->windowPos];
+		vfz->stream.avail_out = chunk;
+		int status = inflate(&vfz->stream, Z_BLOCK);
+		size_t inflated = chunk - vfz->stream.avail_out;
+		if (buffer) {
+			memcpy(&buffer[produced], &vfz->window[vfz->windowPos], inflated);
+		}
+		produced += inflated;
+		vfz->outPos += inflated;
+		vfz->windowPos = (vfz->windowPos + inflated) & (ZIP_WINDOW_SIZE - 1);
+		if (status == Z_STREAM_END) {
+			break;
+		}
+		if (status != Z_OK) {
+			if (status != Z_BUF_ERROR) {
+				vfz->streamValid = false;
+				if (!produced) {
+					return -1;
+				}
+			}
+			break;
+		}
+		// Bit 7 is set at the end of a block header, bit 6 if it was the last block
+		if ((vfz->stream.data_type & 0xC0) == 0x80) {
+			_vfzCheckpoint(vfz);
+		}
+	}
+	return produced;
+}
+
+static ssize_t _vfzReadRaw(struct VFileZip* vfz, void* buffer, size_t size) {
+	if (vfz->position >= vfz->fileSize) {
+		return 0;
+	}
+	if (size > vfz->fileSize - vfz->position) {
+		size = vfz->fileSize - vfz->position;
+	}
+	ssize_t read;
+	if (!vfz->deflated) {
+		if (vfz->raw->seek(vfz->raw, vfz->dataOffset + vfz->position, SEEK_SET) < 0) {
+			return -1;
+		}
+		read = vfz->raw->read(vfz->raw, buffer, size);
+	} else {
+		// Resume from the closest checkpoint unless carrying on from here is closer
+		const struct VFileZipCheckpoint* checkpoint = _vfzFindCheckpoint(vfz, vfz->position);
+		if (!vfz->streamValid || vfz->position < vfz->outPos || (checkpoint && checkpoint->out > vfz->outPos)) {
+			_vfzRestart(vfz, checkpoint);
+			if (!vfz->streamValid) {
+				return -1;
+			}
+		}
+		size_t skip = vfz->position - vfz->outPos;
+		if (skip && _vfzInflate(vfz, NULL, skip) != (ssize_t) skip) {
+			return -1;
+		}
+		read = _vfzInflate(vfz, buffer, size);
+	}
+	if (read > 0) {
+		vfz->position += read;
+	}
+	return read;
+}
+
+// Reads from the start of the member without disturbing the current position
+static ssize_t _vfzReadFromStart(struct VFileZip* vfz, void* buffer, size_t size) {
+	if (size > vfz->fileSize) {
+		size = vfz->fileSize;
+	}
+	if (vfz->raw) {
+		size_t position = vfz->position;
+		vfz->position = 0;
+		ssize_t read = _vfzReadRaw(vfz, buffer, size);
+		vfz->position = position;
+		return read;
+	}
+
+	off_t pos = vfz->d.seek(&vfz->d, 0, SEEK_CUR);
+	if (pos < 0) {
+		return -1;
+	}
+	unzCloseCurrentFile(vfz->uz);
+	unzOpenCurrentFile(vfz->uz);
+	ssize_t read = unzReadCurrentFile(vfz->uz, buffer, size);
+	unzCloseCurrentFile(vfz->uz);
+	unzOpenCurrentFile(vfz->uz);
+	vfz->d.seek(&vfz->d, pos, SEEK_SET);
+	return read;
+}
+
 bool _vfzClose(struct VFile* vf) {
 	struct VFileZip* vfz = (struct VFileZip*) vf;
-	if (vfz->uz) {
+	if (vfz->raw) {
+		vfz->raw->close(vfz->raw);
+		if (vfz->deflated) {
+			inflateEnd(&vfz->stream);
+		}
+		free(vfz->window);
+		free(vfz->input);
+		size_t i;
+		for (i = 0; i < VFileZipCheckpointListSize(&vfz->checkpoints); ++i) {
+			free(VFileZipCheckpointListGetPointer(&vfz->checkpoints, i)->window);
+		}
+		VFileZipCheckpointListDeinit(&vfz->checkpoints);
+	} else if (vfz->uz) {
 		unzCloseCurrentFile(vfz->uz);
 	}
 	if (vfz->z) {
@@ -569,6 +1173,10 @@ bool _vfzClose(struct VFile* vf) {
 	if (vfz->buffer) {
 		mappedMemoryFree(vfz->buffer, vfz->bufferSize);
 	}
+	if (vfz->view) {
+		_cacheUnmap(vfz->cached, vfz->view);
+	}
+	free(vfz->cacheKey);
 	free(vfz);
 	return true;
 }
@@ -579,6 +1187,33 @@ off_t _vfzSeek(struct VFile* vf, off_t offset, int whence) {
 		return -1;
 	}
 
+	if (vfz->raw) {
+		size_t position;
+		switch (whence) {
+		case SEEK_SET:
+			position = 0;
+			break;
+		case SEEK_CUR:
+			position = vfz->position;
+			break;
+		case SEEK_END:
+			position = vfz->fileSize;
+			break;
+		default:
+			return -1;
+		}
+		if (offset < 0 && (size_t) -offset > position) {
+			return -1;
+		}
+		position += offset;
+		if (position > vfz->fileSize) {
+			return -1;
+		}
+		// Decompression catches up lazily on the next read
+		vfz->position = position;
+		return position;
+	}
+
 	int64_t currentPos = unztell64(vfz->uz);
 	int64_t pos;
 	switch (whence) {
@@ -622,6 +1257,23 @@ off_t _vfzSeek(struct VFile* vf, off_t offset, int whence) {
 
 ssize_t _vfzRead(struct VFile* vf, void* buffer, size_t size) {
 	struct VFileZip* vfz = (struct VFileZip*) vf;
+	if (vfz->raw) {
+		// Once the whole member has been mapped, read from the pristine copy behind
+		// the mapping instead of inflating it again
+		if (vfz->view) {
+			const uint8_t* contents = vfz->cached->contents;
+			if (vfz->position >= vfz->fileSize) {
+				return 0;
+			}
+			if (size > vfz->fileSize - vfz->position) {
+				size = vfz->fileSize - vfz->position;
+			}
+			memcpy(buffer, &contents[vfz->position], size);
+			vfz->position += size;
+			return size;
+		}
+		return _vfzReadRaw(vfz, buffer, size);
+	}
 	return unzReadCurrentFile(vfz->uz, buffer, size);
 }
 
@@ -640,22 +1292,34 @@ void* _vfzMap(struct VFile* vf, size_t size, int flags) {
 	// TODO
 	UNUSED(flags);
 
-	off_t pos = vf->seek(vf, 0, SEEK_CUR);
-	if (pos < 0) {
-		return 0;
+	if (size <= vfz->fileSize && !vfz->view) {
+		struct VFileZipCacheEntry* entry = _cacheCreate(vfz->cacheKey, vfz->crc32, vfz->fileSize);
+		if (entry) {
+			if (_vfzReadFromStart(vfz, entry->contents, vfz->fileSize) == (ssize_t) vfz->fileSize) {
+				vfz->view = _cachePublish(entry);
+				if (vfz->view) {
+					vfz->cached = entry;
+					return vfz->view;
+				}
+			} else {
+				_cacheDestroy(entry);
+			}
+		}
 	}
 
+	if (vfz->buffer) {
+		mappedMemoryFree(vfz->buffer, vfz->bufferSize);
+	}
 	vfz->buffer = anonymousMemoryMap(size);
 	if (!vfz->buffer) {
 		return 0;
 	}
 
-	unzCloseCurrentFile(vfz->uz);
-	unzOpenCurrentFile(vfz->uz);
-	vf->read(vf, vfz->buffer, size);
-	unzCloseCurrentFile(vfz->uz);
-	unzOpenCurrentFile(vfz->uz);
-	vf->seek(vf, pos, SEEK_SET);
+	if (_vfzReadFromStart(vfz, vfz->buffer, size) < 0) {
+		mappedMemoryFree(vfz->buffer, size);
+		vfz->buffer = 0;
+		return 0;
+	}
 
 	vfz->bufferSize = size;
 
@@ -665,6 +1329,12 @@ void* _vfzMap(struct VFile* vf, size_t size, int flags) {
 void _vfzUnmap(struct VFile* vf, void* memory, size_t size) {
 	struct VFileZip* vfz = (struct VFileZip*) vf;
 
+	if (memory && memory == vfz->view) {
+		_cacheUnmap(vfz->cached, vfz->view);
+		vfz->view = 0;
+		return;
+	}
+
 	if (memory != vfz->buffer) {
 		return;
 	}
@@ -692,6 +1362,7 @@ bool _vdzClose(struct VDir* vd) {
 	if (vdz->z && zipClose(vdz->z, NULL) < 0) {
 		return false;
 	}
+	free(vdz->path);
 	free(vdz);
 	return true;
 }
@@ -729,19 +1400,41 @@ struct VFile* _vdzOpenFile(struct VDir* vd, const char* path, int mode) {
 	}
 
 	unz_file_info64 info = {0};
+	char* cacheKey = NULL;
+	struct VFile* raw = NULL;
+	uint64_t dataOffset = 0;
 	if ((mode & O_ACCMODE) == O_RDONLY) {
 		if (unzLocateFile(vdz->uz, path, 0) != UNZ_OK) {
 			return 0;
 		}
 
-		if (unzOpenCurrentFile(vdz->uz) < 0) {
+		int status = unzGetCurrentFileInfo64(vdz->uz, &info, 0, 0, 0, 0, 0, 0);
+		if (status < 0) {
+			return 0;
+		}
+		if (info.uncompressed_size > SIZE_MAX) {
 			return 0;
 		}
 
-		int status = unzGetCurrentFileInfo64(vdz->uz, &info, 0, 0, 0, 0, 0, 0);
-		if (status < 0) {
+		cacheKey = _cacheKey(vdz->path, path);
+		struct VFileZipCacheEntry* cached = _cacheAcquire(cacheKey, info.crc, info.uncompressed_size);
+		if (cached) {
+			free(cacheKey);
+			return _vfzcOpen(cached);
+		}
+
+		if (unzOpenCurrentFile(vdz->uz) < 0) {
+			free(cacheKey);
 			return 0;
 		}
+
+		if (!(info.flag & 1) && (info.compression_method == 0 || info.compression_method == Z_DEFLATED)) {
+			raw = VFileOpen(vdz->path, O_RDONLY);
+		}
+		if (raw) {
+			dataOffset = unzGetCurrentFileZStreamPos64(vdz->uz);
+			unzCloseCurrentFile(vdz->uz);
+		}
 	} else {
 		if (zipOpenNewFileInZip(vdz->z, path, NULL, NULL, 0, NULL, 0, NULL, Z_DEFLATED, 3) < 0) {
 			return 0;
@@ -754,6 +1447,27 @@ struct VFile* _vdzOpenFile(struct VDir* vd, const char* path, int mode) {
 	vfz->buffer = 0;
 	vfz->bufferSize = 0;
 	vfz->fileSize = info.uncompressed_size;
+	vfz->cacheKey = cacheKey;
+	vfz->crc32 = info.crc;
+
+	if (raw) {
+		vfz->raw = raw;
+		vfz->dataOffset = dataOffset;
+		vfz->compressedSize = info.compressed_size;
+		vfz->deflated = info.compression_method == Z_DEFLATED;
+		if (vfz->deflated) {
+			if (inflateInit2(&vfz->stream, -MAX_WBITS) != Z_OK) {
+				raw->close(raw);
+				free(cacheKey);
+				free(vfz);
+				return 0;
+			}
+			vfz->window = malloc(ZIP_WINDOW_SIZE);
+			vfz->input = malloc(ZIP_INPUT_SIZE);
+			vfz->streamValid = true;
+		}
+		VFileZipCheckpointListInit(&vfz->checkpoints, 0);
+	}
 
 	vfz->d.close = _vfzClose;
 	vfz->d.seek = _vfzSeek;